@@ -26,6 +26,8 @@
 #include "types.h"
 #include <stdbool.h>
 
+struct DirSnapshot;
+
 /* Backup adapter interface */
 typedef struct BackupAdapter {
 	const char *name;
@@ -33,6 +35,14 @@ typedef struct BackupAdapter {
 	/* Detect if a path contains a backup of this type */
 	bool (*detect)(const char *path);
 
+	/* The same, answered from the directory's entries as the scanner
+	 * read them (see dir_snapshot_read()).  NULL: detect() is used. */
+	bool (*detect_entries)(const char *path, const struct DirSnapshot *entries);
+
+	/* Whether further backups can lie below a detected one.  When false,
+	 * the scanner does not descend into the directories of a backup. */
+	bool nested;
+
 	/* Scan and parse backup metadata */
 	BackupInfo* (*scan)(const char *backup_root);
 	int (*read_metadata)(const char *backup_path, BackupInfo *info);
@@ -50,6 +60,16 @@ typedef struct BackupAdapter {
 
 	/* Cleanup */
 	void (*cleanup)(BackupInfo *info);
+
+	/* Complete a record scan() returned at BACKUP_LOAD_IDENTITY.  NULL
+	 * when scan() always loads everything. */
+	bool (*load_details)(BackupInfo *info);
+
+	/* Files and directories, relative to the detected path, whose size
+	 * and mtime determine what scan() returns.  A "*" component matches
+	 * every entry of that directory.  NULL-terminated; used by the
+	 * catalog index to tell whether a cached scan is still current. */
+	const char *const *metadata_files;
 } BackupAdapter;
 
 /* Adapter registration */
@@ -62,6 +82,7 @@ extern BackupAdapter pgbackrest_adapter;
 
 /* Helper functions */
 BackupAdapter* detect_backup_type(const char *path);
+BackupAdapter* detect_backup_type_in(const char *path, const struct DirSnapshot *entries);
 BackupAdapter* get_adapter_for_tool(BackupTool tool);
 const char* backup_type_to_string(BackupType type);
 const char* backup_tool_to_string(BackupTool tool);
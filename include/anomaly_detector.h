@@ -0,0 +1,130 @@
+/*
+ * anomaly_detector.h
+ *
+ * Incremental anomaly detection over backup sizes and durations
+ *
+ * Every (tool, instance, type) has a baseline of its own, fed one backup
+ * at a time in start time order.  For both size (data + WAL) and
+ * duration a baseline keeps an exponentially weighted moving average and
+ * the last ANOMALY_WINDOW values, from which the median and the median
+ * absolute deviation (MAD) are taken.  A backup is scored against the
+ * baseline as it was before the backup, then folded into it; the cost
+ * and the memory per baseline are constant however long the history.
+ *
+ * A value is anomalous when it is more than ANOMALY_RATIO times off both
+ * the median and the moving average, and its robust z-score
+ * (0.6745 * (x - median) / MAD) exceeds ANOMALY_SCORE.  The median and
+ * MAD shrug off earlier outliers; the moving average follows a lasting
+ * change of level (a database that doubled), which then stops being
+ * reported after a few backups.
+ *
+ * With a cache directory (validation_set_cache_dir()) the baselines are
+ * kept next to the catalog index, together with the findings of backups
+ * already folded in, so a later run only scores backups that are new.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include "pg_backup_auditor.h"
+
+#define ANOMALY_WINDOW          32      /* values kept for the median and MAD */
+#define ANOMALY_MIN_HISTORY     3       /* backups in a baseline before scoring */
+#define ANOMALY_EWMA_ALPHA      0.25    /* weight of the newest value */
+#define ANOMALY_RATIO           2.0
+#define ANOMALY_SCORE           3.5
+
+typedef enum {
+	ANOMALY_SIZE_LARGE,
+	ANOMALY_SIZE_SMALL,
+	ANOMALY_DURATION_LONG,
+	ANOMALY_DURATION_SHORT
+} AnomalyKind;
+
+/* Findings per backup: at most one for the size and one for the duration */
+#define ANOMALY_MAX_FINDINGS    2
+
+typedef struct {
+	char        backup_id[64];
+	time_t      start_time;
+	AnomalyKind kind;
+	double      value;
+	double      median;             /* of the baseline before this backup */
+	double      ewma;
+	double      ratio;              /* how many times off the median, >= 1 */
+	double      score;              /* robust z-score; 0 if the MAD was 0 */
+} AnomalyFinding;
+
+/* One measure of a baseline */
+typedef struct {
+	uint64_t    count;              /* values seen */
+	double      ewma;
+	double      window[ANOMALY_WINDOW]; /* the latest values, a ring */
+} AnomalySeries;
+
+typedef struct AnomalyDetector AnomalyDetector;
+
+/* "size_large", "size_small", "duration_long" or "duration_short" */
+const char      *anomaly_kind_name(AnomalyKind kind);
+
+void             anomaly_series_add(AnomalySeries *s, double value);
+/* Median and MAD of the window; false if the series is empty */
+bool             anomaly_series_median(const AnomalySeries *s, double *median,
+									   double *mad);
+
+/*
+ * A detector for the catalog at 'backup_dir', with the baselines saved
+ * by an earlier run if a cache directory is set.  NULL 'backup_dir' makes
+ * one that is never saved.  NULL on allocation failure.
+ */
+AnomalyDetector *anomaly_detector_open(const char *backup_dir);
+
+/*
+ * Score 'backup' against its baseline and fold it in; a backup the
+ * baseline already holds (it started no later than the newest one folded
+ * in) is not scored again and gets the findings it had then.  Backups
+ * that are not baseline ones (backup_stats_is_baseline()) are ignored.
+ * Size findings below the median are produced with 'detect_size_small'
+ * only.  Fills 'out' and returns the number of findings.
+ */
+int              anomaly_detector_observe(AnomalyDetector *detector,
+										  const BackupInfo *backup,
+										  bool detect_size_small,
+										  AnomalyFinding out[ANOMALY_MAX_FINDINGS]);
+
+/*
+ * The baseline backups of 'list' in the order the detector takes them:
+ * by start time, then backup ID.  Sets *count; NULL if there are none or
+ * on allocation failure.
+ */
+const BackupInfo **anomaly_detector_order(const BackupInfo *list, int *count);
+
+/* Baselines the detector holds */
+int              anomaly_detector_baselines(const AnomalyDetector *detector);
+
+/*
+ * Write the baselines back if they changed, with the findings of the
+ * backups observed since the detector was opened (or last saved); those
+ * of backups that were not observed are dropped.
+ */
+void             anomaly_detector_save(AnomalyDetector *detector);
+
+/* Save, then free */
+void             anomaly_detector_close(AnomalyDetector *detector);
+
+#endif /* ANOMALY_DETECTOR_H */
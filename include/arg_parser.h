@@ -24,6 +24,8 @@
 #define ARG_PARSER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 
 /*
  * Check if an option has been seen multiple times and report error
@@ -44,6 +46,24 @@ bool parse_string_option(const char *option_name, const char *value,
  */
 bool parse_int_argument(const char *str, int *result, const char *option_name);
 
+/*
+ * Parse a byte count with an optional K, M, G or T suffix (powers of
+ * 1024), e.g. "200M".  Returns true on success, false on error.
+ */
+bool parse_size_argument(const char *str, uint64_t *result, const char *option_name);
+
+/*
+ * Parse a positive duration in seconds, with an optional s, m, h or d
+ * suffix, e.g. "90m".  Returns true on success, false on error.
+ */
+bool parse_duration_argument(const char *str, time_t *result, const char *option_name);
+
+/*
+ * Parse a fraction in (0, 1], written as a decimal ("0.1") or a
+ * percentage ("10%").  Returns true on success, false on error.
+ */
+bool parse_fraction_argument(const char *str, double *result, const char *option_name);
+
 /*
  * Validate that a required argument is provided
  * Returns true if valid, false if missing
@@ -0,0 +1,69 @@
+/*
+ * async_read.h
+ *
+ * Batched asynchronous whole-file reads.
+ *
+ * On Linux with io_uring (5.10 or later) one thread keeps many reads in
+ * flight across files, into a fixed set of registered buffers, while
+ * worker threads consume the filled buffers.  Where io_uring is missing
+ * (macOS, FreeBSD, older kernels, or a sandbox that forbids it)
+ * async_read_files() returns false before doing anything, and the caller
+ * reads the files the ordinary way.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ASYNC_READ_H
+#define ASYNC_READ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Buffers in flight, and the size of each */
+#define ASYNC_READ_DEPTH      32
+#define ASYNC_READ_BUF_SIZE   (256 * 1024)
+
+typedef struct {
+	const char *path;
+	void       *arg;            /* handed back to the callbacks */
+} AsyncReadFile;
+
+/*
+ * Consume one chunk of a file.  Chunks of one file arrive in order and
+ * never concurrently; chunks of different files may be handled on
+ * different threads at the same time.
+ */
+typedef void (*AsyncReadDataFn)(void *arg, const uint8_t *buf, size_t len);
+
+/* A file is finished: 'error' is 0 at end of file, otherwise an errno */
+typedef void (*AsyncReadDoneFn)(void *arg, int error);
+
+/* Whether async_read_files() can work on this system */
+bool async_read_supported(void);
+
+/*
+ * Read every file front to back, calling on_data for each chunk and
+ * on_done once per file.  The calling thread drives the I/O; 'workers'
+ * additional threads run the callbacks (0 runs them on the caller).
+ *
+ * Returns false, with no callback made, if the asynchronous engine is
+ * not available.
+ */
+bool async_read_files(const AsyncReadFile *files, int count, int workers,
+					  AsyncReadDataFn on_data, AsyncReadDoneFn on_done);
+
+#endif /* ASYNC_READ_H */
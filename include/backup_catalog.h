@@ -0,0 +1,114 @@
+/*
+ * backup_catalog.h
+ *
+ * Compact in-memory catalog of scanned backups.
+ *
+ * A BackupInfo is several kilobytes, most of it fixed-size string
+ * buffers.  The catalog keeps one small BackupRecord per backup in a
+ * contiguous array; strings are interned in a shared arena (equal strings
+ * share one copy, so equal references mean equal strings) and backups are
+ * found by id through a hash table.  Records are in the order of the list
+ * the catalog was built from; commands sort and filter arrays of record
+ * indices and expand a record to a BackupInfo only to print it.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKUP_CATALOG_H
+#define BACKUP_CATALOG_H
+
+#include "pg_backup_auditor.h"
+
+/* Offset of an interned string in BackupCatalog.strings; 0 is "" */
+typedef uint32_t CatalogStr;
+
+typedef struct {
+	CatalogStr      backup_id;
+	CatalogStr      node_name;
+	CatalogStr      instance_name;
+	CatalogStr      tool_version;
+	CatalogStr      parent_backup_id;
+	CatalogStr      backup_path;
+	CatalogStr      backup_dir;         /* backup_path without its last component */
+	CatalogStr      backup_method;
+	CatalogStr      backup_from;
+	CatalogStr      backup_label;
+	CatalogStr      wal_start_file;
+	CatalogStr      compress_alg;
+	CatalogStr      wal_mode;
+	int32_t         parent;             /* Record of parent_backup_id, -1 if none */
+	BackupType      type;
+	BackupTool      tool;
+	BackupStatus    status;
+	TimeLineID      timeline;
+	uint32_t        pg_version;
+	bool            wal_stream;
+	bool            partial;
+	time_t          start_time;
+	time_t          end_time;
+	XLogRecPtr      start_lsn;
+	XLogRecPtr      stop_lsn;
+	XLogRecPtr      redo_lsn;
+	uint64_t        data_bytes;
+	uint64_t        wal_bytes;
+} BackupRecord;
+
+typedef struct {
+	BackupRecord   *records;
+	int             count;
+	char           *strings;            /* Arena of NUL-terminated strings */
+	size_t          strings_len;
+	size_t          strings_cap;
+	CatalogStr     *str_slots;          /* Interning hash, 0 = empty */
+	size_t          str_capacity;
+	size_t          str_count;
+	int32_t        *id_slots;           /* backup_id -> record index, -1 = empty */
+	size_t          id_capacity;
+} BackupCatalog;
+
+/* Orders for backup_catalog_sort() */
+typedef enum {
+	CATALOG_ORDER_START_TIME,
+	CATALOG_ORDER_END_TIME,         /* unfinished (end_time 0) last */
+	CATALOG_ORDER_NAME,
+	CATALOG_ORDER_SIZE,
+	CATALOG_ORDER_START_LSN
+} CatalogOrder;
+
+BackupCatalog *backup_catalog_build(const BackupInfo *list);
+void           backup_catalog_free(BackupCatalog *catalog);
+
+const char    *backup_catalog_str(const BackupCatalog *catalog, CatalogStr ref);
+
+/* Record index of the first backup called 'backup_id', or -1 */
+int            backup_catalog_find(const BackupCatalog *catalog, const char *backup_id);
+
+/* Root FULL record of 'index' following parent links, or -1 */
+int            backup_catalog_find_root(const BackupCatalog *catalog, int index);
+
+/* Expand a record into a standalone BackupInfo (next = NULL) */
+void           backup_catalog_get(const BackupCatalog *catalog, int index,
+								  BackupInfo *out);
+
+/* <0, 0 or >0 as record 'a' comes before, with or after 'b' in 'order' */
+int            backup_catalog_compare(const BackupCatalog *catalog, int a, int b,
+									  CatalogOrder order);
+
+/* Stable sort of record indices */
+void           backup_catalog_sort(const BackupCatalog *catalog, int *indices,
+								   int n, CatalogOrder order);
+
+#endif /* BACKUP_CATALOG_H */
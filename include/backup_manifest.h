@@ -0,0 +1,96 @@
+/*
+ * backup_manifest.h
+ *
+ * Single-pass reader for PostgreSQL's backup_manifest (PostgreSQL 13+).
+ *
+ * The manifest is mapped into memory (or read from a caller's buffer,
+ * e.g. a member extracted from a tar archive) and tokenized once, front
+ * to back.  manifest_reader_next() returns each "Files" entry with its
+ * fields as slices pointing into the mapping, so nothing is copied per
+ * line; the "WAL-Ranges" and "Manifest-Checksum" values are picked up on
+ * the same pass.  When asked to, the reader hashes the bytes preceding
+ * "Manifest-Checksum" as it goes, so the manifest's own checksum needs
+ * no second read.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKUP_MANIFEST_H
+#define BACKUP_MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "json_scan.h"
+#include "sha256.h"
+#include "types.h"
+
+/* One entry of the "Files" array */
+typedef struct {
+	JsonSlice     path;             /* raw JSON string contents */
+	JsonSlice     algorithm;        /* "Checksum-Algorithm" */
+	JsonSlice     checksum;
+	uint64_t      size;
+	bool          has_size;
+} ManifestFileEntry;
+
+typedef struct {
+	const char *data;
+	size_t      size;
+	size_t      pos;
+	bool        mapped;             /* data is an mmap() of the file */
+	int         state;
+
+	/* Hash of the bytes before "Manifest-Checksum", if requested */
+	bool        hash;
+	size_t      hashed;
+	SHA256Ctx   ctx;
+
+	/* First "WAL-Ranges" entry */
+	bool        has_wal_range;
+	TimeLineID  timeline;
+	XLogRecPtr  start_lsn;
+	XLogRecPtr  end_lsn;
+
+	/* "Manifest-Checksum" */
+	bool          has_checksum;
+	JsonSlice     stored_checksum;
+	size_t        checksum_offset;  /* start of the line holding the key */
+	char          computed_checksum[SHA256_HEX_LENGTH + 1];
+} ManifestReader;
+
+/*
+ * Map 'path' for reading.  With 'hash' the manifest checksum is computed
+ * during the scan.  Returns false if the file cannot be opened.
+ */
+bool manifest_reader_open(ManifestReader *r, const char *path, bool hash);
+
+/* Read a manifest held in memory; 'data' must outlive the reader */
+void manifest_reader_init(ManifestReader *r, const char *data, size_t size,
+						  bool hash);
+
+/*
+ * Advance to the next "Files" entry.  Returns 1 and fills 'entry', 0
+ * once the whole manifest has been read, or -1 if it is malformed (the
+ * byte offset is in r->pos).  Slices stay valid until the reader is
+ * closed.
+ */
+int  manifest_reader_next(ManifestReader *r, ManifestFileEntry *entry);
+
+void manifest_reader_close(ManifestReader *r);
+
+#endif /* BACKUP_MANIFEST_H */
@@ -0,0 +1,129 @@
+/*
+ * backup_stats.h
+ *
+ * Single-pass statistics over a backup list.
+ *
+ * backup_stats_build() walks the list once and folds every backup into
+ * two sets of accumulators, found through hash tables so that neither
+ * the number of instances nor of tools and types is bounded: groups,
+ * keyed by (tool, instance, type) -- or by (tool, type), pooling the
+ * instances, for per-tool baselines -- and instances, keyed by (tool,
+ * instance).  A StatAccum keeps count, sum, min, max and a streaming
+ * mean and variance (Welford's method), so 'stat' and the anomaly
+ * baselines of 'audit' come from the same pass.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKUP_STATS_H
+#define BACKUP_STATS_H
+
+#include "pg_backup_auditor.h"
+
+/* Backup statuses have consecutive values from BACKUP_STATUS_OK */
+#define BACKUP_STATS_STATUSES   (BACKUP_STATUS_WARNING + 1)
+
+typedef struct {
+	uint64_t    count;
+	double      sum;
+	double      min;
+	double      max;
+	double      mean;
+	double      m2;                 /* sum of squared deviations from mean */
+} StatAccum;
+
+void   stat_accum_add(StatAccum *acc, double value);
+/* Sample variance and standard deviation; 0 below two values */
+double stat_accum_variance(const StatAccum *acc);
+double stat_accum_stddev(const StatAccum *acc);
+
+typedef enum {
+	BACKUP_STATS_BY_INSTANCE,       /* groups per (tool, instance, type) */
+	BACKUP_STATS_BY_TOOL            /* groups per (tool, type) */
+} BackupStatsGrouping;
+
+/*
+ * Backups of one group.  A backup is a baseline one if it is OK or
+ * WARNING, has data and a positive duration: the others' sizes and
+ * timestamps are unreliable and would skew what is "normal".
+ */
+typedef struct {
+	BackupTool  tool;
+	BackupType  type;
+	char        instance_name[64];  /* "" with BACKUP_STATS_BY_TOOL */
+	int         count;
+	int         ok_count;           /* status OK */
+	uint64_t    total_bytes;        /* data + WAL */
+	uint64_t    total_wal_bytes;
+	time_t      min_time;           /* earliest and latest start; 0 if none */
+	time_t      max_time;
+	StatAccum   duration;           /* durations below 48 hours */
+	StatAccum   baseline_size;      /* data + WAL of baseline backups */
+	StatAccum   baseline_duration;
+} BackupStatGroup;
+
+typedef struct {
+	time_t      start_time;
+	uint64_t    data_bytes;
+} BackupStatFull;
+
+/* Backups of one (tool, instance) */
+typedef struct {
+	BackupTool  tool;
+	char        instance_name[64];
+	int         count;
+	uint64_t    wal_bytes;          /* of the backups that hold WAL, */
+	time_t      wal_min_time;       /* and their start times; 0 if none */
+	time_t      wal_max_time;
+	StatAccum   full_bytes;         /* data of OK / WARNING FULL backups */
+	BackupStatFull first_full;      /* the earliest and latest of them */
+	BackupStatFull last_full;
+} BackupStatInstance;
+
+typedef struct {
+	BackupStatsGrouping grouping;
+	BackupStatGroup    *groups;             /* sorted by tool, instance, type */
+	int                 group_count;
+	BackupStatInstance *instances;          /* sorted by tool, instance */
+	int                 instance_count;
+	int                 backup_count;
+	uint64_t            total_bytes;        /* data + WAL of every backup */
+	int                 status_count[BACKUP_STATS_STATUSES];
+	uint64_t            status_bytes[BACKUP_STATS_STATUSES];
+	int32_t            *group_slots;        /* hash: group index, -1 = empty */
+	size_t              group_capacity;
+	int32_t            *instance_slots;
+	size_t              instance_capacity;
+} BackupStats;
+
+/* NULL on out-of-memory */
+BackupStats *backup_stats_build(const BackupInfo *list, BackupStatsGrouping grouping);
+void         backup_stats_free(BackupStats *stats);
+
+/* Group or instance of a key, NULL if no backup has it */
+const BackupStatGroup *backup_stats_group(const BackupStats *stats, BackupTool tool,
+										  const char *instance_name, BackupType type);
+const BackupStatInstance *backup_stats_instance(const BackupStats *stats, BackupTool tool,
+												const char *instance_name);
+
+/* The group of 'backup' */
+const BackupStatGroup *backup_stats_group_of(const BackupStats *stats,
+											 const BackupInfo *backup);
+
+/* Whether 'backup' takes part in the baseline accumulators */
+bool         backup_stats_is_baseline(const BackupInfo *backup);
+
+#endif /* BACKUP_STATS_H */
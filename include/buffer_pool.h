@@ -0,0 +1,82 @@
+/*
+ * buffer_pool.h
+ *
+ * Process-wide pool of aligned read buffers under one memory budget
+ *
+ * Readers borrow a buffer for the length of a file or segment and hand
+ * it back; returned buffers are kept for the next borrower of the same
+ * size, so a long run allocates each buffer once.  Sizes are rounded up
+ * to a power of two, from 4 KB to BUFFER_POOL_MAX_SIZE, and every buffer
+ * is BUFFER_POOL_ALIGN aligned (O_DIRECT, registered io_uring buffers).
+ *
+ * With a limit set, a borrow that would take the pool's buffers (kept
+ * or lent) over it first frees kept buffers of other sizes, then waits
+ * for one to come back.  A thread that already holds a buffer, or finds
+ * none lent out, gets one regardless, and so does a borrower that has
+ * waited ten seconds in vain: the limit slows readers down but never
+ * deadlocks them, and may be exceeded by the nested borrows counted in
+ * BufferPoolStats.overdrafts.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUFFER_POOL_ALIGN       4096
+#define BUFFER_POOL_MAX_SIZE    (16 * 1024 * 1024)
+
+/* Smallest useful --memory-limit: one WAL read buffer */
+#define BUFFER_POOL_MIN_LIMIT   (1024 * 1024)
+
+typedef struct {
+	uint64_t    limit;              /* 0 = none */
+	uint64_t    allocated;          /* bytes of buffers lent or kept */
+	uint64_t    lent;               /* bytes of buffers borrowed now */
+	uint64_t    peak;               /* most bytes allocated at once */
+	uint64_t    waits;              /* borrows that had to wait */
+	uint64_t    overdrafts;         /* borrows granted over the limit */
+} BufferPoolStats;
+
+/* Cap the bytes of pooled buffers; 0 removes the cap */
+void        buffer_pool_set_limit(uint64_t bytes);
+
+/*
+ * Borrow a buffer of at least 'size' bytes, waiting while the limit is
+ * reached.  NULL if 'size' is over BUFFER_POOL_MAX_SIZE or memory is
+ * exhausted.
+ */
+void       *buffer_pool_get(size_t size);
+
+/* As buffer_pool_get(), but NULL instead of waiting or going over the limit */
+void       *buffer_pool_try_get(size_t size);
+
+/*
+ * Give back a buffer borrowed with the same 'size', on the thread that
+ * borrowed it.  NULL is ignored.
+ */
+void        buffer_pool_put(void *buf, size_t size);
+
+/* Free the buffers kept for reuse */
+void        buffer_pool_trim(void);
+
+void        buffer_pool_stats(BufferPoolStats *stats);
+
+#endif /* BUFFER_POOL_H */
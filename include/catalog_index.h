@@ -0,0 +1,67 @@
+/*
+ * catalog_index.h
+ *
+ * On-disk index of scanned backups, so that repeated scans of the same
+ * catalog only re-parse backups whose metadata changed.
+ *
+ * For every directory where a backup was detected, the index keeps the
+ * adapter that claimed it, a fingerprint of the adapter's metadata files
+ * (size, mtime and inode of each, see BackupAdapter.metadata_files) and
+ * the BackupInfo records its scan() produced.  While the fingerprint
+ * matches, the records are reused without detection, parsing or
+ * directory size walks.  The index is a compact binary file under the
+ * directory set with validation_set_cache_dir(), one per backup
+ * directory, scan depth and size mode.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CATALOG_INDEX_H
+#define CATALOG_INDEX_H
+
+#include "types.h"
+#include "adapter.h"
+
+typedef struct CatalogIndex CatalogIndex;
+
+/*
+ * Load the index for a scan of 'backup_dir' to 'max_depth'.  Returns
+ * NULL when no cache directory is configured.
+ */
+CatalogIndex *catalog_index_open(const char *backup_dir, int max_depth);
+
+/*
+ * If 'path' was indexed and its metadata is unchanged, set *backups to
+ * fresh copies of the indexed records (possibly NULL: the directory held
+ * a backup that could not be parsed) and *adapter, if not NULL, to the
+ * adapter that claimed it, and return true.
+ */
+bool          catalog_index_reuse(CatalogIndex *index, const char *path,
+								  BackupInfo **backups,
+								  const BackupAdapter **adapter);
+
+/* Index what 'adapter' scanned at 'path' (the list is copied) */
+void          catalog_index_record(CatalogIndex *index, const char *path,
+								   const BackupAdapter *adapter,
+								   const BackupInfo *backups);
+
+/*
+ * Write the index back if it changed, dropping directories this scan
+ * did not visit, then free it.
+ */
+void          catalog_index_close(CatalogIndex *index);
+
+#endif /* CATALOG_INDEX_H */
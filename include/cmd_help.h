@@ -53,4 +53,19 @@ void print_audit_usage(void);
  */
 void print_stat_usage(void);
 
+/*
+ * Print usage for 'watch' command
+ */
+void print_watch_usage(void);
+
+/*
+ * Print usage for 'merge' command
+ */
+void print_merge_usage(void);
+
+/*
+ * Print usage for 'verify-segment' command
+ */
+void print_verify_segment_usage(void);
+
 #endif /* CMD_HELP_H */
@@ -24,6 +24,7 @@
 #define COMMON_H
 
 #include "types.h"
+#include "decompress.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <sys/types.h>
@@ -33,7 +34,14 @@ bool parse_lsn(const char *str, XLogRecPtr *lsn);
 int lsn_compare(XLogRecPtr lsn1, XLogRecPtr lsn2);
 void format_lsn(XLogRecPtr lsn, char *buf, size_t bufsize);
 void lsn_to_seg(XLogRecPtr lsn, uint32_t timeline, WALSegmentName *seg, uint32_t wal_segment_size);
+uint64_t wal_segments_per_xlogid(uint32_t wal_segment_size);
+uint64_t wal_segment_number(const WALSegmentName *seg, uint32_t wal_segment_size);
+void wal_segment_from_number(uint64_t segno, uint32_t timeline, WALSegmentName *seg,
+							 uint32_t wal_segment_size);
+void wal_segment_next(WALSegmentName *seg, uint32_t wal_segment_size);
 bool parse_wal_filename(const char *filename, WALSegmentName *result);
+bool parse_wal_segment_file(const char *filename, WALSegmentName *result, const char **suffix);
+CompressionType wal_suffix_compression(const char *suffix);
 void format_wal_filename(const WALSegmentName *seg, char *buf, size_t bufsize);
 
 /* logging.c - Logging functions */
@@ -44,15 +52,25 @@ typedef enum {
 	LOG_ERROR
 } LogLevel;
 
+/* Messages below this level are dropped; read by log_debug() */
+extern LogLevel log_min_level;
+
 void log_init(void);
 void log_set_level(LogLevel level);
-void log_set_file(const char *filename);
+bool log_level_enabled(LogLevel level);
+bool log_set_file(const char *filename);
+bool log_set_async(bool async);
+void log_flush(void);
 void log_debug(const char *fmt, ...);
 void log_info(const char *fmt, ...);
 void log_warning(const char *fmt, ...);
 void log_error(const char *fmt, ...);
 void log_cleanup(void);
 
+/* Debug messages are not even formatted, nor their arguments evaluated, when off */
+#define log_debug(...) \
+	((void) (log_min_level <= LOG_DEBUG ? (log_debug)(__VA_ARGS__) : (void) 0))
+
 /* Color support */
 extern bool use_color;
 
@@ -75,13 +93,98 @@ bool is_directory(const char *path);
 bool is_regular_file(const char *path);
 off_t get_file_size(const char *path);
 uint64_t get_directory_size(const char *path);
+struct dirent;
+bool dirent_is_directory(int dir_fd, const struct dirent *entry);
+
+/* What one readdir() pass found in a directory, "." and ".." left out */
+typedef struct {
+	char	   *name;
+	bool		is_dir;			/* as dirent_is_directory() answered */
+} DirSnapshotEntry;
+
+typedef struct DirSnapshot {
+	DirSnapshotEntry *entries;	/* in readdir order */
+	DirSnapshotEntry **sorted;	/* the same, by name */
+	int			count;
+} DirSnapshot;
+
+bool dir_snapshot_read(const char *path, DirSnapshot *snap);
+const DirSnapshotEntry *dir_snapshot_find(const DirSnapshot *snap, const char *name);
+const DirSnapshotEntry *dir_snapshot_find_prefix(const DirSnapshot *snap, const char *prefix);
+bool dir_snapshot_has_dir(const DirSnapshot *snap, const char *name);
+void dir_snapshot_free(DirSnapshot *snap);
 void path_join(char *dest, size_t destsize, const char *path1, const char *path2);
 char *read_file_contents(const char *path);
 bool compute_file_crc32c(const char *path, uint32_t *crc_out);
+typedef void (*FileChunkFn)(void *arg, const uint8_t *buf, size_t len);
+bool read_file_chunks(const char *path, FileChunkFn fn, void *arg);
+int  pipe_cloexec(int fds[2]);
+int  mkstemp_cloexec(char *tmpl);
+
+/* How verification reads use the page cache */
+typedef enum {
+	PAGE_CACHE_USE,			/* ordinary cached reads */
+	PAGE_CACHE_DROP,		/* read sequentially, release pages once consumed */
+	PAGE_CACHE_DIRECT		/* O_DIRECT where supported, otherwise DROP */
+} PageCacheMode;
+
+void set_page_cache_mode(PageCacheMode mode);
+PageCacheMode get_page_cache_mode(void);
+int  page_cache_open(const char *path, bool *direct);
+void page_cache_begin(int fd);
+void page_cache_consumed(int fd, off_t *released, off_t pos);
+void page_cache_end(int fd);
+
+/* common/read_limit.c - shared read-rate and IOPS budget */
+void read_limit_set(uint64_t bytes_per_sec, uint64_t iops);
+void read_limit_charge(size_t bytes);
 
 /* scanner/fs_scanner.c - Directory scanning */
 BackupInfo* scan_backup_directory(const char *backup_dir, int max_depth);
+void scan_set_jobs(int jobs);
+int scan_get_jobs(void);
+
+/* Where adapters take a backup's size (data_bytes) from */
+typedef enum {
+	SIZE_MODE_METADATA,		/* manifest/control totals; walk only without them */
+	SIZE_MODE_WALK,			/* always walk: on-disk usage */
+	SIZE_MODE_NONE			/* metadata totals only, never walk (0 if unknown) */
+} SizeMode;
+
+void scan_set_size_mode(SizeMode mode);
+SizeMode scan_get_size_mode(void);
+bool size_mode_from_string(const char *str, SizeMode *out);
+uint64_t scan_resolve_size(const char *path, uint64_t metadata_bytes);
+
+/*
+ * How much scans read for each backup.  At BACKUP_LOAD_IDENTITY adapters
+ * fill in what their label/control/info file holds (id, type, parent,
+ * timestamps, start LSN) and skip manifests, tar members and sizes; such
+ * records are marked partial until backup_info_load() completes them.
+ */
+typedef enum {
+	BACKUP_LOAD_IDENTITY,
+	BACKUP_LOAD_FULL			/* default */
+} BackupLoadLevel;
+
+void scan_set_load_level(BackupLoadLevel level);
+BackupLoadLevel scan_get_load_level(void);
+bool backup_info_load(BackupInfo *info);
 WALArchiveInfo* scan_wal_archive(const char *wal_archive_dir);
+int wal_archive_find(const WALArchiveInfo *info, const WALSegmentName *seg);
+int wal_archive_find_range(const WALArchiveInfo *info, const WALSegmentName *seg);
+WALSegmentRange *wal_segment_ranges_build(const WALSegmentName *segs, int count,
+										  uint32_t wal_segment_size, int *range_count);
+bool wal_timelines_load_history(const char *archive_path, uint32_t tli,
+								WALTimeline **timelines, int *count);
+const WALTimeline *wal_timelines_find(const WALTimeline *timelines, int count,
+									  uint32_t tli);
+bool wal_timelines_switchpoint(const WALTimeline *timelines, int count,
+							   uint32_t new_tli, uint32_t parent_tli,
+							   XLogRecPtr *switch_lsn);
+void wal_archive_segment_path(const WALArchiveInfo *info, int index, char *buf, size_t bufsize);
+CompressionType wal_archive_segment_compression(const WALArchiveInfo *info, int index);
+uint32_t wal_archive_read_segment_size(const WALArchiveInfo *info);
 void free_backup_list(BackupInfo *list);
 void free_wal_archive_info(WALArchiveInfo *info);
 
@@ -90,9 +193,23 @@ ValidationResult* validate_backup_metadata(BackupInfo *info);
 ValidationResult* check_backup_checksums(BackupInfo *backup);
 ValidationResult* validate_single_backup(BackupInfo *backup, WALArchiveInfo *wal_info, ValidationLevel level);
 ValidationResult* validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups, WALArchiveInfo *wal_info, ValidationLevel level);
+typedef struct ValidationMemo ValidationMemo;
+ValidationMemo *validation_memo_create(void);
+void validation_memo_free(ValidationMemo *memo);
+ValidationResult* validate_backup_chain_memo(BackupInfo *backup, BackupInfo *all_backups, WALArchiveInfo *wal_info, ValidationLevel level, ValidationMemo *memo);
 ValidationResult* check_retention_policy(BackupInfo *backups, int retention_days, int retention_weekly);
 void free_validation_result(ValidationResult *result);
 bool validation_level_from_string(const char *str, ValidationLevel *out);
+void validation_set_jobs(int jobs);
+int validation_get_jobs(void);
+bool validation_set_io_engine(const char *name);
+void validation_io_acquire(void);
+void validation_io_release(void);
+
+/* validator/wal_cache.c - cache directory for the WAL verification cache
+ * and the catalog index (NULL disables both) */
+void validation_set_cache_dir(const char *dir);
+const char *validation_get_cache_dir(void);
 
 /* validator/pg_probackup_validator.c */
 ValidationResult* pg_probackup_validate_structure(BackupInfo *backup);
@@ -102,17 +219,30 @@ WALArchiveInfo*   pg_probackup_get_embedded_wal(BackupInfo *backup);
 ValidationResult* pg_basebackup_validate_structure(BackupInfo *backup);
 WALArchiveInfo*   pg_basebackup_get_embedded_wal(BackupInfo *backup);
 ValidationResult* check_manifest_checksums(BackupInfo *backup);
+/* Where WAL summaries are looked for when a backup has none (NULL = nowhere) */
+void validation_set_wal_summaries_dir(const char *dir);
 
 /* validator/pgbackrest_validator.c */
 ValidationResult* pgbackrest_validate_structure(BackupInfo *backup);
 ValidationResult* pgbackrest_check_manifest_checksums(BackupInfo *backup);
 
+/* validator/page_validator.c - page headers and checksums (--level=pages) */
+ValidationResult* check_backup_pages(BackupInfo *backup);
+
 /* validator/wal_validator.c - WAL validation */
 ValidationResult* check_wal_continuity(WALArchiveInfo *wal_info);
 ValidationResult* check_wal_availability(BackupInfo *backup, WALArchiveInfo *wal_info);
 ValidationResult* check_wal_headers(BackupInfo *backup, WALArchiveInfo *wal_info);
 ValidationResult* check_wal_timeline(BackupInfo *backup, WALArchiveInfo *wal_info);
 ValidationResult* check_wal_archive_headers(WALArchiveInfo *wal_info);
+ValidationResult* check_wal_segments(WALArchiveInfo *wal_info,
+									 const WALSegmentName *segs, int count);
+ValidationResult* check_wal_segment_file(const char *seg_path, const char *archive_path);
 ValidationResult* check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info);
+ValidationResult* check_wal_restore_chain_of(BackupInfo *const *backups, int count,
+											 WALArchiveInfo *wal_info);
+/* Check only each segment's page header, not its records (false by default) */
+void validation_set_wal_headers_only(bool enabled);
+bool validation_wal_headers_only(void);
 
 #endif /* COMMON_H */
@@ -1,7 +1,7 @@
 /*
  * crc32c.h
  *
- * CRC32C (Castagnoli) software implementation.
+ * CRC32C (Castagnoli) checksum with hardware acceleration.
  * Polynomial: 0x82F63B78 (bit-reversed 0x1EDC6F41).
  * INIT = ~0U, FIN = ~crc — matches PostgreSQL's pg_crc32c.
  *
@@ -27,11 +27,23 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/*
+ * Select the implementation for this CPU (SSE4.2, ARMv8 CRC or
+ * slicing-by-8).  Called once from pg_backup_auditor_init(); calling it
+ * again is a no-op.  crc32c_update() also calls it lazily.
+ */
+void crc32c_init(void);
+
 /*
  * Update a running CRC32C accumulator over 'len' bytes.
- * Initializes the lookup table on first call.
  * Usage: start with crc = ~0U; finalize with ~crc.
  */
 uint32_t crc32c_update(uint32_t crc, const uint8_t *buf, size_t len);
 
+/* Portable slicing-by-8 implementation, regardless of CPU support */
+uint32_t crc32c_update_sw(uint32_t crc, const uint8_t *buf, size_t len);
+
+/* Name of the selected implementation: "sse4.2", "armv8" or "sb8" */
+const char *crc32c_implementation(void);
+
 #endif /* CRC32C_H */
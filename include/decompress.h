@@ -0,0 +1,88 @@
+/*
+ * decompress.h
+ *
+ * Streaming decompression for compressed backup payloads.
+ *
+ * A DecompressStream reads a file and returns its decompressed bytes
+ * in caller-sized pieces, in bounded memory and without temp files.
+ * Each compression type is served by the first available backend:
+ * an in-process library (zlib, liblz4, libzstd — enabled with
+ * HAVE_ZLIB / HAVE_LZ4 / HAVE_ZSTD at build time), or otherwise the
+ * matching command-line tool run as a "-dc" child process.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+typedef enum {
+	COMPRESSION_NONE = 0,
+	COMPRESSION_GZIP,
+	COMPRESSION_BZIP2,
+	COMPRESSION_XZ,
+	COMPRESSION_LZ4,
+	COMPRESSION_ZSTD
+} CompressionType;
+
+/* Identify a compressed stream by its first bytes (6 are enough) */
+CompressionType compression_detect(const unsigned char *magic, size_t len);
+
+/*
+ * Map a tool's compression name ("gz", "gzip", "bz2", "xz", "lz4",
+ * "zst", "zstd", "none") to a type.  Returns false for names that are
+ * not a whole-file stream format (e.g. pg_probackup's per-page "zlib").
+ */
+bool            compression_from_name(const char *name, CompressionType *type);
+
+/* File suffix pgBackRest and pg_basebackup use (".gz", ...; "" for none) */
+const char     *compression_suffix(CompressionType type);
+
+/* Backend that decompress_open() would use, e.g. "zlib" or "external" */
+const char     *compression_backend(CompressionType type);
+
+typedef struct DecompressStream DecompressStream;
+
+/*
+ * Open 'path' as a stream of the given type (COMPRESSION_NONE reads the
+ * file as is).  decompress_open_auto() detects the type from the file's
+ * magic bytes.  Both return NULL if the file cannot be opened.
+ */
+DecompressStream *decompress_open(const char *path, CompressionType type);
+DecompressStream *decompress_open_auto(const char *path);
+
+/*
+ * Read up to 'len' decompressed bytes.  Returns the number of bytes
+ * read (possibly fewer than asked for), 0 at the end of the stream, or
+ * -1 on an I/O error or corrupt input.
+ */
+ssize_t           decompress_read(DecompressStream *ds, void *buf, size_t len);
+
+/*
+ * Discard 'len' bytes.  Returns false if the stream ends first; on
+ * uncompressed files this seeks instead, so a short file only shows up
+ * as end-of-stream on the next read.
+ */
+bool              decompress_skip(DecompressStream *ds, uint64_t len);
+
+void              decompress_close(DecompressStream *ds);
+
+#endif /* DECOMPRESS_H */
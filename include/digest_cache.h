@@ -0,0 +1,83 @@
+/*
+ * digest_cache.h
+ *
+ * Cache of file digests by content identity, shared by every backup
+ * verified in a run.
+ *
+ * pgBackRest manifests reference unchanged files of earlier backups, and
+ * hard-linked or shared files show up under several backups; the digest
+ * of such a file only needs computing once.  Entries are keyed by the
+ * file's identity (device, inode, size, mtime) together with the digest
+ * algorithm and compression, and hold the digest and length of the
+ * content as read.  A cache hit is compared with each manifest's
+ * expected value as a fresh digest would be, so a damaged file is still
+ * reported under every backup that lists it.
+ *
+ * With a cache directory (validation_set_cache_dir()) the entries are
+ * kept between runs.  They are trusted for DIGEST_CACHE_MAX_AGE days,
+ * after which the file is read again, so that damage which leaves the
+ * identity unchanged is still found eventually.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIGEST_CACHE_H
+#define DIGEST_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define DIGEST_CACHE_MAX_DIGEST 32      /* SHA-256 */
+#define DIGEST_CACHE_MAX_AGE    30      /* days a persisted digest is trusted */
+
+/* What a digest was computed over, and how */
+typedef struct {
+	uint64_t dev;
+	uint64_t ino;
+	int64_t  size;              /* of the file on disk */
+	int64_t  mtime_sec;
+	long     mtime_nsec;
+	int      algorithm;         /* VerifyAlgorithm */
+	int      compression;       /* CompressionType: digest of the decompressed content */
+} DigestKey;
+
+void digest_key_set(DigestKey *key, const struct stat *st,
+					int algorithm, int compression);
+
+/*
+ * Copy the cached digest of 'key' ('len' bytes) to 'digest' and the
+ * length of the content it covers to *content_size.  False if there is
+ * none, or it was computed with another length or too long ago.
+ */
+bool digest_cache_lookup(const DigestKey *key, uint8_t *digest, size_t len,
+						 int64_t *content_size);
+
+/* Record the digest of 'key' */
+void digest_cache_store(const DigestKey *key, const uint8_t *digest, size_t len,
+						int64_t content_size);
+
+/*
+ * Write the entries back to the cache directory, if one is set and
+ * anything changed.  Entries past DIGEST_CACHE_MAX_AGE are dropped.
+ */
+void digest_cache_save(void);
+
+/* Forget all entries; the next lookup reloads the cache directory's */
+void digest_cache_reset(void);
+
+#endif /* DIGEST_CACHE_H */
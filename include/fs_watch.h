@@ -0,0 +1,73 @@
+/*
+ * fs_watch.h
+ *
+ * Directory change notification for the watch command.
+ *
+ * Trees of directories are watched to a given depth; fs_watch_wait()
+ * blocks until something in a watched directory changes (an entry is
+ * created, removed, renamed or a file written and closed) and reports
+ * which directories changed.  Events are coalesced: a burst of changes,
+ * such as a backup being written, comes back as one wakeup once it has
+ * been quiet for a moment.  Directories that appear below a watched one
+ * are watched as they are found.
+ *
+ * The backend is inotify on Linux and kqueue on BSD and macOS; elsewhere
+ * the directories' modification times are polled once a second.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FS_WATCH_H
+#define FS_WATCH_H
+
+#include <stdbool.h>
+
+typedef struct FsWatch FsWatch;
+
+/*
+ * Asked for each watched directory before its subdirectories are
+ * watched; false keeps the watch from descending (the directory itself
+ * is still watched).
+ */
+typedef bool (*FsWatchDescendFn)(const char *path, void *arg);
+
+/* 'descend' may be NULL to descend everywhere.  NULL on failure. */
+FsWatch    *fs_watch_open(FsWatchDescendFn descend, void *arg);
+
+/*
+ * Watch 'root' and the directories below it, down to 'max_depth' levels
+ * (0 = 'root' only).  Returns false if 'root' cannot be watched.
+ */
+bool        fs_watch_add_tree(FsWatch *w, const char *root, int max_depth);
+
+/*
+ * Wait up to 'timeout_ms' (-1 = forever) for changes.  Returns the
+ * number of directories that changed, 0 on timeout or -1 on error.
+ */
+int         fs_watch_wait(FsWatch *w, int timeout_ms);
+
+/* Path of the i-th directory reported by the last fs_watch_wait() */
+const char *fs_watch_changed(const FsWatch *w, int i);
+
+/* Number of directories watched */
+int         fs_watch_count(const FsWatch *w);
+
+/* "inotify", "kqueue" or "poll" */
+const char *fs_watch_backend(void);
+
+void        fs_watch_close(FsWatch *w);
+
+#endif /* FS_WATCH_H */
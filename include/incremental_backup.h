@@ -0,0 +1,113 @@
+/*
+ * incremental_backup.h
+ *
+ * The file formats of PostgreSQL 17+ incremental backups, checked as
+ * they are read without reconstructing anything:
+ *
+ *   INCREMENTAL.<relfile>   magic, block count, truncation length and the
+ *                           relative block numbers, padded to BLCKSZ when
+ *                           there are blocks, then the blocks
+ *                           (src/include/backup/basebackup_incremental.h)
+ *   pg_wal/summaries/       one block reference table per WAL range,
+ *     <tli><start><end>.summary
+ *                           closed by a zero entry and the CRC32C of all
+ *                           that precedes it (src/common/blkreftable.c)
+ *
+ * Both walkers are fed chunk by chunk, so they can follow the digests of
+ * verify_jobs.h or any other sequential read.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCREMENTAL_BACKUP_H
+#define INCREMENTAL_BACKUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+
+#define INCREMENTAL_MAGIC       0xd3ae1f0dU
+#define INCREMENTAL_PREFIX      "INCREMENTAL."
+#define WAL_SUMMARY_MAGIC       0x652b137bU   /* BLOCKREFTABLE_MAGIC */
+
+/* True if the last component of 'path' names an incremental file */
+bool        incremental_file_name(const char *path);
+
+/* State of the check of one INCREMENTAL.* file, fed as it is read */
+typedef struct {
+	uint64_t    bytes;              /* read so far */
+	uint8_t     field[4];           /* a header field split across chunks */
+	size_t      field_have;
+	uint32_t    magic;
+	uint32_t    num_blocks;
+	uint32_t    truncation_block_length;
+	uint32_t    blocks_read;        /* block numbers read */
+	uint32_t    last_block;
+	uint64_t    header_length;      /* 0 until the block count is known */
+	bool        failed;
+	char        problem[160];       /* the first one found */
+} IncrementalWalk;
+
+void        incremental_walk_init(IncrementalWalk *walk);
+void        incremental_walk_update(IncrementalWalk *walk, const uint8_t *buf,
+									size_t len);
+
+/*
+ * End of the file: false if the header is invalid or does not account
+ * for the file's length; walk->problem says why.
+ */
+bool        incremental_walk_finish(IncrementalWalk *walk);
+
+/* The range a WAL summary file covers, from its name */
+typedef struct {
+	TimeLineID  timeline;
+	XLogRecPtr  start_lsn;
+	XLogRecPtr  end_lsn;
+} WALSummaryRange;
+
+/*
+ * Parse "<TLI:8><START:16><END:16>.summary" (hex).  False for any other
+ * name, or a range that ends before it starts.
+ */
+bool        wal_summary_file_name(const char *name, WALSummaryRange *range);
+
+/* State of the check of one WAL summary file, fed as it is read */
+typedef struct {
+	uint64_t    bytes;
+	uint32_t    crc;                /* running, of everything before the stored CRC */
+	int         state;
+	uint8_t     item[24];           /* the fixed-size item being read */
+	size_t      item_have;
+	size_t      item_want;
+	uint32_t    chunks_left;        /* chunk_usage entries of the current relation */
+	uint64_t    skip;               /* chunk contents still to pass over */
+	uint64_t    relations;
+	bool        failed;
+	char        problem[160];
+} WALSummaryWalk;
+
+void        wal_summary_walk_init(WALSummaryWalk *walk);
+void        wal_summary_walk_update(WALSummaryWalk *walk, const uint8_t *buf,
+									size_t len);
+
+/*
+ * End of the file: false if it is malformed, truncated, has data after
+ * its CRC or the CRC does not match; walk->problem says why.
+ */
+bool        wal_summary_walk_finish(WALSummaryWalk *walk);
+
+#endif /* INCREMENTAL_BACKUP_H */
@@ -23,33 +23,79 @@
 #define INI_PARSER_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /* Maximum line length in INI file */
 #define INI_MAX_LINE 8192
 
+/*
+ * All sections, keys and values of an IniFile live in one arena that
+ * ini_free() releases at once.  Sections and keys are kept in file order
+ * (first_section/next, first_kv/next) for callers that walk them, and
+ * are also hashed for ini_get_section()/ini_get_value().
+ */
+typedef struct IniArenaBlock IniArenaBlock;
+
 /* INI key-value pair */
 typedef struct IniKeyValue {
 	char *key;
 	char *value;
-	struct IniKeyValue *next;
+	struct IniKeyValue *next;       /* file order */
+	struct IniKeyValue *hash_next;  /* bucket chain */
+	uint32_t hash;
 } IniKeyValue;
 
 /* INI section */
 typedef struct IniSection {
 	char *name;
 	IniKeyValue *first_kv;
-	struct IniSection *next;
+	struct IniSection *next;        /* file order */
+	struct IniSection *hash_next;   /* bucket chain */
+	uint32_t hash;
+	IniKeyValue *last_kv;
+	int kv_count;
+	IniKeyValue **buckets;          /* kv_count rounded up to a power of 2 */
+	uint32_t nbuckets;
 } IniSection;
 
 /* INI file structure */
 typedef struct {
 	char *filename;
 	IniSection *first_section;
+	IniSection **buckets;
+	uint32_t nbuckets;
+	IniArenaBlock *arena;
 } IniFile;
 
 /* Parse INI file from path */
 IniFile* ini_parse_file(const char *filepath);
 
+/*
+ * Streaming mode: a piece of the line being parsed, NUL-terminated,
+ * valid only for the duration of the callback.
+ */
+typedef struct {
+	const char *ptr;
+	size_t len;
+} IniSlice;
+
+/*
+ * Called for every key=value of every section, in file order and with
+ * duplicates included.  Return false to stop reading.
+ */
+typedef bool (*IniStreamCallback)(IniSlice section, IniSlice key,
+								  IniSlice value, void *arg);
+
+/*
+ * Parse INI file from path without building a tree.  Returns false if
+ * the file cannot be opened or read; stopping early is not an error.
+ */
+bool ini_parse_stream(const char *filepath, IniStreamCallback callback, void *arg);
+
+/* Check a slice against a string */
+bool ini_slice_eq(IniSlice slice, const char *str);
+
 /* Get section by name */
 IniSection* ini_get_section(IniFile *ini, const char *section_name);
 
@@ -0,0 +1,91 @@
+/*
+ * json_scan.h
+ *
+ * Forward-only scanner for the JSON found in backup metadata.
+ *
+ * The tools write their per-file metadata as flat JSON objects:
+ * pg_probackup one per line of backup_content.control, pgBackRest one per
+ * key of backup.info and backup.manifest, pg_basebackup one per entry of
+ * backup_manifest.  json_scan_object() walks such an object once and
+ * picks out every wanted key in that pass, instead of searching the text
+ * again for each key.  Values are returned as slices of the input;
+ * nothing is allocated or copied.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * A value inside the input; not NUL-terminated.  Strings are given
+ * without their quotes (escapes left as written), other scalars as
+ * written, and nested objects and arrays including their brackets.
+ */
+typedef struct {
+	const char *ptr;                /* NULL if the key is absent */
+	size_t      len;
+} JsonSlice;
+
+/* Position in the input; 'p' advances, 'end' is one past the last byte */
+typedef struct {
+	const char *p;
+	const char *end;
+} JsonCursor;
+
+void json_skip_ws(JsonCursor *c);
+
+/* Byte at the cursor, or '\0' at the end of the input */
+char json_peek(const JsonCursor *c);
+
+/* The string at the cursor, which is on its opening quote */
+bool json_scan_string(JsonCursor *c, JsonSlice *out);
+
+/* Skip the value at the cursor, storing its extent in 'out' if not NULL */
+bool json_skip_value(JsonCursor *c, JsonSlice *out);
+
+/*
+ * Scan the object at the cursor (on its '{') in one pass.  values[i] is
+ * set to the value of keys[i], or left absent.  Returns false if the
+ * object is malformed; the cursor is then where scanning stopped.
+ */
+bool json_scan_object(JsonCursor *c, const char *const *keys, int nkeys,
+					  JsonSlice *values);
+
+/* json_scan_object() over a NUL-terminated string */
+bool json_get_fields(const char *json, const char *const *keys, int nkeys,
+					 JsonSlice *values);
+
+/* Copy into 'buf', truncating to bufsize - 1; false if absent */
+bool json_slice_copy(JsonSlice s, char *buf, size_t bufsize);
+
+/*
+ * json_slice_copy() of a string with its escapes decoded (\uXXXX to
+ * UTF-8); false if absent or an escape is malformed
+ */
+bool json_slice_unescape(JsonSlice s, char *buf, size_t bufsize);
+
+/* Decimal digits only (possibly quoted in the source); false otherwise */
+bool json_slice_to_uint64(JsonSlice s, uint64_t *out);
+
+bool json_slice_eq(JsonSlice s, const char *str);
+bool json_slice_case_eq(JsonSlice s, const char *str);
+
+#endif /* JSON_SCAN_H */
@@ -0,0 +1,156 @@
+/*
+ * metrics.h
+ *
+ * Run metrics in the Prometheus text exposition format.
+ *
+ * The scanners and validators add to process-wide counters as they go:
+ * time spent per phase, bytes digested per algorithm, and files, WAL
+ * segments and records checked.  Times are summed over threads, so with
+ * --jobs a phase can account for more seconds than the run took.  The
+ * commands add their results' error counts by category and write it all
+ * out, for node_exporter's textfile collector (--metrics-file) or, in
+ * watch mode, over the state socket.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "types.h"
+
+typedef enum {
+	METRIC_PHASE_SCAN,              /* walking the backup tree */
+	METRIC_PHASE_METADATA,          /* parsing backup metadata */
+	METRIC_PHASE_WAL_INVENTORY,     /* listing WAL archives */
+	METRIC_PHASE_STRUCTURE,         /* structure and metadata checks */
+	METRIC_PHASE_CHECKSUM,          /* file checksums */
+	METRIC_PHASE_WAL,               /* WAL headers and records */
+	METRIC_PHASE_ANALYSIS,          /* chains, statistics and anomalies */
+	METRIC_PHASE_COUNT              /* also: outside any phase */
+} MetricPhase;
+
+typedef enum {
+	METRIC_ALG_CRC32C,
+	METRIC_ALG_SHA1,
+	METRIC_ALG_SHA256,
+	METRIC_ALG_PAGE,                /* data page checksums */
+	METRIC_ALG_COUNT
+} MetricAlgorithm;
+
+/* What was digested */
+typedef enum {
+	METRIC_TARGET_FILE,             /* backup files against their manifest */
+	METRIC_TARGET_WAL,              /* WAL record CRCs */
+	METRIC_TARGET_COUNT
+} MetricTarget;
+
+typedef enum {
+	METRIC_BACKUPS_SCANNED,
+	METRIC_BACKUPS_VALIDATED,
+	METRIC_FILES_CHECKED,
+	METRIC_WAL_SEGMENTS_CHECKED,
+	METRIC_WAL_RECORDS_CHECKED,
+	METRIC_COUNTER_COUNT
+} MetricCounter;
+
+/* I/O done by the readers, charged to the calling thread's phase */
+typedef enum {
+	METRIC_IO_BYTES_READ,
+	METRIC_IO_FILES_OPENED,
+	METRIC_IO_SYSCALLS,             /* open, read, mmap, io_uring_enter */
+	METRIC_IO_FORKS,                /* external decompressors */
+	METRIC_IO_COUNT
+} MetricIo;
+
+/* A timed phase; spans nest, and I/O goes to the innermost one */
+typedef struct {
+	uint64_t    start;
+	MetricPhase phase;
+	MetricPhase prev;
+} MetricSpan;
+
+/* Monotonic clock in nanoseconds, for the 'start' arguments below */
+uint64_t metrics_clock(void);
+
+/* Add the time from 'start' to now to 'phase' */
+void     metrics_phase_add(MetricPhase phase, uint64_t start);
+
+/* Enter 'phase' on this thread; metrics_phase_end() adds its time */
+void     metrics_phase_begin(MetricSpan *span, MetricPhase phase);
+void     metrics_phase_end(const MetricSpan *span);
+
+/*
+ * The calling thread's phase (METRIC_PHASE_COUNT outside any), and
+ * setting it without timing, for workers doing a phase's I/O.
+ */
+MetricPhase metrics_thread_phase(void);
+void     metrics_set_thread_phase(MetricPhase phase);
+
+void     metrics_io(MetricIo what, uint64_t n);
+
+/*
+ * A stdio stream read up to its current position, about to be closed:
+ * one file opened and its bytes.  The reads stdio made are not counted.
+ */
+void     metrics_io_stream(FILE *fp);
+
+void     metrics_count(MetricCounter counter, uint64_t n);
+
+/* Seconds spent in 'phase' (summed over threads) and its I/O, so far */
+double   metrics_phase_seconds(MetricPhase phase);
+uint64_t metrics_phase_io(MetricPhase phase, MetricIo what);
+
+/* 'bytes' digested with 'alg', which took 'ns' */
+void     metrics_verified(MetricAlgorithm alg, MetricTarget target,
+						  uint64_t bytes, uint64_t ns);
+
+/* Outcome of a run, or of the state in watch mode */
+typedef struct {
+	const char *command;            /* "command" label of every series */
+	time_t      finished_at;
+	double      duration;           /* seconds */
+	int         errors;
+	int         warnings;
+	int         codes[VALIDATION_CODE_COUNT];   /* errors by category */
+} MetricsReport;
+
+void     metrics_report_init(MetricsReport *report, const char *command);
+
+/* Count 'result's errors and warnings; NULL is ignored */
+void     metrics_report_add(MetricsReport *report, const ValidationResult *result);
+
+/* The counters and 'report' in the text exposition format */
+void     metrics_write(FILE *fp, const MetricsReport *report);
+
+/*
+ * Write to 'path' through a temporary file renamed into place, so the
+ * textfile collector never reads a partial file.  False on failure.
+ */
+bool     metrics_write_file(const char *path, const MetricsReport *report);
+
+/*
+ * The --profile report: time, I/O and throughput per phase, for a run
+ * that took 'wall' seconds.
+ */
+void     metrics_profile_write(FILE *fp, double wall);
+
+#endif /* METRICS_H */
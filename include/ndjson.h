@@ -0,0 +1,86 @@
+/*
+ * ndjson.h
+ *
+ * Streaming newline-delimited JSON output (--format=ndjson)
+ *
+ * Each record is one JSON object on one line, written and flushed as
+ * soon as it is complete, so a consumer reading the pipe sees a backup,
+ * chain or finding the moment it is known and the writer holds nothing
+ * but the record in progress.  Every record has a "record" member naming
+ * its kind.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef NDJSON_H
+#define NDJSON_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "types.h"
+
+typedef enum {
+	OUTPUT_TABLE,
+	OUTPUT_NDJSON
+} OutputFormat;
+
+/* "table", or "ndjson" (also "json"); false for anything else */
+bool output_format_from_string(const char *str, OutputFormat *out);
+
+typedef struct {
+	FILE *fp;
+	bool  first;            /* no member written yet */
+} NdjsonRecord;
+
+/* Open a record of kind 'record' on 'fp' */
+void ndjson_begin(NdjsonRecord *rec, FILE *fp, const char *record);
+
+/* Members; a NULL string is written as null */
+void ndjson_string(NdjsonRecord *rec, const char *key, const char *value);
+void ndjson_int(NdjsonRecord *rec, const char *key, int64_t value);
+void ndjson_uint(NdjsonRecord *rec, const char *key, uint64_t value);
+void ndjson_bool(NdjsonRecord *rec, const char *key, bool value);
+void ndjson_double(NdjsonRecord *rec, const char *key, double value);
+void ndjson_null(NdjsonRecord *rec, const char *key);
+
+/* UTC ISO 8601 ("2026-01-08T10:05:30Z"); 0 is null */
+void ndjson_time(NdjsonRecord *rec, const char *key, time_t value);
+
+/* "X/X" as PostgreSQL prints it; 0 is null */
+void ndjson_lsn(NdjsonRecord *rec, const char *key, XLogRecPtr value);
+
+/* A member whose value is already JSON text, 'len' bytes of it */
+void ndjson_raw(NdjsonRecord *rec, const char *key, const char *json, size_t len);
+
+/* The identifying and descriptive fields of a backup */
+void ndjson_backup_fields(NdjsonRecord *rec, const BackupInfo *backup);
+
+/* Close the record, end the line and flush it */
+void ndjson_end(NdjsonRecord *rec);
+
+/*
+ * One "finding" record per error and warning of 'result'.  'backup_id'
+ * or 'archive' names what was checked (the other is null), 'check' how;
+ * errors carry their code (validation_code_name()), warnings null.
+ */
+void ndjson_findings(FILE *fp, const ValidationResult *result,
+					 const char *backup_id, const char *archive,
+					 const char *check);
+
+#endif /* NDJSON_H */
@@ -0,0 +1,137 @@
+/*
+ * page_checksum.h
+ *
+ * PostgreSQL data page verification: the FNV-1a based page checksum
+ * (src/include/storage/checksum_impl.h) and the page header sanity
+ * checks of PageIsVerified(), over 8 kB pages.
+ *
+ * The checksum is computed as 32 independent lanes, which map directly
+ * onto AVX2 (x86_64, selected at run time) and NEON (aarch64) registers;
+ * a portable loop is used elsewhere.  All three give identical results.
+ *
+ * PageWalk checks the pages of a relation file as it is read, chunk by
+ * chunk, so it can follow the digests of verify_jobs.h: plain copies
+ * (pg_basebackup, pgBackRest) or pg_probackup's framing, where every
+ * page is preceded by a header naming its block.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAGE_CHECKSUM_H
+#define PAGE_CHECKSUM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PAGE_BLCKSZ             8192
+#define PAGE_RELSEG_SIZE        131072      /* blocks per 1 GB segment file */
+#define PAGE_HEADER_SIZE        24          /* SizeOfPageHeaderData */
+
+/*
+ * Select the implementation for this CPU (AVX2, NEON or portable).
+ * Called once from pg_backup_auditor_init(); page_checksum() also calls
+ * it lazily.
+ */
+void        page_checksum_init(void);
+
+/*
+ * pd_checksum of 'page' as block 'blkno' of its relation fork, computed
+ * with the stored pd_checksum taken as zero.  Always 1..65535.
+ */
+uint16_t    page_checksum(const uint8_t *page, uint32_t blkno);
+
+/* Portable implementation, regardless of CPU support */
+uint16_t    page_checksum_sw(const uint8_t *page, uint32_t blkno);
+
+/* Name of the selected implementation: "avx2", "neon" or "portable" */
+const char *page_checksum_implementation(void);
+
+/* Whether the cluster computes page checksums (pg_control) */
+typedef enum {
+	PAGE_CHECKSUMS_UNKNOWN = 0, /* checked where pd_checksum is set */
+	PAGE_CHECKSUMS_OFF,         /* headers only */
+	PAGE_CHECKSUMS_ON
+} PageChecksums;
+
+/*
+ * data_checksum_version of the pg_control file in 'buf' (its first
+ * 'len' bytes).  The field is found after floatFormat, whose offset
+ * depends on the version, so UNKNOWN for anything unrecognised.
+ */
+PageChecksums page_checksums_from_control(const uint8_t *buf, size_t len);
+
+typedef enum {
+	PAGE_OK = 0,
+	PAGE_NEW,                   /* all zero: allocated, never written */
+	PAGE_NEWER,                 /* written during the backup, left to WAL replay */
+	PAGE_BAD_HEADER,
+	PAGE_BAD_CHECKSUM
+} PageStatus;
+
+typedef struct {
+	PageChecksums checksums;
+	uint64_t      start_lsn;    /* pages with pd_lsn >= this are PAGE_NEWER; 0 = none */
+	bool          framed;       /* pg_probackup: a header before each page */
+} PageCheckOptions;
+
+/*
+ * Check one page.  For PAGE_BAD_CHECKSUM, *stored and *computed are set
+ * (either may be NULL).
+ */
+PageStatus  page_verify(const uint8_t *page, uint32_t blkno,
+						const PageCheckOptions *options,
+						uint16_t *stored, uint16_t *computed);
+
+/*
+ * Block number of the first page of relation file 'rel_path' (relative
+ * to the data directory: base/<db>/<rel>, global/<rel> or
+ * pg_tblspc/<oid>/<version>/<db>/<rel>, with an optional _fsm, _vm or
+ * _init fork and .N segment suffix).  False for any other file.
+ */
+bool        page_relation_file(const char *rel_path, uint32_t *first_block);
+
+/* State of the page check of one file, fed as it is read */
+typedef struct {
+	const PageCheckOptions *options;
+	uint32_t    first_block;
+	uint32_t    block;          /* of the next page */
+	uint8_t    *carry;          /* an item split across chunks; lazily allocated */
+	size_t      have;           /* bytes of it in carry */
+	size_t      want;           /* size of the current item: frame header or page */
+	bool        in_header;      /* framed: reading a frame header */
+	bool        stopped;        /* the rest of the file is not checked */
+	bool        out_of_memory;
+
+	uint64_t    pages;          /* checked and valid */
+	uint64_t    new_pages;
+	uint64_t    newer_pages;
+	uint64_t    unchecked;      /* framed: compressed or unframed pages */
+	uint64_t    bad_pages;
+	uint32_t    bad_block;      /* the first bad page */
+	PageStatus  bad_status;
+	uint16_t    bad_stored;
+	uint16_t    bad_computed;
+} PageWalk;
+
+void        page_walk_init(PageWalk *walk, const PageCheckOptions *options,
+						   uint32_t first_block);
+void        page_walk_update(PageWalk *walk, const uint8_t *buf, size_t len);
+
+/* End of the file: releases the walk; false if a bad page was found */
+bool        page_walk_finish(PageWalk *walk);
+
+#endif /* PAGE_CHECKSUM_H */
@@ -0,0 +1,110 @@
+/*
+ * restore_estimate.h
+ *
+ * Restore time model for backup chains
+ *
+ * Restoring a chain's latest backup means copying it and every backup it
+ * depends on, then replaying WAL from its start LSN up to the end of the
+ * archived WAL that follows on without a gap.  The estimate divides the
+ * data bytes by a copy rate and the WAL bytes by a replay rate.
+ *
+ * The rates are measured: at the end of a check, the bytes read and the
+ * time spent verifying data file checksums and WAL give the read
+ * throughput of one stream for each.  The measurements are kept in the
+ * cache directory (validation_set_cache_dir()), one file per backup
+ * directory, and smoothed over runs.  Without one, the defaults below are
+ * assumed.  Replay on a server also applies the records, so the WAL rate
+ * measured here is an upper bound for it; --replay-rate sets it instead.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESTORE_ESTIMATE_H
+#define RESTORE_ESTIMATE_H
+
+#include "pg_backup_auditor.h"
+#include "backup_chain.h"
+
+/* Bytes per second, when nothing was measured */
+#define RESTORE_DEFAULT_DATA_RATE   (100.0 * 1024 * 1024)
+#define RESTORE_DEFAULT_WAL_RATE    (16.0 * 1024 * 1024)
+
+/* Smallest read worth a measurement: page cache hits and startup dominate below */
+#define RESTORE_MIN_SAMPLE_BYTES    (16 * 1024 * 1024)
+#define RESTORE_MIN_SAMPLE_SECONDS  0.1
+
+/* Weight of the newest measurement */
+#define RESTORE_RATE_ALPHA          0.5
+
+typedef enum {
+	RATE_ASSUMED,                   /* default */
+	RATE_MEASURED,                  /* from earlier checks */
+	RATE_GIVEN                      /* on the command line */
+} RateSource;
+
+/* Measured read rates, in bytes per second; 0 = none yet */
+typedef struct {
+	double      data_rate;
+	double      wal_rate;
+	time_t      data_measured_at;
+	time_t      wal_measured_at;
+} RestoreThroughput;
+
+typedef struct {
+	const BackupInfo *backup;       /* the one restored: latest completed */
+	int         backups;            /* it and those it depends on */
+	uint64_t    data_bytes;         /* their data */
+	XLogRecPtr  replay_from;        /* backup start */
+	XLogRecPtr  replay_to;          /* end of gapless archived WAL, or backup stop */
+	uint64_t    wal_bytes;
+	double      data_rate;
+	double      wal_rate;
+	RateSource  data_source;
+	RateSource  wal_source;
+	double      restore_seconds;
+	double      replay_seconds;
+} RestoreEstimate;
+
+const char *rate_source_name(RateSource source);
+
+/* Fold one measurement into 'tp'; samples below the minimums are ignored */
+void        restore_throughput_update(RestoreThroughput *tp,
+									  uint64_t data_bytes, double data_seconds,
+									  uint64_t wal_bytes, double wal_seconds,
+									  time_t now);
+
+/*
+ * The rates measured for 'backup_dir' by earlier runs; zeros if there
+ * are none or no cache directory is set.
+ */
+void        restore_throughput_load(const char *backup_dir, RestoreThroughput *tp);
+bool        restore_throughput_save(const char *backup_dir, const RestoreThroughput *tp);
+
+/* Fold the checksum and WAL phases of this run (metrics.h) into the saved rates */
+void        restore_throughput_record(const char *backup_dir);
+
+/*
+ * Estimate restoring 'chain' with the rates of 'tp', or 'replay_rate'
+ * for WAL if it is not 0.  'wal_info' (may be NULL) extends the replay
+ * past the backup's stop LSN.  False if the chain has no completed
+ * backup.
+ */
+bool        restore_estimate_chain(const BackupChain *chain,
+								   const WALArchiveInfo *wal_info,
+								   const RestoreThroughput *tp, double replay_rate,
+								   RestoreEstimate *out);
+
+#endif /* RESTORE_ESTIMATE_H */
@@ -0,0 +1,141 @@
+/*
+ * retention.h
+ *
+ * Retention planning: which backups and archived WAL a policy would let
+ * go, and the bytes that would free
+ *
+ * A plan is built once from the chains and the WAL archives: for every
+ * instance its FULL chains in start_time order with running totals, for
+ * every archive its segments in segment-number order with running byte
+ * totals.  A policy then only has to find a cut in each, by binary
+ * search, so any number of what-if policies can be tried against years
+ * of history at the cost of one scan.
+ *
+ * Policies work on whole chains, the unit pg_probackup and pgBackRest
+ * expire:
+ *
+ *   redundancy N   the newest N chains whose FULL backup is OK are kept,
+ *                  and everything after the oldest of them
+ *   window D       what is needed to restore to any point of the last D:
+ *                  the newest OK chain finished before the window began,
+ *                  every later chain, and any chain with a backup that
+ *                  ended in the window
+ *
+ * With both rules a chain is kept if either keeps it.  Orphaned backups
+ * (no FULL) are not part of any chain, so they neither count nor hold on
+ * to WAL.  WAL is expendable below the start LSN of the oldest backup kept
+ * by any instance sharing the archive; the segment holding that LSN is
+ * kept.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RETENTION_H
+#define RETENTION_H
+
+#include "pg_backup_auditor.h"
+#include "backup_chain.h"
+#include "wal_archive_set.h"
+
+/* Most --retention policies one audit evaluates */
+#define RETENTION_MAX_POLICIES  16
+
+typedef struct {
+	char        instance[64];       /* applies to this instance only; "" = all */
+	int         redundancy;         /* OK chains to keep; 0 = no such rule */
+	time_t      window;             /* seconds of history to keep; 0 = no such rule */
+} RetentionPolicy;
+
+/* The FULL chains of one instance bound to one WAL archive */
+typedef struct {
+	const char         *instance;   /* the chains' instance_name */
+	int                 archive;    /* index into the WALArchiveSet, or -1 */
+	const BackupChain **chains;     /* by root start_time, oldest first */
+	int                 nchains;
+	uint64_t           *cum_bytes;  /* data bytes of chains [0, i), nchains + 1 */
+	int                *cum_backups;    /* backups of chains [0, i), nchains + 1 */
+	XLogRecPtr         *wal_from;   /* least start_lsn of chains [i, nchains) */
+	time_t             *ended_by;   /* latest end_time of chains [0, i] */
+	int                *ok;         /* indices of chains with an OK root */
+	time_t             *ok_min_end; /* least root end_time of ok[j..nok) */
+	int                 nok;
+} RetentionInstance;
+
+/* The segments of one scanned archive, by segment number */
+typedef struct {
+	const char         *path;
+	uint64_t            seg_bytes;  /* segment size */
+	uint64_t           *segno;
+	uint64_t           *cum_bytes;  /* of segments [0, i), count + 1 */
+	int                 count;
+} RetentionArchive;
+
+typedef struct {
+	RetentionInstance  *instances;
+	int                 ninstances;
+	RetentionArchive   *archives;   /* parallel to WALArchiveSet.archives */
+	int                 narchives;
+	time_t              now;        /* windows end here */
+} RetentionPlan;
+
+/* What a policy does to one instance */
+typedef struct {
+	int         keep_from;          /* first chain kept; nchains if none */
+	int         chains;             /* expendable chains: [0, keep_from) */
+	int         backups;
+	uint64_t    bytes;
+	bool        met;                /* false: too few OK chains to satisfy it */
+} RetentionInstanceResult;
+
+/* What a policy does to one archive */
+typedef struct {
+	XLogRecPtr  keep_from;          /* start of the first segment kept; 0 = all kept */
+	XLogRecPtr  from;               /* start of the first expendable segment */
+	int         segments;
+	uint64_t    bytes;
+} RetentionArchiveResult;
+
+/*
+ * Parse a --retention spec: comma-separated redundancy=N, window=DURATION
+ * (as parse_duration_argument() reads it) and instance=NAME.  At least
+ * one rule is required.  Prints an error and returns false otherwise.
+ */
+bool            retention_policy_parse(const char *spec, RetentionPolicy *policy);
+
+/* "redundancy 2, window 7d" */
+void            retention_policy_format(const RetentionPolicy *policy, char *buf,
+										size_t size);
+
+/*
+ * Plan retention for the FULL chains of 'chains' (an orphaned bucket is
+ * skipped) and the archives of 'wal_set' (may be NULL).  Returns NULL on
+ * out-of-memory.
+ */
+RetentionPlan  *retention_plan_build(const BackupChain *chains, int nchains,
+									 const WALArchiveSet *wal_set, time_t now);
+void            retention_plan_free(RetentionPlan *plan);
+
+/*
+ * Apply 'policy' (NULL: keep every chain) to the plan.  'inst' has room
+ * for plan->ninstances results, 'arch' (may be NULL) for plan->narchives.
+ * Instances the policy does not apply to keep everything.
+ */
+void            retention_plan_evaluate(const RetentionPlan *plan,
+										const RetentionPolicy *policy,
+										RetentionInstanceResult *inst,
+										RetentionArchiveResult *arch);
+
+#endif /* RETENTION_H */
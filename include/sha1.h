@@ -0,0 +1,67 @@
+/*
+ * sha1.h
+ *
+ * Minimal self-contained SHA-1 implementation (FIPS 180-4).
+ * Used for pgBackRest manifests, which store SHA-1 file checksums.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHA1_H
+#define SHA1_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SHA1_DIGEST_LENGTH  20
+#define SHA1_HEX_LENGTH     40   /* 20 bytes × 2 hex digits, no NUL */
+
+typedef struct {
+	uint32_t state[5];
+	uint64_t count;         /* total bits processed */
+	uint8_t  buf[64];       /* partial block buffer */
+	uint32_t buf_len;       /* bytes used in buf */
+} SHA1Ctx;
+
+/*
+ * Select the block function for this CPU (x86 SHA extensions or
+ * portable).  Called once from pg_backup_auditor_init(); sha1_init()
+ * also calls it lazily.
+ */
+void sha1_hw_init(void);
+const char *sha1_implementation(void);   /* "sha-ni" or "generic" */
+
+void sha1_init(SHA1Ctx *ctx);
+void sha1_update(SHA1Ctx *ctx, const void *data, size_t len);
+void sha1_final(SHA1Ctx *ctx, uint8_t digest[SHA1_DIGEST_LENGTH]);
+
+/*
+ * One-shot helpers.
+ *
+ * sha1_file   — hash an entire file; returns false on I/O error.
+ * sha1_to_hex — convert a raw 20-byte digest to a 41-byte NUL-terminated
+ *               lowercase hex string.
+ */
+bool sha1_file(const char *path, uint8_t digest[SHA1_DIGEST_LENGTH]);
+void sha1_to_hex(const uint8_t digest[SHA1_DIGEST_LENGTH],
+				 char hex[SHA1_HEX_LENGTH + 1]);
+
+/* Portable block function, exposed so tests can compare implementations */
+void sha1_blocks_generic(uint32_t state[5], const uint8_t *data,
+						 size_t nblocks);
+
+#endif /* SHA1_H */
@@ -37,6 +37,14 @@ typedef struct {
 	uint32_t buf_len;       /* bytes used in buf */
 } SHA256Ctx;
 
+/*
+ * Select the block function for this CPU (x86 SHA extensions, ARMv8
+ * SHA2 or portable).  Called once from pg_backup_auditor_init();
+ * sha256_init() also calls it lazily.
+ */
+void sha256_hw_init(void);
+const char *sha256_implementation(void);   /* "sha-ni", "armv8", "generic" */
+
 void sha256_init(SHA256Ctx *ctx);
 void sha256_update(SHA256Ctx *ctx, const void *data, size_t len);
 void sha256_final(SHA256Ctx *ctx, uint8_t digest[SHA256_DIGEST_LENGTH]);
@@ -52,4 +60,8 @@ bool sha256_file(const char *path, uint8_t digest[SHA256_DIGEST_LENGTH]);
 void sha256_to_hex(const uint8_t digest[SHA256_DIGEST_LENGTH],
 				   char hex[SHA256_HEX_LENGTH + 1]);
 
+/* Portable block function, exposed so tests can compare implementations */
+void sha256_blocks_generic(uint32_t state[8], const uint8_t *data,
+						   size_t nblocks);
+
 #endif /* SHA256_H */
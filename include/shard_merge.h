@@ -0,0 +1,110 @@
+/*
+ * shard_merge.h
+ *
+ * Combining the parts of a sharded check (verify_shard.h) into one
+ * report.
+ *
+ * Each part is the NDJSON output of 'check --shard=K/N --format=ndjson':
+ * a "shard" record naming the part and the catalog it was run against,
+ * then the usual chain, backup, wal_check and finding records and a
+ * closing summary.  The parts must come from the same catalog, level and
+ * N, and together cover shards 1..N once each.
+ *
+ * Every shard reports every backup and WAL check, with the findings of
+ * the content it read and those of the checks all shards run.  Merging
+ * keeps the report order of the parts and gives each backup and WAL
+ * check one ValidationResult: the union of the parts' findings, where a
+ * finding reported by several parts (a global check) counts once.  The
+ * totals are then computed from the merged results, as for a local run.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHARD_MERGE_H
+#define SHARD_MERGE_H
+
+#include <stdio.h>
+
+#include "types.h"
+
+typedef enum {
+	SHARD_ENTRY_CHAIN,
+	SHARD_ENTRY_BACKUP,
+	SHARD_ENTRY_WAL_CHECK
+} ShardEntryKind;
+
+/* One chain header, backup or WAL check of the merged report */
+typedef struct {
+	ShardEntryKind   kind;
+	char            *record;    /* the record as first read, one line */
+	char            *name;      /* backup ID, or archive of a WAL check */
+	char             check[32]; /* WAL check: "restore_chain", "continuity", ... */
+	bool             skipped;   /* backup skipped for its status */
+	ValidationResult result;    /* merged findings (not of a chain) */
+	int              next;      /* next entry in report order, or -1 */
+} ShardEntry;
+
+typedef struct ShardMergeIndex ShardMergeIndex;
+
+typedef struct {
+	int          count;         /* N, from the first part */
+	int          parts;         /* parts added */
+	bool        *seen;          /* [count]: shard K-1 added */
+	char         level[16];
+	char         catalog[24];
+
+	ShardEntry  *entries;
+	int          entry_count;
+	int          entry_capacity;
+	int          first;         /* first entry in report order, or -1 */
+
+	bool         stopped;       /* a part stopped at --fail-fast */
+	bool         sampled;       /* the parts ran with --sample */
+	uint64_t     sampled_files;
+	uint64_t     checksummed_files;
+	uint64_t     sampled_wal_segments;
+	uint64_t     wal_segments;
+
+	ShardMergeIndex *index;
+} ShardMerge;
+
+/* Totals of the merged report, counted the way 'check' counts them */
+typedef struct {
+	int backups_found;
+	int backups_validated;
+	int backups_skipped;
+	int errors;                 /* of backups and WAL checks */
+	int warnings;               /* of backups */
+} ShardMergeTotals;
+
+ShardMerge *shard_merge_create(void);
+
+/*
+ * Add the part read from 'fp', or the parts if several were written one
+ * after another; 'name' is used in messages.  False, with an error
+ * printed, if it is not a complete part of the same run as the parts
+ * before it.
+ */
+bool shard_merge_add(ShardMerge *merge, FILE *fp, const char *name);
+
+/* Whether every shard was added; false, with the missing ones printed */
+bool shard_merge_complete(const ShardMerge *merge);
+
+void shard_merge_totals(const ShardMerge *merge, ShardMergeTotals *totals);
+
+void shard_merge_free(ShardMerge *merge);
+
+#endif /* SHARD_MERGE_H */
@@ -0,0 +1,187 @@
+/*
+ * storage.h
+ *
+ * Backup repositories in object storage.
+ *
+ * A backup or WAL location is either a local path or a URL:
+ *
+ *   s3://bucket/prefix     Amazon S3 or any S3-compatible store
+ *   gs://bucket/prefix     Google Cloud Storage (S3-compatible XML API)
+ *   file:///path           a local directory, read the way a store is
+ *
+ * Adapters and validators work on files, so a remote repository is
+ * staged into a local mirror before the scan.  One paginated LIST of the
+ * whole prefix gives every object's key, size and modification time;
+ * these become the mirror's tree, with objects that are not needed yet
+ * left as sparse files of the right size.  Directory walks, stat()s and
+ * the WAL inventory then never wait on the network.  What is downloaded
+ * depends on the depth: STAGE_METADATA fetches control, label, info and
+ * manifest files (and the head of tar archives and of the first WAL
+ * segment of each directory); STAGE_WAL_HEADERS adds the first page of
+ * every other WAL segment, for a header-only WAL check (a compressed
+ * segment's first megabyte); STAGE_CONTENT fetches every byte, large
+ * objects as several ranged GETs.  Requests are batched per connection
+ * and run on parallel streams.
+ *
+ * Checks that read whole files do not stage the content up front: they
+ * fetch one backup, or one batch of WAL segments, with storage_fetch()
+ * right before reading it and hand it back with storage_release() once
+ * verified, so a temporary mirror only ever holds what is being read.
+ *
+ * With a cache directory the mirror is kept there between runs, fetched
+ * content included, and only objects whose size or ETag changed are
+ * fetched again; without one it is a temporary directory removed at
+ * exit.
+ *
+ * There is no S3 client in here: the s3:// and gs:// drivers run the curl
+ * command-line tool, one process per batch of requests.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "pg_backup_auditor.h"
+
+/* Objects up to this size are always fetched: control and label files */
+#define STORAGE_INLINE_SIZE      (64 * 1024)
+
+/* Prefix fetched of tar archives and of the first WAL segment of a directory */
+#define STORAGE_HEAD_SIZE        (1024 * 1024)
+
+/* Prefix fetched of the other WAL segments for a header-only check */
+#define STORAGE_PAGE_SIZE        (8 * 1024)
+
+/* Larger objects are fetched as ranged GETs of this size */
+#define STORAGE_PART_SIZE        (8 * 1024 * 1024)
+
+/* Parallel streams, and what one stream fetches over one connection */
+#define STORAGE_FETCH_STREAMS    16
+#define STORAGE_BATCH_REQUESTS   32
+#define STORAGE_BATCH_BYTES      (64 * 1024 * 1024)
+
+/* Keys per LIST page */
+#define STORAGE_LIST_PAGE        1000
+
+#define STORAGE_ETAG_LEN         72
+
+typedef enum {
+	STAGE_METADATA,             /* enough to scan, list and audit */
+	STAGE_WAL_HEADERS,          /* + the first page of every WAL segment */
+	STAGE_CONTENT               /* every byte, up front */
+} StageDepth;
+
+/* One listed object; 'key' is relative to the location's prefix */
+typedef struct {
+	const char *key;
+	uint64_t    size;
+	time_t      mtime;
+	const char *etag;           /* "" if the store gave none */
+} StorageObject;
+
+/*
+ * Bytes [offset, offset + length) of an object, written to the local
+ * file 'dest' at the same offset.  A 'whole' request covers the entire
+ * object and replaces 'dest'; otherwise 'dest' already exists.
+ */
+typedef struct {
+	const char *key;
+	uint64_t    offset;
+	uint64_t    length;
+	bool        whole;
+	const char *dest;
+} StorageRequest;
+
+typedef struct StorageDriver StorageDriver;
+
+typedef struct {
+	const StorageDriver *driver;
+	char        url[PATH_MAX];      /* as given, without trailing slashes */
+	char        bucket[256];        /* empty for file:// */
+	char        prefix[PATH_MAX];   /* key prefix, "" or ending in '/';
+									 * the directory for file:// */
+} StorageLocation;
+
+/* Called for each listed object; returning false stops the listing */
+typedef bool (*StorageListFn)(void *arg, const StorageObject *object);
+
+struct StorageDriver {
+	const char *scheme;
+	/* Every object under the prefix, in any order; false on failure */
+	bool      (*list)(const StorageLocation *loc, StorageListFn fn, void *arg);
+	/* Perform 'count' requests; false if any of them failed */
+	bool      (*fetch)(const StorageLocation *loc, const StorageRequest *requests,
+					   int count);
+};
+
+extern const StorageDriver storage_file_driver;
+extern const StorageDriver storage_s3_driver;
+extern const StorageDriver storage_gcs_driver;
+
+/* Whether 'location' is a URL rather than a local path */
+bool        storage_is_remote(const char *location);
+
+/* Split a URL into driver, bucket and prefix; false if it is not one */
+bool        storage_parse_location(const char *location, StorageLocation *loc);
+
+/*
+ * Stage 'location' to 'depth' and return the mirror directory (owned by
+ * this module, valid until exit), or NULL with the reason logged.
+ */
+const char *storage_stage(const char *location, StageDepth depth);
+
+/*
+ * For the commands: replace a remote *location with its staged mirror.
+ * Local paths are left alone.  False, with an error printed, on failure.
+ */
+bool        storage_resolve(char **location, StageDepth depth);
+
+/*
+ * For the validators: fetch every byte of the objects at or below each
+ * of 'paths' (files or directories in a staged mirror) and pin them
+ * while they are read.  Paths outside any mirror are left alone.  False,
+ * with the objects logged, if one could not be fetched.  Each call is
+ * matched by a storage_release() of the same paths, whether it succeeded
+ * or not.  Thread-safe.
+ */
+bool        storage_fetch(const char *const *paths, int count);
+
+/*
+ * Unpin what storage_fetch() pinned.  In a temporary mirror an object
+ * nobody holds any longer is truncated back to what the staging fetched
+ * of it, the rest a hole.
+ */
+void        storage_release(const char *const *paths, int count);
+
+/*
+ * For the drivers: copy 'length' bytes of local file 'src' from
+ * 'src_offset' into 'dest' at 'offset', creating 'dest' if needed.
+ */
+bool        storage_copy_range(const char *src, uint64_t src_offset,
+							   const char *dest, uint64_t offset, uint64_t length);
+
+/*
+ * Parse one ListObjectsV2 response, calling 'fn' for every object with
+ * the first 'strip' bytes of its key removed.  'token' receives the
+ * continuation token, or "" on the last page.  Returns the number of
+ * objects, or -1 if the response is not a listing or 'fn' stopped.
+ */
+int         storage_s3_parse_list(const char *xml, size_t len, size_t strip,
+								  StorageListFn fn, void *arg,
+								  char *token, size_t token_size);
+
+#endif /* STORAGE_H */
@@ -0,0 +1,98 @@
+/*
+ * tar_reader.h
+ *
+ * Streaming, in-process reader for tar archives (ustar, GNU and pax).
+ *
+ * The archive is read in a single forward pass: tar_reader_next() moves
+ * to the next member header and tar_reader_read() pulls that member's
+ * data.  Unread data is skipped automatically (by seeking when the input
+ * is a plain file).  Each TarReader owns all of its state, so several
+ * archives can be read at the same time from different threads.
+ *
+ * Compressed archives are recognised by their magic bytes and read
+ * through the decompress layer (decompress.h).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TAR_READER_H
+#define TAR_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define TAR_BLOCK_SIZE  512
+#define TAR_NAME_MAX    1024
+
+/* Member types, as stored in the header typeflag */
+#define TAR_TYPE_REGULAR    '0'
+#define TAR_TYPE_HARDLINK   '1'
+#define TAR_TYPE_SYMLINK    '2'
+#define TAR_TYPE_DIRECTORY  '5'
+
+typedef struct TarReader TarReader;
+
+typedef struct {
+	char     name[TAR_NAME_MAX];    /* member path, leading "./" removed */
+	uint64_t size;                  /* data bytes */
+	char     type;                  /* TAR_TYPE_* ('\0' is reported as '0') */
+	time_t   mtime;
+} TarMember;
+
+/*
+ * Open 'path' for reading.  Returns NULL if the file cannot be opened
+ * or its compression format needs a decompressor that is unavailable.
+ */
+TarReader *tar_reader_open(const char *path);
+
+/*
+ * Advance to the next member.  Returns 1 and fills 'member', 0 at the
+ * end of the archive, or -1 on a read error or corrupt header.
+ */
+int        tar_reader_next(TarReader *tr, TarMember *member);
+
+/*
+ * Read up to 'len' bytes of the current member's data.  Returns the
+ * number of bytes read, 0 once the member is exhausted, or -1 if the
+ * archive ends early.
+ */
+ssize_t    tar_reader_read(TarReader *tr, void *buf, size_t len);
+
+void       tar_reader_close(TarReader *tr);
+
+/*
+ * One-pass extraction of small members into memory.
+ *
+ * The caller fills in 'name' for each entry; on return 'found' is set
+ * and 'data' holds a malloc'd, NUL-terminated copy of the member (which
+ * the caller frees).  Members larger than 'max_size' are left unloaded.
+ * Reading stops as soon as every wanted member has been seen.
+ */
+typedef struct {
+	const char *name;
+	bool        found;
+	char       *data;
+	size_t      size;
+} TarWanted;
+
+/* Returns the number of members found, or -1 if the archive is unreadable */
+int        tar_extract_members(const char *path, TarWanted *wanted,
+							   int nwanted, size_t max_size);
+
+#endif /* TAR_READER_H */
@@ -69,7 +69,8 @@ typedef enum {
 	VALIDATION_LEVEL_BASIC,      /* Level 1: File structure + chain + WAL presence */
 	VALIDATION_LEVEL_STANDARD,   /* Level 2: + metadata validation (default) */
 	VALIDATION_LEVEL_CHECKSUMS,  /* Level 3: + WAL continuity + checksums */
-	VALIDATION_LEVEL_FULL        /* Level 4: All possible checks */
+	VALIDATION_LEVEL_FULL,       /* Level 4: All possible checks */
+	VALIDATION_LEVEL_PAGES       /* Level 5: + page headers and checksums of relation files */
 } ValidationLevel;
 
 /* Backup information structure */
@@ -100,6 +101,7 @@ typedef struct BackupInfo {
 	char            wal_start_file[64]; /* WAL filename from START WAL LOCATION */
 	char            compress_alg[32];   /* Compression algorithm: none, gzip, zstd, lz4, etc. */
 	char            wal_mode[16];       /* Display label: tool-specific WAL mode */
+	bool            partial;            /* Scanned at BACKUP_LOAD_IDENTITY; see backup_info_load() */
 	struct BackupInfo *next;
 } BackupInfo;
 
@@ -110,20 +112,88 @@ typedef struct {
 	uint32_t seg_id;
 } WALSegmentName;
 
+/* On-disk form of an archived segment that is not a bare 24-char file */
+typedef struct {
+	char           *suffix;         /* after the name: ".gz", "-<sha1>.zst"; NULL = none */
+	bool            in_subdir;      /* under <timeline><log_id>/ (pgBackRest layout) */
+} WALSegmentFile;
+
+/* Size and mtime of an archived segment as found by the archive scan */
+typedef struct {
+	uint64_t        size;           /* on-disk (possibly compressed) bytes */
+	time_t          mtime;
+} WALSegmentStat;
+
+/*
+ * A run of consecutive segments of one timeline.  Positions are segment
+ * numbers (LSN / segment size, see wal_segment_number()), so a run covers
+ * segments start .. start + count - 1.
+ */
+typedef struct {
+	uint32_t        timeline;
+	uint32_t        count;
+	uint64_t        start;
+	int             first;          /* index of the first one in segments[] */
+} WALSegmentRange;
+
+/*
+ * A timeline of the archive's history graph, from the NNNNNNNN.history
+ * files.  'parent' is the timeline it branched from (0 if none is known)
+ * and 'switch_lsn' the LSN at which it did.
+ */
+typedef struct {
+	uint32_t        tli;
+	uint32_t        parent;
+	XLogRecPtr      switch_lsn;
+	bool            has_history;    /* its own history file is in the archive */
+} WALTimeline;
+
 /* WAL archive information */
 typedef struct {
 	char            archive_path[PATH_MAX];
 	int             segment_count;
 	WALSegmentName *segments;
+	WALSegmentFile *files;          /* parallel to segments; NULL if all bare */
+	WALSegmentStat *stats;          /* parallel to segments; NULL if not from disk */
+	uint64_t        total_bytes;    /* every regular file under archive_path */
+	uint32_t        segment_size;   /* of its segments, as far as known; 0 = 16 MB */
+	WALSegmentRange *ranges;        /* runs of segments[]; NULL if not built */
+	int             range_count;
+	WALTimeline    *timelines;      /* sorted by tli; NULL if not built */
+	int             timeline_count;
+	bool            in_tar;         /* archive_path is a tar file of the segments */
 } WALArchiveInfo;
 
-/* Validation result */
+/* What kind of problem an error reports */
+typedef enum {
+	VALIDATION_CODE_OTHER = 0,
+	VALIDATION_CODE_MISSING_FILE,
+	VALIDATION_CODE_SIZE_MISMATCH,
+	VALIDATION_CODE_CHECKSUM_MISMATCH,
+	VALIDATION_CODE_CORRUPT_FILE,
+	VALIDATION_CODE_UNREADABLE,
+	VALIDATION_CODE_MISSING_WAL,
+	VALIDATION_CODE_COUNT
+} ValidationCode;
+
+typedef struct ValidationArenaBlock ValidationArenaBlock;
+
+/*
+ * Validation result.  A zeroed struct is an empty result; messages are
+ * added and merged with the helpers in validation_result.h, which own
+ * the storage below the counts.
+ */
 typedef struct {
 	BackupStatus    status;
 	int             error_count;
 	int             warning_count;
 	char          **errors;
 	char          **warnings;
+	uint8_t        *error_codes;    /* ValidationCode, parallel to errors */
+	int             error_capacity;
+	int             warning_capacity;
+	int             code_counts[VALIDATION_CODE_COUNT];
+	ValidationArenaBlock *arena;    /* message text */
 } ValidationResult;
 
 /* Generic status codes */
@@ -0,0 +1,68 @@
+/*
+ * validation_result.h
+ *
+ * Building ValidationResults: every validator adds its messages here,
+ * and per-check results are merged into per-backup and per-chain ones.
+ *
+ * Message text lives in an arena owned by the result, and the message
+ * arrays grow geometrically.  Merging moves a child's messages into the
+ * parent without copying any text: the child's arena blocks are linked
+ * into the parent's, and only the pointer arrays are appended (or taken
+ * over whole when the parent is still empty).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef VALIDATION_RESULT_H
+#define VALIDATION_RESULT_H
+
+#include "types.h"
+
+void validation_add_error(ValidationResult *result, const char *message);
+void validation_add_error_code(ValidationResult *result, ValidationCode code,
+							   const char *message);
+void validation_add_warning(ValidationResult *result, const char *message);
+
+/*
+ * Move all of src's messages to the end of dst's, leaving src empty.
+ * Neither status is changed.
+ */
+void validation_result_merge(ValidationResult *dst, ValidationResult *src);
+
+/* Copy src's messages to the end of dst's; src is unchanged */
+void validation_result_append(ValidationResult *dst, const ValidationResult *src);
+
+/* Release a result's messages but not the struct itself */
+void validation_result_clear(ValidationResult *result);
+
+/* Short name of a code, e.g. "missing_file" */
+const char *validation_code_name(ValidationCode code);
+
+/* The code named 'name'; false if there is none */
+bool validation_code_from_name(const char *name, ValidationCode *code);
+
+/*
+ * Fail-fast mode.  Once enabled, the first error added to any result
+ * requests a stop: running validations skip their remaining work and
+ * queued ones are not started.  validation_request_stop() does the same
+ * directly, for errors kept outside a ValidationResult.
+ */
+void validation_set_fail_fast(bool enabled);
+bool validation_fail_fast(void);
+void validation_request_stop(void);
+bool validation_stop_requested(void);
+
+#endif /* VALIDATION_RESULT_H */
@@ -0,0 +1,63 @@
+/*
+ * validation_scheduler.h
+ *
+ * Runs validate_backup_chain() for many backups at once.
+ *
+ * The caller lists the backups to validate, in the order results will be
+ * used, and then collects each result with validation_scheduler_wait().
+ * Up to validation_get_jobs() backups are validated side by side; the
+ * waiting thread takes on a backup itself when nobody has started it, so
+ * with one job everything runs in order on the caller's thread.  File
+ * reads inside the validations share one budget (validation_io_acquire()),
+ * so per-backup and per-file parallelism together do not oversubscribe
+ * the disks.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef VALIDATION_SCHEDULER_H
+#define VALIDATION_SCHEDULER_H
+
+#include "pg_backup_auditor.h"
+
+typedef struct {
+	BackupInfo       *backup;
+	WALArchiveInfo   *wal_info;
+	ValidationResult *result;       /* set once the task is done */
+} ValidationTask;
+
+typedef struct ValidationScheduler ValidationScheduler;
+
+/*
+ * Start validating 'tasks' against 'all_backups' on background threads.
+ * The array must stay valid until validation_scheduler_finish().
+ * Returns NULL on allocation failure.
+ */
+ValidationScheduler *validation_scheduler_start(ValidationTask *tasks, int count,
+												BackupInfo *all_backups,
+												ValidationLevel level);
+
+/*
+ * Result of tasks[index], once validated (by the calling thread if no
+ * worker has claimed it yet).  The result stays owned by the task; it is
+ * NULL if the task was dropped after a fail-fast stop.
+ */
+ValidationResult *validation_scheduler_wait(ValidationScheduler *sched, int index);
+
+/* Wait for every task, stop the workers and free the scheduler */
+void validation_scheduler_finish(ValidationScheduler *sched);
+
+#endif /* VALIDATION_SCHEDULER_H */
@@ -0,0 +1,123 @@
+/*
+ * verify_jobs.h
+ *
+ * Parallel per-file verification engine shared by the manifest checkers
+ * of all supported backup tools.
+ *
+ * A validator turns its manifest into a VerifyJobList — one job per file
+ * with the expected size and digest — and hands it to verify_jobs_run(),
+ * which checks the files on validation_get_jobs() threads.
+ * verify_jobs_merge() then copies the outcomes into a ValidationResult
+ * in list (manifest) order, so output is independent of scheduling.
+ * For tar-format backups verify_jobs_run_tar() streams each archive
+ * once instead, hashing members as they go by.
+ *
+ * Plain files are looked up in the digest cache (digest_cache.h) first,
+ * so a file listed by several backups is read once.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef VERIFY_JOBS_H
+#define VERIFY_JOBS_H
+
+#include "pg_backup_auditor.h"
+#include "decompress.h"
+#include "page_checksum.h"
+#include "digest_cache.h"
+
+typedef enum {
+	VERIFY_ALG_NONE = 0,    /* presence (and size, if given) only */
+	VERIFY_ALG_CRC32C,
+	VERIFY_ALG_SHA256,
+	VERIFY_ALG_SHA1,
+	VERIFY_ALG_PAGES        /* page headers and checksums (page_checksum.h) */
+} VerifyAlgorithm;
+
+/* Job flags */
+#define VERIFY_SKIP_IF_MISSING  0x01    /* absent file is not an error */
+#define VERIFY_NOT_SAMPLED      0x02    /* left out by --sample; presence only */
+#define VERIFY_OTHER_SHARD      0x04    /* another --shard verifies it; not read */
+#define VERIFY_INCREMENTAL      0x08    /* INCREMENTAL.* file: its header is checked
+										 * as it is read (incremental_backup.h) */
+
+typedef enum {
+	VERIFY_PENDING = 0,
+	VERIFY_OK,
+	VERIFY_SKIPPED,         /* missing, but VERIFY_SKIP_IF_MISSING */
+	VERIFY_FAILED,          /* message is an error */
+	VERIFY_UNREADABLE       /* message is an error or warning, see list */
+} VerifyOutcome;
+
+typedef struct {
+	char            *path;          /* file on disk */
+	char            *name;          /* manifest name, used in messages */
+	int64_t          expected_size; /* -1 = size not checked */
+	VerifyAlgorithm  algorithm;
+	uint32_t         expected_crc;  /* VERIFY_ALG_CRC32C */
+	char            *expected_hex;  /* VERIFY_ALG_SHA256 / VERIFY_ALG_SHA1 */
+	CompressionType  compression;   /* size and digest are of the
+									 * decompressed content */
+	const PageCheckOptions *pages;  /* VERIFY_ALG_PAGES */
+	uint32_t         first_block;   /* VERIFY_ALG_PAGES: of the file's first page */
+	unsigned         flags;
+	bool             has_identity;  /* 'identity' is set: the digest is cached */
+	DigestKey        identity;      /* of the file when its digest was looked up */
+
+	VerifyOutcome    outcome;
+	ValidationCode   code;          /* kind of failure */
+	char            *message;
+} VerifyJob;
+
+typedef struct {
+	VerifyJob   *jobs;
+	int          count;
+	int          capacity;
+	const char  *label;             /* prefix for progress log lines */
+	const char  *scope;             /* backup ID, for --shard; NULL = none */
+	bool         unreadable_warns;  /* read failures are warnings */
+	bool         sampled;           /* verify_sample.h selection applied */
+	bool         sharded;           /* verify_shard.h ownership applied */
+} VerifyJobList;
+
+/* Summary filled in by verify_jobs_merge() */
+typedef struct {
+	int verified;
+	int skipped;
+	int failed;
+	int not_sampled;    /* present, content left for a later run */
+	int other_shard;    /* left to another --shard, not looked at */
+} VerifyStats;
+
+void       verify_job_list_init(VerifyJobList *list, const char *label);
+VerifyJob *verify_job_list_add(VerifyJobList *list,
+							   const char *path, const char *name);
+void       verify_job_list_free(VerifyJobList *list);
+
+void       verify_jobs_run(VerifyJobList *list, int jobs);
+
+/*
+ * Tar-format backups: verify pending jobs against the members of
+ * 'tar_path' (matched as prefix + member name) in one streaming pass,
+ * then mark whatever no archive contained as missing.
+ */
+bool       verify_jobs_run_tar(VerifyJobList *list, const char *tar_path,
+							   const char *prefix);
+void       verify_jobs_finish_missing(VerifyJobList *list);
+void       verify_jobs_merge(VerifyJobList *list, ValidationResult *result,
+							 VerifyStats *stats);
+
+#endif /* VERIFY_JOBS_H */
@@ -0,0 +1,87 @@
+/*
+ * verify_sample.h
+ *
+ * Sampled verification: read only a fraction of the files and WAL
+ * segments in each run, chosen so that consecutive runs cover all of
+ * them.
+ *
+ * Items are laid out on a circle in a fixed, hash-defined order, each
+ * taking an arc proportional to its weight (one per item, or its size).
+ * A run verifies the items whose arcs start inside a window of the
+ * chosen fraction, and each rotation step moves the window on by its own
+ * length, so ceil(1 / fraction) consecutive steps cover the circle.
+ * Items an earlier run has verified (the WAL verification cache) are not
+ * read at all; the budget goes to unverified items first.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef VERIFY_SAMPLE_H
+#define VERIFY_SAMPLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+	SAMPLE_BY_COUNT,        /* the fraction is of the number of items */
+	SAMPLE_BY_BYTES         /* ... of their total size */
+} SampleUnit;
+
+/* What a selection was made for, for the coverage report */
+typedef enum {
+	SAMPLE_FILES,
+	SAMPLE_WAL_SEGMENTS,
+	SAMPLE_KIND_COUNT
+} SampleKind;
+
+typedef struct {
+	uint64_t key;           /* sample_key() of a stable name */
+	uint64_t bytes;
+	bool     cached;        /* verified by an earlier run; never read */
+	bool     selected;      /* out: verify in this run */
+} SampleItem;
+
+typedef struct {
+	uint64_t items;
+	uint64_t items_checked; /* selected or cached */
+	uint64_t bytes;
+	uint64_t bytes_checked;
+} SampleCoverage;
+
+/*
+ * Verify 'fraction' (0 < fraction <= 1) of the items, in 'unit', at
+ * rotation step 'step'.  A fraction of 1 turns sampling off.  Set before
+ * validation starts.
+ */
+void validation_set_sample(double fraction, SampleUnit unit, uint64_t step);
+bool validation_sample_active(void);
+
+/* Rotation steps needed to cover every item once (1 without sampling) */
+int  validation_sample_runs(void);
+
+uint64_t sample_key(const char *name);
+
+/*
+ * Set 'selected' on the items to verify this run and add them to the
+ * coverage totals for 'kind'.  Without sampling every uncached item is
+ * selected.
+ */
+void sample_select(SampleItem *items, int count, SampleKind kind);
+
+/* Totals over every selection made so far */
+void sample_coverage(SampleKind kind, SampleCoverage *out);
+
+#endif /* VERIFY_SAMPLE_H */
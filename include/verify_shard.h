@@ -0,0 +1,68 @@
+/*
+ * verify_shard.h
+ *
+ * Sharded verification: the content checks of one catalog split between
+ * several auditor runs, typically on different hosts.
+ *
+ * With --shard K/N a check run reads only the files and WAL segments of
+ * shard K.  Ownership is a hash of names that do not depend on the host
+ * (backup ID and manifest name of a file; timeline and segment number of
+ * a WAL segment), so N runs against the same catalog cover everything
+ * once without talking to each other.  WAL segments are dealt out in
+ * runs of SHARD_WAL_RANGE consecutive segments, so that records crossing
+ * from one segment into the next mostly stay within a shard.  Checks
+ * that read no content (structure, metadata, WAL availability and
+ * continuity) are run by every shard; 'merge' (shard_merge.h) reports
+ * each of their findings once.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef VERIFY_SHARD_H
+#define VERIFY_SHARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* WAL segments dealt out to one shard at a time (1 GB of 16 MB segments) */
+#define SHARD_WAL_RANGE     64
+
+/* Largest N accepted for --shard */
+#define SHARD_MAX_COUNT     4096
+
+/*
+ * Verify shard 'index' of 'count' (1 <= index <= count).  A count of 1
+ * turns sharding off.  Set before validation starts.
+ */
+void validation_set_shard(int index, int count);
+bool validation_shard_active(void);
+int  validation_shard_index(void);
+int  validation_shard_count(void);
+
+/* Parse "K/N"; false, with an error printed, if it is not valid */
+bool shard_from_string(const char *str, int *index, int *count);
+
+/*
+ * Whether this run verifies file 'name' of backup 'scope'.  A NULL name
+ * stands for the whole backup (tar-format backups, whose archives are
+ * read in one pass).  Always true without sharding.
+ */
+bool shard_owns_file(const char *scope, const char *name);
+
+/* Whether this run verifies WAL segment 'segno' of 'timeline' */
+bool shard_owns_wal_segment(uint32_t timeline, uint64_t segno);
+
+#endif /* VERIFY_SHARD_H */
@@ -0,0 +1,72 @@
+/*
+ * wal_archive_set.h
+ *
+ * The WAL archives a set of backups is validated against.
+ *
+ * A backup directory can hold several pg_probackup instances or
+ * pgBackRest stanzas, each archiving WAL to its own directory.  The set
+ * resolves the archive of every backup through its adapter's
+ * get_wal_archive_path(), scans each distinct archive once (several at a
+ * time on scan_get_jobs() threads) and binds every backup to the archive
+ * of its instance.  With an explicit --wal-archive the set holds that one
+ * archive and every backup is bound to it.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WAL_ARCHIVE_SET_H
+#define WAL_ARCHIVE_SET_H
+
+#include "pg_backup_auditor.h"
+
+typedef struct {
+	char            path[PATH_MAX];
+	WALArchiveInfo *info;           /* NULL if the archive could not be scanned */
+	BackupInfo    **members;        /* backups bound to it, in list order */
+	int             member_count;
+} WALArchiveSetEntry;
+
+typedef struct {
+	BackupInfo         *backup;
+	int                 archive;    /* index into WALArchiveSet.archives */
+} WALArchiveBinding;
+
+typedef struct {
+	WALArchiveSetEntry *archives;   /* in order of first use */
+	int                 count;
+	WALArchiveBinding  *bindings;   /* sorted by backup address */
+	int                 binding_count;
+} WALArchiveSet;
+
+/*
+ * Resolve and scan the archives of 'backups'.  With 'explicit_path' that
+ * archive is used for all of them.  Otherwise archives are found through
+ * the adapters; only archives used by an archive-mode backup (stream =
+ * false) are scanned.  Returns NULL on out-of-memory.
+ */
+WALArchiveSet  *wal_archive_set_build(BackupInfo *backups, const char *explicit_path);
+void            wal_archive_set_free(WALArchiveSet *set);
+
+/* Archive 'backup' is bound to, or -1 */
+int             wal_archive_set_index(const WALArchiveSet *set, const BackupInfo *backup);
+
+/* Scanned archive of 'backup', or NULL */
+WALArchiveInfo *wal_archive_set_lookup(const WALArchiveSet *set, const BackupInfo *backup);
+
+/* Number of archives that were scanned successfully */
+int             wal_archive_set_scanned(const WALArchiveSet *set);
+
+#endif /* WAL_ARCHIVE_SET_H */
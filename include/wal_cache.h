@@ -0,0 +1,92 @@
+/*
+ * wal_cache.h
+ *
+ * Persistent cache of WAL segments that passed validation.
+ *
+ * Archived segments never change, so a segment that was found clean once
+ * does not need to be read again as long as the file is the same one.
+ * The cache keeps, per WAL archive, the path and identity (size, mtime,
+ * device, inode) of every clean segment in one file under the directory
+ * set with validation_set_cache_dir().  Segments with problems are never
+ * cached, so they are re-checked and reported on every run.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WAL_CACHE_H
+#define WAL_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "types.h"
+
+typedef struct WALCache WALCache;
+
+/*
+ * Load the cache of 'archive_path', or start an empty one.  Entries made
+ * with a different segment size are discarded.  Returns NULL when no
+ * cache directory is configured.
+ */
+WALCache *wal_cache_open(const char *archive_path, uint32_t seg_size);
+
+/* True if 'path' is cached as clean and 'st' still describes the same file */
+bool      wal_cache_lookup(WALCache *cache, const char *path,
+						   const struct stat *st);
+
+/* Record 'path' (as described by 'st') as clean */
+void      wal_cache_store(WALCache *cache, const char *path,
+						  const struct stat *st);
+
+/*
+ * Write the cache back if it changed, then free it.  With 'prune' set,
+ * entries that were not looked up since wal_cache_open() are dropped
+ * (for callers that walked the whole archive).
+ */
+void      wal_cache_close(WALCache *cache, bool prune);
+
+/*
+ * The record left incomplete at the end of a segment verified on its own
+ * ('verify-segment'), kept until the next segment arrives so that the
+ * record can be finished and checked then.  One is kept per archive.
+ */
+typedef struct {
+	char		path[PATH_MAX];		/* segment the record starts in */
+	uint32_t	seg_size;
+	char		seg_filename[32];
+	int			page_no;
+	uint32_t	rec_off;
+	uint32_t	tot_len;			/* xl_tot_len */
+	uint32_t	have;				/* bytes of the record in 'data' */
+	uint8_t	   *data;
+} WALCacheTail;
+
+/*
+ * Keep 'tail' for 'archive_path'; 'st' describes tail->path.  NULL
+ * forgets the kept one.  Does nothing without a cache directory.
+ */
+void      wal_cache_set_tail(const char *archive_path, const WALCacheTail *tail,
+							 const struct stat *st);
+
+/*
+ * Load the tail kept for 'archive_path' into *tail, if its segment is
+ * still the same file; *st is then that file's stat.  tail->data is
+ * malloc'd.
+ */
+bool      wal_cache_get_tail(const char *archive_path, WALCacheTail *tail,
+							 struct stat *st);
+
+#endif /* WAL_CACHE_H */
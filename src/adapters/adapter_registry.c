@@ -70,6 +70,27 @@ detect_backup_type(const char *path)
 	return NULL;
 }
 
+/*
+ * Detect backup type from the entries of 'path', read once for all
+ * adapters; those without detect_entries() look for themselves.
+ */
+BackupAdapter*
+detect_backup_type_in(const char *path, const DirSnapshot *entries)
+{
+	int i;
+
+	for (i = 0; pg_backup_auditor_adapters[i] != NULL; i++)
+	{
+		BackupAdapter *adapter = pg_backup_auditor_adapters[i];
+
+		if (adapter->detect_entries != NULL ?
+			adapter->detect_entries(path, entries) : adapter->detect(path))
+			return adapter;
+	}
+
+	return NULL;
+}
+
 /*
  * Convert BackupType to string
  */
@@ -22,117 +22,69 @@
 #define _XOPEN_SOURCE 700
 
 #include "pg_backup_auditor.h"
+#include "tar_reader.h"
+#include "backup_manifest.h"
+#include "metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
 #include <time.h>
 #include <sys/stat.h>
-#include <sys/wait.h>
-#include <unistd.h>
-#include <fcntl.h>
 
 /* Forward declarations */
 static bool pg_basebackup_detect(const char *path);
+static bool pg_basebackup_detect_entries(const char *path, const DirSnapshot *entries);
 static BackupInfo* pg_basebackup_scan(const char *backup_root);
 static int pg_basebackup_read_metadata(const char *backup_path, BackupInfo *info);
 static char* pg_basebackup_get_wal_archive_path(const char *backup_path, const char *instance_name);
 static void pg_basebackup_cleanup(BackupInfo *info);
+static bool pg_basebackup_load_details(BackupInfo *info);
 
 /* Helper functions */
-static bool is_tar_format(const char *path);
-static bool is_plain_format(const char *path);
-static int parse_manifest_stream(FILE *fp, BackupInfo *info);
+static bool is_plain_format(const DirSnapshot *entries);
+static bool find_base_tar(const char *path, char *out, size_t outsz);
+static void parse_pg_version(const char *version_str, BackupInfo *info);
+static int parse_manifest(ManifestReader *reader, BackupInfo *info);
 static int parse_backup_manifest(const char *manifest_path, BackupInfo *info);
+static BackupInfo* scan_at_level(const char *backup_path, BackupLoadLevel level);
+static int read_label_metadata(const char *backup_path, BackupInfo *info,
+							   bool with_manifest);
 
 /* Implemented in src/validator/pg_basebackup_validator.c */
 ValidationResult* pg_basebackup_validate_structure(BackupInfo *backup);
 
-/*
- * Shell-free replacement for popen("tar FLAG TARFILE MEMBER", "r").
- * Arguments are passed directly to execvp — no shell, no injection risk.
- * Single-threaded use only (tar_child_pid is a module-level static).
- */
-static pid_t tar_child_pid = -1;
-
-static FILE *
-tar_popen(const char *flag, const char *tar_path, const char *member)
-{
-	int    pipefd[2];
-	pid_t  pid;
-	int    devnull;
-	FILE  *fp;
-
-	if (pipe(pipefd) != 0)
-		return NULL;
+/* Largest tar member read into memory (backup_manifest of a big cluster) */
+#define TAR_METADATA_MAX  (512 * 1024 * 1024)
 
-	pid = fork();
-	if (pid < 0)
-	{
-		close(pipefd[0]);
-		close(pipefd[1]);
-		return NULL;
-	}
-
-	if (pid == 0)
-	{
-		close(pipefd[0]);
-		if (dup2(pipefd[1], STDOUT_FILENO) < 0)
-			_exit(127);
-		close(pipefd[1]);
-		devnull = open("/dev/null", O_WRONLY);
-		if (devnull >= 0)
-		{
-			dup2(devnull, STDERR_FILENO);
-			close(devnull);
-		}
-		execlp("tar", "tar", flag, tar_path, member, (char *)NULL);
-		_exit(127);
-	}
-
-	/* parent */
-	close(pipefd[1]);
-	fp = fdopen(pipefd[0], "r");
-	if (fp == NULL)
-	{
-		close(pipefd[0]);
-		waitpid(pid, NULL, 0);
-		return NULL;
-	}
-	tar_child_pid = pid;
-	return fp;
-}
-
-static void
-tar_pclose(FILE *fp)
-{
-	fclose(fp);
-	if (tar_child_pid > 0)
-	{
-		waitpid(tar_child_pid, NULL, 0);
-		tar_child_pid = -1;
-	}
-}
 WALArchiveInfo*   pg_basebackup_get_embedded_wal(BackupInfo *backup);
 
+/* The directory itself changes when tar files are added or renamed */
+static const char *const pg_basebackup_metadata_files[] = {
+	".", "backup_label", "backup_manifest", "PG_VERSION", "pg_wal", NULL
+};
+
 /* Adapter definition */
 BackupAdapter pg_basebackup_adapter = {
 	.name = "pg_basebackup",
 	.detect = pg_basebackup_detect,
+	.detect_entries = pg_basebackup_detect_entries,
 	.scan = pg_basebackup_scan,
 	.read_metadata = pg_basebackup_read_metadata,
 	.get_wal_archive_path = pg_basebackup_get_wal_archive_path,
 	.validate_structure = pg_basebackup_validate_structure,
 	.get_embedded_wal   = pg_basebackup_get_embedded_wal,
-	.cleanup = pg_basebackup_cleanup
+	.cleanup = pg_basebackup_cleanup,
+	.load_details = pg_basebackup_load_details,
+	.metadata_files = pg_basebackup_metadata_files
 };
 
 /*
- * Helper: Check if path contains tar format backup
- * Looks for any file starting with "base.tar"
+ * Helper: Find the base.tar* archive of a tar format backup.
+ * Writes its full path into out; returns false if there is none.
  */
 static bool
-is_tar_format(const char *path)
+find_base_tar(const char *path, char *out, size_t outsz)
 {
 	DIR *dir;
 	struct dirent *entry;
@@ -144,9 +96,9 @@ is_tar_format(const char *path)
 
 	while ((entry = readdir(dir)) != NULL)
 	{
-		/* Check if filename starts with "base.tar" */
 		if (strncmp(entry->d_name, "base.tar", 8) == 0)
 		{
+			path_join(out, outsz, path, entry->d_name);
 			found = true;
 			break;
 		}
@@ -157,46 +109,69 @@ is_tar_format(const char *path)
 }
 
 /*
- * Helper: Check if path contains plain format backup
+ * Helper: Parse PG_VERSION contents, major.minor format
+ * (e.g., "16.1" -> 160001)
  */
-static bool
-is_plain_format(const char *path)
+static void
+parse_pg_version(const char *version_str, BackupInfo *info)
 {
-	char file_path[PATH_MAX];
-	bool has_base = false;
-	bool has_global = false;
-	bool has_marker = false;
+	int major = 0, minor = 0;
 
-	/* Check for base/ directory */
-	path_join(file_path, sizeof(file_path), path, "base");
-	has_base = is_directory(file_path);
+	if (sscanf(version_str, "%d.%d", &major, &minor) >= 1)
+	{
+		info->pg_version = major * 10000 + minor;
+		log_debug("Read PG_VERSION: major=%d, minor=%d", major, minor);
+	}
+}
 
-	/* Check for global/ directory */
-	path_join(file_path, sizeof(file_path), path, "global");
-	has_global = is_directory(file_path);
+/*
+ * Helper: Check if the entries are those of a plain format backup
+ */
+static bool
+is_plain_format(const DirSnapshot *entries)
+{
+	/* Check for base/ and global/ directories */
+	if (!dir_snapshot_has_dir(entries, "base") ||
+		!dir_snapshot_has_dir(entries, "global"))
+		return false;
 
 	/* Check for backup_label or backup_manifest
 	 * backup_label - traditional marker (all versions)
 	 * backup_manifest - PostgreSQL 13+ with --manifest-checksums
 	 * pg_combinebackup removes backup_label but keeps backup_manifest
 	 */
-	path_join(file_path, sizeof(file_path), path, "backup_label");
-	if (file_exists(file_path))
-		has_marker = true;
+	return dir_snapshot_find(entries, "backup_label") != NULL ||
+		dir_snapshot_find(entries, "backup_manifest") != NULL;
+}
 
-	if (!has_marker)
-	{
-		path_join(file_path, sizeof(file_path), path, "backup_manifest");
-		if (file_exists(file_path))
-			has_marker = true;
-	}
+/*
+ * Helper: Is 'path' a directory of a pg_probackup backup?  Its database/
+ * directory looks like a plain format backup.
+ */
+static bool
+parent_has_backup_control(const char *path)
+{
+	char parent_path[PATH_MAX];
+	char control_path[PATH_MAX];
+	const char *last_slash;
+	size_t parent_len;
 
-	/* Valid plain format needs base/, global/, and at least one marker */
-	return (has_base && has_global && has_marker);
+	last_slash = strrchr(path, '/');
+	if (last_slash == NULL || last_slash == path)
+		return false;
+
+	parent_len = last_slash - path;
+	if (parent_len >= sizeof(parent_path))
+		return false;
+	memcpy(parent_path, path, parent_len);
+	parent_path[parent_len] = '\0';
+
+	path_join(control_path, sizeof(control_path), parent_path, "backup.control");
+	return file_exists(control_path);
 }
 
 /*
- * Detect if path contains a pg_basebackup backup
+ * Detect if the entries of 'path' are those of a pg_basebackup backup
  *
  * Supports:
  * - Plain format (directory with backup_label/backup_manifest, base/, global/)
@@ -204,53 +179,40 @@ is_plain_format(const char *path)
  * - pg_combinebackup output (PostgreSQL 17+)
  */
 static bool
-pg_basebackup_detect(const char *path)
+pg_basebackup_detect_entries(const char *path, const DirSnapshot *entries)
 {
-	char parent_path[PATH_MAX];
-	char control_path[PATH_MAX];
-	const char *last_slash;
+	bool tar;
 
-	/* First check if path exists and is a directory */
-	if (!is_directory(path))
+	/* Tar format must have a file starting with base.tar */
+	tar = dir_snapshot_find_prefix(entries, "base.tar") != NULL;
+	if (!tar && !is_plain_format(entries))
 		return false;
 
 	/*
 	 * Skip detection if parent directory contains backup.control
 	 * This prevents detecting pg_probackup's database/ subdirectory as pg_basebackup
 	 */
-	last_slash = strrchr(path, '/');
-	if (last_slash != NULL && last_slash != path)
+	if (parent_has_backup_control(path))
 	{
-		size_t parent_len = last_slash - path;
-		if (parent_len < sizeof(parent_path))
-		{
-			memcpy(parent_path, path, parent_len);
-			parent_path[parent_len] = '\0';
-
-			path_join(control_path, sizeof(control_path), parent_path, "backup.control");
-			if (file_exists(control_path))
-			{
-				log_debug("Skipping %s - parent has backup.control (pg_probackup backup)", path);
-				return false;
-			}
-		}
+		log_debug("Skipping %s - parent has backup.control (pg_probackup backup)", path);
+		return false;
 	}
 
-	/* Check for tar format - must have file starting with base.tar */
-	if (is_tar_format(path))
-	{
-		log_debug("Detected pg_basebackup tar format at: %s", path);
-		return true;
-	}
+	log_debug("Detected pg_basebackup %s format at: %s", tar ? "tar" : "plain", path);
+	return true;
+}
 
-	/* Check for plain format */
-	if (is_plain_format(path))
-	{
-		log_debug("Detected pg_basebackup plain format at: %s", path);
-		return true;
-	}
+static bool
+pg_basebackup_detect(const char *path)
+{
+	DirSnapshot entries;
+	bool		detected;
 
-	return false;
+	if (!dir_snapshot_read(path, &entries))
+		return false;
+	detected = pg_basebackup_detect_entries(path, &entries);
+	dir_snapshot_free(&entries);
+	return detected;
 }
 
 /*
@@ -261,6 +223,39 @@ pg_basebackup_detect(const char *path)
  */
 static BackupInfo*
 pg_basebackup_scan(const char *backup_path)
+{
+	return scan_at_level(backup_path, scan_get_load_level());
+}
+
+/*
+ * Read the rest of a backup scanned at BACKUP_LOAD_IDENTITY.  backup_label
+ * is read again along with everything else; it is a few hundred bytes.
+ */
+static bool
+pg_basebackup_load_details(BackupInfo *info)
+{
+	BackupInfo *full = scan_at_level(info->backup_path, BACKUP_LOAD_FULL);
+
+	if (full == NULL)
+		return false;
+
+	/* Keep what the scanner derived from the rest of the list */
+	if (full->parent_backup_id[0] == '\0')
+		str_copy(full->parent_backup_id, info->parent_backup_id,
+				 sizeof(full->parent_backup_id));
+	full->next = info->next;
+	*info = *full;
+	free(full);
+	return true;
+}
+
+/*
+ * Scan one backup.  BACKUP_LOAD_IDENTITY reads backup_label only (the
+ * first member of base.tar for tar backups): no backup_manifest, sizes
+ * or PG_VERSION.
+ */
+static BackupInfo*
+scan_at_level(const char *backup_path, BackupLoadLevel level)
 {
 	BackupInfo *info;
 	const char *dir_name;
@@ -294,16 +289,26 @@ pg_basebackup_scan(const char *backup_path)
 	/* Read metadata to populate remaining fields
 	 * This will update backup_id to timestamp format, node_name, timestamps, LSNs, etc.
 	 */
-	if (pg_basebackup_read_metadata(backup_path, info) != STATUS_OK)
+	if (read_label_metadata(backup_path, info, level == BACKUP_LOAD_FULL) != STATUS_OK)
 	{
 		log_debug("Failed to parse backup metadata at: %s", backup_path);
 		info->status = BACKUP_STATUS_ERROR;
 		/* Don't return NULL - we still want to show the backup with ERROR status */
 	}
 
-	/* Calculate backup size */
-	info->data_bytes = get_directory_size(backup_path);
-	log_debug("Backup size: %llu bytes", (unsigned long long)info->data_bytes);
+	if (level == BACKUP_LOAD_IDENTITY)
+	{
+		struct stat st;
+
+		if (stat(backup_path, &st) == 0)
+			info->end_time = st.st_mtime;
+		info->partial = true;
+		return info;
+	}
+
+	/* Total of the manifest's file sizes, if read_metadata found one */
+	uint64_t manifest_bytes = info->data_bytes;
+	info->data_bytes = 0;
 
 	/* Calculate WAL size if present */
 	char wal_path[PATH_MAX];
@@ -348,6 +353,32 @@ pg_basebackup_scan(const char *backup_path)
 	snprintf(info->wal_mode, sizeof(info->wal_mode), "%s",
 			 info->wal_stream ? "embedded" : "none");
 
+	/*
+	 * Calculate backup size.  A plain backup holds the files its manifest
+	 * lists, the manifest itself and pg_wal/, so there is no need to stat
+	 * the whole data directory.  Tar backups are a handful of archives
+	 * whose on-disk size is what counts; listing them is cheap.
+	 */
+	{
+		char		base_path[PATH_MAX];
+		char		manifest_path[PATH_MAX];
+		struct stat mst;
+		uint64_t	metadata_bytes = 0;
+
+		path_join(base_path, sizeof(base_path), backup_path, "base");
+		path_join(manifest_path, sizeof(manifest_path), backup_path, "backup_manifest");
+		if (manifest_bytes > 0 && is_directory(base_path) &&
+			stat(manifest_path, &mst) == 0)
+			metadata_bytes = manifest_bytes + (uint64_t) mst.st_size + info->wal_bytes;
+
+		info->data_bytes = is_directory(base_path)
+			? scan_resolve_size(backup_path, metadata_bytes)
+			: get_directory_size(backup_path);
+		log_debug("Backup size: %llu bytes%s", (unsigned long long)info->data_bytes,
+				  metadata_bytes > 0 && info->data_bytes == metadata_bytes
+				  ? " (from backup_manifest)" : "");
+	}
+
 	/* end_time fallback: directory mtime (overridden by manifest mtime below) */
 	{
 		struct stat st;
@@ -355,74 +386,21 @@ pg_basebackup_scan(const char *backup_path)
 			info->end_time = st.st_mtime;
 	}
 
-	/* Try to read PG_VERSION file from plain format */
-	char version_path[PATH_MAX];
-	path_join(version_path, sizeof(version_path), backup_path, "PG_VERSION");
-
-	FILE *ver_fp = fopen(version_path, "r");
-	if (ver_fp != NULL)
+	/* Read PG_VERSION file from plain format; for tar format it was
+	 * extracted together with backup_label by read_metadata */
+	if (info->pg_version == 0)
 	{
-		char version_str[32];
-		if (fgets(version_str, sizeof(version_str), ver_fp) != NULL)
-		{
-			/* Parse major.minor format (e.g., "16.1" -> 160001) */
-			int major = 0, minor = 0;
-			if (sscanf(version_str, "%d.%d", &major, &minor) >= 1)
-			{
-				info->pg_version = major * 10000 + minor;
-				log_debug("Read PG_VERSION from file: major=%d, minor=%d", major, minor);
-			}
-		}
-		fclose(ver_fp);
-	}
-	else
-	{
-		/* Try to extract PG_VERSION from tar archive */
-		DIR *tar_dir;
-		struct dirent *tar_entry;
+		char version_path[PATH_MAX];
+		path_join(version_path, sizeof(version_path), backup_path, "PG_VERSION");
 
-		tar_dir = opendir(backup_path);
-		if (tar_dir != NULL)
+		FILE *ver_fp = fopen(version_path, "r");
+		if (ver_fp != NULL)
 		{
-			while ((tar_entry = readdir(tar_dir)) != NULL)
-			{
-				if (strncmp(tar_entry->d_name, "base.tar", 8) == 0)
-				{
-					char tar_file[PATH_MAX];
-					const char *flag;
-
-					path_join(tar_file, sizeof(tar_file), backup_path, tar_entry->d_name);
-
-					if (strstr(tar_entry->d_name, ".gz") != NULL)
-						flag = "-xzOf";
-					else if (strstr(tar_entry->d_name, ".bz2") != NULL)
-						flag = "-xjOf";
-					else if (strstr(tar_entry->d_name, ".xz") != NULL ||
-							 strstr(tar_entry->d_name, ".lz4") != NULL)
-						flag = "-xJOf";
-					else
-						flag = "-xOf";
-
-					ver_fp = tar_popen(flag, tar_file, "PG_VERSION");
-					if (ver_fp != NULL)
-					{
-						char version_str[32];
-						if (fgets(version_str, sizeof(version_str), ver_fp) != NULL)
-						{
-							/* Parse major.minor format (e.g., "16.1" -> 160001) */
-							int major = 0, minor = 0;
-							if (sscanf(version_str, "%d.%d", &major, &minor) >= 1)
-							{
-								info->pg_version = major * 10000 + minor;
-								log_debug("Extracted PG_VERSION from tar: major=%d, minor=%d", major, minor);
-							}
-						}
-						tar_pclose(ver_fp);
-					}
-					break;
-				}
-			}
-			closedir(tar_dir);
+			char version_str[32];
+			if (fgets(version_str, sizeof(version_str), ver_fp) != NULL)
+				parse_pg_version(version_str, info);
+			metrics_io_stream(ver_fp);
+			fclose(ver_fp);
 		}
 	}
 
@@ -438,21 +416,45 @@ pg_basebackup_scan(const char *backup_path)
  */
 static int
 pg_basebackup_read_metadata(const char *backup_path, BackupInfo *info)
+{
+	return read_label_metadata(backup_path, info, true);
+}
+
+/*
+ * Without 'with_manifest' only backup_label is read: backup_manifest is
+ * left alone unless there is no backup_label (pg_combinebackup output).
+ */
+static int
+read_label_metadata(const char *backup_path, BackupInfo *info, bool with_manifest)
 {
 	char label_path[PATH_MAX];
 	char tar_path[PATH_MAX];
-	const char *tar_flag = NULL;
+	char sidecar_manifest[PATH_MAX];
 	FILE *fp = NULL;
 	char line[1024];
 	bool found_start_time = false;
 	bool is_incremental = false;  /* Detect incremental backups */
 	bool is_tar = false;
 	struct tm tm_time = {0};
-	DIR *dir;
-	struct dirent *entry;
+	/*
+	 * Members pulled out of base.tar* in one pass.  backup_label is the
+	 * first member pg_basebackup writes and PG_VERSION sits at the top of
+	 * the data directory, so the reader usually stops after a few headers.
+	 * backup_manifest is only inside the tar when it was written to
+	 * stdout (-D -); it goes at the very end, so it is asked for only
+	 * when there is no backup_manifest file next to the archive.
+	 */
+	TarWanted tar_members[] = {
+		{ .name = "backup_label" },
+		{ .name = "PG_VERSION" },
+		{ .name = "backup_manifest" },
+	};
+	int ntar_members = 3;
 
 	/* Build path to backup_label (plain format) */
 	path_join(label_path, sizeof(label_path), backup_path, "backup_label");
+	path_join(sidecar_manifest, sizeof(sidecar_manifest),
+			  backup_path, "backup_manifest");
 
 	/* Try to open backup_label as regular file (plain format) */
 	fp = fopen(label_path, "r");
@@ -460,39 +462,32 @@ pg_basebackup_read_metadata(const char *backup_path, BackupInfo *info)
 	if (fp == NULL)
 	{
 		/* backup_label not found as file, check if this is tar format */
-		dir = opendir(backup_path);
-		if (dir != NULL)
+		if (find_base_tar(backup_path, tar_path, sizeof(tar_path)))
 		{
-			while ((entry = readdir(dir)) != NULL)
+			if (!with_manifest)
+				ntar_members = 1;
+			else if (file_exists(sidecar_manifest))
+				ntar_members = 2;
+
+			log_debug("Extracting backup_label from tar: %s", tar_path);
+			if (tar_extract_members(tar_path, tar_members, ntar_members,
+									TAR_METADATA_MAX) >= 0)
 			{
-				/* Find file starting with "base.tar" */
-				if (strncmp(entry->d_name, "base.tar", 8) == 0)
-				{
-					/* Found tar archive, extract backup_label */
-					path_join(tar_path, sizeof(tar_path), backup_path, entry->d_name);
-
-					/* Determine tar flag based on compression */
-					if (strstr(entry->d_name, ".gz") != NULL)
-						tar_flag = "-xzOf";
-					else if (strstr(entry->d_name, ".bz2") != NULL)
-						tar_flag = "-xjOf";
-					else if (strstr(entry->d_name, ".xz") != NULL ||
-							 strstr(entry->d_name, ".lz4") != NULL)
-						tar_flag = "-xJOf";
-					else
-						tar_flag = "-xOf";
-
-					log_debug("Extracting backup_label from tar: %s", entry->d_name);
-					fp = tar_popen(tar_flag, tar_path, "backup_label");
-					is_tar = true;
-					break;
-				}
+				is_tar = true;
+
+				if (tar_members[1].data != NULL)
+					parse_pg_version(tar_members[1].data, info);
+
+				if (tar_members[0].data != NULL && tar_members[0].size > 0)
+					fp = fmemopen(tar_members[0].data, tar_members[0].size, "r");
 			}
-			closedir(dir);
 		}
 
 		if (fp == NULL)
 		{
+			for (int i = 0; i < ntar_members; i++)
+				free(tar_members[i].data);
+
 			/* backup_label not found, try backup_manifest (pg_combinebackup) */
 			log_debug("backup_label not found, trying backup_manifest");
 
@@ -648,15 +643,15 @@ pg_basebackup_read_metadata(const char *backup_path, BackupInfo *info)
 		}
 	}
 
-	/* Close file handle (use tar_pclose for tar, fclose for plain) */
-	if (is_tar)
-		tar_pclose(fp);
-	else
-		fclose(fp);
+	metrics_io_stream(fp);
+	fclose(fp);
+	free(tar_members[0].data);
+	free(tar_members[1].data);
 
 	if (!found_start_time)
 	{
 		log_debug("START TIME not found in backup_label");
+		free(tar_members[2].data);
 		return STATUS_ERROR;
 	}
 
@@ -683,30 +678,28 @@ pg_basebackup_read_metadata(const char *backup_path, BackupInfo *info)
 	 * Supplemental read from backup_manifest:
 	 * - stop_lsn (End-LSN) is not present in backup_label; backup_manifest
 	 *   is the only source of the real stop LSN for pg_basebackup backups.
-	 * - For plain format: read directly from the file; also get end_time from mtime.
-	 * - For tar format: extract backup_manifest from the same archive via tar_popen.
+	 * - For plain format, and tar format written to a directory, it is a
+	 *   file next to the data; also get end_time from mtime.
+	 * - For tar format written to stdout it was extracted from the archive
+	 *   in the same pass as backup_label.
 	 */
-	if (!is_tar)
+	if (tar_members[2].data != NULL)
 	{
-		char manifest_path[PATH_MAX];
-		path_join(manifest_path, sizeof(manifest_path),
-				  backup_path, "backup_manifest");
-		if (file_exists(manifest_path))
-			parse_backup_manifest(manifest_path, info);
-	}
-	else if (tar_flag != NULL && tar_path[0] != '\0')
-	{
-		FILE *mfp = tar_popen(tar_flag, tar_path, "backup_manifest");
-		if (mfp != NULL)
-		{
-			parse_manifest_stream(mfp, info);
-			tar_pclose(mfp);
-			log_debug("Extracted backup_manifest from tar: stop_lsn=%llX",
-					  (unsigned long long)info->stop_lsn);
-		}
-		else
-			log_debug("backup_manifest not found in tar archive (PG12 or earlier)");
+		ManifestReader reader;
+
+		manifest_reader_init(&reader, tar_members[2].data, tar_members[2].size, false);
+		parse_manifest(&reader, info);
+		manifest_reader_close(&reader);
+		log_debug("Extracted backup_manifest from tar: stop_lsn=%llX",
+				  (unsigned long long)info->stop_lsn);
+		free(tar_members[2].data);
 	}
+	else if (!with_manifest)
+		log_debug("backup_manifest left for backup_info_load()");
+	else if (file_exists(sidecar_manifest))
+		parse_backup_manifest(sidecar_manifest, info);
+	else if (is_tar)
+		log_debug("backup_manifest not found in tar archive (PG12 or earlier)");
 
 	/* Try to extract node name from directory name
 	 * Example: "backup_shard1_20240108" -> "shard1"
@@ -786,39 +779,6 @@ pg_basebackup_get_wal_archive_path(const char *backup_path, const char *instance
 	return NULL;
 }
 
-/*
- * parse_lsn_str — parse "X/XXXXXX" into uint64_t.
- * Returns true on success.
- */
-static bool
-parse_lsn_str(const char *str, uint64_t *out)
-{
-	unsigned int hi, lo;
-	if (sscanf(str, "%X/%X", &hi, &lo) == 2)
-	{
-		*out = ((uint64_t)hi << 32) | lo;
-		return true;
-	}
-	return false;
-}
-
-/*
- * parse_quoted_lsn — find the first quoted string following `key` on `line`
- * and parse it as an LSN.  Returns true on success.
- */
-static bool
-parse_quoted_lsn(const char *line, const char *key, uint64_t *out)
-{
-	const char *p = strstr(line, key);
-	if (p == NULL)
-		return false;
-	p += strlen(key);
-	p = strchr(p, '"');
-	if (p == NULL) return false;
-	p++;
-	return parse_lsn_str(p, out);
-}
-
 /*
  * parse_backup_manifest — read backup_manifest for metadata.
  *
@@ -834,81 +794,57 @@ parse_quoted_lsn(const char *line, const char *key, uint64_t *out)
  *   true  — only updates stop_lsn and end_time (leaves other fields alone)
  */
 /*
- * parse_manifest_stream — read backup_manifest metadata from an open FILE*.
- * Used by both parse_backup_manifest (plain file) and tar extraction.
- * Does NOT fclose(fp) — caller is responsible.
+ * parse_manifest — read backup_manifest metadata with a manifest reader.
+ * Used by both parse_backup_manifest (mapped file) and tar extraction.
+ * Does NOT close the reader — caller is responsible.
  * Does NOT set end_time (no path for mtime) — caller sets it if needed.
  */
 static int
-parse_manifest_stream(FILE *fp, BackupInfo *info)
+parse_manifest(ManifestReader *reader, BackupInfo *info)
 {
-	char   line[2048];
-	bool   found_timeline = false;
-	bool   found_start_lsn = false;
-	bool   found_end_lsn = false;
+	ManifestFileEntry entry;
+	uint64_t file_bytes = 0;
 	time_t now;
+	int    rc;
 
-	while (fgets(line, sizeof(line), fp) != NULL)
-	{
-		/* "Timeline": <number> */
-		if (!found_timeline && strstr(line, "\"Timeline\"") != NULL)
-		{
-			const char *p = strstr(line, "\"Timeline\"");
-			p = strchr(p, ':');
-			if (p != NULL)
-			{
-				info->timeline = (TimeLineID)atoi(p + 1);
-				found_timeline = true;
-			}
-		}
-
-		/* "Start-LSN": "X/X" — only if not yet set */
-		if (!found_start_lsn && strstr(line, "\"Start-LSN\"") != NULL)
-		{
-			uint64_t lsn = 0;
-			if (parse_quoted_lsn(line, "\"Start-LSN\"", &lsn))
-			{
-				if (info->start_lsn == 0)
-					info->start_lsn = lsn;
-				found_start_lsn = true;
-			}
-		}
-
-		/* "End-LSN": "X/X" — always update stop_lsn (more accurate) */
-		if (!found_end_lsn && strstr(line, "\"End-LSN\"") != NULL)
-		{
-			uint64_t lsn = 0;
-			if (parse_quoted_lsn(line, "\"End-LSN\"", &lsn))
-			{
-				info->stop_lsn = lsn;
-				found_end_lsn = true;
-			}
-		}
-
-		/* Stop once we've found all three fields */
-		if (found_timeline && found_start_lsn && found_end_lsn)
-			break;
-	}
+	/* "Size" of every file entry, for data_bytes */
+	while ((rc = manifest_reader_next(reader, &entry)) > 0)
+		file_bytes += entry.size;
+	if (rc < 0)
+		log_debug("backup_manifest is malformed at byte %zu", reader->pos);
 
-	if (!found_timeline && !found_start_lsn)
+	if (!reader->has_wal_range)
 	{
 		log_warning("backup_manifest does not contain Timeline or Start-LSN");
 		return STATUS_ERROR;
 	}
 
+	info->timeline = reader->timeline;
+	if (info->start_lsn == 0)
+		info->start_lsn = reader->start_lsn;
+	/* End-LSN is more accurate than backup_label's STOP (there is none) */
+	if (reader->end_lsn != 0)
+		info->stop_lsn = reader->end_lsn;
+
+
+	/* Files come before WAL-Ranges, so all of them have been counted */
+	info->data_bytes = file_bytes;
+
 	/* For pg_combinebackup (no backup_label): generate synthetic backup_id */
 	if (info->start_time == 0)
 	{
+		struct tm tm_now;
+
 		now = time(NULL);
-		struct tm *tm_now = localtime(&now);
+		localtime_r(&now, &tm_now);	/* scans run on several threads */
 		snprintf(info->backup_id, sizeof(info->backup_id),
 				 "%04d%02d%02d-%02d%02d%02d",
-				 tm_now->tm_year + 1900,
-				 tm_now->tm_mon + 1,
-				 tm_now->tm_mday,
-				 tm_now->tm_hour,
-				 tm_now->tm_min,
-				 tm_now->tm_sec);
+				 tm_now.tm_year + 1900,
+				 tm_now.tm_mon + 1,
+				 tm_now.tm_mday,
+				 tm_now.tm_hour,
+				 tm_now.tm_min,
+				 tm_now.tm_sec);
 		info->start_time = now;
 	}
 
@@ -923,19 +859,18 @@ parse_manifest_stream(FILE *fp, BackupInfo *info)
 static int
 parse_backup_manifest(const char *manifest_path, BackupInfo *info)
 {
-	FILE       *fp;
-	int         rc;
-	struct stat mst;
+	ManifestReader reader;
+	int            rc;
+	struct stat    mst;
 
-	fp = fopen(manifest_path, "r");
-	if (fp == NULL)
+	if (!manifest_reader_open(&reader, manifest_path, false))
 	{
 		log_debug("backup_manifest not found: %s", manifest_path);
 		return STATUS_ERROR;
 	}
 
-	rc = parse_manifest_stream(fp, info);
-	fclose(fp);
+	rc = parse_manifest(&reader, info);
+	manifest_reader_close(&reader);
 
 	if (rc == STATUS_OK)
 	{
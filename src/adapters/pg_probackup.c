@@ -22,6 +22,7 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "pg_backup_auditor.h"
+#include "metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +30,7 @@
 
 /* Forward declarations */
 static bool pg_probackup_detect(const char *path);
+static bool pg_probackup_detect_entries(const char *path, const DirSnapshot *entries);
 static BackupInfo* pg_probackup_scan(const char *backup_root);
 static int pg_probackup_read_metadata(const char *backup_path, BackupInfo *info);
 static char* pg_probackup_get_wal_archive_path(const char *backup_path, const char *instance_name);
@@ -38,16 +40,23 @@ static void pg_probackup_cleanup(BackupInfo *info);
 ValidationResult* pg_probackup_validate_structure(BackupInfo *backup);
 WALArchiveInfo*   pg_probackup_get_embedded_wal(BackupInfo *backup);
 
+static const char *const pg_probackup_metadata_files[] = {
+	".", "backup.control", "database/backup_label", NULL
+};
+
 /* Adapter definition */
 BackupAdapter pg_probackup_adapter = {
 	.name = "pg_probackup",
 	.detect = pg_probackup_detect,
+	.detect_entries = pg_probackup_detect_entries,
 	.scan = pg_probackup_scan,
 	.read_metadata = pg_probackup_read_metadata,
 	.get_wal_archive_path = pg_probackup_get_wal_archive_path,
 	.validate_structure = pg_probackup_validate_structure,
 	.get_embedded_wal   = pg_probackup_get_embedded_wal,
-	.cleanup = pg_probackup_cleanup
+	.cleanup = pg_probackup_cleanup,
+	.load_details = NULL,	/* backup.control has it all */
+	.metadata_files = pg_probackup_metadata_files
 };
 
 /*
@@ -86,6 +95,17 @@ pg_probackup_detect(const char *path)
 	return false;
 }
 
+static bool
+pg_probackup_detect_entries(const char *path, const DirSnapshot *entries)
+{
+	if (dir_snapshot_find(entries, "backup.control") == NULL ||
+		!dir_snapshot_has_dir(entries, "database"))
+		return false;
+
+	log_debug("Detected pg_probackup 2.5.X format at: %s", path);
+	return true;
+}
+
 /*
  * Scan a single pg_probackup backup directory
  *
@@ -468,6 +488,7 @@ pg_probackup_read_metadata(const char *backup_path, BackupInfo *info)
 		}
 	}
 
+	metrics_io_stream(fp);
 	fclose(fp);
 
 	/*
@@ -503,6 +524,7 @@ pg_probackup_read_metadata(const char *backup_path, BackupInfo *info)
 					break;
 				}
 			}
+			metrics_io_stream(blf);
 			fclose(blf);
 			if (info->redo_lsn != 0)
 				log_debug("Parsed redo_lsn from backup_label: %X/%X",
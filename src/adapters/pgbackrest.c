@@ -23,6 +23,7 @@
 
 #include "pgbackrest.h"
 #include "pg_backup_auditor.h"
+#include "json_scan.h"
 #include "ini_parser.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,57 +33,31 @@
 #include <ctype.h>
 #include <inttypes.h>
 
-/*
- * Extract JSON value from a JSON string into a caller-supplied buffer.
- * Returns true on success, false if the key is not found or inputs are NULL.
- */
-static bool
-get_json_value(const char *json, const char *key, char *buf, size_t bufsize)
-{
-	char search_key[128];
-	const char *start, *end;
-	size_t len;
-
-	if (json == NULL || key == NULL || buf == NULL || bufsize == 0)
-		return false;
-
-	/* Build search pattern: "key": */
-	snprintf(search_key, sizeof(search_key), "\"%s\":", key);
-
-	start = strstr(json, search_key);
-	if (start == NULL)
-		return false;
-
-	/* Skip to value */
-	start += strlen(search_key);
-	while (*start && isspace((unsigned char)*start))
-		start++;
-
-	/* Handle string values (quoted) */
-	if (*start == '"')
-	{
-		start++;
-		end = strchr(start, '"');
-		if (end == NULL)
-			return false;
-	}
-	/* Handle numeric/boolean values */
-	else
-	{
-		end = start;
-		while (*end && *end != ',' && *end != '}' && !isspace((unsigned char)*end))
-			end++;
-	}
-
-	len = end - start;
-	if (len >= bufsize)
-		len = bufsize - 1;
-
-	memcpy(buf, start, len);
-	buf[len] = '\0';
+static bool pgbackrest_load_details(BackupInfo *info);
+
+/* Fields of a [backup:current] entry of backup.info, read in one pass */
+enum {
+	INFO_TYPE,
+	INFO_TIMESTAMP_START,
+	INFO_TIMESTAMP_STOP,
+	INFO_LSN_START,
+	INFO_LSN_STOP,
+	INFO_PRIOR,
+	INFO_REPO_SIZE,
+	INFO_SIZE,
+	INFO_NFIELDS
+};
 
-	return true;
-}
+static const char *const info_fields[INFO_NFIELDS] = {
+	"backup-type",
+	"backup-timestamp-start",
+	"backup-timestamp-stop",
+	"backup-lsn-start",
+	"backup-lsn-stop",
+	"backup-prior",
+	"backup-info-repo-size",
+	"backup-info-size"
+};
 
 /*
  * Detect if path is a pgBackRest repository
@@ -110,93 +85,156 @@ is_pgbackrest_repo(const char *path)
 	return true;
 }
 
-/*
- * Parse backup.manifest file for individual backup details
- */
-bool
-parse_pgbackrest_manifest(BackupInfo *info, const char *manifest_path)
+/* Keys of backup.manifest that describe the backup */
+enum {
+	MF_LABEL,
+	MF_TYPE,
+	MF_TIMESTAMP_START,
+	MF_TIMESTAMP_STOP,
+	MF_LSN_START,
+	MF_LSN_STOP,
+	MF_ARCHIVE_START,
+	MF_COMPRESS_TYPE,
+	MF_SIZE,
+	MF_DB_VERSION,
+	MF_NFIELDS
+};
+
+static const struct {
+	const char *section;
+	const char *key;
+} manifest_fields[MF_NFIELDS] = {
+	{ "backup",    "backup-label" },
+	{ "backup",    "backup-type" },
+	{ "backup",    "backup-timestamp-start" },
+	{ "backup",    "backup-timestamp-stop" },
+	{ "backup",    "backup-lsn-start" },
+	{ "backup",    "backup-lsn-stop" },
+	{ "backup",    "backup-archive-start" },
+	{ "backup",    "backup-compress-type" },
+	{ "backup",    "backup-size" },
+	{ "backup:db", "db-version" },
+};
+
+/* Where the manifest pass puts the values; the first occurrence wins */
+typedef struct {
+	BackupInfo *info;
+	unsigned    seen;           /* bit per MF_* field */
+} ManifestDetails;
+
+static void
+apply_manifest_field(BackupInfo *info, int field, const char *value)
 {
-	IniFile *ini;
-	const char *value;
+	switch (field)
+	{
+		case MF_LABEL:
+			if (info->backup_id[0] == '\0')
+				strncpy(info->backup_id, value, sizeof(info->backup_id) - 1);
+			break;
 
-	if (info == NULL || manifest_path == NULL)
-		return false;
+		case MF_TYPE:
+			if (strcmp(value, "full") == 0)
+				info->type = BACKUP_TYPE_FULL;
+			else if (strcmp(value, "incr") == 0)
+				info->type = BACKUP_TYPE_INCREMENTAL;
+			else if (strcmp(value, "diff") == 0)
+				info->type = BACKUP_TYPE_DELTA;
+			break;
 
-	ini = ini_parse_file(manifest_path);
-	if (ini == NULL)
-		return false;
+		case MF_TIMESTAMP_START:
+			info->start_time = (time_t)atoll(value);
+			break;
 
-	/* Parse [backup] section */
-	value = ini_get_value(ini, "backup", "backup-label");
-	if (value != NULL && info->backup_id[0] == '\0')
-		strncpy(info->backup_id, value, sizeof(info->backup_id) - 1);
+		case MF_TIMESTAMP_STOP:
+			info->end_time = (time_t)atoll(value);
+			break;
 
-	value = ini_get_value(ini, "backup", "backup-type");
-	if (value != NULL)
-	{
-		if (strcmp(value, "full") == 0)
-			info->type = BACKUP_TYPE_FULL;
-		else if (strcmp(value, "incr") == 0)
-			info->type = BACKUP_TYPE_INCREMENTAL;
-		else if (strcmp(value, "diff") == 0)
-			info->type = BACKUP_TYPE_DELTA;
-	}
+		case MF_LSN_START:
+			parse_lsn(value, &info->start_lsn);
+			break;
 
-	value = ini_get_value(ini, "backup", "backup-timestamp-start");
-	if (value != NULL)
-		info->start_time = (time_t)atoll(value);
+		case MF_LSN_STOP:
+			parse_lsn(value, &info->stop_lsn);
+			break;
 
-	value = ini_get_value(ini, "backup", "backup-timestamp-stop");
-	if (value != NULL)
-		info->end_time = (time_t)atoll(value);
+		case MF_ARCHIVE_START:
+			/*
+			 * Timeline: stored in the first 8 hex chars of backup-archive-start,
+			 * e.g. "000000010000000000000006" → timeline 1.
+			 */
+			if (strlen(value) >= 8)
+			{
+				char tl_str[9];
+				memcpy(tl_str, value, 8);
+				tl_str[8] = '\0';
+				info->timeline = (TimeLineID)strtoul(tl_str, NULL, 16);
+			}
+			break;
 
-	value = ini_get_value(ini, "backup", "backup-lsn-start");
-	if (value != NULL)
-		parse_lsn(value, &info->start_lsn);
+		case MF_COMPRESS_TYPE:
+			snprintf(info->compress_alg, sizeof(info->compress_alg), "%s", value);
+			break;
 
-	value = ini_get_value(ini, "backup", "backup-lsn-stop");
-	if (value != NULL)
-		parse_lsn(value, &info->stop_lsn);
+		case MF_SIZE:
+			/* backup-size: not always present in pgBackRest manifests.
+			 * Only overwrite if the field exists and is non-zero. */
+			{
+				uint64_t sz = (uint64_t)atoll(value);
+				if (sz > 0)
+					info->data_bytes = sz;
+			}
+			break;
+
+		case MF_DB_VERSION:
+			{
+				int major = 0;
+				sscanf(value, "%d", &major);
+				info->pg_version = major * 10000;
+			}
+			break;
+	}
+}
+
+static bool
+manifest_details_entry(IniSlice section, IniSlice key, IniSlice value, void *arg)
+{
+	ManifestDetails *details = arg;
 
 	/*
-	 * Timeline: stored in the first 8 hex chars of backup-archive-start,
-	 * e.g. "000000010000000000000006" → timeline 1.
+	 * [backup] and [backup:db] sort before the per-file [target:*]
+	 * sections, which are nearly all of a large manifest; stop there.
 	 */
-	value = ini_get_value(ini, "backup", "backup-archive-start");
-	if (value != NULL && strlen(value) >= 8)
-	{
-		char tl_str[9];
-		memcpy(tl_str, value, 8);
-		tl_str[8] = '\0';
-		info->timeline = (TimeLineID)strtoul(tl_str, NULL, 16);
-	}
+	if (section.len >= 7 && strncmp(section.ptr, "target:", 7) == 0)
+		return false;
 
-	/* Parse [backup:db] section for version info */
-	value = ini_get_value(ini, "backup:db", "db-version");
-	if (value != NULL)
+	for (int i = 0; i < MF_NFIELDS; i++)
 	{
-		int major = 0;
-		sscanf(value, "%d", &major);
-		info->pg_version = major * 10000;
+		if ((details->seen & (1u << i)) == 0 &&
+			ini_slice_eq(key, manifest_fields[i].key) &&
+			ini_slice_eq(section, manifest_fields[i].section))
+		{
+			details->seen |= 1u << i;
+			apply_manifest_field(details->info, i, value.ptr);
+			break;
+		}
 	}
+	return true;
+}
 
-	/* Compression algorithm */
-	value = ini_get_value(ini, "backup", "backup-compress-type");
-	if (value != NULL)
-		snprintf(info->compress_alg, sizeof(info->compress_alg), "%s", value);
+/*
+ * Parse backup.manifest file for individual backup details
+ */
+bool
+parse_pgbackrest_manifest(BackupInfo *info, const char *manifest_path)
+{
+	ManifestDetails details;
 
-	/* backup-size: not always present in pgBackRest manifests.
-	 * Only overwrite if the field exists and is non-zero. */
-	value = ini_get_value(ini, "backup", "backup-size");
-	if (value != NULL)
-	{
-		uint64_t sz = (uint64_t)atoll(value);
-		if (sz > 0)
-			info->data_bytes = sz;
-	}
+	if (info == NULL || manifest_path == NULL)
+		return false;
 
-	ini_free(ini);
-	return true;
+	details.info = info;
+	details.seen = 0;
+	return ini_parse_stream(manifest_path, manifest_details_entry, &details);
 }
 
 /*
@@ -248,7 +286,6 @@ parse_pgbackrest_backup_info(const char *backup_info_path, const char *stanza_na
 	for (kv = section->first_kv; kv != NULL; kv = kv->next)
 	{
 		BackupInfo *info;
-		char manifest_path[PATH_MAX];
 		char *backup_dir;
 
 		/* Allocate new backup info */
@@ -275,37 +312,39 @@ parse_pgbackrest_backup_info(const char *backup_info_path, const char *stanza_na
 		/* Parse JSON value for backup metadata */
 		json_value = kv->value;
 
-		char val[256];
+		JsonSlice v[INFO_NFIELDS];
+		char      val[256];
+		uint64_t  num;
+
+		if (!json_get_fields(json_value, info_fields, INFO_NFIELDS, v))
+			log_debug("Malformed backup.info entry for %s", kv->key);
 
 		/* Extract backup type */
-		if (get_json_value(json_value, "backup-type", val, sizeof(val)))
-		{
-			if (strcmp(val, "full") == 0)
-				info->type = BACKUP_TYPE_FULL;
-			else if (strcmp(val, "incr") == 0)
-				info->type = BACKUP_TYPE_INCREMENTAL;
-			else if (strcmp(val, "diff") == 0)
-				info->type = BACKUP_TYPE_DELTA;
-		}
+		if (json_slice_eq(v[INFO_TYPE], "full"))
+			info->type = BACKUP_TYPE_FULL;
+		else if (json_slice_eq(v[INFO_TYPE], "incr"))
+			info->type = BACKUP_TYPE_INCREMENTAL;
+		else if (json_slice_eq(v[INFO_TYPE], "diff"))
+			info->type = BACKUP_TYPE_DELTA;
 
 		/* Extract timestamps */
-		if (get_json_value(json_value, "backup-timestamp-start", val, sizeof(val)))
-			info->start_time = (time_t)atoll(val);
+		if (json_slice_to_uint64(v[INFO_TIMESTAMP_START], &num))
+			info->start_time = (time_t) num;
 
-		if (get_json_value(json_value, "backup-timestamp-stop", val, sizeof(val)))
-			info->end_time = (time_t)atoll(val);
+		if (json_slice_to_uint64(v[INFO_TIMESTAMP_STOP], &num))
+			info->end_time = (time_t) num;
 
 		/* Extract LSN values */
-		if (get_json_value(json_value, "backup-lsn-start", val, sizeof(val)))
+		if (json_slice_copy(v[INFO_LSN_START], val, sizeof(val)))
 			parse_lsn(val, &info->start_lsn);
 
-		if (get_json_value(json_value, "backup-lsn-stop", val, sizeof(val)))
+		if (json_slice_copy(v[INFO_LSN_STOP], val, sizeof(val)))
 			parse_lsn(val, &info->stop_lsn);
 
-		/* Parent backup (DIFF and INCR backups) */
-		if (get_json_value(json_value, "backup-prior", val, sizeof(val)))
-			str_copy(info->parent_backup_id, val,
-					 sizeof(info->parent_backup_id));
+		/* Parent backup (DIFF and INCR backups); null for FULL */
+		if (v[INFO_PRIOR].ptr != NULL && !json_slice_eq(v[INFO_PRIOR], "null"))
+			json_slice_copy(v[INFO_PRIOR], info->parent_backup_id,
+							sizeof(info->parent_backup_id));
 
 		/* Build backup path */
 		backup_dir = strrchr(backup_info_path, '/');
@@ -316,14 +355,16 @@ parse_pgbackrest_backup_info(const char *backup_info_path, const char *stanza_na
 					 "%.*s/%s", (int)dir_len, backup_info_path, info->backup_id);
 		}
 
-		/* Calculate backup size from directory */
-		if (info->backup_path[0] != '\0')
-			info->data_bytes = get_directory_size(info->backup_path);
+		/* Size in the repository as recorded by pgBackRest */
+		if (json_slice_to_uint64(v[INFO_REPO_SIZE], &num) ||
+			json_slice_to_uint64(v[INFO_SIZE], &num))
+			info->data_bytes = num;
 
-		/* Try to parse manifest for additional details */
-		path_join(manifest_path, sizeof(manifest_path),
-				  info->backup_path, "backup.manifest");
-		parse_pgbackrest_manifest(info, manifest_path);
+		/* The manifest lists every file of the cluster: read it on demand */
+		if (scan_get_load_level() == BACKUP_LOAD_IDENTITY)
+			info->partial = true;
+		else
+			pgbackrest_load_details(info);
 
 		/* Set stanza name if provided */
 		if (stanza_name != NULL)
@@ -422,6 +463,26 @@ scan_pgbackrest_backups(const char *repo_path)
 	return all_backups;
 }
 
+/*
+ * Fill in what backup.info leaves out from the backup's manifest, then
+ * settle data_bytes.
+ */
+static bool
+pgbackrest_load_details(BackupInfo *info)
+{
+	char manifest_path[PATH_MAX];
+
+	/* Try to parse manifest for additional details */
+	path_join(manifest_path, sizeof(manifest_path),
+			  info->backup_path, "backup.manifest");
+	parse_pgbackrest_manifest(info, manifest_path);
+
+	/* Walk the backup directory only when the metadata has no size */
+	if (info->backup_path[0] != '\0')
+		info->data_bytes = scan_resolve_size(info->backup_path, info->data_bytes);
+	return true;
+}
+
 /*
  * Adapter implementation
  */
@@ -431,6 +492,14 @@ pgbackrest_detect(const char *path)
 	return is_pgbackrest_repo(path);
 }
 
+static bool
+pgbackrest_detect_entries(const char *path, const DirSnapshot *entries)
+{
+	(void) path;
+	return dir_snapshot_has_dir(entries, "backup") &&
+		dir_snapshot_has_dir(entries, "archive");
+}
+
 static BackupInfo*
 pgbackrest_scan(const char *path)
 {
@@ -548,14 +617,13 @@ pgbackrest_get_wal_archive_path(const char *backup_path, const char *instance_na
 		return NULL;
 
 	/*
-	 * pgBackRest stores WAL in subdirectories with checksum-suffixed names
-	 * (e.g. 000000010000000000000006-<hash>.gz), which scan_wal_archive()
-	 * cannot parse.  Return NULL so callers skip WAL checks rather than
-	 * producing false-positive "missing segment" errors.
+	 * Segments live in <timeline><log_id>/ subdirectories with
+	 * checksum-suffixed, usually compressed names
+	 * (e.g. 0000000100000000/000000010000000000000006-<sha1>.gz);
+	 * scan_wal_archive() understands this layout.
 	 */
-	log_debug("pgBackRest WAL archive found at %s (subdirectory format, skipping scan)",
-			  wal_path);
-	return NULL;
+	log_debug("pgBackRest WAL archive found at %s", wal_path);
+	return strdup(wal_path);
 }
 
 
@@ -568,15 +636,24 @@ static void pgbackrest_cleanup_stub(BackupInfo *info)
 /* Implemented in src/validator/pgbackrest_validator.c */
 ValidationResult* pgbackrest_validate_structure(BackupInfo *backup);
 
+/* backup.info is rewritten (and its stanza directory touched) whenever a
+ * backup is added, expired or completes */
+static const char *const pgbackrest_metadata_files[] = {
+	"backup", "backup/*", "backup/*/backup.info", NULL
+};
+
 BackupAdapter pgbackrest_adapter = {
 	.name = "pgBackRest",
 	.detect = pgbackrest_detect,
+	.detect_entries = pgbackrest_detect_entries,
 	.scan = pgbackrest_scan,
 	.read_metadata = pgbackrest_read_metadata_stub,
 	.get_wal_archive_path = pgbackrest_get_wal_archive_path,
 	.validate_structure = pgbackrest_validate_structure,
 	.get_embedded_wal   = NULL,
-	.cleanup = pgbackrest_cleanup_stub
+	.cleanup = pgbackrest_cleanup_stub,
+	.load_details = pgbackrest_load_details,
+	.metadata_files = pgbackrest_metadata_files
 };
 
 BackupAdapter*
@@ -25,7 +25,16 @@
 #include "cmd_help.h"
 #include "arg_parser.h"
 #include "adapter.h"
+#include "anomaly_detector.h"
 #include "backup_chain.h"
+#include "backup_stats.h"
+#include "restore_estimate.h"
+#include "retention.h"
+#include "storage.h"
+#include "wal_archive_set.h"
+#include "ndjson.h"
+#include "metrics.h"
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,14 +47,45 @@ typedef struct {
 	char *backup_dir;
 	char *wal_archive;
 	bool detect_size_small;
+	char *cache_dir;    /* Catalog index directory, or NULL */
+	int jobs;           /* Directory scan threads */
+	OutputFormat output;
+	bool profile;       /* print the --profile report */
+	uint64_t replay_rate;   /* WAL replay bytes per second, 0 = measured */
+	time_t rto_target;      /* chains estimated to restore slower are degraded; 0 = none */
+	RetentionPolicy retention[RETENTION_MAX_POLICIES];  /* --retention, in order */
+	int nretention;
 } AuditOptions;
 
+/* False with --format=ndjson: the report text is not printed */
+static bool table_output = true;
+
+/* printf() for the human-readable report */
+static void
+report(const char *fmt, ...)
+{
+	va_list args;
+
+	if (!table_output)
+		return;
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+}
+
 static void
 init_options(AuditOptions *opts)
 {
 	opts->backup_dir  = NULL;
 	opts->wal_archive = NULL;
 	opts->detect_size_small = false;
+	opts->cache_dir   = NULL;
+	opts->jobs        = DEFAULT_THREADS;
+	opts->output      = OUTPUT_TABLE;
+	opts->profile     = false;
+	opts->replay_rate = 0;
+	opts->rto_target  = 0;
+	opts->nretention  = 0;
 }
 
 static int
@@ -55,16 +95,29 @@ parse_arguments(int argc, char **argv, AuditOptions *opts)
 	int option_index = 0;
 	bool backup_dir_seen  = false;
 	bool wal_archive_seen = false;
+	bool cache_dir_seen   = false;
+	bool jobs_seen        = false;
+	bool format_seen      = false;
+	bool profile_seen     = false;
+	bool replay_rate_seen = false;
+	bool rto_target_seen  = false;
 
 	static struct option long_options[] = {
 		{"backup-dir",           required_argument, 0, 'B'},
 		{"wal-archive",          required_argument, 0, 'w'},
 		{"detect-size-small",    no_argument,       0, 's'},
+		{"cache-dir",            required_argument, 0, 'C'},
+		{"jobs",                 required_argument, 0, 'j'},
+		{"format",               required_argument, 0, 'f'},
+		{"profile",              no_argument,       0, 'T'},
+		{"replay-rate",          required_argument, 0, 'P'},
+		{"rto-target",           required_argument, 0, 'O'},
+		{"retention",            required_argument, 0, 'K'},
 		{"help",                 no_argument,       0, 'h'},
 		{0, 0, 0, 0}
 	};
 
-	while ((c = getopt_long(argc, argv, "B:w:sh",
+	while ((c = getopt_long(argc, argv, "B:w:sj:f:h",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -80,6 +133,69 @@ parse_arguments(int argc, char **argv, AuditOptions *opts)
 			case 's':
 				opts->detect_size_small = true;
 				break;
+			case 'j':
+				if (check_duplicate_option(jobs_seen, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_int_argument(optarg, &opts->jobs, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->jobs < 1)
+				{
+					fprintf(stderr, "Error: --jobs must be >= 1\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				jobs_seen = true;
+				break;
+			case 'C':
+				if (!parse_string_option("--cache-dir", optarg, &opts->cache_dir, &cache_dir_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'f':
+				if (check_duplicate_option(format_seen, "--format"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!output_format_from_string(optarg, &opts->output))
+				{
+					fprintf(stderr, "Error: Invalid format: %s\n", optarg);
+					fprintf(stderr, "Valid formats: table, ndjson\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				format_seen = true;
+				break;
+			case 'T':
+				if (check_duplicate_option(profile_seen, "--profile"))
+					return EXIT_INVALID_ARGUMENTS;
+				opts->profile = true;
+				profile_seen = true;
+				break;
+			case 'P':
+				if (check_duplicate_option(replay_rate_seen, "--replay-rate"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_size_argument(optarg, &opts->replay_rate, "--replay-rate"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->replay_rate == 0)
+				{
+					fprintf(stderr, "Error: --replay-rate must be positive\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				replay_rate_seen = true;
+				break;
+			case 'O':
+				if (check_duplicate_option(rto_target_seen, "--rto-target"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_duration_argument(optarg, &opts->rto_target, "--rto-target"))
+					return EXIT_INVALID_ARGUMENTS;
+				rto_target_seen = true;
+				break;
+			case 'K':
+				if (opts->nretention == RETENTION_MAX_POLICIES)
+				{
+					fprintf(stderr, "Error: At most %d --retention policies\n",
+							RETENTION_MAX_POLICIES);
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				if (!retention_policy_parse(optarg, &opts->retention[opts->nretention]))
+					return EXIT_INVALID_ARGUMENTS;
+				opts->nretention++;
+				break;
 			case 'h':
 				print_audit_usage();
 				return EXIT_SUCCESS;
@@ -99,18 +215,25 @@ validate_options(const AuditOptions *opts)
 	if (!validate_required_option(opts->backup_dir, "--backup-dir"))
 		return EXIT_INVALID_ARGUMENTS;
 
-	if (!is_directory(opts->backup_dir))
+	if (!storage_is_remote(opts->backup_dir) && !is_directory(opts->backup_dir))
 	{
 		fprintf(stderr, "Error: Backup directory does not exist: %s\n", opts->backup_dir);
 		return EXIT_GENERAL_ERROR;
 	}
 
-	if (opts->wal_archive != NULL && !is_directory(opts->wal_archive))
+	if (opts->wal_archive != NULL && !storage_is_remote(opts->wal_archive) &&
+		!is_directory(opts->wal_archive))
 	{
 		fprintf(stderr, "Error: WAL archive directory does not exist: %s\n", opts->wal_archive);
 		return EXIT_GENERAL_ERROR;
 	}
 
+	if (opts->cache_dir != NULL && !is_directory(opts->cache_dir))
+	{
+		fprintf(stderr, "Error: Cache directory does not exist: %s\n", opts->cache_dir);
+		return EXIT_GENERAL_ERROR;
+	}
+
 	return EXIT_SUCCESS;
 }
 
@@ -170,8 +293,10 @@ typedef struct {
 	char backup_id[64];
 	const char *anomaly_type;  /* "size_large", "size_small", "duration_long", "duration_short" */
 	double value;
-	double avg;
-	double multiplier;  /* value / avg */
+	double avg;         /* baseline median */
+	double multiplier;  /* how many times off the median */
+	double ewma;        /* baseline moving average */
+	double score;       /* robust z-score, 0 if the baseline did not vary */
 } AnomalyRecord;
 
 typedef struct {
@@ -180,18 +305,6 @@ typedef struct {
 	int capacity;
 } AnomalyList;
 
-/* Per-backup-type statistics (per tool AND type) */
-typedef struct {
-	BackupTool tool;
-	BackupType type;
-	int count;
-	uint64_t total_size;
-	time_t total_duration;
-	double avg_size;
-	double avg_duration;
-	double stddev_size;
-} BackupTypeStats;
-
 /* ------------------------------------------------------------------ *
  * Chain status assessment
  * ------------------------------------------------------------------ */
@@ -202,188 +315,68 @@ typedef enum {
 	CHAIN_STATUS_BROKEN
 } ChainStatus;
 
-/* Calculate statistics for each backup tool+type combination (only OK/WARNING backups) */
-BackupTypeStats*
-calculate_backup_stats(BackupInfo *backups, int *out_count)
-{
-	BackupTypeStats *stats = malloc(30 * sizeof(BackupTypeStats));  /* Max 30 combinations */
-	if (stats == NULL)
-		return NULL;
-
-	int stats_count = 0;
-	memset(stats, 0, 30 * sizeof(BackupTypeStats));
-
-	/* First pass: group by (tool, type) and sum */
-	for (BackupInfo *b = backups; b != NULL; b = b->next)
-	{
-		/* Skip failed/incomplete backups */
-		if (b->status != BACKUP_STATUS_OK && b->status != BACKUP_STATUS_WARNING)
-			continue;
-
-		/* Skip if no data */
-		if (b->data_bytes == 0 || b->start_time == 0 || b->end_time == 0)
-			continue;
-
-		/* Skip backups with non-positive duration (end <= start). Otherwise
-		 * zero-duration entries pull the average toward 0, and entries where
-		 * end < start (broken timestamps) feed a negative value into the
-		 * sum, corrupting the baseline for every real backup. */
-		if (b->end_time <= b->start_time)
-			continue;
-
-		BackupTypeStats *st = NULL;
-		for (int i = 0; i < stats_count; i++)
-		{
-			if (stats[i].tool == b->tool && stats[i].type == b->type)
-			{
-				st = &stats[i];
-				break;
-			}
-		}
-
-		if (st == NULL)
-		{
-			if (stats_count >= 30)
-				break;  /* Too many combinations */
-			st = &stats[stats_count++];
-			st->tool = b->tool;
-			st->type = b->type;
-			st->count = 0;
-			st->total_size = 0;
-			st->total_duration = 0;
-		}
-
-		st->count++;
-		st->total_size += b->data_bytes + b->wal_bytes;
-		st->total_duration += (b->end_time - b->start_time);
-	}
-
-	/* Calculate averages */
-	for (int i = 0; i < stats_count; i++)
-	{
-		if (stats[i].count > 0)
-		{
-			stats[i].avg_size = (double)stats[i].total_size / stats[i].count;
-			stats[i].avg_duration = (double)stats[i].total_duration / stats[i].count;
-		}
-	}
-
-	*out_count = stats_count;
-	return stats;
-}
-
-/* Detect anomalies in backup sizes and durations */
+/*
+ * Detect anomalies in backup sizes and durations: feed the backups to
+ * 'detector' oldest first, each scored against the baseline of its
+ * (tool, instance, type) as it was before (see anomaly_detector.h)
+ */
 AnomalyList*
-detect_anomalies(BackupInfo *backups, BackupTypeStats *stats, int stats_count, bool detect_size_small)
+detect_anomalies(BackupInfo *backups, AnomalyDetector *detector, bool detect_size_small)
 {
-	AnomalyList *anomalies = malloc(sizeof(AnomalyList));
-	if (anomalies == NULL)
-		return NULL;
-
-	anomalies->items = malloc(100 * sizeof(AnomalyRecord));  /* Max 100 anomalies */
-	anomalies->count = 0;
-	anomalies->capacity = 100;
+	AnomalyList *anomalies = calloc(1, sizeof(AnomalyList));
+	const BackupInfo **order;
+	int n;
 
-	if (anomalies->items == NULL)
-	{
-		free(anomalies);
+	if (anomalies == NULL)
 		return NULL;
-	}
-
-	const double SIZE_THRESHOLD = 2.0;     /* 2x average = anomaly */
-	const double DURATION_THRESHOLD = 2.0; /* 2x average = anomaly */
 
-	for (BackupInfo *b = backups; b != NULL; b = b->next)
+	order = anomaly_detector_order(backups, &n);
+	for (int i = 0; i < n; i++)
 	{
-		/* Skip failed/incomplete backups */
-		if (b->status != BACKUP_STATUS_OK && b->status != BACKUP_STATUS_WARNING)
-			continue;
+		AnomalyFinding found[ANOMALY_MAX_FINDINGS];
+		int nfound = anomaly_detector_observe(detector, order[i], detect_size_small, found);
 
-		/* Skip if no data */
-		if (b->data_bytes == 0 || b->start_time == 0 || b->end_time == 0)
-			continue;
-
-		/* Skip backups with non-positive duration (end <= start). The
-		 * duration math below would otherwise produce a 0 or negative
-		 * multiplier and report a meaningless "Nx faster" anomaly. */
-		if (b->end_time <= b->start_time)
-			continue;
-
-		/* Find stats for this (tool, type) combination */
-		BackupTypeStats *st = NULL;
-		for (int i = 0; i < stats_count; i++)
+		for (int k = 0; k < nfound; k++)
 		{
-			if (stats[i].tool == b->tool && stats[i].type == b->type && stats[i].count > 1)
-			{
-				st = &stats[i];
-				break;
-			}
-		}
-
-		if (st == NULL)
-			continue;  /* Not enough data for this combination */
+			AnomalyRecord *rec;
 
-		uint64_t size = b->data_bytes + b->wal_bytes;
-		time_t duration = b->end_time - b->start_time;
+			if (anomalies->count == anomalies->capacity)
+			{
+				int cap = anomalies->capacity > 0 ? anomalies->capacity * 2 : 16;
+				AnomalyRecord *grown = realloc(anomalies->items, (size_t) cap * sizeof(AnomalyRecord));
 
-		/* Check for size anomalies */
-		double size_multiplier = size / st->avg_size;
-		if (size_multiplier > SIZE_THRESHOLD)
-		{
-			AnomalyRecord *rec = &anomalies->items[anomalies->count++];
-			str_copy(rec->backup_id, b->backup_id, sizeof(rec->backup_id));
-			rec->anomaly_type = "size_large";
-			rec->value = size;
-			rec->avg = st->avg_size;
-			rec->multiplier = size_multiplier;
-
-			if (anomalies->count >= anomalies->capacity)
-				break;
-		}
-		else if (detect_size_small && size_multiplier < (1.0 / SIZE_THRESHOLD) && size_multiplier > 0)
-		{
-			AnomalyRecord *rec = &anomalies->items[anomalies->count++];
-			str_copy(rec->backup_id, b->backup_id, sizeof(rec->backup_id));
-			rec->anomaly_type = "size_small";
-			rec->value = size;
-			rec->avg = st->avg_size;
-			rec->multiplier = 1.0 / size_multiplier;
-
-			if (anomalies->count >= anomalies->capacity)
-				break;
-		}
+				if (grown == NULL)
+				{
+					fprintf(stderr, "Error: Memory allocation failed\n");
+					free(order);
+					return anomalies;
+				}
+				anomalies->items = grown;
+				anomalies->capacity = cap;
+			}
 
-		/* Check for duration anomalies */
-		double duration_multiplier = duration / st->avg_duration;
-		if (duration_multiplier > DURATION_THRESHOLD)
-		{
-			AnomalyRecord *rec = &anomalies->items[anomalies->count++];
-			str_copy(rec->backup_id, b->backup_id, sizeof(rec->backup_id));
-			rec->anomaly_type = "duration_long";
-			rec->value = duration;
-			rec->avg = st->avg_duration;
-			rec->multiplier = duration_multiplier;
-
-			if (anomalies->count >= anomalies->capacity)
-				break;
-		}
-		else if (duration_multiplier < (1.0 / DURATION_THRESHOLD) && duration_multiplier > 0)
-		{
-			AnomalyRecord *rec = &anomalies->items[anomalies->count++];
-			str_copy(rec->backup_id, b->backup_id, sizeof(rec->backup_id));
-			rec->anomaly_type = "duration_short";
-			rec->value = duration;
-			rec->avg = st->avg_duration;
-			rec->multiplier = 1.0 / duration_multiplier;
-
-			if (anomalies->count >= anomalies->capacity)
-				break;
+			rec = &anomalies->items[anomalies->count++];
+			str_copy(rec->backup_id, found[k].backup_id, sizeof(rec->backup_id));
+			rec->anomaly_type = anomaly_kind_name(found[k].kind);
+			rec->value = found[k].value;
+			rec->avg = found[k].median;
+			rec->multiplier = found[k].ratio;
+			rec->ewma = found[k].ewma;
+			rec->score = found[k].score;
 		}
 	}
+	free(order);
 
 	return anomalies;
 }
 
+/* Size of the archive's segments; the scan leaves 0 for the standard 16 MB */
+static uint64_t
+wal_archive_segment_bytes(const WALArchiveInfo *wal_info)
+{
+	return wal_info->segment_size != 0 ? wal_info->segment_size : 16 * 1024 * 1024;
+}
+
 /* Find the latest WAL segment after a given LSN in the archive */
 static bool
 get_latest_wal_lsn(const WALArchiveInfo *wal_info, XLogRecPtr after_lsn,
@@ -392,15 +385,15 @@ get_latest_wal_lsn(const WALArchiveInfo *wal_info, XLogRecPtr after_lsn,
 	if (wal_info == NULL || wal_info->segment_count == 0)
 		return false;
 
-	/* Segments are sorted by timeline, log_id, seg_id (highest first after sort) */
-	/* We need to find the last segment that is >= after_lsn */
+	/* The last segment of each run is the latest one it holds */
 	XLogRecPtr max_lsn = 0;
 	bool found = false;
 
-	for (int i = 0; i < wal_info->segment_count; i++)
+	for (int i = 0; i < wal_info->range_count; i++)
 	{
-		WALSegmentName *seg = &wal_info->segments[i];
-		XLogRecPtr seg_lsn = ((XLogRecPtr)seg->log_id << 32) | (seg->seg_id * 16 * 1024 * 1024);
+		const WALSegmentRange *r = &wal_info->ranges[i];
+		uint64_t   last = r->start + r->count - 1;
+		XLogRecPtr seg_lsn = last * wal_archive_segment_bytes(wal_info);
 
 		if (seg_lsn > after_lsn)
 		{
@@ -420,64 +413,35 @@ get_latest_wal_lsn(const WALArchiveInfo *wal_info, XLogRecPtr after_lsn,
 	return false;
 }
 
-/* Calculate how many WAL segments can be safely removed (older than oldest backup) */
-static uint64_t
-calculate_deletable_wal_size(const WALArchiveInfo *wal_info, XLogRecPtr oldest_lsn)
-{
-	if (wal_info == NULL || wal_info->segment_count == 0)
-		return 0;
-
-	uint64_t deletable_size = 0;
-
-	/* All segments before oldest_lsn can be deleted */
-	for (int i = 0; i < wal_info->segment_count; i++)
-	{
-		WALSegmentName *seg = &wal_info->segments[i];
-		XLogRecPtr seg_lsn = ((XLogRecPtr)seg->log_id << 32) | (seg->seg_id * 16 * 1024 * 1024);
-
-		if (seg_lsn < oldest_lsn)
-		{
-			deletable_size += 16 * 1024 * 1024;  /* 16 MB per segment */
-		}
-	}
-
-	return deletable_size;
-}
-
-/* Check if WAL archive covers from backup stop_lsn to the latest segment */
+/*
+ * Check if WAL archive covers from backup stop_lsn to the latest segment
+ * of that timeline: the run of segments holding from_lsn must be the last
+ * one on the timeline.  A switch to a later timeline is not a gap.
+ */
 static bool
-is_wal_continuous_after_lsn(const WALArchiveInfo *wal_info, XLogRecPtr from_lsn)
+is_wal_continuous_after_lsn(const WALArchiveInfo *wal_info, XLogRecPtr from_lsn,
+							TimeLineID timeline)
 {
-	if (wal_info == NULL || wal_info->segment_count == 0)
+	WALSegmentName seg;
+	int            r;
+
+	if (wal_info == NULL || wal_info->segment_count == 0 ||
+		wal_info->ranges == NULL)
 		return false;
 
-	/* Check if there's a segment starting at or shortly after from_lsn */
-	/* A segment at LSN X covers [X, X + 16MB) */
-	for (int i = 0; i < wal_info->segment_count; i++)
-	{
-		WALSegmentName *seg = &wal_info->segments[i];
-		XLogRecPtr seg_lsn = ((XLogRecPtr)seg->log_id << 32) | (seg->seg_id * 16 * 1024 * 1024);
+	/* Backup without a known timeline: assume the newest one archived */
+	if (timeline == 0)
+		timeline = wal_info->ranges[wal_info->range_count - 1].timeline;
 
-		/* If we find a segment that covers from_lsn or is the next one */
-		if (seg_lsn <= from_lsn && seg_lsn + (16UL * 1024 * 1024) > from_lsn)
-			return true;  /* Continuous from backup stop point */
+	/* A segment at LSN X covers [X, X + segment size) */
+	lsn_to_seg(from_lsn, timeline, &seg, wal_info->segment_size);
 
-		if (seg_lsn > from_lsn)
-		{
-			/* Check if there's a gap - next segment should start at or before
-			 * the point where previous segment would end */
-			if (i > 0)
-			{
-				WALSegmentName *prev = &wal_info->segments[i - 1];
-				XLogRecPtr prev_lsn = ((XLogRecPtr)prev->log_id << 32) | (prev->seg_id * 16 * 1024 * 1024);
-				if (prev_lsn + (16UL * 1024 * 1024) >= seg_lsn)
-					return true;  /* No gap */
-			}
-			return false;  /* Gap detected */
-		}
-	}
+	r = wal_archive_find_range(wal_info, &seg);
+	if (r < 0)
+		return false;  /* No segment covers the stop point */
 
-	return false;  /* No segment covers the range */
+	return r + 1 == wal_info->range_count ||
+		wal_info->ranges[r + 1].timeline != timeline;
 }
 
 static ChainStatus
@@ -531,10 +495,44 @@ chain_status_color(ChainStatus s)
  * Section: one FULL chain
  * ------------------------------------------------------------------ */
 
+static void
+format_rate(double rate, char *buf, size_t size)
+{
+	char bytes[32];
+
+	format_bytes((uint64_t) rate, bytes, sizeof(bytes));
+	snprintf(buf, size, "%.29s/s", bytes);
+}
+
+/* format_duration(), with seconds below a minute: restores can be quick */
+static void
+format_estimate(double seconds, char *buf, size_t size)
+{
+	if (seconds < 59.5)
+		snprintf(buf, size, "%.0fs", seconds);
+	else
+		format_duration((time_t) (seconds + 0.5), buf, size);
+}
+
 static ChainStatus
-print_chain_audit(const BackupChain *chain, int chain_num, const WALArchiveInfo *wal_info)
+print_chain_audit(const BackupChain *chain, int chain_num, const WALArchiveInfo *wal_info,
+				  const RestoreThroughput *throughput, const AuditOptions *opts)
 {
 	ChainStatus status = assess_chain_status(chain);
+	RestoreEstimate est;
+	bool        has_estimate;
+	bool        rto_exceeded = false;
+
+	/* Restore time of the latest backup; over --rto-target degrades the chain */
+	has_estimate = restore_estimate_chain(chain, wal_info, throughput,
+										  (double) opts->replay_rate, &est);
+	if (has_estimate && opts->rto_target > 0 &&
+		est.restore_seconds + est.replay_seconds > (double) opts->rto_target)
+	{
+		rto_exceeded = true;
+		if (status == CHAIN_STATUS_OK)
+			status = CHAIN_STATUS_DEGRADED;
+	}
 
 	/* Chain header */
 	{
@@ -544,21 +542,21 @@ print_chain_audit(const BackupChain *chain, int chain_num, const WALArchiveInfo
 					 localtime(&chain->root->start_time));
 
 		int incr_count = chain->count - 1;
-		printf("Chain %d: %s  %s  %s",
+		report("Chain %d: %s  %s  %s",
 			   chain_num,
 			   chain->root->backup_id,
 			   backup_tool_to_string(chain->root->tool),
 			   date_str);
 		if (incr_count > 0)
-			printf("  (+%d incremental%s)", incr_count, incr_count == 1 ? "" : "s");
-		printf("\n");
+			report("  (+%d incremental%s)", incr_count, incr_count == 1 ? "" : "s");
+		report("\n");
 	}
 
 	/* Status line */
 	{
 		const char *col = use_color ? chain_status_color(status) : "";
 		const char *rst = use_color ? COLOR_RESET : "";
-		printf("  Status:                  %s[%s]%s\n",
+		report("  Status:                  %s[%s]%s\n",
 			   col, chain_status_label(status), rst);
 	}
 
@@ -574,7 +572,7 @@ print_chain_audit(const BackupChain *chain, int chain_num, const WALArchiveInfo
 				break;
 			}
 		}
-		printf("  WAL Mode:                %s\n",
+		report("  WAL Mode:                %s\n",
 			   (first[0] == '\0') ? "-" : (all_same ? first : "mixed"));
 	}
 
@@ -583,7 +581,11 @@ print_chain_audit(const BackupChain *chain, int chain_num, const WALArchiveInfo
 	time_t     latest_time = 0;
 	XLogRecPtr oldest_lsn  = 0;
 	XLogRecPtr latest_lsn  = 0;
+	TimeLineID latest_tli  = 0;
 	time_t     last_end    = 0;  /* newest end_time, for RPO gap */
+	XLogRecPtr wal_lsn     = 0;  /* newest archived WAL past latest_lsn */
+	bool       wal_continuous = false;
+	time_t     rpo_gap     = -1;
 
 	for (int i = 0; i < chain->count; i++)
 	{
@@ -602,6 +604,7 @@ print_chain_audit(const BackupChain *chain, int chain_num, const WALArchiveInfo
 		{
 			latest_time = b->end_time;
 			latest_lsn  = b->stop_lsn;
+			latest_tli  = b->timeline;
 		}
 		if (b->end_time > last_end)
 			last_end = b->end_time;
@@ -614,30 +617,31 @@ print_chain_audit(const BackupChain *chain, int chain_num, const WALArchiveInfo
 
 		format_timestamp(oldest_time, ts, sizeof(ts));
 		format_lsn(oldest_lsn, lsn_str, sizeof(lsn_str));
-		printf("  Oldest recovery point:   %s  (%s) [from backup]\n", ts, lsn_str);
+		report("  Oldest recovery point:   %s  (%s) [from backup]\n", ts, lsn_str);
 
 		format_timestamp(latest_time, ts, sizeof(ts));
 		format_lsn(latest_lsn, lsn_str, sizeof(lsn_str));
-		printf("  Latest recovery point:   %s  (%s) [from backup]\n", ts, lsn_str);
+		report("  Latest recovery point:   %s  (%s) [from backup]\n", ts, lsn_str);
 
 		/* Check if WAL archive extends recovery window */
 		if (wal_info != NULL && wal_info->segment_count > 0)
 		{
-			XLogRecPtr wal_lsn = 0;
 			if (get_latest_wal_lsn(wal_info, latest_lsn, &wal_lsn))
 			{
 				format_lsn(wal_lsn, lsn_str, sizeof(lsn_str));
 
 				/* Check if WAL is continuous from backup stop_lsn */
-				if (is_wal_continuous_after_lsn(wal_info, latest_lsn))
+				wal_continuous = is_wal_continuous_after_lsn(wal_info, latest_lsn,
+															 latest_tli);
+				if (wal_continuous)
 				{
-					printf("  Latest recovery point:   (with continuous WAL) (%s) [with WAL archive]\n", lsn_str);
+					report("  Latest recovery point:   (with continuous WAL) (%s) [with WAL archive]\n", lsn_str);
 				}
 				else
 				{
 					const char *col = use_color ? COLOR_YELLOW : "";
 					const char *rst = use_color ? COLOR_RESET : "";
-					printf("  Latest recovery point:   (with WAL - %sGAP DETECTED%s) (%s)\n",
+					report("  Latest recovery point:   (with WAL - %sGAP DETECTED%s) (%s)\n",
 						   col, rst, lsn_str);
 				}
 			}
@@ -646,14 +650,86 @@ print_chain_audit(const BackupChain *chain, int chain_num, const WALArchiveInfo
 		/* RPO gap: time elapsed since last completed backup */
 		time_t now = time(NULL);
 		char   dur[32];
-		format_duration((time_t)difftime(now, last_end), dur, sizeof(dur));
-		printf("  RPO gap:                 %s\n", dur);
+		rpo_gap = (time_t)difftime(now, last_end);
+		format_duration(rpo_gap, dur, sizeof(dur));
+		report("  RPO gap:                 %s\n", dur);
 	}
 	else
 	{
-		printf("  Oldest recovery point:   N/A\n");
-		printf("  Latest recovery point:   N/A\n");
-		printf("  RPO gap:                 N/A\n");
+		report("  Oldest recovery point:   N/A\n");
+		report("  Latest recovery point:   N/A\n");
+		report("  RPO gap:                 N/A\n");
+	}
+
+	if (has_estimate)
+	{
+		char total[32], part[32], size[32], rate[40];
+
+		format_estimate(est.restore_seconds + est.replay_seconds, total, sizeof(total));
+		report("  Estimated restore time:  %s (latest backup %s)\n", total, est.backup->backup_id);
+
+		format_estimate(est.restore_seconds, part, sizeof(part));
+		format_bytes(est.data_bytes, size, sizeof(size));
+		format_rate(est.data_rate, rate, sizeof(rate));
+		report("    Data:                  %s  (%s in %d backup%s at %s, %s)\n",
+			   part, size, est.backups, est.backups == 1 ? "" : "s",
+			   rate, rate_source_name(est.data_source));
+
+		format_estimate(est.replay_seconds, part, sizeof(part));
+		format_bytes(est.wal_bytes, size, sizeof(size));
+		format_rate(est.wal_rate, rate, sizeof(rate));
+		report("    WAL replay:            %s  (%s at %s, %s)\n",
+			   part, size, rate, rate_source_name(est.wal_source));
+
+		if (opts->rto_target > 0)
+		{
+			const char *col = use_color ? (rto_exceeded ? COLOR_YELLOW : COLOR_GREEN) : "";
+			const char *rst = use_color ? COLOR_RESET : "";
+
+			format_estimate((double) opts->rto_target, part, sizeof(part));
+			report("  RTO target:              %s%s %s%s\n", col, part,
+				   rto_exceeded ? "EXCEEDED" : "met", rst);
+		}
+	}
+
+	if (!table_output)
+	{
+		NdjsonRecord rec;
+
+		ndjson_begin(&rec, stdout, "chain");
+		ndjson_int(&rec, "chain", chain_num);
+		ndjson_string(&rec, "root", chain->root->backup_id);
+		ndjson_string(&rec, "tool", backup_tool_to_string(chain->root->tool));
+		ndjson_time(&rec, "start_time", chain->root->start_time);
+		ndjson_int(&rec, "members", chain->count);
+		ndjson_string(&rec, "status", chain_status_label(status));
+		ndjson_time(&rec, "oldest_recovery_time", oldest_time);
+		ndjson_lsn(&rec, "oldest_recovery_lsn", oldest_time > 0 ? oldest_lsn : 0);
+		ndjson_time(&rec, "latest_recovery_time", latest_time);
+		ndjson_lsn(&rec, "latest_recovery_lsn", oldest_time > 0 ? latest_lsn : 0);
+		ndjson_lsn(&rec, "latest_wal_lsn", wal_lsn);
+		if (wal_lsn != 0)
+			ndjson_bool(&rec, "wal_continuous", wal_continuous);
+		if (rpo_gap >= 0)
+			ndjson_int(&rec, "rpo_gap_seconds", (int64_t) rpo_gap);
+		else
+			ndjson_null(&rec, "rpo_gap_seconds");
+		if (has_estimate)
+		{
+			ndjson_string(&rec, "restore_backup", est.backup->backup_id);
+			ndjson_int(&rec, "restore_backups", est.backups);
+			ndjson_uint(&rec, "restore_data_bytes", est.data_bytes);
+			ndjson_uint(&rec, "replay_wal_bytes", est.wal_bytes);
+			ndjson_double(&rec, "data_rate", est.data_rate);
+			ndjson_string(&rec, "data_rate_source", rate_source_name(est.data_source));
+			ndjson_double(&rec, "wal_rate", est.wal_rate);
+			ndjson_string(&rec, "wal_rate_source", rate_source_name(est.wal_source));
+			ndjson_double(&rec, "restore_seconds", est.restore_seconds);
+			ndjson_double(&rec, "replay_seconds", est.replay_seconds);
+			if (opts->rto_target > 0)
+				ndjson_bool(&rec, "rto_exceeded", rto_exceeded);
+		}
+		ndjson_end(&rec);
 	}
 
 	return status;
@@ -671,26 +747,42 @@ print_anomalies_section(const AnomalyList *anomalies)
 
 	const char *col = use_color ? COLOR_CYAN : "";
 	const char *rst = use_color ? COLOR_RESET : "";
-	printf("%sAnomalies%s\n", col, rst);
-	printf("  Detected unusual backup patterns:\n");
+	report("%sAnomalies%s\n", col, rst);
+	report("  Detected unusual backup patterns:\n");
 
 	for (int i = 0; i < anomalies->count; i++)
 	{
 		const AnomalyRecord *rec = &anomalies->items[i];
 		char val_str[32], avg_str[32];
 
+		if (!table_output)
+		{
+			NdjsonRecord out;
+
+			ndjson_begin(&out, stdout, "anomaly");
+			ndjson_string(&out, "backup_id", rec->backup_id);
+			ndjson_string(&out, "kind", rec->anomaly_type);
+			ndjson_double(&out, "value", rec->value);
+			ndjson_double(&out, "median", rec->avg);
+			ndjson_double(&out, "average", rec->ewma);
+			ndjson_double(&out, "ratio", rec->multiplier);
+			ndjson_double(&out, "score", rec->score);
+			ndjson_end(&out);
+			continue;
+		}
+
 		if (strcmp(rec->anomaly_type, "size_large") == 0)
 		{
 			format_bytes(rec->value, val_str, sizeof(val_str));
 			format_bytes(rec->avg, avg_str, sizeof(avg_str));
-			printf("  - %s: size %s (%.1fx larger than avg %s)\n",
+			report("  - %s: size %s (%.1fx larger than median %s)\n",
 				   rec->backup_id, val_str, rec->multiplier, avg_str);
 		}
 		else if (strcmp(rec->anomaly_type, "size_small") == 0)
 		{
 			format_bytes(rec->value, val_str, sizeof(val_str));
 			format_bytes(rec->avg, avg_str, sizeof(avg_str));
-			printf("  - %s: size %s (%.1fx smaller than avg %s)\n",
+			report("  - %s: size %s (%.1fx smaller than median %s)\n",
 				   rec->backup_id, val_str, rec->multiplier, avg_str);
 		}
 		else if (strcmp(rec->anomaly_type, "duration_long") == 0)
@@ -698,7 +790,7 @@ print_anomalies_section(const AnomalyList *anomalies)
 			char dur_str[32], avg_dur_str[32];
 			format_duration((time_t)rec->value, dur_str, sizeof(dur_str));
 			format_duration((time_t)rec->avg, avg_dur_str, sizeof(avg_dur_str));
-			printf("  - %s: took %s (%.1fx longer than avg %s)\n",
+			report("  - %s: took %s (%.1fx longer than median %s)\n",
 				   rec->backup_id, dur_str, rec->multiplier, avg_dur_str);
 		}
 		else if (strcmp(rec->anomaly_type, "duration_short") == 0)
@@ -706,7 +798,7 @@ print_anomalies_section(const AnomalyList *anomalies)
 			char dur_str[32], avg_dur_str[32];
 			format_duration((time_t)rec->value, dur_str, sizeof(dur_str));
 			format_duration((time_t)rec->avg, avg_dur_str, sizeof(avg_dur_str));
-			printf("  - %s: took %s (%.1fx faster than avg %s)\n",
+			report("  - %s: took %s (%.1fx faster than median %s)\n",
 				   rec->backup_id, dur_str, rec->multiplier, avg_dur_str);
 		}
 	}
@@ -724,16 +816,25 @@ print_orphans_section(const BackupChain *orphan_chain)
 
 	const char *col = use_color ? COLOR_CYAN : "";
 	const char *rst = use_color ? COLOR_RESET : "";
-	printf("%sOrphaned Backups (%d)%s\n", col, orphan_chain->count, rst);
-	printf("  ");
+	for (int i = 0; !table_output && i < orphan_chain->count; i++)
+	{
+		NdjsonRecord rec;
+
+		ndjson_begin(&rec, stdout, "orphan");
+		ndjson_backup_fields(&rec, orphan_chain->members[i]);
+		ndjson_end(&rec);
+	}
+
+	report("%sOrphaned Backups (%d)%s\n", col, orphan_chain->count, rst);
+	report("  ");
 	for (int i = 0; i < orphan_chain->count; i++)
 	{
 		if (i > 0)
-			printf(", ");
-		printf("%s", orphan_chain->members[i]->backup_id);
+			report(", ");
+		report("%s", orphan_chain->members[i]->backup_id);
 	}
-	printf("\n");
-	printf("  These backups cannot be used for restore without their parent FULL backup\n");
+	report("\n");
+	report("  These backups cannot be used for restore without their parent FULL backup\n");
 
 	return orphan_chain->count;
 }
@@ -742,108 +843,153 @@ print_orphans_section(const BackupChain *orphan_chain)
  * Section: WAL archive
  * ------------------------------------------------------------------ */
 
+/*
+ * 'spare' is the WAL below the oldest backup of a chain, from the
+ * retention plan with nothing expired.
+ */
 static bool
-print_wal_section(const char *wal_archive_dir, WALArchiveInfo *wal_info,
-				  BackupInfo *backups)
+print_wal_archive(const WALArchiveSetEntry *archive,
+				  const RetentionArchiveResult *spare)
 {
-	bool wal_ok = true;
-
-	const char *col = use_color ? COLOR_CYAN : "";
-	const char *rst = use_color ? COLOR_RESET : "";
-	printf("%sWAL%s\n", col, rst);
-
-	if (wal_archive_dir == NULL || wal_info == NULL)
-	{
-		printf("  No WAL archive provided (use --wal-archive to enable)\n");
-		return true;
-	}
+	bool            wal_ok   = true;
+	WALArchiveInfo *wal_info = archive->info;
+	uint64_t        deletable_size = spare->bytes;
+	int             gaps     = -1;
 
-	printf("  Archive:    %s\n", wal_archive_dir);
-	printf("  Segments:   %d\n", wal_info->segment_count);
+	report("  Archive:    %s\n", archive->path);
+	report("  Segments:   %d\n", wal_info->segment_count);
 
-	uint64_t wal_size = get_directory_size(wal_archive_dir);
+	/* Totalled by the archive scan; no second walk of the archive */
 	char     size_str[32];
-	format_bytes(wal_size, size_str, sizeof(size_str));
-	printf("  Size:       %s\n", size_str);
+	format_bytes(wal_info->total_bytes, size_str, sizeof(size_str));
+	report("  Size:       %s\n", size_str);
 
 	/* WAL restore chain coverage */
-	ValidationResult *chain_result = check_wal_restore_chain(backups, wal_info);
+	ValidationResult *chain_result =
+		check_wal_restore_chain_of(archive->members, archive->member_count,
+								   wal_info);
 	if (chain_result != NULL)
 	{
+		gaps = chain_result->error_count;
+		for (int i = 0; !table_output && i < chain_result->error_count; i++)
+		{
+			NdjsonRecord rec;
+
+			ndjson_begin(&rec, stdout, "finding");
+			ndjson_string(&rec, "severity", "error");
+			ndjson_string(&rec, "archive", archive->path);
+			ndjson_string(&rec, "check", "restore_chain");
+			ndjson_string(&rec, "message", chain_result->errors[i]);
+			ndjson_end(&rec);
+		}
 		if (chain_result->error_count > 0)
 		{
-			printf("  Coverage:   %s[INCOMPLETE]%s WAL gaps detected:\n",
+			report("  Coverage:   %s[INCOMPLETE]%s WAL gaps detected:\n",
 				   use_color ? COLOR_RED : "", use_color ? COLOR_RESET : "");
 			for (int i = 0; i < chain_result->error_count; i++)
-				printf("              %s\n", chain_result->errors[i]);
+				report("              %s\n", chain_result->errors[i]);
 			wal_ok = false;
 		}
 		else
 		{
-			printf("  Coverage:   %s[OK]%s Continuous WAL available for all backups\n",
+			report("  Coverage:   %s[OK]%s Continuous WAL available for all backups\n",
 				   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "");
 		}
 		free_validation_result(chain_result);
 	}
 
 	/* WAL cleanup recommendations */
-	if (backups != NULL && wal_info->segment_count > 0)
+	if (deletable_size > 0)
 	{
-		/* Find oldest backup's start_lsn to calculate cleanable segments */
-		XLogRecPtr oldest_lsn = 0;
-		for (BackupInfo *b = backups; b != NULL; b = b->next)
-		{
-			if (b->start_lsn > 0)
-			{
-				if (oldest_lsn == 0 || b->start_lsn < oldest_lsn)
-					oldest_lsn = b->start_lsn;
-			}
-		}
+		format_bytes(deletable_size, size_str, sizeof(size_str));
+		report("  Cleanup:    %s of WAL segments can be safely removed (older than oldest backup)\n",
+			   size_str);
+	}
 
-		if (oldest_lsn > 0)
-		{
-			uint64_t deletable_size = calculate_deletable_wal_size(wal_info, oldest_lsn);
-			if (deletable_size > 0)
-			{
-				format_bytes(deletable_size, size_str, sizeof(size_str));
-				printf("  Cleanup:    %s of WAL segments can be safely removed (older than oldest backup)\n",
-					   size_str);
-			}
-		}
+	if (!table_output)
+	{
+		NdjsonRecord rec;
+
+		ndjson_begin(&rec, stdout, "wal_archive");
+		ndjson_string(&rec, "archive", archive->path);
+		ndjson_int(&rec, "segments", wal_info->segment_count);
+		ndjson_uint(&rec, "bytes", wal_info->total_bytes);
+		if (gaps >= 0)
+			ndjson_int(&rec, "coverage_gaps", gaps);
+		else
+			ndjson_null(&rec, "coverage_gaps");
+		ndjson_uint(&rec, "removable_bytes", deletable_size);
+		ndjson_end(&rec);
 	}
 
 	return wal_ok;
 }
 
+/* One block per scanned archive: each instance or stanza has its own */
+static bool
+print_wal_section(const WALArchiveSet *wal_set, const RetentionPlan *plan)
+{
+	bool wal_ok  = true;
+	int  printed = 0;
+	RetentionArchiveResult *spare = NULL;
+	RetentionInstanceResult *kept = NULL;
+	RetentionArchiveResult none = {0, 0, 0, 0};
+
+	if (plan->narchives > 0)
+	{
+		spare = calloc(plan->narchives, sizeof(*spare));
+		kept = calloc(plan->ninstances > 0 ? plan->ninstances : 1, sizeof(*kept));
+		if (spare != NULL && kept != NULL)
+			retention_plan_evaluate(plan, NULL, kept, spare);
+	}
+
+	const char *col = use_color ? COLOR_CYAN : "";
+	const char *rst = use_color ? COLOR_RESET : "";
+	report("%sWAL%s\n", col, rst);
+
+	for (int ai = 0; wal_set != NULL && ai < wal_set->count; ai++)
+	{
+		if (wal_set->archives[ai].info == NULL)
+			continue;
+		if (printed++ > 0)
+			report("\n");
+		if (!print_wal_archive(&wal_set->archives[ai],
+							   spare != NULL && kept != NULL ? &spare[ai] : &none))
+			wal_ok = false;
+	}
+
+	if (printed == 0)
+		report("  No WAL archive provided (use --wal-archive to enable)\n");
+
+	free(spare);
+	free(kept);
+	return wal_ok;
+}
+
 /* ------------------------------------------------------------------ *
  * Section: storage
  * ------------------------------------------------------------------ */
 
 static void
-print_storage_section(const char *backup_dir, BackupInfo *backups)
+print_storage_section(const char *backup_dir, const BackupStats *stats)
 {
 	const char *col = use_color ? COLOR_CYAN : "";
 	const char *rst = use_color ? COLOR_RESET : "";
-	printf("%sSTORAGE%s\n", col, rst);
-
-	/* Sum backup sizes from metadata */
-	uint64_t total_backup_bytes = 0;
-	int      running_count      = 0;
+	report("%sSTORAGE%s\n", col, rst);
 
-	for (BackupInfo *b = backups; b != NULL; b = b->next)
-	{
-		total_backup_bytes += b->data_bytes + b->wal_bytes;
-		if (b->status == BACKUP_STATUS_RUNNING)
-			running_count++;
-	}
+	/* Backup sizes from metadata */
+	uint64_t total_backup_bytes = stats != NULL ? stats->total_bytes : 0;
+	int      running_count      = stats != NULL
+		? stats->status_count[BACKUP_STATUS_RUNNING] : 0;
 
 	char size_str[32];
 	format_bytes(total_backup_bytes, size_str, sizeof(size_str));
-	printf("  Total backup size:   %s\n", size_str);
+	report("  Total backup size:   %s\n", size_str);
 
 	/* Disk usage via statvfs */
 	struct statvfs vfs;
-	if (statvfs(backup_dir, &vfs) == 0)
+	bool           have_vfs = statvfs(backup_dir, &vfs) == 0;
+	if (have_vfs)
 	{
 		uint64_t disk_total = (uint64_t)vfs.f_blocks * vfs.f_frsize;
 		uint64_t disk_free  = (uint64_t)vfs.f_bavail * vfs.f_frsize;
@@ -853,21 +999,164 @@ print_storage_section(const char *backup_dir, BackupInfo *backups)
 		format_bytes(disk_total, total_str, sizeof(total_str));
 		format_bytes(disk_free,  free_str,  sizeof(free_str));
 
-		printf("  Disk total:          %s\n", total_str);
-		printf("  Disk free:           %s (%.1f%%)\n", free_str, pct_free);
+		report("  Disk total:          %s\n", total_str);
+		report("  Disk free:           %s (%.1f%%)\n", free_str, pct_free);
 	}
 	else
 	{
-		printf("  Disk usage:          unavailable\n");
+		report("  Disk usage:          unavailable\n");
+	}
+
+	if (!table_output)
+	{
+		NdjsonRecord rec;
+
+		ndjson_begin(&rec, stdout, "storage");
+		ndjson_uint(&rec, "backup_bytes", total_backup_bytes);
+		if (have_vfs)
+		{
+			ndjson_uint(&rec, "disk_total_bytes", (uint64_t)vfs.f_blocks * vfs.f_frsize);
+			ndjson_uint(&rec, "disk_free_bytes", (uint64_t)vfs.f_bavail * vfs.f_frsize);
+		}
+		ndjson_int(&rec, "running", running_count);
+		ndjson_end(&rec);
 	}
 
 	/* RUNNING backups */
 	if (running_count > 0)
-		printf("  %s[WARNING]%s %d backup%s currently RUNNING\n",
+		report("  %s[WARNING]%s %d backup%s currently RUNNING\n",
 			   use_color ? COLOR_YELLOW : "", use_color ? COLOR_RESET : "",
 			   running_count, running_count == 1 ? " is" : "s are");
 	else
-		printf("  Backups RUNNING:     none\n");
+		report("  Backups RUNNING:     none\n");
+}
+
+/* ------------------------------------------------------------------ *
+ * Section: retention
+ * ------------------------------------------------------------------ */
+
+/*
+ * What each --retention policy would expire, per instance and per WAL
+ * archive.  Returns false if a policy cannot be met by some instance.
+ */
+static bool
+print_retention_section(const AuditOptions *opts, const RetentionPlan *plan,
+						const WALArchiveSet *wal_set)
+{
+	const char *col = use_color ? COLOR_CYAN : "";
+	const char *rst = use_color ? COLOR_RESET : "";
+	bool        all_met = true;
+	RetentionInstanceResult *inst;
+	RetentionArchiveResult  *arch;
+
+	report("%sRETENTION%s\n", col, rst);
+
+	inst = calloc(plan->ninstances > 0 ? plan->ninstances : 1, sizeof(*inst));
+	arch = calloc(plan->narchives > 0 ? plan->narchives : 1, sizeof(*arch));
+	if (inst == NULL || arch == NULL)
+	{
+		log_error("Out of memory while planning retention");
+		free(inst);
+		free(arch);
+		return false;
+	}
+
+	for (int p = 0; p < opts->nretention; p++)
+	{
+		char policy_str[128];
+
+		retention_policy_format(&opts->retention[p], policy_str, sizeof(policy_str));
+		retention_plan_evaluate(plan, &opts->retention[p], inst, arch);
+
+		if (p > 0)
+			report("\n");
+		report("  Policy:     %s\n", policy_str);
+
+		for (int i = 0; i < plan->ninstances; i++)
+		{
+			const RetentionInstance       *ri = &plan->instances[i];
+			const RetentionInstanceResult *r  = &inst[i];
+			const char *name = ri->instance[0] != '\0' ? ri->instance : "(default)";
+			char        size_str[32];
+
+			if (opts->retention[p].instance[0] != '\0' &&
+				strcmp(opts->retention[p].instance, ri->instance) != 0)
+				continue;
+
+			format_bytes(r->bytes, size_str, sizeof(size_str));
+			if (r->keep_from < ri->nchains)
+				report("  %-10s  keeps %d of %d chain%s from %s; expendable: %d chain%s, %d backup%s, %s\n",
+					   name, ri->nchains - r->keep_from, ri->nchains,
+					   ri->nchains == 1 ? "" : "s",
+					   ri->chains[r->keep_from]->root->backup_id,
+					   r->chains, r->chains == 1 ? "" : "s",
+					   r->backups, r->backups == 1 ? "" : "s", size_str);
+			else
+				report("  %-10s  keeps none of %d chain%s; expendable: %d backup%s, %s\n",
+					   name, ri->nchains, ri->nchains == 1 ? "" : "s",
+					   r->backups, r->backups == 1 ? "" : "s", size_str);
+			if (!r->met)
+			{
+				report("              %s[NOT MET]%s too few OK chains to satisfy the policy\n",
+					   use_color ? COLOR_YELLOW : "", use_color ? COLOR_RESET : "");
+				all_met = false;
+			}
+
+			if (!table_output)
+			{
+				NdjsonRecord rec;
+
+				ndjson_begin(&rec, stdout, "retention");
+				ndjson_int(&rec, "policy", p + 1);
+				ndjson_string(&rec, "rule", policy_str);
+				ndjson_string(&rec, "instance", ri->instance);
+				ndjson_int(&rec, "chains", ri->nchains);
+				ndjson_int(&rec, "kept_chains", ri->nchains - r->keep_from);
+				ndjson_int(&rec, "expendable_chains", r->chains);
+				ndjson_int(&rec, "expendable_backups", r->backups);
+				ndjson_uint(&rec, "expendable_bytes", r->bytes);
+				if (r->keep_from < ri->nchains)
+					ndjson_string(&rec, "keep_from", ri->chains[r->keep_from]->root->backup_id);
+				else
+					ndjson_null(&rec, "keep_from");
+				ndjson_bool(&rec, "met", r->met);
+				ndjson_end(&rec);
+			}
+		}
+
+		for (int a = 0; a < plan->narchives; a++)
+		{
+			const RetentionArchiveResult *r = &arch[a];
+			char from_str[32], upto_str[32], size_str[32];
+
+			if (r->segments == 0)
+				continue;
+			format_lsn(r->from, from_str, sizeof(from_str));
+			format_lsn(r->keep_from, upto_str, sizeof(upto_str));
+			format_bytes(r->bytes, size_str, sizeof(size_str));
+			report("  WAL:        %s: %d segment%s, %s expendable (%s to %s)\n",
+				   wal_set->archives[a].path, r->segments,
+				   r->segments == 1 ? "" : "s", size_str, from_str, upto_str);
+
+			if (!table_output)
+			{
+				NdjsonRecord rec;
+
+				ndjson_begin(&rec, stdout, "retention_wal");
+				ndjson_int(&rec, "policy", p + 1);
+				ndjson_string(&rec, "archive", wal_set->archives[a].path);
+				ndjson_int(&rec, "segments", r->segments);
+				ndjson_uint(&rec, "bytes", r->bytes);
+				ndjson_lsn(&rec, "from_lsn", r->from);
+				ndjson_lsn(&rec, "up_to_lsn", r->keep_from);
+				ndjson_end(&rec);
+			}
+		}
+	}
+
+	free(inst);
+	free(arch);
+	return all_met;
 }
 
 /* ------------------------------------------------------------------ *
@@ -879,8 +1168,9 @@ cmd_audit_main(int argc, char **argv)
 {
 	AuditOptions    opts;
 	BackupInfo     *backups         = NULL;
-	WALArchiveInfo *wal_info        = NULL;
-	char           *wal_path_alloc  = NULL;  /* auto-detected path, must be freed */
+	WALArchiveSet  *wal_set         = NULL;
+	uint64_t        started         = metrics_clock();
+	MetricSpan      span;
 	int ret;
 
 	init_options(&opts);
@@ -895,6 +1185,13 @@ cmd_audit_main(int argc, char **argv)
 	if (ret != EXIT_SUCCESS)
 		return ret;
 
+	table_output = opts.output == OUTPUT_TABLE;
+	validation_set_cache_dir(opts.cache_dir);
+	scan_set_jobs(opts.jobs);
+	if (!storage_resolve(&opts.backup_dir, STAGE_METADATA) ||
+		!storage_resolve(&opts.wal_archive, STAGE_METADATA))
+		return EXIT_GENERAL_ERROR;
+
 	/* Scan backup directory */
 	log_info("Scanning backup directory: %s", opts.backup_dir);
 	backups = scan_backup_directory(opts.backup_dir, -1);
@@ -904,57 +1201,34 @@ cmd_audit_main(int argc, char **argv)
 		return EXIT_GENERAL_ERROR;
 	}
 
-	/* Scan WAL archive — explicit or auto-detected */
-	const char *wal_archive_display = opts.wal_archive;  /* path shown in output */
-
-	if (opts.wal_archive != NULL)
+	/* Scan WAL archives — explicit, or one per instance/stanza */
+	wal_set = wal_archive_set_build(backups, opts.wal_archive);
+	if (wal_set == NULL)
 	{
-		log_info("Scanning WAL archive: %s", opts.wal_archive);
-		wal_info = scan_wal_archive(opts.wal_archive);
-		if (wal_info == NULL)
-			log_warning("Failed to scan WAL archive: %s", opts.wal_archive);
-		else
-			log_info("Found %d WAL segments in archive", wal_info->segment_count);
-	}
-	else
-	{
-		/* Auto-detect WAL archive for archive-mode backups */
-		for (BackupInfo *b = backups; b != NULL; b = b->next)
-		{
-			if (b->wal_stream || b->start_lsn == 0)
-				continue;
-			BackupAdapter *adapter = get_adapter_for_tool(b->tool);
-			if (adapter == NULL || adapter->get_wal_archive_path == NULL)
-				continue;
-			char *wal_path = adapter->get_wal_archive_path(
-				b->backup_path, b->instance_name);
-			if (wal_path == NULL)
-				continue;
-			log_info("Auto-detected WAL archive: %s", wal_path);
-			wal_info = scan_wal_archive(wal_path);
-			if (wal_info != NULL)
-			{
-				wal_path_alloc    = wal_path;
-				wal_archive_display = wal_path_alloc;
-				log_info("Found %d WAL segments in archive", wal_info->segment_count);
-			}
-			else
-			{
-				free(wal_path);
-			}
-			break;
-		}
+		free_backup_list(backups);
+		return EXIT_GENERAL_ERROR;
 	}
 
 	/* Build chains */
 	int          nchains = 0;
+	metrics_phase_begin(&span, METRIC_PHASE_ANALYSIS);
 	BackupChain *chains  = backup_chain_build(backups, &nchains);
+	metrics_phase_end(&span);
 	if (chains == NULL)
 	{
 		fprintf(stderr, "Error: Failed to build backup chains\n");
 		free_backup_list(backups);
-		if (wal_info != NULL)
-			free_wal_archive_info(wal_info);
+		wal_archive_set_free(wal_set);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	/* Chains by instance and archive, for the cleanup and --retention figures */
+	RetentionPlan *plan = retention_plan_build(chains, nchains, wal_set, time(NULL));
+	if (plan == NULL)
+	{
+		backup_chain_free(chains, nchains);
+		free_backup_list(backups);
+		wal_archive_set_free(wal_set);
 		return EXIT_GENERAL_ERROR;
 	}
 
@@ -967,16 +1241,16 @@ cmd_audit_main(int argc, char **argv)
 		const char *title_col = use_color ? COLOR_CYAN : "";
 		const char *rst = use_color ? COLOR_RESET : "";
 
-		printf("%sBackup Audit%s\n", title_col, rst);
+		report("%sBackup Audit%s\n", title_col, rst);
 		char resolved_dir[PATH_MAX];
 		const char *display_dir = opts.backup_dir;
 		if (realpath(opts.backup_dir, resolved_dir) != NULL)
 			display_dir = resolved_dir;
-		printf("Directory:  %s\n", display_dir);
-		printf("Time:       %s\n", now_str);
+		report("Directory:  %s\n", display_dir);
+		report("Time:       %s\n", now_str);
 	}
 
-	printf("\n");
+	report("\n");
 
 	/* Separate FULL chains from the orphaned bucket (always last if non-empty) */
 	int              full_count    = nchains;
@@ -993,97 +1267,132 @@ cmd_audit_main(int argc, char **argv)
 	bool has_degraded = false;
 	bool wal_ok       = true;
 
+	/* Read rates measured by earlier checks, for the restore estimates */
+	RestoreThroughput throughput;
+	restore_throughput_load(opts.backup_dir, &throughput);
+
 	/* CHAINS section */
 	{
 		const char *col = use_color ? COLOR_CYAN : "";
 		const char *rst = use_color ? COLOR_RESET : "";
-		printf("%sCHAINS%s\n", col, rst);
+		report("%sCHAINS%s\n", col, rst);
 	}
 
 	for (int ci = 0; ci < full_count; ci++)
 	{
-		ChainStatus cs = print_chain_audit(&chains[ci], ci + 1, wal_info);
+		ChainStatus cs = print_chain_audit(&chains[ci], ci + 1,
+										   wal_archive_set_lookup(wal_set, chains[ci].root),
+										   &throughput, &opts);
 		if (cs == CHAIN_STATUS_BROKEN)   has_broken   = true;
 		if (cs == CHAIN_STATUS_DEGRADED) has_degraded = true;
 	}
 
-	printf("\n────────────────────────────────────────────────────────────────\n");
+	report("\n────────────────────────────────────────────────────────────────\n");
 
 	/* Orphaned backups */
 	if (orphan_bucket != NULL && orphan_bucket->count > 0)
 	{
 		print_orphans_section(orphan_bucket);
-		printf("────────────────────────────────────────────────────────────────\n");
+		report("────────────────────────────────────────────────────────────────\n");
 		has_degraded = true;
 	}
 
-	/* Anomaly detection */
-	int stats_count = 0;
-	BackupTypeStats *stats = calculate_backup_stats(backups, &stats_count);
+	/*
+	 * Anomaly detection against per-instance baselines; with a cache
+	 * directory only backups since the last run are scored
+	 */
+	metrics_phase_begin(&span, METRIC_PHASE_ANALYSIS);
+	BackupStats *stats = backup_stats_build(backups, BACKUP_STATS_BY_TOOL);
+	AnomalyDetector *detector = anomaly_detector_open(opts.backup_dir);
 	AnomalyList *anomalies = NULL;
-	if (stats != NULL && stats_count > 0)
+	if (detector != NULL)
 	{
-		anomalies = detect_anomalies(backups, stats, stats_count, opts.detect_size_small);
+		anomalies = detect_anomalies(backups, detector, opts.detect_size_small);
+		anomaly_detector_close(detector);
 	}
+	metrics_phase_end(&span);
 	if (anomalies != NULL && anomalies->count > 0)
 	{
 		print_anomalies_section(anomalies);
-		printf("────────────────────────────────────────────────────────────────\n");
+		report("────────────────────────────────────────────────────────────────\n");
 		has_degraded = true;
 	}
 
 	/* WAL section */
-	wal_ok = print_wal_section(wal_archive_display, wal_info, backups);
+	wal_ok = print_wal_section(wal_set, plan);
 	if (!wal_ok)
 		has_degraded = true;
 
-	printf("────────────────────────────────────────────────────────────────\n");
+	report("────────────────────────────────────────────────────────────────\n");
 
 	/* STORAGE section */
-	print_storage_section(opts.backup_dir, backups);
+	print_storage_section(opts.backup_dir, stats);
+
+	report("\n────────────────────────────────────────────────────────────────\n");
 
-	printf("\n────────────────────────────────────────────────────────────────\n");
+	/* RETENTION section */
+	if (opts.nretention > 0)
+	{
+		if (!print_retention_section(&opts, plan, wal_set))
+			has_degraded = true;
+		report("\n────────────────────────────────────────────────────────────────\n");
+	}
 
 	/* Verdict */
 	if (has_broken)
 	{
 		const char *col = use_color ? COLOR_RED    : "";
 		const char *rst = use_color ? COLOR_RESET  : "";
-		printf("%s✗ Verdict: CRITICAL%s\n", col, rst);
+		report("%s✗ Verdict: CRITICAL%s\n", col, rst);
 		if (full_count == 0)
-			printf("  No complete backup chains found.\n");
+			report("  No complete backup chains found.\n");
 		else
-			printf("  One or more backup chains are BROKEN and cannot be restored.\n");
+			report("  One or more backup chains are BROKEN and cannot be restored.\n");
 	}
 	else if (has_degraded)
 	{
 		const char *col = use_color ? COLOR_YELLOW : "";
 		const char *rst = use_color ? COLOR_RESET  : "";
-		printf("%s⚠ Verdict: WARNING%s\n", col, rst);
-		printf("  Backup chains are restorable but issues were detected.\n");
+		report("%s⚠ Verdict: WARNING%s\n", col, rst);
+		report("  Backup chains are restorable but issues were detected.\n");
 	}
 	else
 	{
 		const char *col = use_color ? COLOR_GREEN  : "";
 		const char *rst = use_color ? COLOR_RESET  : "";
-		printf("%s✓ Verdict: OK%s\n", col, rst);
-		printf("  All backup chains are healthy and restorable.\n");
+		report("%s✓ Verdict: OK%s\n", col, rst);
+		report("  All backup chains are healthy and restorable.\n");
 	}
 
+	if (!table_output)
+	{
+		NdjsonRecord rec;
+
+		ndjson_begin(&rec, stdout, "summary");
+		ndjson_int(&rec, "chains", full_count);
+		ndjson_int(&rec, "orphans", orphan_bucket != NULL ? orphan_bucket->count : 0);
+		ndjson_int(&rec, "anomalies", anomalies != NULL ? anomalies->count : 0);
+		ndjson_bool(&rec, "wal_ok", wal_ok);
+		ndjson_string(&rec, "verdict",
+					  has_broken ? "critical" : has_degraded ? "warning" : "ok");
+		ndjson_end(&rec);
+	}
+
+	/* On stderr, so it never mixes with NDJSON output */
+	if (opts.profile)
+		metrics_profile_write(stderr, (double) (metrics_clock() - started) / 1e9);
+
 	/* Cleanup */
 	if (anomalies != NULL)
 	{
 		free(anomalies->items);
 		free(anomalies);
 	}
-	if (stats != NULL)
-		free(stats);
+	backup_stats_free(stats);
+	retention_plan_free(plan);
 	backup_chain_free(chains, nchains);
 	free_backup_list(backups);
-	if (wal_info != NULL)
-		free_wal_archive_info(wal_info);
-	if (wal_path_alloc != NULL)
-		free(wal_path_alloc);
+	wal_archive_set_free(wal_set);
 
 	return (has_broken || has_degraded) ? EXIT_VALIDATION_FAILED : EXIT_SUCCESS;
 }
@@ -25,10 +25,24 @@
 #include "arg_parser.h"
 #include "adapter.h"
 #include "backup_chain.h"
+#include "digest_cache.h"
+#include "wal_archive_set.h"
+#include "validation_scheduler.h"
+#include "verify_sample.h"
+#include "verify_shard.h"
+#include "ndjson.h"
+#include "validation_result.h"
+#include "metrics.h"
+#include "restore_estimate.h"
+#include "storage.h"
+#include "buffer_pool.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <time.h>
 
 /* Command-line options */
 typedef struct {
@@ -37,8 +51,45 @@ typedef struct {
 	char *wal_archive;
 	ValidationLevel level;
 	bool skip_wal;
+	bool wal_headers_only;  /* WAL: page headers only, no record pass */
+	int jobs;               /* Worker threads for scanning and verification */
+	char *cache_dir;        /* WAL verification cache, or NULL */
+	char *wal_summaries;    /* WAL summaries for incremental backups, or NULL */
+	char *io_engine;        /* "auto", "io_uring" or "sync"; NULL = auto */
+	PageCacheMode page_cache;
+	uint64_t max_read_rate; /* bytes per second, 0 = unlimited */
+	int max_iops;           /* 0 = unlimited */
+	uint64_t memory_limit;  /* bytes of read buffers, 0 = unlimited */
+	double sample;          /* fraction of files verified, 1 = all */
+	SampleUnit sample_by;
+	int sample_seed;        /* rotation step, -1 = days since the epoch */
+	int shard_index;        /* --shard K/N; 1/1 = not sharded */
+	int shard_count;
+	OutputFormat output;
+	bool fail_fast;         /* stop at the first error */
+	bool latest_chain_only; /* newest restorable chain per instance */
+	char *metrics_file;     /* Prometheus textfile, or NULL */
+	bool profile;           /* print the --profile report */
 } CheckOptions;
 
+static const char *const level_names[] = {"basic", "standard", "checksums", "full", "pages"};
+
+/* False with --format=ndjson: the report text is not printed */
+static bool table_output = true;
+
+/* printf() for the human-readable report */
+static void
+report(const char *fmt, ...)
+{
+	va_list args;
+
+	if (!table_output)
+		return;
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+}
+
 static void
 init_options(CheckOptions *opts)
 {
@@ -47,6 +98,25 @@ init_options(CheckOptions *opts)
 	opts->wal_archive = NULL;
 	opts->level = VALIDATION_LEVEL_STANDARD;  /* default: level 2 */
 	opts->skip_wal = false;
+	opts->wal_headers_only = false;
+	opts->jobs = DEFAULT_THREADS;
+	opts->cache_dir = NULL;
+	opts->wal_summaries = NULL;
+	opts->io_engine = NULL;
+	opts->page_cache = PAGE_CACHE_USE;
+	opts->max_read_rate = 0;
+	opts->max_iops = 0;
+	opts->memory_limit = 0;
+	opts->sample = 1.0;
+	opts->sample_by = SAMPLE_BY_COUNT;
+	opts->sample_seed = -1;
+	opts->shard_index = 1;
+	opts->shard_count = 1;
+	opts->output = OUTPUT_TABLE;
+	opts->fail_fast = false;
+	opts->latest_chain_only = false;
+	opts->metrics_file = NULL;
+	opts->profile = false;
 }
 
 static int
@@ -59,6 +129,24 @@ parse_arguments(int argc, char **argv, CheckOptions *opts)
 	bool wal_archive_seen = false;
 	bool level_seen = false;
 	bool skip_wal_seen = false;
+	bool wal_headers_only_seen = false;
+	bool jobs_seen = false;
+	bool cache_dir_seen = false;
+	bool wal_summaries_seen = false;
+	bool io_engine_seen = false;
+	bool page_cache_seen = false;
+	bool max_read_rate_seen = false;
+	bool max_iops_seen = false;
+	bool memory_limit_seen = false;
+	bool sample_seen = false;
+	bool sample_by_seen = false;
+	bool sample_seed_seen = false;
+	bool shard_seen = false;
+	bool format_seen = false;
+	bool fail_fast_seen = false;
+	bool profile_seen = false;
+	bool latest_chain_seen = false;
+	bool metrics_file_seen = false;
 
 	static struct option long_options[] = {
 		{"backup-dir",      required_argument, 0, 'B'},
@@ -66,11 +154,29 @@ parse_arguments(int argc, char **argv, CheckOptions *opts)
 		{"wal-archive",     required_argument, 0, 'w'},
 		{"level",           required_argument, 0, 'l'},
 		{"skip-wal",        no_argument,       0, 'S'},
+		{"wal-headers-only", no_argument,      0, 'H'},
+		{"jobs",            required_argument, 0, 'j'},
+		{"cache-dir",       required_argument, 0, 'C'},
+		{"wal-summaries",   required_argument, 0, 'Y'},
+		{"io-engine",       required_argument, 0, 'E'},
+		{"page-cache",      required_argument, 0, 'P'},
+		{"max-read-rate",   required_argument, 0, 'R'},
+		{"max-iops",        required_argument, 0, 'O'},
+		{"memory-limit",    required_argument, 0, 'm'},
+		{"sample",          required_argument, 0, 'A'},
+		{"sample-by",       required_argument, 0, 'U'},
+		{"sample-seed",     required_argument, 0, 'D'},
+		{"shard",           required_argument, 0, 'K'},
+		{"format",          required_argument, 0, 'f'},
+		{"fail-fast",       no_argument,       0, 'F'},
+		{"latest-chain-only", no_argument,     0, 'L'},
+		{"metrics-file",    required_argument, 0, 'M'},
+		{"profile",         no_argument,       0, 'T'},
 		{"help",            no_argument,       0, 'h'},
 		{0, 0, 0, 0}
 	};
 
-	while ((c = getopt_long(argc, argv, "B:i:w:l:h",
+	while ((c = getopt_long(argc, argv, "B:i:w:l:j:f:h",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -93,7 +199,7 @@ parse_arguments(int argc, char **argv, CheckOptions *opts)
 				if (!validation_level_from_string(optarg, &opts->level))
 				{
 					fprintf(stderr, "Error: Invalid validation level: %s\n", optarg);
-					fprintf(stderr, "Valid levels: basic, standard, checksums, full\n");
+					fprintf(stderr, "Valid levels: basic, standard, checksums, full, pages\n");
 					return EXIT_INVALID_ARGUMENTS;
 				}
 				level_seen = true;
@@ -104,6 +210,165 @@ parse_arguments(int argc, char **argv, CheckOptions *opts)
 				opts->skip_wal = true;
 				skip_wal_seen = true;
 				break;
+			case 'H':
+				if (check_duplicate_option(wal_headers_only_seen, "--wal-headers-only"))
+					return EXIT_INVALID_ARGUMENTS;
+				opts->wal_headers_only = true;
+				wal_headers_only_seen = true;
+				break;
+			case 'j':
+				if (check_duplicate_option(jobs_seen, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_int_argument(optarg, &opts->jobs, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->jobs < 1)
+				{
+					fprintf(stderr, "Error: --jobs must be >= 1\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				jobs_seen = true;
+				break;
+			case 'C':
+				if (!parse_string_option("--cache-dir", optarg, &opts->cache_dir, &cache_dir_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'Y':
+				if (!parse_string_option("--wal-summaries", optarg, &opts->wal_summaries, &wal_summaries_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'E':
+				if (!parse_string_option("--io-engine", optarg, &opts->io_engine, &io_engine_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				if (strcmp(optarg, "auto") != 0 && strcmp(optarg, "io_uring") != 0 &&
+					strcmp(optarg, "sync") != 0)
+				{
+					fprintf(stderr, "Error: Invalid I/O engine: %s\n", optarg);
+					fprintf(stderr, "Valid engines: auto, io_uring, sync\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				break;
+			case 'P':
+				if (check_duplicate_option(page_cache_seen, "--page-cache"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (strcmp(optarg, "use") == 0)
+					opts->page_cache = PAGE_CACHE_USE;
+				else if (strcmp(optarg, "drop") == 0)
+					opts->page_cache = PAGE_CACHE_DROP;
+				else if (strcmp(optarg, "direct") == 0)
+					opts->page_cache = PAGE_CACHE_DIRECT;
+				else
+				{
+					fprintf(stderr, "Error: Invalid page cache mode: %s\n", optarg);
+					fprintf(stderr, "Valid modes: use, drop, direct\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				page_cache_seen = true;
+				break;
+			case 'R':
+				if (check_duplicate_option(max_read_rate_seen, "--max-read-rate"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_size_argument(optarg, &opts->max_read_rate, "--max-read-rate"))
+					return EXIT_INVALID_ARGUMENTS;
+				max_read_rate_seen = true;
+				break;
+			case 'O':
+				if (check_duplicate_option(max_iops_seen, "--max-iops"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_int_argument(optarg, &opts->max_iops, "--max-iops"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->max_iops < 0)
+				{
+					fprintf(stderr, "Error: --max-iops must be >= 0\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				max_iops_seen = true;
+				break;
+			case 'm':
+				if (check_duplicate_option(memory_limit_seen, "--memory-limit"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_size_argument(optarg, &opts->memory_limit, "--memory-limit"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->memory_limit > 0 && opts->memory_limit < BUFFER_POOL_MIN_LIMIT)
+				{
+					fprintf(stderr, "Error: --memory-limit must be at least 1M\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				memory_limit_seen = true;
+				break;
+			case 'A':
+				if (check_duplicate_option(sample_seen, "--sample"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_fraction_argument(optarg, &opts->sample, "--sample"))
+					return EXIT_INVALID_ARGUMENTS;
+				sample_seen = true;
+				break;
+			case 'U':
+				if (check_duplicate_option(sample_by_seen, "--sample-by"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (strcmp(optarg, "count") == 0)
+					opts->sample_by = SAMPLE_BY_COUNT;
+				else if (strcmp(optarg, "bytes") == 0)
+					opts->sample_by = SAMPLE_BY_BYTES;
+				else
+				{
+					fprintf(stderr, "Error: Invalid sample unit: %s\n", optarg);
+					fprintf(stderr, "Valid units: count, bytes\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				sample_by_seen = true;
+				break;
+			case 'D':
+				if (check_duplicate_option(sample_seed_seen, "--sample-seed"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_int_argument(optarg, &opts->sample_seed, "--sample-seed"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->sample_seed < 0)
+				{
+					fprintf(stderr, "Error: --sample-seed must be >= 0\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				sample_seed_seen = true;
+				break;
+			case 'K':
+				if (check_duplicate_option(shard_seen, "--shard"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!shard_from_string(optarg, &opts->shard_index, &opts->shard_count))
+					return EXIT_INVALID_ARGUMENTS;
+				shard_seen = true;
+				break;
+			case 'f':
+				if (check_duplicate_option(format_seen, "--format"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!output_format_from_string(optarg, &opts->output))
+				{
+					fprintf(stderr, "Error: Invalid format: %s\n", optarg);
+					fprintf(stderr, "Valid formats: table, ndjson\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				format_seen = true;
+				break;
+			case 'T':
+				if (check_duplicate_option(profile_seen, "--profile"))
+					return EXIT_INVALID_ARGUMENTS;
+				opts->profile = true;
+				profile_seen = true;
+				break;
+			case 'F':
+				if (check_duplicate_option(fail_fast_seen, "--fail-fast"))
+					return EXIT_INVALID_ARGUMENTS;
+				opts->fail_fast = true;
+				fail_fast_seen = true;
+				break;
+			case 'L':
+				if (check_duplicate_option(latest_chain_seen, "--latest-chain-only"))
+					return EXIT_INVALID_ARGUMENTS;
+				opts->latest_chain_only = true;
+				latest_chain_seen = true;
+				break;
+			case 'M':
+				if (!parse_string_option("--metrics-file", optarg, &opts->metrics_file, &metrics_file_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
 			case 'h':
 				print_check_usage();
 				return EXIT_SUCCESS;
@@ -125,18 +390,46 @@ validate_options(const CheckOptions *opts)
 		return EXIT_INVALID_ARGUMENTS;
 
 	/* Validate paths exist */
-	if (opts->backup_dir != NULL && !is_directory(opts->backup_dir))
+	if (opts->backup_dir != NULL && !storage_is_remote(opts->backup_dir) &&
+		!is_directory(opts->backup_dir))
 	{
 		fprintf(stderr, "Error: Backup directory does not exist: %s\n", opts->backup_dir);
 		return EXIT_GENERAL_ERROR;
 	}
 
-	if (opts->wal_archive != NULL && !is_directory(opts->wal_archive))
+	if (opts->wal_archive != NULL && !storage_is_remote(opts->wal_archive) &&
+		!is_directory(opts->wal_archive))
 	{
 		fprintf(stderr, "Error: WAL archive directory does not exist: %s\n", opts->wal_archive);
 		return EXIT_GENERAL_ERROR;
 	}
 
+	if (opts->cache_dir != NULL && !is_directory(opts->cache_dir))
+	{
+		fprintf(stderr, "Error: Cache directory does not exist: %s\n", opts->cache_dir);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	if (opts->wal_summaries != NULL && !is_directory(opts->wal_summaries))
+	{
+		fprintf(stderr, "Error: WAL summaries directory does not exist: %s\n", opts->wal_summaries);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	if (opts->wal_headers_only &&
+		(opts->skip_wal || opts->level < VALIDATION_LEVEL_CHECKSUMS))
+	{
+		fprintf(stderr, "Error: --wal-headers-only needs WAL checks "
+				"(--level=checksums or above, without --skip-wal)\n");
+		return EXIT_INVALID_ARGUMENTS;
+	}
+
+	if (opts->latest_chain_only && opts->backup_id != NULL)
+	{
+		fprintf(stderr, "Error: --latest-chain-only cannot be used with --backup-id\n");
+		return EXIT_INVALID_ARGUMENTS;
+	}
+
 	return EXIT_SUCCESS;
 }
 
@@ -146,21 +439,238 @@ static void
 print_validation_result(ValidationResult *result, const char *indent)
 {
 	for (int i = 0; i < result->error_count; i++)
-		printf("%s  %s[ERROR]%s %s\n",
+		report("%s  %s[ERROR]%s %s\n",
 			   indent,
 			   use_color ? COLOR_RED   : "", use_color ? COLOR_RESET : "",
 			   result->errors[i]);
 	for (int i = 0; i < result->warning_count; i++)
-		printf("%s  %s[WARNING]%s %s\n",
+		report("%s  %s[WARNING]%s %s\n",
 			   indent,
 			   use_color ? COLOR_YELLOW : "", use_color ? COLOR_RESET : "",
 			   result->warnings[i]);
 	if (result->error_count == 0 && result->warning_count == 0)
-		printf("%s  %s[OK]%s Backup validation: passed\n",
+		report("%s  %s[OK]%s Backup validation: passed\n",
 			   indent,
 			   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "");
 }
 
+/* What --sample read this run, and how long a full rotation takes */
+static void
+print_sample_coverage(int step)
+{
+	SampleCoverage files;
+	SampleCoverage wal;
+
+	sample_coverage(SAMPLE_FILES, &files);
+	sample_coverage(SAMPLE_WAL_SEGMENTS, &wal);
+
+	report("  Sampled files:          %llu of %llu (%.1f%% of bytes)\n",
+		   (unsigned long long) files.items_checked,
+		   (unsigned long long) files.items,
+		   files.bytes > 0 ? 100.0 * (double) files.bytes_checked / (double) files.bytes
+		   : 100.0);
+	if (wal.items > 0)
+		report("  Sampled WAL segments:   %llu of %llu (%.1f%% of bytes)\n",
+			   (unsigned long long) wal.items_checked,
+			   (unsigned long long) wal.items,
+			   wal.bytes > 0 ? 100.0 * (double) wal.bytes_checked / (double) wal.bytes
+			   : 100.0);
+	report("  Sample rotation:        step %d; every item within %d run%s\n",
+		   step, validation_sample_runs(), validation_sample_runs() == 1 ? "" : "s");
+}
+
+/*
+ * Order-independent fingerprint of the scanned catalog, so that 'merge'
+ * can tell whether its parts were run against the same backups
+ */
+static uint64_t
+catalog_fingerprint(const BackupInfo *backups, int *count)
+{
+	uint64_t sum = 0;
+
+	*count = 0;
+	for (const BackupInfo *b = backups; b != NULL; b = b->next)
+	{
+		char name[512];
+
+		snprintf(name, sizeof(name), "%s/%s/%s", backup_tool_to_string(b->tool),
+				 b->instance_name, b->backup_id);
+		sum += sample_key(name);
+		(*count)++;
+	}
+	return sum;
+}
+
+/* The first record of a --shard run, identifying the part for 'merge' */
+static void
+emit_shard(const CheckOptions *opts, const BackupInfo *backups)
+{
+	NdjsonRecord rec;
+	char         catalog[17];
+	int          count;
+
+	snprintf(catalog, sizeof(catalog), "%016" PRIx64,
+			 catalog_fingerprint(backups, &count));
+	ndjson_begin(&rec, stdout, "shard");
+	ndjson_int(&rec, "index", opts->shard_index);
+	ndjson_int(&rec, "count", opts->shard_count);
+	ndjson_string(&rec, "level", level_names[opts->level]);
+	ndjson_string(&rec, "catalog", catalog);
+	ndjson_int(&rec, "backups", count);
+	ndjson_end(&rec);
+}
+
+/* A backup's outcome; 'result' is NULL for one skipped for its status */
+static void
+emit_backup(const BackupInfo *backup, const BackupInfo *root,
+			const ValidationResult *result)
+{
+	NdjsonRecord rec;
+	const char  *outcome = "skipped";
+
+	if (result != NULL)
+		outcome = result->error_count > 0 ? "error" :
+			result->warning_count > 0 ? "warning" : "ok";
+
+	ndjson_begin(&rec, stdout, "backup");
+	ndjson_backup_fields(&rec, backup);
+	ndjson_string(&rec, "chain", root != NULL ? root->backup_id : NULL);
+	ndjson_string(&rec, "result", outcome);
+	ndjson_int(&rec, "errors", result != NULL ? result->error_count : 0);
+	ndjson_int(&rec, "warnings", result != NULL ? result->warning_count : 0);
+	ndjson_end(&rec);
+
+	if (result != NULL)
+		ndjson_findings(stdout, result, backup->backup_id, NULL, "backup");
+}
+
+static void
+emit_chain(const BackupChain *chain)
+{
+	NdjsonRecord rec;
+
+	ndjson_begin(&rec, stdout, "chain");
+	ndjson_string(&rec, "root", chain->root != NULL ? chain->root->backup_id : NULL);
+	ndjson_bool(&rec, "orphaned", chain->root == NULL);
+	if (chain->root != NULL)
+	{
+		ndjson_string(&rec, "tool", backup_tool_to_string(chain->root->tool));
+		ndjson_time(&rec, "start_time", chain->root->start_time);
+	}
+	ndjson_int(&rec, "members", chain->count);
+	ndjson_end(&rec);
+}
+
+/* One archive-wide WAL check and its findings */
+static void
+emit_wal_check(const char *archive, const char *check,
+			   const ValidationResult *result)
+{
+	NdjsonRecord rec;
+
+	ndjson_begin(&rec, stdout, "wal_check");
+	ndjson_string(&rec, "archive", archive);
+	ndjson_string(&rec, "check", check);
+	ndjson_int(&rec, "errors", result->error_count);
+	ndjson_end(&rec);
+	ndjson_findings(stdout, result, NULL, archive, check);
+}
+
+/* The closing record, with the run's totals */
+static void
+emit_summary(int found, int validated, int skipped, int errors, int warnings,
+			 bool stopped)
+{
+	NdjsonRecord rec;
+	const char  *outcome = "ok";
+
+	if (errors > 0)
+		outcome = "failed";
+	else if (warnings > 0)
+		outcome = "warning";
+	else if (validated == 0 && skipped > 0)
+		outcome = "none";
+
+	ndjson_begin(&rec, stdout, "summary");
+	ndjson_int(&rec, "backups_found", found);
+	ndjson_int(&rec, "backups_validated", validated);
+	ndjson_int(&rec, "backups_skipped", skipped);
+	ndjson_int(&rec, "errors", errors);
+	ndjson_int(&rec, "warnings", warnings);
+	ndjson_bool(&rec, "stopped", stopped);
+	if (validation_sample_active())
+	{
+		SampleCoverage files;
+		SampleCoverage wal;
+
+		sample_coverage(SAMPLE_FILES, &files);
+		sample_coverage(SAMPLE_WAL_SEGMENTS, &wal);
+		ndjson_uint(&rec, "sampled_files", files.items_checked);
+		ndjson_uint(&rec, "checksummed_files", files.items);
+		ndjson_uint(&rec, "sampled_wal_segments", wal.items_checked);
+		ndjson_uint(&rec, "wal_segments", wal.items);
+	}
+	ndjson_string(&rec, "result", outcome);
+	ndjson_end(&rec);
+}
+
+/* Number of backups across all chains */
+static size_t
+count_chain_members(const BackupChain *chains, int nchains)
+{
+	size_t n = 0;
+
+	for (int ci = 0; ci < nchains; ci++)
+		n += (size_t) chains[ci].count;
+	return n;
+}
+
+/* A chain can be restored from when its FULL root is usable */
+static bool
+chain_restorable(const BackupChain *chain)
+{
+	return chain->root != NULL &&
+		chain->root->status != BACKUP_STATUS_ERROR &&
+		chain->root->status != BACKUP_STATUS_CORRUPT;
+}
+
+/*
+ * --latest-chain-only: mark the newest restorable chain of each tool and
+ * instance in 'selected'.  Orphaned groups are never selected.
+ */
+static void
+select_latest_chains(const BackupChain *chains, int nchains, bool *selected)
+{
+	for (int ci = 0; ci < nchains; ci++)
+	{
+		const BackupInfo *root = chains[ci].root;
+
+		selected[ci] = chain_restorable(&chains[ci]);
+		for (int cj = 0; selected[ci] && cj < nchains; cj++)
+		{
+			const BackupInfo *other = chains[cj].root;
+
+			if (cj == ci || !chain_restorable(&chains[cj]) ||
+				other->tool != root->tool ||
+				strcmp(other->instance_name, root->instance_name) != 0)
+				continue;
+			if (other->start_time > root->start_time ||
+				(other->start_time == root->start_time && cj > ci))
+				selected[ci] = false;
+		}
+	}
+}
+
+/* Whether 'backup' is one of the 'count' backups in 'scope' */
+static bool
+in_scope(BackupInfo *const *scope, int count, const BackupInfo *backup)
+{
+	for (int i = 0; i < count; i++)
+		if (scope[i] == backup)
+			return true;
+	return false;
+}
+
 /*
  * cmd_check_main - Main function for the 'check' command
  *
@@ -177,10 +687,16 @@ cmd_check_main(int argc, char **argv)
 {
 	CheckOptions opts;
 	BackupInfo *backups = NULL;
-	WALArchiveInfo *wal_info = NULL;
+	WALArchiveSet *wal_set = NULL;
 	int ret;
 	int total_errors = 0;
 	int total_warnings = 0;
+	bool stopped = false;           /* --fail-fast cut the run short */
+	BackupInfo **scope = NULL;      /* --latest-chain-only members */
+	int scope_count = 0;
+	MetricsReport metrics;
+	uint64_t started = metrics_clock();
+	StageDepth depth;
 
 	/* Initialize options */
 	init_options(&opts);
@@ -197,6 +713,35 @@ cmd_check_main(int argc, char **argv)
 	if (ret != EXIT_SUCCESS)
 		return ret;
 
+	table_output = opts.output == OUTPUT_TABLE;
+	metrics_report_init(&metrics, "check");
+	validation_set_jobs(opts.jobs);
+	validation_set_fail_fast(opts.fail_fast);
+	validation_set_wal_headers_only(opts.wal_headers_only);
+	scan_set_jobs(opts.jobs);
+	validation_set_cache_dir(opts.cache_dir);
+	validation_set_wal_summaries_dir(opts.wal_summaries);
+	if (opts.io_engine != NULL)
+		validation_set_io_engine(opts.io_engine);
+	set_page_cache_mode(opts.page_cache);
+	read_limit_set(opts.max_read_rate, (uint64_t) opts.max_iops);
+	buffer_pool_set_limit(opts.memory_limit);
+	/* A nightly run moves the sample on by one step each day */
+	if (opts.sample_seed < 0)
+		opts.sample_seed = (int) (time(NULL) / 86400);
+	validation_set_sample(opts.sample, opts.sample_by, (uint64_t) opts.sample_seed);
+	validation_set_shard(opts.shard_index, opts.shard_count);
+
+	/*
+	 * Object storage: metadata up front, and for a header-only WAL check
+	 * the first page of each segment.  Checksum and WAL checks fetch each
+	 * backup and batch of segments as they read it (storage_fetch()).
+	 */
+	depth = opts.wal_headers_only ? STAGE_WAL_HEADERS : STAGE_METADATA;
+	if (!storage_resolve(&opts.backup_dir, depth) ||
+		!storage_resolve(&opts.wal_archive, depth))
+		return EXIT_GENERAL_ERROR;
+
 	/* Scan backup directory */
 	log_info("Scanning backup directory: %s", opts.backup_dir);
 	backups = scan_backup_directory(opts.backup_dir, -1);
@@ -207,57 +752,38 @@ cmd_check_main(int argc, char **argv)
 		return EXIT_GENERAL_ERROR;
 	}
 
-	/* Scan WAL archive if provided and WAL checks are not skipped */
-	if (!opts.skip_wal && opts.wal_archive != NULL &&
-		opts.level >= VALIDATION_LEVEL_CHECKSUMS)
+	/*
+	 * Scan WAL archives if WAL checks are not skipped: the one given with
+	 * --wal-archive, or else the archive of every instance or stanza that
+	 * has archive-mode backups (stream=false), each bound to its backups.
+	 */
+	if (!opts.skip_wal && opts.level >= VALIDATION_LEVEL_CHECKSUMS)
 	{
-		log_info("Scanning WAL archive: %s", opts.wal_archive);
-		wal_info = scan_wal_archive(opts.wal_archive);
-		if (wal_info == NULL)
-			log_warning("Failed to scan WAL archive: %s", opts.wal_archive);
-		else
-			log_info("Found %d WAL segments in archive", wal_info->segment_count);
-	}
-
-	/* Auto-detect WAL archive for archive-mode backups (stream=false)
-	 * if --wal-archive was not explicitly provided */
-	if (!opts.skip_wal && wal_info == NULL &&
-		opts.level >= VALIDATION_LEVEL_CHECKSUMS)
-	{
-		BackupInfo *scan = backups;
-		while (scan != NULL)
+		wal_set = wal_archive_set_build(backups, opts.wal_archive);
+		if (wal_set == NULL)
 		{
-			if (!scan->wal_stream && scan->start_lsn > 0)
-			{
-				BackupAdapter *adapter = get_adapter_for_tool(scan->tool);
-				if (adapter != NULL && adapter->get_wal_archive_path != NULL)
-				{
-					char *wal_path = adapter->get_wal_archive_path(
-						scan->backup_path, scan->instance_name);
-					if (wal_path != NULL)
-					{
-						log_info("Auto-detected WAL archive: %s", wal_path);
-						wal_info = scan_wal_archive(wal_path);
-						free(wal_path);
-						if (wal_info != NULL)
-							log_info("Found %d WAL segments in archive",
-									 wal_info->segment_count);
-						break;
-					}
-				}
-			}
-			scan = scan->next;
+			free_backup_list(backups);
+			return EXIT_GENERAL_ERROR;
 		}
 	}
 
 	/* Validate backups */
-	const char *level_names[] = {"basic", "standard", "checksums", "full"};
-	printf("====================================================\n");
-	printf("Backup Validation\n");
-	printf("====================================================\n");
-	printf("Directory:        %s\n", opts.backup_dir);
-	printf("Validation level: %s\n", level_names[opts.level]);
-	printf("====================================================\n");
+	report("====================================================\n");
+	report("Backup Validation\n");
+	report("====================================================\n");
+	report("Directory:        %s\n", opts.backup_dir);
+	report("Validation level: %s\n", level_names[opts.level]);
+	if (opts.latest_chain_only)
+		report("Scope:            latest chain per instance\n");
+	if (opts.wal_headers_only)
+		report("WAL check:        page headers only\n");
+	if (validation_shard_active())
+		report("Shard:            %d of %d (combine the parts with 'merge')\n",
+			   opts.shard_index, opts.shard_count);
+	report("====================================================\n");
+
+	if (!table_output && validation_shard_active())
+		emit_shard(&opts, backups);
 
 	int backup_count = 0;
 	int backups_validated = 0;
@@ -275,31 +801,37 @@ cmd_check_main(int argc, char **argv)
 				continue;
 
 			backup_count++;
-			printf("\n%sBackup:%s %s (%s)\n",
+			report("\n%sBackup:%s %s (%s)\n",
 				   use_color ? COLOR_BOLD : "", use_color ? COLOR_RESET : "",
 				   cur->backup_id, backup_tool_to_string(cur->tool));
 
 			if (cur->status == BACKUP_STATUS_ERROR ||
 				cur->status == BACKUP_STATUS_CORRUPT)
 			{
-				printf("  %s[SKIPPED]%s Status: %s - validation not performed\n",
+				report("  %s[SKIPPED]%s Status: %s - validation not performed\n",
 					   use_color ? COLOR_CYAN  : "", use_color ? COLOR_RESET : "",
 					   backup_status_to_string(cur->status));
+				if (!table_output)
+					emit_backup(cur, NULL, NULL);
 				backups_skipped++;
 			}
 			else
 			{
 				backups_validated++;
-				WALArchiveInfo   *chain_wal = opts.skip_wal ? NULL : wal_info;
+				WALArchiveInfo   *chain_wal = wal_archive_set_lookup(wal_set, cur);
 				ValidationResult *result    =
 					validate_backup_chain(cur, backups, chain_wal, opts.level);
 				if (result != NULL)
 				{
+					if (!table_output)
+						emit_backup(cur, NULL, result);
 					print_validation_result(result, "");
 					total_errors   += result->error_count;
 					total_warnings += result->warning_count;
+					metrics_report_add(&metrics, result);
 					free_validation_result(result);
 				}
+				stopped = opts.fail_fast && total_errors > 0;
 			}
 			break;
 		}
@@ -312,26 +844,95 @@ cmd_check_main(int argc, char **argv)
 		 */
 		int          nchains = 0;
 		BackupChain *chains  = backup_chain_build(backups, &nchains);
+		bool        *selected = NULL;
 
 		if (chains == NULL)
 		{
 			fprintf(stderr, "Error: Failed to build backup chains\n");
 			free_backup_list(backups);
-			if (wal_info != NULL)
-				free_wal_archive_info(wal_info);
+			wal_archive_set_free(wal_set);
 			return EXIT_GENERAL_ERROR;
 		}
 
-		for (int ci = 0; ci < nchains; ci++)
+		if (opts.latest_chain_only)
+		{
+			selected = calloc(nchains > 0 ? (size_t) nchains : 1, sizeof(bool));
+			scope = calloc(count_chain_members(chains, nchains) + 1,
+						   sizeof(BackupInfo *));
+			if (selected == NULL || scope == NULL)
+			{
+				fprintf(stderr, "Error: Memory allocation failed\n");
+				free(selected);
+				free(scope);
+				backup_chain_free(chains, nchains);
+				free_backup_list(backups);
+				wal_archive_set_free(wal_set);
+				return EXIT_GENERAL_ERROR;
+			}
+			select_latest_chains(chains, nchains, selected);
+			for (int ci = 0; ci < nchains; ci++)
+				for (int mi = 0; selected[ci] && mi < chains[ci].count; mi++)
+					scope[scope_count++] = chains[ci].members[mi];
+		}
+
+		/*
+		 * Chains, and the members within a chain, are validated
+		 * independently: queue every backup that will be validated, in
+		 * display order, and print each result as it becomes available.
+		 */
+		int                  ntasks = 0;
+		int                  next_task = 0;
+		ValidationTask      *tasks = calloc(count_chain_members(chains, nchains) + 1,
+											sizeof(ValidationTask));
+		ValidationScheduler *sched = NULL;
+
+		if (tasks != NULL)
+		{
+			for (int ci = 0; ci < nchains; ci++)
+			{
+				if (selected != NULL && !selected[ci])
+					continue;
+				for (int mi = 0; mi < chains[ci].count; mi++)
+				{
+					BackupInfo *cur = chains[ci].members[mi];
+
+					if (cur->status == BACKUP_STATUS_ERROR ||
+						cur->status == BACKUP_STATUS_CORRUPT)
+						continue;
+					tasks[ntasks].backup   = cur;
+					tasks[ntasks].wal_info = wal_archive_set_lookup(wal_set, cur);
+					ntasks++;
+				}
+			}
+			sched = validation_scheduler_start(tasks, ntasks, backups, opts.level);
+		}
+		if (sched == NULL)
+		{
+			fprintf(stderr, "Error: Memory allocation failed\n");
+			free(tasks);
+			free(selected);
+			free(scope);
+			backup_chain_free(chains, nchains);
+			free_backup_list(backups);
+			wal_archive_set_free(wal_set);
+			return EXIT_GENERAL_ERROR;
+		}
+
+		for (int ci = 0; ci < nchains && !stopped; ci++)
 		{
 			BackupChain *chain       = &chains[ci];
 			bool         is_orphaned = (chain->root == NULL);
 
+			if (selected != NULL && !selected[ci])
+				continue;
+
 			/* Chain header */
-			printf("\n");
+			if (!table_output)
+				emit_chain(chain);
+			report("\n");
 			if (is_orphaned)
 			{
-				printf("Orphaned Backups\n");
+				report("Orphaned Backups\n");
 			}
 			else
 			{
@@ -341,195 +942,279 @@ cmd_check_main(int argc, char **argv)
 							 localtime(&chain->root->start_time));
 
 				int incr_count = chain->count - 1;
-				printf("Chain: %s  %s  %s",
+				report("Chain: %s  %s  %s",
 					   chain->root->backup_id,
 					   backup_tool_to_string(chain->root->tool),
 					   date_str);
 				if (incr_count > 0)
-					printf("  (+%d incremental%s)",
+					report("  (+%d incremental%s)",
 						   incr_count, incr_count == 1 ? "" : "s");
-				printf("\n");
+				report("\n");
 			}
-			printf("----------------------------------------------------\n");
+			report("----------------------------------------------------\n");
 
-			for (int mi = 0; mi < chain->count; mi++)
+			for (int mi = 0; mi < chain->count && !stopped; mi++)
 			{
 				BackupInfo *cur    = chain->members[mi];
 				bool        is_incr = (cur->type != BACKUP_TYPE_FULL && !is_orphaned);
 				const char *indent = is_incr ? "  " : "";
 
 				backup_count++;
-				printf("\n");
+				report("\n");
 
-				printf("%s%sBackup:%s %s (%s)",
+				report("%s%sBackup:%s %s (%s)",
 					   indent,
 					   use_color ? COLOR_BOLD  : "", use_color ? COLOR_RESET : "",
 					   cur->backup_id,
 					   backup_type_to_string(cur->type));
 				if (cur->parent_backup_id[0] != '\0')
-					printf("  ->  parent: %s", cur->parent_backup_id);
-				printf("\n");
+					report("  ->  parent: %s", cur->parent_backup_id);
+				report("\n");
 
 				if (cur->status == BACKUP_STATUS_ERROR ||
 					cur->status == BACKUP_STATUS_CORRUPT)
 				{
-					printf("%s  %s[SKIPPED]%s Status: %s - validation not performed\n",
+					report("%s  %s[SKIPPED]%s Status: %s - validation not performed\n",
 						   indent,
 						   use_color ? COLOR_CYAN  : "", use_color ? COLOR_RESET : "",
 						   backup_status_to_string(cur->status));
+					if (!table_output)
+						emit_backup(cur, chain->root, NULL);
 					backups_skipped++;
 					continue;
 				}
 
 				backups_validated++;
 
-				WALArchiveInfo   *chain_wal = opts.skip_wal ? NULL : wal_info;
-				ValidationResult *result    =
-					validate_backup_chain(cur, backups, chain_wal, opts.level);
+				ValidationResult *result =
+					validation_scheduler_wait(sched, next_task++);
 				if (result != NULL)
 				{
+					if (!table_output)
+						emit_backup(cur, chain->root, result);
 					print_validation_result(result, indent);
 					total_errors   += result->error_count;
 					total_warnings += result->warning_count;
-					free_validation_result(result);
+					metrics_report_add(&metrics, result);
 				}
+				stopped = opts.fail_fast && total_errors > 0;
 			}
 		}
 
+		/* Backups not yet started are dropped once a stop is requested */
+		validation_scheduler_finish(sched);
+		for (int ti = 0; ti < ntasks; ti++)
+			free_validation_result(tasks[ti].result);
+		free(tasks);
+		free(selected);
 		backup_chain_free(chains, nchains);
 	}
 
-	/* WAL archive-wide continuity check (once, not per-backup) */
-	if (!opts.skip_wal && wal_info != NULL &&
-		opts.level >= VALIDATION_LEVEL_CHECKSUMS)
+	/*
+	 * WAL archive-wide continuity check (once per archive, not per-backup).
+	 * With --latest-chain-only only the selected chains' restore chain is
+	 * checked; gaps and headers elsewhere in the archive do not affect it.
+	 */
+	int wal_archives_scanned = wal_archive_set_scanned(wal_set);
+	BackupInfo **members = NULL;
+
+	if (scope != NULL && wal_set != NULL)
+		members = calloc((size_t) scope_count + 1, sizeof(BackupInfo *));
+
+	for (int ai = 0; wal_set != NULL && ai < wal_set->count && !stopped; ai++)
 	{
-		printf("\n");
-		printf("WAL Archive\n");
-		printf("----------------------------------------------------\n");
+		WALArchiveSetEntry *archive  = &wal_set->archives[ai];
+		WALArchiveInfo     *wal_info = archive->info;
+		BackupInfo *const  *chain_members = archive->members;
+		int                 chain_count   = archive->member_count;
+
+		if (wal_info == NULL)
+			continue;
+
+		if (scope != NULL)
+		{
+			if (members == NULL)
+				break;
+			chain_members = members;
+			chain_count = 0;
+			for (int mi = 0; mi < archive->member_count; mi++)
+				if (in_scope(scope, scope_count, archive->members[mi]))
+					members[chain_count++] = archive->members[mi];
+			if (chain_count == 0)
+				continue;
+		}
+
+		report("\n");
+		if (wal_archives_scanned > 1)
+			report("WAL Archive: %s\n", archive->path);
+		else
+			report("WAL Archive\n");
+		report("----------------------------------------------------\n");
 
 		/* Check whether any backup in the chain uses stream WAL.
 		 * Stream backups do not store bridge segments (WAL between
 		 * consecutive backups), so missing bridges are expected. */
 		bool chain_has_stream = false;
-		for (BackupInfo *b = backups; b != NULL; b = b->next)
+		for (int mi = 0; mi < chain_count; mi++)
 		{
-			if (b->wal_stream)
+			if (chain_members[mi]->wal_stream)
 			{
 				chain_has_stream = true;
 				break;
 			}
 		}
 
-		ValidationResult *chain_result = check_wal_restore_chain(backups, wal_info);
+		ValidationResult *chain_result =
+			check_wal_restore_chain_of(chain_members, chain_count, wal_info);
 		if (chain_result != NULL)
 		{
+			if (!table_output)
+				emit_wal_check(archive->path, "restore_chain", chain_result);
 			if (chain_result->error_count > 0)
 			{
-				printf("  %s[ERROR]%s WAL restore chain incomplete:\n",
+				report("  %s[ERROR]%s WAL restore chain incomplete:\n",
 					   use_color ? COLOR_RED : "", use_color ? COLOR_RESET : "");
 				for (int i = 0; i < chain_result->error_count; i++)
-					printf("          %s\n", chain_result->errors[i]);
+					report("          %s\n", chain_result->errors[i]);
 				if (chain_has_stream)
-					printf("  %s[NOTE]%s Chain contains stream backups — bridge segments "
+					report("  %s[NOTE]%s Chain contains stream backups — bridge segments "
 						   "between backups are not stored in stream mode and will not "
 						   "appear in the WAL archive\n",
 						   use_color ? COLOR_YELLOW : "", use_color ? COLOR_RESET : "");
 			}
 			else
 			{
-				printf("  %s[OK]%s WAL restore chain: all inter-backup bridges complete\n",
+				report("  %s[OK]%s WAL restore chain: all inter-backup bridges complete\n",
 					   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "");
 			}
 			total_errors += chain_result->error_count;
+			metrics_report_add(&metrics, chain_result);
 			free_validation_result(chain_result);
 		}
+		stopped = opts.fail_fast && total_errors > 0;
 
-		ValidationResult *cont_result = check_wal_continuity(wal_info);
+		ValidationResult *cont_result = (stopped || scope != NULL) ? NULL
+			: check_wal_continuity(wal_info);
 		if (cont_result != NULL)
 		{
+			if (!table_output)
+				emit_wal_check(archive->path, "continuity", cont_result);
 			if (cont_result->error_count > 0)
 			{
-				printf("  %s[ERROR]%s WAL archive has gaps:\n",
+				report("  %s[ERROR]%s WAL archive has gaps:\n",
 					   use_color ? COLOR_RED : "", use_color ? COLOR_RESET : "");
 				for (int i = 0; i < cont_result->error_count; i++)
-					printf("          %s\n", cont_result->errors[i]);
+					report("          %s\n", cont_result->errors[i]);
 			}
 			else
 			{
-				printf("  %s[OK]%s WAL archive: no gaps detected (%d segment%s)\n",
+				report("  %s[OK]%s WAL archive: no gaps detected (%d segment%s)\n",
 					   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "",
 					   wal_info->segment_count,
 					   wal_info->segment_count == 1 ? "" : "s");
 			}
 			total_errors += cont_result->error_count;
+			metrics_report_add(&metrics, cont_result);
 			free_validation_result(cont_result);
 		}
+		stopped = opts.fail_fast && total_errors > 0;
 
 		/* Archive-wide header validation — catches segment swaps and other
 		 * corruptions in segments that lie between backups and are therefore
 		 * not covered by the per-backup check_wal_headers() pass. */
-		if (opts.level >= VALIDATION_LEVEL_FULL)
+		if (opts.level >= VALIDATION_LEVEL_FULL && !stopped && scope == NULL)
 		{
 			ValidationResult *arch_result = check_wal_archive_headers(wal_info);
 			if (arch_result != NULL)
 			{
+				if (!table_output)
+					emit_wal_check(archive->path, "headers", arch_result);
 				if (arch_result->error_count > 0)
 				{
-					printf("  %s[ERROR]%s WAL archive header validation failed:\n",
+					report("  %s[ERROR]%s WAL archive header validation failed:\n",
 						   use_color ? COLOR_RED : "", use_color ? COLOR_RESET : "");
 					for (int i = 0; i < arch_result->error_count; i++)
-						printf("          %s\n", arch_result->errors[i]);
+						report("          %s\n", arch_result->errors[i]);
 				}
 				else
 				{
-					printf("  %s[OK]%s WAL archive: all segment headers valid\n",
+					report("  %s[OK]%s WAL archive: all segment headers valid\n",
 						   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "");
 				}
 				total_errors += arch_result->error_count;
+				metrics_report_add(&metrics, arch_result);
 				free_validation_result(arch_result);
 			}
 		}
+		stopped = opts.fail_fast && total_errors > 0;
+	}
+	free(members);
+	free(scope);
+
+	/* Digests computed in this run are trusted by the next (--cache-dir) */
+	digest_cache_save();
+
+	if (!table_output)
+		emit_summary(backup_count, backups_validated, backups_skipped,
+					 total_errors, total_warnings, stopped);
+
+	if (opts.metrics_file != NULL)
+	{
+		metrics.finished_at = time(NULL);
+		metrics.duration = (double) (metrics_clock() - started) / 1e9;
+		metrics_write_file(opts.metrics_file, &metrics);
 	}
 
 	/* Print summary */
-	printf("\n");
-	printf("====================================================\n");
-	printf("Validation Summary\n");
-	printf("====================================================\n");
-	printf("  Total backups found:    %d\n", backup_count);
-	printf("  Backups validated:      %d\n", backups_validated);
+	report("\n");
+	report("====================================================\n");
+	report("Validation Summary\n");
+	report("====================================================\n");
+	report("  Total backups found:    %d\n", backup_count);
+	report("  Backups validated:      %d\n", backups_validated);
 	if (backups_skipped > 0)
-		printf("  Backups skipped:        %d (ERROR/CORRUPT status)\n", backups_skipped);
-	printf("----------------------------------------------------\n");
-	printf("  Validation errors:      %d\n", total_errors);
-	printf("  Validation warnings:    %d\n", total_warnings);
-	printf("====================================================\n");
+		report("  Backups skipped:        %d (ERROR/CORRUPT status)\n", backups_skipped);
+	if (validation_sample_active())
+		print_sample_coverage(opts.sample_seed);
+	if (stopped)
+		report("  Fail-fast:              stopped at the first error\n");
+	report("----------------------------------------------------\n");
+	report("  Validation errors:      %d\n", total_errors);
+	report("  Validation warnings:    %d\n", total_warnings);
+	report("====================================================\n");
+
+	/* On stderr, so it never mixes with JSON or NDJSON output */
+	if (opts.profile)
+		metrics_profile_write(stderr, (double) (metrics_clock() - started) / 1e9);
+
+	/* Read rates for audit's restore estimates; throttled reads say nothing */
+	if (opts.max_read_rate == 0 && opts.max_iops == 0)
+		restore_throughput_record(opts.backup_dir);
 
 	/* Cleanup */
 	free_backup_list(backups);
-	if (wal_info != NULL)
-		free_wal_archive_info(wal_info);
+	wal_archive_set_free(wal_set);
 
 	/* Return appropriate exit code */
 	if (total_errors > 0)
 	{
-		printf("\n%sResult: FAILED%s\n",
+		report("\n%sResult: FAILED%s\n",
 			   use_color ? COLOR_RED : "", use_color ? COLOR_RESET : "");
-		printf("  %d validation error%s found in checked backups.\n",
+		report("  %d validation error%s found in checked backups.\n",
 			   total_errors, total_errors == 1 ? "" : "s");
 		if (backups_skipped > 0)
-			printf("  %d backup%s skipped due to ERROR/CORRUPT status.\n",
+			report("  %d backup%s skipped due to ERROR/CORRUPT status.\n",
 				   backups_skipped, backups_skipped == 1 ? " was" : "s were");
 		return EXIT_VALIDATION_FAILED;
 	}
 	else if (total_warnings > 0)
 	{
-		printf("\n%sResult: WARNING%s\n",
+		report("\n%sResult: WARNING%s\n",
 			   use_color ? COLOR_YELLOW : "", use_color ? COLOR_RESET : "");
-		printf("  %d validation warning%s found in checked backups.\n",
+		report("  %d validation warning%s found in checked backups.\n",
 			   total_warnings, total_warnings == 1 ? "" : "s");
 		if (backups_skipped > 0)
-			printf("  %d backup%s skipped due to ERROR/CORRUPT status.\n",
+			report("  %d backup%s skipped due to ERROR/CORRUPT status.\n",
 				   backups_skipped, backups_skipped == 1 ? " was" : "s were");
 		return EXIT_VALIDATION_FAILED;
 	}
@@ -537,20 +1222,20 @@ cmd_check_main(int argc, char **argv)
 	{
 		if (backups_validated == 0 && backups_skipped > 0)
 		{
-			printf("\n%sResult: NO VALIDATION PERFORMED%s\n",
+			report("\n%sResult: NO VALIDATION PERFORMED%s\n",
 				   use_color ? COLOR_CYAN : "", use_color ? COLOR_RESET : "");
-			printf("  All %d backup%s skipped (ERROR/CORRUPT status).\n",
+			report("  All %d backup%s skipped (ERROR/CORRUPT status).\n",
 				   backups_skipped, backups_skipped == 1 ? " was" : "s were");
-			printf("  No backups were available for validation.\n");
+			report("  No backups were available for validation.\n");
 		}
 		else
 		{
-			printf("\n%sResult: OK%s\n",
+			report("\n%sResult: OK%s\n",
 				   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "");
-			printf("  All %d validated backup%s passed checks successfully.\n",
+			report("  All %d validated backup%s passed checks successfully.\n",
 				   backups_validated, backups_validated == 1 ? "" : "s");
 			if (backups_skipped > 0)
-				printf("  %d backup%s skipped due to ERROR/CORRUPT status.\n",
+				report("  %d backup%s skipped due to ERROR/CORRUPT status.\n",
 					   backups_skipped, backups_skipped == 1 ? " was" : "s were");
 		}
 		return EXIT_SUCCESS;
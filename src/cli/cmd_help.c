@@ -21,6 +21,7 @@
 
 
 #include "cmd_help.h"
+#include "digest_cache.h"
 #include <stdio.h>
 
 /*
@@ -37,7 +38,25 @@ print_general_usage(void)
 	printf("  check   - Validate backup consistency\n");
 	printf("  audit   - Audit backup strategy (recovery points, RPO, storage)\n");
 	printf("  stat    - Backup collection statistics\n");
+	printf("  watch   - Validate continuously as backups and WAL arrive\n");
+	printf("  merge   - Combine the parts of a sharded check into one report\n");
+	printf("  verify-segment - Verify one WAL segment as it is archived\n");
 	printf("  help    - Show this help message\n\n");
+	printf("GLOBAL OPTIONS (anywhere on the command line):\n");
+	printf("  --no-color             Plain output without colors\n");
+	printf("  --log-level=LEVEL      debug, info (default), warning or error\n");
+	printf("  --log-file=PATH        Append log lines to PATH instead of stderr\n");
+	printf("  --log-async            Write log lines from a background thread\n\n");
+	printf("OBJECT STORAGE:\n");
+	printf("  --backup-dir, --backup-path and --wal-archive also take s3://bucket/prefix\n");
+	printf("  and gs://bucket/prefix (all commands but watch).  The repository is listed\n");
+	printf("  once and its metadata files staged into a local mirror; higher check\n");
+	printf("  levels fetch each backup and batch of WAL segments as it is verified, and\n");
+	printf("  drop it after.  With --cache-dir the mirror is kept and only changed\n");
+	printf("  objects are fetched again.  Requests are run by the curl command-line\n");
+	printf("  tool, not a built-in client; credentials, region and endpoint come\n");
+	printf("  from AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY, AWS_SESSION_TOKEN,\n");
+	printf("  AWS_REGION and AWS_ENDPOINT_URL.\n\n");
 	printf("Use 'pg_backup_auditor COMMAND --help' for command-specific options.\n\n");
 }
 
@@ -57,9 +76,16 @@ print_list_usage(void)
 	printf("      --sort-by=FIELD      Sort by: start_time (default), end_time, name, size\n");
 	printf("  -r, --reverse            Reverse sort order\n");
 	printf("  -n, --limit=N            Limit number of results (default: unlimited)\n");
+	printf("      --after=BACKUP_ID    Start after this backup, to page through with --limit\n");
 	printf("  -d, --max-depth=N        Recursion depth (0 = current dir only, -1 = unlimited, default: -1)\n");
 	printf("  -R, --no-recurse         Scan only the specified directory (alias for --max-depth=0)\n");
-	printf("  -f, --format=FORMAT      Output format: table (default)\n");
+	printf("  -j, --jobs=N             Scan directories with N threads (default: 1)\n");
+	printf("  -f, --format=FORMAT      Output format: table (default), ndjson (one JSON\n");
+	printf("                           object per line, written as results are known)\n");
+	printf("      --cache-dir=PATH     Keep a catalog index here; later runs only\n");
+	printf("                           re-read backups whose metadata changed\n");
+	printf("      --sizes=MODE         Backup sizes: metadata (manifest/control totals,\n");
+	printf("                           default), walk (on-disk usage), none (never walk)\n");
 	printf("  -h, --help               Show this help message\n\n");
 
 	printf("EXAMPLES:\n");
@@ -67,7 +93,8 @@ print_list_usage(void)
 	printf("  pg_backup_auditor list -B /backup/pg --type=pg_probackup\n");
 	printf("  pg_backup_auditor list -B /backup/pg --status=error\n");
 	printf("  pg_backup_auditor list -B /backup/pg --no-recurse\n");
-	printf("  pg_backup_auditor list -B /backup/pg --sort-by=size --reverse --limit=10\n\n");
+	printf("  pg_backup_auditor list -B /backup/pg --sort-by=size --reverse --limit=10\n");
+	printf("  pg_backup_auditor list -B /backup/pg --limit=20 --after=20240101-120000F\n\n");
 }
 
 /*
@@ -83,6 +110,7 @@ print_info_usage(void)
 	printf("  -B, --backup-dir=PATH    Path to backup directory (required)\n");
 	printf("  -i, --backup-id=ID       Backup ID to inspect (required)\n");
 	printf("  -o, --output=FORMAT      Output format: text, json (default: text)\n");
+	printf("      --cache-dir=PATH     Keep a catalog index here (see 'list --help')\n");
 	printf("  -h, --help               Show this help message\n\n");
 
 	printf("INFORMATION DISPLAYED:\n");
@@ -106,16 +134,46 @@ print_check_usage(void)
 	printf("  -B, --backup-dir=PATH    Path to backup directory (required)\n");
 	printf("  -i, --backup-id=ID       Check specific backup by ID\n");
 	printf("  -l, --level=LEVEL        Validation level (default: standard)\n");
-	printf("                           Levels: basic, standard, checksums, full\n");
+	printf("                           Levels: basic, standard, checksums, full, pages\n");
 	printf("      --wal-archive=PATH   Path to external WAL archive (optional)\n");
 	printf("      --skip-wal           Skip all WAL checking\n");
+	printf("      --wal-headers-only   Check only the page header of each WAL segment,\n");
+	printf("                           not its records (one small read per segment)\n");
+	printf("      --wal-summaries=PATH WAL summaries of incremental backups when the\n");
+	printf("                           backup has none (the server's pg_wal/summaries)\n");
+	printf("  -j, --jobs=N             Scan, validate backups and verify files with N threads (default: 1)\n");
+	printf("  -f, --format=FORMAT      Output format: table (default), ndjson (see 'list --help')\n");
+	printf("      --cache-dir=PATH     Remember clean WAL segments, file digests and\n");
+	printf("                           scanned backups here; later runs only read what\n");
+	printf("                           changed\n");
+	printf("      --io-engine=ENGINE   How files are read for checksums: auto (io_uring\n");
+	printf("                           where available, default), io_uring or sync\n");
+	printf("      --page-cache=MODE    use (default); drop: release pages once read;\n");
+	printf("                           direct: O_DIRECT where supported, else drop\n");
+	printf("      --max-read-rate=RATE Read at most RATE bytes per second in total\n");
+	printf("                           (K, M, G suffixes; default: unlimited)\n");
+	printf("      --max-iops=N         Issue at most N reads per second in total\n");
+	printf("      --memory-limit=SIZE  Keep read buffers within SIZE in total; readers wait\n");
+	printf("                           for a free buffer (K, M, G; at least 1M; default: unlimited)\n");
+	printf("      --sample=FRACTION    Verify checksums of only this share of files and\n");
+	printf("                           WAL segments (e.g. 10%%); runs rotate through all\n");
+	printf("      --sample-by=UNIT     count (default) or bytes\n");
+	printf("      --sample-seed=N      Rotation step (default: days since 1970-01-01)\n");
+	printf("      --shard=K/N          Verify only shard K of N of the files and WAL\n");
+	printf("                           segments; combine the N parts with 'merge'\n");
+	printf("      --fail-fast          Stop at the first error and cancel the work still queued\n");
+	printf("      --latest-chain-only  Check only the newest restorable chain of each instance\n");
+	printf("      --metrics-file=PATH  Write Prometheus metrics (phase times, throughput,\n");
+	printf("                           errors by category) to PATH when done\n");
+	printf("      --profile            Print time, I/O and throughput per phase to stderr\n");
 	printf("  -h, --help               Show this help message\n\n");
 
 	printf("VALIDATION LEVELS (cumulative — each level includes all checks from previous):\n");
 	printf("  basic      - Level 1: File structure + chain connectivity + WAL presence\n");
 	printf("  standard   - Level 2: Level 1 + metadata validation (default)\n");
 	printf("  checksums  - Level 3: Level 2 + WAL availability + WAL header validation\n");
-	printf("  full       - Level 4: Level 3 + comprehensive checks (pg_verifybackup)\n\n");
+	printf("  full       - Level 4: Level 3 + comprehensive checks (pg_verifybackup)\n");
+	printf("  pages      - Level 5: Level 4 + page headers and checksums of relation files\n\n");
 
 	printf("CHECKS BY LEVEL:\n");
 	printf("  Level 1 (basic):\n");
@@ -137,18 +195,42 @@ print_check_usage(void)
 	printf("        timeline matches backup, page address matches segment start\n");
 	printf("        segment size is a valid power of two (1 MB - 1 GB)\n");
 	printf("        CRC32C of the first XLogRecord\n");
-	printf("    - WAL per-record CRC32C: validates CRC32C of every complete\n");
-	printf("        single-page XLogRecord across all pages of each segment;\n");
-	printf("        multi-page records and xl_crc=0 records are skipped\n\n");
+	printf("    - WAL per-record CRC32C: validates CRC32C of every XLogRecord,\n");
+	printf("        reassembling records that span pages or segments;\n");
+	printf("        xl_crc=0 records are skipped\n\n");
 	printf("  Level 4 (full):\n");
 	printf("    - pg_verifybackup: if available for pg_basebackup\n");
 	printf("    - All comprehensive checks\n\n");
+	printf("  Level 5 (pages):\n");
+	printf("    - Every 8 kB page of the relation files in base/, global/ and\n");
+	printf("        pg_tblspc/ of plain-format backups: header sanity and, with\n");
+	printf("        data_checksums on, pd_checksum; all-zero pages are skipped, as\n");
+	printf("        are pages written during the backup (restored from WAL)\n\n");
+	printf("  Incremental pg_basebackup backups (PostgreSQL 17+), from level 3:\n");
+	printf("    - INCREMENTAL.* files: magic, block count, truncation length and\n");
+	printf("        block numbers, and a length agreeing with the header\n");
+	printf("    - WAL summaries: format and CRC32C of each, and coverage of the\n");
+	printf("        WAL from the parent's start LSN to the backup's start LSN\n\n");
 
 	printf("WAL CHECKING:\n");
 	printf("  WAL checks require backup LSN metadata (start_lsn/stop_lsn).\n");
 	printf("  For pg_probackup: WAL archive path is auto-detected from the catalog.\n");
 	printf("  For other tools: use --wal-archive to specify the archive location.\n");
-	printf("  Use --skip-wal to disable all WAL checks.\n\n");
+	printf("  Without --wal-archive every instance or stanza is checked against its\n");
+	printf("  own archive; each archive is scanned once.\n");
+	printf("  Use --skip-wal to disable all WAL checks.\n");
+	printf("  --wal-headers-only reads the first page of each segment, with many\n");
+	printf("  reads in flight, for quick sweeps of large or remote archives; record\n");
+	printf("  CRCs and compressed segments' lengths are then not verified.\n");
+	printf("  With --cache-dir, segments that passed once and are unchanged (same\n");
+	printf("  size, mtime and inode) are not read again; problems are re-reported.\n\n");
+
+	printf("FILE DIGESTS:\n");
+	printf("  A file listed by several backups (pgBackRest references, shared files)\n");
+	printf("  is read once per run; its digest is checked against every manifest.\n");
+	printf("  With --cache-dir digests of unchanged files (same device, inode, size\n");
+	printf("  and mtime) are kept for %d days, after which the file is read again.\n\n",
+		   DIGEST_CACHE_MAX_AGE);
 
 	printf("EXIT CODES:\n");
 	printf("  0 - All checks passed successfully\n");
@@ -167,6 +249,12 @@ print_check_usage(void)
 	printf("  pg_backup_auditor check -B /backup/pg -i 20240101T120000 --skip-wal\n\n");
 	printf("  # Use external WAL archive\n");
 	printf("  pg_backup_auditor check -B /backup/pg --wal-archive=/wal/archive\n\n");
+	printf("  # Hourly run that only reads WAL archived since the last one\n");
+	printf("  pg_backup_auditor check -B /backup/pg --level=checksums \\\n");
+	printf("      --wal-archive=/wal/archive --cache-dir=/var/cache/pg_backup_auditor\n\n");
+	printf("  # Health probe: can the latest chain be restored?\n");
+	printf("  pg_backup_auditor check -B /backup/pg --level=checksums \\\n");
+	printf("      --latest-chain-only --fail-fast\n\n");
 }
 
 /*
@@ -183,6 +271,16 @@ print_audit_usage(void)
 	printf("  -B, --backup-dir=PATH       Path to backup directory (required)\n");
 	printf("      --wal-archive=PATH      Path to external WAL archive for coverage analysis (optional)\n");
 	printf("  -s, --detect-size-small     Detect unusually small backups as anomalies (optional)\n");
+	printf("  -j, --jobs=N                Scan directories with N threads (default: 1)\n");
+	printf("  -f, --format=FORMAT         Output format: table (default), ndjson (see 'list --help')\n");
+	printf("      --cache-dir=PATH        Keep a catalog index here (see 'list --help')\n");
+	printf("      --profile               Print time, I/O and throughput per phase to stderr\n");
+	printf("      --replay-rate=RATE      WAL replay speed for restore estimates, bytes per second\n");
+	printf("                              (K, M, G suffixes; default: as measured by check)\n");
+	printf("      --rto-target=DURATION   Degrade chains estimated to restore slower (s, m, h, d)\n");
+	printf("      --retention=POLICY      What a retention policy would expire; repeatable (up to 16).\n");
+	printf("                              POLICY: redundancy=N, window=DURATION, instance=NAME,\n");
+	printf("                              comma-separated, e.g. redundancy=2,window=7d\n");
 	printf("  -h, --help                  Show this help message\n\n");
 
 	printf("OUTPUT SECTIONS:\n");
@@ -192,7 +290,10 @@ print_audit_usage(void)
 	printf("    - WAL Mode: stream/archive/mixed (how WAL is captured)\n");
 	printf("    - Oldest recovery point: earliest time you can restore to\n");
 	printf("    - Latest recovery point: most recent recovery time\n");
-	printf("    - RPO (Recovery Point Objective) gap: time between backups\n\n");
+	printf("    - RPO (Recovery Point Objective) gap: time between backups\n");
+	printf("    - Estimated restore time of the latest backup: its data and that of the\n");
+	printf("      backups it depends on at the read rate measured by check --level=checksums\n");
+	printf("      (with --cache-dir), plus replay of the WAL up to the first archive gap\n\n");
 	printf("  Orphaned\n");
 	printf("    Incremental/differential backups without a FULL backup parent.\n");
 	printf("    These backups cannot be used for recovery.\n\n");
@@ -206,11 +307,21 @@ print_audit_usage(void)
 	printf("    - Total backup size (all backup data)\n");
 	printf("    - Disk usage (actual filesystem usage)\n");
 	printf("    - RUNNING backups (incomplete backups in progress)\n\n");
+	printf("  RETENTION\n");
+	printf("    For each --retention policy, per instance and WAL archive:\n");
+	printf("    - redundancy=N keeps the newest N chains with an OK FULL backup\n");
+	printf("    - window=D keeps the newest OK chain finished before the last D began,\n");
+	printf("      and every chain with a backup since; with both, either keeps a chain\n");
+	printf("    - the chains, backups and bytes that would be expendable, and the WAL\n");
+	printf("      below the oldest backup kept\n");
+	printf("    A policy that an instance has too few OK chains for degrades the verdict.\n\n");
 	printf("  Anomalies\n");
-	printf("    Backups with unusual patterns (by tool and backup type):\n");
-	printf("    - Size anomalies: backups >2x larger than average\n");
-	printf("    - Size anomalies (small): backups <0.5x average (use --detect-size-small to enable)\n");
-	printf("    - Duration anomalies: backups >2x slower/faster than average\n\n");
+	printf("    Backups with unusual patterns, each against the earlier backups of its\n");
+	printf("    instance, tool and type (median of the last 32, and a moving average):\n");
+	printf("    - Size anomalies: backups >2x larger than both, and far outside the usual spread\n");
+	printf("    - Size anomalies (small): backups <0.5x both (use --detect-size-small to enable)\n");
+	printf("    - Duration anomalies: backups >2x slower/faster than both\n");
+	printf("    With --cache-dir the baselines are kept, and only new backups are scored.\n\n");
 	printf("  Verdict\n");
 	printf("    Overall assessment based on all checks:\n");
 	printf("    - OK:       All chains healthy, no gaps, good recovery coverage\n");
@@ -258,6 +369,10 @@ print_stat_usage(void)
 	printf("  -B, --backup-dir=PATH    Path to backup directory (required)\n");
 	printf("  -W, --wal-archive=PATH   Path to WAL archive (optional, for pg_probackup)\n");
 	printf("                           If not specified, auto-detected from backup directory\n");
+	printf("  -j, --jobs=N             Scan directories with N threads (default: 1)\n");
+	printf("      --cache-dir=PATH     Keep a catalog index here (see 'list --help')\n");
+	printf("      --sizes=MODE         Backup sizes: metadata, walk, none (see 'list --help')\n");
+	printf("  -f, --format=FORMAT      Output format: table (default), ndjson (see 'list --help')\n");
 	printf("  -h, --help               Show this help message\n\n");
 
 	printf("STATISTICS BY GROUP:\n");
@@ -293,3 +408,120 @@ print_stat_usage(void)
 	printf("  # Get statistics for specific directory\n");
 	printf("  pg_backup_auditor stat -B /var/lib/pgbackup\n\n");
 }
+
+/*
+ * Print usage for 'watch' command
+ */
+void
+print_watch_usage(void)
+{
+	printf("Usage: pg_backup_auditor watch [OPTIONS]\n\n");
+	printf("Validate backups once, then keep watching the backup directory and WAL\n");
+	printf("archives and validate new backups and newly archived WAL as they arrive.\n\n");
+
+	printf("OPTIONS:\n");
+	printf("  -B, --backup-dir=PATH    Path to backup directory (required)\n");
+	printf("  -l, --level=LEVEL        Validation level (default: standard; see 'check --help')\n");
+	printf("      --wal-archive=PATH   Path to external WAL archive (optional)\n");
+	printf("  -j, --jobs=N             Scan, validate backups and verify files with N threads (default: 1)\n");
+	printf("      --cache-dir=PATH     Remember clean WAL segments, file digests and scanned backups\n");
+	printf("      --socket=PATH        Serve the current state on this unix socket\n");
+	printf("      --interval=SECONDS   Full rescan every SECONDS, 0 = never (default: 3600)\n");
+	printf("      --metrics-file=PATH  Rewrite Prometheus metrics to PATH after each round\n");
+	printf("  -h, --help               Show this help message\n\n");
+
+	printf("OUTPUT:\n");
+	printf("  State is NDJSON with the records of 'check --format=ndjson': backup,\n");
+	printf("  finding, wal_archive and summary.  Without --socket the records that\n");
+	printf("  changed are written to stdout after each round.  With --socket a client\n");
+	printf("  connecting gets the whole state; an HTTP GET gets it as the response:\n");
+	printf("    curl --unix-socket /run/pg_backup_auditor.sock http://localhost/\n");
+	printf("  GET /metrics returns the metrics in the Prometheus text format.\n\n");
+
+	printf("WATCHING:\n");
+	printf("  inotify on Linux, kqueue on BSD and macOS, else a 1s poll of directory\n");
+	printf("  mtimes.  Backup directories are watched, their contents are not.  WAL\n");
+	printf("  archives are watched from --level=checksums up; there only segments\n");
+	printf("  that were not in the archive before are read.  Backups missing WAL are\n");
+	printf("  validated again when their archive grows.  Stop with SIGINT or SIGTERM.\n\n");
+
+	printf("EXAMPLES:\n");
+	printf("  # Watch a catalog and serve its state\n");
+	printf("  pg_backup_auditor watch -B /backup/pg --level=checksums \\\n");
+	printf("      --socket=/run/pg_backup_auditor.sock\n\n");
+	printf("  # Stream changes to a log file\n");
+	printf("  pg_backup_auditor watch -B /backup/pg >> /var/log/pg_backup_auditor.ndjson\n\n");
+}
+
+/*
+ * Print usage for 'merge' command
+ */
+void
+print_merge_usage(void)
+{
+	printf("Usage: pg_backup_auditor merge [OPTIONS] PART...\n\n");
+	printf("Combine the parts of a sharded check into the report of one unsharded run.\n");
+	printf("Each PART is the output of 'check --shard=K/N --format=ndjson', or several\n");
+	printf("such outputs one after another (\"-\" reads stdin); all N shards of the\n");
+	printf("same catalog and level must be given.\n\n");
+
+	printf("OPTIONS:\n");
+	printf("  -f, --format=FORMAT      Output format: table (default), ndjson\n");
+	printf("  -h, --help               Show this help message\n\n");
+
+	printf("SHARDING:\n");
+	printf("  --shard=K/N splits the files of every backup (by backup ID and file name)\n");
+	printf("  and the WAL segments (in runs of 64) between N runs without coordination;\n");
+	printf("  tar-format backups go whole to one shard.  Structure, metadata and WAL\n");
+	printf("  continuity are checked by every shard and reported once.  The exit code\n");
+	printf("  is that of 'check' for the merged report.\n\n");
+
+	printf("EXAMPLES:\n");
+	printf("  # Four hosts, one shard each\n");
+	printf("  pg_backup_auditor check -B /backup/pg --level=full --shard=2/4 \\\n");
+	printf("      --format=ndjson > part2.ndjson\n");
+	printf("  pg_backup_auditor merge part1.ndjson part2.ndjson part3.ndjson part4.ndjson\n\n");
+}
+
+/*
+ * Print usage for 'verify-segment' command
+ */
+void
+print_verify_segment_usage(void)
+{
+	printf("Usage: pg_backup_auditor verify-segment [OPTIONS] SEGMENT\n\n");
+	printf("Verify one archived WAL segment file: its page header and the CRC of\n");
+	printf("every record, in one read.  Meant to follow the copy in archive_command;\n");
+	printf("no backup catalog is scanned.  Timeline and segment number come from the\n");
+	printf("file name (compressed and pgBackRest names are accepted), the segment\n");
+	printf("size from the header.\n\n");
+
+	printf("OPTIONS:\n");
+	printf("  -w, --wal-archive=DIR    The WAL archive the segment belongs to, spelled\n");
+	printf("                           as 'check' sees it (default: the directory of\n");
+	printf("                           SEGMENT)\n");
+	printf("  -C, --cache-dir=PATH     Record the verdict in the WAL verification cache\n");
+	printf("                           in PATH, which must exist\n");
+	printf("  -h, --help               Show this help message\n\n");
+
+	printf("CACHE:\n");
+	printf("  With --cache-dir, a clean segment is added to the archive's WAL\n");
+	printf("  verification cache and later 'check --cache-dir' runs do not read it\n");
+	printf("  again.  The record running from a segment's end into the next one is\n");
+	printf("  kept in PATH and checked when the next segment is verified; only then\n");
+	printf("  is the segment cached.  The cache key is the segment's path, so SEGMENT\n");
+	printf("  must be the archived file, named as 'check' finds it in the archive.\n\n");
+
+	printf("EXIT STATUS:\n");
+	printf("  0 if the segment is clean, 2 if it has errors, 4 for bad arguments.\n");
+	printf("  Chained with && in archive_command, a failure makes PostgreSQL keep the\n");
+	printf("  segment and retry.\n\n");
+
+	printf("EXAMPLES:\n");
+	printf("  # postgresql.conf\n");
+	printf("  archive_command = 'cp %%p /archive/%%f && pg_backup_auditor verify-segment \\\n");
+	printf("      --cache-dir=/var/cache/pg_backup_auditor /archive/%%f'\n\n");
+	printf("  # Later full checks skip the verified segments\n");
+	printf("  pg_backup_auditor check -B /backup/pg -w /archive --level=full \\\n");
+	printf("      --cache-dir=/var/cache/pg_backup_auditor\n\n");
+}
@@ -23,6 +23,7 @@
 #include "pg_backup_auditor.h"
 #include "cmd_help.h"
 #include "arg_parser.h"
+#include "storage.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,6 +34,7 @@ typedef struct {
 	char *backup_path;   /* Direct path to backup directory */
 	char *backup_dir;    /* Parent directory to search in */
 	char *backup_id;     /* Backup ID to find */
+	char *cache_dir;     /* Catalog index directory, or NULL */
 } InfoOptions;
 
 static const char *
@@ -59,6 +61,7 @@ init_options(InfoOptions *opts)
 	opts->backup_path = NULL;
 	opts->backup_dir = NULL;
 	opts->backup_id = NULL;
+	opts->cache_dir = NULL;
 }
 
 static int
@@ -69,11 +72,13 @@ parse_arguments(int argc, char **argv, InfoOptions *opts)
 	bool backup_path_seen = false;
 	bool backup_dir_seen = false;
 	bool backup_id_seen = false;
+	bool cache_dir_seen = false;
 
 	static struct option long_options[] = {
 		{"backup-path", required_argument, 0, 'p'},
 		{"backup-dir",  required_argument, 0, 'B'},
 		{"backup-id",   required_argument, 0, 'i'},
+		{"cache-dir",   required_argument, 0, 'C'},
 		{"help",        no_argument,       0, 'h'},
 		{0, 0, 0, 0}
 	};
@@ -95,6 +100,10 @@ parse_arguments(int argc, char **argv, InfoOptions *opts)
 				if (!parse_string_option("--backup-id", optarg, &opts->backup_id, &backup_id_seen))
 					return EXIT_INVALID_ARGUMENTS;
 				break;
+			case 'C':
+				if (!parse_string_option("--cache-dir", optarg, &opts->cache_dir, &cache_dir_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
 			case 'h':
 				print_info_usage();
 				return EXIT_SUCCESS;
@@ -123,18 +132,26 @@ validate_options(const InfoOptions *opts)
 	}
 
 	/* Validate paths exist */
-	if (opts->backup_path != NULL && !is_directory(opts->backup_path))
+	if (opts->backup_path != NULL && !storage_is_remote(opts->backup_path) &&
+		!is_directory(opts->backup_path))
 	{
 		fprintf(stderr, "Error: Backup path does not exist: %s\n", opts->backup_path);
 		return EXIT_GENERAL_ERROR;
 	}
 
-	if (opts->backup_dir != NULL && !is_directory(opts->backup_dir))
+	if (opts->backup_dir != NULL && !storage_is_remote(opts->backup_dir) &&
+		!is_directory(opts->backup_dir))
 	{
 		fprintf(stderr, "Error: Backup directory does not exist: %s\n", opts->backup_dir);
 		return EXIT_GENERAL_ERROR;
 	}
 
+	if (opts->cache_dir != NULL && !is_directory(opts->cache_dir))
+	{
+		fprintf(stderr, "Error: Cache directory does not exist: %s\n", opts->cache_dir);
+		return EXIT_GENERAL_ERROR;
+	}
+
 	return EXIT_SUCCESS;
 }
 
@@ -325,8 +342,13 @@ find_backup_by_id(const char *backup_dir, const char *backup_id)
 	BackupInfo *current;
 	BackupInfo *found = NULL;
 
-	/* Scan all backups (unlimited depth) */
+	/*
+	 * Scan all backups (unlimited depth).  Only the one being printed needs
+	 * its manifest and sizes, so the rest are read at identity level.
+	 */
+	scan_set_load_level(BACKUP_LOAD_IDENTITY);
 	all_backups = scan_backup_directory(backup_dir, -1);
+	scan_set_load_level(BACKUP_LOAD_FULL);
 	if (all_backups == NULL)
 		return NULL;
 
@@ -342,6 +364,7 @@ find_backup_by_id(const char *backup_dir, const char *backup_id)
 			{
 				memcpy(found, current, sizeof(BackupInfo));
 				found->next = NULL;
+				backup_info_load(found);
 			}
 			break;
 		}
@@ -401,6 +424,11 @@ cmd_info_main(int argc, char **argv)
 	if (ret != EXIT_SUCCESS)
 		return ret;
 
+	validation_set_cache_dir(opts.cache_dir);
+	if (!storage_resolve(&opts.backup_path, STAGE_METADATA) ||
+		!storage_resolve(&opts.backup_dir, STAGE_METADATA))
+		return EXIT_GENERAL_ERROR;
+
 	/* Get backup information */
 	if (opts.backup_path != NULL)
 	{
@@ -22,8 +22,11 @@
 #define _XOPEN_SOURCE 700
 
 #include "pg_backup_auditor.h"
+#include "backup_catalog.h"
 #include "cmd_help.h"
 #include "arg_parser.h"
+#include "ndjson.h"
+#include "storage.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,17 +38,24 @@ typedef struct {
 	char *backup_dir;
 	char *type_filter;      /* auto|pg_basebackup|pg_probackup */
 	char *status_filter;    /* all|ok|warning|error|corrupt|orphan */
-	char *format;           /* table|json|yaml */
+	char *format;           /* table|ndjson */
+	OutputFormat output;
 	char *sort_by;          /* time|lsn|size|status */
 	bool reverse;
 	int limit;
+	char *after;            /* --after: print what follows this backup */
 	int max_depth;          /* Maximum recursion depth (-1 = unlimited) */
+	char *cache_dir;        /* Catalog index directory, or NULL */
+	int jobs;               /* Directory scan threads */
+	char *sizes;            /* metadata|walk|none, or NULL for default */
 } ListOptions;
 
 /* Output statistics */
 typedef struct {
 	int count;
 	uint64_t total_bytes;
+	int after;              /* record index of --after until it has passed, else -1 */
+	int last;               /* record index of the last backup printed, or -1 */
 } OutputStats;
 
 
@@ -56,10 +66,15 @@ init_options(ListOptions *opts)
 	opts->type_filter = "auto";
 	opts->status_filter = "all";
 	opts->format = "table";
+	opts->output = OUTPUT_TABLE;
 	opts->sort_by = "time";
 	opts->reverse = false;
 	opts->limit = 0;  /* 0 means no limit */
+	opts->after = NULL;
 	opts->max_depth = -1;  /* -1 means unlimited */
+	opts->cache_dir = NULL;
+	opts->jobs = DEFAULT_THREADS;
+	opts->sizes = NULL;
 }
 
 static int
@@ -74,8 +89,12 @@ parse_arguments(int argc, char **argv, ListOptions *opts)
 	bool sort_by_seen = false;
 	bool reverse_seen = false;
 	bool limit_seen = false;
+	bool after_seen = false;
 	bool max_depth_seen = false;
 	bool no_recurse_seen = false;
+	bool cache_dir_seen = false;
+	bool jobs_seen = false;
+	bool sizes_seen = false;
 
 	static struct option long_options[] = {
 		{"backup-dir",  required_argument, 0, 'B'},
@@ -85,13 +104,17 @@ parse_arguments(int argc, char **argv, ListOptions *opts)
 		{"sort-by",     required_argument, 0,  0 },
 		{"reverse",     no_argument,       0, 'r'},
 		{"limit",       required_argument, 0, 'n'},
+		{"after",       required_argument, 0, 'A'},
 		{"max-depth",   required_argument, 0, 'd'},
 		{"no-recurse",  no_argument,       0, 'R'},
+		{"cache-dir",   required_argument, 0, 'C'},
+		{"jobs",        required_argument, 0, 'j'},
+		{"sizes",       required_argument, 0, 'z'},
 		{"help",        no_argument,       0, 'h'},
 		{0, 0, 0, 0}
 	};
 
-	while ((c = getopt_long(argc, argv, "B:t:s:f:rn:d:Rh",
+	while ((c = getopt_long(argc, argv, "B:t:s:f:rn:d:Rj:h",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -138,6 +161,10 @@ parse_arguments(int argc, char **argv, ListOptions *opts)
 				}
 				limit_seen = true;
 				break;
+			case 'A':
+				if (!parse_string_option("--after", optarg, &opts->after, &after_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
 			case 'd':
 				if (check_duplicate_option(max_depth_seen, "--max-depth"))
 					return EXIT_INVALID_ARGUMENTS;
@@ -156,6 +183,26 @@ parse_arguments(int argc, char **argv, ListOptions *opts)
 				opts->max_depth = 0;
 				no_recurse_seen = true;
 				break;
+			case 'j':
+				if (check_duplicate_option(jobs_seen, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_int_argument(optarg, &opts->jobs, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->jobs < 1)
+				{
+					fprintf(stderr, "Error: --jobs must be >= 1\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				jobs_seen = true;
+				break;
+			case 'C':
+				if (!parse_string_option("--cache-dir", optarg, &opts->cache_dir, &cache_dir_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'z':
+				if (!parse_string_option("--sizes", optarg, &opts->sizes, &sizes_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
 			case 'h':
 				print_list_usage();
 				return EXIT_SUCCESS;
@@ -170,8 +217,10 @@ parse_arguments(int argc, char **argv, ListOptions *opts)
 }
 
 static int
-validate_options(const ListOptions *opts)
+validate_options(ListOptions *opts)
 {
+	SizeMode dummy_mode;
+
 	/* Check required options */
 	if (opts->backup_dir == NULL)
 	{
@@ -181,7 +230,7 @@ validate_options(const ListOptions *opts)
 	}
 
 	/* Check if backup directory exists */
-	if (!is_directory(opts->backup_dir))
+	if (!storage_is_remote(opts->backup_dir) && !is_directory(opts->backup_dir))
 	{
 		fprintf(stderr, "Error: Backup directory does not exist or is not a directory: %s\n",
 				opts->backup_dir);
@@ -201,10 +250,10 @@ validate_options(const ListOptions *opts)
 	}
 
 	/* Validate format */
-	if (strcmp(opts->format, "table") != 0)
+	if (!output_format_from_string(opts->format, &opts->output))
 	{
 		fprintf(stderr, "Error: Invalid format: %s\n", opts->format);
-		fprintf(stderr, "Valid formats: table\n");
+		fprintf(stderr, "Valid formats: table, ndjson\n");
 		return EXIT_INVALID_ARGUMENTS;
 	}
 
@@ -232,6 +281,19 @@ validate_options(const ListOptions *opts)
 		return EXIT_INVALID_ARGUMENTS;
 	}
 
+	if (opts->cache_dir != NULL && !is_directory(opts->cache_dir))
+	{
+		fprintf(stderr, "Error: Cache directory does not exist: %s\n", opts->cache_dir);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	if (opts->sizes != NULL && !size_mode_from_string(opts->sizes, &dummy_mode))
+	{
+		fprintf(stderr, "Error: Invalid size mode: %s\n", opts->sizes);
+		fprintf(stderr, "Valid values: metadata, walk, none\n");
+		return EXIT_INVALID_ARGUMENTS;
+	}
+
 	return EXIT_SUCCESS;
 }
 
@@ -240,7 +302,7 @@ validate_options(const ListOptions *opts)
  * Returns true if backup should be included, false if filtered out
  */
 static bool
-matches_filters(const BackupInfo *backup, const ListOptions *opts)
+matches_filters(const BackupRecord *backup, const ListOptions *opts)
 {
 	/* Filter by tool type */
 	if (strcasecmp(opts->type_filter, "auto") != 0)
@@ -264,160 +326,113 @@ matches_filters(const BackupInfo *backup, const ListOptions *opts)
 }
 
 /*
- * Compare two backups by start_time for sorting
- * Returns: <0 if a < b, 0 if a == b, >0 if a > b
+ * Catalog order for --sort-by (validated in validate_options)
  */
-static int
-compare_backups_by_time(const void *a, const void *b)
+static CatalogOrder
+sort_order(const char *sort_by)
 {
-	const BackupInfo *backup_a = *(const BackupInfo **)a;
-	const BackupInfo *backup_b = *(const BackupInfo **)b;
-
-	/* Handle missing start_time (treat as 0) */
-	time_t time_a = backup_a->start_time;
-	time_t time_b = backup_b->start_time;
-
-	if (time_a < time_b)
-		return -1;
-	else if (time_a > time_b)
-		return 1;
-	else
-		return 0;
+	if (strcasecmp(sort_by, "end_time") == 0)
+		return CATALOG_ORDER_END_TIME;
+	if (strcasecmp(sort_by, "name") == 0)
+		return CATALOG_ORDER_NAME;
+	if (strcasecmp(sort_by, "size") == 0)
+		return CATALOG_ORDER_SIZE;
+	return CATALOG_ORDER_START_TIME;  /* time, start_time */
 }
 
 /*
- * Compare two backups by end_time for sorting
- * Returns: <0 if a < b, 0 if a == b, >0 if a > b
+ * Output order of two records of a directory group: by 'primary', then
+ * by --sort-by, then by position in the catalog, the tie-break turned
+ * around with --reverse.  This is the order a stable sort by 'primary'
+ * of the --sort-by order gives, without sorting the whole group first.
  */
 static int
-compare_backups_by_end_time(const void *a, const void *b)
+compare_listed(const BackupCatalog *catalog, int a, int b,
+			   CatalogOrder primary, const ListOptions *opts)
 {
-	const BackupInfo *backup_a = *(const BackupInfo **)a;
-	const BackupInfo *backup_b = *(const BackupInfo **)b;
-
-	time_t time_a = backup_a->end_time;
-	time_t time_b = backup_b->end_time;
-
-	/* Treat 0 as "in progress" - should sort to end */
-	if (time_a == 0 && time_b != 0)
-		return 1;
-	if (time_a != 0 && time_b == 0)
-		return -1;
-
-	if (time_a < time_b)
-		return -1;
-	else if (time_a > time_b)
-		return 1;
-	else
-		return 0;
+	int cmp = backup_catalog_compare(catalog, a, b, primary);
+
+	if (cmp != 0)
+		return cmp;
+	cmp = backup_catalog_compare(catalog, a, b, sort_order(opts->sort_by));
+	if (cmp == 0)
+		cmp = (a > b) - (a < b);
+	return opts->reverse ? -cmp : cmp;
 }
 
 /*
- * Compare two backups by backup_id (alphabetically)
- * Returns: <0 if a < b, 0 if a == b, >0 if a > b
+ * Record indices handed out in compare_listed() order, least first.
+ * Building the heap is linear and each pop logarithmic, so printing the
+ * first --limit backups of a group never sorts all of it.
  */
-static int
-compare_backups_by_name(const void *a, const void *b)
+typedef struct {
+	const BackupCatalog *catalog;
+	const ListOptions   *opts;
+	CatalogOrder         primary;
+	int                 *items;     /* owned by the caller */
+	int                  count;
+} ListHeap;
+
+static void
+list_heap_sift_down(ListHeap *heap, int i)
 {
-	const BackupInfo *backup_a = *(const BackupInfo **)a;
-	const BackupInfo *backup_b = *(const BackupInfo **)b;
+	for (;;)
+	{
+		int least = i;
+		int l = 2 * i + 1;
+		int r = l + 1;
+		int tmp;
+
+		if (l < heap->count &&
+			compare_listed(heap->catalog, heap->items[l], heap->items[least],
+						   heap->primary, heap->opts) < 0)
+			least = l;
+		if (r < heap->count &&
+			compare_listed(heap->catalog, heap->items[r], heap->items[least],
+						   heap->primary, heap->opts) < 0)
+			least = r;
+		if (least == i)
+			return;
+		tmp = heap->items[i];
+		heap->items[i] = heap->items[least];
+		heap->items[least] = tmp;
+		i = least;
+	}
+}
 
-	return strcmp(backup_a->backup_id, backup_b->backup_id);
+/* Arrange items[0..count-1] into a heap, in place */
+static void
+list_heap_init(ListHeap *heap, const BackupCatalog *catalog,
+			   const ListOptions *opts, CatalogOrder primary,
+			   int *items, int count)
+{
+	heap->catalog = catalog;
+	heap->opts = opts;
+	heap->primary = primary;
+	heap->items = items;
+	heap->count = count;
+	for (int i = count / 2 - 1; i >= 0; i--)
+		list_heap_sift_down(heap, i);
 }
 
-/*
- * Compare two backups by size (data_bytes)
- * Returns: <0 if a < b, 0 if a == b, >0 if a > b
- */
+/* The least record index left, or -1 */
 static int
-compare_backups_by_size(const void *a, const void *b)
+list_heap_pop(ListHeap *heap)
 {
-	const BackupInfo *backup_a = *(const BackupInfo **)a;
-	const BackupInfo *backup_b = *(const BackupInfo **)b;
+	int top;
 
-	uint64_t size_a = backup_a->data_bytes;
-	uint64_t size_b = backup_b->data_bytes;
-
-	if (size_a < size_b)
+	if (heap->count == 0)
 		return -1;
-	else if (size_a > size_b)
-		return 1;
-	else
-		return 0;
+	top = heap->items[0];
+	heap->items[0] = heap->items[--heap->count];
+	list_heap_sift_down(heap, 0);
+	return top;
 }
 
-/*
- * Sort backup list by specified field
- * Creates an array of pointers, sorts them, then rebuilds the linked list
- */
-static BackupInfo*
-sort_backups(BackupInfo *backups, const char *sort_by, bool reverse)
+static bool
+limit_reached(const ListOptions *opts, const OutputStats *stats)
 {
-	int (*comparator)(const void *, const void *);
-
-	if (backups == NULL)
-		return NULL;
-
-	/* Select comparator based on sort_by */
-	if (strcasecmp(sort_by, "time") == 0 || strcasecmp(sort_by, "start_time") == 0)
-		comparator = compare_backups_by_time;
-	else if (strcasecmp(sort_by, "end_time") == 0)
-		comparator = compare_backups_by_end_time;
-	else if (strcasecmp(sort_by, "name") == 0)
-		comparator = compare_backups_by_name;
-	else if (strcasecmp(sort_by, "size") == 0)
-		comparator = compare_backups_by_size;
-	else
-		comparator = compare_backups_by_time;  /* Default to time */
-
-	/* Count backups */
-	int count = 0;
-	BackupInfo *current = backups;
-	while (current != NULL)
-	{
-		count++;
-		current = current->next;
-	}
-
-	if (count <= 1)
-		return backups;  /* Nothing to sort */
-
-	/* Create array of pointers */
-	BackupInfo **array = malloc(count * sizeof(BackupInfo *));
-	if (array == NULL)
-		return backups;  /* Out of memory, return unsorted */
-
-	/* Fill array */
-	current = backups;
-	for (int i = 0; i < count; i++)
-	{
-		array[i] = current;
-		current = current->next;
-	}
-
-	/* Sort array */
-	qsort(array, count, sizeof(BackupInfo *), comparator);
-
-	/* Rebuild linked list */
-	if (reverse)
-	{
-		/* Reverse order: newest first */
-		for (int i = count - 1; i > 0; i--)
-			array[i]->next = array[i - 1];
-		array[0]->next = NULL;
-		backups = array[count - 1];
-	}
-	else
-	{
-		/* Normal order: oldest first */
-		for (int i = 0; i < count - 1; i++)
-			array[i]->next = array[i + 1];
-		array[count - 1]->next = NULL;
-		backups = array[0];
-	}
-
-	free(array);
-	return backups;
+	return opts->limit > 0 && stats->count >= opts->limit;
 }
 
 static const char *
@@ -549,30 +564,71 @@ print_backup_table_row_tree(const BackupInfo *backup,
 }
 
 /*
- * Collect direct children of parent_id from arr[0..count-1], sorted by
- * start_time.  Returns number of children found.
+ * Collect direct children of 'parent' from arr[0..count-1].  Interned
+ * ids compare by reference.  Returns number of children found.
  */
 static int
-collect_children(BackupInfo **arr, int count, const char *parent_id,
-				 BackupInfo **out, int capacity)
+collect_children(const BackupCatalog *catalog, const int *arr, int count,
+				 int parent, int *out)
 {
-	int n = 0;
-	for (int i = 0; i < count && n < capacity; i++)
+	CatalogStr parent_id = catalog->records[parent].backup_id;
+	int        n = 0;
+
+	for (int i = 0; i < count; i++)
 	{
-		if (arr[i]->parent_backup_id[0] != '\0' &&
-			strcmp(arr[i]->parent_backup_id, parent_id) == 0)
+		if (catalog->records[arr[i]].parent_backup_id == parent_id)
 			out[n++] = arr[i];
 	}
-	if (n > 1)
-		qsort(out, n, sizeof(BackupInfo *), compare_backups_by_time);
 	return n;
 }
 
+/*
+ * Print one record, loading what a lazy scan left out.  Kept out of
+ * print_chain_recursive() so the expanded BackupInfo is not on the stack
+ * of every tree level.
+ */
+static void
+print_record(const BackupCatalog *catalog, int index,
+			 const char *prefix, int extra_bytes,
+			 const ListOptions *opts, OutputStats *stats)
+{
+	BackupInfo backup;
+
+	/* Up to and including --after, backups are passed over unloaded */
+	if (stats->after >= 0)
+	{
+		if (index == stats->after)
+			stats->after = -1;
+		return;
+	}
+
+	backup_catalog_get(catalog, index, &backup);
+	backup_info_load(&backup);
+
+	stats->count++;
+	stats->last = index;
+	stats->total_bytes += backup.data_bytes;
+	if (opts->output == OUTPUT_NDJSON)
+	{
+		NdjsonRecord rec;
+
+		ndjson_begin(&rec, stdout, "backup");
+		ndjson_backup_fields(&rec, &backup);
+		ndjson_string(&rec, "directory",
+					  backup_catalog_str(catalog, catalog->records[index].backup_dir));
+		ndjson_end(&rec);
+		return;
+	}
+	print_backup_table_row_tree(&backup, prefix, extra_bytes);
+}
+
 /*
  * Recursively print a backup and all its descendants using proper tree
  * drawing (├─ for non-last children, └─ for the last child, │ for
  * vertical continuation lines at intermediate levels).
  *
+ * arr          — record indices of the directory group.
+ * visited      — per catalog record.
  * indent       — prefix string inherited from the parent level;
  *                starts empty for root nodes and grows with each level.
  * indent_extra — extra bytes in `indent` due to multi-byte UTF-8 chars.
@@ -580,22 +636,17 @@ collect_children(BackupInfo **arr, int count, const char *parent_id,
  * is_last      — true if this node is the last child of its parent.
  */
 static void
-print_chain_recursive(BackupInfo **arr, int count, bool *visited,
-					  BackupInfo *backup,
+print_chain_recursive(const BackupCatalog *catalog, const int *arr, int count,
+					  bool *visited, int backup,
 					  const char *indent, int indent_extra,
 					  bool is_root, bool is_last,
 					  const ListOptions *opts, OutputStats *stats)
 {
-	/* Mark visited */
-	for (int i = 0; i < count; i++)
-		if (arr[i] == backup) { visited[i] = true; break; }
+	visited[backup] = true;
 
-	if (opts->limit > 0 && stats->count >= opts->limit)
+	if (limit_reached(opts, stats))
 		return;
 
-	stats->count++;
-	stats->total_bytes += backup->data_bytes;
-
 	/* Build display prefix: indent + connector */
 	char display_prefix[256];
 	int  display_extra;
@@ -615,14 +666,23 @@ print_chain_recursive(BackupInfo **arr, int count, bool *visited,
 		display_extra = indent_extra + 4;
 	}
 
-	print_backup_table_row_tree(backup, display_prefix, display_extra);
+	print_record(catalog, backup, display_prefix, display_extra, opts, stats);
 
-	/* Collect children */
-	BackupInfo *children[256];
-	int nchildren = collect_children(arr, count, backup->backup_id,
-									 children, 256);
+	/* Collect children, handed out by start_time */
+	int *children = malloc(count * sizeof(int));
+	if (children == NULL)
+		return;
+	int nchildren = collect_children(catalog, arr, count, backup, children);
 	if (nchildren == 0)
+	{
+		free(children);
 		return;
+	}
+	ListHeap heap;
+	int      child;
+
+	list_heap_init(&heap, catalog, opts, CATALOG_ORDER_START_TIME,
+				   children, nchildren);
 
 	/*
 	 * Build indent for the next level.
@@ -644,23 +704,18 @@ print_chain_recursive(BackupInfo **arr, int count, bool *visited,
 		child_indent_extra = indent_extra + (is_last ? 0 : 2);
 	}
 
-	for (int i = 0; i < nchildren; i++)
+	while (!limit_reached(opts, stats) && (child = list_heap_pop(&heap)) >= 0)
 	{
-		if (opts->limit > 0 && stats->count >= opts->limit)
-			break;
-
 		/* Cycle guard */
-		bool already = false;
-		for (int j = 0; j < count; j++)
-			if (arr[j] == children[i] && visited[j]) { already = true; break; }
-		if (already)
+		if (visited[child])
 			continue;
 
-		print_chain_recursive(arr, count, visited, children[i],
+		print_chain_recursive(catalog, arr, count, visited, child,
 							  child_indent, child_indent_extra,
-							  false, (i == nchildren - 1),
+							  false, heap.count == 0,
 							  opts, stats);
 	}
+	free(children);
 }
 
 /*
@@ -669,114 +724,85 @@ print_chain_recursive(BackupInfo **arr, int count, bool *visited,
  * Displays backups grouped by chain: each FULL backup is followed by its
  * incremental descendants indented with tree characters (└─).  Backups
  * within a chain are ordered by start_time; orphaned incrementals (no
- * FULL ancestor in this group) are printed last at depth 0.
+ * FULL ancestor in this group) are printed last at depth 0, by start_lsn.
+ * Ties keep the --sort-by order (compare_listed()).
+ *
+ * Chain roots and orphans are taken from a heap one at a time, so with
+ * --limit only the backups printed are ever ordered.  A group that comes
+ * before the --after backup is passed over without being looked at.
+ * 'stats' counts for the whole output.
  */
-static OutputStats
-output_directory_group(const char *directory_path, BackupInfo *backups,
-					   const ListOptions *opts)
+static void
+output_directory_group(const BackupCatalog *catalog, int *arr, int count,
+					   bool *visited, const ListOptions *opts,
+					   OutputStats *stats)
 {
-	OutputStats stats = {0, 0};
+	const BackupRecord *first = &catalog->records[arr[0]];
+	ListHeap heap;
+	int      next;
+	int      n = 0;
+
+	if (stats->after >= 0 &&
+		catalog->records[stats->after].backup_dir != first->backup_dir)
+		return;
+
+	int *pending = malloc(count * sizeof(int));
+	if (pending == NULL)
+		return;
 
 	/* Resolve to absolute path, normalising any ".." components. */
+	const char *directory_path = backup_catalog_str(catalog, first->backup_dir);
 	char display_buf[PATH_MAX];
 	const char *display_path = directory_path;
 	if (realpath(directory_path, display_buf) != NULL)
 		display_path = display_buf;
-	printf("\nDirectory: %s\n", display_path);
-	if (backups != NULL && backups->instance_name[0] != '\0')
-		printf("Instance: %s\n", backups->instance_name);
-	print_table_header();
-
-	/* Convert linked list to array for random-access traversal */
-	int count = 0;
-	for (BackupInfo *b = backups; b != NULL; b = b->next)
-		count++;
-	if (count == 0)
-		return stats;
-
-	BackupInfo **arr    = malloc(count * sizeof(BackupInfo *));
-	bool        *visited = calloc(count, sizeof(bool));
-	if (arr == NULL || visited == NULL)
+	if (opts->output == OUTPUT_TABLE)
 	{
-		free(arr);
-		free(visited);
-		return stats;
+		printf("\nDirectory: %s\n", display_path);
+		if (first->instance_name != 0)
+			printf("Instance: %s\n", backup_catalog_str(catalog, first->instance_name));
+		print_table_header();
 	}
 
-	int idx = 0;
-	for (BackupInfo *b = backups; b != NULL; b = b->next)
-		arr[idx++] = b;
-
-	/* Sort by start_time for stable chain traversal */
-	qsort(arr, count, sizeof(BackupInfo *), compare_backups_by_time);
-
 	/* Print FULL backups (chain roots) with their incremental subtrees */
 	for (int j = 0; j < count; j++)
+		if (catalog->records[arr[j]].type == BACKUP_TYPE_FULL)
+			pending[n++] = arr[j];
+	list_heap_init(&heap, catalog, opts, CATALOG_ORDER_START_TIME, pending, n);
+	while (!limit_reached(opts, stats) && (next = list_heap_pop(&heap)) >= 0)
 	{
-		if (visited[j] || arr[j]->type != BACKUP_TYPE_FULL)
+		if (visited[next])
 			continue;
-		if (opts->limit > 0 && stats.count >= opts->limit)
-			break;
-		print_chain_recursive(arr, count, visited, arr[j],
-							  "", 0, true, true, opts, &stats);
+		print_chain_recursive(catalog, arr, count, visited, next,
+							  "", 0, true, true, opts, stats);
 	}
 
-	/* Print any unvisited backups (incrementals whose FULL is missing/elsewhere),
-	 * sorted by start_lsn so LSN order is preserved even without a chain root. */
+	/*
+	 * Print any unvisited backups (incrementals whose FULL is missing/elsewhere),
+	 * by start_lsn so LSN order is preserved even without a chain root.
+	 * Short of the limit, every chain above was printed in full, so
+	 * 'visited' is complete.
+	 */
+	n = 0;
+	for (int j = 0; j < count; j++)
+		if (!visited[arr[j]])
+			pending[n++] = arr[j];
+	list_heap_init(&heap, catalog, opts, CATALOG_ORDER_START_LSN, pending, n);
+	while (!limit_reached(opts, stats) && (next = list_heap_pop(&heap)) >= 0)
 	{
-		BackupInfo *orphans[1024];
-		int nordans = 0;
-		for (int j = 0; j < count && nordans < (int)(sizeof(orphans)/sizeof(*orphans)); j++)
-			if (!visited[j])
-				orphans[nordans++] = arr[j];
-
-		/* Sort orphans by start_lsn ascending */
-		for (int a = 0; a < nordans - 1; a++)
-			for (int b = a + 1; b < nordans; b++)
-				if (orphans[a]->start_lsn > orphans[b]->start_lsn)
-				{
-					BackupInfo *tmp = orphans[a];
-					orphans[a] = orphans[b];
-					orphans[b] = tmp;
-				}
-
-		for (int j = 0; j < nordans; j++)
-		{
-			if (opts->limit > 0 && stats.count >= opts->limit)
-				break;
-			print_chain_recursive(arr, count, visited, orphans[j],
-								  "", 0, true, true, opts, &stats);
-		}
+		if (visited[next])
+			continue;
+		print_chain_recursive(catalog, arr, count, visited, next,
+							  "", 0, true, true, opts, stats);
 	}
 
-	free(arr);
-	free(visited);
-	return stats;
+	free(pending);
 }
 
-/*
- * Helper function to extract parent directory from backup path
- */
-static void
-get_parent_directory(const char *backup_path, char *parent_dir, size_t parent_dir_size)
+static int
+compare_directories(const BackupCatalog *catalog, CatalogStr a, CatalogStr b)
 {
-	char *last_slash;
-
-	if (backup_path == NULL || backup_path[0] == '\0')
-	{
-		parent_dir[0] = '\0';
-		return;
-	}
-
-	/* Copy the path */
-	snprintf(parent_dir, parent_dir_size, "%s", backup_path);
-
-	/* Find last slash and truncate */
-	last_slash = strrchr(parent_dir, '/');
-	if (last_slash != NULL)
-		*last_slash = '\0';
-	else
-		parent_dir[0] = '\0';
+	return strcmp(backup_catalog_str(catalog, a), backup_catalog_str(catalog, b));
 }
 
 /*
@@ -785,152 +811,102 @@ get_parent_directory(const char *backup_path, char *parent_dir, size_t parent_di
  * Groups backups by parent directory and outputs each group
  * as a separate table.
  *
- * Iterates through the backup list and outputs each backup according to the
- * requested format (table, JSON, or YAML). Currently only table format
- * is fully implemented.
+ * Works on record indices of the catalog: filtering, grouping and
+ * ordering never copy backups.
  *
  * During iteration, accumulates statistics:
  * - Total number of backups displayed
  * - Total size of all backups in bytes
  *
- * Respects the --limit option to cap the number of backups shown.
+ * Respects the --limit option to cap the number of backups shown, and
+ * --after to start after a given backup.
  *
  * Parameters:
- * - backups: Linked list of BackupInfo structures to output
+ * - catalog: Scanned backups
  * - opts: List options including format and limit
+ * - after: Record index of the --after backup, or -1
  *
  * Returns:
  * - OutputStats structure containing count and total_bytes
  */
 static OutputStats
-output_backups(const BackupInfo *backups, const ListOptions *opts)
+output_backups(const BackupCatalog *catalog, const ListOptions *opts, int after)
 {
-	const BackupInfo *current;
-	OutputStats stats = {0, 0};
-	OutputStats dir_stats;
-
-	if (strcmp(opts->format, "table") == 0)
-	{
-		/*
-		 * Group backups by parent directory
-		 * First pass: find all unique parent directories
-		 */
-		char directory_paths[100][PATH_MAX];  /* Max 100 directories */
-		int num_directories = 0;
-
-		/* Collect unique parent directories */
-		current = backups;
-		while (current != NULL)
-		{
-			/* Apply filters */
-			if (matches_filters(current, opts))
-			{
-				char parent_dir[PATH_MAX];
-				get_parent_directory(current->backup_path, parent_dir, sizeof(parent_dir));
+	OutputStats stats = {0, 0, after, -1};
 
-				if (parent_dir[0] != '\0')
-				{
-					/* Check if we've seen this directory before */
-					bool found = false;
-					for (int i = 0; i < num_directories; i++)
-					{
-						if (strcmp(directory_paths[i], parent_dir) == 0)
-						{
-							found = true;
-							break;
-						}
-					}
-					if (!found && num_directories < 100)
-					{
-						snprintf(directory_paths[num_directories], PATH_MAX, "%s", parent_dir);
-						num_directories++;
-					}
-				}
-			}
-			current = current->next;
-		}
+	if (catalog->count == 0)
+		return stats;
+
+	int *matched = malloc(catalog->count * sizeof(int));
+	CatalogStr *directories = malloc(catalog->count * sizeof(CatalogStr));
+	bool *visited = calloc(catalog->count, sizeof(bool));
+	int nmatched = 0;
+	int num_directories = 0;
+
+	if (matched == NULL || directories == NULL || visited == NULL)
+	{
+		free(matched);
+		free(directories);
+		free(visited);
+		return stats;
+	}
 
-		/* Sort directory paths lexicographically */
-		if (num_directories > 1)
+	/* Apply filters; backups without a parent directory are not shown */
+	for (int i = 0; i < catalog->count; i++)
+	{
+		const BackupRecord *rec = &catalog->records[i];
+
+		if (rec->backup_dir != 0 && matches_filters(rec, opts))
+			matched[nmatched++] = i;
+	}
+
+	/* Unique parent directories (same string, same reference) */
+	for (int i = 0; i < nmatched; i++)
+	{
+		CatalogStr dir = catalog->records[matched[i]].backup_dir;
+		bool       found = false;
+
+		for (int d = 0; d < num_directories && !found; d++)
+			found = (directories[d] == dir);
+		if (!found)
+			directories[num_directories++] = dir;
+	}
+
+	/* Sort directory paths lexicographically */
+	for (int i = 1; i < num_directories; i++)
+	{
+		CatalogStr v = directories[i];
+		int        j = i;
+
+		while (j > 0 && compare_directories(catalog, directories[j - 1], v) > 0)
 		{
-			for (int i = 0; i < num_directories - 1; i++)
-			{
-				for (int j = i + 1; j < num_directories; j++)
-				{
-					if (strcmp(directory_paths[i], directory_paths[j]) > 0)
-					{
-						/* Swap */
-						char temp[PATH_MAX];
-						memcpy(temp, directory_paths[i], PATH_MAX);
-						memcpy(directory_paths[i], directory_paths[j], PATH_MAX);
-						memcpy(directory_paths[j], temp, PATH_MAX);
-					}
-				}
-			}
+			directories[j] = directories[j - 1];
+			j--;
 		}
+		directories[j] = v;
+	}
 
-		/* Output each directory group */
-		for (int i = 0; i < num_directories; i++)
-		{
-			/* Stop early if global limit already reached */
-			if (opts->limit > 0 && stats.count >= opts->limit)
-				break;
+	/* Output each directory group */
+	int *group = malloc(nmatched > 0 ? nmatched * sizeof(int) : sizeof(int));
+	for (int d = 0; group != NULL && d < num_directories; d++)
+	{
+		int count = 0;
 
-			/* Build a list of backups for this directory */
-			BackupInfo *dir_list = NULL;
-			BackupInfo *dir_tail = NULL;
+		/* Stop early if global limit already reached */
+		if (limit_reached(opts, &stats))
+			break;
 
-			current = backups;
-			while (current != NULL)
-			{
-				if (matches_filters(current, opts))
-				{
-					char parent_dir[PATH_MAX];
-					get_parent_directory(current->backup_path, parent_dir, sizeof(parent_dir));
-
-					if (strcmp(parent_dir, directory_paths[i]) == 0)
-					{
-						BackupInfo *copy = (BackupInfo *) malloc(sizeof(BackupInfo));
-						if (copy != NULL)
-						{
-							memcpy(copy, current, sizeof(BackupInfo));
-							copy->next = NULL;
-
-							if (dir_list == NULL)
-								dir_list = copy;
-							else
-								dir_tail->next = copy;
-							dir_tail = copy;
-						}
-					}
-				}
-				current = current->next;
-			}
-
-			if (dir_list != NULL)
-			{
-				/* Remaining slots under the global limit */
-				int remaining = (opts->limit > 0) ? (opts->limit - stats.count) : 0;
-
-				/* Temporarily override limit for this group */
-				ListOptions group_opts = *opts;
-				group_opts.limit = remaining;
-
-				/* sort_by is ignored inside output_directory_group — chains
-				 * are always displayed in start_time order for coherent tree
-				 * traversal.  The external sort still affects FULL ordering
-				 * when all backups share the same start_time (rare). */
-				dir_list  = sort_backups(dir_list, opts->sort_by, opts->reverse);
-				dir_stats = output_directory_group(directory_paths[i], dir_list, &group_opts);
-				stats.count += dir_stats.count;
-				stats.total_bytes += dir_stats.total_bytes;
-
-				free_backup_list(dir_list);
-			}
-		}
+		for (int i = 0; i < nmatched; i++)
+			if (catalog->records[matched[i]].backup_dir == directories[d])
+				group[count++] = matched[i];
+
+		output_directory_group(catalog, group, count, visited, opts, &stats);
 	}
-	/* format is validated before reaching here — only "table" is accepted */
 
+	free(group);
+	free(matched);
+	free(directories);
+	free(visited);
 	return stats;
 }
 
@@ -940,8 +916,9 @@ output_backups(const BackupInfo *backups, const ListOptions *opts)
  * Executes the complete list command workflow:
  * 1. Parse command-line arguments (--backup-dir, --type, --status, etc.)
  * 2. Scan backup directory via scan_backup_directory()
- * 3. Sort results by selected field (sort_backups)
- * 4. Output filtered and limited backup list as a table (output_backups)
+ * 3. Find the --after backup, if any
+ * 4. Output filtered and limited backup list as a table (output_backups),
+ *    ordered by chain and --sort-by as it is printed
  * 5. Display summary statistics (backup count and total size)
  *
  * Returns:
@@ -954,7 +931,9 @@ cmd_list_main(int argc, char **argv)
 {
 	ListOptions opts;
 	BackupInfo *backups = NULL;
+	BackupCatalog *catalog;
 	int ret;
+	int after = -1;
 	OutputStats stats;
 	char total_size_str[64];
 
@@ -973,11 +952,30 @@ cmd_list_main(int argc, char **argv)
 	if (ret != EXIT_SUCCESS)
 		return ret;
 
+	validation_set_cache_dir(opts.cache_dir);
+	scan_set_jobs(opts.jobs);
+	if (opts.sizes != NULL)
+	{
+		SizeMode mode;
+
+		size_mode_from_string(opts.sizes, &mode);
+		scan_set_size_mode(mode);
+	}
+	if (!storage_resolve(&opts.backup_dir, STAGE_METADATA))
+		return EXIT_GENERAL_ERROR;
+
 	/* Log what we're doing */
 	log_info("Scanning backup directory: %s", opts.backup_dir);
 
-	/* Scan backup directory */
+	/*
+	 * Scan backup directory.  With --limit, only the rows printed need
+	 * sizes and manifest details; they are loaded as they are printed.
+	 * Sorting by size needs them all up front.
+	 */
+	if (opts.limit > 0 && strcasecmp(opts.sort_by, "size") != 0)
+		scan_set_load_level(BACKUP_LOAD_IDENTITY);
 	backups = scan_backup_directory(opts.backup_dir, opts.max_depth);
+	scan_set_load_level(BACKUP_LOAD_FULL);
 
 	if (backups == NULL)
 	{
@@ -986,8 +984,37 @@ cmd_list_main(int argc, char **argv)
 		return EXIT_GENERAL_ERROR;
 	}
 
-	/* Output results (sorting is done per-directory group inside output_backups) */
-	stats = output_backups(backups, &opts);
+	/* Keep the compact catalog only; the scanned list is several KB a backup */
+	catalog = backup_catalog_build(backups);
+	free_backup_list(backups);
+	if (catalog == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		return EXIT_GENERAL_ERROR;
+	}
+
+	/* --after must name a backup the filters keep, or nothing would follow */
+	if (opts.after != NULL)
+	{
+		after = backup_catalog_find(catalog, opts.after);
+		if (after < 0)
+		{
+			fprintf(stderr, "Error: Backup with ID '%s' not found\n", opts.after);
+			backup_catalog_free(catalog);
+			return EXIT_GENERAL_ERROR;
+		}
+		if (catalog->records[after].backup_dir == 0 ||
+			!matches_filters(&catalog->records[after], &opts))
+		{
+			fprintf(stderr, "Error: Backup '%s' is not listed with the given filters\n",
+					opts.after);
+			backup_catalog_free(catalog);
+			return EXIT_INVALID_ARGUMENTS;
+		}
+	}
+
+	/* Output results (ordering is done per-directory group inside output_backups) */
+	stats = output_backups(catalog, &opts, after);
 
 	/* Format total size */
 	if (stats.total_bytes > 0)
@@ -1008,12 +1035,27 @@ cmd_list_main(int argc, char **argv)
 		snprintf(total_size_str, sizeof(total_size_str), "N/A");
 
 	/* Summary */
-	printf("\nTotal backups found: %d\n", stats.count);
-	printf("Total size: %s\n", total_size_str);
+	if (opts.output == OUTPUT_NDJSON)
+	{
+		NdjsonRecord rec;
+
+		ndjson_begin(&rec, stdout, "summary");
+		ndjson_int(&rec, "backups", stats.count);
+		ndjson_uint(&rec, "total_bytes", stats.total_bytes);
+		ndjson_string(&rec, "last_backup_id", stats.last >= 0
+					  ? backup_catalog_str(catalog, catalog->records[stats.last].backup_id)
+					  : NULL);
+		ndjson_end(&rec);
+	}
+	else
+	{
+		printf("\nTotal backups found: %d\n", stats.count);
+		printf("Total size: %s\n", total_size_str);
+	}
 	log_info("Total backups found: %d, total size: %s", stats.count, total_size_str);
 
 	/* Cleanup */
-	free_backup_list(backups);
+	backup_catalog_free(catalog);
 
 	return EXIT_SUCCESS;
 }
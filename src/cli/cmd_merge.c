@@ -0,0 +1,455 @@
+/*
+ * cmd_merge.c
+ *
+ * Implementation of 'merge' command: the parts of a sharded check
+ * (check --shard=K/N --format=ndjson) combined into the report one
+ * unsharded run would have printed.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pg_backup_auditor.h"
+#include "cmd_help.h"
+#include "arg_parser.h"
+#include "json_scan.h"
+#include "ndjson.h"
+#include "shard_merge.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+/* Command-line options */
+typedef struct {
+	OutputFormat output;
+	char **parts;           /* files, "-" for stdin */
+	int part_count;
+} MergeOptions;
+
+static int
+parse_arguments(int argc, char **argv, MergeOptions *opts)
+{
+	int c;
+	int option_index = 0;
+	bool format_seen = false;
+
+	static struct option long_options[] = {
+		{"format",          required_argument, 0, 'f'},
+		{"help",            no_argument,       0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	while ((c = getopt_long(argc, argv, "f:h",
+							long_options, &option_index)) != -1)
+	{
+		switch (c)
+		{
+			case 'f':
+				if (check_duplicate_option(format_seen, "--format"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!output_format_from_string(optarg, &opts->output))
+				{
+					fprintf(stderr, "Error: Invalid format: %s\n", optarg);
+					fprintf(stderr, "Valid formats: table, ndjson\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				format_seen = true;
+				break;
+			case 'h':
+				print_merge_usage();
+				return EXIT_SUCCESS;
+			case '?':
+				return EXIT_INVALID_ARGUMENTS;
+			default:
+				return EXIT_INVALID_ARGUMENTS;
+		}
+	}
+
+	opts->parts = argv + optind;
+	opts->part_count = argc - optind;
+	if (opts->part_count == 0)
+	{
+		fprintf(stderr, "Error: No parts given (the NDJSON output of each 'check --shard=K/N')\n");
+		return EXIT_INVALID_ARGUMENTS;
+	}
+
+	return -1;  /* Continue processing */
+}
+
+/* A string member of a stored record into 'buf'; "" if absent or null */
+static const char *
+record_string(const char *record, const char *key, char *buf, size_t size)
+{
+	JsonSlice v;
+
+	buf[0] = '\0';
+	if (json_get_fields(record, &key, 1, &v) && v.ptr != NULL && v.ptr[-1] == '"')
+		(void) json_slice_unescape(v, buf, size);
+	return buf;
+}
+
+/* Print [ERROR]/[WARNING]/[OK] lines of one backup, as 'check' does */
+static void
+print_backup(const ShardEntry *entry, bool in_chain)
+{
+	const ValidationResult *result = &entry->result;
+	char        type[32];
+	char        parent[64];
+	char        status[32];
+	const char *indent;
+
+	record_string(entry->record, "backup_type", type, sizeof(type));
+	record_string(entry->record, "parent_backup_id", parent, sizeof(parent));
+	indent = in_chain && strcmp(type, "FULL") != 0 ? "  " : "";
+
+	printf("\n%s%sBackup:%s %s (%s)",
+		   indent, use_color ? COLOR_BOLD : "", use_color ? COLOR_RESET : "",
+		   entry->name, type);
+	if (parent[0] != '\0')
+		printf("  ->  parent: %s", parent);
+	printf("\n");
+
+	if (entry->skipped)
+	{
+		printf("%s  %s[SKIPPED]%s Status: %s - validation not performed\n",
+			   indent, use_color ? COLOR_CYAN : "", use_color ? COLOR_RESET : "",
+			   record_string(entry->record, "status", status, sizeof(status)));
+		return;
+	}
+	for (int i = 0; i < result->error_count; i++)
+		printf("%s  %s[ERROR]%s %s\n", indent,
+			   use_color ? COLOR_RED : "", use_color ? COLOR_RESET : "",
+			   result->errors[i]);
+	for (int i = 0; i < result->warning_count; i++)
+		printf("%s  %s[WARNING]%s %s\n", indent,
+			   use_color ? COLOR_YELLOW : "", use_color ? COLOR_RESET : "",
+			   result->warnings[i]);
+	if (result->error_count == 0 && result->warning_count == 0)
+		printf("%s  %s[OK]%s Backup validation: passed\n", indent,
+			   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "");
+}
+
+/* The chain header; false for the orphaned group */
+static bool
+print_chain(const ShardEntry *entry)
+{
+	char root[64];
+	char tool[32];
+	char start[32];
+	char members[16] = "";
+	JsonSlice v;
+	static const char *const key = "members";
+
+	printf("\n");
+	if (record_string(entry->record, "root", root, sizeof(root))[0] == '\0')
+	{
+		printf("Orphaned Backups\n");
+		printf("----------------------------------------------------\n");
+		return false;
+	}
+
+	record_string(entry->record, "tool", tool, sizeof(tool));
+	record_string(entry->record, "start_time", start, sizeof(start));
+	/* The date of the ISO 8601 start time */
+	if (strlen(start) > 10)
+		start[10] = '\0';
+	printf("Chain: %s  %s  %s", root, tool, start[0] != '\0' ? start : "N/A");
+	if (json_get_fields(entry->record, &key, 1, &v) &&
+		json_slice_copy(v, members, sizeof(members)) && atoi(members) > 1)
+		printf("  (+%d incremental%s)", atoi(members) - 1,
+			   atoi(members) == 2 ? "" : "s");
+	printf("\n");
+	printf("----------------------------------------------------\n");
+	return true;
+}
+
+static void
+print_wal_check(const ShardEntry *entry)
+{
+	const ValidationResult *result = &entry->result;
+	const char *what = strcmp(entry->check, "restore_chain") == 0 ? "WAL restore chain" :
+		strcmp(entry->check, "continuity") == 0 ? "WAL archive continuity" :
+		strcmp(entry->check, "headers") == 0 ? "WAL archive headers" : entry->check;
+
+	if (result->error_count > 0)
+	{
+		printf("  %s[ERROR]%s %s:\n",
+			   use_color ? COLOR_RED : "", use_color ? COLOR_RESET : "", what);
+		for (int i = 0; i < result->error_count; i++)
+			printf("          %s\n", result->errors[i]);
+	}
+	else
+		printf("  %s[OK]%s %s\n",
+			   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "", what);
+}
+
+static void
+print_report(const ShardMerge *merge, const ShardMergeTotals *totals)
+{
+	const char *archive = NULL;
+	bool        in_chain = false;
+
+	printf("====================================================\n");
+	printf("Backup Validation\n");
+	printf("====================================================\n");
+	printf("Validation level: %s\n", merge->level);
+	printf("Shards:           %d merged\n", merge->count);
+	printf("====================================================\n");
+
+	for (int i = merge->first; i >= 0; i = merge->entries[i].next)
+	{
+		const ShardEntry *entry = &merge->entries[i];
+
+		switch (entry->kind)
+		{
+			case SHARD_ENTRY_CHAIN:
+				in_chain = print_chain(entry);
+				break;
+			case SHARD_ENTRY_BACKUP:
+				print_backup(entry, in_chain);
+				break;
+			case SHARD_ENTRY_WAL_CHECK:
+				if (archive == NULL || strcmp(archive, entry->name) != 0)
+				{
+					archive = entry->name;
+					printf("\nWAL Archive: %s\n", archive);
+					printf("----------------------------------------------------\n");
+				}
+				print_wal_check(entry);
+				break;
+		}
+	}
+
+	printf("\n");
+	printf("====================================================\n");
+	printf("Validation Summary\n");
+	printf("====================================================\n");
+	printf("  Total backups found:    %d\n", totals->backups_found);
+	printf("  Backups validated:      %d\n", totals->backups_validated);
+	if (totals->backups_skipped > 0)
+		printf("  Backups skipped:        %d (ERROR/CORRUPT status)\n",
+			   totals->backups_skipped);
+	if (merge->sampled)
+	{
+		printf("  Sampled files:          %llu of %llu\n",
+			   (unsigned long long) merge->sampled_files,
+			   (unsigned long long) merge->checksummed_files);
+		if (merge->wal_segments > 0)
+			printf("  Sampled WAL segments:   %llu of %llu\n",
+				   (unsigned long long) merge->sampled_wal_segments,
+				   (unsigned long long) merge->wal_segments);
+	}
+	if (merge->stopped)
+		printf("  Fail-fast:              a shard stopped at its first error\n");
+	printf("----------------------------------------------------\n");
+	printf("  Validation errors:      %d\n", totals->errors);
+	printf("  Validation warnings:    %d\n", totals->warnings);
+	printf("====================================================\n");
+
+	if (totals->errors > 0)
+		printf("\n%sResult: FAILED%s\n",
+			   use_color ? COLOR_RED : "", use_color ? COLOR_RESET : "");
+	else if (totals->warnings > 0)
+		printf("\n%sResult: WARNING%s\n",
+			   use_color ? COLOR_YELLOW : "", use_color ? COLOR_RESET : "");
+	else if (totals->backups_validated == 0 && totals->backups_skipped > 0)
+		printf("\n%sResult: NO VALIDATION PERFORMED%s\n",
+			   use_color ? COLOR_CYAN : "", use_color ? COLOR_RESET : "");
+	else
+		printf("\n%sResult: OK%s\n",
+			   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "");
+}
+
+/* A backup record as read, with the outcome of the merged result */
+static void
+emit_backup(const ShardEntry *entry)
+{
+	NdjsonRecord rec;
+	JsonCursor   c;
+	const char  *outcome = "skipped";
+
+	if (!entry->skipped)
+		outcome = entry->result.error_count > 0 ? "error" :
+			entry->result.warning_count > 0 ? "warning" : "ok";
+
+	ndjson_begin(&rec, stdout, "backup");
+	c.p = entry->record;
+	c.end = entry->record + strlen(entry->record);
+	json_skip_ws(&c);
+	c.p++;                      /* '{', checked when the part was read */
+	for (;;)
+	{
+		JsonSlice   key;
+		const char *value;
+		char        name[64];
+
+		json_skip_ws(&c);
+		if (json_peek(&c) != '"' || !json_scan_string(&c, &key))
+			break;
+		json_skip_ws(&c);
+		if (json_peek(&c) != ':')
+			break;
+		c.p++;
+		json_skip_ws(&c);
+		value = c.p;
+		if (!json_skip_value(&c, NULL))
+			break;
+		json_slice_copy(key, name, sizeof(name));
+		if (strcmp(name, "record") != 0 && strcmp(name, "result") != 0 &&
+			strcmp(name, "errors") != 0 && strcmp(name, "warnings") != 0)
+			ndjson_raw(&rec, name, value, (size_t) (c.p - value));
+		json_skip_ws(&c);
+		if (json_peek(&c) == ',')
+			c.p++;
+	}
+	ndjson_string(&rec, "result", outcome);
+	ndjson_int(&rec, "errors", entry->result.error_count);
+	ndjson_int(&rec, "warnings", entry->result.warning_count);
+	ndjson_end(&rec);
+
+	if (!entry->skipped)
+		ndjson_findings(stdout, &entry->result, entry->name, NULL, "backup");
+}
+
+/* The merged records, as one unsharded 'check --format=ndjson' writes them */
+static void
+emit_records(const ShardMerge *merge, const ShardMergeTotals *totals)
+{
+	NdjsonRecord rec;
+	const char  *outcome = "ok";
+
+	for (int i = merge->first; i >= 0; i = merge->entries[i].next)
+	{
+		const ShardEntry *entry = &merge->entries[i];
+
+		switch (entry->kind)
+		{
+			case SHARD_ENTRY_CHAIN:
+				fprintf(stdout, "%s\n", entry->record);
+				break;
+			case SHARD_ENTRY_BACKUP:
+				emit_backup(entry);
+				break;
+			case SHARD_ENTRY_WAL_CHECK:
+				ndjson_begin(&rec, stdout, "wal_check");
+				ndjson_string(&rec, "archive", entry->name);
+				ndjson_string(&rec, "check", entry->check);
+				ndjson_int(&rec, "errors", entry->result.error_count);
+				ndjson_end(&rec);
+				ndjson_findings(stdout, &entry->result, NULL, entry->name, entry->check);
+				break;
+		}
+	}
+
+	if (totals->errors > 0)
+		outcome = "failed";
+	else if (totals->warnings > 0)
+		outcome = "warning";
+	else if (totals->backups_validated == 0 && totals->backups_skipped > 0)
+		outcome = "none";
+
+	ndjson_begin(&rec, stdout, "summary");
+	ndjson_int(&rec, "backups_found", totals->backups_found);
+	ndjson_int(&rec, "backups_validated", totals->backups_validated);
+	ndjson_int(&rec, "backups_skipped", totals->backups_skipped);
+	ndjson_int(&rec, "errors", totals->errors);
+	ndjson_int(&rec, "warnings", totals->warnings);
+	ndjson_bool(&rec, "stopped", merge->stopped);
+	if (merge->sampled)
+	{
+		ndjson_uint(&rec, "sampled_files", merge->sampled_files);
+		ndjson_uint(&rec, "checksummed_files", merge->checksummed_files);
+		ndjson_uint(&rec, "sampled_wal_segments", merge->sampled_wal_segments);
+		ndjson_uint(&rec, "wal_segments", merge->wal_segments);
+	}
+	ndjson_int(&rec, "shards", merge->count);
+	ndjson_string(&rec, "result", outcome);
+	ndjson_end(&rec);
+}
+
+/*
+ * cmd_merge_main - Main function for the 'merge' command
+ *
+ * Return codes are those of 'check' for the merged report:
+ * - EXIT_SUCCESS (0) if all checks passed
+ * - 2 (EXIT_VALIDATION_FAILED) if validation issues were found
+ * - EXIT_FAILURE (1) if a part cannot be read, is incomplete, belongs to
+ *   another run, or a shard is missing
+ * - 4 (EXIT_INVALID_ARGUMENTS) on invalid arguments
+ */
+int
+cmd_merge_main(int argc, char **argv)
+{
+	MergeOptions     opts = { OUTPUT_TABLE, NULL, 0 };
+	ShardMerge      *merge;
+	ShardMergeTotals totals;
+	int              ret;
+
+	ret = parse_arguments(argc, argv, &opts);
+	if (ret == EXIT_SUCCESS)  /* --help was shown */
+		return EXIT_SUCCESS;
+	if (ret != -1)
+		return ret;
+
+	merge = shard_merge_create();
+	if (merge == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		return EXIT_GENERAL_ERROR;
+	}
+
+	for (int i = 0; i < opts.part_count; i++)
+	{
+		bool  is_stdin = strcmp(opts.parts[i], "-") == 0;
+		FILE *fp = is_stdin ? stdin : fopen(opts.parts[i], "r");
+		bool  ok;
+
+		if (fp == NULL)
+		{
+			fprintf(stderr, "Error: Cannot open %s: %s\n", opts.parts[i], strerror(errno));
+			shard_merge_free(merge);
+			return EXIT_GENERAL_ERROR;
+		}
+		ok = shard_merge_add(merge, fp, is_stdin ? "(stdin)" : opts.parts[i]);
+		if (!is_stdin)
+			fclose(fp);
+		if (!ok)
+		{
+			shard_merge_free(merge);
+			return EXIT_GENERAL_ERROR;
+		}
+	}
+
+	if (!shard_merge_complete(merge))
+	{
+		shard_merge_free(merge);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	log_info("Merged %d shard part%s: %d entr%s",
+			 merge->parts, merge->parts == 1 ? "" : "s",
+			 merge->entry_count, merge->entry_count == 1 ? "y" : "ies");
+
+	shard_merge_totals(merge, &totals);
+	if (opts.output == OUTPUT_TABLE)
+		print_report(merge, &totals);
+	else
+		emit_records(merge, &totals);
+
+	shard_merge_free(merge);
+	return totals.errors > 0 || totals.warnings > 0 ? EXIT_VALIDATION_FAILED : EXIT_SUCCESS;
+}
@@ -25,14 +25,16 @@
 #include "cmd_help.h"
 #include "arg_parser.h"
 #include "adapter.h"
+#include "ndjson.h"
+#include "backup_stats.h"
+#include "storage.h"
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <getopt.h>
 #include <limits.h>
-#include <dirent.h>
-#include <sys/stat.h>
 
 /*
  * Per-row format for the per-(tool, type) statistics table.
@@ -45,39 +47,46 @@
 typedef struct {
 	char *backup_dir;
 	char *wal_archive;
+	char *cache_dir;    /* Catalog index directory, or NULL */
+	int jobs;           /* Directory scan threads */
+	char *sizes;        /* metadata|walk|none, or NULL for default */
+	OutputFormat output;
 } StatOptions;
 
-typedef struct {
-	BackupTool tool;
-	BackupType type;
-	char       instance_name[64];
-	int        count;
-	uint64_t   total_bytes;
-	uint64_t   total_wal_bytes;
-	time_t     min_time;
-	time_t     max_time;
-	int64_t    total_duration;
-	int        duration_count;
-	int        ok_count;
-} StatGroup;
+/* False with --format=ndjson: the report text is not printed */
+static bool table_output = true;
 
-typedef struct {
-	time_t   start_time;
-	uint64_t data_bytes;
-} FullEntry;
+/* printf() for the human-readable report */
+static void
+report(const char *fmt, ...)
+{
+	va_list args;
 
-typedef struct {
-	BackupTool tool;
-	char       instance_name[64];
-	FullEntry  fulls[200];
-	int        full_count;
-} GrowthTrack;
+	if (!table_output)
+		return;
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+}
+
+/* Tool and instance members shared by the grouped records */
+static void
+emit_group_key(NdjsonRecord *rec, BackupTool tool, const char *instance)
+{
+	ndjson_string(rec, "tool", backup_tool_to_string(tool));
+	ndjson_string(rec, "instance",
+				  instance != NULL && instance[0] != '\0' ? instance : NULL);
+}
 
 static void
 init_options(StatOptions *opts)
 {
 	opts->backup_dir = NULL;
 	opts->wal_archive = NULL;
+	opts->cache_dir = NULL;
+	opts->jobs = DEFAULT_THREADS;
+	opts->sizes = NULL;
+	opts->output = OUTPUT_TABLE;
 }
 
 static int
@@ -86,15 +95,23 @@ parse_arguments(int argc, char **argv, StatOptions *opts)
 	int c;
 	int option_index = 0;
 	bool backup_dir_seen = false;
+	bool cache_dir_seen = false;
+	bool jobs_seen = false;
+	bool sizes_seen = false;
+	bool format_seen = false;
 
 	static struct option long_options[] = {
 		{"backup-dir",   required_argument, 0, 'B'},
 		{"wal-archive",  required_argument, 0, 'W'},
+		{"cache-dir",    required_argument, 0, 'C'},
+		{"jobs",         required_argument, 0, 'j'},
+		{"sizes",        required_argument, 0, 'z'},
+		{"format",       required_argument, 0, 'f'},
 		{"help",         no_argument,       0, 'h'},
 		{0, 0, 0, 0}
 	};
 
-	while ((c = getopt_long(argc, argv, "B:W:h",
+	while ((c = getopt_long(argc, argv, "B:W:j:f:h",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -106,6 +123,37 @@ parse_arguments(int argc, char **argv, StatOptions *opts)
 			case 'W':
 				opts->wal_archive = optarg;
 				break;
+			case 'j':
+				if (check_duplicate_option(jobs_seen, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_int_argument(optarg, &opts->jobs, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->jobs < 1)
+				{
+					fprintf(stderr, "Error: --jobs must be >= 1\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				jobs_seen = true;
+				break;
+			case 'C':
+				if (!parse_string_option("--cache-dir", optarg, &opts->cache_dir, &cache_dir_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'z':
+				if (!parse_string_option("--sizes", optarg, &opts->sizes, &sizes_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'f':
+				if (check_duplicate_option(format_seen, "--format"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!output_format_from_string(optarg, &opts->output))
+				{
+					fprintf(stderr, "Error: Invalid format: %s\n", optarg);
+					fprintf(stderr, "Valid formats: table, ndjson\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				format_seen = true;
+				break;
 			case 'h':
 				print_stat_usage();
 				return EXIT_SUCCESS;
@@ -122,15 +170,30 @@ parse_arguments(int argc, char **argv, StatOptions *opts)
 static int
 validate_options(const StatOptions *opts)
 {
+	SizeMode dummy_mode;
+
 	if (!validate_required_option(opts->backup_dir, "--backup-dir"))
 		return EXIT_INVALID_ARGUMENTS;
 
-	if (!is_directory(opts->backup_dir))
+	if (!storage_is_remote(opts->backup_dir) && !is_directory(opts->backup_dir))
 	{
 		fprintf(stderr, "Error: Backup directory does not exist: %s\n", opts->backup_dir);
 		return EXIT_GENERAL_ERROR;
 	}
 
+	if (opts->cache_dir != NULL && !is_directory(opts->cache_dir))
+	{
+		fprintf(stderr, "Error: Cache directory does not exist: %s\n", opts->cache_dir);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	if (opts->sizes != NULL && !size_mode_from_string(opts->sizes, &dummy_mode))
+	{
+		fprintf(stderr, "Error: Invalid size mode: %s\n", opts->sizes);
+		fprintf(stderr, "Valid values: metadata, walk, none\n");
+		return EXIT_INVALID_ARGUMENTS;
+	}
+
 	return EXIT_SUCCESS;
 }
 
@@ -220,225 +283,198 @@ format_interval(double seconds, char *buf, size_t size)
 		snprintf(buf, size, "<1m");
 }
 
-static StatGroup *
-find_or_create_group(StatGroup *groups, int *group_count, int group_cap,
-					 BackupTool tool, BackupType type, const char *instance_name)
-{
-	for (int i = 0; i < *group_count; i++)
-	{
-		if (groups[i].tool == tool && groups[i].type == type &&
-			strcmp(groups[i].instance_name, instance_name) == 0)
-			return &groups[i];
-	}
-
-	if (*group_count >= group_cap)
-		return NULL;  /* Too many groups */
-
-	StatGroup *g = &groups[*group_count];
-	g->tool = tool;
-	g->type = type;
-	str_copy(g->instance_name, instance_name, sizeof(g->instance_name));
-	g->count = 0;
-	g->total_bytes = 0;
-	g->total_wal_bytes = 0;
-	g->min_time = LLONG_MAX;
-	g->max_time = 0;
-	g->total_duration = 0;
-	g->duration_count = 0;
-	g->ok_count = 0;
-
-	(*group_count)++;
-	return g;
-}
-
+/* Tool / instance heading of a report block */
 static void
-free_stat_groups(StatGroup *groups, int group_count)
+report_instance_heading(BackupTool tool, const char *instance_name)
 {
-	(void)group_count;  /* unused */
-	free(groups);
-}
-
-static int
-compare_groups(const void *a, const void *b)
-{
-	const StatGroup *ga = (const StatGroup *)a;
-	const StatGroup *gb = (const StatGroup *)b;
-
-	if (ga->tool != gb->tool)
-		return (int)ga->tool - (int)gb->tool;
-	if (strcmp(ga->instance_name, gb->instance_name) != 0)
-		return strcmp(ga->instance_name, gb->instance_name);
-	return (int)ga->type - (int)gb->type;
-}
-
-static int
-compare_full_entries(const void *a, const void *b)
-{
-	const FullEntry *fa = (const FullEntry *)a;
-	const FullEntry *fb = (const FullEntry *)b;
-	return (int)(fa->start_time - fb->start_time);
+	report("  %s", backup_tool_to_string(tool));
+	if (instance_name[0] != '\0' && strcmp(instance_name, "localhost") != 0)
+		report(" / %s", instance_name);
+	report("\n");
 }
 
+/* WAL volume of an instance over a time range (start times or mtimes) */
 typedef struct {
-	uint64_t total_wal;
-	time_t min_time;
-	time_t max_time;
-} WalArchiveStats;
+	uint64_t total;
+	time_t   min_time;
+	time_t   max_time;
+} WalVolume;
 
-static WalArchiveStats __attribute__((unused))
-analyze_wal_archive(const char *wal_archive_path)
+/*
+ * Volume of a WAL archive: every file the archive scan found, over the
+ * range of its segments' mtimes.
+ */
+static WalVolume
+archive_wal_volume(const char *wal_archive_path)
 {
-	WalArchiveStats stats = {0, LLONG_MAX, 0};
+	WalVolume       vol = {0, 0, 0};
+	WALArchiveInfo *info = scan_wal_archive(wal_archive_path);
 
-	if (!wal_archive_path || !is_directory(wal_archive_path))
-		return stats;
+	if (info == NULL)
+		return vol;
 
-	DIR *dir = opendir(wal_archive_path);
-	if (!dir)
-		return stats;
-
-	struct dirent *entry;
-	while ((entry = readdir(dir)) != NULL)
+	vol.total = info->total_bytes;
+	for (int i = 0; info->stats != NULL && i < info->segment_count; i++)
 	{
-		if (entry->d_name[0] == '.')
-			continue;
-		if (strstr(entry->d_name, ".backup") != NULL)
-			continue;
+		time_t t = info->stats[i].mtime;
 
-		char full_path[PATH_MAX];
-		struct stat st;
-		path_join(full_path, sizeof(full_path), wal_archive_path, entry->d_name);
-
-		if (stat(full_path, &st) == 0 && S_ISREG(st.st_mode))
-		{
-			stats.total_wal += st.st_size;
-			if (st.st_mtime < stats.min_time)
-				stats.min_time = st.st_mtime;
-			if (st.st_mtime > stats.max_time)
-				stats.max_time = st.st_mtime;
-		}
+		if (t <= 0)
+			continue;
+		if (vol.min_time == 0 || t < vol.min_time)
+			vol.min_time = t;
+		if (t > vol.max_time)
+			vol.max_time = t;
 	}
-	closedir(dir);
-	return stats;
+	free_wal_archive_info(info);
+	return vol;
 }
 
+/*
+ * WAL archive of a pg_probackup instance: --wal-archive if given, else
+ * <catalog>/wal/<instance> next to <catalog>/backups/<instance>/<id>.
+ */
 static void
-print_growth_efficiency(BackupInfo *backups, StatGroup *groups, int group_count)
+probackup_wal_archive_path(const StatOptions *opts, const BackupInfo *b,
+						   char *buf, size_t size)
 {
-	GrowthTrack tracks[20];
-	int track_count = 0;
+	char  catalog_base[PATH_MAX];
+	char  wal_base[PATH_MAX];
+	char *last_slash;
 
-	for (BackupInfo *b = backups; b != NULL; b = b->next)
+	if (opts->wal_archive && is_directory(opts->wal_archive))
 	{
-		/* Growth analysis is only meaningful for healthy backups:
-		 * stub/corrupt/in-progress entries have unreliable sizes and
-		 * timestamps that distort both axes. OK and WARNING are
-		 * considered usable; ERROR/CORRUPT/ORPHAN/RUNNING are not. */
-		if (b->type == BACKUP_TYPE_FULL
-			&& (b->status == BACKUP_STATUS_OK
-				|| b->status == BACKUP_STATUS_WARNING)
-			&& b->data_bytes > 0
-			&& b->start_time > 0)
-		{
-			GrowthTrack *track = NULL;
-			for (int i = 0; i < track_count; i++)
-			{
-				if (tracks[i].tool == b->tool &&
-					strcmp(tracks[i].instance_name, b->instance_name) == 0)
-				{
-					track = &tracks[i];
-					break;
-				}
-			}
+		snprintf(buf, size, "%s", opts->wal_archive);
+		return;
+	}
 
-			if (track == NULL)
-			{
-				if (track_count >= 20)
-					continue;
-				track = &tracks[track_count];
-				track->tool = b->tool;
-				str_copy(track->instance_name, b->instance_name, sizeof(track->instance_name));
-				track->full_count = 0;
-				track_count++;
-			}
+	/* Remove the backup ID, then the instance name */
+	snprintf(catalog_base, sizeof(catalog_base), "%s", b->backup_path);
+	last_slash = strrchr(catalog_base, '/');
+	if (last_slash)
+		*last_slash = '\0';
+	last_slash = strrchr(catalog_base, '/');
+	if (last_slash)
+		*last_slash = '\0';
+
+	/* Now catalog_base is /path/to/catalog/backups */
+	last_slash = strrchr(catalog_base, '/');
+	if (last_slash)
+	{
+		*last_slash = '\0';  /* catalog_base is now /path/to/catalog */
+		path_join(wal_base, sizeof(wal_base), catalog_base, "wal");
+	}
+	else
+	{
+		/* Fallback: use backup_dir structure */
+		char temp_base[PATH_MAX];
 
-			if (track->full_count < 200)
-			{
-				track->fulls[track->full_count].start_time = b->start_time;
-				track->fulls[track->full_count].data_bytes = b->data_bytes;
-				track->full_count++;
-			}
-		}
+		path_join(temp_base, sizeof(temp_base), opts->backup_dir, "backups");
+		path_join(wal_base, sizeof(wal_base), temp_base, "wal");
 	}
+	path_join(buf, size, wal_base, b->instance_name);
+}
 
+/* Whether an instance has FULL backups to follow over time */
+static bool
+has_growth_track(const BackupStatInstance *in)
+{
+	return in->full_bytes.count > 0;
+}
+
+static void
+print_growth_efficiency(const BackupStats *stats)
+{
+	int track_count = 0;
+
+	for (int t = 0; t < stats->instance_count; t++)
+		if (has_growth_track(&stats->instances[t]))
+			track_count++;
 	if (track_count == 0)
 		return;
 
-	printf("\n");
+	report("\n");
 	const char *col = use_color ? COLOR_CYAN : "";
 	const char *rst = use_color ? COLOR_RESET : "";
 
 	/* DATABASE GROWTH TREND */
-	printf("%sDATABASE GROWTH TREND%s\n", col, rst);
-	printf("  ──────────────────────────────────────────────────────────\n\n");
+	report("%sDATABASE GROWTH TREND%s\n", col, rst);
+	report("  ──────────────────────────────────────────────────────────\n\n");
 
-	for (int t = 0; t < track_count; t++)
+	for (int t = 0; t < stats->instance_count; t++)
 	{
-		GrowthTrack *track = &tracks[t];
-		qsort(track->fulls, track->full_count, sizeof(FullEntry), compare_full_entries);
-
-		printf("  %s", backup_tool_to_string(track->tool));
-		if (track->instance_name[0] != '\0' && strcmp(track->instance_name, "localhost") != 0)
-			printf(" / %s", track->instance_name);
-		printf("\n");
+		const BackupStatInstance *track = &stats->instances[t];
+		int                       full_count = (int) track->full_bytes.count;
 
-		if (track->full_count == 0)
-		{
-			printf("    (no FULL backups)\n\n");
+		if (!has_growth_track(track))
 			continue;
-		}
-		if (track->full_count == 1)
+
+		report_instance_heading(track->tool, track->instance_name);
+
+		if (full_count == 1)
 		{
-			printf("    FULL growth: N/A (need ≥2 FULL backups)\n\n");
+			report("    FULL growth: N/A (need ≥2 FULL backups)\n\n");
+			if (!table_output)
+			{
+				NdjsonRecord rec;
+
+				ndjson_begin(&rec, stdout, "growth");
+				emit_group_key(&rec, track->tool, track->instance_name);
+				ndjson_int(&rec, "full_backups", 1);
+				ndjson_uint(&rec, "avg_full_bytes", track->first_full.data_bytes);
+				ndjson_null(&rec, "growth_bytes");
+				ndjson_end(&rec);
+			}
 			continue;
 		}
 
 		/* Average / min / max FULL size — gives the growth numbers a sense
 		 * of scale, mirroring how INCREMENTAL EFFICIENCY shows "vs FULL". */
-		uint64_t sum_size = 0;
-		uint64_t min_size = UINT64_MAX;
-		uint64_t max_size = 0;
-		for (int i = 0; i < track->full_count; i++)
-		{
-			uint64_t sz = track->fulls[i].data_bytes;
-			sum_size += sz;
-			if (sz < min_size) min_size = sz;
-			if (sz > max_size) max_size = sz;
-		}
-		uint64_t avg_full = sum_size / track->full_count;
+		uint64_t avg_full = (uint64_t) (track->full_bytes.sum / full_count);
+		uint64_t min_size = (uint64_t) track->full_bytes.min;
+		uint64_t max_size = (uint64_t) track->full_bytes.max;
 		char avg_str[32], min_str[32], max_str[32];
 		format_bytes(avg_full, avg_str, sizeof(avg_str));
 		format_bytes(min_size, min_str, sizeof(min_str));
 		format_bytes(max_size, max_str, sizeof(max_str));
 
-		/* Net growth between the first and last FULL (sorted by start_time).
+		/* Net growth between the first and last FULL (by start_time).
 		 * Intermediate fluctuations (e.g. stream-mode WAL noise) cancel out,
 		 * so this is far more meaningful for capacity planning than the
 		 * mean/min/max of per-interval deltas. */
-		FullEntry *first = &track->fulls[0];
-		FullEntry *last  = &track->fulls[track->full_count - 1];
+		const BackupStatFull *first = &track->first_full;
+		const BackupStatFull *last  = &track->last_full;
 		int64_t net_delta = (int64_t)last->data_bytes - (int64_t)first->data_bytes;
 		time_t  span      = last->start_time - first->start_time;
 
 		char net_str[32];
 		format_signed_bytes(net_delta, net_str, sizeof(net_str));
 
-		printf("    FULL: avg %s, min %s, max %s (%d backups)\n",
-			   avg_str, min_str, max_str, track->full_count);
+		report("    FULL: avg %s, min %s, max %s (%d backups)\n",
+			   avg_str, min_str, max_str, full_count);
+
+		if (!table_output)
+		{
+			NdjsonRecord rec;
+			long         span_days = span > 0 ? (span / 86400 > 0 ? span / 86400 : 1) : 0;
+
+			ndjson_begin(&rec, stdout, "growth");
+			emit_group_key(&rec, track->tool, track->instance_name);
+			ndjson_int(&rec, "full_backups", full_count);
+			ndjson_uint(&rec, "avg_full_bytes", avg_full);
+			ndjson_uint(&rec, "min_full_bytes", min_size);
+			ndjson_uint(&rec, "max_full_bytes", max_size);
+			ndjson_int(&rec, "growth_bytes", net_delta);
+			ndjson_int(&rec, "span_days", span_days);
+			if (span_days > 0)
+				ndjson_int(&rec, "growth_bytes_per_month", (net_delta * 30) / span_days);
+			else
+				ndjson_null(&rec, "growth_bytes_per_month");
+			ndjson_end(&rec);
+		}
 
 		if (span <= 0)
 		{
-			printf("      growth: %s over <1d\n\n", net_str);
+			report("      growth: %s over <1d\n\n", net_str);
 			continue;
 		}
 
@@ -451,47 +487,39 @@ print_growth_efficiency(BackupInfo *backups, StatGroup *groups, int group_count)
 		char rate_str[32];
 		format_signed_bytes(per_month, rate_str, sizeof(rate_str));
 
-		printf("      growth: %s over %ldd  (≈ %s/month)\n\n",
+		report("      growth: %s over %ldd  (≈ %s/month)\n\n",
 			   net_str, days, rate_str);
 	}
 
 	/* INCREMENTAL EFFICIENCY */
-	printf("%sINCREMENTAL EFFICIENCY%s\n", col, rst);
-	printf("  ──────────────────────────────────────────────────────────\n\n");
+	report("%sINCREMENTAL EFFICIENCY%s\n", col, rst);
+	report("  ──────────────────────────────────────────────────────────\n\n");
 
-	for (int t = 0; t < track_count; t++)
+	for (int t = 0; t < stats->instance_count; t++)
 	{
-		GrowthTrack *track = &tracks[t];
+		const BackupStatInstance *track = &stats->instances[t];
 
-		StatGroup *full_group = NULL;
-		for (int i = 0; i < group_count; i++)
-		{
-			if (groups[i].tool == track->tool &&
-				groups[i].type == BACKUP_TYPE_FULL &&
-				strcmp(groups[i].instance_name, track->instance_name) == 0)
-			{
-				full_group = &groups[i];
-				break;
-			}
-		}
+		if (!has_growth_track(track))
+			continue;
+
+		const BackupStatGroup *full_group =
+			backup_stats_group(stats, track->tool, track->instance_name, BACKUP_TYPE_FULL);
 
 		if (full_group == NULL || full_group->count == 0)
 			continue;
 
-		printf("  %s", backup_tool_to_string(track->tool));
-		if (track->instance_name[0] != '\0' && strcmp(track->instance_name, "localhost") != 0)
-			printf(" / %s", track->instance_name);
-		printf("\n");
+		report_instance_heading(track->tool, track->instance_name);
 
 		uint64_t avg_full = full_group->total_bytes / full_group->count;
 		bool has_incr = false;
 
-		for (int i = 0; i < group_count; i++)
+		for (int type = BACKUP_TYPE_INCREMENTAL; type <= BACKUP_TYPE_PTRACK; type++)
 		{
-			StatGroup *ig = &groups[i];
-			if (ig->tool == track->tool &&
-				strcmp(ig->instance_name, track->instance_name) == 0 &&
-				ig->type != BACKUP_TYPE_FULL && ig->count > 0)
+			const BackupStatGroup *ig =
+				backup_stats_group(stats, track->tool, track->instance_name,
+								   (BackupType) type);
+
+			if (ig != NULL && ig->count > 0)
 			{
 				uint64_t avg_incr = ig->total_bytes / ig->count;
 				if (avg_incr == 0)
@@ -503,16 +531,29 @@ print_growth_efficiency(BackupInfo *backups, StatGroup *groups, int group_count)
 				format_bytes(avg_incr, avg_incr_str, sizeof(avg_incr_str));
 				format_bytes(avg_full, avg_full_str, sizeof(avg_full_str));
 
-				printf("    %s:  %3d%% of FULL  (avg %s vs %s FULL)\n",
+				report("    %s:  %3d%% of FULL  (avg %s vs %s FULL)\n",
 					   backup_type_to_string(ig->type), pct, avg_incr_str, avg_full_str);
 				has_incr = true;
+
+				if (!table_output)
+				{
+					NdjsonRecord rec;
+
+					ndjson_begin(&rec, stdout, "efficiency");
+					emit_group_key(&rec, track->tool, track->instance_name);
+					ndjson_string(&rec, "backup_type", backup_type_to_string(ig->type));
+					ndjson_int(&rec, "percent_of_full", pct);
+					ndjson_uint(&rec, "avg_bytes", avg_incr);
+					ndjson_uint(&rec, "avg_full_bytes", avg_full);
+					ndjson_end(&rec);
+				}
 			}
 		}
 
 		if (!has_incr)
-			printf("    (no incremental backups)\n");
+			report("    (no incremental backups)\n");
 
-		printf("\n");
+		report("\n");
 	}
 }
 
@@ -521,8 +562,7 @@ cmd_stat_main(int argc, char **argv)
 {
 	StatOptions opts;
 	BackupInfo *backups = NULL;
-	StatGroup *groups = NULL;
-	int group_count = 0;
+	BackupStats *stats = NULL;
 	int ret;
 
 	init_options(&opts);
@@ -537,6 +577,20 @@ cmd_stat_main(int argc, char **argv)
 	if (ret != EXIT_SUCCESS)
 		return ret;
 
+	table_output = opts.output == OUTPUT_TABLE;
+	validation_set_cache_dir(opts.cache_dir);
+	scan_set_jobs(opts.jobs);
+	if (opts.sizes != NULL)
+	{
+		SizeMode mode;
+
+		size_mode_from_string(opts.sizes, &mode);
+		scan_set_size_mode(mode);
+	}
+	if (!storage_resolve(&opts.backup_dir, STAGE_METADATA) ||
+		!storage_resolve(&opts.wal_archive, STAGE_METADATA))
+		return EXIT_GENERAL_ERROR;
+
 	/* Scan backup directory */
 	log_info("Scanning backup directory: %s", opts.backup_dir);
 	backups = scan_backup_directory(opts.backup_dir, -1);
@@ -546,57 +600,15 @@ cmd_stat_main(int argc, char **argv)
 		return EXIT_GENERAL_ERROR;
 	}
 
-	/* Allocate groups array (max 60 groups) */
-	groups = malloc(60 * sizeof(StatGroup));
-	if (groups == NULL)
+	/* One pass: groups per (tool, instance, type) and per instance */
+	stats = backup_stats_build(backups, BACKUP_STATS_BY_INSTANCE);
+	if (stats == NULL)
 	{
 		fprintf(stderr, "Error: Memory allocation failed\n");
 		free_backup_list(backups);
 		return EXIT_GENERAL_ERROR;
 	}
 
-	/* Build groups */
-	for (BackupInfo *b = backups; b != NULL; b = b->next)
-	{
-		StatGroup *g = find_or_create_group(groups, &group_count, 60,
-											b->tool, b->type, b->instance_name);
-		if (g == NULL)
-		{
-			fprintf(stderr, "Error: Too many backup type combinations (max 60)\n");
-			free_stat_groups(groups, group_count);
-			free_backup_list(backups);
-			return EXIT_GENERAL_ERROR;
-		}
-
-		g->count++;
-		uint64_t size = b->data_bytes + b->wal_bytes;
-		g->total_bytes += size;
-		g->total_wal_bytes += b->wal_bytes;
-
-		if (b->start_time > 0)
-		{
-			if (b->start_time < g->min_time)
-				g->min_time = b->start_time;
-			if (b->start_time > g->max_time)
-				g->max_time = b->start_time;
-		}
-
-		if (b->end_time > b->start_time)
-		{
-			int64_t duration = (int64_t)(b->end_time - b->start_time);
-			if (duration < 48 * 3600)
-			{
-				g->total_duration += duration;
-				g->duration_count++;
-			}
-		}
-		if (b->status == BACKUP_STATUS_OK)
-			g->ok_count++;
-	}
-
-	/* Sort groups for organized output */
-	qsort(groups, group_count, sizeof(StatGroup), compare_groups);
-
 	/* Header */
 	{
 		time_t now = time(NULL);
@@ -606,47 +618,46 @@ cmd_stat_main(int argc, char **argv)
 		const char *title_col = use_color ? COLOR_CYAN : "";
 		const char *rst = use_color ? COLOR_RESET : "";
 
-		printf("%sBackup Statistics%s\n", title_col, rst);
+		report("%sBackup Statistics%s\n", title_col, rst);
 		char resolved_dir[PATH_MAX];
 		const char *display_dir = opts.backup_dir;
 		if (realpath(opts.backup_dir, resolved_dir) != NULL)
 			display_dir = resolved_dir;
-		printf("Directory:  %s\n", display_dir);
-		printf("Time:       %s\n\n", now_str);
+		report("Directory:  %s\n", display_dir);
+		report("Time:       %s\n\n", now_str);
 	}
 
 	/* Group and print statistics by tool and instance */
 	BackupTool current_tool = (BackupTool)-1;
 	char current_instance[64] = "";
-	for (int i = 0; i < group_count; i++)
+	for (int i = 0; i < stats->group_count; i++)
 	{
-		StatGroup *g = &groups[i];
+		const BackupStatGroup *g = &stats->groups[i];
 
 		/* Print tool/instance header when switching tools or instances */
 		if (g->tool != current_tool || strcmp(g->instance_name, current_instance) != 0)
 		{
 			if (current_tool != (BackupTool)-1)
-				printf("\n");
+				report("\n");
 
 			const char *col = use_color ? COLOR_CYAN : "";
 			const char *rst = use_color ? COLOR_RESET : "";
-			printf("%s%s", col, backup_tool_to_string(g->tool));
+			report("%s%s", col, backup_tool_to_string(g->tool));
 			if (g->instance_name[0] != '\0' && strcmp(g->instance_name, "localhost") != 0)
-				printf(" / %s", g->instance_name);
-			printf("%s\n", rst);
+				report(" / %s", g->instance_name);
+			report("%s\n", rst);
 
-			printf(STAT_ROW_FMT,
+			report(STAT_ROW_FMT,
 				   "Type", "Count", "Interval",
 				   "Total Size", "Avg Size", "Avg Duration", "OK%");
-			printf("  ──────────────────────────────────────────────────────────────────────────\n");
+			report("  ──────────────────────────────────────────────────────────────────────────\n");
 			current_tool = g->tool;
 			str_copy(current_instance, g->instance_name, sizeof(current_instance));
 		}
 
 		/* Calculate statistics */
 		uint64_t avg_bytes = g->total_bytes / g->count;
-		double avg_dur = (g->duration_count > 0)
-			? (double)g->total_duration / g->duration_count : -1.0;
+		double avg_dur = (g->duration.count > 0) ? g->duration.mean : -1.0;
 
 		/* Average interval between backups within this group.
 		 * Needs at least 2 backups spanning a real time range. */
@@ -664,7 +675,7 @@ cmd_stat_main(int argc, char **argv)
 		snprintf(ok_pct_str, sizeof(ok_pct_str), "%d%%",
 				 g->count > 0 ? (g->ok_count * 100 / g->count) : 0);
 
-		printf(STAT_ROW_FMT,
+		report(STAT_ROW_FMT,
 			   backup_type_to_string(g->type),
 			   count_str,
 			   interval_str,
@@ -672,56 +683,78 @@ cmd_stat_main(int argc, char **argv)
 			   avg_str,
 			   dur_str,
 			   ok_pct_str);
+
+		if (!table_output)
+		{
+			NdjsonRecord rec;
+
+			ndjson_begin(&rec, stdout, "group");
+			emit_group_key(&rec, g->tool, g->instance_name);
+			ndjson_string(&rec, "backup_type", backup_type_to_string(g->type));
+			ndjson_int(&rec, "count", g->count);
+			ndjson_int(&rec, "ok", g->ok_count);
+			ndjson_uint(&rec, "total_bytes", g->total_bytes);
+			ndjson_uint(&rec, "avg_bytes", avg_bytes);
+			if (avg_interval >= 0)
+				ndjson_double(&rec, "avg_interval_seconds", avg_interval);
+			else
+				ndjson_null(&rec, "avg_interval_seconds");
+			if (avg_dur >= 0)
+				ndjson_double(&rec, "avg_duration_seconds", avg_dur);
+			else
+				ndjson_null(&rec, "avg_duration_seconds");
+			ndjson_end(&rec);
+		}
 	}
 
 	/* Summary */
 	{
-		printf("\n");
+		report("\n");
 		const char *col = use_color ? COLOR_CYAN : "";
 		const char *rst = use_color ? COLOR_RESET : "";
-		printf("%sSTORAGE%s\n", col, rst);
+		report("%sSTORAGE%s\n", col, rst);
 
 		/* Count by status */
-		int ok_count = 0, warning_count = 0, error_count = 0, corrupt_count = 0, orphan_count = 0, running_count = 0;
-		uint64_t ok_bytes = 0, warning_bytes = 0, error_bytes = 0, corrupt_bytes = 0, orphan_bytes = 0, running_bytes = 0;
-
-		for (BackupInfo *b = backups; b != NULL; b = b->next)
-		{
-			uint64_t size = b->data_bytes + b->wal_bytes;
-			switch (b->status)
-			{
-				case BACKUP_STATUS_OK:
-					ok_count++;
-					ok_bytes += size;
-					break;
-				case BACKUP_STATUS_WARNING:
-					warning_count++;
-					warning_bytes += size;
-					break;
-				case BACKUP_STATUS_ERROR:
-					error_count++;
-					error_bytes += size;
-					break;
-				case BACKUP_STATUS_CORRUPT:
-					corrupt_count++;
-					corrupt_bytes += size;
-					break;
-				case BACKUP_STATUS_ORPHAN:
-					orphan_count++;
-					orphan_bytes += size;
-					break;
-				case BACKUP_STATUS_RUNNING:
-					running_count++;
-					running_bytes += size;
-					break;
-			}
-		}
+		int ok_count = stats->status_count[BACKUP_STATUS_OK];
+		int warning_count = stats->status_count[BACKUP_STATUS_WARNING];
+		int error_count = stats->status_count[BACKUP_STATUS_ERROR];
+		int corrupt_count = stats->status_count[BACKUP_STATUS_CORRUPT];
+		int orphan_count = stats->status_count[BACKUP_STATUS_ORPHAN];
+		int running_count = stats->status_count[BACKUP_STATUS_RUNNING];
+		uint64_t ok_bytes = stats->status_bytes[BACKUP_STATUS_OK];
+		uint64_t warning_bytes = stats->status_bytes[BACKUP_STATUS_WARNING];
+		uint64_t error_bytes = stats->status_bytes[BACKUP_STATUS_ERROR];
+		uint64_t corrupt_bytes = stats->status_bytes[BACKUP_STATUS_CORRUPT];
+		uint64_t orphan_bytes = stats->status_bytes[BACKUP_STATUS_ORPHAN];
+		uint64_t running_bytes = stats->status_bytes[BACKUP_STATUS_RUNNING];
 
 		int total_count = ok_count + warning_count + error_count + corrupt_count + orphan_count + running_count;
 		uint64_t total_bytes = ok_bytes + warning_bytes + error_bytes + corrupt_bytes + orphan_bytes + running_bytes;
 
-		printf("  Status          Count   Size\n");
-		printf("  ─────────────────────────────────\n");
+		if (!table_output)
+		{
+			NdjsonRecord rec;
+
+			ndjson_begin(&rec, stdout, "storage");
+			ndjson_int(&rec, "ok", ok_count);
+			ndjson_uint(&rec, "ok_bytes", ok_bytes);
+			ndjson_int(&rec, "warning", warning_count);
+			ndjson_uint(&rec, "warning_bytes", warning_bytes);
+			ndjson_int(&rec, "error", error_count);
+			ndjson_uint(&rec, "error_bytes", error_bytes);
+			ndjson_int(&rec, "corrupt", corrupt_count);
+			ndjson_uint(&rec, "corrupt_bytes", corrupt_bytes);
+			ndjson_int(&rec, "orphan", orphan_count);
+			ndjson_uint(&rec, "orphan_bytes", orphan_bytes);
+			ndjson_int(&rec, "running", running_count);
+			ndjson_uint(&rec, "running_bytes", running_bytes);
+			ndjson_int(&rec, "total", total_count);
+			ndjson_uint(&rec, "total_bytes", total_bytes);
+			ndjson_end(&rec);
+		}
+
+		report("  Status          Count   Size\n");
+		report("  ─────────────────────────────────\n");
 
 		if (ok_count > 0)
 		{
@@ -729,7 +762,7 @@ cmd_stat_main(int argc, char **argv)
 			format_bytes(ok_bytes, ok_str, sizeof(ok_str));
 			const char *green = use_color ? COLOR_GREEN : "";
 			const char *rst2 = use_color ? COLOR_RESET : "";
-			printf("  %sOK%s              %5d   %s\n", green, rst2, ok_count, ok_str);
+			report("  %sOK%s              %5d   %s\n", green, rst2, ok_count, ok_str);
 		}
 
 		if (warning_count > 0)
@@ -738,7 +771,7 @@ cmd_stat_main(int argc, char **argv)
 			format_bytes(warning_bytes, warn_str, sizeof(warn_str));
 			const char *yellow = use_color ? COLOR_YELLOW : "";
 			const char *rst2 = use_color ? COLOR_RESET : "";
-			printf("  %sWARNING%s         %5d   %s\n", yellow, rst2, warning_count, warn_str);
+			report("  %sWARNING%s         %5d   %s\n", yellow, rst2, warning_count, warn_str);
 		}
 
 		if (error_count > 0)
@@ -747,7 +780,7 @@ cmd_stat_main(int argc, char **argv)
 			format_bytes(error_bytes, err_str, sizeof(err_str));
 			const char *red = use_color ? COLOR_RED : "";
 			const char *rst2 = use_color ? COLOR_RESET : "";
-			printf("  %sERROR%s           %5d   %s\n", red, rst2, error_count, err_str);
+			report("  %sERROR%s           %5d   %s\n", red, rst2, error_count, err_str);
 		}
 
 		if (corrupt_count > 0)
@@ -756,7 +789,7 @@ cmd_stat_main(int argc, char **argv)
 			format_bytes(corrupt_bytes, corr_str, sizeof(corr_str));
 			const char *red = use_color ? COLOR_RED : "";
 			const char *rst2 = use_color ? COLOR_RESET : "";
-			printf("  %sCORRUPT%s         %5d   %s\n", red, rst2, corrupt_count, corr_str);
+			report("  %sCORRUPT%s         %5d   %s\n", red, rst2, corrupt_count, corr_str);
 		}
 
 		if (orphan_count > 0)
@@ -765,7 +798,7 @@ cmd_stat_main(int argc, char **argv)
 			format_bytes(orphan_bytes, orph_str, sizeof(orph_str));
 			const char *yellow = use_color ? COLOR_YELLOW : "";
 			const char *rst2 = use_color ? COLOR_RESET : "";
-			printf("  %sORPHAN%s          %5d   %s\n", yellow, rst2, orphan_count, orph_str);
+			report("  %sORPHAN%s          %5d   %s\n", yellow, rst2, orphan_count, orph_str);
 		}
 
 		if (running_count > 0)
@@ -774,304 +807,180 @@ cmd_stat_main(int argc, char **argv)
 			format_bytes(running_bytes, run_str, sizeof(run_str));
 			const char *blue = use_color ? COLOR_BLUE : "";
 			const char *rst2 = use_color ? COLOR_RESET : "";
-			printf("  %sRUNNING%s         %5d   %s\n", blue, rst2, running_count, run_str);
+			report("  %sRUNNING%s         %5d   %s\n", blue, rst2, running_count, run_str);
 		}
 
-		printf("  ─────────────────────────────────\n");
+		report("  ─────────────────────────────────\n");
 		char total_str[32];
 		format_bytes(total_bytes, total_str, sizeof(total_str));
-		printf("  TOTAL            %5d   %s\n", total_count, total_str);
+		report("  TOTAL            %5d   %s\n", total_count, total_str);
 
 		/* WAL Archive Volume by tool and instance (from backups or archives) */
-		printf("\n  WAL Archive Volume:\n");
-
-		typedef struct {
-			BackupTool tool;
-			char instance_name[64];
-			uint64_t total_wal;
-			time_t min_time;
-			time_t max_time;
-			bool from_archive;
-		} ToolInstanceWal;
+		report("\n  WAL Archive Volume:\n");
 
-		ToolInstanceWal wals[20];
-		int wal_count = 0;
+		WalVolume *wals = calloc(stats->instance_count > 0 ? stats->instance_count : 1,
+								 sizeof(WalVolume));
+		bool      *scanned = calloc(stats->instance_count > 0 ? stats->instance_count : 1,
+									sizeof(bool));
 
-		/* For pg_probackup: try to find and analyze WAL archives */
-		typedef struct {
-			char instance_name[64];
-			WalArchiveStats archive_stats;
-		} ProbackupArchive;
+		if (wals == NULL || scanned == NULL)
+		{
+			fprintf(stderr, "Error: Memory allocation failed\n");
+			free(wals);
+			free(scanned);
+			backup_stats_free(stats);
+			free_backup_list(backups);
+			return EXIT_GENERAL_ERROR;
+		}
 
-		ProbackupArchive pb_archives[20];
-		int pb_archive_count = 0;
+		/* WAL from backup metadata, per instance */
+		for (int i = 0; i < stats->instance_count; i++)
+		{
+			wals[i].total = stats->instances[i].wal_bytes;
+			wals[i].min_time = stats->instances[i].wal_min_time;
+			wals[i].max_time = stats->instances[i].wal_max_time;
+		}
 
+		/*
+		 * For pg_probackup: use the instance's WAL archive if it spans a
+		 * longer time than the backup metadata (backups may have wal_bytes
+		 * but a single timestamp, archives have a time range).
+		 */
 		for (BackupInfo *b = backups; b != NULL; b = b->next)
 		{
+			const BackupStatInstance *in;
+			char        wal_archive_path[PATH_MAX];
+			WalVolume   arch;
+			int         n;
+
 			if (b->tool != BACKUP_TOOL_PG_PROBACKUP)
 				continue;
-
-			/* Check if we already processed this instance */
-			bool found = false;
-			for (int i = 0; i < pb_archive_count; i++)
-			{
-				if (strcmp(pb_archives[i].instance_name, b->instance_name) == 0)
-				{
-					found = true;
-					break;
-				}
-			}
-			if (found)
+			in = backup_stats_instance(stats, b->tool, b->instance_name);
+			n = (int) (in - stats->instances);
+			if (scanned[n])
 				continue;
+			scanned[n] = true;
 
-			/* Try to find WAL archive for this instance */
-			char wal_archive_path[PATH_MAX];
-
-			/* First, try user-provided path */
-			if (opts.wal_archive && is_directory(opts.wal_archive))
-			{
-				snprintf(wal_archive_path, sizeof(wal_archive_path), "%s", opts.wal_archive);
-			}
-			else
-			{
-				/* Try to find automatically from backup path
-				 * backup_path is like: /path/to/catalog/backups/{instance}/{backup_id}
-				 * WAL archive is at: /path/to/catalog/wal/{instance}
-				 */
-				char catalog_base[PATH_MAX];
-				snprintf(catalog_base, sizeof(catalog_base), "%s", b->backup_path);
-
-				/* Remove backup ID (last component) */
-				char *last_slash = strrchr(catalog_base, '/');
-				if (last_slash)
-					*last_slash = '\0';
-
-				/* Remove instance name (next-to-last component) */
-				last_slash = strrchr(catalog_base, '/');
-				if (last_slash)
-					*last_slash = '\0';
-
-				/* Now catalog_base is /path/to/catalog/backups */
-				/* Navigate to /path/to/catalog/wal/{instance} */
-				char wal_base[PATH_MAX];
-				last_slash = strrchr(catalog_base, '/');
-				if (last_slash)
-				{
-					*last_slash = '\0';  /* catalog_base is now /path/to/catalog */
-					path_join(wal_base, sizeof(wal_base), catalog_base, "wal");
-					path_join(wal_archive_path, sizeof(wal_archive_path), wal_base, b->instance_name);
-				}
-				else
-				{
-					/* Fallback: use backup_dir structure */
-					char temp_base[PATH_MAX];
-					path_join(temp_base, sizeof(temp_base), opts.backup_dir, "backups");
-					path_join(wal_base, sizeof(wal_base), temp_base, "wal");
-					path_join(wal_archive_path, sizeof(wal_archive_path), wal_base, b->instance_name);
-				}
-			}
-
-			/* Analyze archive if found */
-			if (is_directory(wal_archive_path))
-			{
-				if (pb_archive_count < 20)
-				{
-					WalArchiveStats stats = analyze_wal_archive(wal_archive_path);
-					pb_archives[pb_archive_count].archive_stats = stats;
-					str_copy(pb_archives[pb_archive_count].instance_name, b->instance_name,
-							 sizeof(pb_archives[pb_archive_count].instance_name));
-					pb_archive_count++;
-				}
-			}
+			probackup_wal_archive_path(&opts, b, wal_archive_path, sizeof(wal_archive_path));
+			if (!is_directory(wal_archive_path))
+				continue;
+			arch = archive_wal_volume(wal_archive_path);
+			if (arch.total == 0)
+				continue;
+			if (wals[n].total == 0 ||
+				(arch.max_time > arch.min_time &&
+				 (wals[n].max_time <= wals[n].min_time ||
+				  arch.max_time - arch.min_time > wals[n].max_time - wals[n].min_time)))
+				wals[n] = arch;
 		}
 
-		/* Collect WAL stats from backups (only from backups with WAL) */
-		for (BackupInfo *b = backups; b != NULL; b = b->next)
+		/* Print WAL stats grouped by tool (instances are sorted by tool) */
+		for (int i = 0; i < stats->instance_count; )
 		{
-			if (b->wal_bytes == 0)
-				continue;  /* Skip backups without WAL */
+			BackupTool tool = stats->instances[i].tool;
+			int        end = i;
 
-			ToolInstanceWal *entry = NULL;
-			for (int i = 0; i < wal_count; i++)
-			{
-				if (wals[i].tool == b->tool && strcmp(wals[i].instance_name, b->instance_name) == 0)
-				{
-					entry = &wals[i];
-					break;
-				}
-			}
+			/* Calculate tool totals */
+			uint64_t tool_total_wal = 0;
+			time_t tool_min_time = 0;
+			time_t tool_max_time = 0;
 
-			if (entry == NULL)
+			for (; end < stats->instance_count && stats->instances[end].tool == tool; end++)
 			{
-				if (wal_count >= 20)
+				if (wals[end].total == 0)
 					continue;
-				entry = &wals[wal_count];
-				entry->tool = b->tool;
-				str_copy(entry->instance_name, b->instance_name, sizeof(entry->instance_name));
-				entry->total_wal = 0;
-				entry->min_time = LLONG_MAX;
-				entry->max_time = 0;
-				entry->from_archive = false;
-				wal_count++;
+				tool_total_wal += wals[end].total;
+				if (wals[end].min_time > 0 &&
+					(tool_min_time == 0 || wals[end].min_time < tool_min_time))
+					tool_min_time = wals[end].min_time;
+				if (wals[end].max_time > tool_max_time)
+					tool_max_time = wals[end].max_time;
 			}
 
-			entry->total_wal += b->wal_bytes;
-			if (b->start_time > 0)
+			if (tool_total_wal > 0 && tool_max_time > tool_min_time)
 			{
-				if (b->start_time < entry->min_time)
-					entry->min_time = b->start_time;
-				if (b->start_time > entry->max_time)
-					entry->max_time = b->start_time;
-			}
-		}
-
-		/* Use discovered WAL archives if they provide better data than backup metadata
-		 * (for pg_probackup: backups may have wal_bytes but single timestamp, archives have time range)
-		 */
-		for (int i = 0; i < pb_archive_count; i++)
-		{
-			if (pb_archives[i].archive_stats.total_wal == 0)
-				continue;
-
-			/* Look for existing entry for this instance */
-			for (int j = 0; j < wal_count; j++)
-			{
-				if (wals[j].tool == BACKUP_TOOL_PG_PROBACKUP &&
-					strcmp(wals[j].instance_name, pb_archives[i].instance_name) == 0)
+				time_t days = (tool_max_time - tool_min_time) / 86400;
+				if (days == 0)
+					days = 1;
+				uint64_t tool_wal_per_day = tool_total_wal / days;
+				char tool_wal_str[32];
+				format_bytes(tool_wal_per_day, tool_wal_str, sizeof(tool_wal_str));
+
+				report("    %s: %s/day\n", backup_tool_to_string(tool), tool_wal_str);
+				if (!table_output)
 				{
-					/* Found existing entry - check if archive has better time range */
-					if (pb_archives[i].archive_stats.max_time > pb_archives[i].archive_stats.min_time &&
-						(wals[j].max_time <= wals[j].min_time ||
-						 (pb_archives[i].archive_stats.max_time - pb_archives[i].archive_stats.min_time) >
-						 (wals[j].max_time - wals[j].min_time)))
-					{
-						wals[j].total_wal = pb_archives[i].archive_stats.total_wal;
-						wals[j].min_time = pb_archives[i].archive_stats.min_time;
-						wals[j].max_time = pb_archives[i].archive_stats.max_time;
-						wals[j].from_archive = true;
-					}
-					goto next_archive;
-				}
-			}
+					NdjsonRecord rec;
 
-			/* Not found - add new entry if space available */
-			if (wal_count < 20)
-			{
-				ToolInstanceWal *entry = &wals[wal_count];
-				entry->tool = BACKUP_TOOL_PG_PROBACKUP;
-				str_copy(entry->instance_name, pb_archives[i].instance_name, sizeof(entry->instance_name));
-				entry->total_wal = pb_archives[i].archive_stats.total_wal;
-				entry->min_time = pb_archives[i].archive_stats.min_time;
-				entry->max_time = pb_archives[i].archive_stats.max_time;
-				entry->from_archive = true;
-				wal_count++;
-			}
+					ndjson_begin(&rec, stdout, "wal_volume");
+					emit_group_key(&rec, tool, NULL);
+					ndjson_uint(&rec, "total_bytes", tool_total_wal);
+					ndjson_uint(&rec, "bytes_per_day", tool_wal_per_day);
+					ndjson_end(&rec);
+				}
 
-			next_archive:
-			(void)0;  /* Dummy statement for label */
-		}
+				/* Print instances for this tool */
+				for (int j = i; j < end; j++)
+				{
+					const char *name = stats->instances[j].instance_name;
+					time_t      from = wals[j].min_time;
+					time_t      to = wals[j].max_time;
 
-		/* Print WAL stats grouped by tool */
-		BackupTool prev_tool = (BackupTool)-1;
-		for (int i = 0; i < wal_count; i++)
-		{
-			if (wals[i].tool != prev_tool)
-			{
-				/* Calculate tool totals */
-				uint64_t tool_total_wal = 0;
-				time_t tool_min_time = LLONG_MAX;
-				time_t tool_max_time = 0;
+					if (wals[j].total == 0 || name[0] == '\0' ||
+						strcmp(name, "localhost") == 0)
+						continue;
 
-				for (int j = 0; j < wal_count; j++)
-				{
-					if (wals[j].tool == wals[i].tool)
+					/* No per-instance time range: use the tool's period */
+					if (to <= from)
 					{
-						tool_total_wal += wals[j].total_wal;
-						if (wals[j].min_time < tool_min_time)
-							tool_min_time = wals[j].min_time;
-						if (wals[j].max_time > tool_max_time)
-							tool_max_time = wals[j].max_time;
+						from = tool_min_time;
+						to = tool_max_time;
 					}
-				}
-
-				if (tool_total_wal > 0 && tool_max_time > tool_min_time)
-				{
-					time_t days = (tool_max_time - tool_min_time) / 86400;
+					time_t days = (to - from) / 86400;
 					if (days == 0)
 						days = 1;
-					uint64_t tool_wal_per_day = tool_total_wal / days;
-					char tool_wal_str[32], total_wal_str[32];
-					format_bytes(tool_wal_per_day, tool_wal_str, sizeof(tool_wal_str));
-					format_bytes(tool_total_wal, total_wal_str, sizeof(total_wal_str));
+					uint64_t wal_per_day = wals[j].total / days;
 
-					printf("    %s: %s/day\n", backup_tool_to_string(wals[i].tool), tool_wal_str);
-
-					/* Print instances for this tool */
-					for (int j = 0; j < wal_count; j++)
+					if (wal_per_day > 0)
 					{
-						if (wals[j].tool == wals[i].tool && wals[j].total_wal > 0 &&
-							wals[j].instance_name[0] != '\0' &&
-							strcmp(wals[j].instance_name, "localhost") != 0)
+						char wal_str[32];
+						format_bytes(wal_per_day, wal_str, sizeof(wal_str));
+						report("      %s: %s/day\n", name, wal_str);
+						if (!table_output)
 						{
-							/* Check if we have WAL archive for pg_probackup */
-							ProbackupArchive *archive = NULL;
-							if (wals[j].tool == BACKUP_TOOL_PG_PROBACKUP)
-							{
-								for (int k = 0; k < pb_archive_count; k++)
-								{
-									if (strcmp(pb_archives[k].instance_name, wals[j].instance_name) == 0 &&
-										pb_archives[k].archive_stats.total_wal > 0)
-									{
-										archive = &pb_archives[k];
-										break;
-									}
-								}
-							}
-
-							uint64_t wal_per_day = 0;
-							if (archive && archive->archive_stats.max_time > archive->archive_stats.min_time)
-							{
-								time_t days = (archive->archive_stats.max_time - archive->archive_stats.min_time) / 86400;
-								if (days == 0)
-									days = 1;
-								wal_per_day = archive->archive_stats.total_wal / days;
-							}
-							else if (wals[j].max_time > wals[j].min_time)
-							{
-								time_t days = (wals[j].max_time - wals[j].min_time) / 86400;
-								if (days == 0)
-									days = 1;
-								wal_per_day = wals[j].total_wal / days;
-							}
-							else if (wals[j].total_wal > 0 && tool_max_time > tool_min_time)
-							{
-								/* No per-instance time range, use tool total period */
-								time_t days = (tool_max_time - tool_min_time) / 86400;
-								if (days == 0)
-									days = 1;
-								wal_per_day = wals[j].total_wal / days;
-							}
-
-							if (wal_per_day > 0)
-							{
-								char wal_str[32];
-								format_bytes(wal_per_day, wal_str, sizeof(wal_str));
-								printf("      %s: %s/day\n", wals[j].instance_name, wal_str);
-							}
+							NdjsonRecord rec;
+
+							ndjson_begin(&rec, stdout, "wal_volume");
+							emit_group_key(&rec, tool, name);
+							ndjson_uint(&rec, "total_bytes", wals[j].total);
+							ndjson_uint(&rec, "bytes_per_day", wal_per_day);
+							ndjson_end(&rec);
 						}
 					}
 				}
-
-				prev_tool = wals[i].tool;
 			}
+
+			i = end;
 		}
+
+		free(wals);
+		free(scanned);
 	}
 
 	/* Growth & Efficiency analysis */
-	print_growth_efficiency(backups, groups, group_count);
+	print_growth_efficiency(stats);
+
+	if (!table_output)
+	{
+		NdjsonRecord rec;
+
+		ndjson_begin(&rec, stdout, "summary");
+		ndjson_int(&rec, "backups", stats->backup_count);
+		ndjson_int(&rec, "groups", stats->group_count);
+		ndjson_end(&rec);
+	}
 
 	/* Cleanup */
-	free_stat_groups(groups, group_count);
+	backup_stats_free(stats);
 	free_backup_list(backups);
 
 	return EXIT_SUCCESS;
@@ -0,0 +1,158 @@
+/*
+ * cmd_verify_segment.c
+ *
+ * Implementation of 'verify-segment' command: one archived WAL segment
+ * verified as it arrives, from archive_command, with the verdict added
+ * to the WAL verification cache that later checks use.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pg_backup_auditor.h"
+#include "cmd_help.h"
+#include "arg_parser.h"
+#include "validation_result.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+/* Command-line options */
+typedef struct {
+	char *wal_archive;      /* or NULL: the segment's directory */
+	char *cache_dir;        /* WAL verification cache, or NULL */
+	const char *segment;
+} VerifySegmentOptions;
+
+static int
+parse_arguments(int argc, char **argv, VerifySegmentOptions *opts)
+{
+	int c;
+	int option_index = 0;
+	bool wal_archive_seen = false;
+	bool cache_dir_seen = false;
+
+	static struct option long_options[] = {
+		{"wal-archive",     required_argument, 0, 'w'},
+		{"cache-dir",       required_argument, 0, 'C'},
+		{"help",            no_argument,       0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	while ((c = getopt_long(argc, argv, "w:C:h",
+							long_options, &option_index)) != -1)
+	{
+		switch (c)
+		{
+			case 'w':
+				if (!parse_string_option("--wal-archive", optarg, &opts->wal_archive, &wal_archive_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'C':
+				if (!parse_string_option("--cache-dir", optarg, &opts->cache_dir, &cache_dir_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'h':
+				print_verify_segment_usage();
+				return EXIT_SUCCESS;
+			case '?':
+				return EXIT_INVALID_ARGUMENTS;
+			default:
+				return EXIT_INVALID_ARGUMENTS;
+		}
+	}
+
+	if (optind >= argc)
+	{
+		fprintf(stderr, "Error: No WAL segment file given\n");
+		return EXIT_INVALID_ARGUMENTS;
+	}
+	if (optind + 1 < argc)
+	{
+		fprintf(stderr, "Error: Only one WAL segment file may be given\n");
+		return EXIT_INVALID_ARGUMENTS;
+	}
+	opts->segment = argv[optind];
+
+	if (opts->wal_archive != NULL && !is_directory(opts->wal_archive))
+	{
+		fprintf(stderr, "Error: WAL archive directory does not exist: %s\n", opts->wal_archive);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	if (opts->cache_dir != NULL && !is_directory(opts->cache_dir))
+	{
+		fprintf(stderr, "Error: Cache directory does not exist: %s\n", opts->cache_dir);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	return -1;  /* Continue processing */
+}
+
+/*
+ * cmd_verify_segment_main
+ *
+ * Nothing but the one segment is read: no catalog scan, no adapters.
+ */
+int
+cmd_verify_segment_main(int argc, char **argv)
+{
+	VerifySegmentOptions opts = { NULL, NULL, NULL };
+	ValidationResult    *result;
+	char                 archive[PATH_MAX];
+	const char          *slash;
+	int                  ret;
+
+	ret = parse_arguments(argc, argv, &opts);
+	if (ret != -1)
+		goto cleanup;
+
+	if (opts.wal_archive != NULL)
+		str_copy(archive, opts.wal_archive, sizeof(archive));
+	else if ((slash = strrchr(opts.segment, '/')) == NULL)
+		str_copy(archive, ".", sizeof(archive));
+	else if (slash == opts.segment)
+		str_copy(archive, "/", sizeof(archive));
+	else
+		snprintf(archive, sizeof(archive), "%.*s",
+				 (int) (slash - opts.segment), opts.segment);
+
+	validation_set_cache_dir(opts.cache_dir);
+
+	result = check_wal_segment_file(opts.segment, archive);
+	if (result == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		ret = EXIT_GENERAL_ERROR;
+		goto cleanup;
+	}
+
+	for (int i = 0; i < result->error_count; i++)
+		printf("%s[ERROR]%s %s\n",
+			   use_color ? COLOR_RED : "", use_color ? COLOR_RESET : "",
+			   result->errors[i]);
+	if (result->error_count == 0)
+		printf("%s[OK]%s WAL segment %s: verified\n",
+			   use_color ? COLOR_GREEN : "", use_color ? COLOR_RESET : "",
+			   opts.segment);
+
+	ret = result->error_count > 0 ? EXIT_VALIDATION_FAILED : EXIT_SUCCESS;
+	free_validation_result(result);
+
+cleanup:
+	validation_set_cache_dir(NULL);
+	return ret;
+}
@@ -0,0 +1,1269 @@
+/*
+ * cmd_watch.c
+ *
+ * Implementation of 'watch' command
+ *
+ * The catalog, the WAL archives' segment lists and every result are kept
+ * in memory across rounds.  File system events (fs_watch.h) on the
+ * backup tree and the archives start a round: a change under the backup
+ * tree rescans the catalog, and only backups that are new or whose
+ * metadata changed are validated again; a change in an archive re-lists
+ * that archive, and only the segments that were not there before are
+ * read.  Backups that were missing WAL are validated again when their
+ * archive grows.  A full rescan every --interval seconds covers anything
+ * the events missed.  New backups are also scored against the anomaly
+ * baselines of their instance (anomaly_detector.h) as they land.
+ *
+ * The current state is served as NDJSON on a unix socket, either to a
+ * bare connection or as the response to an HTTP GET, so
+ * "curl --unix-socket PATH http://localhost/" works; GET /metrics returns
+ * the metrics.h counters in the Prometheus text format.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pg_backup_auditor.h"
+#include "cmd_help.h"
+#include "anomaly_detector.h"
+#include "arg_parser.h"
+#include "digest_cache.h"
+#include "fs_watch.h"
+#include "metrics.h"
+#include "ndjson.h"
+#include "storage.h"
+#include "validation_result.h"
+#include "validation_scheduler.h"
+#include "wal_archive_set.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+/* Default --interval: one full rescan an hour */
+#define WATCH_DEFAULT_INTERVAL  3600
+
+/* Directory levels watched below the backup root and each archive */
+#define WATCH_DEPTH             3
+
+/* How long a client may take to send an HTTP request line */
+#define WATCH_REQUEST_WAIT_MS   200
+
+/* How long one send or receive may block before the client is dropped */
+#define WATCH_CLIENT_TIMEOUT    5
+
+/* Command-line options */
+typedef struct {
+	char *backup_dir;
+	char *wal_archive;
+	ValidationLevel level;
+	int jobs;               /* Worker threads for scanning and verification */
+	char *cache_dir;        /* WAL verification cache, or NULL */
+	char *socket_path;      /* NULL = changes go to stdout */
+	int interval;           /* seconds between full rescans, 0 = never */
+	char *metrics_file;     /* Prometheus textfile, or NULL */
+} WatchOptions;
+
+/*
+ * What is known about one backup.  Entries are matched to the backups of
+ * a rescan by path; one whose metadata is unchanged keeps its result.
+ */
+typedef struct {
+	char              backup_path[PATH_MAX];
+	BackupInfo       *backup;       /* in the current catalog */
+	BackupStatus      status;
+	time_t            end_time;
+	XLogRecPtr        stop_lsn;
+	uint64_t          data_bytes;
+	ValidationResult *result;       /* NULL if skipped for its status */
+	time_t            validated_at;
+	bool              pending;      /* to be validated this round */
+	bool              touched;      /* changed this round */
+	AnomalyFinding    anomalies[ANOMALY_MAX_FINDINGS];
+	int               anomaly_count;
+} WatchedBackup;
+
+/* Archive-wide findings, matched across rescans by path */
+typedef struct {
+	char              path[PATH_MAX];
+	ValidationResult *segments;     /* segments checked since the last full rescan */
+	ValidationResult *continuity;
+	int               segment_count;
+	bool              touched;
+} WatchedArchive;
+
+typedef struct {
+	const WatchOptions *opts;
+	BackupInfo     *backups;
+	WALArchiveSet  *wal_set;        /* NULL below --level=checksums */
+	WatchedBackup  *watched;        /* sorted by backup_path */
+	int             watched_count;
+	WatchedArchive *archives;
+	int             archive_count;
+	AnomalyDetector *detector;      /* NULL if it could not be allocated */
+	time_t          started_at;
+	time_t          updated_at;
+	uint64_t        round_started;  /* metrics_clock() */
+
+	/* NDJSON served on the socket, replaced after every round */
+	pthread_mutex_t lock;
+	char           *snapshot;
+	size_t          snapshot_len;
+	char           *metrics;        /* exposition text */
+	size_t          metrics_len;
+	int             listen_fd;
+} WatchState;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void
+handle_signal(int signo)
+{
+	(void) signo;
+	stop_requested = 1;
+}
+
+static void
+init_options(WatchOptions *opts)
+{
+	opts->backup_dir = NULL;
+	opts->wal_archive = NULL;
+	opts->level = VALIDATION_LEVEL_STANDARD;
+	opts->jobs = DEFAULT_THREADS;
+	opts->cache_dir = NULL;
+	opts->socket_path = NULL;
+	opts->interval = WATCH_DEFAULT_INTERVAL;
+	opts->metrics_file = NULL;
+}
+
+static int
+parse_arguments(int argc, char **argv, WatchOptions *opts)
+{
+	int c;
+	int option_index = 0;
+	bool backup_dir_seen = false;
+	bool wal_archive_seen = false;
+	bool level_seen = false;
+	bool jobs_seen = false;
+	bool cache_dir_seen = false;
+	bool socket_seen = false;
+	bool interval_seen = false;
+	bool metrics_file_seen = false;
+
+	static struct option long_options[] = {
+		{"backup-dir",      required_argument, 0, 'B'},
+		{"wal-archive",     required_argument, 0, 'w'},
+		{"level",           required_argument, 0, 'l'},
+		{"jobs",            required_argument, 0, 'j'},
+		{"cache-dir",       required_argument, 0, 'C'},
+		{"socket",          required_argument, 0, 'K'},
+		{"interval",        required_argument, 0, 'I'},
+		{"metrics-file",    required_argument, 0, 'M'},
+		{"help",            no_argument,       0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	while ((c = getopt_long(argc, argv, "B:w:l:j:h",
+							long_options, &option_index)) != -1)
+	{
+		switch (c)
+		{
+			case 'B':
+				if (!parse_string_option("--backup-dir", optarg, &opts->backup_dir, &backup_dir_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'w':
+				if (!parse_string_option("--wal-archive", optarg, &opts->wal_archive, &wal_archive_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'l':
+				if (check_duplicate_option(level_seen, "--level"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!validation_level_from_string(optarg, &opts->level))
+				{
+					fprintf(stderr, "Error: Invalid validation level: %s\n", optarg);
+					fprintf(stderr, "Valid levels: basic, standard, checksums, full, pages\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				level_seen = true;
+				break;
+			case 'j':
+				if (check_duplicate_option(jobs_seen, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_int_argument(optarg, &opts->jobs, "--jobs"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->jobs < 1)
+				{
+					fprintf(stderr, "Error: --jobs must be >= 1\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				jobs_seen = true;
+				break;
+			case 'C':
+				if (!parse_string_option("--cache-dir", optarg, &opts->cache_dir, &cache_dir_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'K':
+				if (!parse_string_option("--socket", optarg, &opts->socket_path, &socket_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'I':
+				if (check_duplicate_option(interval_seen, "--interval"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (!parse_int_argument(optarg, &opts->interval, "--interval"))
+					return EXIT_INVALID_ARGUMENTS;
+				if (opts->interval < 0)
+				{
+					fprintf(stderr, "Error: --interval must be >= 0\n");
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				interval_seen = true;
+				break;
+			case 'M':
+				if (!parse_string_option("--metrics-file", optarg, &opts->metrics_file, &metrics_file_seen))
+					return EXIT_INVALID_ARGUMENTS;
+				break;
+			case 'h':
+				print_watch_usage();
+				return EXIT_SUCCESS;
+			case '?':
+				return EXIT_INVALID_ARGUMENTS;
+			default:
+				return EXIT_INVALID_ARGUMENTS;
+		}
+	}
+
+	return -1;  /* Continue processing */
+}
+
+static int
+validate_options(const WatchOptions *opts)
+{
+	struct sockaddr_un addr;
+
+	if (!validate_required_option(opts->backup_dir, "--backup-dir"))
+		return EXIT_INVALID_ARGUMENTS;
+
+	/* Change notification needs the repository on a local file system */
+	if (storage_is_remote(opts->backup_dir) || storage_is_remote(opts->wal_archive))
+	{
+		fprintf(stderr, "Error: watch needs local directories; object storage URLs are not supported\n");
+		return EXIT_INVALID_ARGUMENTS;
+	}
+
+	if (!is_directory(opts->backup_dir))
+	{
+		fprintf(stderr, "Error: Backup directory does not exist: %s\n", opts->backup_dir);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	if (opts->wal_archive != NULL && !is_directory(opts->wal_archive))
+	{
+		fprintf(stderr, "Error: WAL archive directory does not exist: %s\n", opts->wal_archive);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	if (opts->cache_dir != NULL && !is_directory(opts->cache_dir))
+	{
+		fprintf(stderr, "Error: Cache directory does not exist: %s\n", opts->cache_dir);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	if (opts->socket_path != NULL &&
+		strlen(opts->socket_path) >= sizeof(addr.sun_path))
+	{
+		fprintf(stderr, "Error: Socket path too long: %s\n", opts->socket_path);
+		return EXIT_INVALID_ARGUMENTS;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ *
+ * State
+ * ------------------------------------------------------------------ */
+
+static int
+compare_watched(const void *a, const void *b)
+{
+	return strcmp(((const WatchedBackup *) a)->backup_path,
+				  ((const WatchedBackup *) b)->backup_path);
+}
+
+static WatchedBackup *
+find_watched(WatchedBackup *watched, int count, const char *path)
+{
+	WatchedBackup key;
+
+	if (count == 0)
+		return NULL;
+	str_copy(key.backup_path, path, sizeof(key.backup_path));
+	return bsearch(&key, watched, (size_t) count, sizeof(WatchedBackup),
+				   compare_watched);
+}
+
+/* Whether a rescan found the backup as it was last validated */
+static bool
+fingerprint_equal(const WatchedBackup *wb, const BackupInfo *backup)
+{
+	return wb->status == backup->status &&
+		wb->end_time == backup->end_time &&
+		wb->stop_lsn == backup->stop_lsn &&
+		wb->data_bytes == backup->data_bytes;
+}
+
+static bool
+skipped_for_status(const BackupInfo *backup)
+{
+	return backup->status == BACKUP_STATUS_ERROR ||
+		backup->status == BACKUP_STATUS_CORRUPT;
+}
+
+static WatchedArchive *
+find_archive(WatchState *st, const char *path)
+{
+	for (int i = 0; i < st->archive_count; i++)
+		if (strcmp(st->archives[i].path, path) == 0)
+			return &st->archives[i];
+	return NULL;
+}
+
+/* 'path' is 'dir' or lies below it */
+static bool
+path_under(const char *path, const char *dir)
+{
+	size_t len = strlen(dir);
+
+	while (len > 1 && dir[len - 1] == '/')
+		len--;
+	return strncmp(path, dir, len) == 0 &&
+		(path[len] == '\0' || path[len] == '/');
+}
+
+/* Index of the archive holding directory 'path', or -1 */
+static int
+archive_of(const WatchState *st, const char *path)
+{
+	int    best = -1;
+	size_t best_len = 0;
+
+	for (int ai = 0; st->wal_set != NULL && ai < st->wal_set->count; ai++)
+	{
+		const char *archive = st->wal_set->archives[ai].path;
+
+		if (path_under(path, archive) && strlen(archive) > best_len)
+		{
+			best = ai;
+			best_len = strlen(archive);
+		}
+	}
+	return best;
+}
+
+/* Segment i of 'cur' was not in 'old', or was archived again since */
+static bool
+segment_is_new(const WALArchiveInfo *old, const WALArchiveInfo *cur, int i)
+{
+	int j = old != NULL ? wal_archive_find(old, &cur->segments[i]) : -1;
+
+	if (j < 0)
+		return true;
+	return old->stats != NULL && cur->stats != NULL &&
+		(old->stats[j].size != cur->stats[i].size ||
+		 old->stats[j].mtime != cur->stats[i].mtime);
+}
+
+/*
+ * Bring an archive's findings up to date with its new listing 'cur'.
+ * With 'whole' every segment is checked, otherwise only those not in
+ * 'old'.  Returns true if segments were added.
+ */
+static bool
+update_archive(WatchedArchive *wa, const WALArchiveInfo *old,
+			   WALArchiveInfo *cur, ValidationLevel level, bool whole)
+{
+	WALSegmentName   *segs;
+	ValidationResult *result = NULL;
+	int               nnew = 0;
+
+	if (cur == NULL)
+	{
+		wa->touched = wa->segment_count != 0;
+		wa->segment_count = 0;
+		return false;
+	}
+
+	if (whole)
+	{
+		free_validation_result(wa->segments);
+		wa->segments = NULL;
+		nnew = cur->segment_count;
+		if (level >= VALIDATION_LEVEL_FULL)
+			result = check_wal_archive_headers(cur);
+	}
+	else
+	{
+		segs = malloc(sizeof(WALSegmentName) * (size_t) (cur->segment_count + 1));
+		if (segs == NULL)
+		{
+			fprintf(stderr, "Error: Memory allocation failed\n");
+			return false;
+		}
+		for (int i = 0; i < cur->segment_count; i++)
+			if (segment_is_new(old, cur, i))
+				segs[nnew++] = cur->segments[i];
+		if (nnew > 0)
+			result = check_wal_segments(cur, segs, nnew);
+		free(segs);
+	}
+
+	if (result != NULL)
+	{
+		if (wa->segments == NULL)
+			wa->segments = result;
+		else
+		{
+			validation_result_merge(wa->segments, result);
+			free_validation_result(result);
+		}
+	}
+
+	if (whole || nnew > 0 || cur->segment_count != wa->segment_count)
+	{
+		free_validation_result(wa->continuity);
+		wa->continuity = check_wal_continuity(cur);
+		wa->segment_count = cur->segment_count;
+		wa->touched = true;
+	}
+	return nnew > 0;
+}
+
+/* Queue the backups of an archive that grew, if they were missing WAL */
+static void
+requeue_missing_wal(WatchState *st, const WALArchiveSetEntry *entry)
+{
+	for (int mi = 0; mi < entry->member_count; mi++)
+	{
+		WatchedBackup *wb = find_watched(st->watched, st->watched_count,
+										 entry->members[mi]->backup_path);
+
+		if (wb != NULL && wb->result != NULL &&
+			wb->result->code_counts[VALIDATION_CODE_MISSING_WAL] > 0)
+			wb->pending = true;
+	}
+}
+
+static void
+free_watched(WatchedBackup *watched, int count)
+{
+	for (int i = 0; i < count; i++)
+		free_validation_result(watched[i].result);
+	free(watched);
+}
+
+/*
+ * Score the backups against their baselines, oldest first.  Those the
+ * baselines already hold get their earlier findings back, so only new
+ * backups cost anything.
+ */
+static void
+observe_anomalies(WatchState *st)
+{
+	const BackupInfo **order;
+	int                n;
+
+	if (st->detector == NULL)
+		return;
+
+	order = anomaly_detector_order(st->backups, &n);
+	for (int i = 0; i < n; i++)
+	{
+		WatchedBackup *wb = find_watched(st->watched, st->watched_count,
+										 order[i]->backup_path);
+
+		if (wb != NULL)
+			wb->anomaly_count = anomaly_detector_observe(st->detector, order[i],
+														 false, wb->anomalies);
+	}
+	free(order);
+	anomaly_detector_save(st->detector);
+}
+
+/*
+ * Rescan the catalog and the archives.  Backups found as they were keep
+ * their results unless 'full' is set; the rest are queued.  On failure
+ * the previous state is kept.
+ */
+static bool
+refresh_catalog(WatchState *st, bool full)
+{
+	const WatchOptions *opts = st->opts;
+	BackupInfo     *backups;
+	WALArchiveSet  *wal_set = NULL;
+	WatchedBackup  *watched;
+	WatchedArchive *archives;
+	int             count = 0;
+	int             n = 0;
+
+	backups = scan_backup_directory(opts->backup_dir, -1);
+	for (BackupInfo *cur = backups; cur != NULL; cur = cur->next)
+		count++;
+
+	if (opts->level >= VALIDATION_LEVEL_CHECKSUMS)
+	{
+		wal_set = wal_archive_set_build(backups, opts->wal_archive);
+		if (wal_set == NULL)
+		{
+			free_backup_list(backups);
+			return false;
+		}
+	}
+
+	watched = calloc((size_t) count + 1, sizeof(WatchedBackup));
+	archives = calloc(wal_set != NULL ? (size_t) wal_set->count + 1 : 1,
+					  sizeof(WatchedArchive));
+	if (watched == NULL || archives == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		free(watched);
+		free(archives);
+		wal_archive_set_free(wal_set);
+		free_backup_list(backups);
+		return false;
+	}
+
+	for (BackupInfo *cur = backups; cur != NULL; cur = cur->next)
+	{
+		WatchedBackup *wb = &watched[n++];
+		WatchedBackup *prev = find_watched(st->watched, st->watched_count,
+										   cur->backup_path);
+
+		str_copy(wb->backup_path, cur->backup_path, sizeof(wb->backup_path));
+		wb->backup = cur;
+		wb->status = cur->status;
+		wb->end_time = cur->end_time;
+		wb->stop_lsn = cur->stop_lsn;
+		wb->data_bytes = cur->data_bytes;
+
+		if (!full && prev != NULL && fingerprint_equal(prev, cur))
+		{
+			wb->result = prev->result;
+			wb->validated_at = prev->validated_at;
+			prev->result = NULL;
+			continue;
+		}
+		wb->pending = !skipped_for_status(cur);
+		wb->touched = true;
+	}
+	qsort(watched, (size_t) count, sizeof(WatchedBackup), compare_watched);
+
+	free_watched(st->watched, st->watched_count);
+	st->watched = watched;
+	st->watched_count = count;
+
+	/* Archives carry their findings over; new segments are checked */
+	for (int ai = 0; wal_set != NULL && ai < wal_set->count; ai++)
+	{
+		WALArchiveSetEntry *entry = &wal_set->archives[ai];
+		WatchedArchive     *prev = find_archive(st, entry->path);
+		WatchedArchive     *wa = &archives[ai];
+		int                 ri;
+
+		if (prev != NULL)
+		{
+			*wa = *prev;
+			prev->segments = NULL;
+			prev->continuity = NULL;
+		}
+		else
+			str_copy(wa->path, entry->path, sizeof(wa->path));
+
+		ri = -1;
+		for (int oi = 0; st->wal_set != NULL && oi < st->wal_set->count; oi++)
+			if (strcmp(st->wal_set->archives[oi].path, entry->path) == 0)
+				ri = oi;
+
+		if (update_archive(wa, ri >= 0 ? st->wal_set->archives[ri].info : NULL,
+						   entry->info, opts->level, full || prev == NULL))
+			requeue_missing_wal(st, entry);
+	}
+
+	for (int i = 0; i < st->archive_count; i++)
+	{
+		free_validation_result(st->archives[i].segments);
+		free_validation_result(st->archives[i].continuity);
+	}
+	free(st->archives);
+	st->archives = archives;
+	st->archive_count = wal_set != NULL ? wal_set->count : 0;
+
+	wal_archive_set_free(st->wal_set);
+	free_backup_list(st->backups);
+	st->wal_set = wal_set;
+	st->backups = backups;
+	observe_anomalies(st);
+	return true;
+}
+
+/* Re-list one archive; backups keep their results */
+static void
+refresh_archive(WatchState *st, int ai)
+{
+	WALArchiveSetEntry *entry = &st->wal_set->archives[ai];
+	WALArchiveInfo     *old = entry->info;
+
+	entry->info = scan_wal_archive(entry->path);
+	if (update_archive(&st->archives[ai], old, entry->info, st->opts->level, false))
+		requeue_missing_wal(st, entry);
+	free_wal_archive_info(old);
+}
+
+/* Validate the queued backups */
+static int
+validate_pending(WatchState *st)
+{
+	ValidationTask      *tasks;
+	WatchedBackup      **owners;
+	ValidationScheduler *sched;
+	int                  ntasks = 0;
+	time_t               now;
+
+	tasks = calloc((size_t) st->watched_count + 1, sizeof(ValidationTask));
+	owners = calloc((size_t) st->watched_count + 1, sizeof(WatchedBackup *));
+	if (tasks == NULL || owners == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		free(tasks);
+		free(owners);
+		return 0;
+	}
+
+	for (int i = 0; i < st->watched_count; i++)
+	{
+		WatchedBackup *wb = &st->watched[i];
+
+		if (!wb->pending)
+			continue;
+		tasks[ntasks].backup = wb->backup;
+		tasks[ntasks].wal_info = wal_archive_set_lookup(st->wal_set, wb->backup);
+		owners[ntasks++] = wb;
+	}
+
+	if (ntasks > 0)
+	{
+		sched = validation_scheduler_start(tasks, ntasks, st->backups, st->opts->level);
+		if (sched == NULL)
+		{
+			fprintf(stderr, "Error: Memory allocation failed\n");
+			ntasks = 0;
+		}
+		else
+			validation_scheduler_finish(sched);
+	}
+
+	now = time(NULL);
+	for (int ti = 0; ti < ntasks; ti++)
+	{
+		WatchedBackup *wb = owners[ti];
+
+		free_validation_result(wb->result);
+		wb->result = tasks[ti].result;
+		wb->validated_at = now;
+		wb->pending = false;
+		wb->touched = true;
+	}
+
+	free(tasks);
+	free(owners);
+	return ntasks;
+}
+
+/* ------------------------------------------------------------------ *
+ * Output
+ * ------------------------------------------------------------------ */
+
+static const char *
+result_outcome(const ValidationResult *result)
+{
+	if (result == NULL)
+		return "skipped";
+	return result->error_count > 0 ? "error" :
+		result->warning_count > 0 ? "warning" : "ok";
+}
+
+static void
+emit_backup(FILE *fp, const WatchedBackup *wb)
+{
+	NdjsonRecord rec;
+
+	ndjson_begin(&rec, fp, "backup");
+	ndjson_backup_fields(&rec, wb->backup);
+	ndjson_string(&rec, "result", result_outcome(wb->result));
+	ndjson_int(&rec, "errors", wb->result != NULL ? wb->result->error_count : 0);
+	ndjson_int(&rec, "warnings", wb->result != NULL ? wb->result->warning_count : 0);
+	ndjson_time(&rec, "validated_at", wb->validated_at);
+	ndjson_end(&rec);
+
+	if (wb->result != NULL)
+		ndjson_findings(fp, wb->result, wb->backup->backup_id, NULL, "backup");
+
+	for (int i = 0; i < wb->anomaly_count; i++)
+	{
+		const AnomalyFinding *f = &wb->anomalies[i];
+
+		ndjson_begin(&rec, fp, "anomaly");
+		ndjson_string(&rec, "backup_id", f->backup_id);
+		ndjson_string(&rec, "kind", anomaly_kind_name(f->kind));
+		ndjson_double(&rec, "value", f->value);
+		ndjson_double(&rec, "median", f->median);
+		ndjson_double(&rec, "average", f->ewma);
+		ndjson_double(&rec, "ratio", f->ratio);
+		ndjson_double(&rec, "score", f->score);
+		ndjson_end(&rec);
+	}
+}
+
+static void
+emit_archive(FILE *fp, const WatchedArchive *wa)
+{
+	NdjsonRecord rec;
+	int          errors = 0;
+
+	if (wa->segments != NULL)
+		errors += wa->segments->error_count;
+	if (wa->continuity != NULL)
+		errors += wa->continuity->error_count;
+
+	ndjson_begin(&rec, fp, "wal_archive");
+	ndjson_string(&rec, "archive", wa->path);
+	ndjson_int(&rec, "segments", wa->segment_count);
+	ndjson_int(&rec, "errors", errors);
+	ndjson_end(&rec);
+
+	if (wa->segments != NULL)
+		ndjson_findings(fp, wa->segments, NULL, wa->path, "segments");
+	if (wa->continuity != NULL)
+		ndjson_findings(fp, wa->continuity, NULL, wa->path, "continuity");
+}
+
+static void
+emit_summary(FILE *fp, const WatchState *st)
+{
+	NdjsonRecord rec;
+	int          validated = 0;
+	int          errors = 0;
+	int          warnings = 0;
+	int          anomalies = 0;
+	const char  *outcome;
+
+	for (int i = 0; i < st->watched_count; i++)
+	{
+		const ValidationResult *result = st->watched[i].result;
+
+		anomalies += st->watched[i].anomaly_count;
+		if (result == NULL)
+			continue;
+		validated++;
+		errors += result->error_count;
+		warnings += result->warning_count;
+	}
+	for (int i = 0; i < st->archive_count; i++)
+	{
+		if (st->archives[i].segments != NULL)
+			errors += st->archives[i].segments->error_count;
+		if (st->archives[i].continuity != NULL)
+			errors += st->archives[i].continuity->error_count;
+	}
+	outcome = errors > 0 ? "failed" : warnings > 0 ? "warning" : "ok";
+
+	ndjson_begin(&rec, fp, "summary");
+	ndjson_time(&rec, "started_at", st->started_at);
+	ndjson_time(&rec, "updated_at", st->updated_at);
+	ndjson_int(&rec, "backups_found", st->watched_count);
+	ndjson_int(&rec, "backups_validated", validated);
+	ndjson_int(&rec, "wal_archives", st->archive_count);
+	ndjson_int(&rec, "errors", errors);
+	ndjson_int(&rec, "warnings", warnings);
+	ndjson_int(&rec, "anomalies", anomalies);
+	ndjson_string(&rec, "result", outcome);
+	ndjson_end(&rec);
+}
+
+/* The state, or with 'touched_only' what changed this round, and a summary */
+static void
+render(FILE *fp, const WatchState *st, bool touched_only)
+{
+	for (BackupInfo *cur = st->backups; cur != NULL; cur = cur->next)
+	{
+		const WatchedBackup *wb = find_watched(st->watched, st->watched_count,
+											   cur->backup_path);
+
+		if (wb != NULL && (!touched_only || wb->touched))
+			emit_backup(fp, wb);
+	}
+	for (int i = 0; i < st->archive_count; i++)
+		if (!touched_only || st->archives[i].touched)
+			emit_archive(fp, &st->archives[i]);
+	emit_summary(fp, st);
+}
+
+/* Counters, and the current findings by category */
+static void
+metrics_report_state(const WatchState *st, MetricsReport *report)
+{
+	metrics_report_init(report, "watch");
+	report->finished_at = st->updated_at;
+	report->duration = (double) (metrics_clock() - st->round_started) / 1e9;
+	for (int i = 0; i < st->watched_count; i++)
+		metrics_report_add(report, st->watched[i].result);
+	for (int i = 0; i < st->archive_count; i++)
+	{
+		metrics_report_add(report, st->archives[i].segments);
+		metrics_report_add(report, st->archives[i].continuity);
+	}
+}
+
+/* Publish the state after a round and clear the round's marks */
+static void
+publish(WatchState *st)
+{
+	MetricsReport report;
+	char         *buf = NULL;
+	size_t        len = 0;
+	char         *mbuf = NULL;
+	size_t        mlen = 0;
+	FILE         *fp;
+
+	st->updated_at = time(NULL);
+	digest_cache_save();
+	metrics_report_state(st, &report);
+	if (st->opts->metrics_file != NULL)
+		metrics_write_file(st->opts->metrics_file, &report);
+
+	if (st->opts->socket_path == NULL)
+		render(stdout, st, true);
+	else if ((fp = open_memstream(&buf, &len)) != NULL)
+	{
+		render(fp, st, false);
+		fclose(fp);
+		if ((fp = open_memstream(&mbuf, &mlen)) != NULL)
+		{
+			metrics_write(fp, &report);
+			fclose(fp);
+		}
+
+		pthread_mutex_lock(&st->lock);
+		free(st->snapshot);
+		st->snapshot = buf;
+		st->snapshot_len = len;
+		free(st->metrics);
+		st->metrics = mbuf;
+		st->metrics_len = mbuf != NULL ? mlen : 0;
+		pthread_mutex_unlock(&st->lock);
+	}
+	else
+		fprintf(stderr, "Error: Memory allocation failed\n");
+
+	for (int i = 0; i < st->watched_count; i++)
+		st->watched[i].touched = false;
+	for (int i = 0; i < st->archive_count; i++)
+		st->archives[i].touched = false;
+}
+
+/* ------------------------------------------------------------------ *
+ * Socket
+ * ------------------------------------------------------------------ */
+
+static bool
+send_all(int fd, const char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			log_debug("Dropping a client that stopped reading for %d s",
+					  WATCH_CLIENT_TIMEOUT);
+		if (n <= 0)
+			return false;
+		buf += n;
+		len -= (size_t) n;
+	}
+	return true;
+}
+
+/*
+ * A bare connection gets the records; an HTTP GET gets them as a
+ * response, or the metrics for GET /metrics.  Clients are served one at
+ * a time, so the socket timeouts set on accept bound how long a stalled
+ * one holds up the rest.
+ */
+static void
+serve_client(WatchState *st, int fd)
+{
+	char          request[512];
+	struct pollfd pfd = { fd, POLLIN, 0 };
+	ssize_t       n = 0;
+	bool          http;
+	bool          metrics;
+	char         *body;
+	size_t        len;
+
+	if (poll(&pfd, 1, WATCH_REQUEST_WAIT_MS) > 0)
+		n = recv(fd, request, sizeof(request) - 1, 0);
+	request[n > 0 ? n : 0] = '\0';
+	http = strncmp(request, "GET ", 4) == 0;
+	metrics = http && strncmp(request + 4, "/metrics", 8) == 0 &&
+		(request[12] == ' ' || request[12] == '?' || request[12] == '\r');
+
+	pthread_mutex_lock(&st->lock);
+	len = metrics ? st->metrics_len : st->snapshot_len;
+	body = malloc(len + 1);
+	if (body != NULL && len > 0)
+		memcpy(body, metrics ? st->metrics : st->snapshot, len);
+	pthread_mutex_unlock(&st->lock);
+	if (body == NULL)
+		return;
+
+	if (http)
+	{
+		char header[160];
+		int  hlen = snprintf(header, sizeof(header),
+							 "HTTP/1.0 200 OK\r\n"
+							 "Content-Type: %s\r\n"
+							 "Content-Length: %zu\r\n"
+							 "Connection: close\r\n\r\n",
+							 metrics ? "text/plain; version=0.0.4"
+							 : "application/x-ndjson", len);
+
+		if (!send_all(fd, header, (size_t) hlen))
+		{
+			free(body);
+			return;
+		}
+	}
+	send_all(fd, body, len);
+	free(body);
+}
+
+static void *
+serve_thread(void *arg)
+{
+	WatchState *st = arg;
+
+	while (!stop_requested)
+	{
+		struct pollfd  pfd = { st->listen_fd, POLLIN, 0 };
+		struct timeval timeout = { WATCH_CLIENT_TIMEOUT, 0 };
+		int            fd;
+
+		if (poll(&pfd, 1, 500) <= 0)
+			continue;
+		fd = accept(st->listen_fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+		if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0 ||
+			setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0)
+		{
+			close(fd);
+			continue;
+		}
+		serve_client(st, fd);
+		close(fd);
+	}
+	return NULL;
+}
+
+static int
+open_socket(const char *path)
+{
+	struct sockaddr_un addr;
+	struct stat        st;
+	int                fd;
+
+	/* A socket left behind by an earlier run; other files are not touched */
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	str_copy(addr.sun_path, path, sizeof(addr.sun_path));
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+		listen(fd, 16) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* ------------------------------------------------------------------ *
+ * Watching
+ * ------------------------------------------------------------------ */
+
+/* Backup directories are watched themselves, but not their contents */
+static bool
+descend_filter(const char *path, void *arg)
+{
+	static const char *const markers[] = {
+		"backup_label", "backup.control", "backup.manifest", "backup_manifest"
+	};
+	char marker[PATH_MAX];
+
+	(void) arg;
+	for (size_t i = 0; i < sizeof(markers) / sizeof(markers[0]); i++)
+	{
+		path_join(marker, sizeof(marker), path, markers[i]);
+		if (file_exists(marker))
+			return false;
+	}
+	return true;
+}
+
+/* Watch archives the set gained; already watched ones are left alone */
+static void
+watch_archives(FsWatch *fs, const WatchState *st)
+{
+	for (int ai = 0; st->wal_set != NULL && ai < st->wal_set->count; ai++)
+		if (!fs_watch_add_tree(fs, st->wal_set->archives[ai].path, WATCH_DEPTH))
+			log_warning("Cannot watch WAL archive: %s", st->wal_set->archives[ai].path);
+}
+
+static void
+free_state(WatchState *st)
+{
+	free_watched(st->watched, st->watched_count);
+	for (int i = 0; i < st->archive_count; i++)
+	{
+		free_validation_result(st->archives[i].segments);
+		free_validation_result(st->archives[i].continuity);
+	}
+	free(st->archives);
+	wal_archive_set_free(st->wal_set);
+	free_backup_list(st->backups);
+	anomaly_detector_close(st->detector);
+	free(st->snapshot);
+	free(st->metrics);
+	pthread_mutex_destroy(&st->lock);
+}
+
+/*
+ * cmd_watch_main - Main function for the 'watch' command
+ *
+ * Validates the catalog once and then again as it changes, until
+ * SIGINT or SIGTERM.
+ *
+ * Return codes:
+ * - EXIT_SUCCESS (0) when stopped by a signal
+ * - EXIT_FAILURE (1) on critical error
+ * - 4 (EXIT_INVALID_ARGUMENTS) on invalid arguments
+ */
+int
+cmd_watch_main(int argc, char **argv)
+{
+	WatchOptions      opts;
+	WatchState        st;
+	FsWatch          *fs;
+	struct sigaction  sa;
+	sigset_t          block;
+	sigset_t          saved;
+	pthread_t         server;
+	bool              serving = false;
+	time_t            last_full;
+	int               ret;
+
+	init_options(&opts);
+
+	ret = parse_arguments(argc, argv, &opts);
+	if (ret == EXIT_SUCCESS)  /* --help was shown */
+		return EXIT_SUCCESS;
+	if (ret != -1)  /* Error occurred */
+		return ret;
+
+	ret = validate_options(&opts);
+	if (ret != EXIT_SUCCESS)
+		return ret;
+
+	validation_set_jobs(opts.jobs);
+	scan_set_jobs(opts.jobs);
+	validation_set_cache_dir(opts.cache_dir);
+
+	memset(&st, 0, sizeof(st));
+	st.opts = &opts;
+	st.listen_fd = -1;
+	st.started_at = time(NULL);
+	st.detector = anomaly_detector_open(opts.backup_dir);
+	pthread_mutex_init(&st.lock, NULL);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = handle_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	fs = fs_watch_open(descend_filter, NULL);
+	if (fs == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		free_state(&st);
+		return EXIT_GENERAL_ERROR;
+	}
+	if (!fs_watch_add_tree(fs, opts.backup_dir, WATCH_DEPTH))
+	{
+		fprintf(stderr, "Error: Cannot watch backup directory: %s\n", opts.backup_dir);
+		fs_watch_close(fs);
+		free_state(&st);
+		return EXIT_GENERAL_ERROR;
+	}
+
+	/* The first round validates everything */
+	log_info("Scanning backup directory: %s", opts.backup_dir);
+	st.round_started = metrics_clock();
+	if (!refresh_catalog(&st, true))
+	{
+		fs_watch_close(fs);
+		free_state(&st);
+		return EXIT_GENERAL_ERROR;
+	}
+	watch_archives(fs, &st);
+	validate_pending(&st);
+	publish(&st);
+	last_full = time(NULL);
+
+	if (opts.socket_path != NULL)
+	{
+		st.listen_fd = open_socket(opts.socket_path);
+		if (st.listen_fd < 0)
+		{
+			fprintf(stderr, "Error: Cannot listen on socket: %s\n", opts.socket_path);
+			fs_watch_close(fs);
+			free_state(&st);
+			return EXIT_GENERAL_ERROR;
+		}
+
+		/* Signals are left to the main thread */
+		sigemptyset(&block);
+		sigaddset(&block, SIGINT);
+		sigaddset(&block, SIGTERM);
+		pthread_sigmask(SIG_BLOCK, &block, &saved);
+		serving = pthread_create(&server, NULL, serve_thread, &st) == 0;
+		pthread_sigmask(SIG_SETMASK, &saved, NULL);
+		if (!serving)
+		{
+			fprintf(stderr, "Error: Cannot start the socket thread\n");
+			close(st.listen_fd);
+			unlink(opts.socket_path);
+			fs_watch_close(fs);
+			free_state(&st);
+			return EXIT_GENERAL_ERROR;
+		}
+		log_info("Serving state on %s", opts.socket_path);
+	}
+	log_info("Watching %d directories (%s)", fs_watch_count(fs), fs_watch_backend());
+
+	ret = EXIT_SUCCESS;
+	while (!stop_requested)
+	{
+		int  n;
+		int  validated;
+		bool full = false;
+		bool backups_changed = false;
+
+		/* Wake up every second for signals and the rescan interval */
+		n = fs_watch_wait(fs, 1000);
+		if (stop_requested)
+			break;
+		if (n < 0)
+		{
+			log_error("Cannot wait for file system events");
+			ret = EXIT_GENERAL_ERROR;
+			break;
+		}
+
+		if (opts.interval > 0 && time(NULL) - last_full >= opts.interval)
+			full = true;
+		else if (n == 0)
+			continue;
+		st.round_started = metrics_clock();
+
+		if (!full)
+		{
+			bool *archive_changed = calloc(st.wal_set != NULL ? (size_t) st.wal_set->count + 1 : 1,
+										   sizeof(bool));
+
+			if (archive_changed == NULL)
+			{
+				fprintf(stderr, "Error: Memory allocation failed\n");
+				continue;
+			}
+			for (int c = 0; c < n; c++)
+			{
+				int ai = archive_of(&st, fs_watch_changed(fs, c));
+
+				log_debug("Changed: %s", fs_watch_changed(fs, c));
+				if (ai >= 0)
+					archive_changed[ai] = true;
+				else
+					backups_changed = true;
+			}
+			if (backups_changed)
+				refresh_catalog(&st, false);
+			else
+				for (int ai = 0; st.wal_set != NULL && ai < st.wal_set->count; ai++)
+					if (archive_changed[ai])
+						refresh_archive(&st, ai);
+			free(archive_changed);
+		}
+		else
+		{
+			log_info("Full rescan of %s", opts.backup_dir);
+			refresh_catalog(&st, true);
+			last_full = time(NULL);
+		}
+
+		watch_archives(fs, &st);
+		validated = validate_pending(&st);
+		publish(&st);
+		log_info("Revalidated %d backup%s", validated, validated == 1 ? "" : "s");
+	}
+
+	if (serving)
+	{
+		stop_requested = 1;
+		pthread_join(server, NULL);
+		close(st.listen_fd);
+		unlink(opts.socket_path);
+	}
+	fs_watch_close(fs);
+	free_state(&st);
+	return ret;
+}
@@ -0,0 +1,651 @@
+/*
+ * anomaly_detector.c
+ *
+ * Per-(tool, instance, type) baselines of backup size and duration
+ *
+ * Baselines live in an array that grows as new keys turn up, found by
+ * an open-addressing table of array indices.  Each also keeps the
+ * findings of the backups folded into it, in start time order, so that
+ * a backup seen again is answered by a binary search instead of being
+ * scored against a baseline that already includes it.
+ *
+ * The baselines file sits in the cache directory next to the catalog
+ * index, under the same kind of name (a hash of the backup directory and
+ * the size mode, which changes what data_bytes holds).  Native byte
+ * order and struct layout, like the index:
+ *
+ *   header:   magic[8] version:u32 baseline_size:u32 finding_size:u32
+ *             count:u32
+ *   baseline: BaselineRecord AnomalyFinding[nfindings]
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "anomaly_detector.h"
+#include "backup_stats.h"
+#include "metrics.h"
+#include "sha256.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ANOMALY_FILE_MAGIC    "PGBAANM"
+#define ANOMALY_FILE_VERSION  1
+
+/* Scale of the MAD to the standard deviation of a normal distribution */
+#define MAD_SCALE             0.6745
+
+typedef struct {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	baseline_size;
+	uint32_t	finding_size;
+	uint32_t	count;
+} AnomalyFileHeader;
+
+/* The part of a baseline that is saved */
+typedef struct {
+	BackupTool	tool;
+	BackupType	type;
+	char		instance_name[64];
+	time_t		last_start;			/* newest backup folded in */
+	char		last_id[64];
+	AnomalySeries size;				/* data + WAL bytes */
+	AnomalySeries duration;			/* seconds */
+	uint32_t	nfindings;
+} BaselineRecord;
+
+typedef struct {
+	AnomalyFinding finding;
+	bool		seen;				/* observed since the last save */
+} StoredFinding;
+
+typedef struct {
+	BaselineRecord rec;
+	StoredFinding *findings;		/* by start time, then backup ID */
+	int			finding_count;
+	int			finding_capacity;
+} Baseline;
+
+struct AnomalyDetector {
+	char		file[PATH_MAX];		/* "" = not saved */
+	Baseline   *baselines;
+	int			count;
+	int			capacity;
+	int32_t    *slots;				/* indices into baselines, -1 = empty */
+	size_t		slot_capacity;		/* power of two */
+	bool		dirty;
+};
+
+const char *
+anomaly_kind_name(AnomalyKind kind)
+{
+	switch (kind)
+	{
+		case ANOMALY_SIZE_LARGE:     return "size_large";
+		case ANOMALY_SIZE_SMALL:     return "size_small";
+		case ANOMALY_DURATION_LONG:  return "duration_long";
+		case ANOMALY_DURATION_SHORT: return "duration_short";
+	}
+	return "unknown";
+}
+
+/* ------------------------------------------------------------------ *
+ * Series
+ * ------------------------------------------------------------------ */
+
+void
+anomaly_series_add(AnomalySeries *s, double value)
+{
+	s->window[s->count % ANOMALY_WINDOW] = value;
+	if (s->count == 0)
+		s->ewma = value;
+	else
+		s->ewma += ANOMALY_EWMA_ALPHA * (value - s->ewma);
+	s->count++;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* Median of the n values of 'v', which are sorted in place */
+static double
+median_of(double *v, int n)
+{
+	qsort(v, (size_t) n, sizeof(double), compare_doubles);
+	return n % 2 == 1 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+bool
+anomaly_series_median(const AnomalySeries *s, double *median, double *mad)
+{
+	double	v[ANOMALY_WINDOW];
+	int		n = s->count < ANOMALY_WINDOW ? (int) s->count : ANOMALY_WINDOW;
+
+	if (n == 0)
+		return false;
+
+	memcpy(v, s->window, (size_t) n * sizeof(double));
+	*median = median_of(v, n);
+	for (int i = 0; i < n; i++)
+		v[i] = fabs(v[i] - *median);
+	*mad = median_of(v, n);
+	return true;
+}
+
+/*
+ * Score 'value' against 's'.  Fills 'out' with kind 'large' or 'small'
+ * and returns true if it is anomalous.
+ */
+static bool
+series_score(const AnomalySeries *s, double value, bool detect_small,
+			 AnomalyKind large, AnomalyKind small, AnomalyFinding *out)
+{
+	double median, mad;
+
+	if (s->count < ANOMALY_MIN_HISTORY || !anomaly_series_median(s, &median, &mad) ||
+		median <= 0.0 || value <= 0.0)
+		return false;
+
+	if (value > ANOMALY_RATIO * median && value > ANOMALY_RATIO * s->ewma)
+	{
+		out->kind = large;
+		out->ratio = value / median;
+	}
+	else if (detect_small &&
+			 value * ANOMALY_RATIO < median && value * ANOMALY_RATIO < s->ewma)
+	{
+		out->kind = small;
+		out->ratio = median / value;
+	}
+	else
+		return false;
+
+	/* A MAD of 0 (identical history) leaves only the ratio to judge by */
+	out->score = mad > 0.0 ? MAD_SCALE * fabs(value - median) / mad : 0.0;
+	if (mad > 0.0 && out->score <= ANOMALY_SCORE)
+		return false;
+
+	out->value = value;
+	out->median = median;
+	out->ewma = s->ewma;
+	return true;
+}
+
+/* ------------------------------------------------------------------ *
+ * Baselines
+ * ------------------------------------------------------------------ */
+
+/* FNV-1a of the instance name, mixed with the tool and type */
+static size_t
+key_hash(BackupTool tool, BackupType type, const char *instance_name)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	h = (h ^ (uint64_t) tool) * 0x100000001b3ULL;
+	h = (h ^ (uint64_t) (type + 1)) * 0x100000001b3ULL;
+	for (const unsigned char *p = (const unsigned char *) instance_name; *p; p++)
+		h = (h ^ *p) * 0x100000001b3ULL;
+	return (size_t) (h ^ (h >> 29));
+}
+
+static int32_t *
+find_slot(const AnomalyDetector *d, BackupTool tool, const char *instance_name,
+		  BackupType type)
+{
+	size_t i = key_hash(tool, type, instance_name) & (d->slot_capacity - 1);
+
+	for (;;)
+	{
+		int32_t n = d->slots[i];
+
+		if (n < 0 ||
+			(d->baselines[n].rec.tool == tool && d->baselines[n].rec.type == type &&
+			 strcmp(d->baselines[n].rec.instance_name, instance_name) == 0))
+			return &d->slots[i];
+		i = (i + 1) & (d->slot_capacity - 1);
+	}
+}
+
+static bool
+rehash(AnomalyDetector *d, size_t capacity)
+{
+	int32_t *slots = malloc(capacity * sizeof(int32_t));
+
+	if (slots == NULL)
+		return false;
+	for (size_t i = 0; i < capacity; i++)
+		slots[i] = -1;
+	free(d->slots);
+	d->slots = slots;
+	d->slot_capacity = capacity;
+	for (int n = 0; n < d->count; n++)
+		*find_slot(d, d->baselines[n].rec.tool, d->baselines[n].rec.instance_name,
+				   d->baselines[n].rec.type) = n;
+	return true;
+}
+
+/* The baseline of the key, added if new; NULL on allocation failure */
+static Baseline *
+get_baseline(AnomalyDetector *d, BackupTool tool, const char *instance_name,
+			 BackupType type)
+{
+	int32_t	   *slot;
+	Baseline   *b;
+
+	slot = find_slot(d, tool, instance_name, type);
+	if (*slot >= 0)
+		return &d->baselines[*slot];
+
+	/* Keep the load factor at or below 1/2 */
+	if ((size_t) (d->count + 1) * 2 > d->slot_capacity)
+	{
+		if (!rehash(d, d->slot_capacity * 2))
+			return NULL;
+		slot = find_slot(d, tool, instance_name, type);
+	}
+	if (d->count == d->capacity)
+	{
+		int			cap = d->capacity > 0 ? d->capacity * 2 : 16;
+		Baseline   *grown = realloc(d->baselines, (size_t) cap * sizeof(Baseline));
+
+		if (grown == NULL)
+			return NULL;
+		d->baselines = grown;
+		d->capacity = cap;
+	}
+
+	b = &d->baselines[d->count];
+	memset(b, 0, sizeof(*b));
+	b->rec.tool = tool;
+	b->rec.type = type;
+	str_copy(b->rec.instance_name, instance_name, sizeof(b->rec.instance_name));
+	*slot = d->count++;
+	return b;
+}
+
+/* Order of backups within a baseline: start time, then backup ID */
+static int
+compare_position(time_t start_a, const char *id_a, time_t start_b, const char *id_b)
+{
+	if (start_a != start_b)
+		return start_a < start_b ? -1 : 1;
+	return strcmp(id_a, id_b);
+}
+
+static bool
+add_finding(Baseline *b, const AnomalyFinding *f)
+{
+	if (b->finding_count == b->finding_capacity)
+	{
+		int			   cap = b->finding_capacity > 0 ? b->finding_capacity * 2 : 4;
+		StoredFinding *grown = realloc(b->findings, (size_t) cap * sizeof(StoredFinding));
+
+		if (grown == NULL)
+			return false;
+		b->findings = grown;
+		b->finding_capacity = cap;
+	}
+	b->findings[b->finding_count].finding = *f;
+	b->findings[b->finding_count].seen = true;
+	b->finding_count++;
+	return true;
+}
+
+/* Findings of a backup the baseline already holds */
+static int
+recall_findings(Baseline *b, const BackupInfo *backup,
+				AnomalyFinding out[ANOMALY_MAX_FINDINGS])
+{
+	int lo = 0, hi = b->finding_count;
+	int n = 0;
+
+	while (lo < hi)
+	{
+		int					  mid = lo + (hi - lo) / 2;
+		const AnomalyFinding *f = &b->findings[mid].finding;
+
+		if (compare_position(f->start_time, f->backup_id,
+							 backup->start_time, backup->backup_id) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (int i = lo; i < b->finding_count && n < ANOMALY_MAX_FINDINGS; i++)
+	{
+		StoredFinding *sf = &b->findings[i];
+
+		if (sf->finding.start_time != backup->start_time ||
+			strcmp(sf->finding.backup_id, backup->backup_id) != 0)
+			break;
+		sf->seen = true;
+		out[n++] = sf->finding;
+	}
+	return n;
+}
+
+int
+anomaly_detector_observe(AnomalyDetector *d, const BackupInfo *backup,
+						 bool detect_size_small, AnomalyFinding out[ANOMALY_MAX_FINDINGS])
+{
+	Baseline   *b;
+	double		size, duration;
+	int			n = 0;
+
+	if (!backup_stats_is_baseline(backup))
+		return 0;
+
+	b = get_baseline(d, backup->tool, backup->instance_name, backup->type);
+	if (b == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		return 0;
+	}
+
+	if (b->rec.size.count > 0 &&
+		compare_position(backup->start_time, backup->backup_id,
+						 b->rec.last_start, b->rec.last_id) <= 0)
+		return recall_findings(b, backup, out);
+
+	size = (double) (backup->data_bytes + backup->wal_bytes);
+	duration = (double) (backup->end_time - backup->start_time);
+
+	if (series_score(&b->rec.size, size, detect_size_small,
+					 ANOMALY_SIZE_LARGE, ANOMALY_SIZE_SMALL, &out[n]))
+		n++;
+	if (series_score(&b->rec.duration, duration, true,
+					 ANOMALY_DURATION_LONG, ANOMALY_DURATION_SHORT, &out[n]))
+		n++;
+	for (int i = 0; i < n; i++)
+	{
+		str_copy(out[i].backup_id, backup->backup_id, sizeof(out[i].backup_id));
+		out[i].start_time = backup->start_time;
+		if (!add_finding(b, &out[i]))
+			fprintf(stderr, "Error: Memory allocation failed\n");
+	}
+
+	anomaly_series_add(&b->rec.size, size);
+	anomaly_series_add(&b->rec.duration, duration);
+	b->rec.last_start = backup->start_time;
+	str_copy(b->rec.last_id, backup->backup_id, sizeof(b->rec.last_id));
+	d->dirty = true;
+	return n;
+}
+
+static int
+compare_order(const void *a, const void *b)
+{
+	const BackupInfo *x = *(const BackupInfo *const *) a;
+	const BackupInfo *y = *(const BackupInfo *const *) b;
+	int				  c = compare_position(x->start_time, x->backup_id,
+										   y->start_time, y->backup_id);
+
+	/* Same start and ID in different baselines: keep the sort total */
+	return c != 0 ? c : strcmp(x->backup_path, y->backup_path);
+}
+
+const BackupInfo **
+anomaly_detector_order(const BackupInfo *list, int *count)
+{
+	const BackupInfo **order;
+	int				   n = 0;
+
+	*count = 0;
+	for (const BackupInfo *b = list; b != NULL; b = b->next)
+		if (backup_stats_is_baseline(b))
+			n++;
+	if (n == 0)
+		return NULL;
+
+	order = malloc((size_t) n * sizeof(BackupInfo *));
+	if (order == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		return NULL;
+	}
+	n = 0;
+	for (const BackupInfo *b = list; b != NULL; b = b->next)
+		if (backup_stats_is_baseline(b))
+			order[n++] = b;
+	qsort(order, (size_t) n, sizeof(BackupInfo *), compare_order);
+	*count = n;
+	return order;
+}
+
+int
+anomaly_detector_baselines(const AnomalyDetector *d)
+{
+	return d->count;
+}
+
+/* ------------------------------------------------------------------ *
+ * Baselines file
+ * ------------------------------------------------------------------ */
+
+static void
+free_baselines(AnomalyDetector *d)
+{
+	for (int i = 0; i < d->count; i++)
+		free(d->baselines[i].findings);
+	d->count = 0;
+	for (size_t i = 0; i < d->slot_capacity; i++)
+		d->slots[i] = -1;
+}
+
+static void
+load_baselines(AnomalyDetector *d)
+{
+	FILE			 *fp;
+	AnomalyFileHeader hdr;
+
+	fp = fopen(d->file, "rb");
+	if (fp == NULL)
+		return;		/* nothing saved yet */
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+		memcmp(hdr.magic, ANOMALY_FILE_MAGIC, sizeof(ANOMALY_FILE_MAGIC)) != 0 ||
+		hdr.version != ANOMALY_FILE_VERSION ||
+		hdr.baseline_size != sizeof(BaselineRecord) ||
+		hdr.finding_size != sizeof(AnomalyFinding))
+	{
+		log_debug("Anomaly baselines %s: stale or unknown format, starting over",
+				  d->file);
+		fclose(fp);
+		d->dirty = true;
+		return;
+	}
+
+	for (uint32_t n = 0; n < hdr.count; n++)
+	{
+		BaselineRecord rec;
+		Baseline	  *b;
+
+		if (fread(&rec, sizeof(rec), 1, fp) != 1)
+			goto corrupt;
+		rec.instance_name[sizeof(rec.instance_name) - 1] = '\0';
+		rec.last_id[sizeof(rec.last_id) - 1] = '\0';
+
+		b = get_baseline(d, rec.tool, rec.instance_name, rec.type);
+		if (b == NULL || b->rec.size.count > 0)
+			goto corrupt;		/* out of memory, or a key repeated */
+		b->rec = rec;
+		b->rec.nfindings = 0;
+
+		for (uint32_t i = 0; i < rec.nfindings; i++)
+		{
+			AnomalyFinding f;
+
+			if (fread(&f, sizeof(f), 1, fp) != 1)
+				goto corrupt;
+			f.backup_id[sizeof(f.backup_id) - 1] = '\0';
+			if (!add_finding(b, &f))
+				goto corrupt;
+			b->findings[b->finding_count - 1].seen = false;
+		}
+	}
+	metrics_io_stream(fp);
+	fclose(fp);
+
+	log_debug("Anomaly baselines %s: %d baseline%s", d->file,
+			  d->count, d->count == 1 ? "" : "s");
+	return;
+
+corrupt:
+	log_debug("Anomaly baselines %s: truncated or corrupt, starting over",
+			  d->file);
+	fclose(fp);
+	free_baselines(d);
+	d->dirty = true;
+}
+
+static void
+write_baselines(const AnomalyDetector *d)
+{
+	char			  tmp_file[PATH_MAX + 32];
+	FILE			 *fp;
+	AnomalyFileHeader hdr;
+	bool			  ok;
+
+	snprintf(tmp_file, sizeof(tmp_file), "%s.tmp.%ld", d->file, (long) getpid());
+
+	fp = fopen(tmp_file, "wb");
+	if (fp == NULL)
+	{
+		log_warning("Cannot write anomaly baselines %s: %s",
+					tmp_file, strerror(errno));
+		return;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, ANOMALY_FILE_MAGIC, sizeof(ANOMALY_FILE_MAGIC));
+	hdr.version = ANOMALY_FILE_VERSION;
+	hdr.baseline_size = sizeof(BaselineRecord);
+	hdr.finding_size = sizeof(AnomalyFinding);
+	hdr.count = (uint32_t) d->count;
+	ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+
+	for (int n = 0; ok && n < d->count; n++)
+	{
+		BaselineRecord rec = d->baselines[n].rec;
+
+		rec.nfindings = (uint32_t) d->baselines[n].finding_count;
+		ok = fwrite(&rec, sizeof(rec), 1, fp) == 1;
+		for (int i = 0; ok && i < d->baselines[n].finding_count; i++)
+			ok = fwrite(&d->baselines[n].findings[i].finding,
+						sizeof(AnomalyFinding), 1, fp) == 1;
+	}
+
+	if (ferror(fp))
+		ok = false;
+	if (fclose(fp) != 0)
+		ok = false;
+	if (!ok || rename(tmp_file, d->file) != 0)
+	{
+		log_warning("Cannot write anomaly baselines %s: %s",
+					d->file, strerror(errno));
+		unlink(tmp_file);
+	}
+}
+
+/* ------------------------------------------------------------------ *
+ * Public interface
+ * ------------------------------------------------------------------ */
+
+AnomalyDetector *
+anomaly_detector_open(const char *backup_dir)
+{
+	const char *cache_dir = validation_get_cache_dir();
+	AnomalyDetector *d;
+
+	d = calloc(1, sizeof(AnomalyDetector));
+	if (d == NULL || !rehash(d, 64))
+	{
+		free(d);
+		return NULL;
+	}
+
+	if (cache_dir != NULL && backup_dir != NULL)
+	{
+		SHA256Ctx	ctx;
+		uint8_t		digest[SHA256_DIGEST_LENGTH];
+		char		hex[SHA256_HEX_LENGTH + 1];
+		char		name[64];
+		SizeMode	size_mode = scan_get_size_mode();
+
+		sha256_init(&ctx);
+		sha256_update(&ctx, backup_dir, strlen(backup_dir));
+		sha256_update(&ctx, &size_mode, sizeof(size_mode));
+		sha256_final(&ctx, digest);
+		sha256_to_hex(digest, hex);
+		snprintf(name, sizeof(name), "anomaly-%.16s.bin", hex);
+		path_join(d->file, sizeof(d->file), cache_dir, name);
+		load_baselines(d);
+	}
+	return d;
+}
+
+void
+anomaly_detector_save(AnomalyDetector *d)
+{
+	if (d == NULL)
+		return;
+
+	/* Drop the findings of backups that were not observed */
+	for (int n = 0; n < d->count; n++)
+	{
+		Baseline *b = &d->baselines[n];
+		int		  kept = 0;
+
+		for (int i = 0; i < b->finding_count; i++)
+		{
+			if (!b->findings[i].seen)
+				continue;
+			b->findings[i].seen = false;
+			b->findings[kept++] = b->findings[i];
+		}
+		if (kept != b->finding_count)
+			d->dirty = true;
+		b->finding_count = kept;
+	}
+
+	if (d->dirty && d->file[0] != '\0')
+		write_baselines(d);
+	d->dirty = false;
+}
+
+void
+anomaly_detector_close(AnomalyDetector *d)
+{
+	if (d == NULL)
+		return;
+	anomaly_detector_save(d);
+	free_baselines(d);
+	free(d->baselines);
+	free(d->slots);
+	free(d);
+}
@@ -86,6 +86,128 @@ parse_int_argument(const char *str, int *result, const char *option_name)
 	return true;
 }
 
+/*
+ * Parse a byte count with an optional K, M, G or T suffix
+ * Returns true on success, false on error
+ */
+bool
+parse_size_argument(const char *str, uint64_t *result, const char *option_name)
+{
+	char              *endptr;
+	unsigned long long val;
+	int                shift = 0;
+
+	errno = 0;
+	val = strtoull(str, &endptr, 10);
+	if (errno != 0 || endptr == str || str[0] == '-')
+	{
+		fprintf(stderr, "Error: Invalid size value for %s: %s\n", option_name, str);
+		return false;
+	}
+
+	switch (*endptr)
+	{
+		case 'k': case 'K': shift = 10; endptr++; break;
+		case 'm': case 'M': shift = 20; endptr++; break;
+		case 'g': case 'G': shift = 30; endptr++; break;
+		case 't': case 'T': shift = 40; endptr++; break;
+		default: break;
+	}
+	if (*endptr != '\0')
+	{
+		fprintf(stderr, "Error: Invalid size value for %s: %s\n", option_name, str);
+		return false;
+	}
+	if (shift > 0 && val > (UINT64_MAX >> shift))
+	{
+		fprintf(stderr, "Error: Value out of range for %s: %s\n", option_name, str);
+		return false;
+	}
+
+	*result = (uint64_t) val << shift;
+	return true;
+}
+
+/*
+ * Parse a positive duration with an optional s, m, h or d suffix
+ * Returns true on success, false on error
+ */
+bool
+parse_duration_argument(const char *str, time_t *result, const char *option_name)
+{
+	char              *endptr;
+	unsigned long long val;
+	unsigned long long unit = 1;
+
+	errno = 0;
+	val = strtoull(str, &endptr, 10);
+	if (errno != 0 || endptr == str || str[0] == '-')
+	{
+		fprintf(stderr, "Error: Invalid duration for %s: %s\n", option_name, str);
+		return false;
+	}
+
+	switch (*endptr)
+	{
+		case 's': endptr++; break;
+		case 'm': unit = 60; endptr++; break;
+		case 'h': unit = 3600; endptr++; break;
+		case 'd': unit = 86400; endptr++; break;
+		default: break;
+	}
+	if (*endptr != '\0' || val == 0)
+	{
+		fprintf(stderr, "Error: Invalid duration for %s: %s\n", option_name, str);
+		return false;
+	}
+	if (val > (unsigned long long) INT32_MAX / unit)
+	{
+		fprintf(stderr, "Error: Value out of range for %s: %s\n", option_name, str);
+		return false;
+	}
+
+	*result = (time_t) (val * unit);
+	return true;
+}
+
+/*
+ * Parse a fraction in (0, 1], as a decimal or a percentage
+ * Returns true on success, false on error
+ */
+bool
+parse_fraction_argument(const char *str, double *result, const char *option_name)
+{
+	char   *endptr;
+	double  val;
+
+	errno = 0;
+	val = strtod(str, &endptr);
+	if (errno != 0 || endptr == str)
+	{
+		fprintf(stderr, "Error: Invalid fraction for %s: %s\n", option_name, str);
+		return false;
+	}
+	if (*endptr == '%')
+	{
+		val /= 100.0;
+		endptr++;
+	}
+	if (*endptr != '\0')
+	{
+		fprintf(stderr, "Error: Invalid fraction for %s: %s\n", option_name, str);
+		return false;
+	}
+	if (!(val > 0.0 && val <= 1.0))
+	{
+		fprintf(stderr, "Error: %s must be greater than 0 and at most 1 (100%%)\n",
+				option_name);
+		return false;
+	}
+
+	*result = val;
+	return true;
+}
+
 /*
  * Validate that a required argument is provided
  * Returns true if valid, false if missing
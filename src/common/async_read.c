@@ -0,0 +1,677 @@
+/*
+ * async_read.c
+ *
+ * io_uring engine for reading many files at once
+ *
+ * Each of ASYNC_READ_DEPTH slots owns one registered buffer and reads
+ * one file at a time, so every file has at most one read outstanding and
+ * its chunks are consumed strictly in order.  The driving thread opens
+ * files into free slots, submits their reads and reaps completions;
+ * filled slots go to a queue that the worker threads drain, and come
+ * back to the driver to read the next chunk.  Up to ASYNC_READ_DEPTH
+ * reads are in flight at any time, which is what keeps a fast device
+ * busy from a single submitting thread.  The buffers are borrowed from
+ * the buffer pool: with a memory limit, fewer slots are used when fewer
+ * buffers are to be had.
+ *
+ * The ring is driven through the raw system calls, so no library is
+ * needed; the kernel header <linux/io_uring.h> is enough to build it.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE				/* syscall(), O_DIRECT */
+
+#include "async_read.h"
+#include "pg_backup_auditor.h"
+#include "metrics.h"
+#include "buffer_pool.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && defined(HAVE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(SYS_io_uring_setup) && defined(SYS_io_uring_enter) && \
+	defined(SYS_io_uring_register)
+#define ASYNC_READ_URING 1
+#endif
+#endif
+
+#ifdef ASYNC_READ_URING
+
+/* ------------------------------------------------------------------ *
+ * Ring
+ * ------------------------------------------------------------------ */
+
+typedef struct {
+	int                  fd;
+	unsigned            *sq_head;
+	unsigned            *sq_tail;
+	unsigned            *sq_array;
+	unsigned             sq_mask;
+	unsigned            *cq_head;
+	unsigned            *cq_tail;
+	unsigned             cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void                *sq_map;
+	size_t               sq_map_len;
+	void                *cq_map;    /* == sq_map with IORING_FEAT_SINGLE_MMAP */
+	size_t               cq_map_len;
+	size_t               sqes_len;
+	unsigned             to_submit;
+	bool                 fixed;     /* buffers are registered */
+} Ring;
+
+static void
+ring_close(Ring *ring)
+{
+	if (ring->sqes != NULL)
+		munmap(ring->sqes, ring->sqes_len);
+	if (ring->cq_map != NULL && ring->cq_map != ring->sq_map)
+		munmap(ring->cq_map, ring->cq_map_len);
+	if (ring->sq_map != NULL)
+		munmap(ring->sq_map, ring->sq_map_len);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	ring->fd = -1;
+}
+
+static bool
+ring_open(Ring *ring, unsigned entries)
+{
+	struct io_uring_params p;
+	uint8_t *sq, *cq;
+
+	memset(ring, 0, sizeof(*ring));
+	memset(&p, 0, sizeof(p));
+	ring->fd = (int) syscall(SYS_io_uring_setup, entries, &p);
+	if (ring->fd < 0)
+		return false;
+
+	ring->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ring->cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (ring->cq_map_len > ring->sq_map_len)
+			ring->sq_map_len = ring->cq_map_len;
+		ring->cq_map_len = ring->sq_map_len;
+	}
+
+	ring->sq_map = mmap(NULL, ring->sq_map_len, PROT_READ | PROT_WRITE,
+						MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_map == MAP_FAILED)
+	{
+		ring->sq_map = NULL;
+		ring_close(ring);
+		return false;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cq_map = ring->sq_map;
+	else
+	{
+		ring->cq_map = mmap(NULL, ring->cq_map_len, PROT_READ | PROT_WRITE,
+							MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+		if (ring->cq_map == MAP_FAILED)
+		{
+			ring->cq_map = NULL;
+			ring_close(ring);
+			return false;
+		}
+	}
+	ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+					  MAP_SHARED, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+	{
+		ring->sqes = NULL;
+		ring_close(ring);
+		return false;
+	}
+
+	sq = ring->sq_map;
+	cq = ring->cq_map;
+	ring->sq_head  = (unsigned *) (sq + p.sq_off.head);
+	ring->sq_tail  = (unsigned *) (sq + p.sq_off.tail);
+	ring->sq_array = (unsigned *) (sq + p.sq_off.array);
+	ring->sq_mask  = *(unsigned *) (sq + p.sq_off.ring_mask);
+	ring->cq_head  = (unsigned *) (cq + p.cq_off.head);
+	ring->cq_tail  = (unsigned *) (cq + p.cq_off.tail);
+	ring->cq_mask  = *(unsigned *) (cq + p.cq_off.ring_mask);
+	ring->cqes     = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+	return true;
+}
+
+/* Queue a read of 'len' bytes at 'offset' into buffer 'index' */
+static void
+ring_queue_read(Ring *ring, int fd, void *buf, unsigned len,
+				uint64_t offset, int index)
+{
+	unsigned             tail = *ring->sq_tail;
+	unsigned             idx = tail & ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = ring->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t) (uintptr_t) buf;
+	sqe->len = len;
+	sqe->off = offset;
+	if (ring->fixed)
+		sqe->buf_index = (uint16_t) index;
+	sqe->user_data = (uint64_t) index;
+	ring->sq_array[idx] = idx;
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ring->to_submit++;
+}
+
+/* Submit queued reads and, if 'wait', block for at least one completion */
+static bool
+ring_enter(Ring *ring, bool wait)
+{
+	for (;;)
+	{
+		long ret = syscall(SYS_io_uring_enter, ring->fd, ring->to_submit,
+						   wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0,
+						   NULL, 0);
+
+		metrics_io(METRIC_IO_SYSCALLS, 1);
+		if (ret >= 0)
+		{
+			ring->to_submit -= (unsigned) ret;
+			if (ring->to_submit == 0 || wait)
+				return true;
+			continue;
+		}
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			return false;
+		if (errno != EINTR)
+			wait = true;        /* let completions drain first */
+	}
+}
+
+/* ------------------------------------------------------------------ *
+ * Engine
+ * ------------------------------------------------------------------ */
+
+typedef enum {
+	SLOT_FREE,
+	SLOT_READING,           /* read submitted */
+	SLOT_FILLED             /* with a worker, or waiting for one */
+} SlotState;
+
+typedef struct {
+	SlotState  state;
+	uint8_t   *buf;
+	int        file;        /* index into the file list */
+	int        fd;
+	off_t      size;        /* at open time */
+	uint64_t   offset;      /* of the data in buf */
+	size_t     len;
+	bool       last;
+	bool       direct;      /* opened with O_DIRECT */
+	off_t      released;    /* see page_cache_consumed() */
+} Slot;
+
+typedef struct {
+	const AsyncReadFile *files;
+	int                  count;
+	AsyncReadDataFn      on_data;
+	AsyncReadDoneFn      on_done;
+	Slot                 slots[ASYNC_READ_DEPTH];
+	int                  depth;     /* slots in use, each with a buffer */
+
+	/* Filled slots for the workers, and slots handed back, under lock */
+	int                  ready[ASYNC_READ_DEPTH];
+	int                  ready_head;
+	int                  nready;
+	int                  back[ASYNC_READ_DEPTH];
+	int                  nback;
+	bool                 stop;
+	pthread_mutex_t      lock;
+	pthread_cond_t       work;
+	pthread_cond_t       returned;
+} Engine;
+
+/* Hand one chunk to the callbacks; finishes the file after its last one */
+static void
+consume_slot(Engine *e, Slot *slot)
+{
+	void *arg = e->files[slot->file].arg;
+
+	if (slot->len > 0)
+		e->on_data(arg, slot->buf, slot->len);
+	if (!slot->direct)
+		page_cache_consumed(slot->fd, &slot->released,
+							(off_t) (slot->offset + slot->len));
+	if (slot->last)
+	{
+		if (!slot->direct)
+			page_cache_end(slot->fd);
+		close(slot->fd);
+		e->on_done(arg, 0);
+	}
+}
+
+static void *
+engine_worker(void *arg)
+{
+	Engine *e = arg;
+
+	pthread_mutex_lock(&e->lock);
+	for (;;)
+	{
+		int i;
+
+		while (e->nready == 0 && !e->stop)
+			pthread_cond_wait(&e->work, &e->lock);
+		if (e->nready == 0)
+			break;
+		i = e->ready[e->ready_head];
+		e->ready_head = (e->ready_head + 1) % ASYNC_READ_DEPTH;
+		e->nready--;
+		pthread_mutex_unlock(&e->lock);
+
+		consume_slot(e, &e->slots[i]);
+
+		pthread_mutex_lock(&e->lock);
+		e->back[e->nback++] = i;
+		pthread_cond_signal(&e->returned);
+	}
+	pthread_mutex_unlock(&e->lock);
+	return NULL;
+}
+
+/* Open the next readable file into a free slot; false when none remain */
+static bool
+slot_open_next(Engine *e, Slot *slot, int *next_file)
+{
+	while (*next_file < e->count)
+	{
+		int         f = (*next_file)++;
+		struct stat st;
+		bool        direct;
+		int         fd = page_cache_open(e->files[f].path, &direct);
+
+		if (fd < 0)
+		{
+			e->on_done(e->files[f].arg, errno);
+			continue;
+		}
+		if (fstat(fd, &st) != 0)
+		{
+			int err = errno;
+
+			close(fd);
+			e->on_done(e->files[f].arg, err);
+			continue;
+		}
+		slot->file = f;
+		slot->fd = fd;
+		slot->size = st.st_size;
+		slot->offset = 0;
+		slot->len = 0;
+		slot->direct = direct;
+		slot->released = 0;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * A read completed with 'res'.  The file is done after a read reaches
+ * the size it had when opened and comes back short, or returns nothing;
+ * a short read before that point is simply followed by another one.
+ */
+static void
+slot_complete(Engine *e, Slot *slot, int res)
+{
+	if (res < 0)
+	{
+		close(slot->fd);
+		e->on_done(e->files[slot->file].arg, -res);
+		slot->state = SLOT_FREE;
+		return;
+	}
+	if (res > 0)
+	{
+		read_limit_charge((size_t) res);
+		metrics_io(METRIC_IO_BYTES_READ, (uint64_t) res);
+	}
+	slot->len = (size_t) res;
+	slot->last = res == 0 ||
+		(res < ASYNC_READ_BUF_SIZE &&
+		 slot->offset + (uint64_t) res >= (uint64_t) slot->size);
+	slot->state = SLOT_FILLED;
+}
+
+/* Close everything still open and fail whatever was not read */
+static void
+engine_abort(Engine *e, int next_file)
+{
+	for (int i = 0; i < e->depth; i++)
+	{
+		if (e->slots[i].state != SLOT_FREE)
+		{
+			close(e->slots[i].fd);
+			e->on_done(e->files[e->slots[i].file].arg, EIO);
+		}
+	}
+	for (int f = next_file; f < e->count; f++)
+		e->on_done(e->files[f].arg, EIO);
+}
+
+static bool
+engine_run(Engine *e, Ring *ring, int workers)
+{
+	int  next_file = 0;
+	int  in_flight = 0;
+	int  filled = 0;            /* slots out with the workers */
+	bool ok = true;
+
+	for (;;)
+	{
+		int back[ASYNC_READ_DEPTH];
+		int nback = 0;
+
+		/* Slots the workers have finished with */
+		if (workers > 0)
+		{
+			pthread_mutex_lock(&e->lock);
+			while (in_flight == 0 && filled > 0 && e->nback == 0)
+				pthread_cond_wait(&e->returned, &e->lock);
+			nback = e->nback;
+			memcpy(back, e->back, sizeof(int) * nback);
+			e->nback = 0;
+			pthread_mutex_unlock(&e->lock);
+		}
+
+		for (int k = 0; k < nback; k++)
+		{
+			Slot *slot = &e->slots[back[k]];
+
+			filled--;
+			if (slot->last)
+				slot->state = SLOT_FREE;
+			else
+			{
+				slot->offset += slot->len;
+				slot->state = SLOT_READING;
+				ring_queue_read(ring, slot->fd, slot->buf, ASYNC_READ_BUF_SIZE,
+								slot->offset, back[k]);
+				in_flight++;
+			}
+		}
+
+		/* Free slots take the next files */
+		for (int i = 0; i < e->depth && next_file < e->count; i++)
+		{
+			Slot *slot = &e->slots[i];
+
+			if (slot->state != SLOT_FREE || !slot_open_next(e, slot, &next_file))
+				continue;
+			slot->state = SLOT_READING;
+			ring_queue_read(ring, slot->fd, slot->buf, ASYNC_READ_BUF_SIZE,
+							0, i);
+			in_flight++;
+		}
+
+		if (in_flight == 0)
+		{
+			if (filled == 0 && next_file >= e->count)
+				break;
+			continue;
+		}
+
+		if (!ring_enter(ring, true))
+		{
+			log_debug("io_uring_enter failed: %s", strerror(errno));
+			ok = false;
+			break;
+		}
+
+		/* Reap completions */
+		{
+			unsigned head = *ring->cq_head;
+			unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+			for (; head != tail; head++)
+			{
+				struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+				int                  i = (int) cqe->user_data;
+				Slot                *slot = &e->slots[i];
+				bool                 retry = cqe->res == -EINTR || cqe->res == -EAGAIN;
+
+				in_flight--;
+				if (cqe->res == -EINVAL && slot->direct)
+				{
+					/* O_DIRECT accepted at open() but not for reads */
+					fcntl(slot->fd, F_SETFL, fcntl(slot->fd, F_GETFL) & ~O_DIRECT);
+					slot->direct = false;
+					page_cache_begin(slot->fd);
+					retry = true;
+				}
+				if (retry)
+				{
+					ring_queue_read(ring, slot->fd, slot->buf,
+									ASYNC_READ_BUF_SIZE, slot->offset, i);
+					in_flight++;
+					continue;
+				}
+				slot_complete(e, slot, cqe->res);
+				if (slot->state != SLOT_FILLED)
+					continue;
+
+				if (workers == 0)
+				{
+					/* Consume here; handled as returned on the next pass */
+					consume_slot(e, slot);
+					if (slot->last)
+						slot->state = SLOT_FREE;
+					else
+					{
+						slot->offset += slot->len;
+						slot->state = SLOT_READING;
+						ring_queue_read(ring, slot->fd, slot->buf,
+										ASYNC_READ_BUF_SIZE, slot->offset, i);
+						in_flight++;
+					}
+					continue;
+				}
+
+				filled++;
+				pthread_mutex_lock(&e->lock);
+				e->ready[(e->ready_head + e->nready) % ASYNC_READ_DEPTH] = i;
+				e->nready++;
+				pthread_cond_signal(&e->work);
+				pthread_mutex_unlock(&e->lock);
+			}
+			__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+		}
+	}
+
+	/* Let the workers drain, then stop them */
+	pthread_mutex_lock(&e->lock);
+	while (filled > 0)
+	{
+		while (e->nback == 0)
+			pthread_cond_wait(&e->returned, &e->lock);
+		for (int k = 0; k < e->nback; k++)
+		{
+			Slot *slot = &e->slots[e->back[k]];
+
+			filled--;
+			if (!ok && slot->last)
+				slot->state = SLOT_FREE;
+			else if (!ok)
+				slot->state = SLOT_READING;     /* closed by engine_abort() */
+		}
+		e->nback = 0;
+	}
+	e->stop = true;
+	pthread_cond_broadcast(&e->work);
+	pthread_mutex_unlock(&e->lock);
+
+	if (!ok)
+		engine_abort(e, next_file);
+	return ok;
+}
+
+static bool uring_usable = false;
+static pthread_once_t uring_probe_once = PTHREAD_ONCE_INIT;
+
+static void
+uring_probe(void)
+{
+	Ring ring;
+
+	if (ring_open(&ring, 1))
+	{
+		uring_usable = true;
+		ring_close(&ring);
+	}
+	else
+		log_debug("io_uring not available (%s); using synchronous reads",
+				  strerror(errno));
+}
+
+bool
+async_read_supported(void)
+{
+	pthread_once(&uring_probe_once, uring_probe);
+	return uring_usable;
+}
+
+bool
+async_read_files(const AsyncReadFile *files, int count, int workers,
+				 AsyncReadDataFn on_data, AsyncReadDoneFn on_done)
+{
+	Engine       *e;
+	Ring          ring;
+	struct iovec  iov[ASYNC_READ_DEPTH];
+	pthread_t    *threads = NULL;
+	int           started = 0;
+	bool          ok = true;
+
+	if (!async_read_supported())
+		return false;
+	if (count <= 0)
+		return true;
+
+	e = calloc(1, sizeof(Engine));
+	if (e == NULL)
+		return false;
+
+	/* One buffer is waited for; the others only taken if the pool has them */
+	for (int i = 0; i < ASYNC_READ_DEPTH && i < count; i++)
+	{
+		void *buf = i == 0 ? buffer_pool_get(ASYNC_READ_BUF_SIZE)
+			: buffer_pool_try_get(ASYNC_READ_BUF_SIZE);
+
+		if (buf == NULL)
+			break;
+		e->slots[i].buf = buf;
+		iov[i].iov_base = buf;
+		iov[i].iov_len = ASYNC_READ_BUF_SIZE;
+		e->depth++;
+	}
+
+	if (e->depth == 0 || !ring_open(&ring, ASYNC_READ_DEPTH))
+	{
+		for (int i = 0; i < e->depth; i++)
+			buffer_pool_put(e->slots[i].buf, ASYNC_READ_BUF_SIZE);
+		free(e);
+		return false;
+	}
+
+	/* Registered buffers save a page walk per read; plain reads also work */
+	ring.fixed = syscall(SYS_io_uring_register, ring.fd,
+						 IORING_REGISTER_BUFFERS, iov, e->depth) == 0;
+
+	e->files = files;
+	e->count = count;
+	e->on_data = on_data;
+	e->on_done = on_done;
+	pthread_mutex_init(&e->lock, NULL);
+	pthread_cond_init(&e->work, NULL);
+	pthread_cond_init(&e->returned, NULL);
+
+	if (workers > 0)
+		threads = malloc(sizeof(pthread_t) * workers);
+	if (threads != NULL)
+	{
+		for (int t = 0; t < workers; t++)
+		{
+			if (pthread_create(&threads[started], NULL, engine_worker, e) != 0)
+				break;
+			started++;
+		}
+	}
+
+	log_debug("Async read: %d file%s, %d buffers of %d KB%s, %d worker(s)",
+			  count, count == 1 ? "" : "s", e->depth,
+			  ASYNC_READ_BUF_SIZE / 1024, ring.fixed ? " (registered)" : "",
+			  started);
+
+	ok = engine_run(e, &ring, started);
+
+	for (int t = 0; t < started; t++)
+		pthread_join(threads[t], NULL);
+	free(threads);
+
+	/* Closing the ring first: no read can still target a buffer */
+	ring_close(&ring);
+	for (int i = 0; i < e->depth; i++)
+		buffer_pool_put(e->slots[i].buf, ASYNC_READ_BUF_SIZE);
+	pthread_cond_destroy(&e->returned);
+	pthread_cond_destroy(&e->work);
+	pthread_mutex_destroy(&e->lock);
+	free(e);
+
+	if (!ok)
+		log_debug("Async read stopped early; unread files reported as I/O errors");
+	return true;
+}
+
+#else /* !ASYNC_READ_URING */
+
+bool
+async_read_supported(void)
+{
+	return false;
+}
+
+bool
+async_read_files(const AsyncReadFile *files, int count, int workers,
+				 AsyncReadDataFn on_data, AsyncReadDoneFn on_done)
+{
+	(void) files;
+	(void) count;
+	(void) workers;
+	(void) on_data;
+	(void) on_done;
+	return false;
+}
+
+#endif /* ASYNC_READ_URING */
@@ -0,0 +1,431 @@
+/*
+ * backup_catalog.c
+ *
+ * Compact in-memory catalog of scanned backups
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "backup_catalog.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* FNV-1a */
+static uint64_t
+fnv1a(const char *str)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (const unsigned char *p = (const unsigned char *) str; *p; p++)
+	{
+		h ^= *p;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/* Smallest power of two holding 'n' entries at load factor <= 1/2 */
+static size_t
+table_capacity(size_t n)
+{
+	size_t capacity = 64;
+
+	while (capacity < n * 2)
+		capacity *= 2;
+	return capacity;
+}
+
+static bool
+arena_append(BackupCatalog *catalog, const char *str, size_t len, CatalogStr *out)
+{
+	if (catalog->strings_len + len + 1 > UINT32_MAX)
+		return false;
+
+	if (catalog->strings_len + len + 1 > catalog->strings_cap)
+	{
+		size_t  cap = catalog->strings_cap;
+		char   *strings;
+
+		while (cap < catalog->strings_len + len + 1)
+			cap *= 2;
+		strings = realloc(catalog->strings, cap);
+		if (strings == NULL)
+			return false;
+		catalog->strings = strings;
+		catalog->strings_cap = cap;
+	}
+
+	memcpy(catalog->strings + catalog->strings_len, str, len + 1);
+	*out = (CatalogStr) catalog->strings_len;
+	catalog->strings_len += len + 1;
+	return true;
+}
+
+static bool
+grow_str_slots(BackupCatalog *catalog)
+{
+	size_t      capacity = catalog->str_capacity * 2;
+	CatalogStr *slots = calloc(capacity, sizeof(CatalogStr));
+
+	if (slots == NULL)
+		return false;
+
+	for (size_t i = 0; i < catalog->str_capacity; i++)
+	{
+		CatalogStr ref = catalog->str_slots[i];
+		size_t     j;
+
+		if (ref == 0)
+			continue;
+		j = (size_t) fnv1a(catalog->strings + ref) & (capacity - 1);
+		while (slots[j] != 0)
+			j = (j + 1) & (capacity - 1);
+		slots[j] = ref;
+	}
+
+	free(catalog->str_slots);
+	catalog->str_slots = slots;
+	catalog->str_capacity = capacity;
+	return true;
+}
+
+/* Reference to the one copy of 'str' in the arena */
+static bool
+intern(BackupCatalog *catalog, const char *str, CatalogStr *out)
+{
+	size_t i;
+
+	if (str[0] == '\0')
+	{
+		*out = 0;
+		return true;
+	}
+
+	if ((catalog->str_count + 1) * 2 > catalog->str_capacity &&
+		!grow_str_slots(catalog))
+		return false;
+
+	i = (size_t) fnv1a(str) & (catalog->str_capacity - 1);
+	while (catalog->str_slots[i] != 0)
+	{
+		if (strcmp(catalog->strings + catalog->str_slots[i], str) == 0)
+		{
+			*out = catalog->str_slots[i];
+			return true;
+		}
+		i = (i + 1) & (catalog->str_capacity - 1);
+	}
+
+	if (!arena_append(catalog, str, strlen(str), out))
+		return false;
+	catalog->str_slots[i] = *out;
+	catalog->str_count++;
+	return true;
+}
+
+static bool
+intern_record(BackupCatalog *catalog, const BackupInfo *b, BackupRecord *rec)
+{
+	char        dir[PATH_MAX];
+	const char *slash;
+
+	str_copy(dir, b->backup_path, sizeof(dir));
+	slash = strrchr(b->backup_path, '/');
+	dir[slash != NULL ? (size_t) (slash - b->backup_path) : 0] = '\0';
+
+	return intern(catalog, b->backup_id, &rec->backup_id) &&
+		intern(catalog, b->node_name, &rec->node_name) &&
+		intern(catalog, b->instance_name, &rec->instance_name) &&
+		intern(catalog, b->tool_version, &rec->tool_version) &&
+		intern(catalog, b->parent_backup_id, &rec->parent_backup_id) &&
+		intern(catalog, b->backup_path, &rec->backup_path) &&
+		intern(catalog, dir, &rec->backup_dir) &&
+		intern(catalog, b->backup_method, &rec->backup_method) &&
+		intern(catalog, b->backup_from, &rec->backup_from) &&
+		intern(catalog, b->backup_label, &rec->backup_label) &&
+		intern(catalog, b->wal_start_file, &rec->wal_start_file) &&
+		intern(catalog, b->compress_alg, &rec->compress_alg) &&
+		intern(catalog, b->wal_mode, &rec->wal_mode);
+}
+
+/*
+ * Because strings are interned, ids are compared by reference; the slot
+ * holds the first record with that id.
+ */
+static int32_t *
+find_id_slot(const BackupCatalog *catalog, CatalogStr id)
+{
+	size_t i = (size_t) fnv1a(catalog->strings + id) & (catalog->id_capacity - 1);
+
+	while (catalog->id_slots[i] >= 0 &&
+		   catalog->records[catalog->id_slots[i]].backup_id != id)
+		i = (i + 1) & (catalog->id_capacity - 1);
+	return &catalog->id_slots[i];
+}
+
+BackupCatalog *
+backup_catalog_build(const BackupInfo *list)
+{
+	BackupCatalog *catalog;
+	int            count = 0;
+	int            i;
+
+	for (const BackupInfo *b = list; b != NULL; b = b->next)
+		count++;
+
+	catalog = calloc(1, sizeof(BackupCatalog));
+	if (catalog == NULL)
+		return NULL;
+
+	catalog->strings_cap = 4096;
+	catalog->strings = malloc(catalog->strings_cap);
+	catalog->str_capacity = table_capacity((size_t) count);
+	catalog->str_slots = calloc(catalog->str_capacity, sizeof(CatalogStr));
+	catalog->id_capacity = table_capacity((size_t) count);
+	catalog->id_slots = malloc(catalog->id_capacity * sizeof(int32_t));
+	catalog->records = calloc(count > 0 ? count : 1, sizeof(BackupRecord));
+	if (catalog->strings == NULL || catalog->str_slots == NULL ||
+		catalog->id_slots == NULL || catalog->records == NULL)
+	{
+		backup_catalog_free(catalog);
+		return NULL;
+	}
+
+	/* Offset 0 is the empty string */
+	catalog->strings[0] = '\0';
+	catalog->strings_len = 1;
+	memset(catalog->id_slots, 0xFF, catalog->id_capacity * sizeof(int32_t));
+
+	i = 0;
+	for (const BackupInfo *b = list; b != NULL; b = b->next, i++)
+	{
+		BackupRecord *rec = &catalog->records[i];
+		int32_t      *slot;
+
+		if (!intern_record(catalog, b, rec))
+		{
+			backup_catalog_free(catalog);
+			return NULL;
+		}
+		rec->type       = b->type;
+		rec->tool       = b->tool;
+		rec->status     = b->status;
+		rec->timeline   = b->timeline;
+		rec->pg_version = b->pg_version;
+		rec->wal_stream = b->wal_stream;
+		rec->partial    = b->partial;
+		rec->start_time = b->start_time;
+		rec->end_time   = b->end_time;
+		rec->start_lsn  = b->start_lsn;
+		rec->stop_lsn   = b->stop_lsn;
+		rec->redo_lsn   = b->redo_lsn;
+		rec->data_bytes = b->data_bytes;
+		rec->wal_bytes  = b->wal_bytes;
+		catalog->count = i + 1;
+
+		slot = find_id_slot(catalog, rec->backup_id);
+		if (*slot < 0)
+			*slot = i;
+	}
+
+	/* Resolve parents once all ids are known */
+	for (i = 0; i < catalog->count; i++)
+	{
+		BackupRecord *rec = &catalog->records[i];
+
+		rec->parent = rec->parent_backup_id != 0
+			? *find_id_slot(catalog, rec->parent_backup_id) : -1;
+	}
+
+	return catalog;
+}
+
+void
+backup_catalog_free(BackupCatalog *catalog)
+{
+	if (catalog == NULL)
+		return;
+	free(catalog->records);
+	free(catalog->strings);
+	free(catalog->str_slots);
+	free(catalog->id_slots);
+	free(catalog);
+}
+
+const char *
+backup_catalog_str(const BackupCatalog *catalog, CatalogStr ref)
+{
+	return catalog->strings + ref;
+}
+
+int
+backup_catalog_find(const BackupCatalog *catalog, const char *backup_id)
+{
+	size_t i;
+
+	if (backup_id == NULL || backup_id[0] == '\0')
+		return -1;
+
+	i = (size_t) fnv1a(backup_id) & (catalog->id_capacity - 1);
+	while (catalog->id_slots[i] >= 0)
+	{
+		const BackupRecord *rec = &catalog->records[catalog->id_slots[i]];
+
+		if (strcmp(catalog->strings + rec->backup_id, backup_id) == 0)
+			return catalog->id_slots[i];
+		i = (i + 1) & (catalog->id_capacity - 1);
+	}
+	return -1;
+}
+
+int
+backup_catalog_find_root(const BackupCatalog *catalog, int index)
+{
+	/* Bounded by the catalog size, so a parent cycle cannot loop */
+	for (int depth = 0; index >= 0 && depth <= catalog->count; depth++)
+	{
+		const BackupRecord *rec = &catalog->records[index];
+
+		if (rec->type == BACKUP_TYPE_FULL)
+			return index;
+		index = rec->parent;
+	}
+	return -1;
+}
+
+void
+backup_catalog_get(const BackupCatalog *catalog, int index, BackupInfo *out)
+{
+	const BackupRecord *rec = &catalog->records[index];
+
+	memset(out, 0, sizeof(*out));
+	str_copy(out->backup_id, backup_catalog_str(catalog, rec->backup_id),
+			 sizeof(out->backup_id));
+	str_copy(out->node_name, backup_catalog_str(catalog, rec->node_name),
+			 sizeof(out->node_name));
+	str_copy(out->instance_name, backup_catalog_str(catalog, rec->instance_name),
+			 sizeof(out->instance_name));
+	str_copy(out->tool_version, backup_catalog_str(catalog, rec->tool_version),
+			 sizeof(out->tool_version));
+	str_copy(out->parent_backup_id, backup_catalog_str(catalog, rec->parent_backup_id),
+			 sizeof(out->parent_backup_id));
+	str_copy(out->backup_path, backup_catalog_str(catalog, rec->backup_path),
+			 sizeof(out->backup_path));
+	str_copy(out->backup_method, backup_catalog_str(catalog, rec->backup_method),
+			 sizeof(out->backup_method));
+	str_copy(out->backup_from, backup_catalog_str(catalog, rec->backup_from),
+			 sizeof(out->backup_from));
+	str_copy(out->backup_label, backup_catalog_str(catalog, rec->backup_label),
+			 sizeof(out->backup_label));
+	str_copy(out->wal_start_file, backup_catalog_str(catalog, rec->wal_start_file),
+			 sizeof(out->wal_start_file));
+	str_copy(out->compress_alg, backup_catalog_str(catalog, rec->compress_alg),
+			 sizeof(out->compress_alg));
+	str_copy(out->wal_mode, backup_catalog_str(catalog, rec->wal_mode),
+			 sizeof(out->wal_mode));
+	out->type       = rec->type;
+	out->tool       = rec->tool;
+	out->status     = rec->status;
+	out->timeline   = rec->timeline;
+	out->pg_version = rec->pg_version;
+	out->wal_stream = rec->wal_stream;
+	out->partial    = rec->partial;
+	out->start_time = rec->start_time;
+	out->end_time   = rec->end_time;
+	out->start_lsn  = rec->start_lsn;
+	out->stop_lsn   = rec->stop_lsn;
+	out->redo_lsn   = rec->redo_lsn;
+	out->data_bytes = rec->data_bytes;
+	out->wal_bytes  = rec->wal_bytes;
+}
+
+int
+backup_catalog_compare(const BackupCatalog *catalog, int a, int b,
+					   CatalogOrder order)
+{
+	const BackupRecord *ra = &catalog->records[a];
+	const BackupRecord *rb = &catalog->records[b];
+
+	switch (order)
+	{
+		case CATALOG_ORDER_END_TIME:
+			if ((ra->end_time == 0) != (rb->end_time == 0))
+				return ra->end_time == 0 ? 1 : -1;
+			return (ra->end_time > rb->end_time) - (ra->end_time < rb->end_time);
+		case CATALOG_ORDER_NAME:
+			return strcmp(catalog->strings + ra->backup_id,
+						  catalog->strings + rb->backup_id);
+		case CATALOG_ORDER_SIZE:
+			return (ra->data_bytes > rb->data_bytes) - (ra->data_bytes < rb->data_bytes);
+		case CATALOG_ORDER_START_LSN:
+			return (ra->start_lsn > rb->start_lsn) - (ra->start_lsn < rb->start_lsn);
+		case CATALOG_ORDER_START_TIME:
+		default:
+			return (ra->start_time > rb->start_time) - (ra->start_time < rb->start_time);
+	}
+}
+
+/* Merge sort: qsort is not stable and has no context argument */
+void
+backup_catalog_sort(const BackupCatalog *catalog, int *indices, int n,
+					CatalogOrder order)
+{
+	int *tmp;
+
+	if (n < 2)
+		return;
+
+	tmp = malloc((size_t) n * sizeof(int));
+	if (tmp == NULL)
+	{
+		/* Insertion sort needs no buffer */
+		for (int i = 1; i < n; i++)
+		{
+			int v = indices[i];
+			int j = i;
+
+			while (j > 0 && backup_catalog_compare(catalog, indices[j - 1], v, order) > 0)
+			{
+				indices[j] = indices[j - 1];
+				j--;
+			}
+			indices[j] = v;
+		}
+		return;
+	}
+
+	/* Bottom-up: merge runs of 'width' from indices into tmp and back */
+	for (int width = 1; width < n; width *= 2)
+	{
+		for (int lo = 0; lo < n; lo += 2 * width)
+		{
+			int mid = lo + width < n ? lo + width : n;
+			int hi = lo + 2 * width < n ? lo + 2 * width : n;
+			int i = lo, j = mid, k = lo;
+
+			while (i < mid && j < hi)
+				tmp[k++] = backup_catalog_compare(catalog, indices[j], indices[i], order) < 0
+					? indices[j++] : indices[i++];
+			while (i < mid)
+				tmp[k++] = indices[i++];
+			while (j < hi)
+				tmp[k++] = indices[j++];
+		}
+		memcpy(indices, tmp, (size_t) n * sizeof(int));
+	}
+
+	free(tmp);
+}
@@ -20,6 +20,7 @@
  */
 
 #include "backup_chain.h"
+#include "backup_catalog.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -73,61 +74,78 @@ backup_chain_append(BackupChain *chain, BackupInfo *backup)
 	return true;
 }
 
+/*
+ * Group backups into one chain per FULL plus a trailing bucket of backups
+ * without a FULL ancestor.  Parent links are resolved once through the
+ * id hash of a BackupCatalog, whose records are in list order, so this
+ * is linear in the number of backups (plus the per-chain sorts).
+ */
 BackupChain *
 backup_chain_build(BackupInfo *all_backups, int *nchains)
 {
+	int count = 0;
 	int full_count = 0;
 	for (BackupInfo *b = all_backups; b != NULL; b = b->next)
+	{
+		count++;
 		if (b->type == BACKUP_TYPE_FULL)
 			full_count++;
+	}
 
-	BackupChain *chains = calloc(full_count + 1, sizeof(BackupChain));
-	if (chains == NULL)
+	BackupChain   *chains  = calloc(full_count + 1, sizeof(BackupChain));
+	BackupInfo   **nodes   = malloc((count + 1) * sizeof(BackupInfo *));
+	int           *chain_of = malloc((count + 1) * sizeof(int));
+	BackupCatalog *catalog = backup_catalog_build(all_backups);
+	if (chains == NULL || nodes == NULL || chain_of == NULL || catalog == NULL)
+	{
+		free(chains);
+		free(nodes);
+		free(chain_of);
+		backup_catalog_free(catalog);
 		return NULL;
+	}
+
+	int i = 0;
+	for (BackupInfo *b = all_backups; b != NULL; b = b->next)
+		nodes[i++] = b;
 
 	int ci = 0;
 
 	/* One chain per FULL */
-	for (BackupInfo *b = all_backups; b != NULL; b = b->next)
+	for (i = 0; i < count; i++)
 	{
-		if (b->type != BACKUP_TYPE_FULL)
+		chain_of[i] = -1;
+		if (nodes[i]->type != BACKUP_TYPE_FULL)
 			continue;
-		chains[ci].root = b;
-		backup_chain_append(&chains[ci], b);
-		ci++;
+		chains[ci].root = nodes[i];
+		backup_chain_append(&chains[ci], nodes[i]);
+		chain_of[i] = ci++;
 	}
 
 	/* Assign non-FULL backups to their chain or the orphaned bucket */
 	int orphan = full_count;
-	for (BackupInfo *b = all_backups; b != NULL; b = b->next)
+	for (i = 0; i < count; i++)
 	{
-		if (b->type == BACKUP_TYPE_FULL)
+		if (nodes[i]->type == BACKUP_TYPE_FULL)
 			continue;
 
-		BackupInfo *root   = backup_chain_find_root(b, all_backups);
-		int         target = orphan;
-
-		if (root != NULL)
-		{
-			for (int i = 0; i < full_count; i++)
-			{
-				if (chains[i].root == root)
-				{
-					target = i;
-					break;
-				}
-			}
-		}
-		backup_chain_append(&chains[target], b);
+		int root   = backup_catalog_find_root(catalog, i);
+		int target = (root >= 0) ? chain_of[root] : orphan;
+
+		backup_chain_append(&chains[target], nodes[i]);
 	}
 
+	backup_catalog_free(catalog);
+	free(chain_of);
+	free(nodes);
+
 	/* Include orphaned bucket only if non-empty */
 	int total = full_count;
 	if (chains[orphan].count > 0)
 		total++;
 
 	/* Sort members within each chain by start_time */
-	for (int i = 0; i < total; i++)
+	for (i = 0; i < total; i++)
 	{
 		if (chains[i].count > 1)
 			qsort(chains[i].members, chains[i].count,
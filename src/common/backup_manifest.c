@@ -0,0 +1,338 @@
+/*
+ * backup_manifest.c
+ *
+ * Single-pass backup_manifest tokenizer
+ *
+ * The manifest is a single JSON object; the members this module cares
+ * about are the "Files" and "WAL-Ranges" arrays of flat objects and the
+ * trailing "Manifest-Checksum" string.  The tokenizer walks the bytes
+ * once, keeping only a cursor and the section it is in; entries are read
+ * with the shared JSON scanner (json_scan.h), so their fields come back
+ * as slices of the input and unknown members are skipped structurally.
+ *
+ * Manifest-Checksum is the SHA-256 of every byte before the line that
+ * holds the key.  Those bytes are fed to the hash as entries are handed
+ * out, while they are still in cache, instead of being read again.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "backup_manifest.h"
+#include "json_scan.h"
+#include "pg_backup_auditor.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Where the cursor is in the manifest's structure */
+enum {
+	MANIFEST_START,             /* before the opening brace */
+	MANIFEST_TOP,               /* among the top-level members */
+	MANIFEST_FILES,             /* inside "Files": [ */
+	MANIFEST_WAL_RANGES,        /* inside "WAL-Ranges": [ */
+	MANIFEST_END,
+	MANIFEST_ERROR
+};
+
+/* Fields picked out of entry objects */
+enum {
+	FIELD_PATH,
+	FIELD_SIZE,
+	FIELD_ALGORITHM,
+	FIELD_CHECKSUM,
+	FIELD_TIMELINE,
+	FIELD_START_LSN,
+	FIELD_END_LSN,
+	FIELD_COUNT
+};
+
+static const char *const field_names[FIELD_COUNT] = {
+	"Path", "Size", "Checksum-Algorithm", "Checksum",
+	"Timeline", "Start-LSN", "End-LSN"
+};
+
+static void
+reader_reset(ManifestReader *r, const char *data, size_t size, bool hash)
+{
+	memset(r, 0, sizeof(*r));
+	r->data = data;
+	r->size = size;
+	r->state = MANIFEST_START;
+	r->hash = hash;
+	if (hash)
+		sha256_init(&r->ctx);
+}
+
+bool
+manifest_reader_open(ManifestReader *r, const char *path, bool hash)
+{
+	struct stat st;
+	void       *map;
+	int         fd;
+
+	fd = open(path, O_RDONLY);
+	metrics_io(METRIC_IO_SYSCALLS, 1);
+	if (fd < 0)
+		return false;
+	metrics_io(METRIC_IO_FILES_OPENED, 1);
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	/* mmap() of an empty file fails; there is nothing to map anyway */
+	if (st.st_size == 0)
+	{
+		close(fd);
+		reader_reset(r, "", 0, hash);
+		return true;
+	}
+
+	map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	metrics_io(METRIC_IO_SYSCALLS, 1);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		log_debug("Cannot map %s", path);
+		return false;
+	}
+	posix_madvise(map, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+	metrics_io(METRIC_IO_BYTES_READ, (uint64_t) st.st_size);
+
+	reader_reset(r, map, (size_t) st.st_size, hash);
+	r->mapped = true;
+	return true;
+}
+
+void
+manifest_reader_init(ManifestReader *r, const char *data, size_t size, bool hash)
+{
+	reader_reset(r, data, size, hash);
+}
+
+void
+manifest_reader_close(ManifestReader *r)
+{
+	if (r->mapped)
+		munmap((void *) r->data, r->size);
+	r->data = NULL;
+	r->size = 0;
+	r->mapped = false;
+}
+
+/* ------------------------------------------------------------------ *
+ * Tokenizing
+ * ------------------------------------------------------------------ */
+
+static JsonCursor
+cursor(const ManifestReader *r)
+{
+	JsonCursor c = { r->data + r->pos, r->data + r->size };
+
+	return c;
+}
+
+static bool
+slice_to_lsn(JsonSlice s, XLogRecPtr *out)
+{
+	char buf[32];
+
+	if (s.ptr == NULL || s.len == 0 || s.len >= sizeof(buf))
+		return false;
+	memcpy(buf, s.ptr, s.len);
+	buf[s.len] = '\0';
+	return parse_lsn(buf, out);
+}
+
+/* Feed the hash everything up to 'upto' */
+static void
+hash_upto(ManifestReader *r, size_t upto)
+{
+	if (r->hash && upto > r->hashed)
+	{
+		sha256_update(&r->ctx, r->data + r->hashed, upto - r->hashed);
+		r->hashed = upto;
+	}
+}
+
+/* The "Manifest-Checksum" member, with the cursor on its value */
+static bool
+read_manifest_checksum(ManifestReader *r, size_t key_start)
+{
+	size_t     line = key_start;
+	JsonSlice  value;
+	JsonCursor c = cursor(r);
+	uint8_t    digest[SHA256_DIGEST_LENGTH];
+
+	while (line > 0 && r->data[line - 1] != '\n')
+		line--;
+
+	if (json_peek(&c) != '"' || !json_scan_string(&c, &value))
+		return false;
+	r->pos = (size_t) (c.p - r->data);
+
+	r->checksum_offset = line;
+	r->stored_checksum = value;
+	r->has_checksum = true;
+	if (r->hash)
+	{
+		hash_upto(r, line);
+		sha256_final(&r->ctx, digest);
+		sha256_to_hex(digest, r->computed_checksum);
+		r->hash = false;
+	}
+	return true;
+}
+
+/* A top-level member; the cursor is on its key */
+static bool
+read_top_member(ManifestReader *r)
+{
+	size_t     key_start = r->pos;
+	JsonCursor c = cursor(r);
+	JsonSlice  key;
+	bool       ok;
+
+	if (!json_scan_string(&c, &key))
+		return false;
+	json_skip_ws(&c);
+	if (json_peek(&c) != ':')
+		return false;
+	c.p++;
+	json_skip_ws(&c);
+	r->pos = (size_t) (c.p - r->data);
+
+	if (json_peek(&c) == '[' && json_slice_eq(key, "Files"))
+	{
+		r->pos++;
+		r->state = MANIFEST_FILES;
+		return true;
+	}
+	if (json_peek(&c) == '[' && json_slice_eq(key, "WAL-Ranges"))
+	{
+		r->pos++;
+		r->state = MANIFEST_WAL_RANGES;
+		return true;
+	}
+	if (json_slice_eq(key, "Manifest-Checksum"))
+		return read_manifest_checksum(r, key_start);
+
+	ok = json_skip_value(&c, NULL);
+	r->pos = (size_t) (c.p - r->data);
+	return ok;
+}
+
+int
+manifest_reader_next(ManifestReader *r, ManifestFileEntry *entry)
+{
+	JsonSlice fields[FIELD_COUNT];
+
+	while (r->state != MANIFEST_END)
+	{
+		JsonCursor c;
+		char       ch;
+		bool       ok;
+
+		if (r->state == MANIFEST_ERROR)
+			return -1;
+
+		c = cursor(r);
+		json_skip_ws(&c);
+		r->pos = (size_t) (c.p - r->data);
+		ch = json_peek(&c);
+
+		switch (r->state)
+		{
+			case MANIFEST_START:
+				if (ch != '{')
+					goto malformed;
+				r->pos++;
+				r->state = MANIFEST_TOP;
+				break;
+
+			case MANIFEST_TOP:
+				if (ch == '}')
+				{
+					r->pos++;
+					r->state = MANIFEST_END;
+				}
+				else if (ch == ',')
+					r->pos++;
+				else if (ch != '"' || !read_top_member(r))
+					goto malformed;
+				break;
+
+			case MANIFEST_FILES:
+			case MANIFEST_WAL_RANGES:
+				if (ch == ']')
+				{
+					r->pos++;
+					r->state = MANIFEST_TOP;
+					break;
+				}
+				if (ch == ',')
+				{
+					r->pos++;
+					break;
+				}
+				ok = ch == '{' &&
+					json_scan_object(&c, field_names, FIELD_COUNT, fields);
+				r->pos = (size_t) (c.p - r->data);
+				if (!ok)
+					goto malformed;
+
+				if (r->state == MANIFEST_WAL_RANGES)
+				{
+					if (!r->has_wal_range)
+					{
+						uint64_t tli = 0;
+
+						r->has_wal_range = true;
+						if (json_slice_to_uint64(fields[FIELD_TIMELINE], &tli))
+							r->timeline = (TimeLineID) tli;
+						slice_to_lsn(fields[FIELD_START_LSN], &r->start_lsn);
+						slice_to_lsn(fields[FIELD_END_LSN], &r->end_lsn);
+					}
+					break;
+				}
+
+				/* Entries without a (plain) Path are not reported */
+				if (fields[FIELD_PATH].ptr == NULL)
+					break;
+				entry->path = fields[FIELD_PATH];
+				entry->algorithm = fields[FIELD_ALGORITHM];
+				entry->checksum = fields[FIELD_CHECKSUM];
+				entry->has_size = json_slice_to_uint64(fields[FIELD_SIZE], &entry->size);
+				if (!entry->has_size)
+					entry->size = 0;
+				hash_upto(r, r->pos);
+				return 1;
+		}
+	}
+	return 0;
+
+malformed:
+	r->state = MANIFEST_ERROR;
+	return -1;
+}
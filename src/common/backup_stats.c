@@ -0,0 +1,455 @@
+/*
+ * backup_stats.c
+ *
+ * Single-pass statistics over a backup list
+ *
+ * Groups and instances live in arrays that grow as new keys turn up;
+ * open-addressing tables of array indices find a backup's accumulators
+ * in constant time.  Once the list is consumed both arrays are sorted
+ * for reporting and the tables rebuilt over the sorted order.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "backup_stats.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Durations from this long are taken as broken timestamps */
+#define MAX_PLAUSIBLE_DURATION  (48 * 3600)
+
+void
+stat_accum_add(StatAccum *acc, double value)
+{
+	double delta;
+
+	if (acc->count == 0 || value < acc->min)
+		acc->min = value;
+	if (acc->count == 0 || value > acc->max)
+		acc->max = value;
+	acc->count++;
+	acc->sum += value;
+
+	delta = value - acc->mean;
+	acc->mean += delta / (double) acc->count;
+	acc->m2 += delta * (value - acc->mean);
+}
+
+double
+stat_accum_variance(const StatAccum *acc)
+{
+	return acc->count >= 2 ? acc->m2 / (double) (acc->count - 1) : 0.0;
+}
+
+double
+stat_accum_stddev(const StatAccum *acc)
+{
+	return sqrt(stat_accum_variance(acc));
+}
+
+bool
+backup_stats_is_baseline(const BackupInfo *b)
+{
+	return (b->status == BACKUP_STATUS_OK || b->status == BACKUP_STATUS_WARNING) &&
+		b->data_bytes > 0 && b->start_time > 0 && b->end_time > b->start_time;
+}
+
+/* ------------------------------------------------------------------ *
+ * Hash tables of array indices
+ * ------------------------------------------------------------------ */
+
+/* FNV-1a of the instance name, mixed with the tool and type */
+static size_t
+key_hash(BackupTool tool, int type, const char *instance_name)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	h = (h ^ (uint64_t) tool) * 0x100000001b3ULL;
+	h = (h ^ (uint64_t) (type + 1)) * 0x100000001b3ULL;
+	for (const unsigned char *p = (const unsigned char *) instance_name; *p; p++)
+		h = (h ^ *p) * 0x100000001b3ULL;
+	return (size_t) (h ^ (h >> 29));
+}
+
+static size_t
+group_hash(const void *p)
+{
+	const BackupStatGroup *g = p;
+
+	return key_hash(g->tool, (int) g->type, g->instance_name);
+}
+
+static size_t
+instance_hash(const void *p)
+{
+	const BackupStatInstance *in = p;
+
+	return key_hash(in->tool, -1, in->instance_name);
+}
+
+/* Fill 'capacity' slots with the first 'count' entries */
+static int32_t *
+slots_build(size_t capacity, int count, const void *array, size_t elem_size,
+			size_t (*hash)(const void *))
+{
+	int32_t *slots = malloc(capacity * sizeof(int32_t));
+
+	if (slots == NULL)
+		return NULL;
+	for (size_t i = 0; i < capacity; i++)
+		slots[i] = -1;
+	for (int n = 0; n < count; n++)
+	{
+		size_t i = hash((const char *) array + (size_t) n * elem_size) & (capacity - 1);
+
+		while (slots[i] >= 0)
+			i = (i + 1) & (capacity - 1);
+		slots[i] = n;
+	}
+	return slots;
+}
+
+static bool
+rehash_groups(BackupStats *stats, size_t capacity)
+{
+	int32_t *slots = slots_build(capacity, stats->group_count, stats->groups,
+								 sizeof(BackupStatGroup), group_hash);
+
+	if (slots == NULL)
+		return false;
+	free(stats->group_slots);
+	stats->group_slots = slots;
+	stats->group_capacity = capacity;
+	return true;
+}
+
+static bool
+rehash_instances(BackupStats *stats, size_t capacity)
+{
+	int32_t *slots = slots_build(capacity, stats->instance_count, stats->instances,
+								 sizeof(BackupStatInstance), instance_hash);
+
+	if (slots == NULL)
+		return false;
+	free(stats->instance_slots);
+	stats->instance_slots = slots;
+	stats->instance_capacity = capacity;
+	return true;
+}
+
+/* Slot holding the group of the key, or the empty slot where it goes */
+static int32_t *
+find_group_slot(const BackupStats *stats, BackupTool tool, const char *instance_name,
+				BackupType type)
+{
+	size_t i = key_hash(tool, (int) type, instance_name) & (stats->group_capacity - 1);
+
+	for (;;)
+	{
+		int32_t n = stats->group_slots[i];
+
+		if (n < 0 ||
+			(stats->groups[n].tool == tool && stats->groups[n].type == type &&
+			 strcmp(stats->groups[n].instance_name, instance_name) == 0))
+			return &stats->group_slots[i];
+		i = (i + 1) & (stats->group_capacity - 1);
+	}
+}
+
+static int32_t *
+find_instance_slot(const BackupStats *stats, BackupTool tool, const char *instance_name)
+{
+	size_t i = key_hash(tool, -1, instance_name) & (stats->instance_capacity - 1);
+
+	for (;;)
+	{
+		int32_t n = stats->instance_slots[i];
+
+		if (n < 0 ||
+			(stats->instances[n].tool == tool &&
+			 strcmp(stats->instances[n].instance_name, instance_name) == 0))
+			return &stats->instance_slots[i];
+		i = (i + 1) & (stats->instance_capacity - 1);
+	}
+}
+
+/* Grow 'array' of '*capacity' elements to hold one more */
+static bool
+reserve(void **array, int count, int *capacity, size_t elem_size)
+{
+	void *grown;
+	int   cap;
+
+	if (count < *capacity)
+		return true;
+	cap = *capacity > 0 ? *capacity * 2 : 16;
+	grown = realloc(*array, (size_t) cap * elem_size);
+	if (grown == NULL)
+		return false;
+	*array = grown;
+	*capacity = cap;
+	return true;
+}
+
+static BackupStatGroup *
+get_group(BackupStats *stats, int *capacity, BackupTool tool,
+		  const char *instance_name, BackupType type)
+{
+	int32_t         *slot;
+	BackupStatGroup *g;
+
+	slot = find_group_slot(stats, tool, instance_name, type);
+	if (*slot >= 0)
+		return &stats->groups[*slot];
+
+	if (!reserve((void **) &stats->groups, stats->group_count, capacity,
+				 sizeof(BackupStatGroup)))
+		return NULL;
+	g = &stats->groups[stats->group_count];
+	memset(g, 0, sizeof(*g));
+	g->tool = tool;
+	g->type = type;
+	str_copy(g->instance_name, instance_name, sizeof(g->instance_name));
+	*slot = stats->group_count++;
+
+	/* Keep the load factor at or below 1/2 */
+	if ((size_t) stats->group_count * 2 > stats->group_capacity &&
+		!rehash_groups(stats, stats->group_capacity * 2))
+		return NULL;
+	return g;
+}
+
+static BackupStatInstance *
+get_instance(BackupStats *stats, int *capacity, BackupTool tool,
+			 const char *instance_name)
+{
+	int32_t            *slot;
+	BackupStatInstance *in;
+
+	slot = find_instance_slot(stats, tool, instance_name);
+	if (*slot >= 0)
+		return &stats->instances[*slot];
+
+	if (!reserve((void **) &stats->instances, stats->instance_count, capacity,
+				 sizeof(BackupStatInstance)))
+		return NULL;
+	in = &stats->instances[stats->instance_count];
+	memset(in, 0, sizeof(*in));
+	in->tool = tool;
+	str_copy(in->instance_name, instance_name, sizeof(in->instance_name));
+	*slot = stats->instance_count++;
+
+	if ((size_t) stats->instance_count * 2 > stats->instance_capacity &&
+		!rehash_instances(stats, stats->instance_capacity * 2))
+		return NULL;
+	return in;
+}
+
+/* ------------------------------------------------------------------ *
+ * Accumulation
+ * ------------------------------------------------------------------ */
+
+static void
+widen_range(time_t *min_time, time_t *max_time, time_t t)
+{
+	if (t <= 0)
+		return;
+	if (*min_time == 0 || t < *min_time)
+		*min_time = t;
+	if (t > *max_time)
+		*max_time = t;
+}
+
+static void
+add_to_group(BackupStatGroup *g, const BackupInfo *b)
+{
+	uint64_t size = b->data_bytes + b->wal_bytes;
+
+	g->count++;
+	g->total_bytes += size;
+	g->total_wal_bytes += b->wal_bytes;
+	if (b->status == BACKUP_STATUS_OK)
+		g->ok_count++;
+	widen_range(&g->min_time, &g->max_time, b->start_time);
+
+	if (b->end_time > b->start_time &&
+		b->end_time - b->start_time < MAX_PLAUSIBLE_DURATION)
+		stat_accum_add(&g->duration, (double) (b->end_time - b->start_time));
+
+	if (backup_stats_is_baseline(b))
+	{
+		stat_accum_add(&g->baseline_size, (double) size);
+		stat_accum_add(&g->baseline_duration, (double) (b->end_time - b->start_time));
+	}
+}
+
+static void
+add_to_instance(BackupStatInstance *in, const BackupInfo *b)
+{
+	in->count++;
+	if (b->wal_bytes > 0)
+	{
+		in->wal_bytes += b->wal_bytes;
+		widen_range(&in->wal_min_time, &in->wal_max_time, b->start_time);
+	}
+
+	/* Sizes of FULL backups over time: healthy ones with real numbers */
+	if (b->type == BACKUP_TYPE_FULL &&
+		(b->status == BACKUP_STATUS_OK || b->status == BACKUP_STATUS_WARNING) &&
+		b->data_bytes > 0 && b->start_time > 0)
+	{
+		BackupStatFull full = { b->start_time, b->data_bytes };
+
+		if (in->full_bytes.count == 0 || full.start_time < in->first_full.start_time)
+			in->first_full = full;
+		if (in->full_bytes.count == 0 || full.start_time >= in->last_full.start_time)
+			in->last_full = full;
+		stat_accum_add(&in->full_bytes, (double) b->data_bytes);
+	}
+}
+
+/* ------------------------------------------------------------------ *
+ * Building and lookup
+ * ------------------------------------------------------------------ */
+
+static int
+compare_groups(const void *a, const void *b)
+{
+	const BackupStatGroup *ga = a;
+	const BackupStatGroup *gb = b;
+	int                    c;
+
+	if (ga->tool != gb->tool)
+		return (int) ga->tool - (int) gb->tool;
+	c = strcmp(ga->instance_name, gb->instance_name);
+	if (c != 0)
+		return c;
+	return (int) ga->type - (int) gb->type;
+}
+
+static int
+compare_instances(const void *a, const void *b)
+{
+	const BackupStatInstance *ia = a;
+	const BackupStatInstance *ib = b;
+
+	if (ia->tool != ib->tool)
+		return (int) ia->tool - (int) ib->tool;
+	return strcmp(ia->instance_name, ib->instance_name);
+}
+
+BackupStats *
+backup_stats_build(const BackupInfo *list, BackupStatsGrouping grouping)
+{
+	BackupStats *stats = calloc(1, sizeof(BackupStats));
+	int          group_cap = 0;
+	int          instance_cap = 0;
+
+	if (stats == NULL)
+		return NULL;
+	stats->grouping = grouping;
+	if (!rehash_groups(stats, 64) || !rehash_instances(stats, 64))
+	{
+		backup_stats_free(stats);
+		return NULL;
+	}
+
+	for (const BackupInfo *b = list; b != NULL; b = b->next)
+	{
+		const char         *group_instance =
+			grouping == BACKUP_STATS_BY_TOOL ? "" : b->instance_name;
+		BackupStatGroup    *g;
+		BackupStatInstance *in;
+
+		g = get_group(stats, &group_cap, b->tool, group_instance, b->type);
+		in = g != NULL ? get_instance(stats, &instance_cap, b->tool, b->instance_name)
+			: NULL;
+		if (in == NULL)
+		{
+			backup_stats_free(stats);
+			return NULL;
+		}
+		add_to_group(g, b);
+		add_to_instance(in, b);
+
+		stats->backup_count++;
+		stats->total_bytes += b->data_bytes + b->wal_bytes;
+		if ((int) b->status >= 0 && (int) b->status < BACKUP_STATS_STATUSES)
+		{
+			stats->status_count[b->status]++;
+			stats->status_bytes[b->status] += b->data_bytes + b->wal_bytes;
+		}
+	}
+
+	if (stats->group_count > 1)
+		qsort(stats->groups, (size_t) stats->group_count, sizeof(BackupStatGroup),
+			  compare_groups);
+	if (stats->instance_count > 1)
+		qsort(stats->instances, (size_t) stats->instance_count,
+			  sizeof(BackupStatInstance), compare_instances);
+	if (!rehash_groups(stats, stats->group_capacity) ||
+		!rehash_instances(stats, stats->instance_capacity))
+	{
+		backup_stats_free(stats);
+		return NULL;
+	}
+	return stats;
+}
+
+void
+backup_stats_free(BackupStats *stats)
+{
+	if (stats == NULL)
+		return;
+	free(stats->groups);
+	free(stats->instances);
+	free(stats->group_slots);
+	free(stats->instance_slots);
+	free(stats);
+}
+
+const BackupStatGroup *
+backup_stats_group(const BackupStats *stats, BackupTool tool,
+				   const char *instance_name, BackupType type)
+{
+	int32_t n;
+
+	if (stats == NULL)
+		return NULL;
+	if (stats->grouping == BACKUP_STATS_BY_TOOL || instance_name == NULL)
+		instance_name = "";
+	n = *find_group_slot(stats, tool, instance_name, type);
+	return n >= 0 ? &stats->groups[n] : NULL;
+}
+
+const BackupStatGroup *
+backup_stats_group_of(const BackupStats *stats, const BackupInfo *backup)
+{
+	return backup_stats_group(stats, backup->tool, backup->instance_name, backup->type);
+}
+
+const BackupStatInstance *
+backup_stats_instance(const BackupStats *stats, BackupTool tool,
+					  const char *instance_name)
+{
+	int32_t n;
+
+	if (stats == NULL)
+		return NULL;
+	n = *find_instance_slot(stats, tool, instance_name != NULL ? instance_name : "");
+	return n >= 0 ? &stats->instances[n] : NULL;
+}
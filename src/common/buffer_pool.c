@@ -0,0 +1,292 @@
+/*
+ * buffer_pool.c
+ *
+ * Process-wide pool of aligned read buffers under one memory budget
+ *
+ * Kept buffers sit on one free list per size class, linked through
+ * their first bytes.  One lock covers the lists and the counters; a
+ * borrow that finds a kept buffer takes it without allocating, and
+ * memory is only allocated outside the lock.  Waiting borrowers queue in
+ * arrival order, and nobody else but a thread that already holds a
+ * buffer gets one ahead of the first of them, so a 1 MB WAL buffer is
+ * not starved by a stream of 64 KB file buffers.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pg_backup_auditor.h"
+#include "buffer_pool.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Size classes: 4 KB << i, up to BUFFER_POOL_MAX_SIZE */
+#define POOL_MIN_SHIFT  12
+#define POOL_CLASSES    13
+
+/* A borrower waiting this long without getting a buffer overdraws */
+#define POOL_WAIT_SECONDS   10
+
+typedef struct PoolFree {
+	struct PoolFree *next;
+} PoolFree;
+
+typedef struct PoolWaiter {
+	struct PoolWaiter *next;
+} PoolWaiter;
+
+static pthread_mutex_t  pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   pool_returned = PTHREAD_COND_INITIALIZER;
+static PoolFree        *pool_free[POOL_CLASSES];
+static PoolWaiter      *pool_waiters;   /* oldest first */
+static BufferPoolStats  pool;
+
+/* Buffers the calling thread has borrowed and not given back */
+static _Thread_local int pool_held = 0;
+
+/* Size class of 'size', or -1 if it is too large */
+static int
+size_class(size_t size)
+{
+	int cls = 0;
+
+	while (cls < POOL_CLASSES && ((size_t) 1 << (cls + POOL_MIN_SHIFT)) < size)
+		cls++;
+	return cls < POOL_CLASSES ? cls : -1;
+}
+
+static uint64_t
+class_bytes(int cls)
+{
+	return (uint64_t) 1 << (cls + POOL_MIN_SHIFT);
+}
+
+/*
+ * Free kept buffers of classes other than 'keep' until 'bytes' more fit
+ * under the limit, largest first.  Called with pool_lock held.
+ */
+static void
+trim_for(uint64_t bytes, int keep)
+{
+	for (int cls = POOL_CLASSES - 1;
+		 cls >= 0 && pool.allocated + bytes > pool.limit; cls--)
+	{
+		while (cls != keep && pool_free[cls] != NULL &&
+			   pool.allocated + bytes > pool.limit)
+		{
+			PoolFree *f = pool_free[cls];
+
+			pool_free[cls] = f->next;
+			free(f);
+			pool.allocated -= class_bytes(cls);
+		}
+	}
+}
+
+static void
+dequeue(PoolWaiter *self)
+{
+	PoolWaiter **w = &pool_waiters;
+
+	while (*w != self)
+		w = &(*w)->next;
+	*w = self->next;
+}
+
+static void *
+borrow(size_t size, bool wait)
+{
+	int              cls = size_class(size);
+	uint64_t         bytes;
+	void            *buf = NULL;
+	PoolWaiter       self = { NULL };
+	bool             queued = false;
+	bool             timed_out = false;
+	struct timespec  deadline;
+
+	if (cls < 0)
+	{
+		log_error("Buffer of %zu bytes is larger than the pool provides", size);
+		return NULL;
+	}
+	bytes = class_bytes(cls);
+
+	pthread_mutex_lock(&pool_lock);
+	for (;;)
+	{
+		/* Whether it is this borrower's turn */
+		bool turn = pool_waiters == NULL ||
+			(wait && (pool_held > 0 || pool_waiters == &self));
+		bool within;
+
+		if ((turn || timed_out) && pool_free[cls] != NULL)
+		{
+			buf = pool_free[cls];
+			pool_free[cls] = pool_free[cls]->next;
+			break;
+		}
+
+		if (turn && pool.limit > 0 && pool.allocated + bytes > pool.limit)
+			trim_for(bytes, cls);
+		within = pool.limit == 0 || pool.allocated + bytes <= pool.limit;
+		if (!wait && !(turn && within))
+		{
+			pthread_mutex_unlock(&pool_lock);
+			return NULL;
+		}
+
+		/* Waiting is only safe when someone else can give a buffer back */
+		if ((turn && (within || pool.lent == 0 || pool_held > 0)) || timed_out)
+		{
+			if (!within)
+				pool.overdrafts++;
+			pool.allocated += bytes;
+			pthread_mutex_unlock(&pool_lock);
+
+			if (posix_memalign(&buf, BUFFER_POOL_ALIGN, (size_t) bytes) != 0)
+				buf = NULL;
+
+			pthread_mutex_lock(&pool_lock);
+			if (buf == NULL)
+			{
+				pool.allocated -= bytes;
+				if (queued)
+					dequeue(&self);
+				pthread_cond_broadcast(&pool_returned);
+				pthread_mutex_unlock(&pool_lock);
+				log_error("Out of memory while allocating a %" PRIu64 " byte read buffer",
+						  bytes);
+				return NULL;
+			}
+			break;
+		}
+
+		if (!queued)
+		{
+			PoolWaiter **w = &pool_waiters;
+
+			while (*w != NULL)
+				w = &(*w)->next;
+			*w = &self;
+			queued = true;
+			pool.waits++;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_sec += POOL_WAIT_SECONDS;
+		}
+		if (pthread_cond_timedwait(&pool_returned, &pool_lock, &deadline) == ETIMEDOUT)
+			timed_out = true;
+	}
+
+	if (queued)
+	{
+		/* The next in line may find a buffer too */
+		dequeue(&self);
+		pthread_cond_broadcast(&pool_returned);
+	}
+	pool.lent += bytes;
+	if (pool.allocated > pool.peak)
+		pool.peak = pool.allocated;
+	pthread_mutex_unlock(&pool_lock);
+
+	pool_held++;
+	return buf;
+}
+
+void
+buffer_pool_set_limit(uint64_t bytes)
+{
+	pthread_mutex_lock(&pool_lock);
+	pool.limit = bytes;
+	if (bytes > 0)
+		trim_for(0, -1);
+	pthread_cond_broadcast(&pool_returned);
+	pthread_mutex_unlock(&pool_lock);
+}
+
+void *
+buffer_pool_get(size_t size)
+{
+	return borrow(size, true);
+}
+
+void *
+buffer_pool_try_get(size_t size)
+{
+	return borrow(size, false);
+}
+
+void
+buffer_pool_put(void *buf, size_t size)
+{
+	int      cls;
+	uint64_t bytes;
+
+	cls = size_class(size);
+	if (buf == NULL || cls < 0)
+		return;
+	bytes = class_bytes(cls);
+
+	pthread_mutex_lock(&pool_lock);
+	pool.lent -= bytes;
+	if (pool.limit > 0 && pool.allocated > pool.limit)
+	{
+		/* Over the limit after an overdraft: shrink back */
+		free(buf);
+		pool.allocated -= bytes;
+	}
+	else
+	{
+		PoolFree *f = buf;
+
+		f->next = pool_free[cls];
+		pool_free[cls] = f;
+	}
+	pthread_cond_broadcast(&pool_returned);
+	pthread_mutex_unlock(&pool_lock);
+
+	if (pool_held > 0)
+		pool_held--;
+}
+
+void
+buffer_pool_trim(void)
+{
+	pthread_mutex_lock(&pool_lock);
+	for (int cls = 0; cls < POOL_CLASSES; cls++)
+	{
+		while (pool_free[cls] != NULL)
+		{
+			PoolFree *f = pool_free[cls];
+
+			pool_free[cls] = f->next;
+			free(f);
+			pool.allocated -= class_bytes(cls);
+		}
+	}
+	pthread_mutex_unlock(&pool_lock);
+}
+
+void
+buffer_pool_stats(BufferPoolStats *stats)
+{
+	pthread_mutex_lock(&pool_lock);
+	*stats = pool;
+	pthread_mutex_unlock(&pool_lock);
+}
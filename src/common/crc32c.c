@@ -1,10 +1,17 @@
 /*
  * crc32c.c
  *
- * CRC32C (Castagnoli) software implementation.
+ * CRC32C (Castagnoli) implementation with runtime CPU dispatch.
  * Polynomial: 0x82F63B78 (bit-reversed 0x1EDC6F41).
  * INIT = ~0U, FIN = ~crc — matches PostgreSQL's pg_crc32c.
  *
+ * Three implementations produce bit-identical results:
+ *   - SSE4.2 crc32 instruction (x86/x86_64)
+ *   - ARMv8 CRC32C instructions (aarch64)
+ *   - portable slicing-by-8 tables (everything else)
+ * The fastest available one is selected once, by CPUID/HWCAP, and then
+ * called through a function pointer.
+ *
  * Copyright (C) 2026 Daria Lepikhova
  *
  * This program is free software: you can redistribute it and/or modify
@@ -22,9 +29,36 @@
  */
 
 #include "crc32c.h"
+#include <pthread.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+	(defined(__GNUC__) || defined(__clang__))
+#define CRC32C_HAVE_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__)) && \
+	(defined(__linux__) || defined(__APPLE__))
+#define CRC32C_HAVE_ARMV8 1
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+#endif
+
+typedef uint32_t (*crc32c_fn)(uint32_t crc, const uint8_t *buf, size_t len);
+
+static uint32_t       crc32c_table[8][256];
+static pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
 
-static uint32_t crc32c_table[256];
-static int      crc32c_table_ready = 0;
+/* Picked once, however many workers get here first */
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+static crc32c_fn      crc32c_impl = NULL;
+static const char    *crc32c_impl_label = "sb8";
 
 static void
 init_crc32c_table(void)
@@ -38,21 +72,200 @@ init_crc32c_table(void)
 
 		for (j = 0; j < 8; j++)
 			crc = (crc & 1) ? ((crc >> 1) ^ poly) : (crc >> 1);
-		crc32c_table[i] = crc;
+		crc32c_table[0][i] = crc;
 	}
-	crc32c_table_ready = 1;
+
+	/* table[k][i] = CRC of byte i followed by k zero bytes */
+	for (i = 0; i < 256; i++)
+		for (j = 1; j < 8; j++)
+			crc32c_table[j][i] = (crc32c_table[j - 1][i] >> 8) ^
+				crc32c_table[0][crc32c_table[j - 1][i] & 0xFFU];
 }
 
 uint32_t
-crc32c_update(uint32_t crc, const uint8_t *buf, size_t len)
+crc32c_update_sw(uint32_t crc, const uint8_t *buf, size_t len)
 {
-	size_t i;
+	const uint8_t *p = buf;
 
-	if (!crc32c_table_ready)
-		init_crc32c_table();
+	pthread_once(&crc32c_table_once, init_crc32c_table);
 
-	for (i = 0; i < len; i++)
-		crc = (crc >> 8) ^ crc32c_table[(crc ^ buf[i]) & 0xFFU];
+	/*
+	 * Words are assembled byte by byte so the loop is independent of host
+	 * endianness and alignment; compilers turn this into a single load on
+	 * little-endian targets.
+	 */
+	while (len >= 8)
+	{
+		uint32_t lo = crc ^ ((uint32_t) p[0] |
+							 ((uint32_t) p[1] << 8) |
+							 ((uint32_t) p[2] << 16) |
+							 ((uint32_t) p[3] << 24));
+		uint32_t hi = (uint32_t) p[4] |
+					  ((uint32_t) p[5] << 8) |
+					  ((uint32_t) p[6] << 16) |
+					  ((uint32_t) p[7] << 24);
+
+		crc = crc32c_table[7][lo & 0xFFU] ^
+			  crc32c_table[6][(lo >> 8) & 0xFFU] ^
+			  crc32c_table[5][(lo >> 16) & 0xFFU] ^
+			  crc32c_table[4][lo >> 24] ^
+			  crc32c_table[3][hi & 0xFFU] ^
+			  crc32c_table[2][(hi >> 8) & 0xFFU] ^
+			  crc32c_table[1][(hi >> 16) & 0xFFU] ^
+			  crc32c_table[0][hi >> 24];
+		p += 8;
+		len -= 8;
+	}
+
+	while (len-- > 0)
+		crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xFFU];
 
 	return crc;
 }
+
+#ifdef CRC32C_HAVE_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t
+crc32c_update_sse42(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	const uint8_t *p = buf;
+
+	while (len > 0 && ((uintptr_t) p & 7) != 0)
+	{
+		crc = _mm_crc32_u8(crc, *p++);
+		len--;
+	}
+
+#if defined(__x86_64__)
+	{
+		uint64_t crc64 = crc;
+
+		while (len >= 8)
+		{
+			uint64_t word;
+
+			memcpy(&word, p, sizeof(word));
+			crc64 = _mm_crc32_u64(crc64, word);
+			p += 8;
+			len -= 8;
+		}
+		crc = (uint32_t) crc64;
+	}
+#endif
+
+	while (len >= 4)
+	{
+		uint32_t word;
+
+		memcpy(&word, p, sizeof(word));
+		crc = _mm_crc32_u32(crc, word);
+		p += 4;
+		len -= 4;
+	}
+
+	while (len-- > 0)
+		crc = _mm_crc32_u8(crc, *p++);
+
+	return crc;
+}
+#endif /* CRC32C_HAVE_SSE42 */
+
+#ifdef CRC32C_HAVE_ARMV8
+#if defined(__clang__)
+__attribute__((target("crc")))
+#else
+__attribute__((target("+crc")))
+#endif
+static uint32_t
+crc32c_update_armv8(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	const uint8_t *p = buf;
+
+	while (len > 0 && ((uintptr_t) p & 7) != 0)
+	{
+		crc = __crc32cb(crc, *p++);
+		len--;
+	}
+
+	while (len >= 8)
+	{
+		uint64_t word;
+
+		memcpy(&word, p, sizeof(word));
+		crc = __crc32cd(crc, word);
+		p += 8;
+		len -= 8;
+	}
+
+	while (len-- > 0)
+		crc = __crc32cb(crc, *p++);
+
+	return crc;
+}
+#endif /* CRC32C_HAVE_ARMV8 */
+
+static void
+crc32c_select(crc32c_fn fn, const char *label)
+{
+	crc32c_impl_label = label;
+	__atomic_store_n(&crc32c_impl, fn, __ATOMIC_RELEASE);
+}
+
+static void
+crc32c_pick(void)
+{
+	pthread_once(&crc32c_table_once, init_crc32c_table);
+
+#if defined(CRC32C_HAVE_SSE42)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.2"))
+	{
+		crc32c_select(crc32c_update_sse42, "sse4.2");
+		return;
+	}
+#elif defined(CRC32C_HAVE_ARMV8)
+#if defined(__APPLE__)
+	/* Every Apple Silicon core implements the ARMv8 CRC32 extension */
+	crc32c_select(crc32c_update_armv8, "armv8");
+	return;
+#else
+	if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+	{
+		crc32c_select(crc32c_update_armv8, "armv8");
+		return;
+	}
+#endif
+#endif
+
+	crc32c_select(crc32c_update_sw, "sb8");
+}
+
+void
+crc32c_init(void)
+{
+	pthread_once(&crc32c_once, crc32c_pick);
+}
+
+const char *
+crc32c_implementation(void)
+{
+	crc32c_init();
+	return crc32c_impl_label;
+}
+
+uint32_t
+crc32c_update(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	crc32c_fn fn = __atomic_load_n(&crc32c_impl, __ATOMIC_ACQUIRE);
+
+	if (fn == NULL)
+	{
+		crc32c_init();
+		fn = crc32c_impl;
+	}
+
+	if (len == 0)
+		return crc;
+
+	return fn(crc, buf, len);
+}
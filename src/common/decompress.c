@@ -0,0 +1,746 @@
+/*
+ * decompress.c
+ *
+ * Pluggable streaming decompression.
+ *
+ * Backends are listed in decompress_backends[] in order of preference;
+ * the first one that handles the requested type is used.  Library
+ * backends keep one fixed-size input buffer plus the library's own
+ * context, so memory use does not grow with the file.  The "external"
+ * backend covers every compressed type by running the matching tool
+ * with "-dc", reading its stdout through a pipe; a non-zero exit status
+ * is reported as corrupt input at the end of the stream.
+ *
+ * Adding a format means adding a DecompressBackend entry.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include "decompress.h"
+#include "common.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* Compressed input read per library call */
+#define DECOMPRESS_IN_CHUNK  (64 * 1024)
+
+typedef struct DecompressBackend DecompressBackend;
+
+struct DecompressStream {
+	const DecompressBackend *backend;
+	CompressionType          type;
+	FILE                    *fp;        /* compressed input, or child stdout */
+	pid_t                    child;     /* external backend only */
+	bool                     eof;
+	void                    *state;     /* library backend context */
+
+	/* Input file, for page-cache release (-1 with the external backend) */
+	int                      in_fd;
+	off_t                    released;
+	unsigned                 reads;
+};
+
+struct DecompressBackend {
+	const char      *name;
+	CompressionType  type;      /* COMPRESSION_NONE in "external": any */
+	bool           (*open)(DecompressStream *ds, int fd);
+	ssize_t        (*read)(DecompressStream *ds, void *buf, size_t len);
+	void           (*close)(DecompressStream *ds);
+};
+
+/*
+ * Read input from ds->fp, charged to the shared read budget.  With the
+ * external backend this is the tool's output; throttling it holds the
+ * tool back within a pipe buffer of the limit.
+ */
+static size_t
+input_read(DecompressStream *ds, void *buf, size_t len)
+{
+	size_t n = fread(buf, 1, len, ds->fp);
+
+	metrics_io(METRIC_IO_SYSCALLS, 1);
+	if (n > 0)
+	{
+		read_limit_charge(n);
+		metrics_io(METRIC_IO_BYTES_READ, n);
+	}
+	return n;
+}
+
+/* ------------------------------------------------------------------ *
+ * Type helpers
+ * ------------------------------------------------------------------ */
+
+CompressionType
+compression_detect(const unsigned char *magic, size_t len)
+{
+	if (len >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+		return COMPRESSION_GZIP;
+	if (len >= 3 && memcmp(magic, "BZh", 3) == 0)
+		return COMPRESSION_BZIP2;
+	if (len >= 6 && memcmp(magic, "\xFD" "7zXZ\0", 6) == 0)
+		return COMPRESSION_XZ;
+	if (len >= 4 && memcmp(magic, "\x04\x22\x4D\x18", 4) == 0)
+		return COMPRESSION_LZ4;
+	if (len >= 4 && memcmp(magic, "\x28\xB5\x2F\xFD", 4) == 0)
+		return COMPRESSION_ZSTD;
+	return COMPRESSION_NONE;
+}
+
+bool
+compression_from_name(const char *name, CompressionType *type)
+{
+	static const struct {
+		const char      *name;
+		CompressionType  type;
+	} names[] = {
+		{ "none", COMPRESSION_NONE },
+		{ "gz",   COMPRESSION_GZIP },
+		{ "gzip", COMPRESSION_GZIP },
+		{ "bz2",  COMPRESSION_BZIP2 },
+		{ "bzip2", COMPRESSION_BZIP2 },
+		{ "xz",   COMPRESSION_XZ },
+		{ "lz4",  COMPRESSION_LZ4 },
+		{ "zst",  COMPRESSION_ZSTD },
+		{ "zstd", COMPRESSION_ZSTD },
+	};
+
+	if (name == NULL || name[0] == '\0')
+	{
+		*type = COMPRESSION_NONE;
+		return true;
+	}
+
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+	{
+		if (strcasecmp(name, names[i].name) == 0)
+		{
+			*type = names[i].type;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *
+compression_suffix(CompressionType type)
+{
+	switch (type)
+	{
+		case COMPRESSION_GZIP:  return ".gz";
+		case COMPRESSION_BZIP2: return ".bz2";
+		case COMPRESSION_XZ:    return ".xz";
+		case COMPRESSION_LZ4:   return ".lz4";
+		case COMPRESSION_ZSTD:  return ".zst";
+		default:                return "";
+	}
+}
+
+static const char *
+external_program(CompressionType type)
+{
+	switch (type)
+	{
+		case COMPRESSION_GZIP:  return "gzip";
+		case COMPRESSION_BZIP2: return "bzip2";
+		case COMPRESSION_XZ:    return "xz";
+		case COMPRESSION_LZ4:   return "lz4";
+		case COMPRESSION_ZSTD:  return "zstd";
+		default:                return NULL;
+	}
+}
+
+/* ------------------------------------------------------------------ *
+ * Plain files
+ * ------------------------------------------------------------------ */
+
+static bool
+plain_open(DecompressStream *ds, int fd)
+{
+	ds->fp = fdopen(fd, "rb");
+	return ds->fp != NULL;
+}
+
+static ssize_t
+plain_read(DecompressStream *ds, void *buf, size_t len)
+{
+	size_t n = input_read(ds, buf, len);
+
+	if (n == 0 && ferror(ds->fp))
+		return -1;
+	return (ssize_t) n;
+}
+
+static void
+plain_close(DecompressStream *ds)
+{
+	(void) ds;
+}
+
+/* ------------------------------------------------------------------ *
+ * zlib (gzip, including concatenated members)
+ * ------------------------------------------------------------------ */
+
+#ifdef HAVE_ZLIB
+typedef struct {
+	z_stream      z;
+	bool          member_done;
+	unsigned char in[DECOMPRESS_IN_CHUNK];
+} ZlibState;
+
+static bool
+zlib_open(DecompressStream *ds, int fd)
+{
+	ZlibState *zs = calloc(1, sizeof(ZlibState));
+
+	if (zs == NULL)
+		return false;
+
+	/* 15 + 16: gzip wrapper only */
+	if (inflateInit2(&zs->z, 15 + 16) != Z_OK)
+	{
+		free(zs);
+		return false;
+	}
+
+	ds->fp = fdopen(fd, "rb");
+	if (ds->fp == NULL)
+	{
+		inflateEnd(&zs->z);
+		free(zs);
+		return false;
+	}
+	ds->state = zs;
+	return true;
+}
+
+static ssize_t
+zlib_read(DecompressStream *ds, void *buf, size_t len)
+{
+	ZlibState *zs = ds->state;
+	z_stream  *z = &zs->z;
+
+	if (len > UINT_MAX)
+		len = UINT_MAX;
+
+	z->next_out = buf;
+	z->avail_out = (uInt) len;
+
+	while (z->avail_out > 0)
+	{
+		int rc;
+
+		if (z->avail_in == 0)
+		{
+			size_t n = input_read(ds, zs->in, sizeof(zs->in));
+
+			if (n == 0)
+			{
+				/* Input ended: fine between members, truncation inside one */
+				if (ferror(ds->fp) || !zs->member_done)
+					return -1;
+				break;
+			}
+			z->next_in = zs->in;
+			z->avail_in = (uInt) n;
+		}
+
+		if (zs->member_done)
+		{
+			if (inflateReset(z) != Z_OK)
+				return -1;
+			zs->member_done = false;
+		}
+
+		rc = inflate(z, Z_NO_FLUSH);
+		if (rc == Z_STREAM_END)
+			zs->member_done = true;
+		else if (rc != Z_OK)
+			return -1;
+	}
+
+	return (ssize_t) (len - z->avail_out);
+}
+
+static void
+zlib_close(DecompressStream *ds)
+{
+	ZlibState *zs = ds->state;
+
+	if (zs != NULL)
+	{
+		inflateEnd(&zs->z);
+		free(zs);
+	}
+}
+#endif /* HAVE_ZLIB */
+
+/* ------------------------------------------------------------------ *
+ * liblz4 (frame format, including concatenated frames)
+ * ------------------------------------------------------------------ */
+
+#ifdef HAVE_LZ4
+typedef struct {
+	LZ4F_dctx     *dctx;
+	bool           frame_done;
+	size_t         in_len;
+	size_t         in_pos;
+	unsigned char  in[DECOMPRESS_IN_CHUNK];
+} Lz4State;
+
+static bool
+lz4_open(DecompressStream *ds, int fd)
+{
+	Lz4State *ls = calloc(1, sizeof(Lz4State));
+
+	if (ls == NULL)
+		return false;
+
+	if (LZ4F_isError(LZ4F_createDecompressionContext(&ls->dctx, LZ4F_VERSION)))
+	{
+		free(ls);
+		return false;
+	}
+
+	ds->fp = fdopen(fd, "rb");
+	if (ds->fp == NULL)
+	{
+		LZ4F_freeDecompressionContext(ls->dctx);
+		free(ls);
+		return false;
+	}
+	ds->state = ls;
+	return true;
+}
+
+static ssize_t
+lz4_read(DecompressStream *ds, void *buf, size_t len)
+{
+	Lz4State *ls = ds->state;
+	size_t    out_pos = 0;
+
+	while (out_pos < len)
+	{
+		size_t dst_size;
+		size_t src_size;
+		size_t hint;
+
+		if (ls->in_pos == ls->in_len)
+		{
+			size_t n = input_read(ds, ls->in, sizeof(ls->in));
+
+			if (n == 0)
+			{
+				if (ferror(ds->fp) || !ls->frame_done)
+					return -1;
+				break;
+			}
+			ls->in_len = n;
+			ls->in_pos = 0;
+		}
+
+		dst_size = len - out_pos;
+		src_size = ls->in_len - ls->in_pos;
+		hint = LZ4F_decompress(ls->dctx, (char *) buf + out_pos, &dst_size,
+							   ls->in + ls->in_pos, &src_size, NULL);
+		if (LZ4F_isError(hint))
+			return -1;
+
+		ls->in_pos += src_size;
+		out_pos += dst_size;
+		ls->frame_done = (hint == 0);
+	}
+
+	return (ssize_t) out_pos;
+}
+
+static void
+lz4_close(DecompressStream *ds)
+{
+	Lz4State *ls = ds->state;
+
+	if (ls != NULL)
+	{
+		LZ4F_freeDecompressionContext(ls->dctx);
+		free(ls);
+	}
+}
+#endif /* HAVE_LZ4 */
+
+/* ------------------------------------------------------------------ *
+ * libzstd (including concatenated frames)
+ * ------------------------------------------------------------------ */
+
+#ifdef HAVE_ZSTD
+typedef struct {
+	ZSTD_DStream  *zds;
+	bool           frame_done;
+	ZSTD_inBuffer  input;
+	unsigned char  in[DECOMPRESS_IN_CHUNK];
+} ZstdState;
+
+static bool
+zstd_open(DecompressStream *ds, int fd)
+{
+	ZstdState *zs = calloc(1, sizeof(ZstdState));
+
+	if (zs == NULL)
+		return false;
+
+	zs->zds = ZSTD_createDStream();
+	if (zs->zds == NULL || ZSTD_isError(ZSTD_initDStream(zs->zds)))
+	{
+		ZSTD_freeDStream(zs->zds);
+		free(zs);
+		return false;
+	}
+	zs->input.src = zs->in;
+
+	ds->fp = fdopen(fd, "rb");
+	if (ds->fp == NULL)
+	{
+		ZSTD_freeDStream(zs->zds);
+		free(zs);
+		return false;
+	}
+	ds->state = zs;
+	return true;
+}
+
+static ssize_t
+zstd_read(DecompressStream *ds, void *buf, size_t len)
+{
+	ZstdState      *zs = ds->state;
+	ZSTD_outBuffer  output = { buf, len, 0 };
+
+	while (output.pos < output.size)
+	{
+		size_t ret;
+
+		if (zs->input.pos == zs->input.size)
+		{
+			size_t n = input_read(ds, zs->in, sizeof(zs->in));
+
+			if (n == 0)
+			{
+				if (ferror(ds->fp) || !zs->frame_done)
+					return -1;
+				break;
+			}
+			zs->input.size = n;
+			zs->input.pos = 0;
+		}
+
+		ret = ZSTD_decompressStream(zs->zds, &output, &zs->input);
+		if (ZSTD_isError(ret))
+			return -1;
+		zs->frame_done = (ret == 0);
+	}
+
+	return (ssize_t) output.pos;
+}
+
+static void
+zstd_close(DecompressStream *ds)
+{
+	ZstdState *zs = ds->state;
+
+	if (zs != NULL)
+	{
+		ZSTD_freeDStream(zs->zds);
+		free(zs);
+	}
+}
+#endif /* HAVE_ZSTD */
+
+/* ------------------------------------------------------------------ *
+ * External tool ("gzip -dc" etc.), any compressed type
+ * ------------------------------------------------------------------ */
+
+static bool
+external_open(DecompressStream *ds, int fd)
+{
+	const char *prog = external_program(ds->type);
+	int         pipefd[2];
+	pid_t       pid;
+
+	/*
+	 * Close-on-exec, so that a tool another thread starts meanwhile does
+	 * not inherit this pipe and keep it open; dup2() clears the flag on
+	 * the child's stdin and stdout.
+	 */
+	if (prog == NULL || pipe_cloexec(pipefd) != 0)
+		return false;
+
+	pid = fork();
+	if (pid < 0)
+	{
+		close(pipefd[0]);
+		close(pipefd[1]);
+		return false;
+	}
+	if (pid > 0)
+		metrics_io(METRIC_IO_FORKS, 1);
+
+	if (pid == 0)
+	{
+		int devnull;
+
+		close(pipefd[0]);
+		if (dup2(fd, STDIN_FILENO) < 0 ||
+			dup2(pipefd[1], STDOUT_FILENO) < 0)
+			_exit(127);
+		close(fd);
+		close(pipefd[1]);
+		devnull = open("/dev/null", O_WRONLY);
+		if (devnull >= 0)
+		{
+			dup2(devnull, STDERR_FILENO);
+			close(devnull);
+		}
+		execlp(prog, prog, "-dc", (char *) NULL);
+		_exit(127);
+	}
+
+	close(pipefd[1]);
+	ds->fp = fdopen(pipefd[0], "rb");
+	if (ds->fp == NULL)
+	{
+		close(pipefd[0]);
+		kill(pid, SIGTERM);
+		waitpid(pid, NULL, 0);
+		return false;
+	}
+	ds->child = pid;
+
+	/* The child has its own copy of the input */
+	close(fd);
+	return true;
+}
+
+static ssize_t
+external_read(DecompressStream *ds, void *buf, size_t len)
+{
+	size_t n = input_read(ds, buf, len);
+	int    status;
+
+	if (n > 0)
+		return (ssize_t) n;
+	if (ferror(ds->fp))
+		return -1;
+
+	/* End of output: only a clean exit means the input was intact */
+	if (ds->child > 0)
+	{
+		if (waitpid(ds->child, &status, 0) < 0)
+			status = -1;
+		ds->child = -1;
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+static void
+external_close(DecompressStream *ds)
+{
+	if (ds->child > 0)
+	{
+		/* Stopping early leaves the tool with output to write */
+		kill(ds->child, SIGTERM);
+		if (ds->fp != NULL)
+		{
+			fclose(ds->fp);
+			ds->fp = NULL;
+		}
+		waitpid(ds->child, NULL, 0);
+		ds->child = -1;
+	}
+}
+
+/* ------------------------------------------------------------------ *
+ * Backend table and public API
+ * ------------------------------------------------------------------ */
+
+static const DecompressBackend decompress_backends[] = {
+	{ "none", COMPRESSION_NONE, plain_open, plain_read, plain_close },
+#ifdef HAVE_ZLIB
+	{ "zlib", COMPRESSION_GZIP, zlib_open, zlib_read, zlib_close },
+#endif
+#ifdef HAVE_LZ4
+	{ "lz4",  COMPRESSION_LZ4,  lz4_open,  lz4_read,  lz4_close },
+#endif
+#ifdef HAVE_ZSTD
+	{ "zstd", COMPRESSION_ZSTD, zstd_open, zstd_read, zstd_close },
+#endif
+};
+
+static const DecompressBackend external_backend = {
+	"external", COMPRESSION_NONE, external_open, external_read, external_close
+};
+
+static const DecompressBackend *
+find_backend(CompressionType type)
+{
+	for (size_t i = 0; i < sizeof(decompress_backends) / sizeof(decompress_backends[0]); i++)
+		if (decompress_backends[i].type == type)
+			return &decompress_backends[i];
+	return &external_backend;
+}
+
+const char *
+compression_backend(CompressionType type)
+{
+	return find_backend(type)->name;
+}
+
+DecompressStream *
+decompress_open(const char *path, CompressionType type)
+{
+	DecompressStream *ds;
+	int               fd;
+
+	if (path == NULL)
+		return NULL;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	metrics_io(METRIC_IO_SYSCALLS, 1);
+	if (fd < 0)
+		return NULL;
+	metrics_io(METRIC_IO_FILES_OPENED, 1);
+
+	ds = calloc(1, sizeof(DecompressStream));
+	if (ds == NULL)
+	{
+		close(fd);
+		return NULL;
+	}
+	ds->type = type;
+	ds->child = -1;
+	ds->backend = find_backend(type);
+	page_cache_begin(fd);
+
+	/* On success the backend owns fd; on failure it leaves it open */
+	if (!ds->backend->open(ds, fd))
+	{
+		close(fd);
+		free(ds);
+		return NULL;
+	}
+	ds->in_fd = ds->child < 0 ? fd : -1;
+	return ds;
+}
+
+DecompressStream *
+decompress_open_auto(const char *path)
+{
+	unsigned char magic[6];
+	size_t        n = 0;
+	FILE         *fp;
+
+	if (path == NULL)
+		return NULL;
+
+	fp = fopen(path, "rb");
+	if (fp == NULL)
+		return NULL;
+	n = fread(magic, 1, sizeof(magic), fp);
+	metrics_io_stream(fp);
+	fclose(fp);
+
+	return decompress_open(path, compression_detect(magic, n));
+}
+
+ssize_t
+decompress_read(DecompressStream *ds, void *buf, size_t len)
+{
+	ssize_t n;
+
+	if (ds == NULL)
+		return -1;
+	if (ds->eof || len == 0)
+		return 0;
+
+	n = ds->backend->read(ds, buf, len);
+	if (n == 0)
+		ds->eof = true;
+
+	/* Release consumed input now and then; see page_cache_consumed() */
+	if (n > 0 && ds->in_fd >= 0 && ++ds->reads % 64 == 0 &&
+		get_page_cache_mode() != PAGE_CACHE_USE)
+		page_cache_consumed(ds->in_fd, &ds->released, ftello(ds->fp));
+	return n;
+}
+
+bool
+decompress_skip(DecompressStream *ds, uint64_t len)
+{
+	unsigned char buf[DECOMPRESS_IN_CHUNK];
+
+	if (ds == NULL)
+		return false;
+	if (len == 0)
+		return true;
+
+	if (ds->type == COMPRESSION_NONE && len <= (uint64_t) INT64_MAX &&
+		fseeko(ds->fp, (off_t) len, SEEK_CUR) == 0)
+		return true;
+
+	while (len > 0)
+	{
+		size_t  chunk = len < sizeof(buf) ? (size_t) len : sizeof(buf);
+		ssize_t n = decompress_read(ds, buf, chunk);
+
+		if (n <= 0)
+			return false;
+		len -= (uint64_t) n;
+	}
+	return true;
+}
+
+void
+decompress_close(DecompressStream *ds)
+{
+	if (ds == NULL)
+		return;
+
+	if (ds->in_fd >= 0)
+		page_cache_end(ds->in_fd);
+	ds->backend->close(ds);
+	if (ds->fp != NULL)
+		fclose(ds->fp);
+	free(ds);
+}
@@ -20,17 +20,214 @@
  */
 
 #define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE			/* d_type and DT_* */
+#define _GNU_SOURCE				/* O_DIRECT, pipe2(), mkostemp() */
 
 #include "pg_backup_auditor.h"
+#include "buffer_pool.h"
 #include "crc32c.h"
+#include "metrics.h"
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdint.h>
 
+/* ------------------------------------------------------------------ *
+ * Page-cache use of verification reads
+ *
+ * Checking backups on the database host would otherwise stream
+ * terabytes through the page cache and evict the server's working set.
+ * In PAGE_CACHE_DROP mode readers tell the kernel they read sequentially
+ * and release what they have consumed every PAGE_CACHE_DROP_STEP bytes;
+ * PAGE_CACHE_DIRECT bypasses the cache with O_DIRECT where the file
+ * system accepts it.  Every verification reader (plain files, the
+ * decompress layer, the io_uring engine) goes through these helpers.
+ * ------------------------------------------------------------------ */
+
+#define PAGE_CACHE_DROP_STEP	(8 * 1024 * 1024)
+
+static PageCacheMode page_cache_mode = PAGE_CACHE_USE;
+
+/* Set before any reader starts; not changed while threads run */
+void
+set_page_cache_mode(PageCacheMode mode)
+{
+	page_cache_mode = mode;
+}
+
+PageCacheMode
+get_page_cache_mode(void)
+{
+	return page_cache_mode;
+}
+
+/* Hint a sequential read of 'fd' (or, on macOS, disable caching for it) */
+void
+page_cache_begin(int fd)
+{
+	if (page_cache_mode == PAGE_CACHE_USE)
+		return;
+#if defined(POSIX_FADV_SEQUENTIAL)
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(F_NOCACHE)
+	fcntl(fd, F_NOCACHE, 1);
+#else
+	(void) fd;
+#endif
+}
+
+/*
+ * The first 'pos' bytes of 'fd' have been consumed; release them once a
+ * step's worth has built up since '*released'.
+ */
+void
+page_cache_consumed(int fd, off_t *released, off_t pos)
+{
+#ifdef POSIX_FADV_DONTNEED
+	if (page_cache_mode == PAGE_CACHE_USE ||
+		pos - *released < PAGE_CACHE_DROP_STEP)
+		return;
+	posix_fadvise(fd, *released, pos - *released, POSIX_FADV_DONTNEED);
+	*released = pos;
+#else
+	(void) fd;
+	(void) released;
+	(void) pos;
+#endif
+}
+
+/* The read of 'fd' is over: release all of it */
+void
+page_cache_end(int fd)
+{
+#ifdef POSIX_FADV_DONTNEED
+	if (page_cache_mode != PAGE_CACHE_USE)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#else
+	(void) fd;
+#endif
+}
+
+/*
+ * Open 'path' for a verification read.  In PAGE_CACHE_DIRECT mode the
+ * file is opened with O_DIRECT if the file system allows it, and
+ * '*direct' is set: the caller must then read into buffers, at offsets
+ * and in lengths aligned to 4096 bytes.  Returns -1 with errno set on
+ * failure.
+ */
+int
+page_cache_open(const char *path, bool *direct)
+{
+	int fd;
+
+	*direct = false;
+#ifdef O_DIRECT
+	if (page_cache_mode == PAGE_CACHE_DIRECT)
+	{
+		fd = open(path, O_RDONLY | O_CLOEXEC | O_DIRECT);
+		metrics_io(METRIC_IO_SYSCALLS, 1);
+		if (fd >= 0)
+		{
+			metrics_io(METRIC_IO_FILES_OPENED, 1);
+			*direct = true;
+			return fd;
+		}
+		if (errno != EINVAL)
+			return -1;
+	}
+#endif
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	metrics_io(METRIC_IO_SYSCALLS, 1);
+	if (fd >= 0)
+	{
+		metrics_io(METRIC_IO_FILES_OPENED, 1);
+		page_cache_begin(fd);
+	}
+	return fd;
+}
+
+/* Read size of read_file_chunks(), from the buffer pool */
+#define FILE_CHUNK_SIZE     (64 * 1024)
+
+/*
+ * read_file_chunks - read a whole file, handing each chunk to 'fn'
+ *
+ * Honours the page-cache mode.  Returns false if the file cannot be
+ * opened or a read fails.
+ */
+bool
+read_file_chunks(const char *path, FileChunkFn fn, void *arg)
+{
+	uint8_t *buf;
+	bool     direct;
+	off_t    pos = 0;
+	off_t    released = 0;
+	int      fd;
+
+	fd = page_cache_open(path, &direct);
+	if (fd < 0)
+		return false;
+	buf = buffer_pool_get(FILE_CHUNK_SIZE);
+	if (buf == NULL)
+	{
+		close(fd);
+		return false;
+	}
+
+	for (;;)
+	{
+		ssize_t n = read(fd, buf, FILE_CHUNK_SIZE);
+
+		metrics_io(METRIC_IO_SYSCALLS, 1);
+		if (n < 0 && errno == EINTR)
+			continue;
+#ifdef O_DIRECT
+		if (n < 0 && errno == EINVAL && direct)
+		{
+			/* Accepted at open() but refused on read: read it cached */
+			direct = false;
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+			page_cache_begin(fd);
+			continue;
+		}
+#endif
+		if (n < 0)
+		{
+			buffer_pool_put(buf, FILE_CHUNK_SIZE);
+			close(fd);
+			return false;
+		}
+		if (n == 0)
+			break;
+
+		read_limit_charge((size_t) n);
+		metrics_io(METRIC_IO_BYTES_READ, (uint64_t) n);
+		fn(arg, buf, (size_t) n);
+		pos += n;
+		if (!direct)
+			page_cache_consumed(fd, &released, pos);
+	}
+
+	buffer_pool_put(buf, FILE_CHUNK_SIZE);
+	if (!direct)
+		page_cache_end(fd);
+	close(fd);
+	return true;
+}
+
+static void
+crc32c_chunk(void *arg, const uint8_t *buf, size_t len)
+{
+	uint32_t *crc = arg;
+
+	*crc = crc32c_update(*crc, buf, len);
+}
+
 /*
  * compute_file_crc32c - compute CRC32C checksum of a file
  *
@@ -40,20 +237,10 @@
 bool
 compute_file_crc32c(const char *path, uint32_t *crc_out)
 {
-	FILE    *fp;
-	uint8_t  buf[65536];
-	size_t   n;
-	uint32_t crc;
+	uint32_t crc = ~0U;
 
-	fp = fopen(path, "rb");
-	if (fp == NULL)
+	if (!read_file_chunks(path, crc32c_chunk, &crc))
 		return false;
-
-	crc = ~0U;
-	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
-		crc = crc32c_update(crc, buf, n);
-
-	fclose(fp);
 	*crc_out = ~crc;
 	return true;
 }
@@ -111,43 +298,213 @@ get_file_size(const char *path)
 }
 
 /*
- * Get total size of directory (recursively)
- * Returns total size in bytes
+ * Is 'entry', read from the directory open as 'dir_fd', a directory?
+ * Answered from d_type when the file system fills it in; otherwise (and
+ * for symlinks, which are followed as stat() would) with fstatat().
  */
-uint64_t
-get_directory_size(const char *path)
+bool
+dirent_is_directory(int dir_fd, const struct dirent *entry)
+{
+	struct stat st;
+
+#ifdef DT_DIR
+	if (entry->d_type == DT_DIR)
+		return true;
+	if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK)
+		return false;
+#endif
+	return fstatat(dir_fd, entry->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+}
+
+static int
+compare_snapshot_entries(const void *a, const void *b)
+{
+	const DirSnapshotEntry *ea = *(const DirSnapshotEntry *const *) a;
+	const DirSnapshotEntry *eb = *(const DirSnapshotEntry *const *) b;
+
+	return strcmp(ea->name, eb->name);
+}
+
+/*
+ * Read the entries of directory 'path' into 'snap' in one pass, so that
+ * several questions about the directory (is there a backup.control, a
+ * base/ directory, a base.tar*?) cost no further opendir() or stat().
+ * Returns false, with 'snap' empty, if the directory cannot be read.
+ */
+bool
+dir_snapshot_read(const char *path, DirSnapshot *snap)
 {
 	DIR *dir;
 	struct dirent *entry;
-	struct stat st;
-	uint64_t total_size = 0;
-	char full_path[PATH_MAX];
+	int capacity = 0;
 
+	memset(snap, 0, sizeof(*snap));
 	dir = opendir(path);
 	if (dir == NULL)
-		return 0;
+		return false;
 
 	while ((entry = readdir(dir)) != NULL)
 	{
-		/* Skip . and .. */
+		DirSnapshotEntry *e;
+
 		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
 			continue;
 
-		/* Build full path */
-		path_join(full_path, sizeof(full_path), path, entry->d_name);
+		if (snap->count == capacity)
+		{
+			int nc = capacity ? capacity * 2 : 16;
+			DirSnapshotEntry *grown = realloc(snap->entries, sizeof(DirSnapshotEntry) * nc);
+
+			if (grown == NULL)
+				goto oom;
+			snap->entries = grown;
+			capacity = nc;
+		}
+		e = &snap->entries[snap->count];
+		e->name = strdup(entry->d_name);
+		if (e->name == NULL)
+			goto oom;
+		e->is_dir = dirent_is_directory(dirfd(dir), entry);
+		snap->count++;
+	}
+	closedir(dir);
+
+	if (snap->count > 0)
+	{
+		snap->sorted = malloc(sizeof(DirSnapshotEntry *) * snap->count);
+		if (snap->sorted == NULL)
+		{
+			log_warning("Out of memory while reading directory: %s", path);
+			dir_snapshot_free(snap);
+			return false;
+		}
+		for (int i = 0; i < snap->count; i++)
+			snap->sorted[i] = &snap->entries[i];
+		qsort(snap->sorted, snap->count, sizeof(DirSnapshotEntry *),
+			  compare_snapshot_entries);
+	}
+	return true;
+
+oom:
+	log_warning("Out of memory while reading directory: %s", path);
+	closedir(dir);
+	dir_snapshot_free(snap);
+	return false;
+}
+
+/* First entry, by name, not sorting before 'name' */
+static int
+snapshot_lower_bound(const DirSnapshot *snap, const char *name)
+{
+	int lo = 0;
+	int hi = snap->count;
 
-		if (stat(full_path, &st) != 0)
+	while (lo < hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+
+		if (strcmp(snap->sorted[mid]->name, name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* The entry called 'name', or NULL */
+const DirSnapshotEntry *
+dir_snapshot_find(const DirSnapshot *snap, const char *name)
+{
+	int i = snapshot_lower_bound(snap, name);
+
+	if (i < snap->count && strcmp(snap->sorted[i]->name, name) == 0)
+		return snap->sorted[i];
+	return NULL;
+}
+
+/* The first entry, by name, whose name starts with 'prefix', or NULL */
+const DirSnapshotEntry *
+dir_snapshot_find_prefix(const DirSnapshot *snap, const char *prefix)
+{
+	int i = snapshot_lower_bound(snap, prefix);
+
+	if (i < snap->count &&
+		strncmp(snap->sorted[i]->name, prefix, strlen(prefix)) == 0)
+		return snap->sorted[i];
+	return NULL;
+}
+
+/* Is there a directory called 'name'? */
+bool
+dir_snapshot_has_dir(const DirSnapshot *snap, const char *name)
+{
+	const DirSnapshotEntry *e = dir_snapshot_find(snap, name);
+
+	return e != NULL && e->is_dir;
+}
+
+void
+dir_snapshot_free(DirSnapshot *snap)
+{
+	for (int i = 0; i < snap->count; i++)
+		free(snap->entries[i].name);
+	free(snap->entries);
+	free(snap->sorted);
+	memset(snap, 0, sizeof(*snap));
+}
+
+/*
+ * Size of the regular files below the directory open as 'fd' (consumed).
+ * Entries are looked up relative to their directory, so long paths are
+ * not resolved again for every file.
+ */
+static uint64_t
+directory_size_at(int fd)
+{
+	DIR *dir;
+	struct dirent *entry;
+	struct stat st;
+	uint64_t total_size = 0;
+
+	dir = fdopendir(fd);
+	if (dir == NULL)
+	{
+		close(fd);
+		return 0;
+	}
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		bool is_dir;
+
+		/* Skip . and .. */
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
 			continue;
 
-		if (S_ISDIR(st.st_mode))
+#ifdef DT_DIR
+		if (entry->d_type == DT_DIR)
+			is_dir = true;
+		else if (entry->d_type != DT_REG && entry->d_type != DT_LNK &&
+				 entry->d_type != DT_UNKNOWN)
+			continue;	/* no size worth counting */
+		else
+#endif
 		{
-			/* Recursively get subdirectory size */
-			total_size += get_directory_size(full_path);
+			/* Follow symlinks, as stat() would */
+			if (fstatat(dirfd(dir), entry->d_name, &st, 0) != 0)
+				continue;
+			is_dir = S_ISDIR(st.st_mode);
+			if (!is_dir && S_ISREG(st.st_mode))
+				total_size += st.st_size;	/* Add file size */
 		}
-		else if (S_ISREG(st.st_mode))
+
+		if (is_dir)
 		{
-			/* Add file size */
-			total_size += st.st_size;
+			/* Recursively get subdirectory size */
+			int sub = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY);
+
+			if (sub >= 0)
+				total_size += directory_size_at(sub);
 		}
 	}
 
@@ -155,6 +512,20 @@ get_directory_size(const char *path)
 	return total_size;
 }
 
+/*
+ * Get total size of directory (recursively)
+ * Returns total size in bytes
+ */
+uint64_t
+get_directory_size(const char *path)
+{
+	int fd = open(path, O_RDONLY | O_DIRECTORY);
+
+	if (fd < 0)
+		return 0;
+	return directory_size_at(fd);
+}
+
 /*
  * Join paths (similar to Python's os.path.join)
  */
@@ -225,7 +596,50 @@ read_file_contents(const char *path)
 	read_size = fread(contents, 1, size, f);
 	contents[read_size] = '\0';
 
+	metrics_io_stream(f);
 	fclose(f);
 
 	return contents;
 }
+
+/* ------------------------------------------------------------------ *
+ * Close-on-exec descriptors
+ *
+ * Tools are forked while other threads read on, so every descriptor
+ * must be close-on-exec from the moment it exists: one a child inherits
+ * by accident stays open in it, and a pipe's reader then never sees EOF.
+ * pipe2() and mkostemp() set the flag atomically where the C library
+ * has them (HAVE_PIPE2, HAVE_MKOSTEMP, found by the build); elsewhere,
+ * as on macOS, it is set right after, which leaves a short window to a
+ * fork in another thread.
+ * ------------------------------------------------------------------ */
+
+/* pipe(), with both ends close-on-exec */
+int
+pipe_cloexec(int fds[2])
+{
+#ifdef HAVE_PIPE2
+	return pipe2(fds, O_CLOEXEC);
+#else
+	if (pipe(fds) != 0)
+		return -1;
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	return 0;
+#endif
+}
+
+/* mkstemp(), with the file close-on-exec */
+int
+mkstemp_cloexec(char *tmpl)
+{
+#ifdef HAVE_MKOSTEMP
+	return mkostemp(tmpl, O_CLOEXEC);
+#else
+	int fd = mkstemp(tmpl);
+
+	if (fd >= 0)
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+	return fd;
+#endif
+}
@@ -0,0 +1,640 @@
+/*
+ * fs_watch.c
+ *
+ * Directory change notification
+ *
+ * Every watched directory has an entry, found by path through an
+ * open-addressing index, so a tree is never watched twice however often
+ * it is re-listed.  The backends differ only in how an entry is armed
+ * and how events are read back: inotify returns a watch descriptor per
+ * event, kqueue the entry index stored with the directory's descriptor,
+ * and the polling fallback compares stat() results.  When a directory
+ * changes its subdirectories are listed again, which is how new ones
+ * (a backup being created, a new pgBackRest archive prefix) come to be
+ * watched with every backend.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fs_watch.h"
+#include "pg_backup_auditor.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_INOTIFY)
+#include <sys/inotify.h>
+#define FS_WATCH_INOTIFY 1
+#elif defined(HAVE_KQUEUE)
+#include <sys/event.h>
+#define FS_WATCH_KQUEUE 1
+#endif
+
+/* A burst of events is over once none has come for this long */
+#define FS_WATCH_SETTLE_MS      250
+
+/* ... or after this long, so that steady writes still wake the caller */
+#define FS_WATCH_SETTLE_MAX_MS  2000
+
+/* How often the polling fallback looks at the directories */
+#define FS_WATCH_POLL_MS        1000
+
+typedef struct {
+	char   *path;
+	int     depth_left;     /* levels below this one that are watched */
+	int     handle;         /* inotify wd or kqueue fd; -1 if not armed */
+	bool    changed;        /* listed in changed[] */
+
+	/* Polling fallback: what stat() said last time */
+	time_t  mtime;
+	time_t  ctime;
+	off_t   size;
+} WatchDir;
+
+struct FsWatch {
+	WatchDir        *dirs;
+	int              count;
+	int              capacity;
+	int             *changed;       /* indexes into dirs, capacity entries */
+	int              nchanged;
+
+	int             *slots;         /* path index: dir index + 1; 0 = empty */
+	uint32_t         mask;
+
+	int             *by_handle;     /* inotify: wd -> dir index + 1 */
+	int              handle_cap;
+
+	int              fd;            /* inotify or kqueue descriptor, or -1 */
+	bool             limit_warned;
+	FsWatchDescendFn descend;
+	void            *arg;
+};
+
+const char *
+fs_watch_backend(void)
+{
+#if defined(FS_WATCH_INOTIFY)
+	return "inotify";
+#elif defined(FS_WATCH_KQUEUE)
+	return "kqueue";
+#else
+	return "poll";
+#endif
+}
+
+static long
+elapsed_ms(const struct timespec *since)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long) (now.tv_sec - since->tv_sec) * 1000 +
+		(now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+/* ------------------------------------------------------------------ *
+ * Path index
+ * ------------------------------------------------------------------ */
+
+static uint32_t
+path_hash(const char *s)
+{
+	uint32_t h = 2166136261U;
+
+	while (*s != '\0')
+	{
+		h ^= (uint8_t) *s++;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static int
+index_find(const FsWatch *w, const char *path)
+{
+	uint32_t slot = path_hash(path) & w->mask;
+
+	while (w->slots[slot] != 0)
+	{
+		int i = w->slots[slot] - 1;
+
+		if (strcmp(w->dirs[i].path, path) == 0)
+			return i;
+		slot = (slot + 1) & w->mask;
+	}
+	return -1;
+}
+
+static void
+index_put(int *slots, uint32_t mask, const char *path, int i)
+{
+	uint32_t slot = path_hash(path) & mask;
+
+	while (slots[slot] != 0)
+		slot = (slot + 1) & mask;
+	slots[slot] = i + 1;
+}
+
+/* Keep the index at most half full */
+static bool
+index_reserve(FsWatch *w)
+{
+	uint32_t nmask;
+	int     *slots;
+
+	if ((uint32_t) (w->count + 1) * 2 <= w->mask + 1)
+		return true;
+	nmask = w->mask * 2 + 1;
+	slots = calloc((size_t) nmask + 1, sizeof(int));
+	if (slots == NULL)
+		return false;
+	for (int i = 0; i < w->count; i++)
+		index_put(slots, nmask, w->dirs[i].path, i);
+	free(w->slots);
+	w->slots = slots;
+	w->mask = nmask;
+	return true;
+}
+
+/* ------------------------------------------------------------------ *
+ * Backends
+ * ------------------------------------------------------------------ */
+
+static void
+mark_changed(FsWatch *w, int i)
+{
+	if (w->dirs[i].changed)
+		return;
+	w->dirs[i].changed = true;
+	w->changed[w->nchanged++] = i;
+}
+
+#if defined(FS_WATCH_INOTIFY) || defined(FS_WATCH_KQUEUE)
+/* Warn once when the system's watch limit is hit */
+static void
+arm_failed(FsWatch *w, const char *path)
+{
+	if (errno == ENOSPC || errno == EMFILE)
+	{
+		if (!w->limit_warned)
+			log_warning("Cannot watch %s: watch limit reached (%s); changes "
+						"below it are picked up by the periodic rescan",
+						path, strerror(errno));
+		w->limit_warned = true;
+	}
+	else
+		log_debug("Cannot watch %s: %s", path, strerror(errno));
+}
+#endif
+
+/* Start receiving events for dirs[i] */
+static bool
+arm(FsWatch *w, int i)
+{
+	WatchDir *d = &w->dirs[i];
+
+#if defined(FS_WATCH_INOTIFY)
+	int wd = inotify_add_watch(w->fd, d->path,
+							   IN_CREATE | IN_DELETE | IN_CLOSE_WRITE |
+							   IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |
+							   IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+
+	if (wd < 0)
+	{
+		arm_failed(w, d->path);
+		return false;
+	}
+	if (wd >= w->handle_cap)
+	{
+		int  nc = w->handle_cap ? w->handle_cap : 64;
+		int *grown;
+
+		while (nc <= wd)
+			nc *= 2;
+		grown = realloc(w->by_handle, sizeof(int) * (size_t) nc);
+		if (grown == NULL)
+		{
+			inotify_rm_watch(w->fd, wd);
+			return false;
+		}
+		memset(grown + w->handle_cap, 0, sizeof(int) * (size_t) (nc - w->handle_cap));
+		w->by_handle = grown;
+		w->handle_cap = nc;
+	}
+	w->by_handle[wd] = i + 1;
+	d->handle = wd;
+#elif defined(FS_WATCH_KQUEUE)
+	struct kevent ev;
+	int           flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+	int           fd;
+
+#ifdef O_EVTONLY
+	flags |= O_EVTONLY;			/* macOS: do not keep the volume busy */
+#endif
+	fd = open(d->path, flags);
+	if (fd < 0)
+	{
+		arm_failed(w, d->path);
+		return false;
+	}
+	EV_SET(&ev, fd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+		   NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE | NOTE_RENAME,
+		   0, (void *) (intptr_t) i);
+	if (kevent(w->fd, &ev, 1, NULL, 0, NULL) < 0)
+	{
+		arm_failed(w, d->path);
+		close(fd);
+		return false;
+	}
+	d->handle = fd;
+#else
+	struct stat st;
+
+	if (stat(d->path, &st) != 0)
+		return false;
+	d->mtime = st.st_mtime;
+	d->ctime = st.st_ctime;
+	d->size = st.st_size;
+	d->handle = 0;
+#endif
+	return true;
+}
+
+/* The directory of dirs[i] is gone; forget its handle */
+static void
+disarm(FsWatch *w, int i)
+{
+	WatchDir *d = &w->dirs[i];
+
+	if (d->handle < 0)
+		return;
+#if defined(FS_WATCH_INOTIFY)
+	if (d->handle < w->handle_cap)
+		w->by_handle[d->handle] = 0;
+#elif defined(FS_WATCH_KQUEUE)
+	close(d->handle);			/* also removes the event */
+#endif
+	d->handle = -1;
+}
+
+/*
+ * Read the events that are ready, marking the directories they concern.
+ * Returns the number of events read, or -1 on error.
+ */
+static int
+drain(FsWatch *w)
+{
+	int n = 0;
+
+#if defined(FS_WATCH_INOTIFY)
+	char buf[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	for (;;)
+	{
+		ssize_t len = read(w->fd, buf, sizeof(buf));
+
+		if (len < 0)
+		{
+			if (errno == EAGAIN || errno == EINTR)
+				break;
+			return -1;
+		}
+		for (char *p = buf; p < buf + len; )
+		{
+			const struct inotify_event *ev = (const struct inotify_event *) p;
+
+			p += sizeof(struct inotify_event) + ev->len;
+			n++;
+			if (ev->mask & IN_Q_OVERFLOW)
+			{
+				/* Events were lost: treat every directory as changed */
+				for (int i = 0; i < w->count; i++)
+					mark_changed(w, i);
+				continue;
+			}
+			if (ev->wd < 0 || ev->wd >= w->handle_cap || w->by_handle[ev->wd] == 0)
+				continue;
+			mark_changed(w, w->by_handle[ev->wd] - 1);
+			if (ev->mask & IN_IGNORED)
+				disarm(w, w->by_handle[ev->wd] - 1);
+		}
+	}
+#elif defined(FS_WATCH_KQUEUE)
+	struct kevent   evs[64];
+	struct timespec zero = {0, 0};
+	int             got;
+
+	do
+	{
+		got = kevent(w->fd, NULL, 0, evs, 64, &zero);
+		if (got < 0)
+			return errno == EINTR ? n : -1;
+		for (int e = 0; e < got; e++)
+		{
+			int i = (int) (intptr_t) evs[e].udata;
+
+			if (i < 0 || i >= w->count)
+				continue;
+			n++;
+			mark_changed(w, i);
+			if (evs[e].fflags & (NOTE_DELETE | NOTE_RENAME))
+				disarm(w, i);
+		}
+	} while (got == 64);
+#else
+	for (int i = 0; i < w->count; i++)
+	{
+		WatchDir   *d = &w->dirs[i];
+		struct stat st;
+
+		if (d->handle < 0)
+			continue;
+		if (stat(d->path, &st) != 0)
+		{
+			n++;
+			mark_changed(w, i);
+			disarm(w, i);
+		}
+		else if (st.st_mtime != d->mtime || st.st_ctime != d->ctime ||
+				 st.st_size != d->size)
+		{
+			n++;
+			mark_changed(w, i);
+			d->mtime = st.st_mtime;
+			d->ctime = st.st_ctime;
+			d->size = st.st_size;
+		}
+	}
+#endif
+	return n;
+}
+
+/* ------------------------------------------------------------------ *
+ * Trees
+ * ------------------------------------------------------------------ */
+
+static void add_children(FsWatch *w, int i, bool report);
+
+/*
+ * Watch 'path' and what lies below it.  New directories are reported as
+ * changed when 'report' is set.  Returns the entry, or -1.
+ */
+static int
+add_dir(FsWatch *w, const char *path, int depth_left, bool report)
+{
+	int i = index_find(w, path);
+
+	if (i >= 0)
+	{
+		/* Re-created after it was removed */
+		if (w->dirs[i].handle < 0 && arm(w, i))
+		{
+			if (report)
+				mark_changed(w, i);
+			add_children(w, i, report);
+		}
+		return i;
+	}
+
+	if (w->count == w->capacity)
+	{
+		int       nc = w->capacity ? w->capacity * 2 : 64;
+		WatchDir *dirs = realloc(w->dirs, sizeof(WatchDir) * (size_t) nc);
+		int      *changed;
+
+		if (dirs == NULL)
+			return -1;
+		w->dirs = dirs;
+		changed = realloc(w->changed, sizeof(int) * (size_t) nc);
+		if (changed == NULL)
+			return -1;
+		w->changed = changed;
+		w->capacity = nc;
+	}
+	if (!index_reserve(w))
+		return -1;
+
+	i = w->count;
+	memset(&w->dirs[i], 0, sizeof(WatchDir));
+	w->dirs[i].path = strdup(path);
+	if (w->dirs[i].path == NULL)
+		return -1;
+	w->dirs[i].depth_left = depth_left;
+	w->dirs[i].handle = -1;
+	w->count++;
+	index_put(w->slots, w->mask, path, i);
+
+	if (!arm(w, i))
+		return i;			/* kept, so it is not retried on every listing */
+	if (report)
+		mark_changed(w, i);
+	add_children(w, i, report);
+	return i;
+}
+
+/* Watch the subdirectories of dirs[i] not watched yet */
+static void
+add_children(FsWatch *w, int i, bool report)
+{
+	char           path[PATH_MAX];
+	char           child[PATH_MAX];
+	int            depth_left = w->dirs[i].depth_left;
+	DIR           *dir;
+	struct dirent *entry;
+
+	if (depth_left <= 0)
+		return;
+	str_copy(path, w->dirs[i].path, sizeof(path));	/* dirs may move */
+	if (w->descend != NULL && !w->descend(path, w->arg))
+		return;
+
+	dir = opendir(path);
+	if (dir == NULL)
+		return;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+		if (!dirent_is_directory(dirfd(dir), entry))
+			continue;
+		path_join(child, sizeof(child), path, entry->d_name);
+		add_dir(w, child, depth_left - 1, report);
+	}
+	closedir(dir);
+}
+
+/* ------------------------------------------------------------------ *
+ * Interface
+ * ------------------------------------------------------------------ */
+
+FsWatch *
+fs_watch_open(FsWatchDescendFn descend, void *arg)
+{
+	FsWatch *w = calloc(1, sizeof(FsWatch));
+
+	if (w == NULL)
+		return NULL;
+	w->mask = 63;
+	w->slots = calloc(w->mask + 1, sizeof(int));
+	if (w->slots == NULL)
+	{
+		free(w);
+		return NULL;
+	}
+	w->descend = descend;
+	w->arg = arg;
+
+#if defined(FS_WATCH_INOTIFY)
+	w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#elif defined(FS_WATCH_KQUEUE)
+	w->fd = kqueue();
+#else
+	w->fd = 0;
+#endif
+	if (w->fd < 0)
+	{
+		log_error("Cannot start %s: %s", fs_watch_backend(), strerror(errno));
+		free(w->slots);
+		free(w);
+		return NULL;
+	}
+	return w;
+}
+
+bool
+fs_watch_add_tree(FsWatch *w, const char *root, int max_depth)
+{
+	int i;
+
+	if (w == NULL || root == NULL)
+		return false;
+	i = add_dir(w, root, max_depth, false);
+	return i >= 0 && w->dirs[i].handle >= 0;
+}
+
+int
+fs_watch_wait(FsWatch *w, int timeout_ms)
+{
+	struct timespec start;
+	int             nreported;
+
+	if (w == NULL)
+		return -1;
+
+	for (int c = 0; c < w->nchanged; c++)
+		w->dirs[w->changed[c]].changed = false;
+	w->nchanged = 0;
+
+#if defined(FS_WATCH_INOTIFY) || defined(FS_WATCH_KQUEUE)
+	{
+		struct pollfd pfd = { w->fd, POLLIN, 0 };
+		int           rc = poll(&pfd, 1, timeout_ms);
+
+		if (rc < 0)
+			return errno == EINTR ? 0 : -1;
+		if (rc == 0)
+			return 0;
+		if (drain(w) < 0)
+			return -1;
+
+		/* Let the burst settle */
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		while (elapsed_ms(&start) < FS_WATCH_SETTLE_MAX_MS)
+		{
+			rc = poll(&pfd, 1, FS_WATCH_SETTLE_MS);
+			if (rc <= 0)
+				break;
+			if (drain(w) < 0)
+				return -1;
+		}
+	}
+#else
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (;;)
+	{
+		long left = timeout_ms < 0 ? FS_WATCH_POLL_MS
+			: timeout_ms - elapsed_ms(&start);
+		struct timespec pause;
+
+		if (drain(w) > 0)
+			break;
+		if (left <= 0)
+			return 0;
+		if (left > FS_WATCH_POLL_MS)
+			left = FS_WATCH_POLL_MS;
+		pause.tv_sec = left / 1000;
+		pause.tv_nsec = (left % 1000) * 1000000L;
+		if (nanosleep(&pause, NULL) != 0)
+			return 0;			/* interrupted by a signal */
+	}
+#endif
+
+	/* Pick up directories created in the ones that changed */
+	nreported = w->nchanged;
+	for (int c = 0; c < nreported; c++)
+		if (w->dirs[w->changed[c]].handle >= 0)
+			add_children(w, w->changed[c], true);
+
+	return w->nchanged;
+}
+
+const char *
+fs_watch_changed(const FsWatch *w, int i)
+{
+	if (w == NULL || i < 0 || i >= w->nchanged)
+		return NULL;
+	return w->dirs[w->changed[i]].path;
+}
+
+int
+fs_watch_count(const FsWatch *w)
+{
+	int n = 0;
+
+	for (int i = 0; w != NULL && i < w->count; i++)
+		if (w->dirs[i].handle >= 0)
+			n++;
+	return n;
+}
+
+void
+fs_watch_close(FsWatch *w)
+{
+	if (w == NULL)
+		return;
+	for (int i = 0; i < w->count; i++)
+	{
+		disarm(w, i);
+		free(w->dirs[i].path);
+	}
+#if defined(FS_WATCH_INOTIFY) || defined(FS_WATCH_KQUEUE)
+	close(w->fd);
+#endif
+	free(w->dirs);
+	free(w->changed);
+	free(w->slots);
+	free(w->by_handle);
+	free(w);
+}
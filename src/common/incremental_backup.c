@@ -0,0 +1,438 @@
+/*
+ * incremental_backup.c
+ *
+ * Streaming checks of the INCREMENTAL.* files and WAL summaries of
+ * PostgreSQL 17+ incremental backups.  Integers are in the byte order of
+ * the server that wrote them, read as it reads them: in host order.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "incremental_backup.h"
+#include "page_checksum.h"
+#include "crc32c.h"
+#include "pg_backup_auditor.h"
+#include <stdio.h>
+#include <string.h>
+
+/* magic, num_blocks, truncation_block_length */
+#define INCREMENTAL_FIXED_FIELDS    3
+
+/* BlockRefTableSerializedEntry: spcOid, dbOid, relNumber, forknum, limit_block, nchunks */
+#define SUMMARY_ENTRY_SIZE          24
+#define SUMMARY_RELNUMBER_OFFSET    8
+#define SUMMARY_FORKNUM_OFFSET      12
+#define SUMMARY_NCHUNKS_OFFSET      20
+#define SUMMARY_MAX_FORKNUM         3           /* INIT_FORKNUM */
+#define SUMMARY_MAX_CHUNK_ENTRIES   4096        /* MAX_ENTRIES_PER_CHUNK */
+
+#define SUMMARY_SUFFIX              ".summary"
+#define SUMMARY_HEX_DIGITS          40
+
+typedef enum {
+	SUMMARY_MAGIC = 0,
+	SUMMARY_ENTRY,
+	SUMMARY_USAGE,          /* one chunk_usage of the current relation */
+	SUMMARY_CHUNKS,         /* the relation's chunk contents, skipped */
+	SUMMARY_CRC,
+	SUMMARY_DONE
+} SummaryState;
+
+static uint32_t
+read_u32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+bool
+incremental_file_name(const char *path)
+{
+	const char *base = strrchr(path, '/');
+
+	base = base != NULL ? base + 1 : path;
+	return strncmp(base, INCREMENTAL_PREFIX, strlen(INCREMENTAL_PREFIX)) == 0 &&
+		base[strlen(INCREMENTAL_PREFIX)] != '\0';
+}
+
+/* ------------------------------------------------------------------ *
+ * INCREMENTAL.* files
+ * ------------------------------------------------------------------ */
+
+static void
+incremental_fail(IncrementalWalk *walk, const char *problem)
+{
+	if (walk->failed)
+		return;
+	walk->failed = true;
+	str_copy(walk->problem, problem, sizeof(walk->problem));
+}
+
+/* Bytes of the header before its padding */
+static uint64_t
+incremental_fields_end(const IncrementalWalk *walk)
+{
+	if (walk->header_length == 0)
+		return INCREMENTAL_FIXED_FIELDS * sizeof(uint32_t);
+	return (INCREMENTAL_FIXED_FIELDS + (uint64_t) walk->num_blocks) * sizeof(uint32_t);
+}
+
+/* Header field 'index' has just been read into walk->field */
+static void
+incremental_field(IncrementalWalk *walk, uint64_t index)
+{
+	uint32_t value = read_u32(walk->field);
+	char     problem[sizeof(walk->problem)];
+
+	if (index == 0)
+	{
+		walk->magic = value;
+		if (value != INCREMENTAL_MAGIC)
+		{
+			snprintf(problem, sizeof(problem), "bad magic number %08X", value);
+			incremental_fail(walk, problem);
+		}
+	}
+	else if (index == 1)
+	{
+		walk->num_blocks = value;
+		if (value > PAGE_RELSEG_SIZE)
+		{
+			snprintf(problem, sizeof(problem),
+					 "block count %u exceeds the segment size", value);
+			incremental_fail(walk, problem);
+			return;
+		}
+		/* With blocks to follow the header is padded to a whole block */
+		walk->header_length = (INCREMENTAL_FIXED_FIELDS + (uint64_t) value) * sizeof(uint32_t);
+		if (value > 0 && walk->header_length % PAGE_BLCKSZ != 0)
+			walk->header_length += PAGE_BLCKSZ - walk->header_length % PAGE_BLCKSZ;
+	}
+	else if (index == 2)
+	{
+		walk->truncation_block_length = value;
+		if (value > PAGE_RELSEG_SIZE)
+		{
+			snprintf(problem, sizeof(problem),
+					 "truncation block length %u exceeds the segment size", value);
+			incremental_fail(walk, problem);
+		}
+	}
+	else
+	{
+		/* The server sorts the block numbers before writing them */
+		if (value >= PAGE_RELSEG_SIZE)
+			snprintf(problem, sizeof(problem), "block number %u out of range", value);
+		else if (walk->blocks_read > 0 && value <= walk->last_block)
+			snprintf(problem, sizeof(problem),
+					 "block number %u does not follow %u", value, walk->last_block);
+		else
+			problem[0] = '\0';
+		if (problem[0] != '\0')
+			incremental_fail(walk, problem);
+		walk->last_block = value;
+		walk->blocks_read++;
+	}
+}
+
+void
+incremental_walk_init(IncrementalWalk *walk)
+{
+	memset(walk, 0, sizeof(*walk));
+}
+
+void
+incremental_walk_update(IncrementalWalk *walk, const uint8_t *buf, size_t len)
+{
+	while (len > 0 && !walk->failed)
+	{
+		uint64_t end = incremental_fields_end(walk);
+		size_t   n;
+
+		if (walk->bytes >= end)
+		{
+			/* Padding and blocks: only their length is checked */
+			walk->bytes += len;
+			return;
+		}
+
+		n = sizeof(walk->field) - walk->field_have;
+		if (n > len)
+			n = len;
+		memcpy(walk->field + walk->field_have, buf, n);
+		walk->field_have += n;
+		walk->bytes += n;
+		buf += n;
+		len -= n;
+
+		if (walk->field_have == sizeof(walk->field))
+		{
+			walk->field_have = 0;
+			incremental_field(walk, walk->bytes / sizeof(uint32_t) - 1);
+		}
+	}
+}
+
+bool
+incremental_walk_finish(IncrementalWalk *walk)
+{
+	char     problem[sizeof(walk->problem)];
+	uint64_t expected;
+
+	if (walk->failed)
+		return false;
+
+	if (walk->bytes < incremental_fields_end(walk) || walk->header_length == 0)
+	{
+		snprintf(problem, sizeof(problem), "header truncated at %llu bytes",
+				 (unsigned long long) walk->bytes);
+		incremental_fail(walk, problem);
+		return false;
+	}
+
+	expected = walk->header_length + (uint64_t) walk->num_blocks * PAGE_BLCKSZ;
+	if (walk->bytes != expected)
+	{
+		snprintf(problem, sizeof(problem),
+				 "%llu bytes, but its header describes %u blocks in %llu",
+				 (unsigned long long) walk->bytes, walk->num_blocks,
+				 (unsigned long long) expected);
+		incremental_fail(walk, problem);
+		return false;
+	}
+	return true;
+}
+
+/* ------------------------------------------------------------------ *
+ * WAL summaries
+ * ------------------------------------------------------------------ */
+
+static bool
+hex_field(const char *s, int digits, uint64_t *value)
+{
+	*value = 0;
+	for (int i = 0; i < digits; i++)
+	{
+		char c = s[i];
+		int  d;
+
+		if (c >= '0' && c <= '9')
+			d = c - '0';
+		else if (c >= 'A' && c <= 'F')
+			d = c - 'A' + 10;
+		else if (c >= 'a' && c <= 'f')
+			d = c - 'a' + 10;
+		else
+			return false;
+		*value = (*value << 4) | (uint64_t) d;
+	}
+	return true;
+}
+
+bool
+wal_summary_file_name(const char *name, WALSummaryRange *range)
+{
+	uint64_t tli, start, end;
+
+	if (strlen(name) != SUMMARY_HEX_DIGITS + strlen(SUMMARY_SUFFIX) ||
+		strcmp(name + SUMMARY_HEX_DIGITS, SUMMARY_SUFFIX) != 0)
+		return false;
+	if (!hex_field(name, 8, &tli) ||
+		!hex_field(name + 8, 16, &start) ||
+		!hex_field(name + 24, 16, &end) ||
+		end < start)
+		return false;
+
+	range->timeline = (TimeLineID) tli;
+	range->start_lsn = start;
+	range->end_lsn = end;
+	return true;
+}
+
+static void
+summary_fail(WALSummaryWalk *walk, const char *problem)
+{
+	if (walk->failed)
+		return;
+	walk->failed = true;
+	str_copy(walk->problem, problem, sizeof(walk->problem));
+}
+
+static void
+summary_expect(WALSummaryWalk *walk, SummaryState state, size_t want)
+{
+	walk->state = (int) state;
+	walk->item_have = 0;
+	walk->item_want = want;
+}
+
+/* One complete item of the current state is in walk->item */
+static void
+summary_item(WALSummaryWalk *walk)
+{
+	char     problem[sizeof(walk->problem)];
+	uint32_t value;
+
+	switch ((SummaryState) walk->state)
+	{
+		case SUMMARY_MAGIC:
+			value = read_u32(walk->item);
+			if (value != WAL_SUMMARY_MAGIC)
+			{
+				snprintf(problem, sizeof(problem), "bad magic number %08X", value);
+				summary_fail(walk, problem);
+				return;
+			}
+			summary_expect(walk, SUMMARY_ENTRY, SUMMARY_ENTRY_SIZE);
+			break;
+
+		case SUMMARY_ENTRY:
+		{
+			uint32_t forknum = read_u32(walk->item + SUMMARY_FORKNUM_OFFSET);
+
+			/* A zero relation number ends the entries */
+			if (read_u32(walk->item + SUMMARY_RELNUMBER_OFFSET) == 0)
+			{
+				summary_expect(walk, SUMMARY_CRC, sizeof(uint32_t));
+				break;
+			}
+			if (forknum > SUMMARY_MAX_FORKNUM)
+			{
+				snprintf(problem, sizeof(problem),
+						 "entry %llu has invalid fork number %u",
+						 (unsigned long long) walk->relations, forknum);
+				summary_fail(walk, problem);
+				return;
+			}
+			walk->relations++;
+			walk->chunks_left = read_u32(walk->item + SUMMARY_NCHUNKS_OFFSET);
+			walk->skip = 0;
+			if (walk->chunks_left > 0)
+				summary_expect(walk, SUMMARY_USAGE, sizeof(uint16_t));
+			else
+				summary_expect(walk, SUMMARY_ENTRY, SUMMARY_ENTRY_SIZE);
+			break;
+		}
+
+		case SUMMARY_USAGE:
+		{
+			uint16_t usage;
+
+			memcpy(&usage, walk->item, sizeof(usage));
+			if (usage > SUMMARY_MAX_CHUNK_ENTRIES)
+			{
+				snprintf(problem, sizeof(problem),
+						 "entry %llu has a chunk of %u entries",
+						 (unsigned long long) (walk->relations - 1), usage);
+				summary_fail(walk, problem);
+				return;
+			}
+			walk->skip += (uint64_t) usage * sizeof(uint16_t);
+			if (--walk->chunks_left > 0)
+				summary_expect(walk, SUMMARY_USAGE, sizeof(uint16_t));
+			else if (walk->skip > 0)
+				summary_expect(walk, SUMMARY_CHUNKS, 0);
+			else
+				summary_expect(walk, SUMMARY_ENTRY, SUMMARY_ENTRY_SIZE);
+			break;
+		}
+
+		case SUMMARY_CRC:
+			value = read_u32(walk->item);
+			if (value != ~walk->crc)
+			{
+				snprintf(problem, sizeof(problem),
+						 "CRC32C mismatch (stored %08X, computed %08X)",
+						 value, ~walk->crc);
+				summary_fail(walk, problem);
+				return;
+			}
+			summary_expect(walk, SUMMARY_DONE, 0);
+			break;
+
+		default:
+			break;
+	}
+}
+
+void
+wal_summary_walk_init(WALSummaryWalk *walk)
+{
+	memset(walk, 0, sizeof(*walk));
+	walk->crc = ~0U;
+	summary_expect(walk, SUMMARY_MAGIC, sizeof(uint32_t));
+}
+
+void
+wal_summary_walk_update(WALSummaryWalk *walk, const uint8_t *buf, size_t len)
+{
+	while (len > 0 && !walk->failed)
+	{
+		size_t n;
+
+		if (walk->state == SUMMARY_DONE)
+		{
+			summary_fail(walk, "data after the checksum");
+			return;
+		}
+
+		if (walk->state == SUMMARY_CHUNKS)
+		{
+			n = walk->skip < len ? (size_t) walk->skip : len;
+			walk->skip -= n;
+			if (walk->skip == 0)
+				summary_expect(walk, SUMMARY_ENTRY, SUMMARY_ENTRY_SIZE);
+		}
+		else
+		{
+			n = walk->item_want - walk->item_have;
+			if (n > len)
+				n = len;
+			memcpy(walk->item + walk->item_have, buf, n);
+			walk->item_have += n;
+		}
+
+		/* The stored CRC covers everything before it */
+		if (walk->state != SUMMARY_CRC)
+			walk->crc = crc32c_update(walk->crc, buf, n);
+		walk->bytes += n;
+		buf += n;
+		len -= n;
+
+		if (walk->state != SUMMARY_CHUNKS && walk->item_want > 0 &&
+			walk->item_have == walk->item_want)
+			summary_item(walk);
+	}
+}
+
+bool
+wal_summary_walk_finish(WALSummaryWalk *walk)
+{
+	char problem[sizeof(walk->problem)];
+
+	if (walk->failed)
+		return false;
+	if (walk->state != SUMMARY_DONE)
+	{
+		snprintf(problem, sizeof(problem), "truncated at %llu bytes",
+				 (unsigned long long) walk->bytes);
+		summary_fail(walk, problem);
+		return false;
+	}
+	return true;
+}
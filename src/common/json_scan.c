@@ -0,0 +1,379 @@
+/*
+ * json_scan.c
+ *
+ * Single-pass extraction of fields from flat JSON objects
+ *
+ * The scanner moves over the input once.  The expensive steps are
+ * finding the end of a string and of a scalar; both are a search for
+ * one of a few bytes (memchr() for the closing quote, a byte-class table
+ * for delimiters), which compilers and libc vectorize.  Keys are matched
+ * against the wanted list by length first, so most comparisons are a
+ * single integer test.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "json_scan.h"
+#include <string.h>
+#include <strings.h>
+
+/* Bytes that end a number, true, false or null */
+static bool
+is_scalar_end(char ch)
+{
+	switch (ch)
+	{
+		case ',': case '}': case ']': case ':':
+		case ' ': case '\t': case '\r': case '\n':
+			return true;
+		default:
+			return false;
+	}
+}
+
+void
+json_skip_ws(JsonCursor *c)
+{
+	while (c->p < c->end &&
+		   (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r'))
+		c->p++;
+}
+
+char
+json_peek(const JsonCursor *c)
+{
+	return c->p < c->end ? *c->p : '\0';
+}
+
+bool
+json_scan_string(JsonCursor *c, JsonSlice *out)
+{
+	const char *start = c->p + 1;
+	const char *from = start;
+
+	for (;;)
+	{
+		const char *q = from < c->end ? memchr(from, '"', (size_t) (c->end - from)) : NULL;
+		const char *p;
+
+		if (q == NULL)
+			return false;
+
+		/* A quote after an odd number of backslashes is escaped */
+		for (p = q; p > start && p[-1] == '\\'; p--)
+			;
+		if ((q - p) % 2 == 0)
+		{
+			out->ptr = start;
+			out->len = (size_t) (q - start);
+			c->p = q + 1;
+			return true;
+		}
+		from = q + 1;
+	}
+}
+
+bool
+json_skip_value(JsonCursor *c, JsonSlice *out)
+{
+	JsonSlice   s;
+	const char *start;
+	int         depth = 0;
+
+	json_skip_ws(c);
+	start = c->p;
+	do
+	{
+		char ch;
+
+		json_skip_ws(c);
+		ch = json_peek(c);
+		if (ch == '"')
+		{
+			if (!json_scan_string(c, &s))
+				return false;
+			if (depth == 0 && out != NULL)
+			{
+				*out = s;
+				return true;
+			}
+		}
+		else if (ch == '{' || ch == '[')
+		{
+			depth++;
+			c->p++;
+		}
+		else if (ch == '}' || ch == ']')
+		{
+			if (depth == 0)
+				return false;
+			depth--;
+			c->p++;
+		}
+		else if (ch == ',' || ch == ':')
+		{
+			if (depth == 0)
+				return false;
+			c->p++;
+		}
+		else
+		{
+			const char *from = c->p;
+
+			while (c->p < c->end && !is_scalar_end(*c->p))
+				c->p++;
+			if (c->p == from)
+				return false;
+		}
+	} while (depth > 0);
+
+	if (out != NULL)
+	{
+		out->ptr = start;
+		out->len = (size_t) (c->p - start);
+	}
+	return true;
+}
+
+bool
+json_scan_object(JsonCursor *c, const char *const *keys, int nkeys,
+				 JsonSlice *values)
+{
+	size_t key_len[64];
+
+	if (nkeys > (int) (sizeof(key_len) / sizeof(key_len[0])))
+		return false;
+	for (int i = 0; i < nkeys; i++)
+	{
+		values[i].ptr = NULL;
+		values[i].len = 0;
+		key_len[i] = strlen(keys[i]);
+	}
+
+	json_skip_ws(c);
+	if (json_peek(c) != '{')
+		return false;
+	c->p++;
+
+	for (;;)
+	{
+		JsonSlice key;
+		JsonSlice value;
+		char      ch;
+
+		json_skip_ws(c);
+		ch = json_peek(c);
+		if (ch == '}')
+		{
+			c->p++;
+			return true;
+		}
+		if (ch == ',')
+		{
+			c->p++;
+			continue;
+		}
+		if (ch != '"' || !json_scan_string(c, &key))
+			return false;
+		json_skip_ws(c);
+		if (json_peek(c) != ':')
+			return false;
+		c->p++;
+		if (!json_skip_value(c, &value))
+			return false;
+
+		for (int i = 0; i < nkeys; i++)
+		{
+			if (key.len == key_len[i] && memcmp(key.ptr, keys[i], key.len) == 0)
+			{
+				values[i] = value;
+				break;
+			}
+		}
+	}
+}
+
+bool
+json_get_fields(const char *json, const char *const *keys, int nkeys,
+				JsonSlice *values)
+{
+	JsonCursor c;
+
+	if (json == NULL)
+		return false;
+	c.p = json;
+	c.end = json + strlen(json);
+	return json_scan_object(&c, keys, nkeys, values);
+}
+
+bool
+json_slice_copy(JsonSlice s, char *buf, size_t bufsize)
+{
+	size_t len;
+
+	if (s.ptr == NULL || bufsize == 0)
+		return false;
+	len = s.len < bufsize ? s.len : bufsize - 1;
+	memcpy(buf, s.ptr, len);
+	buf[len] = '\0';
+	return true;
+}
+
+/* Four hex digits at 'p'; -1 if they are not */
+static long
+hex4(const char *p)
+{
+	long v = 0;
+
+	for (int i = 0; i < 4; i++)
+	{
+		char c = p[i];
+
+		v <<= 4;
+		if (c >= '0' && c <= '9')
+			v |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			v |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			v |= c - 'A' + 10;
+		else
+			return -1;
+	}
+	return v;
+}
+
+bool
+json_slice_unescape(JsonSlice s, char *buf, size_t bufsize)
+{
+	const char *p;
+	const char *end;
+	size_t      n = 0;
+
+	if (s.ptr == NULL || bufsize == 0)
+		return false;
+
+	for (p = s.ptr, end = s.ptr + s.len; p < end; p++)
+	{
+		char   out[4];
+		size_t len = 1;
+
+		out[0] = *p;
+		if (*p == '\\')
+		{
+			if (++p == end)
+				return false;
+			switch (*p)
+			{
+				case '"':
+				case '\\':
+				case '/':  out[0] = *p; break;
+				case 'b':  out[0] = '\b'; break;
+				case 'f':  out[0] = '\f'; break;
+				case 'n':  out[0] = '\n'; break;
+				case 'r':  out[0] = '\r'; break;
+				case 't':  out[0] = '\t'; break;
+				case 'u':
+					{
+						long cp;
+
+						if (end - p < 5 || (cp = hex4(p + 1)) < 0)
+							return false;
+						p += 4;
+						/* A high surrogate must be followed by a low one */
+						if (cp >= 0xD800 && cp <= 0xDBFF)
+						{
+							long lo;
+
+							if (end - p < 7 || p[1] != '\\' || p[2] != 'u' ||
+								(lo = hex4(p + 3)) < 0xDC00 || lo > 0xDFFF)
+								return false;
+							cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+							p += 6;
+						}
+						else if (cp >= 0xDC00 && cp <= 0xDFFF)
+							return false;
+
+						if (cp < 0x80)
+							out[0] = (char) cp;
+						else if (cp < 0x800)
+						{
+							out[0] = (char) (0xC0 | (cp >> 6));
+							out[1] = (char) (0x80 | (cp & 0x3F));
+							len = 2;
+						}
+						else if (cp < 0x10000)
+						{
+							out[0] = (char) (0xE0 | (cp >> 12));
+							out[1] = (char) (0x80 | ((cp >> 6) & 0x3F));
+							out[2] = (char) (0x80 | (cp & 0x3F));
+							len = 3;
+						}
+						else
+						{
+							out[0] = (char) (0xF0 | (cp >> 18));
+							out[1] = (char) (0x80 | ((cp >> 12) & 0x3F));
+							out[2] = (char) (0x80 | ((cp >> 6) & 0x3F));
+							out[3] = (char) (0x80 | (cp & 0x3F));
+							len = 4;
+						}
+						break;
+					}
+				default:
+					return false;
+			}
+		}
+
+		/* Truncate on a character boundary */
+		if (n + len > bufsize - 1)
+			break;
+		memcpy(buf + n, out, len);
+		n += len;
+	}
+	buf[n] = '\0';
+	return true;
+}
+
+bool
+json_slice_to_uint64(JsonSlice s, uint64_t *out)
+{
+	uint64_t v = 0;
+
+	if (s.ptr == NULL || s.len == 0)
+		return false;
+	for (size_t i = 0; i < s.len; i++)
+	{
+		if (s.ptr[i] < '0' || s.ptr[i] > '9')
+			return false;
+		v = v * 10 + (uint64_t) (s.ptr[i] - '0');
+	}
+	*out = v;
+	return true;
+}
+
+bool
+json_slice_eq(JsonSlice s, const char *str)
+{
+	return s.ptr != NULL && strlen(str) == s.len && memcmp(s.ptr, str, s.len) == 0;
+}
+
+bool
+json_slice_case_eq(JsonSlice s, const char *str)
+{
+	return s.ptr != NULL && strlen(str) == s.len &&
+		strncasecmp(s.ptr, str, s.len) == 0;
+}
@@ -3,6 +3,13 @@
  *
  * Logging functionality
  *
+ * Each message is formatted, prefix and newline included, into a buffer
+ * of the calling thread and handed to the kernel in one write(), so lines
+ * from parallel workers never interleave and nothing waits on a stdio
+ * lock or a flush.  With log_set_async() the lines are appended to a
+ * shared buffer instead and a writer thread drains it in large writes;
+ * log_cleanup() writes out whatever is left.
+ *
  * Copyright (C) 2026 Daria Lepikhova
  *
  * This program is free software: you can redistribute it and/or modify
@@ -19,15 +26,49 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _POSIX_C_SOURCE 200809L
 
 #include "pg_backup_auditor.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+
+#undef log_debug
+
+/* Longest line written; longer messages are cut and end in "..." */
+#define LOG_LINE_MAX        4096
+
+/* Bytes the async writer may fall behind before loggers wait */
+#define LOG_QUEUE_SIZE      (256 * 1024)
 
-static LogLevel current_log_level = LOG_INFO;
-static FILE *log_file = NULL;
+LogLevel log_min_level = LOG_INFO;
+static int  log_fd = STDERR_FILENO;
+static bool log_timestamps = false;    /* only in log files */
+
+static _Thread_local char line_buf[LOG_LINE_MAX];
+
+/* Async writer: loggers append to 'pending', the writer swaps it out */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t  not_empty;
+	pthread_cond_t  not_full;
+	pthread_t       thread;
+	bool            running;
+	bool            stop;
+	char           *pending;
+	size_t          pending_len;
+	char           *spare;
+} writer = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.not_empty = PTHREAD_COND_INITIALIZER,
+	.not_full = PTHREAD_COND_INITIALIZER
+};
 
 /* Global color support flag */
 bool use_color = true;
@@ -38,8 +79,8 @@ bool use_color = true;
 void
 log_init(void)
 {
-	if (log_file == NULL)
-		log_file = stderr;
+	log_fd = STDERR_FILENO;
+	log_timestamps = false;
 }
 
 /*
@@ -48,22 +89,151 @@ log_init(void)
 void
 log_set_level(LogLevel level)
 {
-	current_log_level = level;
+	log_min_level = level;
+}
+
+bool
+log_level_enabled(LogLevel level)
+{
+	return level >= log_min_level;
 }
 
 /*
- * Set log output file
+ * Set log output file.  Lines are appended with O_APPEND, so several
+ * processes can share one file.  Call before log_set_async().
  */
-void
+bool
 log_set_file(const char *filename)
 {
-	FILE *f = fopen(filename, "a");
-	if (f != NULL)
+	int fd = open(filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+	if (fd < 0)
+		return false;
+	if (log_fd != STDERR_FILENO)
+		close(log_fd);
+	log_fd = fd;
+	log_timestamps = true;
+	return true;
+}
+
+static void
+write_all(int fd, const char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t n = write(fd, buf, len);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;             /* nowhere left to report it */
+		buf += n;
+		len -= (size_t) n;
+	}
+}
+
+static void *
+writer_main(void *arg)
+{
+	(void) arg;
+
+	pthread_mutex_lock(&writer.lock);
+	for (;;)
+	{
+		char   *out;
+		size_t  len;
+
+		while (writer.pending_len == 0 && !writer.stop)
+			pthread_cond_wait(&writer.not_empty, &writer.lock);
+		if (writer.pending_len == 0)
+			break;
+
+		out = writer.pending;
+		len = writer.pending_len;
+		writer.pending = writer.spare;
+		writer.pending_len = 0;
+		pthread_cond_broadcast(&writer.not_full);
+
+		pthread_mutex_unlock(&writer.lock);
+		write_all(log_fd, out, len);
+		pthread_mutex_lock(&writer.lock);
+		writer.spare = out;
+	}
+	pthread_mutex_unlock(&writer.lock);
+	return NULL;
+}
+
+/*
+ * Hand lines to a writer thread instead of writing them in the caller.
+ * Returns false, and keeps logging synchronously, if it cannot start.
+ */
+bool
+log_set_async(bool async)
+{
+	if (!async)
+	{
+		log_flush();
+		return true;
+	}
+	if (writer.running)
+		return true;
+
+	writer.pending = malloc(LOG_QUEUE_SIZE);
+	writer.spare = malloc(LOG_QUEUE_SIZE);
+	writer.pending_len = 0;
+	writer.stop = false;
+	if (writer.pending == NULL || writer.spare == NULL ||
+		pthread_create(&writer.thread, NULL, writer_main, NULL) != 0)
+	{
+		free(writer.pending);
+		free(writer.spare);
+		writer.pending = writer.spare = NULL;
+		return false;
+	}
+	writer.running = true;
+	return true;
+}
+
+/* Stop the writer thread, if any, once everything queued is written */
+void
+log_flush(void)
+{
+	if (!writer.running)
+		return;
+
+	pthread_mutex_lock(&writer.lock);
+	writer.stop = true;
+	pthread_cond_signal(&writer.not_empty);
+	pthread_mutex_unlock(&writer.lock);
+	pthread_join(writer.thread, NULL);
+
+	writer.running = false;
+	free(writer.pending);
+	free(writer.spare);
+	writer.pending = writer.spare = NULL;
+}
+
+static void
+emit(const char *line, size_t len)
+{
+	bool queued = false;
+
+	if (writer.running)
 	{
-		if (log_file != NULL && log_file != stderr)
-			fclose(log_file);
-		log_file = f;
+		pthread_mutex_lock(&writer.lock);
+		while (writer.pending_len + len > LOG_QUEUE_SIZE && !writer.stop)
+			pthread_cond_wait(&writer.not_full, &writer.lock);
+		if (!writer.stop)
+		{
+			memcpy(writer.pending + writer.pending_len, line, len);
+			writer.pending_len += len;
+			pthread_cond_signal(&writer.not_empty);
+			queued = true;
+		}
+		pthread_mutex_unlock(&writer.lock);
 	}
+	if (!queued)
+		write_all(log_fd, line, len);
 }
 
 /*
@@ -73,16 +243,13 @@ static void
 log_message(LogLevel level, const char *fmt, va_list args)
 {
 	const char *level_str;
-	time_t now;
-	struct tm *tm_info;
-	char time_buf[64];
+	char       *buf = line_buf;
+	size_t      len = 0;
+	int         n;
 
-	if (level < current_log_level)
+	if (level < log_min_level)
 		return;
 
-	if (log_file == NULL)
-		log_file = stderr;
-
 	/* Level string */
 	switch (level)
 	{
@@ -104,18 +271,32 @@ log_message(LogLevel level, const char *fmt, va_list args)
 	}
 
 	/* Timestamp if logging to file */
-	if (log_file != stderr)
+	if (log_timestamps)
+	{
+		time_t    now = time(NULL);
+		struct tm tm_info;
+
+		if (localtime_r(&now, &tm_info) != NULL)
+			len = strftime(buf, LOG_LINE_MAX, "[%Y-%m-%d %H:%M:%S] ", &tm_info);
+	}
+
+	n = snprintf(buf + len, LOG_LINE_MAX - len, "[%s] ", level_str);
+	len += (size_t) n;
+	n = vsnprintf(buf + len, LOG_LINE_MAX - len, fmt, args);
+	if (n < 0)
+		n = 0;
+
+	/* Room is kept for the newline; a cut message ends in "..." */
+	if ((size_t) n >= LOG_LINE_MAX - len - 1)
 	{
-		time(&now);
-		tm_info = localtime(&now);
-		strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", tm_info);
-		fprintf(log_file, "[%s] ", time_buf);
+		len = LOG_LINE_MAX - 1;
+		memcpy(buf + len - 3, "...", 3);
 	}
+	else
+		len += (size_t) n;
+	buf[len++] = '\n';
 
-	fprintf(log_file, "[%s] ", level_str);
-	vfprintf(log_file, fmt, args);
-	fprintf(log_file, "\n");
-	fflush(log_file);
+	emit(buf, len);
 }
 
 /*
@@ -163,7 +344,8 @@ log_error(const char *fmt, ...)
 void
 log_cleanup(void)
 {
-	if (log_file != NULL && log_file != stderr)
-		fclose(log_file);
-	log_file = NULL;
+	log_flush();
+	if (log_fd != STDERR_FILENO)
+		close(log_fd);
+	log_init();
 }
@@ -0,0 +1,415 @@
+/*
+ * metrics.c
+ *
+ * Process-wide counters and their Prometheus text exposition
+ *
+ * Every counter is a 64-bit integer updated with an atomic add; times
+ * are kept in nanoseconds and written out as seconds.  A counter costs
+ * one clock read and one add per file or segment, next to reading it.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+#include "pg_backup_auditor.h"
+#include "validation_result.h"
+#include "buffer_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define METRIC_PREFIX "pg_backup_auditor_"
+
+static uint64_t phase_ns[METRIC_PHASE_COUNT];
+static uint64_t verified_bytes[METRIC_ALG_COUNT][METRIC_TARGET_COUNT];
+static uint64_t verified_ns[METRIC_ALG_COUNT][METRIC_TARGET_COUNT];
+static uint64_t counters[METRIC_COUNTER_COUNT];
+static uint64_t io[METRIC_PHASE_COUNT + 1][METRIC_IO_COUNT];
+
+static _Thread_local MetricPhase thread_phase = METRIC_PHASE_COUNT;
+
+static const char *const phase_names[METRIC_PHASE_COUNT + 1] = {
+	"scan", "metadata", "wal_inventory", "structure", "checksum", "wal",
+	"analysis", "other"
+};
+
+static const struct {
+	const char *name;
+	const char *help;
+} io_info[METRIC_IO_COUNT] = {
+	{ "read_bytes_total",   "Bytes read from files, per phase." },
+	{ "files_opened_total", "Files opened for reading, per phase." },
+	{ "syscalls_total",     "open, read, mmap and io_uring_enter calls of the unbuffered readers, per phase." },
+	{ "forks_total",        "External decompressors started, per phase." }
+};
+
+static const char *const algorithm_names[METRIC_ALG_COUNT] = {
+	"crc32c", "sha1", "sha256", "page"
+};
+
+static const char *const target_names[METRIC_TARGET_COUNT] = {
+	"file", "wal"
+};
+
+/* Name and help text of each counter */
+static const struct {
+	const char *name;
+	const char *help;
+} counter_info[METRIC_COUNTER_COUNT] = {
+	{ "backups_scanned_total",      "Backups whose metadata was parsed." },
+	{ "backups_validated_total",    "Backups validated." },
+	{ "files_checked_total",        "Backup files checked against their manifest." },
+	{ "wal_segments_checked_total", "WAL segments read and checked." },
+	{ "wal_records_checked_total",  "WAL records whose CRC was checked." }
+};
+
+uint64_t
+metrics_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+void
+metrics_phase_add(MetricPhase phase, uint64_t start)
+{
+	uint64_t now = metrics_clock();
+
+	if (phase < METRIC_PHASE_COUNT && now > start)
+		__atomic_fetch_add(&phase_ns[phase], now - start, __ATOMIC_RELAXED);
+}
+
+void
+metrics_phase_begin(MetricSpan *span, MetricPhase phase)
+{
+	span->start = metrics_clock();
+	span->phase = phase;
+	span->prev = thread_phase;
+	thread_phase = phase;
+}
+
+void
+metrics_phase_end(const MetricSpan *span)
+{
+	metrics_phase_add(span->phase, span->start);
+	thread_phase = span->prev;
+}
+
+MetricPhase
+metrics_thread_phase(void)
+{
+	return thread_phase;
+}
+
+void
+metrics_set_thread_phase(MetricPhase phase)
+{
+	thread_phase = phase <= METRIC_PHASE_COUNT ? phase : METRIC_PHASE_COUNT;
+}
+
+void
+metrics_io(MetricIo what, uint64_t n)
+{
+	if (what < METRIC_IO_COUNT)
+		__atomic_fetch_add(&io[thread_phase][what], n, __ATOMIC_RELAXED);
+}
+
+void
+metrics_io_stream(FILE *fp)
+{
+	off_t pos = ftello(fp);
+
+	metrics_io(METRIC_IO_FILES_OPENED, 1);
+	if (pos > 0)
+		metrics_io(METRIC_IO_BYTES_READ, (uint64_t) pos);
+}
+
+void
+metrics_count(MetricCounter counter, uint64_t n)
+{
+	if (counter < METRIC_COUNTER_COUNT)
+		__atomic_fetch_add(&counters[counter], n, __ATOMIC_RELAXED);
+}
+
+double
+metrics_phase_seconds(MetricPhase phase)
+{
+	if (phase >= METRIC_PHASE_COUNT)
+		return 0.0;
+	return (double) __atomic_load_n(&phase_ns[phase], __ATOMIC_RELAXED) / 1e9;
+}
+
+uint64_t
+metrics_phase_io(MetricPhase phase, MetricIo what)
+{
+	if (phase > METRIC_PHASE_COUNT || what >= METRIC_IO_COUNT)
+		return 0;
+	return __atomic_load_n(&io[phase][what], __ATOMIC_RELAXED);
+}
+
+void
+metrics_verified(MetricAlgorithm alg, MetricTarget target, uint64_t bytes,
+				 uint64_t ns)
+{
+	if (alg >= METRIC_ALG_COUNT || target >= METRIC_TARGET_COUNT)
+		return;
+	__atomic_fetch_add(&verified_bytes[alg][target], bytes, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&verified_ns[alg][target], ns, __ATOMIC_RELAXED);
+}
+
+void
+metrics_report_init(MetricsReport *report, const char *command)
+{
+	memset(report, 0, sizeof(*report));
+	report->command = command;
+}
+
+void
+metrics_report_add(MetricsReport *report, const ValidationResult *result)
+{
+	if (result == NULL)
+		return;
+	report->errors += result->error_count;
+	report->warnings += result->warning_count;
+	for (int c = 0; c < VALIDATION_CODE_COUNT; c++)
+		report->codes[c] += result->code_counts[c];
+}
+
+/* WAL records only ever carry CRC32C */
+static bool
+series_exists(int alg, int target)
+{
+	return alg == METRIC_ALG_CRC32C || target == METRIC_TARGET_FILE;
+}
+
+static double
+seconds(uint64_t ns)
+{
+	return (double) ns / 1e9;
+}
+
+static void
+header(FILE *fp, const char *name, const char *type, const char *help)
+{
+	fprintf(fp, "# HELP " METRIC_PREFIX "%s %s\n", name, help);
+	fprintf(fp, "# TYPE " METRIC_PREFIX "%s %s\n", name, type);
+}
+
+void
+metrics_write(FILE *fp, const MetricsReport *report)
+{
+	const char *cmd = report->command != NULL ? report->command : "";
+
+	header(fp, "phase_seconds_total", "counter",
+		   "Time spent per phase, summed over threads.");
+	for (int p = 0; p < METRIC_PHASE_COUNT; p++)
+		fprintf(fp, METRIC_PREFIX "phase_seconds_total{command=\"%s\",phase=\"%s\"} %.6f\n",
+				cmd, phase_names[p],
+				seconds(__atomic_load_n(&phase_ns[p], __ATOMIC_RELAXED)));
+
+	header(fp, "verified_bytes_total", "counter",
+		   "Bytes digested, per algorithm.");
+	for (int a = 0; a < METRIC_ALG_COUNT; a++)
+		for (int t = 0; t < METRIC_TARGET_COUNT; t++)
+			if (series_exists(a, t))
+				fprintf(fp, METRIC_PREFIX "verified_bytes_total{command=\"%s\",algorithm=\"%s\",target=\"%s\"} %llu\n",
+						cmd, algorithm_names[a], target_names[t],
+						(unsigned long long) __atomic_load_n(&verified_bytes[a][t], __ATOMIC_RELAXED));
+
+	header(fp, "verify_seconds_total", "counter",
+		   "Time spent reading and digesting, per algorithm, summed over threads.");
+	for (int a = 0; a < METRIC_ALG_COUNT; a++)
+		for (int t = 0; t < METRIC_TARGET_COUNT; t++)
+			if (series_exists(a, t))
+				fprintf(fp, METRIC_PREFIX "verify_seconds_total{command=\"%s\",algorithm=\"%s\",target=\"%s\"} %.6f\n",
+						cmd, algorithm_names[a], target_names[t],
+						seconds(__atomic_load_n(&verified_ns[a][t], __ATOMIC_RELAXED)));
+
+	/* The same ratio PromQL would take, for a single run's textfile */
+	header(fp, "verify_bytes_per_second", "gauge",
+		   "Bytes digested per second of verification time, per algorithm.");
+	for (int a = 0; a < METRIC_ALG_COUNT; a++)
+	{
+		for (int t = 0; t < METRIC_TARGET_COUNT; t++)
+		{
+			uint64_t ns = __atomic_load_n(&verified_ns[a][t], __ATOMIC_RELAXED);
+			uint64_t bytes = __atomic_load_n(&verified_bytes[a][t], __ATOMIC_RELAXED);
+
+			if (series_exists(a, t))
+				fprintf(fp, METRIC_PREFIX "verify_bytes_per_second{command=\"%s\",algorithm=\"%s\",target=\"%s\"} %.0f\n",
+						cmd, algorithm_names[a], target_names[t],
+						ns > 0 ? (double) bytes / seconds(ns) : 0.0);
+		}
+	}
+
+	for (int c = 0; c < METRIC_COUNTER_COUNT; c++)
+	{
+		header(fp, counter_info[c].name, "counter", counter_info[c].help);
+		fprintf(fp, METRIC_PREFIX "%s{command=\"%s\"} %llu\n",
+				counter_info[c].name, cmd,
+				(unsigned long long) __atomic_load_n(&counters[c], __ATOMIC_RELAXED));
+	}
+
+	for (int i = 0; i < METRIC_IO_COUNT; i++)
+	{
+		header(fp, io_info[i].name, "counter", io_info[i].help);
+		for (int p = 0; p <= METRIC_PHASE_COUNT; p++)
+			fprintf(fp, METRIC_PREFIX "%s{command=\"%s\",phase=\"%s\"} %llu\n",
+					io_info[i].name, cmd, phase_names[p],
+					(unsigned long long) __atomic_load_n(&io[p][i], __ATOMIC_RELAXED));
+	}
+
+	header(fp, "validation_errors", "gauge",
+		   "Validation errors found, by category.");
+	for (int c = 0; c < VALIDATION_CODE_COUNT; c++)
+		fprintf(fp, METRIC_PREFIX "validation_errors{command=\"%s\",category=\"%s\"} %d\n",
+				cmd, validation_code_name((ValidationCode) c), report->codes[c]);
+
+	header(fp, "validation_warnings", "gauge", "Validation warnings found.");
+	fprintf(fp, METRIC_PREFIX "validation_warnings{command=\"%s\"} %d\n",
+			cmd, report->warnings);
+
+	header(fp, "last_run_timestamp_seconds", "gauge",
+		   "When the run, or in watch mode the last round, finished.");
+	fprintf(fp, METRIC_PREFIX "last_run_timestamp_seconds{command=\"%s\"} %lld\n",
+			cmd, (long long) report->finished_at);
+
+	header(fp, "last_run_duration_seconds", "gauge",
+		   "Wall-clock length of the run or last round.");
+	fprintf(fp, METRIC_PREFIX "last_run_duration_seconds{command=\"%s\"} %.6f\n",
+			cmd, report->duration);
+}
+
+bool
+metrics_write_file(const char *path, const MetricsReport *report)
+{
+	char  tmp[PATH_MAX];
+	FILE *fp;
+	bool  ok;
+
+	/* Same directory, so the rename cannot cross file systems */
+	if (snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int) getpid()) >= (int) sizeof(tmp))
+		return false;
+	fp = fopen(tmp, "w");
+	if (fp == NULL)
+	{
+		log_warning("Cannot write metrics file: %s", tmp);
+		return false;
+	}
+	metrics_write(fp, report);
+	ok = !ferror(fp);
+	ok = fclose(fp) == 0 && ok;
+	if (ok && rename(tmp, path) != 0)
+		ok = false;
+	if (!ok)
+	{
+		log_warning("Cannot write metrics file: %s", path);
+		unlink(tmp);
+	}
+	return ok;
+}
+
+/* "1.2 GiB" style, into 'buf' */
+static const char *
+format_bytes(uint64_t bytes, char *buf, size_t size)
+{
+	static const char *const units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+	double value = (double) bytes;
+	int    u = 0;
+
+	while (value >= 1024 && u < 4)
+	{
+		value /= 1024;
+		u++;
+	}
+	snprintf(buf, size, u == 0 ? "%.0f %s" : "%.1f %s", value, units[u]);
+	return buf;
+}
+
+static void
+profile_row(FILE *fp, const char *name, double secs, const uint64_t n[METRIC_IO_COUNT])
+{
+	char bytes[32];
+	char rate[40];
+
+	if (secs > 0 && n[METRIC_IO_BYTES_READ] > 0)
+	{
+		format_bytes((uint64_t) ((double) n[METRIC_IO_BYTES_READ] / secs),
+					 bytes, sizeof(bytes));
+		snprintf(rate, sizeof(rate), "%s/s", bytes);
+	}
+	else
+		snprintf(rate, sizeof(rate), "-");
+
+	fprintf(fp, "  %-14s %9.3fs %12s %8llu %10llu %6llu %12s\n",
+			name, secs,
+			format_bytes(n[METRIC_IO_BYTES_READ], bytes, sizeof(bytes)),
+			(unsigned long long) n[METRIC_IO_FILES_OPENED],
+			(unsigned long long) n[METRIC_IO_SYSCALLS],
+			(unsigned long long) n[METRIC_IO_FORKS], rate);
+}
+
+void
+metrics_profile_write(FILE *fp, double wall)
+{
+	uint64_t        total[METRIC_IO_COUNT] = { 0 };
+	BufferPoolStats pool;
+
+	fprintf(fp, "\nPROFILE\n");
+	fprintf(fp, "  %-14s %10s %12s %8s %10s %6s %12s\n",
+			"Phase", "Time", "Read", "Files", "Syscalls", "Forks", "Throughput");
+	for (int p = 0; p <= METRIC_PHASE_COUNT; p++)
+	{
+		uint64_t n[METRIC_IO_COUNT];
+		double   secs = 0;
+		bool     idle;
+
+		if (p < METRIC_PHASE_COUNT)
+			secs = seconds(__atomic_load_n(&phase_ns[p], __ATOMIC_RELAXED));
+		idle = secs == 0;
+		for (int i = 0; i < METRIC_IO_COUNT; i++)
+		{
+			n[i] = __atomic_load_n(&io[p][i], __ATOMIC_RELAXED);
+			total[i] += n[i];
+			idle = idle && n[i] == 0;
+		}
+		if (!idle)
+			profile_row(fp, phase_names[p], secs, n);
+	}
+	profile_row(fp, "total (wall)", wall, total);
+	fprintf(fp, "  Phase times are summed over threads and include nested phases\n"
+			"  (metadata runs inside scan); I/O is charged to the innermost one.\n");
+
+	buffer_pool_stats(&pool);
+	if (pool.peak > 0)
+	{
+		char peak[32], limit[32];
+
+		if (pool.limit > 0)
+			format_bytes(pool.limit, limit, sizeof(limit));
+		fprintf(fp, "  Read buffers: %s at most%s%s, %llu wait%s, %llu over the limit\n",
+				format_bytes(pool.peak, peak, sizeof(peak)),
+				pool.limit > 0 ? " of a limit of " : " (no limit)",
+				pool.limit > 0 ? limit : "",
+				(unsigned long long) pool.waits, pool.waits == 1 ? "" : "s",
+				(unsigned long long) pool.overdrafts);
+	}
+}
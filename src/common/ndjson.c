@@ -0,0 +1,243 @@
+/*
+ * ndjson.c
+ *
+ * Streaming newline-delimited JSON writer
+ *
+ * Members go straight to the stream; only ndjson_end() flushes, so a
+ * record reaches the reader whole and the per-member cost is a few
+ * buffered stdio calls.  Strings are escaped per RFC 8259; bytes of 0x80
+ * and above are passed through, as paths and messages are UTF-8 or at
+ * least opaque to JSON consumers either way.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "ndjson.h"
+#include "pg_backup_auditor.h"
+#include "adapter.h"
+#include "validation_result.h"
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+
+bool
+output_format_from_string(const char *str, OutputFormat *out)
+{
+	if (strcmp(str, "table") == 0)
+		*out = OUTPUT_TABLE;
+	else if (strcmp(str, "ndjson") == 0 || strcmp(str, "json") == 0)
+		*out = OUTPUT_NDJSON;
+	else
+		return false;
+	return true;
+}
+
+static void
+write_escaped(FILE *fp, const char *s)
+{
+	fputc('"', fp);
+	for (const unsigned char *p = (const unsigned char *) s; *p; p++)
+	{
+		switch (*p)
+		{
+			case '"':  fputs("\\\"", fp); break;
+			case '\\': fputs("\\\\", fp); break;
+			case '\n': fputs("\\n", fp); break;
+			case '\r': fputs("\\r", fp); break;
+			case '\t': fputs("\\t", fp); break;
+			default:
+				if (*p < 0x20)
+					fprintf(fp, "\\u%04x", *p);
+				else
+					fputc(*p, fp);
+				break;
+		}
+	}
+	fputc('"', fp);
+}
+
+/* Separator and key of the next member */
+static void
+member(NdjsonRecord *rec, const char *key)
+{
+	if (!rec->first)
+		fputc(',', rec->fp);
+	rec->first = false;
+	write_escaped(rec->fp, key);
+	fputc(':', rec->fp);
+}
+
+void
+ndjson_begin(NdjsonRecord *rec, FILE *fp, const char *record)
+{
+	rec->fp = fp;
+	rec->first = true;
+	fputc('{', fp);
+	ndjson_string(rec, "record", record);
+}
+
+void
+ndjson_string(NdjsonRecord *rec, const char *key, const char *value)
+{
+	member(rec, key);
+	if (value == NULL)
+		fputs("null", rec->fp);
+	else
+		write_escaped(rec->fp, value);
+}
+
+void
+ndjson_int(NdjsonRecord *rec, const char *key, int64_t value)
+{
+	member(rec, key);
+	fprintf(rec->fp, "%" PRId64, value);
+}
+
+void
+ndjson_uint(NdjsonRecord *rec, const char *key, uint64_t value)
+{
+	member(rec, key);
+	fprintf(rec->fp, "%" PRIu64, value);
+}
+
+void
+ndjson_bool(NdjsonRecord *rec, const char *key, bool value)
+{
+	member(rec, key);
+	fputs(value ? "true" : "false", rec->fp);
+}
+
+void
+ndjson_double(NdjsonRecord *rec, const char *key, double value)
+{
+	member(rec, key);
+	/* JSON has no NaN or infinity */
+	if (isfinite(value))
+		fprintf(rec->fp, "%.6g", value);
+	else
+		fputs("null", rec->fp);
+}
+
+void
+ndjson_null(NdjsonRecord *rec, const char *key)
+{
+	member(rec, key);
+	fputs("null", rec->fp);
+}
+
+void
+ndjson_raw(NdjsonRecord *rec, const char *key, const char *json, size_t len)
+{
+	member(rec, key);
+	fwrite(json, 1, len, rec->fp);
+}
+
+void
+ndjson_time(NdjsonRecord *rec, const char *key, time_t value)
+{
+	char      buf[32];
+	struct tm tm;
+
+	if (value <= 0 || gmtime_r(&value, &tm) == NULL)
+	{
+		ndjson_null(rec, key);
+		return;
+	}
+	strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+	ndjson_string(rec, key, buf);
+}
+
+void
+ndjson_lsn(NdjsonRecord *rec, const char *key, XLogRecPtr value)
+{
+	char buf[32];
+
+	if (value == 0)
+	{
+		ndjson_null(rec, key);
+		return;
+	}
+	format_lsn(value, buf, sizeof(buf));
+	ndjson_string(rec, key, buf);
+}
+
+static const char *
+empty_as_null(const char *s)
+{
+	return s[0] != '\0' ? s : NULL;
+}
+
+void
+ndjson_backup_fields(NdjsonRecord *rec, const BackupInfo *backup)
+{
+	ndjson_string(rec, "backup_id", backup->backup_id);
+	ndjson_string(rec, "instance", empty_as_null(backup->instance_name));
+	ndjson_string(rec, "node", empty_as_null(backup->node_name));
+	ndjson_string(rec, "tool", backup_tool_to_string(backup->tool));
+	ndjson_string(rec, "backup_type", backup_type_to_string(backup->type));
+	ndjson_string(rec, "status", backup_status_to_string(backup->status));
+	ndjson_string(rec, "parent_backup_id", empty_as_null(backup->parent_backup_id));
+	ndjson_string(rec, "path", backup->backup_path);
+	ndjson_time(rec, "start_time", backup->start_time);
+	ndjson_time(rec, "end_time", backup->end_time);
+	ndjson_lsn(rec, "start_lsn", backup->start_lsn);
+	ndjson_lsn(rec, "stop_lsn", backup->stop_lsn);
+	ndjson_uint(rec, "timeline", backup->timeline);
+	if (backup->pg_version > 0)
+		ndjson_uint(rec, "pg_version", backup->pg_version / 10000);
+	else
+		ndjson_null(rec, "pg_version");
+	ndjson_string(rec, "wal_mode", empty_as_null(backup->wal_mode));
+	ndjson_string(rec, "compression", empty_as_null(backup->compress_alg));
+	ndjson_uint(rec, "data_bytes", backup->data_bytes);
+	ndjson_uint(rec, "wal_bytes", backup->wal_bytes);
+}
+
+void
+ndjson_end(NdjsonRecord *rec)
+{
+	fputs("}\n", rec->fp);
+	fflush(rec->fp);
+}
+
+void
+ndjson_findings(FILE *fp, const ValidationResult *result, const char *backup_id,
+				const char *archive, const char *check)
+{
+	for (int pass = 0; pass < 2; pass++)
+	{
+		int           n = pass == 0 ? result->error_count : result->warning_count;
+		char * const *msgs = pass == 0 ? result->errors : result->warnings;
+
+		for (int i = 0; i < n; i++)
+		{
+			NdjsonRecord rec;
+
+			ndjson_begin(&rec, fp, "finding");
+			ndjson_string(&rec, "severity", pass == 0 ? "error" : "warning");
+			ndjson_string(&rec, "backup_id", backup_id);
+			ndjson_string(&rec, "archive", archive);
+			ndjson_string(&rec, "check", check);
+			ndjson_string(&rec, "code", pass == 0 ?
+						  validation_code_name((ValidationCode) result->error_codes[i]) :
+						  NULL);
+			ndjson_string(&rec, "message", msgs[i]);
+			ndjson_end(&rec);
+		}
+	}
+}
@@ -0,0 +1,596 @@
+/*
+ * page_checksum.c
+ *
+ * PostgreSQL data page checksum and header checks, with runtime CPU
+ * dispatch.
+ *
+ * The checksum (storage/checksum_impl.h) treats the page as 64 rows of
+ * 32 uint32 words and folds each column into its own FNV-1a style sum,
+ * starting from fixed offsets; two rounds of zeros mix the last row in,
+ * the 32 sums are XORed together and the block number is XORed in
+ * before reducing to 1..65535.  The columns are independent, so:
+ *   - AVX2 keeps the 32 sums in four 256-bit registers (x86_64)
+ *   - NEON keeps them in eight 128-bit registers (aarch64)
+ *   - the portable loop works on an array (everything else)
+ * Words are read in host byte order, as PostgreSQL does.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "page_checksum.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PAGE_CHECKSUM_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define PAGE_CHECKSUM_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define N_SUMS          32
+#define FNV_PRIME       16777619U
+#define ROW_BYTES       (N_SUMS * sizeof(uint32_t))
+#define ROWS            (PAGE_BLCKSZ / ROW_BYTES)
+
+/* Page header fields (PageHeaderData) */
+#define PD_LSN_OFFSET       0
+#define PD_CHECKSUM_OFFSET  8
+#define PD_FLAGS_OFFSET     10
+#define PD_LOWER_OFFSET     12
+#define PD_UPPER_OFFSET     14
+#define PD_SPECIAL_OFFSET   16
+#define PD_VALID_FLAG_BITS  0x0007
+#define PAGE_MAXALIGN       8
+
+/* pg_probackup's BackupPageHeader: block number and stored size */
+#define FRAME_HEADER_SIZE   8
+
+/* pg_control: floatFormat, then data_checksum_version this far after it */
+#define FLOATFORMAT_VALUE           1234567.0
+#define CONTROL_CHECKSUM_OFFSET     44
+
+static const uint32_t checksum_base_offsets[N_SUMS] = {
+	0x5B1F36E9, 0xB8525960, 0x02AB50AA, 0x1DE66D2A,
+	0x79FF467A, 0x9BB9F8A3, 0x217E7CD2, 0x83E13D2C,
+	0xF8D4474F, 0xE39EB970, 0x42C6AE16, 0x993216FA,
+	0x7B093B5D, 0x98DAFF3C, 0xF718902A, 0x0B1C9CDB,
+	0xE58F764B, 0x187636BC, 0x5D7B3BB1, 0xE73DE7DE,
+	0x92BEC979, 0xCCA6C0B2, 0x304A0979, 0x85AA43D4,
+	0x783125BB, 0x6CA8EAA2, 0xE407EAC6, 0x4B5CFC3E,
+	0x9FBF8C76, 0x15CA20BE, 0xF2CA9FD3, 0x959BD756
+};
+
+/*
+ * Sum of the page, whose first row is passed separately as 'row0' with
+ * pd_checksum cleared; rows 1.. are read from 'page'.
+ */
+typedef uint32_t (*checksum_block_fn)(const uint32_t *row0, const uint8_t *page);
+
+static pthread_once_t    page_checksum_once = PTHREAD_ONCE_INIT;
+static checksum_block_fn page_checksum_impl = NULL;
+static const char       *page_checksum_impl_label = "portable";
+
+#define CHECKSUM_COMP(sum, value) \
+	do { \
+		uint32_t tmp_ = (sum) ^ (value); \
+		(sum) = tmp_ * FNV_PRIME ^ (tmp_ >> 17); \
+	} while (0)
+
+static uint32_t
+checksum_block_sw(const uint32_t *row0, const uint8_t *page)
+{
+	uint32_t sums[N_SUMS];
+	uint32_t row[N_SUMS];
+	uint32_t result = 0;
+
+	memcpy(sums, checksum_base_offsets, sizeof(sums));
+
+	for (int j = 0; j < N_SUMS; j++)
+		CHECKSUM_COMP(sums[j], row0[j]);
+	for (size_t i = 1; i < ROWS; i++)
+	{
+		memcpy(row, page + i * ROW_BYTES, ROW_BYTES);
+		for (int j = 0; j < N_SUMS; j++)
+			CHECKSUM_COMP(sums[j], row[j]);
+	}
+
+	for (int i = 0; i < 2; i++)
+		for (int j = 0; j < N_SUMS; j++)
+			CHECKSUM_COMP(sums[j], 0);
+
+	for (int j = 0; j < N_SUMS; j++)
+		result ^= sums[j];
+	return result;
+}
+
+#ifdef PAGE_CHECKSUM_HAVE_AVX2
+__attribute__((target("avx2")))
+static __m256i
+checksum_comp_avx2(__m256i sum, __m256i value)
+{
+	__m256i tmp = _mm256_xor_si256(sum, value);
+
+	return _mm256_xor_si256(_mm256_mullo_epi32(tmp, _mm256_set1_epi32((int) FNV_PRIME)),
+							_mm256_srli_epi32(tmp, 17));
+}
+
+__attribute__((target("avx2")))
+static uint32_t
+checksum_block_avx2(const uint32_t *row0, const uint8_t *page)
+{
+	__m256i sums[4];
+	__m256i zero = _mm256_setzero_si256();
+	__m256i all;
+	__m128i half;
+
+	for (int k = 0; k < 4; k++)
+	{
+		sums[k] = _mm256_loadu_si256((const __m256i *) (checksum_base_offsets + 8 * k));
+		sums[k] = checksum_comp_avx2(sums[k],
+									 _mm256_loadu_si256((const __m256i *) (row0 + 8 * k)));
+	}
+
+	for (size_t i = 1; i < ROWS; i++)
+	{
+		const uint8_t *row = page + i * ROW_BYTES;
+
+		for (int k = 0; k < 4; k++)
+			sums[k] = checksum_comp_avx2(sums[k],
+										 _mm256_loadu_si256((const __m256i *) (row + 32 * k)));
+	}
+
+	for (int i = 0; i < 2; i++)
+		for (int k = 0; k < 4; k++)
+			sums[k] = checksum_comp_avx2(sums[k], zero);
+
+	all = _mm256_xor_si256(_mm256_xor_si256(sums[0], sums[1]),
+						   _mm256_xor_si256(sums[2], sums[3]));
+	half = _mm_xor_si128(_mm256_castsi256_si128(all),
+						 _mm256_extracti128_si256(all, 1));
+	half = _mm_xor_si128(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_xor_si128(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	return (uint32_t) _mm_cvtsi128_si32(half);
+}
+#endif /* PAGE_CHECKSUM_HAVE_AVX2 */
+
+#ifdef PAGE_CHECKSUM_HAVE_NEON
+static uint32x4_t
+checksum_comp_neon(uint32x4_t sum, uint32x4_t value)
+{
+	uint32x4_t tmp = veorq_u32(sum, value);
+
+	return veorq_u32(vmulq_n_u32(tmp, FNV_PRIME), vshrq_n_u32(tmp, 17));
+}
+
+static uint32_t
+checksum_block_neon(const uint32_t *row0, const uint8_t *page)
+{
+	uint32x4_t sums[8];
+	uint32x4_t zero = vdupq_n_u32(0);
+	uint32x4_t all;
+
+	for (int k = 0; k < 8; k++)
+		sums[k] = checksum_comp_neon(vld1q_u32(checksum_base_offsets + 4 * k),
+									 vld1q_u32(row0 + 4 * k));
+
+	/* Byte loads: rows need not be word aligned in a read buffer */
+	for (size_t i = 1; i < ROWS; i++)
+	{
+		const uint8_t *row = page + i * ROW_BYTES;
+
+		for (int k = 0; k < 8; k++)
+			sums[k] = checksum_comp_neon(sums[k],
+										 vreinterpretq_u32_u8(vld1q_u8(row + 16 * k)));
+	}
+
+	for (int i = 0; i < 2; i++)
+		for (int k = 0; k < 8; k++)
+			sums[k] = checksum_comp_neon(sums[k], zero);
+
+	all = sums[0];
+	for (int k = 1; k < 8; k++)
+		all = veorq_u32(all, sums[k]);
+	return vgetq_lane_u32(all, 0) ^ vgetq_lane_u32(all, 1) ^
+		   vgetq_lane_u32(all, 2) ^ vgetq_lane_u32(all, 3);
+}
+#endif /* PAGE_CHECKSUM_HAVE_NEON */
+
+static void
+page_checksum_select(checksum_block_fn fn, const char *label)
+{
+	page_checksum_impl_label = label;
+	__atomic_store_n(&page_checksum_impl, fn, __ATOMIC_RELEASE);
+}
+
+static void
+page_checksum_pick(void)
+{
+#if defined(PAGE_CHECKSUM_HAVE_AVX2)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		page_checksum_select(checksum_block_avx2, "avx2");
+		return;
+	}
+#elif defined(PAGE_CHECKSUM_HAVE_NEON)
+	/* Advanced SIMD is part of every ARMv8-A core */
+	page_checksum_select(checksum_block_neon, "neon");
+	return;
+#endif
+
+	page_checksum_select(checksum_block_sw, "portable");
+}
+
+void
+page_checksum_init(void)
+{
+	pthread_once(&page_checksum_once, page_checksum_pick);
+}
+
+const char *
+page_checksum_implementation(void)
+{
+	page_checksum_init();
+	return page_checksum_impl_label;
+}
+
+/* The first row, with pd_checksum zeroed as pg_checksum_page() does */
+static void
+first_row(const uint8_t *page, uint32_t *row0)
+{
+	memcpy(row0, page, ROW_BYTES);
+	memset((uint8_t *) row0 + PD_CHECKSUM_OFFSET, 0, sizeof(uint16_t));
+}
+
+static uint16_t
+checksum_reduce(uint32_t sum, uint32_t blkno)
+{
+	/* Mix in the block number to detect transposed pages */
+	sum ^= blkno;
+	return (uint16_t) ((sum % 65535) + 1);
+}
+
+uint16_t
+page_checksum(const uint8_t *page, uint32_t blkno)
+{
+	checksum_block_fn fn = __atomic_load_n(&page_checksum_impl, __ATOMIC_ACQUIRE);
+	uint32_t          row0[N_SUMS];
+
+	if (fn == NULL)
+	{
+		page_checksum_init();
+		fn = page_checksum_impl;
+	}
+
+	first_row(page, row0);
+	return checksum_reduce(fn(row0, page), blkno);
+}
+
+uint16_t
+page_checksum_sw(const uint8_t *page, uint32_t blkno)
+{
+	uint32_t row0[N_SUMS];
+
+	first_row(page, row0);
+	return checksum_reduce(checksum_block_sw(row0, page), blkno);
+}
+
+PageChecksums
+page_checksums_from_control(const uint8_t *buf, size_t len)
+{
+	const double format = FLOATFORMAT_VALUE;
+
+	if (buf == NULL)
+		return PAGE_CHECKSUMS_UNKNOWN;
+
+	/* floatFormat is a double, so 8-byte aligned in ControlFileData */
+	for (size_t off = 0; off + CONTROL_CHECKSUM_OFFSET + 4 <= len; off += 8)
+	{
+		uint32_t blcksz;
+		uint32_t version;
+
+		if (memcmp(buf + off, &format, sizeof(format)) != 0)
+			continue;
+		memcpy(&blcksz, buf + off + 8, sizeof(blcksz));
+		if (blcksz != PAGE_BLCKSZ)
+			return PAGE_CHECKSUMS_UNKNOWN;
+
+		memcpy(&version, buf + off + CONTROL_CHECKSUM_OFFSET, sizeof(version));
+		if (version == 0)
+			return PAGE_CHECKSUMS_OFF;
+		if (version == 1)
+			return PAGE_CHECKSUMS_ON;
+		return PAGE_CHECKSUMS_UNKNOWN;
+	}
+	return PAGE_CHECKSUMS_UNKNOWN;
+}
+
+static uint16_t
+page_field(const uint8_t *page, size_t offset)
+{
+	uint16_t v;
+
+	memcpy(&v, page + offset, sizeof(v));
+	return v;
+}
+
+static bool
+page_is_zero(const uint8_t *page)
+{
+	static const uint8_t zero[PAGE_BLCKSZ];
+
+	return memcmp(page, zero, PAGE_BLCKSZ) == 0;
+}
+
+PageStatus
+page_verify(const uint8_t *page, uint32_t blkno, const PageCheckOptions *options,
+			uint16_t *stored, uint16_t *computed)
+{
+	uint16_t lower   = page_field(page, PD_LOWER_OFFSET);
+	uint16_t upper   = page_field(page, PD_UPPER_OFFSET);
+	uint16_t special = page_field(page, PD_SPECIAL_OFFSET);
+	uint16_t flags   = page_field(page, PD_FLAGS_OFFSET);
+	uint16_t expected;
+	uint16_t actual;
+	uint32_t lsn_hi;
+	uint32_t lsn_lo;
+
+	/* PageIsNew(): only a page of zeros may have pd_upper == 0 */
+	if (upper == 0)
+		return page_is_zero(page) ? PAGE_NEW : PAGE_BAD_HEADER;
+
+	/* Written while the backup ran: WAL replay restores a full image */
+	memcpy(&lsn_hi, page + PD_LSN_OFFSET, sizeof(lsn_hi));
+	memcpy(&lsn_lo, page + PD_LSN_OFFSET + 4, sizeof(lsn_lo));
+	if (options != NULL && options->start_lsn != 0 &&
+		(((uint64_t) lsn_hi << 32) | lsn_lo) >= options->start_lsn)
+		return PAGE_NEWER;
+
+	/* The checksum first, as PageIsVerified() does */
+	expected = page_field(page, PD_CHECKSUM_OFFSET);
+	if (options == NULL || options->checksums == PAGE_CHECKSUMS_ON ||
+		(options->checksums == PAGE_CHECKSUMS_UNKNOWN && expected != 0))
+	{
+		actual = page_checksum(page, blkno);
+		if (actual != expected)
+		{
+			if (stored != NULL)
+				*stored = expected;
+			if (computed != NULL)
+				*computed = actual;
+			return PAGE_BAD_CHECKSUM;
+		}
+	}
+
+	if ((flags & ~PD_VALID_FLAG_BITS) != 0 ||
+		lower > upper || upper > special || special > PAGE_BLCKSZ ||
+		special % PAGE_MAXALIGN != 0)
+		return PAGE_BAD_HEADER;
+
+	return PAGE_OK;
+}
+
+/* Length of a run of digits at 's', at most 10 */
+static size_t
+digit_run(const char *s)
+{
+	size_t n = strspn(s, "0123456789");
+
+	return n <= 10 ? n : 0;
+}
+
+bool
+page_relation_file(const char *rel_path, uint32_t *first_block)
+{
+	const char *name;
+	size_t      n;
+	uint32_t    segno = 0;
+
+	if (rel_path == NULL)
+		return false;
+
+	if (strncmp(rel_path, "global/", 7) == 0)
+		name = rel_path + 7;
+	else if (strncmp(rel_path, "base/", 5) == 0)
+	{
+		name = rel_path + 5;
+		if ((n = digit_run(name)) == 0 || name[n] != '/')
+			return false;
+		name += n + 1;
+	}
+	else if (strncmp(rel_path, "pg_tblspc/", 10) == 0)
+	{
+		/* pg_tblspc/<oid>/PG_<version>_<catversion>/<db>/<rel> */
+		name = rel_path + 10;
+		if ((n = digit_run(name)) == 0 || name[n] != '/')
+			return false;
+		name += n + 1;
+		if (strncmp(name, "PG_", 3) != 0 || (name = strchr(name, '/')) == NULL)
+			return false;
+		name++;
+		if ((n = digit_run(name)) == 0 || name[n] != '/')
+			return false;
+		name += n + 1;
+	}
+	else
+		return false;
+
+	/* <relfilenode>[_fork][.segment] */
+	if ((n = digit_run(name)) == 0)
+		return false;
+	name += n;
+	if (*name == '_')
+	{
+		static const char *const forks[] = { "_fsm", "_vm", "_init" };
+		size_t fork = strcspn(name, ".");
+		bool   known = false;
+
+		for (size_t i = 0; i < sizeof(forks) / sizeof(forks[0]); i++)
+			known |= strlen(forks[i]) == fork && strncmp(name, forks[i], fork) == 0;
+		if (!known)
+			return false;
+		name += fork;
+	}
+	if (*name == '.')
+	{
+		name++;
+		if ((n = digit_run(name)) == 0 || name[n] != '\0')
+			return false;
+		segno = (uint32_t) strtoul(name, NULL, 10);
+		if (segno > UINT32_MAX / PAGE_RELSEG_SIZE)
+			return false;
+	}
+	else if (*name != '\0')
+		return false;
+
+	if (first_block != NULL)
+		*first_block = segno * PAGE_RELSEG_SIZE;
+	return true;
+}
+
+void
+page_walk_init(PageWalk *walk, const PageCheckOptions *options, uint32_t first_block)
+{
+	memset(walk, 0, sizeof(*walk));
+	walk->options     = options;
+	walk->first_block = first_block;
+	walk->block       = first_block;
+	walk->in_header   = options != NULL && options->framed;
+	walk->want        = walk->in_header ? FRAME_HEADER_SIZE : PAGE_BLCKSZ;
+}
+
+/* A complete frame header or page at 'p' */
+static void
+page_walk_item(PageWalk *walk, const uint8_t *p)
+{
+	PageStatus status;
+	uint16_t   stored = 0;
+	uint16_t   computed = 0;
+
+	if (walk->in_header)
+	{
+		uint32_t block;
+		int32_t  size;
+
+		memcpy(&block, p, sizeof(block));
+		memcpy(&size, p + 4, sizeof(size));
+
+		/*
+		 * Only uncompressed pages are stored whole.  A compressed one is
+		 * padded to an unrecorded length, and a negative size marks a
+		 * truncated file, so the rest is left to the file checksum.
+		 */
+		if (size != PAGE_BLCKSZ || block >= PAGE_RELSEG_SIZE)
+		{
+			if (size > 0)
+				walk->unchecked++;
+			walk->stopped = true;
+			return;
+		}
+		walk->block     = walk->first_block + block;
+		walk->in_header = false;
+		walk->want      = PAGE_BLCKSZ;
+		return;
+	}
+
+	status = page_verify(p, walk->block, walk->options, &stored, &computed);
+	switch (status)
+	{
+		case PAGE_OK:
+			walk->pages++;
+			break;
+		case PAGE_NEW:
+			walk->new_pages++;
+			break;
+		case PAGE_NEWER:
+			walk->newer_pages++;
+			break;
+		default:
+			if (walk->bad_pages++ == 0)
+			{
+				walk->bad_block    = walk->block;
+				walk->bad_status   = status;
+				walk->bad_stored   = stored;
+				walk->bad_computed = computed;
+			}
+			break;
+	}
+
+	walk->block++;
+	if (walk->options != NULL && walk->options->framed)
+	{
+		walk->in_header = true;
+		walk->want      = FRAME_HEADER_SIZE;
+	}
+}
+
+void
+page_walk_update(PageWalk *walk, const uint8_t *buf, size_t len)
+{
+	while (len > 0 && !walk->stopped)
+	{
+		size_t n;
+
+		/* Whole items straight from the caller's buffer */
+		if (walk->have == 0 && len >= walk->want)
+		{
+			n = walk->want;
+			page_walk_item(walk, buf);
+			buf += n;
+			len -= n;
+			continue;
+		}
+
+		if (walk->carry == NULL)
+		{
+			walk->carry = malloc(PAGE_BLCKSZ);
+			if (walk->carry == NULL)
+			{
+				walk->out_of_memory = true;
+				walk->stopped = true;
+				return;
+			}
+		}
+
+		n = walk->want - walk->have;
+		if (n > len)
+			n = len;
+		memcpy(walk->carry + walk->have, buf, n);
+		walk->have += n;
+		buf += n;
+		len -= n;
+		if (walk->have == walk->want)
+		{
+			walk->have = 0;
+			page_walk_item(walk, walk->carry);
+		}
+	}
+}
+
+bool
+page_walk_finish(PageWalk *walk)
+{
+	/* A partial last page is being extended; PostgreSQL skips it too */
+	free(walk->carry);
+	walk->carry = NULL;
+	walk->have = 0;
+	return walk->bad_pages == 0 && !walk->out_of_memory;
+}
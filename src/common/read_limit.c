@@ -0,0 +1,121 @@
+/*
+ * read_limit.c
+ *
+ * Shared read-rate and IOPS budget for verification reads
+ *
+ * Two token buckets, one counting bytes and one counting read requests,
+ * are refilled at the configured rates and hold at most a tenth of a
+ * second's worth.  A reader charges each read after it completes; when
+ * that leaves a bucket in debt the reader sleeps until the debt is paid
+ * off.  Debt accumulates, so however many threads read, together they
+ * stay within the limits.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pg_backup_auditor.h"
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+typedef struct {
+	double rate;            /* per second; 0 = unlimited */
+	double burst;
+	double tokens;          /* negative: debt */
+} TokenBucket;
+
+static bool            limit_active = false;
+static pthread_mutex_t limit_lock = PTHREAD_MUTEX_INITIALIZER;
+static TokenBucket     byte_bucket;
+static TokenBucket     op_bucket;
+static double          last_refill;
+
+static double
+monotonic_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void
+bucket_init(TokenBucket *b, uint64_t rate)
+{
+	b->rate = (double) rate;
+	b->burst = b->rate / 10 > 1 ? b->rate / 10 : 1;
+	b->tokens = b->burst;
+}
+
+/*
+ * Refill 'b' for 'elapsed' seconds and take 'cost' from it.  Returns how
+ * long the caller has to wait for the bucket to be out of debt.
+ */
+static double
+bucket_take(TokenBucket *b, double elapsed, double cost)
+{
+	if (b->rate <= 0)
+		return 0;
+	b->tokens += elapsed * b->rate;
+	if (b->tokens > b->burst)
+		b->tokens = b->burst;
+	b->tokens -= cost;
+	return b->tokens < 0 ? -b->tokens / b->rate : 0;
+}
+
+/*
+ * Limit verification reads to 'bytes_per_sec' and 'iops' (0 = no limit
+ * on that axis).  Set before any reader starts.
+ */
+void
+read_limit_set(uint64_t bytes_per_sec, uint64_t iops)
+{
+	bucket_init(&byte_bucket, bytes_per_sec);
+	bucket_init(&op_bucket, iops);
+	last_refill = monotonic_seconds();
+	limit_active = bytes_per_sec > 0 || iops > 0;
+}
+
+/* Account for one read of 'bytes'; sleeps while over budget */
+void
+read_limit_charge(size_t bytes)
+{
+	double          now, wait, w;
+	struct timespec ts;
+
+	if (!limit_active)
+		return;
+
+	pthread_mutex_lock(&limit_lock);
+	now = monotonic_seconds();
+	wait = bucket_take(&byte_bucket, now - last_refill, (double) bytes);
+	w = bucket_take(&op_bucket, now - last_refill, 1);
+	if (w > wait)
+		wait = w;
+	last_refill = now;
+	pthread_mutex_unlock(&limit_lock);
+
+	if (wait <= 0)
+		return;
+	ts.tv_sec = (time_t) wait;
+	ts.tv_nsec = (long) ((wait - (double) ts.tv_sec) * 1e9);
+	if (ts.tv_nsec > 999999999L)
+		ts.tv_nsec = 999999999L;
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+		;
+}
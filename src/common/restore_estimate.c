@@ -0,0 +1,299 @@
+/*
+ * restore_estimate.c
+ *
+ * Restore and replay time of backup chains, from measured throughput
+ *
+ * The rates file is a header and a RestoreThroughput, in native byte
+ * order, under a name derived from the backup directory like the
+ * catalog index's.  A file written by another build is discarded.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "restore_estimate.h"
+#include "metrics.h"
+#include "sha256.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define THROUGHPUT_FILE_MAGIC    "PGBARTE"
+#define THROUGHPUT_FILE_VERSION  1
+
+typedef struct {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	size;				/* sizeof(RestoreThroughput) */
+} ThroughputFileHeader;
+
+const char *
+rate_source_name(RateSource source)
+{
+	switch (source)
+	{
+		case RATE_ASSUMED:  return "assumed";
+		case RATE_MEASURED: return "measured";
+		case RATE_GIVEN:    return "given";
+	}
+	return "unknown";
+}
+
+/* ------------------------------------------------------------------ *
+ * Measured rates
+ * ------------------------------------------------------------------ */
+
+static void
+fold_rate(double *rate, time_t *measured_at, uint64_t bytes, double seconds,
+		  time_t now)
+{
+	double sample;
+
+	if (bytes < RESTORE_MIN_SAMPLE_BYTES || seconds < RESTORE_MIN_SAMPLE_SECONDS)
+		return;
+
+	sample = (double) bytes / seconds;
+	if (*rate <= 0.0)
+		*rate = sample;
+	else
+		*rate += RESTORE_RATE_ALPHA * (sample - *rate);
+	*measured_at = now;
+}
+
+void
+restore_throughput_update(RestoreThroughput *tp, uint64_t data_bytes,
+						  double data_seconds, uint64_t wal_bytes,
+						  double wal_seconds, time_t now)
+{
+	fold_rate(&tp->data_rate, &tp->data_measured_at, data_bytes, data_seconds, now);
+	fold_rate(&tp->wal_rate, &tp->wal_measured_at, wal_bytes, wal_seconds, now);
+}
+
+/* The rates file for 'backup_dir'; false without a cache directory */
+static bool
+throughput_file(const char *backup_dir, char *path, size_t size)
+{
+	const char *cache_dir = validation_get_cache_dir();
+	SHA256Ctx	ctx;
+	uint8_t		digest[SHA256_DIGEST_LENGTH];
+	char		hex[SHA256_HEX_LENGTH + 1];
+	char		name[64];
+
+	if (cache_dir == NULL || backup_dir == NULL)
+		return false;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, backup_dir, strlen(backup_dir));
+	sha256_final(&ctx, digest);
+	sha256_to_hex(digest, hex);
+	snprintf(name, sizeof(name), "throughput-%.16s.bin", hex);
+	path_join(path, size, cache_dir, name);
+	return true;
+}
+
+void
+restore_throughput_load(const char *backup_dir, RestoreThroughput *tp)
+{
+	char		path[PATH_MAX];
+	FILE	   *fp;
+	ThroughputFileHeader hdr;
+	RestoreThroughput loaded;
+
+	memset(tp, 0, sizeof(*tp));
+	if (!throughput_file(backup_dir, path, sizeof(path)))
+		return;
+
+	fp = fopen(path, "rb");
+	if (fp == NULL)
+		return;		/* nothing measured yet */
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) == 1 &&
+		memcmp(hdr.magic, THROUGHPUT_FILE_MAGIC, sizeof(THROUGHPUT_FILE_MAGIC)) == 0 &&
+		hdr.version == THROUGHPUT_FILE_VERSION &&
+		hdr.size == sizeof(RestoreThroughput) &&
+		fread(&loaded, sizeof(loaded), 1, fp) == 1 &&
+		loaded.data_rate >= 0.0 && loaded.wal_rate >= 0.0)
+		*tp = loaded;
+	else
+		log_debug("Throughput file %s: stale or corrupt, ignored", path);
+	metrics_io_stream(fp);
+	fclose(fp);
+}
+
+bool
+restore_throughput_save(const char *backup_dir, const RestoreThroughput *tp)
+{
+	char		path[PATH_MAX];
+	char		tmp_file[PATH_MAX + 32];
+	FILE	   *fp;
+	ThroughputFileHeader hdr;
+	bool		ok;
+
+	if (!throughput_file(backup_dir, path, sizeof(path)))
+		return false;
+
+	snprintf(tmp_file, sizeof(tmp_file), "%s.tmp.%ld", path, (long) getpid());
+	fp = fopen(tmp_file, "wb");
+	if (fp == NULL)
+	{
+		log_warning("Cannot write throughput file %s: %s", tmp_file, strerror(errno));
+		return false;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, THROUGHPUT_FILE_MAGIC, sizeof(THROUGHPUT_FILE_MAGIC));
+	hdr.version = THROUGHPUT_FILE_VERSION;
+	hdr.size = sizeof(RestoreThroughput);
+	ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+		 fwrite(tp, sizeof(*tp), 1, fp) == 1;
+	if (fclose(fp) != 0)
+		ok = false;
+	if (!ok || rename(tmp_file, path) != 0)
+	{
+		log_warning("Cannot write throughput file %s: %s", path, strerror(errno));
+		unlink(tmp_file);
+		return false;
+	}
+	return true;
+}
+
+void
+restore_throughput_record(const char *backup_dir)
+{
+	RestoreThroughput tp;
+	RestoreThroughput before;
+
+	if (validation_get_cache_dir() == NULL)
+		return;
+
+	restore_throughput_load(backup_dir, &tp);
+	before = tp;
+	restore_throughput_update(&tp,
+							  metrics_phase_io(METRIC_PHASE_CHECKSUM, METRIC_IO_BYTES_READ),
+							  metrics_phase_seconds(METRIC_PHASE_CHECKSUM),
+							  metrics_phase_io(METRIC_PHASE_WAL, METRIC_IO_BYTES_READ),
+							  metrics_phase_seconds(METRIC_PHASE_WAL),
+							  time(NULL));
+	if (memcmp(&tp, &before, sizeof(tp)) != 0)
+		restore_throughput_save(backup_dir, &tp);
+}
+
+/* ------------------------------------------------------------------ *
+ * Estimate
+ * ------------------------------------------------------------------ */
+
+static bool
+completed(const BackupInfo *b)
+{
+	return b->status == BACKUP_STATUS_OK || b->status == BACKUP_STATUS_WARNING;
+}
+
+static const BackupInfo *
+chain_member(const BackupChain *chain, const char *backup_id)
+{
+	for (int i = 0; i < chain->count; i++)
+		if (strcmp(chain->members[i]->backup_id, backup_id) == 0)
+			return chain->members[i];
+	return NULL;
+}
+
+/* End of the gapless WAL run holding 'lsn' on 'timeline', or 'lsn' */
+static XLogRecPtr
+archived_wal_end(const WALArchiveInfo *wal_info, XLogRecPtr lsn, TimeLineID timeline)
+{
+	uint64_t		seg_bytes;
+	WALSegmentName	seg;
+	int				r;
+	XLogRecPtr		end;
+
+	if (wal_info == NULL || wal_info->range_count == 0 || wal_info->ranges == NULL)
+		return lsn;
+
+	if (timeline == 0)
+		timeline = wal_info->ranges[wal_info->range_count - 1].timeline;
+	seg_bytes = wal_info->segment_size != 0 ? wal_info->segment_size : 16 * 1024 * 1024;
+	lsn_to_seg(lsn, timeline, &seg, wal_info->segment_size);
+	r = wal_archive_find_range(wal_info, &seg);
+	if (r < 0)
+		return lsn;
+
+	end = (wal_info->ranges[r].start + wal_info->ranges[r].count) * seg_bytes;
+	return end > lsn ? end : lsn;
+}
+
+bool
+restore_estimate_chain(const BackupChain *chain, const WALArchiveInfo *wal_info,
+					   const RestoreThroughput *tp, double replay_rate,
+					   RestoreEstimate *out)
+{
+	const BackupInfo *latest = NULL;
+	const BackupInfo *b;
+
+	memset(out, 0, sizeof(*out));
+	for (int i = 0; i < chain->count; i++)
+		if (completed(chain->members[i]) &&
+			(latest == NULL || chain->members[i]->end_time > latest->end_time))
+			latest = chain->members[i];
+	if (latest == NULL)
+		return false;
+	out->backup = latest;
+
+	/*
+	 * The backup and its ancestors, up to the root; the chain length
+	 * bounds the walk should parent links loop
+	 */
+	for (b = latest; b != NULL && out->backups < chain->count; )
+	{
+		out->backups++;
+		out->data_bytes += b->data_bytes;
+		if (b == chain->root || b->parent_backup_id[0] == '\0')
+			break;
+		b = chain_member(chain, b->parent_backup_id);
+	}
+	if (b != chain->root && chain->root != NULL && latest != chain->root)
+	{
+		/* Parent links did not lead back to the root: count it anyway */
+		out->backups++;
+		out->data_bytes += chain->root->data_bytes;
+	}
+
+	out->replay_from = latest->start_lsn;
+	out->replay_to = archived_wal_end(wal_info, latest->stop_lsn, latest->timeline);
+	if (out->replay_to > out->replay_from)
+		out->wal_bytes = out->replay_to - out->replay_from;
+
+	out->data_source = tp != NULL && tp->data_rate > 0.0 ? RATE_MEASURED : RATE_ASSUMED;
+	out->data_rate = out->data_source == RATE_MEASURED ? tp->data_rate
+		: RESTORE_DEFAULT_DATA_RATE;
+	if (replay_rate > 0.0)
+	{
+		out->wal_source = RATE_GIVEN;
+		out->wal_rate = replay_rate;
+	}
+	else
+	{
+		out->wal_source = tp != NULL && tp->wal_rate > 0.0 ? RATE_MEASURED : RATE_ASSUMED;
+		out->wal_rate = out->wal_source == RATE_MEASURED ? tp->wal_rate
+			: RESTORE_DEFAULT_WAL_RATE;
+	}
+
+	out->restore_seconds = (double) out->data_bytes / out->data_rate;
+	out->replay_seconds = (double) out->wal_bytes / out->wal_rate;
+	return true;
+}
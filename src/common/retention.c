@@ -0,0 +1,517 @@
+/*
+ * retention.c
+ *
+ * Retention plans and the evaluation of policies against them
+ *
+ * Building a plan sorts each instance's chains and each archive's
+ * segments once and keeps prefix sums and running minima and maxima
+ * over them, in the order a policy cuts them.  Evaluating a policy is a
+ * few binary searches per instance and one per archive.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "retention.h"
+#include "arg_parser.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* An end_time of 0 is a backup that has not finished: later than any */
+#define RETENTION_UNFINISHED    ((time_t) INT64_MAX)
+
+static time_t
+finished_at(const BackupInfo *backup)
+{
+	return backup->end_time != 0 ? backup->end_time : RETENTION_UNFINISHED;
+}
+
+bool
+retention_policy_parse(const char *spec, RetentionPolicy *policy)
+{
+	char        buf[256];
+	char       *item;
+	char       *save = NULL;
+
+	memset(policy, 0, sizeof(*policy));
+	if (strlen(spec) >= sizeof(buf))
+	{
+		fprintf(stderr, "Error: Retention policy too long: %s\n", spec);
+		return false;
+	}
+	str_copy(buf, spec, sizeof(buf));
+
+	for (item = strtok_r(buf, ",", &save); item != NULL;
+		 item = strtok_r(NULL, ",", &save))
+	{
+		char *value = strchr(item, '=');
+
+		if (value == NULL)
+		{
+			fprintf(stderr, "Error: Invalid retention rule (expected KEY=VALUE): %s\n", item);
+			return false;
+		}
+		*value++ = '\0';
+
+		if (strcmp(item, "redundancy") == 0)
+		{
+			if (!parse_int_argument(value, &policy->redundancy, "--retention redundancy"))
+				return false;
+			if (policy->redundancy < 1)
+			{
+				fprintf(stderr, "Error: Retention redundancy must be >= 1\n");
+				return false;
+			}
+		}
+		else if (strcmp(item, "window") == 0)
+		{
+			if (!parse_duration_argument(value, &policy->window, "--retention window"))
+				return false;
+		}
+		else if (strcmp(item, "instance") == 0 && value[0] != '\0')
+			str_copy(policy->instance, value, sizeof(policy->instance));
+		else
+		{
+			fprintf(stderr, "Error: Invalid retention rule: %s=%s\n", item, value);
+			fprintf(stderr, "Valid rules: redundancy=N, window=DURATION, instance=NAME\n");
+			return false;
+		}
+	}
+
+	if (policy->redundancy == 0 && policy->window == 0)
+	{
+		fprintf(stderr, "Error: Retention policy needs redundancy=N or window=DURATION: %s\n",
+				spec);
+		return false;
+	}
+	return true;
+}
+
+void
+retention_policy_format(const RetentionPolicy *policy, char *buf, size_t size)
+{
+	size_t len = 0;
+
+	buf[0] = '\0';
+	if (policy->redundancy > 0)
+		len += snprintf(buf + len, size - len, "redundancy %d", policy->redundancy);
+	if (policy->window > 0 && len < size)
+	{
+		time_t w = policy->window;
+
+		len += snprintf(buf + len, size - len, "%swindow ", len > 0 ? ", " : "");
+		if (len < size)
+		{
+			if (w % 86400 == 0)
+				len += snprintf(buf + len, size - len, "%lldd", (long long) (w / 86400));
+			else if (w % 3600 == 0)
+				len += snprintf(buf + len, size - len, "%lldh", (long long) (w / 3600));
+			else
+				len += snprintf(buf + len, size - len, "%llds", (long long) w);
+		}
+	}
+	if (policy->instance[0] != '\0' && len < size)
+		snprintf(buf + len, size - len, " (%s)", policy->instance);
+}
+
+/* Chains of the plan being built, with their instance key */
+typedef struct {
+	const BackupChain *chain;
+	const char        *instance;
+	int                archive;
+	int                pos;         /* in the chain array, the last tie-break */
+} ChainKey;
+
+static int
+compare_chain_keys(const void *a, const void *b)
+{
+	const ChainKey *ka = a;
+	const ChainKey *kb = b;
+	int             cmp = strcmp(ka->instance, kb->instance);
+
+	if (cmp != 0)
+		return cmp;
+	if (ka->archive != kb->archive)
+		return (ka->archive > kb->archive) - (ka->archive < kb->archive);
+	if (ka->chain->root->start_time != kb->chain->root->start_time)
+		return ka->chain->root->start_time < kb->chain->root->start_time ? -1 : 1;
+	return (ka->pos > kb->pos) - (ka->pos < kb->pos);
+}
+
+static int
+compare_segnos(const void *a, const void *b)
+{
+	uint64_t sa = *(const uint64_t *) a;
+	uint64_t sb = *(const uint64_t *) b;
+
+	return (sa > sb) - (sa < sb);
+}
+
+/* Running totals of one instance's chains keys[0..n-1] */
+static bool
+build_instance(RetentionInstance *inst, const ChainKey *keys, int n)
+{
+	inst->instance = keys[0].instance;
+	inst->archive = keys[0].archive;
+	inst->nchains = n;
+	inst->chains = malloc(n * sizeof(*inst->chains));
+	inst->cum_bytes = malloc((n + 1) * sizeof(*inst->cum_bytes));
+	inst->cum_backups = malloc((n + 1) * sizeof(*inst->cum_backups));
+	inst->wal_from = malloc((n + 1) * sizeof(*inst->wal_from));
+	inst->ended_by = malloc(n * sizeof(*inst->ended_by));
+	inst->ok = malloc(n * sizeof(*inst->ok));
+	inst->ok_min_end = malloc(n * sizeof(*inst->ok_min_end));
+	if (inst->chains == NULL || inst->cum_bytes == NULL ||
+		inst->cum_backups == NULL || inst->wal_from == NULL ||
+		inst->ended_by == NULL || inst->ok == NULL || inst->ok_min_end == NULL)
+		return false;
+
+	inst->cum_bytes[0] = 0;
+	inst->cum_backups[0] = 0;
+	inst->nok = 0;
+	for (int i = 0; i < n; i++)
+	{
+		const BackupChain *chain = keys[i].chain;
+		uint64_t           bytes = 0;
+		time_t             ended = 0;
+
+		for (int m = 0; m < chain->count; m++)
+		{
+			bytes += chain->members[m]->data_bytes;
+			if (finished_at(chain->members[m]) > ended)
+				ended = finished_at(chain->members[m]);
+		}
+		inst->chains[i] = chain;
+		inst->cum_bytes[i + 1] = inst->cum_bytes[i] + bytes;
+		inst->cum_backups[i + 1] = inst->cum_backups[i] + chain->count;
+		inst->ended_by[i] = (i > 0 && inst->ended_by[i - 1] > ended)
+			? inst->ended_by[i - 1] : ended;
+		if (chain->root->status == BACKUP_STATUS_OK)
+			inst->ok[inst->nok++] = i;
+	}
+
+	/* From the newest back: the least start LSN, the least OK root end */
+	inst->wal_from[n] = UINT64_MAX;
+	for (int i = n - 1; i >= 0; i--)
+	{
+		const BackupChain *chain = inst->chains[i];
+		XLogRecPtr         lsn = inst->wal_from[i + 1];
+
+		for (int m = 0; m < chain->count; m++)
+			if (chain->members[m]->start_lsn < lsn)
+				lsn = chain->members[m]->start_lsn;
+		inst->wal_from[i] = lsn;
+	}
+	for (int j = inst->nok - 1; j >= 0; j--)
+	{
+		time_t end = finished_at(inst->chains[inst->ok[j]]->root);
+
+		inst->ok_min_end[j] = (j + 1 < inst->nok && inst->ok_min_end[j + 1] < end)
+			? inst->ok_min_end[j + 1] : end;
+	}
+	return true;
+}
+
+/* Segment numbers and running sizes of one scanned archive */
+static bool
+build_archive(RetentionArchive *arch, const WALArchiveSetEntry *entry)
+{
+	const WALArchiveInfo *info = entry->info;
+	uint64_t             *sizes;
+
+	arch->path = entry->path;
+	arch->seg_bytes = 16 * 1024 * 1024;
+	if (info == NULL || info->segment_count == 0)
+		return true;
+	if (info->segment_size != 0)
+		arch->seg_bytes = info->segment_size;
+
+	arch->count = info->segment_count;
+	arch->segno = malloc(arch->count * sizeof(*arch->segno));
+	arch->cum_bytes = malloc((arch->count + 1) * sizeof(*arch->cum_bytes));
+	if (arch->segno == NULL || arch->cum_bytes == NULL)
+		return false;
+
+	/*
+	 * Timelines do not matter: no backup kept needs a segment below the
+	 * oldest start LSN, whatever its timeline.  Segment numbers are
+	 * sorted together with their sizes, as pairs.
+	 */
+	sizes = malloc(arch->count * 2 * sizeof(uint64_t));
+	if (sizes == NULL)
+		return false;
+	for (int i = 0; i < arch->count; i++)
+	{
+		sizes[2 * i] = wal_segment_number(&info->segments[i], info->segment_size);
+		sizes[2 * i + 1] = info->stats != NULL ? info->stats[i].size : arch->seg_bytes;
+	}
+	qsort(sizes, arch->count, 2 * sizeof(uint64_t), compare_segnos);
+
+	arch->cum_bytes[0] = 0;
+	for (int i = 0; i < arch->count; i++)
+	{
+		arch->segno[i] = sizes[2 * i];
+		arch->cum_bytes[i + 1] = arch->cum_bytes[i] + sizes[2 * i + 1];
+	}
+	free(sizes);
+	return true;
+}
+
+RetentionPlan *
+retention_plan_build(const BackupChain *chains, int nchains,
+					 const WALArchiveSet *wal_set, time_t now)
+{
+	RetentionPlan *plan = calloc(1, sizeof(*plan));
+	ChainKey      *keys = NULL;
+	int            nkeys = 0;
+
+	if (plan == NULL)
+		goto oom;
+	plan->now = now;
+
+	if (wal_set != NULL && wal_set->count > 0)
+	{
+		plan->archives = calloc(wal_set->count, sizeof(*plan->archives));
+		if (plan->archives == NULL)
+			goto oom;
+		plan->narchives = wal_set->count;
+		for (int a = 0; a < wal_set->count; a++)
+			if (!build_archive(&plan->archives[a], &wal_set->archives[a]))
+				goto oom;
+	}
+
+	if (nchains > 0)
+	{
+		keys = malloc(nchains * sizeof(*keys));
+		plan->instances = calloc(nchains, sizeof(*plan->instances));
+		if (keys == NULL || plan->instances == NULL)
+			goto oom;
+	}
+	for (int i = 0; i < nchains; i++)
+	{
+		if (chains[i].root == NULL)
+			continue;
+		keys[nkeys].chain = &chains[i];
+		keys[nkeys].instance = chains[i].root->instance_name;
+		keys[nkeys].archive = wal_archive_set_index(wal_set, chains[i].root);
+		keys[nkeys].pos = i;
+		nkeys++;
+	}
+	if (nkeys > 1)
+		qsort(keys, nkeys, sizeof(*keys), compare_chain_keys);
+
+	/* One instance per run of equal (instance, archive) */
+	for (int i = 0; i < nkeys;)
+	{
+		int j = i + 1;
+
+		while (j < nkeys && strcmp(keys[j].instance, keys[i].instance) == 0 &&
+			   keys[j].archive == keys[i].archive)
+			j++;
+		if (!build_instance(&plan->instances[plan->ninstances++], keys + i, j - i))
+			goto oom;
+		i = j;
+	}
+
+	free(keys);
+	return plan;
+
+oom:
+	log_error("Out of memory while planning retention");
+	free(keys);
+	retention_plan_free(plan);
+	return NULL;
+}
+
+void
+retention_plan_free(RetentionPlan *plan)
+{
+	if (plan == NULL)
+		return;
+	for (int i = 0; i < plan->ninstances; i++)
+	{
+		RetentionInstance *inst = &plan->instances[i];
+
+		free(inst->chains);
+		free(inst->cum_bytes);
+		free(inst->cum_backups);
+		free(inst->wal_from);
+		free(inst->ended_by);
+		free(inst->ok);
+		free(inst->ok_min_end);
+	}
+	for (int a = 0; a < plan->narchives; a++)
+	{
+		free(plan->archives[a].segno);
+		free(plan->archives[a].cum_bytes);
+	}
+	free(plan->instances);
+	free(plan->archives);
+	free(plan);
+}
+
+/* First chain the window rule keeps */
+static int
+window_keep_from(const RetentionInstance *inst, time_t start, bool *met)
+{
+	int lo = 0;
+	int hi = inst->nok;
+	int base;
+	int recent;
+
+	/* The newest OK chain finished by 'start': last j with ok_min_end[j] <= start */
+	while (lo < hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+
+		if (inst->ok_min_end[mid] <= start)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+	{
+		/* Nothing restores to the start of the window: keep all */
+		*met = false;
+		return 0;
+	}
+	base = inst->ok[lo - 1];
+
+	/* An older chain with a backup that ended in the window is kept too */
+	lo = 0;
+	hi = base;
+	while (lo < hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+
+		if (inst->ended_by[mid] >= start)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	recent = lo;
+
+	return recent < base ? recent : base;
+}
+
+static void
+evaluate_instance(const RetentionInstance *inst, const RetentionPolicy *policy,
+				  time_t now, RetentionInstanceResult *out)
+{
+	int  keep_from = inst->nchains;
+	bool met = true;
+
+	if (policy == NULL ||
+		(policy->instance[0] != '\0' && strcmp(policy->instance, inst->instance) != 0) ||
+		(policy->redundancy == 0 && policy->window == 0))
+		keep_from = 0;
+	else
+	{
+		if (policy->redundancy > 0)
+		{
+			int from = 0;
+
+			if (inst->nok >= policy->redundancy)
+				from = inst->ok[inst->nok - policy->redundancy];
+			else
+				met = false;
+			if (from < keep_from)
+				keep_from = from;
+		}
+		if (policy->window > 0)
+		{
+			int from = window_keep_from(inst, now - policy->window, &met);
+
+			if (from < keep_from)
+				keep_from = from;
+		}
+	}
+
+	out->keep_from = keep_from;
+	out->chains = keep_from;
+	out->backups = inst->cum_backups[keep_from];
+	out->bytes = inst->cum_bytes[keep_from];
+	out->met = met;
+}
+
+/* Segments of 'arch' wholly below 'lsn' */
+static void
+evaluate_archive(const RetentionArchive *arch, XLogRecPtr lsn,
+				 RetentionArchiveResult *out)
+{
+	uint64_t limit = lsn / arch->seg_bytes;
+	int      lo = 0;
+	int      hi = arch->count;
+
+	memset(out, 0, sizeof(*out));
+	if (arch->count == 0 || lsn == 0)
+		return;
+
+	while (lo < hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+
+		if (arch->segno[mid] < limit)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return;
+	out->keep_from = limit * arch->seg_bytes;
+	out->from = arch->segno[0] * arch->seg_bytes;
+	out->segments = lo;
+	out->bytes = arch->cum_bytes[lo];
+}
+
+void
+retention_plan_evaluate(const RetentionPlan *plan, const RetentionPolicy *policy,
+						RetentionInstanceResult *inst, RetentionArchiveResult *arch)
+{
+	XLogRecPtr *cut = NULL;
+
+	if (arch != NULL && plan->narchives > 0)
+	{
+		cut = malloc(plan->narchives * sizeof(*cut));
+		if (cut == NULL)
+			log_error("Out of memory while planning retention");
+		for (int a = 0; cut != NULL && a < plan->narchives; a++)
+			cut[a] = UINT64_MAX;
+	}
+
+	/* An archive keeps what the neediest of its instances keeps */
+	for (int i = 0; i < plan->ninstances; i++)
+	{
+		const RetentionInstance *ri = &plan->instances[i];
+
+		evaluate_instance(ri, policy, plan->now, &inst[i]);
+		if (cut != NULL && ri->archive >= 0 && ri->wal_from[inst[i].keep_from] < cut[ri->archive])
+			cut[ri->archive] = ri->wal_from[inst[i].keep_from];
+	}
+
+	for (int a = 0; arch != NULL && a < plan->narchives; a++)
+	{
+		/* No chain bound to it, or out of memory: nothing is known to be spare */
+		if (cut == NULL || cut[a] == UINT64_MAX)
+			memset(&arch[a], 0, sizeof(arch[a]));
+		else
+			evaluate_archive(&plan->archives[a], cut[a], &arch[a]);
+	}
+	free(cut);
+}
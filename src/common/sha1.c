@@ -0,0 +1,400 @@
+/*
+ * sha1.c
+ *
+ * Minimal self-contained SHA-1 implementation (FIPS 180-4).
+ * No external dependencies.
+ *
+ * On x86 CPUs with the SHA extensions the block function uses the
+ * sha1rnds4/sha1nexte/sha1msg1/sha1msg2 instructions; everywhere else
+ * a portable version is used.  The choice is made once, by CPUID.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sha1.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+	(defined(__GNUC__) || defined(__clang__))
+#define SHA1_HAVE_SHANI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#ifndef bit_SHA
+#define bit_SHA (1 << 29)
+#endif
+#endif
+
+typedef void (*sha1_blocks_fn)(uint32_t state[5], const uint8_t *data,
+							   size_t nblocks);
+
+static sha1_blocks_fn  sha1_blocks = NULL;
+static pthread_once_t   sha1_once = PTHREAD_ONCE_INIT;
+static const char     *sha1_impl_label = "generic";
+
+/* -----------------------------------------------------------------------
+ * Bit-manipulation helpers (big-endian word I/O, rotations).
+ * ----------------------------------------------------------------------- */
+
+static inline uint32_t
+be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+		   ((uint32_t)p[2] <<  8) |  (uint32_t)p[3];
+}
+
+static inline void
+put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >>  8);
+	p[3] = (uint8_t)(v);
+}
+
+static inline void
+put_be64(uint8_t *p, uint64_t v)
+{
+	p[0] = (uint8_t)(v >> 56);
+	p[1] = (uint8_t)(v >> 48);
+	p[2] = (uint8_t)(v >> 40);
+	p[3] = (uint8_t)(v >> 32);
+	p[4] = (uint8_t)(v >> 24);
+	p[5] = (uint8_t)(v >> 16);
+	p[6] = (uint8_t)(v >>  8);
+	p[7] = (uint8_t)(v);
+}
+
+#define ROTL32(x, n)  (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* -----------------------------------------------------------------------
+ * Portable block function (FIPS 180-4 § 6.1.2).
+ * ----------------------------------------------------------------------- */
+void
+sha1_blocks_generic(uint32_t state[5], const uint8_t *data, size_t nblocks)
+{
+	while (nblocks-- > 0)
+	{
+		uint32_t w[80];
+		uint32_t a, b, c, d, e, f, k, t;
+		int      i;
+
+		for (i = 0; i < 16; i++)
+			w[i] = be32(data + i * 4);
+		for (i = 16; i < 80; i++)
+			w[i] = ROTL32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+
+		for (i = 0; i < 80; i++)
+		{
+			if (i < 20)
+			{
+				f = (b & c) | (~b & d);
+				k = 0x5a827999;
+			}
+			else if (i < 40)
+			{
+				f = b ^ c ^ d;
+				k = 0x6ed9eba1;
+			}
+			else if (i < 60)
+			{
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8f1bbcdc;
+			}
+			else
+			{
+				f = b ^ c ^ d;
+				k = 0xca62c1d6;
+			}
+
+			t = ROTL32(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = ROTL32(b, 30);
+			b = a;
+			a = t;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+
+		data += 64;
+	}
+}
+
+#ifdef SHA1_HAVE_SHANI
+/*
+ * One group of four rounds with the SHA extensions.  'g' is the group
+ * number 0..19; msg[] holds the sliding window of the message schedule.
+ * Conditions on 'g' are compile-time constants and fold away.
+ */
+#define SHA1_NI_GROUP(g, ecur, eoth) \
+	do { \
+		if ((g) < 4) \
+			msg[(g) % 4] = _mm_shuffle_epi8( \
+				_mm_loadu_si128((const __m128i *) (data + 16 * (g))), mask); \
+		if ((g) == 0) \
+			ecur = _mm_add_epi32(ecur, msg[0]); \
+		else \
+			ecur = _mm_sha1nexte_epu32(ecur, msg[(g) % 4]); \
+		eoth = abcd; \
+		if ((g) >= 3 && (g) <= 18) \
+			msg[((g) + 1) % 4] = _mm_sha1msg2_epu32(msg[((g) + 1) % 4], \
+													msg[(g) % 4]); \
+		abcd = _mm_sha1rnds4_epu32(abcd, ecur, (g) / 5); \
+		if ((g) >= 1 && (g) <= 16) \
+			msg[((g) + 3) % 4] = _mm_sha1msg1_epu32(msg[((g) + 3) % 4], \
+													msg[(g) % 4]); \
+		if ((g) >= 2 && (g) <= 17) \
+			msg[((g) + 2) % 4] = _mm_xor_si128(msg[((g) + 2) % 4], \
+											   msg[(g) % 4]); \
+	} while (0)
+
+__attribute__((target("sha,sse4.1")))
+static void
+sha1_blocks_shani(uint32_t state[5], const uint8_t *data, size_t nblocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+										0x08090a0b0c0d0e0fULL);
+	__m128i abcd, e0, e1, abcd_save, e0_save;
+	__m128i msg[4];
+
+	abcd = _mm_loadu_si128((const __m128i *) state);
+	abcd = _mm_shuffle_epi32(abcd, 0x1B);
+	e0   = _mm_set_epi32((int) state[4], 0, 0, 0);
+
+	while (nblocks-- > 0)
+	{
+		abcd_save = abcd;
+		e0_save   = e0;
+
+		SHA1_NI_GROUP(0,  e0, e1);
+		SHA1_NI_GROUP(1,  e1, e0);
+		SHA1_NI_GROUP(2,  e0, e1);
+		SHA1_NI_GROUP(3,  e1, e0);
+		SHA1_NI_GROUP(4,  e0, e1);
+		SHA1_NI_GROUP(5,  e1, e0);
+		SHA1_NI_GROUP(6,  e0, e1);
+		SHA1_NI_GROUP(7,  e1, e0);
+		SHA1_NI_GROUP(8,  e0, e1);
+		SHA1_NI_GROUP(9,  e1, e0);
+		SHA1_NI_GROUP(10, e0, e1);
+		SHA1_NI_GROUP(11, e1, e0);
+		SHA1_NI_GROUP(12, e0, e1);
+		SHA1_NI_GROUP(13, e1, e0);
+		SHA1_NI_GROUP(14, e0, e1);
+		SHA1_NI_GROUP(15, e1, e0);
+		SHA1_NI_GROUP(16, e0, e1);
+		SHA1_NI_GROUP(17, e1, e0);
+		SHA1_NI_GROUP(18, e0, e1);
+		SHA1_NI_GROUP(19, e1, e0);
+
+		e0   = _mm_sha1nexte_epu32(e0, e0_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+
+		data += 64;
+	}
+
+	abcd = _mm_shuffle_epi32(abcd, 0x1B);
+	_mm_storeu_si128((__m128i *) state, abcd);
+	state[4] = (uint32_t) _mm_extract_epi32(e0, 3);
+}
+
+/* SHA extensions plus the SSSE3/SSE4.1 shuffles used around them */
+static bool
+cpu_has_sha_ni(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	if (!(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+		return false;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return false;
+	return (ebx & bit_SHA) != 0;
+}
+#endif /* SHA1_HAVE_SHANI */
+
+/* -----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------- */
+
+static void
+sha1_pick(void)
+{
+#ifdef SHA1_HAVE_SHANI
+	if (cpu_has_sha_ni())
+	{
+		sha1_impl_label = "sha-ni";
+		sha1_blocks = sha1_blocks_shani;
+		return;
+	}
+#endif
+
+	sha1_impl_label = "generic";
+	sha1_blocks = sha1_blocks_generic;
+}
+
+/* Picked once, however many workers get here first */
+void
+sha1_hw_init(void)
+{
+	pthread_once(&sha1_once, sha1_pick);
+}
+
+const char *
+sha1_implementation(void)
+{
+	sha1_hw_init();
+	return sha1_impl_label;
+}
+
+void
+sha1_init(SHA1Ctx *ctx)
+{
+	sha1_hw_init();
+
+	/* Initial hash values (FIPS 180-4 § 5.3.1) */
+	ctx->state[0] = 0x67452301;
+	ctx->state[1] = 0xefcdab89;
+	ctx->state[2] = 0x98badcfe;
+	ctx->state[3] = 0x10325476;
+	ctx->state[4] = 0xc3d2e1f0;
+	ctx->count   = 0;
+	ctx->buf_len = 0;
+}
+
+void
+sha1_update(SHA1Ctx *ctx, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	ctx->count += (uint64_t)len * 8;   /* track bit count */
+
+	/* Top up a partial block first */
+	if (ctx->buf_len > 0)
+	{
+		size_t room = 64 - ctx->buf_len;
+		size_t copy = (len < room) ? len : room;
+
+		memcpy(ctx->buf + ctx->buf_len, p, copy);
+		ctx->buf_len += (uint32_t)copy;
+		p   += copy;
+		len -= copy;
+
+		if (ctx->buf_len < 64)
+			return;
+		sha1_blocks(ctx->state, ctx->buf, 1);
+		ctx->buf_len = 0;
+	}
+
+	/* Whole blocks straight from the caller's buffer */
+	if (len >= 64)
+	{
+		size_t nblocks = len / 64;
+
+		sha1_blocks(ctx->state, p, nblocks);
+		p   += nblocks * 64;
+		len -= nblocks * 64;
+	}
+
+	if (len > 0)
+	{
+		memcpy(ctx->buf, p, len);
+		ctx->buf_len = (uint32_t)len;
+	}
+}
+
+void
+sha1_final(SHA1Ctx *ctx, uint8_t digest[SHA1_DIGEST_LENGTH])
+{
+	uint64_t bit_count = ctx->count;
+	uint32_t used      = ctx->buf_len;
+	int      i;
+
+	/* 0x80, zero padding to 56 mod 64, then the 64-bit length */
+	ctx->buf[used++] = 0x80;
+
+	if (used > 56)
+	{
+		memset(ctx->buf + used, 0, 64 - used);
+		sha1_blocks(ctx->state, ctx->buf, 1);
+		used = 0;
+	}
+
+	memset(ctx->buf + used, 0, 56 - used);
+	put_be64(ctx->buf + 56, bit_count);
+	sha1_blocks(ctx->state, ctx->buf, 1);
+
+	for (i = 0; i < 5; i++)
+		put_be32(digest + i * 4, ctx->state[i]);
+}
+
+bool
+sha1_file(const char *path, uint8_t digest[SHA1_DIGEST_LENGTH])
+{
+	FILE    *fp;
+	SHA1Ctx  ctx;
+	uint8_t  buf[65536];
+	size_t   n;
+
+	fp = fopen(path, "rb");
+	if (fp == NULL)
+		return false;
+
+	sha1_init(&ctx);
+
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		sha1_update(&ctx, buf, n);
+
+	if (ferror(fp))
+	{
+		fclose(fp);
+		return false;
+	}
+
+	metrics_io_stream(fp);
+	fclose(fp);
+	sha1_final(&ctx, digest);
+	return true;
+}
+
+void
+sha1_to_hex(const uint8_t digest[SHA1_DIGEST_LENGTH],
+			char hex[SHA1_HEX_LENGTH + 1])
+{
+	static const char hextab[] = "0123456789abcdef";
+	int i;
+
+	for (i = 0; i < SHA1_DIGEST_LENGTH; i++)
+	{
+		hex[i * 2]     = hextab[digest[i] >> 4];
+		hex[i * 2 + 1] = hextab[digest[i] & 0x0f];
+	}
+	hex[SHA1_HEX_LENGTH] = '\0';
+}
@@ -4,6 +4,10 @@
  * Minimal self-contained SHA-256 implementation (FIPS 180-4).
  * No external dependencies.
  *
+ * The block function is chosen once at startup: x86 SHA extensions
+ * (sha256rnds2/sha256msg1/sha256msg2), ARMv8 SHA2 instructions, or the
+ * portable version below.
+ *
  * Copyright (C) 2026 Daria Lepikhova
  *
  * This program is free software: you can redistribute it and/or modify
@@ -21,9 +25,40 @@
  */
 
 #include "sha256.h"
+#include "metrics.h"
+#include <pthread.h>
 #include <string.h>
 #include <stdio.h>
 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+	(defined(__GNUC__) || defined(__clang__))
+#define SHA256_HAVE_SHANI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#ifndef bit_SHA
+#define bit_SHA (1 << 29)
+#endif
+#endif
+
+#if defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__)) && \
+	(defined(__linux__) || defined(__APPLE__))
+#define SHA256_HAVE_ARMV8 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif
+#endif
+#endif
+
+typedef void (*sha256_blocks_fn)(uint32_t state[8], const uint8_t *data,
+								 size_t nblocks);
+
+static sha256_blocks_fn  sha256_blocks = NULL;
+static pthread_once_t   sha256_once = PTHREAD_ONCE_INIT;
+static const char       *sha256_impl_label = "generic";
+
 /* -----------------------------------------------------------------------
  * SHA-256 constants: first 32 bits of the fractional parts of the cube
  * roots of the first 64 primes (FIPS 180-4 § 4.2.2).
@@ -90,64 +125,283 @@ put_be64(uint8_t *p, uint64_t v)
 #define SIG1(x)       (ROTR32(x, 17) ^ ROTR32(x, 19) ^ ((x) >> 10))
 
 /* -----------------------------------------------------------------------
- * Process one 64-byte block.
+ * Portable block function.
  * ----------------------------------------------------------------------- */
+void
+sha256_blocks_generic(uint32_t state[8], const uint8_t *data, size_t nblocks)
+{
+	while (nblocks-- > 0)
+	{
+		uint32_t w[64];
+		uint32_t a, b, c, d, e, f, g, h;
+		uint32_t t1, t2;
+		int      i;
+
+		/* Prepare message schedule */
+		for (i = 0; i < 16; i++)
+			w[i] = be32(data + i * 4);
+		for (i = 16; i < 64; i++)
+			w[i] = SIG1(w[i-2]) + w[i-7] + SIG0(w[i-15]) + w[i-16];
+
+		/* Working variables */
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+		f = state[5];
+		g = state[6];
+		h = state[7];
+
+		/* Compression */
+		for (i = 0; i < 64; i++)
+		{
+			t1 = h + EP1(e) + CH(e, f, g) + K[i] + w[i];
+			t2 = EP0(a) + MAJ(a, b, c);
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+
+		data += 64;
+	}
+}
+
+#ifdef SHA256_HAVE_SHANI
+/*
+ * Four rounds with the x86 SHA extensions.  'g' is the group number
+ * 0..15; msg[] is the sliding window of the message schedule.  The
+ * conditions on 'g' are compile-time constants and fold away.
+ */
+#define SHA256_NI_GROUP(g) \
+	do { \
+		if ((g) < 4) \
+			msg[(g) % 4] = _mm_shuffle_epi8( \
+				_mm_loadu_si128((const __m128i *) (data + 16 * (g))), mask); \
+		wk = _mm_add_epi32(msg[(g) % 4], \
+						   _mm_loadu_si128((const __m128i *) &K[4 * (g)])); \
+		state1 = _mm_sha256rnds2_epu32(state1, state0, wk); \
+		if ((g) >= 3 && (g) <= 14) \
+		{ \
+			tmp = _mm_alignr_epi8(msg[(g) % 4], msg[((g) + 3) % 4], 4); \
+			msg[((g) + 1) % 4] = _mm_add_epi32(msg[((g) + 1) % 4], tmp); \
+			msg[((g) + 1) % 4] = _mm_sha256msg2_epu32(msg[((g) + 1) % 4], \
+													  msg[(g) % 4]); \
+		} \
+		wk = _mm_shuffle_epi32(wk, 0x0E); \
+		state0 = _mm_sha256rnds2_epu32(state0, state1, wk); \
+		if ((g) >= 1 && (g) <= 12) \
+			msg[((g) + 3) % 4] = _mm_sha256msg1_epu32(msg[((g) + 3) % 4], \
+													  msg[(g) % 4]); \
+	} while (0)
+
+__attribute__((target("sha,sse4.1")))
 static void
-sha256_transform(SHA256Ctx *ctx, const uint8_t block[64])
+sha256_blocks_shani(uint32_t state[8], const uint8_t *data, size_t nblocks)
 {
-	uint32_t w[64];
-	uint32_t a, b, c, d, e, f, g, h;
-	uint32_t t1, t2;
-	int      i;
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+										0x0405060700010203ULL);
+	__m128i state0, state1, abef_save, cdgh_save;
+	__m128i msg[4], wk, tmp;
+
+	/* The instructions keep the state as ABEF / CDGH */
+	tmp    = _mm_loadu_si128((const __m128i *) &state[0]);
+	state1 = _mm_loadu_si128((const __m128i *) &state[4]);
+	tmp    = _mm_shuffle_epi32(tmp, 0xB1);
+	state1 = _mm_shuffle_epi32(state1, 0x1B);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+	while (nblocks-- > 0)
+	{
+		abef_save = state0;
+		cdgh_save = state1;
+
+		SHA256_NI_GROUP(0);
+		SHA256_NI_GROUP(1);
+		SHA256_NI_GROUP(2);
+		SHA256_NI_GROUP(3);
+		SHA256_NI_GROUP(4);
+		SHA256_NI_GROUP(5);
+		SHA256_NI_GROUP(6);
+		SHA256_NI_GROUP(7);
+		SHA256_NI_GROUP(8);
+		SHA256_NI_GROUP(9);
+		SHA256_NI_GROUP(10);
+		SHA256_NI_GROUP(11);
+		SHA256_NI_GROUP(12);
+		SHA256_NI_GROUP(13);
+		SHA256_NI_GROUP(14);
+		SHA256_NI_GROUP(15);
+
+		state0 = _mm_add_epi32(state0, abef_save);
+		state1 = _mm_add_epi32(state1, cdgh_save);
+
+		data += 64;
+	}
+
+	tmp    = _mm_shuffle_epi32(state0, 0x1B);
+	state1 = _mm_shuffle_epi32(state1, 0xB1);
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+	state1 = _mm_alignr_epi8(state1, tmp, 8);
+	_mm_storeu_si128((__m128i *) &state[0], state0);
+	_mm_storeu_si128((__m128i *) &state[4], state1);
+}
+
+/* SHA extensions plus the SSSE3/SSE4.1 shuffles used around them */
+static bool
+cpu_has_sha_ni(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	if (!(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+		return false;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return false;
+	return (ebx & bit_SHA) != 0;
+}
+#endif /* SHA256_HAVE_SHANI */
+
+#ifdef SHA256_HAVE_ARMV8
+/*
+ * Four rounds with the ARMv8 SHA2 instructions.  wk[g % 2] holds
+ * W + K for this group; the next group's value is prepared in between.
+ */
+#define SHA256_ARM_GROUP(g) \
+	do { \
+		if ((g) <= 11) \
+			msg[(g) % 4] = vsha256su0q_u32(msg[(g) % 4], msg[((g) + 1) % 4]); \
+		tmp = state0; \
+		if ((g) <= 14) \
+			wk[((g) + 1) % 2] = vaddq_u32(msg[((g) + 1) % 4], \
+										  vld1q_u32(&K[4 * ((g) + 1)])); \
+		state0 = vsha256hq_u32(state0, state1, wk[(g) % 2]); \
+		state1 = vsha256h2q_u32(state1, tmp, wk[(g) % 2]); \
+		if ((g) <= 11) \
+			msg[(g) % 4] = vsha256su1q_u32(msg[(g) % 4], msg[((g) + 2) % 4], \
+										   msg[((g) + 3) % 4]); \
+	} while (0)
+
+#if defined(__clang__)
+__attribute__((target("sha2")))
+#else
+__attribute__((target("+sha2")))
+#endif
+static void
+sha256_blocks_armv8(uint32_t state[8], const uint8_t *data, size_t nblocks)
+{
+	uint32x4_t state0, state1, abef_save, cdgh_save, tmp;
+	uint32x4_t msg[4], wk[2];
 
-	/* Prepare message schedule */
-	for (i = 0; i < 16; i++)
-		w[i] = be32(block + i * 4);
-	for (i = 16; i < 64; i++)
-		w[i] = SIG1(w[i-2]) + w[i-7] + SIG0(w[i-15]) + w[i-16];
-
-	/* Working variables */
-	a = ctx->state[0];
-	b = ctx->state[1];
-	c = ctx->state[2];
-	d = ctx->state[3];
-	e = ctx->state[4];
-	f = ctx->state[5];
-	g = ctx->state[6];
-	h = ctx->state[7];
-
-	/* Compression */
-	for (i = 0; i < 64; i++)
+	state0 = vld1q_u32(&state[0]);
+	state1 = vld1q_u32(&state[4]);
+
+	while (nblocks-- > 0)
 	{
-		t1 = h + EP1(e) + CH(e, f, g) + K[i] + w[i];
-		t2 = EP0(a) + MAJ(a, b, c);
-		h = g;
-		g = f;
-		f = e;
-		e = d + t1;
-		d = c;
-		c = b;
-		b = a;
-		a = t1 + t2;
+		abef_save = state0;
+		cdgh_save = state1;
+
+		for (int i = 0; i < 4; i++)
+			msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+		wk[0] = vaddq_u32(msg[0], vld1q_u32(&K[0]));
+
+		SHA256_ARM_GROUP(0);
+		SHA256_ARM_GROUP(1);
+		SHA256_ARM_GROUP(2);
+		SHA256_ARM_GROUP(3);
+		SHA256_ARM_GROUP(4);
+		SHA256_ARM_GROUP(5);
+		SHA256_ARM_GROUP(6);
+		SHA256_ARM_GROUP(7);
+		SHA256_ARM_GROUP(8);
+		SHA256_ARM_GROUP(9);
+		SHA256_ARM_GROUP(10);
+		SHA256_ARM_GROUP(11);
+		SHA256_ARM_GROUP(12);
+		SHA256_ARM_GROUP(13);
+		SHA256_ARM_GROUP(14);
+		SHA256_ARM_GROUP(15);
+
+		state0 = vaddq_u32(state0, abef_save);
+		state1 = vaddq_u32(state1, cdgh_save);
+
+		data += 64;
 	}
 
-	ctx->state[0] += a;
-	ctx->state[1] += b;
-	ctx->state[2] += c;
-	ctx->state[3] += d;
-	ctx->state[4] += e;
-	ctx->state[5] += f;
-	ctx->state[6] += g;
-	ctx->state[7] += h;
+	vst1q_u32(&state[0], state0);
+	vst1q_u32(&state[4], state1);
 }
+#endif /* SHA256_HAVE_ARMV8 */
 
 /* -----------------------------------------------------------------------
  * Public API
  * ----------------------------------------------------------------------- */
 
+static void
+sha256_pick(void)
+{
+#if defined(SHA256_HAVE_SHANI)
+	if (cpu_has_sha_ni())
+	{
+		sha256_impl_label = "sha-ni";
+		sha256_blocks = sha256_blocks_shani;
+		return;
+	}
+#elif defined(SHA256_HAVE_ARMV8)
+#if defined(__APPLE__)
+	/* Every Apple Silicon core implements the ARMv8 SHA2 extension */
+	sha256_impl_label = "armv8";
+	sha256_blocks = sha256_blocks_armv8;
+	return;
+#else
+	if (getauxval(AT_HWCAP) & HWCAP_SHA2)
+	{
+		sha256_impl_label = "armv8";
+		sha256_blocks = sha256_blocks_armv8;
+		return;
+	}
+#endif
+#endif
+
+	sha256_impl_label = "generic";
+	sha256_blocks = sha256_blocks_generic;
+}
+
+/* Picked once, however many workers get here first */
+void
+sha256_hw_init(void)
+{
+	pthread_once(&sha256_once, sha256_pick);
+}
+
+const char *
+sha256_implementation(void)
+{
+	sha256_hw_init();
+	return sha256_impl_label;
+}
+
 void
 sha256_init(SHA256Ctx *ctx)
 {
+	sha256_hw_init();
+
 	/* Initial hash values: first 32 bits of fractional parts of
 	 * the square roots of the first 8 primes (FIPS 180-4 § 5.3.3). */
 	ctx->state[0] = 0x6a09e667;
@@ -169,7 +423,8 @@ sha256_update(SHA256Ctx *ctx, const void *data, size_t len)
 
 	ctx->count += (uint64_t)len * 8;   /* track bit count */
 
-	while (len > 0)
+	/* Top up a partial block first */
+	if (ctx->buf_len > 0)
 	{
 		size_t room = 64 - ctx->buf_len;
 		size_t copy = (len < room) ? len : room;
@@ -179,11 +434,26 @@ sha256_update(SHA256Ctx *ctx, const void *data, size_t len)
 		p   += copy;
 		len -= copy;
 
-		if (ctx->buf_len == 64)
-		{
-			sha256_transform(ctx, ctx->buf);
-			ctx->buf_len = 0;
-		}
+		if (ctx->buf_len < 64)
+			return;
+		sha256_blocks(ctx->state, ctx->buf, 1);
+		ctx->buf_len = 0;
+	}
+
+	/* Whole blocks straight from the caller's buffer */
+	if (len >= 64)
+	{
+		size_t nblocks = len / 64;
+
+		sha256_blocks(ctx->state, p, nblocks);
+		p   += nblocks * 64;
+		len -= nblocks * 64;
+	}
+
+	if (len > 0)
+	{
+		memcpy(ctx->buf, p, len);
+		ctx->buf_len = (uint32_t)len;
 	}
 }
 
@@ -206,7 +476,7 @@ sha256_final(SHA256Ctx *ctx, uint8_t digest[SHA256_DIGEST_LENGTH])
 		/* Not enough room for the length field — pad to end of block,
 		 * process it, then start a fresh block. */
 		memset(ctx->buf + used, 0, 64 - used);
-		sha256_transform(ctx, ctx->buf);
+		sha256_blocks(ctx->state, ctx->buf, 1);
 		used = 0;
 	}
 
@@ -215,7 +485,7 @@ sha256_final(SHA256Ctx *ctx, uint8_t digest[SHA256_DIGEST_LENGTH])
 
 	/* Write the 64-bit bit count in big-endian at bytes 56..63 */
 	put_be64(ctx->buf + 56, bit_count);
-	sha256_transform(ctx, ctx->buf);
+	sha256_blocks(ctx->state, ctx->buf, 1);
 
 	/* Produce the digest */
 	for (i = 0; i < 8; i++)
@@ -245,6 +515,7 @@ sha256_file(const char *path, uint8_t digest[SHA256_DIGEST_LENGTH])
 		return false;
 	}
 
+	metrics_io_stream(fp);
 	fclose(fp);
 	sha256_final(&ctx, digest);
 	return true;
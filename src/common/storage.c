@@ -0,0 +1,1429 @@
+/*
+ * storage.c
+ *
+ * Remote repository locations and their local mirrors
+ *
+ * storage_stage() lists the location once, lays the listing out as a
+ * tree of sparse files, fetches what the depth needs on parallel
+ * streams and records what the mirror holds in a state file beside it:
+ * one line per object with the staged extent, size, mtime, ETag and
+ * key.  On the next run an object whose size and ETag still match is
+ * left alone.
+ *
+ * The mirror's listing stays in memory for storage_fetch(), which brings
+ * the objects below a path to their full content while a validator reads
+ * them.  Objects can be pinned by several readers at once; the last
+ * storage_release() of an object in a temporary mirror truncates it back
+ * to what the staging fetched.
+ *
+ * The file:// driver lists a local directory; it lets the staging be
+ * exercised without a store.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include "storage.h"
+#include "sha256.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define MIRROR_STATE_HEADER  "pg_backup_auditor mirror 2"
+#define COPY_BUF_SIZE        (256 * 1024)
+
+/* How much of an object the mirror holds */
+enum {
+	STAGED_ABSENT = -1,         /* not in the mirror (or not to be trusted) */
+	STAGED_NONE,                /* sparse placeholder of the right size */
+	STAGED_PAGE,                /* the first STORAGE_PAGE_SIZE bytes */
+	STAGED_HEAD,                /* the first STORAGE_HEAD_SIZE bytes */
+	STAGED_WHOLE
+};
+
+typedef struct {
+	char	   *key;
+	uint64_t	size;
+	time_t		mtime;
+	char		etag[STORAGE_ETAG_LEN];
+	int			staged;			/* STAGED_* */
+	int			need;			/* what this run wants */
+	char	   *path;			/* in the mirror; set while staging */
+	bool		touched;		/* written this run */
+	bool		failed;
+	int			base;			/* what the staging left; STAGED_* */
+	int			pins;			/* storage_fetch() calls not yet released */
+	bool		fetching;		/* a storage_fetch() is fetching it */
+} MirrorEntry;
+
+typedef struct {
+	MirrorEntry *entries;
+	int			count;
+	int			capacity;
+} MirrorList;
+
+/* Mirrors staged by this process */
+typedef struct {
+	char	   *url;
+	char	   *path;
+	bool		temporary;		/* removed at exit */
+	int			depth;
+	StorageLocation loc;
+	MirrorList	objects;		/* sorted by key; empty once staged again */
+	char	   *state;			/* NULL for a temporary mirror */
+	bool		changed;		/* fetched into since the state was saved */
+} StagedMirror;
+
+static StagedMirror *staged_mirrors = NULL;
+static int	staged_count = 0;
+static bool cleanup_registered = false;
+
+/* Covers the objects' pins and extents while validators fetch */
+static pthread_mutex_t mirror_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mirror_fetched = PTHREAD_COND_INITIALIZER;
+
+static const StorageDriver *const storage_drivers[] = {
+	&storage_s3_driver,
+	&storage_gcs_driver,
+	&storage_file_driver,
+};
+
+/* ------------------------------------------------------------------ *
+ * Locations
+ * ------------------------------------------------------------------ */
+
+bool
+storage_is_remote(const char *location)
+{
+	const char *p = location;
+
+	if (location == NULL)
+		return false;
+	while (isalnum((unsigned char) *p) || *p == '+' || *p == '-' || *p == '.')
+		p++;
+	return p > location && strncmp(p, "://", 3) == 0;
+}
+
+bool
+storage_parse_location(const char *location, StorageLocation *loc)
+{
+	const char *rest;
+	const char *slash;
+	size_t		scheme_len;
+	size_t		len;
+
+	memset(loc, 0, sizeof(*loc));
+	if (!storage_is_remote(location))
+		return false;
+
+	rest = strstr(location, "://");
+	scheme_len = (size_t) (rest - location);
+	rest += 3;
+	for (size_t i = 0; i < sizeof(storage_drivers) / sizeof(storage_drivers[0]); i++)
+		if (strlen(storage_drivers[i]->scheme) == scheme_len &&
+			strncasecmp(location, storage_drivers[i]->scheme, scheme_len) == 0)
+			loc->driver = storage_drivers[i];
+	if (loc->driver == NULL)
+		return false;
+
+	len = strlen(location);
+	while (len > (size_t) (rest - location) + 1 && location[len - 1] == '/')
+		len--;
+	if (len >= sizeof(loc->url))
+		return false;
+	memcpy(loc->url, location, len);
+	loc->url[len] = '\0';
+	rest = loc->url + (rest - location);
+
+	if (loc->driver == &storage_file_driver)
+	{
+		/* file:///abs/path: the path is the "prefix" */
+		if (rest[0] != '/')
+			return false;
+		str_copy(loc->prefix, rest, sizeof(loc->prefix));
+		return true;
+	}
+
+	slash = strchr(rest, '/');
+	len = slash != NULL ? (size_t) (slash - rest) : strlen(rest);
+	if (len == 0 || len >= sizeof(loc->bucket))
+		return false;
+	memcpy(loc->bucket, rest, len);
+	loc->bucket[len] = '\0';
+
+	if (slash != NULL)
+	{
+		while (*slash == '/')
+			slash++;
+		if (*slash != '\0')
+		{
+			if (strlen(slash) + 2 > sizeof(loc->prefix))
+				return false;
+			snprintf(loc->prefix, sizeof(loc->prefix), "%s/", slash);
+		}
+	}
+	return true;
+}
+
+/* ------------------------------------------------------------------ *
+ * file:// driver
+ * ------------------------------------------------------------------ */
+
+bool
+storage_copy_range(const char *src, uint64_t src_offset,
+				   const char *dest, uint64_t offset, uint64_t length)
+{
+	uint8_t    *buf;
+	int			in;
+	int			out;
+	uint64_t	done = 0;
+	bool		ok = true;
+
+	in = open(src, O_RDONLY);
+	if (in < 0)
+		return false;
+	out = open(dest, O_WRONLY | O_CREAT, 0644);
+	buf = malloc(COPY_BUF_SIZE);
+	if (out < 0 || buf == NULL)
+	{
+		if (out >= 0)
+			close(out);
+		close(in);
+		free(buf);
+		return false;
+	}
+
+	while (ok && done < length)
+	{
+		size_t		want = length - done < COPY_BUF_SIZE ? (size_t) (length - done) : COPY_BUF_SIZE;
+		ssize_t		n = pread(in, buf, want, (off_t) (src_offset + done));
+
+		if (n <= 0 || pwrite(out, buf, (size_t) n, (off_t) (offset + done)) != n)
+			ok = false;
+		else
+			done += (uint64_t) n;
+	}
+
+	free(buf);
+	if (close(out) != 0)
+		ok = false;
+	close(in);
+	return ok;
+}
+
+static bool
+file_list_dir(const char *root, const char *rel, StorageListFn fn, void *arg)
+{
+	char		dir[PATH_MAX];
+	DIR		   *d;
+	struct dirent *entry;
+	bool		ok = true;
+
+	snprintf(dir, sizeof(dir), "%s%s%s", root, rel[0] != '\0' ? "/" : "", rel);
+	d = opendir(dir);
+	if (d == NULL)
+	{
+		log_warning("Cannot open directory %s: %s", dir, strerror(errno));
+		return false;
+	}
+
+	while (ok && (entry = readdir(d)) != NULL)
+	{
+		char		key[PATH_MAX];
+		char		path[PATH_MAX];
+		char		etag[STORAGE_ETAG_LEN];
+		struct stat st;
+		StorageObject object;
+
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+		if ((size_t) snprintf(key, sizeof(key), "%s%s%s", rel, rel[0] != '\0' ? "/" : "",
+							  entry->d_name) >= sizeof(key) ||
+			(size_t) snprintf(path, sizeof(path), "%s/%s", root, key) >= sizeof(path) ||
+			lstat(path, &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode))
+		{
+			ok = file_list_dir(root, key, fn, arg);
+			continue;
+		}
+		if (!S_ISREG(st.st_mode))
+			continue;
+
+		/* Size and nanosecond mtime stand in for a store's ETag */
+		snprintf(etag, sizeof(etag), "%llx-%lld.%09ld",
+				 (unsigned long long) st.st_size, (long long) st.st_mtim.tv_sec,
+				 (long) st.st_mtim.tv_nsec);
+		object.key = key;
+		object.size = (uint64_t) st.st_size;
+		object.mtime = st.st_mtime;
+		object.etag = etag;
+		ok = fn(arg, &object);
+	}
+	closedir(d);
+	return ok;
+}
+
+static bool
+file_list(const StorageLocation *loc, StorageListFn fn, void *arg)
+{
+	return file_list_dir(loc->prefix, "", fn, arg);
+}
+
+static bool
+file_fetch(const StorageLocation *loc, const StorageRequest *requests, int count)
+{
+	bool		ok = true;
+
+	for (int i = 0; i < count; i++)
+	{
+		const StorageRequest *req = &requests[i];
+		char		src[PATH_MAX];
+		char		tmp[PATH_MAX + 8];
+
+		if ((size_t) snprintf(src, sizeof(src), "%s/%s", loc->prefix, req->key) >= sizeof(src))
+		{
+			ok = false;
+			continue;
+		}
+		if (!req->whole)
+		{
+			if (!storage_copy_range(src, req->offset, req->dest, req->offset, req->length))
+				ok = false;
+			continue;
+		}
+
+		snprintf(tmp, sizeof(tmp), "%s.part", req->dest);
+		unlink(tmp);
+		if (!storage_copy_range(src, 0, tmp, 0, req->length) || rename(tmp, req->dest) != 0)
+		{
+			unlink(tmp);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+const StorageDriver storage_file_driver = {
+	"file", file_list, file_fetch
+};
+
+/* ------------------------------------------------------------------ *
+ * Mirror state
+ * ------------------------------------------------------------------ */
+
+static int
+compare_entries(const void *a, const void *b)
+{
+	return strcmp(((const MirrorEntry *) a)->key, ((const MirrorEntry *) b)->key);
+}
+
+static MirrorEntry *
+mirror_list_add(MirrorList *list, const char *key)
+{
+	MirrorEntry *e;
+
+	if (list->count == list->capacity)
+	{
+		int			capacity = list->capacity > 0 ? list->capacity * 2 : 256;
+		MirrorEntry *grown = realloc(list->entries, (size_t) capacity * sizeof(*grown));
+
+		if (grown == NULL)
+			return NULL;
+		list->entries = grown;
+		list->capacity = capacity;
+	}
+	e = &list->entries[list->count];
+	memset(e, 0, sizeof(*e));
+	e->key = strdup(key);
+	if (e->key == NULL)
+		return NULL;
+	e->staged = STAGED_ABSENT;
+	list->count++;
+	return e;
+}
+
+static void
+mirror_list_free(MirrorList *list)
+{
+	for (int i = 0; i < list->count; i++)
+	{
+		free(list->entries[i].key);
+		free(list->entries[i].path);
+	}
+	free(list->entries);
+	memset(list, 0, sizeof(*list));
+}
+
+static MirrorEntry *
+mirror_list_find(const MirrorList *list, const char *key)
+{
+	MirrorEntry probe;
+
+	if (list->count == 0)
+		return NULL;
+	probe.key = (char *) key;
+	return bsearch(&probe, list->entries, (size_t) list->count, sizeof(MirrorEntry),
+				   compare_entries);
+}
+
+static void
+mirror_load_state(const char *path, MirrorList *list)
+{
+	FILE	   *fp = fopen(path, "r");
+	char		line[PATH_MAX + STORAGE_ETAG_LEN + 96];
+
+	if (fp == NULL)
+		return;
+
+	if (fgets(line, sizeof(line), fp) == NULL ||
+		strncmp(line, MIRROR_STATE_HEADER "\n", sizeof(MIRROR_STATE_HEADER)) != 0)
+	{
+		log_debug("Mirror state %s: unknown format, ignored", path);
+		fclose(fp);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		int			staged;
+		unsigned long long size;
+		long long	mtime;
+		char		etag[STORAGE_ETAG_LEN];
+		int			key_at = 0;
+		size_t		len = strlen(line);
+		MirrorEntry *e;
+
+		if (len == 0 || line[len - 1] != '\n')
+			break;				/* truncated */
+		line[len - 1] = '\0';
+		if (sscanf(line, "%d %llu %lld %71s %n", &staged, &size, &mtime, etag, &key_at) != 4 ||
+			key_at == 0 || line[key_at] == '\0' ||
+			staged < STAGED_NONE || staged > STAGED_WHOLE)
+			continue;
+
+		e = mirror_list_add(list, line + key_at);
+		if (e == NULL)
+			break;
+		e->staged = staged;
+		e->size = size;
+		e->mtime = (time_t) mtime;
+		str_copy(e->etag, strcmp(etag, "-") == 0 ? "" : etag, sizeof(e->etag));
+	}
+	fclose(fp);
+
+	if (list->count > 1)
+		qsort(list->entries, (size_t) list->count, sizeof(MirrorEntry), compare_entries);
+}
+
+static bool
+mirror_save_state(const char *path, const MirrorList *list)
+{
+	char		tmp[PATH_MAX + 32];
+	FILE	   *fp;
+	bool		ok = true;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long) getpid());
+	fp = fopen(tmp, "w");
+	if (fp == NULL)
+	{
+		log_warning("Cannot write mirror state %s: %s", tmp, strerror(errno));
+		return false;
+	}
+
+	fprintf(fp, "%s\n", MIRROR_STATE_HEADER);
+	for (int i = 0; i < list->count; i++)
+	{
+		const MirrorEntry *e = &list->entries[i];
+
+		if (e->failed || e->staged == STAGED_ABSENT)
+			continue;
+		fprintf(fp, "%d %llu %lld %s %s\n", e->staged, (unsigned long long) e->size,
+				(long long) e->mtime, e->etag[0] != '\0' ? e->etag : "-", e->key);
+	}
+	if (ferror(fp))
+		ok = false;
+	if (fclose(fp) != 0)
+		ok = false;
+	if (!ok || rename(tmp, path) != 0)
+	{
+		log_warning("Cannot write mirror state %s: %s", path, strerror(errno));
+		unlink(tmp);
+		return false;
+	}
+	return true;
+}
+
+/* ------------------------------------------------------------------ *
+ * Listing
+ * ------------------------------------------------------------------ */
+
+/* Keys that map onto a path inside the mirror */
+static bool
+key_is_safe(const char *key)
+{
+	const char *p = key;
+
+	if (key[0] == '\0' || key[0] == '/')
+		return false;
+	while (*p != '\0')
+	{
+		const char *end = strchr(p, '/');
+		size_t		len = end != NULL ? (size_t) (end - p) : strlen(p);
+
+		if (len == 0 || (len == 1 && p[0] == '.') ||
+			(len == 2 && p[0] == '.' && p[1] == '.'))
+			return false;
+		if (end == NULL)
+			break;
+		p = end + 1;
+	}
+	return true;
+}
+
+static bool
+collect_object(void *arg, const StorageObject *object)
+{
+	MirrorList *list = arg;
+	MirrorEntry *e;
+	size_t		len = strlen(object->key);
+
+	/* Folder markers ("dir/") carry nothing */
+	if (len > 0 && object->key[len - 1] == '/')
+		return true;
+	if (!key_is_safe(object->key) || len >= PATH_MAX - 64)
+	{
+		log_warning("Skipping object with unusable key: %s", object->key);
+		return true;
+	}
+
+	e = mirror_list_add(list, object->key);
+	if (e == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		return false;
+	}
+	e->size = object->size;
+	e->mtime = object->mtime;
+	str_copy(e->etag, object->etag != NULL ? object->etag : "", sizeof(e->etag));
+	for (char *c = e->etag; *c != '\0'; c++)
+		if (isspace((unsigned char) *c))
+			*c = '_';
+	return true;
+}
+
+/* ------------------------------------------------------------------ *
+ * Planning
+ * ------------------------------------------------------------------ */
+
+static const char *const metadata_names[] = {
+	"backup.control", "backup_content.control", "backup_label", "backup_manifest",
+	"backup.manifest", "backup.manifest.copy", "backup.info", "backup.info.copy",
+	"archive.info", "archive.info.copy", "tablespace_map", "PG_VERSION", "pg_control",
+	NULL
+};
+
+static const char *
+key_basename(const char *key)
+{
+	const char *slash = strrchr(key, '/');
+
+	return slash != NULL ? slash + 1 : key;
+}
+
+static size_t
+key_dirlen(const char *key)
+{
+	const char *slash = strrchr(key, '/');
+
+	return slash != NULL ? (size_t) (slash - key) : 0;
+}
+
+static int
+object_need(const MirrorEntry *e, StageDepth depth, bool first_wal)
+{
+	const char *name = key_basename(e->key);
+	WALSegmentName seg;
+	const char *suffix;
+	int			need = STAGED_NONE;
+
+	if (depth == STAGE_CONTENT)
+		return STAGED_WHOLE;
+
+	if (parse_wal_segment_file(name, &seg, &suffix))
+	{
+		need = first_wal ? STAGED_HEAD : STAGED_NONE;	/* the segment size */
+		/* The page header; a compressed one needs its first blocks */
+		if (depth == STAGE_WAL_HEADERS && need == STAGED_NONE)
+			need = wal_suffix_compression(suffix) == COMPRESSION_NONE ?
+				STAGED_PAGE : STAGED_HEAD;
+	}
+	else if (e->size <= STORAGE_INLINE_SIZE)
+		need = STAGED_WHOLE;
+	else if (strncmp(name, "base.tar", 8) == 0)
+		need = STAGED_HEAD;		/* backup_label is the first member */
+	else
+	{
+		for (int i = 0; metadata_names[i] != NULL; i++)
+			if (strcmp(name, metadata_names[i]) == 0)
+				need = STAGED_WHOLE;
+	}
+
+	if ((need == STAGED_HEAD && e->size <= STORAGE_HEAD_SIZE) ||
+		(need == STAGED_PAGE && e->size <= STORAGE_PAGE_SIZE))
+		need = STAGED_WHOLE;
+	return need;
+}
+
+/* Whether the mirror's copy of 'e' is still usable, from the last run's record */
+static int
+carried_extent(const MirrorEntry *e, const MirrorEntry *old)
+{
+	struct stat st;
+
+	if (old == NULL || old->size != e->size || strcmp(old->etag, e->etag) != 0 ||
+		(e->etag[0] == '\0' && old->mtime != e->mtime))
+		return STAGED_ABSENT;
+	if (e->path == NULL || lstat(e->path, &st) != 0 || !S_ISREG(st.st_mode) ||
+		(uint64_t) st.st_size != e->size)
+		return STAGED_ABSENT;
+	return old->staged;
+}
+
+static char *
+mirror_path(const char *mirror, const char *key)
+{
+	size_t		size = strlen(mirror) + strlen(key) + 2;
+	char	   *path = malloc(size);
+
+	if (path != NULL)
+		snprintf(path, size, "%s/%s", mirror, key);
+	return path;
+}
+
+/* Create the directories above 'path' below 'root'; 'last' caches the last one made */
+static bool
+make_parents(const char *root, const char *path, char *last, size_t last_size)
+{
+	char		dir[PATH_MAX];
+	size_t		root_len = strlen(root);
+	char	   *slash;
+
+	str_copy(dir, path, sizeof(dir));
+	slash = strrchr(dir, '/');
+	if (slash == NULL || (size_t) (slash - dir) <= root_len)
+		return true;
+	*slash = '\0';
+	if (strcmp(dir, last) == 0)
+		return true;
+
+	for (char *p = dir + root_len + 1; ; p++)
+	{
+		if (*p == '/' || *p == '\0')
+		{
+			char		saved = *p;
+
+			*p = '\0';
+			if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+			{
+				log_warning("Cannot create directory %s: %s", dir, strerror(errno));
+				return false;
+			}
+			*p = saved;
+			if (saved == '\0')
+				break;
+		}
+	}
+	str_copy(last, dir, last_size);
+	return true;
+}
+
+static bool
+make_placeholder(const char *path, uint64_t size)
+{
+	int			fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	bool		ok;
+
+	if (fd < 0)
+	{
+		log_warning("Cannot create %s: %s", path, strerror(errno));
+		return false;
+	}
+	ok = ftruncate(fd, (off_t) size) == 0;
+	if (close(fd) != 0)
+		ok = false;
+	if (!ok)
+		log_warning("Cannot size %s: %s", path, strerror(errno));
+	return ok;
+}
+
+/* Drop what the file of 'e' holds beyond the staging's extent, keeping its size */
+static bool
+shrink_to_base(const MirrorEntry *e)
+{
+	uint64_t	keep = e->base == STAGED_PAGE ? STORAGE_PAGE_SIZE :
+		e->base == STAGED_HEAD ? STORAGE_HEAD_SIZE : 0;
+	int			fd = open(e->path, O_WRONLY);
+	bool		ok;
+
+	if (fd < 0)
+		return false;
+	ok = ftruncate(fd, (off_t) keep) == 0 && ftruncate(fd, (off_t) e->size) == 0;
+	if (close(fd) != 0)
+		ok = false;
+	return ok;
+}
+
+/* The mirror's files carry the objects' modification times */
+static void
+set_mtime(const MirrorEntry *e)
+{
+	struct timespec times[2];
+
+	times[0].tv_sec = times[1].tv_sec = e->mtime;
+	times[0].tv_nsec = times[1].tv_nsec = 0;
+	utimensat(AT_FDCWD, e->path, times, 0);
+}
+
+/* ------------------------------------------------------------------ *
+ * Fetching
+ * ------------------------------------------------------------------ */
+
+typedef struct {
+	const StorageLocation *loc;
+	const StorageRequest *requests;
+	const int  *batch_start;		/* batch_count + 1 boundaries */
+	int			batch_count;
+	bool	   *batch_ok;
+	int			next;
+	pthread_mutex_t lock;
+} FetchQueue;
+
+static void *
+fetch_worker(void *arg)
+{
+	FetchQueue *queue = arg;
+
+	for (;;)
+	{
+		int			b;
+
+		pthread_mutex_lock(&queue->lock);
+		b = queue->next++;
+		pthread_mutex_unlock(&queue->lock);
+		if (b >= queue->batch_count)
+			break;
+
+		queue->batch_ok[b] =
+			queue->loc->driver->fetch(queue->loc,
+									  &queue->requests[queue->batch_start[b]],
+									  queue->batch_start[b + 1] - queue->batch_start[b]);
+	}
+	return NULL;
+}
+
+/* Run the requests in batches on up to STORAGE_FETCH_STREAMS streams */
+static bool
+fetch_all(const StorageLocation *loc, const StorageRequest *requests, int count,
+		  bool *request_ok)
+{
+	FetchQueue	queue;
+	pthread_t	threads[STORAGE_FETCH_STREAMS];
+	int		   *batch_start;
+	int			started = 0;
+	int			nbatches = 0;
+	uint64_t	bytes = 0;
+
+	batch_start = malloc(((size_t) count + 1) * sizeof(int));
+	queue.batch_ok = calloc((size_t) count + 1, sizeof(bool));
+	if (batch_start == NULL || queue.batch_ok == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		free(batch_start);
+		free(queue.batch_ok);
+		return false;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		if (i == 0 || i - batch_start[nbatches - 1] >= STORAGE_BATCH_REQUESTS ||
+			bytes >= STORAGE_BATCH_BYTES)
+		{
+			batch_start[nbatches++] = i;
+			bytes = 0;
+		}
+		bytes += requests[i].length;
+	}
+	batch_start[nbatches] = count;
+
+	queue.loc = loc;
+	queue.requests = requests;
+	queue.batch_start = batch_start;
+	queue.batch_count = nbatches;
+	queue.next = 0;
+	pthread_mutex_init(&queue.lock, NULL);
+
+	for (int i = 1; i < nbatches && i < STORAGE_FETCH_STREAMS; i++)
+	{
+		if (pthread_create(&threads[started], NULL, fetch_worker, &queue) != 0)
+			break;
+		started++;
+	}
+	fetch_worker(&queue);
+	for (int i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&queue.lock);
+
+	for (int b = 0; b < nbatches; b++)
+		for (int i = batch_start[b]; i < batch_start[b + 1]; i++)
+			request_ok[i] = queue.batch_ok[b];
+
+	free(batch_start);
+	free(queue.batch_ok);
+	return true;
+}
+
+/* ------------------------------------------------------------------ *
+ * Staging
+ * ------------------------------------------------------------------ */
+
+static int
+remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+	(void) st;
+	(void) flag;
+	(void) ftw;
+	remove(path);
+	return 0;
+}
+
+/* Record what was fetched into kept mirrors, and remove the temporary ones */
+static void
+finish_mirrors(void)
+{
+	for (int i = 0; i < staged_count; i++)
+	{
+		StagedMirror *m = &staged_mirrors[i];
+
+		if (m->temporary)
+			nftw(m->path, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+		else if (m->changed)
+			mirror_save_state(m->state, &m->objects);
+		free(m->url);
+		free(m->path);
+		free(m->state);
+		mirror_list_free(&m->objects);
+	}
+	free(staged_mirrors);
+	staged_mirrors = NULL;
+	staged_count = 0;
+}
+
+/* The mirror directory and state file; a fresh temporary one without a cache */
+static bool
+mirror_paths(const StorageLocation *loc, char *mirror, size_t mirror_size,
+			 char *state, size_t state_size, bool *temporary)
+{
+	const char *cache_dir = validation_get_cache_dir();
+	SHA256Ctx	ctx;
+	uint8_t		digest[SHA256_DIGEST_LENGTH];
+	char		hex[SHA256_HEX_LENGTH + 1];
+	char		name[64];
+
+	if (cache_dir == NULL)
+	{
+		const char *tmpdir = getenv("TMPDIR");
+
+		snprintf(mirror, mirror_size, "%s/pg_backup_auditor-XXXXXX",
+				 tmpdir != NULL && tmpdir[0] != '\0' ? tmpdir : "/tmp");
+		state[0] = '\0';
+		*temporary = true;
+		if (mkdtemp(mirror) == NULL)
+		{
+			log_warning("Cannot create a temporary directory: %s", strerror(errno));
+			return false;
+		}
+		return true;
+	}
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, loc->url, strlen(loc->url));
+	sha256_final(&ctx, digest);
+	sha256_to_hex(digest, hex);
+	snprintf(name, sizeof(name), "remote-%.16s", hex);
+	path_join(mirror, mirror_size, cache_dir, name);
+	snprintf(state, state_size, "%s.state", mirror);
+	*temporary = false;
+	if (mkdir(mirror, 0755) != 0 && errno != EEXIST)
+	{
+		log_warning("Cannot create mirror directory %s: %s", mirror, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/* Delete what the last run staged and the listing no longer has */
+static void
+remove_vanished(const char *mirror, const MirrorList *old, const MirrorList *now)
+{
+	for (int i = 0; i < old->count; i++)
+	{
+		char		path[PATH_MAX];
+		char	   *slash;
+
+		if (mirror_list_find(now, old->entries[i].key) != NULL)
+			continue;
+		if ((size_t) snprintf(path, sizeof(path), "%s/%s", mirror,
+							  old->entries[i].key) >= sizeof(path))
+			continue;
+		unlink(path);
+		/* and the directories it leaves empty */
+		while ((slash = strrchr(path, '/')) != NULL &&
+			   (size_t) (slash - path) > strlen(mirror))
+		{
+			*slash = '\0';
+			if (rmdir(path) != 0)
+				break;
+		}
+	}
+}
+
+static bool
+add_request(StorageRequest **requests, int **owners, int *count, int *capacity,
+			const MirrorEntry *e, int owner, uint64_t offset, uint64_t length, bool whole)
+{
+	if (*count == *capacity)
+	{
+		int			cap = *capacity > 0 ? *capacity * 2 : 256;
+		StorageRequest *r = realloc(*requests, (size_t) cap * sizeof(**requests));
+		int		   *o;
+
+		if (r == NULL)
+			return false;
+		*requests = r;
+		o = realloc(*owners, (size_t) cap * sizeof(**owners));
+		if (o == NULL)
+			return false;
+		*owners = o;
+		*capacity = cap;
+	}
+	(*requests)[*count].key = e->key;
+	(*requests)[*count].offset = offset;
+	(*requests)[*count].length = length;
+	(*requests)[*count].whole = whole;
+	(*requests)[*count].dest = e->path;
+	(*owners)[*count] = owner;
+	(*count)++;
+	return true;
+}
+
+/* Lay out the mirror and queue what 'e' needs; false on a local failure */
+static bool
+plan_entry(const char *mirror, MirrorEntry *e, int index, char *last_dir, size_t last_size,
+		   StorageRequest **requests, int **owners, int *count, int *capacity)
+{
+	uint64_t	upto;
+
+	if (e->need <= e->staged)
+		return true;
+
+	if (!make_parents(mirror, e->path, last_dir, last_size))
+		return false;
+	e->touched = true;
+
+	/* Small enough for one request: fetched in place of the file */
+	if (e->need == STAGED_WHOLE && e->size > 0 && e->size <= STORAGE_PART_SIZE)
+		return add_request(requests, owners, count, capacity, e, index, 0, e->size, true);
+
+	if (e->staged == STAGED_ABSENT && !make_placeholder(e->path, e->size))
+		return false;
+	if (e->need == STAGED_NONE || e->size == 0)
+		return true;
+
+	upto = e->need == STAGED_PAGE ? STORAGE_PAGE_SIZE :
+		e->need == STAGED_HEAD ? STORAGE_HEAD_SIZE : e->size;
+	for (uint64_t off = 0; off < upto; off += STORAGE_PART_SIZE)
+	{
+		uint64_t	len = upto - off < STORAGE_PART_SIZE ? upto - off : STORAGE_PART_SIZE;
+
+		if (!add_request(requests, owners, count, capacity, e, index, off, len, false))
+			return false;
+	}
+	return true;
+}
+
+static void
+format_bytes_short(uint64_t bytes, char *buf, size_t size)
+{
+	if (bytes >= 1024ULL * 1024 * 1024)
+		snprintf(buf, size, "%.1f GB", (double) bytes / (1024.0 * 1024 * 1024));
+	else if (bytes >= 1024 * 1024)
+		snprintf(buf, size, "%.1f MB", (double) bytes / (1024.0 * 1024));
+	else
+		snprintf(buf, size, "%llu kB", (unsigned long long) (bytes + 1023) / 1024);
+}
+
+const char *
+storage_stage(const char *location, StageDepth depth)
+{
+	StorageLocation loc;
+	char		mirror[PATH_MAX];
+	char		state[PATH_MAX + 8];
+	char		last_dir[PATH_MAX] = "";
+	bool		temporary;
+	MirrorList	old = { 0 };
+	MirrorList	now = { 0 };
+	StorageRequest *requests = NULL;
+	int		   *owners = NULL;
+	bool	   *request_ok = NULL;
+	int			nreq = 0;
+	int			capacity = 0;
+	int			failed = 0;
+	uint64_t	fetched = 0;
+	size_t		wal_dir_len = 0;
+	const char *wal_dir = NULL;
+	StagedMirror *grown;
+	char		amount[32];
+
+	if (!storage_parse_location(location, &loc))
+	{
+		log_warning("Unsupported storage location: %s (use s3://, gs:// or file:///)",
+					location);
+		return NULL;
+	}
+
+	/* Staged already by this process, deeply enough */
+	for (int i = 0; i < staged_count; i++)
+		if (strcmp(staged_mirrors[i].url, loc.url) == 0 &&
+			staged_mirrors[i].depth >= (int) depth)
+			return staged_mirrors[i].path;
+
+	if (!mirror_paths(&loc, mirror, sizeof(mirror), state, sizeof(state), &temporary))
+		return NULL;
+	if (!cleanup_registered)
+	{
+		atexit(finish_mirrors);
+		cleanup_registered = true;
+	}
+	grown = realloc(staged_mirrors, ((size_t) staged_count + 1) * sizeof(*grown));
+	if (grown == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		return NULL;
+	}
+	staged_mirrors = grown;
+	memset(&staged_mirrors[staged_count], 0, sizeof(StagedMirror));
+	staged_mirrors[staged_count].url = strdup(loc.url);
+	staged_mirrors[staged_count].path = strdup(mirror);
+	staged_mirrors[staged_count].temporary = temporary;
+	staged_mirrors[staged_count].depth = -1;
+	staged_mirrors[staged_count].loc = loc;
+	if (!temporary)
+		staged_mirrors[staged_count].state = strdup(state);
+	if (staged_mirrors[staged_count].url == NULL || staged_mirrors[staged_count].path == NULL ||
+		(!temporary && staged_mirrors[staged_count].state == NULL))
+	{
+		free(staged_mirrors[staged_count].url);
+		free(staged_mirrors[staged_count].path);
+		free(staged_mirrors[staged_count].state);
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		return NULL;
+	}
+	staged_count++;
+
+	/* A kept mirror staged before: its listing is superseded by this one */
+	for (int i = 0; i < staged_count - 1; i++)
+	{
+		StagedMirror *m = &staged_mirrors[i];
+
+		if (strcmp(m->path, mirror) != 0)
+			continue;
+		if (m->changed)
+			mirror_save_state(m->state, &m->objects);
+		m->changed = false;
+		mirror_list_free(&m->objects);
+	}
+
+	if (!temporary)
+		mirror_load_state(state, &old);
+
+	log_info("Listing %s", loc.url);
+	if (!loc.driver->list(&loc, collect_object, &now))
+	{
+		log_warning("Cannot list %s", loc.url);
+		goto fail;
+	}
+	if (now.count > 1)
+		qsort(now.entries, (size_t) now.count, sizeof(MirrorEntry), compare_entries);
+
+	/* What each object needs, and what the mirror still has of it */
+	for (int i = 0; i < now.count; i++)
+	{
+		MirrorEntry *e = &now.entries[i];
+		const char *name = key_basename(e->key);
+		size_t		dir_len = key_dirlen(e->key);
+		WALSegmentName seg;
+		bool		first_wal = false;
+
+		if (parse_wal_segment_file(name, &seg, NULL) &&
+			(wal_dir == NULL || dir_len != wal_dir_len ||
+			 strncmp(wal_dir, e->key, dir_len) != 0))
+		{
+			first_wal = true;
+			wal_dir = e->key;
+			wal_dir_len = dir_len;
+		}
+
+		e->path = mirror_path(mirror, e->key);
+		if (e->path == NULL)
+		{
+			fprintf(stderr, "Error: Memory allocation failed\n");
+			goto fail;
+		}
+		e->need = object_need(e, depth, first_wal);
+		e->staged = carried_extent(e, mirror_list_find(&old, e->key));
+		if (!plan_entry(mirror, e, i, last_dir, sizeof(last_dir),
+						&requests, &owners, &nreq, &capacity))
+			goto fail;
+	}
+
+	if (nreq > 0)
+	{
+		request_ok = calloc((size_t) nreq, sizeof(bool));
+		if (request_ok == NULL || !fetch_all(&loc, requests, nreq, request_ok))
+		{
+			if (request_ok == NULL)
+				fprintf(stderr, "Error: Memory allocation failed\n");
+			goto fail;
+		}
+		for (int i = 0; i < nreq; i++)
+		{
+			if (request_ok[i])
+				fetched += requests[i].length;
+			else if (!now.entries[owners[i]].failed)
+			{
+				now.entries[owners[i]].failed = true;
+				failed++;
+			}
+		}
+	}
+
+	for (int i = 0; i < now.count; i++)
+	{
+		MirrorEntry *e = &now.entries[i];
+
+		if (e->touched && !e->failed)
+		{
+			e->staged = e->need > e->staged ? e->need : e->staged;
+			set_mtime(e);
+		}
+		e->base = e->staged;
+	}
+
+	remove_vanished(mirror, &old, &now);
+	if (!temporary)
+		mirror_save_state(state, &now);
+
+	format_bytes_short(fetched, amount, sizeof(amount));
+	log_info("Staged %s: %d objects, %d requests, %s fetched", loc.url, now.count, nreq,
+			 amount);
+	if (failed > 0)
+	{
+		log_warning("Cannot fetch %d object%s from %s", failed, failed == 1 ? "" : "s",
+					loc.url);
+		goto fail;
+	}
+
+	staged_mirrors[staged_count - 1].depth = (int) depth;
+	staged_mirrors[staged_count - 1].objects = now;
+	free(requests);
+	free(owners);
+	free(request_ok);
+	mirror_list_free(&old);
+	return staged_mirrors[staged_count - 1].path;
+
+fail:
+	free(requests);
+	free(owners);
+	free(request_ok);
+	mirror_list_free(&old);
+	mirror_list_free(&now);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------ *
+ * Fetching while validating
+ * ------------------------------------------------------------------ */
+
+/*
+ * The key in mirror 'm' of local 'path', or NULL if it is not below
+ * the mirror
+ */
+static const char *
+mirror_key(const StagedMirror *m, const char *path)
+{
+	size_t		len = strlen(m->path);
+
+	if (m->objects.count == 0 || strncmp(path, m->path, len) != 0 || path[len] != '/')
+		return NULL;
+	return path + len + 1;
+}
+
+/* Index of the first object whose key sorts at or after 'key' */
+static int
+first_object_from(const MirrorList *list, const char *key)
+{
+	int			lo = 0;
+	int			hi = list->count;
+
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (strcmp(list->entries[mid].key, key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Whether object 'key' is 'prefix' itself or below it */
+static bool
+key_below(const char *key, const char *prefix, size_t len)
+{
+	return strncmp(key, prefix, len) == 0 && (key[len] == '\0' || key[len] == '/');
+}
+
+/* An object pinned by one storage_fetch() call */
+typedef struct {
+	int			index;
+	bool		own;			/* fetched by this call */
+} PinnedObject;
+
+/*
+ * storage_fetch() for the paths in one mirror.  Called with mirror_lock
+ * held; it is let go while the requests run, which is safe as a staged
+ * listing is never changed.
+ */
+static bool
+fetch_below(StagedMirror *m, const char *const *paths, int count)
+{
+	StorageRequest *requests = NULL;
+	int		   *owners = NULL;
+	bool	   *request_ok = NULL;
+	PinnedObject *mine = NULL;
+	int			nmine = 0;
+	int			mine_capacity = 0;
+	int			nreq = 0;
+	int			capacity = 0;
+	char		last_dir[PATH_MAX] = "";
+	uint64_t	fetched = 0;
+	bool		ok = true;
+
+	for (int p = 0; p < count; p++)
+	{
+		const char *key = mirror_key(m, paths[p]);
+		size_t		len;
+
+		if (key == NULL)
+			continue;
+		len = strlen(key);
+		for (int i = first_object_from(&m->objects, key);
+			 i < m->objects.count && strncmp(m->objects.entries[i].key, key, len) == 0; i++)
+		{
+			MirrorEntry *e = &m->objects.entries[i];
+
+			if (!key_below(e->key, key, len))
+				continue;
+			if (nmine == mine_capacity)
+			{
+				int			cap = mine_capacity > 0 ? mine_capacity * 2 : 64;
+				PinnedObject *grown = realloc(mine, (size_t) cap * sizeof(*grown));
+
+				if (grown == NULL)
+				{
+					fprintf(stderr, "Error: Memory allocation failed\n");
+					ok = false;
+					break;
+				}
+				mine = grown;
+				mine_capacity = cap;
+			}
+			mine[nmine].index = i;
+			mine[nmine].own = e->staged != STAGED_WHOLE && !e->fetching;
+			e->pins++;
+			if (mine[nmine++].own)
+			{
+				e->need = STAGED_WHOLE;
+				e->fetching = true;
+				e->failed = false;
+				if (!plan_entry(m->path, e, i, last_dir, sizeof(last_dir),
+								&requests, &owners, &nreq, &capacity))
+					e->failed = true;
+			}
+		}
+	}
+	if (nmine == 0)
+		return ok;
+
+	pthread_mutex_unlock(&mirror_lock);
+	if (nreq > 0)
+	{
+		request_ok = calloc((size_t) nreq, sizeof(bool));
+		if (request_ok == NULL || !fetch_all(&m->loc, requests, nreq, request_ok))
+		{
+			if (request_ok == NULL)
+				fprintf(stderr, "Error: Memory allocation failed\n");
+			free(request_ok);
+			request_ok = NULL;
+		}
+	}
+	pthread_mutex_lock(&mirror_lock);
+
+	for (int r = 0; r < nreq; r++)
+	{
+		if (request_ok != NULL && request_ok[r])
+			fetched += requests[r].length;
+		else
+			m->objects.entries[owners[r]].failed = true;
+	}
+	for (int k = 0; k < nmine; k++)
+	{
+		MirrorEntry *e = &m->objects.entries[mine[k].index];
+
+		if (!mine[k].own)
+			continue;
+		if (!e->failed)
+		{
+			e->staged = STAGED_WHOLE;
+			set_mtime(e);
+			m->changed = true;
+		}
+		e->fetching = false;
+	}
+	pthread_cond_broadcast(&mirror_fetched);
+
+	for (int k = 0; k < nmine; k++)
+	{
+		MirrorEntry *e = &m->objects.entries[mine[k].index];
+
+		while (e->fetching)
+			pthread_cond_wait(&mirror_fetched, &mirror_lock);
+		if (e->staged != STAGED_WHOLE)
+		{
+			log_warning("Cannot fetch %s from %s", e->key, m->url);
+			ok = false;
+		}
+	}
+
+	if (nreq > 0)
+	{
+		char		amount[32];
+
+		format_bytes_short(fetched, amount, sizeof(amount));
+		log_debug("Fetched %s in %d requests from %s", amount, nreq, m->url);
+	}
+	free(requests);
+	free(owners);
+	free(request_ok);
+	free(mine);
+	return ok;
+}
+
+bool
+storage_fetch(const char *const *paths, int count)
+{
+	bool		ok = true;
+
+	if (staged_count == 0)
+		return true;
+
+	pthread_mutex_lock(&mirror_lock);
+	for (int i = 0; i < staged_count; i++)
+		if (!fetch_below(&staged_mirrors[i], paths, count))
+			ok = false;
+	pthread_mutex_unlock(&mirror_lock);
+	return ok;
+}
+
+void
+storage_release(const char *const *paths, int count)
+{
+	if (staged_count == 0)
+		return;
+
+	pthread_mutex_lock(&mirror_lock);
+	for (int m = 0; m < staged_count; m++)
+	{
+		StagedMirror *mirror = &staged_mirrors[m];
+
+		for (int p = 0; p < count; p++)
+		{
+			const char *key = mirror_key(mirror, paths[p]);
+			size_t		len;
+
+			if (key == NULL)
+				continue;
+			len = strlen(key);
+			for (int i = first_object_from(&mirror->objects, key);
+				 i < mirror->objects.count &&
+				 strncmp(mirror->objects.entries[i].key, key, len) == 0; i++)
+			{
+				MirrorEntry *e = &mirror->objects.entries[i];
+
+				if (!key_below(e->key, key, len) || e->pins == 0 || --e->pins > 0)
+					continue;
+				/* Read by everyone who asked: a temporary mirror lets it go */
+				if (mirror->temporary && e->staged > e->base && shrink_to_base(e))
+				{
+					e->staged = e->base;
+					set_mtime(e);
+				}
+			}
+		}
+	}
+	pthread_mutex_unlock(&mirror_lock);
+}
+
+bool
+storage_resolve(char **location, StageDepth depth)
+{
+	const char *mirror;
+
+	if (*location == NULL || !storage_is_remote(*location))
+		return true;
+
+	mirror = storage_stage(*location, depth);
+	if (mirror == NULL)
+	{
+		fprintf(stderr, "Error: Cannot read remote repository: %s\n", *location);
+		return false;
+	}
+	*location = (char *) mirror;
+	return true;
+}
@@ -0,0 +1,708 @@
+/*
+ * storage_s3.c
+ *
+ * S3-compatible object store driver (s3://, and gs:// through the
+ * Cloud Storage XML API), as a wrapper around the curl command line
+ *
+ * This is not an S3 client: requests are sent by the curl command-line
+ * tool (7.75 or later, for --aws-sigv4), run as a child process the way
+ * decompress.c runs gzip, which keeps TLS and request signing out of the
+ * build at the cost of a fork and exec per batch.  Each child is
+ * handed a config file listing a whole batch of transfers, which it
+ * performs one after the other over one kept-alive connection; the
+ * caller runs several batches at once.  The config reaches curl as its
+ * standard input, from an already unlinked temporary file, so the
+ * credentials never appear on a command line or in the file system.
+ *
+ * Configuration comes from the usual environment variables:
+ *
+ *   AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY, AWS_SESSION_TOKEN
+ *       credentials (HMAC keys for Cloud Storage); without them
+ *       requests are unsigned, for public buckets
+ *   AWS_REGION, AWS_DEFAULT_REGION
+ *       signing region (default us-east-1)
+ *   AWS_ENDPOINT_URL_S3, AWS_ENDPOINT_URL
+ *       an S3-compatible endpoint (MinIO, Ceph, ...), addressed
+ *       path-style; otherwise AWS with virtual-hosted addressing
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include "storage.h"
+#include "metrics.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define GCS_ENDPOINT      "https://storage.googleapis.com"
+#define CURL_RETRIES      3
+
+/* ------------------------------------------------------------------ *
+ * Growing strings, for URLs and curl configs
+ * ------------------------------------------------------------------ */
+
+typedef struct {
+	char	   *data;
+	size_t		len;
+	size_t		cap;
+	bool		failed;
+} StrBuf;
+
+static void
+sb_append(StrBuf *b, const char *s, size_t n)
+{
+	if (b->failed)
+		return;
+	if (b->len + n + 1 > b->cap)
+	{
+		size_t		cap = b->cap > 0 ? b->cap : 1024;
+		char	   *grown;
+
+		while (b->len + n + 1 > cap)
+			cap *= 2;
+		grown = realloc(b->data, cap);
+		if (grown == NULL)
+		{
+			b->failed = true;
+			return;
+		}
+		b->data = grown;
+		b->cap = cap;
+	}
+	memcpy(b->data + b->len, s, n);
+	b->len += n;
+	b->data[b->len] = '\0';
+}
+
+static void
+sb_add(StrBuf *b, const char *s)
+{
+	sb_append(b, s, strlen(s));
+}
+
+/* Percent-encode all but RFC 3986 unreserved characters (and '/' in paths) */
+static void
+sb_add_encoded(StrBuf *b, const char *s, bool keep_slash)
+{
+	static const char hex[] = "0123456789ABCDEF";
+
+	for (const unsigned char *p = (const unsigned char *) s; *p != '\0'; p++)
+	{
+		char		esc[3];
+
+		if ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z') ||
+			(*p >= '0' && *p <= '9') || *p == '-' || *p == '.' || *p == '_' ||
+			*p == '~' || (keep_slash && *p == '/'))
+		{
+			sb_append(b, (const char *) p, 1);
+			continue;
+		}
+		esc[0] = '%';
+		esc[1] = hex[*p >> 4];
+		esc[2] = hex[*p & 0x0F];
+		sb_append(b, esc, 3);
+	}
+}
+
+/* A curl config line: name = "value", quoted the way curl unquotes it */
+static void
+sb_add_option(StrBuf *b, const char *name, const char *value)
+{
+	sb_add(b, name);
+	sb_add(b, " = \"");
+	for (const char *p = value; *p != '\0'; p++)
+	{
+		if (*p == '"' || *p == '\\')
+			sb_append(b, "\\", 1);
+		sb_append(b, p, 1);
+	}
+	sb_add(b, "\"\n");
+}
+
+/* ------------------------------------------------------------------ *
+ * Endpoint and credentials
+ * ------------------------------------------------------------------ */
+
+static const char *
+env(const char *name)
+{
+	const char *value = getenv(name);
+
+	return value != NULL && value[0] != '\0' ? value : NULL;
+}
+
+/* The endpoint addressed path-style, or NULL for AWS (virtual-hosted) */
+static const char *
+path_style_endpoint(const StorageLocation *loc)
+{
+	const char *endpoint = env("AWS_ENDPOINT_URL_S3");
+
+	if (loc->driver == &storage_gcs_driver)
+		return GCS_ENDPOINT;
+	return endpoint != NULL ? endpoint : env("AWS_ENDPOINT_URL");
+}
+
+/* Scheme, host and bucket part of every URL, without a trailing slash */
+static void
+sb_add_base(StrBuf *b, const StorageLocation *loc)
+{
+	const char *endpoint = path_style_endpoint(loc);
+	size_t		len;
+
+	if (endpoint == NULL)
+	{
+		/* AWS itself, virtual-hosted */
+		const char *region = env("AWS_REGION");
+
+		if (region == NULL)
+			region = env("AWS_DEFAULT_REGION");
+		sb_add(b, "https://");
+		sb_add(b, loc->bucket);
+		sb_add(b, ".s3.");
+		sb_add(b, region != NULL ? region : "us-east-1");
+		sb_add(b, ".amazonaws.com");
+		return;
+	}
+
+	len = strlen(endpoint);
+	while (len > 0 && endpoint[len - 1] == '/')
+		len--;
+	sb_append(b, endpoint, len);
+	sb_add(b, "/");
+	sb_add_encoded(b, loc->bucket, false);
+}
+
+/* The options every transfer of a config starts with */
+static void
+sb_add_transfer_options(StrBuf *b, const StorageLocation *loc)
+{
+	const char *key_id = env("AWS_ACCESS_KEY_ID");
+	const char *secret = env("AWS_SECRET_ACCESS_KEY");
+	const char *token = env("AWS_SESSION_TOKEN");
+	char		retries[16];
+
+	sb_add(b, "silent\nfail\ngloboff\n");
+	snprintf(retries, sizeof(retries), "%d", CURL_RETRIES);
+	sb_add_option(b, "retry", retries);
+
+	if (key_id != NULL && secret != NULL)
+	{
+		const char *region = env("AWS_REGION");
+		StrBuf		s = { 0 };
+
+		if (region == NULL)
+			region = env("AWS_DEFAULT_REGION");
+		if (loc->driver == &storage_gcs_driver)
+			region = "auto";
+
+		sb_add(&s, key_id);
+		sb_add(&s, ":");
+		sb_add(&s, secret);
+		sb_add_option(b, "user", s.failed ? "" : s.data);
+		free(s.data);
+
+		sb_add(b, "aws-sigv4 = \"aws:amz:");
+		sb_add(b, region != NULL ? region : "us-east-1");
+		sb_add(b, ":s3\"\n");
+		sb_add_option(b, "header", "x-amz-content-sha256: UNSIGNED-PAYLOAD");
+		if (token != NULL)
+		{
+			StrBuf		h = { 0 };
+
+			sb_add(&h, "x-amz-security-token: ");
+			sb_add(&h, token);
+			sb_add_option(b, "header", h.failed ? "" : h.data);
+			free(h.data);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------ *
+ * Running curl
+ * ------------------------------------------------------------------ */
+
+/*
+ * Run curl on 'config'.  With 'output' its standard output is collected
+ * there (malloc'd, NUL-terminated); otherwise it is discarded.  Returns
+ * curl's exit status, or -1 if it could not be run.
+ */
+static int
+run_curl(const StrBuf *config, StrBuf *output)
+{
+	const char *tmpdir = env("TMPDIR");
+	char		tmpl[PATH_MAX];
+	int			config_fd;
+	int			pipefd[2] = { -1, -1 };
+	pid_t		pid;
+	int			status;
+	size_t		done = 0;
+
+	if (config->failed)
+		return -1;
+
+	snprintf(tmpl, sizeof(tmpl), "%s/pg_backup_auditor-curl-XXXXXX",
+			 tmpdir != NULL ? tmpdir : "/tmp");
+	config_fd = mkstemp_cloexec(tmpl);
+	if (config_fd < 0)
+	{
+		log_warning("Cannot create a temporary file: %s", strerror(errno));
+		return -1;
+	}
+	unlink(tmpl);
+	while (done < config->len)
+	{
+		ssize_t		n = write(config_fd, config->data + done, config->len - done);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+		{
+			close(config_fd);
+			return -1;
+		}
+		done += (size_t) n;
+	}
+	lseek(config_fd, 0, SEEK_SET);
+
+	if (output != NULL)
+	{
+		if (pipe_cloexec(pipefd) != 0)
+		{
+			close(config_fd);
+			return -1;
+		}
+	}
+
+	pid = fork();
+	if (pid < 0)
+	{
+		close(config_fd);
+		if (output != NULL)
+		{
+			close(pipefd[0]);
+			close(pipefd[1]);
+		}
+		return -1;
+	}
+
+	if (pid == 0)
+	{
+		int			devnull = open("/dev/null", O_WRONLY);
+
+		if (dup2(config_fd, STDIN_FILENO) < 0 ||
+			dup2(output != NULL ? pipefd[1] : devnull, STDOUT_FILENO) < 0)
+			_exit(127);
+		if (devnull >= 0)
+			dup2(devnull, STDERR_FILENO);
+		execlp("curl", "curl", "--config", "-", (char *) NULL);
+		_exit(127);
+	}
+	metrics_io(METRIC_IO_FORKS, 1);
+	close(config_fd);
+
+	if (output != NULL)
+	{
+		char		buf[65536];
+		ssize_t		n;
+
+		close(pipefd[1]);
+		while ((n = read(pipefd[0], buf, sizeof(buf))) != 0)
+		{
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+			sb_append(output, buf, (size_t) n);
+		}
+		close(pipefd[0]);
+	}
+
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR)
+			return -1;
+	if (!WIFEXITED(status))
+		return -1;
+	if (WEXITSTATUS(status) == 127)
+		log_warning("Cannot run curl; it is needed for object storage");
+	return WEXITSTATUS(status);
+}
+
+/* ------------------------------------------------------------------ *
+ * Listing
+ * ------------------------------------------------------------------ */
+
+static const char *
+xml_find(const char *p, const char *end, const char *needle)
+{
+	size_t		n = strlen(needle);
+
+	for (; p + n <= end; p++)
+		if (*p == needle[0] && memcmp(p, needle, n) == 0)
+			return p;
+	return NULL;
+}
+
+/* The text of the first <tag>...</tag> in [p, end) */
+static bool
+xml_element(const char *p, const char *end, const char *tag,
+			const char **value, size_t *len)
+{
+	char		open[48];
+	char		close[48];
+	const char *v;
+	const char *e;
+
+	snprintf(open, sizeof(open), "<%s>", tag);
+	snprintf(close, sizeof(close), "</%s>", tag);
+	v = xml_find(p, end, open);
+	if (v == NULL)
+		return false;
+	v += strlen(open);
+	e = xml_find(v, end, close);
+	if (e == NULL)
+		return false;
+	*value = v;
+	*len = (size_t) (e - v);
+	return true;
+}
+
+/* Append code point 'c' as UTF-8 */
+static size_t
+utf8_encode(unsigned long c, char *out)
+{
+	if (c < 0x80)
+	{
+		out[0] = (char) c;
+		return 1;
+	}
+	if (c < 0x800)
+	{
+		out[0] = (char) (0xC0 | (c >> 6));
+		out[1] = (char) (0x80 | (c & 0x3F));
+		return 2;
+	}
+	if (c < 0x10000)
+	{
+		out[0] = (char) (0xE0 | (c >> 12));
+		out[1] = (char) (0x80 | ((c >> 6) & 0x3F));
+		out[2] = (char) (0x80 | (c & 0x3F));
+		return 3;
+	}
+	out[0] = (char) (0xF0 | (c >> 18));
+	out[1] = (char) (0x80 | ((c >> 12) & 0x3F));
+	out[2] = (char) (0x80 | ((c >> 6) & 0x3F));
+	out[3] = (char) (0x80 | (c & 0x3F));
+	return 4;
+}
+
+/* Undo XML escaping of s[0..len) into 'out'; false if it does not fit or is malformed */
+static bool
+xml_decode(const char *s, size_t len, char *out, size_t size)
+{
+	static const struct {
+		const char *name;
+		char		c;
+	}			entities[] = {
+		{ "amp;", '&' }, { "lt;", '<' }, { "gt;", '>' }, { "quot;", '"' }, { "apos;", '\'' }
+	};
+	size_t		o = 0;
+
+	for (size_t i = 0; i < len; )
+	{
+		char		buf[4];
+		size_t		n = 1;
+
+		buf[0] = s[i];
+		if (s[i] == '&')
+		{
+			const char *semi = memchr(s + i, ';', len - i);
+			bool		known = false;
+
+			if (semi == NULL)
+				return false;
+			if (s[i + 1] == '#')
+			{
+				char	   *endp;
+				unsigned long c = s[i + 2] == 'x' ? strtoul(s + i + 3, &endp, 16)
+					: strtoul(s + i + 2, &endp, 10);
+
+				if (endp != semi || c == 0 || c > 0x10FFFF)
+					return false;
+				n = utf8_encode(c, buf);
+				known = true;
+			}
+			for (size_t e = 0; !known && e < sizeof(entities) / sizeof(entities[0]); e++)
+				if ((size_t) (semi - s - i - 1) + 1 == strlen(entities[e].name) &&
+					strncmp(s + i + 1, entities[e].name, strlen(entities[e].name)) == 0)
+				{
+					buf[0] = entities[e].c;
+					known = true;
+				}
+			if (!known)
+				return false;
+			i = (size_t) (semi - s) + 1;
+		}
+		else
+			i++;
+
+		if (o + n >= size)
+			return false;
+		memcpy(out + o, buf, n);
+		o += n;
+	}
+	out[o] = '\0';
+	return true;
+}
+
+/* Days-from-civil: seconds since the epoch of a UTC date and time */
+static time_t
+utc_seconds(int year, int month, int day, int hour, int min, int sec)
+{
+	long		y = year - (month <= 2);
+	long		era = (y >= 0 ? y : y - 399) / 400;
+	long		yoe = y - era * 400;
+	long		doy = (153L * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	long		doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	long long	days = (long long) era * 146097 + doe - 719468;
+
+	return (time_t) (days * 86400 + hour * 3600 + min * 60 + sec);
+}
+
+int
+storage_s3_parse_list(const char *xml, size_t len, size_t strip,
+					  StorageListFn fn, void *arg, char *token, size_t token_size)
+{
+	const char *end = xml + len;
+	const char *p = xml;
+	const char *v;
+	size_t		vlen;
+	int			count = 0;
+
+	token[0] = '\0';
+	if (xml_find(xml, end, "<ListBucketResult") == NULL)
+		return -1;
+
+	while ((p = xml_find(p, end, "<Contents>")) != NULL)
+	{
+		const char *block_end = xml_find(p, end, "</Contents>");
+		char		key[PATH_MAX];
+		char		etag[STORAGE_ETAG_LEN];
+		char		num[32];
+		StorageObject object;
+		int			year, month, day, hour, min, sec;
+
+		if (block_end == NULL ||
+			!xml_element(p, block_end, "Key", &v, &vlen) ||
+			!xml_decode(v, vlen, key, sizeof(key)))
+			return -1;
+
+		memset(&object, 0, sizeof(object));
+		if (!xml_element(p, block_end, "Size", &v, &vlen) || vlen == 0 || vlen >= sizeof(num))
+			return -1;
+		memcpy(num, v, vlen);
+		num[vlen] = '\0';
+		object.size = strtoull(num, NULL, 10);
+
+		if (xml_element(p, block_end, "LastModified", &v, &vlen) && vlen < sizeof(num))
+		{
+			memcpy(num, v, vlen);
+			num[vlen] = '\0';
+			if (sscanf(num, "%d-%d-%dT%d:%d:%d", &year, &month, &day, &hour, &min, &sec) == 6)
+				object.mtime = utc_seconds(year, month, day, hour, min, sec);
+		}
+
+		etag[0] = '\0';
+		if (xml_element(p, block_end, "ETag", &v, &vlen) &&
+			xml_decode(v, vlen, etag, sizeof(etag)))
+		{
+			size_t		elen = strlen(etag);
+
+			/* The ETag comes quoted */
+			if (elen >= 2 && etag[0] == '"' && etag[elen - 1] == '"')
+			{
+				memmove(etag, etag + 1, elen - 2);
+				etag[elen - 2] = '\0';
+			}
+		}
+		object.etag = etag;
+
+		p = block_end;
+		if (strlen(key) <= strip)
+			continue;			/* the prefix itself */
+		object.key = key + strip;
+		if (!fn(arg, &object))
+			return -1;
+		count++;
+	}
+
+	if (xml_element(xml, end, "IsTruncated", &v, &vlen) && vlen == 4 &&
+		memcmp(v, "true", 4) == 0 &&
+		xml_element(xml, end, "NextContinuationToken", &v, &vlen) &&
+		!xml_decode(v, vlen, token, token_size))
+		return -1;
+	return count;
+}
+
+static bool
+s3_list(const StorageLocation *loc, StorageListFn fn, void *arg)
+{
+	char		token[1024] = "";
+	size_t		strip = strlen(loc->prefix);
+	int			pages = 0;
+
+	do
+	{
+		StrBuf		url = { 0 };
+		StrBuf		config = { 0 };
+		StrBuf		body = { 0 };
+		char		max_keys[16];
+		int			status;
+		int			n;
+
+		snprintf(max_keys, sizeof(max_keys), "%d", STORAGE_LIST_PAGE);
+		sb_add_base(&url, loc);
+		sb_add(&url, path_style_endpoint(loc) != NULL ? "?" : "/?");
+		/* Parameters in canonical (sorted) order, as SigV4 signs them */
+		if (token[0] != '\0')
+		{
+			sb_add(&url, "continuation-token=");
+			sb_add_encoded(&url, token, false);
+			sb_add(&url, "&");
+		}
+		sb_add(&url, "list-type=2&max-keys=");
+		sb_add(&url, max_keys);
+		sb_add(&url, "&prefix=");
+		sb_add_encoded(&url, loc->prefix, false);
+
+		sb_add_transfer_options(&config, loc);
+		sb_add_option(&config, "url", url.failed ? "" : url.data);
+		status = url.failed ? -1 : run_curl(&config, &body);
+		free(url.data);
+		free(config.data);
+
+		if (status != 0 || body.failed)
+		{
+			log_warning("Listing %s failed (curl exit status %d)", loc->url, status);
+			free(body.data);
+			return false;
+		}
+		n = storage_s3_parse_list(body.data != NULL ? body.data : "", body.len, strip,
+								  fn, arg, token, sizeof(token));
+		free(body.data);
+		if (n < 0)
+		{
+			log_warning("Unexpected listing response for %s", loc->url);
+			return false;
+		}
+		pages++;
+		log_debug("Listed page %d of %s: %d objects", pages, loc->url, n);
+	} while (token[0] != '\0');
+
+	return true;
+}
+
+/* ------------------------------------------------------------------ *
+ * Fetching
+ * ------------------------------------------------------------------ */
+
+static void
+part_path(const StorageRequest *req, char *buf, size_t size)
+{
+	snprintf(buf, size, "%s.part-%llu", req->dest, (unsigned long long) req->offset);
+}
+
+static bool
+s3_fetch(const StorageLocation *loc, const StorageRequest *requests, int count)
+{
+	StrBuf		config = { 0 };
+	bool		ok = true;
+	int			status;
+
+	for (int i = 0; i < count; i++)
+	{
+		const StorageRequest *req = &requests[i];
+		StrBuf		url = { 0 };
+		char		part[PATH_MAX + 32];
+
+		part_path(req, part, sizeof(part));
+		unlink(part);
+		if (i > 0)
+			sb_add(&config, "next\n");
+		sb_add_transfer_options(&config, loc);
+
+		sb_add_base(&url, loc);
+		sb_add(&url, "/");
+		sb_add_encoded(&url, loc->prefix, true);
+		sb_add_encoded(&url, req->key, true);
+		sb_add_option(&config, "url", url.failed ? "" : url.data);
+		free(url.data);
+		sb_add_option(&config, "output", part);
+		if (!req->whole)
+		{
+			char		range[48];
+
+			snprintf(range, sizeof(range), "%llu-%llu", (unsigned long long) req->offset,
+					 (unsigned long long) (req->offset + req->length - 1));
+			sb_add_option(&config, "range", range);
+		}
+	}
+
+	/* curl carries on past a failed transfer; each is checked below */
+	status = run_curl(&config, NULL);
+	free(config.data);
+	if (status != 0)
+		log_debug("curl exit status %d fetching from %s", status, loc->url);
+
+	for (int i = 0; i < count; i++)
+	{
+		const StorageRequest *req = &requests[i];
+		char		part[PATH_MAX + 32];
+		struct stat st;
+		bool		got;
+
+		part_path(req, part, sizeof(part));
+		got = stat(part, &st) == 0 && (uint64_t) st.st_size == req->length;
+		if (got && req->whole)
+			got = rename(part, req->dest) == 0;
+		else if (got)
+			got = storage_copy_range(part, 0, req->dest, req->offset, req->length);
+		if (!got)
+		{
+			log_debug("Cannot fetch %s%s [%llu, +%llu)", loc->prefix, req->key,
+					  (unsigned long long) req->offset, (unsigned long long) req->length);
+			ok = false;
+		}
+		unlink(part);
+	}
+	return ok;
+}
+
+const StorageDriver storage_s3_driver = {
+	"s3", s3_list, s3_fetch
+};
+
+const StorageDriver storage_gcs_driver = {
+	"gs", s3_list, s3_fetch
+};
@@ -87,18 +87,60 @@ format_lsn(XLogRecPtr lsn, char *buf, size_t bufsize)
 			 (uint32_t) lsn);
 }
 
+/*
+ * Segments per "xlogid", the middle part of a segment name: a name is
+ * <timeline><segno / per-xlogid><segno % per-xlogid>, as PostgreSQL's
+ * XLogFileName() writes it, so 256 for the default 16 MB segments.
+ * A size of 0 means 16 MB.
+ */
+uint64_t
+wal_segments_per_xlogid(uint32_t wal_segment_size)
+{
+	if (wal_segment_size == 0)
+		wal_segment_size = 0x1000000;  /* 16MB */
+	return 0x100000000ULL / wal_segment_size;
+}
+
+/* Segment number (LSN / segment size) of a segment name */
+uint64_t
+wal_segment_number(const WALSegmentName *seg, uint32_t wal_segment_size)
+{
+	return (uint64_t) seg->log_id * wal_segments_per_xlogid(wal_segment_size) +
+		seg->seg_id;
+}
+
+/* Name of segment number 'segno' on 'timeline' */
+void
+wal_segment_from_number(uint64_t segno, uint32_t timeline, WALSegmentName *seg,
+						uint32_t wal_segment_size)
+{
+	uint64_t per_xlogid = wal_segments_per_xlogid(wal_segment_size);
+
+	seg->timeline = timeline;
+	seg->log_id = (uint32_t) (segno / per_xlogid);
+	seg->seg_id = (uint32_t) (segno % per_xlogid);
+}
+
+/* Advance 'seg' to the next segment of its timeline */
+void
+wal_segment_next(WALSegmentName *seg, uint32_t wal_segment_size)
+{
+	if (++seg->seg_id >= wal_segments_per_xlogid(wal_segment_size))
+	{
+		seg->seg_id = 0;
+		seg->log_id++;
+	}
+}
+
 /*
  * Convert LSN to WAL segment name
  *
- * WAL segment size is 16MB (0x1000000) by default.
- * LSN is divided by segment size to get segment number.
- * Segment number is split into log_id (upper 32 bits) and seg_id (lower 32 bits).
+ * WAL segment size is 16MB (0x1000000) by default.  The segment holding
+ * the LSN is LSN / segment size, named as wal_segment_from_number() does.
  */
 void
 lsn_to_seg(XLogRecPtr lsn, uint32_t timeline, WALSegmentName *seg, uint32_t wal_segment_size)
 {
-	uint64_t segment_number;
-
 	if (seg == NULL)
 		return;
 
@@ -106,21 +148,8 @@ lsn_to_seg(XLogRecPtr lsn, uint32_t timeline, WALSegmentName *seg, uint32_t wal_
 	if (wal_segment_size == 0)
 		wal_segment_size = 0x1000000;  /* 16MB */
 
-	/* Calculate segment number: LSN / WAL_SEGMENT_SIZE */
-	segment_number = lsn / wal_segment_size;
-
-	/* Split into log_id and seg_id
-	 * In PostgreSQL 11+: segment number is 64-bit
-	 *   Upper 32 bits = log_id (0xFFFFFFFF00000000)
-	 *   Lower 8 bits of upper half + upper 24 bits of lower half = seg_id
-	 *
-	 * For simplicity, we use the traditional approach:
-	 *   log_id = segment_number / 0x100000000
-	 *   seg_id = segment_number % 0x100000000
-	 */
-	seg->timeline = timeline;
-	seg->log_id = (uint32_t)(segment_number / 0x100000000ULL);
-	seg->seg_id = (uint32_t)(segment_number % 0x100000000ULL);
+	wal_segment_from_number(lsn / wal_segment_size, timeline, seg,
+							wal_segment_size);
 }
 
 /*
@@ -212,3 +241,70 @@ parse_wal_filename(const char *filename, WALSegmentName *result)
 
 	return true;
 }
+
+/*
+ * Parse the name of an archived WAL segment file.
+ *
+ * Besides the bare 24-character name, archivers store segments as
+ * <name>.gz / .lz4 / .zst / .bz2 / .xz (pg_probackup, wal-g style
+ * setups) and as <name>-<40-hex sha1>[.ext] (pgBackRest).  On success
+ * *suffix points at whatever follows the name inside 'filename' ("" for
+ * a bare file).  Partial segments, .backup and .history files are
+ * rejected.
+ */
+bool
+parse_wal_segment_file(const char *filename, WALSegmentName *result,
+					   const char **suffix)
+{
+	char            name[25];
+	const char     *p;
+	CompressionType type;
+
+	if (filename == NULL || result == NULL || strlen(filename) < 24)
+		return false;
+
+	memcpy(name, filename, 24);
+	name[24] = '\0';
+	if (!parse_wal_filename(name, result))
+		return false;
+
+	p = filename + 24;
+
+	/* pgBackRest: "-" + SHA-1 of the segment */
+	if (*p == '-')
+	{
+		if (strlen(p + 1) < 40 || !is_hex_string(p + 1, 40))
+			return false;
+		p += 41;
+	}
+
+	/* Optional compression extension, and nothing after it */
+	if (*p == '.')
+	{
+		if (!compression_from_name(p + 1, &type) || type == COMPRESSION_NONE)
+			return false;
+	}
+	else if (*p != '\0')
+		return false;
+
+	if (suffix != NULL)
+		*suffix = filename + 24;
+	return true;
+}
+
+/*
+ * Compression of a segment file, from the suffix returned by
+ * parse_wal_segment_file() (NULL or "" = uncompressed).
+ */
+CompressionType
+wal_suffix_compression(const char *suffix)
+{
+	const char     *dot;
+	CompressionType type;
+
+	if (suffix == NULL || (dot = strrchr(suffix, '.')) == NULL)
+		return COMPRESSION_NONE;
+	if (!compression_from_name(dot + 1, &type))
+		return COMPRESSION_NONE;
+	return type;
+}
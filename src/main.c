@@ -22,6 +22,10 @@
 
 #include "pg_backup_auditor.h"
 #include "cmd_help.h"
+#include "crc32c.h"
+#include "page_checksum.h"
+#include "sha1.h"
+#include "sha256.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -32,6 +36,9 @@ extern int cmd_check_main(int argc, char **argv);
 extern int cmd_info_main(int argc, char **argv);
 extern int cmd_audit_main(int argc, char **argv);
 extern int cmd_stat_main(int argc, char **argv);
+extern int cmd_watch_main(int argc, char **argv);
+extern int cmd_merge_main(int argc, char **argv);
+extern int cmd_verify_segment_main(int argc, char **argv);
 
 static void
 print_version(void)
@@ -39,6 +46,83 @@ print_version(void)
 	printf("pg_backup_auditor %s\n", PG_BACKUP_AUDITOR_VERSION);
 }
 
+static bool
+parse_log_level(const char *name, LogLevel *level)
+{
+	static const struct {
+		const char *name;
+		LogLevel    level;
+	} levels[] = {
+		{ "debug", LOG_DEBUG }, { "info", LOG_INFO },
+		{ "warning", LOG_WARNING }, { "error", LOG_ERROR }
+	};
+
+	for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++)
+	{
+		if (strcmp(name, levels[i].name) == 0)
+		{
+			*level = levels[i].level;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Apply the options every command takes (--no-color, --log-level,
+ * --log-file, --log-async) and remove them from argv, so the command's
+ * own parser never sees them.  Returns false on a bad value.
+ */
+static bool
+take_global_options(int *argc, char **argv)
+{
+	bool async = false;
+	int  kept = 1;
+	int  i;
+
+	for (i = 1; i < *argc; i++)
+	{
+		const char *arg = argv[i];
+
+		if (strcmp(arg, "--") == 0)
+			break;
+		if (strcmp(arg, "--no-color") == 0)
+			use_color = false;
+		else if (strcmp(arg, "--log-async") == 0)
+			async = true;
+		else if (strncmp(arg, "--log-level=", 12) == 0)
+		{
+			LogLevel level;
+
+			if (!parse_log_level(arg + 12, &level))
+			{
+				fprintf(stderr, "Error: Invalid log level: %s\n", arg + 12);
+				fprintf(stderr, "Valid levels: debug, info, warning, error\n");
+				return false;
+			}
+			log_set_level(level);
+		}
+		else if (strncmp(arg, "--log-file=", 11) == 0)
+		{
+			if (!log_set_file(arg + 11))
+			{
+				fprintf(stderr, "Error: Cannot open log file: %s\n", arg + 11);
+				return false;
+			}
+		}
+		else
+			argv[kept++] = argv[i];
+	}
+	for (; i < *argc; i++)
+		argv[kept++] = argv[i];
+	argv[kept] = NULL;
+	*argc = kept;
+
+	if (async && !log_set_async(true))
+		log_warning("Cannot start the log writer thread, logging synchronously");
+	return true;
+}
+
 
 int
 main(int argc, char **argv)
@@ -48,14 +132,11 @@ main(int argc, char **argv)
 	/* Initialize */
 	pg_backup_auditor_init();
 
-	/* Check for --no-color option anywhere in arguments */
-	for (int i = 1; i < argc; i++)
+	/* Global options may appear anywhere in the arguments */
+	if (!take_global_options(&argc, argv))
 	{
-		if (strcmp(argv[i], "--no-color") == 0)
-		{
-			use_color = false;
-			break;
-		}
+		ret = EXIT_INVALID_ARGUMENTS;
+		goto cleanup;
 	}
 
 	/* Check for arguments */
@@ -100,6 +181,18 @@ main(int argc, char **argv)
 	{
 		ret = cmd_stat_main(argc - 1, argv + 1);
 	}
+	else if (strcmp(argv[1], "watch") == 0)
+	{
+		ret = cmd_watch_main(argc - 1, argv + 1);
+	}
+	else if (strcmp(argv[1], "merge") == 0)
+	{
+		ret = cmd_merge_main(argc - 1, argv + 1);
+	}
+	else if (strcmp(argv[1], "verify-segment") == 0)
+	{
+		ret = cmd_verify_segment_main(argc - 1, argv + 1);
+	}
 	else
 	{
 		fprintf(stderr, "Error: Unknown command '%s'\n\n", argv[1]);
@@ -120,12 +213,18 @@ pg_backup_auditor_init(void)
 {
 	/* Initialize logging subsystem (stderr by default) */
 	log_init();
+
+	/* Pick checksum implementations before any worker threads start */
+	crc32c_init();
+	page_checksum_init();
+	sha1_hw_init();
+	sha256_hw_init();
 }
 
 /* Global cleanup - called once at program exit */
 void
 pg_backup_auditor_cleanup(void)
 {
-	/* Currently no global resources to cleanup.
-	 * Future use: close log files, free global caches, etc. */
+	/* Write out queued log lines and close the log file */
+	log_cleanup();
 }
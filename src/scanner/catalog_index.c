@@ -0,0 +1,747 @@
+/*
+ * catalog_index.c
+ *
+ * Persistent index of scanned backups
+ *
+ * One binary file per backup directory and scan depth, named after a
+ * hash of both.  Every field is written on its own, as a fixed-width
+ * integer in native byte order (the file is a local cache) or as a
+ * length-prefixed string, so neither struct padding nor pointers reach
+ * the file and a change to BackupInfo only needs the version bumped.
+ *
+ *   header:  magic[8] version:u32 count:u64
+ *   entry:   fingerprint:u64 nbackups:u32 path:str adapter:str
+ *            backup[nbackups]
+ *   backup:  type:u32 tool:u32 status:u32 timeline:u32 pg_version:u32
+ *            flags:u32 start_time:i64 end_time:i64 start_lsn:u64
+ *            stop_lsn:u64 redo_lsn:u64 data_bytes:u64 wal_bytes:u64
+ *            then each of info_strings[] as a str
+ *   str:     len:u32 bytes[len]
+ *
+ * In memory the entries live in an open-addressing hash table keyed by
+ * path, under a mutex: the scanner looks directories up from several
+ * threads.  Fingerprints are computed outside the lock.  The file is rewritten (to a temporary file, then renamed) only
+ * when an entry was added, changed or pruned.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pg_backup_auditor.h"
+#include "catalog_index.h"
+#include "sha256.h"
+#include "metrics.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define CATALOG_INDEX_MAGIC    "PGBAIDX"
+#define CATALOG_INDEX_VERSION  2
+
+/* BackupInfo.flags bits in the file */
+#define INDEX_WAL_STREAM       0x1
+#define INDEX_PARTIAL          0x2
+
+#define INFO_STRING(field) \
+	{ offsetof(BackupInfo, field), sizeof(((BackupInfo *) 0)->field) }
+
+/* The string fields of a BackupInfo, in file order */
+static const struct {
+	size_t		offset;
+	size_t		size;
+} info_strings[] = {
+	INFO_STRING(backup_id),
+	INFO_STRING(node_name),
+	INFO_STRING(instance_name),
+	INFO_STRING(tool_version),
+	INFO_STRING(parent_backup_id),
+	INFO_STRING(backup_path),
+	INFO_STRING(backup_method),
+	INFO_STRING(backup_from),
+	INFO_STRING(backup_label),
+	INFO_STRING(wal_start_file),
+	INFO_STRING(compress_alg),
+	INFO_STRING(wal_mode),
+};
+
+#define N_INFO_STRINGS  (sizeof(info_strings) / sizeof(info_strings[0]))
+
+typedef struct {
+	char	   *path;			/* NULL = empty slot */
+	const BackupAdapter *adapter;
+	uint64_t	fingerprint;
+	uint32_t	nbackups;
+	BackupInfo *backups;		/* array of nbackups, next pointers unused */
+	bool		seen;			/* reused or recorded by this scan */
+} IndexEntry;
+
+struct CatalogIndex {
+	char		file[PATH_MAX];
+	IndexEntry *slots;
+	size_t		capacity;		/* power of two */
+	size_t		count;
+	bool		dirty;
+	pthread_mutex_t lock;		/* scanner threads share the index */
+};
+
+/* ----------------------------------------------------------------
+ * Hash table
+ * ---------------------------------------------------------------- */
+
+/* FNV-1a */
+static uint64_t
+fnv1a(uint64_t h, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+#define FNV1A_INIT  0xcbf29ce484222325ULL
+
+static IndexEntry *
+find_slot(IndexEntry *slots, size_t capacity, const char *path)
+{
+	size_t i = (size_t) fnv1a(FNV1A_INIT, path, strlen(path)) & (capacity - 1);
+
+	while (slots[i].path != NULL && strcmp(slots[i].path, path) != 0)
+		i = (i + 1) & (capacity - 1);
+	return &slots[i];
+}
+
+static bool
+grow(CatalogIndex *index)
+{
+	size_t		new_capacity = index->capacity * 2;
+	IndexEntry *slots = calloc(new_capacity, sizeof(IndexEntry));
+
+	if (slots == NULL)
+		return false;
+
+	for (size_t i = 0; i < index->capacity; i++)
+		if (index->slots[i].path != NULL)
+			*find_slot(slots, new_capacity, index->slots[i].path) = index->slots[i];
+
+	free(index->slots);
+	index->slots = slots;
+	index->capacity = new_capacity;
+	return true;
+}
+
+/* Find or add the entry for 'path' */
+static IndexEntry *
+put_entry(CatalogIndex *index, const char *path)
+{
+	IndexEntry *e;
+
+	/* Keep the load factor at or below 1/2 */
+	if ((index->count + 1) * 2 > index->capacity && !grow(index))
+		return NULL;
+
+	e = find_slot(index->slots, index->capacity, path);
+	if (e->path == NULL)
+	{
+		e->path = strdup(path);
+		if (e->path == NULL)
+			return NULL;
+		index->count++;
+	}
+	return e;
+}
+
+static BackupAdapter *
+adapter_by_name(const char *name)
+{
+	for (int i = 0; pg_backup_auditor_adapters[i] != NULL; i++)
+		if (strcmp(pg_backup_auditor_adapters[i]->name, name) == 0)
+			return pg_backup_auditor_adapters[i];
+	return NULL;
+}
+
+/* ----------------------------------------------------------------
+ * Fingerprint of an adapter's metadata files
+ * ---------------------------------------------------------------- */
+
+static int
+compare_names(const void *a, const void *b)
+{
+	return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/*
+ * Fold 'abs' (shown as 'rel') into the hash: whether it exists, and its
+ * size, mtime and inode.
+ */
+static uint64_t
+hash_file(uint64_t h, const char *abs, const char *rel)
+{
+	struct stat st;
+	int64_t		v[4] = {-1, -1, -1, -1};
+
+	if (stat(abs, &st) == 0)
+	{
+		v[0] = (int64_t) st.st_size;
+		v[1] = (int64_t) st.st_mtim.tv_sec;
+		v[2] = (int64_t) st.st_mtim.tv_nsec;
+		v[3] = (int64_t) st.st_ino;
+	}
+	h = fnv1a(h, rel, strlen(rel) + 1);
+	return fnv1a(h, v, sizeof(v));
+}
+
+/*
+ * Hash every file matching 'pattern' below 'abs'/'rel'.  "*" components
+ * expand to the directory's entries in sorted order, so the fingerprint
+ * also changes when one is added or removed.
+ */
+static uint64_t
+hash_pattern(uint64_t h, const char *abs, const char *rel, const char *pattern)
+{
+	char		component[NAME_MAX + 1];
+	const char *slash = strchr(pattern, '/');
+	const char *rest = slash != NULL ? slash + 1 : "";
+	size_t		len = slash != NULL ? (size_t) (slash - pattern) : strlen(pattern);
+	char		sub_abs[PATH_MAX];
+	char		sub_rel[PATH_MAX];
+
+	if (len == 0 || len > NAME_MAX)
+		return hash_file(h, abs, rel);
+	memcpy(component, pattern, len);
+	component[len] = '\0';
+
+	if (strcmp(component, "*") == 0)
+	{
+		DIR		   *dir = opendir(abs);
+		struct dirent *de;
+		char	  **names = NULL;
+		size_t		n = 0, cap = 0;
+
+		if (dir == NULL)
+			return hash_file(h, abs, rel);
+
+		while ((de = readdir(dir)) != NULL)
+		{
+			if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+				continue;
+			if (n == cap)
+			{
+				char  **grown = realloc(names, (cap ? cap * 2 : 16) * sizeof(char *));
+
+				if (grown == NULL)
+					break;
+				names = grown;
+				cap = cap ? cap * 2 : 16;
+			}
+			if ((names[n] = strdup(de->d_name)) == NULL)
+				break;
+			n++;
+		}
+		closedir(dir);
+
+		if (n > 1)
+			qsort(names, n, sizeof(char *), compare_names);
+		h = fnv1a(h, &n, sizeof(n));
+		for (size_t i = 0; i < n; i++)
+		{
+			path_join(sub_abs, sizeof(sub_abs), abs, names[i]);
+			path_join(sub_rel, sizeof(sub_rel), rel, names[i]);
+			h = hash_pattern(h, sub_abs, sub_rel, rest);
+			free(names[i]);
+		}
+		free(names);
+		return h;
+	}
+
+	if (strcmp(component, ".") == 0)
+		return hash_pattern(h, abs, rel, rest);
+
+	path_join(sub_abs, sizeof(sub_abs), abs, component);
+	path_join(sub_rel, sizeof(sub_rel), rel, component);
+	return hash_pattern(h, sub_abs, sub_rel, rest);
+}
+
+static uint64_t
+fingerprint(const BackupAdapter *adapter, const char *path)
+{
+	uint64_t h = fnv1a(FNV1A_INIT, adapter->name, strlen(adapter->name) + 1);
+
+	for (int i = 0; adapter->metadata_files[i] != NULL; i++)
+		h = hash_pattern(h, path, ".", adapter->metadata_files[i]);
+	return h;
+}
+
+/* ----------------------------------------------------------------
+ * Index file
+ * ---------------------------------------------------------------- */
+
+static void
+free_entries(CatalogIndex *index)
+{
+	for (size_t i = 0; i < index->capacity; i++)
+	{
+		free(index->slots[i].path);
+		free(index->slots[i].backups);
+	}
+	memset(index->slots, 0, index->capacity * sizeof(IndexEntry));
+	index->count = 0;
+}
+
+static bool
+write_u32(FILE *fp, uint32_t v)
+{
+	return fwrite(&v, sizeof(v), 1, fp) == 1;
+}
+
+static bool
+write_u64(FILE *fp, uint64_t v)
+{
+	return fwrite(&v, sizeof(v), 1, fp) == 1;
+}
+
+static bool
+write_str(FILE *fp, const char *s)
+{
+	uint32_t	len = (uint32_t) strlen(s);
+
+	return write_u32(fp, len) && fwrite(s, 1, len, fp) == len;
+}
+
+static bool
+read_u32(FILE *fp, uint32_t *v)
+{
+	return fread(v, sizeof(*v), 1, fp) == 1;
+}
+
+static bool
+read_u64(FILE *fp, uint64_t *v)
+{
+	return fread(v, sizeof(*v), 1, fp) == 1;
+}
+
+/* A string into buf[size]; false if it is cut short or does not fit */
+static bool
+read_str(FILE *fp, char *buf, size_t size)
+{
+	uint32_t	len;
+
+	if (!read_u32(fp, &len) || len >= size || fread(buf, 1, len, fp) != len)
+		return false;
+	buf[len] = '\0';
+	return true;
+}
+
+static bool
+write_backup(FILE *fp, const BackupInfo *b)
+{
+	bool		ok;
+
+	ok = write_u32(fp, (uint32_t) b->type) &&
+		 write_u32(fp, (uint32_t) b->tool) &&
+		 write_u32(fp, (uint32_t) b->status) &&
+		 write_u32(fp, b->timeline) &&
+		 write_u32(fp, b->pg_version) &&
+		 write_u32(fp, (b->wal_stream ? INDEX_WAL_STREAM : 0) |
+				   (b->partial ? INDEX_PARTIAL : 0)) &&
+		 write_u64(fp, (uint64_t) (int64_t) b->start_time) &&
+		 write_u64(fp, (uint64_t) (int64_t) b->end_time) &&
+		 write_u64(fp, b->start_lsn) &&
+		 write_u64(fp, b->stop_lsn) &&
+		 write_u64(fp, b->redo_lsn) &&
+		 write_u64(fp, b->data_bytes) &&
+		 write_u64(fp, b->wal_bytes);
+	for (size_t i = 0; ok && i < N_INFO_STRINGS; i++)
+		ok = write_str(fp, (const char *) b + info_strings[i].offset);
+	return ok;
+}
+
+static bool
+read_backup(FILE *fp, BackupInfo *b)
+{
+	uint32_t	type, tool, status, flags;
+	uint64_t	start_time, end_time;
+
+	memset(b, 0, sizeof(*b));
+	if (!read_u32(fp, &type) || !read_u32(fp, &tool) || !read_u32(fp, &status) ||
+		!read_u32(fp, &b->timeline) || !read_u32(fp, &b->pg_version) ||
+		!read_u32(fp, &flags) ||
+		!read_u64(fp, &start_time) || !read_u64(fp, &end_time) ||
+		!read_u64(fp, &b->start_lsn) || !read_u64(fp, &b->stop_lsn) ||
+		!read_u64(fp, &b->redo_lsn) ||
+		!read_u64(fp, &b->data_bytes) || !read_u64(fp, &b->wal_bytes))
+		return false;
+	for (size_t i = 0; i < N_INFO_STRINGS; i++)
+		if (!read_str(fp, (char *) b + info_strings[i].offset, info_strings[i].size))
+			return false;
+
+	b->type = (BackupType) type;
+	b->tool = (BackupTool) tool;
+	b->status = (BackupStatus) status;
+	b->wal_stream = (flags & INDEX_WAL_STREAM) != 0;
+	b->partial = (flags & INDEX_PARTIAL) != 0;
+	b->start_time = (time_t) (int64_t) start_time;
+	b->end_time = (time_t) (int64_t) end_time;
+	return true;
+}
+
+static void
+load_index(CatalogIndex *index)
+{
+	FILE	   *fp;
+	char		magic[8];
+	uint32_t	version;
+	uint64_t	count;
+	char		path[PATH_MAX];
+	char		name[64];
+
+	fp = fopen(index->file, "rb");
+	if (fp == NULL)
+		return;		/* no index yet */
+
+	if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+		memcmp(magic, CATALOG_INDEX_MAGIC, sizeof(CATALOG_INDEX_MAGIC)) != 0 ||
+		!read_u32(fp, &version) || version != CATALOG_INDEX_VERSION ||
+		!read_u64(fp, &count))
+	{
+		log_debug("Catalog index %s: stale or unknown format, starting over",
+				  index->file);
+		fclose(fp);
+		index->dirty = true;
+		return;
+	}
+
+	for (uint64_t n = 0; n < count; n++)
+	{
+		uint64_t	fingerprint;
+		uint32_t	nbackups;
+		IndexEntry *e;
+		BackupInfo *backups = NULL;
+		const BackupAdapter *adapter;
+
+		if (!read_u64(fp, &fingerprint) || !read_u32(fp, &nbackups) ||
+			!read_str(fp, path, sizeof(path)) || path[0] == '\0' ||
+			!read_str(fp, name, sizeof(name)) || name[0] == '\0')
+			goto corrupt;
+
+		if (nbackups > 0)
+		{
+			backups = calloc(nbackups, sizeof(BackupInfo));
+			if (backups == NULL)
+				goto corrupt;
+			for (uint32_t i = 0; i < nbackups; i++)
+			{
+				if (!read_backup(fp, &backups[i]))
+				{
+					free(backups);
+					goto corrupt;
+				}
+			}
+		}
+
+		adapter = adapter_by_name(name);
+		if (adapter == NULL)
+		{
+			free(backups);		/* adapter since removed: rescan */
+			index->dirty = true;
+			continue;
+		}
+
+		e = put_entry(index, path);
+		if (e == NULL)
+		{
+			free(backups);
+			break;
+		}
+		free(e->backups);
+		e->adapter = adapter;
+		e->fingerprint = fingerprint;
+		e->nbackups = nbackups;
+		e->backups = backups;
+	}
+	metrics_io_stream(fp);
+	fclose(fp);
+
+	log_debug("Catalog index %s: %zu director%s", index->file,
+			  index->count, index->count == 1 ? "y" : "ies");
+	return;
+
+corrupt:
+	log_debug("Catalog index %s: truncated or corrupt, starting over",
+			  index->file);
+	fclose(fp);
+	free_entries(index);
+	index->dirty = true;
+}
+
+static void
+save_index(CatalogIndex *index)
+{
+	char		tmp_file[PATH_MAX + 32];
+	FILE	   *fp;
+	bool		ok = true;
+
+	snprintf(tmp_file, sizeof(tmp_file), "%s.tmp.%ld",
+			 index->file, (long) getpid());
+
+	fp = fopen(tmp_file, "wb");
+	if (fp == NULL)
+	{
+		log_warning("Cannot write catalog index %s: %s",
+					tmp_file, strerror(errno));
+		return;
+	}
+
+	ok = fwrite(CATALOG_INDEX_MAGIC, sizeof(CATALOG_INDEX_MAGIC), 1, fp) == 1 &&
+		 write_u32(fp, CATALOG_INDEX_VERSION) &&
+		 write_u64(fp, index->count);
+
+	for (size_t i = 0; ok && i < index->capacity; i++)
+	{
+		const IndexEntry *e = &index->slots[i];
+
+		if (e->path == NULL)
+			continue;
+
+		ok = write_u64(fp, e->fingerprint) &&
+			 write_u32(fp, e->nbackups) &&
+			 write_str(fp, e->path) &&
+			 write_str(fp, e->adapter->name);
+		for (uint32_t b = 0; ok && b < e->nbackups; b++)
+			ok = write_backup(fp, &e->backups[b]);
+	}
+
+	if (ferror(fp))
+		ok = false;
+	if (fclose(fp) != 0)
+		ok = false;
+	if (!ok || rename(tmp_file, index->file) != 0)
+	{
+		log_warning("Cannot write catalog index %s: %s",
+					index->file, strerror(errno));
+		unlink(tmp_file);
+	}
+}
+
+/* ----------------------------------------------------------------
+ * Public interface
+ * ---------------------------------------------------------------- */
+
+CatalogIndex *
+catalog_index_open(const char *backup_dir, int max_depth)
+{
+	const char *cache_dir = validation_get_cache_dir();
+	CatalogIndex *index;
+	SHA256Ctx	ctx;
+	uint8_t		digest[SHA256_DIGEST_LENGTH];
+	char		hex[SHA256_HEX_LENGTH + 1];
+	char		name[64];
+	SizeMode	size_mode;
+
+	if (cache_dir == NULL || backup_dir == NULL)
+		return NULL;
+
+	index = calloc(1, sizeof(CatalogIndex));
+	if (index == NULL)
+		return NULL;
+	index->capacity = 256;
+	index->slots = calloc(index->capacity, sizeof(IndexEntry));
+	if (index->slots == NULL)
+	{
+		free(index);
+		return NULL;
+	}
+
+	/*
+	 * One file per backup directory and depth, as pruning relies on both,
+	 * and per size mode, which changes what data_bytes holds.
+	 */
+	sha256_init(&ctx);
+	sha256_update(&ctx, backup_dir, strlen(backup_dir));
+	sha256_update(&ctx, &max_depth, sizeof(max_depth));
+	size_mode = scan_get_size_mode();
+	sha256_update(&ctx, &size_mode, sizeof(size_mode));
+	sha256_final(&ctx, digest);
+	sha256_to_hex(digest, hex);
+	snprintf(name, sizeof(name), "catalog-%.16s.idx", hex);
+	path_join(index->file, sizeof(index->file), cache_dir, name);
+
+	load_index(index);
+	pthread_mutex_init(&index->lock, NULL);
+	return index;
+}
+
+bool
+catalog_index_reuse(CatalogIndex *index, const char *path, BackupInfo **backups,
+					const BackupAdapter **claimed)
+{
+	IndexEntry *e;
+	const BackupAdapter *adapter;
+	uint64_t	indexed;
+	BackupInfo *head = NULL;
+	BackupInfo **tail = &head;
+	bool		found;
+
+	*backups = NULL;
+	if (index == NULL)
+		return false;
+
+	pthread_mutex_lock(&index->lock);
+	e = find_slot(index->slots, index->capacity, path);
+	found = e->path != NULL;
+	adapter = e->adapter;
+	indexed = e->fingerprint;
+	pthread_mutex_unlock(&index->lock);
+
+	if (!found || adapter->metadata_files == NULL ||
+		fingerprint(adapter, path) != indexed)
+		return false;
+
+	/* Look again: the table may have grown meanwhile */
+	pthread_mutex_lock(&index->lock);
+	e = find_slot(index->slots, index->capacity, path);
+	for (uint32_t i = 0; e->path != NULL && i < e->nbackups; i++)
+	{
+		BackupInfo *copy = malloc(sizeof(BackupInfo));
+
+		if (copy == NULL)
+		{
+			pthread_mutex_unlock(&index->lock);
+			free_backup_list(head);
+			return false;
+		}
+		*copy = e->backups[i];
+		copy->next = NULL;
+		*tail = copy;
+		tail = &copy->next;
+	}
+	e->seen = e->path != NULL;
+	found = e->path != NULL;
+	pthread_mutex_unlock(&index->lock);
+
+	if (!found)
+		return false;
+
+	*backups = head;
+	if (claimed != NULL)
+		*claimed = adapter;
+	log_debug("Reusing indexed %s scan of: %s", adapter->name, path);
+	return true;
+}
+
+void
+catalog_index_record(CatalogIndex *index, const char *path,
+					 const BackupAdapter *adapter, const BackupInfo *backups)
+{
+	IndexEntry *e;
+	BackupInfo *copies;
+	uint64_t	fp;
+	uint32_t	n = 0;
+
+	if (index == NULL || adapter->metadata_files == NULL)
+		return;
+
+	for (const BackupInfo *b = backups; b != NULL; b = b->next)
+		n++;
+	copies = n > 0 ? malloc((size_t) n * sizeof(BackupInfo)) : NULL;
+	if (n > 0 && copies == NULL)
+		return;
+	n = 0;
+	for (const BackupInfo *b = backups; b != NULL; b = b->next)
+	{
+		copies[n] = *b;
+		copies[n++].next = NULL;
+	}
+	fp = fingerprint(adapter, path);
+
+	pthread_mutex_lock(&index->lock);
+	e = put_entry(index, path);
+	if (e == NULL)
+	{
+		pthread_mutex_unlock(&index->lock);
+		free(copies);
+		return;
+	}
+	free(e->backups);
+	e->adapter = adapter;
+	e->fingerprint = fp;
+	e->nbackups = n;
+	e->backups = copies;
+	e->seen = true;
+	index->dirty = true;
+	pthread_mutex_unlock(&index->lock);
+}
+
+void
+catalog_index_close(CatalogIndex *index)
+{
+	size_t kept = 0;
+
+	if (index == NULL)
+		return;
+
+	/* Drop directories that are gone or no longer hold a backup */
+	for (size_t i = 0; i < index->capacity; i++)
+		if (index->slots[i].path != NULL && index->slots[i].seen)
+			kept++;
+	if (kept != index->count)
+	{
+		IndexEntry *old = index->slots;
+
+		index->slots = calloc(index->capacity, sizeof(IndexEntry));
+		if (index->slots != NULL)
+		{
+			index->count = 0;
+			for (size_t i = 0; i < index->capacity; i++)
+			{
+				if (old[i].path == NULL)
+					continue;
+				if (old[i].seen)
+				{
+					*find_slot(index->slots, index->capacity, old[i].path) = old[i];
+					index->count++;
+				}
+				else
+				{
+					free(old[i].path);
+					free(old[i].backups);
+				}
+			}
+			free(old);
+			index->dirty = true;
+		}
+		else
+			index->slots = old;
+	}
+
+	if (index->dirty)
+		save_index(index);
+
+	free_entries(index);
+	free(index->slots);
+	pthread_mutex_destroy(&index->lock);
+	free(index);
+}
@@ -22,50 +22,56 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "pg_backup_auditor.h"
+#include "catalog_index.h"
+#include "metrics.h"
+#include "decompress.h"
+#include "tar_reader.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <dirent.h>
+#include <pthread.h>
 #include <sys/stat.h>
 
-/*
- * Helper: Add backup to the end of the list
- */
-static void
-add_backup_to_list(BackupInfo **head, BackupInfo *new_backup)
-{
-	if (*head == NULL)
-	{
-		*head = new_backup;
-	}
-	else
-	{
-		BackupInfo *current = *head;
-		while (current->next != NULL)
-			current = current->next;
-		current->next = new_backup;
-	}
-}
-
 /*
  * Helper: Scan a single directory for a backup
- * Returns NULL if no backup detected, or BackupInfo if found
+ * Returns NULL if no backup detected, or BackupInfo if found; 'entries'
+ * are the directory's, read once for all adapters.  *claimed is set to
+ * the adapter that detected a backup, even one that could not be parsed.
+ * What the adapter found is recorded in 'index'; while the backup's
+ * metadata is unchanged, later scans take it from there instead.  Only
+ * complete records are indexed, so reused ones never need
+ * backup_info_load().
  */
 static BackupInfo*
-scan_single_directory(const char *path)
+scan_single_directory(const char *path, const DirSnapshot *entries,
+					  CatalogIndex *index, const BackupAdapter **claimed)
 {
 	BackupAdapter *adapter;
 	BackupInfo *backup;
+	MetricSpan span;
+
+	*claimed = NULL;
+	if (catalog_index_reuse(index, path, &backup, claimed))
+		return backup;
 
 	/* Try to detect backup type using adapters */
-	adapter = detect_backup_type(path);
+	adapter = detect_backup_type_in(path, entries);
 	if (adapter == NULL)
 		return NULL;
 
 	log_debug("Detected %s backup at: %s", adapter->name, path);
+	*claimed = adapter;
 
 	/* Use adapter to scan and parse metadata */
+	metrics_phase_begin(&span, METRIC_PHASE_METADATA);
 	backup = adapter->scan(path);
+	metrics_phase_end(&span);
+	metrics_count(METRIC_BACKUPS_SCANNED, 1);
+	if (scan_get_load_level() == BACKUP_LOAD_FULL)
+		catalog_index_record(index, path, adapter, backup);
 	if (backup == NULL)
 	{
 		log_debug("Failed to parse backup metadata at: %s", path);
@@ -75,84 +81,417 @@ scan_single_directory(const char *path)
 	return backup;
 }
 
+/* Directories waiting for a worker; when full, a worker scans inline */
+#define SCAN_QUEUE_SIZE 256
+
+static int scan_jobs = DEFAULT_THREADS;
+static SizeMode size_mode = SIZE_MODE_METADATA;
+static BackupLoadLevel load_level = BACKUP_LOAD_FULL;
+
 /*
- * Helper: Recursively scan directory tree for backups
- * max_depth: maximum recursion depth (0 = current dir only, -1 = unlimited)
+ * Set the number of threads scan_backup_directory() uses.  Values below 1
+ * are treated as 1.
+ */
+void
+scan_set_jobs(int jobs)
+{
+	scan_jobs = (jobs < 1) ? 1 : jobs;
+}
+
+int
+scan_get_jobs(void)
+{
+	return scan_jobs;
+}
+
+void
+scan_set_size_mode(SizeMode mode)
+{
+	size_mode = mode;
+}
+
+SizeMode
+scan_get_size_mode(void)
+{
+	return size_mode;
+}
+
+bool
+size_mode_from_string(const char *str, SizeMode *out)
+{
+	if (strcasecmp(str, "metadata") == 0)
+		*out = SIZE_MODE_METADATA;
+	else if (strcasecmp(str, "walk") == 0)
+		*out = SIZE_MODE_WALK;
+	else if (strcasecmp(str, "none") == 0)
+		*out = SIZE_MODE_NONE;
+	else
+		return false;
+	return true;
+}
+
+/*
+ * Size of the backup at 'path', given the total its metadata records
+ * ('metadata_bytes', 0 if none).  Walking the directory stats every file
+ * of the backup, so it is done only when the metadata has no total or
+ * on-disk usage was asked for.
+ */
+uint64_t
+scan_resolve_size(const char *path, uint64_t metadata_bytes)
+{
+	if (size_mode == SIZE_MODE_WALK ||
+		(size_mode == SIZE_MODE_METADATA && metadata_bytes == 0))
+		return get_directory_size(path);
+	return metadata_bytes;
+}
+
+void
+scan_set_load_level(BackupLoadLevel level)
+{
+	load_level = level;
+}
+
+BackupLoadLevel
+scan_get_load_level(void)
+{
+	return load_level;
+}
+
+/*
+ * Load whatever a BACKUP_LOAD_IDENTITY scan left out of 'info'.  Returns
+ * false if the adapter could not read the rest; the record stays partial.
+ */
+bool
+backup_info_load(BackupInfo *info)
+{
+	BackupAdapter *adapter;
+	MetricSpan span;
+	bool loaded;
+
+	if (info == NULL || !info->partial)
+		return true;
+
+	adapter = get_adapter_for_tool(info->tool);
+	metrics_phase_begin(&span, METRIC_PHASE_METADATA);
+	loaded = adapter == NULL || adapter->load_details == NULL ||
+		adapter->load_details(info);
+	metrics_phase_end(&span);
+	if (!loaded)
+	{
+		log_debug("Failed to load details of backup %s", info->backup_id);
+		return false;
+	}
+
+	info->partial = false;
+	return true;
+}
+
+/*
+ * One directory of the scanned tree.  Its backups and subdirectories are
+ * filled in by whichever worker scans it; the tree is walked in order
+ * afterwards, so the result does not depend on which worker got there
+ * first.
+ */
+typedef struct ScanNode {
+	char			*path;
+	int				 depth;
+	BackupInfo		*backups;
+	struct ScanNode **children;		/* in readdir order */
+	int				 nchildren;
+} ScanNode;
+
+typedef struct {
+	ScanNode	   *ring[SCAN_QUEUE_SIZE];
+	int				head;
+	int				count;
+	int				busy;			/* workers scanning a directory */
+	bool			threaded;		/* false: everything is scanned inline */
+	int				max_depth;
+	CatalogIndex   *index;
+	pthread_mutex_t lock;
+	pthread_cond_t	cond;
+} ScanQueue;
+
+static ScanNode *
+scan_node_new(const char *path, int depth)
+{
+	ScanNode *node = calloc(1, sizeof(ScanNode));
+
+	if (node == NULL)
+		return NULL;
+	node->path = strdup(path);
+	if (node->path == NULL)
+	{
+		free(node);
+		return NULL;
+	}
+	node->depth = depth;
+	return node;
+}
+
+/* Hand 'node' to another worker; false if the queue is full */
+static bool
+scan_queue_push(ScanQueue *queue, ScanNode *node)
+{
+	bool pushed = false;
+
+	if (!queue->threaded)
+		return false;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count < SCAN_QUEUE_SIZE)
+	{
+		queue->ring[(queue->head + queue->count) % SCAN_QUEUE_SIZE] = node;
+		queue->count++;
+		pushed = true;
+		pthread_cond_signal(&queue->cond);
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return pushed;
+}
+
+/*
+ * Scan one directory: read its entries once, detect a backup in them,
+ * then queue its subdirectories (or scan them here, if the queue is
+ * full or there are no other workers).  The directories of a detected
+ * backup (base/, database/, pg_wal/, ...) are not descended into, unless
+ * its adapter says further backups can lie below it.
  */
 static void
-scan_directory_recursive(const char *dir_path, BackupInfo **backup_list, int depth, int max_depth)
+scan_node(ScanQueue *queue, ScanNode *node)
 {
-	DIR *dir;
-	struct dirent *entry;
-	struct stat statbuf;
+	DirSnapshot entries;
+	const BackupAdapter *claimed;
 	char path[PATH_MAX];
-	BackupInfo *backup;
-
-	/* Check depth limit */
-	if (max_depth >= 0 && depth > max_depth)
-		return;
+	int capacity = 0;
 
-	/* Open directory */
-	dir = opendir(dir_path);
-	if (dir == NULL)
+	if (!dir_snapshot_read(node->path, &entries))
 	{
-		log_debug("Cannot open directory: %s", dir_path);
+		log_debug("Cannot open directory: %s", node->path);
 		return;
 	}
 
-	log_debug("Scanning directory (depth=%d): %s", depth, dir_path);
+	log_debug("Scanning directory (depth=%d): %s", node->depth, node->path);
 
 	/* Try to detect backup in current directory */
-	backup = scan_single_directory(dir_path);
-	if (backup != NULL)
+	node->backups = scan_single_directory(node->path, &entries, queue->index,
+										  &claimed);
+	if (claimed != NULL && !claimed->nested)
 	{
-		add_backup_to_list(backup_list, backup);
+		dir_snapshot_free(&entries);
+		return;
 	}
 
-	/* Scan subdirectories */
-	while ((entry = readdir(dir)) != NULL)
+	/* Collect subdirectories, unless they would exceed the depth limit */
+	for (int i = 0;
+		 (queue->max_depth < 0 || node->depth < queue->max_depth) && i < entries.count;
+		 i++)
 	{
-		/* Skip . and .. */
-		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+		ScanNode *child;
+
+		if (!entries.entries[i].is_dir)
 			continue;
 
 		/* Build full path */
-		path_join(path, sizeof(path), dir_path, entry->d_name);
+		path_join(path, sizeof(path), node->path, entries.entries[i].name);
 
-		/* Check if it's a directory */
-		if (stat(path, &statbuf) != 0)
+		if (node->nchildren == capacity)
 		{
-			log_warning("Failed to stat: %s", path);
-			continue;
+			int        nc = capacity ? capacity * 2 : 8;
+			ScanNode **grown = realloc(node->children, sizeof(ScanNode *) * nc);
+
+			if (grown == NULL)
+			{
+				log_warning("Out of memory while scanning: %s", node->path);
+				break;
+			}
+			node->children = grown;
+			capacity = nc;
 		}
+		child = scan_node_new(path, node->depth + 1);
+		if (child == NULL)
+		{
+			log_warning("Out of memory while scanning: %s", node->path);
+			break;
+		}
+		node->children[node->nchildren++] = child;
+	}
 
-		if (!S_ISDIR(statbuf.st_mode))
-			continue;
+	dir_snapshot_free(&entries);
+
+	for (int i = 0; i < node->nchildren; i++)
+		if (!scan_queue_push(queue, node->children[i]))
+			scan_node(queue, node->children[i]);
+}
+
+/* Take queued directories until the queue is empty and nobody is busy */
+static void *
+scan_worker(void *arg)
+{
+	ScanQueue *queue = arg;
 
-		/* Recurse into subdirectory */
-		scan_directory_recursive(path, backup_list, depth + 1, max_depth);
+	metrics_set_thread_phase(METRIC_PHASE_SCAN);
+	pthread_mutex_lock(&queue->lock);
+	for (;;)
+	{
+		ScanNode *node;
+
+		while (queue->count == 0 && queue->busy > 0)
+			pthread_cond_wait(&queue->cond, &queue->lock);
+		if (queue->count == 0)
+			break;
+
+		node = queue->ring[queue->head];
+		queue->head = (queue->head + 1) % SCAN_QUEUE_SIZE;
+		queue->count--;
+		queue->busy++;
+		pthread_mutex_unlock(&queue->lock);
+
+		scan_node(queue, node);
+
+		pthread_mutex_lock(&queue->lock);
+		queue->busy--;
+		if (queue->busy == 0 && queue->count == 0)
+			pthread_cond_broadcast(&queue->cond);
 	}
+	pthread_mutex_unlock(&queue->lock);
+	return NULL;
+}
 
-	closedir(dir);
+/*
+ * Append the tree's backups in depth-first order, freeing the nodes.
+ * 'tail' is the last link of the list, so appending never walks it.
+ */
+static void
+collect_scan_tree(ScanNode *node, BackupInfo ***tail)
+{
+	**tail = node->backups;
+	while (**tail != NULL)
+		*tail = &(**tail)->next;
+	for (int i = 0; i < node->nchildren; i++)
+		collect_scan_tree(node->children[i], tail);
+	free(node->children);
+	free(node->path);
+	free(node);
+}
+
+/*
+ * Helper: Scan directory tree for backups
+ * max_depth: maximum recursion depth (0 = current dir only, -1 = unlimited)
+ *
+ * With several scan jobs, directories are scanned by a pool of threads
+ * sharing a bounded queue, which hides per-directory metadata latency on
+ * network file systems.  The result is in the same order as a
+ * single-threaded depth-first scan.
+ */
+static void
+scan_directory_tree(const char *dir_path, BackupInfo **backup_list, int max_depth,
+					CatalogIndex *index)
+{
+	ScanQueue	queue;
+	ScanNode   *root = scan_node_new(dir_path, 0);
+	pthread_t  *threads = NULL;
+	int			started = 0;
+
+	if (root == NULL)
+		return;
+
+	memset(&queue, 0, sizeof(queue));
+	queue.max_depth = max_depth;
+	queue.index = index;
+	pthread_mutex_init(&queue.lock, NULL);
+	pthread_cond_init(&queue.cond, NULL);
+
+	if (scan_jobs > 1)
+		threads = malloc(sizeof(pthread_t) * (scan_jobs - 1));
+	queue.threaded = threads != NULL;
+
+	/* The calling thread scans the root; workers pick up what it queues */
+	queue.busy = 1;
+	if (threads != NULL)
+	{
+		for (int t = 0; t < scan_jobs - 1; t++)
+		{
+			if (pthread_create(&threads[started], NULL, scan_worker, &queue) != 0)
+				break;
+			started++;
+		}
+	}
+
+	scan_node(&queue, root);
+
+	pthread_mutex_lock(&queue.lock);
+	queue.busy--;
+	pthread_cond_broadcast(&queue.cond);
+	pthread_mutex_unlock(&queue.lock);
+	scan_worker(&queue);
+
+	for (int t = 0; t < started; t++)
+		pthread_join(threads[t], NULL);
+	free(threads);
+	pthread_cond_destroy(&queue.cond);
+	pthread_mutex_destroy(&queue.lock);
+
+	while (*backup_list != NULL)
+		backup_list = &(*backup_list)->next;
+	collect_scan_tree(root, &backup_list);
+}
+
+/* A backup in start_lsn order; 'pos' keeps list order among equal LSNs */
+typedef struct {
+	XLogRecPtr  start_lsn;
+	int         pos;
+	BackupInfo *backup;
+} LsnEntry;
+
+static int
+compare_lsn_entries(const void *a, const void *b)
+{
+	const LsnEntry *ea = a;
+	const LsnEntry *eb = b;
+
+	if (ea->start_lsn != eb->start_lsn)
+		return (ea->start_lsn < eb->start_lsn) ? -1 : 1;
+	return (ea->pos > eb->pos) - (ea->pos < eb->pos);
 }
 
 /*
  * link_incremental_chains — post-scan pass for pg_basebackup 17+ incrementals.
  *
  * pg_basebackup does not store a parent backup ID; instead, backup_label
- * contains "INCREMENTAL FROM LSN: X/X" which equals the stop_lsn of the
- * parent.  The adapter stores this value in redo_lsn.  Here we match it
- * against stop_lsn of other backups and populate parent_backup_id so that
- * the tree display in cmd_list works uniformly across all tools.
+ * contains "INCREMENTAL FROM LSN: X/X", the LSN the parent started at.
+ * The adapter stores this value in redo_lsn.  Here we match it against
+ * start_lsn of other backups and populate parent_backup_id so that the
+ * tree display in cmd_list works uniformly across all tools.
  */
 static void
 link_incremental_chains(BackupInfo *list)
 {
 	BackupInfo *incr;
-	BackupInfo *candidate;
+	LsnEntry   *by_lsn;
+	int         count = 0;
+	int         n = 0;
+
+	for (incr = list; incr != NULL; incr = incr->next)
+		count++;
+
+	/* Sorted once, then each incremental is a binary search */
+	by_lsn = malloc(count * sizeof(LsnEntry));
+	if (by_lsn == NULL)
+		return;
+	for (incr = list; incr != NULL; incr = incr->next, n++)
+	{
+		by_lsn[n].start_lsn = incr->start_lsn;
+		by_lsn[n].pos = n;
+		by_lsn[n].backup = incr;
+	}
+	qsort(by_lsn, count, sizeof(LsnEntry), compare_lsn_entries);
 
 	for (incr = list; incr != NULL; incr = incr->next)
 	{
+		int lo = 0;
+		int hi = count;
+
 		if (incr->type != BACKUP_TYPE_INCREMENTAL)
 			continue;
 		if (incr->parent_backup_id[0] != '\0')
@@ -163,22 +502,33 @@ link_incremental_chains(BackupInfo *list)
 		/* Find backup whose start_lsn matches this incremental's redo_lsn.
 		 * INCREMENTAL FROM LSN in backup_label is the checkpoint LSN at the
 		 * start of the previous backup, i.e. its start_lsn. */
-		for (candidate = list; candidate != NULL; candidate = candidate->next)
+		while (lo < hi)
 		{
+			int mid = lo + (hi - lo) / 2;
+
+			if (by_lsn[mid].start_lsn < incr->redo_lsn)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		for (; lo < count && by_lsn[lo].start_lsn == incr->redo_lsn; lo++)
+		{
+			BackupInfo *candidate = by_lsn[lo].backup;
+
 			if (candidate == incr)
 				continue;
-			if (candidate->start_lsn == incr->redo_lsn)
-			{
-				snprintf(incr->parent_backup_id, sizeof(incr->parent_backup_id),
-						 "%s", candidate->backup_id);
-				log_debug("Linked incremental %s → parent %s (via LSN %lX/%X)",
-						  incr->backup_id, candidate->backup_id,
-						  (unsigned long)(incr->redo_lsn >> 32),
-						  (unsigned int)(incr->redo_lsn & 0xFFFFFFFF));
-				break;
-			}
+			snprintf(incr->parent_backup_id, sizeof(incr->parent_backup_id),
+					 "%s", candidate->backup_id);
+			log_debug("Linked incremental %s → parent %s (via LSN %lX/%X)",
+					  incr->backup_id, candidate->backup_id,
+					  (unsigned long)(incr->redo_lsn >> 32),
+					  (unsigned int)(incr->redo_lsn & 0xFFFFFFFF));
+			break;
 		}
 	}
+
+	free(by_lsn);
 }
 
 /*
@@ -195,16 +545,22 @@ BackupInfo*
 scan_backup_directory(const char *backup_dir, int max_depth)
 {
 	BackupInfo *backup_list = NULL;
+	CatalogIndex *index;
+	MetricSpan span;
 
+	metrics_phase_begin(&span, METRIC_PHASE_SCAN);
 	log_debug("Starting recursive backup scan: %s (max_depth=%d)", backup_dir, max_depth);
 
-	/* Recursively scan with specified max depth */
-	scan_directory_recursive(backup_dir, &backup_list, 0, max_depth);
+	/* Scan with specified max depth, reusing indexed backups */
+	index = catalog_index_open(backup_dir, max_depth);
+	scan_directory_tree(backup_dir, &backup_list, max_depth, index);
+	catalog_index_close(index);
 
 	/* Link pg_basebackup 17+ incrementals to their parents via LSN */
 	if (backup_list != NULL)
 		link_incremental_chains(backup_list);
 
+	metrics_phase_end(&span);
 	return backup_list;
 }
 
@@ -232,19 +588,421 @@ compare_wal_segments(const void *a, const void *b)
 	return 0;
 }
 
+/* A segment file found while scanning, before the archive is assembled */
+typedef struct {
+	WALSegmentName  seg;
+	WALSegmentFile  file;
+	WALSegmentStat  stat;
+} WALScanEntry;
+
+typedef struct {
+	WALScanEntry   *entries;
+	int             count;
+	int             capacity;
+	uint64_t        total_bytes;    /* every regular file seen, segments or not */
+	uint32_t       *history;        /* timelines with a NNNNNNNN.history file */
+	int             history_count;
+	int             history_capacity;
+} WALScanList;
+
 /*
- * Scan WAL archive directory
+ * Sort by segment; among copies of the same segment the bare top-level
+ * file sorts first, so it is the one kept.
  */
-WALArchiveInfo*
-scan_wal_archive(const char *wal_archive_dir)
+static int
+compare_wal_scan_entries(const void *a, const void *b)
+{
+	const WALScanEntry *ea = (const WALScanEntry *)a;
+	const WALScanEntry *eb = (const WALScanEntry *)b;
+	int cmp = compare_wal_segments(&ea->seg, &eb->seg);
+
+	if (cmp != 0)
+		return cmp;
+	if ((ea->file.suffix == NULL) != (eb->file.suffix == NULL))
+		return ea->file.suffix == NULL ? -1 : 1;
+	if (ea->file.in_subdir != eb->file.in_subdir)
+		return ea->file.in_subdir ? 1 : -1;
+	if (ea->file.suffix != NULL)
+		return strcmp(ea->file.suffix, eb->file.suffix);
+	return 0;
+}
+
+/* Below this many segments a comparison sort is as quick */
+#define WAL_RADIX_MIN   256
+
+/* Byte 'b' (0 = least significant) of the (timeline, log_id, seg_id) key */
+static unsigned
+wal_scan_key_byte(const WALScanEntry *e, int b)
+{
+	uint32_t word = b < 4 ? e->seg.seg_id : b < 8 ? e->seg.log_id : e->seg.timeline;
+
+	return (word >> ((b % 4) * 8)) & 0xFF;
+}
+
+/*
+ * Sort scanned segments by (timeline, log_id, seg_id).
+ *
+ * A least-significant-digit radix sort over the 12 key bytes.  It is
+ * stable, and a byte that is the same in every entry (nearly all of the
+ * timeline and log_id bytes in practice) costs one counting pass and no
+ * moves, so a large archive is sorted in a few linear passes.  Copies of
+ * one segment stay in directory order; the caller picks among them.
+ * Small lists, or no memory for the second buffer, fall back to qsort().
+ */
+static void
+sort_wal_scan_entries(WALScanEntry *entries, int count)
+{
+	WALScanEntry *buf;
+	WALScanEntry *src = entries;
+	WALScanEntry *dst;
+	int           counts[256];
+
+	if (count < WAL_RADIX_MIN ||
+		(buf = malloc((size_t) count * sizeof(WALScanEntry))) == NULL)
+	{
+		qsort(entries, count, sizeof(WALScanEntry), compare_wal_scan_entries);
+		return;
+	}
+	dst = buf;
+
+	for (int b = 0; b < 12; b++)
+	{
+		int sum = 0;
+
+		memset(counts, 0, sizeof(counts));
+		for (int i = 0; i < count; i++)
+			counts[wal_scan_key_byte(&src[i], b)]++;
+		if (counts[wal_scan_key_byte(&src[0], b)] == count)
+			continue;   /* same byte everywhere: already in order */
+
+		for (int d = 0; d < 256; d++)
+		{
+			int n = counts[d];
+
+			counts[d] = sum;
+			sum += n;
+		}
+		for (int i = 0; i < count; i++)
+			dst[counts[wal_scan_key_byte(&src[i], b)]++] = src[i];
+
+		{
+			WALScanEntry *tmp = src;
+
+			src = dst;
+			dst = tmp;
+		}
+	}
+
+	if (src != entries)
+		memcpy(entries, src, (size_t) count * sizeof(WALScanEntry));
+	free(buf);
+}
+
+/* pgBackRest groups segments in <timeline><log_id>/ directories (16 hex) */
+static bool
+is_wal_subdir_name(const char *name)
+{
+	if (strlen(name) != 16)
+		return false;
+	for (int i = 0; i < 16; i++)
+		if (!((name[i] >= '0' && name[i] <= '9') ||
+			  (name[i] >= 'A' && name[i] <= 'F')))
+			return false;
+	return true;
+}
+
+/* Timeline of a NNNNNNNN.history file name, or 0 */
+static uint32_t
+history_file_timeline(const char *name)
+{
+	for (int i = 0; i < 8; i++)
+		if (!isxdigit((unsigned char) name[i]))
+			return 0;
+	if (strcmp(name + 8, ".history") != 0)
+		return 0;
+	return (uint32_t) strtoul(name, NULL, 16);
+}
+
+/*
+ * Collect the segment files of one directory.  At the top level,
+ * pgBackRest-style <timeline><log_id>/ subdirectories are scanned too.
+ * Every entry is looked up once with fstatat(): segments keep their size
+ * and mtime, and the size of all regular files (history files, backup
+ * labels, archive_status/) is added to list->total_bytes, so the archive
+ * never has to be walked again to report its size.  Returns false on
+ * out-of-memory.
+ */
+static bool
+scan_wal_dir(const char *dir_path, bool in_subdir, WALScanList *list)
 {
 	DIR *dir;
 	struct dirent *entry;
+	struct stat st;
+	WALScanEntry e;
+	const char *suffix;
+	bool ok = true;
+
+	dir = opendir(dir_path);
+	if (dir == NULL)
+		return true;    /* unreadable subdirectory: nothing to add */
+
+	while (ok && (entry = readdir(dir)) != NULL)
+	{
+		/* Skip . and .. */
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+
+		/* Follow symlinks, as get_directory_size() does */
+		if (fstatat(dirfd(dir), entry->d_name, &st, 0) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode))
+		{
+			char sub_path[PATH_MAX];
+
+			path_join(sub_path, sizeof(sub_path), dir_path, entry->d_name);
+			if (!in_subdir && is_wal_subdir_name(entry->d_name))
+				ok = scan_wal_dir(sub_path, true, list);
+			else
+				list->total_bytes += get_directory_size(sub_path);
+			continue;
+		}
+		if (!S_ISREG(st.st_mode))
+			continue;
+		list->total_bytes += st.st_size;
+
+		/* Remember history files; they are read once the scan is done */
+		if (!in_subdir && history_file_timeline(entry->d_name) != 0)
+		{
+			if (list->history_count >= list->history_capacity)
+			{
+				int       new_capacity = list->history_capacity > 0 ?
+					list->history_capacity * 2 : 16;
+				uint32_t *history = realloc(list->history,
+											new_capacity * sizeof(uint32_t));
+
+				if (history == NULL)
+				{
+					log_warning("Out of memory while scanning WAL archive");
+					ok = false;
+					break;
+				}
+				list->history = history;
+				list->history_capacity = new_capacity;
+			}
+			list->history[list->history_count++] = history_file_timeline(entry->d_name);
+			continue;
+		}
+
+		/* Try to parse as WAL filename, possibly compressed or hashed */
+		if (!parse_wal_segment_file(entry->d_name, &e.seg, &suffix))
+			continue;  /* Not a WAL segment, skip */
+
+		/* Subdirectory must match the segment it holds */
+		if (in_subdir &&
+			strncmp(entry->d_name, strrchr(dir_path, '/') + 1, 16) != 0)
+			continue;
+
+		/* Resize array if needed */
+		if (list->count >= list->capacity)
+		{
+			int new_capacity = list->capacity * 2;
+			WALScanEntry *new_entries = realloc(list->entries,
+												new_capacity * sizeof(WALScanEntry));
+			if (new_entries == NULL)
+			{
+				log_warning("Out of memory while scanning WAL archive");
+				ok = false;
+				break;
+			}
+			list->entries = new_entries;
+			list->capacity = new_capacity;
+		}
+
+		e.file.in_subdir = in_subdir;
+		e.file.suffix = NULL;
+		if (suffix[0] != '\0' && (e.file.suffix = strdup(suffix)) == NULL)
+		{
+			log_warning("Out of memory while scanning WAL archive");
+			ok = false;
+			break;
+		}
+		e.stat.size = st.st_size;
+		e.stat.mtime = st.st_mtime;
+
+		/* Add segment to array */
+		list->entries[list->count++] = e;
+	}
+
+	closedir(dir);
+	return ok;
+}
+
+static bool read_history_stream(FILE *fp, const char *name, uint32_t tli,
+								WALTimeline **timelines, int *count);
+
+/* Largest history file read from a tar archive */
+#define WAL_TAR_HISTORY_MAX  (1024 * 1024)
+
+/* Merge history member 'name' of 'tr', timeline 'tli', into info's graph */
+static void
+read_tar_history(TarReader *tr, const TarMember *member, uint32_t tli,
+				 WALArchiveInfo *info)
+{
+	char	   *data;
+	ssize_t		got = 0;
+	FILE	   *fp;
+
+	if (member->size > WAL_TAR_HISTORY_MAX ||
+		(data = malloc((size_t) member->size + 1)) == NULL)
+	{
+		log_warning("Cannot read timeline history file %s", member->name);
+		return;
+	}
+	while ((uint64_t) got < member->size)
+	{
+		ssize_t n = tar_reader_read(tr, data + got, (size_t) member->size - got);
+
+		if (n <= 0)
+			break;
+		got += n;
+	}
+	fp = (uint64_t) got == member->size && got > 0 ?
+		fmemopen(data, (size_t) got, "r") : NULL;
+	if (fp == NULL ||
+		!read_history_stream(fp, member->name, tli, &info->timelines,
+							 &info->timeline_count))
+		log_warning("Cannot read timeline history file %s", member->name);
+	if (fp != NULL)
+		fclose(fp);
+	free(data);
+}
+
+/*
+ * Collect the segments of a WAL tar archive -- the pg_wal.tar* of a
+ * tar-format stream backup -- from its member headers, in one pass.
+ * Segment data is not extracted: it is skipped, by seeking when the tar
+ * is not compressed, except for the first segment's long page header,
+ * which gives info->segment_size.  History files are small and parsed
+ * into info->timelines as they go by.  Members count with the size
+ * stored in the tar; list->total_bytes is that of the tar file itself.
+ * Returns false if the archive cannot be opened or memory runs out.
+ */
+static bool
+scan_wal_tar(const char *tar_path, WALScanList *list, WALArchiveInfo *info)
+{
+	TarReader  *tr;
+	TarMember	member;
+	WALScanEntry e;
+	const char *suffix;
+	off_t		size;
+	int			rc = 0;
+	bool		ok = true;
+
+	tr = tar_reader_open(tar_path);
+	if (tr == NULL)
+	{
+		log_warning("Cannot open WAL tar archive: %s", tar_path);
+		return false;
+	}
+	size = get_file_size(tar_path);
+	list->total_bytes = size > 0 ? (uint64_t) size : 0;
+
+	while (ok && (rc = tar_reader_next(tr, &member)) == 1)
+	{
+		uint32_t tli;
+
+		/* Segments are at the top; archive_status/ is of no interest */
+		if (member.type != TAR_TYPE_REGULAR || strchr(member.name, '/') != NULL)
+			continue;
+
+		if ((tli = history_file_timeline(member.name)) != 0)
+		{
+			read_tar_history(tr, &member, tli, info);
+			continue;
+		}
+
+		/* Only bare segments: the tar as a whole may be compressed */
+		if (!parse_wal_segment_file(member.name, &e.seg, &suffix) ||
+			suffix[0] != '\0')
+			continue;
+
+		if (info->segment_size == 0)
+		{
+			uint8_t		hdr[40];
+			ssize_t		got = 0;
+			ssize_t		n = 1;
+
+			while ((size_t) got < sizeof(hdr) &&
+				   (n = tar_reader_read(tr, hdr + got, sizeof(hdr) - got)) > 0)
+				got += n;
+			if ((size_t) got == sizeof(hdr))
+			{
+				/* xlp_seg_size follows xlp_sysid in XLogLongPageHeaderData */
+				uint32_t seg_size = (uint32_t) hdr[32] | (uint32_t) hdr[33] << 8 |
+					(uint32_t) hdr[34] << 16 | (uint32_t) hdr[35] << 24;
+
+				if (seg_size != 0 && (seg_size & (seg_size - 1)) == 0 &&
+					seg_size >= (1U << 20) && seg_size <= (1U << 30))
+					info->segment_size = seg_size;
+			}
+		}
+
+		if (list->count >= list->capacity)
+		{
+			int new_capacity = list->capacity * 2;
+			WALScanEntry *new_entries = realloc(list->entries,
+												new_capacity * sizeof(WALScanEntry));
+			if (new_entries == NULL)
+			{
+				log_warning("Out of memory while scanning WAL archive");
+				ok = false;
+				break;
+			}
+			list->entries = new_entries;
+			list->capacity = new_capacity;
+		}
+		e.file.in_subdir = false;
+		e.file.suffix = NULL;
+		e.stat.size = member.size;
+		e.stat.mtime = member.mtime;
+		list->entries[list->count++] = e;
+	}
+	if (ok && rc < 0)
+		log_warning("WAL tar archive %s is damaged; listing only the members before it",
+					tar_path);
+
+	tar_reader_close(tr);
+	return ok;
+}
+
+/*
+ * Scan WAL archive directory
+ *
+ * Segments are recognised in every form archivers store them: bare
+ * 24-character files, compressed copies (<name>.gz, .lz4, .zst, ...), and
+ * pgBackRest's <timeline><log_id>/<name>-<sha1>[.ext] layout.  The on-disk
+ * form of each non-bare segment is kept in info->files so validators can
+ * open it; use wal_archive_segment_path() rather than building the path
+ * from the segment name.  When a segment is present more than once the
+ * bare file wins.
+ *
+ * The directory is listed once: info->stats and info->total_bytes carry
+ * the sizes callers report, so nothing needs to walk the archive again.
+ * The history files found are parsed into info->timelines, so timeline
+ * checks query the graph instead of reopening them.
+ *
+ * 'wal_archive_dir' may also be a tar file holding the segments, as
+ * pg_basebackup writes pg_wal.tar* for a tar-format stream backup; see
+ * scan_wal_tar().  Such an archive has info->in_tar set.
+ */
+static WALArchiveInfo*
+scan_wal_archive_dir(const char *wal_archive_dir)
+{
 	WALArchiveInfo *info;
-	WALSegmentName *segments = NULL;
-	int segment_count = 0;
-	int segment_capacity = 1024;  /* Initial capacity */
-	WALSegmentName seg;
+	WALScanList list;
+	bool any_file = false;
+	int n = 0;
 
 	if (wal_archive_dir == NULL)
 		return NULL;
@@ -256,72 +1014,549 @@ scan_wal_archive(const char *wal_archive_dir)
 
 	strncpy(info->archive_path, wal_archive_dir, sizeof(info->archive_path) - 1);
 
-	/* Allocate initial array for segments */
-	segments = malloc(segment_capacity * sizeof(WALSegmentName));
-	if (segments == NULL)
+	if (is_regular_file(wal_archive_dir))
+		info->in_tar = true;
+	else if (!is_directory(wal_archive_dir))
 	{
+		log_warning("Cannot open WAL archive directory: %s", wal_archive_dir);
 		free(info);
 		return NULL;
 	}
 
-	/* Open directory */
-	dir = opendir(wal_archive_dir);
-	if (dir == NULL)
+	/* Allocate initial array for segments */
+	list.count = 0;
+	list.capacity = 1024;  /* Initial capacity */
+	list.total_bytes = 0;
+	list.history = NULL;
+	list.history_count = 0;
+	list.history_capacity = 0;
+	list.entries = malloc(list.capacity * sizeof(WALScanEntry));
+	if (list.entries == NULL)
 	{
-		log_warning("Cannot open WAL archive directory: %s", wal_archive_dir);
-		free(segments);
 		free(info);
 		return NULL;
 	}
 
 	log_debug("Scanning WAL archive: %s", wal_archive_dir);
 
-	/* Scan directory for WAL segment files */
-	while ((entry = readdir(dir)) != NULL)
+	if (info->in_tar)
 	{
-		/* Skip . and .. */
-		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-			continue;
+		if (!scan_wal_tar(wal_archive_dir, &list, info))
+		{
+			free(list.entries);
+			free_wal_archive_info(info);
+			return NULL;
+		}
+	}
+	else
+		scan_wal_dir(wal_archive_dir, false, &list);
 
-		/* Try to parse as WAL filename */
-		if (!parse_wal_filename(entry->d_name, &seg))
-			continue;  /* Not a WAL segment, skip */
+	log_debug("Found %d WAL segments", list.count);
 
-		/* Resize array if needed */
-		if (segment_count >= segment_capacity)
+	/* Sort segments by timeline, log_id, seg_id */
+	if (list.count > 0)
+		sort_wal_scan_entries(list.entries, list.count);
+
+	/* Drop duplicates, keeping the preferred copy (see compare_wal_scan_entries) */
+	for (int i = 0; i < list.count; i++)
+	{
+		if (n > 0 && compare_wal_segments(&list.entries[n - 1].seg,
+										  &list.entries[i].seg) == 0)
 		{
-			segment_capacity *= 2;
-			WALSegmentName *new_segments = realloc(segments,
-												   segment_capacity * sizeof(WALSegmentName));
-			if (new_segments == NULL)
+			if (compare_wal_scan_entries(&list.entries[i], &list.entries[n - 1]) < 0)
 			{
-				log_warning("Out of memory while scanning WAL archive");
-				break;
+				WALScanEntry tmp = list.entries[n - 1];
+
+				list.entries[n - 1] = list.entries[i];
+				list.entries[i] = tmp;
 			}
-			segments = new_segments;
+			free(list.entries[i].file.suffix);
+			continue;
 		}
-
-		/* Add segment to array */
-		segments[segment_count++] = seg;
+		list.entries[n++] = list.entries[i];
 	}
+	for (int i = 0; i < n; i++)
+		if (list.entries[i].file.suffix != NULL || list.entries[i].file.in_subdir)
+			any_file = true;
 
-	closedir(dir);
+	/* Store results */
+	info->segment_count = n;
+	info->total_bytes = list.total_bytes;
+	info->segments = malloc((n > 0 ? n : 1) * sizeof(WALSegmentName));
+	info->stats = malloc((n > 0 ? n : 1) * sizeof(WALSegmentStat));
+	if (any_file)
+		info->files = malloc(n * sizeof(WALSegmentFile));
+	if (info->segments == NULL || info->stats == NULL ||
+		(any_file && info->files == NULL))
+	{
+		for (int i = 0; i < n; i++)
+			free(list.entries[i].file.suffix);
+		free(list.entries);
+		free(list.history);
+		free_wal_archive_info(info);
+		return NULL;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		info->segments[i] = list.entries[i].seg;
+		info->stats[i] = list.entries[i].stat;
+		if (any_file)
+			info->files[i] = list.entries[i].file;
+	}
+	free(list.entries);
 
-	log_debug("Found %d WAL segments", segment_count);
+	if (!info->in_tar)
+		info->segment_size = wal_archive_read_segment_size(info);
+	info->ranges = wal_segment_ranges_build(info->segments, n, info->segment_size,
+											&info->range_count);
+	if (info->ranges == NULL)
+	{
+		free_wal_archive_info(info);
+		return NULL;
+	}
+	log_debug("WAL archive holds %d run%s of consecutive segments",
+			  info->range_count, info->range_count == 1 ? "" : "s");
 
-	/* Sort segments by timeline, log_id, seg_id */
-	if (segment_count > 0)
+	for (int i = 0; i < list.history_count; i++)
+		if (!wal_timelines_load_history(wal_archive_dir, list.history[i],
+										&info->timelines, &info->timeline_count))
+			log_warning("Cannot read timeline history file %08X.history",
+						list.history[i]);
+	free(list.history);
+	if (info->timelines == NULL &&
+		(info->timelines = malloc(sizeof(WALTimeline))) == NULL)
 	{
-		qsort(segments, segment_count, sizeof(WALSegmentName), compare_wal_segments);
+		free_wal_archive_info(info);
+		return NULL;
 	}
+	log_debug("WAL archive holds %d timeline history file%s",
+			  list.history_count, list.history_count == 1 ? "" : "s");
 
-	/* Store results */
-	info->segments = segments;
-	info->segment_count = segment_count;
+	return info;
+}
+
+/* scan_wal_archive_dir(), timed as the WAL inventory phase */
+WALArchiveInfo*
+scan_wal_archive(const char *wal_archive_dir)
+{
+	WALArchiveInfo *info;
+	MetricSpan span;
 
+	metrics_phase_begin(&span, METRIC_PHASE_WAL_INVENTORY);
+	info = scan_wal_archive_dir(wal_archive_dir);
+	metrics_phase_end(&span);
 	return info;
 }
 
+/*
+ * Node of 'tli' in the sorted array, inserting it if it is new; NULL on
+ * out-of-memory.  The pointer is only valid until the next insertion.
+ */
+static WALTimeline *
+timeline_node(WALTimeline **timelines, int *count, uint32_t tli)
+{
+	WALTimeline *grown;
+	int          lo = 0;
+	int          hi = *count;
+
+	while (lo < hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+
+		if ((*timelines)[mid].tli < tli)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < *count && (*timelines)[lo].tli == tli)
+		return &(*timelines)[lo];
+
+	/* Archives have a handful of timelines: grow one at a time */
+	grown = realloc(*timelines, (*count + 1) * sizeof(WALTimeline));
+	if (grown == NULL)
+		return NULL;
+	*timelines = grown;
+	memmove(&grown[lo + 1], &grown[lo], (*count - lo) * sizeof(WALTimeline));
+	(*count)++;
+	memset(&grown[lo], 0, sizeof(WALTimeline));
+	grown[lo].tli = tli;
+	return &grown[lo];
+}
+
+/*
+ * Merge the history of timeline 'tli', read from 'fp', into the graph;
+ * see wal_timelines_load_history().  'name' is used in messages.
+ */
+static bool
+read_history_stream(FILE *fp, const char *name, uint32_t tli,
+					WALTimeline **timelines, int *count)
+{
+	char         line[256];
+	uint32_t     prev_tli = 0;
+	XLogRecPtr   prev_lsn = 0;
+	WALTimeline *node;
+	bool         ok = true;
+
+	while (ok && fgets(line, sizeof(line), fp) != NULL)
+	{
+		char         *p = line;
+		char         *end;
+		unsigned long tli_val;
+		char          lsn_buf[32];
+		size_t        lsn_len;
+		XLogRecPtr    lsn;
+
+		/* Skip leading whitespace */
+		while (*p == ' ' || *p == '\t') p++;
+
+		/* Skip comment / blank lines */
+		if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+			continue;
+
+		/* Parse parent timeline number */
+		tli_val = strtoul(p, &end, 10);
+		if (end == p || tli_val == 0)
+			continue;	/* no digits — malformed line */
+
+		/* Skip whitespace between tli and LSN */
+		p = end;
+		while (*p == ' ' || *p == '\t') p++;
+
+		/* Extract the LSN token (non-whitespace, non-newline chars) */
+		end = p;
+		while (*end && *end != ' ' && *end != '\t' &&
+			   *end != '\n' && *end != '\r')
+			end++;
+
+		lsn_len = (size_t)(end - p);
+		if (lsn_len == 0 || lsn_len >= sizeof(lsn_buf))
+			continue;
+
+		memcpy(lsn_buf, p, lsn_len);
+		lsn_buf[lsn_len] = '\0';
+		if (!parse_lsn(lsn_buf, &lsn))
+			continue;
+
+		node = timeline_node(timelines, count, (uint32_t) tli_val);
+		if (node == NULL)
+			ok = false;
+		else if (prev_tli != 0 && node->parent == 0 && !node->has_history)
+		{
+			node->parent = prev_tli;
+			node->switch_lsn = prev_lsn;
+		}
+		prev_tli = (uint32_t) tli_val;
+		prev_lsn = lsn;
+	}
+
+	if (ok && (node = timeline_node(timelines, count, tli)) != NULL)
+	{
+		node->has_history = true;
+		node->parent = prev_tli;
+		node->switch_lsn = prev_lsn;
+	}
+	else
+	{
+		log_warning("Out of memory while reading %s", name);
+		ok = false;
+	}
+	return ok;
+}
+
+/*
+ * Merge archive_path/NNNNNNNN.history of timeline 'tli' into the graph.
+ *
+ * Non-comment lines: <parent_tli><whitespace><switch_lsn><whitespace><reason>
+ * Example: "1\t0/5000000\tno recovery target specified\n"
+ *
+ * The file lists every ancestor of 'tli', oldest first, with the LSN at
+ * which it ended; each line therefore gives the parent and switch point
+ * of the timeline on the next line (of 'tli' for the last one).  The
+ * timeline's own file is authoritative for it; ancestors are only filled
+ * in when their own file has not been read.  Returns false if the file
+ * cannot be read or memory runs out.
+ */
+bool
+wal_timelines_load_history(const char *archive_path, uint32_t tli,
+						   WALTimeline **timelines, int *count)
+{
+	char         history_filename[32];
+	char         history_path[PATH_MAX];
+	FILE        *fp;
+	bool         ok;
+
+	snprintf(history_filename, sizeof(history_filename), "%08X.history", tli);
+	path_join(history_path, sizeof(history_path), archive_path, history_filename);
+
+	fp = fopen(history_path, "r");
+	if (fp == NULL)
+		return false;
+
+	ok = read_history_stream(fp, history_path, tli, timelines, count);
+	metrics_io_stream(fp);
+	fclose(fp);
+	return ok;
+}
+
+/*
+ * Timeline 'tli' of the graph, or NULL.
+ */
+const WALTimeline *
+wal_timelines_find(const WALTimeline *timelines, int count, uint32_t tli)
+{
+	int lo = 0;
+	int hi = count - 1;
+
+	while (lo <= hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+
+		if (timelines[mid].tli == tli)
+			return &timelines[mid];
+		if (timelines[mid].tli < tli)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return NULL;
+}
+
+/*
+ * LSN at which the history of 'new_tli' left its ancestor 'parent_tli',
+ * found by walking parent links up from 'new_tli'.  Returns false if
+ * 'parent_tli' is not an ancestor in the graph.
+ */
+bool
+wal_timelines_switchpoint(const WALTimeline *timelines, int count,
+						  uint32_t new_tli, uint32_t parent_tli,
+						  XLogRecPtr *switch_lsn)
+{
+	const WALTimeline *node = wal_timelines_find(timelines, count, new_tli);
+
+	/* At most 'count' steps, in case the history files form a cycle */
+	for (int depth = 0; node != NULL && node->parent != 0 && depth < count; depth++)
+	{
+		if (node->parent == parent_tli)
+		{
+			*switch_lsn = node->switch_lsn;
+			return true;
+		}
+		node = wal_timelines_find(timelines, count, node->parent);
+	}
+	return false;
+}
+
+/*
+ * Collapse sorted, distinct segments into runs of consecutive segments;
+ * 'seg_size' (0 = 16 MB) says where one xlogid's names end and the
+ * next one's begin.  Returns a malloc'd array (never NULL for count 0)
+ * or NULL on out-of-memory.
+ */
+WALSegmentRange *
+wal_segment_ranges_build(const WALSegmentName *segs, int count, uint32_t seg_size,
+						 int *range_count)
+{
+	WALSegmentRange *ranges;
+	int              n = 0;
+
+	*range_count = 0;
+
+	/* Count first, so the array is allocated exactly once */
+	for (int i = 0; i < count; i++)
+	{
+		uint64_t pos = wal_segment_number(&segs[i], seg_size);
+
+		if (i == 0 || segs[i].timeline != segs[i - 1].timeline ||
+			pos != wal_segment_number(&segs[i - 1], seg_size) + 1)
+			n++;
+	}
+
+	ranges = malloc((n > 0 ? n : 1) * sizeof(WALSegmentRange));
+	if (ranges == NULL)
+		return NULL;
+
+	n = 0;
+	for (int i = 0; i < count; i++)
+	{
+		uint64_t pos = wal_segment_number(&segs[i], seg_size);
+
+		if (n > 0 && ranges[n - 1].timeline == segs[i].timeline &&
+			ranges[n - 1].start + ranges[n - 1].count == pos)
+		{
+			ranges[n - 1].count++;
+			continue;
+		}
+		ranges[n].timeline = segs[i].timeline;
+		ranges[n].start = pos;
+		ranges[n].count = 1;
+		ranges[n].first = i;
+		n++;
+	}
+
+	*range_count = n;
+	return ranges;
+}
+
+/*
+ * Index in info->ranges of the run holding 'seg', or -1.  Needs the
+ * ranges scan_wal_archive() builds.
+ */
+int
+wal_archive_find_range(const WALArchiveInfo *info, const WALSegmentName *seg)
+{
+	uint64_t pos;
+	int      lo, hi;
+
+	if (info == NULL || seg == NULL || info->ranges == NULL)
+		return -1;
+
+	pos = wal_segment_number(seg, info->segment_size);
+	lo = 0;
+	hi = info->range_count - 1;
+
+	while (lo <= hi)
+	{
+		int                    mid = lo + (hi - lo) / 2;
+		const WALSegmentRange *r = &info->ranges[mid];
+
+		if (seg->timeline < r->timeline ||
+			(seg->timeline == r->timeline && pos < r->start))
+			hi = mid - 1;
+		else if (seg->timeline > r->timeline || pos >= r->start + r->count)
+			lo = mid + 1;
+		else
+			return mid;
+	}
+
+	return -1;
+}
+
+/*
+ * Index of a segment in the (sorted) archive, or -1 if it is not there.
+ * With ranges the search is over runs rather than segments.
+ */
+int
+wal_archive_find(const WALArchiveInfo *info, const WALSegmentName *seg)
+{
+	int lo, hi;
+
+	if (info == NULL || seg == NULL || info->segments == NULL)
+		return -1;
+
+	if (info->ranges != NULL)
+	{
+		int r = wal_archive_find_range(info, seg);
+
+		if (r < 0)
+			return -1;
+		return info->ranges[r].first +
+			(int) (wal_segment_number(seg, info->segment_size) - info->ranges[r].start);
+	}
+
+	lo = 0;
+	hi = info->segment_count - 1;
+
+	while (lo <= hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+		int cmp = compare_wal_segments(&info->segments[mid], seg);
+
+		if (cmp == 0)
+			return mid;
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	return -1;
+}
+
+/*
+ * Full path of segment 'index' as stored on disk.
+ */
+void
+wal_archive_segment_path(const WALArchiveInfo *info, int index,
+						 char *buf, size_t bufsize)
+{
+	const WALSegmentName *seg = &info->segments[index];
+	const WALSegmentFile *file = info->files != NULL ? &info->files[index] : NULL;
+	char name[PATH_MAX];
+
+	if (file == NULL)
+		format_wal_filename(seg, name, sizeof(name));
+	else if (file->in_subdir)
+		snprintf(name, sizeof(name), "%08X%08X/%08X%08X%08X%s",
+				 seg->timeline, seg->log_id,
+				 seg->timeline, seg->log_id, seg->seg_id,
+				 file->suffix != NULL ? file->suffix : "");
+	else
+		snprintf(name, sizeof(name), "%08X%08X%08X%s",
+				 seg->timeline, seg->log_id, seg->seg_id,
+				 file->suffix != NULL ? file->suffix : "");
+
+	path_join(buf, bufsize, info->archive_path, name);
+}
+
+/*
+ * Compression of segment 'index', from its file suffix.
+ */
+CompressionType
+wal_archive_segment_compression(const WALArchiveInfo *info, int index)
+{
+	if (info == NULL || info->files == NULL)
+		return COMPRESSION_NONE;
+	return wal_suffix_compression(info->files[index].suffix);
+}
+
+/*
+ * xlp_seg_size of the archive's segments, read from the long page header
+ * of the first segment that can be read (trying a few, so one damaged
+ * file does not matter).  Returns 0 -- meaning the standard 16 MB -- if
+ * none can be read or the stored value is not a power of two in
+ * [1 MB, 1 GB].
+ */
+uint32_t
+wal_archive_read_segment_size(const WALArchiveInfo *info)
+{
+	char		path[PATH_MAX];
+	uint8_t		hdr[40];
+	int			i;
+
+	if (info == NULL || info->in_tar)
+		return 0;
+
+	for (i = 0; i < info->segment_count && i < 8; i++)
+	{
+		DecompressStream *ds;
+		size_t		got = 0;
+		ssize_t		n = 1;
+		uint32_t	size;
+
+		wal_archive_segment_path(info, i, path, sizeof(path));
+		ds = decompress_open(path, wal_archive_segment_compression(info, i));
+		if (ds == NULL)
+			continue;
+		while (got < sizeof(hdr) && n > 0)
+		{
+			n = decompress_read(ds, hdr + got, sizeof(hdr) - got);
+			if (n > 0)
+				got += (size_t) n;
+		}
+		decompress_close(ds);
+		if (got < sizeof(hdr))
+			continue;
+
+		/* xlp_seg_size follows xlp_sysid in XLogLongPageHeaderData */
+		size = (uint32_t) hdr[32] | (uint32_t) hdr[33] << 8 |
+			(uint32_t) hdr[34] << 16 | (uint32_t) hdr[35] << 24;
+		if (size != 0 && (size & (size - 1)) == 0 &&
+			size >= (1U << 20) && size <= (1U << 30))
+			return size;
+	}
+	return 0;
+}
+
 /*
  * Free BackupInfo list
  */
@@ -349,6 +1584,15 @@ free_wal_archive_info(WALArchiveInfo *info)
 	{
 		if (info->segments != NULL)
 			free(info->segments);
+		free(info->stats);
+		free(info->ranges);
+		free(info->timelines);
+		if (info->files != NULL)
+		{
+			for (int i = 0; i < info->segment_count; i++)
+				free(info->files[i].suffix);
+			free(info->files);
+		}
 		free(info);
 	}
 }
@@ -0,0 +1,329 @@
+/*
+ * wal_archive_set.c
+ *
+ * Resolve, scan and bind the WAL archives of a backup list
+ *
+ * Archive paths are resolved per backup with the adapter's
+ * get_wal_archive_path() and compared as strings, so backups of one
+ * instance share one entry however many of them there are.  The scans of
+ * distinct archives are independent and run on a small pool of threads
+ * that take the next unscanned entry under a mutex.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pg_backup_auditor.h"
+#include "wal_archive_set.h"
+#include "adapter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Scan queue shared by the archive scanning threads */
+typedef struct {
+	WALArchiveSet  *set;
+	bool           *needed;
+	bool            explicit_path;
+	int             next;
+	pthread_mutex_t lock;
+} ArchiveScanQueue;
+
+/* Entry for 'path', adding it if it is new; -1 on out-of-memory */
+static int
+find_or_add_archive(WALArchiveSet *set, int *capacity, bool **needed,
+					const char *path)
+{
+	for (int i = 0; i < set->count; i++)
+		if (strcmp(set->archives[i].path, path) == 0)
+			return i;
+
+	if (set->count >= *capacity)
+	{
+		int                 new_capacity = *capacity > 0 ? *capacity * 2 : 4;
+		WALArchiveSetEntry *archives = realloc(set->archives,
+											   new_capacity * sizeof(*archives));
+		bool               *flags;
+
+		if (archives == NULL)
+			return -1;
+		set->archives = archives;
+		flags = realloc(*needed, new_capacity * sizeof(*flags));
+		if (flags == NULL)
+			return -1;
+		*needed = flags;
+		*capacity = new_capacity;
+	}
+
+	memset(&set->archives[set->count], 0, sizeof(WALArchiveSetEntry));
+	str_copy(set->archives[set->count].path, path,
+			 sizeof(set->archives[set->count].path));
+	(*needed)[set->count] = false;
+	return set->count++;
+}
+
+static void *
+archive_scan_worker(void *arg)
+{
+	ArchiveScanQueue *queue = (ArchiveScanQueue *) arg;
+
+	for (;;)
+	{
+		WALArchiveSetEntry *entry;
+		int                 i;
+
+		pthread_mutex_lock(&queue->lock);
+		while (queue->next < queue->set->count && !queue->needed[queue->next])
+			queue->next++;
+		i = queue->next < queue->set->count ? queue->next++ : -1;
+		pthread_mutex_unlock(&queue->lock);
+
+		if (i < 0)
+			break;
+
+		entry = &queue->set->archives[i];
+		if (queue->explicit_path)
+			log_info("Scanning WAL archive: %s", entry->path);
+		else
+			log_info("Auto-detected WAL archive: %s", entry->path);
+
+		entry->info = scan_wal_archive(entry->path);
+		if (entry->info == NULL)
+			log_warning("Failed to scan WAL archive: %s", entry->path);
+		else
+			log_info("Found %d WAL segments in archive", entry->info->segment_count);
+	}
+
+	return NULL;
+}
+
+/* Scan the needed archives on up to scan_get_jobs() threads */
+static void
+scan_archives(WALArchiveSet *set, bool *needed, bool explicit_path)
+{
+	ArchiveScanQueue queue;
+	pthread_t       *threads = NULL;
+	int              nneeded = 0;
+	int              started = 0;
+	int              jobs = scan_get_jobs();
+
+	for (int i = 0; i < set->count; i++)
+		if (needed[i])
+			nneeded++;
+	if (jobs > nneeded)
+		jobs = nneeded;
+
+	queue.set = set;
+	queue.needed = needed;
+	queue.explicit_path = explicit_path;
+	queue.next = 0;
+	pthread_mutex_init(&queue.lock, NULL);
+
+	/* The calling thread scans too; without threads it scans them all */
+	if (jobs > 1)
+		threads = malloc(sizeof(pthread_t) * (jobs - 1));
+	if (threads != NULL)
+	{
+		for (int t = 0; t < jobs - 1; t++)
+			if (pthread_create(&threads[started], NULL, archive_scan_worker, &queue) == 0)
+				started++;
+	}
+
+	archive_scan_worker(&queue);
+
+	for (int t = 0; t < started; t++)
+		pthread_join(threads[t], NULL);
+	free(threads);
+	pthread_mutex_destroy(&queue.lock);
+}
+
+static int
+compare_bindings(const void *a, const void *b)
+{
+	uintptr_t pa = (uintptr_t) ((const WALArchiveBinding *) a)->backup;
+	uintptr_t pb = (uintptr_t) ((const WALArchiveBinding *) b)->backup;
+
+	return (pa > pb) - (pa < pb);
+}
+
+/*
+ * Fill in the members of every archive from set->bindings (still in list
+ * order), then sort the bindings by backup for lookups.
+ */
+static bool
+index_bindings(WALArchiveSet *set)
+{
+	int *fill;
+
+	for (int i = 0; i < set->binding_count; i++)
+		set->archives[set->bindings[i].archive].member_count++;
+
+	for (int a = 0; a < set->count; a++)
+	{
+		int count = set->archives[a].member_count;
+
+		set->archives[a].members = malloc((count > 0 ? count : 1) *
+										  sizeof(BackupInfo *));
+		if (set->archives[a].members == NULL)
+			return false;
+	}
+
+	fill = calloc(set->count > 0 ? set->count : 1, sizeof(int));
+	if (fill == NULL)
+		return false;
+	for (int i = 0; i < set->binding_count; i++)
+	{
+		int a = set->bindings[i].archive;
+
+		set->archives[a].members[fill[a]++] = set->bindings[i].backup;
+	}
+	free(fill);
+
+	qsort(set->bindings, set->binding_count, sizeof(WALArchiveBinding),
+		  compare_bindings);
+	return true;
+}
+
+/*
+ * Resolve and scan the archives of 'backups'
+ */
+WALArchiveSet *
+wal_archive_set_build(BackupInfo *backups, const char *explicit_path)
+{
+	WALArchiveSet *set;
+	bool          *needed = NULL;
+	int            capacity = 0;
+	int            nbackups = 0;
+	bool           ok = false;
+
+	set = calloc(1, sizeof(WALArchiveSet));
+	if (set == NULL)
+		return NULL;
+
+	for (BackupInfo *b = backups; b != NULL; b = b->next)
+		nbackups++;
+	set->bindings = malloc((nbackups > 0 ? nbackups : 1) * sizeof(WALArchiveBinding));
+	if (set->bindings == NULL)
+		goto done;
+
+	if (explicit_path != NULL)
+	{
+		if (find_or_add_archive(set, &capacity, &needed, explicit_path) < 0)
+			goto done;
+		needed[0] = true;
+		for (BackupInfo *b = backups; b != NULL; b = b->next)
+		{
+			set->bindings[set->binding_count].backup = b;
+			set->bindings[set->binding_count++].archive = 0;
+		}
+	}
+	else
+	{
+		for (BackupInfo *b = backups; b != NULL; b = b->next)
+		{
+			BackupAdapter *adapter;
+			char          *wal_path;
+			int            a;
+
+			if (b->start_lsn == 0)
+				continue;
+			adapter = get_adapter_for_tool(b->tool);
+			if (adapter == NULL || adapter->get_wal_archive_path == NULL)
+				continue;
+			wal_path = adapter->get_wal_archive_path(b->backup_path,
+													 b->instance_name);
+			if (wal_path == NULL)
+				continue;
+
+			a = find_or_add_archive(set, &capacity, &needed, wal_path);
+			free(wal_path);
+			if (a < 0)
+				goto done;
+
+			/* Stream backups carry their WAL; they alone need no scan */
+			if (!b->wal_stream)
+				needed[a] = true;
+			set->bindings[set->binding_count].backup = b;
+			set->bindings[set->binding_count++].archive = a;
+		}
+	}
+
+	scan_archives(set, needed, explicit_path != NULL);
+	ok = index_bindings(set);
+
+done:
+	free(needed);
+	if (!ok)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		wal_archive_set_free(set);
+		return NULL;
+	}
+	return set;
+}
+
+void
+wal_archive_set_free(WALArchiveSet *set)
+{
+	if (set == NULL)
+		return;
+
+	for (int i = 0; i < set->count; i++)
+	{
+		if (set->archives[i].info != NULL)
+			free_wal_archive_info(set->archives[i].info);
+		free(set->archives[i].members);
+	}
+	free(set->archives);
+	free(set->bindings);
+	free(set);
+}
+
+int
+wal_archive_set_index(const WALArchiveSet *set, const BackupInfo *backup)
+{
+	WALArchiveBinding  key;
+	WALArchiveBinding *found;
+
+	if (set == NULL || backup == NULL || set->binding_count == 0)
+		return -1;
+
+	key.backup = (BackupInfo *) backup;
+	found = bsearch(&key, set->bindings, set->binding_count,
+					sizeof(WALArchiveBinding), compare_bindings);
+	return found != NULL ? found->archive : -1;
+}
+
+WALArchiveInfo *
+wal_archive_set_lookup(const WALArchiveSet *set, const BackupInfo *backup)
+{
+	int i = wal_archive_set_index(set, backup);
+
+	return i >= 0 ? set->archives[i].info : NULL;
+}
+
+int
+wal_archive_set_scanned(const WALArchiveSet *set)
+{
+	int count = 0;
+
+	if (set == NULL)
+		return 0;
+	for (int i = 0; i < set->count; i++)
+		if (set->archives[i].info != NULL)
+			count++;
+	return count;
+}
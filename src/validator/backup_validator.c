@@ -22,13 +22,21 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "pg_backup_auditor.h"
+#include "validation_result.h"
 #include "adapter.h"
+#include "verify_jobs.h"
+#include "json_scan.h"
+#include "metrics.h"
+#include "backup_chain.h"
+#include "retention.h"
+#include "storage.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <inttypes.h>
 #include <stdint.h>
+#include <pthread.h>
 
 /* Maximum steps when walking a backup chain (cycle / depth guard) */
 #define MAX_CHAIN_DEPTH 10000
@@ -46,77 +54,10 @@ validation_level_from_string(const char *str, ValidationLevel *out)
 	if (strcasecmp(str, "standard")  == 0) { *out = VALIDATION_LEVEL_STANDARD;  return true; }
 	if (strcasecmp(str, "checksums") == 0) { *out = VALIDATION_LEVEL_CHECKSUMS; return true; }
 	if (strcasecmp(str, "full")      == 0) { *out = VALIDATION_LEVEL_FULL;      return true; }
+	if (strcasecmp(str, "pages")     == 0) { *out = VALIDATION_LEVEL_PAGES;     return true; }
 	return false;
 }
 
-/* ------------------------------------------------------------------ *
- * Internal helpers
- * ------------------------------------------------------------------ */
-
-static void
-add_error(ValidationResult *result, const char *message)
-{
-	if (result == NULL || message == NULL)
-		return;
-
-	char **tmp = realloc(result->errors,
-						 sizeof(char *) * (result->error_count + 1));
-	if (tmp == NULL)
-		return;
-	result->errors = tmp;
-
-	result->errors[result->error_count] = strdup(message);
-	result->error_count++;
-}
-
-static void
-add_warning(ValidationResult *result, const char *message)
-{
-	if (result == NULL || message == NULL)
-		return;
-
-	char **tmp = realloc(result->warnings,
-						 sizeof(char *) * (result->warning_count + 1));
-	if (tmp == NULL)
-		return;
-	result->warnings = tmp;
-
-	result->warnings[result->warning_count] = strdup(message);
-	result->warning_count++;
-}
-
-/*
- * merge_result — copy all errors/warnings from src into dst.
- * If prefix is non-NULL, each message is prepended with "<prefix>: ".
- */
-static void
-merge_result(ValidationResult *dst, const ValidationResult *src,
-			 const char *prefix)
-{
-	char msg[PATH_MAX + 256];
-	int  i;
-
-	if (dst == NULL || src == NULL)
-		return;
-
-	for (i = 0; i < src->error_count; i++)
-	{
-		if (prefix != NULL)
-			snprintf(msg, sizeof(msg), "%s: %s", prefix, src->errors[i]);
-		else
-			snprintf(msg, sizeof(msg), "%s", src->errors[i]);
-		add_error(dst, msg);
-	}
-	for (i = 0; i < src->warning_count; i++)
-	{
-		if (prefix != NULL)
-			snprintf(msg, sizeof(msg), "%s: %s", prefix, src->warnings[i]);
-		else
-			snprintf(msg, sizeof(msg), "%s", src->warnings[i]);
-		add_warning(dst, msg);
-	}
-}
-
 /* ------------------------------------------------------------------ *
  * validate_backup_metadata
  *
@@ -140,24 +81,24 @@ validate_backup_metadata(BackupInfo *info)
 
 	/* Required fields */
 	if (info->backup_id[0] == '\0')
-		add_error(result, "Missing backup_id");
+		validation_add_error(result, "Missing backup_id");
 
 	if (info->backup_path[0] == '\0')
-		add_error(result, "Missing backup_path");
+		validation_add_error(result, "Missing backup_path");
 
 	if (info->backup_path[0] != '\0' && !is_directory(info->backup_path))
 	{
 		snprintf(msg, sizeof(msg),
 				 "Backup path does not exist: %s", info->backup_path);
-		add_error(result, msg);
+		validation_add_error(result, msg);
 	}
 
 	/* Timestamps */
 	if (info->start_time == 0)
-		add_warning(result, "Missing start_time");
+		validation_add_warning(result, "Missing start_time");
 
 	if (info->end_time == 0 && info->status == BACKUP_STATUS_OK)
-		add_warning(result, "Missing end_time for completed backup");
+		validation_add_warning(result, "Missing end_time for completed backup");
 
 	if (info->start_time > 0 && info->end_time > 0 &&
 		info->start_time > info->end_time)
@@ -165,7 +106,7 @@ validate_backup_metadata(BackupInfo *info)
 		snprintf(msg, sizeof(msg),
 				 "Invalid timestamps: start_time (%ld) > end_time (%ld)",
 				 (long)info->start_time, (long)info->end_time);
-		add_error(result, msg);
+		validation_add_error(result, msg);
 	}
 
 	/* LSN range */
@@ -175,15 +116,15 @@ validate_backup_metadata(BackupInfo *info)
 		snprintf(msg, sizeof(msg),
 				 "Invalid LSN range: start_lsn (%" PRIu64 ") >= stop_lsn (%" PRIu64 ")",
 				 info->start_lsn, info->stop_lsn);
-		add_error(result, msg);
+		validation_add_error(result, msg);
 	}
 
 	/* Timeline and version */
 	if (info->timeline == 0)
-		add_warning(result, "Missing timeline ID");
+		validation_add_warning(result, "Missing timeline ID");
 
 	if (info->pg_version == 0)
-		add_warning(result, "Missing PostgreSQL version");
+		validation_add_warning(result, "Missing PostgreSQL version");
 
 	if (result->error_count > 0)
 		result->status = BACKUP_STATUS_ERROR;
@@ -210,6 +151,12 @@ validate_backup_metadata(BackupInfo *info)
  *              - STREAM mode:  scans database/pg_wal/ inside the backup
  * FULL:     + WAL timeline history (check_wal_timeline)
  *
+ * From CHECKSUMS on, a backup in object storage is fetched before these
+ * checks and let go after them (storage_fetch()).
+ *
+ * In fail-fast mode the checks still to run are skipped once an error
+ * has been found, in this backup or any other.
+ *
  * Returns a ValidationResult that the caller must free.
  * ------------------------------------------------------------------ */
 ValidationResult*
@@ -219,6 +166,8 @@ validate_single_backup(BackupInfo *backup, WALArchiveInfo *wal_info,
 	ValidationResult *result;
 	WALArchiveInfo   *effective_wal = NULL;
 	WALArchiveInfo   *stream_wal   = NULL;
+	MetricSpan        span;
+	const char       *files = NULL;     /* fetched from object storage */
 
 	if (backup == NULL)
 		return NULL;
@@ -228,6 +177,9 @@ validate_single_backup(BackupInfo *backup, WALArchiveInfo *wal_info,
 		return NULL;
 	result->status = BACKUP_STATUS_OK;
 
+	metrics_count(METRIC_BACKUPS_VALIDATED, 1);
+	metrics_phase_begin(&span, METRIC_PHASE_STRUCTURE);
+
 	/* Level 1: structure */
 	if (level >= VALIDATION_LEVEL_BASIC)
 	{
@@ -239,57 +191,78 @@ validate_single_backup(BackupInfo *backup, WALArchiveInfo *wal_info,
 
 		if (sr != NULL)
 		{
-			merge_result(result, sr, NULL);
+			validation_result_merge(result, sr);
 			free_validation_result(sr);
 		}
 	}
 
 	/* Level 2: metadata */
-	if (level >= VALIDATION_LEVEL_STANDARD)
+	if (level >= VALIDATION_LEVEL_STANDARD && !validation_stop_requested())
 	{
 		ValidationResult *mr = validate_backup_metadata(backup);
 		if (mr != NULL)
 		{
-			merge_result(result, mr, NULL);
+			validation_result_merge(result, mr);
 			free_validation_result(mr);
 		}
 	}
 
+	metrics_phase_end(&span);
+
+	/* Level 3+ read the backup's files */
+	if (level >= VALIDATION_LEVEL_CHECKSUMS && !validation_stop_requested())
+	{
+		files = backup->backup_path;
+		if (!storage_fetch(&files, 1))
+		{
+			validation_add_error(result,
+								 "Cannot fetch the backup's files from object "
+								 "storage: file checks not run");
+			level = VALIDATION_LEVEL_STANDARD;
+		}
+	}
+
 	/* Level 3+: checksums + WAL */
-	if (level >= VALIDATION_LEVEL_CHECKSUMS)
+	if (level >= VALIDATION_LEVEL_CHECKSUMS && !validation_stop_requested())
 	{
 		/* File-level checksums (pg_probackup: backup_content.control) */
-		ValidationResult *cr = check_backup_checksums(backup);
+		ValidationResult *cr;
+
+		metrics_phase_begin(&span, METRIC_PHASE_CHECKSUM);
+		cr = check_backup_checksums(backup);
 		if (cr != NULL)
 		{
-			merge_result(result, cr, NULL);
+			validation_result_merge(result, cr);
 			free_validation_result(cr);
 		}
 
 		/* File-level checksums (pg_basebackup: backup_manifest SHA256/CRC32C) */
-		if (backup->tool == BACKUP_TOOL_PG_BASEBACKUP)
+		if (backup->tool == BACKUP_TOOL_PG_BASEBACKUP && !validation_stop_requested())
 		{
 			ValidationResult *mr = check_manifest_checksums(backup);
 			if (mr != NULL)
 			{
-				merge_result(result, mr, NULL);
+				validation_result_merge(result, mr);
 				free_validation_result(mr);
 			}
 		}
 
 		/* File-level checksums (pgbackrest: backup.manifest [target:file] SHA1) */
-		if (backup->tool == BACKUP_TOOL_PGBACKREST)
+		if (backup->tool == BACKUP_TOOL_PGBACKREST && !validation_stop_requested())
 		{
 			ValidationResult *mr = pgbackrest_check_manifest_checksums(backup);
 			if (mr != NULL)
 			{
-				merge_result(result, mr, NULL);
+				validation_result_merge(result, mr);
 				free_validation_result(mr);
 			}
 		}
 
+		metrics_phase_end(&span);
+
 		/* Determine WAL source */
-		if (backup->start_lsn > 0 && backup->stop_lsn > 0)
+		if (backup->start_lsn > 0 && backup->stop_lsn > 0 &&
+			!validation_stop_requested())
 		{
 			if (!backup->wal_stream)
 			{
@@ -316,40 +289,68 @@ validate_single_backup(BackupInfo *backup, WALArchiveInfo *wal_info,
 				wr = check_wal_availability(backup, effective_wal);
 				if (wr != NULL)
 				{
-					merge_result(result, wr, NULL);
+					validation_result_merge(result, wr);
 					free_validation_result(wr);
 				}
 
-				hr = check_wal_headers(backup, effective_wal);
+				hr = validation_stop_requested() ? NULL
+					: check_wal_headers(backup, effective_wal);
 				if (hr != NULL)
 				{
-					merge_result(result, hr, NULL);
+					validation_result_merge(result, hr);
 					free_validation_result(hr);
 				}
 			}
 			else if (backup->wal_stream)
 			{
-				add_warning(result,
-							"WAL not verified: stream backup with no "
-							"accessible WAL (database/pg_wal/ missing or "
-							"empty, and no --wal-archive provided)");
+				validation_add_warning(result,
+									   "WAL not verified: stream backup with no "
+									   "accessible WAL (database/pg_wal/ missing or "
+									   "empty, and no --wal-archive provided)");
 			}
 		}
 	}
 
 	/* Level 4: timeline history */
-	if (level >= VALIDATION_LEVEL_FULL && effective_wal != NULL)
+	if (level >= VALIDATION_LEVEL_FULL && effective_wal != NULL &&
+		!validation_stop_requested())
 	{
 		ValidationResult *tr = check_wal_timeline(backup, effective_wal);
 		if (tr != NULL)
 		{
-			merge_result(result, tr, NULL);
+			validation_result_merge(result, tr);
 			free_validation_result(tr);
 		}
 	}
 
+	/* Level 5: the pages of every relation file */
+	if (level >= VALIDATION_LEVEL_PAGES && !validation_stop_requested())
+	{
+		ValidationResult *pr;
+
+		metrics_phase_begin(&span, METRIC_PHASE_CHECKSUM);
+		pr = check_backup_pages(backup);
+		if (pr != NULL)
+		{
+			validation_result_merge(result, pr);
+			free_validation_result(pr);
+		}
+		metrics_phase_end(&span);
+	}
+
 	if (stream_wal != NULL)
 		free_wal_archive_info(stream_wal);
+	if (files != NULL)
+		storage_release(&files, 1);
+
+	/*
+	 * A fail-fast stop may have cut this backup's checks short.  Without
+	 * errors of its own it must not read as clean, so say so.
+	 */
+	if (validation_stop_requested() && result->error_count == 0)
+		validation_add_warning(result,
+							   "Validation stopped early (--fail-fast): "
+							   "remaining checks not run");
 
 	if (result->error_count > 0)
 		result->status = BACKUP_STATUS_ERROR;
@@ -359,6 +360,174 @@ validate_single_backup(BackupInfo *backup, WALArchiveInfo *wal_info,
 	return result;
 }
 
+/* ------------------------------------------------------------------ *
+ * ValidationMemo
+ *
+ * validate_single_backup() results kept for the length of a run, keyed
+ * by backup, WAL archive and level.  Every member of a chain walks its
+ * ancestors, so without this the FULL root of an N-member chain would be
+ * validated N times.  With the memo each backup is validated once: the
+ * first caller computes the result while later ones, on any thread,
+ * wait for it.
+ * ------------------------------------------------------------------ */
+typedef struct MemoEntry {
+	BackupInfo       *backup;
+	WALArchiveInfo   *wal_info;
+	ValidationLevel   level;
+	bool              done;
+	ValidationResult *result;       /* may be NULL */
+	struct MemoEntry *next;         /* bucket chain */
+} MemoEntry;
+
+struct ValidationMemo {
+	pthread_mutex_t  lock;
+	pthread_cond_t   done;          /* an entry was completed */
+	MemoEntry      **buckets;
+	uint32_t         nbuckets;      /* power of two */
+	int              count;
+	int              hits;
+};
+
+#define MEMO_INITIAL_BUCKETS 256
+
+static uint32_t
+memo_hash(const BackupInfo *backup, const WALArchiveInfo *wal_info,
+		  ValidationLevel level)
+{
+	uint64_t h = (uint64_t) (uintptr_t) backup * 0x9E3779B97F4A7C15ULL;
+
+	h ^= (uint64_t) (uintptr_t) wal_info * 0xC2B2AE3D27D4EB4FULL;
+	h ^= (uint64_t) level;
+	return (uint32_t) (h >> 32);
+}
+
+ValidationMemo *
+validation_memo_create(void)
+{
+	ValidationMemo *memo = calloc(1, sizeof(ValidationMemo));
+
+	if (memo == NULL)
+		return NULL;
+	memo->nbuckets = MEMO_INITIAL_BUCKETS;
+	memo->buckets = calloc(memo->nbuckets, sizeof(MemoEntry *));
+	if (memo->buckets == NULL)
+	{
+		free(memo);
+		return NULL;
+	}
+	pthread_mutex_init(&memo->lock, NULL);
+	pthread_cond_init(&memo->done, NULL);
+	return memo;
+}
+
+void
+validation_memo_free(ValidationMemo *memo)
+{
+	if (memo == NULL)
+		return;
+
+	log_debug("Validation memo: %d backup%s validated, %d reuse%s",
+			  memo->count, memo->count == 1 ? "" : "s",
+			  memo->hits, memo->hits == 1 ? "" : "s");
+	for (uint32_t b = 0; b < memo->nbuckets; b++)
+	{
+		MemoEntry *e = memo->buckets[b];
+
+		while (e != NULL)
+		{
+			MemoEntry *next = e->next;
+
+			free_validation_result(e->result);
+			free(e);
+			e = next;
+		}
+	}
+	free(memo->buckets);
+	pthread_cond_destroy(&memo->done);
+	pthread_mutex_destroy(&memo->lock);
+	free(memo);
+}
+
+/* Double the table once it averages more than one entry per bucket */
+static void
+memo_grow(ValidationMemo *memo)
+{
+	uint32_t    nb = memo->nbuckets * 2;
+	MemoEntry **buckets = calloc(nb, sizeof(MemoEntry *));
+
+	if (buckets == NULL)
+		return;     /* longer chains, still correct */
+	for (uint32_t b = 0; b < memo->nbuckets; b++)
+	{
+		MemoEntry *e = memo->buckets[b];
+
+		while (e != NULL)
+		{
+			MemoEntry *next = e->next;
+			uint32_t   slot = memo_hash(e->backup, e->wal_info, e->level) & (nb - 1);
+
+			e->next = buckets[slot];
+			buckets[slot] = e;
+			e = next;
+		}
+	}
+	free(memo->buckets);
+	memo->buckets = buckets;
+	memo->nbuckets = nb;
+}
+
+/*
+ * validate_single_backup() through the memo.  The result belongs to the
+ * memo; it is immutable once returned.
+ */
+static const ValidationResult *
+memo_validate_single(ValidationMemo *memo, BackupInfo *backup,
+					 WALArchiveInfo *wal_info, ValidationLevel level)
+{
+	uint32_t   hash = memo_hash(backup, wal_info, level);
+	MemoEntry *e;
+
+	pthread_mutex_lock(&memo->lock);
+	for (e = memo->buckets[hash & (memo->nbuckets - 1)]; e != NULL; e = e->next)
+		if (e->backup == backup && e->wal_info == wal_info && e->level == level)
+			break;
+
+	if (e != NULL)
+	{
+		memo->hits++;
+		while (!e->done)
+			pthread_cond_wait(&memo->done, &memo->lock);
+		pthread_mutex_unlock(&memo->lock);
+		return e->result;
+	}
+
+	e = calloc(1, sizeof(MemoEntry));
+	if (e == NULL)
+	{
+		pthread_mutex_unlock(&memo->lock);
+		return NULL;
+	}
+	e->backup   = backup;
+	e->wal_info = wal_info;
+	e->level    = level;
+	if (memo->count >= (int) memo->nbuckets)
+		memo_grow(memo);
+	e->next = memo->buckets[hash & (memo->nbuckets - 1)];
+	memo->buckets[hash & (memo->nbuckets - 1)] = e;
+	memo->count++;
+	pthread_mutex_unlock(&memo->lock);
+
+	/* Entries are never moved or freed before the memo, so this is safe */
+	e->result = validate_single_backup(backup, wal_info, level);
+
+	pthread_mutex_lock(&memo->lock);
+	e->done = true;
+	pthread_cond_broadcast(&memo->done);
+	pthread_mutex_unlock(&memo->lock);
+
+	return e->result;
+}
+
 /* ------------------------------------------------------------------ *
  * validate_backup_chain
  *
@@ -387,6 +556,19 @@ validate_single_backup(BackupInfo *backup, WALArchiveInfo *wal_info,
 ValidationResult*
 validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 					  WALArchiveInfo *wal_info, ValidationLevel level)
+{
+	return validate_backup_chain_memo(backup, all_backups, wal_info, level,
+									  NULL);
+}
+
+/*
+ * validate_backup_chain() with every single-backup validation, of the
+ * backup and its ancestors, taken from 'memo' (NULL validates afresh).
+ */
+ValidationResult*
+validate_backup_chain_memo(BackupInfo *backup, BackupInfo *all_backups,
+						   WALArchiveInfo *wal_info, ValidationLevel level,
+						   ValidationMemo *memo)
 {
 	ValidationResult *result;
 	char              msg[256];
@@ -395,7 +577,21 @@ validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 		return NULL;
 
 	/* Step 1: validate the target backup itself */
-	result = validate_single_backup(backup, wal_info, level);
+	if (memo != NULL)
+	{
+		const ValidationResult *own = memo_validate_single(memo, backup,
+														   wal_info, level);
+
+		if (own == NULL)
+			return NULL;
+		result = calloc(1, sizeof(ValidationResult));
+		if (result == NULL)
+			return NULL;
+		result->status = own->status;
+		validation_result_append(result, own);
+	}
+	else
+		result = validate_single_backup(backup, wal_info, level);
 	if (result == NULL)
 		return NULL;
 
@@ -412,7 +608,7 @@ validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 			snprintf(msg, sizeof(msg),
 					 "FULL backup has unexpected parent_backup_id: %s",
 					 backup->parent_backup_id);
-			add_error(result, msg);
+			validation_add_error(result, msg);
 		}
 		goto done;
 	}
@@ -426,7 +622,7 @@ validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 	/* Step 3: walk up the chain for incremental backups */
 	if (backup->parent_backup_id[0] == '\0')
 	{
-		add_error(result, "Incremental backup has no parent_backup_id");
+		validation_add_error(result, "Incremental backup has no parent_backup_id");
 		goto done;
 	}
 
@@ -444,7 +640,7 @@ validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 				snprintf(msg, sizeof(msg),
 						 "Broken chain at %s: missing parent_backup_id",
 						 current->backup_id);
-				add_error(result, msg);
+				validation_add_error(result, msg);
 				break;
 			}
 
@@ -462,7 +658,7 @@ validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 			{
 				snprintf(msg, sizeof(msg),
 						 "Parent backup %s not found in catalog", pid);
-				add_error(result, msg);
+				validation_add_error(result, msg);
 				break;
 			}
 
@@ -476,14 +672,20 @@ validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 						 "restorable",
 						 parent->backup_id,
 						 backup_status_to_string(parent->status));
-				add_error(result, msg);
+				validation_add_error(result, msg);
 				break;
 			}
 
 			/* Validate the parent backup */
 			{
-				ValidationResult *pr = validate_single_backup(parent, wal_info,
-															  level);
+				ValidationResult       *owned = NULL;
+				const ValidationResult *pr;
+				bool                    failed = false;
+
+				if (memo != NULL)
+					pr = memo_validate_single(memo, parent, wal_info, level);
+				else
+					pr = owned = validate_single_backup(parent, wal_info, level);
 				if (pr != NULL)
 				{
 					if (pr->error_count > 0)
@@ -492,19 +694,20 @@ validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 								 "Ancestor %s has validation errors — "
 								 "chain recovery may fail",
 								 parent->backup_id);
-						add_warning(result, msg);
-						free_validation_result(pr);
-						break;  /* no point walking further */
+						validation_add_warning(result, msg);
+						failed = true;
 					}
 					else if (pr->warning_count > 0)
 					{
 						snprintf(msg, sizeof(msg),
 								 "Ancestor %s has validation warnings",
 								 parent->backup_id);
-						add_warning(result, msg);
+						validation_add_warning(result, msg);
 					}
-					free_validation_result(pr);
 				}
+				free_validation_result(owned);
+				if (failed)
+					break;  /* no point walking further */
 			}
 
 			/* LSN sanity: child must not start before its parent */
@@ -515,7 +718,7 @@ validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 						 "LSN regression: backup %s start_lsn is before "
 						 "parent %s start_lsn",
 						 current->backup_id, parent->backup_id);
-				add_warning(result, msg);
+				validation_add_warning(result, msg);
 			}
 
 			current = parent;
@@ -523,9 +726,9 @@ validate_backup_chain(BackupInfo *backup, BackupInfo *all_backups,
 
 			if (depth >= MAX_CHAIN_DEPTH)
 			{
-				add_error(result,
-						  "Circular reference or excessively deep "
-						  "backup chain");
+				validation_add_error(result,
+									 "Circular reference or excessively deep "
+									 "backup chain");
 				break;
 			}
 		}
@@ -543,93 +746,116 @@ done:
 }
 
 /* ------------------------------------------------------------------ *
- * check_retention_policy — stub
+ * check_retention_policy
+ *
+ * Warns when the catalog cannot restore to every point of the last
+ * retention_days (no OK chain of an instance finished before the window
+ * began), and for each of the last retention_weekly weeks without a
+ * completed OK backup.  Either limit may be 0 to skip its check.
  * ------------------------------------------------------------------ */
 ValidationResult*
 check_retention_policy(BackupInfo *backups, int retention_days,
 					   int retention_weekly)
 {
-	(void) backups;
-	(void) retention_days;
-	(void) retention_weekly;
-	return NULL;
-}
+	ValidationResult *result;
+	time_t            now = time(NULL);
+	char              msg[256];
 
-/* ------------------------------------------------------------------ *
- * free_validation_result
- * ------------------------------------------------------------------ */
-void
-free_validation_result(ValidationResult *result)
-{
-	int i;
+	if (backups == NULL)
+		return NULL;
 
+	result = calloc(1, sizeof(ValidationResult));
 	if (result == NULL)
-		return;
+		return NULL;
 
-	if (result->errors != NULL)
+	if (retention_days > 0)
 	{
-		for (i = 0; i < result->error_count; i++)
-			free(result->errors[i]);
-		free(result->errors);
+		int              nchains = 0;
+		BackupChain     *chains  = backup_chain_build(backups, &nchains);
+		RetentionPlan   *plan    = NULL;
+		RetentionPolicy  policy  = { "", 0, (time_t) retention_days * 86400 };
+
+		if (chains != NULL)
+			plan = retention_plan_build(chains, nchains, NULL, now);
+		if (plan == NULL)
+			validation_add_error(result, "Failed to plan retention");
+		else if (plan->ninstances == 0)
+			validation_add_warning(result, "No backup chains to retain");
+		else
+		{
+			RetentionInstanceResult *inst = calloc(plan->ninstances, sizeof(*inst));
+
+			if (inst == NULL)
+				validation_add_error(result, "Out of memory while planning retention");
+			else
+			{
+				retention_plan_evaluate(plan, &policy, inst, NULL);
+				for (int i = 0; i < plan->ninstances; i++)
+				{
+					if (inst[i].met)
+						continue;
+					snprintf(msg, sizeof(msg),
+							 "No OK backup chain%s%s restores to %d day%s ago",
+							 plan->instances[i].instance[0] != '\0' ? " of " : "",
+							 plan->instances[i].instance,
+							 retention_days, retention_days == 1 ? "" : "s");
+					validation_add_warning(result, msg);
+				}
+				free(inst);
+			}
+		}
+		retention_plan_free(plan);
+		backup_chain_free(chains, nchains);
 	}
 
-	if (result->warnings != NULL)
+	if (retention_weekly > 0)
 	{
-		for (i = 0; i < result->warning_count; i++)
-			free(result->warnings[i]);
-		free(result->warnings);
-	}
+		bool *seen = calloc(retention_weekly, sizeof(bool));
 
-	free(result);
-}
+		if (seen == NULL)
+			validation_add_error(result, "Out of memory while checking weekly backups");
+		else
+		{
+			/* Week 0 is the last seven days, week 1 the seven before, ... */
+			for (BackupInfo *b = backups; b != NULL; b = b->next)
+			{
+				time_t end = b->end_time > 0 ? b->end_time : b->start_time;
 
-/* ------------------------------------------------------------------ *
- * json_get_string — used by check_backup_checksums
- *
- * Extracts a value from a JSON line: {"key":"value", ...} or
- * {"key":123, ...}.
- * ------------------------------------------------------------------ */
-static bool
-json_get_string(const char *json, const char *key, char *out, size_t outsize)
-{
-	char        search[128];
-	const char *p, *end;
-	size_t      len;
-
-	/* Quoted value */
-	snprintf(search, sizeof(search), "\"%s\":\"", key);
-	p = strstr(json, search);
-	if (p != NULL)
-	{
-		p  += strlen(search);
-		end = strchr(p, '"');
-		if (end == NULL) return false;
-		len = (size_t)(end - p);
-		if (len >= outsize) len = outsize - 1;
-		memcpy(out, p, len);
-		out[len] = '\0';
-		return true;
+				if (b->status != BACKUP_STATUS_OK || end <= 0 || end > now)
+					continue;
+				if ((now - end) / (7 * 86400) < retention_weekly)
+					seen[(now - end) / (7 * 86400)] = true;
+			}
+			for (int w = 0; w < retention_weekly; w++)
+			{
+				if (seen[w])
+					continue;
+				snprintf(msg, sizeof(msg),
+						 "No OK backup between %d and %d days ago",
+						 (w + 1) * 7, w * 7);
+				validation_add_warning(result, msg);
+			}
+			free(seen);
+		}
 	}
 
-	/* Bare numeric value */
-	snprintf(search, sizeof(search), "\"%s\":", key);
-	p = strstr(json, search);
-	if (p != NULL)
-	{
-		p  += strlen(search);
-		end = p;
-		while (*end && *end != ',' && *end != '}')
-			end++;
-		len = (size_t)(end - p);
-		if (len >= outsize) len = outsize - 1;
-		memcpy(out, p, len);
-		out[len] = '\0';
-		return true;
-	}
+	if (result->error_count > 0)
+		result->status = BACKUP_STATUS_ERROR;
+	else if (result->warning_count > 0)
+		result->status = BACKUP_STATUS_WARNING;
+	else
+		result->status = BACKUP_STATUS_OK;
 
-	return false;
+	return result;
 }
 
+/* Fields of a backup_content.control line, read in one pass */
+enum { CONTENT_KIND, CONTENT_PATH, CONTENT_SIZE, CONTENT_CRC, CONTENT_NFIELDS };
+
+static const char *const content_fields[CONTENT_NFIELDS] = {
+	"kind", "path", "size", "crc"
+};
+
 /* ------------------------------------------------------------------ *
  * check_backup_checksums
  *
@@ -637,7 +863,10 @@ json_get_string(const char *json, const char *key, char *out, size_t outsize)
  * for each regular file entry:
  *   1. File exists in the backup's database/ directory
  *   2. Size matches the stored "size" field
- *   3. CRC32C matches the stored "crc" field (uncompressed files only)
+ *   3. CRC32C matches the stored "crc" field
+ *
+ * Files are verified in parallel by the shared verify_jobs engine; the
+ * reported errors keep the order of backup_content.control.
  *
  * Returns NULL if backup_content.control is absent (tool unsupported).
  * ------------------------------------------------------------------ */
@@ -650,9 +879,8 @@ check_backup_checksums(BackupInfo *backup)
 	FILE            *fp;
 	char             line[8192];
 	ValidationResult *result;
-	char             msg[PATH_MAX + 128];
-	int              checked            = 0;
-	int              skipped_compressed = 0;
+	VerifyJobList    jobs;
+	VerifyStats      stats;
 
 	if (backup == NULL || backup->backup_path[0] == '\0')
 		return NULL;
@@ -677,103 +905,68 @@ check_backup_checksums(BackupInfo *backup)
 	}
 	result->status = BACKUP_STATUS_OK;
 
+	verify_job_list_init(&jobs, "pg_probackup checksums");
+	jobs.scope = backup->backup_id;
+
 	while (fgets(line, sizeof(line), fp) != NULL)
 	{
-		char kind[16]           = {0};
-		char rel_path[PATH_MAX] = {0};
-		char size_str[32]       = {0};
-		char crc_str[32]        = {0};
-		char compress[32]       = {0};
-
-		if (!json_get_string(line, "kind", kind, sizeof(kind)))
-			continue;
-		if (strcmp(kind, "reg") != 0)
-			continue;
+		JsonSlice  v[CONTENT_NFIELDS];
+		char       rel_path[PATH_MAX];
+		char       crc_str[32];
+		uint64_t   size;
+		VerifyJob *job;
 
-		if (!json_get_string(line, "path", rel_path, sizeof(rel_path)))
+		if (!json_get_fields(line, content_fields, CONTENT_NFIELDS, v))
 			continue;
-		if (!json_get_string(line, "size", size_str, sizeof(size_str)))
+		if (!json_slice_eq(v[CONTENT_KIND], "reg"))
 			continue;
-		if (!json_get_string(line, "crc", crc_str, sizeof(crc_str)))
+		if (!json_slice_copy(v[CONTENT_PATH], rel_path, sizeof(rel_path)) ||
+			!json_slice_to_uint64(v[CONTENT_SIZE], &size) ||
+			!json_slice_copy(v[CONTENT_CRC], crc_str, sizeof(crc_str)))
 			continue;
-		json_get_string(line, "compress_alg", compress, sizeof(compress));
-
-		path_join(file_path, sizeof(file_path), db_dir, rel_path);
 
 		/* Zero-size files are not stored physically by pg_probackup */
-		if (strcmp(size_str, "0") == 0)
+		if (size == 0)
 			continue;
 
-		/* Incremental backups: skip files that belong to a parent */
-		if (backup->type != BACKUP_TYPE_FULL && !file_exists(file_path))
-			continue;
+		path_join(file_path, sizeof(file_path), db_dir, rel_path);
 
-		if (!file_exists(file_path))
+		job = verify_job_list_add(&jobs, file_path, rel_path);
+		if (job == NULL)
 		{
-			snprintf(msg, sizeof(msg), "Missing file: %s", rel_path);
-			add_error(result, msg);
-			continue;
+			validation_add_error(result, "Out of memory while reading backup_content.control");
+			break;
 		}
+		job->expected_size = (int64_t) size;
 
-		/* Size check */
-		{
-			off_t stored_size = (off_t) strtoull(size_str, NULL, 10);
-			off_t actual_size = get_file_size(file_path);
-			if (actual_size != stored_size)
-			{
-				snprintf(msg, sizeof(msg),
-						 "Size mismatch for %s: stored=%lld, actual=%lld",
-						 rel_path,
-						 (long long)stored_size, (long long)actual_size);
-				add_error(result, msg);
-				continue;
-			}
-		}
+		/* Incremental backups: skip files that belong to a parent */
+		if (backup->type != BACKUP_TYPE_FULL)
+			job->flags |= VERIFY_SKIP_IF_MISSING;
 
-		/* CRC32C check (uncompressed files only).
-		 * global/pg_control is modified by pg_probackup after writing
+		/* global/pg_control is modified by pg_probackup after writing
 		 * backup_content.control, so its stored CRC never matches. */
 		if (strcmp(rel_path, "global/pg_control") == 0)
-		{
-			checked++;
 			continue;
-		}
-
-		if (strcmp(compress, "none") == 0 || compress[0] == '\0')
-		{
-			uint32_t stored_crc = (uint32_t) strtoul(crc_str, NULL, 10);
-			uint32_t actual_crc = 0;
-
-			if (!compute_file_crc32c(file_path, &actual_crc))
-			{
-				snprintf(msg, sizeof(msg),
-						 "Cannot read file for CRC check: %s", rel_path);
-				add_error(result, msg);
-				continue;
-			}
-
-			if (actual_crc != stored_crc)
-			{
-				snprintf(msg, sizeof(msg),
-						 "CRC32C mismatch for %s: "
-						 "stored=0x%08X, actual=0x%08X",
-						 rel_path, stored_crc, actual_crc);
-				add_error(result, msg);
-			}
-		}
-		else
-		{
-			skipped_compressed++;
-		}
 
-		checked++;
+		/*
+		 * "size" and "crc" describe the bytes as stored, so compressed
+		 * data files (zlib/lz4 per page, inside pg_probackup's own page
+		 * framing) are checked as is, the same way "pg_probackup
+		 * validate" does — no decompression needed.
+		 */
+		job->algorithm    = VERIFY_ALG_CRC32C;
+		job->expected_crc = (uint32_t) strtoul(crc_str, NULL, 10);
 	}
 
+	metrics_io_stream(fp);
 	fclose(fp);
 
-	log_debug("Checksum check: %d files verified, %d compressed skipped, "
-			  "%d errors",
-			  checked, skipped_compressed, result->error_count);
+	verify_jobs_run(&jobs, validation_get_jobs());
+	verify_jobs_merge(&jobs, result, &stats);
+	verify_job_list_free(&jobs);
+
+	log_debug("Checksum check: %d files verified, %d errors",
+			  stats.verified, result->error_count);
 
 	return result;
 }
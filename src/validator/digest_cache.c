@@ -0,0 +1,401 @@
+/*
+ * digest_cache.c
+ *
+ * Cache of file digests by content identity
+ *
+ * In memory the entries live in one open-addressing hash table for the
+ * whole process, under a mutex: backups validated side by side share
+ * it.  With a cache directory it is loaded from, and saved to, one text
+ * file there:
+ *
+ *   pg_backup_auditor digest-cache 1
+ *   <dev> <ino> <size> <mtime_sec> <mtime_nsec> <algorithm> <compression>
+ *       <content_size> <computed_at> <digest hex>
+ *   ...
+ *
+ * (one line per entry).  The file is rewritten, to a temporary file that
+ * is then renamed, only when an entry was added or expired.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pg_backup_auditor.h"
+#include "digest_cache.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define DIGEST_CACHE_MAGIC    "pg_backup_auditor digest-cache"
+#define DIGEST_CACHE_VERSION  1
+#define DIGEST_CACHE_FILE     "digests.cache"
+
+typedef struct {
+	DigestKey	key;
+	bool		used;			/* false = empty slot */
+	uint8_t		len;
+	uint8_t		digest[DIGEST_CACHE_MAX_DIGEST];
+	int64_t		content_size;
+	int64_t		computed_at;	/* time_t */
+} DigestEntry;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static DigestEntry *slots = NULL;
+static size_t		capacity = 0;	/* power of two */
+static size_t		count = 0;
+static bool			loaded = false;	/* the cache directory's file was read */
+static bool			dirty = false;
+
+void
+digest_key_set(DigestKey *key, const struct stat *st,
+			   int algorithm, int compression)
+{
+	memset(key, 0, sizeof(*key));
+	key->dev         = (uint64_t) st->st_dev;
+	key->ino         = (uint64_t) st->st_ino;
+	key->size        = (int64_t) st->st_size;
+	key->mtime_sec   = (int64_t) st->st_mtim.tv_sec;
+	key->mtime_nsec  = st->st_mtim.tv_nsec;
+	key->algorithm   = algorithm;
+	key->compression = compression;
+}
+
+static bool
+same_key(const DigestKey *a, const DigestKey *b)
+{
+	return a->ino == b->ino && a->dev == b->dev &&
+		   a->size == b->size &&
+		   a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec &&
+		   a->algorithm == b->algorithm && a->compression == b->compression;
+}
+
+/* FNV-1a over the key's fields */
+static uint64_t
+hash_key(const DigestKey *key)
+{
+	uint64_t fields[7];
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	fields[0] = key->dev;
+	fields[1] = key->ino;
+	fields[2] = (uint64_t) key->size;
+	fields[3] = (uint64_t) key->mtime_sec;
+	fields[4] = (uint64_t) key->mtime_nsec;
+	fields[5] = (uint64_t) key->algorithm;
+	fields[6] = (uint64_t) key->compression;
+
+	for (size_t i = 0; i < sizeof(fields); i++)
+	{
+		h ^= ((const uint8_t *) fields)[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static DigestEntry *
+find_slot(DigestEntry *table, size_t table_capacity, const DigestKey *key)
+{
+	size_t i = (size_t) hash_key(key) & (table_capacity - 1);
+
+	while (table[i].used && !same_key(&table[i].key, key))
+		i = (i + 1) & (table_capacity - 1);
+	return &table[i];
+}
+
+static bool
+grow(void)
+{
+	size_t		 new_capacity = capacity ? capacity * 2 : 1024;
+	DigestEntry *table = calloc(new_capacity, sizeof(DigestEntry));
+
+	if (table == NULL)
+		return false;
+
+	for (size_t i = 0; i < capacity; i++)
+		if (slots[i].used)
+			*find_slot(table, new_capacity, &slots[i].key) = slots[i];
+
+	free(slots);
+	slots = table;
+	capacity = new_capacity;
+	return true;
+}
+
+/* Find or add the entry for 'key'; NULL if out of memory */
+static DigestEntry *
+put_entry(const DigestKey *key)
+{
+	DigestEntry *e;
+
+	/* Keep the load factor at or below 1/2 */
+	if ((count + 1) * 2 > capacity && !grow())
+		return NULL;
+
+	e = find_slot(slots, capacity, key);
+	if (!e->used)
+	{
+		e->used = true;
+		e->key = *key;
+		count++;
+	}
+	return e;
+}
+
+static bool
+expired(const DigestEntry *e, time_t now)
+{
+	return e->computed_at > (int64_t) now ||
+		   (int64_t) now - e->computed_at > (int64_t) DIGEST_CACHE_MAX_AGE * 86400;
+}
+
+static int
+hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+/* Parse 'hex' (lowercase, an even number of digits) into 'digest' */
+static bool
+parse_hex(const char *hex, uint8_t *digest, uint8_t *len)
+{
+	size_t n = strlen(hex);
+
+	if (n == 0 || n % 2 != 0 || n / 2 > DIGEST_CACHE_MAX_DIGEST)
+		return false;
+	for (size_t i = 0; i < n / 2; i++)
+	{
+		int hi = hex_value(hex[2 * i]);
+		int lo = hex_value(hex[2 * i + 1]);
+
+		if (hi < 0 || lo < 0)
+			return false;
+		digest[i] = (uint8_t) (hi << 4 | lo);
+	}
+	*len = (uint8_t) (n / 2);
+	return true;
+}
+
+static void
+cache_file(char *path, size_t size)
+{
+	path_join(path, size, validation_get_cache_dir(), DIGEST_CACHE_FILE);
+}
+
+/* Read the cache directory's entries, once; called under the lock */
+static void
+load_cache(void)
+{
+	char		file[PATH_MAX];
+	char		line[512];
+	FILE	   *fp;
+	unsigned	version;
+	size_t		before = count;
+	time_t		now = time(NULL);
+	int			magic_len = (int) strlen(DIGEST_CACHE_MAGIC);
+
+	if (loaded || validation_get_cache_dir() == NULL)
+		return;
+	loaded = true;
+
+	cache_file(file, sizeof(file));
+	fp = fopen(file, "r");
+	if (fp == NULL)
+		return;		/* no cache yet */
+
+	if (fgets(line, sizeof(line), fp) == NULL ||
+		strncmp(line, DIGEST_CACHE_MAGIC, magic_len) != 0 ||
+		sscanf(line + magic_len, "%u", &version) != 1 ||
+		version != DIGEST_CACHE_VERSION)
+	{
+		log_debug("Digest cache %s: unknown format, starting over", file);
+		fclose(fp);
+		dirty = true;
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		DigestEntry	 tmp;
+		DigestEntry *e;
+		char		 hex[2 * DIGEST_CACHE_MAX_DIGEST + 2];
+
+		memset(&tmp, 0, sizeof(tmp));
+		if (sscanf(line, "%" SCNu64 " %" SCNu64 " %" SCNd64 " %" SCNd64 " %ld %d %d %"
+				   SCNd64 " %" SCNd64 " %65s",
+				   &tmp.key.dev, &tmp.key.ino, &tmp.key.size,
+				   &tmp.key.mtime_sec, &tmp.key.mtime_nsec,
+				   &tmp.key.algorithm, &tmp.key.compression,
+				   &tmp.content_size, &tmp.computed_at, hex) != 10 ||
+			!parse_hex(hex, tmp.digest, &tmp.len))
+			continue;
+		if (expired(&tmp, now))
+		{
+			dirty = true;
+			continue;
+		}
+
+		/* A digest computed in this run is kept over the saved one */
+		if (slots != NULL && find_slot(slots, capacity, &tmp.key)->used)
+			continue;
+		e = put_entry(&tmp.key);
+		if (e == NULL)
+			break;
+		e->len          = tmp.len;
+		memcpy(e->digest, tmp.digest, tmp.len);
+		e->content_size = tmp.content_size;
+		e->computed_at  = tmp.computed_at;
+	}
+	metrics_io_stream(fp);
+	fclose(fp);
+
+	log_debug("Digest cache %s: %zu file%s", file,
+			  count - before, count - before == 1 ? "" : "s");
+}
+
+bool
+digest_cache_lookup(const DigestKey *key, uint8_t *digest, size_t len,
+					int64_t *content_size)
+{
+	const DigestEntry *e;
+	bool			   found = false;
+
+	pthread_mutex_lock(&cache_lock);
+	load_cache();
+	if (slots != NULL)
+	{
+		e = find_slot(slots, capacity, key);
+		if (e->used && e->len == len && !expired(e, time(NULL)))
+		{
+			memcpy(digest, e->digest, len);
+			*content_size = e->content_size;
+			found = true;
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+	return found;
+}
+
+void
+digest_cache_store(const DigestKey *key, const uint8_t *digest, size_t len,
+				   int64_t content_size)
+{
+	DigestEntry *e;
+
+	if (len == 0 || len > DIGEST_CACHE_MAX_DIGEST)
+		return;
+
+	pthread_mutex_lock(&cache_lock);
+	load_cache();
+	e = put_entry(key);
+	if (e != NULL)
+	{
+		e->len          = (uint8_t) len;
+		memcpy(e->digest, digest, len);
+		e->content_size = content_size;
+		e->computed_at  = (int64_t) time(NULL);
+		dirty = true;
+	}
+	pthread_mutex_unlock(&cache_lock);
+}
+
+void
+digest_cache_save(void)
+{
+	char	file[PATH_MAX];
+	char	tmp_file[PATH_MAX + 32];
+	char	hex[2 * DIGEST_CACHE_MAX_DIGEST + 1];
+	FILE   *fp;
+	bool	ok;
+	size_t	written = 0;
+	time_t	now = time(NULL);
+
+	pthread_mutex_lock(&cache_lock);
+	if (!dirty || validation_get_cache_dir() == NULL)
+	{
+		pthread_mutex_unlock(&cache_lock);
+		return;
+	}
+
+	cache_file(file, sizeof(file));
+	snprintf(tmp_file, sizeof(tmp_file), "%s.tmp.%ld", file, (long) getpid());
+	fp = fopen(tmp_file, "w");
+	if (fp == NULL)
+	{
+		log_warning("Cannot write digest cache %s: %s",
+					tmp_file, strerror(errno));
+		pthread_mutex_unlock(&cache_lock);
+		return;
+	}
+
+	fprintf(fp, "%s %d\n", DIGEST_CACHE_MAGIC, DIGEST_CACHE_VERSION);
+	for (size_t i = 0; i < capacity; i++)
+	{
+		const DigestEntry *e = &slots[i];
+
+		if (!e->used || expired(e, now))
+			continue;
+		for (int b = 0; b < e->len; b++)
+			snprintf(hex + 2 * b, 3, "%02x", e->digest[b]);
+		fprintf(fp, "%" PRIu64 " %" PRIu64 " %" PRId64 " %" PRId64 " %ld %d %d %"
+				PRId64 " %" PRId64 " %s\n",
+				e->key.dev, e->key.ino, e->key.size,
+				e->key.mtime_sec, e->key.mtime_nsec,
+				e->key.algorithm, e->key.compression,
+				e->content_size, e->computed_at, hex);
+		written++;
+	}
+
+	ok = !ferror(fp);
+	if (fclose(fp) != 0)
+		ok = false;
+	if (!ok || rename(tmp_file, file) != 0)
+	{
+		log_warning("Cannot write digest cache %s: %s",
+					file, strerror(errno));
+		unlink(tmp_file);
+	}
+	else
+	{
+		dirty = false;
+		log_debug("Digest cache %s: %zu file%s saved", file,
+				  written, written == 1 ? "" : "s");
+	}
+	pthread_mutex_unlock(&cache_lock);
+}
+
+void
+digest_cache_reset(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	free(slots);
+	slots = NULL;
+	capacity = 0;
+	count = 0;
+	loaded = false;
+	dirty = false;
+	pthread_mutex_unlock(&cache_lock);
+}
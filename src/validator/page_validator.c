@@ -0,0 +1,269 @@
+/*
+ * page_validator.c
+ *
+ * --level=pages: every page of the relation files of a plain-format
+ * backup is checked as PostgreSQL would on reading it — its header and,
+ * where the cluster has data_checksums on, its pd_checksum.  Backup
+ * manifests only prove that a file was not changed after it was copied;
+ * this also catches pages that were already corrupt in the cluster.
+ *
+ * Data directories:
+ *   pg_basebackup  <backup>/            (plain format only)
+ *   pg_probackup   <backup>/database/   (pages framed by pg_probackup)
+ *   pgBackRest     <backup>/pg_data/    (files may be compressed)
+ *
+ * Relation files under base/, global/ and pg_tblspc/ become
+ * VERIFY_ALG_PAGES jobs of the verify_jobs engine, so they are read by
+ * the same threads, with the same --max-read-rate throttling, sampling
+ * and sharding as file checksums.  Pages written while the backup ran
+ * (pd_lsn at or after its start LSN) may be torn and are restored from
+ * WAL on recovery, so they are not checked.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pg_backup_auditor.h"
+#include "page_checksum.h"
+#include "verify_jobs.h"
+#include "validation_result.h"
+#include "decompress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* pg_tblspc/<oid>/PG_<version>/<db>/ is the deepest relation directory */
+#define PAGE_DIR_DEPTH  4
+
+typedef struct {
+	VerifyJobList          *jobs;
+	const PageCheckOptions *options;
+	bool                    suffixed;   /* pgBackRest: names carry the compression */
+	bool                    out_of_memory;
+} PageScan;
+
+/* Compressions whose suffix a pgBackRest file name may carry */
+static const CompressionType suffix_types[] = {
+	COMPRESSION_GZIP, COMPRESSION_BZIP2, COMPRESSION_XZ,
+	COMPRESSION_LZ4, COMPRESSION_ZSTD
+};
+
+#define SUFFIX_TYPES ((int) (sizeof(suffix_types) / sizeof(suffix_types[0])))
+
+/* Compression of a pgBackRest file from its suffix, which is removed */
+static CompressionType
+strip_compression_suffix(char *name)
+{
+	size_t len = strlen(name);
+
+	for (int i = 0; i < SUFFIX_TYPES; i++)
+	{
+		const char *suffix = compression_suffix(suffix_types[i]);
+		size_t      slen = strlen(suffix);
+
+		if (len > slen && strcmp(name + len - slen, suffix) == 0)
+		{
+			name[len - slen] = '\0';
+			return suffix_types[i];
+		}
+	}
+	return COMPRESSION_NONE;
+}
+
+/*
+ * Add a job for each relation file below 'dir_path', which is 'rel_dir'
+ * relative to the data directory.  Entries are taken in name order, so
+ * findings come out in the same order on every run.
+ */
+static void
+scan_page_dir(PageScan *scan, const char *dir_path, const char *rel_dir, int depth)
+{
+	DirSnapshot snap;
+
+	if (!dir_snapshot_read(dir_path, &snap))
+		return;
+
+	for (int i = 0; i < snap.count && !scan->out_of_memory; i++)
+	{
+		const DirSnapshotEntry *e = snap.sorted[i];
+		char            path[PATH_MAX];
+		char            rel_path[PATH_MAX];
+		CompressionType compression = COMPRESSION_NONE;
+		uint32_t        first_block;
+		VerifyJob      *job;
+
+		path_join(path, sizeof(path), dir_path, e->name);
+		path_join(rel_path, sizeof(rel_path), rel_dir, e->name);
+
+		if (e->is_dir)
+		{
+			if (depth < PAGE_DIR_DEPTH)
+				scan_page_dir(scan, path, rel_path, depth + 1);
+			continue;
+		}
+
+		if (scan->suffixed)
+			compression = strip_compression_suffix(rel_path);
+		if (!page_relation_file(rel_path, &first_block))
+			continue;
+
+		job = verify_job_list_add(scan->jobs, path, rel_path);
+		if (job == NULL)
+		{
+			scan->out_of_memory = true;
+			break;
+		}
+		job->algorithm   = VERIFY_ALG_PAGES;
+		job->compression = compression;
+		job->pages       = scan->options;
+		job->first_block = first_block;
+	}
+
+	dir_snapshot_free(&snap);
+}
+
+/* data_checksum_version from global/pg_control of the data directory */
+static PageChecksums
+control_checksums(const char *data_dir, bool suffixed)
+{
+	uint8_t           buf[PAGE_BLCKSZ];
+	char              path[PATH_MAX];
+	CompressionType   compression = COMPRESSION_NONE;
+	DecompressStream *ds;
+	ssize_t           n;
+	size_t            len = 0;
+
+	path_join(path, sizeof(path), data_dir, "global/pg_control");
+	if (!file_exists(path) && suffixed)
+	{
+		char candidate[PATH_MAX];
+
+		for (int i = 0; i < SUFFIX_TYPES; i++)
+		{
+			snprintf(candidate, sizeof(candidate), "%s%s", path,
+					 compression_suffix(suffix_types[i]));
+			if (file_exists(candidate))
+			{
+				strcpy(path, candidate);
+				compression = suffix_types[i];
+				break;
+			}
+		}
+	}
+
+	ds = decompress_open(path, compression);
+	if (ds == NULL)
+		return PAGE_CHECKSUMS_UNKNOWN;
+	while (len < sizeof(buf) &&
+		   (n = decompress_read(ds, buf + len, sizeof(buf) - len)) > 0)
+		len += (size_t) n;
+	decompress_close(ds);
+
+	return page_checksums_from_control(buf, len);
+}
+
+/* ------------------------------------------------------------------ *
+ * check_backup_pages
+ *
+ * Verifies the pages of every relation file of the backup's data
+ * directory (see the top of this file).  Findings keep the name order
+ * of the files.
+ *
+ * A backup without a plain data directory (tar format, pgBackRest
+ * bundles) gets a warning.  Returns NULL for an unknown tool.
+ * ------------------------------------------------------------------ */
+ValidationResult*
+check_backup_pages(BackupInfo *backup)
+{
+	ValidationResult *result;
+	PageCheckOptions  options;
+	PageScan          scan;
+	VerifyJobList     jobs;
+	VerifyStats       stats;
+	char              data_dir[PATH_MAX];
+	char              path[PATH_MAX];
+	static const char *const roots[] = { "base", "global", "pg_tblspc" };
+
+	if (backup == NULL || backup->backup_path[0] == '\0')
+		return NULL;
+
+	memset(&options, 0, sizeof(options));
+	memset(&scan, 0, sizeof(scan));
+	switch (backup->tool)
+	{
+		case BACKUP_TOOL_PG_BASEBACKUP:
+			str_copy(data_dir, backup->backup_path, sizeof(data_dir));
+			break;
+		case BACKUP_TOOL_PG_PROBACKUP:
+			path_join(data_dir, sizeof(data_dir), backup->backup_path, "database");
+			options.framed = true;
+			break;
+		case BACKUP_TOOL_PGBACKREST:
+			path_join(data_dir, sizeof(data_dir), backup->backup_path, "pg_data");
+			scan.suffixed = true;
+			break;
+		default:
+			return NULL;
+	}
+
+	result = calloc(1, sizeof(ValidationResult));
+	if (result == NULL)
+		return NULL;
+	result->status = BACKUP_STATUS_OK;
+
+	path_join(path, sizeof(path), data_dir, "base");
+	if (!is_directory(path))
+	{
+		validation_add_warning(result,
+							   "Pages not verified: no plain-format data "
+							   "directory (tar-format or archived backup)");
+		result->status = BACKUP_STATUS_WARNING;
+		return result;
+	}
+
+	options.checksums = control_checksums(data_dir, scan.suffixed);
+	options.start_lsn = backup->start_lsn;
+	if (options.checksums == PAGE_CHECKSUMS_OFF)
+		log_debug("%s: data checksums are off, checking page headers only",
+				  backup->backup_id);
+
+	verify_job_list_init(&jobs, "page check");
+	jobs.scope = backup->backup_id;
+	scan.jobs = &jobs;
+	scan.options = &options;
+
+	for (size_t i = 0; i < sizeof(roots) / sizeof(roots[0]); i++)
+	{
+		path_join(path, sizeof(path), data_dir, roots[i]);
+		if (is_directory(path))
+			scan_page_dir(&scan, path, roots[i], 1);
+	}
+	if (scan.out_of_memory)
+		validation_add_error(result, "Out of memory while listing relation files");
+
+	verify_jobs_run(&jobs, validation_get_jobs());
+	verify_jobs_merge(&jobs, result, &stats);
+	verify_job_list_free(&jobs);
+
+	log_debug("Page check (%s): %d relation files verified, %d errors",
+			  page_checksum_implementation(), stats.verified, result->error_count);
+
+	if (result->error_count > 0)
+		result->status = BACKUP_STATUS_ERROR;
+	else if (result->warning_count > 0)
+		result->status = BACKUP_STATUS_WARNING;
+
+	return result;
+}
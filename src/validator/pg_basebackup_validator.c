@@ -27,7 +27,11 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "pg_backup_auditor.h"
+#include "validation_result.h"
 #include "sha256.h"
+#include "backup_manifest.h"
+#include "verify_jobs.h"
+#include "incremental_backup.h"
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
@@ -35,32 +39,6 @@
 #include <inttypes.h>
 #include <strings.h>
 
-static void
-add_error(ValidationResult *result, const char *message)
-{
-	if (result == NULL || message == NULL)
-		return;
-	result->errors = realloc(result->errors,
-							 sizeof(char *) * (result->error_count + 1));
-	if (result->errors == NULL)
-		return;
-	result->errors[result->error_count] = strdup(message);
-	result->error_count++;
-}
-
-static void
-add_warning(ValidationResult *result, const char *message)
-{
-	if (result == NULL || message == NULL)
-		return;
-	result->warnings = realloc(result->warnings,
-							   sizeof(char *) * (result->warning_count + 1));
-	if (result->warnings == NULL)
-		return;
-	result->warnings[result->warning_count] = strdup(message);
-	result->warning_count++;
-}
-
 /*
  * has_tar_file — check if the backup directory contains a file whose
  * name starts with the given prefix (e.g. "base.tar" or "pg_wal.tar").
@@ -162,23 +140,23 @@ pg_basebackup_validate_structure(BackupInfo *backup)
 	{
 		/* Tar format */
 		if (!has_tar_file(backup->backup_path, "base.tar"))
-			add_error(result, "Missing base.tar* (main data tarball)");
+			validation_add_error(result, "Missing base.tar* (main data tarball)");
 
 		if (backup->wal_stream && !has_tar_file(backup->backup_path, "pg_wal.tar"))
-			add_warning(result,
-						"Missing pg_wal.tar* (expected for stream backup)");
+			validation_add_warning(result,
+								   "Missing pg_wal.tar* (expected for stream backup)");
 	}
 	else
 	{
 		/* Plain format */
 		path_join(path, sizeof(path), backup->backup_path, "base");
 		if (!is_directory(path))
-			add_error(result, "Missing base/ directory");
+			validation_add_error(result, "Missing base/ directory");
 
 		path_join(path, sizeof(path), backup->backup_path, "global");
 		path_join(path, sizeof(path), path, "pg_control");
 		if (!file_exists(path))
-			add_error(result, "Missing global/pg_control");
+			validation_add_error(result, "Missing global/pg_control");
 
 		/* backup_label or backup_manifest must exist */
 		{
@@ -186,22 +164,22 @@ pg_basebackup_validate_structure(BackupInfo *backup)
 			path_join(label,    sizeof(label),    backup->backup_path, "backup_label");
 			path_join(manifest, sizeof(manifest), backup->backup_path, "backup_manifest");
 			if (!file_exists(label) && !file_exists(manifest))
-				add_error(result,
-						  "Missing backup_label and backup_manifest "
-						  "(at least one is required)");
+				validation_add_error(result,
+									 "Missing backup_label and backup_manifest "
+									 "(at least one is required)");
 		}
 
 		/* PG_VERSION — always present in a valid plain backup */
 		path_join(path, sizeof(path), backup->backup_path, "PG_VERSION");
 		if (!file_exists(path))
-			add_warning(result, "Missing PG_VERSION");
+			validation_add_warning(result, "Missing PG_VERSION");
 
 		if (backup->wal_stream)
 		{
 			path_join(path, sizeof(path), backup->backup_path, "pg_wal");
 			if (!is_directory(path))
-				add_warning(result,
-							"Missing pg_wal/ (expected for stream backup)");
+				validation_add_warning(result,
+									   "Missing pg_wal/ (expected for stream backup)");
 		}
 	}
 
@@ -217,8 +195,9 @@ pg_basebackup_validate_structure(BackupInfo *backup)
  * pg_basebackup_get_embedded_wal
  *
  * For plain format stream backups: scan pg_wal/ directory.
- * For tar format stream backups: scan the directory for pg_wal.tar*
- *   and pass it to scan_wal_archive (which handles tar scanning).
+ * For tar format stream backups: find pg_wal.tar* and pass it to
+ *   scan_wal_archive, which lists the segments from the tar headers;
+ *   validation then reads them from the tar in one pass.
  * Archive-mode backups return NULL.
  * ------------------------------------------------------------------ */
 WALArchiveInfo*
@@ -259,74 +238,219 @@ pg_basebackup_get_embedded_wal(BackupInfo *backup)
  *
  * Also verifies the manifest's own integrity checksum
  * ("Manifest-Checksum" covers all manifest bytes before that key).
+ * The manifest is mapped and read once (backup_manifest.h).
  *
  * Returns NULL when backup_manifest does not exist (not applicable).
- * Tar-format backups: only the manifest self-checksum is verified
- * (individual files inside the tar are not accessible without unpacking).
+ * Tar-format backups are checked by streaming base.tar* and each
+ * tablespace <oid>.tar* once, hashing members as they are read.
  * ------------------------------------------------------------------ */
 
 /*
- * Helper: extract a JSON string value following "Key": "VALUE"
- * within a single line.  Writes at most outsz-1 chars into out.
- * Returns true if found.
+ * Helper: run the manifest jobs against the archives of a tar-format
+ * backup.  base.tar* holds the data directory itself; tablespace
+ * <oid>.tar* members are listed in the manifest as pg_tblspc/<oid>/...
+ * pg_wal.tar* is left to WAL validation.
  */
-static bool
-json_extract_string(const char *line, const char *key,
-					char *out, size_t outsz)
+static void
+verify_tar_archives(const char *backup_path, VerifyJobList *jobs,
+					ValidationResult *result)
 {
-	const char *p;
-	const char *q;
-	size_t      len;
+	DIR           *dir;
+	struct dirent *entry;
+	char           tar_path[PATH_MAX];
+	char           prefix[64];
+	char           msg[PATH_MAX + 64];
 
-	p = strstr(line, key);
-	if (p == NULL)
-		return false;
+	dir = opendir(backup_path);
+	if (dir == NULL)
+	{
+		validation_add_error(result, "Cannot open backup directory for tar verification");
+		return;
+	}
 
-	p += strlen(key);
+	while ((entry = readdir(dir)) != NULL)
+	{
+		const char *name = entry->d_name;
+		size_t      digits = strspn(name, "0123456789");
+
+		if (strncmp(name, "base.tar", 8) == 0)
+			prefix[0] = '\0';
+		else if (digits > 0 && strncmp(name + digits, ".tar", 4) == 0)
+			snprintf(prefix, sizeof(prefix), "pg_tblspc/%.*s/",
+					 (int) digits, name);
+		else
+			continue;
 
-	/* skip whitespace and ':' */
-	while (*p == ' ' || *p == '\t' || *p == ':')
-		p++;
+		path_join(tar_path, sizeof(tar_path), backup_path, name);
+		log_debug("Verifying manifest entries from %s", name);
 
-	if (*p != '"')
-		return false;
-	p++;   /* skip opening quote */
+		if (!verify_jobs_run_tar(jobs, tar_path, prefix))
+		{
+			snprintf(msg, sizeof(msg), "Cannot read tar archive: %s", name);
+			validation_add_error(result, msg);
+		}
+	}
+	closedir(dir);
 
-	q = strchr(p, '"');
-	if (q == NULL)
-		return false;
+	verify_jobs_finish_missing(jobs);
+}
+
+/* ------------------------------------------------------------------ *
+ * WAL summaries of incremental backups
+ *
+ * The server takes an incremental backup only if its WAL summaries cover
+ * everything from the parent's start (INCREMENTAL FROM LSN, kept in
+ * redo_lsn) to the backup's own start.  Summaries are looked for in the
+ * backup's pg_wal/summaries/, then in the --wal-summaries directory
+ * (normally the server's pg_wal/summaries/).  Each file is read once, in
+ * one pass: a damaged summary is an error, a range none of them covers a
+ * warning, as summaries are removed on the server as they age.
+ * ------------------------------------------------------------------ */
 
-	len = (size_t)(q - p);
-	if (len >= outsz)
-		len = outsz - 1;
+static const char *wal_summaries_dir = NULL;
 
-	memcpy(out, p, len);
-	out[len] = '\0';
-	return true;
+void
+validation_set_wal_summaries_dir(const char *dir)
+{
+	wal_summaries_dir = dir;
+}
+
+static void
+summary_chunk(void *arg, const uint8_t *buf, size_t len)
+{
+	wal_summary_walk_update(arg, buf, len);
+}
+
+static int
+cmp_summary_start(const void *a, const void *b)
+{
+	const WALSummaryRange *ra = a;
+	const WALSummaryRange *rb = b;
+
+	if (ra->start_lsn != rb->start_lsn)
+		return ra->start_lsn < rb->start_lsn ? -1 : 1;
+	return 0;
 }
 
 /*
- * Helper: extract a JSON integer value following "Key": NUMBER
- * Returns true if found.
+ * Check the summary files of 'dir' and collect the ranges of those on the
+ * backup's timeline or its ancestors.  Returns the number of summary
+ * files found, -1 if the directory cannot be opened.
  */
-static bool
-json_extract_uint64(const char *line, const char *key, uint64_t *out)
+static int
+read_wal_summaries(const char *dir, const BackupInfo *backup,
+				   WALSummaryRange **ranges, int *count,
+				   ValidationResult *result)
 {
-	const char *p;
+	DIR           *d;
+	struct dirent *entry;
+	int            capacity = 0;
+	int            found = 0;
+	char           msg[PATH_MAX + 224];
 
-	p = strstr(line, key);
-	if (p == NULL)
-		return false;
+	d = opendir(dir);
+	if (d == NULL)
+		return -1;
+
+	while ((entry = readdir(d)) != NULL)
+	{
+		WALSummaryRange range;
+		WALSummaryWalk  walk;
+		char            path[PATH_MAX];
 
-	p += strlen(key);
-	while (*p == ' ' || *p == '\t' || *p == ':')
-		p++;
+		if (!wal_summary_file_name(entry->d_name, &range))
+			continue;
+		found++;
 
-	if (*p < '0' || *p > '9')
-		return false;
+		path_join(path, sizeof(path), dir, entry->d_name);
+		wal_summary_walk_init(&walk);
+		if (!read_file_chunks(path, summary_chunk, &walk))
+		{
+			snprintf(msg, sizeof(msg), "Cannot read WAL summary: %s", path);
+			validation_add_warning(result, msg);
+			continue;
+		}
+		if (!wal_summary_walk_finish(&walk))
+		{
+			snprintf(msg, sizeof(msg), "Corrupt WAL summary %s: %s",
+					 path, walk.problem);
+			validation_add_error(result, msg);
+			continue;
+		}
 
-	*out = (uint64_t)strtoull(p, NULL, 10);
-	return true;
+		if (range.timeline > backup->timeline)
+			continue;
+		if (*count == capacity)
+		{
+			WALSummaryRange *grown;
+
+			capacity = capacity == 0 ? 16 : capacity * 2;
+			grown = realloc(*ranges, sizeof(WALSummaryRange) * (size_t) capacity);
+			if (grown == NULL)
+			{
+				validation_add_error(result, "Out of memory while reading WAL summaries");
+				break;
+			}
+			*ranges = grown;
+		}
+		(*ranges)[(*count)++] = range;
+	}
+	closedir(d);
+	return found;
+}
+
+static void
+check_wal_summaries(BackupInfo *backup, ValidationResult *result)
+{
+	WALSummaryRange *ranges = NULL;
+	int              count = 0;
+	int              found;
+	char             dir[PATH_MAX];
+	XLogRecPtr       covered;
+	char             from[32], to[32], upto[32];
+	char             msg[256];
+
+	if (backup->redo_lsn == 0 || backup->start_lsn <= backup->redo_lsn)
+		return;
+
+	path_join(dir, sizeof(dir), backup->backup_path, "pg_wal/summaries");
+	found = read_wal_summaries(dir, backup, &ranges, &count, result);
+	if (found <= 0 && wal_summaries_dir != NULL)
+	{
+		str_copy(dir, wal_summaries_dir, sizeof(dir));
+		found = read_wal_summaries(dir, backup, &ranges, &count, result);
+	}
+	if (found <= 0)
+	{
+		log_debug("%s: no WAL summaries to check", backup->backup_id);
+		free(ranges);
+		return;
+	}
+
+	/* Sweep the ranges in start order from the parent's start */
+	if (count > 1)
+		qsort(ranges, (size_t) count, sizeof(WALSummaryRange), cmp_summary_start);
+	covered = backup->redo_lsn;
+	for (int i = 0; i < count && covered < backup->start_lsn; i++)
+	{
+		if (ranges[i].start_lsn > covered)
+			break;
+		if (ranges[i].end_lsn > covered)
+			covered = ranges[i].end_lsn;
+	}
+	free(ranges);
+
+	log_debug("%s: %d WAL summaries in %s", backup->backup_id, found, dir);
+	if (covered >= backup->start_lsn)
+		return;
+
+	format_lsn(backup->redo_lsn, from, sizeof(from));
+	format_lsn(backup->start_lsn, to, sizeof(to));
+	format_lsn(covered, upto, sizeof(upto));
+	snprintf(msg, sizeof(msg),
+			 "WAL summaries in %.64s cover %s..%s only up to %s",
+			 dir, from, to, upto);
+	validation_add_warning(result, msg);
 }
 
 ValidationResult*
@@ -334,27 +458,13 @@ check_manifest_checksums(BackupInfo *backup)
 {
 	ValidationResult *result;
 	char              manifest_path[PATH_MAX];
-	FILE             *fp;
-	char              line[4096];
 	bool              is_tar;
-	int               checked  = 0;
-	int               errors   = 0;
-
-	/* Per-entry state */
-	char     entry_path[PATH_MAX];
-	char     entry_algo[32];
-	char     entry_cksum[SHA256_HEX_LENGTH + 2];
-	uint64_t entry_size;
-	bool     have_path, have_algo, have_cksum, have_size;
-
-	/* Manifest self-checksum state */
-	SHA256Ctx manifest_ctx;
-	uint8_t   manifest_digest[SHA256_DIGEST_LENGTH];
-	char      manifest_hex[SHA256_HEX_LENGTH + 1];
-	char      stored_manifest_cksum[SHA256_HEX_LENGTH + 2];
-	bool      have_manifest_cksum = false;
-	long      manifest_cksum_offset = 0;   /* byte offset of "Manifest-Checksum" line */
-	char      msg[PATH_MAX + 128];
+	VerifyJobList     jobs;
+	VerifyStats       stats;
+	ManifestReader    reader;
+	ManifestFileEntry entry;
+	int               rc;
+	char              msg[PATH_MAX + 128];
 
 	if (backup == NULL || backup->backup_path[0] == '\0')
 		return NULL;
@@ -373,247 +483,127 @@ check_manifest_checksums(BackupInfo *backup)
 	is_tar = has_tar_file(backup->backup_path, "base.tar");
 
 	/*
-	 * First pass: find the byte offset where "Manifest-Checksum" begins
-	 * so we can hash only the preceding bytes.
+	 * One pass over the mapped manifest: file entries become verify jobs,
+	 * and the bytes before "Manifest-Checksum" are hashed on the way.
 	 */
-	fp = fopen(manifest_path, "r");
-	if (fp == NULL)
+	if (!manifest_reader_open(&reader, manifest_path, true))
 	{
-		add_error(result, "Cannot open backup_manifest");
+		validation_add_error(result, "Cannot open backup_manifest");
 		result->status = BACKUP_STATUS_ERROR;
 		return result;
 	}
 
-	manifest_cksum_offset = 0;
-	while (fgets(line, sizeof(line), fp) != NULL)
+	verify_job_list_init(&jobs, "pg_basebackup manifest");
+	jobs.scope = backup->backup_id;
+	jobs.unreadable_warns = true;
+
+	while ((rc = manifest_reader_next(&reader, &entry)) > 0)
 	{
-		if (strstr(line, "\"Manifest-Checksum\"") != NULL)
+		char       entry_path[PATH_MAX];
+		char       file_path[PATH_MAX];
+		VerifyJob *job;
+
+		/* Skip pg_wal entries — covered by WAL validation */
+		if ((entry.path.len == 6 && memcmp(entry.path.ptr, "pg_wal", 6) == 0) ||
+			(entry.path.len > 7 && memcmp(entry.path.ptr, "pg_wal/", 7) == 0))
+			continue;
+
+		snprintf(entry_path, sizeof(entry_path), "%.*s",
+				 (int) entry.path.len, entry.path.ptr);
+		path_join(file_path, sizeof(file_path),
+				  backup->backup_path, entry_path);
+
+		job = verify_job_list_add(&jobs, file_path, entry_path);
+		if (job == NULL)
 		{
-			/* Record where this line starts */
-			if (json_extract_string(line, "\"Manifest-Checksum\"",
-									stored_manifest_cksum,
-									sizeof(stored_manifest_cksum)))
-				have_manifest_cksum = true;
+			validation_add_error(result, "Out of memory while reading backup_manifest");
 			break;
 		}
-		manifest_cksum_offset = ftell(fp);
-	}
-	fclose(fp);
 
-	/*
-	 * Verify manifest self-checksum: hash the first manifest_cksum_offset
-	 * bytes of the file and compare against stored_manifest_cksum.
-	 */
-	if (have_manifest_cksum && manifest_cksum_offset > 0)
-	{
-		uint8_t  buf[8192];
-		size_t   remaining = (size_t)manifest_cksum_offset;
-		size_t   nread;
+		/* Missing files only matter if size > 0 */
+		if (entry.has_size && entry.size == 0)
+			job->flags |= VERIFY_SKIP_IF_MISSING;
+		if (incremental_file_name(entry_path))
+			job->flags |= VERIFY_INCREMENTAL;
 
-		fp = fopen(manifest_path, "rb");
-		if (fp != NULL)
+		if (json_slice_case_eq(entry.algorithm, "SHA256") && entry.checksum.ptr != NULL)
 		{
-			sha256_init(&manifest_ctx);
-			while (remaining > 0)
-			{
-				size_t want = remaining < sizeof(buf) ? remaining : sizeof(buf);
-				nread = fread(buf, 1, want, fp);
-				if (nread == 0) break;
-				sha256_update(&manifest_ctx, buf, nread);
-				remaining -= nread;
-			}
-			fclose(fp);
-
-			sha256_final(&manifest_ctx, manifest_digest);
-			sha256_to_hex(manifest_digest, manifest_hex);
-
-			if (strcasecmp(manifest_hex, stored_manifest_cksum) != 0)
+			job->algorithm    = VERIFY_ALG_SHA256;
+			job->expected_hex = strndup(entry.checksum.ptr, entry.checksum.len);
+		}
+		else if (json_slice_case_eq(entry.algorithm, "CRC32C"))
+		{
+			/*
+			 * PostgreSQL stores CRC32C as little-endian bytes,
+			 * each byte printed as 2 hex digits (pg_checksum_final).
+			 * e.g. value 0xFB8EEC93 → "93EC8EFB".
+			 * Parse byte-by-byte and reconstruct as LE uint32.
+			 */
+			uint8_t b[4] = {0, 0, 0, 0};
+
+			if (entry.checksum.len == 8)
 			{
-				snprintf(msg, sizeof(msg),
-						 "backup_manifest self-checksum mismatch "
-						 "(expected %s, got %s)",
-						 stored_manifest_cksum, manifest_hex);
-				add_error(result, msg);
-				errors++;
+				for (int bi = 0; bi < 4; bi++)
+				{
+					char tmp[3] = { entry.checksum.ptr[bi*2],
+									entry.checksum.ptr[bi*2+1], '\0' };
+					b[bi] = (uint8_t)strtoul(tmp, NULL, 16);
+				}
 			}
+			job->algorithm    = VERIFY_ALG_CRC32C;
+			job->expected_crc = (uint32_t)b[0]
+							  | ((uint32_t)b[1] << 8)
+							  | ((uint32_t)b[2] << 16)
+							  | ((uint32_t)b[3] << 24);
 		}
+		/* NONE (or unknown): presence check only */
 	}
-	else if (!have_manifest_cksum)
+
+	if (rc < 0)
 	{
-		add_warning(result,
-					"backup_manifest has no Manifest-Checksum "
-					"(PostgreSQL < 13 or truncated manifest)");
+		snprintf(msg, sizeof(msg),
+				 "backup_manifest is malformed at byte %zu", reader.pos);
+		validation_add_error(result, msg);
 	}
 
-	/*
-	 * For tar format we cannot check individual files without unpacking,
-	 * so stop here — the manifest self-checksum above is sufficient.
-	 */
-	if (is_tar)
-		goto done;
-
-	/*
-	 * Second pass: validate per-file checksums (SHA256 and CRC32C).
-	 */
-	fp = fopen(manifest_path, "r");
-	if (fp == NULL)
-		goto done;
-
-	entry_path[0]  = '\0';
-	entry_algo[0]  = '\0';
-	entry_cksum[0] = '\0';
-	entry_size     = 0;
-	have_path = have_algo = have_cksum = have_size = false;
-
-	while (fgets(line, sizeof(line), fp) != NULL)
+	/* Manifest self-checksum, computed during the pass above */
+	if (reader.has_checksum)
 	{
-		/* Stop at Manifest-Checksum — no more file entries after it */
-		if (strstr(line, "\"Manifest-Checksum\"") != NULL)
-			break;
-
-		/* Accumulate fields for the current entry */
-		if (!have_path)
-			have_path = json_extract_string(line, "\"Path\"",
-											entry_path, sizeof(entry_path));
-		if (!have_algo)
-			have_algo = json_extract_string(line, "\"Checksum-Algorithm\"",
-											entry_algo, sizeof(entry_algo));
-		if (!have_cksum)
-			have_cksum = json_extract_string(line, "\"Checksum\"",
-											 entry_cksum, sizeof(entry_cksum));
-		if (!have_size)
-			have_size = json_extract_uint64(line, "\"Size\"", &entry_size);
-
-		/*
-		 * Once we have Path + Algorithm + Checksum (or NONE), validate.
-		 * Entry is complete when we have at minimum: path + algo + cksum,
-		 * OR path + algo=NONE + size.
-		 */
-		if (!have_path || !have_algo)
-			continue;
-		if (!have_cksum && !(strcasecmp(entry_algo, "NONE") == 0 && have_size))
-			continue;
-
+		if (reader.stored_checksum.len != SHA256_HEX_LENGTH ||
+			strncasecmp(reader.computed_checksum, reader.stored_checksum.ptr,
+						SHA256_HEX_LENGTH) != 0)
 		{
-			char file_path[PATH_MAX];
-			bool skip = false;
-
-			path_join(file_path, sizeof(file_path),
-					  backup->backup_path, entry_path);
-
-			/* Skip pg_wal entries — covered by WAL validation */
-			if (strncmp(entry_path, "pg_wal/", 7) == 0 ||
-				strcmp(entry_path, "pg_wal") == 0)
-				skip = true;
-
-			if (!skip)
-			{
-				if (!file_exists(file_path))
-				{
-					/* Missing files only matter if size > 0 */
-					if (!have_size || entry_size > 0)
-					{
-						snprintf(msg, sizeof(msg),
-								 "Missing file: %s", entry_path);
-						add_error(result, msg);
-						errors++;
-					}
-				}
-				else if (strcasecmp(entry_algo, "SHA256") == 0)
-				{
-					uint8_t digest[SHA256_DIGEST_LENGTH];
-					char    hex[SHA256_HEX_LENGTH + 1];
-
-					checked++;
-					if (sha256_file(file_path, digest))
-					{
-						sha256_to_hex(digest, hex);
-						if (strcasecmp(hex, entry_cksum) != 0)
-						{
-							snprintf(msg, sizeof(msg),
-									 "SHA256 mismatch: %s "
-									 "(expected %.16s…, got %.16s…)",
-									 entry_path, entry_cksum, hex);
-							add_error(result, msg);
-							errors++;
-						}
-					}
-					else
-					{
-						snprintf(msg, sizeof(msg),
-								 "Cannot read file for checksum: %s",
-								 entry_path);
-						add_warning(result, msg);
-					}
-				}
-				else if (strcasecmp(entry_algo, "CRC32C") == 0)
-				{
-					uint32_t crc = 0;
-					uint32_t expected;
-
-					checked++;
-
-					/*
-					 * PostgreSQL stores CRC32C as little-endian bytes,
-					 * each byte printed as 2 hex digits (pg_checksum_final).
-					 * e.g. value 0xFB8EEC93 → "93EC8EFB".
-					 * Parse byte-by-byte and reconstruct as LE uint32.
-					 */
-					{
-						uint8_t b[4] = {0, 0, 0, 0};
-						size_t  hlen = strlen(entry_cksum);
-
-						if (hlen == 8)
-						{
-							for (int bi = 0; bi < 4; bi++)
-							{
-								char tmp[3] = { entry_cksum[bi*2],
-												entry_cksum[bi*2+1], '\0' };
-								b[bi] = (uint8_t)strtoul(tmp, NULL, 16);
-							}
-						}
-						expected = (uint32_t)b[0]
-								 | ((uint32_t)b[1] << 8)
-								 | ((uint32_t)b[2] << 16)
-								 | ((uint32_t)b[3] << 24);
-					}
-
-					if (compute_file_crc32c(file_path, &crc))
-					{
-						if (crc != expected)
-						{
-							snprintf(msg, sizeof(msg),
-									 "CRC32C mismatch: %s "
-									 "(expected %08X, got %08X)",
-									 entry_path, expected, crc);
-							add_error(result, msg);
-							errors++;
-						}
-					}
-					else
-					{
-						snprintf(msg, sizeof(msg),
-								 "Cannot read file for checksum: %s",
-								 entry_path);
-						add_warning(result, msg);
-					}
-				}
-				/* NONE: presence already verified above */
-			}
+			snprintf(msg, sizeof(msg),
+					 "backup_manifest self-checksum mismatch "
+					 "(expected %.*s, got %s)",
+					 (int) (reader.stored_checksum.len < 128 ?
+							reader.stored_checksum.len : 128),
+					 reader.stored_checksum.ptr, reader.computed_checksum);
+			validation_add_error(result, msg);
 		}
-
-		/* Reset for next entry */
-		entry_path[0] = entry_algo[0] = entry_cksum[0] = '\0';
-		entry_size = 0;
-		have_path = have_algo = have_cksum = have_size = false;
 	}
+	else if (rc >= 0)
+	{
+		validation_add_warning(result,
+							   "backup_manifest has no Manifest-Checksum "
+							   "(PostgreSQL < 13 or truncated manifest)");
+	}
+
+	manifest_reader_close(&reader);
+
+	if (is_tar)
+		verify_tar_archives(backup->backup_path, &jobs, result);
+	else
+		verify_jobs_run(&jobs, validation_get_jobs());
+	verify_jobs_merge(&jobs, result, &stats);
+	verify_job_list_free(&jobs);
 
-	fclose(fp);
+	log_debug("Manifest check: %d files verified, %d errors",
+			  stats.verified, result->error_count);
 
-	(void)checked;   /* available for debug output if needed */
-	(void)errors;
+	if (backup->type == BACKUP_TYPE_INCREMENTAL && !validation_stop_requested())
+		check_wal_summaries(backup, result);
 
-done:
 	if (result->error_count > 0)
 		result->status = BACKUP_STATUS_ERROR;
 	else if (result->warning_count > 0)
@@ -23,35 +23,10 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "pg_backup_auditor.h"
+#include "validation_result.h"
 #include <stdlib.h>
 #include <string.h>
 
-static void
-add_error(ValidationResult *result, const char *message)
-{
-	if (result == NULL || message == NULL)
-		return;
-	result->errors = realloc(result->errors,
-							 sizeof(char *) * (result->error_count + 1));
-	if (result->errors == NULL)
-		return;
-	result->errors[result->error_count] = strdup(message);
-	result->error_count++;
-}
-
-static void
-add_warning(ValidationResult *result, const char *message)
-{
-	if (result == NULL || message == NULL)
-		return;
-	result->warnings = realloc(result->warnings,
-							   sizeof(char *) * (result->warning_count + 1));
-	if (result->warnings == NULL)
-		return;
-	result->warnings[result->warning_count] = strdup(message);
-	result->warning_count++;
-}
-
 /* ------------------------------------------------------------------ *
  * pg_probackup_validate_structure
  *
@@ -90,7 +65,7 @@ pg_probackup_validate_structure(BackupInfo *backup)
 	path_join(path, sizeof(path), backup->backup_path, "database");
 	if (!is_directory(path))
 	{
-		add_error(result, "Missing database/ directory");
+		validation_add_error(result, "Missing database/ directory");
 	}
 	else
 	{
@@ -98,7 +73,7 @@ pg_probackup_validate_structure(BackupInfo *backup)
 		path_join(path, sizeof(path), backup->backup_path, "database");
 		path_join(path, sizeof(path), path, "database_map");
 		if (!file_exists(path))
-			add_error(result, "Missing database/database_map");
+			validation_add_error(result, "Missing database/database_map");
 
 		/* database/global/pg_control */
 		{
@@ -107,7 +82,7 @@ pg_probackup_validate_structure(BackupInfo *backup)
 			path_join(ctrl, sizeof(ctrl), ctrl, "global");
 			path_join(ctrl, sizeof(ctrl), ctrl, "pg_control");
 			if (!file_exists(ctrl))
-				add_error(result, "Missing database/global/pg_control");
+				validation_add_error(result, "Missing database/global/pg_control");
 		}
 
 		/* database/backup_label (ARCHIVE mode only) */
@@ -116,9 +91,9 @@ pg_probackup_validate_structure(BackupInfo *backup)
 			path_join(path, sizeof(path), backup->backup_path, "database");
 			path_join(path, sizeof(path), path, "backup_label");
 			if (!file_exists(path))
-				add_error(result,
-						  "Missing database/backup_label "
-						  "(required for archive-mode backup)");
+				validation_add_error(result,
+									 "Missing database/backup_label "
+									 "(required for archive-mode backup)");
 		}
 
 		/* database/PG_VERSION — only present in FULL backups;
@@ -128,7 +103,7 @@ pg_probackup_validate_structure(BackupInfo *backup)
 			path_join(path, sizeof(path), backup->backup_path, "database");
 			path_join(path, sizeof(path), path, "PG_VERSION");
 			if (!file_exists(path))
-				add_warning(result, "Missing database/PG_VERSION");
+				validation_add_warning(result, "Missing database/PG_VERSION");
 		}
 
 		/* database/pg_wal/ (STREAM mode) */
@@ -138,9 +113,9 @@ pg_probackup_validate_structure(BackupInfo *backup)
 			path_join(wal_dir, sizeof(wal_dir), backup->backup_path, "database");
 			path_join(wal_dir, sizeof(wal_dir), wal_dir, "pg_wal");
 			if (!is_directory(wal_dir))
-				add_warning(result,
-							"Missing database/pg_wal/ "
-							"(expected for stream backup)");
+				validation_add_warning(result,
+									   "Missing database/pg_wal/ "
+									   "(expected for stream backup)");
 		}
 
 		/*
@@ -157,9 +132,9 @@ pg_probackup_validate_structure(BackupInfo *backup)
 	path_join(path, sizeof(path),
 			  backup->backup_path, "backup_content.control");
 	if (!file_exists(path))
-		add_warning(result,
-					"Missing backup_content.control "
-					"(checksum validation not possible)");
+		validation_add_warning(result,
+							   "Missing backup_content.control "
+							   "(checksum validation not possible)");
 
 	if (result->error_count > 0)
 		result->status = BACKUP_STATUS_ERROR;
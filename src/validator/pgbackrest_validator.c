@@ -23,40 +23,18 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "pg_backup_auditor.h"
+#include "validation_result.h"
 #include "ini_parser.h"
-#include "sha256.h"
+#include "verify_jobs.h"
+#include "decompress.h"
+#include "json_scan.h"
+#include "metrics.h"
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
 #include <stdio.h>
 #include <strings.h>
 
-static void
-add_error(ValidationResult *result, const char *message)
-{
-	if (result == NULL || message == NULL)
-		return;
-	result->errors = realloc(result->errors,
-							 sizeof(char *) * (result->error_count + 1));
-	if (result->errors == NULL)
-		return;
-	result->errors[result->error_count] = strdup(message);
-	result->error_count++;
-}
-
-static void
-add_warning(ValidationResult *result, const char *message)
-{
-	if (result == NULL || message == NULL)
-		return;
-	result->warnings = realloc(result->warnings,
-							   sizeof(char *) * (result->warning_count + 1));
-	if (result->warnings == NULL)
-		return;
-	result->warnings[result->warning_count] = strdup(message);
-	result->warning_count++;
-}
-
 /*
  * has_pg_data — check that the backup directory contains a pg_data/
  * subdirectory (uncompressed) or any file starting with "pg_data"
@@ -127,11 +105,11 @@ pgbackrest_validate_structure(BackupInfo *backup)
 	/* backup.manifest */
 	path_join(path, sizeof(path), backup->backup_path, "backup.manifest");
 	if (!file_exists(path))
-		add_error(result, "Missing backup.manifest");
+		validation_add_error(result, "Missing backup.manifest");
 
 	/* pg_data/ or pg_data.* */
 	if (!has_pg_data(backup->backup_path))
-		add_error(result, "Missing pg_data directory or archive");
+		validation_add_error(result, "Missing pg_data directory or archive");
 
 	/*
 	 * For plain (uncompressed) backups pg_data/ is a real directory and we
@@ -148,12 +126,12 @@ pgbackrest_validate_structure(BackupInfo *backup)
 			path_join(ctrl, sizeof(ctrl), pg_data, "global");
 			path_join(ctrl, sizeof(ctrl), ctrl, "pg_control");
 			if (!file_exists(ctrl))
-				add_warning(result, "Missing pg_data/global/pg_control");
+				validation_add_warning(result, "Missing pg_data/global/pg_control");
 
 			/* pg_data/PG_VERSION */
 			path_join(path, sizeof(path), pg_data, "PG_VERSION");
 			if (!file_exists(path))
-				add_warning(result, "Missing pg_data/PG_VERSION");
+				validation_add_warning(result, "Missing pg_data/PG_VERSION");
 		}
 	}
 
@@ -188,12 +166,13 @@ pgbackrest_validate_structure(BackupInfo *backup)
 
 				if (strncmp(line, "backup-error=y", 14) == 0)
 				{
-					add_error(result,
-							  "backup.manifest reports backup-error=y "
-							  "(backup completed with errors — may not be restorable)");
+					validation_add_error(result,
+										 "backup.manifest reports backup-error=y "
+										 "(backup completed with errors — may not be restorable)");
 					break;
 				}
 			}
+			metrics_io_stream(fp);
 			fclose(fp);
 		}
 	}
@@ -201,9 +180,9 @@ pgbackrest_validate_structure(BackupInfo *backup)
 	/* backup.manifest.copy (redundant copy, absence is a soft warning) */
 	path_join(path, sizeof(path), backup->backup_path, "backup.manifest.copy");
 	if (!file_exists(path))
-		add_warning(result,
-					"Missing backup.manifest.copy "
-					"(redundant copy absent — not critical)");
+		validation_add_warning(result,
+							   "Missing backup.manifest.copy "
+							   "(redundant copy absent — not critical)");
 
 	if (result->error_count > 0)
 		result->status = BACKUP_STATUS_ERROR;
@@ -223,105 +202,172 @@ pgbackrest_validate_structure(BackupInfo *backup)
  *   pg_data/some/file={"checksum":"<sha1hex>","size":<n>,...}
  *
  * For every file that has a "checksum" field:
- *   - verify the file exists at backup_path/key
+ *   - verify the file exists at backup_path/key, or, for an unchanged
+ *     file with a "reference", in the referenced earlier backup next to it
  *   - compute SHA1 and compare
  *
  * Files without "checksum" (checksum-page=true block files where pgbackrest
  * stores page-level checksums separately, or zero-size files) are skipped —
  * their integrity is covered by PostgreSQL's own page checksums.
  *
+ * Compressed backups (pg_data/<file>.gz, .lz4, .zst, .bz2) are verified
+ * by streaming each file through the decompressor into SHA-1, since the
+ * manifest describes the original content.
+ *
  * Returns NULL if backup.manifest does not exist or backup is not pgbackrest.
- * Only works for plain (uncompressed) backups — compressed data files are
- * opaque without unpacking.
  * ------------------------------------------------------------------ */
 
+/* Fields of a [target:file] entry of backup.manifest, read in one pass */
+enum { FILE_CHECKSUM, FILE_SIZE, FILE_REFERENCE, FILE_NFIELDS };
+
+static const char *const file_fields[FILE_NFIELDS] = { "checksum", "size", "reference" };
+
 /*
- * Extract a JSON string value: {"checksum":"<value>",...}
- * Returns pointer into a static buffer, or NULL if not found.
+ * What the streaming pass over backup.manifest collects: a job per
+ * [target:file] entry and the compression options.
  */
-static const char *
-extract_json_str(const char *json, const char *key)
+typedef struct {
+	BackupInfo    *backup;
+	VerifyJobList *jobs;
+	bool           has_files;
+	bool           out_of_memory;
+	bool           has_compress_type;   /* option-compress-type seen */
+	char           compress_type[32];
+	bool           has_compress;        /* option-compress seen */
+	bool           compress;
+} ManifestScan;
+
+static bool
+manifest_scan_entry(IniSlice section, IniSlice key, IniSlice value, void *arg)
 {
-	static char buf[256];
-	char        search[64];
-	const char *p, *q;
-	size_t      len;
-
-	snprintf(search, sizeof(search), "\"%s\":\"", key);
-	p = strstr(json, search);
-	if (p == NULL)
-		return NULL;
+	ManifestScan *scan = arg;
+	const char   *rel_path = key.ptr;  /* e.g. "pg_data/PG_VERSION" */
+	JsonSlice     v[FILE_NFIELDS];
+	uint64_t      size;
+	char          file_path[PATH_MAX];
+	VerifyJob    *job;
+
+	if (ini_slice_eq(section, "backup:option"))
+	{
+		/* JSON-encoded: strings are quoted */
+		if (ini_slice_eq(key, "option-compress-type") && !scan->has_compress_type)
+		{
+			const char *name = value.ptr[0] == '"' ? value.ptr + 1 : value.ptr;
+			size_t      len = strcspn(name, "\"");
 
-	p += strlen(search);
-	q  = strchr(p, '"');
-	if (q == NULL)
-		return NULL;
+			scan->has_compress_type = true;
+			if (len < sizeof(scan->compress_type))
+			{
+				memcpy(scan->compress_type, name, len);
+				scan->compress_type[len] = '\0';
+			}
+			else
+				scan->compress_type[0] = '\0';     /* unknown */
+		}
+		else if (ini_slice_eq(key, "option-compress") && !scan->has_compress)
+		{
+			scan->has_compress = true;
+			scan->compress = ini_slice_eq(value, "true");
+		}
+		return true;
+	}
+
+	if (!ini_slice_eq(section, "target:file"))
+		return true;
+	scan->has_files = true;
+
+	/* Skip pg_wal entries — covered by WAL validation */
+	if (strncmp(rel_path, "pg_data/pg_wal/", 15) == 0 ||
+		strcmp(rel_path,  "pg_data/pg_wal")  == 0)
+		return true;
+
+	json_get_fields(value.ptr, file_fields, FILE_NFIELDS, v);
+	if (v[FILE_CHECKSUM].ptr == NULL)
+		return true;    /* no checksum field: zero-size or page-checksum file */
 
-	len = (size_t)(q - p);
-	if (len >= sizeof(buf))
-		len = sizeof(buf) - 1;
-	memcpy(buf, p, len);
-	buf[len] = '\0';
-	return buf;
+	if (v[FILE_REFERENCE].ptr != NULL && v[FILE_REFERENCE].len > 0 &&
+		memchr(v[FILE_REFERENCE].ptr, '/', v[FILE_REFERENCE].len) == NULL)
+	{
+		/* The stored copy is in the referenced backup, a sibling directory */
+		const char *sep = strrchr(scan->backup->backup_path, '/');
+		int         dir_len = sep != NULL ? (int) (sep - scan->backup->backup_path) + 1 : 0;
+
+		snprintf(file_path, sizeof(file_path), "%.*s%.*s/%s",
+				 dir_len, scan->backup->backup_path,
+				 (int) v[FILE_REFERENCE].len, v[FILE_REFERENCE].ptr, rel_path);
+	}
+	else
+		path_join(file_path, sizeof(file_path), scan->backup->backup_path, rel_path);
+	job = verify_job_list_add(scan->jobs, file_path, rel_path);
+	if (job == NULL)
+	{
+		scan->out_of_memory = true;
+		return false;
+	}
+	job->algorithm    = VERIFY_ALG_SHA1;
+	job->expected_hex = strndup(v[FILE_CHECKSUM].ptr, v[FILE_CHECKSUM].len);
+	if (job->expected_hex == NULL)
+	{
+		scan->out_of_memory = true;
+		return false;
+	}
+	if (json_slice_to_uint64(v[FILE_SIZE], &size))
+		job->expected_size = (int64_t) size;
+	return true;
 }
 
 /*
- * Compute SHA1 of a file.  Returns true on success.
- * We reuse our SHA256 infrastructure but pgbackrest uses SHA1 (40 hex chars).
- * Since we don't have a standalone SHA1 implementation, we shell out to
- * shasum/sha1sum — portable across macOS and Linux.
+ * Compression of the files in a pgBackRest backup, from backup.manifest:
+ * option-compress-type ("gz", "lz4", "zst", "bz2") in pgBackRest 2.x,
+ * or the older boolean option-compress (gzip).  Returns false for an
+ * unknown type.
  */
 static bool
-compute_file_sha1(const char *path, char *out_hex, size_t out_sz)
+manifest_compression(const ManifestScan *scan, CompressionType *type)
 {
-	/*
-	 * Try shasum -a 1 (macOS, also available on Linux via Perl)
-	 * then fall back to sha1sum (coreutils, Linux/FreeBSD).
-	 * Output format for both: "<40-hex-chars>  filename\n"
-	 */
-	static const char * const cmdfmt[] = {
-		"shasum -a 1 -- '%s' 2>/dev/null",
-		"sha1sum -- '%s' 2>/dev/null",
-		NULL
-	};
-	char   cmd[PATH_MAX + 32];
-	FILE  *fp;
-	char   line[256];
-	size_t len;
-	int    i;
-
-	if (out_sz < 41)
-		return false;
+	*type = COMPRESSION_NONE;
 
-	for (i = 0; cmdfmt[i] != NULL; i++)
+	if (!scan->has_compress_type)
 	{
-		snprintf(cmd, sizeof(cmd), cmdfmt[i], path);
-		fp = popen(cmd, "r");
-		if (fp == NULL)
-			continue;
+		if (scan->has_compress && scan->compress)
+			*type = COMPRESSION_GZIP;
+		return true;
+	}
+
+	return compression_from_name(scan->compress_type, type);
+}
 
-		line[0] = '\0';
-		if (fgets(line, sizeof(line), fp) == NULL)
-			line[0] = '\0';
-		pclose(fp);
+/*
+ * Compressed backups store each file as <name>.gz (or .lz4, .zst, .bz2);
+ * its checksum and size are of the original content, so the file is
+ * hashed as it is decompressed.  The size is only checked then.
+ */
+static bool
+apply_compression(VerifyJobList *jobs, CompressionType compression)
+{
+	const char *suffix = compression_suffix(compression);
 
-		/* Verify we got 40 hex chars */
-		len = 0;
-		while (len < 40 && line[len] != '\0' &&
-			   ((line[len] >= '0' && line[len] <= '9') ||
-				(line[len] >= 'a' && line[len] <= 'f') ||
-				(line[len] >= 'A' && line[len] <= 'F')))
-			len++;
+	for (int i = 0; i < jobs->count; i++)
+	{
+		VerifyJob *job = &jobs->jobs[i];
+		char      *path;
+		size_t     len;
 
-		if (len == 40)
+		if (compression == COMPRESSION_NONE)
 		{
-			memcpy(out_hex, line, 40);
-			out_hex[40] = '\0';
-			return true;
+			job->expected_size = -1;
+			continue;
 		}
-	}
 
-	return false;
+		len = strlen(job->path);
+		path = realloc(job->path, len + strlen(suffix) + 1);
+		if (path == NULL)
+			return false;
+		strcpy(path + len, suffix);
+		job->path        = path;
+		job->compression = compression;
+	}
+	return true;
 }
 
 ValidationResult *
@@ -329,11 +375,10 @@ pgbackrest_check_manifest_checksums(BackupInfo *backup)
 {
 	ValidationResult *result;
 	char              manifest_path[PATH_MAX];
-	IniFile          *ini;
-	IniSection       *section;
-	IniKeyValue      *kv;
-	char              msg[PATH_MAX + 128];
+	ManifestScan      scan;
+	VerifyJobList     jobs;
 	bool              is_plain;
+	CompressionType   compression;
 
 	if (backup == NULL || backup->backup_path[0] == '\0')
 		return NULL;
@@ -346,79 +391,62 @@ pgbackrest_check_manifest_checksums(BackupInfo *backup)
 	if (!file_exists(manifest_path))
 		return NULL;
 
-	/* Only plain backups: pg_data/ must be a real directory */
+	/* pg_data/ must be a real directory (files may be compressed inside) */
 	{
 		char pg_data[PATH_MAX];
 		path_join(pg_data, sizeof(pg_data), backup->backup_path, "pg_data");
 		is_plain = is_directory(pg_data);
 	}
 	if (!is_plain)
-		return NULL;   /* compressed — cannot check without unpacking */
-
-	ini = ini_parse_file(manifest_path);
-	if (ini == NULL)
-		return NULL;
+		return NULL;   /* archived pg_data — nothing to walk */
 
-	section = ini_get_section(ini, "target:file");
-	if (section == NULL)
+	/*
+	 * One streaming pass: only the jobs are kept, not the manifest.
+	 * Compression options may come after [target:file], so the jobs are
+	 * adjusted once the whole file is read.
+	 */
+	verify_job_list_init(&jobs, "pgBackRest manifest");
+	jobs.scope = backup->backup_id;
+	jobs.unreadable_warns = true;
+
+	memset(&scan, 0, sizeof(scan));
+	scan.backup = backup;
+	scan.jobs   = &jobs;
+	if (!ini_parse_stream(manifest_path, manifest_scan_entry, &scan) ||
+		!scan.has_files)
 	{
-		ini_free(ini);
+		verify_job_list_free(&jobs);
 		return NULL;
 	}
 
 	result = calloc(1, sizeof(ValidationResult));
 	if (result == NULL)
 	{
-		ini_free(ini);
+		verify_job_list_free(&jobs);
 		return NULL;
 	}
 	result->status = BACKUP_STATUS_OK;
 
-	for (kv = section->first_kv; kv != NULL; kv = kv->next)
+	if (!manifest_compression(&scan, &compression))
 	{
-		const char *rel_path  = kv->key;   /* e.g. "pg_data/PG_VERSION" */
-		const char *json      = kv->value;
-		const char *checksum;
-		char        file_path[PATH_MAX];
-		char        actual[41];
-
-		/* Skip pg_wal entries — covered by WAL validation */
-		if (strncmp(rel_path, "pg_data/pg_wal/", 15) == 0 ||
-			strcmp(rel_path,  "pg_data/pg_wal")  == 0)
-			continue;
-
-		checksum = extract_json_str(json, "checksum");
-		if (checksum == NULL)
-			continue;   /* no checksum field: zero-size or page-checksum file */
-
-		path_join(file_path, sizeof(file_path),
-				  backup->backup_path, rel_path);
-
-		if (!file_exists(file_path))
-		{
-			snprintf(msg, sizeof(msg), "Missing file: %s", rel_path);
-			add_error(result, msg);
-			continue;
-		}
-
-		if (!compute_file_sha1(file_path, actual, sizeof(actual)))
-		{
-			snprintf(msg, sizeof(msg),
-					 "Cannot compute SHA1 for: %s", rel_path);
-			add_warning(result, msg);
-			continue;
-		}
-
-		if (strcasecmp(actual, checksum) != 0)
-		{
-			snprintf(msg, sizeof(msg),
-					 "SHA1 mismatch: %s (expected %.16s…, got %.16s…)",
-					 rel_path, checksum, actual);
-			add_error(result, msg);
-		}
+		validation_add_warning(result,
+							   "Unsupported pgBackRest compression type, "
+							   "file checksums not verified");
+		verify_job_list_free(&jobs);
+		result->status = BACKUP_STATUS_WARNING;
+		return result;
 	}
+	if (compression != COMPRESSION_NONE)
+		log_debug("pgBackRest backup compressed (%s), decompressing with %s",
+				  compression_suffix(compression) + 1,
+				  compression_backend(compression));
+
+	if (scan.out_of_memory || !apply_compression(&jobs, compression))
+		validation_add_error(result, "Out of memory while reading backup.manifest");
 
-	ini_free(ini);
+	verify_jobs_run(&jobs, validation_get_jobs());
+	verify_jobs_merge(&jobs, result, NULL);
+	verify_job_list_free(&jobs);
 
 	if (result->error_count > 0)
 		result->status = BACKUP_STATUS_ERROR;
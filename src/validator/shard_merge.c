@@ -0,0 +1,569 @@
+/*
+ * shard_merge.c
+ *
+ * Combining the NDJSON parts of a sharded check into one report
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "shard_merge.h"
+#include "pg_backup_auditor.h"
+#include "json_scan.h"
+#include "validation_result.h"
+#include "verify_sample.h"
+#include "verify_shard.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Entries and findings by name.  An entry's slot holds its index; a
+ * finding's the number of times the merged result has it, and how often
+ * the part being read has reported it so far.  A finding repeated within
+ * one part is kept as often as the part that repeats it most.
+ */
+typedef struct {
+	char   *key;                /* NULL if free */
+	int     value;
+	int     part;               /* finding: the part 'seen' counts for */
+	int     seen;
+} MergeSlot;
+
+struct ShardMergeIndex {
+	MergeSlot  *slots;
+	size_t      capacity;       /* a power of two */
+	size_t      used;
+};
+
+#define MERGE_INDEX_MIN     256
+
+/* The slot of 'key', inserting it with 'value' if absent; NULL on OOM */
+static MergeSlot *
+index_slot(ShardMergeIndex *index, const char *key, int value)
+{
+	size_t mask;
+	size_t i;
+
+	if ((index->used + 1) * 2 > index->capacity)
+	{
+		size_t     capacity = index->capacity > 0 ? index->capacity * 2 : MERGE_INDEX_MIN;
+		MergeSlot *slots = calloc(capacity, sizeof(MergeSlot));
+
+		if (slots == NULL)
+			return NULL;
+		for (size_t j = 0; j < index->capacity; j++)
+		{
+			if (index->slots[j].key == NULL)
+				continue;
+			for (i = sample_key(index->slots[j].key) & (capacity - 1);
+				 slots[i].key != NULL; i = (i + 1) & (capacity - 1))
+				;
+			slots[i] = index->slots[j];
+		}
+		free(index->slots);
+		index->slots = slots;
+		index->capacity = capacity;
+	}
+
+	mask = index->capacity - 1;
+	for (i = sample_key(key) & mask; index->slots[i].key != NULL; i = (i + 1) & mask)
+		if (strcmp(index->slots[i].key, key) == 0)
+			return &index->slots[i];
+
+	index->slots[i].key = strdup(key);
+	if (index->slots[i].key == NULL)
+		return NULL;
+	index->slots[i].value = value;
+	index->slots[i].part = -1;
+	index->slots[i].seen = 0;
+	index->used++;
+	return &index->slots[i];
+}
+
+/* The slot of 'key', or NULL */
+static MergeSlot *
+index_find(const ShardMergeIndex *index, const char *key)
+{
+	size_t mask;
+
+	if (index->capacity == 0)
+		return NULL;
+	mask = index->capacity - 1;
+	for (size_t i = sample_key(key) & mask; index->slots[i].key != NULL; i = (i + 1) & mask)
+		if (strcmp(index->slots[i].key, key) == 0)
+			return &index->slots[i];
+	return NULL;
+}
+
+ShardMerge *
+shard_merge_create(void)
+{
+	ShardMerge *merge = calloc(1, sizeof(ShardMerge));
+
+	if (merge == NULL)
+		return NULL;
+	merge->index = calloc(1, sizeof(ShardMergeIndex));
+	if (merge->index == NULL)
+	{
+		free(merge);
+		return NULL;
+	}
+	merge->first = -1;
+	return merge;
+}
+
+void
+shard_merge_free(ShardMerge *merge)
+{
+	if (merge == NULL)
+		return;
+	for (int i = 0; i < merge->entry_count; i++)
+	{
+		free(merge->entries[i].record);
+		free(merge->entries[i].name);
+		validation_result_clear(&merge->entries[i].result);
+	}
+	free(merge->entries);
+	for (size_t i = 0; i < merge->index->capacity; i++)
+		free(merge->index->slots[i].key);
+	free(merge->index->slots);
+	free(merge->index);
+	free(merge->seen);
+	free(merge);
+}
+
+/* Members read from each record */
+enum {
+	F_RECORD, F_INDEX, F_COUNT, F_LEVEL, F_CATALOG,
+	F_BACKUP_ID, F_RESULT, F_ARCHIVE, F_CHECK, F_SEVERITY, F_CODE, F_MESSAGE,
+	F_STOPPED, F_SAMPLED_FILES, F_CHECKSUMMED_FILES, F_SAMPLED_WAL, F_WAL_SEGMENTS,
+	F_COUNT_OF
+};
+
+static const char *const fields[F_COUNT_OF] = {
+	"record", "index", "count", "level", "catalog",
+	"backup_id", "result", "archive", "check", "severity", "code", "message",
+	"stopped", "sampled_files", "checksummed_files", "sampled_wal_segments",
+	"wal_segments"
+};
+
+/* Parser state for one part */
+typedef struct {
+	ShardMerge *merge;
+	const char *name;
+	int         lineno;
+	int         part;           /* ordinal of the part, for finding counts */
+	int         last;           /* the part's previous entry, or -1 */
+	char       *buf;            /* unescaped strings; as long as the line */
+	char       *key;            /* index keys */
+} PartReader;
+
+static bool
+bad_record(const PartReader *reader, const char *what)
+{
+	fprintf(stderr, "Error: %s:%d: %s\n", reader->name, reader->lineno, what);
+	return false;
+}
+
+/* A string member into reader->buf + 'offset'; NULL if absent or null */
+static const char *
+string_field(PartReader *reader, JsonSlice value, size_t offset, size_t size)
+{
+	if (value.ptr == NULL || value.ptr[-1] != '"')
+		return NULL;
+	if (!json_slice_unescape(value, reader->buf + offset, size))
+		return NULL;
+	return reader->buf + offset;
+}
+
+/* The first record: which shard this part is, of which run */
+static bool
+read_shard_record(PartReader *reader, const JsonSlice *v, size_t len)
+{
+	ShardMerge *merge = reader->merge;
+	uint64_t    index = 0;
+	uint64_t    count = 0;
+	const char *level;
+	const char *catalog;
+
+	if (!json_slice_eq(v[F_RECORD], "shard"))
+	{
+		fprintf(stderr, "Error: %s: not the output of 'check --shard=K/N --format=ndjson'\n",
+				reader->name);
+		return false;
+	}
+	level = string_field(reader, v[F_LEVEL], 0, len + 1);
+	catalog = level != NULL ? string_field(reader, v[F_CATALOG], len + 1, len + 1) : NULL;
+	if (!json_slice_to_uint64(v[F_INDEX], &index) ||
+		!json_slice_to_uint64(v[F_COUNT], &count) ||
+		count < 1 || count > SHARD_MAX_COUNT || index < 1 || index > count ||
+		catalog == NULL)
+		return bad_record(reader, "malformed shard record");
+
+	if (merge->seen == NULL)
+	{
+		merge->seen = calloc((size_t) count, sizeof(bool));
+		if (merge->seen == NULL)
+		{
+			fprintf(stderr, "Error: Memory allocation failed\n");
+			return false;
+		}
+		merge->count = (int) count;
+		str_copy(merge->level, level, sizeof(merge->level));
+		str_copy(merge->catalog, catalog, sizeof(merge->catalog));
+	}
+	else if ((int) count != merge->count || strcmp(level, merge->level) != 0 ||
+			 strcmp(catalog, merge->catalog) != 0)
+	{
+		fprintf(stderr, "Error: %s: shard %d/%d of another run "
+				"(level %s, catalog %s; expected N=%d, level %s, catalog %s)\n",
+				reader->name, (int) index, (int) count, level, catalog,
+				merge->count, merge->level, merge->catalog);
+		return false;
+	}
+
+	if (merge->seen[index - 1])
+	{
+		fprintf(stderr, "Error: %s: shard %d/%d was already added\n",
+				reader->name, (int) index, merge->count);
+		return false;
+	}
+	merge->seen[index - 1] = true;
+	return true;
+}
+
+/*
+ * The entry named 'key', added after the part's previous entry if it is
+ * new.  -1 on OOM.
+ */
+static int
+part_entry(PartReader *reader, const char *key, ShardEntryKind kind,
+		   const char *line, const char *name)
+{
+	ShardMerge *merge = reader->merge;
+	MergeSlot  *slot = index_slot(merge->index, key, merge->entry_count);
+	ShardEntry *entry;
+	int         at;
+
+	if (slot == NULL)
+		return -1;
+	at = slot->value;
+	if (at < merge->entry_count)
+	{
+		reader->last = at;
+		return at;
+	}
+
+	if (merge->entry_count == merge->entry_capacity)
+	{
+		int         capacity = merge->entry_capacity > 0 ? merge->entry_capacity * 2 : 64;
+		ShardEntry *entries = realloc(merge->entries, sizeof(ShardEntry) * (size_t) capacity);
+
+		if (entries == NULL)
+		{
+			slot->value = -1;
+			return -1;
+		}
+		merge->entries = entries;
+		merge->entry_capacity = capacity;
+	}
+
+	entry = &merge->entries[at];
+	memset(entry, 0, sizeof(*entry));
+	entry->kind = kind;
+	entry->record = strdup(line);
+	entry->name = strdup(name != NULL ? name : "");
+	entry->result.status = BACKUP_STATUS_OK;
+	if (entry->record == NULL || entry->name == NULL)
+	{
+		free(entry->record);
+		free(entry->name);
+		slot->value = -1;
+		return -1;
+	}
+	merge->entry_count++;
+
+	if (reader->last >= 0)
+	{
+		entry->next = merge->entries[reader->last].next;
+		merge->entries[reader->last].next = at;
+	}
+	else
+	{
+		entry->next = merge->first;
+		merge->first = at;
+	}
+	reader->last = at;
+	return at;
+}
+
+/* A finding of entry 'at', unless an earlier part already gave it */
+static bool
+add_finding(PartReader *reader, int at, bool error, ValidationCode code,
+			const char *message)
+{
+	ShardEntry *entry = &reader->merge->entries[at];
+	MergeSlot  *slot;
+
+	snprintf(reader->key, strlen(message) + 32, "f%d\x1f%c\x1f%s",
+			 at, error ? 'e' : 'w', message);
+	slot = index_slot(reader->merge->index, reader->key, 0);
+	if (slot == NULL)
+		return false;
+	if (slot->part != reader->part)
+	{
+		slot->part = reader->part;
+		slot->seen = 0;
+	}
+	if (++slot->seen <= slot->value)
+		return true;
+	slot->value++;
+
+	if (error)
+	{
+		validation_add_error_code(&entry->result, code, message);
+		entry->result.status = BACKUP_STATUS_ERROR;
+	}
+	else
+		validation_add_warning(&entry->result, message);
+	return true;
+}
+
+/* One record after the first */
+static bool
+read_record(PartReader *reader, const JsonSlice *v, const char *line, size_t len)
+{
+	ShardMerge *merge = reader->merge;
+	JsonSlice   record = v[F_RECORD];
+	int         at = 0;
+
+	if (json_slice_eq(record, "chain"))
+	{
+		snprintf(reader->key, len + 32, "c%s", line);
+		at = part_entry(reader, reader->key, SHARD_ENTRY_CHAIN, line, NULL);
+	}
+	else if (json_slice_eq(record, "backup"))
+	{
+		const char *id = string_field(reader, v[F_BACKUP_ID], 0, len + 1);
+
+		if (id == NULL)
+			return bad_record(reader, "backup record without a backup_id");
+		snprintf(reader->key, len + 32, "b%s", id);
+		at = part_entry(reader, reader->key, SHARD_ENTRY_BACKUP, line, id);
+		if (at >= 0)
+			merge->entries[at].skipped = json_slice_eq(v[F_RESULT], "skipped");
+	}
+	else if (json_slice_eq(record, "wal_check"))
+	{
+		const char *archive = string_field(reader, v[F_ARCHIVE], 0, len + 1);
+		const char *check = string_field(reader, v[F_CHECK], len + 1, len + 1);
+
+		if (archive == NULL || check == NULL)
+			return bad_record(reader, "wal_check record without archive or check");
+		snprintf(reader->key, len + 32, "w%s\x1f%s", archive, check);
+		at = part_entry(reader, reader->key, SHARD_ENTRY_WAL_CHECK, line, archive);
+		if (at >= 0)
+			str_copy(merge->entries[at].check, check, sizeof(merge->entries[at].check));
+	}
+	else if (json_slice_eq(record, "finding"))
+	{
+		const char *id = string_field(reader, v[F_BACKUP_ID], 0, len + 1);
+		const char *archive = string_field(reader, v[F_ARCHIVE], len + 1, len + 1);
+		const char *check = string_field(reader, v[F_CHECK], 2 * (len + 1), len + 1);
+		const char *message = string_field(reader, v[F_MESSAGE], 3 * (len + 1), len + 1);
+		char        code_name[32] = "";
+		ValidationCode code = VALIDATION_CODE_OTHER;
+		MergeSlot  *slot;
+		bool        error = json_slice_eq(v[F_SEVERITY], "error");
+
+		if (message == NULL || (id == NULL && (archive == NULL || check == NULL)) ||
+			(!error && !json_slice_eq(v[F_SEVERITY], "warning")))
+			return bad_record(reader, "malformed finding record");
+		if (id != NULL)
+			snprintf(reader->key, len + 32, "b%s", id);
+		else
+			snprintf(reader->key, len + 32, "w%s\x1f%s", archive, check);
+		slot = index_find(merge->index, reader->key);
+		if (slot == NULL || slot->value < 0 || slot->value >= merge->entry_count)
+			return bad_record(reader, "finding for a backup or WAL check not reported before it");
+
+		/* Codes unknown to this version are kept as "other" */
+		if (json_slice_copy(v[F_CODE], code_name, sizeof(code_name)))
+			(void) validation_code_from_name(code_name, &code);
+		at = add_finding(reader, slot->value, error, code, message) ? 0 : -1;
+	}
+	else if (json_slice_eq(record, "summary"))
+	{
+		uint64_t n;
+
+		merge->stopped |= json_slice_eq(v[F_STOPPED], "true");
+		if (json_slice_to_uint64(v[F_SAMPLED_FILES], &n))
+		{
+			merge->sampled = true;
+			merge->sampled_files += n;
+		}
+		if (json_slice_to_uint64(v[F_CHECKSUMMED_FILES], &n))
+			merge->checksummed_files += n;
+		if (json_slice_to_uint64(v[F_SAMPLED_WAL], &n))
+			merge->sampled_wal_segments += n;
+		if (json_slice_to_uint64(v[F_WAL_SEGMENTS], &n))
+			merge->wal_segments += n;
+	}
+	/* Other records (there are none yet) are not merged */
+
+	if (at < 0)
+	{
+		fprintf(stderr, "Error: Memory allocation failed\n");
+		return false;
+	}
+	return true;
+}
+
+bool
+shard_merge_add(ShardMerge *merge, FILE *fp, const char *name)
+{
+	PartReader reader;
+	char      *line = NULL;
+	size_t     line_size = 0;
+	ssize_t    len;
+	size_t     buf_size = 0;
+	bool       header = false;
+	bool       summary = false;
+	bool       ok = true;
+
+	memset(&reader, 0, sizeof(reader));
+	reader.merge = merge;
+	reader.name = name;
+	reader.part = merge->parts;
+	reader.last = -1;
+
+	while (ok && (len = getline(&line, &line_size, fp)) >= 0)
+	{
+		JsonSlice v[F_COUNT_OF];
+
+		reader.lineno++;
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+		if (len == 0)
+			continue;
+
+		/* Room for four unescaped strings of the line, and for a key */
+		if ((size_t) len > buf_size)
+		{
+			char *buf = realloc(reader.buf, 4 * ((size_t) len + 1));
+			char *key = realloc(reader.key, (size_t) len + 32);
+
+			if (buf != NULL)
+				reader.buf = buf;
+			if (key != NULL)
+				reader.key = key;
+			if (buf == NULL || key == NULL)
+			{
+				fprintf(stderr, "Error: Memory allocation failed\n");
+				ok = false;
+				break;
+			}
+			buf_size = (size_t) len;
+		}
+
+		if (!json_get_fields(line, fields, F_COUNT_OF, v) || v[F_RECORD].ptr == NULL)
+			ok = bad_record(&reader, "not an NDJSON record");
+		else if (!header)
+		{
+			ok = read_shard_record(&reader, v, (size_t) len);
+			header = true;
+		}
+		else if (summary && json_slice_eq(v[F_RECORD], "shard"))
+		{
+			/* The next of several parts written one after another */
+			reader.part = ++merge->parts;
+			reader.last = -1;
+			summary = false;
+			ok = read_shard_record(&reader, v, (size_t) len);
+		}
+		else if (summary)
+			ok = bad_record(&reader, "record after the summary");
+		else
+		{
+			summary = json_slice_eq(v[F_RECORD], "summary");
+			ok = read_record(&reader, v, line, (size_t) len);
+		}
+	}
+
+	if (ok && ferror(fp))
+	{
+		fprintf(stderr, "Error: Cannot read %s: %s\n", name, strerror(errno));
+		ok = false;
+	}
+	else if (ok && !header)
+	{
+		fprintf(stderr, "Error: %s: empty, not a shard part\n", name);
+		ok = false;
+	}
+	else if (ok && !summary)
+	{
+		fprintf(stderr, "Error: %s: no summary record; the shard run did not finish\n",
+				name);
+		ok = false;
+	}
+
+	free(line);
+	free(reader.buf);
+	free(reader.key);
+	if (ok)
+		merge->parts++;
+	return ok;
+}
+
+bool
+shard_merge_complete(const ShardMerge *merge)
+{
+	bool complete = merge->count > 0;
+
+	for (int i = 0; i < merge->count; i++)
+	{
+		if (merge->seen[i])
+			continue;
+		fprintf(stderr, "Error: Shard %d/%d is missing\n", i + 1, merge->count);
+		complete = false;
+	}
+	return complete;
+}
+
+void
+shard_merge_totals(const ShardMerge *merge, ShardMergeTotals *totals)
+{
+	memset(totals, 0, sizeof(*totals));
+	for (int i = 0; i < merge->entry_count; i++)
+	{
+		const ShardEntry *entry = &merge->entries[i];
+
+		if (entry->kind == SHARD_ENTRY_BACKUP)
+		{
+			totals->backups_found++;
+			if (entry->skipped)
+				totals->backups_skipped++;
+			else
+				totals->backups_validated++;
+			totals->errors += entry->result.error_count;
+			totals->warnings += entry->result.warning_count;
+		}
+		else if (entry->kind == SHARD_ENTRY_WAL_CHECK)
+			totals->errors += entry->result.error_count;
+	}
+}
@@ -0,0 +1,351 @@
+/*
+ * validation_result.c
+ *
+ * Message storage for ValidationResult
+ *
+ * Messages are copied into arena blocks that start small (most results
+ * hold a message or two) and double up to VALIDATION_ARENA_BLOCK_MAX.
+ * A result is freed by walking its block chain, never per message.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pg_backup_auditor.h"
+#include "validation_result.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VALIDATION_ARENA_BLOCK_MIN  256
+#define VALIDATION_ARENA_BLOCK_MAX  (64 * 1024)
+
+struct ValidationArenaBlock {
+	ValidationArenaBlock *next;
+	size_t                size;
+	size_t                used;
+	char                  data[];
+};
+
+/* Fail-fast: set once, read by every validation thread */
+static bool fail_fast = false;
+static bool stop_requested = false;
+
+/* Stands in for a message that could not be stored */
+static char oom_message[] = "Error: Memory allocation failed";
+
+static const char *const code_names[VALIDATION_CODE_COUNT] = {
+	"other",
+	"missing_file",
+	"size_mismatch",
+	"checksum_mismatch",
+	"corrupt_file",
+	"unreadable",
+	"missing_wal"
+};
+
+static char *
+arena_strdup(ValidationResult *result, const char *message)
+{
+	ValidationArenaBlock *block = result->arena;
+	size_t                len = strlen(message) + 1;
+
+	if (block == NULL || block->size - block->used < len)
+	{
+		size_t size = block != NULL ? block->size * 2 : VALIDATION_ARENA_BLOCK_MIN;
+
+		if (size > VALIDATION_ARENA_BLOCK_MAX)
+			size = VALIDATION_ARENA_BLOCK_MAX;
+		if (size < len)
+			size = len;
+
+		block = malloc(sizeof(ValidationArenaBlock) + size);
+		if (block == NULL)
+			return oom_message;
+		block->next = result->arena;
+		block->size = size;
+		block->used = 0;
+		result->arena = block;
+	}
+
+	memcpy(block->data + block->used, message, len);
+	block->used += len;
+	return block->data + block->used - len;
+}
+
+/* Make room for 'extra' more entries, doubling the capacity */
+static bool
+grow_array(char ***array, uint8_t **codes, int *capacity, int count, int extra)
+{
+	int    nc = *capacity;
+	char **na;
+
+	if (count + extra <= nc)
+		return true;
+	if (nc == 0)
+		nc = 8;
+	while (nc < count + extra)
+		nc *= 2;
+
+	na = realloc(*array, sizeof(char *) * (size_t) nc);
+	if (na == NULL)
+		return false;
+	*array = na;
+
+	if (codes != NULL)
+	{
+		uint8_t *nk = realloc(*codes, (size_t) nc);
+
+		if (nk == NULL)
+			return false;
+		*codes = nk;
+	}
+
+	*capacity = nc;
+	return true;
+}
+
+void
+validation_add_error_code(ValidationResult *result, ValidationCode code,
+						  const char *message)
+{
+	if (result == NULL || message == NULL)
+		return;
+	if ((unsigned) code >= VALIDATION_CODE_COUNT)
+		code = VALIDATION_CODE_OTHER;
+
+	if (!grow_array(&result->errors, &result->error_codes,
+					&result->error_capacity, result->error_count, 1))
+		return;
+
+	result->errors[result->error_count] = arena_strdup(result, message);
+	result->error_codes[result->error_count] = (uint8_t) code;
+	result->error_count++;
+	result->code_counts[code]++;
+
+	if (fail_fast)
+		validation_request_stop();
+}
+
+void
+validation_add_error(ValidationResult *result, const char *message)
+{
+	validation_add_error_code(result, VALIDATION_CODE_OTHER, message);
+}
+
+void
+validation_set_fail_fast(bool enabled)
+{
+	fail_fast = enabled;
+	__atomic_store_n(&stop_requested, false, __ATOMIC_RELAXED);
+}
+
+bool
+validation_fail_fast(void)
+{
+	return fail_fast;
+}
+
+void
+validation_request_stop(void)
+{
+	__atomic_store_n(&stop_requested, true, __ATOMIC_RELAXED);
+}
+
+bool
+validation_stop_requested(void)
+{
+	return __atomic_load_n(&stop_requested, __ATOMIC_RELAXED);
+}
+
+void
+validation_add_warning(ValidationResult *result, const char *message)
+{
+	if (result == NULL || message == NULL)
+		return;
+
+	if (!grow_array(&result->warnings, NULL,
+					&result->warning_capacity, result->warning_count, 1))
+		return;
+
+	result->warnings[result->warning_count] = arena_strdup(result, message);
+	result->warning_count++;
+}
+
+void
+validation_result_append(ValidationResult *dst, const ValidationResult *src)
+{
+	if (dst == NULL || src == NULL || dst == src)
+		return;
+
+	for (int i = 0; i < src->error_count; i++)
+		validation_add_error_code(dst, (ValidationCode) src->error_codes[i],
+								  src->errors[i]);
+	for (int i = 0; i < src->warning_count; i++)
+		validation_add_warning(dst, src->warnings[i]);
+}
+
+/* Append src's entries to dst's, or take src's arrays if dst has none */
+static bool
+move_entries(char ***dst, uint8_t **dst_codes, int *dst_capacity, int *dst_count,
+			 char ***src, uint8_t **src_codes, int *src_capacity, int *src_count)
+{
+	if (*src_count == 0)
+		return true;
+
+	if (*dst_count == 0)
+	{
+		free(*dst);
+		*dst = *src;
+		*dst_capacity = *src_capacity;
+		if (dst_codes != NULL)
+		{
+			free(*dst_codes);
+			*dst_codes = *src_codes;
+			*src_codes = NULL;
+		}
+	}
+	else
+	{
+		if (!grow_array(dst, dst_codes, dst_capacity, *dst_count, *src_count))
+			return false;
+		memcpy(*dst + *dst_count, *src, sizeof(char *) * (size_t) *src_count);
+		if (dst_codes != NULL)
+			memcpy(*dst_codes + *dst_count, *src_codes, (size_t) *src_count);
+		free(*src);
+		if (src_codes != NULL)
+		{
+			free(*src_codes);
+			*src_codes = NULL;
+		}
+	}
+
+	*dst_count += *src_count;
+	*src = NULL;
+	*src_capacity = 0;
+	*src_count = 0;
+	return true;
+}
+
+void
+validation_result_merge(ValidationResult *dst, ValidationResult *src)
+{
+	ValidationArenaBlock *tail;
+
+	if (dst == NULL || src == NULL || dst == src)
+		return;
+
+	/*
+	 * Link src's blocks in behind dst's current one, which keeps taking
+	 * new messages.  This comes first: if an array cannot be moved, its
+	 * messages are lost, but nothing left in src points into freed text.
+	 */
+	if (src->arena != NULL)
+	{
+		if (dst->arena == NULL)
+			dst->arena = src->arena;
+		else
+		{
+			for (tail = src->arena; tail->next != NULL; tail = tail->next)
+				;
+			tail->next = dst->arena->next;
+			dst->arena->next = src->arena;
+		}
+		src->arena = NULL;
+	}
+
+	if (move_entries(&dst->errors, &dst->error_codes, &dst->error_capacity,
+					 &dst->error_count,
+					 &src->errors, &src->error_codes, &src->error_capacity,
+					 &src->error_count))
+	{
+		for (int c = 0; c < VALIDATION_CODE_COUNT; c++)
+		{
+			dst->code_counts[c] += src->code_counts[c];
+			src->code_counts[c] = 0;
+		}
+	}
+	else
+		log_error("Memory allocation failed");
+
+	if (!move_entries(&dst->warnings, NULL, &dst->warning_capacity,
+					  &dst->warning_count,
+					  &src->warnings, NULL, &src->warning_capacity,
+					  &src->warning_count))
+		log_error("Memory allocation failed");
+}
+
+void
+validation_result_clear(ValidationResult *result)
+{
+	ValidationArenaBlock *block, *next;
+
+	if (result == NULL)
+		return;
+
+	for (block = result->arena; block != NULL; block = next)
+	{
+		next = block->next;
+		free(block);
+	}
+	free(result->errors);
+	free(result->error_codes);
+	free(result->warnings);
+
+	result->arena = NULL;
+	result->errors = NULL;
+	result->error_codes = NULL;
+	result->warnings = NULL;
+	result->error_count = 0;
+	result->warning_count = 0;
+	result->error_capacity = 0;
+	result->warning_capacity = 0;
+	memset(result->code_counts, 0, sizeof(result->code_counts));
+}
+
+/* ------------------------------------------------------------------ *
+ * free_validation_result
+ * ------------------------------------------------------------------ */
+void
+free_validation_result(ValidationResult *result)
+{
+	if (result == NULL)
+		return;
+
+	validation_result_clear(result);
+	free(result);
+}
+
+const char *
+validation_code_name(ValidationCode code)
+{
+	if ((unsigned) code >= VALIDATION_CODE_COUNT)
+		return code_names[VALIDATION_CODE_OTHER];
+	return code_names[code];
+}
+
+bool
+validation_code_from_name(const char *name, ValidationCode *code)
+{
+	for (int i = 0; i < VALIDATION_CODE_COUNT; i++)
+	{
+		if (strcmp(code_names[i], name) == 0)
+		{
+			*code = (ValidationCode) i;
+			return true;
+		}
+	}
+	return false;
+}
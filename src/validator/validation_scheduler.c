@@ -0,0 +1,191 @@
+/*
+ * validation_scheduler.c
+ *
+ * Backup-level parallel validation
+ *
+ * Tasks move from pending to running to done under one lock.  Workers
+ * take the first pending task; a thread waiting for a pending result
+ * runs that task itself rather than sleep, so results are consumed in
+ * order without idling the caller.  All tasks share one ValidationMemo,
+ * so a backup that is an ancestor of many others is validated once.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "validation_scheduler.h"
+#include "validation_result.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+typedef enum {
+	TASK_PENDING = 0,
+	TASK_RUNNING,
+	TASK_DONE
+} TaskState;
+
+struct ValidationScheduler {
+	ValidationTask  *tasks;
+	TaskState       *state;
+	int              count;
+	int              next;          /* no pending task below this */
+	BackupInfo      *all_backups;
+	ValidationLevel  level;
+	ValidationMemo  *memo;          /* shared by all tasks; NULL = none */
+
+	pthread_mutex_t  lock;
+	pthread_cond_t   done;          /* a task finished */
+	pthread_t       *threads;
+	int              started;
+};
+
+static void
+run_task(ValidationScheduler *sched, int index)
+{
+	ValidationTask   *task = &sched->tasks[index];
+	ValidationResult *result = NULL;
+
+	/* After a fail-fast stop, tasks not yet started are dropped */
+	if (!validation_stop_requested())
+		result = validate_backup_chain_memo(task->backup, sched->all_backups,
+											task->wal_info, sched->level,
+											sched->memo);
+
+	pthread_mutex_lock(&sched->lock);
+	task->result = result;
+	sched->state[index] = TASK_DONE;
+	pthread_cond_broadcast(&sched->done);
+	pthread_mutex_unlock(&sched->lock);
+}
+
+static void *
+scheduler_worker(void *arg)
+{
+	ValidationScheduler *sched = arg;
+
+	for (;;)
+	{
+		int index;
+
+		pthread_mutex_lock(&sched->lock);
+		while (sched->next < sched->count &&
+			   sched->state[sched->next] != TASK_PENDING)
+			sched->next++;
+		index = sched->next;
+		if (index < sched->count)
+			sched->state[index] = TASK_RUNNING;
+		pthread_mutex_unlock(&sched->lock);
+
+		if (index >= sched->count)
+			break;
+		run_task(sched, index);
+	}
+	return NULL;
+}
+
+ValidationScheduler *
+validation_scheduler_start(ValidationTask *tasks, int count,
+						   BackupInfo *all_backups, ValidationLevel level)
+{
+	ValidationScheduler *sched;
+	int                  workers;
+
+	sched = calloc(1, sizeof(ValidationScheduler));
+	if (sched == NULL)
+		return NULL;
+	sched->state = calloc(count > 0 ? (size_t) count : 1, sizeof(TaskState));
+	if (sched->state == NULL)
+	{
+		free(sched);
+		return NULL;
+	}
+	sched->tasks       = tasks;
+	sched->count       = count;
+	sched->all_backups = all_backups;
+	sched->level       = level;
+	sched->memo        = validation_memo_create();  /* optional */
+	pthread_mutex_init(&sched->lock, NULL);
+	pthread_cond_init(&sched->done, NULL);
+
+	for (int i = 0; i < count; i++)
+		tasks[i].result = NULL;
+
+	/* The caller's thread is one of the jobs */
+	workers = validation_get_jobs() - 1;
+	if (workers > count - 1)
+		workers = count - 1;
+	if (workers > 0)
+		sched->threads = malloc(sizeof(pthread_t) * (size_t) workers);
+	if (sched->threads != NULL)
+	{
+		for (int t = 0; t < workers; t++)
+		{
+			if (pthread_create(&sched->threads[sched->started], NULL,
+							   scheduler_worker, sched) != 0)
+				break;
+			sched->started++;
+		}
+	}
+
+	log_debug("Validating %d backup%s on %d thread(s)",
+			  count, count == 1 ? "" : "s", sched->started + 1);
+	return sched;
+}
+
+ValidationResult *
+validation_scheduler_wait(ValidationScheduler *sched, int index)
+{
+	ValidationResult *result;
+
+	if (sched == NULL || index < 0 || index >= sched->count)
+		return NULL;
+
+	pthread_mutex_lock(&sched->lock);
+	if (sched->state[index] == TASK_PENDING)
+	{
+		sched->state[index] = TASK_RUNNING;
+		pthread_mutex_unlock(&sched->lock);
+		run_task(sched, index);
+		pthread_mutex_lock(&sched->lock);
+	}
+	while (sched->state[index] != TASK_DONE)
+		pthread_cond_wait(&sched->done, &sched->lock);
+	result = sched->tasks[index].result;
+	pthread_mutex_unlock(&sched->lock);
+
+	return result;
+}
+
+void
+validation_scheduler_finish(ValidationScheduler *sched)
+{
+	if (sched == NULL)
+		return;
+
+	/* Anything not yet collected still has to run before the workers stop */
+	for (int i = 0; i < sched->count; i++)
+		validation_scheduler_wait(sched, i);
+
+	for (int t = 0; t < sched->started; t++)
+		pthread_join(sched->threads[t], NULL);
+	free(sched->threads);
+	pthread_cond_destroy(&sched->done);
+	pthread_mutex_destroy(&sched->lock);
+	validation_memo_free(sched->memo);
+	free(sched->state);
+	free(sched);
+}
@@ -0,0 +1,1263 @@
+/*
+ * verify_jobs.c
+ *
+ * Parallel per-file verification engine shared by the manifest checkers
+ * (pg_probackup backup_content.control, pg_basebackup backup_manifest,
+ * pgBackRest backup.manifest).
+ *
+ * Workers claim jobs from a shared counter, check presence, size and
+ * digest of one file each, and store the outcome in the job.  Nothing
+ * is written to a ValidationResult until verify_jobs_merge(), which runs
+ * on the calling thread and walks the list in order.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "verify_jobs.h"
+#include "validation_result.h"
+#include "buffer_pool.h"
+#include "sha256.h"
+#include "sha1.h"
+#include "crc32c.h"
+#include "tar_reader.h"
+#include "decompress.h"
+#include "async_read.h"
+#include "verify_sample.h"
+#include "verify_shard.h"
+#include "digest_cache.h"
+#include "metrics.h"
+#include "incremental_backup.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+/* Emit a progress line every this many files */
+#define VERIFY_PROGRESS_STEP 1000
+
+/* Buffer for decompressed and tar member data, from the buffer pool */
+#define VERIFY_CHUNK_SIZE    (64 * 1024)
+
+static int validation_jobs = DEFAULT_THREADS;
+
+/* How plain files are read for digests; see validation_set_io_engine() */
+typedef enum {
+	IO_ENGINE_AUTO,             /* io_uring where the kernel has it */
+	IO_ENGINE_SYNC              /* one blocking read loop per worker */
+} IoEngine;
+
+static IoEngine io_engine = IO_ENGINE_AUTO;
+
+/*
+ * Set the number of worker threads used for file checksum verification.
+ * Values below 1 are treated as 1.
+ */
+void
+validation_set_jobs(int jobs)
+{
+	validation_jobs = (jobs < 1) ? 1 : jobs;
+}
+
+int
+validation_get_jobs(void)
+{
+	return validation_jobs;
+}
+
+/*
+ * Select the read engine: "auto" (io_uring if available, the default),
+ * "io_uring" (the same, with a warning if it is not available) or
+ * "sync".  Returns false for an unknown name.
+ */
+bool
+validation_set_io_engine(const char *name)
+{
+	if (strcmp(name, "sync") == 0)
+		io_engine = IO_ENGINE_SYNC;
+	else if (strcmp(name, "auto") == 0)
+		io_engine = IO_ENGINE_AUTO;
+	else if (strcmp(name, "io_uring") == 0)
+	{
+		io_engine = IO_ENGINE_AUTO;
+		if (!async_read_supported())
+			log_warning("io_uring is not available; using synchronous reads");
+	}
+	else
+		return false;
+	return true;
+}
+
+/*
+ * Process-wide budget of files being read at once.  Several validations
+ * may run side by side (one per backup, see validation_scheduler.c), each
+ * with its own worker threads; readers take a slot here so that together
+ * they keep at most validation_get_jobs() files in flight.
+ */
+static pthread_mutex_t io_lock  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  io_slots = PTHREAD_COND_INITIALIZER;
+static int             io_in_flight = 0;
+
+void
+validation_io_acquire(void)
+{
+	pthread_mutex_lock(&io_lock);
+	while (io_in_flight >= validation_jobs)
+		pthread_cond_wait(&io_slots, &io_lock);
+	io_in_flight++;
+	pthread_mutex_unlock(&io_lock);
+}
+
+void
+validation_io_release(void)
+{
+	pthread_mutex_lock(&io_lock);
+	io_in_flight--;
+	pthread_cond_signal(&io_slots);
+	pthread_mutex_unlock(&io_lock);
+}
+
+/* ------------------------------------------------------------------ *
+ * Job list
+ * ------------------------------------------------------------------ */
+
+void
+verify_job_list_init(VerifyJobList *list, const char *label)
+{
+	memset(list, 0, sizeof(*list));
+	list->label = label;
+}
+
+/*
+ * Append a job for 'path' (reported as 'name').  The job starts as a
+ * presence check; callers fill in expected_size, algorithm and digest.
+ * Returns NULL on allocation failure.
+ */
+VerifyJob *
+verify_job_list_add(VerifyJobList *list, const char *path, const char *name)
+{
+	VerifyJob *job;
+
+	if (list->count == list->capacity)
+	{
+		int        nc = list->capacity ? list->capacity * 2 : 256;
+		VerifyJob *nj = realloc(list->jobs, sizeof(VerifyJob) * nc);
+		if (nj == NULL)
+			return NULL;
+		list->jobs     = nj;
+		list->capacity = nc;
+	}
+
+	job = &list->jobs[list->count];
+	memset(job, 0, sizeof(*job));
+	job->path = strdup(path);
+	job->name = strdup(name);
+	job->expected_size = -1;
+	if (job->path == NULL || job->name == NULL)
+	{
+		free(job->path);
+		free(job->name);
+		return NULL;
+	}
+
+	list->count++;
+	return job;
+}
+
+void
+verify_job_list_free(VerifyJobList *list)
+{
+	if (list == NULL)
+		return;
+
+	for (int i = 0; i < list->count; i++)
+	{
+		free(list->jobs[i].path);
+		free(list->jobs[i].name);
+		free(list->jobs[i].expected_hex);
+		free(list->jobs[i].message);
+	}
+	free(list->jobs);
+	list->jobs     = NULL;
+	list->count    = 0;
+	list->capacity = 0;
+}
+
+/* ------------------------------------------------------------------ *
+ * Digests
+ * ------------------------------------------------------------------ */
+
+static const char *
+algorithm_name(VerifyAlgorithm alg)
+{
+	switch (alg)
+	{
+		case VERIFY_ALG_CRC32C: return "CRC32C";
+		case VERIFY_ALG_SHA256: return "SHA256";
+		case VERIFY_ALG_SHA1:   return "SHA1";
+		case VERIFY_ALG_PAGES:  return "page";
+		default:                return "NONE";
+	}
+}
+
+/* ------------------------------------------------------------------ *
+ * Worker
+ * ------------------------------------------------------------------ */
+
+static void
+job_finish(VerifyJob *job, VerifyOutcome outcome, const char *message)
+{
+	job->outcome = outcome;
+	if (message != NULL)
+		job->message = strdup(message);
+}
+
+static void
+job_fail(VerifyJob *job, ValidationCode code, const char *message)
+{
+	job->code = code;
+	job_finish(job, VERIFY_FAILED, message);
+	if (validation_fail_fast())
+		validation_request_stop();
+}
+
+/*
+ * Compare a computed digest with the job's expected one and finish the
+ * job.  'crc' is used for VERIFY_ALG_CRC32C, 'hex' for the SHA family.
+ */
+static void
+job_check_digest(VerifyJob *job, uint32_t crc, const char *hex)
+{
+	char msg[PATH_MAX + 192];
+
+	if (job->algorithm == VERIFY_ALG_CRC32C)
+	{
+		if (crc != job->expected_crc)
+		{
+			snprintf(msg, sizeof(msg),
+					 "CRC32C mismatch: %s (expected %08X, got %08X)",
+					 job->name, job->expected_crc, crc);
+			job_fail(job, VALIDATION_CODE_CHECKSUM_MISMATCH, msg);
+			return;
+		}
+	}
+	else if (job->algorithm != VERIFY_ALG_NONE)
+	{
+		if (job->expected_hex == NULL ||
+			strcasecmp(hex, job->expected_hex) != 0)
+		{
+			snprintf(msg, sizeof(msg),
+					 "%s mismatch: %s (expected %.16s..., got %.16s...)",
+					 algorithm_name(job->algorithm), job->name,
+					 job->expected_hex ? job->expected_hex : "", hex);
+			job_fail(job, VALIDATION_CODE_CHECKSUM_MISMATCH, msg);
+			return;
+		}
+	}
+
+	job_finish(job, VERIFY_OK, NULL);
+}
+
+static void
+job_unreadable(VerifyJob *job)
+{
+	char msg[PATH_MAX + 64];
+
+	snprintf(msg, sizeof(msg), "Cannot read file for checksum: %s",
+			 job->name);
+	job->code = VALIDATION_CODE_UNREADABLE;
+	job_finish(job, VERIFY_UNREADABLE, msg);
+}
+
+static void
+job_missing(VerifyJob *job)
+{
+	char msg[PATH_MAX + 32];
+
+	if (job->flags & VERIFY_SKIP_IF_MISSING)
+	{
+		job_finish(job, VERIFY_SKIPPED, NULL);
+		return;
+	}
+	snprintf(msg, sizeof(msg), "Missing file: %s", job->name);
+	job_fail(job, VALIDATION_CODE_MISSING_FILE, msg);
+}
+
+static void
+job_size_mismatch(VerifyJob *job, long long actual_size)
+{
+	char msg[PATH_MAX + 96];
+
+	snprintf(msg, sizeof(msg),
+			 "Size mismatch for %s: stored=%lld, actual=%lld",
+			 job->name, (long long) job->expected_size, actual_size);
+	job_fail(job, VALIDATION_CODE_SIZE_MISMATCH, msg);
+}
+
+/* Report the first bad page found by the walk, which is released */
+static void
+job_check_pages(VerifyJob *job, PageWalk *walk)
+{
+	char msg[PATH_MAX + 192];
+	char more[64] = "";
+
+	if (page_walk_finish(walk))
+	{
+		job_finish(job, VERIFY_OK, NULL);
+		return;
+	}
+
+	if (walk->out_of_memory)
+	{
+		snprintf(msg, sizeof(msg), "Out of memory while checking pages of %s",
+				 job->name);
+		job_fail(job, VALIDATION_CODE_OTHER, msg);
+		return;
+	}
+
+	if (walk->bad_pages > 1)
+		snprintf(more, sizeof(more), " and %llu more",
+				 (unsigned long long) (walk->bad_pages - 1));
+
+	if (walk->bad_status == PAGE_BAD_CHECKSUM)
+	{
+		snprintf(msg, sizeof(msg),
+				 "Page checksum mismatch in block %u of %s (stored %04X, computed %04X)%s",
+				 walk->bad_block, job->name, walk->bad_stored, walk->bad_computed,
+				 more);
+		job_fail(job, VALIDATION_CODE_CHECKSUM_MISMATCH, msg);
+	}
+	else
+	{
+		snprintf(msg, sizeof(msg), "Invalid page header in block %u of %s%s",
+				 walk->bad_block, job->name, more);
+		job_fail(job, VALIDATION_CODE_CORRUPT_FILE, msg);
+	}
+}
+
+/* Report an incremental file whose header does not hold together */
+static void
+job_check_incremental(VerifyJob *job, const IncrementalWalk *walk)
+{
+	char msg[PATH_MAX + 224];
+
+	snprintf(msg, sizeof(msg), "Invalid incremental file %s: %s",
+			 job->name, walk->problem);
+	job_fail(job, VALIDATION_CODE_CORRUPT_FILE, msg);
+}
+
+/* True if the job's content has to be read, not just its presence */
+static bool
+job_reads_content(const VerifyJob *job)
+{
+	return job->algorithm != VERIFY_ALG_NONE || (job->flags & VERIFY_INCREMENTAL);
+}
+
+/* ------------------------------------------------------------------ *
+ * Streaming digests (tar members, compressed files)
+ * ------------------------------------------------------------------ */
+
+typedef struct {
+	VerifyAlgorithm alg;
+	uint32_t        crc;
+	SHA256Ctx       sha256;
+	SHA1Ctx         sha1;
+	PageWalk        pages;
+	bool            incremental;    /* VERIFY_INCREMENTAL: 'incr' is fed too */
+	IncrementalWalk incr;
+	uint64_t        bytes;          /* for metrics.h */
+	uint64_t        started;
+} DigestCtx;
+
+static void
+digest_begin(DigestCtx *dc, const VerifyJob *job)
+{
+	dc->alg = job->algorithm;
+	dc->crc = ~0U;
+	dc->bytes = 0;
+	dc->started = metrics_clock();
+	if (dc->alg == VERIFY_ALG_SHA256)
+		sha256_init(&dc->sha256);
+	else if (dc->alg == VERIFY_ALG_SHA1)
+		sha1_init(&dc->sha1);
+	else if (dc->alg == VERIFY_ALG_PAGES)
+		page_walk_init(&dc->pages, job->pages, job->first_block);
+	dc->incremental = (job->flags & VERIFY_INCREMENTAL) != 0;
+	if (dc->incremental)
+		incremental_walk_init(&dc->incr);
+}
+
+/* A digest that will not be checked: release what it holds */
+static void
+digest_discard(DigestCtx *dc)
+{
+	if (dc->alg == VERIFY_ALG_PAGES)
+		page_walk_finish(&dc->pages);
+}
+
+static void
+digest_update(DigestCtx *dc, const uint8_t *buf, size_t len)
+{
+	dc->bytes += len;
+	if (dc->incremental)
+		incremental_walk_update(&dc->incr, buf, len);
+	switch (dc->alg)
+	{
+		case VERIFY_ALG_CRC32C:
+			dc->crc = crc32c_update(dc->crc, buf, len);
+			break;
+		case VERIFY_ALG_SHA256:
+			sha256_update(&dc->sha256, buf, len);
+			break;
+		case VERIFY_ALG_SHA1:
+			sha1_update(&dc->sha1, buf, len);
+			break;
+		case VERIFY_ALG_PAGES:
+			page_walk_update(&dc->pages, buf, len);
+			break;
+		default:
+			break;
+	}
+}
+
+/* Finalize the digest and compare it with the job's expected value */
+static void
+digest_check(DigestCtx *dc, VerifyJob *job)
+{
+	static const MetricAlgorithm metric_alg[] = {
+		[VERIFY_ALG_CRC32C] = METRIC_ALG_CRC32C,
+		[VERIFY_ALG_SHA256] = METRIC_ALG_SHA256,
+		[VERIFY_ALG_SHA1]   = METRIC_ALG_SHA1,
+		[VERIFY_ALG_PAGES]  = METRIC_ALG_PAGE
+	};
+
+	if (dc->alg != VERIFY_ALG_NONE)
+		metrics_verified(metric_alg[dc->alg], METRIC_TARGET_FILE, dc->bytes,
+						 metrics_clock() - dc->started);
+
+	/* A malformed header says more than the digest would */
+	if (dc->incremental && !incremental_walk_finish(&dc->incr))
+	{
+		digest_discard(dc);
+		job_check_incremental(job, &dc->incr);
+		return;
+	}
+
+	switch (dc->alg)
+	{
+		case VERIFY_ALG_CRC32C:
+		{
+			uint32_t crc = ~dc->crc;
+
+			if (job->has_identity)
+				digest_cache_store(&job->identity, (const uint8_t *) &crc,
+								   sizeof(crc), (int64_t) dc->bytes);
+			job_check_digest(job, crc, NULL);
+			break;
+		}
+
+		case VERIFY_ALG_SHA256:
+		{
+			uint8_t digest[SHA256_DIGEST_LENGTH];
+			char    hex[SHA256_HEX_LENGTH + 1];
+
+			sha256_final(&dc->sha256, digest);
+			if (job->has_identity)
+				digest_cache_store(&job->identity, digest, sizeof(digest),
+								   (int64_t) dc->bytes);
+			sha256_to_hex(digest, hex);
+			job_check_digest(job, 0, hex);
+			break;
+		}
+
+		case VERIFY_ALG_SHA1:
+		{
+			uint8_t digest[SHA1_DIGEST_LENGTH];
+			char    hex[SHA1_HEX_LENGTH + 1];
+
+			sha1_final(&dc->sha1, digest);
+			if (job->has_identity)
+				digest_cache_store(&job->identity, digest, sizeof(digest),
+								   (int64_t) dc->bytes);
+			sha1_to_hex(digest, hex);
+			job_check_digest(job, 0, hex);
+			break;
+		}
+
+		case VERIFY_ALG_PAGES:
+			job_check_pages(job, &dc->pages);
+			break;
+
+		default:
+			job_finish(job, VERIFY_OK, NULL);
+			break;
+	}
+}
+
+/*
+ * Compressed file: expected size and digest describe the original
+ * content, so both are checked on the decompressed stream.
+ */
+static void
+verify_compressed(VerifyJob *job)
+{
+	uint8_t          *buf;
+	DecompressStream *ds;
+	DigestCtx         digest;
+	ssize_t           n;
+	uint64_t          total = 0;
+	char              msg[PATH_MAX + 64];
+
+	buf = buffer_pool_get(VERIFY_CHUNK_SIZE);
+	ds = buf != NULL ? decompress_open(job->path, job->compression) : NULL;
+	if (ds == NULL)
+	{
+		buffer_pool_put(buf, VERIFY_CHUNK_SIZE);
+		job_unreadable(job);
+		return;
+	}
+
+	digest_begin(&digest, job);
+	while ((n = decompress_read(ds, buf, VERIFY_CHUNK_SIZE)) > 0)
+	{
+		digest_update(&digest, buf, (size_t) n);
+		total += (uint64_t) n;
+	}
+	decompress_close(ds);
+	buffer_pool_put(buf, VERIFY_CHUNK_SIZE);
+
+	/* A stream that fails to decode is damaged, not merely unreadable */
+	if (n < 0)
+	{
+		digest_discard(&digest);
+		snprintf(msg, sizeof(msg), "Corrupt compressed file: %s", job->name);
+		job_fail(job, VALIDATION_CODE_CORRUPT_FILE, msg);
+		return;
+	}
+
+	if (job->expected_size >= 0 && (int64_t) total != job->expected_size)
+	{
+		digest_discard(&digest);
+		job_size_mismatch(job, (long long) total);
+		return;
+	}
+
+	digest_check(&digest, job);
+}
+
+static void
+digest_chunk(void *arg, const uint8_t *buf, size_t len)
+{
+	digest_update(arg, buf, len);
+}
+
+/* Verify one job; touches nothing but the job itself */
+static void
+verify_one(VerifyJob *job)
+{
+	DigestCtx digest;
+
+	if (!file_exists(job->path))
+	{
+		job_missing(job);
+		return;
+	}
+
+	if (job->compression != COMPRESSION_NONE)
+	{
+		verify_compressed(job);
+		return;
+	}
+
+	if (job->expected_size >= 0)
+	{
+		off_t actual_size = get_file_size(job->path);
+		if ((int64_t) actual_size != job->expected_size)
+		{
+			job_size_mismatch(job, (long long) actual_size);
+			return;
+		}
+	}
+
+	if (!job_reads_content(job))
+	{
+		job_finish(job, VERIFY_OK, NULL);
+		return;
+	}
+
+	/* read_file_chunks() honours the page-cache mode */
+	digest_begin(&digest, job);
+	if (!read_file_chunks(job->path, digest_chunk, &digest))
+	{
+		digest_discard(&digest);
+		job_unreadable(job);
+		return;
+	}
+	digest_check(&digest, job);
+}
+
+typedef struct {
+	VerifyJobList   *list;
+	int              next;      /* next unclaimed job, under lock */
+	int              done;      /* finished jobs, under lock */
+	pthread_mutex_t  lock;
+} VerifyQueue;
+
+static void *
+verify_worker(void *arg)
+{
+	VerifyQueue *queue = arg;
+	int          i     = -1;
+
+	metrics_set_thread_phase(METRIC_PHASE_CHECKSUM);
+	for (;;)
+	{
+		pthread_mutex_lock(&queue->lock);
+		if (i >= 0)
+		{
+			queue->done++;
+			if (queue->done % VERIFY_PROGRESS_STEP == 0)
+				log_debug("%s: %d/%d files verified",
+						  queue->list->label ? queue->list->label : "verify",
+						  queue->done, queue->list->count);
+		}
+		i = queue->next++;
+		pthread_mutex_unlock(&queue->lock);
+
+		if (i >= queue->list->count)
+			break;
+		if (queue->list->jobs[i].outcome != VERIFY_PENDING)
+			continue;       /* read by the asynchronous engine */
+		if (validation_stop_requested())
+		{
+			job_finish(&queue->list->jobs[i], VERIFY_SKIPPED, NULL);
+			continue;
+		}
+		validation_io_acquire();
+		verify_one(&queue->list->jobs[i]);
+		validation_io_release();
+	}
+	return NULL;
+}
+
+/* ------------------------------------------------------------------ *
+ * Asynchronous reads
+ * ------------------------------------------------------------------ */
+
+typedef struct {
+	VerifyJob *job;
+	DigestCtx  digest;
+	uint64_t   total;
+} AsyncJob;
+
+static void
+async_job_data(void *arg, const uint8_t *buf, size_t len)
+{
+	AsyncJob *aj = arg;
+
+	digest_update(&aj->digest, buf, len);
+	aj->total += len;
+}
+
+static void
+async_job_done(void *arg, int error)
+{
+	AsyncJob  *aj = arg;
+	VerifyJob *job = aj->job;
+
+	if (error != 0 ||
+		(job->expected_size >= 0 && (int64_t) aj->total != job->expected_size))
+		digest_discard(&aj->digest);
+
+	if (error == ENOENT || error == ENOTDIR)
+		job_missing(job);
+	else if (error != 0)
+		job_unreadable(job);
+	else if (job->expected_size >= 0 && (int64_t) aj->total != job->expected_size)
+		job_size_mismatch(job, (long long) aj->total);
+	else
+		digest_check(&aj->digest, job);
+}
+
+/*
+ * Digest the plain files of the list through the asynchronous engine,
+ * leaving the rest (presence checks, compressed files) pending.  Size is
+ * checked on the bytes read rather than stat()ed up front.  With no
+ * engine available nothing is done and the threaded path reads them all.
+ * Returns the number of jobs left pending.
+ */
+static int
+verify_jobs_run_async(VerifyJobList *list, int jobs)
+{
+	AsyncJob      *aj;
+	AsyncReadFile *files;
+	int            n = 0;
+	int            workers;
+
+	if (io_engine == IO_ENGINE_SYNC || !async_read_supported() ||
+		validation_stop_requested())
+		return list->count;
+
+	for (int i = 0; i < list->count; i++)
+		if (list->jobs[i].outcome == VERIFY_PENDING &&
+			list->jobs[i].compression == COMPRESSION_NONE &&
+			job_reads_content(&list->jobs[i]))
+			n++;
+	if (n == 0)
+		return list->count;
+
+	aj = malloc(sizeof(AsyncJob) * n);
+	files = malloc(sizeof(AsyncReadFile) * n);
+	if (aj == NULL || files == NULL)
+	{
+		free(aj);
+		free(files);
+		return list->count;
+	}
+
+	n = 0;
+	for (int i = 0; i < list->count; i++)
+	{
+		VerifyJob *job = &list->jobs[i];
+
+		if (job->outcome != VERIFY_PENDING ||
+			job->compression != COMPRESSION_NONE ||
+			!job_reads_content(job))
+			continue;
+		aj[n].job = job;
+		aj[n].total = 0;
+		digest_begin(&aj[n].digest, job);
+		files[n].path = job->path;
+		files[n].arg = &aj[n];
+		n++;
+	}
+
+	workers = jobs - 1 < n ? jobs - 1 : n;
+
+	/* The engine is one reader however many reads it keeps in flight */
+	validation_io_acquire();
+	if (!async_read_files(files, n, workers, async_job_data, async_job_done))
+		n = 0;
+	validation_io_release();
+
+	log_debug("%s: %d file%s read asynchronously",
+			  list->label ? list->label : "verify", n, n == 1 ? "" : "s");
+	free(files);
+	free(aj);
+	return list->count - n;
+}
+
+/*
+ * Apply --shard ownership to the list, once: jobs of other shards are
+ * finished as skipped without touching the file, so that each missing or
+ * damaged file is reported by exactly one shard.  With 'whole' the list
+ * goes to one shard as a unit, as tar archives are read in one pass.
+ * Returns false if the list has nothing for this shard to read.
+ */
+static bool
+shard_jobs(VerifyJobList *list, bool whole)
+{
+	bool	whole_owned;
+	int		owned = 0;
+	int		pending = 0;
+
+	if (!validation_shard_active())
+		return true;
+	whole_owned = whole && shard_owns_file(list->scope, NULL);
+	if (list->sharded)
+		return !whole || whole_owned;
+	list->sharded = true;
+
+	for (int i = 0; i < list->count; i++)
+	{
+		VerifyJob *job = &list->jobs[i];
+
+		if (job->outcome != VERIFY_PENDING)
+			continue;
+		pending++;
+		if (whole ? whole_owned : shard_owns_file(list->scope, job->name))
+		{
+			owned++;
+			continue;
+		}
+		job->flags |= VERIFY_OTHER_SHARD;
+		job_finish(job, VERIFY_SKIPPED, NULL);
+	}
+
+	log_debug("%s: shard %d/%d verifies %d of %d files",
+			  list->label ? list->label : "verify",
+			  validation_shard_index(), validation_shard_count(), owned, pending);
+	return owned > 0;
+}
+
+/*
+ * Apply sampled verification to the list, once: jobs left out of this
+ * run's sample keep their presence check (and, for plain files, the size
+ * check, which needs no read) but lose their digest.
+ */
+static void
+sample_jobs(VerifyJobList *list)
+{
+	SampleItem *items;
+	int        *index;
+	int         count = 0;
+	int         dropped = 0;
+
+	if (list->sampled || !validation_sample_active())
+		return;
+	list->sampled = true;
+
+	items = malloc(sizeof(SampleItem) * (size_t) list->count);
+	index = malloc(sizeof(int) * (size_t) list->count);
+	if (items == NULL || index == NULL)
+	{
+		free(items);
+		free(index);
+		return;
+	}
+
+	for (int i = 0; i < list->count; i++)
+	{
+		VerifyJob *job = &list->jobs[i];
+		int64_t    size;
+
+		if (job->outcome != VERIFY_PENDING ||
+			(!job_reads_content(job) && job->compression == COMPRESSION_NONE))
+			continue;
+		/* Manifests without sizes cost a stat(), far less than the read */
+		size = job->expected_size;
+		if (size < 0 && job->compression == COMPRESSION_NONE)
+			size = (int64_t) get_file_size(job->path);
+		items[count].key = sample_key(job->path);
+		items[count].bytes = size > 0 ? (uint64_t) size : 0;
+		items[count].cached = false;
+		index[count++] = i;
+	}
+
+	sample_select(items, count, SAMPLE_FILES);
+
+	for (int i = 0; i < count; i++)
+	{
+		VerifyJob *job = &list->jobs[index[i]];
+
+		if (items[i].selected)
+			continue;
+		if (job->compression != COMPRESSION_NONE)
+			job->expected_size = -1;
+		job->algorithm = VERIFY_ALG_NONE;
+		job->compression = COMPRESSION_NONE;
+		job->flags &= ~VERIFY_INCREMENTAL;
+		job->flags |= VERIFY_NOT_SAMPLED;
+		dropped++;
+	}
+
+	log_debug("%s: sampled %d of %d checksummed files",
+			  list->label ? list->label : "verify", count - dropped, count);
+	free(items);
+	free(index);
+}
+
+/* Digest length of 'alg', for the digest cache; 0 = not cached */
+static size_t
+cached_digest_length(VerifyAlgorithm alg)
+{
+	switch (alg)
+	{
+		case VERIFY_ALG_CRC32C: return sizeof(uint32_t);
+		case VERIFY_ALG_SHA256: return SHA256_DIGEST_LENGTH;
+		case VERIFY_ALG_SHA1:   return SHA1_DIGEST_LENGTH;
+		default:                return 0;   /* page checks depend on the backup */
+	}
+}
+
+/*
+ * Finish the jobs whose digest is in the digest cache by comparing it
+ * with the expected one, without reading the file.  The others get the
+ * file's identity, under which their digest is stored once computed.
+ * Files that cannot be stat()ed are left to the readers to report.
+ */
+static void
+cached_jobs(VerifyJobList *list)
+{
+	int reused = 0;
+
+	for (int i = 0; i < list->count; i++)
+	{
+		VerifyJob  *job = &list->jobs[i];
+		size_t      len = cached_digest_length(job->algorithm);
+		uint8_t     digest[DIGEST_CACHE_MAX_DIGEST];
+		int64_t     content_size;
+		struct stat st;
+
+		/* A cached digest would skip the incremental header check */
+		if (job->outcome != VERIFY_PENDING || len == 0 ||
+			(job->flags & VERIFY_INCREMENTAL) ||
+			stat(job->path, &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+
+		digest_key_set(&job->identity, &st, (int) job->algorithm,
+					   (int) job->compression);
+		if (!digest_cache_lookup(&job->identity, digest, len, &content_size))
+		{
+			job->has_identity = true;
+			continue;
+		}
+
+		reused++;
+		if (job->expected_size >= 0 && content_size != job->expected_size)
+			job_size_mismatch(job, (long long) content_size);
+		else if (job->algorithm == VERIFY_ALG_CRC32C)
+		{
+			uint32_t crc;
+
+			memcpy(&crc, digest, sizeof(crc));
+			job_check_digest(job, crc, NULL);
+		}
+		else
+		{
+			char hex[SHA256_HEX_LENGTH + 1];
+
+			if (job->algorithm == VERIFY_ALG_SHA256)
+				sha256_to_hex(digest, hex);
+			else
+				sha1_to_hex(digest, hex);
+			job_check_digest(job, 0, hex);
+		}
+	}
+
+	if (reused > 0)
+		log_debug("%s: %d file digest%s reused from the digest cache",
+				  list->label ? list->label : "verify", reused,
+				  reused == 1 ? "" : "s");
+}
+
+/*
+ * Verify every job in the list on up to 'jobs' threads.  The calling
+ * thread works as one of them; if a thread cannot be created the others
+ * simply pick up its share.  Plain files with a digest go through the
+ * asynchronous engine first, where there is one.
+ */
+void
+verify_jobs_run(VerifyJobList *list, int jobs)
+{
+	VerifyQueue  queue;
+	pthread_t   *threads = NULL;
+	int          started = 0;
+	int          pending;
+
+	if (list == NULL || list->count == 0)
+		return;
+
+	shard_jobs(list, false);
+	cached_jobs(list);
+	sample_jobs(list);
+	pending = verify_jobs_run_async(list, jobs);
+	if (pending == 0)
+		return;
+	if (jobs > pending)
+		jobs = pending;
+
+	queue.list = list;
+	queue.next = 0;
+	queue.done = 0;
+	pthread_mutex_init(&queue.lock, NULL);
+
+	if (jobs > 1)
+		threads = malloc(sizeof(pthread_t) * (jobs - 1));
+
+	if (threads != NULL)
+	{
+		for (int t = 0; t < jobs - 1; t++)
+		{
+			if (pthread_create(&threads[started], NULL,
+							   verify_worker, &queue) != 0)
+				break;
+			started++;
+		}
+	}
+
+	verify_worker(&queue);
+
+	for (int t = 0; t < started; t++)
+		pthread_join(threads[t], NULL);
+	free(threads);
+	pthread_mutex_destroy(&queue.lock);
+
+	log_debug("%s: %d files on %d thread(s)",
+			  list->label ? list->label : "verify", list->count, started + 1);
+}
+
+/* ------------------------------------------------------------------ *
+ * Tar archives
+ * ------------------------------------------------------------------ */
+
+/* Open-addressing index from job name to job, for member lookup */
+typedef struct {
+	int      *slots;    /* job index + 1; 0 = empty */
+	uint32_t  mask;
+} JobIndex;
+
+static uint32_t
+name_hash(const char *s)
+{
+	uint32_t h = 2166136261U;      /* FNV-1a */
+
+	while (*s)
+		h = (h ^ (uint8_t) *s++) * 16777619U;
+	return h;
+}
+
+static bool
+job_index_build(JobIndex *idx, const VerifyJobList *list)
+{
+	uint32_t size = 16;
+
+	while (size < (uint32_t) list->count * 2)
+		size <<= 1;
+
+	idx->slots = calloc(size, sizeof(int));
+	if (idx->slots == NULL)
+		return false;
+	idx->mask = size - 1;
+
+	for (int i = 0; i < list->count; i++)
+	{
+		uint32_t h = name_hash(list->jobs[i].name) & idx->mask;
+
+		while (idx->slots[h] != 0)
+			h = (h + 1) & idx->mask;
+		idx->slots[h] = i + 1;
+	}
+	return true;
+}
+
+/* First job named 'name' that is still pending, or NULL */
+static VerifyJob *
+job_index_find(const JobIndex *idx, VerifyJobList *list, const char *name)
+{
+	uint32_t h = name_hash(name) & idx->mask;
+
+	while (idx->slots[h] != 0)
+	{
+		VerifyJob *job = &list->jobs[idx->slots[h] - 1];
+
+		if (job->outcome == VERIFY_PENDING && strcmp(job->name, name) == 0)
+			return job;
+		h = (h + 1) & idx->mask;
+	}
+	return NULL;
+}
+
+/* Hash the current member's data and finish 'job' */
+static void
+verify_tar_member(VerifyJob *job, TarReader *tr, const TarMember *member)
+{
+	uint8_t   *buf;
+	ssize_t    n;
+	DigestCtx  digest;
+	uint64_t   total = 0;
+
+	if (job->expected_size >= 0 && (int64_t) member->size != job->expected_size)
+	{
+		/* The rest of the member is skipped by the next tar_reader_next() */
+		job_size_mismatch(job, (long long) member->size);
+		return;
+	}
+
+	if (!job_reads_content(job))
+	{
+		job_finish(job, VERIFY_OK, NULL);
+		return;
+	}
+
+	buf = buffer_pool_get(VERIFY_CHUNK_SIZE);
+	if (buf == NULL)
+	{
+		job_unreadable(job);
+		return;
+	}
+
+	digest_begin(&digest, job);
+	while ((n = tar_reader_read(tr, buf, VERIFY_CHUNK_SIZE)) > 0)
+	{
+		digest_update(&digest, buf, (size_t) n);
+		total += (uint64_t) n;
+	}
+	buffer_pool_put(buf, VERIFY_CHUNK_SIZE);
+
+	if (n < 0 || total != member->size)
+	{
+		digest_discard(&digest);
+		job_unreadable(job);
+		return;
+	}
+
+	digest_check(&digest, job);
+}
+
+/*
+ * Verify jobs against the members of one tar archive, in a single
+ * sequential pass with no extraction.  Member "N" is matched to the
+ * pending job named prefix + "N"; members with no job are skipped over.
+ * Jobs the archive does not contain stay pending, so several archives
+ * (base.tar and one per tablespace) can be run against the same list
+ * before verify_jobs_finish_missing().
+ *
+ * Returns false if the archive cannot be opened or is corrupt.
+ */
+bool
+verify_jobs_run_tar(VerifyJobList *list, const char *tar_path,
+					const char *prefix)
+{
+	JobIndex   idx;
+	TarReader *tr;
+	TarMember  member;
+	char       name[PATH_MAX];
+	int        rc;
+	int        matched = 0;
+
+	if (list == NULL || list->count == 0)
+		return true;
+
+	if (prefix == NULL)
+		prefix = "";
+
+	/* Another shard reads this backup's archives */
+	if (!shard_jobs(list, true))
+		return true;
+	sample_jobs(list);
+	tr = tar_reader_open(tar_path);
+	if (tr == NULL)
+		return false;
+
+	if (!job_index_build(&idx, list))
+	{
+		tar_reader_close(tr);
+		return false;
+	}
+
+	/* The whole archive is one sequential reader */
+	validation_io_acquire();
+	while ((rc = tar_reader_next(tr, &member)) == 1)
+	{
+		VerifyJob *job;
+
+		if (member.type != TAR_TYPE_REGULAR)
+			continue;
+		if (validation_stop_requested())
+			break;
+
+		snprintf(name, sizeof(name), "%s%s", prefix, member.name);
+		job = job_index_find(&idx, list, name);
+		if (job == NULL)
+			continue;
+
+		verify_tar_member(job, tr, &member);
+		matched++;
+		if (matched % VERIFY_PROGRESS_STEP == 0)
+			log_debug("%s: %d files verified from %s",
+					  list->label ? list->label : "verify", matched, tar_path);
+	}
+
+	validation_io_release();
+
+	free(idx.slots);
+	tar_reader_close(tr);
+
+	log_debug("%s: %d files verified from %s",
+			  list->label ? list->label : "verify", matched, tar_path);
+	return rc == 0;
+}
+
+/*
+ * Finish every job no archive supplied: "Missing file", or skipped
+ * for VERIFY_SKIP_IF_MISSING jobs.  After a fail-fast stop the archives
+ * were not read to the end, so the rest are only skipped.
+ */
+void
+verify_jobs_finish_missing(VerifyJobList *list)
+{
+	bool stopped = validation_stop_requested();
+
+	if (list == NULL)
+		return;
+
+	for (int i = 0; i < list->count; i++)
+	{
+		if (list->jobs[i].outcome != VERIFY_PENDING)
+			continue;
+		if (stopped)
+			job_finish(&list->jobs[i], VERIFY_SKIPPED, NULL);
+		else
+			job_missing(&list->jobs[i]);
+	}
+}
+
+/*
+ * Copy job outcomes into 'result' in list order and fill 'stats'
+ * (either may be NULL).
+ */
+void
+verify_jobs_merge(VerifyJobList *list, ValidationResult *result,
+				  VerifyStats *stats)
+{
+	VerifyStats local = {0, 0, 0, 0, 0};
+
+	if (list == NULL)
+		return;
+
+	for (int i = 0; i < list->count; i++)
+	{
+		VerifyJob *job = &list->jobs[i];
+
+		switch (job->outcome)
+		{
+			case VERIFY_OK:
+				if (job->flags & VERIFY_NOT_SAMPLED)
+					local.not_sampled++;
+				else
+					local.verified++;
+				break;
+			case VERIFY_SKIPPED:
+				if (job->flags & VERIFY_OTHER_SHARD)
+					local.other_shard++;
+				else
+					local.skipped++;
+				break;
+			case VERIFY_UNREADABLE:
+				if (list->unreadable_warns)
+				{
+					validation_add_warning(result, job->message);
+					break;
+				}
+				/* FALLTHROUGH */
+			case VERIFY_FAILED:
+				local.failed++;
+				validation_add_error_code(result, job->code, job->message);
+				break;
+			default:
+				break;
+		}
+	}
+
+	metrics_count(METRIC_FILES_CHECKED, (uint64_t) (local.verified + local.failed));
+	if (stats != NULL)
+		*stats = local;
+}
@@ -0,0 +1,229 @@
+/*
+ * verify_sample.c
+ *
+ * Deterministic rotation of sampled verification
+ *
+ * Every item gets a fixed place on a unit circle: items are ordered by
+ * a hash of their name, which does not depend on the run, and each
+ * occupies an arc proportional to its weight.  With n = ceil(1 / fraction)
+ * windows per rotation, run 'step' reads the items whose arcs start in
+ * window k = step mod n, [k * fraction, (k + 1) * fraction) (the last one
+ * ending at one), so any n consecutive steps tile the circle.  Items already
+ * verified by an earlier run cost nothing; the budget they leave is spent
+ * on the uncached items that follow the window, so a partly cached set
+ * is covered sooner.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "verify_sample.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+static double     sample_fraction = 1.0;
+static SampleUnit sample_unit = SAMPLE_BY_COUNT;
+static uint64_t   sample_step = 0;
+
+static pthread_mutex_t coverage_lock = PTHREAD_MUTEX_INITIALIZER;
+static SampleCoverage  coverage[SAMPLE_KIND_COUNT];
+
+typedef struct {
+	uint64_t key;
+	uint64_t offset;        /* arc start, past the window start, modulo total */
+	int      index;
+} SampleSlot;
+
+void
+validation_set_sample(double fraction, SampleUnit unit, uint64_t step)
+{
+	sample_fraction = (fraction > 0.0 && fraction < 1.0) ? fraction : 1.0;
+	sample_unit = unit;
+	sample_step = step;
+}
+
+bool
+validation_sample_active(void)
+{
+	return sample_fraction < 1.0;
+}
+
+int
+validation_sample_runs(void)
+{
+	return (int) ceil(1.0 / sample_fraction - 1e-9);
+}
+
+/* FNV-1a followed by a 64-bit finalizer, so nearby names spread out */
+uint64_t
+sample_key(const char *name)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (const unsigned char *p = (const unsigned char *) name; *p; p++)
+	{
+		h ^= *p;
+		h *= 0x100000001b3ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static uint64_t
+item_weight(const SampleItem *item)
+{
+	if (sample_unit == SAMPLE_BY_COUNT)
+		return 1;
+	return item->bytes > 0 ? item->bytes : 1;
+}
+
+static int
+cmp_key(const void *a, const void *b)
+{
+	const SampleSlot *sa = a;
+	const SampleSlot *sb = b;
+
+	if (sa->key != sb->key)
+		return sa->key < sb->key ? -1 : 1;
+	return sa->index - sb->index;
+}
+
+static int
+cmp_offset(const void *a, const void *b)
+{
+	const SampleSlot *sa = a;
+	const SampleSlot *sb = b;
+
+	if (sa->offset != sb->offset)
+		return sa->offset < sb->offset ? -1 : 1;
+	return sa->index - sb->index;
+}
+
+/* Start of window 'k' of 'runs', in weight units; window 'runs' ends at 'total' */
+static uint64_t
+window_start(int k, int runs, uint64_t total)
+{
+	if (k >= runs)
+		return total;
+	return (uint64_t) floor((double) k * sample_fraction * (double) total);
+}
+
+/*
+ * Pick the items of one run.  Returns false if the slots cannot be
+ * allocated; the caller then verifies everything.
+ */
+static bool
+select_window(SampleItem *items, int count)
+{
+	SampleSlot *slots;
+	uint64_t    total = 0;
+	uint64_t    before = 0;
+	uint64_t    spent = 0;
+	uint64_t    start;
+	uint64_t    width;
+	double      budget;
+	int         runs = validation_sample_runs();
+	int         k = (int) (sample_step % (uint64_t) runs);
+
+	slots = malloc(sizeof(SampleSlot) * (size_t) count);
+	if (slots == NULL)
+		return false;
+
+	for (int i = 0; i < count; i++)
+	{
+		slots[i].key = items[i].key;
+		slots[i].index = i;
+		total += item_weight(&items[i]);
+	}
+	qsort(slots, (size_t) count, sizeof(SampleSlot), cmp_key);
+
+	/* Integer bounds, so that the windows of one rotation tile exactly */
+	start = window_start(k, runs, total);
+	width = window_start(k + 1, runs, total) - start;
+	for (int i = 0; i < count; i++)
+	{
+		slots[i].offset = before >= start ? before - start : before + total - start;
+		before += item_weight(&items[slots[i].index]);
+	}
+	qsort(slots, (size_t) count, sizeof(SampleSlot), cmp_offset);
+
+	/*
+	 * The window itself is always read, so that the rotation covers every
+	 * item; cached items in it leave budget for the ones after it.
+	 */
+	budget = sample_fraction * (double) total;
+	for (int i = 0; i < count; i++)
+	{
+		SampleItem *item = &items[slots[i].index];
+
+		if (item->cached)
+			continue;
+		if (slots[i].offset >= width && (double) spent >= budget)
+			continue;
+		item->selected = true;
+		spent += item_weight(item);
+	}
+
+	free(slots);
+	return true;
+}
+
+void
+sample_select(SampleItem *items, int count, SampleKind kind)
+{
+	SampleCoverage add = { 0, 0, 0, 0 };
+
+	for (int i = 0; i < count; i++)
+		items[i].selected = false;
+
+	if (count > 0 && (!validation_sample_active() || !select_window(items, count)))
+	{
+		for (int i = 0; i < count; i++)
+			items[i].selected = !items[i].cached;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		add.items++;
+		add.bytes += items[i].bytes;
+		if (items[i].selected || items[i].cached)
+		{
+			add.items_checked++;
+			add.bytes_checked += items[i].bytes;
+		}
+	}
+
+	pthread_mutex_lock(&coverage_lock);
+	coverage[kind].items += add.items;
+	coverage[kind].items_checked += add.items_checked;
+	coverage[kind].bytes += add.bytes;
+	coverage[kind].bytes_checked += add.bytes_checked;
+	pthread_mutex_unlock(&coverage_lock);
+}
+
+void
+sample_coverage(SampleKind kind, SampleCoverage *out)
+{
+	pthread_mutex_lock(&coverage_lock);
+	*out = coverage[kind];
+	pthread_mutex_unlock(&coverage_lock);
+}
@@ -0,0 +1,129 @@
+/*
+ * verify_shard.c
+ *
+ * Deterministic assignment of verification work to shards
+ *
+ * An item belongs to shard (key mod N) + 1, where the key is
+ * sample_key() of a host-independent name: the same function that
+ * orders items for --sample, so shards are as evenly filled as sample
+ * windows are.  Sampling then applies within a shard.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "verify_shard.h"
+#include "verify_sample.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int shard_index = 1;
+static int shard_count = 1;
+
+void
+validation_set_shard(int index, int count)
+{
+	if (count < 1 || index < 1 || index > count)
+		index = count = 1;
+	shard_index = index;
+	shard_count = count;
+}
+
+bool
+validation_shard_active(void)
+{
+	return shard_count > 1;
+}
+
+int
+validation_shard_index(void)
+{
+	return shard_index;
+}
+
+int
+validation_shard_count(void)
+{
+	return shard_count;
+}
+
+bool
+shard_from_string(const char *str, int *index, int *count)
+{
+	char   *end;
+	long	k = 0;
+	long	n = 0;
+
+	if (str != NULL)
+	{
+		k = strtol(str, &end, 10);
+		if (end != str && *end == '/')
+		{
+			const char *p = end + 1;
+
+			n = strtol(p, &end, 10);
+			if (end == p || *end != '\0')
+				n = 0;
+		}
+	}
+	if (n == 0)
+	{
+		fprintf(stderr, "Error: Invalid shard: %s (expected K/N, e.g. 2/8)\n",
+				str != NULL ? str : "");
+		return false;
+	}
+	if (n < 1 || n > SHARD_MAX_COUNT || k < 1 || k > n)
+	{
+		fprintf(stderr, "Error: --shard needs 1 <= K <= N <= %d, got %ld/%ld\n",
+				SHARD_MAX_COUNT, k, n);
+		return false;
+	}
+	*index = (int) k;
+	*count = (int) n;
+	return true;
+}
+
+static bool
+owns_key(uint64_t key)
+{
+	return (int) (key % (uint64_t) shard_count) == shard_index - 1;
+}
+
+bool
+shard_owns_file(const char *scope, const char *name)
+{
+	uint64_t	key;
+
+	if (shard_count <= 1)
+		return true;
+	key = sample_key(scope != NULL ? scope : "");
+	if (name != NULL)
+		key ^= sample_key(name) * 0x9e3779b97f4a7c15ULL;
+	return owns_key(key);
+}
+
+bool
+shard_owns_wal_segment(uint32_t timeline, uint64_t segno)
+{
+	char	name[32];
+
+	if (shard_count <= 1)
+		return true;
+	snprintf(name, sizeof(name), "%08X/%016" PRIX64, timeline, segno / SHARD_WAL_RANGE);
+	return owns_key(sample_key(name));
+}
@@ -0,0 +1,531 @@
+/*
+ * wal_cache.c
+ *
+ * Persistent cache of WAL segments that passed validation
+ *
+ * One text file per archive, named after a hash of the archive path:
+ *
+ *   pg_backup_auditor wal-cache 1 <seg_size>
+ *   <size> <mtime_sec> <mtime_nsec> <dev> <ino> <path>
+ *   ...
+ *
+ * In memory the entries live in an open-addressing hash table keyed by
+ * path.  The file is rewritten (to a temporary file, then renamed) only
+ * when an entry was added, changed or pruned.
+ *
+ * Next to it, 'verify-segment' keeps the record left incomplete at the
+ * end of the last segment it verified:
+ *
+ *   pg_backup_auditor wal-tail 1 <seg_size> <size> <mtime_sec> <mtime_nsec>
+ *       <dev> <ino> <seg_filename> <page_no> <rec_off> <tot_len> <have>
+ *   <path>
+ *   <have bytes of the record>
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pg_backup_auditor.h"
+#include "wal_cache.h"
+#include "sha256.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define WAL_CACHE_MAGIC    "pg_backup_auditor wal-cache"
+#define WAL_CACHE_VERSION  1
+#define WAL_TAIL_MAGIC     "pg_backup_auditor wal-tail"
+#define WAL_TAIL_VERSION   1
+
+typedef struct {
+	char	   *path;			/* NULL = empty slot */
+	int64_t		size;
+	int64_t		mtime_sec;
+	long		mtime_nsec;
+	uint64_t	dev;
+	uint64_t	ino;
+	bool		seen;			/* looked up since the cache was opened */
+} WALCacheEntry;
+
+struct WALCache {
+	char		file[PATH_MAX];
+	uint32_t	seg_size;
+	WALCacheEntry *slots;
+	size_t		capacity;		/* power of two */
+	size_t		count;
+	bool		dirty;
+};
+
+static char *cache_dir = NULL;
+
+/*
+ * Set the directory holding WAL verification caches; NULL disables
+ * caching.
+ */
+void
+validation_set_cache_dir(const char *dir)
+{
+	free(cache_dir);
+	cache_dir = dir != NULL ? strdup(dir) : NULL;
+}
+
+const char *
+validation_get_cache_dir(void)
+{
+	return cache_dir;
+}
+
+/* FNV-1a */
+static uint64_t
+hash_path(const char *path)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (const unsigned char *p = (const unsigned char *) path; *p; p++)
+	{
+		h ^= *p;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static WALCacheEntry *
+find_slot(WALCacheEntry *slots, size_t capacity, const char *path)
+{
+	size_t i = (size_t) hash_path(path) & (capacity - 1);
+
+	while (slots[i].path != NULL && strcmp(slots[i].path, path) != 0)
+		i = (i + 1) & (capacity - 1);
+	return &slots[i];
+}
+
+static bool
+grow(WALCache *cache)
+{
+	size_t			new_capacity = cache->capacity * 2;
+	WALCacheEntry  *slots = calloc(new_capacity, sizeof(WALCacheEntry));
+
+	if (slots == NULL)
+		return false;
+
+	for (size_t i = 0; i < cache->capacity; i++)
+		if (cache->slots[i].path != NULL)
+			*find_slot(slots, new_capacity, cache->slots[i].path) = cache->slots[i];
+
+	free(cache->slots);
+	cache->slots = slots;
+	cache->capacity = new_capacity;
+	return true;
+}
+
+/* Find or add the entry for 'path'; *created tells which */
+static WALCacheEntry *
+put_entry(WALCache *cache, const char *path, bool *created)
+{
+	WALCacheEntry *e;
+
+	*created = false;
+
+	/* Keep the load factor at or below 1/2 */
+	if ((cache->count + 1) * 2 > cache->capacity && !grow(cache))
+		return NULL;
+
+	e = find_slot(cache->slots, cache->capacity, path);
+	if (e->path == NULL)
+	{
+		e->path = strdup(path);
+		if (e->path == NULL)
+			return NULL;
+		cache->count++;
+		*created = true;
+	}
+	return e;
+}
+
+static void
+set_identity(WALCacheEntry *e, const struct stat *st)
+{
+	e->size       = (int64_t) st->st_size;
+	e->mtime_sec  = (int64_t) st->st_mtim.tv_sec;
+	e->mtime_nsec = st->st_mtim.tv_nsec;
+	e->dev        = (uint64_t) st->st_dev;
+	e->ino        = (uint64_t) st->st_ino;
+}
+
+static bool
+same_identity(const WALCacheEntry *e, const struct stat *st)
+{
+	return e->size       == (int64_t) st->st_size &&
+		   e->mtime_sec  == (int64_t) st->st_mtim.tv_sec &&
+		   e->mtime_nsec == st->st_mtim.tv_nsec &&
+		   e->dev        == (uint64_t) st->st_dev &&
+		   e->ino        == (uint64_t) st->st_ino;
+}
+
+static void
+load_cache(WALCache *cache)
+{
+	FILE	   *fp;
+	char		line[PATH_MAX + 128];
+	unsigned	version, seg_size;
+	int			magic_len = (int) strlen(WAL_CACHE_MAGIC);
+
+	fp = fopen(cache->file, "r");
+	if (fp == NULL)
+		return;		/* no cache yet */
+
+	if (fgets(line, sizeof(line), fp) == NULL ||
+		strncmp(line, WAL_CACHE_MAGIC, magic_len) != 0 ||
+		sscanf(line + magic_len, "%u %u", &version, &seg_size) != 2 ||
+		version != WAL_CACHE_VERSION || seg_size != cache->seg_size)
+	{
+		log_debug("WAL cache %s: stale or unknown format, starting over",
+				  cache->file);
+		fclose(fp);
+		cache->dirty = true;
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		WALCacheEntry	tmp;
+		WALCacheEntry  *e;
+		int				path_off = 0;
+		size_t			len;
+		bool			created;
+
+		if (sscanf(line, "%" SCNd64 " %" SCNd64 " %ld %" SCNu64 " %" SCNu64 " %n",
+				   &tmp.size, &tmp.mtime_sec, &tmp.mtime_nsec,
+				   &tmp.dev, &tmp.ino, &path_off) != 5 || path_off == 0)
+			continue;
+
+		len = strlen(line + path_off);
+		if (len == 0 || line[path_off + len - 1] != '\n')
+			continue;	/* truncated line */
+		line[path_off + len - 1] = '\0';
+
+		e = put_entry(cache, line + path_off, &created);
+		if (e == NULL)
+			break;
+		e->size       = tmp.size;
+		e->mtime_sec  = tmp.mtime_sec;
+		e->mtime_nsec = tmp.mtime_nsec;
+		e->dev        = tmp.dev;
+		e->ino        = tmp.ino;
+	}
+	metrics_io_stream(fp);
+	fclose(fp);
+
+	log_debug("WAL cache %s: %zu segment%s", cache->file,
+			  cache->count, cache->count == 1 ? "" : "s");
+}
+
+static void
+save_cache(WALCache *cache)
+{
+	static pthread_mutex_t seq_lock = PTHREAD_MUTEX_INITIALIZER;
+	static unsigned        seq = 0;
+	char	tmp_file[PATH_MAX + 48];
+	FILE   *fp;
+	bool	ok;
+	unsigned n;
+
+	/*
+	 * Backups validated side by side may save the same archive's cache;
+	 * each writes its own temporary file and the last rename wins.
+	 */
+	pthread_mutex_lock(&seq_lock);
+	n = seq++;
+	pthread_mutex_unlock(&seq_lock);
+	snprintf(tmp_file, sizeof(tmp_file), "%s.tmp.%ld.%u",
+			 cache->file, (long) getpid(), n);
+
+	fp = fopen(tmp_file, "w");
+	if (fp == NULL)
+	{
+		log_warning("Cannot write WAL cache %s: %s",
+					tmp_file, strerror(errno));
+		return;
+	}
+
+	fprintf(fp, "%s %d %u\n", WAL_CACHE_MAGIC, WAL_CACHE_VERSION,
+			cache->seg_size);
+	for (size_t i = 0; i < cache->capacity; i++)
+	{
+		const WALCacheEntry *e = &cache->slots[i];
+
+		if (e->path != NULL)
+			fprintf(fp, "%" PRId64 " %" PRId64 " %ld %" PRIu64 " %" PRIu64 " %s\n",
+					e->size, e->mtime_sec, e->mtime_nsec,
+					e->dev, e->ino, e->path);
+	}
+
+	ok = !ferror(fp);
+	if (fclose(fp) != 0)
+		ok = false;
+	if (!ok || rename(tmp_file, cache->file) != 0)
+	{
+		log_warning("Cannot write WAL cache %s: %s",
+					cache->file, strerror(errno));
+		unlink(tmp_file);
+	}
+}
+
+/* The cache directory's file 'wal-<hash of archive_path>.<ext>' */
+static void
+archive_file(const char *archive_path, const char *ext, char *buf, size_t size)
+{
+	SHA256Ctx	ctx;
+	uint8_t		digest[SHA256_DIGEST_LENGTH];
+	char		hex[SHA256_HEX_LENGTH + 1];
+	char		name[64];
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, archive_path, strlen(archive_path));
+	sha256_final(&ctx, digest);
+	sha256_to_hex(digest, hex);
+	snprintf(name, sizeof(name), "wal-%.16s.%s", hex, ext);
+	path_join(buf, size, cache_dir, name);
+}
+
+WALCache *
+wal_cache_open(const char *archive_path, uint32_t seg_size)
+{
+	WALCache   *cache;
+
+	if (cache_dir == NULL || archive_path == NULL)
+		return NULL;
+
+	cache = calloc(1, sizeof(WALCache));
+	if (cache == NULL)
+		return NULL;
+	cache->capacity = 1024;
+	cache->slots = calloc(cache->capacity, sizeof(WALCacheEntry));
+	if (cache->slots == NULL)
+	{
+		free(cache);
+		return NULL;
+	}
+	cache->seg_size = seg_size;
+
+	/* One file per archive, named after its path */
+	archive_file(archive_path, "cache", cache->file, sizeof(cache->file));
+
+	load_cache(cache);
+	return cache;
+}
+
+bool
+wal_cache_lookup(WALCache *cache, const char *path, const struct stat *st)
+{
+	WALCacheEntry *e;
+
+	if (cache == NULL)
+		return false;
+
+	e = find_slot(cache->slots, cache->capacity, path);
+	if (e->path == NULL)
+		return false;
+
+	e->seen = true;
+	return same_identity(e, st);
+}
+
+void
+wal_cache_store(WALCache *cache, const char *path, const struct stat *st)
+{
+	WALCacheEntry *e;
+	bool		   created;
+
+	if (cache == NULL)
+		return;
+
+	e = put_entry(cache, path, &created);
+	if (e == NULL)
+		return;
+	if (created || !same_identity(e, st))
+	{
+		set_identity(e, st);
+		cache->dirty = true;
+	}
+	e->seen = true;
+}
+
+void
+wal_cache_close(WALCache *cache, bool prune)
+{
+	if (cache == NULL)
+		return;
+
+	if (prune)
+	{
+		size_t	kept = 0;
+
+		for (size_t i = 0; i < cache->capacity; i++)
+			if (cache->slots[i].path != NULL && cache->slots[i].seen)
+				kept++;
+		if (kept != cache->count)
+		{
+			WALCacheEntry  *old = cache->slots;
+			size_t			old_capacity = cache->capacity;
+
+			/* Rebuild the table with only the entries that were seen */
+			cache->slots = calloc(old_capacity, sizeof(WALCacheEntry));
+			if (cache->slots != NULL)
+			{
+				cache->count = 0;
+				for (size_t i = 0; i < old_capacity; i++)
+				{
+					if (old[i].path == NULL)
+						continue;
+					if (old[i].seen)
+					{
+						*find_slot(cache->slots, old_capacity, old[i].path) = old[i];
+						cache->count++;
+					}
+					else
+						free(old[i].path);
+				}
+				free(old);
+				cache->dirty = true;
+			}
+			else
+				cache->slots = old;
+		}
+	}
+
+	if (cache->dirty)
+		save_cache(cache);
+
+	for (size_t i = 0; i < cache->capacity; i++)
+		free(cache->slots[i].path);
+	free(cache->slots);
+	free(cache);
+}
+
+void
+wal_cache_set_tail(const char *archive_path, const WALCacheTail *tail,
+				   const struct stat *st)
+{
+	char	file[PATH_MAX];
+	char	tmp_file[PATH_MAX + 32];
+	FILE   *fp;
+	bool	ok;
+
+	if (cache_dir == NULL || archive_path == NULL)
+		return;
+
+	archive_file(archive_path, "tail", file, sizeof(file));
+	if (tail == NULL)
+	{
+		if (unlink(file) != 0 && errno != ENOENT)
+			log_warning("Cannot remove WAL tail %s: %s", file, strerror(errno));
+		return;
+	}
+
+	snprintf(tmp_file, sizeof(tmp_file), "%s.tmp.%ld", file, (long) getpid());
+	fp = fopen(tmp_file, "w");
+	if (fp == NULL)
+	{
+		log_warning("Cannot write WAL tail %s: %s", tmp_file, strerror(errno));
+		return;
+	}
+
+	fprintf(fp, "%s %d %u %" PRId64 " %" PRId64 " %ld %" PRIu64 " %" PRIu64
+			" %s %d %u %u %u\n%s\n",
+			WAL_TAIL_MAGIC, WAL_TAIL_VERSION, tail->seg_size,
+			(int64_t) st->st_size, (int64_t) st->st_mtim.tv_sec,
+			st->st_mtim.tv_nsec, (uint64_t) st->st_dev, (uint64_t) st->st_ino,
+			tail->seg_filename, tail->page_no, tail->rec_off,
+			tail->tot_len, tail->have, tail->path);
+	ok = fwrite(tail->data, 1, tail->have, fp) == tail->have && !ferror(fp);
+	if (fclose(fp) != 0)
+		ok = false;
+	if (!ok || rename(tmp_file, file) != 0)
+	{
+		log_warning("Cannot write WAL tail %s: %s", file, strerror(errno));
+		unlink(tmp_file);
+	}
+}
+
+bool
+wal_cache_get_tail(const char *archive_path, WALCacheTail *tail,
+				   struct stat *st)
+{
+	char		file[PATH_MAX];
+	char		line[PATH_MAX + 256];
+	FILE	   *fp;
+	WALCacheEntry id;
+	unsigned	version;
+	int			magic_len = (int) strlen(WAL_TAIL_MAGIC);
+	size_t		len;
+	bool		ok = false;
+
+	memset(tail, 0, sizeof(*tail));
+	if (cache_dir == NULL || archive_path == NULL)
+		return false;
+
+	archive_file(archive_path, "tail", file, sizeof(file));
+	fp = fopen(file, "r");
+	if (fp == NULL)
+		return false;	/* nothing kept */
+
+	if (fgets(line, sizeof(line), fp) == NULL ||
+		strncmp(line, WAL_TAIL_MAGIC, magic_len) != 0 ||
+		sscanf(line + magic_len, "%u %u %" SCNd64 " %" SCNd64 " %ld %" SCNu64
+			   " %" SCNu64 " %31s %d %u %u %u",
+			   &version, &tail->seg_size, &id.size, &id.mtime_sec,
+			   &id.mtime_nsec, &id.dev, &id.ino, tail->seg_filename,
+			   &tail->page_no, &tail->rec_off, &tail->tot_len,
+			   &tail->have) != 12 ||
+		version != WAL_TAIL_VERSION ||
+		tail->have == 0 || tail->have >= tail->tot_len ||
+		fgets(tail->path, sizeof(tail->path), fp) == NULL ||
+		(len = strlen(tail->path)) < 2 || tail->path[len - 1] != '\n')
+	{
+		log_debug("WAL tail %s: unknown format, ignored", file);
+		goto done;
+	}
+	tail->path[len - 1] = '\0';
+
+	/* Only for the very file whose end it is */
+	if (stat(tail->path, st) != 0 || !same_identity(&id, st))
+	{
+		log_debug("WAL tail %s: %s changed or gone, ignored", file, tail->path);
+		goto done;
+	}
+
+	tail->data = malloc(tail->have);
+	if (tail->data == NULL ||
+		fread(tail->data, 1, tail->have, fp) != tail->have)
+	{
+		log_debug("WAL tail %s: cannot read the record, ignored", file);
+		free(tail->data);
+		tail->data = NULL;
+		goto done;
+	}
+	ok = true;
+
+done:
+	fclose(fp);
+	return ok;
+}
@@ -22,36 +22,47 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "pg_backup_auditor.h"
+#include "validation_result.h"
 #include "crc32c.h"
+#include "decompress.h"
+#include "tar_reader.h"
+#include "wal_cache.h"
+#include "verify_sample.h"
+#include "verify_shard.h"
+#include "metrics.h"
+#include "buffer_pool.h"
+#include "storage.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 /* -----------------------------------------------------------------------
  * Internal helpers
  * ----------------------------------------------------------------------- */
 
 /*
- * Add error message to a ValidationResult
+ * Add error message to a ValidationResult; any error fails the result
  */
 static void
-add_error(ValidationResult *result, const char *msg)
+add_error_code(ValidationResult *result, ValidationCode code, const char *msg)
 {
 	if (result == NULL || msg == NULL)
 		return;
 
-	char **tmp = realloc(result->errors,
-						 sizeof(char *) * (result->error_count + 1));
-	if (tmp == NULL)
-		return;
-	result->errors = tmp;
-
-	result->errors[result->error_count] = strdup(msg);
-	result->error_count++;
+	validation_add_error_code(result, code, msg);
 	result->status = BACKUP_STATUS_ERROR;
 }
 
+static void
+add_error(ValidationResult *result, const char *msg)
+{
+	add_error_code(result, VALIDATION_CODE_OTHER, msg);
+}
+
 /*
  * Little-endian read helpers (used for WAL page header parsing)
  */
@@ -120,8 +131,11 @@ read_u64le(const uint8_t *buf, int off)
 #define WAL_XLOG_OFF_TOTLEN   0   /* xl_tot_len */
 #define WAL_XLOG_OFF_CRC     20   /* xl_crc */
 
-/* Buffer size for reading page header + first XLogRecord */
-#define WAL_READ_BUF_SIZE  8192
+/*
+ * Segments are read in chunks of this size: large sequential reads, and a
+ * multiple of every valid block size so that chunks hold whole pages.
+ */
+#define WAL_READ_CHUNK     (1024 * 1024)
 
 /* Short page header on continuation pages (XLogPageHeaderData, MAXALIGN'd to 24) */
 #define WAL_SHORT_HDR_SIZE  24
@@ -129,114 +143,195 @@ read_u64le(const uint8_t *buf, int off)
 /* Align n up to the nearest 8-byte boundary (mirrors PostgreSQL MAXALIGN on 64-bit) */
 #define WAL_MAXALIGN(n)  (((uint32_t)(n) + 7U) & ~7U)
 
+/* xlp_info flags for the first record on a page */
+#define XLP_FIRST_IS_CONTRECORD            0x0001
+#define XLP_FIRST_IS_OVERWRITE_CONTRECORD  0x0008
+
+/* Largest record PostgreSQL writes (XLogRecordMaxSize) */
+#define WAL_MAX_RECORD_SIZE  (1020U * 1024 * 1024)
+
+/*
+ * The geometry nearly every cluster uses.  Segments of it are walked by
+ * check_wal_chunk_std(), with the page length a constant; any other valid
+ * geometry goes through the generic loop in validate_wal_source().
+ */
+#define WAL_STD_BLCKSZ      8192U
+#define WAL_STD_SEG_SIZE    (16U * 1024 * 1024)
+
+/* Lets the standard-geometry walker get its own copy of the page walk */
+#if defined(__GNUC__) || defined(__clang__)
+#define WAL_ALWAYS_INLINE   __attribute__((always_inline)) inline
+#else
+#define WAL_ALWAYS_INLINE   inline
+#endif
+
+/*
+ * A record that spans pages (and possibly segments) is copied piece by
+ * piece into 'buf' until complete.  The buffer is grown geometrically
+ * and reused for every such record a worker meets.
+ */
+typedef struct {
+	uint8_t	   *buf;
+	size_t		cap;
+	uint32_t	tot_len;		/* xl_tot_len of the pending record; 0 = none */
+	uint32_t	have;			/* bytes collected so far */
+	char		seg_filename[32];	/* where the record starts */
+	int			page_no;
+	uint32_t	rec_off;
+	uint64_t	seq;			/* number of the current/last record begun */
+	uint64_t	lost_seq;		/* last record dropped before completion */
+} WALRecordAssembler;
+
+/*
+ * Locate a segment on disk: the scanned file (possibly compressed or in a
+ * subdirectory) when the archive lists it, else a bare file of that name.
+ * The file is not stat'ed; opening it tells whether it exists.
+ */
+static void
+locate_wal_segment(WALArchiveInfo *wal_info, const WALSegmentName *seg,
+				   char *path, size_t pathsize, CompressionType *compression)
+{
+	int idx = wal_archive_find(wal_info, seg);
+
+	if (idx >= 0)
+	{
+		wal_archive_segment_path(wal_info, idx, path, pathsize);
+		*compression = wal_archive_segment_compression(wal_info, idx);
+	}
+	else
+	{
+		char seg_filename[32];
+
+		format_wal_filename(seg, seg_filename, sizeof(seg_filename));
+		path_join(path, pathsize, wal_info->archive_path, seg_filename);
+		*compression = COMPRESSION_NONE;
+	}
+}
+
+/*
+ * Where a segment's bytes come from: a (possibly compressed) file, or the
+ * current member of a tar archive
+ */
+typedef struct {
+	DecompressStream *ds;
+	TarReader		 *tar;
+} WALSource;
+
+static uint32_t validate_wal_source(WALSource *src, const char *seg_filename,
+									uint32_t expected_tli, uint64_t expected_pageaddr,
+									const WALSegmentName *seg, uint8_t *chunk,
+									WALRecordAssembler *as, ValidationResult *result);
+
+static void check_wal_source_header(WALSource *src, const char *seg_filename,
+									uint32_t expected_tli, uint64_t expected_pageaddr,
+									int64_t length, ValidationResult *result);
+
+static void finish_wal_source_record(WALSource *src, const char *seg_filename,
+									 uint8_t *chunk, WALRecordAssembler *as,
+									 ValidationResult *result);
+
+/*
+ * Read up to 'len' bytes of a (decompressed) segment, looping over short
+ * reads.  Returns the number of bytes read, or -1 on a read or
+ * decompression error.
+ */
+static ssize_t
+read_wal_bytes(WALSource *src, uint8_t *buf, size_t len)
+{
+	size_t total = 0;
+
+	while (total < len)
+	{
+		ssize_t n = src->tar != NULL ?
+			tar_reader_read(src->tar, buf + total, len - total) :
+			decompress_read(src->ds, buf + total, len - total);
+
+		if (n < 0)
+			return -1;
+		if (n == 0)
+			break;
+		total += (size_t) n;
+	}
+	return (ssize_t) total;
+}
+
+/* xlp_seg_size is valid: a power of two in [1 MB, 1 GB] */
+static bool
+valid_wal_seg_size(uint32_t seg_size)
+{
+	return seg_size != 0 &&
+		(seg_size & (seg_size - 1)) == 0 &&
+		seg_size >= (1U << 20) &&
+		seg_size <= (1U << 30);
+}
+
+/* Block size is a power of two in [512, 65536] */
+static bool
+valid_wal_blcksz(uint32_t blcksz)
+{
+	return blcksz != 0 &&
+		(blcksz & (blcksz - 1)) == 0 &&
+		blcksz >= 512 &&
+		blcksz <= 65536;
+}
+
 /*
  * detect_wal_segment_size
  *
- * Read xlp_seg_size from the first reachable WAL segment in the archive.
- * Returns the value if it is a valid power-of-two in [1 MB, 1 GB].
- * Falls back to the standard 16 MB (0x1000000) if the archive is empty,
- * no segment file can be opened, or the stored value looks invalid.
+ * The archive's segment size: as the scan found it, or read from the
+ * first readable segment's xlp_seg_size for an archive assembled
+ * without one.  Falls back to the standard 16 MB (0x1000000) if the
+ * archive is empty, no segment file can be opened, or the stored value
+ * looks invalid.
  */
 static uint32_t
 detect_wal_segment_size(WALArchiveInfo *wal_info)
 {
-	char		seg_path[PATH_MAX];
-	char		seg_filename[32];
-	FILE	   *fp;
-	uint8_t		buf[WAL_LONG_HDR_SIZE];
 	uint32_t	seg_size;
-	int			i;
 
 	if (wal_info == NULL || wal_info->segment_count == 0)
 		return 0x1000000;	/* default 16 MB */
 
-	for (i = 0; i < wal_info->segment_count; i++)
-	{
-		format_wal_filename(&wal_info->segments[i], seg_filename,
-							sizeof(seg_filename));
-		path_join(seg_path, sizeof(seg_path),
-				  wal_info->archive_path, seg_filename);
-
-		fp = fopen(seg_path, "rb");
-		if (fp == NULL)
-			continue;
-
-		if (fread(buf, 1, sizeof(buf), fp) == sizeof(buf))
-		{
-			fclose(fp);
-			seg_size = read_u32le(buf, WAL_OFF_SEG_SIZE);
-			/* Accept only a power-of-two in [1 MB, 1 GB] */
-			if (seg_size != 0 &&
-				(seg_size & (seg_size - 1)) == 0 &&
-				seg_size >= (1U << 20) &&
-				seg_size <= (1U << 30))
-			{
-				return seg_size;
-			}
-			/* Bad value — try next segment */
-		}
-		else
-			fclose(fp);
-	}
-
-	return 0x1000000;	/* fallback */
+	if (wal_info->segment_size != 0)
+		return wal_info->segment_size;
+	seg_size = wal_archive_read_segment_size(wal_info);
+	return seg_size != 0 ? seg_size : 0x1000000;
 }
 
 /*
- * Read and validate the XLogLongPageHeaderData from one WAL segment,
- * plus CRC32C of the first XLogRecord if it fits in the read buffer.
- * Returns true if everything looks valid.
+ * Validate the XLogLongPageHeaderData at the start of a segment.
+ * On return *blcksz_out and *seg_size_out hold the header's values
+ * (possibly invalid, in which case an error has been reported).
+ * Returns true if every field looks valid.
  */
 static bool
-validate_wal_segment_header(const char *seg_path,
-							const char *seg_filename,
-							uint32_t expected_tli,
-							uint64_t expected_pageaddr,
-							ValidationResult *result)
+check_wal_long_header(const uint8_t *buf,
+					  const char *seg_filename,
+					  uint32_t expected_tli,
+					  uint64_t expected_pageaddr,
+					  uint32_t *blcksz_out,
+					  uint32_t *seg_size_out,
+					  ValidationResult *result)
 {
-	FILE	   *f;
-	uint8_t		buf[WAL_READ_BUF_SIZE];
-	size_t		n;
 	uint16_t	xlp_magic;
 	uint16_t	xlp_info;
 	uint32_t	xlp_tli;
 	uint64_t	xlp_pageaddr;
-	uint32_t	xlp_rem_len;
 	uint32_t	xlp_seg_size;
 	uint32_t	xlp_xlog_blcksz;
 	char		msg[512];
 	bool		ok = true;
 
-	f = fopen(seg_path, "rb");
-	if (f == NULL)
-	{
-		snprintf(msg, sizeof(msg),
-				 "WAL segment %s: cannot open for header check", seg_filename);
-		add_error(result, msg);
-		return false;
-	}
-
-	n = fread(buf, 1, sizeof(buf), f);
-	fclose(f);
-
-	if (n < (size_t) WAL_LONG_HDR_SIZE)
-	{
-		snprintf(msg, sizeof(msg),
-				 "WAL segment %s: file too small to read header "
-				 "(got %zu bytes, need %d)",
-				 seg_filename, n, WAL_LONG_HDR_SIZE);
-		add_error(result, msg);
-		return false;
-	}
-
 	xlp_magic       = read_u16le(buf, WAL_OFF_MAGIC);
 	xlp_info        = read_u16le(buf, WAL_OFF_INFO);
 	xlp_tli         = read_u32le(buf, WAL_OFF_TLI);
 	xlp_pageaddr    = read_u64le(buf, WAL_OFF_PAGEADDR);
-	xlp_rem_len     = read_u32le(buf, WAL_OFF_REM_LEN);
 	xlp_seg_size    = read_u32le(buf, WAL_OFF_SEG_SIZE);
 	xlp_xlog_blcksz = read_u32le(buf, WAL_OFF_BLCKSZ);
 
+	*blcksz_out   = xlp_xlog_blcksz;
+	*seg_size_out = xlp_seg_size;
+
 	/* Magic must be non-zero */
 	if (xlp_magic == 0)
 	{
@@ -281,10 +376,7 @@ validate_wal_segment_header(const char *seg_path,
 	}
 
 	/* Segment size must be a power of two between 1 MB and 1 GB */
-	if (xlp_seg_size == 0 ||
-		(xlp_seg_size & (xlp_seg_size - 1)) != 0 ||
-		xlp_seg_size < (1U << 20) ||
-		xlp_seg_size > (1U << 30))
+	if (!valid_wal_seg_size(xlp_seg_size))
 	{
 		snprintf(msg, sizeof(msg),
 				 "WAL segment %s: unexpected segment size in header "
@@ -294,41 +386,8 @@ validate_wal_segment_header(const char *seg_path,
 		ok = false;
 	}
 
-	/*
-	 * File size must equal the segment size declared in the header.
-	 *
-	 * We only do this check when xlp_seg_size itself is valid (power-of-two,
-	 * 1 MB–1 GB), so we never chase a corrupt value.  Any segment in a
-	 * proper archive must be complete; a truncated file cannot be replayed
-	 * past the point of truncation.
-	 *
-	 * NOTE: The current segment in a live pg_wal directory is being written
-	 * to and will be smaller than xlp_seg_size.  Archives should only contain
-	 * completed segments, so truncation is an error in that context.
-	 */
-	if (xlp_seg_size != 0 &&
-		(xlp_seg_size & (xlp_seg_size - 1)) == 0 &&
-		xlp_seg_size >= (1U << 20) &&
-		xlp_seg_size <= (1U << 30))
-	{
-		off_t actual_size = get_file_size(seg_path);
-
-		if (actual_size >= 0 && (uint64_t)actual_size < (uint64_t)xlp_seg_size)
-		{
-			snprintf(msg, sizeof(msg),
-					 "WAL segment %s: truncated "
-					 "(%lld bytes, expected %u per header)",
-					 seg_filename, (long long)actual_size, xlp_seg_size);
-			add_error(result, msg);
-			ok = false;
-		}
-	}
-
 	/* Block size must be a power of two in [512, 65536] */
-	if (xlp_xlog_blcksz == 0 ||
-		(xlp_xlog_blcksz & (xlp_xlog_blcksz - 1)) != 0 ||
-		xlp_xlog_blcksz < 512 ||
-		xlp_xlog_blcksz > 65536)
+	if (!valid_wal_blcksz(xlp_xlog_blcksz))
 	{
 		snprintf(msg, sizeof(msg),
 				 "WAL segment %s: invalid block size in header "
@@ -338,274 +397,1513 @@ validate_wal_segment_header(const char *seg_path,
 		ok = false;
 	}
 
-	/*
-	 * CRC32C check of the first XLogRecord.
-	 *
-	 * Only attempted when:
-	 *   - The page header looks valid so far (ok == true).
-	 *   - xlp_rem_len == 0, meaning the page starts with a complete record,
-	 *     not a continuation fragment from the previous segment.
-	 *   - We have read at least enough bytes to inspect the record header.
-	 *
-	 * PostgreSQL computes the CRC over:
-	 *   - XLogRecord bytes [0..19]  (everything before xl_crc)
-	 *   - XLogRecord bytes [24..xl_tot_len-1]  (record data payload)
-	 */
-	if (ok && xlp_rem_len == 0 &&
-		n >= (size_t)(WAL_RECORD_OFFSET + WAL_XLOG_HDR_SIZE))
-	{
-		const uint8_t *rec      = buf + WAL_RECORD_OFFSET;
-		uint32_t       xl_tot_len = read_u32le(rec, WAL_XLOG_OFF_TOTLEN);
+	if (ok)
+		log_debug("WAL segment %s: header OK "
+				  "(magic=0x%04X tli=%u seg_size=0x%X blcksz=%u)",
+				  seg_filename, xlp_magic, xlp_tli, xlp_seg_size,
+				  xlp_xlog_blcksz);
 
-		if (xl_tot_len == 0)
-		{
-			/*
-			 * Zero xl_tot_len means the page tail is zero-filled: the segment
-			 * is either pre-allocated but not yet written (valid for the
-			 * current segment in pg_wal) or the archive contains only a page
-			 * header with no records.  Not an error; validate_wal_segment_records
-			 * will iterate through pages and find nothing to check.
-			 */
-			log_debug("WAL segment %s: first page zero-filled (no records)",
-					  seg_filename);
-		}
-		else if (xl_tot_len < (uint32_t) WAL_XLOG_HDR_SIZE)
-		{
-			snprintf(msg, sizeof(msg),
-					 "WAL segment %s: first XLogRecord has implausible "
-					 "xl_tot_len=%u",
-					 seg_filename, xl_tot_len);
-			add_error(result, msg);
-			ok = false;
-		}
-		else if ((size_t)(WAL_RECORD_OFFSET + xl_tot_len) <= n)
-		{
-			/* Record fully buffered — verify CRC32C */
-			uint32_t stored_crc = read_u32le(rec, WAL_XLOG_OFF_CRC);
+	return ok;
+}
 
-			/*
-			 * xl_crc == 0 means the record was written without a CRC
-			 * (e.g. pg_probackup synthetic WAL records).  Skip check.
-			 */
-			if (stored_crc == 0)
-			{
-				log_debug("WAL segment %s: first XLogRecord CRC is zero "
-						  "— skipping CRC check", seg_filename);
-			}
-			else
-			{
-				uint32_t crc = ~0U;
+/*
+ * Check the xl_crc of one complete XLogRecord ('xl_tot_len' bytes at
+ * 'rec').  The location is the record's start, for messages.
+ *
+ * Records whose stored xl_crc == 0 are skipped: pg_probackup writes
+ * synthetic WAL records without a checksum; treating them as errors would
+ * produce false positives.
+ */
+static void
+check_wal_record_crc(const uint8_t *rec, uint32_t xl_tot_len,
+					 const char *seg_filename, int page_no, uint32_t rec_off,
+					 ValidationResult *result)
+{
+	uint32_t	xl_crc = read_u32le(rec, WAL_XLOG_OFF_CRC);
+	uint32_t	crc = ~0U;
+	uint32_t	computed_crc;
+	char		msg[512];
 
-				/*
-				 * PostgreSQL computes xl_crc in the following order:
-				 *   1. data payload: bytes [SizeOfXLogRecord .. xl_tot_len-1]
-				 *   2. record header: bytes [0 .. offsetof(xl_crc)-1] = [0..19]
-				 * We must follow the same order.
-				 */
+	if (xl_crc == 0)
+	{
+		/*
+		 * Stored CRC is zero → synthetic record (e.g. written by
+		 * pg_probackup).  Skip the checksum comparison.
+		 */
+		log_debug("WAL segment %s page %d offset %u: xl_crc=0, skipping",
+				  seg_filename, page_no, rec_off);
+		return;
+	}
 
-				/* 1. Data payload: bytes 24..xl_tot_len-1 */
-				if (xl_tot_len > (uint32_t) WAL_XLOG_HDR_SIZE)
-					crc = crc32c_update(crc,
-										rec + WAL_XLOG_HDR_SIZE,
-										xl_tot_len - WAL_XLOG_HDR_SIZE);
+	/* PostgreSQL order: payload first, then header */
 
-				/* 2. Record header bytes 0..19 (before xl_crc) */
-				crc = crc32c_update(crc, rec, 20);
+	/* 1. Bytes [24..xl_tot_len-1] — data payload */
+	if (xl_tot_len > (uint32_t) WAL_XLOG_HDR_SIZE)
+		crc = crc32c_update(crc,
+							rec + WAL_XLOG_HDR_SIZE,
+							xl_tot_len - WAL_XLOG_HDR_SIZE);
 
-				uint32_t computed_crc = ~crc;
+	/* 2. Bytes [0..19] — header fields before xl_crc */
+	crc = crc32c_update(crc, rec, 20);
 
-				if (computed_crc != stored_crc)
-				{
-					snprintf(msg, sizeof(msg),
-							 "WAL segment %s: first XLogRecord CRC mismatch "
-							 "(stored=0x%08X, computed=0x%08X, xl_tot_len=%u)",
-							 seg_filename, stored_crc, computed_crc, xl_tot_len);
-					add_error(result, msg);
-					ok = false;
-				}
-				else
-					log_debug("WAL segment %s: first XLogRecord CRC OK "
-							  "(xl_tot_len=%u)", seg_filename, xl_tot_len);
-			}
-		}
-		else
-		{
-			/* Record doesn't fit in our read buffer — skip CRC check */
-			log_debug("WAL segment %s: first XLogRecord too large for CRC check "
-					  "(xl_tot_len=%u, buffered=%zu)",
-					  seg_filename, xl_tot_len, n - WAL_RECORD_OFFSET);
-		}
+	computed_crc = ~crc;
+
+	if (computed_crc != xl_crc)
+	{
+		snprintf(msg, sizeof(msg),
+				 "WAL segment %s page %d offset %u: "
+				 "CRC mismatch (stored=0x%08X, computed=0x%08X, "
+				 "xl_tot_len=%u)",
+				 seg_filename, page_no, rec_off,
+				 xl_crc, computed_crc, xl_tot_len);
+		add_error(result, msg);
 	}
+}
 
-	if (ok)
-		log_debug("WAL segment %s: header OK "
-				  "(magic=0x%04X tli=%u seg_size=0x%X blcksz=%u)",
-				  seg_filename, xlp_magic, xlp_tli, xlp_seg_size,
-				  xlp_xlog_blcksz);
+/*
+ * Start collecting a record of 'tot_len' bytes that continues on the next
+ * page.  The buffer only ever grows, so after the first few large records
+ * no more allocations are made.
+ */
+static bool
+wal_assembler_begin(WALRecordAssembler *as, uint32_t tot_len,
+					const char *seg_filename, int page_no, uint32_t rec_off)
+{
+	if (tot_len > as->cap)
+	{
+		size_t	 new_cap = as->cap > 0 ? as->cap : 65536;
+		uint8_t *tmp;
+
+		while (new_cap < tot_len)
+			new_cap *= 2;
+		tmp = realloc(as->buf, new_cap);
+		if (tmp == NULL)
+			return false;
+		as->buf = tmp;
+		as->cap = new_cap;
+	}
 
-	return ok;
+	as->tot_len = tot_len;
+	as->have    = 0;
+	as->seq++;
+	as->page_no = page_no;
+	as->rec_off = rec_off;
+	snprintf(as->seg_filename, sizeof(as->seg_filename), "%s", seg_filename);
+	return true;
+}
+
+static void
+wal_assembler_add(WALRecordAssembler *as, const uint8_t *data, uint32_t len)
+{
+	memcpy(as->buf + as->have, data, len);
+	as->have += len;
+}
+
+/* The pending record is complete and has been checked */
+static void
+wal_assembler_done(WALRecordAssembler *as)
+{
+	as->tot_len = 0;
+	as->have    = 0;
+}
+
+/* Forget the pending record, if any; the buffer is kept for reuse */
+static void
+wal_assembler_reset(WALRecordAssembler *as)
+{
+	if (as->tot_len != 0)
+		as->lost_seq = as->seq;
+	as->tot_len = 0;
+	as->have    = 0;
 }
 
 /*
- * validate_wal_segment_records
- *
- * Read the WAL segment at seg_path page by page and validate the CRC32C of
- * every XLogRecord that fits entirely within one page.
+ * Walk the XLogRecords of one page ('n_read' bytes of it are present; the
+ * last page may be short) and check the CRC32C of each complete record.
  *
- * Records that span a page boundary (xl_tot_len > bytes remaining on the
- * current page) are intentionally skipped: their presence is already verified
- * by check_wal_availability(), and assembling cross-page fragments requires
- * significantly more complexity for rarely-encountered large records.
+ * A record that runs past the end of the page is collected in 'as' and
+ * checked once its last byte arrives, on a later page or in the next
+ * segment.  The continuation must be announced by XLP_FIRST_IS_CONTRECORD
+ * with a matching xlp_rem_len; otherwise the record is reported.  A pending
+ * record that runs into a zero-filled page (the unwritten tail of WAL) or
+ * one PostgreSQL marked as overwritten is dropped without error.
  *
- * Also skipped: records whose stored xl_crc == 0.  pg_probackup writes
- * synthetic WAL records without a checksum; treating them as errors would
- * produce false positives.
+ * With 'cont_only' set, only the continuation of the pending record is
+ * consumed and the records starting on this page are left alone.
  *
  * Returns the number of records whose CRC was actually checked.
  * Errors are appended to *result.
  */
-static int
-validate_wal_segment_records(const char *seg_path,
-							 const char *seg_filename,
-							 ValidationResult *result)
+static WAL_ALWAYS_INLINE int
+walk_wal_page(const uint8_t *page_buf, size_t n_read, int page_no,
+			  const char *seg_filename, WALRecordAssembler *as,
+			  bool cont_only, ValidationResult *result)
 {
-	FILE	   *fp;
-	uint8_t		hdr_peek[WAL_LONG_HDR_SIZE];
-	uint8_t    *page_buf;
-	size_t		n_read;
-	uint32_t	blcksz;
-	int			page_no = 0;
+	uint32_t	hdr_size   = (page_no == 0) ? WAL_LONG_HDR_SIZE : WAL_SHORT_HDR_SIZE;
+	uint16_t	xlp_magic;
+	uint16_t	xlp_info;
+	uint32_t	xlp_rem_len;
+	uint32_t	rec_off;
 	int			records_checked = 0;
 	char		msg[512];
 
-	fp = fopen(seg_path, "rb");
-	if (fp == NULL)
-		return 0;
-
-	/* Peek at the first page header to learn the block size. */
-	n_read = fread(hdr_peek, 1, sizeof(hdr_peek), fp);
-	if (n_read < (size_t) WAL_LONG_HDR_SIZE)
+	if (n_read < hdr_size)
 	{
-		fclose(fp);
-		return 0;	/* too small — already reported by validate_wal_segment_header */
+		wal_assembler_reset(as);
+		return 0;	/* truncated page header */
 	}
 
-	blcksz = read_u32le(hdr_peek, WAL_OFF_BLCKSZ);
-	if (blcksz < 512 || blcksz > 65536)
-	{
-		fclose(fp);
-		return 0;	/* invalid — already reported */
-	}
+	xlp_magic   = read_u16le(page_buf, WAL_OFF_MAGIC);
+	xlp_info    = read_u16le(page_buf, WAL_OFF_INFO);
+	xlp_rem_len = read_u32le(page_buf, WAL_OFF_REM_LEN);
 
-	page_buf = (uint8_t *) malloc(blcksz);
-	if (page_buf == NULL)
+	if (as->tot_len != 0)
 	{
-		fclose(fp);
-		return 0;
-	}
+		uint32_t	want = as->tot_len - as->have;
 
-	rewind(fp);
+		if (xlp_magic == 0)
+		{
+			log_debug("WAL segment %s page %d offset %u: record runs into "
+					  "zero-filled page, not checked",
+					  as->seg_filename, as->page_no, as->rec_off);
+			wal_assembler_reset(as);
+		}
+		else if (xlp_info & XLP_FIRST_IS_OVERWRITE_CONTRECORD)
+		{
+			log_debug("WAL segment %s page %d offset %u: record was "
+					  "overwritten, not checked",
+					  as->seg_filename, as->page_no, as->rec_off);
+			wal_assembler_reset(as);
+		}
+		else if (!(xlp_info & XLP_FIRST_IS_CONTRECORD) || xlp_rem_len != want)
+		{
+			snprintf(msg, sizeof(msg),
+					 "WAL segment %s page %d: continuation of record at "
+					 "%s page %d offset %u %s (xlp_rem_len=%u, expected %u)",
+					 seg_filename, page_no,
+					 as->seg_filename, as->page_no, as->rec_off,
+					 (xlp_info & XLP_FIRST_IS_CONTRECORD) ?
+					 "has wrong length" : "is missing",
+					 xlp_rem_len, want);
+			add_error(result, msg);
+			wal_assembler_reset(as);
+		}
+		else
+		{
+			uint32_t	n = (uint32_t) n_read - hdr_size;
 
-	while ((n_read = fread(page_buf, 1, blcksz, fp)) >= (size_t) WAL_LONG_HDR_SIZE)
-	{
-		uint32_t	hdr_size   = (page_no == 0) ? WAL_LONG_HDR_SIZE : WAL_SHORT_HDR_SIZE;
-		uint32_t	xlp_rem_len;
-		uint32_t	rec_off;
+			if (n > want)
+				n = want;
+			wal_assembler_add(as, page_buf + hdr_size, n);
 
-		if (n_read < hdr_size)
-			break;	/* truncated page header */
+			if (as->have < as->tot_len)
+				return 0;	/* the whole page belongs to the record */
 
-		xlp_rem_len = read_u32le(page_buf, WAL_OFF_REM_LEN);
+			check_wal_record_crc(as->buf, as->tot_len, as->seg_filename,
+								 as->page_no, as->rec_off, result);
+			records_checked++;
+			wal_assembler_done(as);
+		}
+	}
 
-		/*
-		 * First complete record on this page starts after the page header
-		 * plus any continuation bytes from a record that began on the previous
-		 * page, aligned up to the next 8-byte boundary.
-		 */
-		rec_off = WAL_MAXALIGN(hdr_size + xlp_rem_len);
+	if (cont_only)
+		return records_checked;
 
-		while (rec_off + (uint32_t) WAL_XLOG_HDR_SIZE <= (uint32_t) n_read)
-		{
-			const uint8_t *rec        = page_buf + rec_off;
-			uint32_t       xl_tot_len = read_u32le(rec, WAL_XLOG_OFF_TOTLEN);
-			uint32_t       bytes_avail;
-			uint32_t       xl_crc;
+	/*
+	 * First record starting on this page comes after the page header plus
+	 * any continuation bytes from a record that began on the previous page,
+	 * aligned up to the next 8-byte boundary.
+	 */
+	if ((size_t) hdr_size + xlp_rem_len >= n_read)
+		return records_checked;	/* page holds only continuation data */
+	rec_off = WAL_MAXALIGN(hdr_size + xlp_rem_len);
+
+	/* Records are MAXALIGN'd, so xl_tot_len is always on the page */
+	while (rec_off + 4 <= (uint32_t) n_read)
+	{
+		const uint8_t *rec        = page_buf + rec_off;
+		uint32_t       xl_tot_len = read_u32le(rec, WAL_XLOG_OFF_TOTLEN);
+		uint32_t       bytes_avail;
+
+		if (xl_tot_len == 0)
+			break;	/* zero-fill or end of valid records on this page */
 
-			if (xl_tot_len == 0)
-				break;	/* zero-fill or end of valid records on this page */
+		if (xl_tot_len < (uint32_t) WAL_XLOG_HDR_SIZE ||
+			xl_tot_len > WAL_MAX_RECORD_SIZE)
+		{
+			snprintf(msg, sizeof(msg),
+					 "WAL segment %s page %d offset %u: "
+					 "invalid xl_tot_len=%u (must be %d..%u)",
+					 seg_filename, page_no, rec_off,
+					 xl_tot_len, WAL_XLOG_HDR_SIZE, WAL_MAX_RECORD_SIZE);
+			add_error(result, msg);
+			break;
+		}
 
-			if (xl_tot_len < (uint32_t) WAL_XLOG_HDR_SIZE)
+		bytes_avail = (uint32_t) n_read - rec_off;
+		if (xl_tot_len > bytes_avail)
+		{
+			/* Record (possibly even its header) continues on the next page */
+			if (!wal_assembler_begin(as, xl_tot_len, seg_filename,
+									 page_no, rec_off))
 			{
 				snprintf(msg, sizeof(msg),
-						 "WAL segment %s page %d offset %u: "
-						 "invalid xl_tot_len=%u (minimum %d)",
-						 seg_filename, page_no, rec_off,
-						 xl_tot_len, WAL_XLOG_HDR_SIZE);
+						 "WAL segment %s page %d offset %u: out of memory "
+						 "assembling record (xl_tot_len=%u)",
+						 seg_filename, page_no, rec_off, xl_tot_len);
 				add_error(result, msg);
 				break;
 			}
+			wal_assembler_add(as, rec, bytes_avail);
+			break;
+		}
 
-			bytes_avail = (uint32_t) n_read - rec_off;
-			if (xl_tot_len > bytes_avail)
-				break;	/* record crosses page boundary — skip */
+		check_wal_record_crc(rec, xl_tot_len, seg_filename, page_no,
+							 rec_off, result);
+		records_checked++;
+		rec_off += WAL_MAXALIGN(xl_tot_len);
+	}
 
-			xl_crc = read_u32le(rec, WAL_XLOG_OFF_CRC);
+	return records_checked;
+}
 
-			if (xl_crc == 0)
-			{
-				/*
-				 * Stored CRC is zero → synthetic record (e.g. written by
-				 * pg_probackup).  Skip the checksum comparison.
-				 */
-				log_debug("WAL segment %s page %d offset %u: xl_crc=0, skipping",
-						  seg_filename, page_no, rec_off);
-			}
-			else
-			{
-				uint32_t crc = ~0U;
-				uint32_t computed_crc;
+/* walk_wal_page() for pages whose length is only known at run time */
+static int
+check_wal_page_records(const uint8_t *page_buf, size_t n_read, int page_no,
+					   const char *seg_filename, WALRecordAssembler *as,
+					   bool cont_only, ValidationResult *result)
+{
+	return walk_wal_page(page_buf, n_read, page_no, seg_filename, as,
+						 cont_only, result);
+}
 
-				/* PostgreSQL order: payload first, then header */
+/*
+ * The pages of one chunk of a segment of the standard geometry.  Full
+ * pages go through a copy of walk_wal_page() in which the page length is
+ * the constant WAL_STD_BLCKSZ, so its bounds fold away.  Zero-filled
+ * pages need nothing special: the walk stops at the first zero
+ * xl_tot_len, after reading the page header only.  Advances *page_no
+ * past the chunk's pages.
+ */
+static int
+check_wal_chunk_std(const uint8_t *chunk, size_t len, int *page_no,
+					const char *seg_filename, WALRecordAssembler *as,
+					ValidationResult *result)
+{
+	int		records_checked = 0;
+	size_t	off = 0;
 
-				/* 1. Bytes [24..xl_tot_len-1] — data payload */
-				if (xl_tot_len > (uint32_t) WAL_XLOG_HDR_SIZE)
-					crc = crc32c_update(crc,
-										rec + WAL_XLOG_HDR_SIZE,
-										xl_tot_len - WAL_XLOG_HDR_SIZE);
+	for (; off + WAL_STD_BLCKSZ <= len; off += WAL_STD_BLCKSZ, (*page_no)++)
+	{
+		records_checked += walk_wal_page(chunk + off, WAL_STD_BLCKSZ, *page_no,
+										 seg_filename, as, false, result);
+	}
 
-				/* 2. Bytes [0..19] — header fields before xl_crc */
-				crc = crc32c_update(crc, rec, 20);
+	/* A short last page: the segment is truncated */
+	if (off < len)
+	{
+		records_checked += check_wal_page_records(chunk + off, len - off,
+												  *page_no, seg_filename,
+												  as, false, result);
+		(*page_no)++;
+	}
+	return records_checked;
+}
 
-				computed_crc = ~crc;
+/*
+ * Read-buffer for validate_wal_segment(), reused across segments and
+ * borrowed from the buffer pool
+ */
+static uint8_t *
+alloc_wal_read_buf(void)
+{
+	return buffer_pool_get(WAL_READ_CHUNK);
+}
 
-				if (computed_crc != xl_crc)
-				{
-					snprintf(msg, sizeof(msg),
-							 "WAL segment %s page %d offset %u: "
-							 "CRC mismatch (stored=0x%08X, computed=0x%08X, "
-							 "xl_tot_len=%u)",
-							 seg_filename, page_no, rec_off,
-							 xl_crc, computed_crc, xl_tot_len);
-					add_error(result, msg);
-				}
-			}
+static void
+free_wal_read_buf(uint8_t *buf)
+{
+	buffer_pool_put(buf, WAL_READ_CHUNK);
+}
 
-			records_checked++;
-			rec_off += WAL_MAXALIGN(xl_tot_len);
+/*
+ * validate_wal_segment
+ *
+ * One sequential pass over a WAL segment: the file is opened once and read
+ * in WAL_READ_CHUNK pieces (a compressed segment is decompressed as it
+ * goes).  The first page's long header is validated; if it is clean, the
+ * CRC32C of every XLogRecord is checked as each chunk arrives — a corrupt
+ * header makes record offsets unreliable.  The length read is finally
+ * compared with xlp_seg_size, which also covers compressed segments, whose
+ * on-disk size says nothing about their content.
+ *
+ * 'as' carries a record that is still incomplete at the end of the
+ * previous segment; the caller resets it unless this segment directly
+ * follows that one.  On return it holds any record that continues into
+ * the next segment.
+ *
+ * NOTE: The current segment in a live pg_wal directory is being written
+ * to and will be smaller than xlp_seg_size.  Archives should only contain
+ * completed segments, so truncation is an error in that context.
+ *
+ * 'chunk' is a caller-owned buffer from alloc_wal_read_buf().
+ * Returns false, without reporting anything, if the file does not exist
+ * (check_wal_availability reports missing segments); true once the
+ * segment has been checked, with any problems added to *result.
+ */
+static bool
+validate_wal_segment(const char *seg_path,
+					 CompressionType compression,
+					 const char *seg_filename,
+					 uint32_t expected_tli,
+					 uint64_t expected_pageaddr,
+					 uint8_t *chunk,
+					 WALRecordAssembler *as,
+					 ValidationResult *result)
+{
+	WALSource	src = {NULL, NULL};
+	char		msg[512];
+
+	src.ds = decompress_open(seg_path, compression);
+	if (src.ds == NULL)
+	{
+		wal_assembler_reset(as);
+		if (errno == ENOENT)
+			return false;
+		snprintf(msg, sizeof(msg),
+				 "WAL segment %s: cannot open for header check", seg_filename);
+		add_error(result, msg);
+		return true;
+	}
+
+	validate_wal_source(&src, seg_filename, expected_tli, expected_pageaddr,
+						NULL, chunk, as, result);
+	decompress_close(src.ds);
+	return true;
+}
+
+/*
+ * validate_wal_segment() of a segment open as 'src'.  With 'seg' set, the
+ * segment size is not known beforehand: 'expected_pageaddr' is replaced
+ * by the start of 'seg' at the size the header gives, if that is valid.
+ * Returns the header's xlp_seg_size, 0 if the header could not be read.
+ */
+static uint32_t
+validate_wal_source(WALSource *src,
+					const char *seg_filename,
+					uint32_t expected_tli,
+					uint64_t expected_pageaddr,
+					const WALSegmentName *seg,
+					uint8_t *chunk,
+					WALRecordAssembler *as,
+					ValidationResult *result)
+{
+	ssize_t		got;
+	uint64_t	total = 0;
+	uint32_t	blcksz;
+	uint32_t	seg_size;
+	bool		header_ok;
+	int			page_no = 0;
+	int			records_checked = 0;
+	uint64_t	started = metrics_clock();
+	char		msg[512];
+
+	got = read_wal_bytes(src, chunk, WAL_READ_CHUNK);
+	if (got < 0)
+	{
+		wal_assembler_reset(as);
+		snprintf(msg, sizeof(msg),
+				 "WAL segment %s: cannot read header (corrupt compressed data?)",
+				 seg_filename);
+		add_error(result, msg);
+		return 0;
+	}
+	if (got < WAL_LONG_HDR_SIZE)
+	{
+		wal_assembler_reset(as);
+		snprintf(msg, sizeof(msg),
+				 "WAL segment %s: file too small to read header "
+				 "(got %zd bytes, need %d)",
+				 seg_filename, got, WAL_LONG_HDR_SIZE);
+		add_error(result, msg);
+		return 0;
+	}
+
+	if (seg != NULL)
+	{
+		uint32_t header_seg_size = read_u32le(chunk, WAL_OFF_SEG_SIZE);
+
+		if (valid_wal_seg_size(header_seg_size))
+			expected_pageaddr = wal_segment_number(seg, header_seg_size) *
+				(uint64_t) header_seg_size;
+	}
+
+	header_ok = check_wal_long_header(chunk, seg_filename,
+									  expected_tli, expected_pageaddr,
+									  &blcksz, &seg_size, result);
+	if (!header_ok)
+		wal_assembler_reset(as);
+
+	for (;;)
+	{
+		/* WAL_READ_CHUNK is a multiple of every valid block size */
+		if (header_ok && blcksz == WAL_STD_BLCKSZ && seg_size == WAL_STD_SEG_SIZE)
+			records_checked += check_wal_chunk_std(chunk, (size_t) got, &page_no,
+												   seg_filename, as, result);
+		else if (header_ok)
+		{
+			for (size_t off = 0; off < (size_t) got; off += blcksz)
+			{
+				size_t len = (size_t) got - off;
+
+				if (len > blcksz)
+					len = blcksz;
+				records_checked += check_wal_page_records(chunk + off, len,
+														  page_no,
+														  seg_filename,
+														  as, false,
+														  result);
+				page_no++;
+			}
+		}
+
+		total += (uint64_t) got;
+		if (got < WAL_READ_CHUNK)
+			break;	/* end of segment */
+
+		got = read_wal_bytes(src, chunk, WAL_READ_CHUNK);
+		if (got < 0)
+		{
+			snprintf(msg, sizeof(msg),
+					 "WAL segment %s: corrupt compressed data after %" PRIu64
+					 " bytes", seg_filename, total);
+			add_error(result, msg);
+			break;
+		}
+	}
+
+	if (got >= 0 && valid_wal_seg_size(seg_size) && total < (uint64_t) seg_size)
+	{
+		snprintf(msg, sizeof(msg),
+				 "WAL segment %s: truncated "
+				 "(%" PRIu64 " bytes, expected %u per header)",
+				 seg_filename, total, seg_size);
+		add_error(result, msg);
+	}
+
+	/* A record cut short here cannot continue in the next segment */
+	if (got < 0 || !valid_wal_seg_size(seg_size) || total != (uint64_t) seg_size)
+		wal_assembler_reset(as);
+
+	if (header_ok)
+		log_debug("WAL segment %s: %d record%s checked across %d page%s",
+				  seg_filename,
+				  records_checked, records_checked == 1 ? "" : "s",
+				  page_no, page_no == 1 ? "" : "s");
+
+	metrics_verified(METRIC_ALG_CRC32C, METRIC_TARGET_WAL, total,
+					 metrics_clock() - started);
+	metrics_count(METRIC_WAL_SEGMENTS_CHECKED, 1);
+	metrics_count(METRIC_WAL_RECORDS_CHECKED, (uint64_t) records_checked);
+	return seg_size;
+}
+
+/*
+ * check_wal_segment_header
+ *
+ * The header-only counterpart of validate_wal_segment(): just the first
+ * WAL_LONG_HDR_SIZE bytes are read and checked, and no record is.  An
+ * uncompressed segment's length is taken from stat() and still compared
+ * with xlp_seg_size; a compressed one's cannot be known without
+ * decompressing it all, so it is not.
+ *
+ * Returns false, without reporting anything, if the file does not exist;
+ * true once the header has been checked.
+ */
+static bool
+check_wal_segment_header(const char *seg_path,
+						 CompressionType compression,
+						 const char *seg_filename,
+						 uint32_t expected_tli,
+						 uint64_t expected_pageaddr,
+						 ValidationResult *result)
+{
+	WALSource	src = {NULL, NULL};
+	struct stat	st;
+	bool		have_size = false;
+	char		msg[512];
+
+	if (compression == COMPRESSION_NONE)
+	{
+		if (stat(seg_path, &st) != 0)
+		{
+			if (errno == ENOENT)
+				return false;
+		}
+		else
+			have_size = true;
+	}
+
+	src.ds = decompress_open(seg_path, compression);
+	if (src.ds == NULL)
+	{
+		if (errno == ENOENT)
+			return false;
+		snprintf(msg, sizeof(msg),
+				 "WAL segment %s: cannot open for header check", seg_filename);
+		add_error(result, msg);
+		return true;
+	}
+	check_wal_source_header(&src, seg_filename, expected_tli, expected_pageaddr,
+							have_size ? (int64_t) st.st_size : -1, result);
+	decompress_close(src.ds);
+	return true;
+}
+
+/*
+ * check_wal_segment_header() of a segment open as 'src', whose length is
+ * 'length' bytes (-1 if unknown)
+ */
+static void
+check_wal_source_header(WALSource *src,
+						const char *seg_filename,
+						uint32_t expected_tli,
+						uint64_t expected_pageaddr,
+						int64_t length,
+						ValidationResult *result)
+{
+	uint8_t		hdr[WAL_LONG_HDR_SIZE];
+	ssize_t		got;
+	uint32_t	blcksz;
+	uint32_t	seg_size;
+	char		msg[512];
+
+	got = read_wal_bytes(src, hdr, sizeof(hdr));
+	if (got < 0)
+	{
+		snprintf(msg, sizeof(msg),
+				 "WAL segment %s: cannot read header (corrupt compressed data?)",
+				 seg_filename);
+		add_error(result, msg);
+		return;
+	}
+	if (got < WAL_LONG_HDR_SIZE)
+	{
+		snprintf(msg, sizeof(msg),
+				 "WAL segment %s: file too small to read header "
+				 "(got %zd bytes, need %d)",
+				 seg_filename, got, WAL_LONG_HDR_SIZE);
+		add_error(result, msg);
+		return;
+	}
+
+	if (check_wal_long_header(hdr, seg_filename, expected_tli, expected_pageaddr,
+							  &blcksz, &seg_size, result) &&
+		length >= 0 && (uint64_t) length < (uint64_t) seg_size)
+	{
+		snprintf(msg, sizeof(msg),
+				 "WAL segment %s: truncated "
+				 "(%" PRIu64 " bytes, expected %u per header)",
+				 seg_filename, (uint64_t) length, seg_size);
+		add_error(result, msg);
+	}
+
+	metrics_count(METRIC_WAL_SEGMENTS_CHECKED, 1);
+}
+
+/*
+ * Complete a record left pending at the end of a segment by reading the
+ * start of the next one ('seg_filename', found at 'seg_path').  Only the
+ * continuation is consumed: the segment itself is validated separately,
+ * by whichever worker owns it.
+ */
+static void
+finish_wal_record(const char *seg_path,
+				  CompressionType compression,
+				  const char *seg_filename,
+				  uint8_t *chunk,
+				  WALRecordAssembler *as,
+				  ValidationResult *result)
+{
+	WALSource	src = {NULL, NULL};
+
+	/* Not fetched with this worker's batch when it comes from object storage */
+	src.ds = storage_fetch(&seg_path, 1) ? decompress_open(seg_path, compression) : NULL;
+	if (src.ds == NULL)
+	{
+		storage_release(&seg_path, 1);
+		wal_assembler_reset(as);
+		return;
+	}
+	finish_wal_source_record(&src, seg_filename, chunk, as, result);
+	decompress_close(src.ds);
+	storage_release(&seg_path, 1);
+}
+
+/* finish_wal_record() from the start of a segment open as 'src' */
+static void
+finish_wal_source_record(WALSource *src,
+						 const char *seg_filename,
+						 uint8_t *chunk,
+						 WALRecordAssembler *as,
+						 ValidationResult *result)
+{
+	ssize_t		got;
+	uint32_t	blcksz;
+	int			page_no = 0;
+
+	got = read_wal_bytes(src, chunk, WAL_READ_CHUNK);
+	blcksz = got >= WAL_LONG_HDR_SIZE ? read_u32le(chunk, WAL_OFF_BLCKSZ) : 0;
+
+	while (got > 0 && valid_wal_blcksz(blcksz) && as->tot_len != 0)
+	{
+		for (size_t off = 0; off < (size_t) got && as->tot_len != 0;
+			 off += blcksz)
+		{
+			size_t len = (size_t) got - off;
+
+			if (len > blcksz)
+				len = blcksz;
+			check_wal_page_records(chunk + off, len, page_no, seg_filename,
+								   as, true, result);
+			page_no++;
+		}
+
+		if (got < WAL_READ_CHUNK)
+			break;
+		got = read_wal_bytes(src, chunk, WAL_READ_CHUNK);
+	}
+
+	wal_assembler_reset(as);
+}
+
+/* True if 'next' is the segment right after 'prev' on the same timeline */
+static bool
+wal_segment_follows(const WALSegmentName *prev, const WALSegmentName *next,
+					uint32_t seg_size)
+{
+	return prev->timeline == next->timeline &&
+		wal_segment_number(next, seg_size) == wal_segment_number(prev, seg_size) + 1;
+}
+
+/* -----------------------------------------------------------------------
+ * Parallel segment validation
+ * ----------------------------------------------------------------------- */
+
+/* Segments a worker claims at a time */
+#define WAL_BATCH_SIZE  8
+
+typedef struct {
+	WALArchiveInfo		   *wal_info;
+	const WALSegmentName   *segs;
+	int						count;
+	uint32_t				seg_size;
+	ValidationResult	   *batches;	/* one per batch, merged in order */
+	const bool			   *skip;		/* cached as clean, not re-read; or NULL */
+	const bool			   *unsampled;	/* left out by --sample; or NULL */
+	bool				   *clean;		/* out: verdict per segment, if skip set */
+	int						next;		/* next unclaimed segment, under lock */
+	int						checked;	/* segments found on disk, under lock */
+	pthread_mutex_t			lock;
+} WALSegmentQueue;
+
+/*
+ * A segment's verdict also covers the record that runs from its end into
+ * the next segment.  Once that record has been followed, mark the
+ * segment unclean unless the record was completed with no new errors.
+ */
+static void
+settle_carried_record(WALSegmentQueue *queue, int from, uint64_t from_seq,
+					  const WALRecordAssembler *as, bool new_errors)
+{
+	if (queue->clean == NULL || from < 0)
+		return;
+	if (new_errors || as->lost_seq == from_seq ||
+		(as->tot_len != 0 && as->seq == from_seq))
+		queue->clean[from] = false;
+}
+
+/*
+ * Claim batches of consecutive segments until none are left.  Each batch
+ * has its own result, so no locking is needed while validating; each
+ * worker has its own record assembler, and a read buffer for the batch.
+ *
+ * A record that crosses from one segment into the next is assembled as
+ * the batch is walked.  One that crosses out of the batch's last segment
+ * is finished by reading the head of the following segment here, so its
+ * errors are reported with the segment where the record starts.  The same
+ * is done for a segment skipped because the cache has it, or because it
+ * is not in this run's sample.
+ */
+static void *
+wal_segment_worker(void *arg)
+{
+	WALSegmentQueue *queue = arg;
+	uint8_t			*chunk;
+	WALRecordAssembler as;
+	int				 found = 0;
+	int				 pending;		/* segment whose tail record is in 'as' */
+	char			 batch_paths[WAL_BATCH_SIZE][PATH_MAX];
+	const char		*fetched[WAL_BATCH_SIZE];
+	int				 nfetched;
+
+	memset(&as, 0, sizeof(as));
+	metrics_set_thread_phase(METRIC_PHASE_WAL);
+
+	for (;;)
+	{
+		int		first, last;
+		ValidationResult *res;
+
+		pthread_mutex_lock(&queue->lock);
+		queue->checked += found;
+		first = queue->next;
+		queue->next += WAL_BATCH_SIZE;
+		pthread_mutex_unlock(&queue->lock);
+
+		if (first >= queue->count || validation_stop_requested())
+			break;
+
+		last = first + WAL_BATCH_SIZE;
+		if (last > queue->count)
+			last = queue->count;
+		res = &queue->batches[first / WAL_BATCH_SIZE];
+		found = 0;
+		pending = -1;
+		wal_assembler_reset(&as);
+
+		/*
+		 * One reader slot per batch; see validation_io_acquire().  The
+		 * read buffer is borrowed for the batch too, so that under a
+		 * --memory-limit the workers take turns.
+		 */
+		validation_io_acquire();
+		chunk = alloc_wal_read_buf();
+
+		/* From object storage, the segments to read are fetched together */
+		nfetched = 0;
+		for (int i = first; i < last; i++)
+		{
+			CompressionType	compression;
+
+			if ((queue->skip != NULL && queue->skip[i]) ||
+				(queue->unsampled != NULL && queue->unsampled[i]))
+				continue;
+			locate_wal_segment(queue->wal_info, &queue->segs[i], batch_paths[nfetched],
+							   sizeof(batch_paths[0]), &compression);
+			fetched[nfetched] = batch_paths[nfetched];
+			nfetched++;
+		}
+		if (nfetched > 0 && !storage_fetch(fetched, nfetched))
+		{
+			char first_name[32], last_name[32], msg[128];
+
+			format_wal_filename(&queue->segs[first], first_name, sizeof(first_name));
+			format_wal_filename(&queue->segs[last - 1], last_name, sizeof(last_name));
+			snprintf(msg, sizeof(msg),
+					 "WAL segments %s to %s: cannot fetch from object storage, not checked",
+					 first_name, last_name);
+			add_error(res, msg);
+			storage_release(fetched, nfetched);
+			free_wal_read_buf(chunk);
+			validation_io_release();
+			continue;
+		}
+
+		for (int i = first; i < last; i++)
+		{
+			const WALSegmentName *seg = &queue->segs[i];
+			char			seg_filename[32];
+			char			seg_path[PATH_MAX];
+			CompressionType	compression;
+			int				errs = res->error_count;
+			int				from;
+			uint64_t		from_seq;
+
+			/* Expected page address = segment_number * segment_size */
+			uint64_t expected_pageaddr =
+				wal_segment_number(seg, queue->seg_size) * (uint64_t) queue->seg_size;
+
+			format_wal_filename(seg, seg_filename, sizeof(seg_filename));
+
+			if (i > first &&
+				!wal_segment_follows(&queue->segs[i - 1], seg, queue->seg_size))
+				wal_assembler_reset(&as);
+			from = as.tot_len != 0 ? pending : -1;
+			from_seq = as.seq;
+			if (pending >= 0 && from < 0 && queue->clean != NULL)
+				queue->clean[pending] = false;	/* tail never followed */
+
+			if (chunk == NULL)
+			{
+				char msg[128];
+
+				snprintf(msg, sizeof(msg),
+						 "WAL segment %s: out of memory, not checked",
+						 seg_filename);
+				add_error(res, msg);
+				continue;
+			}
+
+			locate_wal_segment(queue->wal_info, seg, seg_path,
+							   sizeof(seg_path), &compression);
+
+			if (queue->skip != NULL && queue->skip[i])
+			{
+				/* Verified by an earlier run; only finish the carried record */
+				if (as.tot_len != 0)
+					finish_wal_record(seg_path, compression, seg_filename,
+									  chunk, &as, res);
+				queue->clean[i] = true;
+				found++;
+			}
+			else if (queue->unsampled != NULL && queue->unsampled[i])
+			{
+				/* Left for a later run; never counted as clean */
+				if (as.tot_len != 0)
+					finish_wal_record(seg_path, compression, seg_filename,
+									  chunk, &as, res);
+			}
+			/* Missing segments are skipped — check_wal_availability reports them */
+			else if (validate_wal_segment(seg_path, compression, seg_filename,
+										  seg->timeline, expected_pageaddr,
+										  chunk, &as, res))
+			{
+				if (queue->clean != NULL)
+					queue->clean[i] = res->error_count == errs;
+				found++;
+			}
+
+			settle_carried_record(queue, from, from_seq, &as,
+								  res->error_count != errs);
+			pending = as.tot_len != 0 ? i : -1;
+		}
+
+		/* Record crossing into the next batch's first segment */
+		if (as.tot_len != 0 && last < queue->count &&
+			wal_segment_follows(&queue->segs[last - 1], &queue->segs[last],
+								queue->seg_size))
+		{
+			char			seg_filename[32];
+			char			seg_path[PATH_MAX];
+			CompressionType	compression;
+			int				errs = res->error_count;
+			uint64_t		from_seq = as.seq;
+
+			format_wal_filename(&queue->segs[last], seg_filename,
+								sizeof(seg_filename));
+			locate_wal_segment(queue->wal_info, &queue->segs[last], seg_path,
+							   sizeof(seg_path), &compression);
+			finish_wal_record(seg_path, compression, seg_filename, chunk,
+							  &as, res);
+			settle_carried_record(queue, pending, from_seq, &as,
+								  res->error_count != errs);
+		}
+		else if (pending >= 0 && queue->clean != NULL)
+			queue->clean[pending] = false;	/* tail never followed */
+
+		storage_release(fetched, nfetched);
+		free_wal_read_buf(chunk);
+		validation_io_release();
+	}
+
+	free(as.buf);
+	return NULL;
+}
+
+/*
+ * Look the segments up in the verification cache.  A cached segment is
+ * skipped unless the next one must be read: the record running from its
+ * end into a changed or new segment has to be checked again.
+ */
+static void
+plan_cached_segments(WALCache *cache, WALArchiveInfo *wal_info,
+					 const WALSegmentName *segs, int count, uint32_t seg_size,
+					 struct stat *st, bool *present, bool *skip)
+{
+	char			seg_path[PATH_MAX];
+	CompressionType	compression;
+	int				skipped = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		locate_wal_segment(wal_info, &segs[i], seg_path, sizeof(seg_path),
+						   &compression);
+		present[i] = stat(seg_path, &st[i]) == 0;
+		skip[i] = present[i] && wal_cache_lookup(cache, seg_path, &st[i]);
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		if (skip[i] && i + 1 < count && !skip[i + 1] &&
+			wal_segment_follows(&segs[i], &segs[i + 1], seg_size))
+			skip[i] = false;
+		if (skip[i])
+			skipped++;
+	}
+
+	log_debug("WAL cache: %d of %d segment%s unchanged since an earlier run",
+			  skipped, count, count == 1 ? "" : "s");
+}
+
+/*
+ * The segments another --shard reads, in runs of SHARD_WAL_RANGE.
+ * Returns NULL (all are ours) when not sharding or out of memory.
+ */
+static bool *
+plan_sharded_segments(const WALSegmentName *segs, int count, uint32_t seg_size)
+{
+	bool	   *other;
+	int			owned = 0;
+
+	if (!validation_shard_active())
+		return NULL;
+	other = calloc((size_t) count, sizeof(bool));
+	if (other == NULL)
+		return NULL;
+
+	for (int i = 0; i < count; i++)
+	{
+		other[i] = !shard_owns_wal_segment(segs[i].timeline,
+										   wal_segment_number(&segs[i], seg_size));
+		if (!other[i])
+			owned++;
+	}
+
+	log_debug("WAL shard %d/%d: reading %d of %d segment%s",
+			  validation_shard_index(), validation_shard_count(),
+			  owned, count, count == 1 ? "" : "s");
+	return other;
+}
+
+/*
+ * Choose the segments this run reads under --sample, among those not
+ * left to another shard ('other', or NULL).  Cached segments count as
+ * covered; without a cache the sizes are not looked up and every
+ * segment weighs 'seg_size'.  Returns NULL (read everything) when not
+ * sampling or out of memory.
+ */
+static bool *
+plan_sampled_segments(const WALSegmentName *segs, int count, uint32_t seg_size,
+					  const struct stat *st, const bool *present,
+					  const bool *skip, const bool *other)
+{
+	SampleItem *items;
+	int		   *index;
+	bool	   *unsampled;
+	int			nitems = 0;
+	int			selected = 0;
+
+	if (!validation_sample_active())
+		return NULL;
+
+	items = malloc(sizeof(SampleItem) * (size_t) count);
+	index = malloc(sizeof(int) * (size_t) count);
+	unsampled = calloc((size_t) count, sizeof(bool));
+	if (items == NULL || index == NULL || unsampled == NULL)
+	{
+		free(items);
+		free(index);
+		free(unsampled);
+		return NULL;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		char seg_filename[32];
+
+		if (other != NULL && other[i])
+		{
+			unsampled[i] = true;
+			continue;
+		}
+		format_wal_filename(&segs[i], seg_filename, sizeof(seg_filename));
+		items[nitems].key = sample_key(seg_filename);
+		items[nitems].bytes = present != NULL ? (present[i] ? (uint64_t) st[i].st_size : 0)
+			: seg_size;
+		items[nitems].cached = skip != NULL && skip[i];
+		index[nitems++] = i;
+	}
+
+	sample_select(items, nitems, SAMPLE_WAL_SEGMENTS);
+
+	for (int i = 0; i < nitems; i++)
+	{
+		unsampled[index[i]] = !items[i].selected && !items[i].cached;
+		if (items[i].selected)
+			selected++;
+	}
+	free(items);
+	free(index);
+
+	log_debug("WAL sample: reading %d of %d segment%s",
+			  selected, nitems, nitems == 1 ? "" : "s");
+	return unsampled;
+}
+
+/* Remember the segments found clean in this run */
+static void
+store_clean_segments(WALCache *cache, WALArchiveInfo *wal_info,
+					 const WALSegmentName *segs, int count,
+					 const struct stat *st, const bool *present,
+					 const bool *clean)
+{
+	char			seg_path[PATH_MAX];
+	CompressionType	compression;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (!present[i] || !clean[i])
+			continue;
+		locate_wal_segment(wal_info, &segs[i], seg_path, sizeof(seg_path),
+						   &compression);
+		wal_cache_store(cache, seg_path, &st[i]);
+	}
+}
+
+/*
+ * Header-only mode (validation_set_wal_headers_only()): a segment costs
+ * one small read, so latency rather than bandwidth bounds the sweep.
+ * Many more readers than --jobs are kept busy, and each claims a larger
+ * batch of segments at a time.
+ */
+#define WAL_HEADER_BATCH_SIZE  64
+#define WAL_HEADER_READ_DEPTH  32
+
+static bool wal_headers_only = false;
+
+void
+validation_set_wal_headers_only(bool enabled)
+{
+	wal_headers_only = enabled;
+}
+
+bool
+validation_wal_headers_only(void)
+{
+	return wal_headers_only;
+}
+
+/*
+ * Check the headers of batches of segments until none are left.  No
+ * record crosses from one segment into the next here, so the segments
+ * are independent; the reads are too small to take a reader slot.
+ */
+static void *
+wal_header_worker(void *arg)
+{
+	WALSegmentQueue *queue = arg;
+	int				 found = 0;
+
+	metrics_set_thread_phase(METRIC_PHASE_WAL);
+
+	for (;;)
+	{
+		int		first, last;
+		ValidationResult *res;
+
+		pthread_mutex_lock(&queue->lock);
+		queue->checked += found;
+		first = queue->next;
+		queue->next += WAL_HEADER_BATCH_SIZE;
+		pthread_mutex_unlock(&queue->lock);
+
+		if (first >= queue->count || validation_stop_requested())
+			break;
+
+		last = first + WAL_HEADER_BATCH_SIZE;
+		if (last > queue->count)
+			last = queue->count;
+		res = &queue->batches[first / WAL_HEADER_BATCH_SIZE];
+		found = 0;
+
+		for (int i = first; i < last; i++)
+		{
+			const WALSegmentName *seg = &queue->segs[i];
+			char			seg_filename[32];
+			char			seg_path[PATH_MAX];
+			CompressionType	compression;
+			uint64_t expected_pageaddr =
+				wal_segment_number(seg, queue->seg_size) * (uint64_t) queue->seg_size;
+
+			if (!shard_owns_wal_segment(seg->timeline,
+										wal_segment_number(seg, queue->seg_size)))
+				continue;
+			format_wal_filename(seg, seg_filename, sizeof(seg_filename));
+			locate_wal_segment(queue->wal_info, seg, seg_path,
+							   sizeof(seg_path), &compression);
+			if (check_wal_segment_header(seg_path, compression, seg_filename,
+										 seg->timeline, expected_pageaddr, res))
+				found++;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * validate_wal_segments() in header-only mode.  Every segment is read
+ * (--sample does not apply: the reads are cheap), and none is recorded
+ * in the verification cache, which vouches for record CRCs as well.
+ */
+static int
+validate_wal_segment_headers(WALArchiveInfo *wal_info, const WALSegmentName *segs,
+							 int count, uint32_t seg_size, ValidationResult *result)
+{
+	WALSegmentQueue queue;
+	pthread_t	   *threads = NULL;
+	int				nbatches = (count + WAL_HEADER_BATCH_SIZE - 1) / WAL_HEADER_BATCH_SIZE;
+	int				readers = validation_get_jobs();
+	int				started = 0;
+	MetricSpan		span;
+
+	memset(&queue, 0, sizeof(queue));
+	queue.wal_info = wal_info;
+	queue.segs     = segs;
+	queue.count    = count;
+	queue.seg_size = seg_size;
+	queue.batches  = calloc((size_t) nbatches, sizeof(ValidationResult));
+	if (queue.batches == NULL)
+	{
+		add_error(result, "Out of memory while checking WAL headers");
+		return 0;
+	}
+	metrics_phase_begin(&span, METRIC_PHASE_WAL);
+	pthread_mutex_init(&queue.lock, NULL);
+
+	if (readers < WAL_HEADER_READ_DEPTH)
+		readers = WAL_HEADER_READ_DEPTH;
+	if (readers > nbatches)
+		readers = nbatches;
+	if (readers > 1)
+		threads = malloc(sizeof(pthread_t) * (readers - 1));
+	if (threads != NULL)
+	{
+		for (int t = 0; t < readers - 1; t++)
+		{
+			if (pthread_create(&threads[started], NULL,
+							   wal_header_worker, &queue) != 0)
+				break;
+			started++;
+		}
+	}
+
+	wal_header_worker(&queue);
+
+	for (int t = 0; t < started; t++)
+		pthread_join(threads[t], NULL);
+	free(threads);
+	pthread_mutex_destroy(&queue.lock);
+
+	for (int b = 0; b < nbatches; b++)
+	{
+		ValidationResult *res = &queue.batches[b];
+
+		if (res->error_count > 0)
+			result->status = BACKUP_STATUS_ERROR;
+		validation_result_merge(result, res);
+		validation_result_clear(res);
+	}
+	free(queue.batches);
+
+	log_debug("WAL header check: %d segment%s on %d reader(s), records not read",
+			  count, count == 1 ? "" : "s", started + 1);
+	metrics_phase_end(&span);
+
+	return queue.checked;
+}
+
+/* Index of 'seg' in the sorted 'segs', or -1 */
+static int
+find_wanted_segment(const WALSegmentName *segs, int count, const WALSegmentName *seg)
+{
+	int lo = 0;
+	int hi = count - 1;
+
+	while (lo <= hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+		const WALSegmentName *m = &segs[mid];
+		int cmp;
+
+		if (m->timeline != seg->timeline)
+			cmp = m->timeline < seg->timeline ? -1 : 1;
+		else if (m->log_id != seg->log_id)
+			cmp = m->log_id < seg->log_id ? -1 : 1;
+		else if (m->seg_id != seg->seg_id)
+			cmp = m->seg_id < seg->seg_id ? -1 : 1;
+		else
+			return mid;
+
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return -1;
+}
+
+/*
+ * validate_wal_segments() for an archive that is a tar file (in_tar):
+ * the pg_wal.tar* of a tar-format stream backup.  The tar is read once,
+ * in member order, and each wanted segment is checked as its data goes
+ * by, without extracting anything.  A record that runs from one member
+ * into the next is followed as between files, so members written in
+ * segment order (as pg_basebackup writes them) are checked as a
+ * directory would be.  In header-only mode the rest of each member is
+ * skipped, by seeking when the tar is not compressed, and its length is
+ * the one the tar header records.
+ *
+ * With --shard only this shard's segments are checked.  The verification
+ * cache and --sample do not apply: the archive is read through either way.
+ */
+static int
+validate_wal_tar_segments(WALArchiveInfo *wal_info, const WALSegmentName *segs,
+						  int count, uint32_t seg_size, ValidationResult *result)
+{
+	TarReader	   *tr;
+	TarMember		member;
+	WALSource		src = {NULL, NULL};
+	WALRecordAssembler as;
+	WALSegmentName	prev;
+	bool			have_prev = false;
+	bool		   *done;
+	uint8_t		   *chunk = NULL;
+	int				checked = 0;
+	int				rc = 0;
+	MetricSpan		span;
+	char			msg[PATH_MAX + 128];
+
+	done = calloc((size_t) count, sizeof(bool));
+	if (!wal_headers_only)
+		chunk = alloc_wal_read_buf();
+	if (done == NULL || (!wal_headers_only && chunk == NULL))
+	{
+		free(done);
+		free_wal_read_buf(chunk);
+		add_error(result, "Out of memory while checking WAL headers");
+		return 0;
+	}
+
+	tr = tar_reader_open(wal_info->archive_path);
+	if (tr == NULL)
+	{
+		snprintf(msg, sizeof(msg), "WAL archive %s: cannot open tar file",
+				 wal_info->archive_path);
+		add_error(result, msg);
+		free(done);
+		free_wal_read_buf(chunk);
+		return 0;
+	}
+
+	memset(&as, 0, sizeof(as));
+	src.tar = tr;
+	metrics_phase_begin(&span, METRIC_PHASE_WAL);
+	validation_io_acquire();
+
+	while (!validation_stop_requested() && (rc = tar_reader_next(tr, &member)) == 1)
+	{
+		WALSegmentName	seg;
+		const char	   *suffix;
+		char			seg_filename[32];
+		int				idx;
+		uint64_t		segno;
+		bool			follows;
+
+		if (member.type != TAR_TYPE_REGULAR || strchr(member.name, '/') != NULL ||
+			!parse_wal_segment_file(member.name, &seg, &suffix) || suffix[0] != '\0')
+			continue;
+
+		follows = have_prev && wal_segment_follows(&prev, &seg, seg_size);
+		prev = seg;
+		have_prev = true;
+		if (!follows)
+			wal_assembler_reset(&as);
+
+		format_wal_filename(&seg, seg_filename, sizeof(seg_filename));
+		segno = wal_segment_number(&seg, seg_size);
+		idx = find_wanted_segment(segs, count, &seg);
+
+		if (idx < 0 || done[idx] || !shard_owns_wal_segment(seg.timeline, segno))
+		{
+			/* Not checked here; only finish a record carried into it */
+			if (as.tot_len != 0)
+				finish_wal_source_record(&src, seg_filename, chunk, &as, result);
+			continue;
+		}
+		done[idx] = true;
+		checked++;
+
+		if (wal_headers_only)
+			check_wal_source_header(&src, seg_filename, seg.timeline,
+									segno * (uint64_t) seg_size,
+									(int64_t) member.size, result);
+		else
+			validate_wal_source(&src, seg_filename, seg.timeline,
+								segno * (uint64_t) seg_size, NULL, chunk, &as,
+								result);
+	}
+	if (rc < 0)
+	{
+		snprintf(msg, sizeof(msg),
+				 "WAL archive %s: corrupt tar file, segments after the damage not checked",
+				 wal_info->archive_path);
+		add_error(result, msg);
+	}
+
+	validation_io_release();
+	tar_reader_close(tr);
+	if (result->error_count > 0)
+		result->status = BACKUP_STATUS_ERROR;
+
+	log_debug("WAL validation: %d of %d segment%s read from tar %s",
+			  checked, count, count == 1 ? "" : "s", wal_info->archive_path);
+	metrics_phase_end(&span);
+
+	free(as.buf);
+	free_wal_read_buf(chunk);
+	free(done);
+	return checked;
+}
+
+/*
+ * Validate the given segments (header, record CRCs, length) on up to
+ * validation_get_jobs() threads.  The calling thread works as one of
+ * them; if a thread cannot be created the others pick up its share.
+ * Errors are added to 'result' in segment order, whatever thread found
+ * them.  Returns the number of segments present on disk.
+ *
+ * With a cache directory set, segments verified clean by an earlier run
+ * and unchanged since are not read again.  'whole_archive' tells that
+ * 'segs' is the full archive, so cache entries for segments that are gone
+ * can be dropped.  With --shard only this shard's segments are read,
+ * and under --sample only this run's share of those not cached.  In header-only mode only the first page header of
+ * each segment is read (validate_wal_segment_headers()).  WAL in a tar
+ * file is read in one pass (validate_wal_tar_segments()).
+ */
+static int
+validate_wal_segments(WALArchiveInfo *wal_info, const WALSegmentName *segs,
+					  int count, uint32_t seg_size, bool whole_archive,
+					  ValidationResult *result)
+{
+	WALSegmentQueue queue;
+	pthread_t	   *threads = NULL;
+	int				nbatches = (count + WAL_BATCH_SIZE - 1) / WAL_BATCH_SIZE;
+	int				jobs = validation_get_jobs();
+	int				started = 0;
+	WALCache	   *cache;
+	struct stat	   *st = NULL;
+	bool		   *present = NULL;
+	bool		   *skip = NULL;
+	bool		   *clean = NULL;
+	bool		   *unsampled;
+	bool		   *other;
+	MetricSpan		span;
+
+	if (count <= 0)
+		return 0;
+	if (wal_info->in_tar)
+		return validate_wal_tar_segments(wal_info, segs, count, seg_size, result);
+	if (wal_headers_only)
+		return validate_wal_segment_headers(wal_info, segs, count, seg_size,
+											result);
+
+	queue.wal_info = wal_info;
+	queue.segs     = segs;
+	queue.count    = count;
+	queue.seg_size = seg_size;
+	queue.next     = 0;
+	queue.checked  = 0;
+	queue.skip     = NULL;
+	queue.clean    = NULL;
+	queue.batches  = calloc((size_t) nbatches, sizeof(ValidationResult));
+	if (queue.batches == NULL)
+	{
+		add_error(result, "Out of memory while checking WAL headers");
+		return 0;
+	}
+	metrics_phase_begin(&span, METRIC_PHASE_WAL);
+
+	cache = wal_cache_open(wal_info->archive_path, seg_size);
+	if (cache != NULL)
+	{
+		st      = malloc(sizeof(struct stat) * (size_t) count);
+		present = calloc((size_t) count, sizeof(bool));
+		skip    = calloc((size_t) count, sizeof(bool));
+		clean   = calloc((size_t) count, sizeof(bool));
+		if (st == NULL || present == NULL || skip == NULL || clean == NULL)
+		{
+			/* Validate everything, uncached */
+			wal_cache_close(cache, false);
+			cache = NULL;
+		}
+		else
+		{
+			plan_cached_segments(cache, wal_info, segs, count, seg_size,
+								 st, present, skip);
+			queue.skip  = skip;
+			queue.clean = clean;
+		}
+	}
+	other = plan_sharded_segments(segs, count, seg_size);
+	unsampled = plan_sampled_segments(segs, count, seg_size, st,
+									  cache != NULL ? present : NULL,
+									  cache != NULL ? skip : NULL, other);
+	queue.unsampled = unsampled != NULL ? unsampled : other;
+	pthread_mutex_init(&queue.lock, NULL);
+
+	if (jobs > nbatches)
+		jobs = nbatches;
+	if (jobs > 1)
+		threads = malloc(sizeof(pthread_t) * (jobs - 1));
+
+	if (threads != NULL)
+	{
+		for (int t = 0; t < jobs - 1; t++)
+		{
+			if (pthread_create(&threads[started], NULL,
+							   wal_segment_worker, &queue) != 0)
+				break;
+			started++;
 		}
-
-		page_no++;
 	}
 
-	free(page_buf);
-	fclose(fp);
+	wal_segment_worker(&queue);
 
-	log_debug("WAL segment %s: %d record%s checked across %d page%s",
-			  seg_filename,
-			  records_checked, records_checked == 1 ? "" : "s",
-			  page_no, page_no == 1 ? "" : "s");
+	for (int t = 0; t < started; t++)
+		pthread_join(threads[t], NULL);
+	free(threads);
+	pthread_mutex_destroy(&queue.lock);
 
-	return records_checked;
+	/* Merge per-batch results in segment order */
+	for (int b = 0; b < nbatches; b++)
+	{
+		ValidationResult *res = &queue.batches[b];
+
+		if (res->error_count > 0)
+			result->status = BACKUP_STATUS_ERROR;
+		validation_result_merge(result, res);
+		validation_result_clear(res);
+	}
+	free(queue.batches);
+
+	if (cache != NULL)
+	{
+		store_clean_segments(cache, wal_info, segs, count, st, present, clean);
+		wal_cache_close(cache, whole_archive);
+	}
+	free(st);
+	free(present);
+	free(skip);
+	free(clean);
+	free(unsampled);
+	free(other);
+
+	log_debug("WAL validation: %d segment%s on %d thread(s)",
+			  count, count == 1 ? "" : "s", started + 1);
+	metrics_phase_end(&span);
+
+	return queue.checked;
 }
 
 /* WAL gap (a contiguous range of missing segments within a timeline) */
@@ -618,12 +1916,59 @@ typedef struct WALGap {
 /* Forward declaration — defined after check_wal_continuity */
 static void free_wal_gaps(WALGap *gaps);
 
+/*
+ * The runs of consecutive segments of 'wal_info': its own, or built into
+ * *owned (to be freed by the caller) for an archive assembled without
+ * them.  False on out-of-memory.
+ */
+static bool
+wal_archive_runs(const WALArchiveInfo *wal_info, uint32_t seg_size,
+				 const WALSegmentRange **ranges, int *nranges,
+				 WALSegmentRange **owned)
+{
+	*owned = NULL;
+	if (wal_info->ranges != NULL || wal_info->segments == NULL)
+	{
+		*ranges = wal_info->ranges;
+		*nranges = wal_info->ranges != NULL ? wal_info->range_count : 0;
+		return true;
+	}
+
+	*owned = wal_segment_ranges_build(wal_info->segments,
+									  wal_info->segment_count, seg_size, nranges);
+	*ranges = *owned;
+	return *owned != NULL;
+}
+
+/* First run on 'timeline' or a later one that ends after 'pos' */
+static int
+first_run_ending_after(const WALSegmentRange *ranges, int nranges,
+					   uint32_t timeline, uint64_t pos)
+{
+	int lo = 0;
+	int hi = nranges;
+
+	while (lo < hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+
+		if (ranges[mid].timeline < timeline ||
+			(ranges[mid].timeline == timeline &&
+			 ranges[mid].start + ranges[mid].count <= pos))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 /*
  * Find gaps in a sorted WAL archive.
  *
- * Iterates through the pre-sorted segment array and reports any range of
- * segment names that are absent between two consecutive present segments
- * (within the same timeline).  Timeline switches are not considered gaps.
+ * Walks the runs of consecutive segments (WALArchiveInfo.ranges, built
+ * here from the segment array if the archive has none) and reports the
+ * segment names absent between two consecutive runs of the same
+ * timeline.  Timeline switches are not considered gaps.
  *
  * Returns a linked list of WALGap structs (or NULL if no gaps / nothing to
  * check).  Caller must free with free_wal_gaps().
@@ -631,55 +1976,41 @@ static void free_wal_gaps(WALGap *gaps);
 WALGap*
 find_wal_gaps(WALArchiveInfo *wal_info)
 {
-	WALGap *gaps = NULL;
-	WALGap *last_gap = NULL;
-	int     i;
+	WALGap			   *gaps = NULL;
+	WALGap			   *last_gap = NULL;
+	WALSegmentRange	   *owned = NULL;
+	const WALSegmentRange *ranges;
+	int					nranges;
+	uint32_t			seg_size;
 
 	if (wal_info == NULL || wal_info->segments == NULL ||
 		wal_info->segment_count < 2)
 		return NULL;
 
-	for (i = 0; i < wal_info->segment_count - 1; i++)
+	seg_size = detect_wal_segment_size(wal_info);
+	if (!wal_archive_runs(wal_info, seg_size, &ranges, &nranges, &owned))
+		return NULL;
+
+	for (int i = 0; i + 1 < nranges; i++)
 	{
-		WALSegmentName *cur = &wal_info->segments[i];
-		WALSegmentName *nxt = &wal_info->segments[i + 1];
+		const WALSegmentRange *cur = &ranges[i];
+		const WALSegmentRange *nxt = &ranges[i + 1];
+		uint64_t	first_missing, last_missing;
 
 		/* Timeline switch — not a gap */
 		if (cur->timeline != nxt->timeline)
 			continue;
 
-		/* Compute what the consecutive next segment should be */
-		uint32_t exp_log = cur->log_id;
-		uint32_t exp_seg = cur->seg_id + 1;
-
-		if (exp_seg == 0)   /* seg_id wrapped */
-			exp_log++;
-
-		/* Consecutive — no gap */
-		if (nxt->log_id == exp_log && nxt->seg_id == exp_seg)
-			continue;
+		/* Missing range is [end of cur .. start of nxt - 1] */
+		first_missing = cur->start + cur->count;
+		last_missing = nxt->start - 1;
 
-		/* Gap detected: missing range is [exp_log/exp_seg .. nxt-1] */
 		WALGap *gap = calloc(1, sizeof(WALGap));
 		if (gap == NULL)
 			break;
 
-		gap->start.timeline = cur->timeline;
-		gap->start.log_id   = exp_log;
-		gap->start.seg_id   = exp_seg;
-
-		gap->end.timeline   = nxt->timeline;
-		if (nxt->seg_id == 0)
-		{
-			gap->end.log_id = nxt->log_id - 1;
-			gap->end.seg_id = UINT32_MAX;
-		}
-		else
-		{
-			gap->end.log_id = nxt->log_id;
-			gap->end.seg_id = nxt->seg_id - 1;
-		}
-
+		wal_segment_from_number(first_missing, cur->timeline, &gap->start, seg_size);
+		wal_segment_from_number(last_missing, nxt->timeline, &gap->end, seg_size);
 		gap->next = NULL;
 
 		if (last_gap == NULL)
@@ -689,6 +2020,7 @@ find_wal_gaps(WALArchiveInfo *wal_info)
 		last_gap = gap;
 	}
 
+	free(owned);
 	return gaps;
 }
 
@@ -749,63 +2081,27 @@ check_wal_continuity(WALArchiveInfo *wal_info)
 }
 
 /*
- * Check if a WAL segment is present in the archive.
- * Segments are sorted by (timeline, log_id, seg_id) — use binary search.
+ * Check if a WAL segment is present in the archive: a binary search over
+ * its runs of segments, or over the sorted segments if it has none.
  */
 static bool
 segment_exists_in_archive(WALSegmentName *seg, WALArchiveInfo *wal_info)
 {
-	int lo, hi;
-
-	if (seg == NULL || wal_info == NULL || wal_info->segments == NULL)
-		return false;
-
-	lo = 0;
-	hi = wal_info->segment_count - 1;
-
-	while (lo <= hi)
-	{
-		int mid = lo + (hi - lo) / 2;
-		WALSegmentName *archived = &wal_info->segments[mid];
-
-		if (archived->timeline != seg->timeline)
-		{
-			if (archived->timeline < seg->timeline)
-				lo = mid + 1;
-			else
-				hi = mid - 1;
-		}
-		else if (archived->log_id != seg->log_id)
-		{
-			if (archived->log_id < seg->log_id)
-				lo = mid + 1;
-			else
-				hi = mid - 1;
-		}
-		else if (archived->seg_id != seg->seg_id)
-		{
-			if (archived->seg_id < seg->seg_id)
-				lo = mid + 1;
-			else
-				hi = mid - 1;
-		}
-		else
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return wal_archive_find(wal_info, seg) >= 0;
 }
 
 /*
  * Check if required WAL segments are available for backup
+ *
+ * The backup's range is compared with the archive's runs of consecutive
+ * segments, so the cost is a binary search plus one step per run or gap
+ * inside the range, and each missing stretch is reported as one error.
  */
 ValidationResult*
 check_wal_availability(BackupInfo *backup, WALArchiveInfo *wal_info)
 {
 	ValidationResult *result;
-	WALSegmentName start_seg, stop_seg, current_seg;
+	WALSegmentName start_seg, stop_seg;
 	int missing_count = 0;
 	char lsn_buf[64];
 	char msg_buf[512];
@@ -828,9 +2124,7 @@ check_wal_availability(BackupInfo *backup, WALArchiveInfo *wal_info)
 	if (backup->start_lsn == 0 && backup->stop_lsn == 0)
 	{
 		result->status = BACKUP_STATUS_WARNING;
-		result->warning_count = 1;
-		result->warnings = malloc(sizeof(char *));
-		result->warnings[0] = strdup("Backup has no LSN information");
+		validation_add_warning(result, "Backup has no LSN information");
 		return result;
 	}
 
@@ -877,60 +2171,63 @@ check_wal_availability(BackupInfo *backup, WALArchiveInfo *wal_info)
 	log_debug("  Stop LSN:  %s (timeline=%u, log=%08X, seg=%08X)",
 			  lsn_buf, stop_seg.timeline, stop_seg.log_id, stop_seg.seg_id);
 
-	/* Check all segments from start to stop */
-	current_seg = start_seg;
-
-	while (current_seg.log_id < stop_seg.log_id ||
-		   (current_seg.log_id == stop_seg.log_id && current_seg.seg_id <= stop_seg.seg_id))
+	/* Report the parts of [start, stop] the archive's runs do not cover */
 	{
-		if (!segment_exists_in_archive(&current_seg, wal_info))
+		WALSegmentRange		   *owned = NULL;
+		const WALSegmentRange  *ranges;
+		WALSegmentName			first_seg, last_seg;
+		char					first_name[32], last_name[32];
+		int						nranges;
+		int						r;
+		uint64_t				pos  = wal_segment_number(&start_seg, seg_size);
+		uint64_t				stop = wal_segment_number(&stop_seg, seg_size);
+
+		if (wal_archive_runs(wal_info, seg_size, &ranges, &nranges, &owned))
+			r = first_run_ending_after(ranges, nranges, start_seg.timeline, pos);
+		else
+			nranges = r = 0;		/* out of memory: everything is missing */
+
+		while (pos <= stop)
 		{
-			missing_count++;
+			const WALSegmentRange *run = (r < nranges &&
+										  ranges[r].timeline == start_seg.timeline)
+				? &ranges[r] : NULL;
+			uint64_t	last;
 
-			/* Add error message */
-			snprintf(msg_buf, sizeof(msg_buf),
-					 "Missing WAL segment: %08X%08X%08X",
-					 current_seg.timeline, current_seg.log_id, current_seg.seg_id);
+			if (run != NULL && run->start <= pos)
 			{
-				char **tmp = realloc(result->errors,
-									 (result->error_count + 1) * sizeof(char *));
-				if (tmp != NULL)
-				{
-					result->errors = tmp;
-					result->errors[result->error_count] = strdup(msg_buf);
-					result->error_count++;
-				}
+				pos = run->start + run->count;
+				r++;
+				continue;
 			}
 
-			log_warning("%s", msg_buf);
-		}
+			/* pos .. up to the next run (or stop) is missing */
+			last = (run != NULL && run->start - 1 < stop) ? run->start - 1 : stop;
+			missing_count += (int) (last - pos + 1);
 
-		/* Move to next segment */
-		current_seg.seg_id++;
+			wal_segment_from_number(pos, start_seg.timeline, &first_seg, seg_size);
+			wal_segment_from_number(last, start_seg.timeline, &last_seg, seg_size);
+			format_wal_filename(&first_seg, first_name, sizeof(first_name));
+			format_wal_filename(&last_seg, last_name, sizeof(last_name));
 
-		/* Handle seg_id overflow */
-		if (current_seg.seg_id == 0)
-		{
-			current_seg.log_id++;
-		}
+			if (last == pos)
+				snprintf(msg_buf, sizeof(msg_buf),
+						 "Missing WAL segment: %s", first_name);
+			else
+				snprintf(msg_buf, sizeof(msg_buf),
+						 "Missing WAL segments: %s .. %s (%llu segments)",
+						 first_name, last_name,
+						 (unsigned long long) (last - pos + 1));
+			add_error_code(result, VALIDATION_CODE_MISSING_WAL, msg_buf);
+			log_warning("%s", msg_buf);
 
-		/* Safety check: prevent infinite loop */
-		if (current_seg.log_id > stop_seg.log_id + 1)
-		{
-			snprintf(msg_buf, sizeof(msg_buf),
-					 "WAL range check aborted: too many segments");
-			{
-				char **tmp = realloc(result->errors,
-									 (result->error_count + 1) * sizeof(char *));
-				if (tmp != NULL)
-				{
-					result->errors = tmp;
-					result->errors[result->error_count] = strdup(msg_buf);
-					result->error_count++;
-				}
-			}
-			break;
+			/* With --fail-fast one missing range is enough */
+			if (validation_stop_requested())
+				break;
+			pos = last + 1;
 		}
+
+		free(owned);
 	}
 
 	/* Set final status */
@@ -970,9 +2267,10 @@ free_wal_gaps(WALGap *gaps)
  * For each required segment in the range [start_lsn, stop_lsn]:
  *   - Skip segments that are not present in the archive (check_wal_availability
  *     already handles reporting those as missing).
- *   - Open the segment and read the first 40 bytes (XLogLongPageHeaderData).
- *   - Validate: non-zero magic, XLP_LONG_HEADER flag, matching timeline,
- *     matching page address, and a plausible segment size value.
+ *   - Read the segment once (validate_wal_segment): the first 40 bytes
+ *     (XLogLongPageHeaderData) are checked for non-zero magic, the
+ *     XLP_LONG_HEADER flag, matching timeline and page address and a
+ *     plausible segment size; then record CRCs and the segment length.
  *
  */
 ValidationResult*
@@ -980,8 +2278,9 @@ check_wal_headers(BackupInfo *backup, WALArchiveInfo *wal_info)
 {
 	ValidationResult   *result;
 	WALSegmentName		start_seg, stop_seg, cur;
-	char				seg_filename[32];
-	char				seg_path[PATH_MAX];
+	WALSegmentName	   *segs = NULL;
+	int					count = 0;
+	int					capacity = 0;
 	int					checked = 0;
 	uint32_t			seg_size;
 
@@ -1026,50 +2325,37 @@ check_wal_headers(BackupInfo *backup, WALArchiveInfo *wal_info)
 			  start_seg.timeline, start_seg.log_id, start_seg.seg_id,
 			  stop_seg.timeline,  stop_seg.log_id,  stop_seg.seg_id);
 
+	/* Collect the segments of the window, then check them in parallel */
 	cur = start_seg;
 	while (cur.log_id < stop_seg.log_id ||
 		   (cur.log_id == stop_seg.log_id && cur.seg_id <= stop_seg.seg_id))
 	{
-		format_wal_filename(&cur, seg_filename, sizeof(seg_filename));
-		path_join(seg_path, sizeof(seg_path),
-				  wal_info->archive_path, seg_filename);
-
-		if (file_exists(seg_path))
+		if (count >= capacity)
 		{
-			/*
-			 * Expected page address = segment_number * segment_size
-			 * where segment_number = log_id * 2^32 + seg_id
-			 */
-			uint64_t expected_pageaddr =
-				((uint64_t)cur.log_id * 0x100000000ULL + (uint64_t)cur.seg_id)
-				* (uint64_t)seg_size;
-
-			int errors_before = result->error_count;
-
-			validate_wal_segment_header(seg_path, seg_filename,
-										backup->timeline, expected_pageaddr,
-										result);
-
-			/*
-			 * Only validate individual record CRCs when the page header is
-			 * clean — a corrupt header makes record offsets unreliable.
-			 */
-			if (result->error_count == errors_before)
-				validate_wal_segment_records(seg_path, seg_filename, result);
+			int				new_capacity = capacity > 0 ? capacity * 2 : 64;
+			WALSegmentName *tmp = realloc(segs, new_capacity * sizeof(WALSegmentName));
 
-			checked++;
+			if (tmp == NULL)
+			{
+				add_error(result, "Out of memory while checking WAL headers");
+				break;
+			}
+			segs = tmp;
+			capacity = new_capacity;
 		}
-		/* Missing segments are skipped — check_wal_availability reports them */
+		segs[count++] = cur;
 
-		cur.seg_id++;
-		if (cur.seg_id == 0)
-			cur.log_id++;
+		wal_segment_next(&cur, seg_size);
 
 		/* Safety: break if we somehow overshoot */
 		if (cur.log_id > stop_seg.log_id + 1)
 			break;
 	}
 
+	checked = validate_wal_segments(wal_info, segs, count, seg_size, false,
+									result);
+	free(segs);
+
 	if (result->error_count == 0)
 		log_debug("Backup %s: WAL headers OK (%d segment%s checked)",
 				  backup->backup_id, checked, checked == 1 ? "" : "s");
@@ -1087,83 +2373,35 @@ check_wal_headers(BackupInfo *backup, WALArchiveInfo *wal_info)
  * ----------------------------------------------------------------------- */
 
 /*
- * Parse a PostgreSQL timeline history file and return the switch LSN at which
- * the given parent_tli transitioned to new_tli.
+ * Switch LSN at which the history of new_tli left parent_tli.
  *
- * History file: NNNNNNNN.history in the WAL archive.
- * Non-comment lines: <parent_tli><whitespace><switch_lsn><whitespace><reason>
- * Example: "1\t0/5000000\tno recovery target specified\n"
+ * Archives read by scan_wal_archive() carry the timeline graph of all
+ * their history files, so this is a walk up parent links.  For archives
+ * assembled elsewhere the history file of new_tli alone is read, which
+ * holds every ancestor of it.
  *
- * Returns true and sets *switch_lsn_out if the entry is found, false if the
- * file is absent or the parent timeline entry is missing / unparseable.
+ * Returns false if the history file is absent or tli=parent_tli is not
+ * an ancestor of new_tli.
  */
 static bool
-parse_history_switchpoint(const char *archive_path, uint32_t new_tli,
-						  uint32_t parent_tli, XLogRecPtr *switch_lsn_out)
+timeline_switchpoint(const WALArchiveInfo *wal_info, uint32_t new_tli,
+					 uint32_t parent_tli, XLogRecPtr *switch_lsn_out)
 {
-	char   history_filename[32];
-	char   history_path[PATH_MAX];
-	FILE  *fp;
-	char   line[256];
-
-	snprintf(history_filename, sizeof(history_filename),
-			 "%08X.history", new_tli);
-	path_join(history_path, sizeof(history_path),
-			  archive_path, history_filename);
-
-	fp = fopen(history_path, "r");
-	if (fp == NULL)
-		return false;
-
-	while (fgets(line, sizeof(line), fp) != NULL)
-	{
-		char         *p = line;
-		char         *end;
-		unsigned long tli_val;
-		char          lsn_buf[32];
-		size_t        lsn_len;
-
-		/* Skip leading whitespace */
-		while (*p == ' ' || *p == '\t') p++;
-
-		/* Skip comment / blank lines */
-		if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
-			continue;
-
-		/* Parse parent timeline number */
-		tli_val = strtoul(p, &end, 10);
-		if (end == p)
-			continue;	/* no digits — malformed line */
-
-		if ((uint32_t)tli_val != parent_tli)
-			continue;
-
-		/* Skip whitespace between tli and LSN */
-		p = end;
-		while (*p == ' ' || *p == '\t') p++;
-
-		/* Extract the LSN token (non-whitespace, non-newline chars) */
-		end = p;
-		while (*end && *end != ' ' && *end != '\t' &&
-			   *end != '\n' && *end != '\r')
-			end++;
-
-		lsn_len = (size_t)(end - p);
-		if (lsn_len == 0 || lsn_len >= sizeof(lsn_buf))
-			continue;
-
-		memcpy(lsn_buf, p, lsn_len);
-		lsn_buf[lsn_len] = '\0';
-
-		if (parse_lsn(lsn_buf, switch_lsn_out))
-		{
-			fclose(fp);
-			return true;
-		}
-	}
-
-	fclose(fp);
-	return false;
+	WALTimeline *timelines = NULL;
+	int          count = 0;
+	bool         found;
+
+	if (wal_info->timelines != NULL)
+		return wal_timelines_switchpoint(wal_info->timelines,
+										 wal_info->timeline_count,
+										 new_tli, parent_tli, switch_lsn_out);
+
+	found = wal_timelines_load_history(wal_info->archive_path, new_tli,
+									   &timelines, &count) &&
+		wal_timelines_switchpoint(timelines, count, new_tli, parent_tli,
+								  switch_lsn_out);
+	free(timelines);
+	return found;
 }
 
 /*
@@ -1202,6 +2440,37 @@ compare_backup_by_lsn(const void *a, const void *b)
  */
 ValidationResult*
 check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
+{
+	ValidationResult   *result;
+	BackupInfo        **arr;
+	int					n = 0;
+
+	if (backups == NULL || wal_info == NULL)
+		return NULL;
+
+	for (BackupInfo *b = backups; b != NULL; b = b->next)
+		n++;
+
+	arr = malloc((size_t)n * sizeof(*arr));
+	if (arr == NULL)
+		return NULL;
+
+	n = 0;
+	for (BackupInfo *b = backups; b != NULL; b = b->next)
+		arr[n++] = b;
+
+	result = check_wal_restore_chain_of(arr, n, wal_info);
+	free(arr);
+	return result;
+}
+
+/*
+ * check_wal_restore_chain() for the 'count' backups in 'backups', such as
+ * the members of one archive of a WALArchiveSet.
+ */
+ValidationResult*
+check_wal_restore_chain_of(BackupInfo *const *backups, int count,
+						   WALArchiveInfo *wal_info)
 {
 	ValidationResult   *result;
 	BackupInfo        **arr;
@@ -1227,9 +2496,9 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
 	 * spurious bridge errors for every gap left by the missing parent.
 	 */
 	n = 0;
-	for (BackupInfo *b = backups; b != NULL; b = b->next)
-		if (b->start_lsn > 0 && b->stop_lsn > 0 &&
-			b->status != BACKUP_STATUS_ORPHAN)
+	for (int j = 0; j < count; j++)
+		if (backups[j]->start_lsn > 0 && backups[j]->stop_lsn > 0 &&
+			backups[j]->status != BACKUP_STATUS_ORPHAN)
 			n++;
 
 	if (n < 2)
@@ -1243,10 +2512,10 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
 		return result;
 
 	i = 0;
-	for (BackupInfo *b = backups; b != NULL; b = b->next)
-		if (b->start_lsn > 0 && b->stop_lsn > 0 &&
-			b->status != BACKUP_STATUS_ORPHAN)
-			arr[i++] = b;
+	for (int j = 0; j < count; j++)
+		if (backups[j]->start_lsn > 0 && backups[j]->stop_lsn > 0 &&
+			backups[j]->status != BACKUP_STATUS_ORPHAN)
+			arr[i++] = backups[j];
 
 	qsort(arr, (size_t)n, sizeof(*arr), compare_backup_by_lsn);
 
@@ -1269,16 +2538,15 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
 			 *  2. WAL on tli B from the switch point to next.start_lsn
 			 *     (post-switch bridge; may be empty).
 			 *
-			 * The switch LSN is read from next->timeline's history file.
+			 * The switch LSN comes from next->timeline's history.
 			 */
 			XLogRecPtr		switch_lsn;
 			WALSegmentName	prev_stop_seg, switch_seg_old, switch_seg_new,
 							next_start_seg, bridge_cur;
 			char			lsn_sw[32];
 
-			if (!parse_history_switchpoint(wal_info->archive_path,
-										  next->timeline, prev->timeline,
-										  &switch_lsn))
+			if (!timeline_switchpoint(wal_info, next->timeline,
+									  prev->timeline, &switch_lsn))
 			{
 				snprintf(msg, sizeof(msg),
 						 "WAL cross-timeline chain: cannot determine switch "
@@ -1300,8 +2568,7 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
 			/* --- 1. Pre-switch bridge on prev->timeline ---
 			 * Range: [prev_stop_seg+1, switch_seg_old]  (inclusive) */
 			bridge_cur = prev_stop_seg;
-			bridge_cur.seg_id++;
-			if (bridge_cur.seg_id == 0) bridge_cur.log_id++;
+			wal_segment_next(&bridge_cur, seg_size);
 
 			while (bridge_cur.log_id < switch_seg_old.log_id ||
 				   (bridge_cur.log_id == switch_seg_old.log_id &&
@@ -1322,8 +2589,7 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
 					add_error(result, msg);
 					chain_errors++;
 				}
-				bridge_cur.seg_id++;
-				if (bridge_cur.seg_id == 0) bridge_cur.log_id++;
+				wal_segment_next(&bridge_cur, seg_size);
 				if (bridge_cur.log_id > switch_seg_old.log_id + 1) break;
 			}
 
@@ -1332,8 +2598,7 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
 			 * Empty when switch and next.start fall in the same or adjacent
 			 * segment. */
 			bridge_cur = switch_seg_new;
-			bridge_cur.seg_id++;
-			if (bridge_cur.seg_id == 0) bridge_cur.log_id++;
+			wal_segment_next(&bridge_cur, seg_size);
 
 			while (bridge_cur.log_id < next_start_seg.log_id ||
 				   (bridge_cur.log_id == next_start_seg.log_id &&
@@ -1353,8 +2618,7 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
 					add_error(result, msg);
 					chain_errors++;
 				}
-				bridge_cur.seg_id++;
-				if (bridge_cur.seg_id == 0) bridge_cur.log_id++;
+				wal_segment_next(&bridge_cur, seg_size);
 				if (bridge_cur.log_id > next_start_seg.log_id + 1) break;
 			}
 
@@ -1371,9 +2635,7 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
 		 * to bridge.
 		 */
 		cur = stop_seg;
-		cur.seg_id++;
-		if (cur.seg_id == 0)
-			cur.log_id++;
+		wal_segment_next(&cur, seg_size);
 
 		if (cur.log_id > start_seg.log_id ||
 			(cur.log_id == start_seg.log_id && cur.seg_id >= start_seg.seg_id))
@@ -1401,9 +2663,7 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
 				chain_errors++;
 			}
 
-			cur.seg_id++;
-			if (cur.seg_id == 0)
-				cur.log_id++;
+			wal_segment_next(&cur, seg_size);
 
 			/* Safety: prevent runaway loop on malformed input */
 			if (cur.log_id > start_seg.log_id + 1)
@@ -1434,7 +2694,7 @@ check_wal_restore_chain(BackupInfo *backups, WALArchiveInfo *wal_info)
  * between backups.
  *
  * For each segment the expected page address is:
- *   (log_id * 2^32 + seg_id) * seg_size
+ *   segment_number * seg_size, see wal_segment_number()
  * where seg_size is auto-detected from the first readable segment header.
  *
  * Per-record CRC validation is also run on each segment whose page header
@@ -1444,9 +2704,7 @@ ValidationResult*
 check_wal_archive_headers(WALArchiveInfo *wal_info)
 {
 	ValidationResult   *result;
-	int					i, checked = 0;
-	char				seg_filename[32];
-	char				seg_path[PATH_MAX];
+	int					checked;
 
 	if (wal_info == NULL)
 		return NULL;
@@ -1460,45 +2718,225 @@ check_wal_archive_headers(WALArchiveInfo *wal_info)
 	/* Detect segment size from the archive; fall back to 16 MB if unavailable. */
 	uint32_t seg_size = detect_wal_segment_size(wal_info);
 
-	for (i = 0; i < wal_info->segment_count; i++)
+	checked = validate_wal_segments(wal_info, wal_info->segments,
+									wal_info->segment_count, seg_size, true,
+									result);
+
+	if (result->error_count == 0)
+		log_debug("WAL archive headers OK (%d segment%s checked)",
+				  checked, checked == 1 ? "" : "s");
+	else
+		log_error("WAL archive has %d header error%s (%d segment%s checked)",
+				  result->error_count, result->error_count == 1 ? "" : "s",
+				  checked, checked == 1 ? "" : "s");
+
+	return result;
+}
+
+/*
+ * Validate only 'segs', a subset of wal_info's segments (e.g. those
+ * archived since the last look), the way check_wal_archive_headers()
+ * validates them all.
+ */
+ValidationResult*
+check_wal_segments(WALArchiveInfo *wal_info, const WALSegmentName *segs,
+				   int count)
+{
+	ValidationResult *result;
+
+	if (wal_info == NULL)
+		return NULL;
+
+	result = calloc(1, sizeof(ValidationResult));
+	if (result == NULL)
+		return NULL;
+	result->status = BACKUP_STATUS_OK;
+
+	if (count > 0)
+		validate_wal_segments(wal_info, segs, count,
+							  detect_wal_segment_size(wal_info), false, result);
+	if (result->error_count > 0)
+		result->status = BACKUP_STATUS_ERROR;
+	return result;
+}
+
+/*
+ * Take up the record kept by an earlier check_wal_segment_file(), if it
+ * was left at the end of the segment right before 'seg'.  Returns false
+ * (and 'as' stays empty) otherwise.
+ */
+static bool
+resume_wal_tail(const char *archive_path, const WALSegmentName *seg,
+				WALRecordAssembler *as, WALCacheTail *tail, struct stat *st)
+{
+	WALSegmentName	prev;
+	bool			ok;
+
+	if (!wal_cache_get_tail(archive_path, tail, st))
+		return false;
+
+	ok = parse_wal_filename(tail->seg_filename, &prev) &&
+		valid_wal_seg_size(tail->seg_size) &&
+		wal_segment_follows(&prev, seg, tail->seg_size) &&
+		wal_assembler_begin(as, tail->tot_len, tail->seg_filename,
+							tail->page_no, tail->rec_off);
+	if (ok)
+		wal_assembler_add(as, tail->data, tail->have);
+	free(tail->data);
+	tail->data = NULL;
+	return ok;
+}
+
+/*
+ * Keep the record 'as' holds at the end of 'seg_path' (as described by
+ * 'st') for the next check_wal_segment_file(), or forget the kept one if
+ * there is none.
+ */
+static void
+keep_wal_tail(const char *archive_path, const char *seg_path,
+			  const struct stat *st, uint32_t seg_size,
+			  const WALRecordAssembler *as)
+{
+	WALCacheTail tail;
+
+	if (as == NULL || as->tot_len == 0)
 	{
-		WALSegmentName *seg = &wal_info->segments[i];
+		wal_cache_set_tail(archive_path, NULL, NULL);
+		return;
+	}
 
-		format_wal_filename(seg, seg_filename, sizeof(seg_filename));
-		path_join(seg_path, sizeof(seg_path),
-				  wal_info->archive_path, seg_filename);
+	memset(&tail, 0, sizeof(tail));
+	str_copy(tail.path, seg_path, sizeof(tail.path));
+	tail.seg_size = seg_size;
+	memcpy(tail.seg_filename, as->seg_filename, sizeof(tail.seg_filename));
+	tail.page_no = as->page_no;
+	tail.rec_off = as->rec_off;
+	tail.tot_len = as->tot_len;
+	tail.have    = as->have;
+	tail.data    = as->buf;
+	wal_cache_set_tail(archive_path, &tail, st);
+}
 
-		if (!file_exists(seg_path))
-			continue;
+/* ------------------------------------------------------------------ *
+ * check_wal_segment_file
+ *
+ * Verify one segment file of the WAL archive 'archive_path' on its own,
+ * as it is archived ('verify-segment' in archive_command): the header
+ * and the CRC of every record, in the single pass validate_wal_segment()
+ * makes.  Timeline and segment number come from the file name, the
+ * segment size from the header.
+ *
+ * With a cache directory the verdict goes into the archive's WAL
+ * verification cache, so later checks of the archive skip the segment.
+ * A cached segment's verdict covers the record that runs from its end
+ * into the next segment, which has not been archived yet: that record
+ * is kept aside, and finished and checked when the next segment is
+ * verified.  Only then is the segment cached.
+ * ------------------------------------------------------------------ */
+ValidationResult*
+check_wal_segment_file(const char *seg_path, const char *archive_path)
+{
+	ValidationResult   *result;
+	WALSegmentName		seg;
+	WALRecordAssembler	as;
+	WALCacheTail		tail;
+	WALSource			src = {NULL, NULL};
+	struct stat			st;
+	struct stat			tail_st;
+	const char		   *name;
+	const char		   *suffix = NULL;
+	char				seg_filename[32];
+	char				msg[PATH_MAX + 128];
+	uint8_t			   *chunk;
+	uint32_t			seg_size;
+	uint64_t			from_seq = 0;
+	bool				carried;
 
-		uint64_t expected_pageaddr =
-			((uint64_t)seg->log_id * 0x100000000ULL + (uint64_t)seg->seg_id)
-			* (uint64_t)seg_size;
+	if (seg_path == NULL || archive_path == NULL)
+		return NULL;
 
-		int errors_before = result->error_count;
+	result = calloc(1, sizeof(ValidationResult));
+	if (result == NULL)
+		return NULL;
+	result->status = BACKUP_STATUS_OK;
 
-		validate_wal_segment_header(seg_path, seg_filename,
-									seg->timeline, expected_pageaddr,
-									result);
+	name = strrchr(seg_path, '/');
+	name = name != NULL ? name + 1 : seg_path;
+	if (!parse_wal_segment_file(name, &seg, &suffix))
+	{
+		snprintf(msg, sizeof(msg), "%s: not a WAL segment file name", name);
+		add_error(result, msg);
+		return result;
+	}
+	format_wal_filename(&seg, seg_filename, sizeof(seg_filename));
 
-		/*
-		 * Only run per-record CRC validation when the page header is clean —
-		 * a corrupt header makes record offsets unreliable.
-		 */
-		if (result->error_count == errors_before)
-			validate_wal_segment_records(seg_path, seg_filename, result);
+	if (stat(seg_path, &st) != 0)
+	{
+		snprintf(msg, sizeof(msg), "WAL segment %s: cannot stat %s: %s",
+				 seg_filename, seg_path, strerror(errno));
+		add_error(result, msg);
+		return result;
+	}
 
-		checked++;
+	chunk = alloc_wal_read_buf();
+	if (chunk == NULL)
+	{
+		snprintf(msg, sizeof(msg), "WAL segment %s: out of memory, not checked",
+				 seg_filename);
+		add_error(result, msg);
+		return result;
 	}
 
-	if (result->error_count == 0)
-		log_debug("WAL archive headers OK (%d segment%s checked)",
-				  checked, checked == 1 ? "" : "s");
+	memset(&as, 0, sizeof(as));
+	carried = resume_wal_tail(archive_path, &seg, &as, &tail, &tail_st);
+	from_seq = as.seq;
+	if (carried)
+		log_debug("WAL segment %s: finishing the record at %s page %d offset %u",
+				  seg_filename, tail.seg_filename, tail.page_no, tail.rec_off);
+
+	src.ds = decompress_open(seg_path, wal_suffix_compression(suffix));
+	if (src.ds == NULL)
+	{
+		snprintf(msg, sizeof(msg), "WAL segment %s: cannot open %s: %s",
+				 seg_filename, seg_path, strerror(errno));
+		add_error(result, msg);
+		seg_size = 0;
+	}
 	else
-		log_error("WAL archive has %d header error%s (%d segment%s checked)",
-				  result->error_count, result->error_count == 1 ? "" : "s",
-				  checked, checked == 1 ? "" : "s");
+	{
+		/* The standard 16 MB until the header says otherwise */
+		seg_size = validate_wal_source(&src, seg_filename, seg.timeline,
+									   wal_segment_number(&seg, 0x1000000) *
+									   (uint64_t) 0x1000000,
+									   &seg, chunk, &as, result);
+		decompress_close(src.ds);
+	}
+
+	if (result->error_count == 0 && valid_wal_seg_size(seg_size))
+	{
+		WALCache *cache = wal_cache_open(archive_path, seg_size);
+
+		/* The previous segment's tail record is now checked too */
+		if (carried && tail.seg_size == seg_size && as.lost_seq != from_seq &&
+			!(as.tot_len != 0 && as.seq == from_seq))
+			wal_cache_store(cache, tail.path, &tail_st);
+
+		if (as.tot_len == 0)
+			wal_cache_store(cache, seg_path, &st);
+		wal_cache_close(cache, false);
+
+		/* A record running through the whole segment is left to full checks */
+		keep_wal_tail(archive_path, seg_path, &st, seg_size,
+					  as.seq != from_seq ? &as : NULL);
+	}
+	else
+		keep_wal_tail(archive_path, seg_path, &st, seg_size, NULL);
 
+	free(as.buf);
+	free_wal_read_buf(chunk);
+
+	if (result->error_count > 0)
+		result->status = BACKUP_STATUS_ERROR;
 	return result;
 }
 
@@ -1518,6 +2956,7 @@ check_wal_timeline(BackupInfo *backup, WALArchiveInfo *wal_info)
 	char              history_filename[32];
 	char              history_path[PATH_MAX];
 	char              msg[512];
+	bool              present;
 
 	if (backup == NULL || wal_info == NULL)
 		return NULL;
@@ -1540,10 +2979,23 @@ check_wal_timeline(BackupInfo *backup, WALArchiveInfo *wal_info)
 	snprintf(history_filename, sizeof(history_filename),
 			 "%08X.history", backup->timeline);
 
-	path_join(history_path, sizeof(history_path),
-			  wal_info->archive_path, history_filename);
+	/* The graph of a scanned archive knows which history files it holds */
+	if (wal_info->timelines != NULL)
+	{
+		const WALTimeline *tl = wal_timelines_find(wal_info->timelines,
+												   wal_info->timeline_count,
+												   backup->timeline);
+
+		present = tl != NULL && tl->has_history;
+	}
+	else
+	{
+		path_join(history_path, sizeof(history_path),
+				  wal_info->archive_path, history_filename);
+		present = file_exists(history_path);
+	}
 
-	if (!file_exists(history_path))
+	if (!present)
 	{
 		snprintf(msg, sizeof(msg),
 				 "Timeline %u history file missing in WAL archive: %s",
@@ -0,0 +1,733 @@
+/*
+ * bench.c
+ *
+ * Microbenchmarks for the checksum, parsing and WAL kernels
+ *
+ * Each case runs its kernel repeatedly until --min-time has elapsed and
+ * reports the rate as one NDJSON "bench" record on stdout, so results can
+ * be appended to a file and compared across commits.  Inputs are made up
+ * on the spot: random buffers for the checksums, generated WAL names, a
+ * directory of empty segment files, a pgBackRest-style backup.manifest, a
+ * backup_manifest held in memory and a few 16 MB WAL segments of valid
+ * records.  Files go to a scratch directory that is removed on exit.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "pg_backup_auditor.h"
+#include "backup_manifest.h"
+#include "crc32c.h"
+#include "page_checksum.h"
+#include "ini_parser.h"
+#include "metrics.h"
+#include "ndjson.h"
+#include "sha1.h"
+#include "sha256.h"
+#include <dirent.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BENCH_BUF_SIZE      (1024 * 1024)
+#define BENCH_WAL_NAMES     4096
+#define BENCH_ARCHIVE_SEGS  2000
+#define BENCH_INI_KEYS      500000
+#define BENCH_MANIFEST_FILES 200000
+#define BENCH_WAL_SEGS      4
+#define BENCH_WAL_SWITCHED  64      /* pages written before a switch */
+
+/* Layout of the generated WAL (see wal_validator.c) */
+#define WAL_SEG_SIZE        (16U * 1024 * 1024)
+#define WAL_BLCKSZ          8192U
+#define WAL_LONG_HDR_SIZE   40U
+#define WAL_SHORT_HDR_SIZE  24U
+#define WAL_RECORD_SIZE     200U
+#define XLP_LONG_HEADER     0x0002
+
+/*
+ * One pass of a kernel.  Returns the amount of work done in the case's
+ * unit (bytes, names, keys, pages), or 0 if the kernel failed.
+ */
+typedef uint64_t (*BenchFn)(void *arg);
+
+typedef struct {
+	double      min_time;           /* seconds per case */
+	const char *filter;             /* run cases whose name contains this */
+	char        dir[PATH_MAX];      /* scratch directory */
+	uint8_t    *buf;                /* BENCH_BUF_SIZE random bytes */
+	size_t      chunk;              /* checksum call size */
+	char      (*names)[32];         /* BENCH_WAL_NAMES file names */
+	char       *manifest;           /* backup_manifest in memory */
+	size_t      manifest_len;
+	bool        failed;
+} Bench;
+
+/* Keeps the compiler from discarding results */
+static volatile uint64_t bench_sink;
+
+static bool
+bench_selected(const Bench *b, const char *name)
+{
+	return b->filter == NULL || strstr(name, b->filter) != NULL;
+}
+
+/* Run 'fn' until min_time has passed and report its rate */
+static void
+bench_run(Bench *b, const char *name, const char *impl, uint64_t param,
+		  const char *unit, double scale, BenchFn fn, void *arg)
+{
+	NdjsonRecord rec;
+	uint64_t     start;
+	uint64_t     elapsed;
+	uint64_t     work = 0;
+	uint64_t     ops = 0;
+	double       seconds;
+
+	if (!bench_selected(b, name))
+		return;
+
+	/* One untimed pass warms caches and faults pages in */
+	if (fn(arg) == 0)
+	{
+		fprintf(stderr, "bench: %s failed\n", name);
+		b->failed = true;
+		return;
+	}
+
+	start = metrics_clock();
+	do
+	{
+		uint64_t n = fn(arg);
+
+		if (n == 0)
+		{
+			fprintf(stderr, "bench: %s failed\n", name);
+			b->failed = true;
+			return;
+		}
+		work += n;
+		ops++;
+		elapsed = metrics_clock() - start;
+	} while ((double) elapsed < b->min_time * 1e9);
+
+	seconds = (double) elapsed / 1e9;
+	ndjson_begin(&rec, stdout, "bench");
+	ndjson_string(&rec, "name", name);
+	if (impl != NULL)
+		ndjson_string(&rec, "implementation", impl);
+	if (param != 0)
+		ndjson_uint(&rec, "size", param);
+	ndjson_uint(&rec, "iterations", ops);
+	ndjson_uint(&rec, "work", work);
+	ndjson_double(&rec, "seconds", seconds);
+	ndjson_double(&rec, "rate", (double) work / seconds / scale);
+	ndjson_string(&rec, "unit", unit);
+	ndjson_end(&rec);
+}
+
+/* ------------------------------------------------------------------ *
+ * Checksums
+ * ------------------------------------------------------------------ */
+
+static uint64_t
+bench_crc32c(void *arg)
+{
+	Bench   *b = arg;
+	uint32_t crc = ~0U;
+
+	for (size_t off = 0; off < BENCH_BUF_SIZE; off += b->chunk)
+		crc = crc32c_update(crc, b->buf + off, b->chunk);
+	bench_sink += crc;
+	return BENCH_BUF_SIZE;
+}
+
+static uint64_t
+bench_sha256(void *arg)
+{
+	Bench    *b = arg;
+	SHA256Ctx ctx;
+	uint8_t   digest[SHA256_DIGEST_LENGTH];
+
+	sha256_init(&ctx);
+	for (size_t off = 0; off < BENCH_BUF_SIZE; off += b->chunk)
+		sha256_update(&ctx, b->buf + off, b->chunk);
+	sha256_final(&ctx, digest);
+	bench_sink += digest[0];
+	return BENCH_BUF_SIZE;
+}
+
+static uint64_t
+bench_sha1(void *arg)
+{
+	Bench  *b = arg;
+	SHA1Ctx ctx;
+	uint8_t digest[SHA1_DIGEST_LENGTH];
+
+	sha1_init(&ctx);
+	for (size_t off = 0; off < BENCH_BUF_SIZE; off += b->chunk)
+		sha1_update(&ctx, b->buf + off, b->chunk);
+	sha1_final(&ctx, digest);
+	bench_sink += digest[0];
+	return BENCH_BUF_SIZE;
+}
+
+static uint64_t
+bench_page_checksum(void *arg)
+{
+	Bench   *b = arg;
+	uint32_t sum = 0;
+
+	for (size_t off = 0; off < BENCH_BUF_SIZE; off += PAGE_BLCKSZ)
+		sum += page_checksum(b->buf + off, (uint32_t) (off / PAGE_BLCKSZ));
+	bench_sink += sum;
+	return BENCH_BUF_SIZE;
+}
+
+static uint64_t
+bench_page_checksum_sw(void *arg)
+{
+	Bench   *b = arg;
+	uint32_t sum = 0;
+
+	for (size_t off = 0; off < BENCH_BUF_SIZE; off += PAGE_BLCKSZ)
+		sum += page_checksum_sw(b->buf + off, (uint32_t) (off / PAGE_BLCKSZ));
+	bench_sink += sum;
+	return BENCH_BUF_SIZE;
+}
+
+static void
+bench_checksums(Bench *b)
+{
+	static const size_t sizes[] = { 64, 512, 4096, 65536, BENCH_BUF_SIZE };
+	char                name[64];
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		b->chunk = sizes[i];
+		snprintf(name, sizeof(name), "crc32c/%zu", sizes[i]);
+		bench_run(b, name, crc32c_implementation(), sizes[i], "GB/s", 1e9,
+				  bench_crc32c, b);
+		snprintf(name, sizeof(name), "sha256/%zu", sizes[i]);
+		bench_run(b, name, sha256_implementation(), sizes[i], "GB/s", 1e9,
+				  bench_sha256, b);
+		snprintf(name, sizeof(name), "sha1/%zu", sizes[i]);
+		bench_run(b, name, sha1_implementation(), sizes[i], "GB/s", 1e9,
+				  bench_sha1, b);
+	}
+
+	/* Data pages as --level=pages reads them, vectorized and not */
+	bench_run(b, "page_checksum", page_checksum_implementation(), PAGE_BLCKSZ,
+			  "GB/s", 1e9, bench_page_checksum, b);
+	if (strcmp(page_checksum_implementation(), "portable") != 0)
+		bench_run(b, "page_checksum", "portable", PAGE_BLCKSZ, "GB/s", 1e9,
+				  bench_page_checksum_sw, b);
+}
+
+/* ------------------------------------------------------------------ *
+ * WAL names and archive scan
+ * ------------------------------------------------------------------ */
+
+static uint64_t
+bench_parse_wal_filename(void *arg)
+{
+	Bench         *b = arg;
+	WALSegmentName seg;
+	uint64_t       ok = 0;
+
+	for (int i = 0; i < BENCH_WAL_NAMES; i++)
+		ok += parse_wal_filename(b->names[i], &seg);
+	bench_sink += ok;
+	return BENCH_WAL_NAMES;
+}
+
+static uint64_t
+bench_scan_wal_archive(void *arg)
+{
+	const char     *dir = arg;
+	WALArchiveInfo *info = scan_wal_archive(dir);
+	uint64_t        n;
+
+	if (info == NULL)
+		return 0;
+	n = (uint64_t) info->segment_count;
+	free_wal_archive_info(info);
+	return n;
+}
+
+/* Empty files are enough: the scan goes by name, size and mtime */
+static bool
+make_archive_dir(const char *dir)
+{
+	WALSegmentName seg = { 1, 0, 0 };
+	char           name[32];
+	char           path[PATH_MAX];
+
+	if (mkdir(dir, 0700) != 0)
+		return false;
+	for (int i = 0; i < BENCH_ARCHIVE_SEGS; i++)
+	{
+		FILE *fp;
+
+		seg.log_id = (uint32_t) (i / 256);
+		seg.seg_id = (uint32_t) (i % 256);
+		format_wal_filename(&seg, name, sizeof(name));
+		path_join(path, sizeof(path), dir, name);
+		if ((fp = fopen(path, "w")) == NULL)
+			return false;
+		fclose(fp);
+	}
+	return true;
+}
+
+static void
+bench_wal_names(Bench *b)
+{
+	char dir[PATH_MAX];
+
+	if (bench_selected(b, "parse_wal_filename"))
+	{
+		b->names = malloc(sizeof(*b->names) * BENCH_WAL_NAMES);
+		if (b->names == NULL)
+		{
+			fprintf(stderr, "Error: Memory allocation failed\n");
+			b->failed = true;
+			return;
+		}
+		/* Mostly segments, with the other kinds of archive member mixed in */
+		for (int i = 0; i < BENCH_WAL_NAMES; i++)
+		{
+			WALSegmentName seg = { 1 + i % 3, (uint32_t) i / 256, (uint32_t) i % 256 };
+
+			format_wal_filename(&seg, b->names[i], sizeof(b->names[i]));
+			if (i % 16 == 7)
+				strcat(b->names[i], ".partial");
+			else if (i % 16 == 15)
+				snprintf(b->names[i], sizeof(b->names[i]), "%08X.history", i);
+		}
+		bench_run(b, "parse_wal_filename", NULL, 0, "names/s", 1,
+				  bench_parse_wal_filename, b);
+		free(b->names);
+		b->names = NULL;
+	}
+
+	if (bench_selected(b, "scan_wal_archive"))
+	{
+		path_join(dir, sizeof(dir), b->dir, "archive");
+		if (!make_archive_dir(dir))
+		{
+			fprintf(stderr, "bench: cannot create %s\n", dir);
+			b->failed = true;
+			return;
+		}
+		bench_run(b, "scan_wal_archive", NULL, BENCH_ARCHIVE_SEGS,
+				  "segments/s", 1, bench_scan_wal_archive, dir);
+	}
+}
+
+/* ------------------------------------------------------------------ *
+ * Manifests
+ * ------------------------------------------------------------------ */
+
+static uint64_t
+bench_ini_parse_file(void *arg)
+{
+	IniFile *ini = ini_parse_file(arg);
+
+	if (ini == NULL)
+		return 0;
+	ini_free(ini);
+	return BENCH_INI_KEYS;
+}
+
+/* A backup.manifest as pgBackRest writes it, one key per file */
+static bool
+make_ini_manifest(const char *path)
+{
+	FILE *fp = fopen(path, "w");
+
+	if (fp == NULL)
+		return false;
+	fprintf(fp, "[backrest]\nbackrest-format=5\nbackrest-version=\"2.50\"\n\n"
+			"[backup]\nbackup-label=\"20260108-100530F\"\n"
+			"backup-type=\"full\"\n\n"
+			"[target:file]\n");
+	for (int i = 0; i < BENCH_INI_KEYS; i++)
+		fprintf(fp, "pg_data/base/%d/%d={\"checksum\":\"%08x%08x%08x%08x%08x\","
+				"\"size\":8192,\"timestamp\":1767866730}\n",
+				16384 + i / 10000, 16384 + i,
+				(unsigned) i, (unsigned) i * 7, (unsigned) i * 13,
+				(unsigned) i * 17, (unsigned) i * 31);
+	return fclose(fp) == 0;
+}
+
+static uint64_t
+bench_manifest_reader(void *arg)
+{
+	Bench            *b = arg;
+	ManifestReader    r;
+	ManifestFileEntry e;
+	uint64_t          n = 0;
+	int               rc;
+
+	manifest_reader_init(&r, b->manifest, b->manifest_len, true);
+	while ((rc = manifest_reader_next(&r, &e)) == 1)
+		n++;
+	if (rc < 0 || !r.has_checksum)
+		n = 0;
+	manifest_reader_close(&r);
+	return n;
+}
+
+/* A backup_manifest as pg_basebackup writes it, one entry per line */
+static bool
+make_backup_manifest(Bench *b)
+{
+	size_t cap = (size_t) BENCH_MANIFEST_FILES * 192 + 1024;
+	size_t len = 0;
+	char  *m = malloc(cap);
+
+	if (m == NULL)
+		return false;
+	len += (size_t) snprintf(m + len, cap - len,
+							 "{ \"PostgreSQL-Backup-Manifest-Version\": 2,\n"
+							 "\"System-Identifier\": 7300000000000000001,\n"
+							 "\"Files\": [\n");
+	for (int i = 0; i < BENCH_MANIFEST_FILES; i++)
+		len += (size_t) snprintf(m + len, cap - len,
+								 "{ \"Path\": \"base/%d/%d\", \"Size\": 8192, "
+								 "\"Last-Modified\": \"2026-01-08 10:05:30 GMT\", "
+								 "\"Checksum-Algorithm\": \"CRC32C\", "
+								 "\"Checksum\": \"%08x\" }%s\n",
+								 16384 + i / 10000, 16384 + i, (unsigned) i * 2654435761U,
+								 i + 1 < BENCH_MANIFEST_FILES ? "," : "");
+	len += (size_t) snprintf(m + len, cap - len,
+							 "],\n\"WAL-Ranges\": [\n"
+							 "{ \"Timeline\": 1, \"Start-LSN\": \"0/2000028\", "
+							 "\"End-LSN\": \"0/2000100\" }\n],\n"
+							 "\"Manifest-Checksum\": \"%064d\"}\n", 0);
+	b->manifest = m;
+	b->manifest_len = len;
+	return true;
+}
+
+static void
+bench_manifests(Bench *b)
+{
+	char path[PATH_MAX];
+
+	if (bench_selected(b, "ini_parse_file"))
+	{
+		path_join(path, sizeof(path), b->dir, "backup.manifest");
+		if (!make_ini_manifest(path))
+		{
+			fprintf(stderr, "bench: cannot write %s\n", path);
+			b->failed = true;
+			return;
+		}
+		bench_run(b, "ini_parse_file", NULL, BENCH_INI_KEYS, "keys/s", 1,
+				  bench_ini_parse_file, path);
+		unlink(path);
+	}
+
+	if (bench_selected(b, "manifest_reader"))
+	{
+		if (!make_backup_manifest(b))
+		{
+			fprintf(stderr, "Error: Memory allocation failed\n");
+			b->failed = true;
+			return;
+		}
+		bench_run(b, "manifest_reader", NULL, BENCH_MANIFEST_FILES,
+				  "entries/s", 1, bench_manifest_reader, b);
+		free(b->manifest);
+		b->manifest = NULL;
+	}
+}
+
+/* ------------------------------------------------------------------ *
+ * WAL records
+ * ------------------------------------------------------------------ */
+
+static void
+put_u16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t) v;
+	p[1] = (uint8_t) (v >> 8);
+}
+
+static void
+put_u32(uint8_t *p, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = (uint8_t) (v >> (8 * i));
+}
+
+static void
+put_u64(uint8_t *p, uint64_t v)
+{
+	for (int i = 0; i < 8; i++)
+		p[i] = (uint8_t) (v >> (8 * i));
+}
+
+/*
+ * Fill 'seg' with the pages of segment 'segno' of timeline 1: page
+ * headers, then WAL_RECORD_SIZE-byte records with valid CRCs for as long
+ * as they fit on the page, the rest left zero.  Only the first 'pages'
+ * pages are written; the others stay zero, as after a switch.
+ */
+static void
+fill_wal_segment(uint8_t *seg, uint32_t segno, const uint8_t *payload,
+				 uint32_t pages)
+{
+	memset(seg, 0, WAL_SEG_SIZE);
+	for (uint32_t page = 0; page < pages; page++)
+	{
+		uint8_t *p = seg + (size_t) page * WAL_BLCKSZ;
+		uint32_t off = page == 0 ? WAL_LONG_HDR_SIZE : WAL_SHORT_HDR_SIZE;
+
+		put_u16(p, 0xD071);
+		put_u16(p + 2, page == 0 ? XLP_LONG_HEADER : 0);
+		put_u32(p + 4, 1);
+		put_u64(p + 8, (uint64_t) segno * WAL_SEG_SIZE + (uint64_t) page * WAL_BLCKSZ);
+		if (page == 0)
+		{
+			put_u64(p + 24, 7300000000000000001ULL);
+			put_u32(p + 32, WAL_SEG_SIZE);
+			put_u32(p + 36, WAL_BLCKSZ);
+		}
+
+		for (; off + WAL_RECORD_SIZE <= WAL_BLCKSZ; off += WAL_RECORD_SIZE)
+		{
+			uint8_t *rec = p + off;
+			uint32_t crc = ~0U;
+
+			put_u32(rec, WAL_RECORD_SIZE);
+			put_u32(rec + 4, page);
+			memcpy(rec + 24, payload, WAL_RECORD_SIZE - 24);
+			crc = crc32c_update(crc, rec + 24, WAL_RECORD_SIZE - 24);
+			crc = crc32c_update(crc, rec, 20);
+			put_u32(rec + 20, ~crc);
+		}
+	}
+}
+
+static bool
+make_wal_dir(const char *dir, const uint8_t *payload, uint32_t pages)
+{
+	uint8_t *seg = malloc(WAL_SEG_SIZE);
+	bool     ok = seg != NULL && mkdir(dir, 0700) == 0;
+
+	for (uint32_t i = 1; ok && i <= BENCH_WAL_SEGS; i++)
+	{
+		WALSegmentName name = { 1, 0, i };
+		char           file[32];
+		char           path[PATH_MAX];
+		FILE          *fp;
+
+		fill_wal_segment(seg, i, payload, pages);
+		format_wal_filename(&name, file, sizeof(file));
+		path_join(path, sizeof(path), dir, file);
+		fp = fopen(path, "wb");
+		ok = fp != NULL && fwrite(seg, 1, WAL_SEG_SIZE, fp) == WAL_SEG_SIZE;
+		if (fp != NULL && fclose(fp) != 0)
+			ok = false;
+	}
+	free(seg);
+	return ok;
+}
+
+static uint64_t
+bench_check_wal_segments(void *arg)
+{
+	WALArchiveInfo   *info = arg;
+	ValidationResult *result;
+	uint64_t          pages = 0;
+
+	result = check_wal_segments(info, info->segments, info->segment_count);
+	if (result != NULL && result->error_count == 0)
+		pages = (uint64_t) info->segment_count * (WAL_SEG_SIZE / WAL_BLCKSZ);
+	free_validation_result(result);
+	return pages;
+}
+
+/* One WAL case: BENCH_WAL_SEGS segments with 'pages' pages written */
+static void
+bench_wal_case(Bench *b, const char *name, uint32_t pages)
+{
+	WALArchiveInfo *info;
+	char            dir[PATH_MAX];
+
+	if (!bench_selected(b, name))
+		return;
+
+	path_join(dir, sizeof(dir), b->dir, name);
+	if (!make_wal_dir(dir, b->buf, pages))
+	{
+		fprintf(stderr, "bench: cannot write WAL segments to %s\n", dir);
+		b->failed = true;
+		return;
+	}
+	info = scan_wal_archive(dir);
+	if (info == NULL || info->segment_count != BENCH_WAL_SEGS)
+	{
+		fprintf(stderr, "bench: cannot scan %s\n", dir);
+		free_wal_archive_info(info);
+		b->failed = true;
+		return;
+	}
+	bench_run(b, name, crc32c_implementation(),
+			  WAL_SEG_SIZE, "pages/s", 1, bench_check_wal_segments, info);
+	free_wal_archive_info(info);
+}
+
+static void
+bench_wal_records(Bench *b)
+{
+	bench_wal_case(b, "check_wal_segments", WAL_SEG_SIZE / WAL_BLCKSZ);
+	/* Mostly zero-filled segments: the page scan that skips them */
+	bench_wal_case(b, "check_wal_switched", BENCH_WAL_SWITCHED);
+}
+
+/* ------------------------------------------------------------------ */
+
+/* Remove the scratch directory and the directories of files under it */
+static void
+remove_scratch(const char *dir, int depth)
+{
+	DIR           *d = opendir(dir);
+	struct dirent *entry;
+	char           path[PATH_MAX];
+
+	if (d != NULL)
+	{
+		while ((entry = readdir(d)) != NULL)
+		{
+			if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+				continue;
+			path_join(path, sizeof(path), dir, entry->d_name);
+			if (depth > 0 && is_directory(path))
+				remove_scratch(path, depth - 1);
+			else
+				unlink(path);
+		}
+		closedir(d);
+	}
+	rmdir(dir);
+}
+
+static void
+usage(void)
+{
+	printf("Usage: pg_backup_auditor_bench [--min-time=SECONDS] [--filter=TEXT]\n"
+		   "                               [--jobs=N]\n\n"
+		   "  -t, --min-time=SECONDS  Time to spend on each case (default: 0.5)\n"
+		   "  -f, --filter=TEXT       Only run cases whose name contains TEXT\n"
+		   "  -j, --jobs=N            Worker threads for check_wal_segments (default: 1)\n"
+		   "  -h, --help              Show this help\n\n"
+		   "Results are written to stdout as NDJSON \"bench\" records.\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	static struct option long_options[] = {
+		{"min-time", required_argument, 0, 't'},
+		{"filter",   required_argument, 0, 'f'},
+		{"jobs",     required_argument, 0, 'j'},
+		{"help",     no_argument,       0, 'h'},
+		{0, 0, 0, 0}
+	};
+	Bench        b = { .min_time = 0.5 };
+	NdjsonRecord rec;
+	const char  *tmp = getenv("TMPDIR");
+	int          jobs = 1;
+	int          c;
+
+	while ((c = getopt_long(argc, argv, "t:f:j:h", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 't':
+				b.min_time = atof(optarg);
+				if (b.min_time <= 0)
+				{
+					fprintf(stderr, "Error: Invalid --min-time: %s\n", optarg);
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				break;
+			case 'f':
+				b.filter = optarg;
+				break;
+			case 'j':
+				jobs = atoi(optarg);
+				if (jobs < 1)
+				{
+					fprintf(stderr, "Error: Invalid --jobs: %s\n", optarg);
+					return EXIT_INVALID_ARGUMENTS;
+				}
+				break;
+			case 'h':
+				usage();
+				return EXIT_SUCCESS;
+			default:
+				usage();
+				return EXIT_INVALID_ARGUMENTS;
+		}
+	}
+
+	log_init();
+	log_set_level(LOG_ERROR);
+	crc32c_init();
+	sha1_hw_init();
+	sha256_hw_init();
+	validation_set_jobs(jobs);
+
+	snprintf(b.dir, sizeof(b.dir), "%s/pg_backup_auditor_bench.XXXXXX",
+			 tmp != NULL && tmp[0] != '\0' ? tmp : "/tmp");
+	b.buf = malloc(BENCH_BUF_SIZE);
+	if (b.buf == NULL || mkdtemp(b.dir) == NULL)
+	{
+		fprintf(stderr, "bench: cannot set up scratch space in %s\n", b.dir);
+		free(b.buf);
+		return EXIT_GENERAL_ERROR;
+	}
+	srand(1);
+	for (size_t i = 0; i < BENCH_BUF_SIZE; i++)
+		b.buf[i] = (uint8_t) rand();
+
+	ndjson_begin(&rec, stdout, "bench_run");
+	ndjson_string(&rec, "version", PG_BACKUP_AUDITOR_VERSION);
+	ndjson_time(&rec, "started", time(NULL));
+	ndjson_double(&rec, "min_time", b.min_time);
+	ndjson_uint(&rec, "jobs", (uint64_t) jobs);
+	ndjson_end(&rec);
+
+	bench_checksums(&b);
+	bench_wal_names(&b);
+	bench_manifests(&b);
+	bench_wal_records(&b);
+
+	remove_scratch(b.dir, 1);
+	free(b.buf);
+	log_cleanup();
+	return b.failed ? EXIT_GENERAL_ERROR : EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""
+End-to-end scaling benchmark: time list, check, audit and stat against
+synthetic catalogs of growing size.
+
+Usage:
+    python3 scale_catalog.py [options]
+
+For every entry of --tools and of --sizes (backups per catalog) a
+catalog is generated with tests/fixtures/create_large_catalog.py and each
+of --commands is run against it --repeat times; the fastest run counts.
+One NDJSON record per run goes to stdout:
+
+    {"record": "scale", "tool": "pg_probackup", "backups": 1000,
+     "wal_segments": 16000, "manifest_entries": 23500, "command": "check",
+     "args": ["--level=standard"], "seconds": 0.412, "exit": 0}
+
+Exit status 2 (validation failed) is an ordinary outcome here -- without
+--materialize, checksum-level runs report the manifests' data files as
+missing -- so only other statuses stop the run.
+
+When done, the growth exponent of every command (the slope of
+log(seconds) over log(backups), by least squares) is printed to stderr:
+about 1 means the command scales linearly with the catalog, 2 means
+quadratically.
+"""
+
+import argparse
+import json
+import math
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+sys.path.insert(0, os.path.join(ROOT, 'tests', 'fixtures'))
+
+import create_large_catalog  # noqa: E402
+
+COMMANDS = ('list', 'check', 'audit', 'stat')
+
+
+def command_args(command, stats, args):
+    """The auditor's argument vector for one command on one catalog."""
+    argv = [args.binary, command, '-B', stats['backup_dir']]
+    extra = []
+
+    if command == 'check':
+        extra.append(f'--level={args.level}')
+    if stats['wal_archive'] is not None and command != 'list':
+        argv.append(f'--wal-archive={stats["wal_archive"]}')
+    if args.jobs > 1:
+        extra.append(f'--jobs={args.jobs}')
+    return argv + extra, extra
+
+
+def time_command(argv, repeat):
+    """Best wall time of 'repeat' runs, and the exit status of the last"""
+    best = None
+    status = 0
+
+    for _ in range(repeat):
+        started = time.perf_counter()
+        status = subprocess.run(argv, stdout=subprocess.DEVNULL,
+                                stderr=subprocess.DEVNULL).returncode
+        elapsed = time.perf_counter() - started
+        best = elapsed if best is None else min(best, elapsed)
+    return best, status
+
+
+def growth_exponent(points):
+    """Least-squares slope of log(seconds) over log(backups)"""
+    pts = [(math.log(n), math.log(s)) for n, s in points if n > 0 and s > 0]
+    if len(pts) < 2:
+        return None
+    mx = sum(x for x, _ in pts) / len(pts)
+    my = sum(y for _, y in pts) / len(pts)
+    den = sum((x - mx) ** 2 for x, _ in pts)
+    if den == 0:
+        return None
+    return sum((x - mx) * (y - my) for x, y in pts) / den
+
+
+def catalog_args(tool, size, args):
+    """Options for create_large_catalog.create(), as its parser makes them"""
+    gen = create_large_catalog.parser().parse_args([
+        'unused', f'--tool={tool}', f'--backups={size}',
+        f'--chain-length={args.chain_length}',
+        f'--timelines={args.timelines}',
+        f'--manifest-files={args.manifest_files}',
+    ])
+    gen.materialize = args.materialize
+    return gen
+
+
+def run(args, workdir):
+    timings = {}
+
+    for tool in args.tools:
+        for size in args.sizes:
+            out = os.path.join(workdir, f'{tool}-{size}')
+            started = time.perf_counter()
+            stats = create_large_catalog.create(out, catalog_args(tool, size, args))
+            print(f'{tool}: {size} backups generated in '
+                  f'{time.perf_counter() - started:.1f}s', file=sys.stderr)
+
+            for command in args.commands:
+                argv, extra = command_args(command, stats, args)
+                seconds, status = time_command(argv, args.repeat)
+                if status not in (0, 2):
+                    print(f'error: {" ".join(argv)} exited with {status}',
+                          file=sys.stderr)
+                    return 1
+                print(json.dumps({
+                    'record': 'scale', 'tool': tool, 'backups': stats['backups'],
+                    'wal_segments': stats['wal_segments'],
+                    'manifest_entries': stats['manifest_entries'],
+                    'command': command, 'args': extra,
+                    'seconds': round(seconds, 6), 'exit': status,
+                }), flush=True)
+                timings.setdefault((tool, command), []).append(
+                    (stats['backups'], seconds))
+
+            if not args.keep:
+                shutil.rmtree(out, ignore_errors=True)
+
+    print('growth exponent (1 = linear):', file=sys.stderr)
+    for (tool, command), points in timings.items():
+        k = growth_exponent(points)
+        print(f'  {tool:14} {command:6} '
+              f'{"n/a" if k is None else format(k, ".2f")}', file=sys.stderr)
+    return 0
+
+
+def positive_list(text):
+    try:
+        values = [int(v) for v in text.split(',') if v]
+    except ValueError:
+        raise argparse.ArgumentTypeError(f'not a list of counts: {text}')
+    if not values or min(values) < 1:
+        raise argparse.ArgumentTypeError(f'not a list of counts: {text}')
+    return sorted(set(values))
+
+
+def name_list(choices):
+    def parse(text):
+        names = [v for v in text.split(',') if v]
+        for name in names:
+            if name not in choices:
+                raise argparse.ArgumentTypeError(
+                    f'unknown name {name} (choose from {", ".join(choices)})')
+        return names
+    return parse
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    p.add_argument('--binary', default=os.path.join(ROOT, 'pg_backup_auditor'),
+                   help='auditor to run (default: the one in the source tree)')
+    p.add_argument('--tools', type=name_list(
+        ('pg_probackup', 'pg_basebackup', 'pgbackrest')),
+        default=['pg_probackup'], help='comma-separated backup tools')
+    p.add_argument('--sizes', type=positive_list, default=[100, 300, 1000],
+                   help='comma-separated backup counts (default: 100,300,1000)')
+    p.add_argument('--commands', type=name_list(COMMANDS), default=list(COMMANDS),
+                   help='comma-separated commands (default: all four)')
+    p.add_argument('--level', default='standard', help='check --level')
+    p.add_argument('--jobs', type=int, default=1, help='--jobs for every command')
+    p.add_argument('--repeat', type=int, default=1,
+                   help='runs per command; the fastest counts')
+    p.add_argument('--chain-length', type=int, default=7)
+    p.add_argument('--timelines', type=int, default=1)
+    p.add_argument('--manifest-files', type=int, default=100)
+    p.add_argument('--materialize', action='store_true',
+                   help='write the data files listed in the manifests')
+    p.add_argument('--workdir', help='where to generate (default: a temporary '
+                   'directory, removed afterwards)')
+    p.add_argument('--keep', action='store_true',
+                   help='keep the generated catalogs')
+    args = p.parse_args()
+
+    if args.jobs < 1 or args.repeat < 1:
+        p.error('--jobs and --repeat must be positive')
+    if not os.access(args.binary, os.X_OK):
+        p.error(f'cannot run {args.binary}; build it first')
+
+    if args.workdir is not None:
+        os.makedirs(args.workdir, exist_ok=True)
+        return run(args, args.workdir)
+
+    workdir = tempfile.mkdtemp(prefix='pg_backup_auditor_scale_')
+    try:
+        return run(args, workdir)
+    finally:
+        if not args.keep:
+            shutil.rmtree(workdir, ignore_errors=True)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,549 @@
+#!/usr/bin/env python3
+"""
+Create a large synthetic backup catalog for scaling benchmarks.
+
+Usage:
+    python3 create_large_catalog.py [options] <output_dir>
+
+Unlike create_test_catalog.py, which writes one small functional fixture,
+this builds layouts the size of a busy production repository: thousands
+of backups in incremental chains, WAL archives of 100k+ segments over
+several timelines, and manifests of millions of entries.
+
+Layouts, by --tool:
+
+    pg_probackup   <out>/backups/<instance>/<ID>/{backup.control,
+                   backup_content.control,database/...}
+                   <out>/wal/<instance>/<segments, NNNNNNNN.history>
+
+    pg_basebackup  <out>/backups/<YYYYMMDD-HHMMSS>/{backup_label,
+                   backup_manifest,PG_VERSION,base/,global/pg_control}
+                   <out>/archive/<segments, NNNNNNNN.history>
+                   (one instance; incrementals are PostgreSQL 17 style,
+                   linked by INCREMENTAL FROM LSN)
+
+    pgbackrest     <out>/backup/<stanza>/{backup.info,<label>/...}
+                   <out>/archive/<stanza>/16-1/<TTTTTTTTLLLLLLLL>/<seg>-<sha1>
+
+Each backup covers one WAL segment; backups are spread evenly over the
+archive, so every WAL check has something to find.  Instances take their
+backups in turn, spread over --interval, so backup IDs and times are
+unique across the catalog.  Segments are sparse 16 MB files holding only
+the long page header, like the small fixture.  pgBackRest's segment name
+suffix is the SHA-1 of that header rather than of the whole file: the
+auditor does not recompute it, and hashing 16 MB per segment would
+dominate generation time.
+
+Manifests list the structural files with their real checksums plus
+--manifest-files data files (a tenth as many for incrementals).  The data
+files are only written with --materialize, and then the catalog passes
+check up to --level=full, so the timings are of the normal path rather
+than of error reporting; otherwise checksum-level runs report them as
+missing, which is still useful for timing the manifest pass itself.
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import struct
+import sys
+import time
+
+# ------------------------------------------------------------------ #
+# Constants                                                            #
+# ------------------------------------------------------------------ #
+
+SEG_SIZE  = 16 * 1024 * 1024   # 16 MB  (default PostgreSQL segment size)
+BLCKSZ    = 8192
+SYSID     = 7308243541062227871
+PG_VERSION = "16"
+EPOCH     = 1767225600         # 2026-01-01 00:00:00 UTC
+
+# ------------------------------------------------------------------ #
+# Checksums                                                            #
+# ------------------------------------------------------------------ #
+
+def _crc32c_table():
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x82F63B78 if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+
+CRC32C_TABLE = _crc32c_table()
+
+
+def crc32c(data):
+    crc = 0xFFFFFFFF
+    for b in data:
+        crc = CRC32C_TABLE[(crc ^ b) & 0xFF] ^ (crc >> 8)
+    return crc ^ 0xFFFFFFFF
+
+
+# ------------------------------------------------------------------ #
+# WAL                                                                  #
+# ------------------------------------------------------------------ #
+
+def wal_header(tli, segno):
+    """40-byte XLogLongPageHeaderData; see create_test_catalog.py."""
+    return struct.pack('<HHIQIxxxxQII',
+                       0xD071, 0x0002, tli, segno * SEG_SIZE, 0,
+                       SYSID, SEG_SIZE, BLCKSZ)
+
+
+def seg_filename(tli, segno):
+    return f'{tli:08X}{segno // 0x100:08X}{segno % 0x100:08X}'
+
+
+def lsn_str(lsn):
+    return f'{lsn >> 32:X}/{lsn & 0xFFFFFFFF:X}'
+
+
+class WalPlan:
+    """
+    Segments 1..count, split evenly across 'timelines'.  Timeline t + 1
+    branches off halfway through the first segment it holds, as after a
+    promotion: that segment is archived on both timelines, and every
+    history file lists all switches before it.
+    """
+
+    def __init__(self, count, timelines):
+        timelines = max(1, min(timelines, count))
+        self.count = count
+        self.starts = [1 + t * count // timelines for t in range(timelines)]
+
+    def timeline_of(self, segno):
+        tli = 1
+        for t, start in enumerate(self.starts):
+            if segno >= start:
+                tli = t + 1
+        return tli
+
+    def switch_lsn(self, tli):
+        """Where timeline tli + 1 branches off tli"""
+        return self.starts[tli] * SEG_SIZE + SEG_SIZE // 2
+
+    def first_lsn(self, segno):
+        """First LSN of segno on its own timeline"""
+        tli = self.timeline_of(segno)
+        if tli > 1 and segno == self.starts[tli - 1]:
+            return self.switch_lsn(tli - 1)
+        return segno * SEG_SIZE
+
+    def segments(self):
+        for segno in range(1, self.count + 1):
+            tli = self.timeline_of(segno)
+            if tli > 1 and segno == self.starts[tli - 1]:
+                yield tli - 1, segno    # the old timeline's last segment
+            yield tli, segno
+
+    def segment_count(self):
+        return self.count + len(self.starts) - 1
+
+    def history(self, tli):
+        lines = []
+        for parent in range(1, tli):
+            lines.append(f'{parent}\t{lsn_str(self.switch_lsn(parent))}'
+                         '\tno recovery target specified\n')
+        return ''.join(lines)
+
+
+def write_segment(path, tli, segno):
+    with open(path, 'wb') as fh:
+        fh.write(wal_header(tli, segno))
+        fh.truncate(SEG_SIZE)
+
+
+def write_wal_archive(wal_dir, plan, pgbackrest=False):
+    os.makedirs(wal_dir, exist_ok=True)
+    for tli in range(2, len(plan.starts) + 1):
+        with open(os.path.join(wal_dir, f'{tli:08X}.history'), 'w') as fh:
+            fh.write(plan.history(tli))
+
+    for tli, segno in plan.segments():
+        name = seg_filename(tli, segno)
+        if pgbackrest:
+            subdir = os.path.join(wal_dir, name[:16])
+            if not os.path.isdir(subdir):
+                os.mkdir(subdir)
+            sha1 = hashlib.sha1(wal_header(tli, segno)).hexdigest()
+            path = os.path.join(subdir, f'{name}-{sha1}')
+        else:
+            path = os.path.join(wal_dir, name)
+        write_segment(path, tli, segno)
+
+
+# ------------------------------------------------------------------ #
+# Backups                                                              #
+# ------------------------------------------------------------------ #
+
+class Backup:
+    """Where a backup sits in the catalog; tool-neutral."""
+
+    def __init__(self, index, args, plan, instance=0, prev_tli=None):
+        self.index = index
+        self.segno = 1 + index * (plan.count - 1) // max(1, args.backups - 1) \
+            if args.backups > 1 else 1
+        self.tli = plan.timeline_of(self.segno)
+        # A new timeline starts a new chain
+        self.full = index % args.chain_length == 0 or \
+            (prev_tli is not None and self.tli != prev_tli)
+        self.start_lsn = plan.first_lsn(self.segno) + 0x28
+        self.stop_lsn = self.segno * SEG_SIZE + 0xFF0000
+        # Instances back up in turn, so their IDs and times never coincide
+        self.start_time = EPOCH + index * args.interval + \
+            instance * (args.interval // args.instances)
+        self.end_time = self.start_time + min(300, args.interval // 2)
+        self.nfiles = args.manifest_files if self.full else \
+            max(1, args.manifest_files // 10)
+
+    def stamp(self, t=None, fmt='%Y%m%d-%H%M%S'):
+        return time.strftime(fmt, time.gmtime(self.start_time if t is None else t))
+
+
+def base36(n):
+    digits = '0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ'
+    out = ''
+    while n:
+        n, r = divmod(n, 36)
+        out = digits[r] + out
+    return out or '0'
+
+
+def data_files(backup, materialize):
+    """
+    (relative path, content or None, size) of the generated data files.
+    Materialized files are small so that millions of them stay cheap.
+    """
+    for i in range(backup.nfiles):
+        rel = f'base/{16384 + i // 10000}/{16384 + i}'
+        if materialize:
+            content = (f'{rel}:{backup.index}\n'.encode() * 4)[:16 + i % 240]
+            yield rel, content, len(content)
+        else:
+            yield rel, None, BLCKSZ
+
+
+def write_file(path, content):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, 'wb') as fh:
+        fh.write(content)
+
+
+def structural_files(backup, with_label):
+    files = {
+        'PG_VERSION': f'{PG_VERSION}\n'.encode(),
+        'global/pg_control': struct.pack('<Q', SYSID) + bytes(BLCKSZ - 8),
+    }
+    if with_label:
+        files['backup_label'] = backup_label(backup, None).encode()
+    return files
+
+
+def backup_label(backup, parent):
+    lines = [
+        f'START WAL LOCATION: {lsn_str(backup.start_lsn)} '
+        f'(file {seg_filename(backup.tli, backup.segno)})',
+        f'CHECKPOINT LOCATION: {lsn_str(backup.start_lsn + 0x60)}',
+        'BACKUP METHOD: streamed',
+        'BACKUP FROM: primary',
+        f'START TIME: {backup.stamp(fmt="%Y-%m-%d %H:%M:%S")} UTC',
+        f'LABEL: generated backup {backup.index}',
+        f'START TIMELINE: {backup.tli}',
+    ]
+    if parent is not None:
+        lines.append(f'INCREMENTAL FROM LSN: {lsn_str(parent.start_lsn)}')
+        lines.append(f'INCREMENTAL FROM TLI: {parent.tli}')
+    return '\n'.join(lines) + '\n'
+
+
+# --- pg_probackup -------------------------------------------------- #
+
+def create_pg_probackup(out, instance, backups, plan, args):
+    backup_dir = os.path.join(out, 'backups', instance)
+    write_wal_archive(os.path.join(out, 'wal', instance), plan)
+
+    parent_id = None
+    for b in backups:
+        backup_id = base36(b.start_time)
+        path = os.path.join(backup_dir, backup_id)
+        db = os.path.join(path, 'database')
+        os.makedirs(db, exist_ok=True)
+
+        files = structural_files(b, True)
+        files['database_map'] = b'1 postgres\n'
+        if not b.full:
+            del files['PG_VERSION']     # incrementals leave it out
+        lines = []
+        for rel, content in files.items():
+            write_file(os.path.join(db, rel), content)
+            lines.append(content_line(rel, len(content), crc32c(content)))
+        for rel, content, size in data_files(b, args.materialize):
+            if content is not None:
+                write_file(os.path.join(db, rel), content)
+            lines.append(content_line(rel, size,
+                                      crc32c(content) if content is not None
+                                      else (b.index * 2654435761 + size) & 0xFFFFFFFF))
+        with open(os.path.join(path, 'backup_content.control'), 'w') as fh:
+            fh.writelines(lines)
+
+        data_bytes = sum(len(c) for c in files.values()) + b.nfiles * BLCKSZ
+        control = (
+            f'#Configuration\n'
+            f'backup-mode = {"FULL" if b.full else "DELTA"}\n'
+            f'stream = false\n'
+            f'compress-alg = none\n'
+            f'compress-level = 1\n'
+            f'from-replica = false\n'
+            f'\n#Compatibility\n'
+            f'block-size = 8192\n'
+            f'xlog-block-size = 8192\n'
+            f'checksum-version = 1\n'
+            f'program-version = 2.5.15\n'
+            f'server-version = {PG_VERSION}\n'
+            f'\n#Result backup info\n'
+            f'timelineid = {b.tli}\n'
+            f'start-lsn = {lsn_str(b.start_lsn)}\n'
+            f'stop-lsn = {lsn_str(b.stop_lsn)}\n'
+            f"start-time = '{b.stamp(fmt='%Y-%m-%d %H:%M:%S')}+00'\n"
+            f"end-time = '{b.stamp(b.end_time, '%Y-%m-%d %H:%M:%S')}+00'\n"
+            f'data-bytes = {data_bytes}\n'
+            f'wal-bytes = {SEG_SIZE}\n'
+            f'status = OK\n'
+        )
+        if not b.full:
+            control += f"parent-backup-id = '{parent_id}'\n"
+        with open(os.path.join(path, 'backup.control'), 'w') as fh:
+            fh.write(control)
+        parent_id = backup_id
+
+
+def content_line(rel, size, crc):
+    return json.dumps({
+        'path': rel, 'size': str(size), 'kind': 'reg', 'mode': '33184',
+        'is_datafile': '1' if rel.startswith('base/') else '0',
+        'is_cfs': '0', 'crc': str(crc), 'compress_alg': 'none',
+        'external_dir_num': '0', 'dbOid': '0',
+    }, separators=(', ', ':')) + '\n'
+
+
+# --- pg_basebackup ------------------------------------------------- #
+
+def create_pg_basebackup(out, backups, plan, args):
+    backup_dir = os.path.join(out, 'backups')
+    write_wal_archive(os.path.join(out, 'archive'), plan)
+
+    parent = None
+    for b in backups:
+        path = os.path.join(backup_dir, b.stamp())
+        os.makedirs(os.path.join(path, 'base'), exist_ok=True)
+
+        files = structural_files(b, False)
+        files['backup_label'] = backup_label(b, None if b.full else parent).encode()
+        entries = []
+        for rel, content in files.items():
+            write_file(os.path.join(path, rel), content)
+            entries.append(manifest_entry(rel, len(content), crc32c(content)))
+        for rel, content, size in data_files(b, args.materialize):
+            if content is not None:
+                write_file(os.path.join(path, rel), content)
+            entries.append(manifest_entry(rel, size,
+                                          crc32c(content) if content is not None
+                                          else (b.index * 2654435761 + size) & 0xFFFFFFFF))
+
+        body = ('{ "PostgreSQL-Backup-Manifest-Version": 2,\n'
+                f'"System-Identifier": {SYSID},\n'
+                '"Files": [\n' + ',\n'.join(entries) + '\n],\n'
+                '"WAL-Ranges": [\n'
+                f'{{ "Timeline": {b.tli}, "Start-LSN": "{lsn_str(b.start_lsn)}", '
+                f'"End-LSN": "{lsn_str(b.stop_lsn)}" }}\n'
+                '],\n')
+        checksum = hashlib.sha256(body.encode()).hexdigest()
+        with open(os.path.join(path, 'backup_manifest'), 'w') as fh:
+            fh.write(body)
+            fh.write(f'"Manifest-Checksum": "{checksum}"}}\n')
+        os.utime(os.path.join(path, 'backup_manifest'), (b.end_time, b.end_time))
+        parent = b
+
+
+def manifest_entry(rel, size, crc):
+    return (f'{{ "Path": "{rel}", "Size": {size}, '
+            f'"Last-Modified": "2026-01-01 00:00:00 GMT", '
+            f'"Checksum-Algorithm": "CRC32C", '
+            f'"Checksum": "{struct.pack("<I", crc).hex()}" }}')
+
+
+# --- pgBackRest ---------------------------------------------------- #
+
+def create_pgbackrest(out, stanza, backups, plan, args):
+    stanza_dir = os.path.join(out, 'backup', stanza)
+    os.makedirs(stanza_dir, exist_ok=True)
+    write_wal_archive(os.path.join(out, 'archive', stanza, f'{PG_VERSION}-1'),
+                      plan, pgbackrest=True)
+
+    current = []
+    full_label = None
+    prior = None
+    for b in backups:
+        if b.full:
+            label = full_label = b.stamp() + 'F'
+        else:
+            label = f'{full_label}_{b.stamp()}I'
+        path = os.path.join(stanza_dir, label)
+        pg_data = os.path.join(path, 'pg_data')
+        os.makedirs(pg_data, exist_ok=True)
+
+        start_seg = seg_filename(b.tli, b.segno)
+        lines = [
+            '[backrest]\nbackrest-format=5\nbackrest-version="2.50"\n\n',
+            '[backup]\n',
+            f'backup-archive-start="{start_seg}"\n',
+            f'backup-archive-stop="{start_seg}"\n',
+            f'backup-label="{label}"\n',
+            f'backup-lsn-start="{lsn_str(b.start_lsn)}"\n',
+            f'backup-lsn-stop="{lsn_str(b.stop_lsn)}"\n',
+        ]
+        if prior is not None and not b.full:
+            lines.append(f'backup-prior="{prior}"\n')
+        lines += [
+            f'backup-timestamp-start={b.start_time}\n',
+            f'backup-timestamp-stop={b.end_time}\n',
+            f'backup-type="{"full" if b.full else "incr"}"\n\n',
+            '[backup:db]\n',
+            f'db-id=1\ndb-system-id={SYSID}\ndb-version="{PG_VERSION}"\n\n',
+            '[backup:option]\noption-compress=false\n\n',
+            '[target:file]\n',
+        ]
+        size = 0
+        for rel, content in structural_files(b, True).items():
+            write_file(os.path.join(pg_data, rel), content)
+            lines.append(rest_entry(rel, len(content), hashlib.sha1(content).hexdigest(), b))
+            size += len(content)
+        for rel, content, fsize in data_files(b, args.materialize):
+            if content is not None:
+                write_file(os.path.join(pg_data, rel), content)
+                sha1 = hashlib.sha1(content).hexdigest()
+            else:
+                sha1 = hashlib.sha1(f'{rel}:{b.index}'.encode()).hexdigest()
+            lines.append(rest_entry(rel, fsize, sha1, b))
+            size += fsize
+
+        manifest = ''.join(lines)
+        for name in ('backup.manifest', 'backup.manifest.copy'):
+            with open(os.path.join(path, name), 'w') as fh:
+                fh.write(manifest)
+
+        info = {
+            'backrest-format': 5, 'backrest-version': '2.50',
+            'backup-archive-start': start_seg, 'backup-archive-stop': start_seg,
+            'backup-info-repo-size': size, 'backup-info-repo-size-delta': size,
+            'backup-info-size': size, 'backup-info-size-delta': size,
+            'backup-lsn-start': lsn_str(b.start_lsn),
+            'backup-lsn-stop': lsn_str(b.stop_lsn),
+            'backup-prior': None if b.full else prior,
+            'backup-timestamp-start': b.start_time,
+            'backup-timestamp-stop': b.end_time,
+            'backup-type': 'full' if b.full else 'incr',
+            'db-id': 1, 'option-archive-check': True, 'option-archive-copy': False,
+        }
+        current.append(f'{label}={json.dumps(info, separators=(",", ":"))}\n')
+        prior = label
+
+    with open(os.path.join(stanza_dir, 'backup.info'), 'w') as fh:
+        fh.write('[backrest]\nbackrest-format=5\nbackrest-version="2.50"\n\n')
+        fh.write('[backup:current]\n')
+        fh.writelines(current)
+        fh.write(f'\n[db]\ndb-id=1\ndb-system-id={SYSID}\ndb-version="{PG_VERSION}"\n')
+
+
+def rest_entry(rel, size, sha1, b):
+    return (f'pg_data/{rel}={{"checksum":"{sha1}","size":{size},'
+            f'"timestamp":{b.start_time}}}\n')
+
+
+# ------------------------------------------------------------------ #
+# Entry point                                                          #
+# ------------------------------------------------------------------ #
+
+def create(out, args):
+    """Write the catalog under 'out'; returns its sizes and the -B/--wal-archive paths."""
+    plan = WalPlan(args.wal_segments or args.backups * 16, args.timelines)
+    stats = {'tool': args.tool, 'instances': args.instances,
+             'backups': args.backups * args.instances,
+             'wal_segments': plan.segment_count() * args.instances,
+             'timelines': len(plan.starts)}
+
+    for n in range(args.instances):
+        backups = []
+        for i in range(args.backups):
+            backups.append(Backup(i, args, plan, n,
+                                  backups[-1].tli if backups else None))
+        name = f'instance{n + 1}'
+        if args.tool == 'pg_probackup':
+            create_pg_probackup(out, name, backups, plan, args)
+        elif args.tool == 'pgbackrest':
+            create_pgbackrest(out, name, backups, plan, args)
+        else:
+            create_pg_basebackup(out, backups, plan, args)
+        stats.setdefault('manifest_entries', 0)
+        stats['manifest_entries'] += sum(b.nfiles for b in backups)
+
+    if args.tool == 'pg_probackup':
+        backup_dir, wal_dir = os.path.join(out, 'backups'), None
+    elif args.tool == 'pgbackrest':
+        backup_dir, wal_dir = out, None
+    else:
+        backup_dir, wal_dir = os.path.join(out, 'backups'), os.path.join(out, 'archive')
+    stats['backup_dir'] = backup_dir
+    stats['wal_archive'] = wal_dir
+    return stats
+
+
+def parser():
+    p = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    p.add_argument('output_dir')
+    p.add_argument('--tool', choices=('pg_probackup', 'pg_basebackup', 'pgbackrest'),
+                   default='pg_probackup')
+    p.add_argument('--instances', type=int, default=1,
+                   help='instances (pgBackRest stanzas); pg_basebackup has one')
+    p.add_argument('--backups', type=int, default=100, help='backups per instance')
+    p.add_argument('--chain-length', type=int, default=7,
+                   help='backups per chain: one FULL, then incrementals '
+                   '(a new timeline starts a new chain)')
+    p.add_argument('--timelines', type=int, default=1)
+    p.add_argument('--wal-segments', type=int, default=0,
+                   help='segments per instance (default: 16 per backup)')
+    p.add_argument('--manifest-files', type=int, default=100,
+                   help='data files per FULL backup (incrementals: a tenth)')
+    p.add_argument('--interval', type=int, default=3600,
+                   help='seconds between backups')
+    p.add_argument('--materialize', action='store_true',
+                   help='write the data files listed in the manifests')
+    return p
+
+
+def check_args(p, args):
+    if args.backups < 1 or args.chain_length < 1 or args.instances < 1 or \
+            args.timelines < 1 or args.manifest_files < 0 or args.interval < 2:
+        p.error('counts must be positive')
+    if args.tool == 'pg_basebackup' and args.instances != 1:
+        p.error('pg_basebackup catalogs hold a single instance')
+    if args.wal_segments and args.wal_segments < args.timelines:
+        p.error('--wal-segments must be at least --timelines')
+    if args.interval < args.instances:
+        p.error('--interval must be at least --instances')
+
+
+if __name__ == '__main__':
+    p = parser()
+    args = p.parse_args()
+    check_args(p, args)
+    started = time.time()
+    stats = create(args.output_dir, args)
+    stats['seconds'] = round(time.time() - started, 3)
+    print(json.dumps(stats))
+    sys.exit(0)
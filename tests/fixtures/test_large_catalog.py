@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""
+Check that create_large_catalog.py writes catalogs the auditor accepts.
+
+Usage:
+    python3 test_large_catalog.py [unittest options]
+
+Every tool's catalog is generated with several timelines and, where the
+tool has them, several instances, and must pass check --level=checksums
+with exit status 0: otherwise the scaling benchmark would time error
+reporting rather than validation.  The auditor is the one in the source
+tree, or $PG_BACKUP_AUDITOR_BINARY.
+"""
+
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+sys.path.insert(0, HERE)
+
+import create_large_catalog  # noqa: E402
+
+BINARY = os.environ.get('PG_BACKUP_AUDITOR_BINARY',
+                        os.path.join(ROOT, 'pg_backup_auditor'))
+
+# --tool value -> tool name in list output
+TOOL_NAMES = {
+    'pg_probackup': 'pg_probackup',
+    'pg_basebackup': 'pg_basebackup',
+    'pgbackrest': 'pgBackRest',
+}
+
+
+class LargeCatalogTest(unittest.TestCase):
+
+    def setUp(self):
+        if not os.access(BINARY, os.X_OK):
+            self.skipTest(f'cannot run {BINARY}; build it first')
+        self.workdir = tempfile.mkdtemp(prefix='pg_backup_auditor_catalog_')
+
+    def tearDown(self):
+        shutil.rmtree(self.workdir, ignore_errors=True)
+
+    def generate(self, tool, instances):
+        args = create_large_catalog.parser().parse_args([
+            'unused', f'--tool={tool}', f'--instances={instances}',
+            '--backups=15', '--chain-length=4', '--timelines=3',
+            '--manifest-files=10', '--materialize',
+        ])
+        create_large_catalog.check_args(create_large_catalog.parser(), args)
+        return create_large_catalog.create(os.path.join(self.workdir, tool), args)
+
+    def run_auditor(self, command, stats, *extra):
+        argv = [BINARY, command, '-B', stats['backup_dir']]
+        if stats['wal_archive'] is not None and command != 'list':
+            argv.append(f'--wal-archive={stats["wal_archive"]}')
+        return subprocess.run(argv + list(extra), capture_output=True, text=True)
+
+    def check_tool(self, tool, instances):
+        stats = self.generate(tool, instances)
+
+        check = self.run_auditor('check', stats, '--level=checksums')
+        self.assertEqual(check.returncode, 0, check.stdout + check.stderr)
+
+        listing = self.run_auditor('list', stats, '--format=ndjson')
+        self.assertEqual(listing.returncode, 0, listing.stderr)
+        ids = [r['backup_id'] for r in map(json.loads, listing.stdout.splitlines())
+               if r.get('record') == 'backup' and r.get('tool') == TOOL_NAMES[tool]]
+        self.assertEqual(len(ids), stats['backups'])
+        self.assertEqual(len(set(ids)), len(ids), 'backup IDs repeat')
+
+    def test_pg_probackup(self):
+        self.check_tool('pg_probackup', 2)
+
+    def test_pg_basebackup(self):
+        self.check_tool('pg_basebackup', 1)
+
+    def test_pgbackrest(self):
+        self.check_tool('pgbackrest', 2)
+
+
+if __name__ == '__main__':
+    unittest.main()
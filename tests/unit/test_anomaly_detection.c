@@ -17,25 +17,18 @@
 #include <time.h>
 #include <stdbool.h>
 #include "../include/types.h"
+#include "backup_stats.h"
+#include "anomaly_detector.h"
 
 /* Forward declarations of functions we're testing */
-typedef struct {
-	BackupTool tool;
-	BackupType type;
-	int count;
-	uint64_t total_size;
-	time_t total_duration;
-	double avg_size;
-	double avg_duration;
-	double stddev_size;
-} BackupTypeStats;
-
 typedef struct {
 	char backup_id[64];
 	const char *anomaly_type;
 	double value;
 	double avg;
 	double multiplier;
+	double ewma;
+	double score;
 } AnomalyRecord;
 
 typedef struct {
@@ -44,8 +37,7 @@ typedef struct {
 	int capacity;
 } AnomalyList;
 
-BackupTypeStats* calculate_backup_stats(BackupInfo *backups, int *out_count);
-AnomalyList* detect_anomalies(BackupInfo *backups, BackupTypeStats *stats, int stats_count, bool detect_size_small);
+AnomalyList* detect_anomalies(BackupInfo *backups, AnomalyDetector *detector, bool detect_size_small);
 
 /* Helper to create a backup */
 static BackupInfo*
@@ -83,35 +75,30 @@ START_TEST(test_stats_per_tool_type)
 	b3->next = b4;
 	b4->next = NULL;
 
-	int count = 0;
-	BackupTypeStats *stats = calculate_backup_stats(b1, &count);
+	BackupStats *stats = backup_stats_build(b1, BACKUP_STATS_BY_TOOL);
 
 	ck_assert_ptr_nonnull(stats);
-	ck_assert_int_eq(count, 2);  /* Two combinations: (pg_basebackup, FULL) and (pg_probackup, FULL) */
+	ck_assert_int_eq(stats->group_count, 2);  /* Two combinations: (pg_basebackup, FULL) and (pg_probackup, FULL) */
 
 	/* Find each stat and verify it's separate */
-	BackupTypeStats *st_pgbase = NULL, *st_pgpro = NULL;
-	for (int i = 0; i < count; i++)
-	{
-		if (stats[i].tool == BACKUP_TOOL_PG_BASEBACKUP && stats[i].type == BACKUP_TYPE_FULL)
-			st_pgbase = &stats[i];
-		if (stats[i].tool == BACKUP_TOOL_PG_PROBACKUP && stats[i].type == BACKUP_TYPE_FULL)
-			st_pgpro = &stats[i];
-	}
+	const BackupStatGroup *st_pgbase =
+		backup_stats_group(stats, BACKUP_TOOL_PG_BASEBACKUP, NULL, BACKUP_TYPE_FULL);
+	const BackupStatGroup *st_pgpro =
+		backup_stats_group(stats, BACKUP_TOOL_PG_PROBACKUP, NULL, BACKUP_TYPE_FULL);
 
 	ck_assert_ptr_nonnull(st_pgbase);
 	ck_assert_ptr_nonnull(st_pgpro);
 
 	/* pg_basebackup avg should be ~1.05 GB */
 	ck_assert_int_eq(st_pgbase->count, 2);
-	ck_assert(st_pgbase->avg_size > 1000000000 && st_pgbase->avg_size < 1200000000);
+	ck_assert(st_pgbase->baseline_size.mean > 1000000000 && st_pgbase->baseline_size.mean < 1200000000);
 
 	/* pg_probackup avg should be ~0.525 GB */
 	ck_assert_int_eq(st_pgpro->count, 2);
-	ck_assert(st_pgpro->avg_size > 500000000 && st_pgpro->avg_size < 600000000);
+	ck_assert(st_pgpro->baseline_size.mean > 500000000 && st_pgpro->baseline_size.mean < 600000000);
 
 	/* Clean up */
-	free(stats);
+	backup_stats_free(stats);
 	free(b1);
 	free(b2);
 	free(b3);
@@ -139,9 +126,8 @@ START_TEST(test_anomaly_large_size)
 	b5->next = b6;
 	b6->next = NULL;
 
-	int count = 0;
-	BackupTypeStats *stats = calculate_backup_stats(b1, &count);
-	AnomalyList *anomalies = detect_anomalies(b1, stats, count, true);
+	AnomalyDetector *detector = anomaly_detector_open(NULL);
+	AnomalyList *anomalies = detect_anomalies(b1, detector, true);
 
 	ck_assert_ptr_nonnull(anomalies);
 	ck_assert_int_eq(anomalies->count, 1);  /* Should find 1 anomaly */
@@ -151,7 +137,7 @@ START_TEST(test_anomaly_large_size)
 
 	free(anomalies->items);
 	free(anomalies);
-	free(stats);
+	anomaly_detector_close(detector);
 	free(b1);
 	free(b2);
 	free(b3);
@@ -179,9 +165,8 @@ START_TEST(test_anomaly_not_mixed_tools)
 	b3->next = b4;
 	b4->next = NULL;
 
-	int count = 0;
-	BackupTypeStats *stats = calculate_backup_stats(b1, &count);
-	AnomalyList *anomalies = detect_anomalies(b1, stats, count, true);
+	AnomalyDetector *detector = anomaly_detector_open(NULL);
+	AnomalyList *anomalies = detect_anomalies(b1, detector, true);
 
 	/* pg_probackup 500MB is NOT anomalous for pg_probackup (it's the average) */
 	ck_assert_ptr_nonnull(anomalies);
@@ -189,7 +174,7 @@ START_TEST(test_anomaly_not_mixed_tools)
 
 	free(anomalies->items);
 	free(anomalies);
-	free(stats);
+	anomaly_detector_close(detector);
 	free(b1);
 	free(b2);
 	free(b3);
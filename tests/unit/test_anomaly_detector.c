@@ -0,0 +1,220 @@
+/*
+ * test_anomaly_detector.c
+ *
+ * Unit tests for the incremental anomaly detector
+ * (src/common/anomaly_detector.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pg_backup_auditor.h"
+#include "anomaly_detector.h"
+
+static void
+set_backup(BackupInfo *b, const char *id, const char *instance,
+		   uint64_t bytes, time_t start, time_t duration)
+{
+	memset(b, 0, sizeof(*b));
+	str_copy(b->backup_id, id, sizeof(b->backup_id));
+	str_copy(b->instance_name, instance, sizeof(b->instance_name));
+	b->tool = BACKUP_TOOL_PG_PROBACKUP;
+	b->type = BACKUP_TYPE_FULL;
+	b->status = BACKUP_STATUS_OK;
+	b->data_bytes = bytes;
+	b->start_time = start;
+	b->end_time = start + duration;
+}
+
+/* Observe one backup, returning its number of findings */
+static int
+observe(AnomalyDetector *d, const char *id, const char *instance,
+		uint64_t bytes, time_t start, time_t duration, AnomalyFinding *out)
+{
+	BackupInfo b;
+
+	set_backup(&b, id, instance, bytes, start, duration);
+	return anomaly_detector_observe(d, &b, true, out);
+}
+
+/* Median and MAD over the window; the moving average follows the values */
+START_TEST(test_anomaly_series)
+{
+	AnomalySeries s;
+	double        median, mad;
+
+	memset(&s, 0, sizeof(s));
+	ck_assert(!anomaly_series_median(&s, &median, &mad));
+
+	anomaly_series_add(&s, 10.0);
+	ck_assert(s.ewma == 10.0);
+	anomaly_series_add(&s, 30.0);
+	ck_assert(fabs(s.ewma - (10.0 + ANOMALY_EWMA_ALPHA * 20.0)) < 1e-9);
+	anomaly_series_add(&s, 1000.0);
+	anomaly_series_add(&s, 20.0);
+	ck_assert(anomaly_series_median(&s, &median, &mad));
+	/* 10 20 30 1000: median 25; deviations 5 5 15 975, MAD 10 */
+	ck_assert(median == 25.0);
+	ck_assert(mad == 10.0);
+
+	/* Past the window only the latest values count */
+	for (int i = 0; i < ANOMALY_WINDOW; i++)
+		anomaly_series_add(&s, 7.0);
+	ck_assert_uint_eq(s.count, ANOMALY_WINDOW + 4);
+	ck_assert(anomaly_series_median(&s, &median, &mad));
+	ck_assert(median == 7.0);
+	ck_assert(mad == 0.0);
+}
+END_TEST
+
+/* Instances of one tool have baselines of their own */
+START_TEST(test_anomaly_per_instance)
+{
+	AnomalyDetector *d = anomaly_detector_open(NULL);
+	AnomalyFinding   out[ANOMALY_MAX_FINDINGS];
+	time_t           t = 1700000000;
+
+	ck_assert_ptr_nonnull(d);
+	for (int i = 0; i < 6; i++)
+	{
+		char id[16];
+
+		snprintf(id, sizeof(id), "s%d", i);
+		ck_assert_int_eq(observe(d, id, "small", 1000 + i * 10, t, 60 + i, out), 0);
+		snprintf(id, sizeof(id), "b%d", i);
+		ck_assert_int_eq(observe(d, id, "big", 100000 - i * 100, t + 1, 6000 - i, out), 0);
+		t += 86400;
+	}
+	ck_assert_int_eq(anomaly_detector_baselines(d), 2);
+
+	/* Normal for "big", but not for "small" */
+	ck_assert_int_eq(observe(d, "s6", "small", 100000, t, 62, out), 1);
+	ck_assert_str_eq(out[0].backup_id, "s6");
+	ck_assert_int_eq(out[0].kind, ANOMALY_SIZE_LARGE);
+	ck_assert(out[0].median == 1025.0);
+	ck_assert(out[0].ratio > 90.0);
+	ck_assert(out[0].score > ANOMALY_SCORE);
+
+	/* Both measures at once */
+	ck_assert_int_eq(observe(d, "b6", "big", 10000, t + 1, 600, out), 2);
+	ck_assert_int_eq(out[0].kind, ANOMALY_SIZE_SMALL);
+	ck_assert_int_eq(out[1].kind, ANOMALY_DURATION_SHORT);
+
+	/* Not scored below ANOMALY_MIN_HISTORY, nor when not a baseline one */
+	ck_assert_int_eq(observe(d, "n0", "new", 10, t, 1, out), 0);
+	ck_assert_int_eq(observe(d, "n1", "new", 10, t + 1, 1, out), 0);
+	ck_assert_int_eq(observe(d, "n2", "new", 10000, t + 2, 100, out), 0);
+	ck_assert_int_eq(observe(d, "n3", "new", 0, t + 3, 1000, out), 0);
+
+	anomaly_detector_close(d);
+}
+END_TEST
+
+/* A lasting change of level stops being reported once the average follows */
+START_TEST(test_anomaly_level_shift)
+{
+	AnomalyDetector *d = anomaly_detector_open(NULL);
+	AnomalyFinding   out[ANOMALY_MAX_FINDINGS];
+	char             id[16];
+	int              reported = 0;
+	time_t           t = 1700000000;
+
+	for (int i = 0; i < 10; i++, t += 3600)
+	{
+		snprintf(id, sizeof(id), "a%d", i);
+		ck_assert_int_eq(observe(d, id, "db", 1000 + (i % 3), t, 60, out), 0);
+	}
+	for (int i = 0; i < 10; i++, t += 3600)
+	{
+		snprintf(id, sizeof(id), "b%d", i);
+		reported += observe(d, id, "db", 5000 + (i % 3), t, 60, out);
+	}
+	ck_assert_int_ge(reported, 1);
+	ck_assert_int_le(reported, 3);
+
+	/* Already folded in: not scored again, and no finding to recall */
+	ck_assert_int_eq(observe(d, "zzz", "db", 1, t - 3600, 60, out), 0);
+
+	anomaly_detector_close(d);
+}
+END_TEST
+
+/* Baselines and findings survive in the cache directory */
+START_TEST(test_anomaly_persistence)
+{
+	char             dir[PATH_MAX];
+	char             cmd[PATH_MAX + 16];
+	AnomalyDetector *d;
+	AnomalyFinding   out[ANOMALY_MAX_FINDINGS];
+	char             id[16];
+	time_t           t = 1700000000;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_anomaly_test_%d", getpid());
+	ck_assert_int_eq(mkdir(dir, 0755), 0);
+	validation_set_cache_dir(dir);
+
+	d = anomaly_detector_open("/backups");
+	for (int i = 0; i < 5; i++)
+	{
+		snprintf(id, sizeof(id), "f%d", i);
+		ck_assert_int_eq(observe(d, id, "db", 1000 + i, t + i * 3600, 60, out), 0);
+	}
+	ck_assert_int_eq(observe(d, "huge", "db", 9000, t + 5 * 3600, 60, out), 1);
+	anomaly_detector_close(d);
+
+	/* The next run recalls the finding and scores only the new backup */
+	d = anomaly_detector_open("/backups");
+	ck_assert_int_eq(anomaly_detector_baselines(d), 1);
+	ck_assert_int_eq(observe(d, "f4", "db", 1004, t + 4 * 3600, 60, out), 0);
+	ck_assert_int_eq(observe(d, "huge", "db", 9000, t + 5 * 3600, 60, out), 1);
+	ck_assert_str_eq(out[0].backup_id, "huge");
+	ck_assert_int_eq(out[0].kind, ANOMALY_SIZE_LARGE);
+	ck_assert(out[0].median == 1002.0);
+	ck_assert_int_eq(observe(d, "slow", "db", 1003, t + 6 * 3600, 600, out), 1);
+	ck_assert_int_eq(out[0].kind, ANOMALY_DURATION_LONG);
+	anomaly_detector_close(d);
+
+	/* A finding is dropped when its backup is not observed: gone from the catalog */
+	d = anomaly_detector_open("/backups");
+	ck_assert_int_eq(observe(d, "slow", "db", 1003, t + 6 * 3600, 600, out), 1);
+	anomaly_detector_close(d);
+	d = anomaly_detector_open("/backups");
+	ck_assert_int_eq(observe(d, "huge", "db", 9000, t + 5 * 3600, 60, out), 0);
+	ck_assert_int_eq(observe(d, "slow", "db", 1003, t + 6 * 3600, 600, out), 1);
+	anomaly_detector_close(d);
+
+	/* Another catalog has baselines of its own */
+	d = anomaly_detector_open("/elsewhere");
+	ck_assert_int_eq(anomaly_detector_baselines(d), 0);
+	anomaly_detector_close(d);
+
+	validation_set_cache_dir(NULL);
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+END_TEST
+
+Suite *
+anomaly_detector_suite(void)
+{
+	Suite *s = suite_create("anomaly_detector");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_anomaly_series);
+	tcase_add_test(tc, test_anomaly_per_instance);
+	tcase_add_test(tc, test_anomaly_level_shift);
+	tcase_add_test(tc, test_anomaly_persistence);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -57,6 +57,26 @@ START_TEST(test_parse_string_option_independent_flags)
 }
 END_TEST
 
+/* Durations take s, m, h and d suffixes; zero and junk are rejected */
+START_TEST(test_parse_duration_argument)
+{
+	time_t t = 0;
+
+	ck_assert(parse_duration_argument("45", &t, "--x"));
+	ck_assert_int_eq(t, 45);
+	ck_assert(parse_duration_argument("90m", &t, "--x"));
+	ck_assert_int_eq(t, 5400);
+	ck_assert(parse_duration_argument("4h", &t, "--x"));
+	ck_assert_int_eq(t, 14400);
+	ck_assert(parse_duration_argument("2d", &t, "--x"));
+	ck_assert_int_eq(t, 172800);
+	ck_assert(!parse_duration_argument("0", &t, "--x"));
+	ck_assert(!parse_duration_argument("-5m", &t, "--x"));
+	ck_assert(!parse_duration_argument("1w", &t, "--x"));
+	ck_assert(!parse_duration_argument("99999999999d", &t, "--x"));
+}
+END_TEST
+
 Suite *
 arg_parser_suite(void)
 {
@@ -66,6 +86,7 @@ arg_parser_suite(void)
 	tcase_add_test(tc, test_parse_string_option_first_call);
 	tcase_add_test(tc, test_parse_string_option_duplicate);
 	tcase_add_test(tc, test_parse_string_option_independent_flags);
+	tcase_add_test(tc, test_parse_duration_argument);
 	suite_add_tcase(s, tc);
 
 	return s;
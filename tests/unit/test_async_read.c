@@ -0,0 +1,152 @@
+/*
+ * test_async_read.c
+ *
+ * Unit tests for the asynchronous whole-file reader
+ * (src/common/async_read.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pg_backup_auditor.h"
+#include "async_read.h"
+#include "crc32c.h"
+
+#define NFILES 48
+
+typedef struct {
+	uint32_t crc;
+	uint64_t total;
+	int      done;
+	int      error;
+} FileState;
+
+static void
+on_data(void *arg, const uint8_t *buf, size_t len)
+{
+	FileState *fs = arg;
+
+	fs->crc = crc32c_update(fs->crc, buf, len);
+	fs->total += len;
+}
+
+static void
+on_done(void *arg, int error)
+{
+	FileState *fs = arg;
+
+	fs->done++;
+	fs->error = error;
+}
+
+static size_t
+file_size(int i)
+{
+	switch (i)
+	{
+		case 0:  return 0;
+		case 1:  return ASYNC_READ_BUF_SIZE;            /* exact buffer */
+		case 2:  return 3 * ASYNC_READ_BUF_SIZE + 17;
+		default: return (size_t) (i * 997);
+	}
+}
+
+/* More files than buffers: every file is read whole, in order, once */
+static void
+read_files(int workers)
+{
+	char          dir[64];
+	char          paths[NFILES][96];
+	AsyncReadFile files[NFILES];
+	FileState     st[NFILES];
+	uint8_t      *data = malloc(3 * ASYNC_READ_BUF_SIZE + 17 + NFILES);
+
+	ck_assert_ptr_nonnull(data);
+	for (size_t k = 0; k < 3 * ASYNC_READ_BUF_SIZE + 17 + NFILES; k++)
+		data[k] = (uint8_t) (k * 31 + (k >> 9));
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_async_read_%d", (int) getpid());
+	ck_assert_int_eq(mkdir(dir, 0755), 0);
+
+	for (int i = 0; i < NFILES; i++)
+	{
+		snprintf(paths[i], sizeof(paths[i]), "%s/f%02d", dir, i);
+		if (i != NFILES - 1)            /* the last one is missing */
+		{
+			FILE *fp = fopen(paths[i], "wb");
+
+			ck_assert_ptr_nonnull(fp);
+			fwrite(data + i, 1, file_size(i), fp);
+			fclose(fp);
+		}
+		files[i].path = paths[i];
+		files[i].arg = &st[i];
+		st[i].crc = ~0U;
+		st[i].total = 0;
+		st[i].done = 0;
+		st[i].error = -1;
+	}
+
+	if (!async_read_supported())
+	{
+		ck_assert(!async_read_files(files, NFILES, workers, on_data, on_done));
+		for (int i = 0; i < NFILES; i++)
+			ck_assert_int_eq(st[i].done, 0);
+	}
+	else
+	{
+		ck_assert(async_read_files(files, NFILES, workers, on_data, on_done));
+		for (int i = 0; i < NFILES - 1; i++)
+		{
+			uint32_t want = 0;
+
+			ck_assert_int_eq(st[i].done, 1);
+			ck_assert_int_eq(st[i].error, 0);
+			ck_assert_uint_eq(st[i].total, file_size(i));
+			ck_assert(compute_file_crc32c(paths[i], &want));
+			ck_assert_uint_eq(~st[i].crc, want);
+		}
+		ck_assert_int_eq(st[NFILES - 1].done, 1);
+		ck_assert_int_eq(st[NFILES - 1].error, ENOENT);
+	}
+
+	for (int i = 0; i < NFILES - 1; i++)
+		unlink(paths[i]);
+	rmdir(dir);
+	free(data);
+}
+
+START_TEST(test_async_read_inline)
+{
+	read_files(0);
+}
+END_TEST
+
+START_TEST(test_async_read_workers)
+{
+	read_files(3);
+}
+END_TEST
+
+Suite *
+async_read_suite(void)
+{
+	Suite *s = suite_create("async_read");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_async_read_inline);
+	tcase_add_test(tc, test_async_read_workers);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,228 @@
+/*
+ * test_backup_catalog.c
+ *
+ * Unit tests for the compact backup catalog (src/common/backup_catalog.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pg_backup_auditor.h"
+#include "backup_catalog.h"
+
+/* Append a backup to the list at *head */
+static BackupInfo *
+mk(BackupInfo **head, const char *id, BackupType type, const char *parent,
+   time_t t, const char *path)
+{
+	BackupInfo *b = calloc(1, sizeof(*b));
+	BackupInfo **p = head;
+
+	str_copy(b->backup_id, id, sizeof(b->backup_id));
+	if (parent != NULL)
+		str_copy(b->parent_backup_id, parent, sizeof(b->parent_backup_id));
+	str_copy(b->backup_path, path, sizeof(b->backup_path));
+	str_copy(b->node_name, "localhost", sizeof(b->node_name));
+	b->type = type;
+	b->start_time = t;
+	while (*p != NULL)
+		p = &(*p)->next;
+	*p = b;
+	return b;
+}
+
+static void
+free_list(BackupInfo *head)
+{
+	while (head != NULL)
+	{
+		BackupInfo *n = head->next;
+		free(head);
+		head = n;
+	}
+}
+
+/* Records round-trip through the catalog in list order */
+START_TEST(test_backup_catalog_roundtrip)
+{
+	BackupInfo    *head = NULL;
+	BackupInfo    *f1 = mk(&head, "F1", BACKUP_TYPE_FULL, NULL, 1000, "/b/dir1/F1");
+	BackupInfo     out;
+	BackupCatalog *cat;
+
+	f1->start_lsn = 0x2000028;
+	f1->data_bytes = 123456789;
+	str_copy(f1->wal_mode, "archive", sizeof(f1->wal_mode));
+	f1->partial = true;
+	mk(&head, "D1", BACKUP_TYPE_DELTA, "F1", 2000, "/b/dir1/D1");
+
+	cat = backup_catalog_build(head);
+	ck_assert_ptr_nonnull(cat);
+	ck_assert_int_eq(cat->count, 2);
+
+	backup_catalog_get(cat, 0, &out);
+	ck_assert_str_eq(out.backup_id, "F1");
+	ck_assert_str_eq(out.backup_path, "/b/dir1/F1");
+	ck_assert_str_eq(out.wal_mode, "archive");
+	ck_assert_str_eq(out.backup_label, "");
+	ck_assert_uint_eq(out.start_lsn, 0x2000028);
+	ck_assert_uint_eq(out.data_bytes, 123456789);
+	ck_assert(out.partial);
+	ck_assert_ptr_null(out.next);
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[1].backup_dir), "/b/dir1");
+
+	backup_catalog_free(cat);
+	free_list(head);
+}
+END_TEST
+
+/* Equal strings are stored once; ids resolve through the hash */
+START_TEST(test_backup_catalog_intern_and_find)
+{
+	BackupInfo    *head = NULL;
+	BackupCatalog *cat;
+	char           id[16];
+	char           path[64];
+
+	for (int i = 0; i < 500; i++)
+	{
+		snprintf(id, sizeof(id), "B%03d", i);
+		snprintf(path, sizeof(path), "/b/dir%d/%s", i % 3, id);
+		mk(&head, id, BACKUP_TYPE_FULL, NULL, i, path);
+	}
+
+	cat = backup_catalog_build(head);
+	ck_assert_ptr_nonnull(cat);
+	ck_assert_int_eq(cat->count, 500);
+	ck_assert_uint_eq(cat->records[0].node_name, cat->records[499].node_name);
+	ck_assert_uint_eq(cat->records[0].backup_dir, cat->records[3].backup_dir);
+	ck_assert_uint_ne(cat->records[0].backup_dir, cat->records[1].backup_dir);
+
+	ck_assert_int_eq(backup_catalog_find(cat, "B000"), 0);
+	ck_assert_int_eq(backup_catalog_find(cat, "B377"), 377);
+	ck_assert_int_eq(backup_catalog_find(cat, "B500"), -1);
+	ck_assert_int_eq(backup_catalog_find(cat, ""), -1);
+
+	backup_catalog_free(cat);
+	free_list(head);
+}
+END_TEST
+
+/* Parents are resolved to record indices; roots follow them */
+START_TEST(test_backup_catalog_parents)
+{
+	BackupInfo    *head = NULL;
+	BackupCatalog *cat;
+
+	mk(&head, "I2", BACKUP_TYPE_INCREMENTAL, "I1", 3000, "/b/I2");
+	mk(&head, "F1", BACKUP_TYPE_FULL, NULL, 1000, "/b/F1");
+	mk(&head, "I1", BACKUP_TYPE_INCREMENTAL, "F1", 2000, "/b/I1");
+	mk(&head, "X1", BACKUP_TYPE_DELTA, "GONE", 4000, "/b/X1");
+
+	cat = backup_catalog_build(head);
+	ck_assert_ptr_nonnull(cat);
+	ck_assert_int_eq(cat->records[0].parent, 2);
+	ck_assert_int_eq(cat->records[1].parent, -1);
+	ck_assert_int_eq(cat->records[3].parent, -1);
+	ck_assert_int_eq(backup_catalog_find_root(cat, 0), 1);
+	ck_assert_int_eq(backup_catalog_find_root(cat, 1), 1);
+	ck_assert_int_eq(backup_catalog_find_root(cat, 3), -1);
+
+	backup_catalog_free(cat);
+	free_list(head);
+}
+END_TEST
+
+/* Sorting is stable, so ties keep their previous order */
+START_TEST(test_backup_catalog_sort)
+{
+	BackupInfo    *head = NULL;
+	BackupCatalog *cat;
+	int            idx[5] = {0, 1, 2, 3, 4};
+
+	mk(&head, "C", BACKUP_TYPE_FULL, NULL, 300, "/b/C")->data_bytes = 10;
+	mk(&head, "A", BACKUP_TYPE_FULL, NULL, 100, "/b/A")->data_bytes = 30;
+	mk(&head, "E", BACKUP_TYPE_FULL, NULL, 100, "/b/E")->data_bytes = 20;
+	mk(&head, "B", BACKUP_TYPE_FULL, NULL, 200, "/b/B")->data_bytes = 20;
+	mk(&head, "D", BACKUP_TYPE_FULL, NULL, 100, "/b/D")->data_bytes = 50;
+
+	cat = backup_catalog_build(head);
+	ck_assert_ptr_nonnull(cat);
+
+	backup_catalog_sort(cat, idx, 5, CATALOG_ORDER_NAME);
+	for (int i = 0; i < 5; i++)
+		ck_assert_int_eq(backup_catalog_str(cat, cat->records[idx[i]].backup_id)[0], 'A' + i);
+
+	/* A, B, C, D, E by name; start times 100, 200, 300, 100, 100 */
+	backup_catalog_sort(cat, idx, 5, CATALOG_ORDER_START_TIME);
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[0]].backup_id), "A");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[1]].backup_id), "D");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[2]].backup_id), "E");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[3]].backup_id), "B");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[4]].backup_id), "C");
+
+	/* Sizes 30, 50, 20, 20, 10 in that order: E stays before B */
+	backup_catalog_sort(cat, idx, 5, CATALOG_ORDER_SIZE);
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[0]].backup_id), "C");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[1]].backup_id), "E");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[2]].backup_id), "B");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[3]].backup_id), "A");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[4]].backup_id), "D");
+
+	/* The comparison the sort uses, on catalog positions */
+	ck_assert_int_lt(backup_catalog_compare(cat, 1, 0, CATALOG_ORDER_START_TIME), 0);
+	ck_assert_int_eq(backup_catalog_compare(cat, 1, 2, CATALOG_ORDER_START_TIME), 0);
+	ck_assert_int_gt(backup_catalog_compare(cat, 4, 3, CATALOG_ORDER_SIZE), 0);
+	ck_assert_int_eq(backup_catalog_compare(cat, 2, 3, CATALOG_ORDER_SIZE), 0);
+
+	backup_catalog_free(cat);
+	free_list(head);
+}
+END_TEST
+
+/* Orphaned incrementals are listed by start_lsn */
+START_TEST(test_backup_catalog_start_lsn_order)
+{
+	BackupInfo    *head = NULL;
+	BackupCatalog *cat;
+	int            idx[3] = {0, 1, 2};
+
+	mk(&head, "I3", BACKUP_TYPE_DELTA, "F", 100, "/b/I3")->start_lsn = 0x3000028;
+	mk(&head, "I1", BACKUP_TYPE_DELTA, "F", 300, "/b/I1")->start_lsn = 0x1000028;
+	mk(&head, "I2", BACKUP_TYPE_DELTA, "F", 200, "/b/I2")->start_lsn = 0x2000028;
+
+	cat = backup_catalog_build(head);
+	ck_assert_ptr_nonnull(cat);
+
+	backup_catalog_sort(cat, idx, 3, CATALOG_ORDER_START_LSN);
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[0]].backup_id), "I1");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[1]].backup_id), "I2");
+	ck_assert_str_eq(backup_catalog_str(cat, cat->records[idx[2]].backup_id), "I3");
+	ck_assert_int_gt(backup_catalog_compare(cat, 0, 2, CATALOG_ORDER_START_LSN), 0);
+
+	backup_catalog_free(cat);
+	free_list(head);
+}
+END_TEST
+
+Suite *
+backup_catalog_suite(void)
+{
+	Suite *s = suite_create("backup_catalog");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_backup_catalog_roundtrip);
+	tcase_add_test(tc, test_backup_catalog_intern_and_find);
+	tcase_add_test(tc, test_backup_catalog_parents);
+	tcase_add_test(tc, test_backup_catalog_sort);
+	tcase_add_test(tc, test_backup_catalog_start_lsn_order);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
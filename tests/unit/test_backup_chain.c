@@ -9,6 +9,7 @@
  */
 
 #include <check.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -166,6 +167,44 @@ START_TEST(test_backup_chain_find_backup)
 }
 END_TEST
 
+/*
+ * Deep chains over a large catalog: every DELTA finds its FULL however
+ * far up it is, and members come out oldest first.
+ */
+START_TEST(test_backup_chain_deep)
+{
+	BackupInfo *head = NULL;
+	char        id[32], parent[32];
+
+	for (int f = 0; f < 5; f++)
+	{
+		snprintf(id, sizeof(id), "F%d", f);
+		mk(&head, id, BACKUP_TYPE_FULL, NULL, f * 100000);
+		for (int d = 1; d <= 1200; d++)
+		{
+			snprintf(parent, sizeof(parent), d == 1 ? "F%d" : "F%d-D%d", f, d - 1);
+			snprintf(id, sizeof(id), "F%d-D%d", f, d);
+			mk(&head, id, BACKUP_TYPE_DELTA, parent, f * 100000 + d);
+		}
+	}
+
+	int n = 0;
+	BackupChain *c = backup_chain_build(head, &n);
+	ck_assert_int_eq(n, 5);
+	for (int i = 0; i < n; i++)
+	{
+		ck_assert_ptr_nonnull(c[i].root);
+		ck_assert_int_eq(c[i].count, 1201);
+		ck_assert_ptr_eq(c[i].members[0], c[i].root);
+		for (int m = 1; m < c[i].count; m++)
+			ck_assert(c[i].members[m - 1]->start_time < c[i].members[m]->start_time);
+	}
+
+	backup_chain_free(c, n);
+	free_chain_list(head);
+}
+END_TEST
+
 Suite *
 backup_chain_suite(void)
 {
@@ -179,6 +218,7 @@ backup_chain_suite(void)
 	tcase_add_test(tc, test_backup_chain_orphan);
 	tcase_add_test(tc, test_backup_chain_find_root);
 	tcase_add_test(tc, test_backup_chain_find_backup);
+	tcase_add_test(tc, test_backup_chain_deep);
 	suite_add_tcase(s, tc);
 
 	return s;
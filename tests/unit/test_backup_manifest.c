@@ -0,0 +1,154 @@
+/*
+ * test_backup_manifest.c
+ *
+ * Unit tests for the single-pass backup_manifest reader
+ * (src/common/backup_manifest.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pg_backup_auditor.h"
+#include "backup_manifest.h"
+
+/* Body in the layout pg_basebackup writes, one file per line */
+static const char manifest_body[] =
+	"{ \"PostgreSQL-Backup-Manifest-Version\": 2,\n"
+	"\"System-Identifier\": 7300000000000000001,\n"
+	"\"Files\": [\n"
+	"{ \"Path\": \"backup_label\", \"Size\": 225, \"Last-Modified\": \"2026-01-08 10:05:30 GMT\", \"Checksum-Algorithm\": \"CRC32C\", \"Checksum\": \"93ec8efb\" },\n"
+	"{ \"Path\": \"base/a \\\"quoted\\\" name\", \"Size\": 0, \"Last-Modified\": \"2026-01-08 10:05:30 GMT\" },\n"
+	"{ \"Encoded-Path\": \"2f746d70\", \"Size\": 8, \"Last-Modified\": \"2026-01-08 10:05:30 GMT\" },\n"
+	"{ \"Path\": \"global/pg_control\", \"Size\": 8192, \"Checksum-Algorithm\": \"SHA256\", \"Checksum\": \"ab01\" }\n"
+	"],\n"
+	"\"WAL-Ranges\": [\n"
+	"{ \"Timeline\": 2, \"Start-LSN\": \"0/2000028\", \"End-LSN\": \"0/2000100\" },\n"
+	"{ \"Timeline\": 3, \"Start-LSN\": \"0/3000028\", \"End-LSN\": \"0/3000100\" }\n"
+	"],\n";
+
+/* Entries come out in order as slices; WAL range and checksum on the same pass */
+START_TEST(test_manifest_reader_entries)
+{
+	char              path[64];
+	char              expected[SHA256_HEX_LENGTH + 1];
+	uint8_t           digest[SHA256_DIGEST_LENGTH];
+	SHA256Ctx         ctx;
+	ManifestReader    r;
+	ManifestFileEntry e;
+	FILE             *fp;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, manifest_body, strlen(manifest_body));
+	sha256_final(&ctx, digest);
+	sha256_to_hex(digest, expected);
+
+	snprintf(path, sizeof(path), "/tmp/pg_manifest_%d", (int) getpid());
+	fp = fopen(path, "w");
+	ck_assert_ptr_nonnull(fp);
+	fputs(manifest_body, fp);
+	fprintf(fp, "\"Manifest-Checksum\": \"%s\"}\n", expected);
+	fclose(fp);
+
+	ck_assert(manifest_reader_open(&r, path, true));
+
+	ck_assert_int_eq(manifest_reader_next(&r, &e), 1);
+	ck_assert(json_slice_eq(e.path, "backup_label"));
+	ck_assert(json_slice_case_eq(e.algorithm, "crc32c"));
+	ck_assert(json_slice_eq(e.checksum, "93ec8efb"));
+	ck_assert(e.has_size);
+	ck_assert_uint_eq(e.size, 225);
+	ck_assert(e.path.ptr >= r.data && e.path.ptr < r.data + r.size);
+
+	/* Escaped quotes stay inside the string; no algorithm means none */
+	ck_assert_int_eq(manifest_reader_next(&r, &e), 1);
+	ck_assert(json_slice_eq(e.path, "base/a \\\"quoted\\\" name"));
+	ck_assert_ptr_null(e.algorithm.ptr);
+	ck_assert_uint_eq(e.size, 0);
+
+	/* The Encoded-Path entry is skipped */
+	ck_assert_int_eq(manifest_reader_next(&r, &e), 1);
+	ck_assert(json_slice_eq(e.path, "global/pg_control"));
+	ck_assert(json_slice_case_eq(e.algorithm, "SHA256"));
+
+	ck_assert_int_eq(manifest_reader_next(&r, &e), 0);
+	ck_assert(r.has_wal_range);
+	ck_assert_uint_eq(r.timeline, 2);
+	ck_assert_uint_eq(r.start_lsn, 0x2000028);
+	ck_assert_uint_eq(r.end_lsn, 0x2000100);
+
+	ck_assert(r.has_checksum);
+	ck_assert_uint_eq(r.checksum_offset, strlen(manifest_body));
+	ck_assert(json_slice_eq(r.stored_checksum, expected));
+	ck_assert_str_eq(r.computed_checksum, expected);
+
+	manifest_reader_close(&r);
+	unlink(path);
+}
+END_TEST
+
+/* In-memory input, a member sharing a line with "Files", and no checksum */
+START_TEST(test_manifest_reader_buffer)
+{
+	static const char data[] =
+		"{ \"PostgreSQL-Backup-Manifest-Version\": 1,\n"
+		"\"Files\": [{ \"Path\": \"PG_VERSION\", \"Size\": 3, \"X\": { \"a\": [1, 2] } }],\n"
+		"\"WAL-Ranges\": [{ \"Timeline\": 1, \"Start-LSN\": \"0/2000028\", \"End-LSN\": \"0/2000100\" }] }\n";
+	ManifestReader    r;
+	ManifestFileEntry e;
+
+	manifest_reader_init(&r, data, strlen(data), true);
+	ck_assert_int_eq(manifest_reader_next(&r, &e), 1);
+	ck_assert(json_slice_eq(e.path, "PG_VERSION"));
+	ck_assert_uint_eq(e.size, 3);
+	ck_assert_int_eq(manifest_reader_next(&r, &e), 0);
+	ck_assert_int_eq(manifest_reader_next(&r, &e), 0);
+	ck_assert(r.has_wal_range);
+	ck_assert_uint_eq(r.end_lsn, 0x2000100);
+	ck_assert(!r.has_checksum);
+	manifest_reader_close(&r);
+}
+END_TEST
+
+/* Truncated input is reported as malformed, after the complete entries */
+START_TEST(test_manifest_reader_malformed)
+{
+	static const char data[] =
+		"{ \"Files\": [\n"
+		"{ \"Path\": \"a\", \"Size\": 1 },\n"
+		"{ \"Path\": \"b\", \"Si";
+	ManifestReader    r;
+	ManifestFileEntry e;
+
+	manifest_reader_init(&r, data, strlen(data), false);
+	ck_assert_int_eq(manifest_reader_next(&r, &e), 1);
+	ck_assert(json_slice_eq(e.path, "a"));
+	ck_assert_int_eq(manifest_reader_next(&r, &e), -1);
+	ck_assert_int_eq(manifest_reader_next(&r, &e), -1);
+	ck_assert(!r.has_wal_range);
+	manifest_reader_close(&r);
+
+	ck_assert(!manifest_reader_open(&r, "/nonexistent/backup_manifest", false));
+}
+END_TEST
+
+Suite *
+backup_manifest_suite(void)
+{
+	Suite *s = suite_create("backup_manifest");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_manifest_reader_entries);
+	tcase_add_test(tc, test_manifest_reader_buffer);
+	tcase_add_test(tc, test_manifest_reader_malformed);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,188 @@
+/*
+ * test_backup_stats.c
+ *
+ * Unit tests for the single-pass backup statistics
+ * (src/common/backup_stats.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#include <check.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pg_backup_auditor.h"
+#include "backup_stats.h"
+
+/* Prepend a finished OK backup to *head */
+static BackupInfo *
+mk(BackupInfo **head, BackupTool tool, const char *instance, BackupType type,
+   uint64_t bytes, time_t start, time_t duration)
+{
+	BackupInfo *b = calloc(1, sizeof(*b));
+
+	b->tool = tool;
+	str_copy(b->instance_name, instance, sizeof(b->instance_name));
+	b->type = type;
+	b->status = BACKUP_STATUS_OK;
+	b->data_bytes = bytes;
+	b->start_time = start;
+	b->end_time = start + duration;
+	b->next = *head;
+	*head = b;
+	return b;
+}
+
+static void
+free_list(BackupInfo *b)
+{
+	while (b != NULL)
+	{
+		BackupInfo *next = b->next;
+
+		free(b);
+		b = next;
+	}
+}
+
+/* Streaming mean and variance match the two-pass values */
+START_TEST(test_stat_accum)
+{
+	static const double values[] = { 1e12 + 4, 1e12 + 7, 1e12 + 13, 1e12 + 16 };
+	StatAccum acc;
+
+	memset(&acc, 0, sizeof(acc));
+	ck_assert(stat_accum_variance(&acc) == 0.0);
+	for (int i = 0; i < 4; i++)
+		stat_accum_add(&acc, values[i]);
+
+	ck_assert_uint_eq(acc.count, 4);
+	ck_assert(acc.min == 1e12 + 4);
+	ck_assert(acc.max == 1e12 + 16);
+	ck_assert(fabs(acc.mean - (1e12 + 10)) < 1e-3);
+	/* Deviations -6, -3, 3, 6: sum of squares 90, sample variance 30 */
+	ck_assert(fabs(stat_accum_variance(&acc) - 30.0) < 1e-6);
+	ck_assert(fabs(stat_accum_stddev(&acc) - sqrt(30.0)) < 1e-6);
+}
+END_TEST
+
+/* Groups per (tool, instance, type), sorted; many instances, no limit */
+START_TEST(test_backup_stats_groups)
+{
+	BackupInfo  *list = NULL;
+	BackupStats *stats;
+	char         name[32];
+	const BackupStatGroup    *g;
+	const BackupStatInstance *in;
+
+	for (int i = 0; i < 500; i++)
+	{
+		snprintf(name, sizeof(name), "db%03d", i);
+		mk(&list, BACKUP_TOOL_PG_PROBACKUP, name, BACKUP_TYPE_FULL, 1000, 1000 + i, 60);
+		mk(&list, BACKUP_TOOL_PG_PROBACKUP, name, BACKUP_TYPE_FULL, 3000, 90000 + i, 120);
+		mk(&list, BACKUP_TOOL_PG_PROBACKUP, name, BACKUP_TYPE_DELTA, 100, 50000 + i, 10);
+	}
+	mk(&list, BACKUP_TOOL_PGBACKREST, "main", BACKUP_TYPE_FULL, 10, 5, 0)->status =
+		BACKUP_STATUS_RUNNING;
+
+	stats = backup_stats_build(list, BACKUP_STATS_BY_INSTANCE);
+	ck_assert_ptr_nonnull(stats);
+	ck_assert_int_eq(stats->backup_count, 1501);
+	ck_assert_int_eq(stats->group_count, 1001);
+	ck_assert_int_eq(stats->instance_count, 501);
+	ck_assert_int_eq(stats->status_count[BACKUP_STATUS_OK], 1500);
+	ck_assert_int_eq(stats->status_count[BACKUP_STATUS_RUNNING], 1);
+	ck_assert_uint_eq(stats->total_bytes, 500 * 4100 + 10);
+
+	/* Sorted by tool, instance, type */
+	ck_assert_str_eq(stats->groups[0].instance_name, "db000");
+	ck_assert_int_eq(stats->groups[0].type, BACKUP_TYPE_FULL);
+	ck_assert_int_eq(stats->groups[1].type, BACKUP_TYPE_DELTA);
+	ck_assert_int_eq(stats->groups[1000].tool, BACKUP_TOOL_PGBACKREST);
+
+	g = backup_stats_group(stats, BACKUP_TOOL_PG_PROBACKUP, "db321", BACKUP_TYPE_FULL);
+	ck_assert_ptr_nonnull(g);
+	ck_assert_int_eq(g->count, 2);
+	ck_assert_int_eq(g->ok_count, 2);
+	ck_assert_uint_eq(g->total_bytes, 4000);
+	ck_assert_int_eq(g->min_time, 1321);
+	ck_assert_int_eq(g->max_time, 90321);
+	ck_assert(g->baseline_size.mean == 2000.0);
+	ck_assert(g->duration.mean == 90.0);
+	ck_assert_ptr_null(backup_stats_group(stats, BACKUP_TOOL_PG_PROBACKUP, "db321",
+										  BACKUP_TYPE_PAGE));
+	ck_assert_ptr_null(backup_stats_group(stats, BACKUP_TOOL_PG_PROBACKUP, "nope",
+										  BACKUP_TYPE_FULL));
+
+	/* Not a baseline backup: running, zero duration */
+	g = backup_stats_group(stats, BACKUP_TOOL_PGBACKREST, "main", BACKUP_TYPE_FULL);
+	ck_assert_ptr_nonnull(g);
+	ck_assert_int_eq(g->count, 1);
+	ck_assert_uint_eq(g->baseline_size.count, 0);
+
+	in = backup_stats_instance(stats, BACKUP_TOOL_PG_PROBACKUP, "db321");
+	ck_assert_ptr_nonnull(in);
+	ck_assert_int_eq(in->count, 3);
+	ck_assert_uint_eq(in->full_bytes.count, 2);
+	ck_assert_int_eq(in->first_full.start_time, 1321);
+	ck_assert_uint_eq(in->last_full.data_bytes, 3000);
+
+	backup_stats_free(stats);
+	free_list(list);
+}
+END_TEST
+
+/* Per-tool grouping pools instances; lookups ignore the instance */
+START_TEST(test_backup_stats_by_tool)
+{
+	BackupInfo  *list = NULL;
+	BackupStats *stats;
+	const BackupStatGroup *g;
+
+	mk(&list, BACKUP_TOOL_PG_PROBACKUP, "a", BACKUP_TYPE_FULL, 100, 1000, 10);
+	mk(&list, BACKUP_TOOL_PG_PROBACKUP, "b", BACKUP_TYPE_FULL, 300, 2000, 30);
+	mk(&list, BACKUP_TOOL_PG_BASEBACKUP, "", BACKUP_TYPE_FULL, 50, 3000, 5);
+
+	stats = backup_stats_build(list, BACKUP_STATS_BY_TOOL);
+	ck_assert_ptr_nonnull(stats);
+	ck_assert_int_eq(stats->group_count, 2);
+	ck_assert_int_eq(stats->instance_count, 3);
+
+	g = backup_stats_group_of(stats, list->next);
+	ck_assert_ptr_nonnull(g);
+	ck_assert_int_eq(g->tool, BACKUP_TOOL_PG_PROBACKUP);
+	ck_assert_int_eq(g->count, 2);
+	ck_assert(g->baseline_size.mean == 200.0);
+	ck_assert(g->baseline_duration.mean == 20.0);
+	ck_assert(fabs(stat_accum_stddev(&g->baseline_size) - sqrt(20000.0)) < 1e-9);
+
+	backup_stats_free(stats);
+	free_list(list);
+
+	/* An empty list has no groups */
+	stats = backup_stats_build(NULL, BACKUP_STATS_BY_INSTANCE);
+	ck_assert_ptr_nonnull(stats);
+	ck_assert_int_eq(stats->group_count, 0);
+	ck_assert_ptr_null(backup_stats_group(stats, BACKUP_TOOL_PG_PROBACKUP, "a",
+										  BACKUP_TYPE_FULL));
+	backup_stats_free(stats);
+}
+END_TEST
+
+Suite *
+backup_stats_suite(void)
+{
+	Suite *s = suite_create("backup_stats");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_stat_accum);
+	tcase_add_test(tc, test_backup_stats_groups);
+	tcase_add_test(tc, test_backup_stats_by_tool);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
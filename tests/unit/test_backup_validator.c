@@ -31,6 +31,7 @@
 #include "../../include/types.h"
 #include "../../include/common.h"
 #include "../../include/sha256.h"
+#include "../../include/validation_scheduler.h"
 
 /* ------------------------------------------------------------------ *
  * Helpers
@@ -436,8 +437,8 @@ START_TEST(test_dir_entries_skipped)
 }
 END_TEST
 
-/* Compressed file: CRC check skipped, only existence + size checked */
-START_TEST(test_compressed_file_skips_crc)
+/* Compressed file: stored CRC covers the compressed bytes, so it is checked */
+START_TEST(test_compressed_file_checks_crc)
 {
 	const uint8_t data[] = {0x1F, 0x8B, 0x08};  /* gzip magic bytes */
 	char          file_path[PATH_MAX];
@@ -450,9 +451,9 @@ START_TEST(test_compressed_file_skips_crc)
 	snprintf(file_path, sizeof(file_path), "%s/2222", db_base);
 	write_file(file_path, data, sizeof(data));
 
-	/* compress_alg != "none", so CRC check is skipped */
+	/* Correct CRC of the stored bytes → no error */
 	write_content_control(backup_dir, "base/1/2222", "reg",
-						  sizeof(data), 0xDEADBEEFU, "zlib");
+						  sizeof(data), buf_crc32c(data, sizeof(data)), "zlib");
 
 	BackupInfo       info = make_backup_info(BACKUP_TYPE_FULL);
 	ValidationResult *res = check_backup_checksums(&info);
@@ -461,10 +462,92 @@ START_TEST(test_compressed_file_skips_crc)
 	ck_assert_int_eq(res->error_count, 0);
 	free_validation_result(res);
 
+	/* Wrong CRC → error, even though the file is compressed */
+	write_content_control(backup_dir, "base/1/2222", "reg",
+						  sizeof(data), 0xDEADBEEFU, "zlib");
+
+	res = check_backup_checksums(&info);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 1);
+	free_validation_result(res);
+
+	teardown_test_dirs();
+}
+END_TEST
+
+/*
+ * Parallel verification: 40 files, every 7th with a bad CRC.  With
+ * --jobs 4 the errors must come back in backup_content.control order,
+ * identical to the single-threaded result.
+ */
+START_TEST(test_parallel_checksums_deterministic)
+{
+	char db_base[PATH_MAX];
+	char ctrl_path[PATH_MAX];
+	FILE *fp;
+
+	setup_test_dirs();
+
+	snprintf(db_base, sizeof(db_base), "%s/database/base/1", backup_dir);
+	make_dir(db_base);
+	snprintf(ctrl_path, sizeof(ctrl_path), "%s/backup_content.control",
+			 backup_dir);
+	fp = fopen(ctrl_path, "w");
+	ck_assert_ptr_nonnull(fp);
+
+	for (int i = 0; i < 40; i++)
+	{
+		uint8_t data[64];
+		char    file_path[PATH_MAX];
+
+		memset(data, i + 1, sizeof(data));
+		snprintf(file_path, sizeof(file_path), "%s/%d", db_base, 1000 + i);
+		write_file(file_path, data, sizeof(data));
+
+		uint32_t crc = buf_crc32c(data, sizeof(data));
+		if (i % 7 == 0)
+			crc ^= 1;
+		fprintf(fp,
+				"{\"path\":\"base/1/%d\", \"size\":\"%zu\", \"kind\":\"reg\","
+				" \"crc\":\"%u\", \"compress_alg\":\"none\"}\n",
+				1000 + i, sizeof(data), crc);
+	}
+	fclose(fp);
+
+	BackupInfo info = make_backup_info(BACKUP_TYPE_FULL);
+
+	validation_set_jobs(1);
+	ValidationResult *serial = check_backup_checksums(&info);
+	validation_set_jobs(4);
+	ValidationResult *parallel = check_backup_checksums(&info);
+	validation_set_jobs(1);
+
+	ck_assert_ptr_nonnull(serial);
+	ck_assert_ptr_nonnull(parallel);
+	ck_assert_int_eq(serial->error_count, 6);
+	ck_assert_int_eq(parallel->error_count, serial->error_count);
+	for (int i = 0; i < serial->error_count; i++)
+		ck_assert_str_eq(parallel->errors[i], serial->errors[i]);
+	ck_assert_ptr_nonnull(strstr(parallel->errors[0], "base/1/1000"));
+	ck_assert_ptr_nonnull(strstr(parallel->errors[5], "base/1/1035"));
+
+	free_validation_result(serial);
+	free_validation_result(parallel);
 	teardown_test_dirs();
 }
 END_TEST
 
+/* validation_set_jobs clamps non-positive values to 1 */
+START_TEST(test_validation_jobs_clamped)
+{
+	validation_set_jobs(0);
+	ck_assert_int_eq(validation_get_jobs(), 1);
+	validation_set_jobs(8);
+	ck_assert_int_eq(validation_get_jobs(), 8);
+	validation_set_jobs(1);
+}
+END_TEST
+
 /* ================================================================== *
  * validate_backup_chain() tests
  * ================================================================== */
@@ -702,6 +785,101 @@ START_TEST(test_chain_cycle)
 }
 END_TEST
 
+/* Scheduler on several threads: same verdicts, in task order */
+START_TEST(test_chain_scheduler_matches_serial)
+{
+	enum { NB = 24 };
+	BackupInfo           bi[NB];
+	ValidationTask       tasks[NB];
+	ValidationScheduler *sched;
+	char                 id[16], parent[16];
+	int                  failed = 0;
+
+	/* FULL roots, each followed by two DELTAs; every fourth has no parent */
+	for (int i = 0; i < NB; i++)
+	{
+		snprintf(id, sizeof(id), "SCH%03d", i);
+		snprintf(parent, sizeof(parent), "SCH%03d", i % 3 == 0 ? i : i - 1);
+		if (i % 3 == 0)
+			bi[i] = make_chain_bi(id, BACKUP_TYPE_FULL, BACKUP_STATUS_OK, NULL);
+		else
+			bi[i] = make_chain_bi(id, BACKUP_TYPE_DELTA, BACKUP_STATUS_OK,
+								  i % 4 == 0 ? "MISSING" : parent);
+		bi[i].next = i + 1 < NB ? &bi[i + 1] : NULL;
+		tasks[i].backup   = &bi[i];
+		tasks[i].wal_info = NULL;
+	}
+
+	validation_set_jobs(4);
+	sched = validation_scheduler_start(tasks, NB, bi, VALIDATION_LEVEL_BASIC);
+	ck_assert_ptr_nonnull(sched);
+
+	for (int i = 0; i < NB; i++)
+	{
+		ValidationResult *got = validation_scheduler_wait(sched, i);
+		ValidationResult *want = validate_backup_chain(&bi[i], bi, NULL,
+													   VALIDATION_LEVEL_BASIC);
+
+		ck_assert_ptr_nonnull(got);
+		ck_assert_ptr_eq(got, tasks[i].result);
+		ck_assert_int_eq(got->error_count, want->error_count);
+		ck_assert_int_eq(got->warning_count, want->warning_count);
+		for (int e = 0; e < got->error_count; e++)
+			ck_assert_str_eq(got->errors[e], want->errors[e]);
+		if (got->error_count > 0)
+			failed++;
+		free_validation_result(want);
+	}
+	ck_assert_int_gt(failed, 0);
+	ck_assert_int_lt(failed, NB);
+	validation_scheduler_finish(sched);
+	validation_set_jobs(1);
+
+	for (int i = 0; i < NB; i++)
+		free_validation_result(tasks[i].result);
+}
+END_TEST
+
+/* A shared memo gives the serial verdicts, and each call owns its result */
+START_TEST(test_chain_memo_matches_serial)
+{
+	BackupInfo        full = make_chain_bi("MEMO001", BACKUP_TYPE_FULL,
+										   BACKUP_STATUS_OK, NULL);
+	BackupInfo        d1   = make_chain_bi("MEMO002", BACKUP_TYPE_DELTA,
+										   BACKUP_STATUS_ERROR, "MEMO001");
+	BackupInfo        d2   = make_chain_bi("MEMO003", BACKUP_TYPE_DELTA,
+										   BACKUP_STATUS_OK, "MEMO002");
+	BackupInfo       *chain[] = { &full, &d1, &d2 };
+	ValidationMemo   *memo = validation_memo_create();
+
+	full.next = &d1;
+	d1.next = &d2;
+	ck_assert_ptr_nonnull(memo);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			ValidationResult *got = validate_backup_chain_memo(chain[i], &full, NULL,
+															   VALIDATION_LEVEL_BASIC,
+															   memo);
+			ValidationResult *want = validate_backup_chain(chain[i], &full, NULL,
+														   VALIDATION_LEVEL_BASIC);
+
+			ck_assert_ptr_nonnull(got);
+			ck_assert_int_eq(got->status, want->status);
+			ck_assert_int_eq(got->error_count, want->error_count);
+			ck_assert_int_eq(got->warning_count, want->warning_count);
+			for (int e = 0; e < got->error_count; e++)
+				ck_assert_str_eq(got->errors[e], want->errors[e]);
+			free_validation_result(got);
+			free_validation_result(want);
+		}
+	}
+	validation_memo_free(memo);
+}
+END_TEST
+
 /* ================================================================== *
  * validate_backup_metadata() tests
  * ================================================================== */
@@ -1617,6 +1795,116 @@ START_TEST(test_manifest_self_checksum_bad)
 }
 END_TEST
 
+/*
+ * Tar format: stage 'data' as rel_path under a scratch directory and pack
+ * it into backup_dir/tar_name, then write the manifest next to it.
+ * tar_member is rel_path as stored inside that archive.
+ */
+static void
+make_tar_backup(const char *tar_name, const char *rel_path,
+				const char *tar_member, const char *data,
+				bool corrupt_file_cksum)
+{
+	char     stage[PATH_MAX];
+	char     file_path[PATH_MAX * 2];
+	char     cmd[PATH_MAX * 4];
+	uint32_t crc;
+
+	snprintf(stage, sizeof(stage), "%s/stage", test_dir);
+	snprintf(cmd, sizeof(cmd), "mkdir -p '%s/%s' && rmdir '%s/%s'",
+			 stage, tar_member, stage, tar_member);
+	ck_assert_int_eq(system(cmd), 0);
+
+	snprintf(file_path, sizeof(file_path), "%s/%s", stage, tar_member);
+	write_file(file_path, data, 5);
+	compute_file_crc32c(file_path, &crc);
+
+	snprintf(cmd, sizeof(cmd), "tar cf '%s/%s' -C '%s' '%s'",
+			 backup_dir, tar_name, stage, tar_member);
+	ck_assert_int_eq(system(cmd), 0);
+
+	write_test_manifest(backup_dir, rel_path, crc, corrupt_file_cksum, false);
+}
+
+/* Tar: member matches manifest entry → 0 errors */
+START_TEST(test_manifest_tar_ok)
+{
+	setup_test_dirs();
+	make_tar_backup("base.tar", "global/testfile", "global/testfile",
+					"hello", false);
+
+	BackupInfo        bi  = make_bb_backup(false);
+	ValidationResult *res = check_manifest_checksums(&bi);
+
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count,   0);
+	ck_assert_int_eq(res->warning_count, 0);
+	free_validation_result(res);
+
+	teardown_test_dirs();
+}
+END_TEST
+
+/* Tar: member content differs from manifest checksum → CRC32C error */
+START_TEST(test_manifest_tar_crc32c_mismatch)
+{
+	setup_test_dirs();
+	make_tar_backup("base.tar", "testfile", "testfile", "hello", true);
+
+	BackupInfo        bi  = make_bb_backup(false);
+	ValidationResult *res = check_manifest_checksums(&bi);
+
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 1);
+	ck_assert_ptr_nonnull(strstr(res->errors[0], "CRC32C mismatch: testfile"));
+	free_validation_result(res);
+
+	teardown_test_dirs();
+}
+END_TEST
+
+/* Tar: manifest entry not present in any archive → missing file error */
+START_TEST(test_manifest_tar_missing_member)
+{
+	setup_test_dirs();
+	make_tar_backup("base.tar", "absent", "present", "hello", false);
+
+	BackupInfo        bi  = make_bb_backup(false);
+	ValidationResult *res = check_manifest_checksums(&bi);
+
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 1);
+	ck_assert_str_eq(res->errors[0], "Missing file: absent");
+	free_validation_result(res);
+
+	teardown_test_dirs();
+}
+END_TEST
+
+/* Tar: tablespace archive <oid>.tar is matched under pg_tblspc/<oid>/ */
+START_TEST(test_manifest_tar_tablespace)
+{
+	char path[PATH_MAX];
+
+	setup_test_dirs();
+	make_tar_backup("16385.tar", "pg_tblspc/16385/PG_16/1/100",
+					"PG_16/1/100", "hello", false);
+
+	/* base.tar must exist for the backup to be treated as tar format */
+	snprintf(path, sizeof(path), "%s/base.tar", backup_dir);
+	write_file(path, "", 0);
+
+	BackupInfo        bi  = make_bb_backup(false);
+	ValidationResult *res = check_manifest_checksums(&bi);
+
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 0);
+	free_validation_result(res);
+
+	teardown_test_dirs();
+}
+END_TEST
+
 /* ------------------------------------------------------------------ *
  * Suite assembly
  * ------------------------------------------------------------------ */
@@ -1641,7 +1929,9 @@ backup_validator_suite(void)
 	tcase_add_test(tc_chk, test_zero_size_file_skipped);
 	tcase_add_test(tc_chk, test_pg_control_excluded);
 	tcase_add_test(tc_chk, test_dir_entries_skipped);
-	tcase_add_test(tc_chk, test_compressed_file_skips_crc);
+	tcase_add_test(tc_chk, test_compressed_file_checks_crc);
+	tcase_add_test(tc_chk, test_parallel_checksums_deterministic);
+	tcase_add_test(tc_chk, test_validation_jobs_clamped);
 	suite_add_tcase(s, tc_chk);
 
 	TCase *tc_chain = tcase_create("validate_backup_chain");
@@ -1657,6 +1947,8 @@ backup_validator_suite(void)
 	tcase_add_test(tc_chain, test_chain_orphan_parent);
 	tcase_add_test(tc_chain, test_chain_lsn_regression);
 	tcase_add_test(tc_chain, test_chain_cycle);
+	tcase_add_test(tc_chain, test_chain_scheduler_matches_serial);
+	tcase_add_test(tc_chain, test_chain_memo_matches_serial);
 	suite_add_tcase(s, tc_chain);
 
 	TCase *tc_meta = tcase_create("validate_backup_metadata");
@@ -1730,6 +2022,10 @@ backup_validator_suite(void)
 	tcase_add_test(tc_manifest, test_manifest_crc32c_ok);
 	tcase_add_test(tc_manifest, test_manifest_crc32c_mismatch);
 	tcase_add_test(tc_manifest, test_manifest_self_checksum_bad);
+	tcase_add_test(tc_manifest, test_manifest_tar_ok);
+	tcase_add_test(tc_manifest, test_manifest_tar_crc32c_mismatch);
+	tcase_add_test(tc_manifest, test_manifest_tar_missing_member);
+	tcase_add_test(tc_manifest, test_manifest_tar_tablespace);
 	suite_add_tcase(s, tc_manifest);
 
 	return s;
@@ -0,0 +1,193 @@
+/*
+ * test_buffer_pool.c
+ *
+ * Unit tests for the shared read-buffer pool (src/common/buffer_pool.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pg_backup_auditor.h"
+#include "buffer_pool.h"
+
+#define KB  1024
+
+static void
+reset_pool(void)
+{
+	buffer_pool_set_limit(0);
+	buffer_pool_trim();
+}
+
+/* A returned buffer is handed to the next borrower of its size class */
+START_TEST(test_buffer_pool_reuse)
+{
+	BufferPoolStats st;
+	void           *a, *b;
+
+	reset_pool();
+	a = buffer_pool_get(60 * KB);
+	ck_assert_ptr_nonnull(a);
+	ck_assert_uint_eq((uintptr_t) a % BUFFER_POOL_ALIGN, 0);
+	memset(a, 0xab, 64 * KB);           /* rounded up to 64 KB */
+	buffer_pool_put(a, 60 * KB);
+
+	b = buffer_pool_get(64 * KB);
+	ck_assert_ptr_eq(a, b);
+	buffer_pool_stats(&st);
+	ck_assert_uint_eq(st.allocated, 64 * KB);
+	ck_assert_uint_eq(st.lent, 64 * KB);
+	buffer_pool_put(b, 64 * KB);
+
+	ck_assert_ptr_null(buffer_pool_get(BUFFER_POOL_MAX_SIZE + 1));
+	buffer_pool_put(NULL, 64 * KB);
+
+	buffer_pool_trim();
+	buffer_pool_stats(&st);
+	ck_assert_uint_eq(st.allocated, 0);
+	ck_assert_uint_eq(st.lent, 0);
+}
+END_TEST
+
+/* try_get refuses what does not fit; kept buffers of other sizes make room */
+START_TEST(test_buffer_pool_limit)
+{
+	BufferPoolStats st;
+	void           *a, *b, *c;
+
+	reset_pool();
+	buffer_pool_set_limit(128 * KB);
+	a = buffer_pool_try_get(64 * KB);
+	b = buffer_pool_try_get(64 * KB);
+	ck_assert_ptr_nonnull(a);
+	ck_assert_ptr_nonnull(b);
+	ck_assert_ptr_null(buffer_pool_try_get(4 * KB));
+	buffer_pool_put(a, 64 * KB);
+	buffer_pool_put(b, 64 * KB);
+
+	/* Both 64 KB buffers are freed to fit a 128 KB one */
+	c = buffer_pool_try_get(128 * KB);
+	ck_assert_ptr_nonnull(c);
+	buffer_pool_stats(&st);
+	ck_assert_uint_eq(st.allocated, 128 * KB);
+	buffer_pool_put(c, 128 * KB);
+
+	/* Lowering the limit frees what is kept beyond it */
+	buffer_pool_set_limit(64 * KB);
+	buffer_pool_stats(&st);
+	ck_assert_uint_eq(st.allocated, 0);
+
+	reset_pool();
+}
+END_TEST
+
+/* A thread holding a buffer, or the only borrower, is never made to wait */
+START_TEST(test_buffer_pool_overdraft)
+{
+	BufferPoolStats before, st;
+	void           *a, *b, *c;
+
+	reset_pool();
+	buffer_pool_stats(&before);
+	buffer_pool_set_limit(64 * KB);
+
+	a = buffer_pool_get(128 * KB);
+	ck_assert_ptr_nonnull(a);
+	b = buffer_pool_get(64 * KB);
+	ck_assert_ptr_nonnull(b);
+	buffer_pool_stats(&st);
+	ck_assert_uint_eq(st.overdrafts - before.overdrafts, 2);
+	ck_assert_uint_eq(st.waits, before.waits);
+
+	/* Handed back over the limit: freed, not kept */
+	buffer_pool_put(a, 128 * KB);
+	buffer_pool_put(b, 64 * KB);
+	buffer_pool_stats(&st);
+	ck_assert_uint_eq(st.allocated, 64 * KB);
+
+	c = buffer_pool_get(64 * KB);
+	ck_assert_ptr_eq(c, b);
+	buffer_pool_put(c, 64 * KB);
+
+	reset_pool();
+}
+END_TEST
+
+typedef struct {
+	void           *buf;
+	struct timespec got;
+} Borrower;
+
+static void *
+borrower(void *arg)
+{
+	Borrower *b = arg;
+
+	b->buf = buffer_pool_get(64 * KB);
+	clock_gettime(CLOCK_MONOTONIC, &b->got);
+	buffer_pool_put(b->buf, 64 * KB);
+	return NULL;
+}
+
+static double
+seconds(const struct timespec *ts)
+{
+	return (double) ts->tv_sec + (double) ts->tv_nsec / 1e9;
+}
+
+/* With the budget lent out, another thread waits until a buffer comes back */
+START_TEST(test_buffer_pool_backpressure)
+{
+	BufferPoolStats before, st;
+	Borrower        b;
+	pthread_t       t;
+	struct timespec pause = {0, 100 * 1000 * 1000};
+	struct timespec put;
+	void           *a;
+
+	reset_pool();
+	buffer_pool_stats(&before);
+	buffer_pool_set_limit(64 * KB);
+	a = buffer_pool_get(64 * KB);
+	ck_assert_ptr_nonnull(a);
+
+	memset(&b, 0, sizeof(b));
+	ck_assert_int_eq(pthread_create(&t, NULL, borrower, &b), 0);
+	nanosleep(&pause, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &put);
+	buffer_pool_put(a, 64 * KB);
+	pthread_join(t, NULL);
+
+	ck_assert_ptr_eq(b.buf, a);
+	ck_assert(seconds(&b.got) >= seconds(&put));
+	buffer_pool_stats(&st);
+	ck_assert_uint_eq(st.waits - before.waits, 1);
+	ck_assert_uint_eq(st.overdrafts, before.overdrafts);
+	ck_assert_uint_eq(st.allocated, 64 * KB);
+
+	reset_pool();
+}
+END_TEST
+
+Suite *
+buffer_pool_suite(void)
+{
+	Suite *s = suite_create("buffer_pool");
+	TCase *tc = tcase_create("core");
+
+	tcase_add_test(tc, test_buffer_pool_reuse);
+	tcase_add_test(tc, test_buffer_pool_limit);
+	tcase_add_test(tc, test_buffer_pool_overdraft);
+	tcase_add_test(tc, test_buffer_pool_backpressure);
+	suite_add_tcase(s, tc);
+	return s;
+}
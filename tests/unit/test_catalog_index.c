@@ -0,0 +1,339 @@
+/*
+ * test_catalog_index.c
+ *
+ * Unit tests for the persistent catalog index
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "pg_backup_auditor.h"
+#include "catalog_index.h"
+
+static char test_dir[PATH_MAX];
+static char cache_dir[PATH_MAX];
+static char backups_dir[PATH_MAX];
+
+static void
+write_file(const char *dir, const char *name, const char *content)
+{
+	char  path[PATH_MAX];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	fp = fopen(path, "w");
+	ck_assert_ptr_nonnull(fp);
+	fputs(content, fp);
+	fclose(fp);
+}
+
+/* A plain pg_basebackup backup at backups_dir/name */
+static void
+make_backup(const char *name, char *path)
+{
+	char sub[PATH_MAX];
+
+	snprintf(path, PATH_MAX, "%s/%s", backups_dir, name);
+	mkdir(path, 0755);
+	snprintf(sub, sizeof(sub), "%s/base", path);
+	mkdir(sub, 0755);
+	snprintf(sub, sizeof(sub), "%s/global", path);
+	mkdir(sub, 0755);
+	write_file(path, "PG_VERSION", "17\n");
+	write_file(path, "backup_label",
+			   "START WAL LOCATION: 0/2000028 (file 000000010000000000000002)\n"
+			   "START TIME: 2024-01-08 10:05:30 UTC\n"
+			   "START TIMELINE: 1\n");
+}
+
+static void
+setup(void)
+{
+	snprintf(test_dir, sizeof(test_dir), "/tmp/pg_catidx_test_%d", getpid());
+	snprintf(cache_dir, sizeof(cache_dir), "%s/cache", test_dir);
+	snprintf(backups_dir, sizeof(backups_dir), "%s/backups", test_dir);
+	mkdir(test_dir, 0755);
+	mkdir(cache_dir, 0755);
+	mkdir(backups_dir, 0755);
+	validation_set_cache_dir(cache_dir);
+}
+
+static void
+teardown(void)
+{
+	char cmd[PATH_MAX + 16];
+
+	validation_set_cache_dir(NULL);
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", test_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/* Index 'path' as holding one backup called 'id' */
+static void
+record_fake(const char *path, const char *id)
+{
+	CatalogIndex *index = catalog_index_open(backups_dir, -1);
+	BackupInfo    info;
+
+	ck_assert_ptr_nonnull(index);
+	memset(&info, 0, sizeof(info));
+	snprintf(info.backup_id, sizeof(info.backup_id), "%s", id);
+	snprintf(info.backup_path, sizeof(info.backup_path), "%s", path);
+	info.tool = BACKUP_TOOL_PG_BASEBACKUP;
+	catalog_index_record(index, path, &pg_basebackup_adapter, &info);
+	catalog_index_close(index);
+}
+
+/* No cache directory → no index, plain scans */
+START_TEST(test_catalog_index_disabled)
+{
+	char        path[PATH_MAX];
+	BackupInfo *list;
+
+	validation_set_cache_dir(NULL);
+	ck_assert_ptr_null(catalog_index_open(backups_dir, -1));
+
+	make_backup("b1", path);
+	list = scan_backup_directory(backups_dir, -1);
+	ck_assert_ptr_nonnull(list);
+	ck_assert_ptr_null(list->next);
+	free_backup_list(list);
+}
+END_TEST
+
+/* Scans take indexed backups until their metadata changes */
+START_TEST(test_catalog_index_reuse)
+{
+	char        path[PATH_MAX];
+	BackupInfo *list;
+	BackupInfo *reused;
+	CatalogIndex *index;
+
+	make_backup("b1", path);
+
+	/* First scan parses the backup and indexes it */
+	list = scan_backup_directory(backups_dir, -1);
+	ck_assert_ptr_nonnull(list);
+	ck_assert_str_eq(list->backup_path, path);
+	index = catalog_index_open(backups_dir, -1);
+	ck_assert(catalog_index_reuse(index, path, &reused, NULL));
+	ck_assert_ptr_nonnull(reused);
+	ck_assert_ptr_null(reused->next);
+	ck_assert_str_eq(reused->backup_id, list->backup_id);
+	ck_assert_uint_eq(reused->start_lsn, list->start_lsn);
+	free_backup_list(reused);
+	catalog_index_close(index);
+	free_backup_list(list);
+
+	/* An indexed record is returned as is: nothing was re-parsed */
+	record_fake(path, "from-index");
+	list = scan_backup_directory(backups_dir, -1);
+	ck_assert_ptr_nonnull(list);
+	ck_assert_str_eq(list->backup_id, "from-index");
+	free_backup_list(list);
+
+	/* Another depth is another index */
+	list = scan_backup_directory(backups_dir, 1);
+	ck_assert_ptr_nonnull(list);
+	ck_assert_str_ne(list->backup_id, "from-index");
+	free_backup_list(list);
+
+	/* Rewriting backup_label invalidates the entry */
+	write_file(path, "backup_label",
+			   "START WAL LOCATION: 0/3000028 (file 000000010000000000000003)\n"
+			   "START TIME: 2024-01-09 10:05:30 UTC\n"
+			   "LABEL: second\n"
+			   "START TIMELINE: 1\n");
+	list = scan_backup_directory(backups_dir, -1);
+	ck_assert_ptr_nonnull(list);
+	ck_assert_str_ne(list->backup_id, "from-index");
+	ck_assert_uint_eq(list->start_lsn, 0x3000028);
+	free_backup_list(list);
+}
+END_TEST
+
+/* Directories a scan did not visit are dropped from the index */
+START_TEST(test_catalog_index_prune)
+{
+	char          a[PATH_MAX], b[PATH_MAX];
+	char          cmd[PATH_MAX + 16];
+	BackupInfo   *list;
+	CatalogIndex *index;
+
+	make_backup("a", a);
+	make_backup("b", b);
+	list = scan_backup_directory(backups_dir, -1);
+	ck_assert_ptr_nonnull(list);
+	ck_assert_ptr_nonnull(list->next);
+	free_backup_list(list);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", b);
+	ck_assert_int_eq(system(cmd), 0);
+	list = scan_backup_directory(backups_dir, -1);
+	ck_assert_ptr_nonnull(list);
+	ck_assert_ptr_null(list->next);
+	free_backup_list(list);
+
+	index = catalog_index_open(backups_dir, -1);
+	ck_assert(catalog_index_reuse(index, a, &list, NULL));
+	free_backup_list(list);
+	ck_assert(!catalog_index_reuse(index, b, &list, NULL));
+	ck_assert_ptr_null(list);
+	catalog_index_close(index);
+}
+END_TEST
+
+/* Every field survives the file; the file holds no struct padding */
+START_TEST(test_catalog_index_fields)
+{
+	char          path[PATH_MAX];
+	char          cmd[PATH_MAX * 2];
+	BackupInfo    info;
+	BackupInfo   *list;
+	CatalogIndex *index;
+	FILE         *fp;
+	long          size = 0;
+
+	make_backup("b1", path);
+	memset(&info, 0x5a, sizeof(info));     /* padding and next: not stored */
+	snprintf(info.backup_id, sizeof(info.backup_id), "S1XQ2Z");
+	snprintf(info.node_name, sizeof(info.node_name), "node-a");
+	snprintf(info.instance_name, sizeof(info.instance_name), "main");
+	snprintf(info.tool_version, sizeof(info.tool_version), "2.5.15");
+	snprintf(info.parent_backup_id, sizeof(info.parent_backup_id), "S1XQ00");
+	snprintf(info.backup_path, sizeof(info.backup_path), "%s", path);
+	snprintf(info.backup_method, sizeof(info.backup_method), "streamed");
+	snprintf(info.backup_from, sizeof(info.backup_from), "standby");
+	snprintf(info.backup_label, sizeof(info.backup_label), "nightly");
+	snprintf(info.wal_start_file, sizeof(info.wal_start_file),
+			 "000000020000000A00000031");
+	snprintf(info.compress_alg, sizeof(info.compress_alg), "zstd");
+	snprintf(info.wal_mode, sizeof(info.wal_mode), "STREAM");
+	info.type = BACKUP_TYPE_DELTA;
+	info.tool = BACKUP_TOOL_PG_BASEBACKUP;
+	info.status = BACKUP_STATUS_OK;
+	info.start_time = 1700000000;
+	info.end_time = -1;
+	info.start_lsn = 0xA31000028ULL;
+	info.stop_lsn = 0xA32000100ULL;
+	info.redo_lsn = 0xA30FFFF00ULL;
+	info.timeline = 2;
+	info.pg_version = 170002;
+	info.data_bytes = 1ULL << 40;
+	info.wal_bytes = 12345;
+	info.wal_stream = true;
+	info.partial = false;
+	info.next = NULL;
+
+	index = catalog_index_open(backups_dir, -1);
+	ck_assert_ptr_nonnull(index);
+	catalog_index_record(index, path, &pg_basebackup_adapter, &info);
+	catalog_index_close(index);
+
+	snprintf(cmd, sizeof(cmd), "cat %s/catalog-*.idx | wc -c", cache_dir);
+	fp = popen(cmd, "r");
+	ck_assert_ptr_nonnull(fp);
+	ck_assert_int_eq(fscanf(fp, "%ld", &size), 1);
+	pclose(fp);
+	ck_assert_int_lt(size, 1024);
+
+	index = catalog_index_open(backups_dir, -1);
+	ck_assert(catalog_index_reuse(index, path, &list, NULL));
+	catalog_index_close(index);
+	ck_assert_ptr_nonnull(list);
+	ck_assert_ptr_null(list->next);
+	ck_assert_str_eq(list->backup_id, info.backup_id);
+	ck_assert_str_eq(list->node_name, info.node_name);
+	ck_assert_str_eq(list->instance_name, info.instance_name);
+	ck_assert_str_eq(list->tool_version, info.tool_version);
+	ck_assert_str_eq(list->parent_backup_id, info.parent_backup_id);
+	ck_assert_str_eq(list->backup_path, info.backup_path);
+	ck_assert_str_eq(list->backup_method, info.backup_method);
+	ck_assert_str_eq(list->backup_from, info.backup_from);
+	ck_assert_str_eq(list->backup_label, info.backup_label);
+	ck_assert_str_eq(list->wal_start_file, info.wal_start_file);
+	ck_assert_str_eq(list->compress_alg, info.compress_alg);
+	ck_assert_str_eq(list->wal_mode, info.wal_mode);
+	ck_assert_int_eq(list->type, info.type);
+	ck_assert_int_eq(list->tool, info.tool);
+	ck_assert_int_eq(list->status, info.status);
+	ck_assert_int_eq(list->start_time, info.start_time);
+	ck_assert_int_eq(list->end_time, info.end_time);
+	ck_assert_uint_eq(list->start_lsn, info.start_lsn);
+	ck_assert_uint_eq(list->stop_lsn, info.stop_lsn);
+	ck_assert_uint_eq(list->redo_lsn, info.redo_lsn);
+	ck_assert_uint_eq(list->timeline, info.timeline);
+	ck_assert_uint_eq(list->pg_version, info.pg_version);
+	ck_assert_uint_eq(list->data_bytes, info.data_bytes);
+	ck_assert_uint_eq(list->wal_bytes, info.wal_bytes);
+	ck_assert(list->wal_stream);
+	ck_assert(!list->partial);
+	free_backup_list(list);
+}
+END_TEST
+
+/* A damaged index file is ignored, not trusted */
+START_TEST(test_catalog_index_corrupt)
+{
+	char          path[PATH_MAX];
+	char          cmd[PATH_MAX * 2];
+	BackupInfo   *list;
+	CatalogIndex *index;
+
+	make_backup("b1", path);
+	record_fake(path, "from-index");
+
+	snprintf(cmd, sizeof(cmd),
+			 "for f in %s/catalog-*.idx; do head -c 40 \"$f\" > \"$f.cut\" && mv \"$f.cut\" \"$f\"; done",
+			 cache_dir);
+	ck_assert_int_eq(system(cmd), 0);
+
+	index = catalog_index_open(backups_dir, -1);
+	ck_assert(!catalog_index_reuse(index, path, &list, NULL));
+	catalog_index_close(index);
+
+	list = scan_backup_directory(backups_dir, -1);
+	ck_assert_ptr_nonnull(list);
+	ck_assert_str_ne(list->backup_id, "from-index");
+	free_backup_list(list);
+}
+END_TEST
+
+Suite *
+catalog_index_suite(void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("CatalogIndex");
+
+	tc_core = tcase_create("core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_catalog_index_disabled);
+	tcase_add_test(tc_core, test_catalog_index_reuse);
+	tcase_add_test(tc_core, test_catalog_index_prune);
+	tcase_add_test(tc_core, test_catalog_index_fields);
+	tcase_add_test(tc_core, test_catalog_index_corrupt);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
@@ -121,6 +121,84 @@ START_TEST(test_crc32c_large)
 }
 END_TEST
 
+/* Bitwise reference CRC32C, independent of the library tables */
+static uint32_t
+crc32c_reference(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		crc ^= buf[i];
+		for (int j = 0; j < 8; j++)
+			crc = (crc & 1) ? ((crc >> 1) ^ 0x82F63B78U) : (crc >> 1);
+	}
+	return crc;
+}
+
+/* Test: CRC32C standard check value ("123456789" -> 0xE3069283) */
+START_TEST(test_crc32c_check_value)
+{
+	const uint8_t data[] = "123456789";
+
+	ck_assert_uint_eq(~crc32c_update(~0U, data, 9), 0xE3069283U);
+	ck_assert_uint_eq(~crc32c_update_sw(~0U, data, 9), 0xE3069283U);
+}
+END_TEST
+
+/* Test: selected implementation reports a known name */
+START_TEST(test_crc32c_implementation_name)
+{
+	const char *name = crc32c_implementation();
+
+	ck_assert_ptr_nonnull(name);
+	ck_assert(strcmp(name, "sse4.2") == 0 ||
+			  strcmp(name, "armv8") == 0 ||
+			  strcmp(name, "sb8") == 0);
+}
+END_TEST
+
+/*
+ * Test: hardware, slicing-by-8 and bitwise reference agree for every
+ * length 0..100 at every starting alignment 0..7
+ */
+START_TEST(test_crc32c_paths_agree)
+{
+	uint8_t data[128];
+
+	for (int i = 0; i < (int) sizeof(data); i++)
+		data[i] = (uint8_t) (i * 131 + 7);
+
+	for (size_t off = 0; off < 8; off++)
+	{
+		for (size_t len = 0; len <= 100; len++)
+		{
+			uint32_t ref = crc32c_reference(~0U, data + off, len);
+
+			ck_assert_uint_eq(crc32c_update(~0U, data + off, len), ref);
+			ck_assert_uint_eq(crc32c_update_sw(~0U, data + off, len), ref);
+		}
+	}
+}
+END_TEST
+
+/* Test: splitting a buffer at any point gives the same running CRC */
+START_TEST(test_crc32c_split_any_point)
+{
+	uint8_t data[64];
+
+	for (int i = 0; i < (int) sizeof(data); i++)
+		data[i] = (uint8_t) (255 - i);
+
+	uint32_t whole = crc32c_update(~0U, data, sizeof(data));
+
+	for (size_t cut = 0; cut <= sizeof(data); cut++)
+	{
+		uint32_t crc = crc32c_update(~0U, data, cut);
+		crc = crc32c_update(crc, data + cut, sizeof(data) - cut);
+		ck_assert_uint_eq(crc, whole);
+	}
+}
+END_TEST
+
 /* Create test suite for CRC32C */
 Suite *
 crc32c_suite(void)
@@ -137,6 +215,10 @@ crc32c_suite(void)
 	tcase_add_test(tc_core, test_crc32c_zeros);
 	tcase_add_test(tc_core, test_crc32c_sensitivity);
 	tcase_add_test(tc_core, test_crc32c_large);
+	tcase_add_test(tc_core, test_crc32c_check_value);
+	tcase_add_test(tc_core, test_crc32c_implementation_name);
+	tcase_add_test(tc_core, test_crc32c_paths_agree);
+	tcase_add_test(tc_core, test_crc32c_split_any_point);
 	suite_add_tcase(s, tc_core);
 
 	return s;
@@ -0,0 +1,246 @@
+/*
+ * test_decompress.c
+ *
+ * Unit tests for the streaming decompression layer
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "decompress.h"
+
+static char test_dir[256];
+
+static void
+write_file(const char *name, const char *content)
+{
+	char path[512];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", test_dir, name);
+	fp = fopen(path, "w");
+	ck_assert_ptr_nonnull(fp);
+	fputs(content, fp);
+	fclose(fp);
+}
+
+/* Run a shell command inside test_dir */
+static void
+run(const char *cmd)
+{
+	char full[1024];
+
+	snprintf(full, sizeof(full), "cd '%s' && %s", test_dir, cmd);
+	ck_assert_int_eq(system(full), 0);
+}
+
+/* Read the whole stream into buf (NUL-terminated); returns bytes or -1 */
+static ssize_t
+read_all(DecompressStream *ds, char *buf, size_t size)
+{
+	size_t  total = 0;
+	ssize_t n;
+
+	/* Small reads, so data is handed out across several calls */
+	while (total + 7 < size &&
+		   (n = decompress_read(ds, buf + total, 7)) > 0)
+		total += (size_t) n;
+	if (n < 0)
+		return -1;
+	buf[total] = '\0';
+	return (ssize_t) total;
+}
+
+static void
+setup(void)
+{
+	snprintf(test_dir, sizeof(test_dir), "/tmp/decompress_test_%d", getpid());
+	mkdir(test_dir, 0755);
+}
+
+static void
+teardown(void)
+{
+	char cmd[512];
+	snprintf(cmd, sizeof(cmd), "rm -rf '%s'", test_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/* Test: magic detection, names and suffixes */
+START_TEST(test_compression_types)
+{
+	CompressionType t;
+
+	ck_assert_int_eq(compression_detect((const unsigned char *) "\x1f\x8b\x08", 3),
+					 COMPRESSION_GZIP);
+	ck_assert_int_eq(compression_detect((const unsigned char *) "BZh9", 4),
+					 COMPRESSION_BZIP2);
+	ck_assert_int_eq(compression_detect((const unsigned char *) "\xfd" "7zXZ\0", 6),
+					 COMPRESSION_XZ);
+	ck_assert_int_eq(compression_detect((const unsigned char *) "\x04\x22\x4d\x18", 4),
+					 COMPRESSION_LZ4);
+	ck_assert_int_eq(compression_detect((const unsigned char *) "\x28\xb5\x2f\xfd", 4),
+					 COMPRESSION_ZSTD);
+	ck_assert_int_eq(compression_detect((const unsigned char *) "ustar", 5),
+					 COMPRESSION_NONE);
+	ck_assert_int_eq(compression_detect((const unsigned char *) "\x1f", 1),
+					 COMPRESSION_NONE);
+
+	ck_assert(compression_from_name("gz", &t));
+	ck_assert_int_eq(t, COMPRESSION_GZIP);
+	ck_assert(compression_from_name("zst", &t));
+	ck_assert_int_eq(t, COMPRESSION_ZSTD);
+	ck_assert(compression_from_name("none", &t));
+	ck_assert_int_eq(t, COMPRESSION_NONE);
+	ck_assert(!compression_from_name("zlib", &t));
+	ck_assert(!compression_from_name("brotli", &t));
+
+	ck_assert_str_eq(compression_suffix(COMPRESSION_LZ4), ".lz4");
+	ck_assert_str_eq(compression_suffix(COMPRESSION_NONE), "");
+}
+END_TEST
+
+/* Test: plain files read as is; skip works */
+START_TEST(test_decompress_plain)
+{
+	char              path[512];
+	char              buf[64];
+	DecompressStream *ds;
+
+	write_file("plain", "0123456789abcdef");
+	snprintf(path, sizeof(path), "%s/plain", test_dir);
+
+	ds = decompress_open_auto(path);
+	ck_assert_ptr_nonnull(ds);
+	ck_assert(decompress_skip(ds, 10));
+	ck_assert_int_eq(read_all(ds, buf, sizeof(buf)), 6);
+	ck_assert_str_eq(buf, "abcdef");
+	decompress_close(ds);
+
+	snprintf(path, sizeof(path), "%s/missing", test_dir);
+	ck_assert_ptr_null(decompress_open_auto(path));
+}
+END_TEST
+
+/* Test: gzip, including a file of two concatenated members */
+START_TEST(test_decompress_gzip)
+{
+	char              path[512];
+	char              buf[256];
+	DecompressStream *ds;
+
+	write_file("a", "first member\n");
+	write_file("b", "second member\n");
+	run("gzip -nc a > one.gz && gzip -nc b >> one.gz");
+	snprintf(path, sizeof(path), "%s/one.gz", test_dir);
+
+	ds = decompress_open_auto(path);
+	ck_assert_ptr_nonnull(ds);
+	ck_assert_int_eq(read_all(ds, buf, sizeof(buf)), 27);
+	ck_assert_str_eq(buf, "first member\nsecond member\n");
+	decompress_close(ds);
+
+	/* Skipping decompresses and discards */
+	ds = decompress_open(path, COMPRESSION_GZIP);
+	ck_assert_ptr_nonnull(ds);
+	ck_assert(decompress_skip(ds, 13));
+	ck_assert_int_eq(read_all(ds, buf, sizeof(buf)), 14);
+	ck_assert_str_eq(buf, "second member\n");
+	ck_assert(!decompress_skip(ds, 1));
+	decompress_close(ds);
+}
+END_TEST
+
+/* Test: truncated gzip stream is an error, not a short success */
+START_TEST(test_decompress_gzip_truncated)
+{
+	char              path[512];
+	char              buf[8192];
+	DecompressStream *ds;
+	char              big[4000];
+
+	memset(big, 'q', sizeof(big) - 1);
+	big[sizeof(big) - 1] = '\0';
+	for (size_t i = 0; i < sizeof(big) - 1; i += 37)
+		big[i] = (char) ('a' + i % 26);
+	write_file("big", big);
+	run("gzip -nc big | head -c 40 > cut.gz");
+	snprintf(path, sizeof(path), "%s/cut.gz", test_dir);
+
+	ds = decompress_open(path, COMPRESSION_GZIP);
+	ck_assert_ptr_nonnull(ds);
+	ck_assert_int_eq(read_all(ds, buf, sizeof(buf)), -1);
+	decompress_close(ds);
+}
+END_TEST
+
+/* Test: a format without a built-in backend goes through the tool */
+START_TEST(test_decompress_external)
+{
+	char              path[512];
+	char              buf[64];
+	DecompressStream *ds;
+
+	if (system("command -v bzip2 >/dev/null 2>&1") != 0)
+		return;     /* no bzip2 on this machine */
+
+	ck_assert_str_eq(compression_backend(COMPRESSION_BZIP2), "external");
+
+	write_file("c", "via bzip2\n");
+	run("bzip2 -c c > c.bz2");
+	snprintf(path, sizeof(path), "%s/c.bz2", test_dir);
+
+	ds = decompress_open_auto(path);
+	ck_assert_ptr_nonnull(ds);
+	ck_assert_int_eq(read_all(ds, buf, sizeof(buf)), 10);
+	ck_assert_str_eq(buf, "via bzip2\n");
+	decompress_close(ds);
+
+	/* Garbage after the magic: the tool fails, the read reports it */
+	write_file("bad.bz2", "BZh9 this is not bzip2 data");
+	snprintf(path, sizeof(path), "%s/bad.bz2", test_dir);
+	ds = decompress_open(path, COMPRESSION_BZIP2);
+	ck_assert_ptr_nonnull(ds);
+	ck_assert_int_eq(read_all(ds, buf, sizeof(buf)), -1);
+	decompress_close(ds);
+}
+END_TEST
+
+Suite *
+decompress_suite(void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Decompress");
+
+	tc_core = tcase_create("core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_compression_types);
+	tcase_add_test(tc_core, test_decompress_plain);
+	tcase_add_test(tc_core, test_decompress_gzip);
+	tcase_add_test(tc_core, test_decompress_gzip_truncated);
+	tcase_add_test(tc_core, test_decompress_external);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
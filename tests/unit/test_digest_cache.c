@@ -0,0 +1,258 @@
+/*
+ * test_digest_cache.c
+ *
+ * Unit tests for the content-identity digest cache
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "pg_backup_auditor.h"
+#include "digest_cache.h"
+#include "verify_jobs.h"
+#include "validation_result.h"
+#include "crc32c.h"
+
+static char test_dir[PATH_MAX];
+static char cache_dir[PATH_MAX];
+
+static void
+setup(void)
+{
+	snprintf(test_dir, sizeof(test_dir), "/tmp/pg_digestcache_test_%d", getpid());
+	snprintf(cache_dir, sizeof(cache_dir), "%s/cache", test_dir);
+	mkdir(test_dir, 0755);
+	mkdir(cache_dir, 0755);
+	validation_set_cache_dir(NULL);
+	digest_cache_reset();
+}
+
+static void
+teardown(void)
+{
+	char cmd[PATH_MAX + 16];
+
+	validation_set_cache_dir(NULL);
+	digest_cache_reset();
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", test_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/* Write test_dir/name with 'content'; fill 'st' */
+static void
+make_file(const char *name, const char *content, char *path, struct stat *st)
+{
+	FILE *fp;
+
+	snprintf(path, PATH_MAX, "%s/%s", test_dir, name);
+	fp = fopen(path, "w");
+	ck_assert_ptr_nonnull(fp);
+	fputs(content, fp);
+	fclose(fp);
+	ck_assert_int_eq(stat(path, st), 0);
+}
+
+/* Rewrite 'path' in place with 'content' and give it back its mtime */
+static void
+rewrite_keeping_identity(const char *path, const char *content,
+						 const struct stat *st)
+{
+	struct timespec times[2];
+	struct stat     now;
+	FILE           *fp = fopen(path, "r+");
+
+	ck_assert_ptr_nonnull(fp);
+	fputs(content, fp);
+	fclose(fp);
+
+	times[0] = st->st_atim;
+	times[1] = st->st_mtim;
+	ck_assert_int_eq(utimensat(AT_FDCWD, path, times, 0), 0);
+	ck_assert_int_eq(stat(path, &now), 0);
+	ck_assert_int_eq(now.st_ino, st->st_ino);
+	ck_assert_int_eq(now.st_size, st->st_size);
+}
+
+/* Any part of the key, and the digest length, must match */
+START_TEST(test_digest_cache_lookup)
+{
+	char        path[PATH_MAX];
+	struct stat st, changed;
+	DigestKey   key, other;
+	uint8_t     digest[20], out[20];
+	int64_t     content_size = 0;
+
+	make_file("a", "abc", path, &st);
+	memset(digest, 0xA5, sizeof(digest));
+	digest_key_set(&key, &st, VERIFY_ALG_SHA1, COMPRESSION_NONE);
+
+	ck_assert(!digest_cache_lookup(&key, out, sizeof(out), &content_size));
+	digest_cache_store(&key, digest, sizeof(digest), 3);
+	ck_assert(digest_cache_lookup(&key, out, sizeof(out), &content_size));
+	ck_assert_int_eq(memcmp(out, digest, sizeof(digest)), 0);
+	ck_assert_int_eq(content_size, 3);
+	ck_assert(!digest_cache_lookup(&key, out, 4, &content_size));
+
+	digest_key_set(&other, &st, VERIFY_ALG_SHA256, COMPRESSION_NONE);
+	ck_assert(!digest_cache_lookup(&other, out, sizeof(out), &content_size));
+	digest_key_set(&other, &st, VERIFY_ALG_SHA1, COMPRESSION_GZIP);
+	ck_assert(!digest_cache_lookup(&other, out, sizeof(out), &content_size));
+
+	changed = st;
+	changed.st_mtim.tv_nsec = (changed.st_mtim.tv_nsec + 1) % 1000000000L;
+	digest_key_set(&other, &changed, VERIFY_ALG_SHA1, COMPRESSION_NONE);
+	ck_assert(!digest_cache_lookup(&other, out, sizeof(out), &content_size));
+	changed = st;
+	changed.st_ino++;
+	digest_key_set(&other, &changed, VERIFY_ALG_SHA1, COMPRESSION_NONE);
+	ck_assert(!digest_cache_lookup(&other, out, sizeof(out), &content_size));
+
+	/* Without a cache directory nothing survives a reset */
+	digest_cache_save();
+	digest_cache_reset();
+	ck_assert(!digest_cache_lookup(&key, out, sizeof(out), &content_size));
+}
+END_TEST
+
+/* With a cache directory entries are kept, until they grow too old */
+START_TEST(test_digest_cache_persist)
+{
+	char        path[PATH_MAX];
+	char        file[PATH_MAX];
+	struct stat st;
+	DigestKey   key;
+	uint8_t     digest[4] = { 1, 2, 3, 4 };
+	uint8_t     out[4];
+	int64_t     content_size = 0;
+	FILE       *fp;
+
+	validation_set_cache_dir(cache_dir);
+	make_file("a", "abc", path, &st);
+	digest_key_set(&key, &st, VERIFY_ALG_CRC32C, COMPRESSION_NONE);
+	digest_cache_store(&key, digest, sizeof(digest), 3);
+	digest_cache_save();
+
+	digest_cache_reset();
+	ck_assert(digest_cache_lookup(&key, out, sizeof(out), &content_size));
+	ck_assert_int_eq(memcmp(out, digest, sizeof(digest)), 0);
+
+	/* An entry computed DIGEST_CACHE_MAX_AGE days ago is not trusted */
+	snprintf(file, sizeof(file), "%s/digests.cache", cache_dir);
+	fp = fopen(file, "w");
+	ck_assert_ptr_nonnull(fp);
+	fprintf(fp, "pg_backup_auditor digest-cache 1\n");
+	fprintf(fp, "%llu %llu %lld %lld %ld %d %d 3 %lld 01020304\n",
+			(unsigned long long) st.st_dev, (unsigned long long) st.st_ino,
+			(long long) st.st_size, (long long) st.st_mtim.tv_sec,
+			st.st_mtim.tv_nsec, VERIFY_ALG_CRC32C, COMPRESSION_NONE,
+			(long long) (time(NULL) - (DIGEST_CACHE_MAX_AGE + 1) * 86400L));
+	fclose(fp);
+	digest_cache_reset();
+	ck_assert(!digest_cache_lookup(&key, out, sizeof(out), &content_size));
+
+	/* It is dropped on the next save */
+	digest_cache_save();
+	digest_cache_reset();
+	fp = fopen(file, "r");
+	ck_assert_ptr_nonnull(fp);
+	ck_assert_ptr_nonnull(fgets(path, sizeof(path), fp));
+	ck_assert_ptr_null(fgets(path, sizeof(path), fp));
+	fclose(fp);
+
+	/* An unknown format starts over */
+	fp = fopen(file, "w");
+	fputs("something else\n", fp);
+	fclose(fp);
+	ck_assert(!digest_cache_lookup(&key, out, sizeof(out), &content_size));
+}
+END_TEST
+
+/* One CRC32C job for 'path' expecting 'crc' */
+static void
+run_crc_job(const char *path, const char *name, uint32_t crc, int64_t size,
+			ValidationResult *res)
+{
+	VerifyJobList list;
+	VerifyJob    *job;
+
+	verify_job_list_init(&list, "test");
+	job = verify_job_list_add(&list, path, name);
+	job->algorithm     = VERIFY_ALG_CRC32C;
+	job->expected_crc  = crc;
+	job->expected_size = size;
+	verify_jobs_run(&list, 1);
+	verify_jobs_merge(&list, res, NULL);
+	verify_job_list_free(&list);
+}
+
+/*
+ * A file listed by a second backup is not read again: its digest comes
+ * from the cache, and is still checked against that backup's manifest
+ */
+START_TEST(test_digest_cache_jobs)
+{
+	char              path[PATH_MAX];
+	struct stat       st;
+	uint32_t          crc = ~crc32c_update(~0U, (const uint8_t *) "abcd", 4);
+	ValidationResult *res = calloc(1, sizeof(*res));
+
+	make_file("shared", "abcd", path, &st);
+	run_crc_job(path, "first", crc, 4, res);
+	ck_assert_int_eq(res->error_count, 0);
+
+	/* Same identity, other content: the cached digest is used */
+	rewrite_keeping_identity(path, "wxyz", &st);
+	run_crc_job(path, "second", crc, 4, res);
+	ck_assert_int_eq(res->error_count, 0);
+
+	/* Another manifest's expectation is compared with it as usual */
+	run_crc_job(path, "third", crc ^ 1, 4, res);
+	run_crc_job(path, "fourth", crc, 5, res);
+	ck_assert_int_eq(res->error_count, 2);
+	ck_assert_ptr_nonnull(strstr(res->errors[0], "CRC32C mismatch: third"));
+	ck_assert_ptr_nonnull(strstr(res->errors[1], "Size mismatch for fourth"));
+
+	/* Without the cached digest the file is read again */
+	digest_cache_reset();
+	run_crc_job(path, "fifth", crc, 4, res);
+	ck_assert_int_eq(res->error_count, 3);
+
+	free_validation_result(res);
+}
+END_TEST
+
+Suite *
+digest_cache_suite(void)
+{
+	Suite *s = suite_create("digest_cache");
+	TCase *tc = tcase_create("core");
+
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_digest_cache_lookup);
+	tcase_add_test(tc, test_digest_cache_persist);
+	tcase_add_test(tc, test_digest_cache_jobs);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,13 +19,17 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include <check.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
 #include "pg_backup_auditor.h"
+#include "crc32c.h"
 
 /* Test fixtures */
 static char test_dir[PATH_MAX];
@@ -172,6 +176,100 @@ START_TEST(test_get_directory_size)
 }
 END_TEST
 
+/* Test: nested directories and symlinks are followed, as stat() would */
+START_TEST(test_get_directory_size_nested)
+{
+	char path[PATH_MAX];
+	char target[PATH_MAX];
+	FILE *fp;
+
+	setup_test_files();
+
+	snprintf(path, sizeof(path), "%s/a", test_subdir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/a/b", test_subdir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/a/b/deep.txt", test_subdir);
+	fp = fopen(path, "w");
+	fprintf(fp, "0123456789");		/* 10 bytes */
+	fclose(fp);
+
+	/* A link to a file outside counts its target; so does a directory link */
+	snprintf(path, sizeof(path), "%s/link.txt", test_subdir);
+	ck_assert_int_eq(symlink(test_file, path), 0);		/* 12 bytes */
+	snprintf(target, sizeof(target), "%s/a/b", test_subdir);
+	snprintf(path, sizeof(path), "%s/linkdir", test_subdir);
+	ck_assert_int_eq(symlink(target, path), 0);		/* 10 bytes again */
+
+	ck_assert_uint_eq(get_directory_size(test_subdir), 18 + 10 + 12 + 10);
+	ck_assert_uint_eq(get_directory_size("/tmp/file_utils_nonexistent_dir"), 0);
+
+	/* Directories are recognised from d_type or, failing that, stat */
+	{
+		DIR *dir = opendir(test_subdir);
+		struct dirent *entry;
+		int dirs = 0;
+
+		ck_assert_ptr_nonnull(dir);
+		while ((entry = readdir(dir)) != NULL)
+			if (entry->d_name[0] != '.' && dirent_is_directory(dirfd(dir), entry))
+				dirs++;
+		closedir(dir);
+		ck_assert_int_eq(dirs, 2);		/* a, linkdir */
+	}
+
+	teardown_test_files();
+}
+END_TEST
+
+/* Test: one readdir() pass answers lookups by name and prefix */
+START_TEST(test_dir_snapshot)
+{
+	DirSnapshot snap;
+	const DirSnapshotEntry *e;
+	char path[PATH_MAX];
+	FILE *fp;
+
+	setup_test_files();
+	snprintf(path, sizeof(path), "%s/base.tar.gz", test_dir);
+	fp = fopen(path, "w");
+	fclose(fp);
+
+	ck_assert(dir_snapshot_read(test_dir, &snap));
+	ck_assert_int_eq(snap.count, 3);		/* testfile.txt, subdir, base.tar.gz */
+
+	e = dir_snapshot_find(&snap, "subdir");
+	ck_assert_ptr_nonnull(e);
+	ck_assert(e->is_dir);
+	ck_assert(dir_snapshot_has_dir(&snap, "subdir"));
+	ck_assert(!dir_snapshot_has_dir(&snap, "testfile.txt"));
+	ck_assert_ptr_nonnull(dir_snapshot_find(&snap, "testfile.txt"));
+	ck_assert_ptr_null(dir_snapshot_find(&snap, "testfile"));
+	ck_assert_ptr_null(dir_snapshot_find(&snap, "."));
+
+	e = dir_snapshot_find_prefix(&snap, "base.tar");
+	ck_assert_ptr_nonnull(e);
+	ck_assert_str_eq(e->name, "base.tar.gz");
+	ck_assert_ptr_nonnull(dir_snapshot_find_prefix(&snap, "sub"));
+	ck_assert_ptr_null(dir_snapshot_find_prefix(&snap, "pg_wal.tar"));
+	dir_snapshot_free(&snap);
+	ck_assert_int_eq(snap.count, 0);
+
+	/* Empty and missing directories */
+	snprintf(path, sizeof(path), "%s/empty", test_dir);
+	mkdir(path, 0755);
+	ck_assert(dir_snapshot_read(path, &snap));
+	ck_assert_int_eq(snap.count, 0);
+	ck_assert_ptr_null(dir_snapshot_find(&snap, "x"));
+	ck_assert_ptr_null(dir_snapshot_find_prefix(&snap, "x"));
+	dir_snapshot_free(&snap);
+	ck_assert(!dir_snapshot_read("/tmp/file_utils_nonexistent_dir", &snap));
+	ck_assert(!dir_snapshot_read(test_file, &snap));
+
+	teardown_test_files();
+}
+END_TEST
+
 /* Test: path_join with normal paths */
 START_TEST(test_path_join_normal)
 {
@@ -235,6 +333,68 @@ START_TEST(test_compute_file_crc32c_nonexistent)
 }
 END_TEST
 
+/* Test: every page-cache mode reads the same bytes (direct may fall back) */
+START_TEST(test_compute_file_crc32c_page_cache_modes)
+{
+	static const PageCacheMode modes[] = {
+		PAGE_CACHE_USE, PAGE_CACHE_DROP, PAGE_CACHE_DIRECT
+	};
+	char     big[PATH_MAX];
+	uint32_t crc[3];
+	size_t   size = 9 * 1024 * 1024 + 123;  /* past one release step */
+	uint8_t *data = malloc(size);
+	FILE    *fp;
+
+	setup_test_files();
+	ck_assert_ptr_nonnull(data);
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t) (i * 7 + (i >> 12));
+	snprintf(big, sizeof(big), "%s/big.bin", test_dir);
+	fp = fopen(big, "wb");
+	ck_assert_ptr_nonnull(fp);
+	ck_assert_uint_eq(fwrite(data, 1, size, fp), size);
+	fclose(fp);
+
+	for (int m = 0; m < 3; m++)
+	{
+		set_page_cache_mode(modes[m]);
+		ck_assert(compute_file_crc32c(big, &crc[m]));
+	}
+	set_page_cache_mode(PAGE_CACHE_USE);
+
+	ck_assert_uint_eq(crc[0], ~crc32c_update(~0U, data, size));
+	ck_assert_uint_eq(crc[1], crc[0]);
+	ck_assert_uint_eq(crc[2], crc[0]);
+
+	unlink(big);
+	free(data);
+	teardown_test_files();
+}
+END_TEST
+
+/* Test: pipes and temporary files are created close-on-exec */
+START_TEST(test_cloexec_descriptors)
+{
+	char tmpl[PATH_MAX];
+	int  fds[2];
+	int  fd;
+
+	ck_assert_int_eq(pipe_cloexec(fds), 0);
+	ck_assert(fcntl(fds[0], F_GETFD) & FD_CLOEXEC);
+	ck_assert(fcntl(fds[1], F_GETFD) & FD_CLOEXEC);
+	close(fds[0]);
+	close(fds[1]);
+
+	snprintf(tmpl, sizeof(tmpl), "/tmp/pg_cloexec_%d_XXXXXX", getpid());
+	fd = mkstemp_cloexec(tmpl);
+	ck_assert_int_ge(fd, 0);
+	ck_assert(fcntl(fd, F_GETFD) & FD_CLOEXEC);
+	ck_assert_str_ne(tmpl + strlen(tmpl) - 6, "XXXXXX");
+	close(fd);
+	unlink(tmpl);
+}
+END_TEST
+
 /* Create test suite */
 Suite *
 file_utils_suite(void)
@@ -255,6 +415,9 @@ file_utils_suite(void)
 	tcase_add_test(tc_file_ops, test_is_regular_file_false);
 	tcase_add_test(tc_file_ops, test_get_file_size);
 	tcase_add_test(tc_file_ops, test_get_directory_size);
+	tcase_add_test(tc_file_ops, test_get_directory_size_nested);
+	tcase_add_test(tc_file_ops, test_dir_snapshot);
+	tcase_add_test(tc_file_ops, test_cloexec_descriptors);
 	suite_add_tcase(s, tc_file_ops);
 
 	tc_path = tcase_create("path_operations");
@@ -266,6 +429,7 @@ file_utils_suite(void)
 	tc_crc = tcase_create("crc32c");
 	tcase_add_test(tc_crc, test_compute_file_crc32c);
 	tcase_add_test(tc_crc, test_compute_file_crc32c_nonexistent);
+	tcase_add_test(tc_crc, test_compute_file_crc32c_page_cache_modes);
 	suite_add_tcase(s, tc_crc);
 
 	return s;
@@ -154,6 +154,471 @@ START_TEST(test_scan_wal_nonexistent)
 }
 END_TEST
 
+/*
+ * Create a plain pg_basebackup backup at 'path' (parents included).
+ */
+static void
+make_plain_backup(const char *path)
+{
+	char cmd[PATH_MAX * 2];
+	FILE *fp;
+
+	snprintf(cmd, sizeof(cmd), "mkdir -p '%s/base' '%s/global'", path, path);
+	ck_assert_int_eq(system(cmd), 0);
+	snprintf(cmd, sizeof(cmd), "%s/backup_label", path);
+	fp = fopen(cmd, "w");
+	ck_assert_ptr_nonnull(fp);
+	fprintf(fp, "START WAL LOCATION: 0/2000028 (file 000000010000000000000002)\n");
+	fprintf(fp, "START TIMELINE: 1\n");
+	fclose(fp);
+}
+
+/*
+ * A threaded scan finds the same backups, in the same order, as a
+ * single-threaded one; the depth limit still applies.
+ */
+START_TEST(test_scan_parallel_order)
+{
+	char        dir[64];
+	char        path[PATH_MAX];
+	char        cmd[PATH_MAX];
+	char      (*serial)[PATH_MAX];
+	int         nserial = 0;
+	int         n;
+	BackupInfo *list;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_fs_parallel_%d", (int)getpid());
+	for (int i = 0; i < 6; i++)
+		for (int j = 0; j < 8; j++)
+		{
+			snprintf(path, sizeof(path), "%s/host%d/b%d", dir, i, j);
+			make_plain_backup(path);
+		}
+	snprintf(path, sizeof(path), "%s/host0/deep/er/b", dir);
+	make_plain_backup(path);
+
+	serial = malloc(64 * sizeof(*serial));
+	ck_assert_ptr_nonnull(serial);
+
+	scan_set_jobs(1);
+	list = scan_backup_directory(dir, -1);
+	for (BackupInfo *cur = list; cur != NULL; cur = cur->next)
+		snprintf(serial[nserial++], PATH_MAX, "%s", cur->backup_path);
+	free_backup_list(list);
+	ck_assert_int_eq(nserial, 49);
+
+	scan_set_jobs(8);
+	for (int round = 0; round < 5; round++)
+	{
+		list = scan_backup_directory(dir, -1);
+		n = 0;
+		for (BackupInfo *cur = list; cur != NULL; cur = cur->next, n++)
+		{
+			ck_assert_int_lt(n, nserial);
+			ck_assert_str_eq(cur->backup_path, serial[n]);
+		}
+		ck_assert_int_eq(n, nserial);
+		free_backup_list(list);
+	}
+
+	/* The hostN/bM backups are at depth 2, the deep one below that */
+	list = scan_backup_directory(dir, 2);
+	n = 0;
+	for (BackupInfo *cur = list; cur != NULL; cur = cur->next)
+		n++;
+	ck_assert_int_eq(n, 48);
+	free_backup_list(list);
+	scan_set_jobs(1);
+
+	free(serial);
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/*
+ * The directories of a detected backup are not scanned: a backup-like
+ * tree inside one (here, in its pg_wal/) is not reported, while the
+ * same tree beside it is.
+ */
+START_TEST(test_scan_prunes_backups)
+{
+	char        dir[64];
+	char        path[PATH_MAX];
+	char        cmd[PATH_MAX];
+	BackupInfo *list;
+	int         n = 0;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_fs_prune_%d", (int)getpid());
+	snprintf(path, sizeof(path), "%s/b1", dir);
+	make_plain_backup(path);
+	snprintf(path, sizeof(path), "%s/b1/pg_wal/inner", dir);
+	make_plain_backup(path);
+	snprintf(path, sizeof(path), "%s/other/b2", dir);
+	make_plain_backup(path);
+
+	list = scan_backup_directory(dir, -1);
+	for (BackupInfo *cur = list; cur != NULL; cur = cur->next)
+	{
+		ck_assert_ptr_null(strstr(cur->backup_path, "inner"));
+		n++;
+	}
+	ck_assert_int_eq(n, 2);
+	free_backup_list(list);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/*
+ * pg_basebackup 17 incrementals are linked to the backup whose start LSN
+ * their INCREMENTAL FROM LSN names, whatever the directory order.
+ */
+START_TEST(test_scan_links_incrementals)
+{
+	static const char *names[] = {"c_incr2", "a_incr1", "b_full", "d_other"};
+	static const char *labels[] = {
+		"START WAL LOCATION: 0/4000028 (file 000000010000000000000004)\n"
+		"START TIME: 2024-01-03 10:00:00 UTC\n"
+		"INCREMENTAL FROM LSN: 0/3000028\n",
+		"START WAL LOCATION: 0/3000028 (file 000000010000000000000003)\n"
+		"START TIME: 2024-01-02 10:00:00 UTC\n"
+		"INCREMENTAL FROM LSN: 0/2000028\n",
+		"START WAL LOCATION: 0/2000028 (file 000000010000000000000002)\n"
+		"START TIME: 2024-01-01 10:00:00 UTC\n",
+		"START WAL LOCATION: 0/9000028 (file 000000010000000000000009)\n"
+		"START TIME: 2024-01-04 10:00:00 UTC\n"
+		"INCREMENTAL FROM LSN: 0/8000028\n",
+	};
+	char        dir[64];
+	char        path[PATH_MAX];
+	char        cmd[PATH_MAX];
+	FILE       *fp;
+	BackupInfo *list;
+	int         n = 0;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_fs_link_%d", (int)getpid());
+	for (int i = 0; i < 4; i++)
+	{
+		snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+		make_plain_backup(path);
+		snprintf(path, sizeof(path), "%s/%s/backup_label", dir, names[i]);
+		fp = fopen(path, "w");
+		ck_assert_ptr_nonnull(fp);
+		fputs(labels[i], fp);
+		fputs("START TIMELINE: 1\n", fp);
+		fclose(fp);
+	}
+
+	list = scan_backup_directory(dir, -1);
+	for (BackupInfo *cur = list; cur != NULL; cur = cur->next, n++)
+	{
+		if (strcmp(cur->backup_id, "20240103-100000I") == 0)
+			ck_assert_str_eq(cur->parent_backup_id, "20240102-100000I");
+		else if (strcmp(cur->backup_id, "20240102-100000I") == 0)
+			ck_assert_str_eq(cur->parent_backup_id, "20240101-100000");
+		else
+			ck_assert_str_eq(cur->parent_backup_id, "");
+	}
+	ck_assert_int_eq(n, 4);
+	free_backup_list(list);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/*
+ * scan_wal_archive() recognises compressed and pgBackRest-style segment
+ * files, keeps their on-disk form, and ignores .partial/.backup files.
+ */
+START_TEST(test_scan_wal_compressed_names)
+{
+	static const char *const files[] = {
+		"000000010000000000000001",
+		"000000010000000000000001.gz",              /* duplicate: bare wins */
+		"000000010000000000000002.zst",
+		"000000010000000000000003.partial",
+		"000000010000000000000003.00000028.backup",
+		"00000002.history",
+		"0000000100000000/000000010000000000000004-"
+		"0123456789abcdef0123456789abcdef01234567.lz4",
+		"0000000100000000/000000010000000000000005-"
+		"0123456789abcdef0123456789abcdef01234567",
+	};
+	char dir[64];
+	char path[PATH_MAX];
+	char cmd[PATH_MAX];
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_wal_names_%d", (int)getpid());
+	mkdir(dir, 0755);
+	snprintf(path, sizeof(path), "%s/0000000100000000", dir);
+	mkdir(path, 0755);
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+	{
+		FILE *fp;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+		fp = fopen(path, "w");
+		ck_assert_ptr_nonnull(fp);
+		fclose(fp);
+	}
+
+	WALArchiveInfo *info = scan_wal_archive(dir);
+	ck_assert_ptr_nonnull(info);
+	ck_assert_int_eq(info->segment_count, 4);
+	ck_assert_ptr_nonnull(info->files);
+
+	ck_assert_uint_eq(info->segments[0].seg_id, 1);
+	ck_assert_ptr_null(info->files[0].suffix);
+	ck_assert_int_eq(wal_archive_segment_compression(info, 0), COMPRESSION_NONE);
+
+	ck_assert_uint_eq(info->segments[1].seg_id, 2);
+	ck_assert_str_eq(info->files[1].suffix, ".zst");
+	ck_assert_int_eq(wal_archive_segment_compression(info, 1), COMPRESSION_ZSTD);
+
+	ck_assert_uint_eq(info->segments[2].seg_id, 4);
+	ck_assert(info->files[2].in_subdir);
+	ck_assert_int_eq(wal_archive_segment_compression(info, 2), COMPRESSION_LZ4);
+	wal_archive_segment_path(info, 2, path, sizeof(path));
+	ck_assert(file_exists(path));
+
+	ck_assert_uint_eq(info->segments[3].seg_id, 5);
+	ck_assert_int_eq(wal_archive_segment_compression(info, 3), COMPRESSION_NONE);
+
+	WALSegmentName want = { 1, 0, 4 };
+	ck_assert_int_eq(wal_archive_find(info, &want), 2);
+	want.seg_id = 3;
+	ck_assert_int_eq(wal_archive_find(info, &want), -1);
+
+	free_wal_archive_info(info);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/*
+ * scan_wal_archive() records each segment's size and totals every regular
+ * file in the archive, matching get_directory_size().
+ */
+START_TEST(test_scan_wal_inventory)
+{
+	static const struct { const char *name; size_t size; } files[] = {
+		{ "000000010000000000000001", 100 },
+		{ "000000010000000000000002.gz", 30 },
+		{ "00000002.history", 7 },
+		{ "archive_status/000000010000000000000001.done", 5 },
+		{ "0000000100000000/000000010000000000000003-"
+		  "0123456789abcdef0123456789abcdef01234567", 11 },
+	};
+	char dir[64];
+	char path[PATH_MAX];
+	char cmd[PATH_MAX];
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_wal_inv_%d", (int)getpid());
+	mkdir(dir, 0755);
+	snprintf(path, sizeof(path), "%s/archive_status", dir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/0000000100000000", dir);
+	mkdir(path, 0755);
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+	{
+		FILE *fp;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, files[i].name);
+		fp = fopen(path, "w");
+		ck_assert_ptr_nonnull(fp);
+		for (size_t j = 0; j < files[i].size; j++)
+			fputc('x', fp);
+		fclose(fp);
+	}
+
+	WALArchiveInfo *info = scan_wal_archive(dir);
+	ck_assert_ptr_nonnull(info);
+	ck_assert_int_eq(info->segment_count, 3);
+	ck_assert_ptr_nonnull(info->stats);
+	ck_assert_uint_eq(info->stats[0].size, 100);
+	ck_assert_uint_eq(info->stats[1].size, 30);
+	ck_assert_uint_eq(info->stats[2].size, 11);
+	ck_assert(info->stats[0].mtime > 0);
+	ck_assert_uint_eq(info->total_bytes, 153);
+	ck_assert_uint_eq(info->total_bytes, get_directory_size(dir));
+
+	free_wal_archive_info(info);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/*
+ * A large archive is sorted (by radix) and collapsed into runs of
+ * consecutive segments; lookups go through the runs.
+ */
+START_TEST(test_scan_wal_ranges)
+{
+	char dir[64];
+	char path[PATH_MAX];
+	char cmd[PATH_MAX];
+	int  nfiles = 0;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_wal_ranges_%d", (int)getpid());
+	mkdir(dir, 0755);
+
+	/*
+	 * tli 1: 0..299 (crossing from log 0 into log 1 after 0xFF), 310..499
+	 * and 512..599 (log 2 from its first segment); tli 2: 0x10..0x1F
+	 */
+	for (int i = 0; i < 600; i++)
+	{
+		FILE *fp;
+
+		if ((i >= 300 && i < 310) || (i >= 500 && i < 512))
+			continue;
+		snprintf(path, sizeof(path), "%s/00000001%08X%08X", dir,
+				 (unsigned) i / 256, (unsigned) i % 256);
+		fp = fopen(path, "w");
+		ck_assert_ptr_nonnull(fp);
+		fclose(fp);
+		nfiles++;
+	}
+	for (int i = 0x10; i < 0x20; i++)
+	{
+		FILE *fp;
+
+		snprintf(path, sizeof(path), "%s/0000000200000000%08X", dir, (unsigned) i);
+		fp = fopen(path, "w");
+		ck_assert_ptr_nonnull(fp);
+		fclose(fp);
+		nfiles++;
+	}
+	snprintf(path, sizeof(path), "%s/000000010000000000000005.gz", dir);
+	fclose(fopen(path, "w"));
+
+	WALArchiveInfo *info = scan_wal_archive(dir);
+	ck_assert_ptr_nonnull(info);
+	ck_assert_int_eq(info->segment_count, nfiles);
+	for (int i = 1; i < info->segment_count; i++)
+	{
+		const WALSegmentName *a = &info->segments[i - 1];
+		const WALSegmentName *b = &info->segments[i];
+
+		ck_assert(a->timeline < b->timeline ||
+				  (a->timeline == b->timeline &&
+				   (a->log_id < b->log_id ||
+					(a->log_id == b->log_id && a->seg_id < b->seg_id))));
+	}
+
+	/* Duplicate of segment 5: the bare file is kept, so all are bare */
+	ck_assert_ptr_null(info->files);
+
+	/* 0..299 | 310..499 | 512..599 | tli 2; positions are segment numbers */
+	ck_assert_ptr_nonnull(info->ranges);
+	ck_assert_uint_eq(info->segment_size, 0);	/* empty files: unknown */
+	ck_assert_int_eq(info->range_count, 4);
+	ck_assert_uint_eq(info->ranges[0].count, 300);
+	ck_assert_uint_eq(info->ranges[1].start, 310);
+	ck_assert_int_eq(info->ranges[1].first, 300);
+	ck_assert_uint_eq(info->ranges[2].start, 512);
+	ck_assert_uint_eq(info->ranges[3].timeline, 2);
+	ck_assert_uint_eq(info->ranges[3].count, 16);
+
+	/* 0000000100000000000000FF is followed by 000000010000000100000000 */
+	WALSegmentName want = { 1, 1, 0 };
+	ck_assert_int_eq(wal_archive_find_range(info, &want), 0);
+	ck_assert_int_eq(wal_archive_find(info, &want), 256);
+	want = (WALSegmentName) { 1, 1, 450 - 256 };
+	ck_assert_int_eq(wal_archive_find_range(info, &want), 1);
+	ck_assert_int_eq(wal_archive_find(info, &want), 440);
+	want.seg_id = 305 - 256;
+	ck_assert_int_eq(wal_archive_find_range(info, &want), -1);
+	ck_assert_int_eq(wal_archive_find(info, &want), -1);
+	want = (WALSegmentName) { 1, 2, 599 - 512 };
+	ck_assert_int_eq(wal_archive_find(info, &want), 577);
+	want = (WALSegmentName) { 2, 0, 0x1F };
+	ck_assert_int_eq(wal_archive_find(info, &want), nfiles - 1);
+	want.timeline = 3;
+	ck_assert_int_eq(wal_archive_find(info, &want), -1);
+
+	free_wal_archive_info(info);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/* Write dir/NNNNNNNN.history with the given content */
+static void
+write_history(const char *dir, uint32_t tli, const char *content)
+{
+	char  path[PATH_MAX];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%08X.history", dir, tli);
+	fp = fopen(path, "w");
+	ck_assert_ptr_nonnull(fp);
+	fputs(content, fp);
+	fclose(fp);
+}
+
+START_TEST(test_scan_wal_timelines)
+{
+	char        dir[64];
+	char        path[PATH_MAX];
+	char        cmd[PATH_MAX];
+	XLogRecPtr  lsn = 0;
+	const WALTimeline *tl;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_wal_tli_%d", (int)getpid());
+	mkdir(dir, 0755);
+
+	/* 1 -> 2 -> 3, and 2 -> 4 -> 5 with no history file of its own for 4 */
+	write_history(dir, 2, "1\t0/5000000\tno recovery target specified\n");
+	write_history(dir, 3, "# comment\n1\t0/5000000\treason\n2\t0/9000000\treason\n");
+	write_history(dir, 5, "1\t0/5000000\ta\n2\t0/9000000\tb\n4\t0/A000000\tc\n");
+	snprintf(path, sizeof(path), "%s/000000010000000000000001", dir);
+	fclose(fopen(path, "w"));
+
+	WALArchiveInfo *info = scan_wal_archive(dir);
+	ck_assert_ptr_nonnull(info);
+	ck_assert_int_eq(info->segment_count, 1);
+	ck_assert_ptr_nonnull(info->timelines);
+	ck_assert_int_eq(info->timeline_count, 5);
+
+	tl = wal_timelines_find(info->timelines, info->timeline_count, 1);
+	ck_assert_ptr_nonnull(tl);
+	ck_assert_uint_eq(tl->parent, 0);
+	ck_assert(!tl->has_history);
+	tl = wal_timelines_find(info->timelines, info->timeline_count, 3);
+	ck_assert_uint_eq(tl->parent, 2);
+	ck_assert_uint_eq(tl->switch_lsn, 0x9000000);
+	ck_assert(tl->has_history);
+	tl = wal_timelines_find(info->timelines, info->timeline_count, 4);
+	ck_assert_uint_eq(tl->parent, 2);
+	ck_assert(!tl->has_history);
+	ck_assert_ptr_null(wal_timelines_find(info->timelines, info->timeline_count, 6));
+
+	/* Ancestors are found by walking up: 5 -> 4 -> 2 -> 1 */
+	ck_assert(wal_timelines_switchpoint(info->timelines, info->timeline_count,
+										5, 1, &lsn));
+	ck_assert_uint_eq(lsn, 0x5000000);
+	ck_assert(wal_timelines_switchpoint(info->timelines, info->timeline_count,
+										5, 4, &lsn));
+	ck_assert_uint_eq(lsn, 0xA000000);
+	ck_assert(!wal_timelines_switchpoint(info->timelines, info->timeline_count,
+										 5, 3, &lsn));
+	ck_assert(!wal_timelines_switchpoint(info->timelines, info->timeline_count,
+										 1, 1, &lsn));
+
+	free_wal_archive_info(info);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
 /*
  * scan_wal_archive() on the real archive finds expected segments.
  */
@@ -196,6 +661,13 @@ fs_scanner_suite(void)
 	tcase_add_test(tc_unit, test_scan_nonexistent_dir);
 	tcase_add_test(tc_unit, test_scan_empty_dir);
 	tcase_add_test(tc_unit, test_free_null_list);
+	tcase_add_test(tc_unit, test_scan_parallel_order);
+	tcase_add_test(tc_unit, test_scan_prunes_backups);
+	tcase_add_test(tc_unit, test_scan_links_incrementals);
+	tcase_add_test(tc_unit, test_scan_wal_compressed_names);
+	tcase_add_test(tc_unit, test_scan_wal_inventory);
+	tcase_add_test(tc_unit, test_scan_wal_ranges);
+	tcase_add_test(tc_unit, test_scan_wal_timelines);
 	suite_add_tcase(s, tc_unit);
 
 	TCase *tc_int = tcase_create("Integration");
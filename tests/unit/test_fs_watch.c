@@ -0,0 +1,158 @@
+/*
+ * test_fs_watch.c
+ *
+ * Unit tests for directory change notification
+ * (src/common/fs_watch.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pg_backup_auditor.h"
+#include "fs_watch.h"
+
+static char test_dir[PATH_MAX];
+
+static void
+setup(void)
+{
+	snprintf(test_dir, sizeof(test_dir), "/tmp/pg_fs_watch_%d", (int) getpid());
+	mkdir(test_dir, 0755);
+}
+
+static void
+teardown(void)
+{
+	char cmd[PATH_MAX + 16];
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", test_dir);
+	system(cmd);
+}
+
+static bool
+reported(const FsWatch *w, int n, const char *path)
+{
+	for (int i = 0; i < n; i++)
+		if (strcmp(fs_watch_changed(w, i), path) == 0)
+			return true;
+	return false;
+}
+
+/* The polling fallback sees one-second modification times */
+static void
+next_second(void)
+{
+	if (strcmp(fs_watch_backend(), "poll") == 0)
+		sleep(1);
+}
+
+static void
+touch(const char *dir, const char *name)
+{
+	char  path[PATH_MAX];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	fp = fopen(path, "w");
+	ck_assert_ptr_nonnull(fp);
+	fputs("x", fp);
+	fclose(fp);
+}
+
+/* Writes are reported against their directory; new subdirectories are watched */
+START_TEST(test_fs_watch_tree)
+{
+	char     sub[PATH_MAX];
+	char     deep[PATH_MAX];
+	FsWatch *w = fs_watch_open(NULL, NULL);
+	int      n;
+
+	ck_assert_ptr_nonnull(w);
+	ck_assert(fs_watch_add_tree(w, test_dir, 2));
+	ck_assert_int_eq(fs_watch_count(w), 1);
+	ck_assert_int_eq(fs_watch_wait(w, 0), 0);
+
+	next_second();
+	snprintf(sub, sizeof(sub), "%s/backup1", test_dir);
+	ck_assert_int_eq(mkdir(sub, 0755), 0);
+	n = fs_watch_wait(w, 3000);
+	ck_assert_int_ge(n, 1);
+	ck_assert(reported(w, n, test_dir));
+	ck_assert_int_eq(fs_watch_count(w), 2);
+
+	next_second();
+	touch(sub, "backup.control");
+	n = fs_watch_wait(w, 3000);
+	ck_assert_int_ge(n, 1);
+	ck_assert(reported(w, n, sub));
+	ck_assert(!reported(w, n, test_dir));
+
+	/* Below max_depth nothing is watched */
+	next_second();
+	snprintf(deep, sizeof(deep), "%s/database", sub);
+	ck_assert_int_eq(mkdir(deep, 0755), 0);
+	n = fs_watch_wait(w, 3000);
+	ck_assert_int_ge(n, 1);
+	ck_assert_int_eq(fs_watch_count(w), 3);
+	next_second();
+	snprintf(deep, sizeof(deep), "%s/database/base", sub);
+	ck_assert_int_eq(mkdir(deep, 0755), 0);
+	fs_watch_wait(w, 1000);
+	ck_assert_int_eq(fs_watch_count(w), 3);
+
+	fs_watch_close(w);
+}
+END_TEST
+
+/* The descend callback keeps the watch out of a directory's children */
+static bool
+no_backup_dirs(const char *path, void *arg)
+{
+	(void) arg;
+	return strstr(path, "/backup") == NULL;
+}
+
+START_TEST(test_fs_watch_descend)
+{
+	char     sub[PATH_MAX];
+	FsWatch *w;
+
+	snprintf(sub, sizeof(sub), "%s/backup1", test_dir);
+	mkdir(sub, 0755);
+	snprintf(sub, sizeof(sub), "%s/backup1/database", test_dir);
+	mkdir(sub, 0755);
+	snprintf(sub, sizeof(sub), "%s/wal", test_dir);
+	mkdir(sub, 0755);
+
+	w = fs_watch_open(no_backup_dirs, NULL);
+	ck_assert_ptr_nonnull(w);
+	ck_assert(fs_watch_add_tree(w, test_dir, 3));
+	ck_assert_int_eq(fs_watch_count(w), 3);     /* root, backup1, wal */
+	ck_assert(!fs_watch_add_tree(w, "/nonexistent/dir", 1));
+	fs_watch_close(w);
+}
+END_TEST
+
+Suite *
+fs_watch_suite(void)
+{
+	Suite *s = suite_create("fs_watch");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_set_timeout(tc, 30);
+	tcase_add_test(tc, test_fs_watch_tree);
+	tcase_add_test(tc, test_fs_watch_descend);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
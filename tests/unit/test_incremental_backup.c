@@ -0,0 +1,476 @@
+/*
+ * test_incremental_backup.c
+ *
+ * Unit tests for the INCREMENTAL.* file and WAL summary checks of
+ * PostgreSQL 17+ incremental backups
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "pg_backup_auditor.h"
+#include "incremental_backup.h"
+#include "page_checksum.h"
+#include "validation_result.h"
+#include "crc32c.h"
+#include "sha256.h"
+
+static char test_dir[PATH_MAX];
+
+static void
+setup(void)
+{
+	snprintf(test_dir, sizeof(test_dir), "/tmp/pg_incremental_test_%d", getpid());
+	mkdir(test_dir, 0755);
+	validation_set_wal_summaries_dir(NULL);
+}
+
+static void
+teardown(void)
+{
+	char cmd[PATH_MAX + 16];
+
+	validation_set_wal_summaries_dir(NULL);
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", test_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+static size_t
+put_u32(uint8_t *p, uint32_t v)
+{
+	memcpy(p, &v, sizeof(v));
+	return sizeof(v);
+}
+
+/*
+ * An incremental file with the given block numbers, as the server writes
+ * it: header padded to BLCKSZ when there are blocks, then the blocks.
+ * Returns its length; the caller frees *out.
+ */
+static size_t
+make_incremental(const uint32_t *blocks, uint32_t n, uint32_t truncation,
+				 uint8_t **out)
+{
+	size_t   header = (3 + (size_t) n) * sizeof(uint32_t);
+	size_t   len;
+	uint8_t *buf;
+	size_t   pos = 0;
+
+	if (n > 0 && header % PAGE_BLCKSZ != 0)
+		header += PAGE_BLCKSZ - header % PAGE_BLCKSZ;
+	len = header + (size_t) n * PAGE_BLCKSZ;
+	buf = calloc(1, len);
+	ck_assert_ptr_nonnull(buf);
+
+	pos += put_u32(buf + pos, INCREMENTAL_MAGIC);
+	pos += put_u32(buf + pos, n);
+	pos += put_u32(buf + pos, truncation);
+	for (uint32_t i = 0; i < n; i++)
+		pos += put_u32(buf + pos, blocks[i]);
+	for (uint32_t i = 0; i < n; i++)
+		memset(buf + header + (size_t) i * PAGE_BLCKSZ, (int) (i + 1), PAGE_BLCKSZ);
+
+	*out = buf;
+	return len;
+}
+
+/* Walk 'len' bytes in chunks of 'step' */
+static bool
+walk_incremental(const uint8_t *buf, size_t len, size_t step, IncrementalWalk *walk)
+{
+	incremental_walk_init(walk);
+	for (size_t off = 0; off < len; off += step)
+		incremental_walk_update(walk, buf + off, len - off < step ? len - off : step);
+	return incremental_walk_finish(walk);
+}
+
+START_TEST(test_incremental_walk_valid)
+{
+	uint32_t        blocks[] = { 3, 7, 130000 };
+	uint8_t        *buf;
+	size_t          len = make_incremental(blocks, 3, 131072, &buf);
+	IncrementalWalk walk;
+
+	ck_assert_uint_eq(len, PAGE_BLCKSZ * 4);
+	ck_assert(walk_incremental(buf, len, len, &walk));
+	ck_assert_uint_eq(walk.num_blocks, 3);
+	ck_assert_uint_eq(walk.truncation_block_length, 131072);
+	/* Fields split across reads are reassembled */
+	ck_assert(walk_incremental(buf, len, 1, &walk));
+	ck_assert(walk_incremental(buf, len, 5, &walk));
+	free(buf);
+
+	/* A file that only records a truncation is the bare header */
+	len = make_incremental(NULL, 0, 12, &buf);
+	ck_assert_uint_eq(len, 12);
+	ck_assert(walk_incremental(buf, len, 7, &walk));
+	free(buf);
+
+	ck_assert(incremental_file_name("base/5/INCREMENTAL.16384"));
+	ck_assert(incremental_file_name("INCREMENTAL.16384_vm"));
+	ck_assert(!incremental_file_name("base/5/16384"));
+	ck_assert(!incremental_file_name("base/INCREMENTAL./16384"));
+	ck_assert(!incremental_file_name("base/5/INCREMENTAL."));
+}
+END_TEST
+
+START_TEST(test_incremental_walk_invalid)
+{
+	uint32_t        blocks[] = { 3, 7 };
+	uint32_t        unsorted[] = { 7, 3 };
+	uint32_t        beyond[] = { 131072 };
+	uint8_t        *buf;
+	size_t          len;
+	IncrementalWalk walk;
+
+	len = make_incremental(blocks, 2, 8, &buf);
+	buf[0] ^= 0xFF;
+	ck_assert(!walk_incremental(buf, len, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "bad magic number"));
+	buf[0] ^= 0xFF;
+
+	/* Truncated data, trailing bytes, truncated header */
+	ck_assert(!walk_incremental(buf, len - 1, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "describes 2 blocks"));
+	ck_assert(!walk_incremental(buf, PAGE_BLCKSZ, len, &walk));
+	ck_assert(!walk_incremental(buf, 14, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "header truncated"));
+	free(buf);
+
+	len = make_incremental(unsorted, 2, 8, &buf);
+	ck_assert(!walk_incremental(buf, len, 3, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "block number 3 does not follow 7"));
+	free(buf);
+
+	len = make_incremental(beyond, 1, 8, &buf);
+	ck_assert(!walk_incremental(buf, len, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "out of range"));
+	free(buf);
+
+	len = make_incremental(NULL, 0, 131073, &buf);
+	ck_assert(!walk_incremental(buf, len, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "truncation block length"));
+	put_u32(buf + 4, 131073);
+	ck_assert(!walk_incremental(buf, len, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "block count 131073"));
+	free(buf);
+}
+END_TEST
+
+/*
+ * A summary with two relations: one with a chunk of 'usage' offsets and
+ * an empty chunk, one with no chunks.  Returns its length.
+ */
+static size_t
+make_summary(uint8_t *buf, uint16_t usage)
+{
+	size_t   pos = 0;
+	uint16_t u16;
+	uint32_t crc;
+
+	pos += put_u32(buf + pos, WAL_SUMMARY_MAGIC);
+	/* spcOid, dbOid, relNumber, forknum, limit_block, nchunks */
+	pos += put_u32(buf + pos, 1663);
+	pos += put_u32(buf + pos, 5);
+	pos += put_u32(buf + pos, 16384);
+	pos += put_u32(buf + pos, 0);
+	pos += put_u32(buf + pos, 0xFFFFFFFF);
+	pos += put_u32(buf + pos, 2);
+	memcpy(buf + pos, &usage, sizeof(usage));
+	pos += sizeof(usage);
+	u16 = 0;
+	memcpy(buf + pos, &u16, sizeof(u16));
+	pos += sizeof(u16);
+	for (uint16_t i = 0; i < usage; i++)
+	{
+		u16 = (uint16_t) (i * 3);
+		memcpy(buf + pos, &u16, sizeof(u16));
+		pos += sizeof(u16);
+	}
+
+	pos += put_u32(buf + pos, 1663);
+	pos += put_u32(buf + pos, 5);
+	pos += put_u32(buf + pos, 16390);
+	pos += put_u32(buf + pos, 1);
+	pos += put_u32(buf + pos, 0);
+	pos += put_u32(buf + pos, 0);
+
+	memset(buf + pos, 0, 24);
+	pos += 24;
+	crc = ~crc32c_update(~0U, buf, pos);
+	pos += put_u32(buf + pos, crc);
+	return pos;
+}
+
+static bool
+walk_summary(const uint8_t *buf, size_t len, size_t step, WALSummaryWalk *walk)
+{
+	wal_summary_walk_init(walk);
+	for (size_t off = 0; off < len; off += step)
+		wal_summary_walk_update(walk, buf + off, len - off < step ? len - off : step);
+	return wal_summary_walk_finish(walk);
+}
+
+START_TEST(test_wal_summary_walk)
+{
+	uint8_t        buf[512];
+	size_t         len = make_summary(buf, 3);
+	WALSummaryWalk walk;
+
+	ck_assert(walk_summary(buf, len, len, &walk));
+	ck_assert_uint_eq(walk.relations, 2);
+	ck_assert(walk_summary(buf, len, 1, &walk));
+	ck_assert(walk_summary(buf, len, 7, &walk));
+
+	/* A flipped bit in a chunk is only seen by the CRC */
+	buf[34] ^= 0x01;
+	ck_assert(!walk_summary(buf, len, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "CRC32C mismatch"));
+	buf[34] ^= 0x01;
+
+	ck_assert(!walk_summary(buf, len - 1, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "truncated"));
+	buf[len] = 0;
+	ck_assert(!walk_summary(buf, len + 1, 5, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "data after the checksum"));
+
+	len = make_summary(buf, 0);
+	ck_assert(walk_summary(buf, len, 3, &walk));
+	put_u32(buf + 16, 9);
+	ck_assert(!walk_summary(buf, len, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "invalid fork number 9"));
+	put_u32(buf + 16, 0);
+	put_u32(buf, 0);
+	ck_assert(!walk_summary(buf, len, len, &walk));
+	ck_assert_ptr_nonnull(strstr(walk.problem, "bad magic number"));
+}
+END_TEST
+
+START_TEST(test_wal_summary_file_name)
+{
+	WALSummaryRange range;
+
+	ck_assert(wal_summary_file_name("0000000100000000010000280000000001000120.summary", &range));
+	ck_assert_uint_eq(range.timeline, 1);
+	ck_assert_uint_eq(range.start_lsn, 0x1000028ULL);
+	ck_assert_uint_eq(range.end_lsn, 0x1000120ULL);
+	ck_assert(wal_summary_file_name("00000002000000010000000000000001FFFFFFFF.summary", &range));
+	ck_assert_uint_eq(range.timeline, 2);
+	ck_assert_uint_eq(range.start_lsn, 0x100000000ULL);
+
+	ck_assert(!wal_summary_file_name("0000000100000000010000280000000001000120.tmp", &range));
+	ck_assert(!wal_summary_file_name("000000010000000001000028000000000100012.summary", &range));
+	ck_assert(!wal_summary_file_name("000000010000000001000028000000000100012G.summary", &range));
+	/* Ends before it starts */
+	ck_assert(!wal_summary_file_name("0000000100000000020000000000000001000000.summary", &range));
+}
+END_TEST
+
+static void
+write_bytes(const char *path, const uint8_t *buf, size_t len)
+{
+	FILE *fp = fopen(path, "w");
+
+	ck_assert_ptr_nonnull(fp);
+	ck_assert_uint_eq(fwrite(buf, 1, len, fp), len);
+	fclose(fp);
+}
+
+/* A backup_manifest listing 'rel_path' of 'size' bytes, without checksums */
+static void
+write_manifest(const char *bdir, const char *rel_path, size_t size)
+{
+	char      path[PATH_MAX];
+	char      body[1024];
+	int       body_len;
+	SHA256Ctx ctx;
+	uint8_t   digest[SHA256_DIGEST_LENGTH];
+	char      hex[SHA256_HEX_LENGTH + 1];
+	FILE     *fp;
+
+	body_len = snprintf(body, sizeof(body),
+		"{ \"PostgreSQL-Backup-Manifest-Version\": 2,\n"
+		"\"Files\": [\n"
+		"{ \"Path\": \"%s\", \"Size\": %zu, \"Checksum-Algorithm\": \"NONE\" }\n"
+		"],\n"
+		"\"WAL-Ranges\": [],\n",
+		rel_path, size);
+	sha256_init(&ctx);
+	sha256_update(&ctx, body, (size_t) body_len);
+	sha256_final(&ctx, digest);
+	sha256_to_hex(digest, hex);
+
+	snprintf(path, sizeof(path), "%s/backup_manifest", bdir);
+	fp = fopen(path, "w");
+	ck_assert_ptr_nonnull(fp);
+	fputs(body, fp);
+	fprintf(fp, "\"Manifest-Checksum\": \"%s\"}\n", hex);
+	fclose(fp);
+}
+
+static BackupInfo
+make_incremental_backup(void)
+{
+	BackupInfo bi;
+
+	memset(&bi, 0, sizeof(bi));
+	str_copy(bi.backup_id, "INCR0001", sizeof(bi.backup_id));
+	str_copy(bi.backup_path, test_dir, sizeof(bi.backup_path));
+	bi.type = BACKUP_TYPE_INCREMENTAL;
+	bi.tool = BACKUP_TOOL_PG_BASEBACKUP;
+	bi.status = BACKUP_STATUS_OK;
+	bi.timeline = 1;
+	bi.redo_lsn = 0x1000028ULL;     /* INCREMENTAL FROM LSN */
+	bi.start_lsn = 0x3000028ULL;
+	bi.stop_lsn = 0x3000100ULL;
+	return bi;
+}
+
+static bool
+has_message(char **messages, int count, const char *text)
+{
+	for (int i = 0; i < count; i++)
+		if (strstr(messages[i], text) != NULL)
+			return true;
+	return false;
+}
+
+/* A damaged header is found even when the manifest has no checksums */
+START_TEST(test_incremental_manifest_files)
+{
+	uint32_t          blocks[] = { 2 };
+	uint8_t          *buf;
+	size_t            len = make_incremental(blocks, 1, 4, &buf);
+	char              path[PATH_MAX];
+	BackupInfo        bi = make_incremental_backup();
+	ValidationResult *res;
+
+	snprintf(path, sizeof(path), "%s/base", test_dir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/base/INCREMENTAL.16384", test_dir);
+	write_bytes(path, buf, len);
+	write_manifest(test_dir, "base/INCREMENTAL.16384", len);
+
+	res = check_manifest_checksums(&bi);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 0);
+	free_validation_result(res);
+
+	/* Same size, but the block it names is beyond the segment */
+	put_u32(buf + 12, 200000);
+	write_bytes(path, buf, len);
+	res = check_manifest_checksums(&bi);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 1);
+	ck_assert(has_message(res->errors, res->error_count,
+						  "Invalid incremental file base/INCREMENTAL.16384: block number 200000 out of range"));
+	free_validation_result(res);
+	free(buf);
+}
+END_TEST
+
+static void
+write_summary(const char *dir, const char *name, bool corrupt)
+{
+	uint8_t buf[512];
+	size_t  len = make_summary(buf, 2);
+	char    path[PATH_MAX];
+
+	if (corrupt)
+		buf[len - 1] ^= 0xFF;
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	write_bytes(path, buf, len);
+}
+
+/* Summaries must cover the parent's start to this backup's start */
+START_TEST(test_incremental_wal_summaries)
+{
+	char              summaries[PATH_MAX];
+	char              server[PATH_MAX];
+	char              path[PATH_MAX];
+	BackupInfo        bi = make_incremental_backup();
+	ValidationResult *res;
+
+	snprintf(path, sizeof(path), "%s/base", test_dir);
+	mkdir(path, 0755);
+	write_manifest(test_dir, "base/PG_VERSION", 0);
+
+	/* No summaries anywhere: nothing to say */
+	res = check_manifest_checksums(&bi);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 0);
+	ck_assert_int_eq(res->warning_count, 0);
+	free_validation_result(res);
+
+	/* 0/1000028..0/2000000 and 0/2000000..0/2800000: short of 0/3000028 */
+	snprintf(server, sizeof(server), "%s/server", test_dir);
+	mkdir(server, 0755);
+	write_summary(server, "0000000100000000010000000000000002000000.summary", false);
+	write_summary(server, "0000000100000000020000000000000002800000.summary", false);
+	/* Another timeline's summaries do not count */
+	write_summary(server, "0000000200000000028000000000000004000000.summary", false);
+	validation_set_wal_summaries_dir(server);
+	res = check_manifest_checksums(&bi);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 0);
+	ck_assert_int_eq(res->warning_count, 1);
+	ck_assert(has_message(res->warnings, res->warning_count,
+						  "cover 0/1000028..0/3000028 only up to 0/2800000"));
+	free_validation_result(res);
+
+	write_summary(server, "0000000100000000028000000000000003000100.summary", false);
+	res = check_manifest_checksums(&bi);
+	ck_assert_int_eq(res->error_count, 0);
+	ck_assert_int_eq(res->warning_count, 0);
+	free_validation_result(res);
+
+	/* The backup's own pg_wal/summaries come first; a damaged one is an error */
+	snprintf(summaries, sizeof(summaries), "%s/pg_wal", test_dir);
+	mkdir(summaries, 0755);
+	snprintf(summaries, sizeof(summaries), "%s/pg_wal/summaries", test_dir);
+	mkdir(summaries, 0755);
+	write_summary(summaries, "0000000100000000010000000000000004000000.summary", true);
+	res = check_manifest_checksums(&bi);
+	ck_assert_int_eq(res->error_count, 1);
+	ck_assert(has_message(res->errors, res->error_count, "CRC32C mismatch"));
+	ck_assert_int_eq(res->warning_count, 1);
+	free_validation_result(res);
+}
+END_TEST
+
+Suite *
+incremental_backup_suite(void)
+{
+	Suite *s = suite_create("incremental_backup");
+	TCase *tc = tcase_create("core");
+
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_incremental_walk_valid);
+	tcase_add_test(tc, test_incremental_walk_invalid);
+	tcase_add_test(tc, test_wal_summary_walk);
+	tcase_add_test(tc, test_wal_summary_file_name);
+	tcase_add_test(tc, test_incremental_manifest_files);
+	tcase_add_test(tc, test_incremental_wal_summaries);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
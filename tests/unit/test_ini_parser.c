@@ -253,6 +253,132 @@ START_TEST(test_ini_parse_whitespace)
 }
 END_TEST
 
+/* Test a manifest-sized section: hashed lookup, file order, first key wins */
+START_TEST(test_ini_parse_many_keys)
+{
+	IniFile *ini;
+	IniSection *section;
+	IniKeyValue *kv;
+	const char *value;
+	char key[64];
+	FILE *fp;
+	int i;
+	const char *test_file = "/tmp/test_ini_many.ini";
+
+	fp = fopen(test_file, "w");
+	ck_assert_ptr_nonnull(fp);
+	fprintf(fp, "[target:file]\n");
+	for (i = 0; i < 5000; i++)
+		fprintf(fp, "pg_data/base/1/%d={\"size\":%d}\n", i, i);
+	fprintf(fp, "pg_data/base/1/7=duplicate\n");
+	fprintf(fp, "[backup]\n");
+	fprintf(fp, "backup-label=\"20260108-100000F\"\n");
+	fprintf(fp, "[target:file]\n");
+	fprintf(fp, "pg_data/base/1/9=second section\n");
+	fclose(fp);
+
+	ini = ini_parse_file(test_file);
+	ck_assert_ptr_nonnull(ini);
+
+	for (i = 0; i < 5000; i += 499)
+	{
+		char expected[32];
+
+		snprintf(key, sizeof(key), "pg_data/base/1/%d", i);
+		snprintf(expected, sizeof(expected), "{\"size\":%d}", i);
+		value = ini_get_value(ini, "target:file", key);
+		ck_assert_ptr_nonnull(value);
+		ck_assert_str_eq(value, expected);
+	}
+
+	/* The first occurrence of a key or section is the one found */
+	ck_assert_str_eq(ini_get_value(ini, "target:file", "pg_data/base/1/7"), "{\"size\":7}");
+	ck_assert_str_eq(ini_get_value(ini, "target:file", "pg_data/base/1/9"), "{\"size\":9}");
+	ck_assert_str_eq(ini_get_value(ini, "backup", "backup-label"), "20260108-100000F");
+	ck_assert_ptr_null(ini_get_value(ini, "target:file", "pg_data/base/1/5000"));
+
+	/* Iteration still sees every entry in file order */
+	section = ini_get_section(ini, "target:file");
+	ck_assert_ptr_eq(section, ini->first_section);
+	ck_assert_int_eq(section->kv_count, 5001);
+	i = 0;
+	for (kv = section->first_kv; kv != NULL; kv = kv->next, i++)
+	{
+		if (i < 5000)
+		{
+			snprintf(key, sizeof(key), "pg_data/base/1/%d", i);
+			ck_assert_str_eq(kv->key, key);
+		}
+	}
+	ck_assert_int_eq(i, 5001);
+	ck_assert_str_eq(section->last_kv->value, "duplicate");
+	ck_assert_ptr_nonnull(section->next->next);
+	ck_assert_str_eq(section->next->next->first_kv->value, "second section");
+
+	ini_free(ini);
+	unlink(test_file);
+}
+END_TEST
+
+/* Collects what ini_parse_stream() reports */
+typedef struct {
+	int  count;
+	int  stop_after;
+	char seen[8][64];
+} StreamLog;
+
+static bool
+stream_collect(IniSlice section, IniSlice key, IniSlice value, void *arg)
+{
+	StreamLog *log = arg;
+
+	ck_assert_uint_eq(strlen(section.ptr), section.len);
+	ck_assert_uint_eq(strlen(value.ptr), value.len);
+	if (log->count < 8)
+		snprintf(log->seen[log->count], sizeof(log->seen[0]), "%s/%.*s=%s",
+				 section.ptr, (int) key.len, key.ptr, value.ptr);
+	log->count++;
+	return log->count != log->stop_after;
+}
+
+/* Test streaming: every key in file order, same rules as the tree parser */
+START_TEST(test_ini_parse_stream)
+{
+	StreamLog log;
+	FILE *fp;
+	const char *test_file = "/tmp/test_ini_stream.ini";
+
+	fp = fopen(test_file, "w");
+	ck_assert_ptr_nonnull(fp);
+	fprintf(fp, "orphan=ignored\n");
+	fprintf(fp, "[backup]\n");
+	fprintf(fp, "; comment\n");
+	fprintf(fp, "  backup-label = \"20260108-100000F\"  \n");
+	fprintf(fp, "[target:file]\n");
+	fprintf(fp, "pg_data/PG_VERSION={\"checksum\":\"ab\",\"size\":3}\n");
+	fprintf(fp, "pg_data/PG_VERSION=again\n");
+	fprintf(fp, "not a pair\n");
+	fclose(fp);
+
+	memset(&log, 0, sizeof(log));
+	ck_assert(ini_parse_stream(test_file, stream_collect, &log));
+	ck_assert_int_eq(log.count, 3);
+	ck_assert_str_eq(log.seen[0], "backup/backup-label=20260108-100000F");
+	ck_assert_str_eq(log.seen[1], "target:file/pg_data/PG_VERSION={\"checksum\":\"ab\",\"size\":3}");
+	ck_assert_str_eq(log.seen[2], "target:file/pg_data/PG_VERSION=again");
+
+	/* The callback can stop the pass */
+	memset(&log, 0, sizeof(log));
+	log.stop_after = 1;
+	ck_assert(ini_parse_stream(test_file, stream_collect, &log));
+	ck_assert_int_eq(log.count, 1);
+
+	ck_assert(!ini_parse_stream("/nonexistent/test.ini", stream_collect, &log));
+
+	unlink(test_file);
+}
+END_TEST
+
 Suite *ini_parser_suite(void)
 {
 	Suite *s;
@@ -267,6 +393,8 @@ Suite *ini_parser_suite(void)
 	tcase_add_test(tc_core, test_ini_get_int);
 	tcase_add_test(tc_core, test_ini_get_bool);
 	tcase_add_test(tc_core, test_ini_parse_whitespace);
+	tcase_add_test(tc_core, test_ini_parse_many_keys);
+	tcase_add_test(tc_core, test_ini_parse_stream);
 
 	suite_add_tcase(s, tc_core);
 
@@ -0,0 +1,130 @@
+/*
+ * test_json_scan.c
+ *
+ * Unit tests for the single-pass JSON field scanner
+ * (src/common/json_scan.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_scan.h"
+
+/* A backup_content.control line: every wanted key in one pass */
+START_TEST(test_json_get_fields_line)
+{
+	static const char *const keys[] = { "kind", "path", "size", "crc", "absent" };
+	const char *line =
+		"{\"path\":\"base/1/1259\", \"size\":\"8192\", \"kind\":\"reg\", "
+		"\"mode\":33152, \"is_datafile\":\"1\", \"crc\":\"3484925488\", "
+		"\"nested\":{\"kind\":\"dir\",\"list\":[1,\"]\",{}]}}\n";
+	JsonSlice   v[5];
+	char        buf[8];
+	uint64_t    n = 0;
+
+	ck_assert(json_get_fields(line, keys, 5, v));
+	ck_assert(json_slice_eq(v[0], "reg"));
+	ck_assert(json_slice_eq(v[1], "base/1/1259"));
+	ck_assert(json_slice_to_uint64(v[2], &n));
+	ck_assert_uint_eq(n, 8192);
+	ck_assert(json_slice_eq(v[3], "3484925488"));
+	ck_assert_ptr_null(v[4].ptr);
+	ck_assert(!json_slice_copy(v[4], buf, sizeof(buf)));
+
+	/* Copies truncate to the buffer */
+	ck_assert(json_slice_copy(v[1], buf, sizeof(buf)));
+	ck_assert_str_eq(buf, "base/1/");
+}
+END_TEST
+
+/* Scalars, nulls and nested values; keys must match exactly */
+START_TEST(test_json_get_fields_values)
+{
+	static const char *const keys[] = {
+		"backup-prior", "backup-timestamp-start", "backup-info", "checksum"
+	};
+	const char *json =
+		"{\"backup-prior\":null,\"backup-timestamp-start\":1700000000,"
+		"\"backup-info\":{\"a\":1},\"checksum-page\":true}";
+	JsonSlice   v[4];
+	uint64_t    n = 0;
+
+	ck_assert(json_get_fields(json, keys, 4, v));
+	ck_assert(json_slice_eq(v[0], "null"));
+	ck_assert(json_slice_to_uint64(v[1], &n));
+	ck_assert_uint_eq(n, 1700000000);
+	ck_assert(json_slice_eq(v[2], "{\"a\":1}"));
+	ck_assert_ptr_null(v[3].ptr);
+	ck_assert(!json_slice_to_uint64(v[0], &n));
+	ck_assert(json_slice_case_eq(v[0], "NULL"));
+}
+END_TEST
+
+/* Escaped quotes inside strings; malformed input is refused */
+START_TEST(test_json_scan_malformed)
+{
+	static const char *const keys[] = { "path" };
+	JsonSlice   v[1];
+	JsonCursor  c;
+	const char *two = "{\"path\":\"a\\\\\"} {\"path\":\"b\\\"c\"}";
+
+	c.p = two;
+	c.end = two + strlen(two);
+	ck_assert(json_scan_object(&c, keys, 1, v));
+	ck_assert(json_slice_eq(v[0], "a\\\\"));
+	ck_assert(json_scan_object(&c, keys, 1, v));
+	ck_assert(json_slice_eq(v[0], "b\\\"c"));
+	ck_assert_int_eq(json_peek(&c), '\0');
+
+	ck_assert(!json_get_fields("{\"path\":\"unterminated}", keys, 1, v));
+	ck_assert(!json_get_fields("{\"path\" \"x\"}", keys, 1, v));
+	ck_assert(!json_get_fields("\"path\":\"x\"", keys, 1, v));
+	ck_assert(!json_get_fields(NULL, keys, 1, v));
+}
+END_TEST
+
+/* Escapes are decoded, \u to UTF-8; truncation keeps characters whole */
+START_TEST(test_json_slice_unescape)
+{
+	static const char *const keys[] = { "m" };
+	JsonSlice   v[1];
+	char        buf[64];
+
+	ck_assert(json_get_fields("{\"m\":\"a\\\"b\\\\c\\/d\\n\\t\\u0001\\u00e9\\u20ac"
+							  "\\ud83d\\ude00\"}", keys, 1, v));
+	ck_assert(json_slice_unescape(v[0], buf, sizeof(buf)));
+	ck_assert_str_eq(buf, "a\"b\\c/d\n\t\x01\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+
+	/* The euro sign does not fit in the last two bytes */
+	ck_assert(json_slice_unescape(v[0], buf, 13));
+	ck_assert_str_eq(buf, "a\"b\\c/d\n\t\x01\xc3\xa9");
+
+	ck_assert(json_get_fields("{\"m\":\"\\ud83d\"}", keys, 1, v));
+	ck_assert(!json_slice_unescape(v[0], buf, sizeof(buf)));
+	ck_assert(json_get_fields("{\"m\":\"\\x\"}", keys, 1, v));
+	ck_assert(!json_slice_unescape(v[0], buf, sizeof(buf)));
+	ck_assert(json_get_fields("{\"m\":\"\\u12\"}", keys, 1, v));
+	ck_assert(!json_slice_unescape(v[0], buf, sizeof(buf)));
+}
+END_TEST
+
+Suite *
+json_scan_suite(void)
+{
+	Suite *s = suite_create("json_scan");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_json_get_fields_line);
+	tcase_add_test(tc, test_json_get_fields_values);
+	tcase_add_test(tc, test_json_scan_malformed);
+	tcase_add_test(tc, test_json_slice_unescape);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,151 @@
+/*
+ * test_logging.c
+ *
+ * Unit tests for the logging backend (src/common/logging.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pg_backup_auditor.h"
+
+#define LOG_THREADS     4
+#define LOG_LINES       2000
+
+static void *
+log_worker(void *arg)
+{
+	int id = (int) (intptr_t) arg;
+
+	for (int i = 0; i < LOG_LINES; i++)
+		log_debug("worker %d line %d %s", id, i,
+				  "padding padding padding padding padding padding");
+	return NULL;
+}
+
+/* Count of 'path's lines, each checked to be one whole message */
+static int
+count_lines(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	char  line[8192];
+	int   n = 0;
+
+	ck_assert_ptr_nonnull(fp);
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		int id, i;
+
+		ck_assert_msg(sscanf(line, "[%*[0-9: -]] [DEBUG] worker %d line %d padding", &id, &i) == 2,
+					  "torn line: %s", line);
+		ck_assert(strstr(line, "padding padding padding padding padding padding\n") != NULL);
+		n++;
+	}
+	fclose(fp);
+	return n;
+}
+
+/* Lines from parallel threads come out whole, synchronously and through the writer */
+START_TEST(test_logging_parallel_lines)
+{
+	char      path[64];
+	pthread_t threads[LOG_THREADS];
+
+	for (int async = 0; async <= 1; async++)
+	{
+		snprintf(path, sizeof(path), "/tmp/pg_logging_%d_%d.log", (int) getpid(), async);
+		unlink(path);
+		ck_assert(log_set_file(path));
+		log_set_level(LOG_DEBUG);
+		if (async)
+			ck_assert(log_set_async(true));
+
+		for (int t = 0; t < LOG_THREADS; t++)
+			ck_assert_int_eq(pthread_create(&threads[t], NULL, log_worker,
+											(void *) (intptr_t) t), 0);
+		for (int t = 0; t < LOG_THREADS; t++)
+			pthread_join(threads[t], NULL);
+
+		/* Everything queued is out once cleanup returns */
+		log_cleanup();
+		ck_assert_int_eq(count_lines(path), LOG_THREADS * LOG_LINES);
+		unlink(path);
+	}
+	log_set_level(LOG_INFO);
+}
+END_TEST
+
+static int evaluated;
+
+static const char *
+side_effect(void)
+{
+	evaluated++;
+	return "x";
+}
+
+/* Disabled debug messages skip their arguments; long ones are cut */
+START_TEST(test_logging_level_and_truncation)
+{
+	char  path[64];
+	char *big = malloc(10000);
+	char  line[8192];
+	FILE *fp;
+
+	ck_assert_ptr_nonnull(big);
+	memset(big, 'a', 9999);
+	big[9999] = '\0';
+
+	snprintf(path, sizeof(path), "/tmp/pg_logging_%d.log", (int) getpid());
+	unlink(path);
+	ck_assert(log_set_file(path));
+
+	log_set_level(LOG_INFO);
+	evaluated = 0;
+	log_debug("%s", side_effect());
+	ck_assert_int_eq(evaluated, 0);
+	ck_assert(!log_level_enabled(LOG_DEBUG));
+	ck_assert(log_level_enabled(LOG_WARNING));
+
+	log_warning("%s", big);
+	log_info("after");
+	log_cleanup();
+
+	fp = fopen(path, "r");
+	ck_assert_ptr_nonnull(fp);
+	ck_assert_ptr_nonnull(fgets(line, sizeof(line), fp));
+	ck_assert(strlen(line) < 4097);
+	ck_assert(strstr(line, "[WARNING] aaaa") != NULL);
+	ck_assert_str_eq(line + strlen(line) - 6, "aa...\n");
+	ck_assert_ptr_nonnull(fgets(line, sizeof(line), fp));
+	ck_assert(strstr(line, "[INFO] after\n") != NULL);
+	ck_assert_ptr_null(fgets(line, sizeof(line), fp));
+	fclose(fp);
+
+	unlink(path);
+	free(big);
+}
+END_TEST
+
+Suite *
+logging_suite(void)
+{
+	Suite *s = suite_create("logging");
+
+	TCase *tc = tcase_create("core");
+	tcase_set_timeout(tc, 30);
+	tcase_add_test(tc, test_logging_parallel_lines);
+	tcase_add_test(tc, test_logging_level_and_truncation);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,221 @@
+/*
+ * test_metrics.c
+ *
+ * Unit tests for the run metrics (src/common/metrics.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pg_backup_auditor.h"
+#include "metrics.h"
+#include "validation_result.h"
+
+/* Exposition of the counters and 'report', as a string to be freed */
+static char *
+render(const MetricsReport *report)
+{
+	char   *buf = NULL;
+	size_t  len = 0;
+	FILE   *fp = open_memstream(&buf, &len);
+
+	ck_assert_ptr_nonnull(fp);
+	metrics_write(fp, report);
+	fclose(fp);
+	return buf;
+}
+
+/* Value of the sample 'series' (name and labels), or -1 */
+static double
+sample(const char *text, const char *series)
+{
+	size_t      len = strlen(series);
+	const char *p = text;
+
+	while ((p = strstr(p, series)) != NULL)
+	{
+		if ((p == text || p[-1] == '\n') && p[len] == ' ')
+			return strtod(p + len + 1, NULL);
+		p += len;
+	}
+	return -1;
+}
+
+/* Counters only grow; other suites may have added to them already */
+START_TEST(test_metrics_counters)
+{
+	MetricsReport report;
+	char         *before;
+	char         *after;
+	uint64_t      start;
+
+	metrics_report_init(&report, "check");
+	before = render(&report);
+
+	metrics_count(METRIC_WAL_RECORDS_CHECKED, 5);
+	metrics_verified(METRIC_ALG_SHA1, METRIC_TARGET_FILE, 4096, 2000000000ULL);
+	start = metrics_clock();
+	metrics_phase_add(METRIC_PHASE_CHECKSUM, start - 1000000000ULL);
+	after = render(&report);
+
+	ck_assert(sample(after, "pg_backup_auditor_wal_records_checked_total{command=\"check\"}") ==
+			  sample(before, "pg_backup_auditor_wal_records_checked_total{command=\"check\"}") + 5);
+	ck_assert(sample(after, "pg_backup_auditor_verified_bytes_total{command=\"check\",algorithm=\"sha1\",target=\"file\"}") ==
+			  sample(before, "pg_backup_auditor_verified_bytes_total{command=\"check\",algorithm=\"sha1\",target=\"file\"}") + 4096);
+	ck_assert(sample(after, "pg_backup_auditor_phase_seconds_total{command=\"check\",phase=\"checksum\"}") >=
+			  sample(before, "pg_backup_auditor_phase_seconds_total{command=\"check\",phase=\"checksum\"}") + 1.0);
+	ck_assert(sample(after, "pg_backup_auditor_verify_bytes_per_second{command=\"check\",algorithm=\"sha1\",target=\"file\"}") > 0);
+
+	/* WAL records are CRC32C only */
+	ck_assert(sample(after, "pg_backup_auditor_verified_bytes_total{command=\"check\",algorithm=\"crc32c\",target=\"wal\"}") >= 0);
+	ck_assert(sample(after, "pg_backup_auditor_verified_bytes_total{command=\"check\",algorithm=\"sha1\",target=\"wal\"}") < 0);
+	ck_assert_ptr_nonnull(strstr(after, "# TYPE pg_backup_auditor_phase_seconds_total counter\n"));
+
+	free(before);
+	free(after);
+}
+END_TEST
+
+/* I/O goes to the innermost span on the thread, and back out after it */
+START_TEST(test_metrics_io_phases)
+{
+	MetricsReport report;
+	MetricSpan    outer;
+	MetricSpan    inner;
+	char         *before;
+	char         *after;
+	char         *text;
+	FILE         *fp;
+
+	metrics_report_init(&report, "check");
+	before = render(&report);
+
+	ck_assert_int_eq(metrics_thread_phase(), METRIC_PHASE_COUNT);
+	metrics_phase_begin(&outer, METRIC_PHASE_SCAN);
+	metrics_phase_begin(&inner, METRIC_PHASE_METADATA);
+	ck_assert_int_eq(metrics_thread_phase(), METRIC_PHASE_METADATA);
+	metrics_io(METRIC_IO_BYTES_READ, 100);
+	metrics_phase_end(&inner);
+	metrics_io(METRIC_IO_FILES_OPENED, 2);
+	metrics_phase_end(&outer);
+	ck_assert_int_eq(metrics_thread_phase(), METRIC_PHASE_COUNT);
+	metrics_io(METRIC_IO_FORKS, 1);
+
+	/* A stream counts as one file and the bytes up to its position */
+	fp = tmpfile();
+	ck_assert_ptr_nonnull(fp);
+	fputs("0123456789", fp);
+	metrics_set_thread_phase(METRIC_PHASE_WAL);
+	metrics_io_stream(fp);
+	metrics_set_thread_phase(METRIC_PHASE_COUNT);
+	fclose(fp);
+
+	after = render(&report);
+	ck_assert(sample(after, "pg_backup_auditor_read_bytes_total{command=\"check\",phase=\"metadata\"}") ==
+			  sample(before, "pg_backup_auditor_read_bytes_total{command=\"check\",phase=\"metadata\"}") + 100);
+	ck_assert(sample(after, "pg_backup_auditor_files_opened_total{command=\"check\",phase=\"scan\"}") ==
+			  sample(before, "pg_backup_auditor_files_opened_total{command=\"check\",phase=\"scan\"}") + 2);
+	ck_assert(sample(after, "pg_backup_auditor_forks_total{command=\"check\",phase=\"other\"}") ==
+			  sample(before, "pg_backup_auditor_forks_total{command=\"check\",phase=\"other\"}") + 1);
+	ck_assert(sample(after, "pg_backup_auditor_read_bytes_total{command=\"check\",phase=\"wal\"}") ==
+			  sample(before, "pg_backup_auditor_read_bytes_total{command=\"check\",phase=\"wal\"}") + 10);
+
+	/* The profile lists the phases with activity */
+	{
+		size_t len = 0;
+
+		text = NULL;
+		fp = open_memstream(&text, &len);
+		ck_assert_ptr_nonnull(fp);
+		metrics_profile_write(fp, 1.0);
+		fclose(fp);
+	}
+	ck_assert_ptr_nonnull(strstr(text, "\n  metadata "));
+	ck_assert_ptr_nonnull(strstr(text, "\n  total (wall) "));
+
+	free(text);
+	free(before);
+	free(after);
+}
+END_TEST
+
+/* Errors by category come from the results added to the report */
+START_TEST(test_metrics_report)
+{
+	MetricsReport    report;
+	ValidationResult a;
+	ValidationResult b;
+	char             path[64];
+	char            *text;
+	FILE            *fp;
+	char             line[256];
+	int              lines = 0;
+
+	memset(&a, 0, sizeof(a));
+	memset(&b, 0, sizeof(b));
+	validation_add_error_code(&a, VALIDATION_CODE_MISSING_WAL, "Missing WAL segment");
+	validation_add_error_code(&a, VALIDATION_CODE_MISSING_WAL, "Missing WAL segment");
+	validation_add_error_code(&b, VALIDATION_CODE_CHECKSUM_MISMATCH, "Checksum mismatch");
+	validation_add_warning(&b, "Missing start_time");
+
+	metrics_report_init(&report, "watch");
+	metrics_report_add(&report, &a);
+	metrics_report_add(&report, &b);
+	metrics_report_add(&report, NULL);
+	report.finished_at = 1767225600;
+	report.duration = 1.5;
+	ck_assert_int_eq(report.errors, 3);
+
+	text = render(&report);
+	ck_assert(sample(text, "pg_backup_auditor_validation_errors{command=\"watch\",category=\"missing_wal\"}") == 2);
+	ck_assert(sample(text, "pg_backup_auditor_validation_errors{command=\"watch\",category=\"checksum_mismatch\"}") == 1);
+	ck_assert(sample(text, "pg_backup_auditor_validation_errors{command=\"watch\",category=\"missing_file\"}") == 0);
+	ck_assert(sample(text, "pg_backup_auditor_validation_warnings{command=\"watch\"}") == 1);
+	ck_assert(sample(text, "pg_backup_auditor_last_run_timestamp_seconds{command=\"watch\"}") == 1767225600);
+	ck_assert(sample(text, "pg_backup_auditor_last_run_duration_seconds{command=\"watch\"}") == 1.5);
+	free(text);
+
+	/* The file is complete once it is there; no temporary is left */
+	snprintf(path, sizeof(path), "/tmp/pg_metrics_%d.prom", (int) getpid());
+	ck_assert(metrics_write_file(path, &report));
+	fp = fopen(path, "r");
+	ck_assert_ptr_nonnull(fp);
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		ck_assert(line[0] == '#' || strncmp(line, "pg_backup_auditor_", 18) == 0);
+		lines++;
+	}
+	fclose(fp);
+	ck_assert_int_gt(lines, 20);
+	snprintf(line, sizeof(line), "%s.%d.tmp", path, (int) getpid());
+	ck_assert(access(line, F_OK) != 0);
+	unlink(path);
+
+	ck_assert(!metrics_write_file("/nonexistent/dir/metrics.prom", &report));
+
+	validation_result_clear(&a);
+	validation_result_clear(&b);
+}
+END_TEST
+
+Suite *
+metrics_suite(void)
+{
+	Suite *s = suite_create("metrics");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_metrics_counters);
+	tcase_add_test(tc, test_metrics_io_phases);
+	tcase_add_test(tc, test_metrics_report);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,82 @@
+/*
+ * test_ndjson.c
+ *
+ * Unit tests for the streaming NDJSON writer (src/common/ndjson.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pg_backup_auditor.h"
+#include "ndjson.h"
+
+/* One line per record, escaped strings, nulls for unknown values */
+START_TEST(test_ndjson_record)
+{
+	char        *out = NULL;
+	size_t       len = 0;
+	FILE        *fp = open_memstream(&out, &len);
+	NdjsonRecord rec;
+
+	ck_assert_ptr_nonnull(fp);
+
+	ndjson_begin(&rec, fp, "finding");
+	ndjson_string(&rec, "message", "Missing \"base/1\"\tC:\\x\n\x01");
+	ndjson_string(&rec, "backup_id", NULL);
+	ndjson_int(&rec, "delta", -5);
+	ndjson_uint(&rec, "bytes", 18446744073709551615ULL);
+	ndjson_bool(&rec, "ok", false);
+	ndjson_double(&rec, "ratio", 0.25);
+	ndjson_time(&rec, "at", 1767866730);
+	ndjson_time(&rec, "never", 0);
+	ndjson_lsn(&rec, "lsn", 0x100002028ULL);
+	ndjson_end(&rec);
+
+	ndjson_begin(&rec, fp, "summary");
+	ndjson_end(&rec);
+	fclose(fp);
+
+	ck_assert_str_eq(out,
+		"{\"record\":\"finding\","
+		"\"message\":\"Missing \\\"base/1\\\"\\tC:\\\\x\\n\\u0001\","
+		"\"backup_id\":null,\"delta\":-5,\"bytes\":18446744073709551615,"
+		"\"ok\":false,\"ratio\":0.25,\"at\":\"2026-01-08T10:05:30Z\","
+		"\"never\":null,\"lsn\":\"1/2028\"}\n"
+		"{\"record\":\"summary\"}\n");
+	free(out);
+}
+END_TEST
+
+START_TEST(test_output_format_from_string)
+{
+	OutputFormat f = OUTPUT_TABLE;
+
+	ck_assert(output_format_from_string("ndjson", &f));
+	ck_assert_int_eq(f, OUTPUT_NDJSON);
+	ck_assert(output_format_from_string("table", &f));
+	ck_assert_int_eq(f, OUTPUT_TABLE);
+	ck_assert(output_format_from_string("json", &f));
+	ck_assert_int_eq(f, OUTPUT_NDJSON);
+	ck_assert(!output_format_from_string("yaml", &f));
+}
+END_TEST
+
+Suite *
+ndjson_suite(void)
+{
+	Suite *s = suite_create("ndjson");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_ndjson_record);
+	tcase_add_test(tc, test_output_format_from_string);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,487 @@
+/*
+ * test_page_checksum.c
+ *
+ * Unit tests for data page verification (src/common/page_checksum.c)
+ * and --level=pages (src/validator/page_validator.c)
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "pg_backup_auditor.h"
+#include "page_checksum.h"
+#include "validation_result.h"
+
+static char test_dir[PATH_MAX];
+
+static void
+setup(void)
+{
+	snprintf(test_dir, sizeof(test_dir), "/tmp/pg_page_test_%d", getpid());
+	mkdir(test_dir, 0755);
+}
+
+static void
+teardown(void)
+{
+	char cmd[PATH_MAX + 16];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", test_dir);
+	system(cmd);
+}
+
+static void
+set_field(uint8_t *page, size_t offset, uint16_t value)
+{
+	memcpy(page + offset, &value, sizeof(value));
+}
+
+/*
+ * A heap-like page of block 'blkno' with pd_lsn 1/'lsn_lo', filled from
+ * 'seed', and a valid pd_checksum
+ */
+static void
+make_page(uint8_t *page, uint32_t blkno, uint32_t lsn_lo, unsigned seed)
+{
+	uint32_t lsn_hi = 1;
+
+	memset(page, 0, PAGE_BLCKSZ);
+	memcpy(page, &lsn_hi, 4);
+	memcpy(page + 4, &lsn_lo, 4);
+	set_field(page, 12, 64);                    /* pd_lower */
+	set_field(page, 14, 1024);                  /* pd_upper */
+	set_field(page, 16, PAGE_BLCKSZ);           /* pd_special */
+	set_field(page, 18, PAGE_BLCKSZ | 4);       /* pd_pagesize_version */
+	for (int i = 1024; i < PAGE_BLCKSZ; i++)
+		page[i] = (uint8_t) (rand_r(&seed) >> 7);
+	set_field(page, 8, page_checksum(page, blkno));
+}
+
+/* The selected implementation agrees with the portable one */
+START_TEST(test_page_checksum_impls)
+{
+	uint8_t  page[PAGE_BLCKSZ];
+	unsigned seed = 42;
+
+	ck_assert_ptr_nonnull(page_checksum_implementation());
+
+	for (int n = 0; n < 64; n++)
+	{
+		uint32_t blkno = (uint32_t) rand_r(&seed);
+		uint16_t sum;
+
+		for (int i = 0; i < PAGE_BLCKSZ; i++)
+			page[i] = (uint8_t) (rand_r(&seed) >> 5);
+		sum = page_checksum(page, blkno);
+		ck_assert_uint_eq(sum, page_checksum_sw(page, blkno));
+		ck_assert_uint_ge(sum, 1);
+
+		/* pd_checksum itself is not part of the sum */
+		set_field(page, 8, (uint16_t) (sum ^ 0x5A5A));
+		ck_assert_uint_eq(page_checksum(page, blkno), sum);
+	}
+
+	/* The block number is mixed in */
+	ck_assert_uint_ne(page_checksum(page, 7), page_checksum(page, 8));
+}
+END_TEST
+
+/*
+ * A heap page as PostgreSQL writes it on a little-endian host for two
+ * committed (int4, text) rows, (1,'one') and (2,'two'): the header and
+ * line pointers, then zeros up to pd_upper and the two tuples.  Its
+ * checksums come from a separate transcription of pg_checksum_page()
+ * (storage/checksum_impl.h), not from this code, so the base offsets, the
+ * mixing and the final % 65535 + 1 are all pinned.
+ */
+static const uint8_t known_head[32] = {
+	0x00, 0x00, 0x00, 0x00, 0xf8, 0xa2, 0x53, 0x01,     /* pd_lsn 0/153A2F8 */
+	0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0xc0, 0x1f,     /* lower 32, upper 8128 */
+	0x00, 0x20, 0x04, 0x20, 0x00, 0x00, 0x00, 0x00,     /* special 8192, version 4 */
+	0xe0, 0x9f, 0x40, 0x00, 0xc0, 0x9f, 0x40, 0x00      /* (8160,32), (8128,32) */
+};
+
+static const uint8_t known_tail[64] = {
+	0xe4, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,     /* (2,'two'): xmin 740 */
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x02, 0x00, 0x02, 0x00, 0x02, 0x09, 0x18, 0x00,
+	0x02, 0x00, 0x00, 0x00, 0x09, 0x74, 0x77, 0x6f,
+	0xe4, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,     /* (1,'one') */
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x01, 0x00, 0x02, 0x00, 0x02, 0x09, 0x18, 0x00,
+	0x01, 0x00, 0x00, 0x00, 0x09, 0x6f, 0x6e, 0x65
+};
+
+START_TEST(test_page_checksum_known)
+{
+	static uint8_t   page[PAGE_BLCKSZ];
+	PageCheckOptions on = { PAGE_CHECKSUMS_ON, 0, false };
+
+	memset(page, 0, sizeof(page));
+	memcpy(page, known_head, sizeof(known_head));
+	memcpy(page + PAGE_BLCKSZ - sizeof(known_tail), known_tail, sizeof(known_tail));
+
+	ck_assert_uint_eq(page_checksum(page, 0), 19738);
+	ck_assert_uint_eq(page_checksum_sw(page, 0), 19738);
+	ck_assert_uint_eq(page_checksum(page, 131075), 19737);
+
+	/* The block number that makes the sum 65534 before the + 1 */
+	ck_assert_uint_eq(page_checksum(page, 1628378103), 65535);
+	ck_assert_uint_eq(page_checksum_sw(page, 1628378103), 65535);
+
+	set_field(page, 8, 19738);
+	ck_assert_int_eq(page_verify(page, 0, &on, NULL, NULL), PAGE_OK);
+}
+END_TEST
+
+START_TEST(test_page_verify)
+{
+	uint8_t          page[PAGE_BLCKSZ];
+	PageCheckOptions on = { PAGE_CHECKSUMS_ON, 0, false };
+	PageCheckOptions off = { PAGE_CHECKSUMS_OFF, 0, false };
+	PageCheckOptions unknown = { PAGE_CHECKSUMS_UNKNOWN, 0, false };
+	PageCheckOptions during = { PAGE_CHECKSUMS_ON, (1ULL << 32) | 0x2000, false };
+	uint16_t         stored = 0;
+	uint16_t         computed = 0;
+	uint16_t         good;
+
+	make_page(page, 5, 0x1000, 1);
+	ck_assert_int_eq(page_verify(page, 5, &on, NULL, NULL), PAGE_OK);
+	good = page_checksum(page, 5);
+
+	/* Same page as another block */
+	ck_assert_int_eq(page_verify(page, 6, &on, NULL, NULL), PAGE_BAD_CHECKSUM);
+
+	/* One flipped bit in the tuple data */
+	page[5000] ^= 0x10;
+	ck_assert_int_eq(page_verify(page, 5, &on, &stored, &computed), PAGE_BAD_CHECKSUM);
+	ck_assert_uint_eq(stored, good);
+	ck_assert_uint_ne(computed, good);
+	ck_assert_int_eq(page_verify(page, 5, &off, NULL, NULL), PAGE_OK);
+
+	/* Written after the backup started: left to WAL replay */
+	ck_assert_int_eq(page_verify(page, 5, &during, NULL, NULL), PAGE_BAD_CHECKSUM);
+	make_page(page, 5, 0x3000, 1);
+	page[5000] ^= 0x10;
+	ck_assert_int_eq(page_verify(page, 5, &during, NULL, NULL), PAGE_NEWER);
+
+	/* pd_checksum never set: only checked when checksums are known on */
+	set_field(page, 8, 0);
+	ck_assert_int_eq(page_verify(page, 5, &unknown, NULL, NULL), PAGE_OK);
+	ck_assert_int_eq(page_verify(page, 5, &on, NULL, NULL), PAGE_BAD_CHECKSUM);
+
+	/* Header sanity, with checksums off */
+	make_page(page, 5, 0x1000, 1);
+	set_field(page, 12, 2000);                  /* pd_lower > pd_upper */
+	ck_assert_int_eq(page_verify(page, 5, &off, NULL, NULL), PAGE_BAD_HEADER);
+	make_page(page, 5, 0x1000, 1);
+	set_field(page, 16, 8190);                  /* pd_special not aligned */
+	ck_assert_int_eq(page_verify(page, 5, &off, NULL, NULL), PAGE_BAD_HEADER);
+	make_page(page, 5, 0x1000, 1);
+	set_field(page, 10, 0x0100);                /* unknown pd_flags */
+	ck_assert_int_eq(page_verify(page, 5, &off, NULL, NULL), PAGE_BAD_HEADER);
+
+	/* New pages must be all zero */
+	memset(page, 0, sizeof(page));
+	ck_assert_int_eq(page_verify(page, 5, &on, NULL, NULL), PAGE_NEW);
+	page[PAGE_BLCKSZ - 1] = 1;
+	ck_assert_int_eq(page_verify(page, 5, &on, NULL, NULL), PAGE_BAD_HEADER);
+}
+END_TEST
+
+START_TEST(test_page_relation_file)
+{
+	uint32_t block = 99;
+
+	ck_assert(page_relation_file("base/1/16384", &block));
+	ck_assert_uint_eq(block, 0);
+	ck_assert(page_relation_file("base/16385/2619.3", &block));
+	ck_assert_uint_eq(block, 3 * PAGE_RELSEG_SIZE);
+	ck_assert(page_relation_file("base/1/16384_fsm", &block));
+	ck_assert(page_relation_file("base/1/16384_vm.1", &block));
+	ck_assert_uint_eq(block, PAGE_RELSEG_SIZE);
+	ck_assert(page_relation_file("base/1/16384_init", NULL));
+	ck_assert(page_relation_file("global/1262", NULL));
+	ck_assert(page_relation_file("pg_tblspc/16400/PG_16_202307071/5/16401", NULL));
+
+	ck_assert(!page_relation_file("global/pg_control", NULL));
+	ck_assert(!page_relation_file("global/pg_filenode.map", NULL));
+	ck_assert(!page_relation_file("base/1/PG_VERSION", NULL));
+	ck_assert(!page_relation_file("base/1/pg_internal.init", NULL));
+	ck_assert(!page_relation_file("base/1/16384_xyz", NULL));
+	ck_assert(!page_relation_file("base/1/16384.", NULL));
+	ck_assert(!page_relation_file("base/1/16384.99999", NULL));
+	ck_assert(!page_relation_file("base/pgsql_tmp/pgsql_tmp12.0", NULL));
+	ck_assert(!page_relation_file("base/1/t3_16384", NULL));
+	ck_assert(!page_relation_file("pg_tblspc/16400/5/16401", NULL));
+	ck_assert(!page_relation_file("pg_wal/000000010000000000000001", NULL));
+}
+END_TEST
+
+START_TEST(test_page_checksums_from_control)
+{
+	uint8_t  buf[512];
+	double   format = 1234567.0;
+	uint32_t blcksz = PAGE_BLCKSZ;
+	uint32_t version = 1;
+
+	memset(buf, 0, sizeof(buf));
+	ck_assert_int_eq(page_checksums_from_control(buf, sizeof(buf)), PAGE_CHECKSUMS_UNKNOWN);
+
+	memcpy(buf + 192, &format, sizeof(format));
+	memcpy(buf + 200, &blcksz, sizeof(blcksz));
+	memcpy(buf + 236, &version, sizeof(version));
+	ck_assert_int_eq(page_checksums_from_control(buf, sizeof(buf)), PAGE_CHECKSUMS_ON);
+
+	version = 0;
+	memcpy(buf + 236, &version, sizeof(version));
+	ck_assert_int_eq(page_checksums_from_control(buf, sizeof(buf)), PAGE_CHECKSUMS_OFF);
+
+	/* Too short to hold the field, or another block size */
+	ck_assert_int_eq(page_checksums_from_control(buf, 220), PAGE_CHECKSUMS_UNKNOWN);
+	blcksz = 16384;
+	memcpy(buf + 200, &blcksz, sizeof(blcksz));
+	ck_assert_int_eq(page_checksums_from_control(buf, sizeof(buf)), PAGE_CHECKSUMS_UNKNOWN);
+}
+END_TEST
+
+/* Walk 'len' bytes of 'data' fed in chunks of 'chunk' bytes */
+static bool
+walk_chunks(PageWalk *walk, const PageCheckOptions *options, uint32_t first_block,
+			const uint8_t *data, size_t len, size_t chunk)
+{
+	page_walk_init(walk, options, first_block);
+	for (size_t off = 0; off < len; off += chunk)
+		page_walk_update(walk, data + off, len - off < chunk ? len - off : chunk);
+	return page_walk_finish(walk);
+}
+
+START_TEST(test_page_walk)
+{
+	enum { PAGES = 6 };
+	static uint8_t   data[PAGES * PAGE_BLCKSZ + 100];
+	PageCheckOptions plain = { PAGE_CHECKSUMS_ON, 0, false };
+	static const size_t chunks[] = { 1, 7, 4096, PAGE_BLCKSZ, 3 * PAGE_BLCKSZ + 5, sizeof(data) };
+	uint32_t         first = 2 * PAGE_RELSEG_SIZE;
+	PageWalk         walk;
+
+	/* Blocks 0, 2, 3, 5 written, 1 new, 4 corrupt; a partial page after */
+	memset(data, 0, sizeof(data));
+	for (int i = 0; i < PAGES; i++)
+		if (i != 1)
+			make_page(data + i * PAGE_BLCKSZ, first + (uint32_t) i, 0x1000, (unsigned) i);
+	data[4 * PAGE_BLCKSZ + 6000] ^= 1;
+	memset(data + PAGES * PAGE_BLCKSZ, 0xEE, 100);
+
+	for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+	{
+		ck_assert(!walk_chunks(&walk, &plain, first, data, sizeof(data), chunks[c]));
+		ck_assert_uint_eq(walk.pages, 4);
+		ck_assert_uint_eq(walk.new_pages, 1);
+		ck_assert_uint_eq(walk.bad_pages, 1);
+		ck_assert_uint_eq(walk.bad_block, first + 4);
+		ck_assert_int_eq(walk.bad_status, PAGE_BAD_CHECKSUM);
+		ck_assert_ptr_null(walk.carry);
+	}
+
+	/* The right blocks once the corrupt one is repaired */
+	data[4 * PAGE_BLCKSZ + 6000] ^= 1;
+	ck_assert(walk_chunks(&walk, &plain, first, data, sizeof(data), 1000));
+	ck_assert(!walk_chunks(&walk, &plain, 0, data, sizeof(data), 1000));
+}
+END_TEST
+
+/* pg_probackup framing: block number and size before each page */
+static size_t
+add_frame(uint8_t *out, uint32_t block, int32_t size, const uint8_t *page)
+{
+	memcpy(out, &block, 4);
+	memcpy(out + 4, &size, 4);
+	if (page != NULL)
+		memcpy(out + 8, page, PAGE_BLCKSZ);
+	return 8 + (page != NULL ? PAGE_BLCKSZ : 0);
+}
+
+START_TEST(test_page_walk_framed)
+{
+	static uint8_t   data[4 * (PAGE_BLCKSZ + 8) + 64];
+	uint8_t          page[PAGE_BLCKSZ];
+	PageCheckOptions framed = { PAGE_CHECKSUMS_ON, 0, true };
+	PageWalk         walk;
+	size_t           len = 0;
+
+	/* An incremental file: only blocks 3 and 9 of the segment */
+	make_page(page, PAGE_RELSEG_SIZE + 3, 0x1000, 3);
+	len += add_frame(data + len, 3, PAGE_BLCKSZ, page);
+	make_page(page, PAGE_RELSEG_SIZE + 9, 0x1000, 9);
+	len += add_frame(data + len, 9, PAGE_BLCKSZ, page);
+	ck_assert(walk_chunks(&walk, &framed, PAGE_RELSEG_SIZE, data, len, 777));
+	ck_assert_uint_eq(walk.pages, 2);
+
+	/* Stored under the wrong block */
+	make_page(page, PAGE_RELSEG_SIZE + 4, 0x1000, 4);
+	len += add_frame(data + len, 5, PAGE_BLCKSZ, page);
+	ck_assert(!walk_chunks(&walk, &framed, PAGE_RELSEG_SIZE, data, len, 777));
+	ck_assert_uint_eq(walk.bad_block, PAGE_RELSEG_SIZE + 5);
+
+	/* A compressed page ends the walk: its padding is not recorded */
+	len = 0;
+	len += add_frame(data + len, 0, 1200, NULL);
+	memset(data + len, 0xAB, 1200);
+	len += 1200;
+	ck_assert(walk_chunks(&walk, &framed, 0, data, len, 100));
+	ck_assert_uint_eq(walk.unchecked, 1);
+	ck_assert_uint_eq(walk.pages, 0);
+}
+END_TEST
+
+static void
+write_bytes(const char *rel, const uint8_t *data, size_t len)
+{
+	char  path[PATH_MAX];
+	char  cmd[PATH_MAX + 32];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", test_dir, rel);
+	snprintf(cmd, sizeof(cmd), "mkdir -p \"$(dirname %s)\"", path);
+	ck_assert_int_eq(system(cmd), 0);
+	fp = fopen(path, "wb");
+	ck_assert_ptr_nonnull(fp);
+	fwrite(data, 1, len, fp);
+	fclose(fp);
+}
+
+/* A pg_control that says data_checksums is on */
+static void
+write_control(const char *rel)
+{
+	uint8_t  buf[PAGE_BLCKSZ];
+	double   format = 1234567.0;
+	uint32_t blcksz = PAGE_BLCKSZ;
+	uint32_t version = 1;
+
+	memset(buf, 0, sizeof(buf));
+	memcpy(buf + 152, &format, sizeof(format));
+	memcpy(buf + 160, &blcksz, sizeof(blcksz));
+	memcpy(buf + 196, &version, sizeof(version));
+	write_bytes(rel, buf, sizeof(buf));
+}
+
+/* Corrupt pages of a plain backup are reported, in file name order */
+START_TEST(test_check_backup_pages)
+{
+	static uint8_t    rel[3 * PAGE_BLCKSZ];
+	BackupInfo        backup;
+	ValidationResult *res;
+	ValidationLevel   level;
+
+	ck_assert(validation_level_from_string("pages", &level));
+	ck_assert_int_eq(level, VALIDATION_LEVEL_PAGES);
+
+	for (int i = 0; i < 3; i++)
+		make_page(rel + i * PAGE_BLCKSZ, (uint32_t) i, 0x1000, (unsigned) i);
+	write_bytes("base/1/16384", rel, sizeof(rel));
+	write_bytes("base/1/16384_fsm", rel, PAGE_BLCKSZ);
+	rel[PAGE_BLCKSZ + 100] ^= 0xFF;
+	write_bytes("base/1/16390", rel, sizeof(rel));
+	write_bytes("base/1/PG_VERSION", (const uint8_t *) "16\n", 3);
+	write_control("global/pg_control");
+
+	memset(&backup, 0, sizeof(backup));
+	backup.tool = BACKUP_TOOL_PG_BASEBACKUP;
+	str_copy(backup.backup_id, "B1", sizeof(backup.backup_id));
+	str_copy(backup.backup_path, test_dir, sizeof(backup.backup_path));
+	backup.start_lsn = (2ULL << 32);
+
+	res = check_backup_pages(&backup);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 1);
+	ck_assert_ptr_nonnull(strstr(res->errors[0], "block 1 of base/1/16390"));
+	ck_assert_int_eq(res->code_counts[VALIDATION_CODE_CHECKSUM_MISMATCH], 1);
+	free_validation_result(res);
+
+	/* The page was written during the backup: WAL replay fixes it */
+	backup.start_lsn = (1ULL << 32) | 0x800;
+	res = check_backup_pages(&backup);
+	ck_assert_int_eq(res->error_count, 0);
+	free_validation_result(res);
+
+	/* No plain data directory */
+	backup.tool = BACKUP_TOOL_PGBACKREST;
+	res = check_backup_pages(&backup);
+	ck_assert_int_eq(res->error_count, 0);
+	ck_assert_int_eq(res->warning_count, 1);
+	free_validation_result(res);
+}
+END_TEST
+
+/* pg_probackup: framed pages of database/, segment numbers included */
+START_TEST(test_check_backup_pages_probackup)
+{
+	static uint8_t    data[2 * (PAGE_BLCKSZ + 8)];
+	uint8_t           page[PAGE_BLCKSZ];
+	BackupInfo        backup;
+	ValidationResult *res;
+	size_t            len = 0;
+
+	make_page(page, PAGE_RELSEG_SIZE, 0x1000, 1);
+	len += add_frame(data + len, 0, PAGE_BLCKSZ, page);
+	make_page(page, 1, 0x1000, 2);      /* checksummed as block 1 of segment 0 */
+	len += add_frame(data + len, 1, PAGE_BLCKSZ, page);
+	write_bytes("database/base/1/16384.1", data, len);
+	write_control("database/global/pg_control");
+
+	memset(&backup, 0, sizeof(backup));
+	backup.tool = BACKUP_TOOL_PG_PROBACKUP;
+	str_copy(backup.backup_id, "T1", sizeof(backup.backup_id));
+	str_copy(backup.backup_path, test_dir, sizeof(backup.backup_path));
+
+	res = check_backup_pages(&backup);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->error_count, 1);
+	ck_assert_ptr_nonnull(strstr(res->errors[0], "block 131073 of base/1/16384.1"));
+	free_validation_result(res);
+}
+END_TEST
+
+Suite *
+page_checksum_suite(void)
+{
+	Suite *s = suite_create("page_checksum");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_page_checksum_impls);
+	tcase_add_test(tc, test_page_checksum_known);
+	tcase_add_test(tc, test_page_verify);
+	tcase_add_test(tc, test_page_relation_file);
+	tcase_add_test(tc, test_page_checksums_from_control);
+	tcase_add_test(tc, test_page_walk);
+	tcase_add_test(tc, test_page_walk_framed);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("backup");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_check_backup_pages);
+	tcase_add_test(tc, test_check_backup_pages_probackup);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -408,6 +408,94 @@ START_TEST(test_data_bytes_calculation)
 }
 END_TEST
 
+/* Test: data_bytes taken from backup_manifest, walked only on request */
+START_TEST(test_data_bytes_from_manifest)
+{
+	char        path[PATH_MAX];
+	struct stat st;
+	FILE       *fp;
+
+	setup_test_directories();
+
+	snprintf(path, sizeof(path), "%s/backup_manifest", plain_backup_dir);
+	fp = fopen(path, "w");
+	fprintf(fp, "{ \"PostgreSQL-Backup-Manifest-Version\": 1,\n");
+	fprintf(fp, "\"Files\": [\n");
+	fprintf(fp, "{ \"Path\": \"PG_VERSION\", \"Size\": 1000000, \"Last-Modified\": \"2024-01-08 10:05:30 GMT\" },\n");
+	fprintf(fp, "{ \"Path\": \"global/pg_control\", \"Size\": 8192, \"Last-Modified\": \"2024-01-08 10:05:30 GMT\" }\n");
+	fprintf(fp, "],\n");
+	fprintf(fp, "\"WAL-Ranges\": [{ \"Timeline\": 1, \"Start-LSN\": \"0/2000028\", \"End-LSN\": \"0/2000100\" }],\n");
+	fprintf(fp, "\"Manifest-Checksum\": \"abc123\" }\n");
+	fclose(fp);
+	ck_assert_int_eq(stat(path, &st), 0);
+
+	/* Default: manifest files plus the manifest itself */
+	BackupInfo *info = pg_basebackup_adapter.scan(plain_backup_dir);
+	ck_assert_ptr_nonnull(info);
+	ck_assert_uint_eq(info->data_bytes, 1000000 + 8192 + (uint64_t) st.st_size);
+	free(info);
+
+	/* walk: what is actually on disk */
+	scan_set_size_mode(SIZE_MODE_WALK);
+	info = pg_basebackup_adapter.scan(plain_backup_dir);
+	ck_assert_ptr_nonnull(info);
+	ck_assert_uint_eq(info->data_bytes, get_directory_size(plain_backup_dir));
+	ck_assert_uint_lt(info->data_bytes, 1000000);
+	free(info);
+
+	/* none: metadata only, and nothing to walk without a manifest */
+	scan_set_size_mode(SIZE_MODE_NONE);
+	unlink(path);
+	info = pg_basebackup_adapter.scan(plain_backup_dir);
+	ck_assert_ptr_nonnull(info);
+	ck_assert_uint_eq(info->data_bytes, 0);
+	free(info);
+
+	scan_set_size_mode(SIZE_MODE_METADATA);
+	teardown_test_directories();
+}
+END_TEST
+
+/* Test: identity-level scan skips backup_manifest until backup_info_load() */
+START_TEST(test_identity_level_scan)
+{
+	char  path[PATH_MAX];
+	FILE *fp;
+
+	setup_test_directories();
+
+	snprintf(path, sizeof(path), "%s/backup_manifest", plain_backup_dir);
+	fp = fopen(path, "w");
+	fprintf(fp, "{ \"PostgreSQL-Backup-Manifest-Version\": 1,\n");
+	fprintf(fp, "\"Files\": [{ \"Path\": \"PG_VERSION\", \"Size\": 3 }],\n");
+	fprintf(fp, "\"WAL-Ranges\": [{ \"Timeline\": 1, \"Start-LSN\": \"0/2000028\", \"End-LSN\": \"0/2000100\" }],\n");
+	fprintf(fp, "\"Manifest-Checksum\": \"abc123\" }\n");
+	fclose(fp);
+
+	scan_set_load_level(BACKUP_LOAD_IDENTITY);
+	BackupInfo *info = pg_basebackup_adapter.scan(plain_backup_dir);
+	scan_set_load_level(BACKUP_LOAD_FULL);
+
+	ck_assert_ptr_nonnull(info);
+	ck_assert(info->partial);
+	ck_assert_str_eq(info->backup_id, "20240108-100530");
+	ck_assert_uint_eq(info->start_lsn, 0x2000028ULL);
+	ck_assert_uint_eq(info->stop_lsn, 0);
+	ck_assert_uint_eq(info->data_bytes, 0);
+	ck_assert_uint_eq(info->pg_version, 0);
+
+	ck_assert(backup_info_load(info));
+	ck_assert(!info->partial);
+	ck_assert_str_eq(info->backup_id, "20240108-100530");
+	ck_assert_uint_eq(info->stop_lsn, 0x2000100ULL);
+	ck_assert(info->data_bytes > 0);
+	ck_assert_uint_eq(info->pg_version, 170000);
+
+	free(info);
+	teardown_test_directories();
+}
+END_TEST
+
 /* Test: end_time from directory mtime */
 START_TEST(test_end_time_from_mtime)
 {
@@ -547,6 +635,8 @@ pg_basebackup_suite(void)
 	tcase_add_test(tc_metadata, test_pg_version_parsing);
 	tcase_add_test(tc_metadata, test_pg_version_with_minor);
 	tcase_add_test(tc_metadata, test_data_bytes_calculation);
+	tcase_add_test(tc_metadata, test_data_bytes_from_manifest);
+	tcase_add_test(tc_metadata, test_identity_level_scan);
 	tcase_add_test(tc_metadata, test_end_time_from_mtime);
 	suite_add_tcase(s, tc_metadata);
 
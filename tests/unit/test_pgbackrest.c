@@ -729,14 +729,14 @@ START_TEST(test_pbr_checksums_no_manifest)
 }
 END_TEST
 
-/* Compressed backup (no pg_data/ dir) → NULL */
-START_TEST(test_pbr_checksums_compressed)
+/* No pg_data/ directory → NULL */
+START_TEST(test_pbr_checksums_no_pg_data)
 {
 	char dir[PATH_MAX], path[PATH_MAX];
 	snprintf(dir, sizeof(dir), "/tmp/pbr_ck_cmp_%d", getpid());
 	mkdir(dir, 0755);
 
-	/* manifest exists but pg_data/ is absent (compressed backup) */
+	/* manifest exists but pg_data/ is absent */
 	snprintf(path, sizeof(path), "%s/backup.manifest", dir);
 	touch_file(path);
 
@@ -873,6 +873,231 @@ START_TEST(test_pbr_checksums_missing_file)
 }
 END_TEST
 
+/* An unchanged file with a "reference" is read from the earlier backup */
+START_TEST(test_pbr_checksums_reference)
+{
+	char dir[PATH_MAX], full[PATH_MAX], incr[PATH_MAX], path[PATH_MAX];
+	char sha1[41];
+	const char *content = "17\n";
+
+	snprintf(dir, sizeof(dir), "/tmp/pbr_ck_ref_%d", getpid());
+	snprintf(full, sizeof(full), "%s/20260101-000000F", dir);
+	snprintf(incr, sizeof(incr), "%s/20260101-000000F_20260102-000000I", dir);
+	mkdir(dir, 0755);
+	mkdir(full, 0755);
+	mkdir(incr, 0755);
+	snprintf(path, sizeof(path), "%s/pg_data", full);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/pg_data", incr);
+	mkdir(path, 0755);
+
+	/* Only the full backup holds PG_VERSION */
+	snprintf(path, sizeof(path), "%s/pg_data/PG_VERSION", full);
+	FILE *fp = fopen(path, "w");
+	fputs(content, fp);
+	fclose(fp);
+	sha1_hex_of_string(content, strlen(content), sha1);
+
+	snprintf(path, sizeof(path), "%s/backup.manifest", incr);
+	fp = fopen(path, "w");
+	fprintf(fp, "[backup]\nbackup-label=20260101-000000F_20260102-000000I\n\n");
+	fprintf(fp, "[target:file]\n");
+	fprintf(fp, "pg_data/PG_VERSION={\"checksum\":\"%s\",\"reference\":\"20260101-000000F\","
+			"\"size\":3}\n", sha1);
+	fprintf(fp, "pg_data/gone={\"checksum\":\"%s\",\"reference\":\"20260101-000000F\","
+			"\"size\":3}\n", sha1);
+	fclose(fp);
+
+	BackupInfo *bi = make_pgbackrest_backup_info(incr);
+	ValidationResult *r = pgbackrest_check_manifest_checksums(bi);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert_ptr_nonnull(strstr(r->errors[0], "Missing file: pg_data/gone"));
+
+	free_validation_result(r);
+	free(bi);
+	char cmd[PATH_MAX + 20];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	system(cmd);
+}
+END_TEST
+
+/*
+ * Write a gzip-compressed backup: pg_data/PG_VERSION.gz holding 'content',
+ * and a manifest with the given compression option line and checksum.
+ */
+static void
+make_pbr_gz_backup(const char *dir, const char *content,
+				   const char *option, const char *sha1)
+{
+	char  path[PATH_MAX];
+	char  cmd[PATH_MAX * 2];
+	FILE *fp;
+
+	mkdir(dir, 0755);
+	snprintf(path, sizeof(path), "%s/pg_data", dir);
+	mkdir(path, 0755);
+
+	snprintf(path, sizeof(path), "%s/pg_data/PG_VERSION", dir);
+	fp = fopen(path, "w");
+	fputs(content, fp);
+	fclose(fp);
+	snprintf(cmd, sizeof(cmd), "gzip -n '%s'", path);
+	ck_assert_int_eq(system(cmd), 0);
+
+	snprintf(path, sizeof(path), "%s/backup.manifest", dir);
+	fp = fopen(path, "w");
+	fprintf(fp, "[backup]\nbackup-label=test\n\n");
+	fprintf(fp, "[backup:option]\n%s\n\n", option);
+	fprintf(fp, "[target:file]\n");
+	fprintf(fp, "pg_data/PG_VERSION={\"checksum\":\"%s\",\"size\":%zu}\n",
+			sha1, strlen(content));
+	fclose(fp);
+}
+
+/* gz-compressed backup: checksum of the decompressed content → 0 errors */
+START_TEST(test_pbr_checksums_gz_ok)
+{
+	char dir[PATH_MAX];
+	char sha1[41];
+	const char *content = "17\n";
+
+	snprintf(dir, sizeof(dir), "/tmp/pbr_ck_gz_%d", getpid());
+	sha1_hex_of_string(content, strlen(content), sha1);
+	make_pbr_gz_backup(dir, content, "option-compress-type=\"gz\"", sha1);
+
+	BackupInfo *bi = make_pgbackrest_backup_info(dir);
+	ValidationResult *r = pgbackrest_check_manifest_checksums(bi);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 0);
+	ck_assert_int_eq(r->warning_count, 0);
+	ck_assert_int_eq(r->status, BACKUP_STATUS_OK);
+
+	free_validation_result(r);
+	free(bi);
+	char cmd[PATH_MAX + 20];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	system(cmd);
+}
+END_TEST
+
+/* Compression option after [target:file]: still applied to every file */
+START_TEST(test_pbr_checksums_gz_option_last)
+{
+	char dir[PATH_MAX];
+	char path[PATH_MAX];
+	char sha1[41];
+	const char *content = "17\n";
+	FILE *fp;
+
+	snprintf(dir, sizeof(dir), "/tmp/pbr_ck_gzlast_%d", getpid());
+	sha1_hex_of_string(content, strlen(content), sha1);
+	make_pbr_gz_backup(dir, content, "", sha1);
+	snprintf(path, sizeof(path), "%s/backup.manifest", dir);
+	fp = fopen(path, "a");
+	fprintf(fp, "\n[backup:option]\noption-compress-type=\"gz\"\n");
+	fclose(fp);
+
+	BackupInfo *bi = make_pgbackrest_backup_info(dir);
+	ValidationResult *r = pgbackrest_check_manifest_checksums(bi);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 0);
+	ck_assert_int_eq(r->status, BACKUP_STATUS_OK);
+
+	free_validation_result(r);
+	free(bi);
+	char cmd[PATH_MAX + 20];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	system(cmd);
+}
+END_TEST
+
+/* Legacy option-compress=true (gzip), wrong checksum → SHA1 mismatch */
+START_TEST(test_pbr_checksums_gz_mismatch)
+{
+	char dir[PATH_MAX];
+
+	snprintf(dir, sizeof(dir), "/tmp/pbr_ck_gzm_%d", getpid());
+	make_pbr_gz_backup(dir, "17\n", "option-compress=true",
+					   "0000000000000000000000000000000000000000");
+
+	BackupInfo *bi = make_pgbackrest_backup_info(dir);
+	ValidationResult *r = pgbackrest_check_manifest_checksums(bi);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert_ptr_nonnull(strstr(r->errors[0], "SHA1 mismatch"));
+	ck_assert_int_eq(r->status, BACKUP_STATUS_ERROR);
+
+	free_validation_result(r);
+	free(bi);
+	char cmd[PATH_MAX + 20];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	system(cmd);
+}
+END_TEST
+
+/* Damaged .gz file → corrupt compressed file error */
+START_TEST(test_pbr_checksums_gz_corrupt)
+{
+	char dir[PATH_MAX], path[PATH_MAX];
+	char sha1[41];
+	const char *content = "17\n";
+	FILE *fp;
+
+	snprintf(dir, sizeof(dir), "/tmp/pbr_ck_gzc_%d", getpid());
+	sha1_hex_of_string(content, strlen(content), sha1);
+	make_pbr_gz_backup(dir, content, "option-compress-type=\"gz\"", sha1);
+
+	/* Keep the gzip magic, garble the deflate data */
+	snprintf(path, sizeof(path), "%s/pg_data/PG_VERSION.gz", dir);
+	fp = fopen(path, "wb");
+	fwrite("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x03garbage", 1, 17, fp);
+	fclose(fp);
+
+	BackupInfo *bi = make_pgbackrest_backup_info(dir);
+	ValidationResult *r = pgbackrest_check_manifest_checksums(bi);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert_ptr_nonnull(strstr(r->errors[0], "Corrupt compressed file"));
+
+	free_validation_result(r);
+	free(bi);
+	char cmd[PATH_MAX + 20];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	system(cmd);
+}
+END_TEST
+
+/* Unknown compression type → warning, no file checks */
+START_TEST(test_pbr_checksums_unknown_compression)
+{
+	char dir[PATH_MAX];
+
+	snprintf(dir, sizeof(dir), "/tmp/pbr_ck_gzu_%d", getpid());
+	make_pbr_gz_backup(dir, "17\n", "option-compress-type=\"brotli\"",
+					   "0000000000000000000000000000000000000000");
+
+	BackupInfo *bi = make_pgbackrest_backup_info(dir);
+	ValidationResult *r = pgbackrest_check_manifest_checksums(bi);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 0);
+	ck_assert_int_eq(r->warning_count, 1);
+	ck_assert_int_eq(r->status, BACKUP_STATUS_WARNING);
+
+	free_validation_result(r);
+	free(bi);
+	char cmd[PATH_MAX + 20];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	system(cmd);
+}
+END_TEST
+
 /* ------------------------------------------------------------------ *
  * pgbackrest chain validation tests
  * ------------------------------------------------------------------ */
@@ -1050,10 +1275,16 @@ pgbackrest_suite(void)
 	TCase *tc_checksums = tcase_create("manifest_checksums");
 	tcase_add_test(tc_checksums, test_pbr_checksums_null_input);
 	tcase_add_test(tc_checksums, test_pbr_checksums_no_manifest);
-	tcase_add_test(tc_checksums, test_pbr_checksums_compressed);
+	tcase_add_test(tc_checksums, test_pbr_checksums_no_pg_data);
 	tcase_add_test(tc_checksums, test_pbr_checksums_all_ok);
 	tcase_add_test(tc_checksums, test_pbr_checksums_mismatch);
 	tcase_add_test(tc_checksums, test_pbr_checksums_missing_file);
+	tcase_add_test(tc_checksums, test_pbr_checksums_reference);
+	tcase_add_test(tc_checksums, test_pbr_checksums_gz_ok);
+	tcase_add_test(tc_checksums, test_pbr_checksums_gz_option_last);
+	tcase_add_test(tc_checksums, test_pbr_checksums_gz_mismatch);
+	tcase_add_test(tc_checksums, test_pbr_checksums_gz_corrupt);
+	tcase_add_test(tc_checksums, test_pbr_checksums_unknown_compression);
 	suite_add_tcase(s, tc_checksums);
 
 	/* Test case for chain validation */
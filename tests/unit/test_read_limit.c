@@ -0,0 +1,95 @@
+/*
+ * test_read_limit.c
+ *
+ * Unit tests for the shared read-rate and IOPS budget
+ * (src/common/read_limit.c) and the size argument parser it is
+ * configured with.
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pg_backup_auditor.h"
+#include "arg_parser.h"
+
+static double
+now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/* 300 KB at 1 MB/s with a 100 KB burst: about 0.2 s of waiting */
+START_TEST(test_read_limit_rate)
+{
+	double start;
+
+	read_limit_set(1000 * 1000, 0);
+	start = now_seconds();
+	for (int i = 0; i < 6; i++)
+		read_limit_charge(50 * 1000);
+	ck_assert(now_seconds() - start >= 0.15);
+	read_limit_set(0, 0);
+
+	/* Unlimited again: no waiting however much is read */
+	start = now_seconds();
+	for (int i = 0; i < 100; i++)
+		read_limit_charge(1 << 30);
+	ck_assert(now_seconds() - start < 0.1);
+}
+END_TEST
+
+/* 6 reads at 20 IOPS (burst of 2): about 0.2 s, whatever their size */
+START_TEST(test_read_limit_iops)
+{
+	double start;
+
+	read_limit_set(0, 20);
+	start = now_seconds();
+	for (int i = 0; i < 6; i++)
+		read_limit_charge(1);
+	ck_assert(now_seconds() - start >= 0.15);
+	read_limit_set(0, 0);
+}
+END_TEST
+
+START_TEST(test_parse_size_argument)
+{
+	uint64_t v = 0;
+
+	ck_assert(parse_size_argument("4096", &v, "--x"));
+	ck_assert_uint_eq(v, 4096);
+	ck_assert(parse_size_argument("200M", &v, "--x"));
+	ck_assert_uint_eq(v, 200ULL << 20);
+	ck_assert(parse_size_argument("1g", &v, "--x"));
+	ck_assert_uint_eq(v, 1ULL << 30);
+	ck_assert(!parse_size_argument("", &v, "--x"));
+	ck_assert(!parse_size_argument("-1", &v, "--x"));
+	ck_assert(!parse_size_argument("10MB", &v, "--x"));
+	ck_assert(!parse_size_argument("99999999999999999T", &v, "--x"));
+}
+END_TEST
+
+Suite *
+read_limit_suite(void)
+{
+	Suite *s = suite_create("read_limit");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_read_limit_rate);
+	tcase_add_test(tc, test_read_limit_iops);
+	tcase_add_test(tc, test_parse_size_argument);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
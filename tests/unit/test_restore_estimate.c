@@ -0,0 +1,178 @@
+/*
+ * test_restore_estimate.c
+ *
+ * Unit tests for the restore time model (src/common/restore_estimate.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pg_backup_auditor.h"
+#include "restore_estimate.h"
+
+#define MB  (1024.0 * 1024.0)
+#define SEG (16ULL * 1024 * 1024)
+
+static void
+set_backup(BackupInfo *b, const char *id, BackupType type, const char *parent,
+		   uint64_t bytes, time_t end, XLogRecPtr start_lsn, XLogRecPtr stop_lsn)
+{
+	memset(b, 0, sizeof(*b));
+	str_copy(b->backup_id, id, sizeof(b->backup_id));
+	if (parent != NULL)
+		str_copy(b->parent_backup_id, parent, sizeof(b->parent_backup_id));
+	b->type = type;
+	b->status = BACKUP_STATUS_OK;
+	b->data_bytes = bytes;
+	b->start_time = end - 60;
+	b->end_time = end;
+	b->start_lsn = start_lsn;
+	b->stop_lsn = stop_lsn;
+	b->timeline = 1;
+}
+
+/* Samples too small to mean anything are ignored; the rest are smoothed */
+START_TEST(test_throughput_update)
+{
+	RestoreThroughput tp;
+
+	memset(&tp, 0, sizeof(tp));
+	restore_throughput_update(&tp, 1024, 1.0, 64 * 1024 * 1024, 0.01, 100);
+	ck_assert(tp.data_rate == 0.0);
+	ck_assert(tp.wal_rate == 0.0);
+
+	restore_throughput_update(&tp, 200 * 1024 * 1024, 2.0, 0, 0.0, 100);
+	ck_assert(fabs(tp.data_rate - 100 * MB) < 1.0);
+	ck_assert_int_eq(tp.data_measured_at, 100);
+	ck_assert(tp.wal_rate == 0.0);
+
+	restore_throughput_update(&tp, 300 * 1024 * 1024, 1.0, 0, 0.0, 200);
+	ck_assert(fabs(tp.data_rate - (100 + RESTORE_RATE_ALPHA * 200) * MB) < 1.0);
+	ck_assert_int_eq(tp.data_measured_at, 200);
+}
+END_TEST
+
+/* Rates are kept per backup directory in the cache directory */
+START_TEST(test_throughput_persistence)
+{
+	char              dir[PATH_MAX];
+	char              cmd[PATH_MAX + 16];
+	RestoreThroughput tp, loaded;
+
+	memset(&tp, 0, sizeof(tp));
+	tp.data_rate = 123.0 * MB;
+	tp.wal_rate = 45.0 * MB;
+
+	validation_set_cache_dir(NULL);
+	ck_assert(!restore_throughput_save("/backups", &tp));
+	restore_throughput_load("/backups", &loaded);
+	ck_assert(loaded.data_rate == 0.0);
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_restore_est_test_%d", getpid());
+	ck_assert_int_eq(mkdir(dir, 0755), 0);
+	validation_set_cache_dir(dir);
+
+	ck_assert(restore_throughput_save("/backups", &tp));
+	restore_throughput_load("/backups", &loaded);
+	ck_assert(loaded.data_rate == tp.data_rate);
+	ck_assert(loaded.wal_rate == tp.wal_rate);
+	restore_throughput_load("/elsewhere", &loaded);
+	ck_assert(loaded.data_rate == 0.0);
+
+	validation_set_cache_dir(NULL);
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+END_TEST
+
+/* The latest backup, its ancestors and the WAL up to the end of its run */
+START_TEST(test_restore_estimate_chain)
+{
+	BackupInfo        full, incr1, incr2, failed, other;
+	BackupInfo       *members[5] = { &full, &incr1, &other, &incr2, &failed };
+	BackupChain       chain = { &full, members, 5, 5 };
+	WALSegmentRange   ranges[2] = {
+		{ 1, 10, 2, 0 },            /* segments 2..11 */
+		{ 1, 5, 20, 10 }            /* after a gap */
+	};
+	WALArchiveInfo    wal;
+	RestoreThroughput tp;
+	RestoreEstimate   est;
+
+	set_backup(&full, "F", BACKUP_TYPE_FULL, NULL, 1000 * 1024 * 1024, 1000,
+			   2 * SEG, 2 * SEG + 100);
+	set_backup(&incr1, "I1", BACKUP_TYPE_DELTA, "F", 100 * 1024 * 1024, 2000,
+			   3 * SEG, 3 * SEG + 100);
+	set_backup(&other, "I2", BACKUP_TYPE_DELTA, "F", 500 * 1024 * 1024, 2500,
+			   4 * SEG, 4 * SEG + 100);
+	set_backup(&incr2, "I3", BACKUP_TYPE_DELTA, "I1", 50 * 1024 * 1024, 3000,
+			   5 * SEG, 5 * SEG + 4096);
+	set_backup(&failed, "I4", BACKUP_TYPE_DELTA, "I3", 10, 4000, 6 * SEG, 6 * SEG);
+	failed.status = BACKUP_STATUS_ERROR;
+
+	/* No archive, nothing measured: the backup's own WAL at default rates */
+	ck_assert(restore_estimate_chain(&chain, NULL, NULL, 0.0, &est));
+	ck_assert_str_eq(est.backup->backup_id, "I3");
+	ck_assert_int_eq(est.backups, 3);
+	ck_assert_uint_eq(est.data_bytes, 1150 * 1024 * 1024);
+	ck_assert_uint_eq(est.wal_bytes, 4096);
+	ck_assert_int_eq(est.data_source, RATE_ASSUMED);
+	ck_assert(fabs(est.restore_seconds - 1150 * MB / RESTORE_DEFAULT_DATA_RATE) < 1e-9);
+
+	/* Replay runs to the end of the gapless run holding the stop LSN */
+	memset(&wal, 0, sizeof(wal));
+	wal.segment_count = 15;
+	wal.ranges = ranges;
+	wal.range_count = 2;
+	memset(&tp, 0, sizeof(tp));
+	tp.data_rate = 115.0 * MB;
+	tp.wal_rate = 32.0 * MB;
+	ck_assert(restore_estimate_chain(&chain, &wal, &tp, 0.0, &est));
+	ck_assert_uint_eq(est.replay_to, 12 * SEG);
+	ck_assert_uint_eq(est.wal_bytes, 7 * SEG);
+	ck_assert_int_eq(est.data_source, RATE_MEASURED);
+	ck_assert_int_eq(est.wal_source, RATE_MEASURED);
+	ck_assert(fabs(est.restore_seconds - 10.0) < 1e-9);
+	ck_assert(fabs(est.replay_seconds - 3.5) < 1e-9);
+
+	/* A given replay rate wins over the measured one */
+	ck_assert(restore_estimate_chain(&chain, &wal, &tp, 8.0 * MB, &est));
+	ck_assert_int_eq(est.wal_source, RATE_GIVEN);
+	ck_assert(fabs(est.replay_seconds - 14.0) < 1e-9);
+
+	/* A broken parent link still counts the root */
+	str_copy(incr2.parent_backup_id, "gone", sizeof(incr2.parent_backup_id));
+	ck_assert(restore_estimate_chain(&chain, NULL, NULL, 0.0, &est));
+	ck_assert_int_eq(est.backups, 2);
+	ck_assert_uint_eq(est.data_bytes, 1050 * 1024 * 1024);
+
+	/* Nothing completed, nothing to restore */
+	for (int i = 0; i < 5; i++)
+		members[i]->status = BACKUP_STATUS_RUNNING;
+	ck_assert(!restore_estimate_chain(&chain, NULL, NULL, 0.0, &est));
+}
+END_TEST
+
+Suite *
+restore_estimate_suite(void)
+{
+	Suite *s = suite_create("restore_estimate");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_throughput_update);
+	tcase_add_test(tc, test_throughput_persistence);
+	tcase_add_test(tc, test_restore_estimate_chain);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
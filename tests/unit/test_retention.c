@@ -0,0 +1,362 @@
+/*
+ * test_retention.c
+ *
+ * Unit tests for retention planning (src/common/retention.c) and
+ * check_retention_policy().
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pg_backup_auditor.h"
+#include "backup_chain.h"
+#include "retention.h"
+
+#define DAY     ((time_t) 86400)
+#define SEG     ((XLogRecPtr) 16 * 1024 * 1024)
+
+/*
+ * Prepend a backup with the fields retention looks at.  It ends an hour
+ * after it starts.
+ */
+static BackupInfo *
+mk(BackupInfo **head, const char *id, BackupType type, const char *parent,
+   time_t t, BackupStatus status, uint64_t bytes)
+{
+	BackupInfo *b = calloc(1, sizeof(*b));
+	strncpy(b->backup_id, id, sizeof(b->backup_id) - 1);
+	if (parent != NULL)
+		strncpy(b->parent_backup_id, parent, sizeof(b->parent_backup_id) - 1);
+	b->type = type;
+	b->status = status;
+	b->start_time = t;
+	b->end_time = t + 3600;
+	b->data_bytes = bytes;
+	b->next = *head;
+	*head = b;
+	return b;
+}
+
+static void
+free_list(BackupInfo *head)
+{
+	while (head != NULL)
+	{
+		BackupInfo *n = head->next;
+		free(head);
+		head = n;
+	}
+}
+
+/* Evaluate 'spec' against the chains of 'head' for the only instance */
+static RetentionInstanceResult
+evaluate_one(BackupInfo *head, const char *spec, time_t now)
+{
+	RetentionPolicy          policy;
+	RetentionInstanceResult  r;
+	int                      n = 0;
+	BackupChain             *c = backup_chain_build(head, &n);
+	RetentionPlan           *plan = retention_plan_build(c, n, NULL, now);
+
+	ck_assert(retention_policy_parse(spec, &policy));
+	ck_assert_ptr_nonnull(plan);
+	ck_assert_int_eq(plan->ninstances, 1);
+	retention_plan_evaluate(plan, &policy, &r, NULL);
+
+	retention_plan_free(plan);
+	backup_chain_free(c, n);
+	return r;
+}
+
+/* Four OK chains ten days apart; the second has an incremental two days in */
+static BackupInfo *
+four_chains(void)
+{
+	BackupInfo *head = NULL;
+
+	mk(&head, "F1", BACKUP_TYPE_FULL, NULL, 10 * DAY, BACKUP_STATUS_OK, 100);
+	mk(&head, "F2", BACKUP_TYPE_FULL, NULL, 20 * DAY, BACKUP_STATUS_OK, 100);
+	mk(&head, "I2", BACKUP_TYPE_DELTA, "F2", 22 * DAY, BACKUP_STATUS_OK, 10);
+	mk(&head, "F3", BACKUP_TYPE_FULL, NULL, 30 * DAY, BACKUP_STATUS_OK, 100);
+	mk(&head, "F4", BACKUP_TYPE_FULL, NULL, 40 * DAY, BACKUP_STATUS_OK, 100);
+	return head;
+}
+
+START_TEST(test_retention_parse)
+{
+	RetentionPolicy p;
+	char            buf[128];
+
+	ck_assert(retention_policy_parse("redundancy=2,window=7d,instance=main", &p));
+	ck_assert_int_eq(p.redundancy, 2);
+	ck_assert_int_eq(p.window, 7 * DAY);
+	ck_assert_str_eq(p.instance, "main");
+	retention_policy_format(&p, buf, sizeof(buf));
+	ck_assert_str_eq(buf, "redundancy 2, window 7d (main)");
+
+	ck_assert(retention_policy_parse("window=36h", &p));
+	ck_assert_int_eq(p.redundancy, 0);
+	retention_policy_format(&p, buf, sizeof(buf));
+	ck_assert_str_eq(buf, "window 36h");
+
+	ck_assert(!retention_policy_parse("", &p));
+	ck_assert(!retention_policy_parse("instance=main", &p));
+	ck_assert(!retention_policy_parse("redundancy=0", &p));
+	ck_assert(!retention_policy_parse("redundancy=two", &p));
+	ck_assert(!retention_policy_parse("window=soon", &p));
+	ck_assert(!retention_policy_parse("copies=3", &p));
+	ck_assert(!retention_policy_parse("redundancy", &p));
+}
+END_TEST
+
+/* redundancy keeps the newest N chains with an OK FULL */
+START_TEST(test_retention_redundancy)
+{
+	BackupInfo             *head = four_chains();
+	RetentionInstanceResult r;
+
+	r = evaluate_one(head, "redundancy=2", 50 * DAY);
+	ck_assert(r.met);
+	ck_assert_int_eq(r.keep_from, 2);
+	ck_assert_int_eq(r.chains, 2);
+	ck_assert_int_eq(r.backups, 3);
+	ck_assert_uint_eq(r.bytes, 210);
+
+	/* A failed FULL does not count towards the N */
+	for (BackupInfo *b = head; b != NULL; b = b->next)
+		if (strcmp(b->backup_id, "F3") == 0)
+			b->status = BACKUP_STATUS_ERROR;
+	r = evaluate_one(head, "redundancy=2", 50 * DAY);
+	ck_assert(r.met);
+	ck_assert_int_eq(r.keep_from, 1);
+	ck_assert_int_eq(r.backups, 1);
+
+	/* Not enough OK chains: everything is kept */
+	r = evaluate_one(head, "redundancy=5", 50 * DAY);
+	ck_assert(!r.met);
+	ck_assert_int_eq(r.keep_from, 0);
+	ck_assert_uint_eq(r.bytes, 0);
+
+	free_list(head);
+}
+END_TEST
+
+/* window keeps the chain that restores to its start, and later ones */
+START_TEST(test_retention_window)
+{
+	BackupInfo             *head = four_chains();
+	RetentionInstanceResult r;
+
+	/* Window from day 33: F3 restores to it */
+	r = evaluate_one(head, "window=12d", 45 * DAY);
+	ck_assert(r.met);
+	ck_assert_int_eq(r.keep_from, 2);
+
+	/* Window from day 21: F2 finished before it and I2 within */
+	r = evaluate_one(head, "window=24d", 45 * DAY);
+	ck_assert_int_eq(r.keep_from, 1);
+
+	/* Nothing finished before day -5 */
+	r = evaluate_one(head, "window=50d", 45 * DAY);
+	ck_assert(!r.met);
+	ck_assert_int_eq(r.keep_from, 0);
+
+	/* Either rule keeps a chain */
+	r = evaluate_one(head, "window=12d,redundancy=3", 45 * DAY);
+	ck_assert(r.met);
+	ck_assert_int_eq(r.keep_from, 1);
+
+	/* An older chain with a backup in the window is kept as well */
+	mk(&head, "I1", BACKUP_TYPE_DELTA, "F1", 34 * DAY, BACKUP_STATUS_OK, 10);
+	r = evaluate_one(head, "window=12d", 45 * DAY);
+	ck_assert(r.met);
+	ck_assert_int_eq(r.keep_from, 0);
+
+	free_list(head);
+}
+END_TEST
+
+/* instance=NAME leaves the other instances alone */
+START_TEST(test_retention_per_instance)
+{
+	BackupInfo              *head = NULL;
+	RetentionPolicy          policy;
+	RetentionInstanceResult  r[2];
+	int                      n = 0;
+
+	strcpy(mk(&head, "A1", BACKUP_TYPE_FULL, NULL, 1 * DAY, BACKUP_STATUS_OK, 1)->instance_name, "a");
+	strcpy(mk(&head, "A2", BACKUP_TYPE_FULL, NULL, 2 * DAY, BACKUP_STATUS_OK, 1)->instance_name, "a");
+	strcpy(mk(&head, "B1", BACKUP_TYPE_FULL, NULL, 1 * DAY, BACKUP_STATUS_OK, 1)->instance_name, "b");
+	strcpy(mk(&head, "B2", BACKUP_TYPE_FULL, NULL, 2 * DAY, BACKUP_STATUS_OK, 1)->instance_name, "b");
+	/* An orphan is no chain of either */
+	strcpy(mk(&head, "X", BACKUP_TYPE_DELTA, "gone", 3 * DAY, BACKUP_STATUS_OK, 1)->instance_name, "a");
+
+	BackupChain   *c = backup_chain_build(head, &n);
+	RetentionPlan *plan = retention_plan_build(c, n, NULL, 10 * DAY);
+
+	ck_assert_ptr_nonnull(plan);
+	ck_assert_int_eq(plan->ninstances, 2);
+	ck_assert_str_eq(plan->instances[0].instance, "a");
+	ck_assert_int_eq(plan->instances[0].nchains, 2);
+
+	ck_assert(retention_policy_parse("redundancy=1,instance=a", &policy));
+	retention_plan_evaluate(plan, &policy, r, NULL);
+	ck_assert_int_eq(r[0].keep_from, 1);
+	ck_assert_int_eq(r[1].keep_from, 0);
+
+	ck_assert(retention_policy_parse("redundancy=1", &policy));
+	retention_plan_evaluate(plan, &policy, r, NULL);
+	ck_assert_int_eq(r[0].keep_from, 1);
+	ck_assert_int_eq(r[1].keep_from, 1);
+
+	retention_plan_free(plan);
+	backup_chain_free(c, n);
+	free_list(head);
+}
+END_TEST
+
+static int
+compare_bindings(const void *a, const void *b)
+{
+	const WALArchiveBinding *ba = a;
+	const WALArchiveBinding *bb = b;
+
+	return (ba->backup > bb->backup) - (ba->backup < bb->backup);
+}
+
+/* WAL below the oldest kept start LSN is expendable, not its segment */
+START_TEST(test_retention_wal)
+{
+	BackupInfo              *head = NULL;
+	BackupInfo              *f1, *f2;
+	WALSegmentName           segs[6];
+	WALSegmentStat           stats[6];
+	WALArchiveInfo           info;
+	WALArchiveSetEntry       entry;
+	WALArchiveBinding        bind[2];
+	WALArchiveSet            set;
+	RetentionPolicy          policy;
+	RetentionInstanceResult  r;
+	RetentionArchiveResult   a;
+	int                      n = 0;
+
+	f1 = mk(&head, "F1", BACKUP_TYPE_FULL, NULL, 1 * DAY, BACKUP_STATUS_OK, 1);
+	f2 = mk(&head, "F2", BACKUP_TYPE_FULL, NULL, 2 * DAY, BACKUP_STATUS_OK, 1);
+	f1->start_lsn = 2 * SEG + 100;
+	f2->start_lsn = 4 * SEG + 5;
+
+	/* Segments 1..6 of timeline 1, listed newest first */
+	memset(&info, 0, sizeof(info));
+	for (int i = 0; i < 6; i++)
+	{
+		segs[i].timeline = 1;
+		segs[i].log_id = 0;
+		segs[i].seg_id = 6 - i;
+		stats[i].size = 100 + i;
+		stats[i].mtime = 0;
+	}
+	info.segments = segs;
+	info.stats = stats;
+	info.segment_count = 6;
+
+	memset(&entry, 0, sizeof(entry));
+	strcpy(entry.path, "/wal");
+	entry.info = &info;
+	bind[0].backup = f1;
+	bind[0].archive = 0;
+	bind[1].backup = f2;
+	bind[1].archive = 0;
+	qsort(bind, 2, sizeof(bind[0]), compare_bindings);
+	set.archives = &entry;
+	set.count = 1;
+	set.bindings = bind;
+	set.binding_count = 2;
+
+	BackupChain   *c = backup_chain_build(head, &n);
+	RetentionPlan *plan = retention_plan_build(c, n, &set, 10 * DAY);
+	ck_assert_ptr_nonnull(plan);
+	ck_assert_int_eq(plan->narchives, 1);
+	ck_assert_int_eq(plan->instances[0].archive, 0);
+
+	/* Nothing expired: segment 1 only, segment 2 holds F1's start */
+	retention_plan_evaluate(plan, NULL, &r, &a);
+	ck_assert_int_eq(r.keep_from, 0);
+	ck_assert_int_eq(a.segments, 1);
+	ck_assert_uint_eq(a.bytes, 105);
+	ck_assert_uint_eq(a.from, 1 * SEG);
+	ck_assert_uint_eq(a.keep_from, 2 * SEG);
+
+	/* F1 expires: segments 1..3 */
+	ck_assert(retention_policy_parse("redundancy=1", &policy));
+	retention_plan_evaluate(plan, &policy, &r, &a);
+	ck_assert_int_eq(r.keep_from, 1);
+	ck_assert_int_eq(a.segments, 3);
+	ck_assert_uint_eq(a.bytes, 105 + 104 + 103);
+	ck_assert_uint_eq(a.keep_from, 4 * SEG);
+
+	/* An unknown start LSN holds all WAL */
+	f2->start_lsn = 0;
+	retention_plan_free(plan);
+	plan = retention_plan_build(c, n, &set, 10 * DAY);
+	retention_plan_evaluate(plan, &policy, &r, &a);
+	ck_assert_int_eq(a.segments, 0);
+	ck_assert_uint_eq(a.bytes, 0);
+
+	retention_plan_free(plan);
+	backup_chain_free(c, n);
+	free_list(head);
+}
+END_TEST
+
+START_TEST(test_check_retention_policy)
+{
+	BackupInfo       *head = NULL;
+	time_t            now  = time(NULL);
+	ValidationResult *res;
+
+	ck_assert_ptr_null(check_retention_policy(NULL, 7, 4));
+
+	mk(&head, "F1", BACKUP_TYPE_FULL, NULL, now - 20 * DAY - 3600, BACKUP_STATUS_OK, 1);
+	mk(&head, "F2", BACKUP_TYPE_FULL, NULL, now - 3 * DAY - 3600, BACKUP_STATUS_OK, 1);
+
+	res = check_retention_policy(head, 7, 0);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->warning_count, 0);
+	ck_assert_int_eq(res->status, BACKUP_STATUS_OK);
+	free_validation_result(res);
+
+	/* Weeks 1 and 3 have no backup */
+	res = check_retention_policy(head, 7, 4);
+	ck_assert_int_eq(res->warning_count, 2);
+	ck_assert_int_eq(res->status, BACKUP_STATUS_WARNING);
+	free_validation_result(res);
+
+	res = check_retention_policy(head, 30, 0);
+	ck_assert_int_eq(res->warning_count, 1);
+	free_validation_result(res);
+
+	free_list(head);
+}
+END_TEST
+
+Suite *
+retention_suite(void)
+{
+	Suite *s = suite_create("retention");
+	TCase *tc = tcase_create("core");
+
+	tcase_add_test(tc, test_retention_parse);
+	tcase_add_test(tc, test_retention_redundancy);
+	tcase_add_test(tc, test_retention_window);
+	tcase_add_test(tc, test_retention_per_instance);
+	tcase_add_test(tc, test_retention_wal);
+	tcase_add_test(tc, test_check_retention_policy);
+	suite_add_tcase(s, tc);
+	return s;
+}
@@ -36,6 +36,8 @@ extern Suite *backup_validator_suite(void);
 extern Suite *fs_scanner_suite(void);
 extern Suite *pg_probackup_suite(void);
 extern Suite *crc32c_suite(void);
+extern Suite *page_checksum_suite(void);
+extern Suite *incremental_backup_suite(void);
 extern Suite *pg_basebackup_validator_suite(void);
 extern Suite *pg_probackup_validator_suite(void);
 extern Suite *pgbackrest_validator_suite(void);
@@ -43,6 +45,33 @@ extern Suite *file_utils_suite(void);
 extern Suite *anomaly_detection_suite(void);
 extern Suite *arg_parser_suite(void);
 extern Suite *backup_chain_suite(void);
+extern Suite *backup_catalog_suite(void);
+extern Suite *backup_stats_suite(void);
+extern Suite *anomaly_detector_suite(void);
+extern Suite *restore_estimate_suite(void);
+extern Suite *retention_suite(void);
+extern Suite *storage_suite(void);
+extern Suite *verify_jobs_suite(void);
+extern Suite *sha1_suite(void);
+extern Suite *sha256_suite(void);
+extern Suite *tar_reader_suite(void);
+extern Suite *decompress_suite(void);
+extern Suite *wal_cache_suite(void);
+extern Suite *digest_cache_suite(void);
+extern Suite *catalog_index_suite(void);
+extern Suite *wal_archive_set_suite(void);
+extern Suite *backup_manifest_suite(void);
+extern Suite *json_scan_suite(void);
+extern Suite *validation_result_suite(void);
+extern Suite *async_read_suite(void);
+extern Suite *read_limit_suite(void);
+extern Suite *buffer_pool_suite(void);
+extern Suite *verify_sample_suite(void);
+extern Suite *verify_shard_suite(void);
+extern Suite *ndjson_suite(void);
+extern Suite *fs_watch_suite(void);
+extern Suite *metrics_suite(void);
+extern Suite *logging_suite(void);
 
 int
 main(void)
@@ -65,6 +94,8 @@ main(void)
 	srunner_add_suite(sr, fs_scanner_suite());
 	srunner_add_suite(sr, pg_probackup_suite());
 	srunner_add_suite(sr, crc32c_suite());
+	srunner_add_suite(sr, page_checksum_suite());
+	srunner_add_suite(sr, incremental_backup_suite());
 	srunner_add_suite(sr, pg_basebackup_validator_suite());
 	srunner_add_suite(sr, pg_probackup_validator_suite());
 	srunner_add_suite(sr, pgbackrest_validator_suite());
@@ -72,6 +103,33 @@ main(void)
 	srunner_add_suite(sr, anomaly_detection_suite());
 	srunner_add_suite(sr, arg_parser_suite());
 	srunner_add_suite(sr, backup_chain_suite());
+	srunner_add_suite(sr, backup_catalog_suite());
+	srunner_add_suite(sr, backup_stats_suite());
+	srunner_add_suite(sr, anomaly_detector_suite());
+	srunner_add_suite(sr, restore_estimate_suite());
+	srunner_add_suite(sr, retention_suite());
+	srunner_add_suite(sr, storage_suite());
+	srunner_add_suite(sr, verify_jobs_suite());
+	srunner_add_suite(sr, sha1_suite());
+	srunner_add_suite(sr, sha256_suite());
+	srunner_add_suite(sr, tar_reader_suite());
+	srunner_add_suite(sr, decompress_suite());
+	srunner_add_suite(sr, wal_cache_suite());
+	srunner_add_suite(sr, digest_cache_suite());
+	srunner_add_suite(sr, catalog_index_suite());
+	srunner_add_suite(sr, wal_archive_set_suite());
+	srunner_add_suite(sr, backup_manifest_suite());
+	srunner_add_suite(sr, json_scan_suite());
+	srunner_add_suite(sr, validation_result_suite());
+	srunner_add_suite(sr, async_read_suite());
+	srunner_add_suite(sr, read_limit_suite());
+	srunner_add_suite(sr, buffer_pool_suite());
+	srunner_add_suite(sr, verify_sample_suite());
+	srunner_add_suite(sr, verify_shard_suite());
+	srunner_add_suite(sr, ndjson_suite());
+	srunner_add_suite(sr, fs_watch_suite());
+	srunner_add_suite(sr, metrics_suite());
+	srunner_add_suite(sr, logging_suite());
 
 	/* Run tests */
 	srunner_run_all(sr, CK_NORMAL);
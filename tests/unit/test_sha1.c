@@ -0,0 +1,163 @@
+/*
+ * test_sha1.c
+ *
+ * Unit tests for the SHA-1 module
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "sha1.h"
+
+static void
+sha1_hex_of(const void *data, size_t len, char hex[SHA1_HEX_LENGTH + 1])
+{
+	SHA1Ctx ctx;
+	uint8_t digest[SHA1_DIGEST_LENGTH];
+
+	sha1_init(&ctx);
+	sha1_update(&ctx, data, len);
+	sha1_final(&ctx, digest);
+	sha1_to_hex(digest, hex);
+}
+
+/* Test: FIPS 180 example vectors */
+START_TEST(test_sha1_known_vectors)
+{
+	char hex[SHA1_HEX_LENGTH + 1];
+
+	sha1_hex_of("", 0, hex);
+	ck_assert_str_eq(hex, "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+
+	sha1_hex_of("abc", 3, hex);
+	ck_assert_str_eq(hex, "a9993e364706816aba3e25717850c26c9cd0d89d");
+
+	const char *two_block =
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	sha1_hex_of(two_block, strlen(two_block), hex);
+	ck_assert_str_eq(hex, "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+}
+END_TEST
+
+/* Test: one million 'a' fed in odd-sized pieces */
+START_TEST(test_sha1_million_a)
+{
+	SHA1Ctx ctx;
+	uint8_t buf[997];
+	uint8_t digest[SHA1_DIGEST_LENGTH];
+	char    hex[SHA1_HEX_LENGTH + 1];
+	size_t  left = 1000000;
+
+	memset(buf, 'a', sizeof(buf));
+	sha1_init(&ctx);
+	while (left > 0)
+	{
+		size_t n = left < sizeof(buf) ? left : sizeof(buf);
+		sha1_update(&ctx, buf, n);
+		left -= n;
+	}
+	sha1_final(&ctx, digest);
+	sha1_to_hex(digest, hex);
+	ck_assert_str_eq(hex, "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+}
+END_TEST
+
+/* Test: selected block function matches the portable one */
+START_TEST(test_sha1_impl_matches_generic)
+{
+	uint8_t  data[64 * 9];
+	uint32_t ref[5] = {0x67452301, 0xefcdab89, 0x98badcfe,
+					   0x10325476, 0xc3d2e1f0};
+	SHA1Ctx  ctx;
+	uint8_t  digest[SHA1_DIGEST_LENGTH];
+
+	for (size_t i = 0; i < sizeof(data); i++)
+		data[i] = (uint8_t) (i * 37 + 11);
+
+	ck_assert(strcmp(sha1_implementation(), "sha-ni") == 0 ||
+			  strcmp(sha1_implementation(), "generic") == 0);
+
+	/* Hash 9 full blocks via the public API, then read back the state */
+	sha1_init(&ctx);
+	sha1_update(&ctx, data, sizeof(data));
+	sha1_blocks_generic(ref, data, 9);
+	for (int i = 0; i < 5; i++)
+		ck_assert_uint_eq(ctx.state[i], ref[i]);
+
+	/* And every length up to two blocks through final() */
+	for (size_t len = 0; len <= 128; len++)
+	{
+		char a[SHA1_HEX_LENGTH + 1];
+		char b[SHA1_HEX_LENGTH + 1];
+
+		sha1_hex_of(data, len, a);
+
+		/* byte-at-a-time exercises the partial-block path */
+		sha1_init(&ctx);
+		for (size_t i = 0; i < len; i++)
+			sha1_update(&ctx, data + i, 1);
+		sha1_final(&ctx, digest);
+		sha1_to_hex(digest, b);
+		ck_assert_str_eq(a, b);
+	}
+}
+END_TEST
+
+/* Test: sha1_file on a small file and on a missing file */
+START_TEST(test_sha1_file)
+{
+	char    path[64];
+	uint8_t digest[SHA1_DIGEST_LENGTH];
+	char    hex[SHA1_HEX_LENGTH + 1];
+	FILE   *fp;
+
+	snprintf(path, sizeof(path), "/tmp/pg_sha1_test_%d", getpid());
+	fp = fopen(path, "wb");
+	ck_assert_ptr_nonnull(fp);
+	fputs("abc", fp);
+	fclose(fp);
+
+	ck_assert(sha1_file(path, digest));
+	sha1_to_hex(digest, hex);
+	ck_assert_str_eq(hex, "a9993e364706816aba3e25717850c26c9cd0d89d");
+	unlink(path);
+
+	ck_assert(!sha1_file("/tmp/this_file_does_not_exist_xyz", digest));
+}
+END_TEST
+
+Suite *
+sha1_suite(void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("SHA1");
+
+	tc_core = tcase_create("core");
+	tcase_add_test(tc_core, test_sha1_known_vectors);
+	tcase_add_test(tc_core, test_sha1_million_a);
+	tcase_add_test(tc_core, test_sha1_impl_matches_generic);
+	tcase_add_test(tc_core, test_sha1_file);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
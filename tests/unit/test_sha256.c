@@ -0,0 +1,169 @@
+/*
+ * test_sha256.c
+ *
+ * Unit tests for the SHA-256 module
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "sha256.h"
+
+static void
+sha256_hex_of(const void *data, size_t len, char hex[SHA256_HEX_LENGTH + 1])
+{
+	SHA256Ctx ctx;
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, len);
+	sha256_final(&ctx, digest);
+	sha256_to_hex(digest, hex);
+}
+
+/* Test: FIPS 180 example vectors */
+START_TEST(test_sha256_known_vectors)
+{
+	char hex[SHA256_HEX_LENGTH + 1];
+
+	sha256_hex_of("", 0, hex);
+	ck_assert_str_eq(hex, "e3b0c44298fc1c149afbf4c8996fb924"
+					 "27ae41e4649b934ca495991b7852b855");
+
+	sha256_hex_of("abc", 3, hex);
+	ck_assert_str_eq(hex, "ba7816bf8f01cfea414140de5dae2223"
+					 "b00361a396177a9cb410ff61f20015ad");
+
+	const char *two_block =
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	sha256_hex_of(two_block, strlen(two_block), hex);
+	ck_assert_str_eq(hex, "248d6a61d20638b8e5c026930c3e6039"
+					 "a33ce45964ff2167f6ecedd419db06c1");
+}
+END_TEST
+
+/* Test: one million 'a' fed in odd-sized pieces */
+START_TEST(test_sha256_million_a)
+{
+	SHA256Ctx ctx;
+	uint8_t buf[997];
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+	char    hex[SHA256_HEX_LENGTH + 1];
+	size_t  left = 1000000;
+
+	memset(buf, 'a', sizeof(buf));
+	sha256_init(&ctx);
+	while (left > 0)
+	{
+		size_t n = left < sizeof(buf) ? left : sizeof(buf);
+		sha256_update(&ctx, buf, n);
+		left -= n;
+	}
+	sha256_final(&ctx, digest);
+	sha256_to_hex(digest, hex);
+	ck_assert_str_eq(hex, "cdc76e5c9914fb9281a1c7e284d73e67"
+					 "f1809a48a497200e046d39ccc7112cd0");
+}
+END_TEST
+
+/* Test: selected block function matches the portable one */
+START_TEST(test_sha256_impl_matches_generic)
+{
+	uint8_t  data[64 * 9];
+	uint32_t ref[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+					   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+	SHA256Ctx  ctx;
+	uint8_t  digest[SHA256_DIGEST_LENGTH];
+
+	for (size_t i = 0; i < sizeof(data); i++)
+		data[i] = (uint8_t) (i * 37 + 11);
+
+	ck_assert(strcmp(sha256_implementation(), "sha-ni") == 0 ||
+			  strcmp(sha256_implementation(), "armv8") == 0 ||
+			  strcmp(sha256_implementation(), "generic") == 0);
+
+	/* Hash 9 full blocks via the public API, then read back the state */
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, sizeof(data));
+	sha256_blocks_generic(ref, data, 9);
+	for (int i = 0; i < 8; i++)
+		ck_assert_uint_eq(ctx.state[i], ref[i]);
+
+	/* And every length up to two blocks through final() */
+	for (size_t len = 0; len <= 128; len++)
+	{
+		char a[SHA256_HEX_LENGTH + 1];
+		char b[SHA256_HEX_LENGTH + 1];
+
+		sha256_hex_of(data, len, a);
+
+		/* byte-at-a-time exercises the partial-block path */
+		sha256_init(&ctx);
+		for (size_t i = 0; i < len; i++)
+			sha256_update(&ctx, data + i, 1);
+		sha256_final(&ctx, digest);
+		sha256_to_hex(digest, b);
+		ck_assert_str_eq(a, b);
+	}
+}
+END_TEST
+
+/* Test: sha256_file on a small file and on a missing file */
+START_TEST(test_sha256_file)
+{
+	char    path[64];
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+	char    hex[SHA256_HEX_LENGTH + 1];
+	FILE   *fp;
+
+	snprintf(path, sizeof(path), "/tmp/pg_sha256_test_%d", getpid());
+	fp = fopen(path, "wb");
+	ck_assert_ptr_nonnull(fp);
+	fputs("abc", fp);
+	fclose(fp);
+
+	ck_assert(sha256_file(path, digest));
+	sha256_to_hex(digest, hex);
+	ck_assert_str_eq(hex, "ba7816bf8f01cfea414140de5dae2223"
+					 "b00361a396177a9cb410ff61f20015ad");
+	unlink(path);
+
+	ck_assert(!sha256_file("/tmp/this_file_does_not_exist_xyz", digest));
+}
+END_TEST
+
+Suite *
+sha256_suite(void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("SHA256");
+
+	tc_core = tcase_create("core");
+	tcase_add_test(tc_core, test_sha256_known_vectors);
+	tcase_add_test(tc_core, test_sha256_million_a);
+	tcase_add_test(tc_core, test_sha256_impl_matches_generic);
+	tcase_add_test(tc_core, test_sha256_file);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
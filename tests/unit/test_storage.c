@@ -0,0 +1,353 @@
+/*
+ * test_storage.c
+ *
+ * Unit tests for object storage locations and staging
+ * (src/common/storage.c, src/common/storage_s3.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pg_backup_auditor.h"
+#include "storage.h"
+
+typedef struct {
+	int         count;
+	char        keys[4][64];
+	uint64_t    sizes[4];
+	time_t      mtimes[4];
+	char        etags[4][STORAGE_ETAG_LEN];
+} Listed;
+
+static bool
+remember(void *arg, const StorageObject *object)
+{
+	Listed *l = arg;
+
+	if (l->count == 4)
+		return false;
+	str_copy(l->keys[l->count], object->key, sizeof(l->keys[0]));
+	l->sizes[l->count] = object->size;
+	l->mtimes[l->count] = object->mtime;
+	str_copy(l->etags[l->count], object->etag, sizeof(l->etags[0]));
+	l->count++;
+	return true;
+}
+
+static void
+write_file(const char *dir, const char *name, size_t size, char fill)
+{
+	char  path[PATH_MAX];
+	char *buf = malloc(size > 0 ? size : 1);
+	FILE *fp;
+
+	memset(buf, fill, size);
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	fp = fopen(path, "wb");
+	ck_assert_ptr_nonnull(fp);
+	ck_assert_uint_eq(fwrite(buf, 1, size, fp), size);
+	fclose(fp);
+	free(buf);
+}
+
+/* The first byte of 'name' in 'dir' that is not 'fill', or -1 */
+static long
+first_other_byte(const char *dir, const char *name, char fill)
+{
+	char  path[PATH_MAX];
+	FILE *fp;
+	int   c;
+	long  pos = 0;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	fp = fopen(path, "rb");
+	ck_assert_ptr_nonnull(fp);
+	while ((c = fgetc(fp)) != EOF && c == (unsigned char) fill)
+		pos++;
+	fclose(fp);
+	return c == EOF ? -1 : pos;
+}
+
+/* URLs split into driver, bucket and prefix; local paths are not URLs */
+START_TEST(test_storage_location)
+{
+	StorageLocation loc;
+
+	ck_assert(!storage_is_remote("/var/lib/backups"));
+	ck_assert(!storage_is_remote("backups"));
+	ck_assert(!storage_is_remote(NULL));
+	ck_assert(storage_is_remote("s3://bucket"));
+	ck_assert(storage_is_remote("az://container/path"));
+
+	ck_assert(storage_parse_location("s3://bucket/pgbackrest/repo1/", &loc));
+	ck_assert_ptr_eq(loc.driver, &storage_s3_driver);
+	ck_assert_str_eq(loc.bucket, "bucket");
+	ck_assert_str_eq(loc.prefix, "pgbackrest/repo1/");
+	ck_assert_str_eq(loc.url, "s3://bucket/pgbackrest/repo1");
+
+	ck_assert(storage_parse_location("gs://bucket", &loc));
+	ck_assert_ptr_eq(loc.driver, &storage_gcs_driver);
+	ck_assert_str_eq(loc.bucket, "bucket");
+	ck_assert_str_eq(loc.prefix, "");
+
+	ck_assert(storage_parse_location("file:///tmp/repo/", &loc));
+	ck_assert_ptr_eq(loc.driver, &storage_file_driver);
+	ck_assert_str_eq(loc.prefix, "/tmp/repo");
+
+	ck_assert(!storage_parse_location("s3://", &loc));
+	ck_assert(!storage_parse_location("s3:///prefix", &loc));
+	ck_assert(!storage_parse_location("file://relative", &loc));
+	ck_assert(!storage_parse_location("az://container/path", &loc));
+	ck_assert(!storage_parse_location("/tmp/repo", &loc));
+}
+END_TEST
+
+/* ListObjectsV2 pages: objects, escaping, continuation token */
+START_TEST(test_storage_parse_list)
+{
+	static const char page[] =
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<ListBucketResult xmlns=\"http://s3.amazonaws.com/doc/2006-03-01/\">"
+		"<Name>bucket</Name><Prefix>repo/</Prefix><KeyCount>3</KeyCount>"
+		"<MaxKeys>1000</MaxKeys><IsTruncated>true</IsTruncated>"
+		"<Contents><Key>repo/</Key><Size>0</Size></Contents>"
+		"<Contents><Key>repo/backup/main/backup.info</Key>"
+		"<LastModified>2026-01-02T03:04:05.000Z</LastModified>"
+		"<ETag>&quot;9b2cf535f27731c974343645a3985328&quot;</ETag>"
+		"<Size>1234</Size><StorageClass>STANDARD</StorageClass></Contents>"
+		"<Contents><Key>repo/a&amp;b &#233;.txt</Key>"
+		"<LastModified>1970-01-01T00:01:00Z</LastModified>"
+		"<Size>7</Size></Contents>"
+		"<NextContinuationToken>1ueGcxLPRx1Tr/XYExHnhbYLgveDs2J/wm36Hy4vbOwM=</NextContinuationToken>"
+		"</ListBucketResult>";
+	static const char last[] =
+		"<ListBucketResult><IsTruncated>false</IsTruncated></ListBucketResult>";
+	Listed l;
+	char   token[128];
+
+	memset(&l, 0, sizeof(l));
+	ck_assert_int_eq(storage_s3_parse_list(page, strlen(page), strlen("repo/"),
+										   remember, &l, token, sizeof(token)), 2);
+	ck_assert_int_eq(l.count, 2);
+	ck_assert_str_eq(l.keys[0], "backup/main/backup.info");
+	ck_assert_uint_eq(l.sizes[0], 1234);
+	ck_assert_int_eq(l.mtimes[0], 1767323045);
+	ck_assert_str_eq(l.etags[0], "9b2cf535f27731c974343645a3985328");
+	ck_assert_str_eq(l.keys[1], "a&b \xc3\xa9.txt");
+	ck_assert_int_eq(l.mtimes[1], 60);
+	ck_assert_str_eq(l.etags[1], "");
+	ck_assert_str_eq(token, "1ueGcxLPRx1Tr/XYExHnhbYLgveDs2J/wm36Hy4vbOwM=");
+
+	ck_assert_int_eq(storage_s3_parse_list(last, strlen(last), 0, remember, &l,
+										   token, sizeof(token)), 0);
+	ck_assert_str_eq(token, "");
+
+	/* An error document is not a listing */
+	ck_assert_int_eq(storage_s3_parse_list("<Error><Code>NoSuchBucket</Code></Error>", 40,
+										   0, remember, &l, token, sizeof(token)), -1);
+}
+END_TEST
+
+/* Metadata staging leaves data as placeholders; deeper staging fills them */
+START_TEST(test_storage_stage)
+{
+	char        root[64];
+	char        repo[PATH_MAX];
+	char        cache[PATH_MAX];
+	char        url[PATH_MAX + 8];
+	char        cmd[PATH_MAX];
+	char        state[PATH_MAX];
+	const char *mirror;
+	const char *again;
+	struct stat st;
+	size_t      big = STORAGE_INLINE_SIZE + 4096;
+	size_t      huge = STORAGE_PART_SIZE + 12345;
+
+	snprintf(root, sizeof(root), "/tmp/pg_storage_test_%d", getpid());
+	snprintf(repo, sizeof(repo), "%s/repo", root);
+	snprintf(cache, sizeof(cache), "%s/cache", root);
+	ck_assert_int_eq(mkdir(root, 0755), 0);
+	ck_assert_int_eq(mkdir(repo, 0755), 0);
+	ck_assert_int_eq(mkdir(cache, 0755), 0);
+	snprintf(cmd, sizeof(cmd), "%s/backup", repo);
+	ck_assert_int_eq(mkdir(cmd, 0755), 0);
+	snprintf(cmd, sizeof(cmd), "%s/wal", repo);
+	ck_assert_int_eq(mkdir(cmd, 0755), 0);
+
+	write_file(repo, "backup/backup.control", 300, 'c');
+	write_file(repo, "backup/backup_content.control", big, 'm');
+	write_file(repo, "backup/datafile", big, 'd');
+	write_file(repo, "backup/hugefile", huge, 'h');
+	write_file(repo, "backup/empty", 0, 'e');
+	write_file(repo, "wal/000000010000000000000001", 2 * STORAGE_HEAD_SIZE, 'w');
+	write_file(repo, "wal/000000010000000000000002", 2 * STORAGE_HEAD_SIZE, 'x');
+	write_file(repo, "wal/000000010000000000000003.gz", 2 * STORAGE_HEAD_SIZE, 'z');
+
+	validation_set_cache_dir(cache);
+	snprintf(url, sizeof(url), "file://%s", repo);
+	mirror = storage_stage(url, STAGE_METADATA);
+	ck_assert_ptr_nonnull(mirror);
+	ck_assert(strncmp(mirror, cache, strlen(cache)) == 0);
+
+	/* Small and metadata files are copied, data only sized */
+	ck_assert_int_eq(first_other_byte(mirror, "backup/backup.control", 'c'), -1);
+	ck_assert_int_eq(first_other_byte(mirror, "backup/backup_content.control", 'm'), -1);
+	ck_assert_int_eq(first_other_byte(mirror, "backup/datafile", '\0'), -1);
+	snprintf(cmd, sizeof(cmd), "%s/backup/datafile", mirror);
+	ck_assert_int_eq(stat(cmd, &st), 0);
+	ck_assert_uint_eq((uint64_t) st.st_size, big);
+	snprintf(cmd, sizeof(cmd), "%s/backup/empty", mirror);
+	ck_assert_int_eq(stat(cmd, &st), 0);
+	ck_assert_int_eq(st.st_size, 0);
+
+	/* The first WAL segment's head is there (for the segment size), the rest not */
+	ck_assert_int_eq(first_other_byte(mirror, "wal/000000010000000000000001", 'w'),
+					 STORAGE_HEAD_SIZE);
+	ck_assert_int_eq(first_other_byte(mirror, "wal/000000010000000000000002", '\0'), -1);
+
+	ck_assert_int_eq(first_other_byte(mirror, "wal/000000010000000000000003.gz", '\0'), -1);
+
+	/* Staged already: the same mirror, nothing listed again */
+	ck_assert_ptr_eq(storage_stage(url, STAGE_METADATA), mirror);
+
+	/* WAL headers: the first page of each segment, more of a compressed one */
+	again = storage_stage(url, STAGE_WAL_HEADERS);
+	ck_assert_ptr_nonnull(again);
+	ck_assert_str_eq(again, mirror);
+	ck_assert_int_eq(first_other_byte(again, "wal/000000010000000000000002", 'x'),
+					 STORAGE_PAGE_SIZE);
+	ck_assert_int_eq(first_other_byte(again, "wal/000000010000000000000003.gz", 'z'),
+					 STORAGE_HEAD_SIZE);
+	ck_assert_int_eq(first_other_byte(again, "backup/datafile", '\0'), -1);
+
+	/* Content: everything, the large file in ranged parts */
+	again = storage_stage(url, STAGE_CONTENT);
+	ck_assert_ptr_nonnull(again);
+	ck_assert_str_eq(again, mirror);
+	ck_assert_int_eq(first_other_byte(again, "backup/datafile", 'd'), -1);
+	ck_assert_int_eq(first_other_byte(again, "backup/hugefile", 'h'), -1);
+	ck_assert_int_eq(first_other_byte(again, "wal/000000010000000000000001", 'w'), -1);
+	ck_assert_int_eq(first_other_byte(again, "wal/000000010000000000000002", 'x'), -1);
+	ck_assert_int_eq(first_other_byte(again, "wal/000000010000000000000003.gz", 'z'), -1);
+	snprintf(cmd, sizeof(cmd), "%s/backup/hugefile", again);
+	ck_assert_int_eq(stat(cmd, &st), 0);
+	ck_assert_uint_eq((uint64_t) st.st_size, huge);
+
+	/* What the mirror holds is recorded beside it */
+	snprintf(state, sizeof(state), "%s.state", again);
+	ck_assert_int_eq(stat(state, &st), 0);
+	ck_assert_int_gt(st.st_size, 0);
+
+	/* Locations that cannot be staged */
+	ck_assert_ptr_null(storage_stage("az://container/path", STAGE_METADATA));
+	snprintf(url, sizeof(url), "file://%s/missing", root);
+	ck_assert_ptr_null(storage_stage(url, STAGE_METADATA));
+
+	validation_set_cache_dir(NULL);
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+	ck_assert_int_eq(system(cmd), 0);
+}
+END_TEST
+
+/* Objects fetched for reading go back to their staged extent once let go */
+START_TEST(test_storage_fetch)
+{
+	char        root[64];
+	char        repo[PATH_MAX];
+	char        url[PATH_MAX + 8];
+	char        path[PATH_MAX];
+	char        seg[PATH_MAX];
+	const char *mirror;
+	const char *paths[2];
+	struct stat st;
+	size_t      big = STORAGE_INLINE_SIZE + 4096;
+	size_t      huge = STORAGE_PART_SIZE + 12345;
+
+	snprintf(root, sizeof(root), "/tmp/pg_storage_fetch_%d", getpid());
+	snprintf(repo, sizeof(repo), "%s/repo", root);
+	ck_assert_int_eq(mkdir(root, 0755), 0);
+	ck_assert_int_eq(mkdir(repo, 0755), 0);
+	snprintf(path, sizeof(path), "%s/backup", repo);
+	ck_assert_int_eq(mkdir(path, 0755), 0);
+	snprintf(path, sizeof(path), "%s/backup2", repo);
+	ck_assert_int_eq(mkdir(path, 0755), 0);
+	snprintf(path, sizeof(path), "%s/wal", repo);
+	ck_assert_int_eq(mkdir(path, 0755), 0);
+
+	write_file(repo, "backup/datafile", big, 'd');
+	write_file(repo, "backup/hugefile", huge, 'h');
+	write_file(repo, "backup2/datafile", big, 'e');
+	write_file(repo, "wal/000000010000000000000001", 2 * STORAGE_HEAD_SIZE, 'w');
+
+	/* A temporary mirror */
+	validation_set_cache_dir(NULL);
+	snprintf(url, sizeof(url), "file://%s", repo);
+	mirror = storage_stage(url, STAGE_METADATA);
+	ck_assert_ptr_nonnull(mirror);
+	ck_assert_int_eq(first_other_byte(mirror, "backup/datafile", '\0'), -1);
+
+	/* A directory: everything below it, nothing beside it */
+	snprintf(path, sizeof(path), "%s/backup", mirror);
+	paths[0] = path;
+	ck_assert(storage_fetch(paths, 1));
+	ck_assert_int_eq(first_other_byte(mirror, "backup/datafile", 'd'), -1);
+	ck_assert_int_eq(first_other_byte(mirror, "backup/hugefile", 'h'), -1);
+	ck_assert_int_eq(first_other_byte(mirror, "backup2/datafile", '\0'), -1);
+
+	/* Pinned twice: kept until the second release */
+	ck_assert(storage_fetch(paths, 1));
+	storage_release(paths, 1);
+	ck_assert_int_eq(first_other_byte(mirror, "backup/datafile", 'd'), -1);
+	storage_release(paths, 1);
+	ck_assert_int_eq(first_other_byte(mirror, "backup/datafile", '\0'), -1);
+	ck_assert_int_eq(first_other_byte(mirror, "backup/hugefile", '\0'), -1);
+	snprintf(seg, sizeof(seg), "%s/backup/hugefile", mirror);
+	ck_assert_int_eq(stat(seg, &st), 0);
+	ck_assert_uint_eq((uint64_t) st.st_size, huge);
+
+	/* The staged head of a WAL segment outlives its release */
+	snprintf(seg, sizeof(seg), "%s/wal/000000010000000000000001", mirror);
+	paths[0] = seg;
+	paths[1] = "/nonexistent/outside/any/mirror";
+	ck_assert(storage_fetch(paths, 2));
+	ck_assert_int_eq(first_other_byte(mirror, "wal/000000010000000000000001", 'w'), -1);
+	storage_release(paths, 2);
+	ck_assert_int_eq(first_other_byte(mirror, "wal/000000010000000000000001", 'w'),
+					 STORAGE_HEAD_SIZE);
+
+	/* Gone from the store: the fetch fails */
+	snprintf(path, sizeof(path), "%s/backup2/datafile", repo);
+	ck_assert_int_eq(unlink(path), 0);
+	snprintf(path, sizeof(path), "%s/backup2", mirror);
+	paths[0] = path;
+	ck_assert(!storage_fetch(paths, 1));
+	storage_release(paths, 1);
+
+	snprintf(path, sizeof(path), "rm -rf %s", root);
+	ck_assert_int_eq(system(path), 0);
+}
+END_TEST
+
+Suite *
+storage_suite(void)
+{
+	Suite *s = suite_create("storage");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_storage_location);
+	tcase_add_test(tc, test_storage_parse_list);
+	tcase_add_test(tc, test_storage_stage);
+	tcase_add_test(tc, test_storage_fetch);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,254 @@
+/*
+ * test_tar_reader.c
+ *
+ * Unit tests for the in-process tar reader
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "tar_reader.h"
+
+static char test_dir[256];
+static char stage_dir[300];
+
+/* 151-character directory: needs the ustar prefix or a long-name header */
+#define LONG_PARENT \
+	"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+#define LONG_DIR LONG_PARENT "/" \
+	"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+
+static void
+write_file(const char *dir, const char *name, const char *content)
+{
+	char path[1024];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	fp = fopen(path, "w");
+	ck_assert_ptr_nonnull(fp);
+	fputs(content, fp);
+	fclose(fp);
+}
+
+static void
+setup(void)
+{
+	char path[1024];
+	char big[3000];
+
+	snprintf(test_dir, sizeof(test_dir), "/tmp/tar_reader_test_%d", getpid());
+	mkdir(test_dir, 0755);
+	snprintf(stage_dir, sizeof(stage_dir), "%s/stage", test_dir);
+	mkdir(stage_dir, 0755);
+
+	write_file(stage_dir, "backup_label", "START TIME: 2024-01-08 10:05:30 UTC\n");
+	write_file(stage_dir, "PG_VERSION", "16\n");
+
+	/* A member spanning several blocks, so skipping is exercised */
+	memset(big, 'x', sizeof(big) - 1);
+	big[sizeof(big) - 1] = '\0';
+	write_file(stage_dir, "big", big);
+
+	snprintf(path, sizeof(path), "%s/" LONG_PARENT, stage_dir);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/" LONG_DIR, stage_dir);
+	mkdir(path, 0755);
+	write_file(path, "long_member", "deep\n");
+}
+
+static void
+teardown(void)
+{
+	char cmd[512];
+	snprintf(cmd, sizeof(cmd), "rm -rf '%s'", test_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/* Create test_dir/name from the stage directory with extra tar options */
+static void
+make_archive(const char *name, const char *options, const char *members)
+{
+	char cmd[2048];
+
+	snprintf(cmd, sizeof(cmd), "tar %s -cf '%s/%s' -C '%s' %s 2>/dev/null",
+			 options, test_dir, name, stage_dir, members);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/* Test: members are listed in order with sizes, data is readable */
+START_TEST(test_tar_iterate_and_read)
+{
+	char        path[512];
+	TarReader  *tr;
+	TarMember   m;
+	char        buf[64];
+	ssize_t     n;
+
+	make_archive("plain.tar", "", "backup_label big PG_VERSION");
+	snprintf(path, sizeof(path), "%s/plain.tar", test_dir);
+
+	tr = tar_reader_open(path);
+	ck_assert_ptr_nonnull(tr);
+
+	ck_assert_int_eq(tar_reader_next(tr, &m), 1);
+	ck_assert_str_eq(m.name, "backup_label");
+	ck_assert_int_eq(m.type, TAR_TYPE_REGULAR);
+
+	/* big is skipped without being read */
+	ck_assert_int_eq(tar_reader_next(tr, &m), 1);
+	ck_assert_str_eq(m.name, "big");
+	ck_assert_uint_eq(m.size, 2999);
+
+	ck_assert_int_eq(tar_reader_next(tr, &m), 1);
+	ck_assert_str_eq(m.name, "PG_VERSION");
+	ck_assert_uint_eq(m.size, 3);
+	n = tar_reader_read(tr, buf, sizeof(buf));
+	ck_assert_int_eq(n, 3);
+	ck_assert(memcmp(buf, "16\n", 3) == 0);
+	ck_assert_int_eq(tar_reader_read(tr, buf, sizeof(buf)), 0);
+
+	ck_assert_int_eq(tar_reader_next(tr, &m), 0);
+	ck_assert_int_eq(tar_reader_next(tr, &m), 0);
+	tar_reader_close(tr);
+}
+END_TEST
+
+/* Test: long names via ustar prefix, GNU 'L' and pax headers; "./" stripped */
+START_TEST(test_tar_long_names)
+{
+	const char *formats[] = { "--format=ustar", "--format=gnu", "--format=pax" };
+	char        path[512];
+
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+	{
+		TarWanted want[] = {
+			{ .name = LONG_DIR "/long_member" },
+			{ .name = "PG_VERSION" },
+		};
+
+		make_archive("long.tar", formats[i], ".");
+		snprintf(path, sizeof(path), "%s/long.tar", test_dir);
+
+		ck_assert_int_eq(tar_extract_members(path, want, 2, 1024), 2);
+		ck_assert_ptr_nonnull(want[0].data);
+		ck_assert_str_eq(want[0].data, "deep\n");
+		ck_assert_str_eq(want[1].data, "16\n");
+		free(want[0].data);
+		free(want[1].data);
+	}
+}
+END_TEST
+
+/* Test: gzip-compressed archive is read through the decompressor */
+START_TEST(test_tar_gzip)
+{
+	char      path[512];
+	TarWanted want[] = {
+		{ .name = "backup_label" },
+		{ .name = "PG_VERSION" },
+	};
+
+	make_archive("base.tar.gz", "-z", "big backup_label PG_VERSION");
+	snprintf(path, sizeof(path), "%s/base.tar.gz", test_dir);
+
+	ck_assert_int_eq(tar_extract_members(path, want, 2, 1024), 2);
+	ck_assert_str_eq(want[0].data, "START TIME: 2024-01-08 10:05:30 UTC\n");
+	ck_assert_uint_eq(want[1].size, 3);
+	free(want[0].data);
+	free(want[1].data);
+}
+END_TEST
+
+/* Test: absent and oversized members are reported as such */
+START_TEST(test_tar_missing_and_oversized)
+{
+	char      path[512];
+	TarWanted want[] = {
+		{ .name = "backup_manifest" },
+		{ .name = "big" },
+		{ .name = "backup_label" },
+	};
+
+	make_archive("plain.tar", "", "backup_label big PG_VERSION");
+	snprintf(path, sizeof(path), "%s/plain.tar", test_dir);
+
+	ck_assert_int_eq(tar_extract_members(path, want, 3, 1024), 2);
+	ck_assert(!want[0].found);
+	ck_assert_ptr_null(want[0].data);
+	ck_assert(want[1].found);
+	ck_assert_ptr_null(want[1].data);   /* 2999 bytes > max_size */
+	ck_assert(want[2].found);
+	ck_assert_ptr_nonnull(want[2].data);
+	free(want[2].data);
+}
+END_TEST
+
+/* Test: a corrupt header checksum is an error, not the end of the archive */
+START_TEST(test_tar_corrupt_header)
+{
+	char        path[512];
+	TarReader  *tr;
+	TarMember   m;
+	FILE       *fp;
+
+	make_archive("plain.tar", "", "backup_label PG_VERSION");
+	snprintf(path, sizeof(path), "%s/plain.tar", test_dir);
+
+	/* Damage the name of the second member (header at offset 1024) */
+	fp = fopen(path, "r+b");
+	ck_assert_ptr_nonnull(fp);
+	fseek(fp, 1024, SEEK_SET);
+	fputc('Z', fp);
+	fclose(fp);
+
+	tr = tar_reader_open(path);
+	ck_assert_ptr_nonnull(tr);
+	ck_assert_int_eq(tar_reader_next(tr, &m), 1);
+	ck_assert_str_eq(m.name, "backup_label");
+	ck_assert_int_eq(tar_reader_next(tr, &m), -1);
+	tar_reader_close(tr);
+
+	snprintf(path, sizeof(path), "%s/missing.tar", test_dir);
+	ck_assert_ptr_null(tar_reader_open(path));
+}
+END_TEST
+
+Suite *
+tar_reader_suite(void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("TarReader");
+
+	tc_core = tcase_create("core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_tar_iterate_and_read);
+	tcase_add_test(tc_core, test_tar_long_names);
+	tcase_add_test(tc_core, test_tar_gzip);
+	tcase_add_test(tc_core, test_tar_missing_and_oversized);
+	tcase_add_test(tc_core, test_tar_corrupt_header);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
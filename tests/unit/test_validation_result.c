@@ -0,0 +1,113 @@
+/*
+ * test_validation_result.c
+ *
+ * Unit tests for ValidationResult message storage
+ * (src/validator/validation_result.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pg_backup_auditor.h"
+#include "validation_result.h"
+
+/* Many messages: order, text and per-code counters are kept */
+START_TEST(test_result_add_many)
+{
+	ValidationResult *r = calloc(1, sizeof(ValidationResult));
+	char msg[64];
+
+	ck_assert_ptr_nonnull(r);
+	for (int i = 0; i < 10000; i++)
+	{
+		snprintf(msg, sizeof(msg), "Missing WAL segment %d", i);
+		validation_add_error_code(r, i % 2 ? VALIDATION_CODE_MISSING_WAL
+									  : VALIDATION_CODE_OTHER, msg);
+	}
+	validation_add_error(r, NULL);
+	validation_add_warning(r, "only warning");
+
+	ck_assert_int_eq(r->error_count, 10000);
+	ck_assert_int_eq(r->warning_count, 1);
+	ck_assert_int_ge(r->error_capacity, 10000);
+	ck_assert_str_eq(r->errors[0], "Missing WAL segment 0");
+	ck_assert_str_eq(r->errors[9999], "Missing WAL segment 9999");
+	ck_assert_int_eq(r->error_codes[9999], VALIDATION_CODE_MISSING_WAL);
+	ck_assert_int_eq(r->code_counts[VALIDATION_CODE_MISSING_WAL], 5000);
+	ck_assert_int_eq(r->code_counts[VALIDATION_CODE_OTHER], 5000);
+	ck_assert_str_eq(r->warnings[0], "only warning");
+	ck_assert_str_eq(validation_code_name(VALIDATION_CODE_MISSING_WAL), "missing_wal");
+
+	free_validation_result(r);
+}
+END_TEST
+
+/* Merging moves messages in order and leaves the child empty */
+START_TEST(test_result_merge)
+{
+	ValidationResult *parent = calloc(1, sizeof(ValidationResult));
+	ValidationResult *a = calloc(1, sizeof(ValidationResult));
+	ValidationResult *b = calloc(1, sizeof(ValidationResult));
+
+	ck_assert_ptr_nonnull(parent);
+	ck_assert_ptr_nonnull(a);
+	ck_assert_ptr_nonnull(b);
+
+	validation_add_error_code(a, VALIDATION_CODE_MISSING_FILE, "a1");
+	validation_add_warning(a, "aw");
+	validation_add_error(b, "b1");
+	validation_add_error_code(b, VALIDATION_CODE_CHECKSUM_MISMATCH, "b2");
+
+	/* Into an empty parent the arrays are taken over */
+	validation_result_merge(parent, a);
+	ck_assert_int_eq(a->error_count, 0);
+	ck_assert_int_eq(a->warning_count, 0);
+	ck_assert_ptr_null(a->errors);
+	ck_assert_ptr_null(a->arena);
+	free_validation_result(a);
+
+	validation_result_merge(parent, b);
+	free_validation_result(b);
+	validation_add_error(parent, "p1");
+
+	ck_assert_int_eq(parent->error_count, 4);
+	ck_assert_str_eq(parent->errors[0], "a1");
+	ck_assert_str_eq(parent->errors[1], "b1");
+	ck_assert_str_eq(parent->errors[2], "b2");
+	ck_assert_str_eq(parent->errors[3], "p1");
+	ck_assert_int_eq(parent->error_codes[0], VALIDATION_CODE_MISSING_FILE);
+	ck_assert_int_eq(parent->error_codes[2], VALIDATION_CODE_CHECKSUM_MISMATCH);
+	ck_assert_int_eq(parent->code_counts[VALIDATION_CODE_OTHER], 2);
+	ck_assert_int_eq(parent->warning_count, 1);
+	ck_assert_str_eq(parent->warnings[0], "aw");
+
+	/* A cleared result can be reused */
+	validation_result_clear(parent);
+	ck_assert_int_eq(parent->error_count, 0);
+	ck_assert_int_eq(parent->code_counts[VALIDATION_CODE_OTHER], 0);
+	validation_add_error(parent, "again");
+	ck_assert_str_eq(parent->errors[0], "again");
+
+	free_validation_result(parent);
+	free_validation_result(NULL);
+}
+END_TEST
+
+Suite *
+validation_result_suite(void)
+{
+	Suite *s = suite_create("validation_result");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_result_add_many);
+	tcase_add_test(tc, test_result_merge);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
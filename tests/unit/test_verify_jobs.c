@@ -0,0 +1,293 @@
+/*
+ * test_verify_jobs.c
+ *
+ * Unit tests for the shared parallel file verification engine
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "verify_jobs.h"
+#include "validation_result.h"
+#include "crc32c.h"
+
+static char test_dir[PATH_MAX];
+
+static void
+setup(void)
+{
+	snprintf(test_dir, sizeof(test_dir), "/tmp/pg_vj_test_%d", getpid());
+	mkdir(test_dir, 0755);
+}
+
+static void
+teardown(void)
+{
+	char cmd[PATH_MAX + 16];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", test_dir);
+	system(cmd);
+}
+
+/* Write 'len' bytes of 'fill' to test_dir/name and return its CRC32C */
+static uint32_t
+write_fill(const char *name, int fill, size_t len, char *path_out)
+{
+	uint8_t buf[256];
+	FILE   *fp;
+
+	memset(buf, fill, sizeof(buf));
+	snprintf(path_out, PATH_MAX, "%s/%s", test_dir, name);
+	fp = fopen(path_out, "wb");
+	fwrite(buf, 1, len, fp);
+	fclose(fp);
+	return ~crc32c_update(~0U, buf, len);
+}
+
+/* Empty list: run and merge are no-ops */
+START_TEST(test_vj_empty)
+{
+	VerifyJobList    list;
+	ValidationResult res = {0};
+	VerifyStats      st;
+
+	verify_job_list_init(&list, "test");
+	verify_jobs_run(&list, 4);
+	verify_jobs_merge(&list, &res, &st);
+	ck_assert_int_eq(res.error_count, 0);
+	ck_assert_int_eq(st.verified, 0);
+	verify_job_list_free(&list);
+}
+END_TEST
+
+/* Mixed outcomes are merged in list order with the right counters */
+START_TEST(test_vj_outcomes)
+{
+	VerifyJobList     list;
+	ValidationResult *res = calloc(1, sizeof(*res));
+	VerifyStats       st;
+	char              path[PATH_MAX];
+	VerifyJob        *job;
+	uint32_t          crc;
+
+	verify_job_list_init(&list, "test");
+
+	/* 1: good CRC and size */
+	crc = write_fill("a", 'a', 100, path);
+	job = verify_job_list_add(&list, path, "a");
+	job->algorithm     = VERIFY_ALG_CRC32C;
+	job->expected_crc  = crc;
+	job->expected_size = 100;
+
+	/* 2: missing, error */
+	snprintf(path, sizeof(path), "%s/missing", test_dir);
+	verify_job_list_add(&list, path, "missing");
+
+	/* 3: missing, but allowed */
+	job = verify_job_list_add(&list, path, "optional");
+	job->flags |= VERIFY_SKIP_IF_MISSING;
+
+	/* 4: bad CRC */
+	crc = write_fill("b", 'b', 50, path);
+	job = verify_job_list_add(&list, path, "b");
+	job->algorithm    = VERIFY_ALG_CRC32C;
+	job->expected_crc = crc ^ 0xFFU;
+
+	/* 5: size mismatch */
+	write_fill("c", 'c', 10, path);
+	job = verify_job_list_add(&list, path, "c");
+	job->expected_size = 11;
+
+	verify_jobs_run(&list, 3);
+	verify_jobs_merge(&list, res, &st);
+
+	ck_assert_int_eq(st.verified, 1);
+	ck_assert_int_eq(st.skipped, 1);
+	ck_assert_int_eq(st.failed, 3);
+	ck_assert_int_eq(res->error_count, 3);
+	ck_assert_ptr_nonnull(strstr(res->errors[0], "Missing file: missing"));
+	ck_assert_ptr_nonnull(strstr(res->errors[1], "CRC32C mismatch: b"));
+	ck_assert_ptr_nonnull(strstr(res->errors[2], "Size mismatch for c"));
+
+	verify_job_list_free(&list);
+	free_validation_result(res);
+}
+END_TEST
+
+/* Fail-fast: the first failed job stops the rest, which are skipped */
+START_TEST(test_vj_fail_fast)
+{
+	VerifyJobList     list;
+	ValidationResult *res = calloc(1, sizeof(*res));
+	VerifyStats       st;
+	char              path[PATH_MAX];
+	char              name[16];
+
+	verify_job_list_init(&list, "test");
+	snprintf(path, sizeof(path), "%s/missing", test_dir);
+	verify_job_list_add(&list, path, "missing");
+	for (int i = 0; i < 3; i++)
+	{
+		snprintf(name, sizeof(name), "f%d", i);
+		write_fill(name, 'f', 10, path);
+		verify_job_list_add(&list, path, name);
+	}
+
+	validation_set_fail_fast(true);
+	ck_assert(!validation_stop_requested());
+	verify_jobs_run(&list, 1);
+	ck_assert(validation_stop_requested());
+	verify_jobs_finish_missing(&list);
+	verify_jobs_merge(&list, res, &st);
+	ck_assert_int_eq(st.failed, 1);
+	ck_assert_int_eq(st.skipped, 3);
+	ck_assert_int_eq(res->error_count, 1);
+
+	/* Turning it off clears the stop; errors no longer request one */
+	validation_set_fail_fast(false);
+	ck_assert(!validation_stop_requested());
+	validation_add_error(res, "another");
+	ck_assert(!validation_stop_requested());
+
+	verify_job_list_free(&list);
+	free_validation_result(res);
+}
+END_TEST
+
+/* SHA256 digests are compared case-insensitively */
+START_TEST(test_vj_sha256)
+{
+	VerifyJobList     list;
+	ValidationResult *res = calloc(1, sizeof(*res));
+	char              path[PATH_MAX];
+	VerifyJob        *job;
+	FILE             *fp;
+
+	snprintf(path, sizeof(path), "%s/abc", test_dir);
+	fp = fopen(path, "wb");
+	fputs("abc", fp);
+	fclose(fp);
+
+	verify_job_list_init(&list, "test");
+	job = verify_job_list_add(&list, path, "abc");
+	job->algorithm    = VERIFY_ALG_SHA256;
+	job->expected_hex = strdup("BA7816BF8F01CFEA414140DE5DAE2223"
+							   "B00361A396177A9CB410FF61F20015AD");
+	job = verify_job_list_add(&list, path, "abc-bad");
+	job->algorithm    = VERIFY_ALG_SHA256;
+	job->expected_hex = strdup("00");
+
+	verify_jobs_run(&list, 2);
+	verify_jobs_merge(&list, res, NULL);
+
+	ck_assert_int_eq(res->error_count, 1);
+	ck_assert_ptr_nonnull(strstr(res->errors[0], "SHA256 mismatch: abc-bad"));
+
+	verify_job_list_free(&list);
+	free_validation_result(res);
+}
+END_TEST
+
+/* unreadable_warns turns read failures into warnings */
+START_TEST(test_vj_unreadable_warns)
+{
+	VerifyJobList     list;
+	ValidationResult *res = calloc(1, sizeof(*res));
+	char              path[PATH_MAX];
+	VerifyJob        *job;
+
+	/* A directory exists but cannot be read as a file */
+	snprintf(path, sizeof(path), "%s/dir", test_dir);
+	mkdir(path, 0755);
+
+	verify_job_list_init(&list, "test");
+	list.unreadable_warns = true;
+	job = verify_job_list_add(&list, path, "dir");
+	job->algorithm = VERIFY_ALG_SHA256;
+	job->expected_hex = strdup("00");
+
+	verify_jobs_run(&list, 1);
+	verify_jobs_merge(&list, res, NULL);
+
+	ck_assert_int_eq(res->error_count, 0);
+	ck_assert_int_eq(res->warning_count, 1);
+	ck_assert_ptr_nonnull(strstr(res->warnings[0], "Cannot read file"));
+
+	verify_job_list_free(&list);
+	free_validation_result(res);
+}
+END_TEST
+
+/* Output order does not depend on the number of threads */
+START_TEST(test_vj_order_independent_of_jobs)
+{
+	ValidationResult *r1 = calloc(1, sizeof(*r1));
+	ValidationResult *r8 = calloc(1, sizeof(*r8));
+	char              path[PATH_MAX];
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		VerifyJobList list;
+
+		verify_job_list_init(&list, "test");
+		for (int i = 0; i < 64; i++)
+		{
+			char     name[32];
+			uint32_t crc;
+
+			snprintf(name, sizeof(name), "f%02d", i);
+			crc = write_fill(name, i, 200, path);
+			VerifyJob *job = verify_job_list_add(&list, path, name);
+			job->algorithm    = VERIFY_ALG_CRC32C;
+			job->expected_crc = (i % 3 == 0) ? crc + 1 : crc;
+		}
+		verify_jobs_run(&list, pass == 0 ? 1 : 8);
+		verify_jobs_merge(&list, pass == 0 ? r1 : r8, NULL);
+		verify_job_list_free(&list);
+	}
+
+	ck_assert_int_eq(r1->error_count, 22);
+	ck_assert_int_eq(r8->error_count, r1->error_count);
+	for (int i = 0; i < r1->error_count; i++)
+		ck_assert_str_eq(r1->errors[i], r8->errors[i]);
+
+	free_validation_result(r1);
+	free_validation_result(r8);
+}
+END_TEST
+
+Suite *
+verify_jobs_suite(void)
+{
+	Suite *s = suite_create("verify_jobs");
+	TCase *tc = tcase_create("core");
+
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_vj_empty);
+	tcase_add_test(tc, test_vj_outcomes);
+	tcase_add_test(tc, test_vj_fail_fast);
+	tcase_add_test(tc, test_vj_sha256);
+	tcase_add_test(tc, test_vj_unreadable_warns);
+	tcase_add_test(tc, test_vj_order_independent_of_jobs);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,169 @@
+/*
+ * test_verify_sample.c
+ *
+ * Unit tests for sampled verification (src/validator/verify_sample.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "verify_sample.h"
+
+#define NITEMS 100
+
+static void
+make_items(SampleItem *items, int count)
+{
+	char name[32];
+
+	for (int i = 0; i < count; i++)
+	{
+		snprintf(name, sizeof(name), "base/1/%d", 16384 + i);
+		items[i].key = sample_key(name);
+		items[i].bytes = (uint64_t) (i % 7 + 1) * 8192;
+		items[i].cached = false;
+	}
+}
+
+/* Ten consecutive steps of a 10% sample read every item; each reads a tenth */
+START_TEST(test_sample_rotation_covers_all)
+{
+	SampleItem     items[NITEMS];
+	int            seen[NITEMS];
+	SampleCoverage before;
+	SampleCoverage after;
+
+	make_items(items, NITEMS);
+	memset(seen, 0, sizeof(seen));
+	sample_coverage(SAMPLE_FILES, &before);
+
+	for (int step = 0; step < 10; step++)
+	{
+		int selected = 0;
+
+		validation_set_sample(0.1, SAMPLE_BY_COUNT, 20000 + step);
+		ck_assert_int_eq(validation_sample_runs(), 10);
+		sample_select(items, NITEMS, SAMPLE_FILES);
+		for (int i = 0; i < NITEMS; i++)
+		{
+			if (items[i].selected)
+			{
+				selected++;
+				seen[i]++;
+			}
+		}
+		ck_assert(selected >= 9 && selected <= 11);
+	}
+
+	for (int i = 0; i < NITEMS; i++)
+		ck_assert_int_ge(seen[i], 1);
+
+	sample_coverage(SAMPLE_FILES, &after);
+	ck_assert_uint_eq(after.items - before.items, 10 * NITEMS);
+	ck_assert(after.items_checked - before.items_checked >= 90 &&
+			  after.items_checked - before.items_checked <= 110);
+
+	/* The same step picks the same items */
+	validation_set_sample(0.1, SAMPLE_BY_COUNT, 7);
+	sample_select(items, NITEMS, SAMPLE_FILES);
+	for (int i = 0; i < NITEMS; i++)
+		seen[i] = items[i].selected;
+	sample_select(items, NITEMS, SAMPLE_FILES);
+	for (int i = 0; i < NITEMS; i++)
+		ck_assert_int_eq(seen[i], items[i].selected);
+
+	validation_set_sample(1.0, SAMPLE_BY_COUNT, 0);
+}
+END_TEST
+
+/* By bytes: each step reads about a quarter of the bytes, four cover all */
+START_TEST(test_sample_by_bytes)
+{
+	SampleItem items[NITEMS];
+	bool       seen[NITEMS];
+	uint64_t   total = 0;
+	uint64_t   largest = 0;
+
+	make_items(items, NITEMS);
+	memset(seen, 0, sizeof(seen));
+	for (int i = 0; i < NITEMS; i++)
+	{
+		total += items[i].bytes;
+		if (items[i].bytes > largest)
+			largest = items[i].bytes;
+	}
+
+	for (int step = 0; step < 4; step++)
+	{
+		uint64_t bytes = 0;
+
+		validation_set_sample(0.25, SAMPLE_BY_BYTES, step);
+		sample_select(items, NITEMS, SAMPLE_FILES);
+		for (int i = 0; i < NITEMS; i++)
+		{
+			if (items[i].selected)
+			{
+				bytes += items[i].bytes;
+				seen[i] = true;
+			}
+		}
+		ck_assert(bytes + largest >= total / 4);
+		ck_assert(bytes <= total / 4 + largest);
+	}
+
+	for (int i = 0; i < NITEMS; i++)
+		ck_assert(seen[i]);
+
+	validation_set_sample(1.0, SAMPLE_BY_COUNT, 0);
+}
+END_TEST
+
+/* Cached items are never read and leave their budget to uncached ones */
+START_TEST(test_sample_cached_first)
+{
+	SampleItem items[NITEMS];
+	int        selected = 0;
+
+	make_items(items, NITEMS);
+	for (int i = 0; i < NITEMS; i += 2)
+		items[i].cached = true;
+
+	validation_set_sample(0.2, SAMPLE_BY_COUNT, 3);
+	sample_select(items, NITEMS, SAMPLE_WAL_SEGMENTS);
+	for (int i = 0; i < NITEMS; i++)
+	{
+		if (items[i].cached)
+			ck_assert(!items[i].selected);
+		else if (items[i].selected)
+			selected++;
+	}
+	ck_assert(selected >= 19 && selected <= 21);
+
+	/* Without sampling, everything not cached is read */
+	validation_set_sample(1.0, SAMPLE_BY_COUNT, 0);
+	ck_assert(!validation_sample_active());
+	ck_assert_int_eq(validation_sample_runs(), 1);
+	sample_select(items, NITEMS, SAMPLE_WAL_SEGMENTS);
+	for (int i = 0; i < NITEMS; i++)
+		ck_assert(items[i].selected == !items[i].cached);
+}
+END_TEST
+
+Suite *
+verify_sample_suite(void)
+{
+	Suite *s = suite_create("verify_sample");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_sample_rotation_covers_all);
+	tcase_add_test(tc, test_sample_by_bytes);
+	tcase_add_test(tc, test_sample_cached_first);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,264 @@
+/*
+ * test_verify_shard.c
+ *
+ * Unit tests for sharded verification (src/validator/verify_shard.c)
+ * and for merging the parts (src/validator/shard_merge.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pg_backup_auditor.h"
+#include "shard_merge.h"
+#include "verify_shard.h"
+
+/* "K/N" with 1 <= K <= N <= SHARD_MAX_COUNT */
+START_TEST(test_shard_from_string)
+{
+	int k = 0;
+	int n = 0;
+
+	ck_assert(shard_from_string("2/8", &k, &n));
+	ck_assert_int_eq(k, 2);
+	ck_assert_int_eq(n, 8);
+	ck_assert(shard_from_string("1/1", &k, &n));
+	ck_assert_int_eq(n, 1);
+
+	ck_assert(!shard_from_string("0/4", &k, &n));
+	ck_assert(!shard_from_string("5/4", &k, &n));
+	ck_assert(!shard_from_string("1/5000", &k, &n));
+	ck_assert(!shard_from_string("2", &k, &n));
+	ck_assert(!shard_from_string("2/", &k, &n));
+	ck_assert(!shard_from_string("2/4x", &k, &n));
+	ck_assert(!shard_from_string(NULL, &k, &n));
+}
+END_TEST
+
+/* Every file and WAL segment belongs to exactly one of N shards */
+START_TEST(test_shard_ownership)
+{
+	enum { N = 5, FILES = 2000, SEGMENTS = 64 * 40 };
+	int  files[N] = { 0 };
+	int  ranges[N] = { 0 };
+	char name[32];
+
+	for (int f = 0; f < FILES; f++)
+	{
+		int owners = 0;
+
+		snprintf(name, sizeof(name), "base/1/%d", 16384 + f);
+		for (int k = 1; k <= N; k++)
+		{
+			validation_set_shard(k, N);
+			ck_assert(validation_shard_active());
+			if (shard_owns_file("T85S00", name))
+			{
+				owners++;
+				files[k - 1]++;
+			}
+		}
+		ck_assert_int_eq(owners, 1);
+	}
+
+	for (int s = 0; s < SEGMENTS; s++)
+	{
+		int owners = 0;
+
+		for (int k = 1; k <= N; k++)
+		{
+			validation_set_shard(k, N);
+			if (shard_owns_wal_segment(1, (uint64_t) s))
+			{
+				owners++;
+				/* Consecutive segments stay together */
+				ck_assert(shard_owns_wal_segment(1, (uint64_t) (s - s % SHARD_WAL_RANGE)));
+				if (s % SHARD_WAL_RANGE == 0)
+					ranges[k - 1]++;
+			}
+		}
+		ck_assert_int_eq(owners, 1);
+	}
+
+	/* Roughly even: no shard gets less than half its share */
+	for (int k = 0; k < N; k++)
+	{
+		ck_assert_int_gt(files[k], FILES / N / 2);
+		ck_assert_int_gt(ranges[k], 0);
+	}
+
+	/* One shard, or none, owns everything */
+	validation_set_shard(1, 1);
+	ck_assert(!validation_shard_active());
+	ck_assert(shard_owns_file("T85S00", "base/1/16384"));
+	ck_assert(shard_owns_file("T85S00", NULL));
+	ck_assert(shard_owns_wal_segment(7, 12345));
+}
+END_TEST
+
+/* A temporary file holding 'text' */
+static FILE *
+part(const char *text)
+{
+	FILE *fp = tmpfile();
+
+	ck_assert_ptr_nonnull(fp);
+	fputs(text, fp);
+	rewind(fp);
+	return fp;
+}
+
+static bool
+add_part(ShardMerge *merge, const char *text)
+{
+	FILE *fp = part(text);
+	bool  ok = shard_merge_add(merge, fp, "part");
+
+	fclose(fp);
+	return ok;
+}
+
+#define SHARD(k) \
+	"{\"record\":\"shard\",\"index\":" #k ",\"count\":2,\"level\":\"full\"," \
+	"\"catalog\":\"00aa\",\"backups\":2}\n"
+#define CHAIN \
+	"{\"record\":\"chain\",\"root\":\"B1\",\"orphaned\":false,\"members\":2}\n"
+#define BACKUP(id, result) \
+	"{\"record\":\"backup\",\"backup_id\":\"" id "\",\"result\":\"" result "\"}\n"
+#define FINDING(id, severity, code, message) \
+	"{\"record\":\"finding\",\"severity\":\"" severity "\",\"backup_id\":\"" id "\"," \
+	"\"archive\":null,\"check\":\"backup\",\"code\":" code ",\"message\":\"" message "\"}\n"
+#define WAL_CHECK \
+	"{\"record\":\"wal_check\",\"archive\":\"/wal\",\"check\":\"headers\",\"errors\":1}\n"
+#define WAL_FINDING(message) \
+	"{\"record\":\"finding\",\"severity\":\"error\",\"backup_id\":null," \
+	"\"archive\":\"/wal\",\"check\":\"headers\",\"code\":\"other\",\"message\":\"" message "\"}\n"
+#define SUMMARY(stopped) \
+	"{\"record\":\"summary\",\"errors\":9,\"stopped\":" stopped "}\n"
+
+/*
+ * Per-file findings of both shards are kept, global ones once; the
+ * totals are counted from the merged results
+ */
+START_TEST(test_shard_merge)
+{
+	ShardMerge      *merge = shard_merge_create();
+	ShardMergeTotals totals;
+	const ShardEntry *e;
+
+	ck_assert_ptr_nonnull(merge);
+	ck_assert(add_part(merge,
+					   SHARD(2) CHAIN
+					   BACKUP("B1", "error")
+					   FINDING("B1", "error", "\"checksum_mismatch\"", "Checksum mismatch: base/1/2")
+					   FINDING("B1", "warning", "null", "Backup is old")
+					   BACKUP("B2", "error")
+					   FINDING("B2", "error", "\"missing_file\"", "Missing file: \\\"x\\\"")
+					   WAL_CHECK WAL_FINDING("Bad header: 000000010000000000000041")
+					   SUMMARY("false")));
+	ck_assert(!shard_merge_complete(merge));
+	ck_assert(add_part(merge,
+					   SHARD(1) CHAIN
+					   BACKUP("B1", "error")
+					   FINDING("B1", "error", "\"checksum_mismatch\"", "Checksum mismatch: base/1/1")
+					   FINDING("B1", "warning", "null", "Backup is old")
+					   BACKUP("B2", "error")
+					   FINDING("B2", "error", "\"missing_file\"", "Missing file: \\\"x\\\"")
+					   FINDING("B2", "error", "\"missing_file\"", "Missing file: \\\"x\\\"")
+					   WAL_CHECK WAL_FINDING("Bad header: 000000010000000000000001")
+					   SUMMARY("true")));
+	ck_assert(shard_merge_complete(merge));
+	ck_assert_int_eq(merge->parts, 2);
+	ck_assert_int_eq(merge->entry_count, 4);
+	ck_assert(merge->stopped);
+
+	/* Report order: chain, B1, B2, WAL check */
+	e = &merge->entries[merge->first];
+	ck_assert_int_eq(e->kind, SHARD_ENTRY_CHAIN);
+	e = &merge->entries[e->next];
+	ck_assert_int_eq(e->kind, SHARD_ENTRY_BACKUP);
+	ck_assert_str_eq(e->name, "B1");
+	ck_assert_int_eq(e->result.error_count, 2);
+	ck_assert_str_eq(e->result.errors[0], "Checksum mismatch: base/1/2");
+	ck_assert_str_eq(e->result.errors[1], "Checksum mismatch: base/1/1");
+	ck_assert_int_eq(e->result.code_counts[VALIDATION_CODE_CHECKSUM_MISMATCH], 2);
+	ck_assert_int_eq(e->result.warning_count, 1);
+
+	/* Reported twice by one shard, once by the other: kept twice */
+	e = &merge->entries[e->next];
+	ck_assert_str_eq(e->name, "B2");
+	ck_assert_int_eq(e->result.error_count, 2);
+	ck_assert_str_eq(e->result.errors[0], "Missing file: \"x\"");
+	ck_assert_int_eq(e->result.code_counts[VALIDATION_CODE_MISSING_FILE], 2);
+
+	e = &merge->entries[e->next];
+	ck_assert_int_eq(e->kind, SHARD_ENTRY_WAL_CHECK);
+	ck_assert_str_eq(e->name, "/wal");
+	ck_assert_str_eq(e->check, "headers");
+	ck_assert_int_eq(e->result.error_count, 2);
+	ck_assert_int_eq(e->next, -1);
+
+	shard_merge_totals(merge, &totals);
+	ck_assert_int_eq(totals.backups_found, 2);
+	ck_assert_int_eq(totals.backups_validated, 2);
+	ck_assert_int_eq(totals.errors, 6);
+	ck_assert_int_eq(totals.warnings, 1);
+
+	shard_merge_free(merge);
+}
+END_TEST
+
+/* Parts of another run, repeated or unfinished parts are refused */
+START_TEST(test_shard_merge_invalid)
+{
+	ShardMerge *merge = shard_merge_create();
+
+	ck_assert_ptr_nonnull(merge);
+	ck_assert(!add_part(merge, BACKUP("B1", "ok") SUMMARY("false")));
+	ck_assert(!add_part(merge, ""));
+	ck_assert(!add_part(merge, SHARD(1) BACKUP("B1", "ok")));
+	ck_assert(!add_part(merge, SHARD(2) FINDING("B9", "error", "null", "x") SUMMARY("false")));
+	shard_merge_free(merge);
+
+	merge = shard_merge_create();
+	ck_assert(add_part(merge, SHARD(1) BACKUP("B1", "ok") SUMMARY("false")));
+	ck_assert(!add_part(merge, SHARD(1) BACKUP("B1", "ok") SUMMARY("false")));
+	ck_assert(!add_part(merge,
+						"{\"record\":\"shard\",\"index\":2,\"count\":2,\"level\":\"full\","
+						"\"catalog\":\"00bb\",\"backups\":2}\n" SUMMARY("false")));
+	ck_assert(!shard_merge_complete(merge));
+
+	/* The same shard twice in one stream */
+	ck_assert(!add_part(merge, SHARD(2) BACKUP("B1", "ok") SUMMARY("false")
+						SHARD(2) BACKUP("B1", "ok") SUMMARY("false")));
+	shard_merge_free(merge);
+
+	/* Parts written one after another, as by 'cat' */
+	merge = shard_merge_create();
+	ck_assert(add_part(merge, SHARD(2) BACKUP("B1", "ok") SUMMARY("false")
+					   SHARD(1) BACKUP("B1", "ok") SUMMARY("false")));
+	ck_assert(shard_merge_complete(merge));
+	ck_assert_int_eq(merge->parts, 2);
+	shard_merge_free(merge);
+}
+END_TEST
+
+Suite *
+verify_shard_suite(void)
+{
+	Suite *s = suite_create("verify_shard");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_test(tc, test_shard_from_string);
+	tcase_add_test(tc, test_shard_ownership);
+	tcase_add_test(tc, test_shard_merge);
+	tcase_add_test(tc, test_shard_merge_invalid);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
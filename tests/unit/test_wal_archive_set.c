@@ -0,0 +1,193 @@
+/*
+ * test_wal_archive_set.c
+ *
+ * Unit tests for per-instance WAL archive resolution
+ * (src/scanner/wal_archive_set.c).
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * Licensed under the GNU GPL v3.0 or later.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pg_backup_auditor.h"
+#include "wal_archive_set.h"
+
+static char root[64];
+
+/* Create a file of 'size' zero bytes */
+static void
+touch(const char *path, size_t size)
+{
+	FILE *fp = fopen(path, "w");
+
+	ck_assert_ptr_nonnull(fp);
+	for (size_t i = 0; i < size; i++)
+		fputc(0, fp);
+	fclose(fp);
+}
+
+/* pg_probackup catalog: <root>/backups/<instance>/, <root>/wal/<instance>/ */
+static void
+make_instance(const char *instance, int nsegments)
+{
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/backups/%s", root, instance);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/wal/%s", root, instance);
+	mkdir(path, 0755);
+	for (int i = 1; i <= nsegments; i++)
+	{
+		snprintf(path, sizeof(path), "%s/wal/%s/0000000100000000000000%02X",
+				 root, instance, i);
+		touch(path, 64);
+	}
+}
+
+/* Append a pg_probackup backup of 'instance' to the list at *head */
+static BackupInfo *
+mk(BackupInfo **head, const char *instance, const char *id, bool stream)
+{
+	BackupInfo  *b = calloc(1, sizeof(*b));
+	BackupInfo **p = head;
+
+	str_copy(b->backup_id, id, sizeof(b->backup_id));
+	str_copy(b->instance_name, instance, sizeof(b->instance_name));
+	snprintf(b->backup_path, sizeof(b->backup_path), "%s/backups/%s/%s",
+			 root, instance, id);
+	mkdir(b->backup_path, 0755);
+	b->tool = BACKUP_TOOL_PG_PROBACKUP;
+	b->type = BACKUP_TYPE_FULL;
+	b->start_lsn = 0x1000028;
+	b->wal_stream = stream;
+	while (*p != NULL)
+		p = &(*p)->next;
+	*p = b;
+	return b;
+}
+
+static void
+setup(void)
+{
+	char path[PATH_MAX];
+
+	snprintf(root, sizeof(root), "/tmp/pg_wal_set_%d", (int) getpid());
+	mkdir(root, 0755);
+	snprintf(path, sizeof(path), "%s/backups", root);
+	mkdir(path, 0755);
+	snprintf(path, sizeof(path), "%s/wal", root);
+	mkdir(path, 0755);
+}
+
+static void
+teardown(void)
+{
+	char cmd[PATH_MAX];
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+	(void) system(cmd);
+}
+
+/* Each instance is validated against its own archive, scanned once */
+START_TEST(test_wal_archive_set_per_instance)
+{
+	BackupInfo    *head = NULL;
+	WALArchiveSet *set;
+	BackupInfo    *a1, *a2, *b1, *b2, *s1;
+	int            ia, ib;
+
+	make_instance("alpha", 3);
+	make_instance("beta", 1);
+	make_instance("streamed", 2);
+	a1 = mk(&head, "alpha", "A1", false);
+	b1 = mk(&head, "beta", "B1", false);
+	a2 = mk(&head, "alpha", "A2", false);
+	b2 = mk(&head, "beta", "B2", true);
+	s1 = mk(&head, "streamed", "S1", true);
+
+	scan_set_jobs(2);
+	set = wal_archive_set_build(head, NULL);
+	scan_set_jobs(1);
+	ck_assert_ptr_nonnull(set);
+	ck_assert_int_eq(set->count, 3);
+	ck_assert_int_eq(wal_archive_set_scanned(set), 2);
+
+	ia = wal_archive_set_index(set, a1);
+	ib = wal_archive_set_index(set, b1);
+	ck_assert_int_ge(ia, 0);
+	ck_assert_int_ge(ib, 0);
+	ck_assert_int_ne(ia, ib);
+	ck_assert_int_eq(wal_archive_set_index(set, a2), ia);
+	ck_assert_int_eq(wal_archive_set_index(set, b2), ib);
+
+	ck_assert_int_eq(wal_archive_set_lookup(set, a2)->segment_count, 3);
+	ck_assert_int_eq(wal_archive_set_lookup(set, b2)->segment_count, 1);
+
+	/* Only stream backups use it: no scan */
+	ck_assert_int_ge(wal_archive_set_index(set, s1), 0);
+	ck_assert_ptr_null(wal_archive_set_lookup(set, s1));
+
+	ck_assert_int_eq(set->archives[ia].member_count, 2);
+	ck_assert_ptr_eq(set->archives[ia].members[0], a1);
+	ck_assert_ptr_eq(set->archives[ia].members[1], a2);
+	ck_assert_int_eq(set->archives[ib].member_count, 2);
+
+	wal_archive_set_free(set);
+	free_backup_list(head);
+}
+END_TEST
+
+/* An explicit archive is used for every backup */
+START_TEST(test_wal_archive_set_explicit)
+{
+	BackupInfo    *head = NULL;
+	WALArchiveSet *set;
+	BackupInfo    *a1, *b1;
+	BackupInfo     other;
+	char           path[PATH_MAX];
+
+	memset(&other, 0, sizeof(other));
+	make_instance("alpha", 3);
+	make_instance("beta", 1);
+	a1 = mk(&head, "alpha", "A1", false);
+	b1 = mk(&head, "beta", "B1", false);
+
+	snprintf(path, sizeof(path), "%s/wal/beta", root);
+	set = wal_archive_set_build(head, path);
+	ck_assert_ptr_nonnull(set);
+	ck_assert_int_eq(set->count, 1);
+	ck_assert_str_eq(set->archives[0].path, path);
+	ck_assert_ptr_eq(wal_archive_set_lookup(set, a1), set->archives[0].info);
+	ck_assert_ptr_eq(wal_archive_set_lookup(set, b1), set->archives[0].info);
+	ck_assert_int_eq(set->archives[0].info->segment_count, 1);
+	ck_assert_int_eq(set->archives[0].member_count, 2);
+
+	/* A backup that is not in the list is not bound */
+	ck_assert_int_eq(wal_archive_set_index(set, &other), -1);
+
+	wal_archive_set_free(set);
+	free_backup_list(head);
+}
+END_TEST
+
+Suite *
+wal_archive_set_suite(void)
+{
+	Suite *s = suite_create("wal_archive_set");
+
+	TCase *tc = tcase_create("core");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_wal_archive_set_per_instance);
+	tcase_add_test(tc, test_wal_archive_set_explicit);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,186 @@
+/*
+ * test_wal_cache.c
+ *
+ * Unit tests for the persistent WAL verification cache
+ *
+ * Copyright (C) 2026 Daria Lepikhova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "pg_backup_auditor.h"
+#include "wal_cache.h"
+
+static char test_dir[PATH_MAX];
+static char cache_dir[PATH_MAX];
+
+static void
+setup(void)
+{
+	snprintf(test_dir, sizeof(test_dir), "/tmp/pg_walcache_test_%d", getpid());
+	snprintf(cache_dir, sizeof(cache_dir), "%s/cache", test_dir);
+	mkdir(test_dir, 0755);
+	mkdir(cache_dir, 0755);
+	validation_set_cache_dir(cache_dir);
+}
+
+static void
+teardown(void)
+{
+	char cmd[PATH_MAX + 16];
+
+	validation_set_cache_dir(NULL);
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", test_dir);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/* Create test_dir/name with 'content'; fill 'st' */
+static void
+make_file(const char *name, const char *content, char *path, struct stat *st)
+{
+	FILE *fp;
+
+	snprintf(path, PATH_MAX, "%s/%s", test_dir, name);
+	fp = fopen(path, "w");
+	ck_assert_ptr_nonnull(fp);
+	fputs(content, fp);
+	fclose(fp);
+	ck_assert_int_eq(stat(path, st), 0);
+}
+
+/* No cache directory → no cache */
+START_TEST(test_wal_cache_disabled)
+{
+	validation_set_cache_dir(NULL);
+	ck_assert_ptr_null(wal_cache_open("/wal", 0x1000000));
+}
+END_TEST
+
+/* Entries survive a reopen; a changed file no longer matches */
+START_TEST(test_wal_cache_persist)
+{
+	char        a[PATH_MAX], b[PATH_MAX];
+	struct stat sa, sb, changed;
+	WALCache   *cache;
+
+	make_file("000000010000000000000001", "one", a, &sa);
+	make_file("000000010000000000000002", "two", b, &sb);
+
+	cache = wal_cache_open("/wal", 0x1000000);
+	ck_assert_ptr_nonnull(cache);
+	ck_assert(!wal_cache_lookup(cache, a, &sa));
+	wal_cache_store(cache, a, &sa);
+	wal_cache_store(cache, b, &sb);
+	wal_cache_close(cache, false);
+
+	cache = wal_cache_open("/wal", 0x1000000);
+	ck_assert(wal_cache_lookup(cache, a, &sa));
+	ck_assert(wal_cache_lookup(cache, b, &sb));
+
+	changed = sb;
+	changed.st_size++;
+	ck_assert(!wal_cache_lookup(cache, b, &changed));
+	changed = sb;
+	changed.st_mtim.tv_sec++;
+	ck_assert(!wal_cache_lookup(cache, b, &changed));
+	wal_cache_close(cache, false);
+
+	/* Another archive and another segment size start empty */
+	cache = wal_cache_open("/other", 0x1000000);
+	ck_assert(!wal_cache_lookup(cache, a, &sa));
+	wal_cache_close(cache, false);
+	cache = wal_cache_open("/wal", 0x4000000);
+	ck_assert(!wal_cache_lookup(cache, a, &sa));
+	wal_cache_close(cache, false);
+}
+END_TEST
+
+/* Pruning drops entries that were not looked up */
+START_TEST(test_wal_cache_prune)
+{
+	char        a[PATH_MAX], b[PATH_MAX];
+	struct stat sa, sb;
+	WALCache   *cache;
+
+	make_file("000000010000000000000001", "one", a, &sa);
+	make_file("000000010000000000000002", "two", b, &sb);
+
+	cache = wal_cache_open("/wal", 0x1000000);
+	wal_cache_store(cache, a, &sa);
+	wal_cache_store(cache, b, &sb);
+	wal_cache_close(cache, false);
+
+	cache = wal_cache_open("/wal", 0x1000000);
+	ck_assert(wal_cache_lookup(cache, a, &sa));
+	wal_cache_close(cache, true);
+
+	cache = wal_cache_open("/wal", 0x1000000);
+	ck_assert(wal_cache_lookup(cache, a, &sa));
+	ck_assert(!wal_cache_lookup(cache, b, &sb));
+	wal_cache_close(cache, false);
+}
+END_TEST
+
+/* Many entries force the table to grow; all are still found */
+START_TEST(test_wal_cache_many)
+{
+	char        path[PATH_MAX];
+	struct stat st;
+	WALCache   *cache;
+
+	make_file("seg", "x", path, &st);
+
+	cache = wal_cache_open("/wal", 0x1000000);
+	for (int i = 0; i < 5000; i++)
+	{
+		snprintf(path, sizeof(path), "/wal/0000000100000000%08X", i);
+		wal_cache_store(cache, path, &st);
+	}
+	wal_cache_close(cache, false);
+
+	cache = wal_cache_open("/wal", 0x1000000);
+	for (int i = 0; i < 5000; i++)
+	{
+		snprintf(path, sizeof(path), "/wal/0000000100000000%08X", i);
+		ck_assert(wal_cache_lookup(cache, path, &st));
+	}
+	wal_cache_close(cache, false);
+}
+END_TEST
+
+Suite *
+wal_cache_suite(void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("WALCache");
+
+	tc_core = tcase_create("core");
+	tcase_add_checked_fixture(tc_core, setup, teardown);
+	tcase_add_test(tc_core, test_wal_cache_disabled);
+	tcase_add_test(tc_core, test_wal_cache_persist);
+	tcase_add_test(tc_core, test_wal_cache_prune);
+	tcase_add_test(tc_core, test_wal_cache_many);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
@@ -25,11 +25,13 @@
 #include <string.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <check.h>
 #include "../../include/types.h"
 #include "../../include/common.h"
 #include "../../include/adapter.h"
+#include "../../include/wal_cache.h"
 #include "test_integration_helpers.h"
 
 /*
@@ -222,12 +224,57 @@ START_TEST(test_check_wal_availability_gap)
 	wal_info->segments[3] = wal_info->segments[4];
 	wal_info->segment_count = 4;
 
-	/* Check availability */
+	/* Check availability: one error for the one missing segment */
 	result = check_wal_availability(&backup, wal_info);
 
 	ck_assert_ptr_nonnull(result);
 	ck_assert_int_eq(result->status, BACKUP_STATUS_ERROR);
-	ck_assert(result->error_count > 0);
+	ck_assert_int_eq(result->error_count, 1);
+	ck_assert_str_eq(result->errors[0],
+					 "Missing WAL segment: 000000010000000000000002");
+
+	free_validation_result(result);
+	free_wal_archive_info(wal_info);
+}
+END_TEST
+
+/*
+ * Test: Check WAL availability - range crossing into the next xlogid
+ *
+ * With 16 MB segments 0000000100000000000000FF is followed by
+ * 000000010000000100000000, not by a segment 0x100 of log 0.
+ */
+START_TEST(test_check_wal_availability_log_boundary)
+{
+	BackupInfo backup;
+	WALArchiveInfo *wal_info;
+	ValidationResult *result;
+
+	memset(&backup, 0, sizeof(backup));
+	strcpy(backup.backup_id, "test-backup");
+	backup.timeline = 1;
+	backup.start_lsn = 0xFE000000ULL;	/* 0/FE000000 */
+	backup.stop_lsn = 0x101000000ULL;	/* 1/01000000 */
+
+	/* 0/FE, 0/FF, 1/00, 1/01 */
+	wal_info = create_test_wal_archive(4);
+	for (int i = 0; i < 4; i++)
+	{
+		wal_info->segments[i].log_id = (0xFE + i) / 0x100;
+		wal_info->segments[i].seg_id = (0xFE + i) % 0x100;
+	}
+
+	result = check_wal_availability(&backup, wal_info);
+
+	ck_assert_ptr_nonnull(result);
+	ck_assert_int_eq(result->status, BACKUP_STATUS_OK);
+	ck_assert_int_eq(result->error_count, 0);
+	free_validation_result(result);
+
+	/* Nor is the archive itself reported as having a gap there */
+	result = check_wal_continuity(wal_info);
+	ck_assert_ptr_nonnull(result);
+	ck_assert_int_eq(result->error_count, 0);
 
 	free_validation_result(result);
 	free_wal_archive_info(wal_info);
@@ -940,7 +987,7 @@ test_xlog_crc(const uint8_t *rec, uint32_t xl_tot_len)
  * If zero_crc is true all xl_crc fields are written as 0 (synthetic WAL).
  *
  * If oversized is true, the first record's xl_tot_len is set to blcksz
- * (8192), making it a multi-page record that must be skipped.
+ * (8192), making it a multi-page record that runs into a zero page.
  *
  * bad_totlen_idx: if >= 0, that record's xl_tot_len is set to 10 (< 24),
  * triggering the invalid-totlen path in validate_wal_segment_records.
@@ -1003,8 +1050,8 @@ write_rec_test_seg(const char *path, int nrecs, int bad_crc_idx, int bad_totlen_
 		{
 			/*
 			 * For oversized records (tot_len > sizeof(rec)) we can't compute
-			 * a real CRC without a matching payload buffer.  The validator
-			 * skips multi-page records anyway, so zero is fine.
+			 * a real CRC without a matching payload buffer.  The record runs
+			 * into zero-filled pages and is never completed, so zero is fine.
 			 */
 			crc_val = 0;
 		}
@@ -1155,8 +1202,8 @@ START_TEST(test_rec_crc_zero_skipped)
 }
 END_TEST
 
-/* Record with xl_tot_len > page remainder → skipped silently, no error */
-START_TEST(test_rec_crc_multipage_skipped)
+/* Record running into a zero-filled page (end of WAL) → not checked, no error */
+START_TEST(test_rec_crc_multipage_unfinished)
 {
 	char           dir[64];
 	char           seg[PATH_MAX];
@@ -1285,6 +1332,328 @@ START_TEST(test_rec_crc_payload_mismatch)
 }
 END_TEST
 
+/* -------------------------------------------------------------------------
+ * Records spanning pages and segments
+ *
+ * WalStream lays records out the way PostgreSQL does: MAXALIGN'd, split
+ * at page boundaries, each continuation page carrying
+ * XLP_FIRST_IS_CONTRECORD and the remaining length in xlp_rem_len.
+ * Segments are 16 MB with 8 KB pages, held in memory and written out as
+ * sparse files.
+ * ------------------------------------------------------------------------- */
+
+#define WS_SEG     0x1000000U
+#define WS_BLCKSZ  8192U
+
+typedef struct {
+	uint8_t *buf;			/* nsegs * WS_SEG bytes */
+	int      nsegs;
+	uint32_t first_seg;		/* segment number of buf[0] (log_id 0, tli 1) */
+	size_t   pos;			/* next write position */
+	size_t   hi;			/* high-water mark */
+} WalStream;
+
+static void
+ws_put32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t) v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+/* Page header at 'pos' (a page boundary); long header at segment starts */
+static void
+ws_page_header(WalStream *ws, size_t pos, uint32_t rem_len)
+{
+	uint8_t *p = ws->buf + pos;
+	uint64_t pageaddr = (uint64_t) ws->first_seg * WS_SEG + pos;
+	bool     long_hdr = (pos % WS_SEG) == 0;
+
+	p[0] = 0x71; p[1] = 0xD0;
+	p[2] = (uint8_t)((long_hdr ? 0x02 : 0) | (rem_len ? 0x01 : 0));
+	ws_put32(p + 4, 1);
+	ws_put32(p + 8, (uint32_t) pageaddr);
+	ws_put32(p + 12, (uint32_t)(pageaddr >> 32));
+	ws_put32(p + 16, rem_len);
+	if (long_hdr)
+	{
+		p[24] = 0x01;
+		ws_put32(p + 32, WS_SEG);
+		ws_put32(p + 36, WS_BLCKSZ);
+	}
+}
+
+static size_t
+ws_header_size(size_t pos)
+{
+	return (pos % WS_SEG) == 0 ? 40 : 24;
+}
+
+static void
+ws_init(WalStream *ws, uint32_t first_seg, int nsegs)
+{
+	ws->buf = calloc((size_t) nsegs, WS_SEG);
+	ck_assert_ptr_nonnull(ws->buf);
+	ws->nsegs = nsegs;
+	ws->first_seg = first_seg;
+	ws->pos = 0;
+	ws->hi = 0;
+}
+
+/* Move to the start of page 'page' of stream segment 'seg' */
+static void
+ws_seek_page(WalStream *ws, int seg, uint32_t page)
+{
+	ws->pos = (size_t) seg * WS_SEG + (size_t) page * WS_BLCKSZ;
+}
+
+/*
+ * Append a record of 'tot_len' bytes (payload filled with 'fill') with a
+ * correct CRC.  Returns its stream position.
+ */
+static size_t
+ws_put_record(WalStream *ws, uint32_t tot_len, uint8_t fill)
+{
+	uint8_t *rec = calloc(1, tot_len);
+	uint32_t done = 0;
+	size_t   start;
+
+	ck_assert_ptr_nonnull(rec);
+	ws_put32(rec, tot_len);
+	memset(rec + 24, fill, tot_len - 24);
+	ws_put32(rec + 20, test_xlog_crc(rec, tot_len));
+
+	ws->pos = (ws->pos + 7) & ~(size_t) 7;
+	if (ws->pos % WS_BLCKSZ == 0)
+	{
+		ws_page_header(ws, ws->pos, 0);
+		ws->pos += ws_header_size(ws->pos);
+	}
+	start = ws->pos;
+
+	while (done < tot_len)
+	{
+		size_t room = WS_BLCKSZ - ws->pos % WS_BLCKSZ;
+		size_t n    = tot_len - done < room ? tot_len - done : room;
+
+		memcpy(ws->buf + ws->pos, rec + done, n);
+		done    += (uint32_t) n;
+		ws->pos += n;
+		if (done < tot_len)
+		{
+			ws_page_header(ws, ws->pos, tot_len - done);
+			ws->pos += ws_header_size(ws->pos);
+		}
+	}
+	if (ws->pos > ws->hi)
+		ws->hi = ws->pos;
+
+	free(rec);
+	return start;
+}
+
+/* Write every segment to 'dir'; segments the stream never reached get a header */
+static void
+ws_write(WalStream *ws, const char *dir)
+{
+	for (int i = 0; i < ws->nsegs; i++)
+	{
+		size_t  start = (size_t) i * WS_SEG;
+		size_t  used  = 40;
+		char    path[PATH_MAX];
+		FILE   *f;
+
+		if (ws->buf[start] == 0)
+			ws_page_header(ws, start, 0);
+		if (ws->hi > start)
+			used = ws->hi - start < WS_SEG ? ws->hi - start : WS_SEG;
+		if (used < 40)
+			used = 40;
+
+		snprintf(path, sizeof(path), "%s/0000000100000000%08X",
+				 dir, ws->first_seg + (uint32_t) i);
+		f = fopen(path, "wb");
+		ck_assert_ptr_nonnull(f);
+		fwrite(ws->buf + start, 1, used, f);
+		if (used < WS_SEG)
+		{
+			(void)fseek(f, (long) WS_SEG - 1, SEEK_SET);
+			(void)fputc('\0', f);
+		}
+		fclose(f);
+	}
+	free(ws->buf);
+	ws->buf = NULL;
+}
+
+/* Record spanning three pages, followed by a small one → no errors */
+START_TEST(test_rec_crc_cross_page_valid)
+{
+	char           dir[64];
+	BackupInfo     bi;
+	WALArchiveInfo wi;
+	WalStream      ws;
+	ValidationResult *r;
+
+	rec_test_setup(dir, sizeof(dir), &bi, &wi);
+	ws_init(&ws, 1, 1);
+	ws_put_record(&ws, 20000, 0xAB);
+	ws_put_record(&ws, 24, 0);
+	ws_write(&ws, dir);
+
+	r = check_wal_headers(&bi, &wi);
+	rec_test_teardown(dir);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+}
+END_TEST
+
+/* Byte flipped on the record's second page → CRC mismatch at its start */
+START_TEST(test_rec_crc_cross_page_mismatch)
+{
+	char           dir[64];
+	BackupInfo     bi;
+	WALArchiveInfo wi;
+	WalStream      ws;
+	ValidationResult *r;
+
+	rec_test_setup(dir, sizeof(dir), &bi, &wi);
+	ws_init(&ws, 1, 1);
+	ws_put_record(&ws, 20000, 0xAB);
+	ws.buf[WS_BLCKSZ + 100] ^= 0x01;
+	ws_write(&ws, dir);
+
+	r = check_wal_headers(&bi, &wi);
+	rec_test_teardown(dir);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "page 0 offset 40: CRC mismatch") != NULL);
+	free_validation_result(r);
+}
+END_TEST
+
+/* Continuation page without XLP_FIRST_IS_CONTRECORD → reported */
+START_TEST(test_rec_crc_cross_page_no_contrecord)
+{
+	char           dir[64];
+	BackupInfo     bi;
+	WALArchiveInfo wi;
+	WalStream      ws;
+	ValidationResult *r;
+
+	rec_test_setup(dir, sizeof(dir), &bi, &wi);
+	ws_init(&ws, 1, 1);
+	ws_put_record(&ws, 10000, 0xAB);
+	ws.buf[WS_BLCKSZ + 2] &= (uint8_t) ~0x01;
+	ws_write(&ws, dir);
+
+	r = check_wal_headers(&bi, &wi);
+	rec_test_teardown(dir);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_ge(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "continuation of record") != NULL);
+	ck_assert(strstr(r->errors[0], "is missing") != NULL);
+	free_validation_result(r);
+}
+END_TEST
+
+/*
+ * Record starting on the last page of segment 1 and ending in segment 2,
+ * corrupted in segment 2 → one CRC error, attributed to segment 1.
+ */
+START_TEST(test_rec_crc_cross_segment)
+{
+	char           dir[64];
+	BackupInfo     bi;
+	WALArchiveInfo wi;
+	WalStream      ws;
+	ValidationResult *r;
+
+	rec_test_setup(dir, sizeof(dir), &bi, &wi);
+	bi.stop_lsn = 0x2000000;	/* window covers segments 1 and 2 */
+	ws_init(&ws, 1, 2);
+	ws_seek_page(&ws, 0, WS_SEG / WS_BLCKSZ - 1);
+	ws_put_record(&ws, 12000, 0xCD);
+	ws_put_record(&ws, 24, 0);
+
+	/* Intact first: the record is checked with no error */
+	ws_write(&ws, dir);
+	r = check_wal_headers(&bi, &wi);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+
+	ws_init(&ws, 1, 2);
+	ws_seek_page(&ws, 0, WS_SEG / WS_BLCKSZ - 1);
+	ws_put_record(&ws, 12000, 0xCD);
+	ws.buf[WS_SEG + 40 + 8] ^= 0x01;
+	ws_write(&ws, dir);
+
+	r = check_wal_headers(&bi, &wi);
+	rec_test_teardown(dir);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "000000010000000000000001 page 2047") != NULL);
+	ck_assert(strstr(r->errors[0], "CRC mismatch") != NULL);
+	free_validation_result(r);
+}
+END_TEST
+
+/*
+ * Archive of nine segments: a record crossing from segment 8 into 9
+ * spans the boundary between two batches of the parallel validator.
+ * Corruption in segment 9 is still found, exactly once, with 4 jobs.
+ */
+START_TEST(test_archive_headers_cross_batch_record)
+{
+	char           dir[64];
+	WALArchiveInfo wi;
+	WALSegmentName segs[9];
+	WalStream      ws;
+	ValidationResult *r;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_warch_%d", (int)getpid());
+	mkdir(dir, 0755);
+
+	ws_init(&ws, 1, 9);
+	ws_seek_page(&ws, 7, WS_SEG / WS_BLCKSZ - 1);
+	ws_put_record(&ws, 30000, 0xEF);
+	ws.buf[8 * (size_t) WS_SEG + WS_BLCKSZ + 24 + 8] ^= 0x01;
+	ws_write(&ws, dir);
+
+	for (int i = 0; i < 9; i++)
+	{
+		segs[i].timeline = 1;
+		segs[i].log_id   = 0;
+		segs[i].seg_id   = (uint32_t)(i + 1);
+	}
+	memset(&wi, 0, sizeof(wi));
+	strncpy(wi.archive_path, dir, sizeof(wi.archive_path) - 1);
+	wi.segment_count = 9;
+	wi.segments = segs;
+
+	validation_set_jobs(4);
+	r = check_wal_archive_headers(&wi);
+	validation_set_jobs(1);
+	wi.segments = NULL;
+
+	char cmd[80];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "000000010000000000000008 page 2047") != NULL);
+	ck_assert(strstr(r->errors[0], "CRC mismatch") != NULL);
+	free_validation_result(r);
+}
+END_TEST
+
 /* -------------------------------------------------------------------------
  * Tests for check_wal_archive_headers()
  *
@@ -1480,50 +1849,44 @@ START_TEST(test_archive_headers_bad_pageaddr)
 END_TEST
 
 /*
- * Segment file has a valid 40-byte header (xlp_seg_size=16MB) but the file
- * is only 64 bytes.  Expected: 1 error containing "truncated".
+ * Twenty segments checked with 4 jobs, three of them (in different
+ * batches) with a wrong pageaddr.  Expected: 3 errors, reported in
+ * segment order regardless of which thread found them.
  */
-START_TEST(test_archive_headers_truncated)
+START_TEST(test_archive_headers_parallel_ordered)
 {
 	char           dir[64];
-	char           seg_path[PATH_MAX];
+	char           seg[PATH_MAX];
 	WALArchiveInfo wi;
 	ValidationResult *r;
-	WALSegmentName segs[1];
-	FILE          *f;
-	uint8_t        hdr[40] = {0};
+	WALSegmentName segs[20];
 
 	snprintf(dir, sizeof(dir), "/tmp/pg_warch_%d", (int)getpid());
 	mkdir(dir, 0755);
 
-	segs[0].timeline = 1;
-	segs[0].log_id   = 0;
-	segs[0].seg_id   = 1;
-
-	snprintf(seg_path, sizeof(seg_path), "%s/000000010000000000000001", dir);
+	for (int i = 0; i < 20; i++)
+	{
+		uint64_t pa = (uint64_t)(i + 1) * 0x1000000ULL;
 
-	/* Write a valid header with xlp_seg_size=16MB, but do NOT extend to 16MB */
-	hdr[0] = 0x71; hdr[1] = 0xD0;          /* xlp_magic */
-	hdr[2] = 0x02; hdr[3] = 0x00;          /* xlp_info = XLP_LONG_HEADER */
-	hdr[4] = 0x01;                          /* xlp_tli = 1 */
-	hdr[8] = 0x00; hdr[9] = 0x00;          /* xlp_pageaddr = 0x1000000 */
-	hdr[10] = 0x00; hdr[11] = 0x01;
-	hdr[24] = 0x01;                         /* xlp_sysid = 1 */
-	hdr[32] = 0x00; hdr[33] = 0x00;        /* xlp_seg_size = 16MB */
-	hdr[34] = 0x00; hdr[35] = 0x01;
-	hdr[36] = 0x00; hdr[37] = 0x20;        /* xlp_xlog_blcksz = 8192 */
+		segs[i].timeline = 1;
+		segs[i].log_id   = 0;
+		segs[i].seg_id   = (uint32_t)(i + 1);
 
-	f = fopen(seg_path, "wb");
-	ck_assert_ptr_nonnull(f);
-	fwrite(hdr, 1, sizeof(hdr), f);
-	fclose(f);                              /* file is 40 bytes — truncated */
+		if (i == 2 || i == 10 || i == 17)
+			pa = 0x1000000ULL;	/* wrong: segment 1's address */
+		snprintf(seg, sizeof(seg),
+				 "%s/0000000100000000%08X", dir, i + 1);
+		write_arch_test_seg(seg, 1, pa);
+	}
 
 	memset(&wi, 0, sizeof(wi));
 	strncpy(wi.archive_path, dir, sizeof(wi.archive_path) - 1);
-	wi.segment_count = 1;
+	wi.segment_count = 20;
 	wi.segments = segs;
 
+	validation_set_jobs(4);
 	r = check_wal_archive_headers(&wi);
+	validation_set_jobs(1);
 	wi.segments = NULL;
 
 	char cmd[80];
@@ -1531,35 +1894,528 @@ START_TEST(test_archive_headers_truncated)
 	(void)system(cmd);
 
 	ck_assert_ptr_nonnull(r);
-	ck_assert_int_eq(r->error_count, 1);
-	ck_assert(strstr(r->errors[0], "truncated") != NULL);
+	ck_assert_int_eq(r->error_count, 3);
+	ck_assert(strstr(r->errors[0], "000000010000000000000003") != NULL);
+	ck_assert(strstr(r->errors[1], "00000001000000000000000B") != NULL);
+	ck_assert(strstr(r->errors[2], "000000010000000000000012") != NULL);
 	free_validation_result(r);
 }
 END_TEST
 
-/* -------------------------------------------------------------------------
- * Tests for check_wal_restore_chain()
- *
- * check_wal_restore_chain() verifies that WAL is continuously available
- * between every consecutive pair of backups on the same timeline.
- * The "bridge" between backup A and backup B is the set of WAL segments
- * in the range [lsn_to_seg(A.stop_lsn)+1, lsn_to_seg(B.start_lsn)-1].
- * If any bridge segment is absent from the archive an error is reported.
- *
- * These tests use in-memory WALArchiveInfo (no real files needed —
- * segment_exists_in_archive() checks the segments[] array, not the fs).
- * BackupInfo nodes are heap-allocated and freed by free_chain() below.
- * ------------------------------------------------------------------------- */
-
-/* Helper: build a heap-allocated BackupInfo linked list node. */
-static BackupInfo *
-make_backup_node(const char *id, uint32_t tli,
-				 uint64_t start_lsn, uint64_t stop_lsn,
-				 BackupInfo *next)
+/*
+ * With a cache directory, a clean segment is not read again while its
+ * size, mtime and inode are unchanged: corrupting it in place and
+ * restoring the mtime goes unnoticed, touching it brings the error back.
+ * Segments with errors are never cached.
+ */
+START_TEST(test_archive_headers_cached)
 {
-	BackupInfo *b = calloc(1, sizeof(BackupInfo));
-
-	strncpy(b->backup_id, id, sizeof(b->backup_id) - 1);
+	char           dir[64];
+	char           cache[96];
+	char           seg[PATH_MAX];
+	WALArchiveInfo wi;
+	ValidationResult *r;
+	WALSegmentName segs[3];
+	struct stat    st;
+	struct timespec times[2];
+	FILE          *f;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_warch_%d", (int)getpid());
+	snprintf(cache, sizeof(cache), "%s/cache", dir);
+	mkdir(dir, 0755);
+	mkdir(cache, 0755);
+
+	for (int i = 0; i < 3; i++)
+	{
+		segs[i].timeline = 1;
+		segs[i].log_id   = 0;
+		segs[i].seg_id   = (uint32_t)(i + 1);
+		snprintf(seg, sizeof(seg), "%s/0000000100000000%08X", dir, i + 1);
+		write_arch_test_seg(seg, 1, (uint64_t)(i + 1) * 0x1000000ULL);
+	}
+	memset(&wi, 0, sizeof(wi));
+	strncpy(wi.archive_path, dir, sizeof(wi.archive_path) - 1);
+	wi.segment_count = 3;
+	wi.segments = segs;
+
+	validation_set_cache_dir(cache);
+
+	r = check_wal_archive_headers(&wi);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+
+	/* Wrong pageaddr in segment 2, same size, mtime put back */
+	snprintf(seg, sizeof(seg), "%s/000000010000000000000002", dir);
+	ck_assert_int_eq(stat(seg, &st), 0);
+	f = fopen(seg, "r+b");
+	ck_assert_ptr_nonnull(f);
+	(void)fseek(f, 11, SEEK_SET);
+	(void)fputc(0x07, f);
+	fclose(f);
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	ck_assert_int_eq(utimensat(AT_FDCWD, seg, times, 0), 0);
+
+	r = check_wal_archive_headers(&wi);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+
+	/* New mtime: read again, and reported on every run from now on */
+	times[1].tv_sec += 10;
+	ck_assert_int_eq(utimensat(AT_FDCWD, seg, times, 0), 0);
+	for (int run = 0; run < 2; run++)
+	{
+		r = check_wal_archive_headers(&wi);
+		ck_assert_int_eq(r->error_count, 1);
+		ck_assert(strstr(r->errors[0], "000000010000000000000002") != NULL);
+		free_validation_result(r);
+	}
+
+	validation_set_cache_dir(NULL);
+	wi.segments = NULL;
+
+	char cmd[80];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/*
+ * Segment file has a valid 40-byte header (xlp_seg_size=16MB) but the file
+ * is only 64 bytes.  Expected: 1 error containing "truncated".
+ */
+START_TEST(test_archive_headers_truncated)
+{
+	char           dir[64];
+	char           seg_path[PATH_MAX];
+	WALArchiveInfo wi;
+	ValidationResult *r;
+	WALSegmentName segs[1];
+	FILE          *f;
+	uint8_t        hdr[40] = {0};
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_warch_%d", (int)getpid());
+	mkdir(dir, 0755);
+
+	segs[0].timeline = 1;
+	segs[0].log_id   = 0;
+	segs[0].seg_id   = 1;
+
+	snprintf(seg_path, sizeof(seg_path), "%s/000000010000000000000001", dir);
+
+	/* Write a valid header with xlp_seg_size=16MB, but do NOT extend to 16MB */
+	hdr[0] = 0x71; hdr[1] = 0xD0;          /* xlp_magic */
+	hdr[2] = 0x02; hdr[3] = 0x00;          /* xlp_info = XLP_LONG_HEADER */
+	hdr[4] = 0x01;                          /* xlp_tli = 1 */
+	hdr[8] = 0x00; hdr[9] = 0x00;          /* xlp_pageaddr = 0x1000000 */
+	hdr[10] = 0x00; hdr[11] = 0x01;
+	hdr[24] = 0x01;                         /* xlp_sysid = 1 */
+	hdr[32] = 0x00; hdr[33] = 0x00;        /* xlp_seg_size = 16MB */
+	hdr[34] = 0x00; hdr[35] = 0x01;
+	hdr[36] = 0x00; hdr[37] = 0x20;        /* xlp_xlog_blcksz = 8192 */
+
+	f = fopen(seg_path, "wb");
+	ck_assert_ptr_nonnull(f);
+	fwrite(hdr, 1, sizeof(hdr), f);
+	fclose(f);                              /* file is 40 bytes — truncated */
+
+	memset(&wi, 0, sizeof(wi));
+	strncpy(wi.archive_path, dir, sizeof(wi.archive_path) - 1);
+	wi.segment_count = 1;
+	wi.segments = segs;
+
+	r = check_wal_archive_headers(&wi);
+	wi.segments = NULL;
+
+	char cmd[80];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "truncated") != NULL);
+	free_validation_result(r);
+}
+END_TEST
+
+/*
+ * --wal-headers-only: only page headers (and plain segments' lengths)
+ * are checked, so a bad record CRC goes unnoticed while a swapped or
+ * truncated segment is still reported, in segment order across batches.
+ */
+START_TEST(test_archive_headers_only)
+{
+	char           dir[64];
+	char           seg_path[PATH_MAX];
+	WALArchiveInfo wi;
+	ValidationResult *r;
+	WALSegmentName segs[100];
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_warch_%d", (int)getpid());
+	mkdir(dir, 0755);
+
+	for (int i = 0; i < 100; i++)
+	{
+		segs[i].timeline = 1;
+		segs[i].log_id   = 0;
+		segs[i].seg_id   = (uint32_t)(i + 1);
+		snprintf(seg_path, sizeof(seg_path), "%s/0000000100000000%08X", dir, i + 1);
+		if (i == 0)
+			write_rec_test_seg(seg_path, 3, 1, -1, false, false);
+		else
+			write_arch_test_seg(seg_path, 1,
+								(uint64_t)(i == 49 ? 7 : i + 1) * 0x1000000ULL);
+	}
+	snprintf(seg_path, sizeof(seg_path), "%s/0000000100000000%08X", dir, 100);
+	ck_assert_int_eq(truncate(seg_path, 8192), 0);
+
+	memset(&wi, 0, sizeof(wi));
+	strncpy(wi.archive_path, dir, sizeof(wi.archive_path) - 1);
+	wi.segment_count = 100;
+	wi.segments = segs;
+
+	/* The record pass finds the bad CRC in segment 1 */
+	r = check_wal_segments(&wi, segs, 1);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "CRC mismatch") != NULL);
+	free_validation_result(r);
+
+	validation_set_wal_headers_only(true);
+	ck_assert(validation_wal_headers_only());
+	r = check_wal_archive_headers(&wi);
+	validation_set_wal_headers_only(false);
+	wi.segments = NULL;
+
+	char cmd[80];
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 2);
+	ck_assert(strstr(r->errors[0], "000000010000000000000032") != NULL);
+	ck_assert(strstr(r->errors[0], "page address mismatch") != NULL);
+	ck_assert(strstr(r->errors[1], "000000010000000000000064") != NULL);
+	ck_assert(strstr(r->errors[1], "truncated") != NULL);
+	free_validation_result(r);
+}
+END_TEST
+
+/*
+ * Compressed segments, as pg_probackup (<name>.gz) and pgBackRest
+ * (<timeline><log_id>/<name>-<sha1>.gz) store them, are found by
+ * scan_wal_archive() and validated on the decompressed stream.
+ */
+START_TEST(test_archive_headers_compressed)
+{
+	char           dir[64];
+	char           seg[PATH_MAX];
+	char           cmd[PATH_MAX + 64];
+	char           path[PATH_MAX];
+	WALArchiveInfo *wi;
+	ValidationResult *r;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_warch_gz_%d", (int)getpid());
+	mkdir(dir, 0755);
+
+	snprintf(seg, sizeof(seg), "%s/000000010000000000000001", dir);
+	write_arch_test_seg(seg, 1, 0x1000000ULL);
+
+	snprintf(seg, sizeof(seg), "%s/000000010000000000000002", dir);
+	write_arch_test_seg(seg, 1, 0x2000000ULL);
+	snprintf(cmd, sizeof(cmd), "gzip -1 '%s'", seg);
+	ck_assert_int_eq(system(cmd), 0);
+
+	snprintf(path, sizeof(path), "%s/0000000100000000", dir);
+	mkdir(path, 0755);
+	snprintf(seg, sizeof(seg), "%s/000000010000000000000003", path);
+	write_arch_test_seg(seg, 1, 0x3000000ULL);
+	snprintf(cmd, sizeof(cmd),
+			 "gzip -1 -c '%s' > '%s-0123456789abcdef0123456789abcdef01234567.gz'"
+			 " && rm '%s'", seg, seg, seg);
+	ck_assert_int_eq(system(cmd), 0);
+
+	wi = scan_wal_archive(dir);
+	ck_assert_ptr_nonnull(wi);
+	ck_assert_int_eq(wi->segment_count, 3);
+
+	r = check_wal_archive_headers(wi);
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+
+	/* A swapped compressed segment is caught from its first page */
+	snprintf(seg, sizeof(seg), "%s/000000010000000000000002.gz", dir);
+	unlink(seg);
+	snprintf(seg, sizeof(seg), "%s/000000010000000000000002", dir);
+	write_arch_test_seg(seg, 1, 0x1000000ULL);
+	snprintf(cmd, sizeof(cmd), "gzip -1 '%s'", seg);
+	ck_assert_int_eq(system(cmd), 0);
+
+	r = check_wal_archive_headers(wi);
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "page address mismatch") != NULL);
+	free_validation_result(r);
+	free_wal_archive_info(wi);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/*
+ * A compressed segment that decompresses to less than xlp_seg_size is
+ * reported as truncated, though the .gz file size says nothing about it.
+ */
+START_TEST(test_archive_headers_compressed_truncated)
+{
+	char           dir[64];
+	char           seg[PATH_MAX];
+	char           cmd[PATH_MAX + 64];
+	WALArchiveInfo *wi;
+	ValidationResult *r;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_warch_gzt_%d", (int)getpid());
+	mkdir(dir, 0755);
+
+	snprintf(seg, sizeof(seg), "%s/000000010000000000000001", dir);
+	write_arch_test_seg(seg, 1, 0x1000000ULL);
+	ck_assert_int_eq(truncate(seg, 65536), 0);
+	snprintf(cmd, sizeof(cmd), "gzip '%s'", seg);
+	ck_assert_int_eq(system(cmd), 0);
+
+	wi = scan_wal_archive(dir);
+	ck_assert_ptr_nonnull(wi);
+	ck_assert_int_eq(wi->segment_count, 1);
+
+	r = check_wal_archive_headers(wi);
+	ck_assert_ptr_nonnull(r);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "truncated") != NULL);
+	free_validation_result(r);
+	free_wal_archive_info(wi);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/* -------------------------------------------------------------------------
+ * Tests for check_wal_segment_file() ('verify-segment')
+ * ------------------------------------------------------------------------- */
+
+/* True if the WAL cache of 'dir' has segment 'seg_id' as clean */
+static bool
+seg_cached(const char *dir, uint32_t seg_id)
+{
+	char        path[PATH_MAX];
+	struct stat st;
+	WALCache   *cache = wal_cache_open(dir, WS_SEG);
+	bool        found;
+
+	snprintf(path, sizeof(path), "%s/0000000100000000%08X", dir, seg_id);
+	ck_assert_int_eq(stat(path, &st), 0);
+	found = wal_cache_lookup(cache, path, &st);
+	wal_cache_close(cache, false);
+	return found;
+}
+
+/* check_wal_segment_file() of segment 'seg_id' of 'dir'; its error count */
+static int
+verify_one_segment(const char *dir, uint32_t seg_id, char *first_error, size_t size)
+{
+	char              path[PATH_MAX];
+	ValidationResult *r;
+	int               errors;
+
+	snprintf(path, sizeof(path), "%s/0000000100000000%08X", dir, seg_id);
+	r = check_wal_segment_file(path, dir);
+	ck_assert_ptr_nonnull(r);
+	errors = r->error_count;
+	if (first_error != NULL)
+		snprintf(first_error, size, "%s", errors > 0 ? r->errors[0] : "");
+	free_validation_result(r);
+	return errors;
+}
+
+/*
+ * Segments verified one by one as they are archived: a segment whose
+ * last record runs into the next one is cached only once that one has
+ * been verified, and the record with it.  A full check then skips them.
+ */
+START_TEST(test_verify_segment_cached)
+{
+	char           dir[64];
+	char           cache[96];
+	char           seg[PATH_MAX];
+	char           cmd[160];
+	WALArchiveInfo wi;
+	WALSegmentName segs[2];
+	WalStream      ws;
+	ValidationResult *r;
+	struct stat    st;
+	struct timespec times[2];
+	FILE          *f;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_wseg_%d", (int)getpid());
+	snprintf(cache, sizeof(cache), "%s/cache", dir);
+	mkdir(dir, 0755);
+	mkdir(cache, 0755);
+
+	ws_init(&ws, 1, 2);
+	ws_seek_page(&ws, 0, WS_SEG / WS_BLCKSZ - 1);
+	ws_put_record(&ws, 12000, 0xCD);
+	ws_put_record(&ws, 24, 0);
+	ws_write(&ws, dir);
+
+	validation_set_cache_dir(cache);
+
+	ck_assert_int_eq(verify_one_segment(dir, 1, NULL, 0), 0);
+	ck_assert(!seg_cached(dir, 1));		/* its last record is not checked yet */
+
+	ck_assert_int_eq(verify_one_segment(dir, 2, NULL, 0), 0);
+	ck_assert(seg_cached(dir, 1));
+	ck_assert(seg_cached(dir, 2));
+
+	/* Damage segment 1 in place, mtime put back: the full check skips it */
+	snprintf(seg, sizeof(seg), "%s/000000010000000000000001", dir);
+	ck_assert_int_eq(stat(seg, &st), 0);
+	f = fopen(seg, "r+b");
+	ck_assert_ptr_nonnull(f);
+	(void)fseek(f, 11, SEEK_SET);
+	(void)fputc(0x07, f);
+	fclose(f);
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	ck_assert_int_eq(utimensat(AT_FDCWD, seg, times, 0), 0);
+
+	for (int i = 0; i < 2; i++)
+	{
+		segs[i].timeline = 1;
+		segs[i].log_id   = 0;
+		segs[i].seg_id   = (uint32_t)(i + 1);
+	}
+	memset(&wi, 0, sizeof(wi));
+	strncpy(wi.archive_path, dir, sizeof(wi.archive_path) - 1);
+	wi.segment_count = 2;
+	wi.segments = segs;
+
+	r = check_wal_archive_headers(&wi);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+
+	validation_set_cache_dir(NULL);
+	wi.segments = NULL;
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/*
+ * The record running from segment 1 into segment 2 is damaged in
+ * segment 2: found when segment 2 is verified, reported at its start,
+ * and neither segment is cached
+ */
+START_TEST(test_verify_segment_cross_record)
+{
+	char      dir[64];
+	char      cache[96];
+	char      err[512];
+	char      cmd[160];
+	WalStream ws;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_wseg_%d", (int)getpid());
+	snprintf(cache, sizeof(cache), "%s/cache", dir);
+	mkdir(dir, 0755);
+	mkdir(cache, 0755);
+
+	ws_init(&ws, 1, 2);
+	ws_seek_page(&ws, 0, WS_SEG / WS_BLCKSZ - 1);
+	ws_put_record(&ws, 12000, 0xCD);
+	ws.buf[WS_SEG + 40 + 8] ^= 0x01;
+	ws_write(&ws, dir);
+
+	validation_set_cache_dir(cache);
+	ck_assert_int_eq(verify_one_segment(dir, 1, NULL, 0), 0);
+	ck_assert_int_eq(verify_one_segment(dir, 2, err, sizeof(err)), 1);
+	ck_assert(strstr(err, "000000010000000000000001 page 2047") != NULL);
+	ck_assert(strstr(err, "CRC mismatch") != NULL);
+	ck_assert(!seg_cached(dir, 1));
+	ck_assert(!seg_cached(dir, 2));
+
+	/* Without the kept record, segment 2 alone is clean */
+	ck_assert_int_eq(verify_one_segment(dir, 2, NULL, 0), 0);
+	ck_assert(seg_cached(dir, 2));
+	ck_assert(!seg_cached(dir, 1));
+
+	validation_set_cache_dir(NULL);
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/* Timeline and segment number come from the name: a misnamed file is caught */
+START_TEST(test_verify_segment_misnamed)
+{
+	char              dir[64];
+	char              path[PATH_MAX];
+	char              cmd[160];
+	ValidationResult *r;
+	WalStream         ws;
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_wseg_%d", (int)getpid());
+	mkdir(dir, 0755);
+	ws_init(&ws, 1, 1);
+	ws_put_record(&ws, 24, 0);
+	ws_write(&ws, dir);
+
+	snprintf(path, sizeof(path), "%s/000000010000000000000001", dir);
+	r = check_wal_segment_file(path, dir);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+
+	snprintf(cmd, sizeof(cmd), "mv %s %s/000000010000000000000005", path, dir);
+	ck_assert_int_eq(system(cmd), 0);
+	snprintf(path, sizeof(path), "%s/000000010000000000000005", dir);
+	r = check_wal_segment_file(path, dir);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "page address mismatch") != NULL);
+	free_validation_result(r);
+
+	snprintf(path, sizeof(path), "%s/backup_label", dir);
+	r = check_wal_segment_file(path, dir);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "not a WAL segment file name") != NULL);
+	free_validation_result(r);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	(void)system(cmd);
+}
+END_TEST
+
+/* -------------------------------------------------------------------------
+ * Tests for check_wal_restore_chain()
+ *
+ * check_wal_restore_chain() verifies that WAL is continuously available
+ * between every consecutive pair of backups on the same timeline.
+ * The "bridge" between backup A and backup B is the set of WAL segments
+ * in the range [lsn_to_seg(A.stop_lsn)+1, lsn_to_seg(B.start_lsn)-1].
+ * If any bridge segment is absent from the archive an error is reported.
+ *
+ * These tests use in-memory WALArchiveInfo (no real files needed —
+ * segment_exists_in_archive() checks the segments[] array, not the fs).
+ * BackupInfo nodes are heap-allocated and freed by free_chain() below.
+ * ------------------------------------------------------------------------- */
+
+/* Helper: build a heap-allocated BackupInfo linked list node. */
+static BackupInfo *
+make_backup_node(const char *id, uint32_t tli,
+				 uint64_t start_lsn, uint64_t stop_lsn,
+				 BackupInfo *next)
+{
+	BackupInfo *b = calloc(1, sizeof(BackupInfo));
+
+	strncpy(b->backup_id, id, sizeof(b->backup_id) - 1);
 	b->timeline  = tli;
 	b->start_lsn = start_lsn;
 	b->stop_lsn  = stop_lsn;
@@ -1775,8 +2631,9 @@ END_TEST
  *
  * The switch LSN comes from the NNNNNNNN.history file in the archive.
  *
- * These tests write a real history file to a temp dir because
- * parse_history_switchpoint() reads from disk; segment presence is checked
+ * These tests write a real history file to a temp dir because archives
+ * built in memory have no timeline graph and the history file is read
+ * from disk; segment presence is checked
  * via the in-memory segments[] array (no segment files needed).
  * ------------------------------------------------------------------------- */
 
@@ -1802,8 +2659,8 @@ write_history_file(const char *dir, uint32_t new_tli, uint32_t parent_tli,
 
 /*
  * Helper: build an in-memory WALArchiveInfo from an explicit WALSegmentName
- * array (may mix timelines).  archive_path is set so that parse_history_*
- * can find the history file on disk.
+ * array (may mix timelines).  archive_path is set so that the history
+ * file can be found on disk.
  */
 static void
 build_archive_from_segs(WALArchiveInfo *wi, const char *archive_path,
@@ -2127,7 +2984,7 @@ END_TEST
 
 /*
  * database/pg_wal/ exists but contains no WAL files.
- * Expected: 3 errors (segments 1, 2, 3 all missing).
+ * Expected: 1 error covering segments 1 .. 3.
  */
 START_TEST(test_stream_wal_empty_dir)
 {
@@ -2166,7 +3023,10 @@ START_TEST(test_stream_wal_empty_dir)
 	free_wal_archive_info(wi);
 
 	ck_assert_ptr_nonnull(r);
-	ck_assert_int_eq(r->error_count, 3);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert_str_eq(r->errors[0],
+					 "Missing WAL segments: 000000010000000000000001 .. "
+					 "000000010000000000000003 (3 segments)");
 	free_validation_result(r);
 }
 END_TEST
@@ -2328,6 +3188,200 @@ START_TEST(test_seg_size_1mb_headers)
 }
 END_TEST
 
+/*
+ * Write a 24-byte record at 'off' of segment 'path', its CRC corrupted if
+ * 'bad'.  With 'page_header' a short page header for 'pageaddr' goes
+ * first, at 'off' - 24.
+ */
+static void
+patch_seg_record(const char *path, long off, bool bad, bool page_header,
+				 uint64_t pageaddr)
+{
+	FILE    *f = fopen(path, "r+b");
+	uint8_t  rec[24] = {0};
+	uint32_t crc;
+
+	ck_assert_ptr_nonnull(f);
+	if (page_header)
+	{
+		uint8_t hdr[24] = {0};
+
+		hdr[0] = 0x71; hdr[1] = 0xD0;
+		hdr[4] = 0x01;
+		ws_put32(hdr + 8, (uint32_t) pageaddr);
+		ws_put32(hdr + 12, (uint32_t)(pageaddr >> 32));
+		(void)fseek(f, off - 24, SEEK_SET);
+		fwrite(hdr, 1, sizeof(hdr), f);
+	}
+	ws_put32(rec, 24);
+	crc = test_xlog_crc(rec, 24);
+	ws_put32(rec + 20, bad ? crc ^ 0xDEADBEEF : crc);
+	(void)fseek(f, off, SEEK_SET);
+	fwrite(rec, 1, sizeof(rec), f);
+	fclose(f);
+}
+
+/*
+ * 16 MB segments take the constant-geometry page walker, other sizes the
+ * generic one; both must find the same records.  Page 0 holds a good and
+ * a bad record, pages 1..4 are zero and page 5 holds another bad one.
+ */
+START_TEST(test_seg_size_walkers_agree)
+{
+	static const uint32_t sizes[] = { 0x1000000, 0x100000 };
+	char            dir[PATH_MAX];
+	char            seg[PATH_MAX];
+	char            cmd[PATH_MAX + 8];
+
+	snprintf(dir, sizeof(dir), "/tmp/pg_szwalk_%d", (int)getpid());
+
+	for (int i = 0; i < 2; i++)
+	{
+		uint32_t          sz = sizes[i];
+		WALArchiveInfo   *wi;
+		BackupInfo        bi;
+		ValidationResult *r;
+
+		mkdir(dir, 0755);
+		snprintf(seg, sizeof(seg), "%s/000000010000000000000001", dir);
+		write_wal_seg_with_size(seg, 1, sz, sz);
+		patch_seg_record(seg, 40, false, false, 0);
+		patch_seg_record(seg, 64, true, false, 0);
+		patch_seg_record(seg, 5 * 8192 + 24, true, true, sz + 5 * 8192);
+
+		wi = scan_wal_archive(dir);
+		ck_assert_ptr_nonnull(wi);
+
+		memset(&bi, 0, sizeof(bi));
+		strcpy(bi.backup_id, "seg-walkers");
+		bi.timeline  = 1;
+		bi.start_lsn = sz;
+		bi.stop_lsn  = sz;
+
+		r = check_wal_headers(&bi, wi);
+		free_wal_archive_info(wi);
+		snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+		(void)system(cmd);
+
+		ck_assert_ptr_nonnull(r);
+		ck_assert_int_eq(r->error_count, 2);
+		ck_assert(strstr(r->errors[0], "CRC mismatch") != NULL);
+		ck_assert(strstr(r->errors[1], "CRC mismatch") != NULL);
+		free_validation_result(r);
+	}
+}
+END_TEST
+
+/*
+ * Tar the segments of 'src' into 'tar_path' (gzip'd if 'gzip') in name
+ * order, as pg_basebackup writes pg_wal.tar* for a tar-format stream
+ * backup.
+ */
+static void
+tar_wal_dir(const char *src, const char *tar_path, bool gzip)
+{
+	char cmd[PATH_MAX * 3 + 32];
+
+	snprintf(cmd, sizeof(cmd), "tar c%sf '%s' -C '%s' $(ls '%s')",
+			 gzip ? "z" : "", tar_path, src, src);
+	ck_assert_int_eq(system(cmd), 0);
+}
+
+/*
+ * pg_wal.tar is listed from its member headers and its segments are
+ * checked in one pass: a record crossing from one member into the next
+ * is followed, and corruption in it is found in a compressed tar too.
+ */
+START_TEST(test_stream_wal_tar)
+{
+	char           dir[64];
+	char           src[PATH_MAX];
+	char           tar_path[PATH_MAX];
+	char           cmd[PATH_MAX + 8];
+	BackupInfo     bi;
+	WALArchiveInfo ignored;
+	WALArchiveInfo *wi;
+	WalStream      ws;
+	ValidationResult *r;
+	const WALTimeline *tl;
+
+	rec_test_setup(dir, sizeof(dir), &bi, &ignored);
+	bi.stop_lsn = 0x2000000;	/* window covers segments 1 and 2 */
+	snprintf(src, sizeof(src), "%s/pg_wal", dir);
+	snprintf(tar_path, sizeof(tar_path), "%s/pg_wal.tar", dir);
+	ck_assert_int_eq(mkdir(src, 0755), 0);
+	snprintf(cmd, sizeof(cmd), "%s/archive_status", src);
+	ck_assert_int_eq(mkdir(cmd, 0755), 0);
+	write_history_file(src, 2, 1, "0/5000000");
+
+	ws_init(&ws, 1, 2);
+	ws_seek_page(&ws, 0, WS_SEG / WS_BLCKSZ - 1);
+	ws_put_record(&ws, 12000, 0xCD);
+	ws_put_record(&ws, 24, 0);
+	ws_write(&ws, src);
+	tar_wal_dir(src, tar_path, false);
+
+	wi = scan_wal_archive(tar_path);
+	ck_assert_ptr_nonnull(wi);
+	ck_assert(wi->in_tar);
+	ck_assert_int_eq(wi->segment_count, 2);
+	ck_assert_uint_eq(wi->segments[1].seg_id, 2);
+	ck_assert_uint_eq(wi->segment_size, WS_SEG);
+	ck_assert_uint_eq(wi->stats[0].size, WS_SEG);
+	ck_assert_int_eq(wi->range_count, 1);
+	tl = wal_timelines_find(wi->timelines, wi->timeline_count, 2);
+	ck_assert_ptr_nonnull(tl);
+	ck_assert(tl->has_history);
+	ck_assert_uint_eq(tl->parent, 1);
+
+	r = check_wal_availability(&bi, wi);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+	r = check_wal_headers(&bi, wi);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+	free_wal_archive_info(wi);
+
+	/* Corrupt the part of the record in segment 2, and compress the tar */
+	ws_init(&ws, 1, 2);
+	ws_seek_page(&ws, 0, WS_SEG / WS_BLCKSZ - 1);
+	ws_put_record(&ws, 12000, 0xCD);
+	ws.buf[WS_SEG + 40 + 8] ^= 0x01;
+	ws_write(&ws, src);
+	snprintf(tar_path, sizeof(tar_path), "%s/pg_wal.tar.gz", dir);
+	tar_wal_dir(src, tar_path, true);
+
+	wi = scan_wal_archive(tar_path);
+	ck_assert_ptr_nonnull(wi);
+	ck_assert_int_eq(wi->segment_count, 2);
+	r = check_wal_headers(&bi, wi);
+	ck_assert_int_eq(r->error_count, 1);
+	ck_assert(strstr(r->errors[0], "000000010000000000000001 page 2047") != NULL);
+	ck_assert(strstr(r->errors[0], "CRC mismatch") != NULL);
+	free_validation_result(r);
+
+	/* Header-only: the page headers are fine, records are not read */
+	validation_set_wal_headers_only(true);
+	r = check_wal_headers(&bi, wi);
+	validation_set_wal_headers_only(false);
+	ck_assert_int_eq(r->error_count, 0);
+	free_validation_result(r);
+	free_wal_archive_info(wi);
+
+	/* A tar cut short: what is before the damage is still listed */
+	snprintf(tar_path, sizeof(tar_path), "%s/pg_wal.tar", dir);
+	ck_assert_int_eq(truncate(tar_path, WS_SEG + 4096), 0);
+	wi = scan_wal_archive(tar_path);
+	ck_assert_ptr_nonnull(wi);
+	r = check_wal_headers(&bi, wi);
+	ck_assert_int_ge(r->error_count, 1);
+	free_validation_result(r);
+	free_wal_archive_info(wi);
+
+	rec_test_teardown(dir);
+}
+END_TEST
+
 /*
  * Test Suite
  */
@@ -2354,6 +3408,7 @@ wal_validator_suite(void)
 	tcase_add_test(tc_availability, test_check_wal_availability_no_lsn);
 	tcase_add_test(tc_availability, test_check_wal_availability_single_segment);
 	tcase_add_test(tc_availability, test_check_wal_availability_gap);
+	tcase_add_test(tc_availability, test_check_wal_availability_log_boundary);
 	tcase_add_test(tc_availability, test_check_wal_availability_empty_archive);
 	suite_add_tcase(s, tc_availability);
 
@@ -2369,12 +3424,14 @@ wal_validator_suite(void)
 	tcase_add_test(tc_stream_wal, test_stream_wal_all_present);
 	tcase_add_test(tc_stream_wal, test_stream_wal_missing_segment);
 	tcase_add_test(tc_stream_wal, test_stream_wal_empty_dir);
+	tcase_add_test(tc_stream_wal, test_stream_wal_tar);
 	suite_add_tcase(s, tc_stream_wal);
 
 	/* Non-standard WAL segment size unit tests (BUG-002 fix) */
 	tc_seg_size = tcase_create("seg_size");
 	tcase_add_test(tc_seg_size, test_seg_size_1mb_avail);
 	tcase_add_test(tc_seg_size, test_seg_size_1mb_headers);
+	tcase_add_test(tc_seg_size, test_seg_size_walkers_agree);
 	suite_add_tcase(s, tc_seg_size);
 
 	/* Per-record CRC unit tests */
@@ -2383,9 +3440,13 @@ wal_validator_suite(void)
 	tcase_add_test(tc_rec_crc, test_rec_crc_mismatch);
 	tcase_add_test(tc_rec_crc, test_rec_crc_invalid_totlen);
 	tcase_add_test(tc_rec_crc, test_rec_crc_zero_skipped);
-	tcase_add_test(tc_rec_crc, test_rec_crc_multipage_skipped);
+	tcase_add_test(tc_rec_crc, test_rec_crc_multipage_unfinished);
 	tcase_add_test(tc_rec_crc, test_rec_crc_payload_valid);
 	tcase_add_test(tc_rec_crc, test_rec_crc_payload_mismatch);
+	tcase_add_test(tc_rec_crc, test_rec_crc_cross_page_valid);
+	tcase_add_test(tc_rec_crc, test_rec_crc_cross_page_mismatch);
+	tcase_add_test(tc_rec_crc, test_rec_crc_cross_page_no_contrecord);
+	tcase_add_test(tc_rec_crc, test_rec_crc_cross_segment);
 	suite_add_tcase(s, tc_rec_crc);
 
 	/* Archive-wide header validation unit tests (BUG-003 fix) */
@@ -2394,7 +3455,16 @@ wal_validator_suite(void)
 	tcase_add_test(tc_arch_headers, test_archive_headers_empty);
 	tcase_add_test(tc_arch_headers, test_archive_headers_all_valid);
 	tcase_add_test(tc_arch_headers, test_archive_headers_bad_pageaddr);
+	tcase_add_test(tc_arch_headers, test_archive_headers_parallel_ordered);
+	tcase_add_test(tc_arch_headers, test_archive_headers_cross_batch_record);
+	tcase_add_test(tc_arch_headers, test_archive_headers_cached);
 	tcase_add_test(tc_arch_headers, test_archive_headers_truncated);
+	tcase_add_test(tc_arch_headers, test_archive_headers_only);
+	tcase_add_test(tc_arch_headers, test_archive_headers_compressed);
+	tcase_add_test(tc_arch_headers, test_archive_headers_compressed_truncated);
+	tcase_add_test(tc_arch_headers, test_verify_segment_cached);
+	tcase_add_test(tc_arch_headers, test_verify_segment_cross_record);
+	tcase_add_test(tc_arch_headers, test_verify_segment_misnamed);
 	suite_add_tcase(s, tc_arch_headers);
 
 	/* Restore-chain WAL continuity unit tests */
@@ -160,19 +160,92 @@ START_TEST(test_lsn_to_seg_overflow)
 
 	/* Test large LSN that causes log_id increment
 	 * Segment number = LSN / 16MB
-	 * log_id = segment_number / 0x100000000
-	 * seg_id = segment_number % 0x100000000
+	 * log_id = segment_number / (4 GB / 16MB), i.e. the LSN's high half
+	 * seg_id = segment_number % (4 GB / 16MB)
 	 */
 
 	/* LSN that results in segment 0x100000001 */
 	uint64_t large_lsn = 0x100000001ULL * 0x1000000ULL;
 	lsn_to_seg(large_lsn, 1, &seg, 0x1000000);
 	ck_assert_uint_eq(seg.timeline, 1);
-	ck_assert_uint_eq(seg.log_id, 1);
+	ck_assert_uint_eq(seg.log_id, 0x1000000);
 	ck_assert_uint_eq(seg.seg_id, 1);
 }
 END_TEST
 
+/*
+ * Test: Segment numbers and the segment after the last one of a log
+ */
+START_TEST(test_wal_segment_number)
+{
+	WALSegmentName seg = { 1, 0, 0xFF };
+
+	ck_assert_uint_eq(wal_segments_per_xlogid(0), 0x100);
+	ck_assert_uint_eq(wal_segments_per_xlogid(0x40000000), 4);
+	ck_assert_uint_eq(wal_segment_number(&seg, 0), 0xFF);
+
+	wal_segment_next(&seg, 0x1000000);
+	ck_assert_uint_eq(seg.log_id, 1);
+	ck_assert_uint_eq(seg.seg_id, 0);
+	ck_assert_uint_eq(wal_segment_number(&seg, 0x1000000), 0x100);
+
+	wal_segment_from_number(0x2345, 3, &seg, 0);
+	ck_assert_uint_eq(seg.timeline, 3);
+	ck_assert_uint_eq(seg.log_id, 0x23);
+	ck_assert_uint_eq(seg.seg_id, 0x45);
+
+	/* 64 MB segments: 64 per log, 0x1F/FC000000 is log 0x1F, seg 0x3F */
+	lsn_to_seg(0x1FFC000000ULL, 1, &seg, 0x4000000);
+	ck_assert_uint_eq(seg.log_id, 0x1F);
+	ck_assert_uint_eq(seg.seg_id, 0x3F);
+
+	/* 1 GB segments: 4 per log */
+	seg = (WALSegmentName) { 1, 7, 3 };
+	ck_assert_uint_eq(wal_segment_number(&seg, 0x40000000), 31);
+	wal_segment_next(&seg, 0x40000000);
+	ck_assert_uint_eq(seg.log_id, 8);
+	ck_assert_uint_eq(seg.seg_id, 0);
+}
+END_TEST
+
+/*
+ * Test: Parse archived segment file names (compressed, pgBackRest)
+ */
+START_TEST(test_parse_wal_segment_file)
+{
+	WALSegmentName seg;
+	const char    *suffix;
+
+	ck_assert(parse_wal_segment_file("000000010000000A000000FF", &seg, &suffix));
+	ck_assert_uint_eq(seg.log_id, 0xA);
+	ck_assert_uint_eq(seg.seg_id, 0xFF);
+	ck_assert_str_eq(suffix, "");
+	ck_assert_int_eq(wal_suffix_compression(suffix), COMPRESSION_NONE);
+
+	ck_assert(parse_wal_segment_file("000000020000000000000003.gz", &seg, &suffix));
+	ck_assert_uint_eq(seg.timeline, 2);
+	ck_assert_str_eq(suffix, ".gz");
+	ck_assert_int_eq(wal_suffix_compression(suffix), COMPRESSION_GZIP);
+
+	ck_assert(parse_wal_segment_file(
+		"000000010000000000000003-0123456789abcdef0123456789abcdef01234567.zst",
+		&seg, &suffix));
+	ck_assert_int_eq(wal_suffix_compression(suffix), COMPRESSION_ZSTD);
+	ck_assert(parse_wal_segment_file(
+		"000000010000000000000003-0123456789abcdef0123456789abcdef01234567",
+		&seg, &suffix));
+	ck_assert_int_eq(wal_suffix_compression(suffix), COMPRESSION_NONE);
+
+	/* Not segments */
+	ck_assert(!parse_wal_segment_file("000000010000000000000003.partial", &seg, NULL));
+	ck_assert(!parse_wal_segment_file("000000010000000000000003.00000028.backup",
+									  &seg, NULL));
+	ck_assert(!parse_wal_segment_file("000000010000000000000003.none", &seg, NULL));
+	ck_assert(!parse_wal_segment_file("000000010000000000000003-abc.gz", &seg, NULL));
+	ck_assert(!parse_wal_segment_file("00000002.history", &seg, NULL));
+}
+END_TEST
+
 /*
  * Test Suite
  */
@@ -197,6 +270,8 @@ xlog_suite(void)
 	tcase_add_test(tc_conversion, test_lsn_to_seg_basic);
 	tcase_add_test(tc_conversion, test_lsn_to_seg_timeline);
 	tcase_add_test(tc_conversion, test_lsn_to_seg_overflow);
+	tcase_add_test(tc_conversion, test_wal_segment_number);
+	tcase_add_test(tc_conversion, test_parse_wal_segment_file);
 	suite_add_tcase(s, tc_conversion);
 
 	return s;